@@ -4860,6 +4860,13 @@ namespace vr
 	/** Returns true if the OpenVR runtime is installed. */
 	VR_INTERFACE bool VR_CALLTYPE VR_IsRuntimeInstalled();
 
+	/** Optional. Starts reading the path registry and loading vrclient.dll on a background thread
+	* so that a later VR_Init only has to create the client. Call it as early as possible, at process
+	* start; only the first call does anything. The next VR_Init, VR_IsHmdPresent or the like waits
+	* for the prefetch if it is still running, and does the whole lookup itself if it failed.
+	*/
+	VR_INTERFACE void VR_CALLTYPE VR_PrefetchRuntime();
+
 	/** Returns where the OpenVR runtime is installed. */
 	VR_INTERFACE bool VR_GetRuntimePath( VR_OUT_STRING() char *pchPathBuffer, uint32_t unBufferSize, uint32_t *punRequiredBufferSize );
 	
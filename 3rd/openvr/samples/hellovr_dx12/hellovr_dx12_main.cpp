@@ -10,6 +10,7 @@
 #include <SDL_syswm.h>
 #include <stdio.h>
 #include <string>
+#include <vector>
 #include <cstdlib>
 
 #include <openvr.h>
@@ -17,6 +18,7 @@
 #include "shared/lodepng.h"
 #include "shared/Matrices.h"
 #include "shared/pathtools.h"
+#include "shared/foveation.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -35,25 +37,83 @@ enum RTVIndex_t
 	NUM_RTVS
 };
 
-// Slots in the ConstantBufferView/ShaderResourceView descriptor heap
+// Slots in the ConstantBufferView/ShaderResourceView descriptor heap. Constant buffers
+// are bound as root CBVs pointing into the upload ring, so only SRVs live here.
 enum CBVSRVIndex_t
 {
-	CBV_LEFT_EYE = 0,
-	CBV_RIGHT_EYE,
-	SRV_LEFT_EYE,
+	SRV_LEFT_EYE = 0,
 	SRV_RIGHT_EYE,
 	SRV_TEXTURE_MAP,
 	// Slot for texture in each possible render model
 	SRV_TEXTURE_RENDER_MODEL0,
 	SRV_TEXTURE_RENDER_MODEL_MAX = SRV_TEXTURE_RENDER_MODEL0 + vr::k_unMaxTrackedDeviceCount,
-	// Slot for transform in each possible rendermodel
-	CBV_LEFT_EYE_RENDER_MODEL0,
-	CBV_LEFT_EYE_RENDER_MODEL_MAX = CBV_LEFT_EYE_RENDER_MODEL0 + vr::k_unMaxTrackedDeviceCount,
-	CBV_RIGHT_EYE_RENDER_MODEL0,
-	CBV_RIGHT_EYE_RENDER_MODEL_MAX = CBV_RIGHT_EYE_RENDER_MODEL0 + vr::k_unMaxTrackedDeviceCount,
 	NUM_SRV_CBVS
 };
 
+// A range of an ID3D12Heap handed out by CD3D12HeapAllocator
+struct D3D12Allocation_t
+{
+	ID3D12Heap *m_pHeap;                                     // NULL when nothing is allocated
+	UINT64 m_nOffset;
+	UINT64 m_nSize;
+	uint32_t m_nBlock;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Places static buffers and textures in a few large ID3D12Heaps
+//          instead of giving each its own implicit heap with
+//          CreateCommittedResource. Buffers and textures are kept in separate
+//          heaps so this works on resource heap tier 1 hardware. Render and
+//          depth targets stay committed resources.
+//-----------------------------------------------------------------------------
+class CD3D12HeapAllocator
+{
+public:
+	CD3D12HeapAllocator();
+
+	void Init( ID3D12Device *pDevice );
+	void Shutdown();
+
+	bool BCreatePlacedResource( D3D12_HEAP_TYPE eHeapType, const D3D12_RESOURCE_DESC &resourceDesc, D3D12_RESOURCE_STATES eInitialState,
+		ComPtr< ID3D12Resource > *ppResource, D3D12Allocation_t *pAllocation );
+	bool BCreateBuffer( D3D12_HEAP_TYPE eHeapType, UINT64 nSize, D3D12_RESOURCE_STATES eInitialState, ComPtr< ID3D12Resource > *ppResource, D3D12Allocation_t *pAllocation );
+
+	// The resource placed in the range must already have been released and no longer be in use by the GPU
+	void Free( D3D12Allocation_t *pAllocation );
+
+private:
+	enum EHeapCategory
+	{
+		k_eHeapCategory_Buffers,
+		k_eHeapCategory_Textures,
+	};
+
+	struct FreeRange_t
+	{
+		UINT64 m_nOffset;
+		UINT64 m_nSize;
+	};
+
+	struct HeapBlock_t
+	{
+		ComPtr< ID3D12Heap > m_pHeap;
+		D3D12_HEAP_TYPE m_eHeapType;
+		EHeapCategory m_eCategory;
+		UINT64 m_nSize;
+		UINT64 m_nAlignment;
+		std::vector< FreeRange_t > m_vecFreeRanges;          // sorted by offset, adjacent ranges merged
+	};
+
+	static const UINT64 k_nHeapBlockSize = 32 * 1024 * 1024;
+
+	bool BAllocateFromBlock( HeapBlock_t &block, uint32_t nBlock, UINT64 nSize, UINT64 nAlignment, D3D12Allocation_t *pAllocation );
+
+	ID3D12Device *m_pDevice;
+	std::vector< HeapBlock_t > m_vecBlocks;
+};
+
+class CD3D12UploadRing;
+
 
 class DX12RenderModel
 {
@@ -61,20 +121,26 @@ public:
 	DX12RenderModel( const std::string & sRenderModelName );
 	~DX12RenderModel();
 
-	bool BInit( ID3D12Device *pDevice, ID3D12GraphicsCommandList *pCommandList, ID3D12DescriptorHeap *pCBVSRVHeap, vr::TrackedDeviceIndex_t unTrackedDeviceIndex, const vr::RenderModel_t & vrModel, const vr::RenderModel_TextureMap_t & vrDiffuseTexture );
+	bool BInit( ID3D12Device *pDevice, CD3D12HeapAllocator *pHeapAllocator, ID3D12GraphicsCommandList *pCommandList, ID3D12DescriptorHeap *pCBVSRVHeap, ID3D12RootSignature *pRootSignature, ID3D12PipelineState *pPipelineState, vr::TrackedDeviceIndex_t unTrackedDeviceIndex, const vr::RenderModel_t & vrModel, const vr::RenderModel_TextureMap_t & vrDiffuseTexture );
+	void ReleaseUploadResources();
 	void Cleanup();
-	void Draw( vr::EVREye nEye, ID3D12GraphicsCommandList *pCommandList, UINT nCBVSRVDescriptorSize, const Matrix4 &matMVP );
+	void Draw( vr::EVREye nEye, ID3D12GraphicsCommandList *pCommandList, CD3D12UploadRing *pUploadRing, const Matrix4 &matMVP );
 	const std::string & GetName() const { return m_sModelName; }
 
 private:
+	CD3D12HeapAllocator *m_pHeapAllocator;
 	ComPtr< ID3D12Resource > m_pVertexBuffer;
+	D3D12Allocation_t m_vertexBufferAllocation;
 	D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
 	ComPtr< ID3D12Resource > m_pIndexBuffer;
+	D3D12Allocation_t m_indexBufferAllocation;
 	D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
 	ComPtr< ID3D12Resource > m_pTexture;
+	D3D12Allocation_t m_textureAllocation;
 	ComPtr< ID3D12Resource > m_pTextureUploadHeap;
-	ComPtr< ID3D12Resource > m_pConstantBuffer;
-	UINT8 *m_pConstantBufferData[ 2 ];
+	D3D12Allocation_t m_textureUploadAllocation;
+	ComPtr< ID3D12CommandAllocator > m_pBundleAllocator;
+	ComPtr< ID3D12GraphicsCommandList > m_pBundle;           // binds the texture and geometry and draws, the transform is a root CBV set by the caller
 	size_t m_unVertexCount;
 	vr::TrackedDeviceIndex_t m_unTrackedDeviceIndex;
 	ID3D12DescriptorHeap *m_pCBVSRVHeap;
@@ -84,6 +150,37 @@ private:
 static bool g_bPrintf = true;
 static const int g_nFrameCount = 2; // Swapchain depth
 
+//-----------------------------------------------------------------------------
+// Purpose: One persistently mapped upload buffer that per-frame data (constant
+//          buffers, the controller axis vertices) is sub-allocated from. The
+//          space used while recording a frame is reclaimed once the swapchain
+//          slot it was recorded for comes around again, at which point
+//          RenderFrame has already waited on that slot's fence.
+//-----------------------------------------------------------------------------
+class CD3D12UploadRing
+{
+public:
+	CD3D12UploadRing();
+
+	bool BInit( ID3D12Device *pDevice, UINT64 nSize );
+	void Shutdown();
+
+	void BeginFrame( UINT nFrameIndex );
+	void EndFrame( UINT nFrameIndex );
+
+	// Returns false if the ring is full. The memory is write-combined, write it sequentially and never read it back.
+	bool BAllocate( UINT64 nSize, UINT64 nAlignment, UINT8 **ppCpuAddress, D3D12_GPU_VIRTUAL_ADDRESS *pGpuAddress );
+
+private:
+	ComPtr< ID3D12Resource > m_pBuffer;
+	UINT8 *m_pMappedData;
+	D3D12_GPU_VIRTUAL_ADDRESS m_nGpuAddress;
+	UINT64 m_nSize;
+	UINT64 m_nHead;                                          // monotonic, offset in the buffer is m_nHead % m_nSize
+	UINT64 m_nTail;                                          // everything before this has been consumed by the GPU
+	UINT64 m_nFrameEnd[ g_nFrameCount ];                     // m_nHead when each swapchain slot's frame was submitted
+};
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //------------------------------------------------------------------------------
@@ -116,6 +213,8 @@ public:
 	void UpdateControllerAxes();
 
 	bool SetupStereoRenderTargets();
+	bool SetupFoveation();
+	void SetShadingRateImage( ID3D12Resource *pShadingRateImage );
 	void SetupCompanionWindow();
 	void SetupCameras();
 
@@ -127,13 +226,32 @@ public:
 	Matrix4 GetHMDMatrixPoseEye( vr::Hmd_Eye nEye );
 	Matrix4 GetCurrentViewProjectionMatrix( vr::Hmd_Eye nEye );
 	void UpdateHMDMatrixPose();
+	void UpdateTrackedDeviceClass( vr::TrackedDeviceIndex_t unTrackedDeviceIndex );
 
 	Matrix4 ConvertSteamVRMatrixToMatrix4( const vr::HmdMatrix34_t &matPose );
+	void ConvertSteamVRMatrixToMatrix4( const vr::TrackedDevicePose_t *pPoses, Matrix4 *pMatrices, uint32_t unCount );
 
 	bool CreateAllShaders();
 
 	void SetupRenderModelForTrackedDevice( vr::TrackedDeviceIndex_t unTrackedDeviceIndex );
-	DX12RenderModel *FindOrLoadRenderModel( vr::TrackedDeviceIndex_t unTrackedDeviceIndex, const char *pchRenderModelName );
+	DX12RenderModel *CreateRenderModel( vr::TrackedDeviceIndex_t unTrackedDeviceIndex, const char *pchRenderModelName, const vr::RenderModel_t &vrModel, const vr::RenderModel_TextureMap_t &vrDiffuseTexture );
+	void UpdateRenderModelLoads();
+
+	// GPU timestamps written between the parts of a frame
+	enum EGpuTimestamp
+	{
+		k_eGpuTimestamp_FrameStart,
+		k_eGpuTimestamp_LeftEye,
+		k_eGpuTimestamp_RightEye,
+		k_eGpuTimestamp_Companion,
+		k_eGpuTimestamp_Count
+	};
+	static const uint32_t k_unTimingFrameCount = 4;          // frames in flight before a frame's timestamps are read back, at least g_nFrameCount
+
+	bool BInitFrameTiming();
+	void WriteGpuTimestamp( EGpuTimestamp eTimestamp );
+	void UpdateFrameTiming();
+	void RecordFrameTiming( uint64_t unFrame, const float *pflGpuMs );
 
 private: 
 	bool m_bDebugD3D12;
@@ -156,6 +274,7 @@ private: // SDL bookkeeping
 	SDL_Window *m_pCompanionWindow;
 	uint32_t m_nCompanionWindowWidth;
 	uint32_t m_nCompanionWindowHeight;
+	uint32_t m_unCompanionInterval;                          // mirror every nth frame ( -companioninterval ), 0 never ( -nocompanion )
 
 private:
 	int m_iTrackedControllerCount;
@@ -164,7 +283,7 @@ private:
 	int m_iValidPoseCount_Last;
 	bool m_bShowCubes;
 
-	std::string m_strPoseClasses;                            // what classes we saw poses for this frame
+	char m_rchPoseClasses[ vr::k_unMaxTrackedDeviceCount + 1 ]; // what classes we saw poses for this frame
 	char m_rDevClassChar[ vr::k_unMaxTrackedDeviceCount ];   // for each device, a character representing its class
 
 	int m_iSceneVolumeWidth;
@@ -179,6 +298,7 @@ private:
 	float m_fFarClip;
 
 	unsigned int m_uiVertcount;
+	unsigned int m_uiSceneInstanceCount;                     // one instance of the cube mesh per cell of the scene volume
 	unsigned int m_uiCompanionWindowIndexSize;
 
 	// D3D12 members
@@ -192,6 +312,11 @@ private:
 	ComPtr< ID3D12CommandQueue > m_pCommandQueue;
 	ComPtr< ID3D12CommandAllocator > m_pCommandAllocators[ g_nFrameCount ];
 	ComPtr< ID3D12GraphicsCommandList > m_pCommandList;
+	ComPtr< ID3D12CommandQueue > m_pCopyCommandQueue;        // render model texture uploads, runs alongside the direct queue
+	ComPtr< ID3D12CommandAllocator > m_pCopyCommandAllocator;
+	ComPtr< ID3D12GraphicsCommandList > m_pCopyCommandList;
+	ComPtr< ID3D12Fence > m_pCopyFence;
+	UINT64 m_nCopyFenceValue;                                // last value signalled on the copy queue
 	ComPtr< ID3D12DescriptorHeap > m_pCBVSRVHeap;
 	ComPtr< ID3D12DescriptorHeap > m_pRTVHeap;
 	ComPtr< ID3D12DescriptorHeap > m_pDSVHeap;
@@ -200,28 +325,66 @@ private:
 	ComPtr< ID3D12PipelineState > m_pCompanionPipelineState;
 	ComPtr< ID3D12PipelineState > m_pAxesPipelineState;
 	ComPtr< ID3D12PipelineState > m_pRenderModelPipelineState;
-	ComPtr< ID3D12Resource > m_pSceneConstantBuffer;
-	D3D12_CPU_DESCRIPTOR_HANDLE m_sceneConstantBufferView[ 2 ];
-	UINT8 *m_pSceneConstantBufferData[ 2 ];
+	ComPtr< ID3D12CommandAllocator > m_pSceneBundleAllocator;
+	ComPtr< ID3D12GraphicsCommandList > m_pSceneBundle;      // the cube volume, recorded once and executed for each eye
+	CD3D12HeapAllocator m_heapAllocator;
+	CD3D12UploadRing m_uploadRing;
+	static const UINT64 k_nUploadRingSize = 2 * 1024 * 1024;
+	float m_rflSceneVolumeOrigin[ 4 ];                       // xyz origin, w spacing between cells
+	uint32_t m_runSceneVolumeSize[ 4 ];
 	UINT m_nRTVDescriptorSize;
 	UINT m_nDSVDescriptorSize;
 	UINT m_nCBVSRVDescriptorSize;
 
 	ComPtr< ID3D12Resource > m_pSceneVertexBuffer;
+	D3D12Allocation_t m_sceneVertexBufferAllocation;
 	D3D12_VERTEX_BUFFER_VIEW m_sceneVertexBufferView;
 	ComPtr< ID3D12Resource > m_pTexture;
+	D3D12Allocation_t m_textureAllocation;
 	ComPtr< ID3D12Resource > m_pTextureUploadHeap;
+	D3D12Allocation_t m_textureUploadAllocation;
 	D3D12_CPU_DESCRIPTOR_HANDLE m_textureShaderResourceView;
 	ComPtr< ID3D12Resource > m_pCompanionWindowVertexBuffer;
+	D3D12Allocation_t m_companionWindowVertexBufferAllocation;
 	D3D12_VERTEX_BUFFER_VIEW m_companionWindowVertexBufferView;
 	ComPtr< ID3D12Resource > m_pCompanionWindowIndexBuffer;
+	D3D12Allocation_t m_companionWindowIndexBufferAllocation;
 	D3D12_INDEX_BUFFER_VIEW m_companionWindowIndexBufferView;
-	ComPtr< ID3D12Resource > m_pControllerAxisVertexBuffer;
-	D3D12_VERTEX_BUFFER_VIEW m_controllerAxisVertexBufferView;
+	D3D12_VERTEX_BUFFER_VIEW m_controllerAxisVertexBufferView; // points into the upload ring, rewritten every frame
+
+	// Per eye -foveate shading rate images, one D3D12_SHADING_RATE per tile
+	FoveationSettings_t m_foveation;
+	ComPtr< ID3D12Resource > m_pShadingRateImage[ 2 ];
+	D3D12Allocation_t m_shadingRateImageAllocations[ 2 ];
+	ComPtr< ID3D12Resource > m_pShadingRateUploadHeap[ 2 ];
+	D3D12Allocation_t m_shadingRateUploadAllocations[ 2 ];
+#ifdef __ID3D12GraphicsCommandList5_INTERFACE_DEFINED__
+	ComPtr< ID3D12GraphicsCommandList5 > m_pCommandList5;    // set once the shading rate images are ready
+#endif
 	
 
 	unsigned int m_uiControllerVertcount;
 
+	// Frame timing resources
+	ComPtr< ID3D12QueryHeap > m_pTimestampQueryHeap;         // k_eGpuTimestamp_Count queries per timing frame
+	ComPtr< ID3D12Resource > m_pTimestampReadbackBuffer;
+	UINT64 m_nTimestampFrequency;
+	uint64_t m_unTimingFrame;                                // frame whose timestamps are being written
+	std::string m_strTimingCsvPath;                          // -timingcsv, one row per frame once its timestamps are back
+	FILE *m_pTimingCsv;
+	std::string m_strWindowTitle;
+
+	struct FrameTimingSums_t
+	{
+		uint32_t m_unFrames;
+		double m_flGpuMs[ k_eGpuTimestamp_Count - 1 ];
+		double m_flCompositorGpuMs;
+		double m_flFrameIntervalMs;
+		uint32_t m_unDroppedFrames;
+	};
+	FrameTimingSums_t m_frameTimingSums;                     // since the companion window title was last updated
+	uint32_t m_unFrameTimingTitleTicks;
+
 	Matrix4 m_mat4HMDPose;
 	Matrix4 m_mat4eyePosLeft;
 	Matrix4 m_mat4eyePosRight;
@@ -261,6 +424,15 @@ private:
 
 	std::vector< DX12RenderModel * > m_vecRenderModels;
 	DX12RenderModel *m_rTrackedDeviceToRenderModel[ vr::k_unMaxTrackedDeviceCount ];
+
+	struct PendingRenderModel_t
+	{
+		std::string m_sName;                                 // empty when no model is loading for the device
+		vr::RenderModel_t *m_pModel = nullptr;               // geometry that is waiting on its texture
+		DX12RenderModel *m_pUploadingModel = nullptr;        // created, texture still being copied on the copy queue
+		UINT64 m_nUploadFenceValue = 0;                      // m_pCopyFence value that marks the upload as done
+	};
+	PendingRenderModel_t m_rPendingRenderModel[ vr::k_unMaxTrackedDeviceCount ];
 };
 
 //-----------------------------------------------------------------------------
@@ -282,6 +454,258 @@ void dprintf( const char *fmt, ... )
 	OutputDebugStringA( buffer );
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+//-----------------------------------------------------------------------------
+CD3D12HeapAllocator::CD3D12HeapAllocator()
+	: m_pDevice( NULL )
+{
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CD3D12HeapAllocator::Init( ID3D12Device *pDevice )
+{
+	m_pDevice = pDevice;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Releases every heap. All placed resources must be released first.
+//-----------------------------------------------------------------------------
+void CD3D12HeapAllocator::Shutdown()
+{
+	m_vecBlocks.clear();
+	m_pDevice = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: First fit allocation from one heap block
+//-----------------------------------------------------------------------------
+bool CD3D12HeapAllocator::BAllocateFromBlock( HeapBlock_t &block, uint32_t nBlock, UINT64 nSize, UINT64 nAlignment, D3D12Allocation_t *pAllocation )
+{
+	for ( size_t nRange = 0; nRange < block.m_vecFreeRanges.size(); nRange++ )
+	{
+		FreeRange_t &range = block.m_vecFreeRanges[ nRange ];
+		UINT64 nOffset = ( range.m_nOffset + nAlignment - 1 ) & ~( nAlignment - 1 );
+		if ( nOffset + nSize > range.m_nOffset + range.m_nSize )
+			continue;
+
+		// Split off whatever is left on either side of the allocation
+		FreeRange_t after = { nOffset + nSize, range.m_nOffset + range.m_nSize - ( nOffset + nSize ) };
+		range.m_nSize = nOffset - range.m_nOffset;
+		if ( after.m_nSize > 0 )
+		{
+			block.m_vecFreeRanges.insert( block.m_vecFreeRanges.begin() + nRange + 1, after );
+		}
+		if ( range.m_nSize == 0 )
+		{
+			block.m_vecFreeRanges.erase( block.m_vecFreeRanges.begin() + nRange );
+		}
+
+		pAllocation->m_pHeap = block.m_pHeap.Get();
+		pAllocation->m_nOffset = nOffset;
+		pAllocation->m_nSize = nSize;
+		pAllocation->m_nBlock = nBlock;
+		return true;
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Creates a resource placed in a shared heap of the given type.
+//          Requests larger than a heap block get a heap of their own.
+//-----------------------------------------------------------------------------
+bool CD3D12HeapAllocator::BCreatePlacedResource( D3D12_HEAP_TYPE eHeapType, const D3D12_RESOURCE_DESC &resourceDesc, D3D12_RESOURCE_STATES eInitialState,
+	ComPtr< ID3D12Resource > *ppResource, D3D12Allocation_t *pAllocation )
+{
+	memset( pAllocation, 0, sizeof( *pAllocation ) );
+
+	D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = m_pDevice->GetResourceAllocationInfo( 0, 1, &resourceDesc );
+	EHeapCategory eCategory = ( resourceDesc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ) ? k_eHeapCategory_Buffers : k_eHeapCategory_Textures;
+
+	bool bAllocated = false;
+	for ( uint32_t nBlock = 0; nBlock < m_vecBlocks.size() && !bAllocated; nBlock++ )
+	{
+		HeapBlock_t &block = m_vecBlocks[ nBlock ];
+		if ( block.m_eHeapType != eHeapType || block.m_eCategory != eCategory || block.m_nAlignment < allocationInfo.Alignment )
+			continue;
+
+		bAllocated = BAllocateFromBlock( block, nBlock, allocationInfo.SizeInBytes, allocationInfo.Alignment, pAllocation );
+	}
+
+	if ( !bAllocated )
+	{
+		D3D12_HEAP_DESC heapDesc = {};
+		heapDesc.SizeInBytes = allocationInfo.SizeInBytes > k_nHeapBlockSize ? allocationInfo.SizeInBytes : k_nHeapBlockSize;
+		heapDesc.Properties = CD3DX12_HEAP_PROPERTIES( eHeapType );
+		heapDesc.Alignment = allocationInfo.Alignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT ? allocationInfo.Alignment : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		heapDesc.Flags = ( eCategory == k_eHeapCategory_Buffers ) ? D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+
+		HeapBlock_t block;
+		if ( FAILED( m_pDevice->CreateHeap( &heapDesc, IID_PPV_ARGS( &block.m_pHeap ) ) ) )
+		{
+			dprintf( "%s - CreateHeap of %llu bytes failed.\n", __FUNCTION__, heapDesc.SizeInBytes );
+			return false;
+		}
+		block.m_eHeapType = eHeapType;
+		block.m_eCategory = eCategory;
+		block.m_nSize = heapDesc.SizeInBytes;
+		block.m_nAlignment = heapDesc.Alignment;
+		FreeRange_t range = { 0, heapDesc.SizeInBytes };
+		block.m_vecFreeRanges.push_back( range );
+		m_vecBlocks.push_back( block );
+
+		uint32_t nBlock = ( uint32_t ) m_vecBlocks.size() - 1;
+		bAllocated = BAllocateFromBlock( m_vecBlocks[ nBlock ], nBlock, allocationInfo.SizeInBytes, allocationInfo.Alignment, pAllocation );
+	}
+
+	if ( !bAllocated || FAILED( m_pDevice->CreatePlacedResource( pAllocation->m_pHeap, pAllocation->m_nOffset, &resourceDesc, eInitialState, nullptr, IID_PPV_ARGS( ppResource->ReleaseAndGetAddressOf() ) ) ) )
+	{
+		dprintf( "%s - Unable to place a resource of %llu bytes.\n", __FUNCTION__, allocationInfo.SizeInBytes );
+		Free( pAllocation );
+		return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+bool CD3D12HeapAllocator::BCreateBuffer( D3D12_HEAP_TYPE eHeapType, UINT64 nSize, D3D12_RESOURCE_STATES eInitialState, ComPtr< ID3D12Resource > *ppResource, D3D12Allocation_t *pAllocation )
+{
+	return BCreatePlacedResource( eHeapType, CD3DX12_RESOURCE_DESC::Buffer( nSize ), eInitialState, ppResource, pAllocation );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns a range to its block's free list, merging with neighbours
+//-----------------------------------------------------------------------------
+void CD3D12HeapAllocator::Free( D3D12Allocation_t *pAllocation )
+{
+	if ( pAllocation->m_pHeap == NULL )
+		return;
+
+	std::vector< FreeRange_t > &vecFreeRanges = m_vecBlocks[ pAllocation->m_nBlock ].m_vecFreeRanges;
+	size_t nInsert = 0;
+	while ( nInsert < vecFreeRanges.size() && vecFreeRanges[ nInsert ].m_nOffset < pAllocation->m_nOffset )
+	{
+		nInsert++;
+	}
+
+	FreeRange_t range = { pAllocation->m_nOffset, pAllocation->m_nSize };
+	vecFreeRanges.insert( vecFreeRanges.begin() + nInsert, range );
+
+	if ( nInsert + 1 < vecFreeRanges.size() && vecFreeRanges[ nInsert ].m_nOffset + vecFreeRanges[ nInsert ].m_nSize == vecFreeRanges[ nInsert + 1 ].m_nOffset )
+	{
+		vecFreeRanges[ nInsert ].m_nSize += vecFreeRanges[ nInsert + 1 ].m_nSize;
+		vecFreeRanges.erase( vecFreeRanges.begin() + nInsert + 1 );
+	}
+	if ( nInsert > 0 && vecFreeRanges[ nInsert - 1 ].m_nOffset + vecFreeRanges[ nInsert - 1 ].m_nSize == vecFreeRanges[ nInsert ].m_nOffset )
+	{
+		vecFreeRanges[ nInsert - 1 ].m_nSize += vecFreeRanges[ nInsert ].m_nSize;
+		vecFreeRanges.erase( vecFreeRanges.begin() + nInsert );
+	}
+
+	memset( pAllocation, 0, sizeof( *pAllocation ) );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+//-----------------------------------------------------------------------------
+CD3D12UploadRing::CD3D12UploadRing()
+	: m_pMappedData( NULL )
+	, m_nGpuAddress( 0 )
+	, m_nSize( 0 )
+	, m_nHead( 0 )
+	, m_nTail( 0 )
+{
+	memset( m_nFrameEnd, 0, sizeof( m_nFrameEnd ) );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Creates and maps the ring buffer, it stays mapped until Shutdown
+//-----------------------------------------------------------------------------
+bool CD3D12UploadRing::BInit( ID3D12Device *pDevice, UINT64 nSize )
+{
+	if ( FAILED( pDevice->CreateCommittedResource( &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer( nSize ),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS( &m_pBuffer ) ) ) )
+	{
+		return false;
+	}
+
+	CD3DX12_RANGE readRange( 0, 0 );
+	if ( FAILED( m_pBuffer->Map( 0, &readRange, reinterpret_cast< void** >( &m_pMappedData ) ) ) )
+		return false;
+
+	m_nGpuAddress = m_pBuffer->GetGPUVirtualAddress();
+	m_nSize = nSize;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CD3D12UploadRing::Shutdown()
+{
+	if ( m_pBuffer )
+	{
+		m_pBuffer->Unmap( 0, nullptr );
+		m_pBuffer.Reset();
+	}
+	m_pMappedData = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Called once the GPU has finished the last frame recorded for this
+//          swapchain slot, everything allocated up to then can be reused
+//-----------------------------------------------------------------------------
+void CD3D12UploadRing::BeginFrame( UINT nFrameIndex )
+{
+	if ( m_nFrameEnd[ nFrameIndex ] > m_nTail )
+	{
+		m_nTail = m_nFrameEnd[ nFrameIndex ];
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Called after the frame's command list has been executed
+//-----------------------------------------------------------------------------
+void CD3D12UploadRing::EndFrame( UINT nFrameIndex )
+{
+	m_nFrameEnd[ nFrameIndex ] = m_nHead;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Sub-allocates nSize bytes. An allocation never straddles the end
+//          of the buffer, the remainder is skipped instead.
+//-----------------------------------------------------------------------------
+bool CD3D12UploadRing::BAllocate( UINT64 nSize, UINT64 nAlignment, UINT8 **ppCpuAddress, D3D12_GPU_VIRTUAL_ADDRESS *pGpuAddress )
+{
+	if ( m_pMappedData == NULL || nSize > m_nSize )
+		return false;
+
+	UINT64 nStart = ( m_nHead + nAlignment - 1 ) & ~( nAlignment - 1 );
+	if ( ( nStart % m_nSize ) + nSize > m_nSize )
+	{
+		nStart += m_nSize - ( nStart % m_nSize );
+	}
+
+	if ( nStart + nSize - m_nTail > m_nSize )
+	{
+		dprintf( "%s - Upload ring is full, %llu bytes requested.\n", __FUNCTION__, nSize );
+		return false;
+	}
+
+	m_nHead = nStart + nSize;
+	*ppCpuAddress = m_pMappedData + ( nStart % m_nSize );
+	*pGpuAddress = m_nGpuAddress + ( nStart % m_nSize );
+	return true;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Constructor
 //-----------------------------------------------------------------------------
@@ -289,6 +713,7 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 	: m_pCompanionWindow(NULL)
 	, m_nCompanionWindowWidth( 640 )
 	, m_nCompanionWindowHeight( 320 )
+	, m_unCompanionInterval( 1 )
 	, m_pHMD( NULL )
 	, m_pRenderModels( NULL )
 	, m_bDebugD3D12( false )
@@ -302,15 +727,30 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 	, m_iValidPoseCount( 0 )
 	, m_iValidPoseCount_Last( -1 )
 	, m_iSceneVolumeInit( 20 )
-	, m_strPoseClasses("")
 	, m_bShowCubes( true )
 	, m_nFrameIndex( 0 )
 	, m_fenceEvent( NULL )
+	, m_nCopyFenceValue( 0 )
 	, m_nRTVDescriptorSize( 0 )
 	, m_nCBVSRVDescriptorSize( 0 )
 	, m_nDSVDescriptorSize( 0 )
+	, m_nTimestampFrequency( 0 )
+	, m_unTimingFrame( 0 )
+	, m_pTimingCsv( NULL )
+	, m_unFrameTimingTitleTicks( 0 )
 {
-	memset( m_pSceneConstantBufferData, 0, sizeof( m_pSceneConstantBufferData ) );
+	memset( m_rflSceneVolumeOrigin, 0, sizeof( m_rflSceneVolumeOrigin ) );
+	memset( m_runSceneVolumeSize, 0, sizeof( m_runSceneVolumeSize ) );
+	memset( &m_sceneVertexBufferAllocation, 0, sizeof( m_sceneVertexBufferAllocation ) );
+	memset( &m_textureAllocation, 0, sizeof( m_textureAllocation ) );
+	memset( &m_textureUploadAllocation, 0, sizeof( m_textureUploadAllocation ) );
+	memset( &m_companionWindowVertexBufferAllocation, 0, sizeof( m_companionWindowVertexBufferAllocation ) );
+	memset( &m_companionWindowIndexBufferAllocation, 0, sizeof( m_companionWindowIndexBufferAllocation ) );
+	memset( &m_controllerAxisVertexBufferView, 0, sizeof( m_controllerAxisVertexBufferView ) );
+	memset( &m_frameTimingSums, 0, sizeof( m_frameTimingSums ) );
+	memset( m_shadingRateImageAllocations, 0, sizeof( m_shadingRateImageAllocations ) );
+	memset( m_shadingRateUploadAllocations, 0, sizeof( m_shadingRateUploadAllocations ) );
+	Foveation_InitSettings( &m_foveation );
 
 	for( int i = 1; i < argc; i++ )
 	{
@@ -345,9 +785,42 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 			m_iSceneVolumeInit = atoi( argv[ i + 1 ] );
 			i++;
 		}
+		else if( !stricmp( argv[i], "-nocompanion" ) )
+		{
+			m_unCompanionInterval = 0;
+		}
+		else if ( !stricmp( argv[i], "-companioninterval" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
+		{
+			int nInterval = atoi( argv[ i + 1 ] );
+			m_unCompanionInterval = nInterval > 0 ? ( uint32_t )nInterval : 0;
+			i++;
+		}
+		else if ( !stricmp( argv[i], "-companionscale" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
+		{
+			// shrinks the window, and the swapchain with it, never grows it
+			float flScale = ( float )atof( argv[ i + 1 ] );
+			if ( flScale > 0.0f && flScale < 1.0f )
+			{
+				uint32_t nWidth = ( uint32_t )( flScale * m_nCompanionWindowWidth );
+				uint32_t nHeight = ( uint32_t )( flScale * m_nCompanionWindowHeight );
+				m_nCompanionWindowWidth = nWidth ? nWidth : 1;
+				m_nCompanionWindowHeight = nHeight ? nHeight : 1;
+			}
+			i++;
+		}
+		else if ( !stricmp( argv[i], "-timingcsv" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
+		{
+			m_strTimingCsvPath = argv[ i + 1 ];
+			i++;
+		}
+		else if ( Foveation_ParseArg( argc, argv, &i, &m_foveation ) )
+		{
+			// consumed along with its values
+		}
 	}
 	// other initialization tasks are done in BInit
 	memset( m_rDevClassChar, 0, sizeof( m_rDevClassChar ) );
+	memset( m_rchPoseClasses, 0, sizeof( m_rchPoseClasses ) );
 };
 
 //-----------------------------------------------------------------------------
@@ -415,7 +888,7 @@ bool CMainApplication::BInit()
 
 	int nWindowPosX = 700;
 	int nWindowPosY = 100;
-	Uint32 unWindowFlags = SDL_WINDOW_SHOWN;
+	Uint32 unWindowFlags = m_unCompanionInterval ? SDL_WINDOW_SHOWN : SDL_WINDOW_HIDDEN;
 
 	m_pCompanionWindow = SDL_CreateWindow( "hellovr [D3D12]", nWindowPosX, nWindowPosY, m_nCompanionWindowWidth, m_nCompanionWindowHeight, unWindowFlags );
 	if (m_pCompanionWindow == NULL)
@@ -430,8 +903,8 @@ bool CMainApplication::BInit()
 	m_strDriver = GetTrackedDeviceString( m_pHMD, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_TrackingSystemName_String );
 	m_strDisplay = GetTrackedDeviceString( m_pHMD, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SerialNumber_String );
 
-	std::string strWindowTitle = "hellovr [D3D12] - " + m_strDriver + " " + m_strDisplay;
-	SDL_SetWindowTitle( m_pCompanionWindow, strWindowTitle.c_str() );
+	m_strWindowTitle = "hellovr [D3D12] - " + m_strDriver + " " + m_strDisplay;
+	SDL_SetWindowTitle( m_pCompanionWindow, m_strWindowTitle.c_str() );
 	
 	// cube array
 	m_iSceneVolumeWidth = m_iSceneVolumeInit;
@@ -445,6 +918,7 @@ bool CMainApplication::BInit()
 	m_fFarClip = 30.0f;
  
  	m_uiVertcount = 0;
+ 	m_uiSceneInstanceCount = 0;
  
 	if ( !BInitD3D12() )
 	{
@@ -458,6 +932,9 @@ bool CMainApplication::BInit()
 		return false;
 	}
 
+	for ( vr::TrackedDeviceIndex_t unDevice = 0; unDevice < vr::k_unMaxTrackedDeviceCount; unDevice++ )
+		UpdateTrackedDeviceClass( unDevice );
+
 	return true;
 }
 
@@ -517,6 +994,20 @@ bool CMainApplication::BInitD3D12()
 		return false;
 	}
 
+	// Create the copy queue used for uploads after startup
+	D3D12_COMMAND_QUEUE_DESC copyQueueDesc = {};
+	copyQueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	copyQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	if ( FAILED( m_pDevice->CreateCommandQueue( &copyQueueDesc, IID_PPV_ARGS( &m_pCopyCommandQueue ) ) ) ||
+		FAILED( m_pDevice->CreateCommandAllocator( D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS( &m_pCopyCommandAllocator ) ) ) ||
+		FAILED( m_pDevice->CreateCommandList( 0, D3D12_COMMAND_LIST_TYPE_COPY, m_pCopyCommandAllocator.Get(), nullptr, IID_PPV_ARGS( &m_pCopyCommandList ) ) ) ||
+		FAILED( m_pDevice->CreateFence( 0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS( &m_pCopyFence ) ) ) )
+	{
+		dprintf( "Failed to create D3D12 copy queue.\n" );
+		return false;
+	}
+	m_pCopyCommandList->Close();
+
 	// Create the swapchain
 	DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
 	swapChainDesc.BufferCount = g_nFrameCount;
@@ -587,39 +1078,12 @@ bool CMainApplication::BInitD3D12()
 		m_pDevice->CreateRenderTargetView( m_pSwapChainRenderTarget[ nFrame ].Get(), nullptr, rtvHandle );
 	}
 
-	// Create constant buffer
+	// Static resources are placed in shared heaps, per-frame data comes from the upload ring
+	m_heapAllocator.Init( m_pDevice.Get() );
+	if ( !m_uploadRing.BInit( m_pDevice.Get(), k_nUploadRingSize ) )
 	{
-		m_pDevice->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer( 1024 * 64 ),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS( &m_pSceneConstantBuffer ) );
-
-		// Keep as persistently mapped buffer, store left eye in first 256 bytes, right eye in second
-		UINT8 *pBuffer;
-		CD3DX12_RANGE readRange( 0, 0 );
-		m_pSceneConstantBuffer->Map( 0, &readRange, reinterpret_cast<void**>( &pBuffer ) );
-		// Left eye to first 256 bytes, right eye to second 256 bytes
-		m_pSceneConstantBufferData[ 0 ] = pBuffer;
-		m_pSceneConstantBufferData[ 1 ] = pBuffer + 256;
-
-		// Left eye CBV
-		CD3DX12_CPU_DESCRIPTOR_HANDLE cbvLeftEyeHandle( m_pCBVSRVHeap->GetCPUDescriptorHandleForHeapStart() );
-		cbvLeftEyeHandle.Offset( CBV_LEFT_EYE, m_nCBVSRVDescriptorSize );
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-		cbvDesc.BufferLocation = m_pSceneConstantBuffer->GetGPUVirtualAddress();
-		cbvDesc.SizeInBytes = ( sizeof( Matrix4 ) + 255 ) & ~255; // Pad to 256 bytes
-		m_pDevice->CreateConstantBufferView( &cbvDesc, cbvLeftEyeHandle );
-		m_sceneConstantBufferView[ 0 ] = cbvLeftEyeHandle;
-
-		// Right eye CBV
-		CD3DX12_CPU_DESCRIPTOR_HANDLE cbvRightEyeHandle( m_pCBVSRVHeap->GetCPUDescriptorHandleForHeapStart() );
-		cbvRightEyeHandle.Offset( CBV_RIGHT_EYE, m_nCBVSRVDescriptorSize );
-		cbvDesc.BufferLocation += 256;
-		m_pDevice->CreateConstantBufferView( &cbvDesc, cbvRightEyeHandle );
-		m_sceneConstantBufferView[ 1 ] = cbvRightEyeHandle;
+		dprintf( "Failed to create upload ring.\n" );
+		return false;
 	}
 
 	// Create fence
@@ -631,6 +1095,9 @@ bool CMainApplication::BInitD3D12()
 		m_fenceEvent = CreateEvent( nullptr, FALSE, FALSE, nullptr );
 	}
 
+	if ( !BInitFrameTiming() )
+		return false;
+
 	if( !CreateAllShaders() )
 		return false;
 
@@ -681,6 +1148,29 @@ bool CMainApplication::BInitCompositor()
 //-----------------------------------------------------------------------------
 void CMainApplication::Shutdown()
 {
+	// Wait for the GPU before releasing anything it may still be reading
+	if ( m_pCommandQueue && m_pFence )
+	{
+		m_pCommandQueue->Signal( m_pFence.Get(), m_nFenceValues[ m_nFrameIndex ] );
+		m_pFence->SetEventOnCompletion( m_nFenceValues[ m_nFrameIndex ], m_fenceEvent );
+		WaitForSingleObjectEx( m_fenceEvent, INFINITE, FALSE );
+		m_nFenceValues[ m_nFrameIndex ]++;
+	}
+	if ( m_pCopyFence && m_pCopyFence->GetCompletedValue() < m_nCopyFenceValue )
+	{
+		m_pCopyFence->SetEventOnCompletion( m_nCopyFenceValue, m_fenceEvent );
+		WaitForSingleObjectEx( m_fenceEvent, INFINITE, FALSE );
+	}
+
+	for( uint32_t unTrackedDevice = 0; unTrackedDevice < vr::k_unMaxTrackedDeviceCount; unTrackedDevice++ )
+	{
+		if( m_rPendingRenderModel[ unTrackedDevice ].m_pModel )
+		{
+			vr::VRRenderModels()->FreeRenderModel( m_rPendingRenderModel[ unTrackedDevice ].m_pModel );
+			m_rPendingRenderModel[ unTrackedDevice ].m_pModel = NULL;
+		}
+	}
+
 	if( m_pHMD )
 	{
 		vr::VR_Shutdown();
@@ -693,6 +1183,36 @@ void CMainApplication::Shutdown()
 	}
 	m_vecRenderModels.clear();
 
+	// Placed resources have to go before the heaps they live in
+	m_pSceneVertexBuffer.Reset();
+	m_heapAllocator.Free( &m_sceneVertexBufferAllocation );
+	m_pTexture.Reset();
+	m_heapAllocator.Free( &m_textureAllocation );
+	m_pTextureUploadHeap.Reset();
+	m_heapAllocator.Free( &m_textureUploadAllocation );
+	m_pCompanionWindowVertexBuffer.Reset();
+	m_heapAllocator.Free( &m_companionWindowVertexBufferAllocation );
+	m_pCompanionWindowIndexBuffer.Reset();
+	m_heapAllocator.Free( &m_companionWindowIndexBufferAllocation );
+#ifdef __ID3D12GraphicsCommandList5_INTERFACE_DEFINED__
+	m_pCommandList5.Reset();
+#endif
+	for ( int nEye = 0; nEye < 2; nEye++ )
+	{
+		m_pShadingRateImage[ nEye ].Reset();
+		m_heapAllocator.Free( &m_shadingRateImageAllocations[ nEye ] );
+		m_pShadingRateUploadHeap[ nEye ].Reset();
+		m_heapAllocator.Free( &m_shadingRateUploadAllocations[ nEye ] );
+	}
+	m_uploadRing.Shutdown();
+	m_heapAllocator.Shutdown();
+
+	if( m_pTimingCsv )
+	{
+		fclose( m_pTimingCsv );
+		m_pTimingCsv = NULL;
+	}
+
 	if( m_pCompanionWindow )
 	{
 		SDL_DestroyWindow(m_pCompanionWindow);
@@ -780,6 +1300,7 @@ void CMainApplication::ProcessVREvent( const vr::VREvent_t & event )
 	case vr::VREvent_TrackedDeviceActivated:
 		{
 			SetupRenderModelForTrackedDevice( event.trackedDeviceIndex );
+			UpdateTrackedDeviceClass( event.trackedDeviceIndex );
 			dprintf( "Device %u attached. Setting up render model.\n", event.trackedDeviceIndex );
 		}
 		break;
@@ -801,9 +1322,11 @@ void CMainApplication::ProcessVREvent( const vr::VREvent_t & event )
 //-----------------------------------------------------------------------------
 void CMainApplication::RenderFrame()
 {
+	bool bCompanionFrame = true;
 	if ( m_pHMD )
 	{
 		m_pCommandAllocators[ m_nFrameIndex ]->Reset();
+		m_uploadRing.BeginFrame( m_nFrameIndex );
 
 		m_pCommandList->Reset( m_pCommandAllocators[ m_nFrameIndex ].Get(), m_pScenePipelineState.Get() );
 		m_pCommandList->SetGraphicsRootSignature( m_pRootSignature.Get() );
@@ -811,15 +1334,26 @@ void CMainApplication::RenderFrame()
 		ID3D12DescriptorHeap *ppHeaps[] = { m_pCBVSRVHeap.Get() };
 		m_pCommandList->SetDescriptorHeaps( _countof( ppHeaps ), ppHeaps );
 
+		UpdateFrameTiming();
+		WriteGpuTimestamp( k_eGpuTimestamp_FrameStart );
+
+		UpdateRenderModelLoads();
 		UpdateControllerAxes();
 		RenderStereoTargets();
-		RenderCompanionWindow();
+
+		// the mirror, and the present that shows it, only every m_unCompanionInterval frames
+		bCompanionFrame = m_unCompanionInterval != 0 && m_unTimingFrame % m_unCompanionInterval == 0;
+		if ( bCompanionFrame )
+			RenderCompanionWindow();
+		WriteGpuTimestamp( k_eGpuTimestamp_Companion );
+		m_unTimingFrame++;
 
 		m_pCommandList->Close();
 
 		// Execute the command list.
 		ID3D12CommandList* ppCommandLists[] = { m_pCommandList.Get() };
 		m_pCommandQueue->ExecuteCommandLists( _countof( ppCommandLists ), ppCommandLists );
+		m_uploadRing.EndFrame( m_nFrameIndex );
 
 		vr::VRTextureBounds_t bounds;
 		bounds.uMin = 0.0f;
@@ -837,14 +1371,19 @@ void CMainApplication::RenderFrame()
 	}
 
 	// Present
-	m_pSwapChain->Present( 0, 0 );
+	if ( bCompanionFrame )
+	{
+		m_pSwapChain->Present( 0, 0 );
+	}
 
 	// Wait for completion
 	{
 		const UINT64 nCurrentFenceValue = m_nFenceValues[ m_nFrameIndex ];
 		m_pCommandQueue->Signal( m_pFence.Get(), nCurrentFenceValue );
 
-		m_nFrameIndex = m_pSwapChain->GetCurrentBackBufferIndex();
+		// The frame slots cycle whether or not the swapchain was presented, so
+		// they only match its back buffers while every frame is mirrored
+		m_nFrameIndex = ( m_nFrameIndex + 1 ) % g_nFrameCount;
 		if ( m_pFence->GetCompletedValue() < m_nFenceValues[ m_nFrameIndex ] )
 		{
 			m_pFence->SetEventOnCompletion( m_nFenceValues[ m_nFrameIndex ], m_fenceEvent );
@@ -860,12 +1399,144 @@ void CMainApplication::RenderFrame()
 		m_iValidPoseCount_Last = m_iValidPoseCount;
 		m_iTrackedControllerCount_Last = m_iTrackedControllerCount;
 		
-		dprintf( "PoseCount:%d(%s) Controllers:%d\n", m_iValidPoseCount, m_strPoseClasses.c_str(), m_iTrackedControllerCount );
+		dprintf( "PoseCount:%d(%s) Controllers:%d\n", m_iValidPoseCount, m_rchPoseClasses, m_iTrackedControllerCount );
 	}
 
 	UpdateHMDMatrixPose();
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Creates the timestamp query heap and its readback buffer and opens
+//          the -timingcsv file
+//-----------------------------------------------------------------------------
+bool CMainApplication::BInitFrameTiming()
+{
+	D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+	queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = k_unTimingFrameCount * k_eGpuTimestamp_Count;
+	if ( FAILED( m_pDevice->CreateQueryHeap( &queryHeapDesc, IID_PPV_ARGS( &m_pTimestampQueryHeap ) ) ) )
+	{
+		dprintf( "Failed to create timestamp query heap.\n" );
+		return false;
+	}
+
+	if ( FAILED( m_pDevice->CreateCommittedResource( &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_READBACK ),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer( queryHeapDesc.Count * sizeof( UINT64 ) ),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS( &m_pTimestampReadbackBuffer ) ) ) )
+	{
+		dprintf( "Failed to create timestamp readback buffer.\n" );
+		return false;
+	}
+
+	m_pCommandQueue->GetTimestampFrequency( &m_nTimestampFrequency );
+
+	if ( !m_strTimingCsvPath.empty() )
+	{
+		m_pTimingCsv = fopen( m_strTimingCsvPath.c_str(), "w" );
+		if ( !m_pTimingCsv )
+		{
+			dprintf( "Unable to open %s for writing.\n", m_strTimingCsvPath.c_str() );
+			return false;
+		}
+
+		fprintf( m_pTimingCsv, "frame,left_eye_gpu_ms,right_eye_gpu_ms,companion_gpu_ms,"
+			"compositor_frame,pre_submit_gpu_ms,post_submit_gpu_ms,total_render_gpu_ms,compositor_render_gpu_ms,"
+			"compositor_render_cpu_ms,compositor_idle_cpu_ms,client_frame_interval_ms,submit_frame_ms,"
+			"num_frame_presents,num_mis_presented,num_dropped_frames,reprojection_flags\n" );
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes a GPU timestamp into the current frame's queries. The last
+//          one of the frame also resolves the frame's queries for readback.
+//-----------------------------------------------------------------------------
+void CMainApplication::WriteGpuTimestamp( EGpuTimestamp eTimestamp )
+{
+	UINT nFirstQuery = ( UINT )( m_unTimingFrame % k_unTimingFrameCount ) * k_eGpuTimestamp_Count;
+	m_pCommandList->EndQuery( m_pTimestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, nFirstQuery + eTimestamp );
+
+	if ( eTimestamp == k_eGpuTimestamp_Count - 1 )
+	{
+		m_pCommandList->ResolveQueryData( m_pTimestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, nFirstQuery, k_eGpuTimestamp_Count,
+			m_pTimestampReadbackBuffer.Get(), nFirstQuery * sizeof( UINT64 ) );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads back the timestamps of the frame whose queries are about to
+//          be reused. RenderFrame waits on the fence g_nFrameCount frames
+//          back, so that frame has always finished on the GPU by now.
+//-----------------------------------------------------------------------------
+void CMainApplication::UpdateFrameTiming()
+{
+	if ( m_unTimingFrame < k_unTimingFrameCount )
+		return;
+
+	UINT nFirstQuery = ( UINT )( m_unTimingFrame % k_unTimingFrameCount ) * k_eGpuTimestamp_Count;
+	CD3DX12_RANGE readRange( nFirstQuery * sizeof( UINT64 ), ( nFirstQuery + k_eGpuTimestamp_Count ) * sizeof( UINT64 ) );
+	UINT64 *pTimestamps = NULL;
+	if ( FAILED( m_pTimestampReadbackBuffer->Map( 0, &readRange, reinterpret_cast< void ** >( &pTimestamps ) ) ) )
+		return;
+
+	double flMsPerTick = 1000.0 / m_nTimestampFrequency;
+	float rflGpuMs[ k_eGpuTimestamp_Count - 1 ];
+	for ( uint32_t i = 0; i < k_eGpuTimestamp_Count - 1; i++ )
+		rflGpuMs[ i ] = ( float )( ( pTimestamps[ nFirstQuery + i + 1 ] - pTimestamps[ nFirstQuery + i ] ) * flMsPerTick );
+
+	CD3DX12_RANGE writtenRange( 0, 0 );
+	m_pTimestampReadbackBuffer->Unmap( 0, &writtenRange );
+
+	RecordFrameTiming( m_unTimingFrame - k_unTimingFrameCount, rflGpuMs );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Pairs a frame's GPU times with the compositor's latest frame
+//          timing, appends them to the -timingcsv file and shows the averages
+//          in the companion window title twice a second.
+//-----------------------------------------------------------------------------
+void CMainApplication::RecordFrameTiming( uint64_t unFrame, const float *pflGpuMs )
+{
+	vr::Compositor_FrameTiming timing;
+	memset( &timing, 0, sizeof( timing ) );
+	timing.m_nSize = sizeof( vr::Compositor_FrameTiming );
+	vr::VRCompositor()->GetFrameTiming( &timing, 1 );
+
+	if ( m_pTimingCsv )
+	{
+		fprintf( m_pTimingCsv, "%llu,%.4f,%.4f,%.4f,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%u,%u,%u,%u\n",
+			( unsigned long long )unFrame, pflGpuMs[ 0 ], pflGpuMs[ 1 ], pflGpuMs[ 2 ],
+			timing.m_nFrameIndex, timing.m_flPreSubmitGpuMs, timing.m_flPostSubmitGpuMs, timing.m_flTotalRenderGpuMs, timing.m_flCompositorRenderGpuMs,
+			timing.m_flCompositorRenderCpuMs, timing.m_flCompositorIdleCpuMs, timing.m_flClientFrameIntervalMs, timing.m_flSubmitFrameMs,
+			timing.m_nNumFramePresents, timing.m_nNumMisPresented, timing.m_nNumDroppedFrames, timing.m_nReprojectionFlags );
+	}
+
+	m_frameTimingSums.m_unFrames++;
+	for ( uint32_t i = 0; i < k_eGpuTimestamp_Count - 1; i++ )
+		m_frameTimingSums.m_flGpuMs[ i ] += pflGpuMs[ i ];
+	m_frameTimingSums.m_flCompositorGpuMs += timing.m_flCompositorRenderGpuMs;
+	m_frameTimingSums.m_flFrameIntervalMs += timing.m_flClientFrameIntervalMs;
+	m_frameTimingSums.m_unDroppedFrames += timing.m_nNumDroppedFrames;
+
+	uint32_t unTicks = SDL_GetTicks();
+	if ( unTicks - m_unFrameTimingTitleTicks < 500 )
+		return;
+	m_unFrameTimingTitleTicks = unTicks;
+
+	double flFrames = m_frameTimingSums.m_unFrames;
+	char rchTitle[ 512 ];
+	sprintf_s( rchTitle, sizeof( rchTitle ), "%s | GPU L %.2f R %.2f companion %.2f ms | compositor %.2f ms | interval %.2f ms | dropped %u",
+		m_strWindowTitle.c_str(), m_frameTimingSums.m_flGpuMs[ 0 ] / flFrames, m_frameTimingSums.m_flGpuMs[ 1 ] / flFrames, m_frameTimingSums.m_flGpuMs[ 2 ] / flFrames,
+		m_frameTimingSums.m_flCompositorGpuMs / flFrames, m_frameTimingSums.m_flFrameIntervalMs / flFrames, m_frameTimingSums.m_unDroppedFrames );
+	SDL_SetWindowTitle( m_pCompanionWindow, rchTitle );
+
+	memset( &m_frameTimingSums, 0, sizeof( m_frameTimingSums ) );
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Creates all the shaders used by HelloVR DX12
 //-----------------------------------------------------------------------------
@@ -883,13 +1554,13 @@ bool CMainApplication::CreateAllShaders()
 			featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
 		}
 		
-		CD3DX12_DESCRIPTOR_RANGE1 ranges[2];
+		CD3DX12_DESCRIPTOR_RANGE1 ranges[1];
 		CD3DX12_ROOT_PARAMETER1 rootParameters[2];
 		
-		ranges[0].Init( D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC );
-		ranges[1].Init( D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0 );
-		rootParameters[0].InitAsDescriptorTable( 1, &ranges[0], D3D12_SHADER_VISIBILITY_VERTEX );
-		rootParameters[1].InitAsDescriptorTable( 1, &ranges[1], D3D12_SHADER_VISIBILITY_PIXEL );
+		// Constants are written to the upload ring for every draw, so they are bound directly rather than through the heap
+		ranges[0].Init( D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0 );
+		rootParameters[0].InitAsConstantBufferView( 0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_VERTEX );
+		rootParameters[1].InitAsDescriptorTable( 1, &ranges[0], D3D12_SHADER_VISIBILITY_PIXEL );
 		
 		D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
 			D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
@@ -920,17 +1591,40 @@ bool CMainApplication::CreateAllShaders()
 		ComPtr<ID3DBlob> pixelShader;
 		UINT compileFlags = 0;
 
-		std::string shaderPath =  Path_MakeAbsolute( "../shaders/scene.hlsl", sExecutableDirectory );
-		std::wstring shaderPathW = std::wstring( shaderPath.begin(), shaderPath.end() );
+		// each instance places the cube mesh in its own cell of the scene volume, see SetupScene
+		static const char s_pchSceneShader[] =
+			"cbuffer SceneConstantBuffer : register(b0)\n"
+			"{\n"
+			"	float4x4 g_MVPMatrix;\n"
+			"	float4 g_vVolumeOrigin;\n" // xyz origin, w spacing between cells
+			"	uint4 g_vVolumeSize;\n"
+			"};\n"
+			"SamplerState g_SamplerState : register(s0);\n"
+			"Texture2D g_Texture : register(t0);\n"
+			"struct VS_INPUT { float3 vPosition : POSITION; float2 vUVCoords : TEXCOORD0; uint nInstance : SV_InstanceID; };\n"
+			"struct PS_INPUT { float4 vPosition : SV_POSITION; float2 vUVCoords : TEXCOORD0; };\n"
+			"PS_INPUT VSMain( VS_INPUT i )\n"
+			"{\n"
+			"	uint3 vCell = uint3( i.nInstance % g_vVolumeSize.x, ( i.nInstance / g_vVolumeSize.x ) % g_vVolumeSize.y, i.nInstance / ( g_vVolumeSize.x * g_vVolumeSize.y ) );\n"
+			"	PS_INPUT o;\n"
+			"	o.vPosition = mul( g_MVPMatrix, float4( i.vPosition + g_vVolumeOrigin.xyz + float3( vCell ) * g_vVolumeOrigin.w, 1.0 ) );\n"
+			"	o.vUVCoords = i.vUVCoords;\n"
+			"	return o;\n"
+			"}\n"
+			"float4 PSMain( PS_INPUT i ) : SV_TARGET\n"
+			"{\n"
+			"	return g_Texture.Sample( g_SamplerState, i.vUVCoords );\n"
+			"}\n";
+
 		ComPtr< ID3DBlob > error;
-		if ( FAILED( D3DCompileFromFile( shaderPathW.c_str(), nullptr, nullptr, "VSMain", "vs_5_0", compileFlags, 0, &vertexShader, &error ) ) )
+		if ( FAILED( D3DCompile( s_pchSceneShader, sizeof( s_pchSceneShader ) - 1, "scene", nullptr, nullptr, "VSMain", "vs_5_0", compileFlags, 0, &vertexShader, &error ) ) )
 		{
-			dprintf( "Failed compiling vertex shader '%s':\n%s\n", shaderPath.c_str(), ( char* )error->GetBufferPointer() );
+			dprintf( "Failed compiling scene vertex shader:\n%s\n", ( char* )error->GetBufferPointer() );
 			return false;
 		}
-		if ( FAILED( D3DCompileFromFile( shaderPathW.c_str(), nullptr, nullptr, "PSMain", "ps_5_0", compileFlags, 0, &pixelShader, &error ) ) )
+		if ( FAILED( D3DCompile( s_pchSceneShader, sizeof( s_pchSceneShader ) - 1, "scene", nullptr, nullptr, "PSMain", "ps_5_0", compileFlags, 0, &pixelShader, &error ) ) )
 		{
-			dprintf( "Failed compiling pixel shader '%s':\n%s\n", shaderPath.c_str(), ( char* )error->GetBufferPointer() );
+			dprintf( "Failed compiling scene pixel shader:\n%s\n", ( char* )error->GetBufferPointer() );
 			return false;
 		}
 
@@ -1133,17 +1827,22 @@ bool CMainApplication::SetupTexturemaps()
 	std::string sExecutableDirectory = Path_StripFilename( Path_GetExecutablePath() );
 	std::string strFullPath = Path_MakeAbsolute( "../cube_texture.png", sExecutableDirectory );
 	
-	std::vector< unsigned char > imageRGBA;
+	std::vector< unsigned char > vecPng;
+	lodepng::load_file( vecPng, strFullPath );
+	lodepng::State pngState;
 	unsigned nImageWidth, nImageHeight;
-	unsigned nError = lodepng::decode( imageRGBA, nImageWidth, nImageHeight, strFullPath.c_str() );
-	
-	if ( nError != 0 )
+	if ( vecPng.empty() || lodepng_inspect( &nImageWidth, &nImageHeight, &pngState, &vecPng[0], vecPng.size() ) != 0 )
 		return false;
 
-	// Store level 0
+	// Decode level 0 in place. UpdateSubresources does the copy into the upload heap itself,
+	// so the mips are built from this and there is no mapped memory to decode into.
 	std::vector< D3D12_SUBRESOURCE_DATA > mipLevelData;
 	UINT8 *pBaseData = new UINT8[ nImageWidth * nImageHeight * 4 ];
-	memcpy( pBaseData, &imageRGBA[0], sizeof( UINT8 ) * nImageWidth * nImageHeight * 4 );
+	if ( lodepng::decode_into( pBaseData, nImageWidth * nImageHeight * 4, nImageWidth, nImageHeight, pngState, &vecPng[0], vecPng.size() ) != 0 )
+	{
+		delete [] pBaseData;
+		return false;
+	}
 	
 	D3D12_SUBRESOURCE_DATA textureData = {};
 	textureData.pData = &pBaseData[ 0 ];
@@ -1181,12 +1880,8 @@ bool CMainApplication::SetupTexturemaps()
 	textureDesc.SampleDesc.Quality = 0;
 	textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 
-	m_pDevice->CreateCommittedResource( &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_DEFAULT ),
-		D3D12_HEAP_FLAG_NONE,
-		&textureDesc,
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS( &m_pTexture ) );
+	if ( !m_heapAllocator.BCreatePlacedResource( D3D12_HEAP_TYPE_DEFAULT, textureDesc, D3D12_RESOURCE_STATE_COPY_DEST, &m_pTexture, &m_textureAllocation ) )
+		return false;
 
 	// Create shader resource view
 	CD3DX12_CPU_DESCRIPTOR_HANDLE srvHandle( m_pCBVSRVHeap->GetCPUDescriptorHandleForHeapStart() );
@@ -1197,13 +1892,8 @@ bool CMainApplication::SetupTexturemaps()
 	const UINT64 nUploadBufferSize = GetRequiredIntermediateSize( m_pTexture.Get(), 0, textureDesc.MipLevels );
 
 	// Create the GPU upload buffer.
-	m_pDevice->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer( nUploadBufferSize ),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS( &m_pTextureUploadHeap ) );
+	if ( !m_heapAllocator.BCreateBuffer( D3D12_HEAP_TYPE_UPLOAD, nUploadBufferSize, D3D12_RESOURCE_STATE_GENERIC_READ, &m_pTextureUploadHeap, &m_textureUploadAllocation ) )
+		return false;
 
 	UpdateSubresources( m_pCommandList.Get(), m_pTexture.Get(), m_pTextureUploadHeap.Get(), 0, 0, mipLevelData.size(), &mipLevelData[0] );
 	m_pCommandList->ResourceBarrier( 1, &CD3DX12_RESOURCE_BARRIER::Transition( m_pTexture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE ) );
@@ -1280,39 +1970,27 @@ void CMainApplication::SetupScene()
 	if ( !m_pHMD )
 		return;
 
+	// a single cube mesh drawn once per cell, the vertex shader offsets each instance into place
 	std::vector<float> vertdataarray;
 
 	Matrix4 matScale;
 	matScale.scale( m_fScale, m_fScale, m_fScale );
-	Matrix4 matTransform;
-	matTransform.translate(
-		-( (float)m_iSceneVolumeWidth * m_fScaleSpacing ) / 2.f,
-		-( (float)m_iSceneVolumeHeight * m_fScaleSpacing ) / 2.f,
-		-( (float)m_iSceneVolumeDepth * m_fScaleSpacing ) / 2.f);
-	
-	Matrix4 mat = matScale * matTransform;
-
-	for( int z = 0; z< m_iSceneVolumeDepth; z++ )
-	{
-		for( int y = 0; y< m_iSceneVolumeHeight; y++ )
-		{
-			for( int x = 0; x< m_iSceneVolumeWidth; x++ )
-			{
-				AddCubeToScene( mat, vertdataarray );
-				mat = mat * Matrix4().translate( m_fScaleSpacing, 0, 0 );
-			}
-			mat = mat * Matrix4().translate( -((float)m_iSceneVolumeWidth) * m_fScaleSpacing, m_fScaleSpacing, 0 );
-		}
-		mat = mat * Matrix4().translate( 0, -((float)m_iSceneVolumeHeight) * m_fScaleSpacing, m_fScaleSpacing );
-	}
+	AddCubeToScene( matScale, vertdataarray );
 	m_uiVertcount = vertdataarray.size()/5;
+	m_uiSceneInstanceCount = m_iSceneVolumeWidth * m_iSceneVolumeHeight * m_iSceneVolumeDepth;
+
+	// the volume layout follows the matrix in each eye's constant buffer and never changes
+	m_rflSceneVolumeOrigin[ 0 ] = -( (float)m_iSceneVolumeWidth * m_fScaleSpacing * m_fScale ) / 2.f;
+	m_rflSceneVolumeOrigin[ 1 ] = -( (float)m_iSceneVolumeHeight * m_fScaleSpacing * m_fScale ) / 2.f;
+	m_rflSceneVolumeOrigin[ 2 ] = -( (float)m_iSceneVolumeDepth * m_fScaleSpacing * m_fScale ) / 2.f;
+	m_rflSceneVolumeOrigin[ 3 ] = m_fScaleSpacing * m_fScale;
+	m_runSceneVolumeSize[ 0 ] = (uint32_t)m_iSceneVolumeWidth;
+	m_runSceneVolumeSize[ 1 ] = (uint32_t)m_iSceneVolumeHeight;
+	m_runSceneVolumeSize[ 2 ] = (uint32_t)m_iSceneVolumeDepth;
+	m_runSceneVolumeSize[ 3 ] = 0;
 	
-	m_pDevice->CreateCommittedResource( &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), 
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer( sizeof(float) * vertdataarray.size() ), 
-		D3D12_RESOURCE_STATE_GENERIC_READ, 
-		nullptr, 
-		IID_PPV_ARGS( &m_pSceneVertexBuffer ) );
+	if ( !m_heapAllocator.BCreateBuffer( D3D12_HEAP_TYPE_UPLOAD, sizeof( float ) * vertdataarray.size(), D3D12_RESOURCE_STATE_GENERIC_READ, &m_pSceneVertexBuffer, &m_sceneVertexBufferAllocation ) )
+		return;
 
 	UINT8 *pMappedBuffer;
 	CD3DX12_RANGE readRange( 0, 0 );
@@ -1323,6 +2001,29 @@ void CMainApplication::SetupScene()
 	m_sceneVertexBufferView.BufferLocation = m_pSceneVertexBuffer->GetGPUVirtualAddress();
 	m_sceneVertexBufferView.StrideInBytes = sizeof( VertexDataScene );
 	m_sceneVertexBufferView.SizeInBytes =  sizeof( float ) * vertdataarray.size();
+
+	// Nothing about the cube draw changes between eyes or frames except the constants, which RenderScene
+	// binds as a root CBV before executing the bundle, so the draw is recorded only once.
+	if ( FAILED( m_pDevice->CreateCommandAllocator( D3D12_COMMAND_LIST_TYPE_BUNDLE, IID_PPV_ARGS( &m_pSceneBundleAllocator ) ) ) ||
+		FAILED( m_pDevice->CreateCommandList( 0, D3D12_COMMAND_LIST_TYPE_BUNDLE, m_pSceneBundleAllocator.Get(), m_pScenePipelineState.Get(), IID_PPV_ARGS( &m_pSceneBundle ) ) ) )
+	{
+		dprintf( "%s - Unable to create the scene bundle.\n", __FUNCTION__ );
+		m_pSceneBundle.Reset();
+		return;
+	}
+
+	ID3D12DescriptorHeap *ppHeaps[] = { m_pCBVSRVHeap.Get() };
+	m_pSceneBundle->SetDescriptorHeaps( _countof( ppHeaps ), ppHeaps );
+	m_pSceneBundle->SetGraphicsRootSignature( m_pRootSignature.Get() );
+
+	CD3DX12_GPU_DESCRIPTOR_HANDLE srvHandle( m_pCBVSRVHeap->GetGPUDescriptorHandleForHeapStart() );
+	srvHandle.Offset( SRV_TEXTURE_MAP, m_nCBVSRVDescriptorSize );
+	m_pSceneBundle->SetGraphicsRootDescriptorTable( 1, srvHandle );
+
+	m_pSceneBundle->IASetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+	m_pSceneBundle->IASetVertexBuffers( 0, 1, &m_sceneVertexBufferView );
+	m_pSceneBundle->DrawInstanced( m_uiVertcount, m_uiSceneInstanceCount, 0, 0 );
+	m_pSceneBundle->Close();
 }
 
 //-----------------------------------------------------------------------------
@@ -1402,13 +2103,15 @@ void CMainApplication::AddCubeToScene( Matrix4 mat, std::vector<float> &vertdata
 //-----------------------------------------------------------------------------
 void CMainApplication::UpdateControllerAxes()
 {
+	// Last frame's vertices are in ring space that may be reused
+	m_uiControllerVertcount = 0;
+
 	// Don't attempt to update controllers if input is not available
 	if( !m_pHMD->IsInputAvailable() )
 		return;
 
 	std::vector<float> vertdataarray;
 
-	m_uiControllerVertcount = 0;
 	m_iTrackedControllerCount = 0;
 
 	for ( vr::TrackedDeviceIndex_t unTrackedDevice = vr::k_unTrackedDeviceIndex_Hmd + 1; unTrackedDevice < vr::k_unMaxTrackedDeviceCount; ++unTrackedDevice )
@@ -1466,34 +2169,21 @@ void CMainApplication::UpdateControllerAxes()
 		m_uiControllerVertcount += 2;
 	}
 
-	// Setup the VB the first time through.
-	if ( m_pControllerAxisVertexBuffer == nullptr && vertdataarray.size() > 0 )
-	{
-		// Make big enough to hold up to the max number
-		size_t nSize = sizeof(float) * vertdataarray.size();
-		nSize *= vr::k_unMaxTrackedDeviceCount;
-		
-		m_pDevice->CreateCommittedResource( 
-			&CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ), 
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer( nSize ), 
-			D3D12_RESOURCE_STATE_GENERIC_READ, 
-			nullptr, 
-			IID_PPV_ARGS( &m_pControllerAxisVertexBuffer ) );
-
-		m_controllerAxisVertexBufferView.BufferLocation = m_pControllerAxisVertexBuffer->GetGPUVirtualAddress();
-		m_controllerAxisVertexBufferView.StrideInBytes = sizeof( float ) * 6;
-		m_controllerAxisVertexBufferView.SizeInBytes =  sizeof( float ) * vertdataarray.size();
-	}
-
-	// Update the VB data
-	if ( m_pControllerAxisVertexBuffer && vertdataarray.size() > 0 )
+	// Copy this frame's vertices into the upload ring
+	if ( vertdataarray.size() > 0 )
 	{
 		UINT8 *pMappedBuffer;
-		CD3DX12_RANGE readRange( 0, 0 );
-		m_pControllerAxisVertexBuffer->Map( 0, &readRange, reinterpret_cast< void** >( &pMappedBuffer ) );
+		D3D12_GPU_VIRTUAL_ADDRESS nBufferLocation;
+		if ( !m_uploadRing.BAllocate( sizeof( float ) * vertdataarray.size(), sizeof( float ), &pMappedBuffer, &nBufferLocation ) )
+		{
+			m_uiControllerVertcount = 0;
+			return;
+		}
 		memcpy( pMappedBuffer, &vertdataarray[0], sizeof( float ) * vertdataarray.size() );
-		m_pControllerAxisVertexBuffer->Unmap( 0, nullptr );
+
+		m_controllerAxisVertexBufferView.BufferLocation = nBufferLocation;
+		m_controllerAxisVertexBufferView.StrideInBytes = sizeof( float ) * 6;
+		m_controllerAxisVertexBufferView.SizeInBytes = sizeof( float ) * vertdataarray.size();
 	}
 }
 
@@ -1577,9 +2267,105 @@ bool CMainApplication::SetupStereoRenderTargets()
 
 	CreateFrameBuffer( m_nRenderWidth, m_nRenderHeight, m_leftEyeDesc, RTV_LEFT_EYE );
 	CreateFrameBuffer( m_nRenderWidth, m_nRenderHeight, m_rightEyeDesc, RTV_RIGHT_EYE );
+
+	if ( m_foveation.m_bEnabled )
+		SetupFoveation();
+
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Builds and uploads each eye's shading rate image for -foveate from
+//          its profile, centred where the eye's view axis crosses its target
+//          unless the command line placed it. Returns false, rendering at full
+//          rate, without variable rate shading tier 2. Devices without the
+//          additional shading rates get 2x2 where the profile asks for 4x4.
+//-----------------------------------------------------------------------------
+bool CMainApplication::SetupFoveation()
+{
+#ifdef __ID3D12GraphicsCommandList5_INTERFACE_DEFINED__
+	D3D12_FEATURE_DATA_D3D12_OPTIONS6 options6 = {};
+	if ( FAILED( m_pDevice->CheckFeatureSupport( D3D12_FEATURE_D3D12_OPTIONS6, &options6, sizeof( options6 ) ) ) ||
+		options6.VariableShadingRateTier < D3D12_VARIABLE_SHADING_RATE_TIER_2 || FAILED( m_pCommandList.As( &m_pCommandList5 ) ) )
+	{
+		dprintf( "Foveation: variable rate shading tier 2 is not supported, rendering at full rate\n" );
+		return false;
+	}
+
+	const UINT8 rnRates[ k_eFoveationRate_Count ] =
+	{
+		D3D12_SHADING_RATE_1X1,
+		D3D12_SHADING_RATE_2X2,
+		( UINT8 )( options6.AdditionalShadingRatesSupported ? D3D12_SHADING_RATE_4X4 : D3D12_SHADING_RATE_2X2 ),
+	};
+
+	UINT nTileSize = options6.ShadingRateImageTileSize;
+	UINT nTilesX = ( m_nRenderWidth + nTileSize - 1 ) / nTileSize;
+	UINT nTilesY = ( m_nRenderHeight + nTileSize - 1 ) / nTileSize;
+
+	float rflInvocationFraction[ 2 ];
+	for ( int nEye = 0; nEye < 2; nEye++ )
+	{
+		float flLeft, flRight, flTop, flBottom;
+		m_pHMD->GetProjectionRaw( ( vr::Hmd_Eye )nEye, &flLeft, &flRight, &flTop, &flBottom );
+		Foveation_SetDefaultCenter( &m_foveation, nEye, flLeft, flRight, flTop, flBottom );
+
+		std::vector< uint8_t > vecRates;
+		Foveation_BuildRateImage( m_foveation.m_rProfile[ nEye ], m_nRenderWidth, m_nRenderHeight, nTileSize, nTileSize, false, &vecRates );
+		rflInvocationFraction[ nEye ] = Foveation_GetInvocationFraction( vecRates );
+		for ( size_t i = 0; i < vecRates.size(); i++ )
+		{
+			vecRates[ i ] = rnRates[ vecRates[ i ] ];
+		}
+
+		D3D12_RESOURCE_DESC imageDesc = CD3DX12_RESOURCE_DESC::Tex2D( DXGI_FORMAT_R8_UINT, nTilesX, nTilesY, 1, 1 );
+		if ( !m_heapAllocator.BCreatePlacedResource( D3D12_HEAP_TYPE_DEFAULT, imageDesc, D3D12_RESOURCE_STATE_COPY_DEST, &m_pShadingRateImage[ nEye ], &m_shadingRateImageAllocations[ nEye ] ) ||
+			!m_heapAllocator.BCreateBuffer( D3D12_HEAP_TYPE_UPLOAD, GetRequiredIntermediateSize( m_pShadingRateImage[ nEye ].Get(), 0, 1 ), D3D12_RESOURCE_STATE_GENERIC_READ,
+				&m_pShadingRateUploadHeap[ nEye ], &m_shadingRateUploadAllocations[ nEye ] ) )
+		{
+			m_pCommandList5.Reset();
+			return false;
+		}
+
+		D3D12_SUBRESOURCE_DATA imageData = {};
+		imageData.pData = &vecRates[ 0 ];
+		imageData.RowPitch = nTilesX;
+		imageData.SlicePitch = nTilesX * nTilesY;
+		UpdateSubresources( m_pCommandList.Get(), m_pShadingRateImage[ nEye ].Get(), m_pShadingRateUploadHeap[ nEye ].Get(), 0, 0, 1, &imageData );
+		m_pCommandList->ResourceBarrier( 1, &CD3DX12_RESOURCE_BARRIER::Transition( m_pShadingRateImage[ nEye ].Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_SHADING_RATE_SOURCE ) );
+	}
+
+	dprintf( "Foveation: %ux%u pixel tiles, pixel shading left %.0f%% right %.0f%% of full rate%s\n", nTileSize, nTileSize,
+		100.0f * rflInvocationFraction[ vr::Eye_Left ], 100.0f * rflInvocationFraction[ vr::Eye_Right ],
+		options6.AdditionalShadingRatesSupported ? "" : " ( 4x4 tiles shade at 2x2 on this device )" );
+	return true;
+#else
+	dprintf( "Foveation: built with a Windows SDK without variable rate shading, rendering at full rate\n" );
+	return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Shades the following draws at the rates of the given image, or at
+//          full rate for null
+//-----------------------------------------------------------------------------
+void CMainApplication::SetShadingRateImage( ID3D12Resource *pShadingRateImage )
+{
+#ifdef __ID3D12GraphicsCommandList5_INTERFACE_DEFINED__
+	if ( !m_pCommandList5 )
+		return;
+
+	// the image overrides the 1x1 base and per primitive rates
+	const D3D12_SHADING_RATE_COMBINER rCombiners[ D3D12_RS_SET_SHADING_RATE_COMBINER_COUNT ] =
+	{
+		D3D12_SHADING_RATE_COMBINER_PASSTHROUGH,
+		pShadingRateImage ? D3D12_SHADING_RATE_COMBINER_OVERRIDE : D3D12_SHADING_RATE_COMBINER_PASSTHROUGH,
+	};
+	m_pCommandList5->RSSetShadingRate( D3D12_SHADING_RATE_1X1, rCombiners );
+	m_pCommandList5->RSSetShadingRateImage( pShadingRateImage );
+#endif
+}
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
@@ -1602,12 +2388,8 @@ void CMainApplication::SetupCompanionWindow()
 	vVerts.push_back( VertexDataWindow( Vector2(0, 1), Vector2(0, 0)) );
 	vVerts.push_back( VertexDataWindow( Vector2(1, 1), Vector2(1, 0)) );
 	
-	m_pDevice->CreateCommittedResource( &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ), 
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer( sizeof( VertexDataWindow ) * vVerts.size() ), 
-		D3D12_RESOURCE_STATE_GENERIC_READ, 
-		nullptr, 
-		IID_PPV_ARGS( &m_pCompanionWindowVertexBuffer ) );
+	if ( !m_heapAllocator.BCreateBuffer( D3D12_HEAP_TYPE_UPLOAD, sizeof( VertexDataWindow ) * vVerts.size(), D3D12_RESOURCE_STATE_GENERIC_READ, &m_pCompanionWindowVertexBuffer, &m_companionWindowVertexBufferAllocation ) )
+		return;
 
 	UINT8 *pMappedBuffer;
 	CD3DX12_RANGE readRange( 0, 0 );
@@ -1623,12 +2405,8 @@ void CMainApplication::SetupCompanionWindow()
 	UINT16 vIndices[] = { 0, 1, 3,   0, 3, 2,   4, 5, 7,   4, 7, 6};
 	m_uiCompanionWindowIndexSize = _countof(vIndices);
 
-	m_pDevice->CreateCommittedResource( &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ), 
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer( sizeof( vIndices ) ),
-		D3D12_RESOURCE_STATE_GENERIC_READ, 
-		nullptr, 
-		IID_PPV_ARGS( &m_pCompanionWindowIndexBuffer ) );
+	if ( !m_heapAllocator.BCreateBuffer( D3D12_HEAP_TYPE_UPLOAD, sizeof( vIndices ), D3D12_RESOURCE_STATE_GENERIC_READ, &m_pCompanionWindowIndexBuffer, &m_companionWindowIndexBufferAllocation ) )
+		return;
 
 	m_pCompanionWindowIndexBuffer->Map( 0, &readRange, reinterpret_cast< void** >( &pMappedBuffer ) );
 	memcpy( pMappedBuffer, &vIndices[0], sizeof( vIndices ) );
@@ -1661,11 +2439,15 @@ void CMainApplication::RenderStereoTargets()
 	m_pCommandList->ClearRenderTargetView( m_leftEyeDesc.m_renderTargetViewHandle, clearColor, 0, nullptr );
 	m_pCommandList->ClearDepthStencilView( m_leftEyeDesc.m_depthStencilViewHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0, 0, 0, nullptr );
 
+	SetShadingRateImage( m_pShadingRateImage[ vr::Eye_Left ].Get() );
 	RenderScene( vr::Eye_Left );
+	SetShadingRateImage( nullptr );
 	
 	// Transition to SHADER_RESOURCE to submit to SteamVR
 	m_pCommandList->ResourceBarrier( 1, &CD3DX12_RESOURCE_BARRIER::Transition( m_leftEyeDesc.m_pTexture.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE ) );
 
+	WriteGpuTimestamp( k_eGpuTimestamp_LeftEye );
+
 
 	//-----------//
 	// Right Eye //
@@ -1677,10 +2459,14 @@ void CMainApplication::RenderStereoTargets()
 	m_pCommandList->ClearRenderTargetView( m_rightEyeDesc.m_renderTargetViewHandle, clearColor, 0, nullptr );
 	m_pCommandList->ClearDepthStencilView( m_rightEyeDesc.m_depthStencilViewHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0, 0, 0, nullptr );
 
+	SetShadingRateImage( m_pShadingRateImage[ vr::Eye_Right ].Get() );
 	RenderScene( vr::Eye_Right );
+	SetShadingRateImage( nullptr );
 	
 	// Transition to SHADER_RESOURCE to submit to SteamVR
 	m_pCommandList->ResourceBarrier( 1, &CD3DX12_RESOURCE_BARRIER::Transition( m_rightEyeDesc.m_pTexture.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE ) );
+
+	WriteGpuTimestamp( k_eGpuTimestamp_RightEye );
 }
 
 //-----------------------------------------------------------------------------
@@ -1688,32 +2474,22 @@ void CMainApplication::RenderStereoTargets()
 //-----------------------------------------------------------------------------
 void CMainApplication::RenderScene( vr::Hmd_Eye nEye )
 {
-	if( m_bShowCubes )
+	UINT8 *pConstantBufferData;
+	D3D12_GPU_VIRTUAL_ADDRESS nConstantBufferLocation;
+	if( m_bShowCubes && m_pSceneBundle && m_uploadRing.BAllocate( sizeof( Matrix4 ) + sizeof( m_rflSceneVolumeOrigin ) + sizeof( m_runSceneVolumeSize ),
+		D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, &pConstantBufferData, &nConstantBufferLocation ) )
 	{
-		m_pCommandList->SetPipelineState( m_pScenePipelineState.Get() );
-
-		// Select the CBV (left or right eye)
-		CD3DX12_GPU_DESCRIPTOR_HANDLE cbvHandle( m_pCBVSRVHeap->GetGPUDescriptorHandleForHeapStart() );
-		cbvHandle.Offset( nEye, m_nCBVSRVDescriptorSize );
-		m_pCommandList->SetGraphicsRootDescriptorTable( 0, cbvHandle );
-		
-		// SRV is just after the left eye 
-		CD3DX12_GPU_DESCRIPTOR_HANDLE srvHandle( m_pCBVSRVHeap->GetGPUDescriptorHandleForHeapStart() );
-		srvHandle.Offset( SRV_TEXTURE_MAP, m_nCBVSRVDescriptorSize );
-		m_pCommandList->SetGraphicsRootDescriptorTable( 1, srvHandle );
-
-		// Update the persistently mapped pointer to the CB data with the latest matrix
-		memcpy( m_pSceneConstantBufferData[ nEye ], GetCurrentViewProjectionMatrix( nEye ).get(), sizeof( Matrix4 ) );
-
-		// Draw
-		m_pCommandList->IASetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
-		m_pCommandList->IASetVertexBuffers( 0, 1, &m_sceneVertexBufferView );
-		m_pCommandList->DrawInstanced( m_uiVertcount, 1, 0, 0 );
+		// Write this eye's constants to the upload ring and point the root CBV at them
+		memcpy( pConstantBufferData, GetCurrentViewProjectionMatrix( nEye ).get(), sizeof( Matrix4 ) );
+		memcpy( pConstantBufferData + sizeof( Matrix4 ), m_rflSceneVolumeOrigin, sizeof( m_rflSceneVolumeOrigin ) );
+		memcpy( pConstantBufferData + sizeof( Matrix4 ) + sizeof( m_rflSceneVolumeOrigin ), m_runSceneVolumeSize, sizeof( m_runSceneVolumeSize ) );
+		m_pCommandList->SetGraphicsRootConstantBufferView( 0, nConstantBufferLocation );
+		m_pCommandList->ExecuteBundle( m_pSceneBundle.Get() );
 	}
 
 	bool bIsInputAvailable = m_pHMD->IsInputAvailable();
 
-	if( bIsInputAvailable && m_pControllerAxisVertexBuffer )
+	if( bIsInputAvailable && m_uiControllerVertcount > 0 )
 	{
 		// draw the controller axis lines
 		m_pCommandList->SetPipelineState( m_pAxesPipelineState.Get() );
@@ -1724,7 +2500,7 @@ void CMainApplication::RenderScene( vr::Hmd_Eye nEye )
 	}
 
 	// ----- Render Model rendering -----
-	m_pCommandList->SetPipelineState( m_pRenderModelPipelineState.Get() );
+	// Each model's bundle sets the render model pipeline state itself
 	for( uint32_t unTrackedDevice = 0; unTrackedDevice < vr::k_unMaxTrackedDeviceCount; unTrackedDevice++ )
 	{
 		if( !m_rTrackedDeviceToRenderModel[ unTrackedDevice ] || !m_rbShowTrackedDevice[ unTrackedDevice ] )
@@ -1740,7 +2516,7 @@ void CMainApplication::RenderScene( vr::Hmd_Eye nEye )
 		const Matrix4 & matDeviceToTracking = m_rmat4DevicePose[ unTrackedDevice ];
 		Matrix4 matMVP = GetCurrentViewProjectionMatrix( nEye ) * matDeviceToTracking;
 		
-		m_rTrackedDeviceToRenderModel[ unTrackedDevice ]->Draw( nEye, m_pCommandList.Get(), m_nCBVSRVDescriptorSize, matMVP );
+		m_rTrackedDeviceToRenderModel[ unTrackedDevice ]->Draw( nEye, m_pCommandList.Get(), &m_uploadRing, matMVP );
 	}
 }
 
@@ -1752,11 +2528,12 @@ void CMainApplication::RenderCompanionWindow()
 	m_pCommandList->SetPipelineState( m_pCompanionPipelineState.Get() );
 
 	// Transition swapchain image to RENDER_TARGET
-	m_pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition( m_pSwapChainRenderTarget[ m_nFrameIndex ].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET ) );
+	UINT nBackBuffer = m_pSwapChain->GetCurrentBackBufferIndex();
+	m_pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition( m_pSwapChainRenderTarget[ nBackBuffer ].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET ) );
 
 	// Bind current swapchain image
 	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle( m_pRTVHeap->GetCPUDescriptorHandleForHeapStart() );
-	rtvHandle.Offset( RTV_SWAPCHAIN0 + m_nFrameIndex, m_nRTVDescriptorSize );
+	rtvHandle.Offset( RTV_SWAPCHAIN0 + nBackBuffer, m_nRTVDescriptorSize );
 	m_pCommandList->OMSetRenderTargets( 1, &rtvHandle, 0, nullptr );
 
 	D3D12_VIEWPORT viewport = { 0.0f, 0.0f, ( FLOAT ) m_nCompanionWindowWidth, ( FLOAT ) m_nCompanionWindowHeight, 0.0f, 1.0f };
@@ -1783,7 +2560,7 @@ void CMainApplication::RenderCompanionWindow()
 	m_pCommandList->DrawIndexedInstanced( m_uiCompanionWindowIndexSize / 2, 1, ( m_uiCompanionWindowIndexSize / 2 ), 0, 0 );
 
 	// Transition swapchain image to PRESENT
-	m_pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition( m_pSwapChainRenderTarget[ m_nFrameIndex ].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT ) );
+	m_pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition( m_pSwapChainRenderTarget[ nBackBuffer ].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT ) );
 }
 
 //-----------------------------------------------------------------------------
@@ -1843,6 +2620,27 @@ Matrix4 CMainApplication::GetCurrentViewProjectionMatrix( vr::Hmd_Eye nEye )
 	return matMVP;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Caches a character representing the class of a tracked device.
+//          Called at startup and when a device is activated so the per frame
+//          pose update never has to query the runtime.
+//-----------------------------------------------------------------------------
+void CMainApplication::UpdateTrackedDeviceClass( vr::TrackedDeviceIndex_t unTrackedDeviceIndex )
+{
+	if ( !m_pHMD || unTrackedDeviceIndex >= vr::k_unMaxTrackedDeviceCount )
+		return;
+
+	switch ( m_pHMD->GetTrackedDeviceClass( unTrackedDeviceIndex ) )
+	{
+	case vr::TrackedDeviceClass_Controller:        m_rDevClassChar[unTrackedDeviceIndex] = 'C'; break;
+	case vr::TrackedDeviceClass_HMD:               m_rDevClassChar[unTrackedDeviceIndex] = 'H'; break;
+	case vr::TrackedDeviceClass_Invalid:           m_rDevClassChar[unTrackedDeviceIndex] = 'I'; break;
+	case vr::TrackedDeviceClass_GenericTracker:    m_rDevClassChar[unTrackedDeviceIndex] = 'G'; break;
+	case vr::TrackedDeviceClass_TrackingReference: m_rDevClassChar[unTrackedDeviceIndex] = 'T'; break;
+	default:                                       m_rDevClassChar[unTrackedDeviceIndex] = '?'; break;
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
@@ -1853,29 +2651,16 @@ void CMainApplication::UpdateHMDMatrixPose()
 
 	vr::VRCompositor()->WaitGetPoses(m_rTrackedDevicePose, vr::k_unMaxTrackedDeviceCount, NULL, 0 );
 
+	// converts every pose in one pass, the matrices of invalid poses are never read
+	ConvertSteamVRMatrixToMatrix4( m_rTrackedDevicePose, m_rmat4DevicePose, vr::k_unMaxTrackedDeviceCount );
+
 	m_iValidPoseCount = 0;
-	m_strPoseClasses = "";
 	for ( int nDevice = 0; nDevice < vr::k_unMaxTrackedDeviceCount; ++nDevice )
 	{
 		if ( m_rTrackedDevicePose[nDevice].bPoseIsValid )
-		{
-			m_iValidPoseCount++;
-			m_rmat4DevicePose[nDevice] = ConvertSteamVRMatrixToMatrix4( m_rTrackedDevicePose[nDevice].mDeviceToAbsoluteTracking );
-			if (m_rDevClassChar[nDevice]==0)
-			{
-				switch (m_pHMD->GetTrackedDeviceClass(nDevice))
-				{
-				case vr::TrackedDeviceClass_Controller:        m_rDevClassChar[nDevice] = 'C'; break;
-				case vr::TrackedDeviceClass_HMD:               m_rDevClassChar[nDevice] = 'H'; break;
-				case vr::TrackedDeviceClass_Invalid:           m_rDevClassChar[nDevice] = 'I'; break;
-				case vr::TrackedDeviceClass_GenericTracker:    m_rDevClassChar[nDevice] = 'G'; break;
-				case vr::TrackedDeviceClass_TrackingReference: m_rDevClassChar[nDevice] = 'T'; break;
-				default:                                       m_rDevClassChar[nDevice] = '?'; break;
-				}
-			}
-			m_strPoseClasses += m_rDevClassChar[nDevice];
-		}
+			m_rchPoseClasses[m_iValidPoseCount++] = m_rDevClassChar[nDevice];
 	}
+	m_rchPoseClasses[m_iValidPoseCount] = '\0';
 
 	if ( m_rTrackedDevicePose[vr::k_unTrackedDeviceIndex_Hmd].bPoseIsValid )
 	{
@@ -1885,73 +2670,38 @@ void CMainApplication::UpdateHMDMatrixPose()
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Finds a render model we've already loaded or loads a new one
+// Purpose: Creates the D3D12 resources for a render model the runtime has loaded
 //-----------------------------------------------------------------------------
-DX12RenderModel *CMainApplication::FindOrLoadRenderModel( vr::TrackedDeviceIndex_t unTrackedDeviceIndex, const char *pchRenderModelName )
+DX12RenderModel *CMainApplication::CreateRenderModel( vr::TrackedDeviceIndex_t unTrackedDeviceIndex, const char *pchRenderModelName, const vr::RenderModel_t &vrModel, const vr::RenderModel_TextureMap_t &vrDiffuseTexture )
 {
-	DX12RenderModel *pRenderModel = NULL;
 	// To simplify the D3D12 rendering code, create an instance of the model for each model name.  This is less efficient
 	// memory wise, but simplifies the rendering code so we can store the transform in a constant buffer associated with
 	// the model itself.  You would not want to do this in a production application.
-	//for( std::vector< DX12RenderModel * >::iterator i = m_vecRenderModels.begin(); i != m_vecRenderModels.end(); i++ )
-	//{
-		//if( !stricmp( (*i)->GetName().c_str(), pchRenderModelName ) )
-		//{
-		//	pRenderModel = *i;
-		//	break;
-		//}
-	//}
-
-	// load the model if we didn't find one
-	if( !pRenderModel )
-	{
-		vr::RenderModel_t *pModel;
-		vr::EVRRenderModelError error;
-		while ( 1 )
-		{
-			error = vr::VRRenderModels()->LoadRenderModel_Async( pchRenderModelName, &pModel );
-			if ( error != vr::VRRenderModelError_Loading )
-				break;
-
-			ThreadSleep( 1 );
-		}
-
-		if ( error != vr::VRRenderModelError_None )
-		{
-			dprintf( "Unable to load render model %s - %s\n", pchRenderModelName, vr::VRRenderModels()->GetRenderModelErrorNameFromEnum( error ) );
-			return NULL; // move on to the next tracked device
-		}
-
-		vr::RenderModel_TextureMap_t *pTexture;
-		while ( 1 )
-		{
-			error = vr::VRRenderModels()->LoadTexture_Async( pModel->diffuseTextureId, &pTexture );
-			if ( error != vr::VRRenderModelError_Loading )
-				break;
-
-			ThreadSleep( 1 );
-		}
+	// The texture upload is recorded for the copy queue so it runs alongside frame rendering, the allocator
+	// can only be reset once every upload recorded from it has finished.
+	if ( m_pCopyFence->GetCompletedValue() >= m_nCopyFenceValue )
+	{
+		m_pCopyCommandAllocator->Reset();
+	}
+	m_pCopyCommandList->Reset( m_pCopyCommandAllocator.Get(), nullptr );
 
-		if ( error != vr::VRRenderModelError_None )
-		{
-			dprintf( "Unable to load render texture id:%d for render model %s\n", pModel->diffuseTextureId, pchRenderModelName );
-			vr::VRRenderModels()->FreeRenderModel( pModel );
-			return NULL; // move on to the next tracked device
-		}
+	DX12RenderModel *pRenderModel = new DX12RenderModel( pchRenderModelName );
+	bool bInit = pRenderModel->BInit( m_pDevice.Get(), &m_heapAllocator, m_pCopyCommandList.Get(), m_pCBVSRVHeap.Get(),
+		m_pRootSignature.Get(), m_pRenderModelPipelineState.Get(), unTrackedDeviceIndex, vrModel, vrDiffuseTexture );
+	m_pCopyCommandList->Close();
 
-		pRenderModel = new DX12RenderModel( pchRenderModelName );
-		if ( !pRenderModel->BInit( m_pDevice.Get(), m_pCommandList.Get(),  m_pCBVSRVHeap.Get(), unTrackedDeviceIndex, *pModel, *pTexture ) )
-		{
-			dprintf( "Unable to create D3D12 model from render model %s\n", pchRenderModelName );
-			delete pRenderModel;
-			pRenderModel = NULL;
-		}
-		else
-		{
-			m_vecRenderModels.push_back( pRenderModel );
-		}
-		vr::VRRenderModels()->FreeRenderModel( pModel );
-		vr::VRRenderModels()->FreeTexture( pTexture );
+	if ( !bInit )
+	{
+		dprintf( "Unable to create D3D12 model from render model %s\n", pchRenderModelName );
+		delete pRenderModel;
+		pRenderModel = NULL;
+	}
+	else
+	{
+		ID3D12CommandList* ppCommandLists[] = { m_pCopyCommandList.Get() };
+		m_pCopyCommandQueue->ExecuteCommandLists( _countof( ppCommandLists ), ppCommandLists );
+		m_pCopyCommandQueue->Signal( m_pCopyFence.Get(), ++m_nCopyFenceValue );
+		m_vecRenderModels.push_back( pRenderModel );
 	}
 
 	return pRenderModel;
@@ -1965,18 +2715,89 @@ void CMainApplication::SetupRenderModelForTrackedDevice( vr::TrackedDeviceIndex_
 	if( unTrackedDeviceIndex >= vr::k_unMaxTrackedDeviceCount )
 		return;
 
-	// try to find a model we've already set up
-	std::string sRenderModelName = GetTrackedDeviceString( m_pHMD, unTrackedDeviceIndex, vr::Prop_RenderModelName_String );
-	DX12RenderModel *pRenderModel = FindOrLoadRenderModel( unTrackedDeviceIndex, sRenderModelName.c_str() );
-	if( !pRenderModel )
+	// the runtime loads the model in the background, UpdateRenderModelLoads creates it once it is ready
+	PendingRenderModel_t &pending = m_rPendingRenderModel[ unTrackedDeviceIndex ];
+	if( pending.m_pModel )
+	{
+		vr::VRRenderModels()->FreeRenderModel( pending.m_pModel );
+		pending.m_pModel = NULL;
+	}
+	pending.m_sName = GetTrackedDeviceString( m_pHMD, unTrackedDeviceIndex, vr::Prop_RenderModelName_String );
+	if( pending.m_sName.empty() )
 	{
 		std::string sTrackingSystemName = GetTrackedDeviceString( m_pHMD, unTrackedDeviceIndex, vr::Prop_TrackingSystemName_String );
-		dprintf( "Unable to load render model for tracked device %d (%s.%s)", unTrackedDeviceIndex, sTrackingSystemName.c_str(), sRenderModelName.c_str() );
+		dprintf( "Unable to load render model for tracked device %d (%s.%s)", unTrackedDeviceIndex, sTrackingSystemName.c_str(), pending.m_sName.c_str() );
 	}
-	else
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Polls the runtime once per frame for the render models that are
+//          still loading, so a device appearing never stalls the frame. Models
+//          are shown once their texture upload on the copy queue has finished.
+//-----------------------------------------------------------------------------
+void CMainApplication::UpdateRenderModelLoads()
+{
+	UINT64 nCompletedCopyFenceValue = m_pCopyFence->GetCompletedValue();
+	for( uint32_t unTrackedDevice = 0; unTrackedDevice < vr::k_unMaxTrackedDeviceCount; unTrackedDevice++ )
 	{
-		m_rTrackedDeviceToRenderModel[ unTrackedDeviceIndex ] = pRenderModel;
-		m_rbShowTrackedDevice[ unTrackedDeviceIndex ] = true;
+		PendingRenderModel_t &pending = m_rPendingRenderModel[ unTrackedDevice ];
+		if( pending.m_pUploadingModel && nCompletedCopyFenceValue >= pending.m_nUploadFenceValue )
+		{
+			pending.m_pUploadingModel->ReleaseUploadResources();
+			m_rTrackedDeviceToRenderModel[ unTrackedDevice ] = pending.m_pUploadingModel;
+			m_rbShowTrackedDevice[ unTrackedDevice ] = true;
+			pending.m_pUploadingModel = NULL;
+		}
+
+		if( pending.m_sName.empty() )
+			continue;
+
+		vr::EVRRenderModelError error;
+		if( !pending.m_pModel )
+		{
+			vr::RenderModel_t *pModel;
+			error = vr::VRRenderModels()->LoadRenderModel_Async( pending.m_sName.c_str(), &pModel );
+			if ( error == vr::VRRenderModelError_Loading )
+				continue;
+
+			if ( error != vr::VRRenderModelError_None )
+				dprintf( "Unable to load render model %s - %s\n", pending.m_sName.c_str(), vr::VRRenderModels()->GetRenderModelErrorNameFromEnum( error ) );
+			else
+				pending.m_pModel = pModel;
+		}
+
+		DX12RenderModel *pRenderModel = NULL;
+		if( pending.m_pModel )
+		{
+			vr::RenderModel_TextureMap_t *pTexture;
+			error = vr::VRRenderModels()->LoadTexture_Async( pending.m_pModel->diffuseTextureId, &pTexture );
+			if ( error == vr::VRRenderModelError_Loading )
+				continue;
+
+			if ( error != vr::VRRenderModelError_None )
+			{
+				dprintf( "Unable to load render texture id:%d for render model %s\n", pending.m_pModel->diffuseTextureId, pending.m_sName.c_str() );
+			}
+			else
+			{
+				pRenderModel = CreateRenderModel( unTrackedDevice, pending.m_sName.c_str(), *pending.m_pModel, *pTexture );
+				vr::VRRenderModels()->FreeTexture( pTexture );
+			}
+			vr::VRRenderModels()->FreeRenderModel( pending.m_pModel );
+			pending.m_pModel = NULL;
+		}
+
+		if( !pRenderModel )
+		{
+			std::string sTrackingSystemName = GetTrackedDeviceString( m_pHMD, unTrackedDevice, vr::Prop_TrackingSystemName_String );
+			dprintf( "Unable to load render model for tracked device %d (%s.%s)", unTrackedDevice, sTrackingSystemName.c_str(), pending.m_sName.c_str() );
+		}
+		else
+		{
+			pending.m_pUploadingModel = pRenderModel;
+			pending.m_nUploadFenceValue = m_nCopyFenceValue;
+		}
+		pending.m_sName.clear();
 	}
 }
 
@@ -2014,13 +2835,26 @@ Matrix4 CMainApplication::ConvertSteamVRMatrixToMatrix4( const vr::HmdMatrix34_t
 	return matrixObj;
 }
 
+
+//-----------------------------------------------------------------------------
+// Purpose: Converts the device to tracking matrices of an array of poses
+//-----------------------------------------------------------------------------
+void CMainApplication::ConvertSteamVRMatrixToMatrix4( const vr::TrackedDevicePose_t *pPoses, Matrix4 *pMatrices, uint32_t unCount )
+{
+	convertRowMajor3x4( pMatrices, &pPoses[0].mDeviceToAbsoluteTracking.m[0][0], sizeof( vr::TrackedDevicePose_t ), (int)unCount );
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Create/destroy D3D12 Render Models
 //-----------------------------------------------------------------------------
 DX12RenderModel::DX12RenderModel( const std::string & sRenderModelName )
-	: m_sModelName( sRenderModelName )
+	: m_pHeapAllocator( NULL )
+	, m_sModelName( sRenderModelName )
 {
-	memset( m_pConstantBufferData, 0, sizeof( m_pConstantBufferData ) );
+	memset( &m_vertexBufferAllocation, 0, sizeof( m_vertexBufferAllocation ) );
+	memset( &m_indexBufferAllocation, 0, sizeof( m_indexBufferAllocation ) );
+	memset( &m_textureAllocation, 0, sizeof( m_textureAllocation ) );
+	memset( &m_textureUploadAllocation, 0, sizeof( m_textureUploadAllocation ) );
 }
 
 DX12RenderModel::~DX12RenderModel()
@@ -2029,21 +2863,19 @@ DX12RenderModel::~DX12RenderModel()
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Allocates and populates the D3D12 resources for a render model
+// Purpose: Allocates and populates the D3D12 resources for a render model.
+//          The texture upload is recorded into pCommandList, a copy list.
 //-----------------------------------------------------------------------------
-bool DX12RenderModel::BInit( ID3D12Device *pDevice, ID3D12GraphicsCommandList *pCommandList, ID3D12DescriptorHeap *pCBVSRVHeap, vr::TrackedDeviceIndex_t unTrackedDeviceIndex, const vr::RenderModel_t & vrModel, const vr::RenderModel_TextureMap_t & vrDiffuseTexture )
+bool DX12RenderModel::BInit( ID3D12Device *pDevice, CD3D12HeapAllocator *pHeapAllocator, ID3D12GraphicsCommandList *pCommandList, ID3D12DescriptorHeap *pCBVSRVHeap, ID3D12RootSignature *pRootSignature, ID3D12PipelineState *pPipelineState, vr::TrackedDeviceIndex_t unTrackedDeviceIndex, const vr::RenderModel_t & vrModel, const vr::RenderModel_TextureMap_t & vrDiffuseTexture )
 {
 	m_unTrackedDeviceIndex = unTrackedDeviceIndex;
 	m_pCBVSRVHeap = pCBVSRVHeap;
+	m_pHeapAllocator = pHeapAllocator;
 
 	// Create and populate the vertex buffer
 	{
-		pDevice->CreateCommittedResource( &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), 
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(  sizeof( vr::RenderModel_Vertex_t ) * vrModel.unVertexCount ), 
-			D3D12_RESOURCE_STATE_GENERIC_READ, 
-			nullptr, 
-			IID_PPV_ARGS( &m_pVertexBuffer ) );
+		if ( !pHeapAllocator->BCreateBuffer( D3D12_HEAP_TYPE_UPLOAD, sizeof( vr::RenderModel_Vertex_t ) * vrModel.unVertexCount, D3D12_RESOURCE_STATE_GENERIC_READ, &m_pVertexBuffer, &m_vertexBufferAllocation ) )
+			return false;
 
 		UINT8 *pMappedBuffer;
 		CD3DX12_RANGE readRange( 0, 0 );
@@ -2058,12 +2890,8 @@ bool DX12RenderModel::BInit( ID3D12Device *pDevice, ID3D12GraphicsCommandList *p
 
 	// Create and populate the index buffer
 	{
-		pDevice->CreateCommittedResource( &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ), 
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer( sizeof( uint16_t ) * vrModel.unTriangleCount * 3 ),
-			D3D12_RESOURCE_STATE_GENERIC_READ, 
-			nullptr, 
-			IID_PPV_ARGS( &m_pIndexBuffer ) );
+		if ( !pHeapAllocator->BCreateBuffer( D3D12_HEAP_TYPE_UPLOAD, sizeof( uint16_t ) * vrModel.unTriangleCount * 3, D3D12_RESOURCE_STATE_GENERIC_READ, &m_pIndexBuffer, &m_indexBufferAllocation ) )
+			return false;
 
 		UINT8 *pMappedBuffer;
 		CD3DX12_RANGE readRange( 0, 0 );
@@ -2120,12 +2948,16 @@ bool DX12RenderModel::BInit( ID3D12Device *pDevice, ID3D12GraphicsCommandList *p
 		textureDesc.SampleDesc.Quality = 0;
 		textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 
-		pDevice->CreateCommittedResource( &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_DEFAULT ),
-			D3D12_HEAP_FLAG_NONE,
-			&textureDesc,
-			D3D12_RESOURCE_STATE_COPY_DEST,
-			nullptr,
-			IID_PPV_ARGS( &m_pTexture ) );
+		// Created in COMMON so the copy queue can promote it to COPY_DEST. It decays back to COMMON when the copy
+		// completes and the direct queue then promotes it to PIXEL_SHADER_RESOURCE on first use, no barriers needed.
+		if ( !pHeapAllocator->BCreatePlacedResource( D3D12_HEAP_TYPE_DEFAULT, textureDesc, D3D12_RESOURCE_STATE_COMMON, &m_pTexture, &m_textureAllocation ) )
+		{
+			for ( size_t nMip = 0; nMip < mipLevelData.size(); nMip++ )
+			{
+				delete [] mipLevelData[ nMip ].pData;
+			}
+			return false;
+		}
 
 		// Create shader resource view
 		CD3DX12_CPU_DESCRIPTOR_HANDLE srvHandle( pCBVSRVHeap->GetCPUDescriptorHandleForHeapStart() );
@@ -2135,16 +2967,16 @@ bool DX12RenderModel::BInit( ID3D12Device *pDevice, ID3D12GraphicsCommandList *p
 		const UINT64 nUploadBufferSize = GetRequiredIntermediateSize( m_pTexture.Get(), 0, textureDesc.MipLevels );
 
 		// Create the GPU upload buffer.
-		pDevice->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer( nUploadBufferSize ),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS( &m_pTextureUploadHeap ) );
+		if ( !pHeapAllocator->BCreateBuffer( D3D12_HEAP_TYPE_UPLOAD, nUploadBufferSize, D3D12_RESOURCE_STATE_GENERIC_READ, &m_pTextureUploadHeap, &m_textureUploadAllocation ) )
+		{
+			for ( size_t nMip = 0; nMip < mipLevelData.size(); nMip++ )
+			{
+				delete [] mipLevelData[ nMip ].pData;
+			}
+			return false;
+		}
 
 		UpdateSubresources( pCommandList, m_pTexture.Get(), m_pTextureUploadHeap.Get(), 0, 0, mipLevelData.size(), &mipLevelData[0] );
-		pCommandList->ResourceBarrier( 1, &CD3DX12_RESOURCE_BARRIER::Transition( m_pTexture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE ) );
 
 		// Free mip pointers
 		for ( size_t nMip = 0; nMip < mipLevelData.size(); nMip++ )
@@ -2153,75 +2985,82 @@ bool DX12RenderModel::BInit( ID3D12Device *pDevice, ID3D12GraphicsCommandList *p
 		}
 	}
 
-	// Create a constant buffer to hold the transform (one for each eye)
+	m_unVertexCount = vrModel.unTriangleCount * 3;
+
+	// Record everything but the transform into a bundle, Draw only has to bind the transform and execute it
 	{
-		pDevice->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer( 1024 * 64 ),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS( &m_pConstantBuffer ) );
+		if ( FAILED( pDevice->CreateCommandAllocator( D3D12_COMMAND_LIST_TYPE_BUNDLE, IID_PPV_ARGS( &m_pBundleAllocator ) ) ) ||
+			FAILED( pDevice->CreateCommandList( 0, D3D12_COMMAND_LIST_TYPE_BUNDLE, m_pBundleAllocator.Get(), pPipelineState, IID_PPV_ARGS( &m_pBundle ) ) ) )
+		{
+			return false;
+		}
 
-		// Keep as persistently mapped buffer, store left eye in first 256 bytes, right eye in second
-		UINT8 *pBuffer;
-		CD3DX12_RANGE readRange( 0, 0 );
-		m_pConstantBuffer->Map( 0, &readRange, reinterpret_cast<void**>( &pBuffer ) );
-		// Left eye to first 256 bytes, right eye to second 256 bytes
-		m_pConstantBufferData[ 0 ] = pBuffer;
-		m_pConstantBufferData[ 1 ] = pBuffer + 256;
-
-		// Left eye CBV
-		CD3DX12_CPU_DESCRIPTOR_HANDLE cbvLeftEyeHandle( m_pCBVSRVHeap->GetCPUDescriptorHandleForHeapStart() );
-		cbvLeftEyeHandle.Offset( CBV_LEFT_EYE_RENDER_MODEL0 + m_unTrackedDeviceIndex, pDevice->GetDescriptorHandleIncrementSize( D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV ) );
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-		cbvDesc.BufferLocation = m_pConstantBuffer->GetGPUVirtualAddress();
-		cbvDesc.SizeInBytes = ( sizeof( Matrix4 ) + 255 ) & ~255; // Pad to 256 bytes
-		pDevice->CreateConstantBufferView( &cbvDesc, cbvLeftEyeHandle );
-		
-		// Right eye CBV
-		CD3DX12_CPU_DESCRIPTOR_HANDLE cbvRightEyeHandle( m_pCBVSRVHeap->GetCPUDescriptorHandleForHeapStart() );
-		cbvRightEyeHandle.Offset( CBV_RIGHT_EYE_RENDER_MODEL0 + m_unTrackedDeviceIndex,  pDevice->GetDescriptorHandleIncrementSize( D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV ) );
-		cbvDesc.BufferLocation += 256;
-		pDevice->CreateConstantBufferView( &cbvDesc, cbvRightEyeHandle );
-	}
+		ID3D12DescriptorHeap *ppHeaps[] = { pCBVSRVHeap };
+		m_pBundle->SetDescriptorHeaps( _countof( ppHeaps ), ppHeaps );
+		m_pBundle->SetGraphicsRootSignature( pRootSignature );
 
-	m_unVertexCount = vrModel.unTriangleCount * 3;
+		CD3DX12_GPU_DESCRIPTOR_HANDLE srvHandle( pCBVSRVHeap->GetGPUDescriptorHandleForHeapStart() );
+		srvHandle.Offset( SRV_TEXTURE_RENDER_MODEL0 + unTrackedDeviceIndex, pDevice->GetDescriptorHandleIncrementSize( D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV ) );
+		m_pBundle->SetGraphicsRootDescriptorTable( 1, srvHandle );
+
+		m_pBundle->IASetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+		m_pBundle->IASetVertexBuffers( 0, 1, &m_vertexBufferView );
+		m_pBundle->IASetIndexBuffer( &m_indexBufferView );
+		m_pBundle->DrawIndexedInstanced( m_unVertexCount, 1, 0, 0, 0 );
+		m_pBundle->Close();
+	}
 
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Frees the texture upload buffer once the copy has completed
+//-----------------------------------------------------------------------------
+void DX12RenderModel::ReleaseUploadResources()
+{
+	m_pTextureUploadHeap.Reset();
+	if ( m_pHeapAllocator != NULL )
+	{
+		m_pHeapAllocator->Free( &m_textureUploadAllocation );
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Frees the D3D12 resources for a render model
 //-----------------------------------------------------------------------------
 void DX12RenderModel::Cleanup()
 {
+	if ( m_pHeapAllocator == NULL )
+		return;
+
+	m_pVertexBuffer.Reset();
+	m_pHeapAllocator->Free( &m_vertexBufferAllocation );
+	m_pIndexBuffer.Reset();
+	m_pHeapAllocator->Free( &m_indexBufferAllocation );
+	m_pTexture.Reset();
+	m_pHeapAllocator->Free( &m_textureAllocation );
+	m_pTextureUploadHeap.Reset();
+	m_pHeapAllocator->Free( &m_textureUploadAllocation );
+	m_pHeapAllocator = NULL;
+	m_pBundle.Reset();
+	m_pBundleAllocator.Reset();
 }
 
 //-----------------------------------------------------------------------------
 // Purpose: Draws the render model
 //-----------------------------------------------------------------------------
-void DX12RenderModel::Draw( vr::EVREye nEye, ID3D12GraphicsCommandList *pCommandList, UINT nCBVSRVDescriptorSize, const Matrix4 &matMVP )
+void DX12RenderModel::Draw( vr::EVREye nEye, ID3D12GraphicsCommandList *pCommandList, CD3D12UploadRing *pUploadRing, const Matrix4 &matMVP )
 {
-	// Update the CB with the transform
-	memcpy( m_pConstantBufferData[ nEye ], &matMVP, sizeof( matMVP ) );
-
-	// Bind the CB
-	int nStartOffset = ( nEye == vr::Eye_Left ) ? CBV_LEFT_EYE_RENDER_MODEL0 : CBV_RIGHT_EYE_RENDER_MODEL0;
-	CD3DX12_GPU_DESCRIPTOR_HANDLE cbvHandle( m_pCBVSRVHeap->GetGPUDescriptorHandleForHeapStart() );
-	cbvHandle.Offset( nStartOffset + m_unTrackedDeviceIndex, nCBVSRVDescriptorSize );
-	pCommandList->SetGraphicsRootDescriptorTable( 0, cbvHandle );
+	// Write the transform to the upload ring and bind it
+	UINT8 *pConstantBufferData;
+	D3D12_GPU_VIRTUAL_ADDRESS nConstantBufferLocation;
+	if ( !pUploadRing->BAllocate( sizeof( matMVP ), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, &pConstantBufferData, &nConstantBufferLocation ) )
+		return;
+	memcpy( pConstantBufferData, &matMVP, sizeof( matMVP ) );
+	pCommandList->SetGraphicsRootConstantBufferView( 0, nConstantBufferLocation );
 
-	// Bind the texture
-	CD3DX12_GPU_DESCRIPTOR_HANDLE srvHandle( m_pCBVSRVHeap->GetGPUDescriptorHandleForHeapStart() );
-	srvHandle.Offset( SRV_TEXTURE_RENDER_MODEL0 + m_unTrackedDeviceIndex, nCBVSRVDescriptorSize );
-	pCommandList->SetGraphicsRootDescriptorTable( 1, srvHandle );
-
-	// Bind the VB/IB and draw
-	pCommandList->IASetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
-	pCommandList->IASetVertexBuffers( 0, 1, &m_vertexBufferView );
-	pCommandList->IASetIndexBuffer( &m_indexBufferView );
-	pCommandList->DrawIndexedInstanced( m_unVertexCount, 1, 0, 0, 0 );
+	// The bundle binds the texture and VB/IB and draws
+	pCommandList->ExecuteBundle( m_pBundle.Get() );
 }
 
 //-----------------------------------------------------------------------------
@@ -2229,6 +3068,9 @@ void DX12RenderModel::Draw( vr::EVREye nEye, ID3D12GraphicsCommandList *pCommand
 //-----------------------------------------------------------------------------
 int main(int argc, char *argv[])
 {
+	// find and map vrclient while the arguments are parsed and SDL starts up
+	vr::VR_PrefetchRuntime();
+
 	CMainApplication *pMainApplication = new CMainApplication( argc, argv );
 
 	if ( !pMainApplication->BInit() )
@@ -13,14 +13,21 @@
 #include <GL/glu.h>
 #endif
 #include <stdio.h>
+#include <math.h>
+#include <float.h>
 #include <string>
 #include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
 
 #include <openvr.h>
 
 #include "shared/lodepng.h"
 #include "shared/Matrices.h"
 #include "shared/pathtools.h"
+#include "shared/scenecull.h"
+#include "shared/VectorBatch.h"
+#include "shared/foveation.h"
 
 #if defined(POSIX)
 #include "unistd.h"
@@ -34,6 +41,26 @@
 #define _countof(x) (sizeof(x)/sizeof((x)[0]))
 #endif
 
+// GL_OVR_multiview is newer than the GLEW we ship, its entry point is loaded through SDL
+#ifndef GL_OVR_multiview
+typedef void ( APIENTRY *PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC )( GLenum target, GLenum attachment, GLuint texture, GLint level, GLint baseViewIndex, GLsizei numViews );
+#endif
+static PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC g_pglFramebufferTextureMultiviewOVR = NULL;
+
+// so is GL_NV_shading_rate_image, which -foveate uses for fixed foveated rendering
+#ifndef GL_NV_shading_rate_image
+#define GL_SHADING_RATE_IMAGE_TEXEL_WIDTH_NV              0x955C
+#define GL_SHADING_RATE_IMAGE_TEXEL_HEIGHT_NV             0x955D
+#define GL_SHADING_RATE_IMAGE_NV                          0x9563
+#define GL_SHADING_RATE_1_INVOCATION_PER_PIXEL_NV         0x9565
+#define GL_SHADING_RATE_1_INVOCATION_PER_2X2_PIXELS_NV    0x9568
+#define GL_SHADING_RATE_1_INVOCATION_PER_4X4_PIXELS_NV    0x956B
+typedef void ( APIENTRY *PFNGLBINDSHADINGRATEIMAGENVPROC )( GLuint texture );
+typedef void ( APIENTRY *PFNGLSHADINGRATEIMAGEPALETTENVPROC )( GLuint viewport, GLuint first, GLsizei count, const GLenum *rates );
+#endif
+static PFNGLBINDSHADINGRATEIMAGENVPROC g_pglBindShadingRateImageNV = NULL;
+static PFNGLSHADINGRATEIMAGEPALETTENVPROC g_pglShadingRateImagePaletteNV = NULL;
+
 void ThreadSleep( unsigned long nMilliseconds )
 {
 #if defined(_WIN32)
@@ -51,8 +78,11 @@ public:
 
 	bool BInit( const vr::RenderModel_t & vrModel, const vr::RenderModel_TextureMap_t & vrDiffuseTexture );
 	void Cleanup();
+	void Bind();
 	void Draw();
 	const std::string & GetName() const { return m_sModelName; }
+	const Vector3 & GetBoundsCenter() const { return m_vBoundsCenter; }
+	float GetBoundsRadius() const { return m_flBoundsRadius; }
 
 private:
 	GLuint m_glVertBuffer;
@@ -60,9 +90,47 @@ private:
 	GLuint m_glVertArray;
 	GLuint m_glTexture;
 	GLsizei m_unVertexCount;
+	Vector3 m_vBoundsCenter;                                 // bounding sphere in model space
+	float m_flBoundsRadius;
 	std::string m_sModelName;
 };
 
+//-----------------------------------------------------------------------------
+// Purpose: Vertex and uniform data that is rewritten every frame. The buffer is split into
+//          k_nRegionCount regions used in turn, one per frame, so the CPU fills
+//          one region while the GPU may still read the previous ones. With
+//          ARB_buffer_storage the buffer stays persistently mapped and each
+//          region is fenced; otherwise the region is uploaded in place.
+//-----------------------------------------------------------------------------
+class CGLStreamingBuffer
+{
+public:
+	CGLStreamingBuffer();
+	~CGLStreamingBuffer();
+
+	bool BInit( GLsizeiptr unRegionSize );
+	void Cleanup();
+
+	void *PAllocate( GLsizeiptr unSize, GLintptr *pOffset, GLsizeiptr unAlignment = 16 );
+	void Flush();
+	void EndFrame();
+
+	GLuint GetBuffer() const { return m_glBuffer; }
+	bool BPersistent() const { return m_pMapped != NULL; }   // writes land in the buffer itself, even after Flush
+
+private:
+	enum { k_nRegionCount = 3 };
+
+	GLuint m_glBuffer;
+	GLsizeiptr m_unRegionSize;
+	GLsizeiptr m_unRegionUsed;
+	GLsizeiptr m_unRegionFlushed;
+	int m_nRegion;
+	uint8_t *m_pMapped;
+	std::vector< uint8_t > m_vecStaging;
+	GLsync m_rFence[ k_nRegionCount ];
+};
+
 static bool g_bPrintf = true;
 
 //-----------------------------------------------------------------------------
@@ -99,19 +167,56 @@ public:
 
 	void RenderStereoTargets();
 	void RenderCompanionWindow();
-	void RenderScene( vr::Hmd_Eye nEye );
+	float *RenderScene( const Matrix4 *pmatViewProjection, uint32_t unViewCount );
 
 	Matrix4 GetHMDMatrixProjectionEye( vr::Hmd_Eye nEye );
 	Matrix4 GetHMDMatrixPoseEye( vr::Hmd_Eye nEye );
 	Matrix4 GetCurrentViewProjectionMatrix( vr::Hmd_Eye nEye );
 	void UpdateHMDMatrixPose();
+	void LateLatchViews();
+	void UpdateTrackedDeviceClass( vr::TrackedDeviceIndex_t unTrackedDeviceIndex );
 
 	Matrix4 ConvertSteamVRMatrixToMatrix4( const vr::HmdMatrix34_t &matPose );
+	void ConvertSteamVRMatrixToMatrix4( const vr::TrackedDevicePose_t *pPoses, Matrix4 *pMatrices, uint32_t unCount );
 
 	GLuint CompileGLShader( const char *pchShaderName, const char *pchVertexShader, const char *pchFragmentShader );
+	std::string GetProgramCachePath( const char *pchVertexShader, const char *pchFragmentShader );
+	GLuint LoadCachedProgram( const char *pchShaderName, const std::string &strPath );
+	void SaveProgramBinary( const char *pchShaderName, GLuint unProgramID, const std::string &strPath );
+	bool BindViewBlock( GLuint unProgramID, const char *pchShaderName );
 	bool CreateAllShaders();
 
+	static const GLuint k_unViewBlockBinding = 0;            // uniform buffer binding of the shaders' view projection matrices
+
 	CGLRenderModel *FindOrLoadRenderModel( const char *pchRenderModelName );
+	void UpdateRenderModelLoads();
+
+	// GPU timestamps written between the parts of a frame
+	enum EGpuTimestamp
+	{
+		k_eGpuTimestamp_FrameStart,
+		k_eGpuTimestamp_LeftEye,
+		k_eGpuTimestamp_RightEye,
+		k_eGpuTimestamp_Companion,
+		k_eGpuTimestamp_Count
+	};
+	static const uint32_t k_unTimingFrameCount = 4;          // frames in flight before a frame's timestamps are read back
+
+	bool BInitFrameTiming();
+	void WriteGpuTimestamp( EGpuTimestamp eTimestamp );
+	void UpdateFrameTiming();
+	void RecordFrameTiming( uint64_t unFrame, const float *pflGpuMs );
+
+	// how far -latelatch moved the head of a frame, and whether the GPU may have read the matrices first
+	struct LateLatch_t
+	{
+		bool m_bLatched;
+		bool m_bGpuStarted;                                  // the frame began on the GPU before the rewrite, known once its timestamps are back
+		GLint64 m_nGpuTime;                                  // GPU clock right after the rewrite
+		float m_flMs;                                        // since WaitGetPoses returned
+		float m_flDegrees;
+		float m_flMillimeters;
+	};
 
 private: 
 	bool m_bDebugOpenGL;
@@ -119,6 +224,12 @@ private:
 	bool m_bPerf;
 	bool m_bVblank;
 	bool m_bGlFinishHack;
+	bool m_bMultiview;                                       // render both eyes in a single pass with GL_OVR_multiview2
+	bool m_bProgramCache;                                    // link programs from the binaries earlier runs saved, -noprogramcache turns it off
+	std::string m_strProgramCacheKey;                        // the driver the binaries are only good for, empty when not caching
+	uint32_t m_unCachedPrograms;                             // programs CreateAllShaders took from the cache
+	bool m_bCulling;                                         // frustum cull the scene cells and render models, off with -noculling
+	bool m_bLateLatch;                                       // re-read the HMD pose just before Submit and rewrite the view matrices
 
 	vr::IVRSystem *m_pHMD;
 	std::string m_strDriver;
@@ -148,6 +259,8 @@ private: // SDL bookkeeping
 	SDL_Window *m_pCompanionWindow;
 	uint32_t m_nCompanionWindowWidth;
 	uint32_t m_nCompanionWindowHeight;
+	uint32_t m_unCompanionInterval;                          // mirror every nth frame ( -companioninterval ), 0 never ( -nocompanion )
+	bool m_bCompanionFrame;                                  // the mirror is drawn and swapped this frame
 
 	SDL_GLContext m_pContext;
 
@@ -159,7 +272,7 @@ private: // OpenGL bookkeeping
 	bool m_bShowCubes;
 	Vector2 m_vAnalogValue;
 
-	std::string m_strPoseClasses;                            // what classes we saw poses for this frame
+	char m_rchPoseClasses[ vr::k_unMaxTrackedDeviceCount + 1 ]; // what classes we saw poses for this frame
 	char m_rDevClassChar[ vr::k_unMaxTrackedDeviceCount ];   // for each device, a character representing its class
 
 	int m_iSceneVolumeWidth;
@@ -176,18 +289,50 @@ private: // OpenGL bookkeeping
 	GLuint m_iTexture;
 
 	unsigned int m_uiVertcount;
+	unsigned int m_uiSceneInstanceCount;                     // one instance of the cube mesh per cell of the scene volume
 
 	GLuint m_glSceneVertBuffer;
 	GLuint m_unSceneVAO;
+	GLuint m_glSceneCellBuffer;                              // the instanced cell index of each cube, in CSceneCellBVH order
+	CSceneCellBVH m_sceneBVH;
+	std::vector< SceneCellRange_t > m_vecSceneRanges;        // cells that survived culling in the current view
 	GLuint m_unCompanionWindowVAO;
 	GLuint m_glCompanionWindowIDVertBuffer;
 	GLuint m_glCompanionWindowIDIndexBuffer;
 	unsigned int m_uiCompanionWindowIndexSize;
 
-	GLuint m_glControllerVertBuffer;
 	GLuint m_unControllerVAO;
 	unsigned int m_uiControllerVertcount;
 
+	CGLStreamingBuffer m_streamingBuffer;                    // per frame dynamic geometry such as the controller axes
+
+	GLuint m_rglTimestampQueries[ k_unTimingFrameCount ][ k_eGpuTimestamp_Count ];
+	uint64_t m_unTimingFrame;                                // frame whose timestamps are being written
+	std::string m_strTimingCsvPath;                          // -timingcsv, one row per frame once its timestamps are back
+	FILE *m_pTimingCsv;
+	std::string m_strWindowTitle;
+
+	struct FrameTimingSums_t
+	{
+		uint32_t m_unFrames;
+		double m_flGpuMs[ k_eGpuTimestamp_Count - 1 ];
+		double m_flCompositorGpuMs;
+		double m_flFrameIntervalMs;
+		uint32_t m_unDroppedFrames;
+		uint32_t m_unLateLatched;
+		uint32_t m_unLateLatchGpuStarted;
+		double m_flLateLatchMs;
+		double m_flLateLatchDegrees;
+	};
+	FrameTimingSums_t m_frameTimingSums;                     // since the companion window title was last updated
+	uint32_t m_unFrameTimingTitleTicks;
+
+	float m_flDisplayFrequency;
+	float m_flSecondsFromVsyncToPhotons;
+	uint64_t m_ulPosesCounter;                               // SDL performance counter when WaitGetPoses returned
+	float *m_rpflViewMatrix[ 2 ];                            // each eye's view projection in this frame's view block, if mapped
+	LateLatch_t m_rLateLatch[ k_unTimingFrameCount ];
+
 	Matrix4 m_mat4HMDPose;
 	Matrix4 m_mat4eyePosLeft;
 	Matrix4 m_mat4eyePosRight;
@@ -215,9 +360,8 @@ private: // OpenGL bookkeeping
 	GLuint m_unControllerTransformProgramID;
 	GLuint m_unRenderModelProgramID;
 
-	GLint m_nSceneMatrixLocation;
-	GLint m_nControllerMatrixLocation;
 	GLint m_nRenderModelMatrixLocation;
+	GLint m_nUniformBufferAlignment;
 
 	struct FramebufferDesc
 	{
@@ -231,11 +375,37 @@ private: // OpenGL bookkeeping
 	FramebufferDesc rightEyeDesc;
 
 	bool CreateFrameBuffer( int nWidth, int nHeight, FramebufferDesc &framebufferDesc );
+
+	// both eyes as the two layers of one multisampled array, resolved into the eye framebuffers above
+	struct MultiviewFramebufferDesc
+	{
+		GLuint m_nDepthTextureId;
+		GLuint m_nRenderTextureId;
+		GLuint m_nRenderFramebufferId;
+		GLuint m_rnLayerFramebufferId[ 2 ];                  // read framebuffer for each eye's layer when resolving
+	};
+	MultiviewFramebufferDesc multiviewDesc;
+
+	bool CreateMultiviewFrameBuffer( int nWidth, int nHeight, MultiviewFramebufferDesc &framebufferDesc );
+
+	bool SetupFoveation();
+	void SetShadingRateImage( GLuint unShadingRateImage );
+
+	FoveationSettings_t m_foveation;                         // -foveate, -foveateleft and -foveateright
+	GLuint m_rglShadingRateImage[ 2 ];                       // each eye's R8UI rate per tile, 0 when not foveating
+	GLuint m_glMultiviewShadingRateImage;                    // the finer rate of the two eyes, for the multiview pass
 	
 	uint32_t m_nRenderWidth;
 	uint32_t m_nRenderHeight;
 
-	std::vector< CGLRenderModel * > m_vecRenderModels;
+	std::unordered_map< std::string, CGLRenderModel * > m_mapRenderModels; // NULL for models that failed to load
+
+	struct PendingRenderModel_t
+	{
+		std::string m_sName;
+		vr::RenderModel_t *m_pModel = nullptr;               // geometry that is waiting on its texture
+	};
+	std::vector< PendingRenderModel_t > m_vecPendingRenderModels;
 
 	vr::VRActionHandle_t m_actionHideCubes = vr::k_ulInvalidActionHandle;
 	vr::VRActionHandle_t m_actionHideThisController = vr::k_ulInvalidActionHandle;
@@ -314,6 +484,26 @@ bool GetDigitalActionState(vr::VRActionHandle_t action, vr::VRInputValueHandle_t
 	return actionData.bActive && actionData.bState;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Where lodepng::decode_rows puts the rows of an RGBA image
+//-----------------------------------------------------------------------------
+struct DecodedRowTarget_t
+{
+	uint8_t *m_pDest;
+	size_t m_unRowPitch;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies one decoded row into place. The rows come top to bottom, so
+//          a mapped buffer is only ever written forwards, never read.
+//-----------------------------------------------------------------------------
+static unsigned CopyDecodedRow( const unsigned char *pRow, size_t unRowSize, unsigned y, void *pContext )
+{
+	DecodedRowTarget_t *pTarget = ( DecodedRowTarget_t * )pContext;
+	memcpy( pTarget->m_pDest + y * pTarget->m_unRowPitch, pRow, unRowSize );
+	return 0;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Outputs a set of optional arguments to debugging output, using
 //          the printf format setting specified in fmt*.
@@ -341,6 +531,8 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 	, m_pContext(NULL)
 	, m_nCompanionWindowWidth( 640 )
 	, m_nCompanionWindowHeight( 320 )
+	, m_unCompanionInterval( 1 )
+	, m_bCompanionFrame( true )
 	, m_unSceneProgramID( 0 )
 	, m_unCompanionWindowProgramID( 0 )
 	, m_unControllerTransformProgramID( 0 )
@@ -351,20 +543,32 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 	, m_bPerf( false )
 	, m_bVblank( false )
 	, m_bGlFinishHack( true )
-	, m_glControllerVertBuffer( 0 )
+	, m_bMultiview( true )
+	, m_bProgramCache( true )
+	, m_unCachedPrograms( 0 )
+	, m_bCulling( true )
+	, m_bLateLatch( false )
 	, m_unControllerVAO( 0 )
 	, m_unSceneVAO( 0 )
-	, m_nSceneMatrixLocation( -1 )
-	, m_nControllerMatrixLocation( -1 )
+	, m_glSceneCellBuffer( 0 )
 	, m_nRenderModelMatrixLocation( -1 )
+	, m_nUniformBufferAlignment( 256 )
 	, m_iTrackedControllerCount( 0 )
 	, m_iTrackedControllerCount_Last( -1 )
 	, m_iValidPoseCount( 0 )
 	, m_iValidPoseCount_Last( -1 )
 	, m_iSceneVolumeInit( 20 )
-	, m_strPoseClasses("")
 	, m_bShowCubes( true )
+	, m_unTimingFrame( 0 )
+	, m_pTimingCsv( NULL )
+	, m_unFrameTimingTitleTicks( 0 )
+	, m_flDisplayFrequency( 90.0f )
+	, m_flSecondsFromVsyncToPhotons( 0.0f )
+	, m_ulPosesCounter( 0 )
+	, m_glMultiviewShadingRateImage( 0 )
 {
+	Foveation_InitSettings( &m_foveation );
+	memset( m_rglShadingRateImage, 0, sizeof( m_rglShadingRateImage ) );
 
 	for( int i = 1; i < argc; i++ )
 	{
@@ -388,14 +592,67 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 		{
 			g_bPrintf = false;
 		}
+		else if( !stricmp( argv[i], "-nomultiview" ) )
+		{
+			m_bMultiview = false;
+		}
+		else if( !stricmp( argv[i], "-noprogramcache" ) )
+		{
+			m_bProgramCache = false;
+		}
+		else if( !stricmp( argv[i], "-noculling" ) )
+		{
+			m_bCulling = false;
+		}
+		else if( !stricmp( argv[i], "-latelatch" ) )
+		{
+			m_bLateLatch = true;
+		}
+		else if( !stricmp( argv[i], "-nocompanion" ) )
+		{
+			m_unCompanionInterval = 0;
+		}
+		else if ( !stricmp( argv[i], "-companioninterval" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
+		{
+			int nInterval = atoi( argv[ i + 1 ] );
+			m_unCompanionInterval = nInterval > 0 ? ( uint32_t )nInterval : 0;
+			i++;
+		}
+		else if ( !stricmp( argv[i], "-companionscale" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
+		{
+			// shrinks the window, and the swapchain with it, never grows it
+			float flScale = ( float )atof( argv[ i + 1 ] );
+			if ( flScale > 0.0f && flScale < 1.0f )
+			{
+				uint32_t nWidth = ( uint32_t )( flScale * m_nCompanionWindowWidth );
+				uint32_t nHeight = ( uint32_t )( flScale * m_nCompanionWindowHeight );
+				m_nCompanionWindowWidth = nWidth ? nWidth : 1;
+				m_nCompanionWindowHeight = nHeight ? nHeight : 1;
+			}
+			i++;
+		}
 		else if ( !stricmp( argv[i], "-cubevolume" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
 		{
 			m_iSceneVolumeInit = atoi( argv[ i + 1 ] );
 			i++;
 		}
+		else if ( !stricmp( argv[i], "-timingcsv" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
+		{
+			m_strTimingCsvPath = argv[ i + 1 ];
+			i++;
+		}
+		else if ( Foveation_ParseArg( argc, argv, &i, &m_foveation ) )
+		{
+			// consumed along with its values
+		}
 	}
 	// other initialization tasks are done in BInit
 	memset(m_rDevClassChar, 0, sizeof(m_rDevClassChar));
+	memset(m_rchPoseClasses, 0, sizeof(m_rchPoseClasses));
+	memset(m_rglTimestampQueries, 0, sizeof(m_rglTimestampQueries));
+	memset(&m_frameTimingSums, 0, sizeof(m_frameTimingSums));
+	memset(m_rpflViewMatrix, 0, sizeof(m_rpflViewMatrix));
+	memset(m_rLateLatch, 0, sizeof(m_rLateLatch));
 };
 
 
@@ -454,7 +711,7 @@ bool CMainApplication::BInit()
 
 	int nWindowPosX = 700;
 	int nWindowPosY = 100;
-	Uint32 unWindowFlags = SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN;
+	Uint32 unWindowFlags = SDL_WINDOW_OPENGL | ( m_unCompanionInterval ? SDL_WINDOW_SHOWN : SDL_WINDOW_HIDDEN );
 
 	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 4 );
 	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 1 );
@@ -502,8 +759,14 @@ bool CMainApplication::BInit()
 	m_strDriver = GetTrackedDeviceString( vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_TrackingSystemName_String );
 	m_strDisplay = GetTrackedDeviceString( vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SerialNumber_String );
 
-	std::string strWindowTitle = "hellovr - " + m_strDriver + " " + m_strDisplay;
-	SDL_SetWindowTitle( m_pCompanionWindow, strWindowTitle.c_str() );
+	m_strWindowTitle = "hellovr - " + m_strDriver + " " + m_strDisplay;
+	SDL_SetWindowTitle( m_pCompanionWindow, m_strWindowTitle.c_str() );
+
+	// what -latelatch predicts the HMD pose with
+	float flDisplayFrequency = m_pHMD->GetFloatTrackedDeviceProperty( vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float );
+	if ( flDisplayFrequency > 0.0f )
+		m_flDisplayFrequency = flDisplayFrequency;
+	m_flSecondsFromVsyncToPhotons = m_pHMD->GetFloatTrackedDeviceProperty( vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SecondsFromVsyncToPhotons_Float );
 	
 	// cube array
  	m_iSceneVolumeWidth = m_iSceneVolumeInit;
@@ -518,6 +781,7 @@ bool CMainApplication::BInit()
  
  	m_iTexture = 0;
  	m_uiVertcount = 0;
+ 	m_uiSceneInstanceCount = 0;
  
 // 		m_MillisecondsTimer.start(1, this);
 // 		m_SecondsTimer.start(1000, this);
@@ -534,6 +798,9 @@ bool CMainApplication::BInit()
 		return false;
 	}
 
+	for ( vr::TrackedDeviceIndex_t unDevice = 0; unDevice < vr::k_unMaxTrackedDeviceCount; unDevice++ )
+		UpdateTrackedDeviceClass( unDevice );
+
 	vr::VRInput()->SetActionManifestPath( Path_MakeAbsolute( "../hellovr_actions.json", Path_StripFilename( Path_GetExecutablePath() ) ).c_str() );
 
 	vr::VRInput()->GetActionHandle( "/actions/demo/in/HideCubes", &m_actionHideCubes );
@@ -581,15 +848,34 @@ bool CMainApplication::BInitGL()
 		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
 	}
 
+	// the render targets decide whether multiview is usable, which the shaders depend on
+	SetupStereoRenderTargets();
+
 	if( !CreateAllShaders() )
 		return false;
 
 	SetupTexturemaps();
 	SetupScene();
 	SetupCameras();
-	SetupStereoRenderTargets();
 	SetupCompanionWindow();
 
+	if ( !m_streamingBuffer.BInit( 64 * 1024 ) )
+	{
+		printf( "%s - Unable to create the streaming vertex buffer\n", __FUNCTION__ );
+		return false;
+	}
+
+	// the view matrices are rewritten in place after the draws are issued, which needs the persistent mapping
+	glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_nUniformBufferAlignment );
+	if ( m_bLateLatch && !m_streamingBuffer.BPersistent() )
+	{
+		dprintf( "No ARB_buffer_storage, -latelatch ignored\n" );
+		m_bLateLatch = false;
+	}
+
+	if ( !BInitFrameTiming() )
+		return false;
+
 	return true;
 }
 
@@ -617,17 +903,30 @@ bool CMainApplication::BInitCompositor()
 //-----------------------------------------------------------------------------
 void CMainApplication::Shutdown()
 {
+	for( std::vector< PendingRenderModel_t >::iterator i = m_vecPendingRenderModels.begin(); i != m_vecPendingRenderModels.end(); i++ )
+	{
+		if( i->m_pModel )
+			vr::VRRenderModels()->FreeRenderModel( i->m_pModel );
+	}
+	m_vecPendingRenderModels.clear();
+
 	if( m_pHMD )
 	{
 		vr::VR_Shutdown();
 		m_pHMD = NULL;
 	}
 
-	for( std::vector< CGLRenderModel * >::iterator i = m_vecRenderModels.begin(); i != m_vecRenderModels.end(); i++ )
+	for( std::unordered_map< std::string, CGLRenderModel * >::iterator i = m_mapRenderModels.begin(); i != m_mapRenderModels.end(); i++ )
+	{
+		delete i->second;
+	}
+	m_mapRenderModels.clear();
+
+	if( m_pTimingCsv )
 	{
-		delete (*i);
+		fclose( m_pTimingCsv );
+		m_pTimingCsv = NULL;
 	}
-	m_vecRenderModels.clear();
 	
 	if( m_pContext )
 	{
@@ -637,6 +936,7 @@ void CMainApplication::Shutdown()
 			glDebugMessageCallback(nullptr, nullptr);
 		}
 		glDeleteBuffers(1, &m_glSceneVertBuffer);
+		glDeleteBuffers(1, &m_glSceneCellBuffer);
 
 		if ( m_unSceneProgramID )
 		{
@@ -667,6 +967,16 @@ void CMainApplication::Shutdown()
 		glDeleteTextures( 1, &rightEyeDesc.m_nResolveTextureId );
 		glDeleteFramebuffers( 1, &rightEyeDesc.m_nResolveFramebufferId );
 
+		glDeleteTextures( 1, &multiviewDesc.m_nDepthTextureId );
+		glDeleteTextures( 1, &multiviewDesc.m_nRenderTextureId );
+		glDeleteFramebuffers( 1, &multiviewDesc.m_nRenderFramebufferId );
+		glDeleteFramebuffers( 2, multiviewDesc.m_rnLayerFramebufferId );
+
+		glDeleteTextures( 2, m_rglShadingRateImage );
+		glDeleteTextures( 1, &m_glMultiviewShadingRateImage );
+
+		glDeleteQueries( k_unTimingFrameCount * k_eGpuTimestamp_Count, &m_rglTimestampQueries[ 0 ][ 0 ] );
+
 		if( m_unCompanionWindowVAO != 0 )
 		{
 			glDeleteVertexArrays( 1, &m_unCompanionWindowVAO );
@@ -679,6 +989,7 @@ void CMainApplication::Shutdown()
 		{
 			glDeleteVertexArrays( 1, &m_unControllerVAO );
 		}
+		m_streamingBuffer.Cleanup();
 	}
 
 	if( m_pCompanionWindow )
@@ -770,6 +1081,8 @@ bool CMainApplication::HandleInput()
 		}
 	}
 
+	UpdateRenderModelLoads();
+
 	for ( EHand eHand = Left; eHand <= Right; ((int&)eHand)++ )
 	{
 		vr::InputPoseActionData_t poseData;
@@ -787,7 +1100,7 @@ bool CMainApplication::HandleInput()
 				&& originInfo.trackedDeviceIndex != vr::k_unTrackedDeviceIndexInvalid )
 			{
 				std::string sRenderModelName = GetTrackedDeviceString( originInfo.trackedDeviceIndex, vr::Prop_RenderModelName_String );
-				if ( sRenderModelName != m_rHand[eHand].m_sRenderModelName )
+				if ( sRenderModelName != m_rHand[eHand].m_sRenderModelName || !m_rHand[eHand].m_pRenderModel )
 				{
 					m_rHand[eHand].m_pRenderModel = FindOrLoadRenderModel( sRenderModelName.c_str() );
 					m_rHand[eHand].m_sRenderModelName = sRenderModelName;
@@ -827,6 +1140,12 @@ void CMainApplication::ProcessVREvent( const vr::VREvent_t & event )
 {
 	switch( event.eventType )
 	{
+	case vr::VREvent_TrackedDeviceActivated:
+		{
+			UpdateTrackedDeviceClass( event.trackedDeviceIndex );
+			dprintf( "Device %u attached.\n", event.trackedDeviceIndex );
+		}
+		break;
 	case vr::VREvent_TrackedDeviceDeactivated:
 		{
 			dprintf( "Device %u detached.\n", event.trackedDeviceIndex );
@@ -849,17 +1168,31 @@ void CMainApplication::RenderFrame()
 	// for now as fast as possible
 	if ( m_pHMD )
 	{
+		UpdateFrameTiming();
+		WriteGpuTimestamp( k_eGpuTimestamp_FrameStart );
+
+		// the mirror, and the swap that paces it, only runs every m_unCompanionInterval frames
+		m_bCompanionFrame = m_unCompanionInterval != 0 && m_unTimingFrame % m_unCompanionInterval == 0;
+
 		RenderControllerAxes();
 		RenderStereoTargets();
-		RenderCompanionWindow();
+		if ( m_bCompanionFrame )
+			RenderCompanionWindow();
+		WriteGpuTimestamp( k_eGpuTimestamp_Companion );
+		if ( m_bLateLatch )
+			LateLatchViews();
+		m_unTimingFrame++;
 
 		vr::Texture_t leftEyeTexture = {(void*)(uintptr_t)leftEyeDesc.m_nResolveTextureId, vr::TextureType_OpenGL, vr::ColorSpace_Gamma };
 		vr::VRCompositor()->Submit(vr::Eye_Left, &leftEyeTexture );
 		vr::Texture_t rightEyeTexture = {(void*)(uintptr_t)rightEyeDesc.m_nResolveTextureId, vr::TextureType_OpenGL, vr::ColorSpace_Gamma };
 		vr::VRCompositor()->Submit(vr::Eye_Right, &rightEyeTexture );
+
+		// every draw reading this frame's dynamic geometry has been issued
+		m_streamingBuffer.EndFrame();
 	}
 
-	if ( m_bVblank && m_bGlFinishHack )
+	if ( m_bCompanionFrame && m_bVblank && m_bGlFinishHack )
 	{
 		//$ HACKHACK. From gpuview profiling, it looks like there is a bug where two renders and a present
 		// happen right before and after the vsync causing all kinds of jittering issues. This glFinish()
@@ -869,11 +1202,13 @@ void CMainApplication::RenderFrame()
 	}
 
 	// SwapWindow
+	if ( m_bCompanionFrame )
 	{
 		SDL_GL_SwapWindow( m_pCompanionWindow );
 	}
 
 	// Clear
+	if ( m_bCompanionFrame )
 	{
 		// We want to make sure the glFinish waits for the entire present to complete, not just the submission
 		// of the command. So, we do a clear here right here so the glFinish will wait fully for the swap.
@@ -882,7 +1217,7 @@ void CMainApplication::RenderFrame()
 	}
 
 	// Flush and wait for swap.
-	if ( m_bVblank )
+	if ( m_bCompanionFrame && m_bVblank )
 	{
 		glFlush();
 		glFinish();
@@ -894,19 +1229,163 @@ void CMainApplication::RenderFrame()
 		m_iValidPoseCount_Last = m_iValidPoseCount;
 		m_iTrackedControllerCount_Last = m_iTrackedControllerCount;
 		
-		dprintf( "PoseCount:%d(%s) Controllers:%d\n", m_iValidPoseCount, m_strPoseClasses.c_str(), m_iTrackedControllerCount );
+		dprintf( "PoseCount:%d(%s) Controllers:%d\n", m_iValidPoseCount, m_rchPoseClasses, m_iTrackedControllerCount );
 	}
 
 	UpdateHMDMatrixPose();
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Creates the timestamp queries and opens the -timingcsv file
+//-----------------------------------------------------------------------------
+bool CMainApplication::BInitFrameTiming()
+{
+	glGenQueries( k_unTimingFrameCount * k_eGpuTimestamp_Count, &m_rglTimestampQueries[ 0 ][ 0 ] );
+
+	if ( !m_strTimingCsvPath.empty() )
+	{
+		m_pTimingCsv = fopen( m_strTimingCsvPath.c_str(), "w" );
+		if ( !m_pTimingCsv )
+		{
+			printf( "%s - Unable to open %s for writing\n", __FUNCTION__, m_strTimingCsvPath.c_str() );
+			return false;
+		}
+
+		fprintf( m_pTimingCsv, "frame,left_eye_gpu_ms,right_eye_gpu_ms,companion_gpu_ms,"
+			"compositor_frame,pre_submit_gpu_ms,post_submit_gpu_ms,total_render_gpu_ms,compositor_render_gpu_ms,"
+			"compositor_render_cpu_ms,compositor_idle_cpu_ms,client_frame_interval_ms,submit_frame_ms,"
+			"num_frame_presents,num_mis_presented,num_dropped_frames,reprojection_flags,"
+			"late_latched,late_latch_gpu_started,late_latch_ms,late_latch_degrees,late_latch_mm\n" );
+	}
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes a GPU timestamp into the current frame's query set
+//-----------------------------------------------------------------------------
+void CMainApplication::WriteGpuTimestamp( EGpuTimestamp eTimestamp )
+{
+	glQueryCounter( m_rglTimestampQueries[ m_unTimingFrame % k_unTimingFrameCount ][ eTimestamp ], GL_TIMESTAMP );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads back the timestamps of the frame whose queries are about to
+//          be reused. Frames the GPU has not finished yet are skipped rather
+//          than waited on.
+//-----------------------------------------------------------------------------
+void CMainApplication::UpdateFrameTiming()
+{
+	if ( m_unTimingFrame < k_unTimingFrameCount )
+		return;
+
+	const GLuint *pQueries = m_rglTimestampQueries[ m_unTimingFrame % k_unTimingFrameCount ];
+
+	GLint nAvailable = 0;
+	glGetQueryObjectiv( pQueries[ k_eGpuTimestamp_Count - 1 ], GL_QUERY_RESULT_AVAILABLE, &nAvailable );
+	if ( !nAvailable )
+		return;
+
+	GLuint64 rulTimestamps[ k_eGpuTimestamp_Count ];
+	for ( uint32_t i = 0; i < k_eGpuTimestamp_Count; i++ )
+		glGetQueryObjectui64v( pQueries[ i ], GL_QUERY_RESULT, &rulTimestamps[ i ] );
+
+	float rflGpuMs[ k_eGpuTimestamp_Count - 1 ];
+	for ( uint32_t i = 0; i < k_eGpuTimestamp_Count - 1; i++ )
+		rflGpuMs[ i ] = ( float )( ( rulTimestamps[ i + 1 ] - rulTimestamps[ i ] ) * 1e-6 );
+
+	LateLatch_t &latch = m_rLateLatch[ m_unTimingFrame % k_unTimingFrameCount ];
+	latch.m_bGpuStarted = latch.m_bLatched && rulTimestamps[ k_eGpuTimestamp_FrameStart ] < ( GLuint64 )latch.m_nGpuTime;
+
+	RecordFrameTiming( m_unTimingFrame - k_unTimingFrameCount, rflGpuMs );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Pairs a frame's GPU times with the compositor's latest frame
+//          timing, appends them to the -timingcsv file and shows the averages
+//          in the companion window title twice a second.
+//-----------------------------------------------------------------------------
+void CMainApplication::RecordFrameTiming( uint64_t unFrame, const float *pflGpuMs )
+{
+	vr::Compositor_FrameTiming timing;
+	memset( &timing, 0, sizeof( timing ) );
+	timing.m_nSize = sizeof( vr::Compositor_FrameTiming );
+	vr::VRCompositor()->GetFrameTiming( &timing, 1 );
+
+	const LateLatch_t &latch = m_rLateLatch[ unFrame % k_unTimingFrameCount ];
+
+	if ( m_pTimingCsv )
+	{
+		fprintf( m_pTimingCsv, "%llu,%.4f,%.4f,%.4f,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%u,%u,%u,%u,%d,%d,%.4f,%.4f,%.4f\n",
+			( unsigned long long )unFrame, pflGpuMs[ 0 ], pflGpuMs[ 1 ], pflGpuMs[ 2 ],
+			timing.m_nFrameIndex, timing.m_flPreSubmitGpuMs, timing.m_flPostSubmitGpuMs, timing.m_flTotalRenderGpuMs, timing.m_flCompositorRenderGpuMs,
+			timing.m_flCompositorRenderCpuMs, timing.m_flCompositorIdleCpuMs, timing.m_flClientFrameIntervalMs, timing.m_flSubmitFrameMs,
+			timing.m_nNumFramePresents, timing.m_nNumMisPresented, timing.m_nNumDroppedFrames, timing.m_nReprojectionFlags,
+			latch.m_bLatched ? 1 : 0, latch.m_bGpuStarted ? 1 : 0, latch.m_flMs, latch.m_flDegrees, latch.m_flMillimeters );
+	}
+
+	m_frameTimingSums.m_unFrames++;
+	for ( uint32_t i = 0; i < k_eGpuTimestamp_Count - 1; i++ )
+		m_frameTimingSums.m_flGpuMs[ i ] += pflGpuMs[ i ];
+	m_frameTimingSums.m_flCompositorGpuMs += timing.m_flCompositorRenderGpuMs;
+	m_frameTimingSums.m_flFrameIntervalMs += timing.m_flClientFrameIntervalMs;
+	m_frameTimingSums.m_unDroppedFrames += timing.m_nNumDroppedFrames;
+	if ( latch.m_bLatched )
+	{
+		m_frameTimingSums.m_unLateLatched++;
+		if ( latch.m_bGpuStarted )
+			m_frameTimingSums.m_unLateLatchGpuStarted++;
+		m_frameTimingSums.m_flLateLatchMs += latch.m_flMs;
+		m_frameTimingSums.m_flLateLatchDegrees += latch.m_flDegrees;
+	}
+
+	uint32_t unTicks = SDL_GetTicks();
+	if ( unTicks - m_unFrameTimingTitleTicks < 500 )
+		return;
+	m_unFrameTimingTitleTicks = unTicks;
+
+	double flFrames = m_frameTimingSums.m_unFrames;
+	char rchTitle[ 512 ];
+	sprintf_s( rchTitle, sizeof( rchTitle ), "%s | GPU L %.2f R %.2f companion %.2f ms | compositor %.2f ms | interval %.2f ms | dropped %u",
+		m_strWindowTitle.c_str(), m_frameTimingSums.m_flGpuMs[ 0 ] / flFrames, m_frameTimingSums.m_flGpuMs[ 1 ] / flFrames, m_frameTimingSums.m_flGpuMs[ 2 ] / flFrames,
+		m_frameTimingSums.m_flCompositorGpuMs / flFrames, m_frameTimingSums.m_flFrameIntervalMs / flFrames, m_frameTimingSums.m_unDroppedFrames );
+	if ( m_bLateLatch && m_frameTimingSums.m_unLateLatched )
+	{
+		double flLatched = m_frameTimingSums.m_unLateLatched;
+		size_t unLength = strlen( rchTitle );
+		sprintf_s( rchTitle + unLength, sizeof( rchTitle ) - unLength, " | late latch %.2f ms %.3f deg, too late %u/%u",
+			m_frameTimingSums.m_flLateLatchMs / flLatched, m_frameTimingSums.m_flLateLatchDegrees / flLatched,
+			m_frameTimingSums.m_unLateLatchGpuStarted, m_frameTimingSums.m_unLateLatched );
+	}
+	SDL_SetWindowTitle( m_pCompanionWindow, rchTitle );
+
+	memset( &m_frameTimingSums, 0, sizeof( m_frameTimingSums ) );
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Compiles a GL shader program and returns the handle. Returns 0 if
 //			the shader couldn't be compiled for some reason.
 //-----------------------------------------------------------------------------
 GLuint CMainApplication::CompileGLShader( const char *pchShaderName, const char *pchVertexShader, const char *pchFragmentShader )
 {
+	std::string strCachePath = GetProgramCachePath( pchVertexShader, pchFragmentShader );
+	if ( !strCachePath.empty() )
+	{
+		GLuint unCachedProgramID = LoadCachedProgram( pchShaderName, strCachePath );
+		if ( unCachedProgramID != 0 )
+		{
+			glUseProgram( unCachedProgramID );
+			glUseProgram( 0 );
+			m_unCachedPrograms++;
+			return unCachedProgramID;
+		}
+	}
+
 	GLuint unProgramID = glCreateProgram();
 
 	GLuint nSceneVertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -942,6 +1421,10 @@ GLuint CMainApplication::CompileGLShader( const char *pchShaderName, const char
 	glAttachShader( unProgramID, nSceneFragmentShader );
 	glDeleteShader( nSceneFragmentShader ); // the program hangs onto this once it's attached
 
+	if ( !strCachePath.empty() )
+	{
+		glProgramParameteri( unProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+	}
 	glLinkProgram( unProgramID );
 
 	GLint programSuccess = GL_TRUE;
@@ -953,6 +1436,11 @@ GLuint CMainApplication::CompileGLShader( const char *pchShaderName, const char
 		return 0;
 	}
 
+	if ( !strCachePath.empty() )
+	{
+		SaveProgramBinary( pchShaderName, unProgramID, strCachePath );
+	}
+
 	glUseProgram( unProgramID );
 	glUseProgram( 0 );
 
@@ -960,26 +1448,176 @@ GLuint CMainApplication::CompileGLShader( const char *pchShaderName, const char
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Returns where the binary of the program built from these sources
+//          is cached, or an empty string when programs aren't cached. The
+//          GL vendor, renderer and version are hashed in with the sources, so
+//          a driver update or an edited shader misses instead of loading a
+//          binary the driver would reject.
+//-----------------------------------------------------------------------------
+std::string CMainApplication::GetProgramCachePath( const char *pchVertexShader, const char *pchFragmentShader )
+{
+	if ( m_strProgramCacheKey.empty() )
+		return std::string();
+
+	// FNV-1a over the key and both sources, each with its terminator so the boundaries count
+	uint64_t ulHash = 14695981039346656037ull;
+	const char *rpchParts[] = { m_strProgramCacheKey.c_str(), pchVertexShader, pchFragmentShader };
+	for ( const char *pchPart : rpchParts )
+	{
+		const char *pch = pchPart;
+		do
+		{
+			ulHash = ( ulHash ^ ( uint8_t )*pch ) * 1099511628211ull;
+		} while ( *pch++ );
+	}
+
+	char rchFileName[ 64 ];
+	sprintf_s( rchFileName, sizeof( rchFileName ), "hellovr_opengl_%016llx.glprogram", ( unsigned long long )ulHash );
+
+	std::string sExecutableDirectory = Path_StripFilename( Path_GetExecutablePath() );
+	return Path_MakeAbsolute( rchFileName, sExecutableDirectory );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Creates a program from a binary saved by SaveProgramBinary.
+//          Returns 0 when there is none or the driver won't take it.
+//-----------------------------------------------------------------------------
+GLuint CMainApplication::LoadCachedProgram( const char *pchShaderName, const std::string &strPath )
+{
+	int nSize = 0;
+	unsigned char *pData = Path_ReadBinaryFile( strPath, &nSize );
+	if ( !pData )
+		return 0;
+
+	// the binary format the driver reported, then the binary
+	GLuint unProgramID = 0;
+	GLenum nBinaryFormat;
+	if ( nSize > ( int )sizeof( nBinaryFormat ) )
+	{
+		memcpy( &nBinaryFormat, pData, sizeof( nBinaryFormat ) );
+		unProgramID = glCreateProgram();
+		glProgramBinary( unProgramID, nBinaryFormat, pData + sizeof( nBinaryFormat ), nSize - ( int )sizeof( nBinaryFormat ) );
+
+		GLint programSuccess = GL_FALSE;
+		glGetProgramiv( unProgramID, GL_LINK_STATUS, &programSuccess );
+		if ( programSuccess != GL_TRUE )
+		{
+			// a driver may still refuse a binary of its own version, which only costs the compile
+			dprintf( "%s - Cached program binary rejected, compiling\n", pchShaderName );
+			glDeleteProgram( unProgramID );
+			unProgramID = 0;
+		}
+	}
+
+	delete [] pData;
+	return unProgramID;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Saves a linked program's binary for the next run. The file is
+//          replaced atomically so an interrupted write never leaves a
+//          truncated binary behind.
+//-----------------------------------------------------------------------------
+void CMainApplication::SaveProgramBinary( const char *pchShaderName, GLuint unProgramID, const std::string &strPath )
+{
+	GLint nLength = 0;
+	glGetProgramiv( unProgramID, GL_PROGRAM_BINARY_LENGTH, &nLength );
+	if ( nLength <= 0 )
+		return;
+
+	GLenum nBinaryFormat = 0;
+	std::vector< unsigned char > vecData( sizeof( nBinaryFormat ) + nLength );
+	GLsizei nWritten = 0;
+	glGetProgramBinary( unProgramID, nLength, &nWritten, &nBinaryFormat, &vecData[ sizeof( nBinaryFormat ) ] );
+	if ( nWritten <= 0 )
+		return;
+	memcpy( &vecData[ 0 ], &nBinaryFormat, sizeof( nBinaryFormat ) );
+
+	if ( !Path_WriteBinaryFileAtomic( strPath, &vecData[ 0 ], ( unsigned )( sizeof( nBinaryFormat ) + nWritten ) ) )
+	{
+		dprintf( "%s - Unable to save the program binary to %s\n", pchShaderName, strPath.c_str() );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Points a program's ViewBlock at the binding RenderScene fills
+//-----------------------------------------------------------------------------
+bool CMainApplication::BindViewBlock( GLuint unProgramID, const char *pchShaderName )
+{
+	GLuint unBlockIndex = unProgramID ? glGetUniformBlockIndex( unProgramID, "ViewBlock" ) : GL_INVALID_INDEX;
+	if ( unBlockIndex == GL_INVALID_INDEX )
+	{
+		dprintf( "Unable to find ViewBlock in %s shader\n", pchShaderName );
+		return false;
+	}
+	glUniformBlockBinding( unProgramID, unBlockIndex, k_unViewBlockBinding );
+	return true;
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Creates all the shaders used by HelloVR SDL
 //-----------------------------------------------------------------------------
 bool CMainApplication::CreateAllShaders()
 {
+	// programs are cached when the driver can hand out at least one binary format
+	GLint nBinaryFormats = 0;
+	glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &nBinaryFormats );
+	m_strProgramCacheKey.clear();
+	if ( m_bProgramCache && nBinaryFormats > 0 )
+	{
+		const GLubyte *rpchStrings[] = { glGetString( GL_VENDOR ), glGetString( GL_RENDERER ), glGetString( GL_VERSION ) };
+		for ( const GLubyte *pchString : rpchStrings )
+		{
+			m_strProgramCacheKey += pchString ? ( const char * )pchString : "";
+			m_strProgramCacheKey += '\n';
+		}
+	}
+	m_unCachedPrograms = 0;
+	uint64_t ulStartCounter = SDL_GetPerformanceCounter();
+
+	// The shaders that draw into the eye targets take one view projection matrix per view from the
+	// view block, a uniform buffer range so -latelatch can rewrite it after the draws are issued. With
+	// multiview the vertex shader runs once per eye and picks its matrix with gl_ViewID_OVR.
+	const std::string sViewHeader = std::string( m_bMultiview ?
+		"#version 410\n"
+		"#extension GL_OVR_multiview2 : require\n"
+		"layout( num_views = 2 ) in;\n"
+		"#define VIEW_COUNT 2\n"
+		"#define VIEW_INDEX int( gl_ViewID_OVR )\n"
+		:
+		"#version 410\n"
+		"#define VIEW_COUNT 1\n"
+		"#define VIEW_INDEX 0\n" ) +
+		"layout( std140 ) uniform ViewBlock\n"
+		"{\n"
+		"	mat4 matViewProjection[ VIEW_COUNT ];\n"
+		"};\n";
+
 	m_unSceneProgramID = CompileGLShader( 
 		"Scene",
 
 		// Vertex Shader
-		"#version 410\n"
-		"uniform mat4 matrix;\n"
+		// each instance places the cube mesh in the cell of the scene volume it is given
+		( sViewHeader +
+		"uniform vec3 v3VolumeOrigin;\n"
+		"uniform float flCellSpacing;\n"
+		"uniform ivec2 i2VolumeSize;\n"
 		"layout(location = 0) in vec4 position;\n"
 		"layout(location = 1) in vec2 v2UVcoordsIn;\n"
 		"layout(location = 2) in vec3 v3NormalIn;\n"
+		"layout(location = 3) in int nCellIn;\n"
 		"out vec2 v2UVcoords;\n"
 		"void main()\n"
 		"{\n"
+		"	ivec3 i3Cell = ivec3( nCellIn % i2VolumeSize.x, ( nCellIn / i2VolumeSize.x ) % i2VolumeSize.y, nCellIn / ( i2VolumeSize.x * i2VolumeSize.y ) );\n"
 		"	v2UVcoords = v2UVcoordsIn;\n"
-		"	gl_Position = matrix * position;\n"
-		"}\n",
+		"	gl_Position = matViewProjection[ VIEW_INDEX ] * vec4( position.xyz + v3VolumeOrigin + vec3( i3Cell ) * flCellSpacing, 1.0 );\n"
+		"}\n" ).c_str(),
 
 		// Fragment Shader
 		"#version 410 core\n"
@@ -991,27 +1629,22 @@ bool CMainApplication::CreateAllShaders()
 		"   outputColor = texture(mytexture, v2UVcoords);\n"
 		"}\n"
 		);
-	m_nSceneMatrixLocation = glGetUniformLocation( m_unSceneProgramID, "matrix" );
-	if( m_nSceneMatrixLocation == -1 )
-	{
-		dprintf( "Unable to find matrix uniform in scene shader\n" );
+	if( !BindViewBlock( m_unSceneProgramID, "scene" ) )
 		return false;
-	}
 
 	m_unControllerTransformProgramID = CompileGLShader(
 		"Controller",
 
 		// vertex shader
-		"#version 410\n"
-		"uniform mat4 matrix;\n"
+		( sViewHeader +
 		"layout(location = 0) in vec4 position;\n"
 		"layout(location = 1) in vec3 v3ColorIn;\n"
 		"out vec4 v4Color;\n"
 		"void main()\n"
 		"{\n"
 		"	v4Color.xyz = v3ColorIn; v4Color.a = 1.0;\n"
-		"	gl_Position = matrix * position;\n"
-		"}\n",
+		"	gl_Position = matViewProjection[ VIEW_INDEX ] * position;\n"
+		"}\n" ).c_str(),
 
 		// fragment shader
 		"#version 410\n"
@@ -1022,19 +1655,15 @@ bool CMainApplication::CreateAllShaders()
 		"   outputColor = v4Color;\n"
 		"}\n"
 		);
-	m_nControllerMatrixLocation = glGetUniformLocation( m_unControllerTransformProgramID, "matrix" );
-	if( m_nControllerMatrixLocation == -1 )
-	{
-		dprintf( "Unable to find matrix uniform in controller shader\n" );
+	if( !BindViewBlock( m_unControllerTransformProgramID, "controller" ) )
 		return false;
-	}
 
 	m_unRenderModelProgramID = CompileGLShader( 
 		"render model",
 
 		// vertex shader
-		"#version 410\n"
-		"uniform mat4 matrix;\n"
+		( sViewHeader +
+		"uniform mat4 matModel;\n"
 		"layout(location = 0) in vec4 position;\n"
 		"layout(location = 1) in vec3 v3NormalIn;\n"
 		"layout(location = 2) in vec2 v2TexCoordsIn;\n"
@@ -1042,8 +1671,8 @@ bool CMainApplication::CreateAllShaders()
 		"void main()\n"
 		"{\n"
 		"	v2TexCoord = v2TexCoordsIn;\n"
-		"	gl_Position = matrix * vec4(position.xyz, 1);\n"
-		"}\n",
+		"	gl_Position = matViewProjection[ VIEW_INDEX ] * matModel * vec4(position.xyz, 1);\n"
+		"}\n" ).c_str(),
 
 		//fragment shader
 		"#version 410 core\n"
@@ -1056,12 +1685,14 @@ bool CMainApplication::CreateAllShaders()
 		"}\n"
 
 		);
-	m_nRenderModelMatrixLocation = glGetUniformLocation( m_unRenderModelProgramID, "matrix" );
+	m_nRenderModelMatrixLocation = glGetUniformLocation( m_unRenderModelProgramID, "matModel" );
 	if( m_nRenderModelMatrixLocation == -1 )
 	{
-		dprintf( "Unable to find matrix uniform in render model shader\n" );
+		dprintf( "Unable to find matModel uniform in render model shader\n" );
 		return false;
 	}
+	if( !BindViewBlock( m_unRenderModelProgramID, "render model" ) )
+		return false;
 
 	m_unCompanionWindowProgramID = CompileGLShader(
 		"CompanionWindow",
@@ -1088,6 +1719,9 @@ bool CMainApplication::CreateAllShaders()
 		"}\n"
 		);
 
+	dprintf( "Shaders ready in %.1f ms, %u programs from the cache\n",
+		( SDL_GetPerformanceCounter() - ulStartCounter ) * 1000.0 / SDL_GetPerformanceFrequency(), m_unCachedPrograms );
+
 	return m_unSceneProgramID != 0 
 		&& m_unControllerTransformProgramID != 0
 		&& m_unRenderModelProgramID != 0
@@ -1103,18 +1737,40 @@ bool CMainApplication::SetupTexturemaps()
 	std::string sExecutableDirectory = Path_StripFilename( Path_GetExecutablePath() );
 	std::string strFullPath = Path_MakeAbsolute( "../cube_texture.png", sExecutableDirectory );
 	
-	std::vector<unsigned char> imageRGBA;
+	std::vector<unsigned char> vecPng;
+	lodepng::load_file( vecPng, strFullPath );
+	lodepng::State pngState;
 	unsigned nImageWidth, nImageHeight;
-	unsigned nError = lodepng::decode( imageRGBA, nImageWidth, nImageHeight, strFullPath.c_str() );
-	
-	if ( nError != 0 )
+	if ( vecPng.empty() || lodepng_inspect( &nImageWidth, &nImageHeight, &pngState, &vecPng[0], vecPng.size() ) != 0 )
 		return false;
 
-	glGenTextures(1, &m_iTexture );
-	glBindTexture( GL_TEXTURE_2D, m_iTexture );
+	// decode row by row straight into a pixel unpack buffer, so the image is never held in
+	// client memory for the driver to copy again
+	GLsizeiptr unImageSize = ( GLsizeiptr )nImageWidth * nImageHeight * 4;
+	GLuint glUnpackBuffer = 0;
+	glGenBuffers( 1, &glUnpackBuffer );
+	glBindBuffer( GL_PIXEL_UNPACK_BUFFER, glUnpackBuffer );
+	glBufferData( GL_PIXEL_UNPACK_BUFFER, unImageSize, NULL, GL_STREAM_DRAW );
+
+	DecodedRowTarget_t target = { ( uint8_t * )glMapBufferRange( GL_PIXEL_UNPACK_BUFFER, 0, unImageSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT ), nImageWidth * 4 };
+	bool bDecoded = target.m_pDest && lodepng::decode_rows( CopyDecodedRow, &target, nImageWidth, nImageHeight, pngState, &vecPng[0], vecPng.size() ) == 0;
+	if ( target.m_pDest && !glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER ) )
+		bDecoded = false;
+
+	if ( bDecoded )
+	{
+		glGenTextures(1, &m_iTexture );
+		glBindTexture( GL_TEXTURE_2D, m_iTexture );
+
+		// with an unpack buffer bound the data pointer is an offset into it
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, nImageWidth, nImageHeight,
+			0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+	}
 
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, nImageWidth, nImageHeight,
-		0, GL_RGBA, GL_UNSIGNED_BYTE, &imageRGBA[0] );
+	glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+	glDeleteBuffers( 1, &glUnpackBuffer );
+	if ( !bDecoded )
+		return false;
 
 	glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -1141,32 +1797,31 @@ void CMainApplication::SetupScene()
 	if ( !m_pHMD )
 		return;
 
+	// a single cube mesh drawn once per cell, the vertex shader offsets each instance into place.
+	// The cells are instanced in bounding volume hierarchy order so whatever survives culling
+	// comes out as a few contiguous runs.
 	std::vector<float> vertdataarray;
 
 	Matrix4 matScale;
 	matScale.scale( m_fScale, m_fScale, m_fScale );
-	Matrix4 matTransform;
-	matTransform.translate(
-		-( (float)m_iSceneVolumeWidth * m_fScaleSpacing ) / 2.f,
-		-( (float)m_iSceneVolumeHeight * m_fScaleSpacing ) / 2.f,
-		-( (float)m_iSceneVolumeDepth * m_fScaleSpacing ) / 2.f);
-	
-	Matrix4 mat = matScale * matTransform;
-
-	for( int z = 0; z< m_iSceneVolumeDepth; z++ )
-	{
-		for( int y = 0; y< m_iSceneVolumeHeight; y++ )
-		{
-			for( int x = 0; x< m_iSceneVolumeWidth; x++ )
-			{
-				AddCubeToScene( mat, vertdataarray );
-				mat = mat * Matrix4().translate( m_fScaleSpacing, 0, 0 );
-			}
-			mat = mat * Matrix4().translate( -((float)m_iSceneVolumeWidth) * m_fScaleSpacing, m_fScaleSpacing, 0 );
-		}
-		mat = mat * Matrix4().translate( 0, -((float)m_iSceneVolumeHeight) * m_fScaleSpacing, m_fScaleSpacing );
-	}
+	AddCubeToScene( matScale, vertdataarray );
 	m_uiVertcount = vertdataarray.size()/5;
+	m_uiSceneInstanceCount = m_iSceneVolumeWidth * m_iSceneVolumeHeight * m_iSceneVolumeDepth;
+
+	glUseProgram( m_unSceneProgramID );
+	glUniform3f( glGetUniformLocation( m_unSceneProgramID, "v3VolumeOrigin" ),
+		-( (float)m_iSceneVolumeWidth * m_fScaleSpacing * m_fScale ) / 2.f,
+		-( (float)m_iSceneVolumeHeight * m_fScaleSpacing * m_fScale ) / 2.f,
+		-( (float)m_iSceneVolumeDepth * m_fScaleSpacing * m_fScale ) / 2.f );
+	glUniform1f( glGetUniformLocation( m_unSceneProgramID, "flCellSpacing" ), m_fScaleSpacing * m_fScale );
+	glUniform2i( glGetUniformLocation( m_unSceneProgramID, "i2VolumeSize" ), m_iSceneVolumeWidth, m_iSceneVolumeHeight );
+	glUseProgram( 0 );
+
+	Vector3 vVolumeOrigin(
+		-( (float)m_iSceneVolumeWidth * m_fScaleSpacing * m_fScale ) / 2.f,
+		-( (float)m_iSceneVolumeHeight * m_fScaleSpacing * m_fScale ) / 2.f,
+		-( (float)m_iSceneVolumeDepth * m_fScaleSpacing * m_fScale ) / 2.f );
+	m_sceneBVH.Build( m_iSceneVolumeWidth, m_iSceneVolumeHeight, m_iSceneVolumeDepth, vVolumeOrigin, m_fScaleSpacing * m_fScale, m_fScale, 64 );
 	
 	glGenVertexArrays( 1, &m_unSceneVAO );
 	glBindVertexArray( m_unSceneVAO );
@@ -1185,9 +1840,19 @@ void CMainApplication::SetupScene()
 	glEnableVertexAttribArray( 1 );
 	glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, stride, (const void *)offset);
 
+	const std::vector< uint32_t > &vecCellOrder = m_sceneBVH.GetCellOrder();
+	glGenBuffers( 1, &m_glSceneCellBuffer );
+	glBindBuffer( GL_ARRAY_BUFFER, m_glSceneCellBuffer );
+	glBufferData( GL_ARRAY_BUFFER, sizeof( uint32_t ) * vecCellOrder.size(), vecCellOrder.empty() ? NULL : &vecCellOrder[0], GL_STATIC_DRAW );
+
+	glEnableVertexAttribArray( 3 );
+	glVertexAttribIPointer( 3, 1, GL_INT, sizeof( uint32_t ), (const void *)0 );
+	glVertexAttribDivisor( 3, 1 );
+
 	glBindVertexArray( 0 );
 	glDisableVertexAttribArray(0);
 	glDisableVertexAttribArray(1);
+	glDisableVertexAttribArray(3);
 
 }
 
@@ -1275,11 +1940,18 @@ void CMainApplication::RenderControllerAxes()
 	if( !m_pHMD->IsInputAvailable() )
 		return;
 
-	std::vector<float> vertdataarray;
+	// two hands, each with three axis lines and a pointer line of two vertices
+	const int k_nMaxVertices = 2 * 4 * 2;
+	const GLsizei k_nFloatsPerVertex = 2 * 3;
 
 	m_uiControllerVertcount = 0;
 	m_iTrackedControllerCount = 0;
 
+	GLintptr unOffset = 0;
+	float *pVertData = (float *)m_streamingBuffer.PAllocate( k_nMaxVertices * k_nFloatsPerVertex * sizeof( float ), &unOffset );
+	if ( !pVertData )
+		return;
+
 	for ( EHand eHand = Left; eHand <= Right; ((int&)eHand)++ )
 	{
 		if ( !m_rHand[eHand].m_bShowController )
@@ -1296,21 +1968,21 @@ void CMainApplication::RenderControllerAxes()
 			point[i] += 0.05f;  // offset in X, Y, Z
 			color[i] = 1.0;  // R, G, B
 			point = mat * point;
-			vertdataarray.push_back( center.x );
-			vertdataarray.push_back( center.y );
-			vertdataarray.push_back( center.z );
+			*pVertData++ = center.x;
+			*pVertData++ = center.y;
+			*pVertData++ = center.z;
 
-			vertdataarray.push_back( color.x );
-			vertdataarray.push_back( color.y );
-			vertdataarray.push_back( color.z );
+			*pVertData++ = color.x;
+			*pVertData++ = color.y;
+			*pVertData++ = color.z;
 		
-			vertdataarray.push_back( point.x );
-			vertdataarray.push_back( point.y );
-			vertdataarray.push_back( point.z );
+			*pVertData++ = point.x;
+			*pVertData++ = point.y;
+			*pVertData++ = point.z;
 		
-			vertdataarray.push_back( color.x );
-			vertdataarray.push_back( color.y );
-			vertdataarray.push_back( color.z );
+			*pVertData++ = color.x;
+			*pVertData++ = color.y;
+			*pVertData++ = color.z;
 		
 			m_uiControllerVertcount += 2;
 		}
@@ -1319,44 +1991,39 @@ void CMainApplication::RenderControllerAxes()
 		Vector4 end = mat * Vector4( 0, 0, -39.f, 1 );
 		Vector3 color( .92f, .92f, .71f );
 
-		vertdataarray.push_back( start.x );vertdataarray.push_back( start.y );vertdataarray.push_back( start.z );
-		vertdataarray.push_back( color.x );vertdataarray.push_back( color.y );vertdataarray.push_back( color.z );
+		*pVertData++ = start.x; *pVertData++ = start.y; *pVertData++ = start.z;
+		*pVertData++ = color.x; *pVertData++ = color.y; *pVertData++ = color.z;
 
-		vertdataarray.push_back( end.x );vertdataarray.push_back( end.y );vertdataarray.push_back( end.z );
-		vertdataarray.push_back( color.x );vertdataarray.push_back( color.y );vertdataarray.push_back( color.z );
+		*pVertData++ = end.x; *pVertData++ = end.y; *pVertData++ = end.z;
+		*pVertData++ = color.x; *pVertData++ = color.y; *pVertData++ = color.z;
 		m_uiControllerVertcount += 2;
 	}
 
+	m_streamingBuffer.Flush();
+
 	// Setup the VAO the first time through.
 	if ( m_unControllerVAO == 0 )
 	{
 		glGenVertexArrays( 1, &m_unControllerVAO );
 		glBindVertexArray( m_unControllerVAO );
-
-		glGenBuffers( 1, &m_glControllerVertBuffer );
-		glBindBuffer( GL_ARRAY_BUFFER, m_glControllerVertBuffer );
-
-		GLuint stride = 2 * 3 * sizeof( float );
-		uintptr_t offset = 0;
-
 		glEnableVertexAttribArray( 0 );
-		glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, (const void *)offset);
-
-		offset += sizeof( Vector3 );
 		glEnableVertexAttribArray( 1 );
-		glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, (const void *)offset);
-
 		glBindVertexArray( 0 );
 	}
 
-	glBindBuffer( GL_ARRAY_BUFFER, m_glControllerVertBuffer );
+	// the data lives in a different region of the streaming buffer every frame, so point the VAO at this frame's copy
+	GLsizei stride = k_nFloatsPerVertex * sizeof( float );
+	uintptr_t offset = (uintptr_t)unOffset;
 
-	// set vertex data if we have some
-	if( vertdataarray.size() > 0 )
-	{
-		//$ TODO: Use glBufferSubData for this...
-		glBufferData( GL_ARRAY_BUFFER, sizeof(float) * vertdataarray.size(), &vertdataarray[0], GL_STREAM_DRAW );
-	}
+	glBindVertexArray( m_unControllerVAO );
+	glBindBuffer( GL_ARRAY_BUFFER, m_streamingBuffer.GetBuffer() );
+
+	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, (const void *)offset);
+
+	offset += sizeof( Vector3 );
+	glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, (const void *)offset);
+
+	glBindVertexArray( 0 );
 }
 
 
@@ -1426,11 +2093,156 @@ bool CMainApplication::SetupStereoRenderTargets()
 
 	CreateFrameBuffer( m_nRenderWidth, m_nRenderHeight, leftEyeDesc );
 	CreateFrameBuffer( m_nRenderWidth, m_nRenderHeight, rightEyeDesc );
+
+	memset( &multiviewDesc, 0, sizeof( multiviewDesc ) );
+	if ( m_bMultiview )
+	{
+		if ( SDL_GL_ExtensionSupported( "GL_OVR_multiview2" ) )
+			g_pglFramebufferTextureMultiviewOVR = (PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC)SDL_GL_GetProcAddress( "glFramebufferTextureMultiviewOVR" );
+
+		m_bMultiview = g_pglFramebufferTextureMultiviewOVR && CreateMultiviewFrameBuffer( m_nRenderWidth, m_nRenderHeight, multiviewDesc );
+		dprintf( "Stereo rendering: %s\n", m_bMultiview ? "single pass multiview" : "one pass per eye" );
+	}
+
+	if ( m_foveation.m_bEnabled )
+		SetupFoveation();
 	
 	return true;
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Creates the layered render target both eyes are drawn into at once
+//-----------------------------------------------------------------------------
+bool CMainApplication::CreateMultiviewFrameBuffer( int nWidth, int nHeight, MultiviewFramebufferDesc &framebufferDesc )
+{
+	glGenFramebuffers( 1, &framebufferDesc.m_nRenderFramebufferId );
+	glBindFramebuffer( GL_FRAMEBUFFER, framebufferDesc.m_nRenderFramebufferId );
+
+	glGenTextures( 1, &framebufferDesc.m_nDepthTextureId );
+	glBindTexture( GL_TEXTURE_2D_MULTISAMPLE_ARRAY, framebufferDesc.m_nDepthTextureId );
+	glTexImage3DMultisample( GL_TEXTURE_2D_MULTISAMPLE_ARRAY, 4, GL_DEPTH_COMPONENT24, nWidth, nHeight, 2, true );
+	g_pglFramebufferTextureMultiviewOVR( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, framebufferDesc.m_nDepthTextureId, 0, 0, 2 );
+
+	glGenTextures( 1, &framebufferDesc.m_nRenderTextureId );
+	glBindTexture( GL_TEXTURE_2D_MULTISAMPLE_ARRAY, framebufferDesc.m_nRenderTextureId );
+	glTexImage3DMultisample( GL_TEXTURE_2D_MULTISAMPLE_ARRAY, 4, GL_RGBA8, nWidth, nHeight, 2, true );
+	g_pglFramebufferTextureMultiviewOVR( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, framebufferDesc.m_nRenderTextureId, 0, 0, 2 );
+
+	bool bComplete = glCheckFramebufferStatus( GL_FRAMEBUFFER ) == GL_FRAMEBUFFER_COMPLETE;
+
+	glGenFramebuffers( 2, framebufferDesc.m_rnLayerFramebufferId );
+	for ( GLint nLayer = 0; nLayer < 2; nLayer++ )
+	{
+		glBindFramebuffer( GL_FRAMEBUFFER, framebufferDesc.m_rnLayerFramebufferId[ nLayer ] );
+		glFramebufferTextureLayer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, framebufferDesc.m_nRenderTextureId, 0, nLayer );
+		bComplete = bComplete && glCheckFramebufferStatus( GL_FRAMEBUFFER ) == GL_FRAMEBUFFER_COMPLETE;
+	}
+
+	glBindTexture( GL_TEXTURE_2D_MULTISAMPLE_ARRAY, 0 );
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+	if ( !bComplete )
+	{
+		glDeleteFramebuffers( 2, framebufferDesc.m_rnLayerFramebufferId );
+		glDeleteFramebuffers( 1, &framebufferDesc.m_nRenderFramebufferId );
+		glDeleteTextures( 1, &framebufferDesc.m_nRenderTextureId );
+		glDeleteTextures( 1, &framebufferDesc.m_nDepthTextureId );
+		memset( &framebufferDesc, 0, sizeof( framebufferDesc ) );
+	}
+
+	return bComplete;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Builds each eye's shading rate image for -foveate from its profile,
+//          centred where the eye's view axis crosses its target unless the
+//          command line placed it. Returns false, rendering at full rate, if
+//          GL_NV_shading_rate_image isn't there.
+//-----------------------------------------------------------------------------
+bool CMainApplication::SetupFoveation()
+{
+	if ( SDL_GL_ExtensionSupported( "GL_NV_shading_rate_image" ) )
+	{
+		g_pglBindShadingRateImageNV = (PFNGLBINDSHADINGRATEIMAGENVPROC)SDL_GL_GetProcAddress( "glBindShadingRateImageNV" );
+		g_pglShadingRateImagePaletteNV = (PFNGLSHADINGRATEIMAGEPALETTENVPROC)SDL_GL_GetProcAddress( "glShadingRateImagePaletteNV" );
+	}
+	if ( !g_pglBindShadingRateImageNV || !g_pglShadingRateImagePaletteNV )
+	{
+		g_pglBindShadingRateImageNV = NULL;
+		dprintf( "Foveation: GL_NV_shading_rate_image is not supported, rendering at full rate\n" );
+		return false;
+	}
+
+	// the texel values index this palette, in EFoveationRate order
+	const GLenum rnRates[ k_eFoveationRate_Count ] =
+	{
+		GL_SHADING_RATE_1_INVOCATION_PER_PIXEL_NV,
+		GL_SHADING_RATE_1_INVOCATION_PER_2X2_PIXELS_NV,
+		GL_SHADING_RATE_1_INVOCATION_PER_4X4_PIXELS_NV,
+	};
+	g_pglShadingRateImagePaletteNV( 0, 0, k_eFoveationRate_Count, rnRates );
+
+	GLint nTexelWidth = 16, nTexelHeight = 16;
+	glGetIntegerv( GL_SHADING_RATE_IMAGE_TEXEL_WIDTH_NV, &nTexelWidth );
+	glGetIntegerv( GL_SHADING_RATE_IMAGE_TEXEL_HEIGHT_NV, &nTexelHeight );
+	GLsizei nTilesX = ( m_nRenderWidth + nTexelWidth - 1 ) / nTexelWidth;
+	GLsizei nTilesY = ( m_nRenderHeight + nTexelHeight - 1 ) / nTexelHeight;
+
+	std::vector< uint8_t > rvecRates[ 2 ];
+	for ( int nEye = 0; nEye < 2; nEye++ )
+	{
+		float flLeft, flRight, flTop, flBottom;
+		m_pHMD->GetProjectionRaw( ( vr::Hmd_Eye )nEye, &flLeft, &flRight, &flTop, &flBottom );
+		Foveation_SetDefaultCenter( &m_foveation, nEye, flLeft, flRight, flTop, flBottom );
+		Foveation_BuildRateImage( m_foveation.m_rProfile[ nEye ], m_nRenderWidth, m_nRenderHeight, nTexelWidth, nTexelHeight, true, &rvecRates[ nEye ] );
+	}
+	std::vector< uint8_t > vecMultiviewRates = rvecRates[ vr::Eye_Left ];
+	Foveation_CombineRateImages( rvecRates[ vr::Eye_Right ], &vecMultiviewRates );
+
+	// the images must be immutable R8UI textures, one texel per tile
+	const std::vector< uint8_t > *rpvecImageRates[ 3 ] = { &rvecRates[ vr::Eye_Left ], &rvecRates[ vr::Eye_Right ], &vecMultiviewRates };
+	GLuint *rpglImage[ 3 ] = { &m_rglShadingRateImage[ vr::Eye_Left ], &m_rglShadingRateImage[ vr::Eye_Right ], &m_glMultiviewShadingRateImage };
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+	for ( int i = 0; i < 3; i++ )
+	{
+		glGenTextures( 1, rpglImage[ i ] );
+		glBindTexture( GL_TEXTURE_2D, *rpglImage[ i ] );
+		glTexStorage2D( GL_TEXTURE_2D, 1, GL_R8UI, nTilesX, nTilesY );
+		glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, nTilesX, nTilesY, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &( *rpvecImageRates[ i ] )[ 0 ] );
+	}
+	glBindTexture( GL_TEXTURE_2D, 0 );
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+
+	dprintf( "Foveation: %dx%d pixel tiles, pixel shading left %.0f%% right %.0f%% multiview %.0f%% of full rate\n", nTexelWidth, nTexelHeight,
+		100.0f * Foveation_GetInvocationFraction( rvecRates[ vr::Eye_Left ] ), 100.0f * Foveation_GetInvocationFraction( rvecRates[ vr::Eye_Right ] ),
+		100.0f * Foveation_GetInvocationFraction( vecMultiviewRates ) );
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Shades the following draws at the rates of the given image, or at
+//          full rate for 0
+//-----------------------------------------------------------------------------
+void CMainApplication::SetShadingRateImage( GLuint unShadingRateImage )
+{
+	if ( !g_pglBindShadingRateImageNV )
+		return;
+
+	if ( unShadingRateImage )
+	{
+		g_pglBindShadingRateImageNV( unShadingRateImage );
+		glEnable( GL_SHADING_RATE_IMAGE_NV );
+	}
+	else
+	{
+		glDisable( GL_SHADING_RATE_IMAGE_NV );
+	}
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
@@ -1491,10 +2303,52 @@ void CMainApplication::RenderStereoTargets()
 	glClearColor( 0.0f, 0.0f, 0.0f, 1.0f );
 	glEnable( GL_MULTISAMPLE );
 
+	if ( m_bMultiview )
+	{
+		// Both eyes in one pass, then resolve each layer into that eye's texture
+		Matrix4 rmatViewProjection[ 2 ] = { GetCurrentViewProjectionMatrix( vr::Eye_Left ), GetCurrentViewProjectionMatrix( vr::Eye_Right ) };
+
+		glBindFramebuffer( GL_FRAMEBUFFER, multiviewDesc.m_nRenderFramebufferId );
+		glViewport(0, 0, m_nRenderWidth, m_nRenderHeight );
+		SetShadingRateImage( m_glMultiviewShadingRateImage );
+		float *pflViewBlock = RenderScene( rmatViewProjection, 2 );
+		SetShadingRateImage( 0 );
+		m_rpflViewMatrix[ vr::Eye_Left ] = pflViewBlock;
+		m_rpflViewMatrix[ vr::Eye_Right ] = pflViewBlock ? pflViewBlock + 16 : NULL;
+		glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+		// the shared pass is reported as the left eye and the resolves as the right
+		WriteGpuTimestamp( k_eGpuTimestamp_LeftEye );
+
+		glDisable( GL_MULTISAMPLE );
+
+		const GLuint rnResolveFramebufferId[ 2 ] = { leftEyeDesc.m_nResolveFramebufferId, rightEyeDesc.m_nResolveFramebufferId };
+		for ( int nEye = 0; nEye < 2; nEye++ )
+		{
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, multiviewDesc.m_rnLayerFramebufferId[ nEye ] );
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, rnResolveFramebufferId[ nEye ] );
+
+			glBlitFramebuffer( 0, 0, m_nRenderWidth, m_nRenderHeight, 0, 0, m_nRenderWidth, m_nRenderHeight, 
+				GL_COLOR_BUFFER_BIT,
+				GL_LINEAR );
+		}
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0 );
+
+		WriteGpuTimestamp( k_eGpuTimestamp_RightEye );
+		return;
+	}
+
+	Matrix4 matViewProjection;
+
 	// Left Eye
 	glBindFramebuffer( GL_FRAMEBUFFER, leftEyeDesc.m_nRenderFramebufferId );
  	glViewport(0, 0, m_nRenderWidth, m_nRenderHeight );
- 	RenderScene( vr::Eye_Left );
+ 	matViewProjection = GetCurrentViewProjectionMatrix( vr::Eye_Left );
+	SetShadingRateImage( m_rglShadingRateImage[ vr::Eye_Left ] );
+ 	m_rpflViewMatrix[ vr::Eye_Left ] = RenderScene( &matViewProjection, 1 );
+	SetShadingRateImage( 0 );
  	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
 	
 	glDisable( GL_MULTISAMPLE );
@@ -1509,12 +2363,17 @@ void CMainApplication::RenderStereoTargets()
  	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0 );	
 
+	WriteGpuTimestamp( k_eGpuTimestamp_LeftEye );
+
 	glEnable( GL_MULTISAMPLE );
 
 	// Right Eye
 	glBindFramebuffer( GL_FRAMEBUFFER, rightEyeDesc.m_nRenderFramebufferId );
  	glViewport(0, 0, m_nRenderWidth, m_nRenderHeight );
- 	RenderScene( vr::Eye_Right );
+ 	matViewProjection = GetCurrentViewProjectionMatrix( vr::Eye_Right );
+	SetShadingRateImage( m_rglShadingRateImage[ vr::Eye_Right ] );
+ 	m_rpflViewMatrix[ vr::Eye_Right ] = RenderScene( &matViewProjection, 1 );
+	SetShadingRateImage( 0 );
  	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
  	
 	glDisable( GL_MULTISAMPLE );
@@ -1528,24 +2387,62 @@ void CMainApplication::RenderStereoTargets()
 
  	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0 );
+
+	WriteGpuTimestamp( k_eGpuTimestamp_RightEye );
 }
 
 
 //-----------------------------------------------------------------------------
-// Purpose: Renders a scene with respect to nEye.
+// Purpose: Renders the scene with one view projection matrix per view, a
+//          single eye or both eyes at once into a multiview target. Returns
+//          the view block the matrices were written to while the streaming
+//          buffer is mapped, so they can still be rewritten, else NULL.
 //-----------------------------------------------------------------------------
-void CMainApplication::RenderScene( vr::Hmd_Eye nEye )
+float *CMainApplication::RenderScene( const Matrix4 *pmatViewProjection, uint32_t unViewCount )
 {
+	// the view block: the matrices packed as the std140 mat4 array the shaders take
+	GLsizeiptr unViewBlockSize = unViewCount * 16 * sizeof( float );
+	GLintptr unViewBlockOffset = 0;
+	float *pflViewBlock = (float *)m_streamingBuffer.PAllocate( unViewBlockSize, &unViewBlockOffset, m_nUniformBufferAlignment );
+	if ( !pflViewBlock )
+		return NULL;
+	for ( uint32_t unView = 0; unView < unViewCount; unView++ )
+		memcpy( pflViewBlock + 16 * unView, pmatViewProjection[ unView ].get(), 16 * sizeof( float ) );
+	m_streamingBuffer.Flush();
+	glBindBufferRange( GL_UNIFORM_BUFFER, k_unViewBlockBinding, m_streamingBuffer.GetBuffer(), unViewBlockOffset, unViewBlockSize );
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glEnable(GL_DEPTH_TEST);
 
+	// a cell or model is drawn if any of the views can see it. -latelatch turns the
+	// view a little after this; leaves straddling the frustum are drawn whole,
+	// which covers that at the edges
+	Frustum_t rFrusta[ 2 ];
+	for ( uint32_t unView = 0; unView < unViewCount; unView++ )
+		Frustum_FromViewProjection( pmatViewProjection[ unView ], &rFrusta[ unView ] );
+
 	if( m_bShowCubes )
 	{
 		glUseProgram( m_unSceneProgramID );
-		glUniformMatrix4fv( m_nSceneMatrixLocation, 1, GL_FALSE, GetCurrentViewProjectionMatrix( nEye ).get() );
 		glBindVertexArray( m_unSceneVAO );
 		glBindTexture( GL_TEXTURE_2D, m_iTexture );
-		glDrawArrays( GL_TRIANGLES, 0, m_uiVertcount );
+		if ( m_bCulling )
+		{
+			// one instanced draw per run of visible cells, the cell attribute starting at the run
+			m_sceneBVH.Cull( rFrusta, unViewCount, &m_vecSceneRanges );
+			glBindBuffer( GL_ARRAY_BUFFER, m_glSceneCellBuffer );
+			for ( size_t i = 0; i < m_vecSceneRanges.size(); i++ )
+			{
+				glVertexAttribIPointer( 3, 1, GL_INT, sizeof( uint32_t ), (const void *)( sizeof( uint32_t ) * m_vecSceneRanges[ i ].m_unFirst ) );
+				glDrawArraysInstanced( GL_TRIANGLES, 0, m_uiVertcount, m_vecSceneRanges[ i ].m_unCount );
+			}
+			glVertexAttribIPointer( 3, 1, GL_INT, sizeof( uint32_t ), (const void *)0 );
+			glBindBuffer( GL_ARRAY_BUFFER, 0 );
+		}
+		else
+		{
+			glDrawArraysInstanced( GL_TRIANGLES, 0, m_uiVertcount, m_uiSceneInstanceCount );
+		}
 		glBindVertexArray( 0 );
 	}
 
@@ -1555,7 +2452,6 @@ void CMainApplication::RenderScene( vr::Hmd_Eye nEye )
 	{
 		// draw the controller axis lines
 		glUseProgram( m_unControllerTransformProgramID );
-		glUniformMatrix4fv( m_nControllerMatrixLocation, 1, GL_FALSE, GetCurrentViewProjectionMatrix( nEye ).get() );
 		glBindVertexArray( m_unControllerVAO );
 		glDrawArrays( GL_LINES, 0, m_uiControllerVertcount );
 		glBindVertexArray( 0 );
@@ -1564,19 +2460,48 @@ void CMainApplication::RenderScene( vr::Hmd_Eye nEye )
 	// ----- Render Model rendering -----
 	glUseProgram( m_unRenderModelProgramID );
 
+	// visible hands sorted by model, so a model both hands use binds its buffers and texture once
+	ControllerInfo_t *rpVisibleHands[ 2 ];
+	uint32_t unVisibleHands = 0;
 	for ( EHand eHand = Left; eHand <= Right; ((int&)eHand)++ )
 	{
-		if ( !m_rHand[eHand].m_bShowController || !m_rHand[eHand].m_pRenderModel )
+		ControllerInfo_t &hand = m_rHand[eHand];
+		if ( !hand.m_bShowController || !hand.m_pRenderModel )
 			continue;
 
-		const Matrix4 & matDeviceToTracking = m_rHand[eHand].m_rmat4Pose;
-		Matrix4 matMVP = GetCurrentViewProjectionMatrix( nEye ) * matDeviceToTracking;
-		glUniformMatrix4fv( m_nRenderModelMatrixLocation, 1, GL_FALSE, matMVP.get() );
+		if ( m_bCulling )
+		{
+			const Vector3 &vCenter = hand.m_pRenderModel->GetBoundsCenter();
+			Vector4 vWorldCenter = hand.m_rmat4Pose * Vector4( vCenter.x, vCenter.y, vCenter.z, 1.0f );
+			if ( Frustum_BSphereOutsideAll( rFrusta, unViewCount, Vector3( vWorldCenter.x, vWorldCenter.y, vWorldCenter.z ), hand.m_pRenderModel->GetBoundsRadius() ) )
+				continue;
+		}
+
+		uint32_t unInsert = unVisibleHands++;
+		for ( ; unInsert > 0 && rpVisibleHands[ unInsert - 1 ]->m_pRenderModel > hand.m_pRenderModel; unInsert-- )
+			rpVisibleHands[ unInsert ] = rpVisibleHands[ unInsert - 1 ];
+		rpVisibleHands[ unInsert ] = &hand;
+	}
+
+	CGLRenderModel *pBoundModel = NULL;
+	for ( uint32_t i = 0; i < unVisibleHands; i++ )
+	{
+		if ( rpVisibleHands[ i ]->m_pRenderModel != pBoundModel )
+		{
+			pBoundModel = rpVisibleHands[ i ]->m_pRenderModel;
+			pBoundModel->Bind();
+		}
+
+		const Matrix4 & matDeviceToTracking = rpVisibleHands[ i ]->m_rmat4Pose;
+		glUniformMatrix4fv( m_nRenderModelMatrixLocation, 1, GL_FALSE, matDeviceToTracking.get() );
 
-		m_rHand[eHand].m_pRenderModel->Draw();
+		pBoundModel->Draw();
 	}
+	glBindVertexArray( 0 );
 
 	glUseProgram( 0 );
+
+	return m_streamingBuffer.BPersistent() ? pflViewBlock : NULL;
 }
 
 
@@ -1671,6 +2596,28 @@ Matrix4 CMainApplication::GetCurrentViewProjectionMatrix( vr::Hmd_Eye nEye )
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Caches a character representing the class of a tracked device.
+//          Called at startup and when a device is activated so the per frame
+//          pose update never has to query the runtime.
+//-----------------------------------------------------------------------------
+void CMainApplication::UpdateTrackedDeviceClass( vr::TrackedDeviceIndex_t unTrackedDeviceIndex )
+{
+	if ( !m_pHMD || unTrackedDeviceIndex >= vr::k_unMaxTrackedDeviceCount )
+		return;
+
+	switch ( m_pHMD->GetTrackedDeviceClass( unTrackedDeviceIndex ) )
+	{
+	case vr::TrackedDeviceClass_Controller:        m_rDevClassChar[unTrackedDeviceIndex] = 'C'; break;
+	case vr::TrackedDeviceClass_HMD:               m_rDevClassChar[unTrackedDeviceIndex] = 'H'; break;
+	case vr::TrackedDeviceClass_Invalid:           m_rDevClassChar[unTrackedDeviceIndex] = 'I'; break;
+	case vr::TrackedDeviceClass_GenericTracker:    m_rDevClassChar[unTrackedDeviceIndex] = 'G'; break;
+	case vr::TrackedDeviceClass_TrackingReference: m_rDevClassChar[unTrackedDeviceIndex] = 'T'; break;
+	default:                                       m_rDevClassChar[unTrackedDeviceIndex] = '?'; break;
+	}
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
@@ -1680,30 +2627,18 @@ void CMainApplication::UpdateHMDMatrixPose()
 		return;
 
 	vr::VRCompositor()->WaitGetPoses(m_rTrackedDevicePose, vr::k_unMaxTrackedDeviceCount, NULL, 0 );
+	m_ulPosesCounter = SDL_GetPerformanceCounter();
+
+	// converts every pose in one pass, the matrices of invalid poses are never read
+	ConvertSteamVRMatrixToMatrix4( m_rTrackedDevicePose, m_rmat4DevicePose, vr::k_unMaxTrackedDeviceCount );
 
 	m_iValidPoseCount = 0;
-	m_strPoseClasses = "";
 	for ( int nDevice = 0; nDevice < vr::k_unMaxTrackedDeviceCount; ++nDevice )
 	{
 		if ( m_rTrackedDevicePose[nDevice].bPoseIsValid )
-		{
-			m_iValidPoseCount++;
-			m_rmat4DevicePose[nDevice] = ConvertSteamVRMatrixToMatrix4( m_rTrackedDevicePose[nDevice].mDeviceToAbsoluteTracking );
-			if (m_rDevClassChar[nDevice]==0)
-			{
-				switch (m_pHMD->GetTrackedDeviceClass(nDevice))
-				{
-				case vr::TrackedDeviceClass_Controller:        m_rDevClassChar[nDevice] = 'C'; break;
-				case vr::TrackedDeviceClass_HMD:               m_rDevClassChar[nDevice] = 'H'; break;
-				case vr::TrackedDeviceClass_Invalid:           m_rDevClassChar[nDevice] = 'I'; break;
-				case vr::TrackedDeviceClass_GenericTracker:    m_rDevClassChar[nDevice] = 'G'; break;
-				case vr::TrackedDeviceClass_TrackingReference: m_rDevClassChar[nDevice] = 'T'; break;
-				default:                                       m_rDevClassChar[nDevice] = '?'; break;
-				}
-			}
-			m_strPoseClasses += m_rDevClassChar[nDevice];
-		}
+			m_rchPoseClasses[m_iValidPoseCount++] = m_rDevClassChar[nDevice];
 	}
+	m_rchPoseClasses[m_iValidPoseCount] = '\0';
 
 	if ( m_rTrackedDevicePose[vr::k_unTrackedDeviceIndex_Hmd].bPoseIsValid )
 	{
@@ -1714,72 +2649,143 @@ void CMainApplication::UpdateHMDMatrixPose()
 
 
 //-----------------------------------------------------------------------------
-// Purpose: Finds a render model we've already loaded or loads a new one
+// Purpose: -latelatch. The draws of the frame are issued with the HMD pose
+//          WaitGetPoses predicted at the top of the frame; this predicts it
+//          again for the same photons and rewrites only the view projection
+//          matrices in the frame's view blocks, just before Submit. The
+//          blocks sit in the coherent persistent mapping of the streaming
+//          buffer, so the GPU reads the new matrices if it hasn't reached
+//          the draws yet. GL can't promise that; the timing records whether
+//          the frame had already started on the GPU, and how far the head
+//          moved in between.
+//-----------------------------------------------------------------------------
+void CMainApplication::LateLatchViews()
+{
+	LateLatch_t &latch = m_rLateLatch[ m_unTimingFrame % k_unTimingFrameCount ];
+	memset( &latch, 0, sizeof( latch ) );
+	if ( !m_rpflViewMatrix[ vr::Eye_Left ] || !m_rpflViewMatrix[ vr::Eye_Right ] )
+		return;
+
+	// the frame is shown at the vsync after this one
+	float flSecondsSinceLastVsync = 0.0f;
+	m_pHMD->GetTimeSinceLastVsync( &flSecondsSinceLastVsync, NULL );
+	float flSecondsToPhotons = 1.0f / m_flDisplayFrequency - flSecondsSinceLastVsync + m_flSecondsFromVsyncToPhotons;
+
+	vr::TrackedDevicePose_t pose;
+	m_pHMD->GetDeviceToAbsoluteTrackingPose( vr::VRCompositor()->GetTrackingSpace(), flSecondsToPhotons, &pose, 1 );
+	const vr::TrackedDevicePose_t &rendered = m_rTrackedDevicePose[ vr::k_unTrackedDeviceIndex_Hmd ];
+	if ( !pose.bPoseIsValid || !rendered.bPoseIsValid )
+		return;
+
+	m_mat4HMDPose = ConvertSteamVRMatrixToMatrix4( pose.mDeviceToAbsoluteTracking );
+	m_mat4HMDPose.invert();
+	memcpy( m_rpflViewMatrix[ vr::Eye_Left ], GetCurrentViewProjectionMatrix( vr::Eye_Left ).get(), 16 * sizeof( float ) );
+	memcpy( m_rpflViewMatrix[ vr::Eye_Right ], GetCurrentViewProjectionMatrix( vr::Eye_Right ).get(), 16 * sizeof( float ) );
+	glGetInteger64v( GL_TIMESTAMP, &latch.m_nGpuTime );
+
+	// rotation between the two poses from the trace of R1^T * R2, and the distance between their origins
+	const vr::HmdMatrix34_t &a = rendered.mDeviceToAbsoluteTracking;
+	const vr::HmdMatrix34_t &b = pose.mDeviceToAbsoluteTracking;
+	float flTrace = 0.0f, flDistanceSquared = 0.0f;
+	for ( int i = 0; i < 3; i++ )
+	{
+		for ( int j = 0; j < 3; j++ )
+			flTrace += a.m[ i ][ j ] * b.m[ i ][ j ];
+		flDistanceSquared += ( b.m[ i ][ 3 ] - a.m[ i ][ 3 ] ) * ( b.m[ i ][ 3 ] - a.m[ i ][ 3 ] );
+	}
+	float flCos = ( flTrace - 1.0f ) * 0.5f;
+	latch.m_bLatched = true;
+	latch.m_flMs = ( float )( ( SDL_GetPerformanceCounter() - m_ulPosesCounter ) * 1000.0 / SDL_GetPerformanceFrequency() );
+	latch.m_flDegrees = acosf( flCos < -1.0f ? -1.0f : ( flCos > 1.0f ? 1.0f : flCos ) ) * 57.29578f;
+	latch.m_flMillimeters = sqrtf( flDistanceSquared ) * 1000.0f;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds a render model we've already loaded or starts loading a new
+//          one. Returns NULL until UpdateRenderModelLoads has created it.
 //-----------------------------------------------------------------------------
 CGLRenderModel *CMainApplication::FindOrLoadRenderModel( const char *pchRenderModelName )
 {
-	CGLRenderModel *pRenderModel = NULL;
-	for( std::vector< CGLRenderModel * >::iterator i = m_vecRenderModels.begin(); i != m_vecRenderModels.end(); i++ )
+	std::unordered_map< std::string, CGLRenderModel * >::iterator iModel = m_mapRenderModels.find( pchRenderModelName );
+	if( iModel != m_mapRenderModels.end() )
+		return iModel->second;
+
+	for( std::vector< PendingRenderModel_t >::iterator i = m_vecPendingRenderModels.begin(); i != m_vecPendingRenderModels.end(); i++ )
 	{
-		if( !stricmp( (*i)->GetName().c_str(), pchRenderModelName ) )
-		{
-			pRenderModel = *i;
-			break;
-		}
+		if( i->m_sName == pchRenderModelName )
+			return NULL;
 	}
 
-	// load the model if we didn't find one
-	if( !pRenderModel )
+	PendingRenderModel_t pending;
+	pending.m_sName = pchRenderModelName;
+	m_vecPendingRenderModels.push_back( pending );
+	return NULL;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Polls the runtime once per frame for the render models that are
+//          still loading and creates the GL models for the ones that are done,
+//          so a device appearing never stalls the frame
+//-----------------------------------------------------------------------------
+void CMainApplication::UpdateRenderModelLoads()
+{
+	for( size_t nPending = 0; nPending < m_vecPendingRenderModels.size(); )
 	{
-		vr::RenderModel_t *pModel;
+		PendingRenderModel_t &pending = m_vecPendingRenderModels[ nPending ];
+		const char *pchRenderModelName = pending.m_sName.c_str();
+
 		vr::EVRRenderModelError error;
-		while ( 1 )
+		if( !pending.m_pModel )
 		{
+			vr::RenderModel_t *pModel;
 			error = vr::VRRenderModels()->LoadRenderModel_Async( pchRenderModelName, &pModel );
-			if ( error != vr::VRRenderModelError_Loading )
-				break;
-
-			ThreadSleep( 1 );
-		}
+			if ( error == vr::VRRenderModelError_Loading )
+			{
+				nPending++;
+				continue;
+			}
 
-		if ( error != vr::VRRenderModelError_None )
-		{
-			dprintf( "Unable to load render model %s - %s\n", pchRenderModelName, vr::VRRenderModels()->GetRenderModelErrorNameFromEnum( error ) );
-			return NULL; // move on to the next tracked device
+			if ( error != vr::VRRenderModelError_None )
+				dprintf( "Unable to load render model %s - %s\n", pchRenderModelName, vr::VRRenderModels()->GetRenderModelErrorNameFromEnum( error ) );
+			else
+				pending.m_pModel = pModel;
 		}
 
-		vr::RenderModel_TextureMap_t *pTexture;
-		while ( 1 )
+		CGLRenderModel *pRenderModel = NULL;
+		if( pending.m_pModel )
 		{
-			error = vr::VRRenderModels()->LoadTexture_Async( pModel->diffuseTextureId, &pTexture );
-			if ( error != vr::VRRenderModelError_Loading )
-				break;
-
-			ThreadSleep( 1 );
-		}
+			vr::RenderModel_TextureMap_t *pTexture;
+			error = vr::VRRenderModels()->LoadTexture_Async( pending.m_pModel->diffuseTextureId, &pTexture );
+			if ( error == vr::VRRenderModelError_Loading )
+			{
+				nPending++;
+				continue;
+			}
 
-		if ( error != vr::VRRenderModelError_None )
-		{
-			dprintf( "Unable to load render texture id:%d for render model %s\n", pModel->diffuseTextureId, pchRenderModelName );
-			vr::VRRenderModels()->FreeRenderModel( pModel );
-			return NULL; // move on to the next tracked device
+			if ( error != vr::VRRenderModelError_None )
+			{
+				dprintf( "Unable to load render texture id:%d for render model %s\n", pending.m_pModel->diffuseTextureId, pchRenderModelName );
+			}
+			else
+			{
+				pRenderModel = new CGLRenderModel( pchRenderModelName );
+				if ( !pRenderModel->BInit( *pending.m_pModel, *pTexture ) )
+				{
+					dprintf( "Unable to create GL model from render model %s\n", pchRenderModelName );
+					delete pRenderModel;
+					pRenderModel = NULL;
+				}
+				vr::VRRenderModels()->FreeTexture( pTexture );
+			}
+			vr::VRRenderModels()->FreeRenderModel( pending.m_pModel );
 		}
 
-		pRenderModel = new CGLRenderModel( pchRenderModelName );
-		if ( !pRenderModel->BInit( *pModel, *pTexture ) )
-		{
-			dprintf( "Unable to create GL model from render model %s\n", pchRenderModelName );
-			delete pRenderModel;
-			pRenderModel = NULL;
-		}
-		else
-		{
-			m_vecRenderModels.push_back( pRenderModel );
-		}
-		vr::VRRenderModels()->FreeRenderModel( pModel );
-		vr::VRRenderModels()->FreeTexture( pTexture );
+		// failures are remembered too so they are not retried every frame
+		m_mapRenderModels[ pending.m_sName ] = pRenderModel;
+		m_vecPendingRenderModels.erase( m_vecPendingRenderModels.begin() + nPending );
 	}
-	return pRenderModel;
 }
 
 
@@ -1798,6 +2804,15 @@ Matrix4 CMainApplication::ConvertSteamVRMatrixToMatrix4( const vr::HmdMatrix34_t
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Converts the device to tracking matrices of an array of poses
+//-----------------------------------------------------------------------------
+void CMainApplication::ConvertSteamVRMatrixToMatrix4( const vr::TrackedDevicePose_t *pPoses, Matrix4 *pMatrices, uint32_t unCount )
+{
+	convertRowMajor3x4( pMatrices, &pPoses[0].mDeviceToAbsoluteTracking.m[0][0], sizeof( vr::TrackedDevicePose_t ), (int)unCount );
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Create/destroy GL Render Models
 //-----------------------------------------------------------------------------
@@ -1808,6 +2823,7 @@ CGLRenderModel::CGLRenderModel( const std::string & sRenderModelName )
 	m_glVertArray = 0;
 	m_glVertBuffer = 0;
 	m_glTexture = 0;
+	m_flBoundsRadius = 0.0f;
 }
 
 
@@ -1869,6 +2885,15 @@ bool CGLRenderModel::BInit( const vr::RenderModel_t & vrModel, const vr::RenderM
 
 	m_unVertexCount = vrModel.unTriangleCount * 3;
 
+	// bounding sphere around the center of the vertices' box, the positions gathered into
+	// separate x, y and z arrays so both passes run four vertices at a time
+	Vector3Batch vertexPositions;
+	vertexPositions.load( vrModel.rVertexData[ 0 ].vPosition.v, sizeof( vr::RenderModel_Vertex_t ), vrModel.unVertexCount );
+	Vector3 vMins, vMaxs;
+	vertexPositions.bounds( &vMins, &vMaxs );
+	m_vBoundsCenter = ( vMins + vMaxs ) * 0.5f;
+	m_flBoundsRadius = vertexPositions.maxDistance( m_vBoundsCenter );
+
 	return true;
 }
 
@@ -1891,18 +2916,173 @@ void CGLRenderModel::Cleanup()
 
 
 //-----------------------------------------------------------------------------
-// Purpose: Draws the render model
+// Purpose: Binds the render model's vertex array and texture for Draw
 //-----------------------------------------------------------------------------
-void CGLRenderModel::Draw()
+void CGLRenderModel::Bind()
 {
 	glBindVertexArray( m_glVertArray );
 
 	glActiveTexture( GL_TEXTURE0 );
 	glBindTexture( GL_TEXTURE_2D, m_glTexture );
+}
 
+
+//-----------------------------------------------------------------------------
+// Purpose: Draws the render model, which must be bound
+//-----------------------------------------------------------------------------
+void CGLRenderModel::Draw()
+{
 	glDrawElements( GL_TRIANGLES, m_unVertexCount, GL_UNSIGNED_SHORT, 0 );
+}
 
-	glBindVertexArray( 0 );
+
+//-----------------------------------------------------------------------------
+// Purpose: Create/destroy the streaming vertex buffer
+//-----------------------------------------------------------------------------
+CGLStreamingBuffer::CGLStreamingBuffer()
+{
+	m_glBuffer = 0;
+	m_unRegionSize = 0;
+	m_unRegionUsed = 0;
+	m_unRegionFlushed = 0;
+	m_nRegion = 0;
+	m_pMapped = NULL;
+	memset( m_rFence, 0, sizeof( m_rFence ) );
+}
+
+
+CGLStreamingBuffer::~CGLStreamingBuffer()
+{
+	Cleanup();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Allocates room for k_nRegionCount frames of unRegionSize bytes each
+//-----------------------------------------------------------------------------
+bool CGLStreamingBuffer::BInit( GLsizeiptr unRegionSize )
+{
+	// keep every region start aligned for any vertex format
+	m_unRegionSize = ( unRegionSize + 255 ) & ~(GLsizeiptr)255;
+	GLsizeiptr unBufferSize = m_unRegionSize * k_nRegionCount;
+
+	glGenBuffers( 1, &m_glBuffer );
+	glBindBuffer( GL_ARRAY_BUFFER, m_glBuffer );
+
+	if ( GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage )
+	{
+		const GLbitfield unFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage( GL_ARRAY_BUFFER, unBufferSize, NULL, unFlags );
+		m_pMapped = (uint8_t *)glMapBufferRange( GL_ARRAY_BUFFER, 0, unBufferSize, unFlags );
+	}
+
+	if ( !m_pMapped )
+	{
+		// no persistent mapping, allocate the storage once and upload each region in place
+		glBufferData( GL_ARRAY_BUFFER, unBufferSize, NULL, GL_STREAM_DRAW );
+		m_vecStaging.resize( m_unRegionSize );
+	}
+
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	return m_glBuffer != 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Frees the GL resources for the streaming buffer
+//-----------------------------------------------------------------------------
+void CGLStreamingBuffer::Cleanup()
+{
+	for ( int i = 0; i < k_nRegionCount; i++ )
+	{
+		if ( m_rFence[i] )
+		{
+			glDeleteSync( m_rFence[i] );
+			m_rFence[i] = 0;
+		}
+	}
+
+	if ( m_glBuffer )
+	{
+		if ( m_pMapped )
+		{
+			glBindBuffer( GL_ARRAY_BUFFER, m_glBuffer );
+			glUnmapBuffer( GL_ARRAY_BUFFER );
+			glBindBuffer( GL_ARRAY_BUFFER, 0 );
+			m_pMapped = NULL;
+		}
+		glDeleteBuffers( 1, &m_glBuffer );
+		m_glBuffer = 0;
+	}
+	m_vecStaging.clear();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns space for unSize bytes in the current frame's region and
+//          its byte offset in the buffer, a multiple of unAlignment, or NULL
+//          if the region is full. The data must be written before the next
+//          Flush().
+//-----------------------------------------------------------------------------
+void *CGLStreamingBuffer::PAllocate( GLsizeiptr unSize, GLintptr *pOffset, GLsizeiptr unAlignment )
+{
+	GLsizeiptr unRegionStart = m_nRegion * m_unRegionSize;
+	GLsizeiptr unStart = ( unRegionStart + m_unRegionUsed + unAlignment - 1 ) / unAlignment * unAlignment - unRegionStart;
+	if ( !m_glBuffer || unStart + unSize > m_unRegionSize )
+		return NULL;
+
+	m_unRegionUsed = unStart + unSize;
+	*pOffset = m_nRegion * m_unRegionSize + unStart;
+
+	if ( m_pMapped )
+		return m_pMapped + *pOffset;
+	return &m_vecStaging[ unStart ];
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Makes the data allocated since the last flush visible to the GPU.
+//          A coherent persistent mapping needs nothing more.
+//-----------------------------------------------------------------------------
+void CGLStreamingBuffer::Flush()
+{
+	if ( !m_pMapped && m_unRegionUsed > m_unRegionFlushed )
+	{
+		glBindBuffer( GL_ARRAY_BUFFER, m_glBuffer );
+		glBufferSubData( GL_ARRAY_BUFFER, m_nRegion * m_unRegionSize + m_unRegionFlushed, m_unRegionUsed - m_unRegionFlushed, &m_vecStaging[ m_unRegionFlushed ] );
+		glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	}
+	m_unRegionFlushed = m_unRegionUsed;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Called once the frame's draws have been issued. Fences the region
+//          they read and moves on to the next one, waiting for the GPU only if
+//          it is still reading that region from k_nRegionCount frames ago.
+//-----------------------------------------------------------------------------
+void CGLStreamingBuffer::EndFrame()
+{
+	if ( !m_glBuffer )
+		return;
+
+	if ( m_pMapped )
+		m_rFence[ m_nRegion ] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+
+	m_nRegion = ( m_nRegion + 1 ) % k_nRegionCount;
+	m_unRegionUsed = 0;
+	m_unRegionFlushed = 0;
+
+	if ( m_rFence[ m_nRegion ] )
+	{
+		GLenum eResult = glClientWaitSync( m_rFence[ m_nRegion ], GL_SYNC_FLUSH_COMMANDS_BIT, 0 );
+		while ( eResult == GL_TIMEOUT_EXPIRED )
+			eResult = glClientWaitSync( m_rFence[ m_nRegion ], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 );
+
+		glDeleteSync( m_rFence[ m_nRegion ] );
+		m_rFence[ m_nRegion ] = 0;
+	}
 }
 
 
@@ -1911,6 +3091,9 @@ void CGLRenderModel::Draw()
 //-----------------------------------------------------------------------------
 int main(int argc, char *argv[])
 {
+	// find and map vrclient while the arguments are parsed and SDL starts up
+	vr::VR_PrefetchRuntime();
+
 	CMainApplication *pMainApplication = new CMainApplication( argc, argv );
 
 	if (!pMainApplication->BInit())
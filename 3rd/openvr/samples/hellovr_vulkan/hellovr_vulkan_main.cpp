@@ -10,8 +10,11 @@
 #include <SDL.h>
 #include <SDL_syswm.h>
 #include <stdio.h>
+#include <math.h>
+#include <float.h>
 #include <string>
 #include <cstdlib>
+#include <algorithm>
 #include <inttypes.h>
 #include <openvr.h>
 #include <deque>
@@ -19,6 +22,9 @@
 #include "shared/lodepng.h"
 #include "shared/Matrices.h"
 #include "shared/pathtools.h"
+#include "shared/scenecull.h"
+#include "shared/VectorBatch.h"
+#include "shared/foveation.h"
 
 #if defined(POSIX)
 #include "unistd.h"
@@ -28,6 +34,11 @@
 #define _countof(x) (sizeof(x)/sizeof((x)[0]))
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HELLOVR_SSE2
+#include <emmintrin.h>
+#endif
+
 void ThreadSleep( unsigned long nMilliseconds )
 {
 #if defined(_WIN32)
@@ -37,6 +48,114 @@ void ThreadSleep( unsigned long nMilliseconds )
 #endif
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: A range of device memory handed out by CVulkanMemoryAllocator
+//-----------------------------------------------------------------------------
+struct VulkanAllocation_t
+{
+	VkDeviceMemory m_pMemory;
+	VkDeviceSize m_nOffset;
+	VkDeviceSize m_nSize;
+	void *m_pMappedData;                                     // persistent mapping of the range, null unless host visible
+	uint32_t m_nBlock;                                       // owning block in the allocator
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Sub-allocates buffers and images out of large VkDeviceMemory blocks
+//          so that loading resources does not cost a vkAllocateMemory each.
+//          Blocks are kept per memory type, and linear (buffer) and optimal
+//          (image) resources never share a block so bufferImageGranularity
+//          can be ignored. Host visible blocks stay mapped for their lifetime.
+//-----------------------------------------------------------------------------
+class CVulkanMemoryAllocator
+{
+public:
+	CVulkanMemoryAllocator();
+
+	void Init( VkDevice pDevice, const VkPhysicalDeviceMemoryProperties &memoryProperties, const VkPhysicalDeviceLimits &limits );
+	void Shutdown();
+
+	bool BAllocate( const VkMemoryRequirements &memoryRequirements, VkMemoryPropertyFlags nMemoryProperties, bool bLinear, VulkanAllocation_t *pAllocationOut );
+	bool BAllocateAndBindBuffer( VkBuffer pBuffer, VkMemoryPropertyFlags nMemoryProperties, VulkanAllocation_t *pAllocationOut );
+	bool BAllocateAndBindImage( VkImage pImage, VkMemoryPropertyFlags nMemoryProperties, VulkanAllocation_t *pAllocationOut );
+	void Free( VulkanAllocation_t *pAllocation );
+	void FlushMappedAllocation( const VulkanAllocation_t &allocation );
+
+private:
+	struct FreeRange_t
+	{
+		VkDeviceSize m_nOffset;
+		VkDeviceSize m_nSize;
+	};
+
+	struct MemoryBlock_t
+	{
+		VkDeviceMemory m_pMemory;
+		VkDeviceSize m_nSize;
+		uint32_t m_nMemoryTypeIndex;
+		bool m_bLinear;
+		bool m_bDedicated;                                   // sized for one large allocation, released when it is freed
+		uint8_t *m_pMappedData;
+		std::vector< FreeRange_t > m_freeRanges;             // sorted by offset, neighbours always merged
+	};
+
+	bool BAllocateFromBlock( MemoryBlock_t *pBlock, VkDeviceSize nSize, VkDeviceSize nAlignment, VkDeviceSize *pnOffsetOut );
+	MemoryBlock_t *CreateBlock( uint32_t nMemoryTypeIndex, bool bLinear, VkDeviceSize nSize, bool bDedicated, uint32_t *pnBlockOut );
+
+	static const VkDeviceSize k_nBlockSize = 64 * 1024 * 1024;
+
+	VkDevice m_pDevice;
+	VkPhysicalDeviceMemoryProperties m_memoryProperties;
+	VkDeviceSize m_nNonCoherentAtomSize;
+	std::vector< MemoryBlock_t * > m_blocks;                 // null where a dedicated block was released, so indices stay valid
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: A persistently mapped upload buffer that is handed out front to
+//          back. Space is tagged with the submission whose copies read it and
+//          comes back once that submission's fence is seen signalled. Uploads
+//          that do not fit get a temporary buffer with the same lifetime.
+//-----------------------------------------------------------------------------
+class CVulkanStagingRing
+{
+public:
+	CVulkanStagingRing();
+
+	bool BInit( VkDevice pDevice, CVulkanMemoryAllocator *pAllocator, VkDeviceSize nSize );
+	void Shutdown();
+
+	bool BAllocate( VkDeviceSize nSize, VkBuffer *ppBufferOut, VkDeviceSize *pnOffsetOut, void **ppDataOut );
+	uint64_t EndSubmission();
+	void Retire( uint64_t nSubmission );
+
+private:
+	struct Region_t
+	{
+		uint64_t m_nSubmission;
+		uint64_t m_nEnd;                                     // value of m_nHead when the submission was closed
+	};
+
+	struct OverflowBuffer_t
+	{
+		uint64_t m_nSubmission;
+		VkBuffer m_pBuffer;
+		VulkanAllocation_t m_allocation;
+	};
+
+	static const VkDeviceSize k_nAlignment = 16;
+
+	VkDevice m_pDevice;
+	CVulkanMemoryAllocator *m_pAllocator;
+	VkBuffer m_pBuffer;
+	VulkanAllocation_t m_allocation;
+	VkDeviceSize m_nSize;
+	uint64_t m_nHead;                                        // bytes ever handed out, the ring offset is this modulo m_nSize
+	uint64_t m_nTail;                                        // bytes the GPU is known to be done with
+	uint64_t m_nSubmission;                                  // submission that new allocations belong to
+	std::deque< Region_t > m_inFlightRegions;
+	std::deque< OverflowBuffer_t > m_overflowBuffers;
+};
+
 // Pipeline state objects
 enum PipelineStateObjectEnum_t
 {
@@ -61,36 +180,46 @@ enum DescriptorSetIndex_t
 	NUM_DESCRIPTOR_SETS
 };
 
+// Frames the CPU may record while the GPU is still executing earlier ones. Everything the CPU
+// writes while recording a frame (constant buffers, dynamic vertex data and the descriptor sets
+// that point at them) is duplicated this many times.
+static const uint32_t k_unMaxFramesInFlight = 3;
+
 class VulkanRenderModel
 {
 public:
 	VulkanRenderModel( const std::string & sRenderModelName );
 	~VulkanRenderModel();
 
-	bool BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryProperties &memoryProperties, VkCommandBuffer pCommandBuffer, vr::TrackedDeviceIndex_t unTrackedDeviceIndex, VkDescriptorSet pDescriptorSets[ 2 ], const vr::RenderModel_t & vrModel, const vr::RenderModel_TextureMap_t & vrDiffuseTexture );
+	bool BInit( VkDevice pDevice, CVulkanMemoryAllocator *pAllocator, CVulkanStagingRing *pStagingRing, VkCommandBuffer pCommandBuffer, bool bGenerateMipsOnGpu, vr::TrackedDeviceIndex_t unTrackedDeviceIndex, VkDescriptorSet pDescriptorSets[ k_unMaxFramesInFlight ][ 2 ], const vr::RenderModel_t & vrModel, const vr::RenderModel_TextureMap_t & vrDiffuseTexture );
 	void Cleanup();
-	void Draw( vr::EVREye nEye, VkCommandBuffer pCommandBuffer, VkPipelineLayout pPipelineLayout, const Matrix4 &matMVP );
+	void Draw( uint32_t nFrame, vr::EVREye nEye, VkCommandBuffer pCommandBuffer, VkPipelineLayout pPipelineLayout, const Matrix4 &matMVP );
+	void DrawGeometry( VkCommandBuffer pCommandBuffer );
+	void UpdateMatrix( uint32_t nFrame, vr::EVREye nEye, const Matrix4 &matMVP );
 	const std::string & GetName() const { return m_sModelName; }
+	VkImageView GetImageView() const { return m_pImageView; }
+	const Vector3 & GetBoundsCenter() const { return m_vBoundsCenter; }
+	float GetBoundsRadius() const { return m_flBoundsRadius; }
 
 private:
 	VkDevice m_pDevice;
-	VkPhysicalDeviceMemoryProperties m_physicalDeviceMemoryProperties;
+	CVulkanMemoryAllocator *m_pAllocator;
 	VkBuffer m_pVertexBuffer;
-	VkDeviceMemory m_pVertexBufferMemory;
+	VulkanAllocation_t m_vertexBufferAllocation;
 	VkBuffer m_pIndexBuffer;
-	VkDeviceMemory m_pIndexBufferMemory;
+	VulkanAllocation_t m_indexBufferAllocation;
 	VkImage m_pImage;
-	VkDeviceMemory m_pImageMemory;
+	VulkanAllocation_t m_imageAllocation;
 	VkImageView m_pImageView;
-	VkBuffer m_pImageStagingBuffer;
-	VkDeviceMemory m_pImageStagingBufferMemory;
-	VkBuffer m_pConstantBuffer[ 2 ];
-	VkDeviceMemory m_pConstantBufferMemory[ 2 ];
-	void *m_pConstantBufferData[ 2 ];
-	VkDescriptorSet m_pDescriptorSets[ 2 ];
+	VkBuffer m_pConstantBuffer[ k_unMaxFramesInFlight ][ 2 ];
+	VulkanAllocation_t m_constantBufferAllocations[ k_unMaxFramesInFlight ][ 2 ];
+	void *m_pConstantBufferData[ k_unMaxFramesInFlight ][ 2 ];
+	VkDescriptorSet m_pDescriptorSets[ k_unMaxFramesInFlight ][ 2 ];
 	VkSampler m_pSampler;
 
 	size_t m_unVertexCount;
+	Vector3 m_vBoundsCenter;                                 // bounding sphere in model space
+	float m_flBoundsRadius;
 	vr::TrackedDeviceIndex_t m_unTrackedDeviceIndex;
 	std::string m_sModelName;
 };
@@ -100,6 +229,9 @@ static bool g_bPrintf = true;
 // Vulkan extension entrypoints
 static PFN_vkCreateDebugReportCallbackEXT g_pVkCreateDebugReportCallbackEXT = nullptr;
 static PFN_vkDestroyDebugReportCallbackEXT g_pVkDestroyDebugReportCallbackEXT = nullptr;
+#ifdef VK_NV_shading_rate_image
+static PFN_vkCmdBindShadingRateImageNV g_pVkCmdBindShadingRateImageNV = nullptr;
+#endif
 
 //-----------------------------------------------------------------------------
 // Purpose:
@@ -138,31 +270,79 @@ public:
 	void UpdateControllerAxes();
 
 	bool SetupStereoRenderTargets();
+	bool SetupFoveation();
 	void SetupCompanionWindow();
 	void SetupCameras();
 
 	void RenderStereoTargets();
-	void RenderCompanionWindow();
-	void RenderScene( vr::Hmd_Eye nEye );
+	bool RenderCompanionWindow();
+	void TransitionEyesForSubmit();
+	void RenderScene( vr::Hmd_Eye nEye, VkCommandBuffer pCommandBuffer );
+	void RecordEyeCommandBuffer( vr::Hmd_Eye nEye, VkCommandBuffer pCommandBuffer );
+
+	bool BInitEyeRecordThreads();
+	void ShutdownEyeRecordThreads();
+	static int SDLCALL EyeRecordThreadMain( void *pData );
 
 	Matrix4 GetHMDMatrixProjectionEye( vr::Hmd_Eye nEye );
 	Matrix4 GetHMDMatrixPoseEye( vr::Hmd_Eye nEye );
 	Matrix4 GetCurrentViewProjectionMatrix( vr::Hmd_Eye nEye );
 	void UpdateHMDMatrixPose();
+	void UpdateTrackedDeviceClass( vr::TrackedDeviceIndex_t unTrackedDeviceIndex );
 
 	Matrix4 ConvertSteamVRMatrixToMatrix4( const vr::HmdMatrix34_t &matPose );
+	void ConvertSteamVRMatrixToMatrix4( const vr::TrackedDevicePose_t *pPoses, Matrix4 *pMatrices, uint32_t unCount );
 
 	bool CreateAllShaders();
 	void CreateAllDescriptorSets();
+	void CreateBindlessDescriptorSets();
+	void UpdateBindlessTextures();
+
+	std::string GetPipelineCachePath();
+	void CreatePipelineCache();
+	void SavePipelineCache();
 
 	void SetupRenderModelForTrackedDevice( vr::TrackedDeviceIndex_t unTrackedDeviceIndex );
-	VulkanRenderModel *FindOrLoadRenderModel( vr::TrackedDeviceIndex_t unTrackedDeviceIndex, const char *pchRenderModelName );
+	VulkanRenderModel *CreateRenderModel( vr::TrackedDeviceIndex_t unTrackedDeviceIndex, const char *pchRenderModelName, const vr::RenderModel_t &vrModel, const vr::RenderModel_TextureMap_t &vrDiffuseTexture );
+	void UpdateRenderModelLoads();
+
+	// GPU timestamps written between the parts of a frame
+	enum EGpuTimestamp
+	{
+		k_eGpuTimestamp_FrameStart,
+		k_eGpuTimestamp_LeftEye,
+		k_eGpuTimestamp_RightEye,
+		k_eGpuTimestamp_Companion,
+		k_eGpuTimestamp_Count
+	};
+	static const uint32_t k_unTimingFrameCount = 4;          // frames in flight before a frame's timestamps are read back
+
+	bool BInitFrameTiming();
+	void WriteGpuTimestamp( EGpuTimestamp eTimestamp );
+	void UpdateFrameTiming();
+	void RecordFrameTiming( uint64_t unFrame, const float *pflGpuMs );
+	void LateLatchViews();
+
+	struct LateLatch_t
+	{
+		bool m_bLatched;
+		float m_flMs;                                        // since WaitGetPoses returned
+		float m_flDegrees;
+		float m_flMillimeters;
+	};
 
 private: 
 	bool m_bDebugVulkan;
 	bool m_bVerbose;
 	bool m_bPerf;
 	bool m_bVblank;
+	bool m_bEyeRecordThreads;                                // record each eye's draws on its own worker thread
+	bool m_bLateLatch;                                       // re-read the HMD pose just before vkQueueSubmit and rewrite the view matrices
+	bool m_bCulling;                                         // frustum cull the scene cells and render models, off with -noculling
+	FoveationSettings_t m_foveation;
+	bool m_bShadingRateImage;                                // the device can shade at the rates of m_rpShadingRateImageView
+	VkExtent2D m_shadingRateTexelSize;                       // pixels covered by one texel of a shading rate image
+	bool m_bBindless;                                        // -bindless: render models index one texture array with a push constant
 	int m_nMSAASampleCount;
 	// Optional scaling factor to render with supersampling (defaults off, use -scale)
 	float m_flSuperSampleScale;
@@ -179,6 +359,8 @@ private: // SDL bookkeeping
 	SDL_Window *m_pCompanionWindow;
 	uint32_t m_nCompanionWindowWidth;
 	uint32_t m_nCompanionWindowHeight;
+	uint32_t m_unCompanionInterval;                          // mirror every nth frame ( -companioninterval ), 0 never ( -nocompanion )
+	bool m_bCompanionFrame;                                  // a swapchain image was acquired and drawn this frame
 
 private:
 	int m_iTrackedControllerCount;
@@ -187,7 +369,7 @@ private:
 	int m_iValidPoseCount_Last;
 	bool m_bShowCubes;
 
-	std::string m_strPoseClasses;                            // what classes we saw poses for this frame
+	char m_rchPoseClasses[ vr::k_unMaxTrackedDeviceCount + 1 ]; // what classes we saw poses for this frame
 	char m_rDevClassChar[ vr::k_unMaxTrackedDeviceCount ];   // for each device, a character representing its class
 
 	int m_iSceneVolumeWidth;
@@ -202,6 +384,9 @@ private:
 	float m_fFarClip;
 
 	unsigned int m_uiVertcount;
+	unsigned int m_uiCubeVertcount;                          // vertices of one cube in the scene vertex buffer
+	CSceneCellBVH m_sceneBVH;                                // the cubes are baked into the vertex buffer in its cell order
+	std::vector< SceneCellRange_t > m_rvecSceneRanges[ 2 ];  // cells that survived culling, per eye so each eye's recording thread has its own
 	unsigned int m_uiCompanionWindowIndexSize;
 
 	VkInstance m_pInstance;
@@ -213,6 +398,7 @@ private:
 	VkPhysicalDeviceProperties m_physicalDeviceProperties;
 	VkPhysicalDeviceMemoryProperties m_physicalDeviceMemoryProperties;
 	VkPhysicalDeviceFeatures m_physicalDeviceFeatures;
+	bool m_bGenerateMipsOnGpu;                               // RGBA8 textures can be blitted with linear filtering
 	uint32_t m_nQueueFamilyIndex;
 	VkDebugReportCallbackEXT m_pDebugReportCallback;
 	uint32_t m_nSwapQueueImageCount;
@@ -227,32 +413,78 @@ private:
 
 	VkCommandPool m_pCommandPool;
 	VkDescriptorPool m_pDescriptorPool;
-	VkDescriptorSet m_pDescriptorSets[ NUM_DESCRIPTOR_SETS ];
+	VkDescriptorSet m_pDescriptorSets[ k_unMaxFramesInFlight ][ NUM_DESCRIPTOR_SETS ];
+
+	CVulkanMemoryAllocator m_memoryAllocator;
+	CVulkanStagingRing m_stagingRing;
+	static const VkDeviceSize k_nStagingRingSize = 16 * 1024 * 1024;
 
 	struct VulkanCommandBuffer_t
 	{
 		VkCommandBuffer m_pCommandBuffer;
 		VkFence m_pFence;
+		uint64_t m_nStagingSubmission;                       // staging ring space read by this buffer's copies
+		VkCommandBuffer m_pEyeCommandBuffers[ 2 ];           // secondary buffers executed by m_pCommandBuffer, recycled with it
 	};
 	std::deque< VulkanCommandBuffer_t > m_commandBuffers;
 	VulkanCommandBuffer_t m_currentCommandBuffer;
 	
 	VulkanCommandBuffer_t GetCommandBuffer();
+	VulkanCommandBuffer_t CreateCommandBuffer( bool bFrameCommandBuffer );
+
+	// Each frame in flight records into its own command buffer. RenderFrame waits for the buffer's
+	// fence before reusing it, which is the only point the CPU waits on the GPU while rendering.
+	VulkanCommandBuffer_t m_rFrameCommandBuffers[ k_unMaxFramesInFlight ];
+	uint32_t m_nFramesInFlight;                              // -framesinflight, at most k_unMaxFramesInFlight
+	uint32_t m_nFrameSlot;                                   // frame resources being recorded this frame
+
+	// Each eye's scene is recorded into a secondary command buffer by its own worker thread while the
+	// main thread records the barriers and render passes around it. A command pool may only be used by
+	// one thread at a time, so every worker owns the pool its secondary buffers come from.
+	struct EyeRecordThread_t
+	{
+		CMainApplication *m_pApplication;
+		vr::Hmd_Eye m_nEye;
+		SDL_Thread *m_pThread;
+		SDL_sem *m_pStartSemaphore;                          // posted by the main thread when there is a buffer to record
+		SDL_sem *m_pDoneSemaphore;                           // posted by the worker once the buffer is recorded
+		VkCommandPool m_pCommandPool;
+		VkCommandBuffer m_pCommandBuffer;                    // secondary buffer to record into this frame
+	};
+	EyeRecordThread_t m_rEyeRecordThreads[ 2 ];
+	bool m_bQuitEyeRecordThreads;
+	bool m_bIsInputAvailable;                                // sampled once per frame for the recording threads
 
 	// Scene resources
 	VkBuffer m_pSceneVertexBuffer;
-	VkDeviceMemory m_pSceneVertexBufferMemory;
+	VulkanAllocation_t m_sceneVertexBufferAllocation;
 	VkBufferView m_pSceneVertexBufferView;
-	VkBuffer m_pSceneConstantBuffer[ 2 ];
-	VkDeviceMemory m_pSceneConstantBufferMemory[ 2 ];
-	void *m_pSceneConstantBufferData[ 2 ];
+	VkBuffer m_pSceneConstantBuffer[ k_unMaxFramesInFlight ][ 2 ];
+	VulkanAllocation_t m_sceneConstantBufferAllocations[ k_unMaxFramesInFlight ][ 2 ];
+	void *m_pSceneConstantBufferData[ k_unMaxFramesInFlight ][ 2 ];
 	VkImage m_pSceneImage;
-	VkDeviceMemory m_pSceneImageMemory;
+	VulkanAllocation_t m_sceneImageAllocation;
 	VkImageView m_pSceneImageView;
-	VkBuffer m_pSceneStagingBuffer;
-	VkDeviceMemory m_pSceneStagingBufferMemory;
 	VkSampler m_pSceneSampler;
 
+	// Per eye -foveate shading rate images, one EFoveationRate per tile
+	VkImage m_rpShadingRateImage[ 2 ];
+	VulkanAllocation_t m_rShadingRateImageAllocations[ 2 ];
+	VkImageView m_rpShadingRateImageView[ 2 ];
+
+	// -bindless render model resources. Every tracked device has a slot in the matrix buffer of each
+	// eye and in the texture array, so a frame binds one set per eye and each draw only pushes its
+	// device index. A frame slot's sets are only written once its fence has been waited on.
+	VkDescriptorSetLayout m_pBindlessDescriptorSetLayout;
+	VkPipelineLayout m_pBindlessPipelineLayout;
+	VkDescriptorPool m_pBindlessDescriptorPool;
+	VkDescriptorSet m_pBindlessDescriptorSets[ k_unMaxFramesInFlight ][ 2 ];
+	VkBuffer m_pBindlessMatrixBuffer[ k_unMaxFramesInFlight ][ 2 ];
+	VulkanAllocation_t m_bindlessMatrixBufferAllocations[ k_unMaxFramesInFlight ][ 2 ];
+	Matrix4 *m_pBindlessMatrixData[ k_unMaxFramesInFlight ][ 2 ];
+	VkImageView m_rpBindlessImageViews[ k_unMaxFramesInFlight ][ vr::k_unMaxTrackedDeviceCount ]; // what each slot's array holds
+	VkSampler m_pBindlessSampler;
+
 	// Storage for VS and PS for each PSO
 	VkShaderModule m_pShaderModules[ PSO_COUNT * 2 ];
 	VkPipeline m_pPipelines[ PSO_COUNT ];
@@ -262,16 +494,42 @@ private:
 
 	// Companion window resources
 	VkBuffer m_pCompanionWindowVertexBuffer;
-	VkDeviceMemory m_pCompanionWindowVertexBufferMemory;
+	VulkanAllocation_t m_companionWindowVertexBufferAllocation;
 	VkBuffer m_pCompanionWindowIndexBuffer;
-	VkDeviceMemory m_pCompanionWindowIndexBufferMemory;
+	VulkanAllocation_t m_companionWindowIndexBufferAllocation;
 
 	// Controller axes resources
-	VkBuffer m_pControllerAxesVertexBuffer;
-	VkDeviceMemory m_pControllerAxesVertexBufferMemory;
+	VkBuffer m_pControllerAxesVertexBuffer[ k_unMaxFramesInFlight ];
+	VulkanAllocation_t m_controllerAxesVertexBufferAllocations[ k_unMaxFramesInFlight ];
 
 	unsigned int m_uiControllerVertcount;
 
+	// Frame timing resources
+	VkQueryPool m_pTimestampQueryPool;                       // k_eGpuTimestamp_Count queries per timing frame, null if unsupported
+	uint64_t m_unTimingFrame;                                // frame whose timestamps are being written
+	std::string m_strTimingCsvPath;                          // -timingcsv, one row per frame once its timestamps are back
+	FILE *m_pTimingCsv;
+	std::string m_strWindowTitle;
+
+	struct FrameTimingSums_t
+	{
+		uint32_t m_unFrames;
+		double m_flGpuMs[ k_eGpuTimestamp_Count - 1 ];
+		double m_flCompositorGpuMs;
+		double m_flFrameIntervalMs;
+		uint32_t m_unDroppedFrames;
+		uint32_t m_unLateLatched;
+		double m_flLateLatchMs;
+		double m_flLateLatchDegrees;
+	};
+	FrameTimingSums_t m_frameTimingSums;                     // since the companion window title was last updated
+	uint32_t m_unFrameTimingTitleTicks;
+
+	float m_flDisplayFrequency;
+	float m_flSecondsFromVsyncToPhotons;
+	uint64_t m_ulPosesCounter;                               // SDL performance counter when WaitGetPoses returned
+	LateLatch_t m_rLateLatch[ k_unTimingFrameCount ];
+
 	Matrix4 m_mat4HMDPose;
 	Matrix4 m_mat4eyePosLeft;
 	Matrix4 m_mat4eyePosRight;
@@ -298,11 +556,11 @@ private:
 	{
 		VkImage m_pImage;
 		VkImageLayout m_nImageLayout;
-		VkDeviceMemory m_pDeviceMemory;
+		VulkanAllocation_t m_allocation;
 		VkImageView m_pImageView;
 		VkImage m_pDepthStencilImage;
 		VkImageLayout m_nDepthStencilImageLayout;
-		VkDeviceMemory m_pDepthStencilDeviceMemory;
+		VulkanAllocation_t m_depthStencilAllocation;
 		VkImageView m_pDepthStencilImageView;
 		VkRenderPass m_pRenderPass;
 		VkFramebuffer m_pFramebuffer;
@@ -317,6 +575,13 @@ private:
 
 	std::vector< VulkanRenderModel * > m_vecRenderModels;
 	VulkanRenderModel *m_rTrackedDeviceToRenderModel[ vr::k_unMaxTrackedDeviceCount ];
+
+	struct PendingRenderModel_t
+	{
+		std::string m_sName;                                 // empty when no model is loading for the device
+		vr::RenderModel_t *m_pModel = nullptr;               // geometry that is waiting on its texture
+	};
+	PendingRenderModel_t m_rPendingRenderModel[ vr::k_unMaxTrackedDeviceCount ];
 };
 
 //-----------------------------------------------------------------------------
@@ -396,65 +661,560 @@ static bool MemoryTypeFromProperties( const VkPhysicalDeviceMemoryProperties &me
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Helper function to create Vulkan static VB/IBs
+// Purpose: Where lodepng::decode_rows puts the rows of an RGBA image
 //-----------------------------------------------------------------------------
-static bool CreateVulkanBuffer( VkDevice pDevice, const VkPhysicalDeviceMemoryProperties &memoryProperties, const void *pBufferData, VkDeviceSize nSize, VkBufferUsageFlags nUsage, VkBuffer *ppBufferOut, VkDeviceMemory *ppDeviceMemoryOut )
+struct DecodedRowTarget_t
 {
-	// Create the vertex buffer and fill with data
+	uint8_t *m_pDest;
+	size_t m_unRowPitch;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies one decoded row into place. The rows come top to bottom, so
+// mapped upload memory is only ever written forwards, never read.
+//-----------------------------------------------------------------------------
+static unsigned CopyDecodedRow( const unsigned char *pRow, size_t unRowSize, unsigned y, void *pContext )
+{
+	DecodedRowTarget_t *pTarget = ( DecodedRowTarget_t * )pContext;
+	memcpy( pTarget->m_pDest + y * pTarget->m_unRowPitch, pRow, unRowSize );
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+CVulkanMemoryAllocator::CVulkanMemoryAllocator()
+	: m_pDevice( VK_NULL_HANDLE )
+	, m_nNonCoherentAtomSize( 1 )
+{
+	memset( &m_memoryProperties, 0, sizeof( m_memoryProperties ) );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CVulkanMemoryAllocator::Init( VkDevice pDevice, const VkPhysicalDeviceMemoryProperties &memoryProperties, const VkPhysicalDeviceLimits &limits )
+{
+	m_pDevice = pDevice;
+	m_memoryProperties = memoryProperties;
+	m_nNonCoherentAtomSize = limits.nonCoherentAtomSize > 0 ? limits.nonCoherentAtomSize : 1;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Releases every block. Resources placed in them must already be
+//          destroyed.
+//-----------------------------------------------------------------------------
+void CVulkanMemoryAllocator::Shutdown()
+{
+	for ( size_t nBlock = 0; nBlock < m_blocks.size(); nBlock++ )
+	{
+		if ( m_blocks[ nBlock ] != nullptr )
+		{
+			vkFreeMemory( m_pDevice, m_blocks[ nBlock ]->m_pMemory, nullptr );
+			delete m_blocks[ nBlock ];
+		}
+	}
+	m_blocks.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Creates a block and maps it if it is host visible
+//-----------------------------------------------------------------------------
+CVulkanMemoryAllocator::MemoryBlock_t *CVulkanMemoryAllocator::CreateBlock( uint32_t nMemoryTypeIndex, bool bLinear, VkDeviceSize nSize, bool bDedicated, uint32_t *pnBlockOut )
+{
+	VkMemoryAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+	allocInfo.allocationSize = nSize;
+	allocInfo.memoryTypeIndex = nMemoryTypeIndex;
+
+	VkDeviceMemory pMemory = VK_NULL_HANDLE;
+	VkResult nResult = vkAllocateMemory( m_pDevice, &allocInfo, nullptr, &pMemory );
+	if ( nResult != VK_SUCCESS )
+	{
+		dprintf( "%s - vkAllocateMemory failed with error %d\n", __FUNCTION__, nResult );
+		return nullptr;
+	}
+
+	void *pMappedData = nullptr;
+	if ( m_memoryProperties.memoryTypes[ nMemoryTypeIndex ].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT )
+	{
+		nResult = vkMapMemory( m_pDevice, pMemory, 0, VK_WHOLE_SIZE, 0, &pMappedData );
+		if ( nResult != VK_SUCCESS )
+		{
+			dprintf( "%s - vkMapMemory returned error %d\n", __FUNCTION__, nResult );
+			vkFreeMemory( m_pDevice, pMemory, nullptr );
+			return nullptr;
+		}
+	}
+
+	MemoryBlock_t *pBlock = new MemoryBlock_t;
+	pBlock->m_pMemory = pMemory;
+	pBlock->m_nSize = nSize;
+	pBlock->m_nMemoryTypeIndex = nMemoryTypeIndex;
+	pBlock->m_bLinear = bLinear;
+	pBlock->m_bDedicated = bDedicated;
+	pBlock->m_pMappedData = ( uint8_t * ) pMappedData;
+	FreeRange_t wholeBlock = { 0, nSize };
+	pBlock->m_freeRanges.push_back( wholeBlock );
+
+	// Reuse a slot left behind by a released dedicated block
+	for ( size_t nBlock = 0; nBlock < m_blocks.size(); nBlock++ )
+	{
+		if ( m_blocks[ nBlock ] == nullptr )
+		{
+			m_blocks[ nBlock ] = pBlock;
+			*pnBlockOut = ( uint32_t ) nBlock;
+			return pBlock;
+		}
+	}
+	*pnBlockOut = ( uint32_t ) m_blocks.size();
+	m_blocks.push_back( pBlock );
+	return pBlock;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: First fit search of a block's free list
+//-----------------------------------------------------------------------------
+bool CVulkanMemoryAllocator::BAllocateFromBlock( MemoryBlock_t *pBlock, VkDeviceSize nSize, VkDeviceSize nAlignment, VkDeviceSize *pnOffsetOut )
+{
+	std::vector< FreeRange_t > &freeRanges = pBlock->m_freeRanges;
+	for ( size_t nRange = 0; nRange < freeRanges.size(); nRange++ )
+	{
+		FreeRange_t range = freeRanges[ nRange ];
+		VkDeviceSize nOffset = ( range.m_nOffset + nAlignment - 1 ) / nAlignment * nAlignment;
+		VkDeviceSize nRangeEnd = range.m_nOffset + range.m_nSize;
+		if ( nOffset + nSize > nRangeEnd )
+			continue;
+
+		// Whatever is left on either side of the allocation stays free
+		freeRanges.erase( freeRanges.begin() + nRange );
+		if ( nOffset + nSize < nRangeEnd )
+		{
+			FreeRange_t after = { nOffset + nSize, nRangeEnd - ( nOffset + nSize ) };
+			freeRanges.insert( freeRanges.begin() + nRange, after );
+		}
+		if ( nOffset > range.m_nOffset )
+		{
+			FreeRange_t before = { range.m_nOffset, nOffset - range.m_nOffset };
+			freeRanges.insert( freeRanges.begin() + nRange, before );
+		}
+
+		*pnOffsetOut = nOffset;
+		return true;
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds room for a resource, creating a new block if none of the
+//          existing ones of the right type can hold it
+//-----------------------------------------------------------------------------
+bool CVulkanMemoryAllocator::BAllocate( const VkMemoryRequirements &memoryRequirements, VkMemoryPropertyFlags nMemoryProperties, bool bLinear, VulkanAllocation_t *pAllocationOut )
+{
+	uint32_t nMemoryTypeIndex;
+	if ( !MemoryTypeFromProperties( m_memoryProperties, memoryRequirements.memoryTypeBits, nMemoryProperties, &nMemoryTypeIndex ) )
+	{
+		dprintf( "%s - failed to find matching memoryTypeIndex\n", __FUNCTION__ );
+		return false;
+	}
+
+	// Non-coherent ranges are flushed by allocation, which must not touch a neighbour's atoms
+	VkDeviceSize nAlignment = memoryRequirements.alignment > 0 ? memoryRequirements.alignment : 1;
+	VkDeviceSize nSize = memoryRequirements.size;
+	VkMemoryPropertyFlags nTypeFlags = m_memoryProperties.memoryTypes[ nMemoryTypeIndex ].propertyFlags;
+	if ( ( nTypeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT ) && !( nTypeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT ) )
+	{
+		if ( nAlignment < m_nNonCoherentAtomSize )
+			nAlignment = m_nNonCoherentAtomSize;
+		nSize = ( nSize + m_nNonCoherentAtomSize - 1 ) / m_nNonCoherentAtomSize * m_nNonCoherentAtomSize;
+	}
+
+	uint32_t nBlock = 0;
+	MemoryBlock_t *pBlock = nullptr;
+	VkDeviceSize nOffset = 0;
+	if ( nSize > k_nBlockSize / 2 )
+	{
+		pBlock = CreateBlock( nMemoryTypeIndex, bLinear, nSize, true, &nBlock );
+		if ( pBlock == nullptr )
+			return false;
+		BAllocateFromBlock( pBlock, nSize, nAlignment, &nOffset );
+	}
+	else
+	{
+		for ( nBlock = 0; nBlock < m_blocks.size(); nBlock++ )
+		{
+			MemoryBlock_t *pCandidate = m_blocks[ nBlock ];
+			if ( pCandidate != nullptr && !pCandidate->m_bDedicated && pCandidate->m_nMemoryTypeIndex == nMemoryTypeIndex && pCandidate->m_bLinear == bLinear &&
+				 BAllocateFromBlock( pCandidate, nSize, nAlignment, &nOffset ) )
+			{
+				pBlock = pCandidate;
+				break;
+			}
+		}
+
+		if ( pBlock == nullptr )
+		{
+			pBlock = CreateBlock( nMemoryTypeIndex, bLinear, k_nBlockSize, false, &nBlock );
+			if ( pBlock == nullptr )
+				return false;
+			BAllocateFromBlock( pBlock, nSize, nAlignment, &nOffset );
+		}
+	}
+
+	pAllocationOut->m_pMemory = pBlock->m_pMemory;
+	pAllocationOut->m_nOffset = nOffset;
+	pAllocationOut->m_nSize = nSize;
+	pAllocationOut->m_pMappedData = pBlock->m_pMappedData ? pBlock->m_pMappedData + nOffset : nullptr;
+	pAllocationOut->m_nBlock = nBlock;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+bool CVulkanMemoryAllocator::BAllocateAndBindBuffer( VkBuffer pBuffer, VkMemoryPropertyFlags nMemoryProperties, VulkanAllocation_t *pAllocationOut )
+{
+	VkMemoryRequirements memoryRequirements = {};
+	vkGetBufferMemoryRequirements( m_pDevice, pBuffer, &memoryRequirements );
+	if ( !BAllocate( memoryRequirements, nMemoryProperties, true, pAllocationOut ) )
+		return false;
+
+	VkResult nResult = vkBindBufferMemory( m_pDevice, pBuffer, pAllocationOut->m_pMemory, pAllocationOut->m_nOffset );
+	if ( nResult != VK_SUCCESS )
+	{
+		dprintf( "%s vkBindBufferMemory failed with error %d\n", __FUNCTION__, nResult );
+		Free( pAllocationOut );
+		return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Images are assumed to use VK_IMAGE_TILING_OPTIMAL
+//-----------------------------------------------------------------------------
+bool CVulkanMemoryAllocator::BAllocateAndBindImage( VkImage pImage, VkMemoryPropertyFlags nMemoryProperties, VulkanAllocation_t *pAllocationOut )
+{
+	VkMemoryRequirements memoryRequirements = {};
+	vkGetImageMemoryRequirements( m_pDevice, pImage, &memoryRequirements );
+	if ( !BAllocate( memoryRequirements, nMemoryProperties, false, pAllocationOut ) )
+		return false;
+
+	VkResult nResult = vkBindImageMemory( m_pDevice, pImage, pAllocationOut->m_pMemory, pAllocationOut->m_nOffset );
+	if ( nResult != VK_SUCCESS )
+	{
+		dprintf( "%s vkBindImageMemory failed with error %d\n", __FUNCTION__, nResult );
+		Free( pAllocationOut );
+		return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns an allocation to its block's free list. Safe to call on an
+//          allocation that was never made.
+//-----------------------------------------------------------------------------
+void CVulkanMemoryAllocator::Free( VulkanAllocation_t *pAllocation )
+{
+	if ( pAllocation->m_pMemory == VK_NULL_HANDLE )
+		return;
+
+	MemoryBlock_t *pBlock = m_blocks[ pAllocation->m_nBlock ];
+	if ( pBlock->m_bDedicated )
+	{
+		vkFreeMemory( m_pDevice, pBlock->m_pMemory, nullptr );
+		delete pBlock;
+		m_blocks[ pAllocation->m_nBlock ] = nullptr;
+	}
+	else
+	{
+		std::vector< FreeRange_t > &freeRanges = pBlock->m_freeRanges;
+		size_t nRange = 0;
+		while ( nRange < freeRanges.size() && freeRanges[ nRange ].m_nOffset < pAllocation->m_nOffset )
+		{
+			nRange++;
+		}
+		FreeRange_t range = { pAllocation->m_nOffset, pAllocation->m_nSize };
+		freeRanges.insert( freeRanges.begin() + nRange, range );
+
+		// Merge with the following range, then with the preceding one
+		if ( nRange + 1 < freeRanges.size() && freeRanges[ nRange ].m_nOffset + freeRanges[ nRange ].m_nSize == freeRanges[ nRange + 1 ].m_nOffset )
+		{
+			freeRanges[ nRange ].m_nSize += freeRanges[ nRange + 1 ].m_nSize;
+			freeRanges.erase( freeRanges.begin() + nRange + 1 );
+		}
+		if ( nRange > 0 && freeRanges[ nRange - 1 ].m_nOffset + freeRanges[ nRange - 1 ].m_nSize == freeRanges[ nRange ].m_nOffset )
+		{
+			freeRanges[ nRange - 1 ].m_nSize += freeRanges[ nRange ].m_nSize;
+			freeRanges.erase( freeRanges.begin() + nRange );
+		}
+	}
+
+	memset( pAllocation, 0, sizeof( *pAllocation ) );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Makes host writes to a mapped allocation visible to the device
+//-----------------------------------------------------------------------------
+void CVulkanMemoryAllocator::FlushMappedAllocation( const VulkanAllocation_t &allocation )
+{
+	if ( allocation.m_pMemory == VK_NULL_HANDLE )
+		return;
+
+	uint32_t nMemoryTypeIndex = m_blocks[ allocation.m_nBlock ]->m_nMemoryTypeIndex;
+	if ( m_memoryProperties.memoryTypes[ nMemoryTypeIndex ].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT )
+		return;
+
+	VkMappedMemoryRange memoryRange = { VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
+	memoryRange.memory = allocation.m_pMemory;
+	memoryRange.offset = allocation.m_nOffset;
+	memoryRange.size = allocation.m_nSize;
+	vkFlushMappedMemoryRanges( m_pDevice, 1, &memoryRange );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+CVulkanStagingRing::CVulkanStagingRing()
+	: m_pDevice( VK_NULL_HANDLE )
+	, m_pAllocator( nullptr )
+	, m_pBuffer( VK_NULL_HANDLE )
+	, m_allocation()
+	, m_nSize( 0 )
+	, m_nHead( 0 )
+	, m_nTail( 0 )
+	, m_nSubmission( 1 )
+{
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Host coherent memory is used so writes never need flushing
+//-----------------------------------------------------------------------------
+bool CVulkanStagingRing::BInit( VkDevice pDevice, CVulkanMemoryAllocator *pAllocator, VkDeviceSize nSize )
+{
+	m_pDevice = pDevice;
+	m_pAllocator = pAllocator;
+	m_nSize = nSize;
+
 	VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
 	bufferCreateInfo.size = nSize;
-	bufferCreateInfo.usage = nUsage;
-	VkResult nResult = vkCreateBuffer( pDevice, &bufferCreateInfo, nullptr, ppBufferOut );
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	VkResult nResult = vkCreateBuffer( m_pDevice, &bufferCreateInfo, nullptr, &m_pBuffer );
 	if ( nResult != VK_SUCCESS )
 	{
 		dprintf( "%s - vkCreateBuffer failed with error %d\n", __FUNCTION__, nResult );
 		return false;
 	}
 
-	VkMemoryRequirements memoryRequirements = {};
-	vkGetBufferMemoryRequirements( pDevice, *ppBufferOut, &memoryRequirements );
+	return m_pAllocator->BAllocateAndBindBuffer( m_pBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_allocation );
+}
 
-	VkMemoryAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
-	if ( !MemoryTypeFromProperties( memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &allocInfo.memoryTypeIndex ) )
+//-----------------------------------------------------------------------------
+// Purpose: The device must be idle
+//-----------------------------------------------------------------------------
+void CVulkanStagingRing::Shutdown()
+{
+	Retire( m_nSubmission );
+
+	if ( m_pBuffer != VK_NULL_HANDLE )
 	{
-		dprintf( "%s - failed to find matching memoryTypeIndex for buffer\n", __FUNCTION__ );
-		return false;
+		vkDestroyBuffer( m_pDevice, m_pBuffer, nullptr );
+		m_pBuffer = VK_NULL_HANDLE;
+	}
+	if ( m_pAllocator != nullptr )
+	{
+		m_pAllocator->Free( &m_allocation );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns nSize bytes to upload from in a copy recorded into the
+//          current submission
+//-----------------------------------------------------------------------------
+bool CVulkanStagingRing::BAllocate( VkDeviceSize nSize, VkBuffer *ppBufferOut, VkDeviceSize *pnOffsetOut, void **ppDataOut )
+{
+	// Start at the next aligned offset, or at the beginning of the ring if the end is too close
+	uint64_t nStart = ( m_nHead + k_nAlignment - 1 ) / k_nAlignment * k_nAlignment;
+	if ( nStart % m_nSize + nSize > m_nSize )
+	{
+		nStart += m_nSize - nStart % m_nSize;
 	}
-	allocInfo.allocationSize = memoryRequirements.size;
 
-	nResult = vkAllocateMemory( pDevice, &allocInfo, nullptr, ppDeviceMemoryOut );
+	if ( nStart + nSize - m_nTail <= m_nSize )
+	{
+		m_nHead = nStart + nSize;
+		*ppBufferOut = m_pBuffer;
+		*pnOffsetOut = nStart % m_nSize;
+		*ppDataOut = ( uint8_t * ) m_allocation.m_pMappedData + *pnOffsetOut;
+		return true;
+	}
+
+	// The ring is full of uploads the GPU has not finished with yet
+	OverflowBuffer_t overflow;
+	overflow.m_nSubmission = m_nSubmission;
+	memset( &overflow.m_allocation, 0, sizeof( overflow.m_allocation ) );
+
+	VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	bufferCreateInfo.size = nSize;
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	VkResult nResult = vkCreateBuffer( m_pDevice, &bufferCreateInfo, nullptr, &overflow.m_pBuffer );
 	if ( nResult != VK_SUCCESS )
 	{
 		dprintf( "%s - vkCreateBuffer failed with error %d\n", __FUNCTION__, nResult );
 		return false;
 	}
+	if ( !m_pAllocator->BAllocateAndBindBuffer( overflow.m_pBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &overflow.m_allocation ) )
+	{
+		vkDestroyBuffer( m_pDevice, overflow.m_pBuffer, nullptr );
+		return false;
+	}
+	m_overflowBuffers.push_back( overflow );
+
+	*ppBufferOut = overflow.m_pBuffer;
+	*pnOffsetOut = 0;
+	*ppDataOut = overflow.m_allocation.m_pMappedData;
+	return true;
+}
 
-	nResult = vkBindBufferMemory( pDevice, *ppBufferOut, *ppDeviceMemoryOut, 0 );
+//-----------------------------------------------------------------------------
+// Purpose: Closes the current submission. Store the returned id with the
+//          command buffer and pass it to Retire once its fence has signalled.
+//-----------------------------------------------------------------------------
+uint64_t CVulkanStagingRing::EndSubmission()
+{
+	if ( m_inFlightRegions.empty() ? m_nHead > m_nTail : m_nHead > m_inFlightRegions.back().m_nEnd )
+	{
+		Region_t region = { m_nSubmission, m_nHead };
+		m_inFlightRegions.push_back( region );
+	}
+	return m_nSubmission++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Submissions complete in order, so this also retires everything
+//          submitted before nSubmission
+//-----------------------------------------------------------------------------
+void CVulkanStagingRing::Retire( uint64_t nSubmission )
+{
+	while ( !m_inFlightRegions.empty() && m_inFlightRegions.front().m_nSubmission <= nSubmission )
+	{
+		m_nTail = m_inFlightRegions.front().m_nEnd;
+		m_inFlightRegions.pop_front();
+	}
+
+	while ( !m_overflowBuffers.empty() && m_overflowBuffers.front().m_nSubmission <= nSubmission )
+	{
+		vkDestroyBuffer( m_pDevice, m_overflowBuffers.front().m_pBuffer, nullptr );
+		m_pAllocator->Free( &m_overflowBuffers.front().m_allocation );
+		m_overflowBuffers.pop_front();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Helper function to create Vulkan static VB/IBs
+//-----------------------------------------------------------------------------
+static bool CreateVulkanBuffer( VkDevice pDevice, CVulkanMemoryAllocator *pAllocator, const void *pBufferData, VkDeviceSize nSize, VkBufferUsageFlags nUsage, VkBuffer *ppBufferOut, VulkanAllocation_t *pAllocationOut )
+{
+	// Create the vertex buffer and fill with data
+	VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	bufferCreateInfo.size = nSize;
+	bufferCreateInfo.usage = nUsage;
+	VkResult nResult = vkCreateBuffer( pDevice, &bufferCreateInfo, nullptr, ppBufferOut );
 	if ( nResult != VK_SUCCESS )
 	{
-		dprintf( "%s vkBindBufferMemory failed with error %d\n", __FUNCTION__, nResult );
+		dprintf( "%s - vkCreateBuffer failed with error %d\n", __FUNCTION__, nResult );
+		return false;
+	}
+
+	if ( !pAllocator->BAllocateAndBindBuffer( *ppBufferOut, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, pAllocationOut ) )
+	{
 		return false;
 	}
 
 	if ( pBufferData != nullptr )
 	{
-		void *pData;
-		nResult = vkMapMemory( pDevice, *ppDeviceMemoryOut, 0, VK_WHOLE_SIZE, 0, &pData );
-		if ( nResult != VK_SUCCESS )
-		{
-			dprintf( "%s - vkMapMemory returned error %d\n", __FUNCTION__, nResult );
-			return false;
-		}
-		memcpy( pData, pBufferData, nSize );
-		vkUnmapMemory( pDevice, *ppDeviceMemoryOut );
+		memcpy( pAllocationOut->m_pMappedData, pBufferData, nSize );
+		pAllocator->FlushMappedAllocation( *pAllocationOut );
+	}
+	return true;
+}
 
-		VkMappedMemoryRange memoryRange = { VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
-		memoryRange.memory = *ppDeviceMemoryOut;
-		memoryRange.size = VK_WHOLE_SIZE;
-		vkFlushMappedMemoryRanges( pDevice, 1, &memoryRange );
+//-----------------------------------------------------------------------------
+// Purpose: Number of mip levels in the chains built for the sample's textures,
+//          which stop once either dimension reaches 1
+//-----------------------------------------------------------------------------
+static uint32_t CountMipLevels( int nWidth, int nHeight )
+{
+	uint32_t unMipLevels = 1;
+	while ( nWidth > 1 && nHeight > 1 )
+	{
+		nWidth /= 2;
+		nHeight /= 2;
+		unMipLevels++;
+	}
+	return unMipLevels;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Records the blits that fill mip levels 1 and up of an image from
+//          its level 0, which has just been copied in. Every level starts in
+//          TRANSFER_DST_OPTIMAL and ends in SHADER_READ_ONLY_OPTIMAL.
+//-----------------------------------------------------------------------------
+static void GenerateMipChainOnGpu( VkCommandBuffer pCommandBuffer, VkImage pImage, int nWidth, int nHeight, uint32_t unMipLevels )
+{
+	VkImageMemoryBarrier imageMemoryBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+	imageMemoryBarrier.image = pImage;
+	imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageMemoryBarrier.subresourceRange.levelCount = 1;
+	imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+	imageMemoryBarrier.subresourceRange.layerCount = 1;
 
+	for ( uint32_t unLevel = 1; unLevel < unMipLevels; unLevel++ )
+	{
+		// The level above is complete, read it as the blit source
+		imageMemoryBarrier.subresourceRange.baseMipLevel = unLevel - 1;
+		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		vkCmdPipelineBarrier( pCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+
+		int nMipWidth = nWidth / 2 > 0 ? nWidth / 2 : 1;
+		int nMipHeight = nHeight / 2 > 0 ? nHeight / 2 : 1;
+
+		VkImageBlit imageBlit = {};
+		imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		imageBlit.srcSubresource.mipLevel = unLevel - 1;
+		imageBlit.srcSubresource.layerCount = 1;
+		imageBlit.srcOffsets[ 1 ].x = nWidth;
+		imageBlit.srcOffsets[ 1 ].y = nHeight;
+		imageBlit.srcOffsets[ 1 ].z = 1;
+		imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		imageBlit.dstSubresource.mipLevel = unLevel;
+		imageBlit.dstSubresource.layerCount = 1;
+		imageBlit.dstOffsets[ 1 ].x = nMipWidth;
+		imageBlit.dstOffsets[ 1 ].y = nMipHeight;
+		imageBlit.dstOffsets[ 1 ].z = 1;
+		vkCmdBlitImage( pCommandBuffer, pImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, pImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlit, VK_FILTER_LINEAR );
+
+		// Nothing else reads the source level, hand it to the fragment shader
+		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		vkCmdPipelineBarrier( pCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+
+		nWidth = nMipWidth;
+		nHeight = nMipHeight;
 	}
-	return true;
+
+	// The last level was only ever written
+	imageMemoryBarrier.subresourceRange.baseMipLevel = unMipLevels - 1;
+	imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier( pCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
 }
 
 
@@ -471,14 +1231,20 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 	, m_bVerbose( false )
 	, m_bPerf( false )
 	, m_bVblank( false )
+	, m_bEyeRecordThreads( true )
+	, m_bLateLatch( false )
+	, m_bCulling( true )
+	, m_bShadingRateImage( false )
+	, m_bBindless( false )
 	, m_nMSAASampleCount( 4 )
 	, m_flSuperSampleScale( 1.0f )
+	, m_unCompanionInterval( 1 )
+	, m_bCompanionFrame( false )
 	, m_iTrackedControllerCount( 0 )
 	, m_iTrackedControllerCount_Last( -1 )
 	, m_iValidPoseCount( 0 )
 	, m_iValidPoseCount_Last( -1 )
 	, m_iSceneVolumeInit( 20 )
-	, m_strPoseClasses("")
 	, m_bShowCubes( true )
 	, m_pInstance( VK_NULL_HANDLE )
 	, m_pDevice( VK_NULL_HANDLE )
@@ -486,37 +1252,68 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 	, m_pQueue( VK_NULL_HANDLE )
 	, m_pSurface( VK_NULL_HANDLE )
 	, m_pSwapchain( VK_NULL_HANDLE )
+	, m_bGenerateMipsOnGpu( false )
 	, m_pDebugReportCallback( VK_NULL_HANDLE )
 	, m_pCommandPool( VK_NULL_HANDLE )
 	, m_pDescriptorPool( VK_NULL_HANDLE )
 	, m_nSwapQueueImageCount( 0 )
 	, m_nFrameIndex( 0 )
 	, m_nCurrentSwapchainImage( 0 )
+	, m_nFramesInFlight( 2 )
+	, m_nFrameSlot( 0 )
+	, m_bQuitEyeRecordThreads( false )
+	, m_bIsInputAvailable( false )
 	, m_pSceneVertexBuffer( VK_NULL_HANDLE )
-	, m_pSceneVertexBufferMemory( VK_NULL_HANDLE )
+	, m_sceneVertexBufferAllocation()
 	, m_pSceneVertexBufferView( VK_NULL_HANDLE )
 	, m_pSceneImage( VK_NULL_HANDLE )
-	, m_pSceneImageMemory( VK_NULL_HANDLE )
+	, m_sceneImageAllocation()
 	, m_pSceneImageView( VK_NULL_HANDLE )
-	, m_pSceneStagingBuffer( VK_NULL_HANDLE )
-	, m_pSceneStagingBufferMemory( VK_NULL_HANDLE )
 	, m_pSceneSampler( VK_NULL_HANDLE )
+	, m_pBindlessDescriptorSetLayout( VK_NULL_HANDLE )
+	, m_pBindlessPipelineLayout( VK_NULL_HANDLE )
+	, m_pBindlessDescriptorPool( VK_NULL_HANDLE )
+	, m_pBindlessSampler( VK_NULL_HANDLE )
 	, m_pDescriptorSetLayout( VK_NULL_HANDLE )
 	, m_pPipelineLayout( VK_NULL_HANDLE )
 	, m_pPipelineCache( VK_NULL_HANDLE )
 	, m_pCompanionWindowVertexBuffer( VK_NULL_HANDLE )
-	, m_pCompanionWindowVertexBufferMemory( VK_NULL_HANDLE )
+	, m_companionWindowVertexBufferAllocation()
 	, m_pCompanionWindowIndexBuffer( VK_NULL_HANDLE )
-	, m_pCompanionWindowIndexBufferMemory( VK_NULL_HANDLE )
-	, m_pControllerAxesVertexBuffer( VK_NULL_HANDLE )
-	, m_pControllerAxesVertexBufferMemory( VK_NULL_HANDLE )
+	, m_companionWindowIndexBufferAllocation()
+	, m_pTimestampQueryPool( VK_NULL_HANDLE )
+	, m_unTimingFrame( 0 )
+	, m_pTimingCsv( NULL )
+	, m_unFrameTimingTitleTicks( 0 )
+	, m_flDisplayFrequency( 90.0f )
+	, m_flSecondsFromVsyncToPhotons( 0.0f )
+	, m_ulPosesCounter( 0 )
 {
 	memset( &m_leftEyeDesc, 0, sizeof( m_leftEyeDesc ) );
 	memset( &m_rightEyeDesc, 0, sizeof( m_rightEyeDesc ) );
 	memset( &m_pShaderModules[ 0 ], 0, sizeof( m_pShaderModules ) );
 	memset( &m_pPipelines[ 0 ], 0, sizeof( m_pPipelines ) );
+	memset( m_rFrameCommandBuffers, 0, sizeof( m_rFrameCommandBuffers ) );
+	memset( m_pSceneConstantBuffer, 0, sizeof( m_pSceneConstantBuffer ) );
+	memset( m_sceneConstantBufferAllocations, 0, sizeof( m_sceneConstantBufferAllocations ) );
+	memset( m_pControllerAxesVertexBuffer, 0, sizeof( m_pControllerAxesVertexBuffer ) );
+	memset( m_controllerAxesVertexBufferAllocations, 0, sizeof( m_controllerAxesVertexBufferAllocations ) );
 	memset( m_pSceneConstantBufferData, 0, sizeof( m_pSceneConstantBufferData ) );
 	memset( m_pDescriptorSets, 0, sizeof( m_pDescriptorSets ) );
+	memset( &m_frameTimingSums, 0, sizeof( m_frameTimingSums ) );
+	memset( m_rLateLatch, 0, sizeof( m_rLateLatch ) );
+	memset( m_rEyeRecordThreads, 0, sizeof( m_rEyeRecordThreads ) );
+	memset( m_rpShadingRateImage, 0, sizeof( m_rpShadingRateImage ) );
+	memset( m_pBindlessDescriptorSets, 0, sizeof( m_pBindlessDescriptorSets ) );
+	memset( m_pBindlessMatrixBuffer, 0, sizeof( m_pBindlessMatrixBuffer ) );
+	memset( m_bindlessMatrixBufferAllocations, 0, sizeof( m_bindlessMatrixBufferAllocations ) );
+	memset( m_pBindlessMatrixData, 0, sizeof( m_pBindlessMatrixData ) );
+	memset( m_rpBindlessImageViews, 0, sizeof( m_rpBindlessImageViews ) );
+	memset( m_rShadingRateImageAllocations, 0, sizeof( m_rShadingRateImageAllocations ) );
+	memset( m_rpShadingRateImageView, 0, sizeof( m_rpShadingRateImageView ) );
+	m_shadingRateTexelSize.width = 16;
+	m_shadingRateTexelSize.height = 16;
+	Foveation_InitSettings( &m_foveation );
 
 	for( int i = 1; i < argc; i++ )
 	{
@@ -532,6 +1329,45 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 		{
 			m_bVblank = false;
 		}
+		else if( !stricmp( argv[i], "-norecordthreads" ) )
+		{
+			m_bEyeRecordThreads = false;
+		}
+		else if( !stricmp( argv[i], "-latelatch" ) )
+		{
+			m_bLateLatch = true;
+		}
+		else if( !stricmp( argv[i], "-noculling" ) )
+		{
+			m_bCulling = false;
+		}
+		else if( !stricmp( argv[i], "-bindless" ) )
+		{
+			m_bBindless = true;
+		}
+		else if( !stricmp( argv[i], "-nocompanion" ) )
+		{
+			m_unCompanionInterval = 0;
+		}
+		else if ( !stricmp( argv[i], "-companioninterval" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
+		{
+			int nInterval = atoi( argv[ i + 1 ] );
+			m_unCompanionInterval = nInterval > 0 ? ( uint32_t )nInterval : 0;
+			i++;
+		}
+		else if ( !stricmp( argv[i], "-companionscale" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
+		{
+			// shrinks the window, and the swapchain with it, never grows it
+			float flScale = ( float )atof( argv[ i + 1 ] );
+			if ( flScale > 0.0f && flScale < 1.0f )
+			{
+				uint32_t nWidth = ( uint32_t )( flScale * m_nCompanionWindowWidth );
+				uint32_t nHeight = ( uint32_t )( flScale * m_nCompanionWindowHeight );
+				m_nCompanionWindowWidth = nWidth ? nWidth : 1;
+				m_nCompanionWindowHeight = nHeight ? nHeight : 1;
+			}
+			i++;
+		}
 		else if ( !stricmp( argv[i], "-msaa" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
 		{
 			m_nMSAASampleCount = atoi( argv[ i + 1 ] );
@@ -551,9 +1387,25 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 			m_iSceneVolumeInit = atoi( argv[ i + 1 ] );
 			i++;
 		}
+		else if ( !stricmp( argv[i], "-timingcsv" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
+		{
+			m_strTimingCsvPath = argv[ i + 1 ];
+			i++;
+		}
+		else if ( !stricmp( argv[i], "-framesinflight" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
+		{
+			int nFramesInFlight = atoi( argv[ i + 1 ] );
+			m_nFramesInFlight = ( uint32_t )( nFramesInFlight < 1 ? 1 : ( nFramesInFlight > ( int ) k_unMaxFramesInFlight ? k_unMaxFramesInFlight : nFramesInFlight ) );
+			i++;
+		}
+		else if ( Foveation_ParseArg( argc, argv, &i, &m_foveation ) )
+		{
+			// consumed along with its values
+		}
 	}
 	// other initialization tasks are done in BInit
 	memset( m_rDevClassChar, 0, sizeof( m_rDevClassChar ) );
+	memset( m_rchPoseClasses, 0, sizeof( m_rchPoseClasses ) );
 };
 
 //-----------------------------------------------------------------------------
@@ -620,7 +1472,7 @@ bool CMainApplication::BInit()
 
 	int nWindowPosX = 700;
 	int nWindowPosY = 100;
-	Uint32 unWindowFlags = SDL_WINDOW_SHOWN;
+	Uint32 unWindowFlags = m_unCompanionInterval ? SDL_WINDOW_SHOWN : SDL_WINDOW_HIDDEN;
 
 	m_pCompanionWindow = SDL_CreateWindow( "hellovr [Vulkan]", nWindowPosX, nWindowPosY, m_nCompanionWindowWidth, m_nCompanionWindowHeight, unWindowFlags );
 	if (m_pCompanionWindow == NULL)
@@ -635,8 +1487,14 @@ bool CMainApplication::BInit()
 	m_strDriver = GetTrackedDeviceString( m_pHMD, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_TrackingSystemName_String );
 	m_strDisplay = GetTrackedDeviceString( m_pHMD, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SerialNumber_String );
 
-	std::string strWindowTitle = "hellovr [Vulkan] - " + m_strDriver + " " + m_strDisplay;
-	SDL_SetWindowTitle( m_pCompanionWindow, strWindowTitle.c_str() );
+	m_strWindowTitle = "hellovr [Vulkan] - " + m_strDriver + " " + m_strDisplay;
+	SDL_SetWindowTitle( m_pCompanionWindow, m_strWindowTitle.c_str() );
+
+	// what -latelatch predicts the HMD pose with
+	float flDisplayFrequency = m_pHMD->GetFloatTrackedDeviceProperty( vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float );
+	if ( flDisplayFrequency > 0.0f )
+		m_flDisplayFrequency = flDisplayFrequency;
+	m_flSecondsFromVsyncToPhotons = m_pHMD->GetFloatTrackedDeviceProperty( vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SecondsFromVsyncToPhotons_Float );
 	
 	// cube array
 	m_iSceneVolumeWidth = m_iSceneVolumeInit;
@@ -650,6 +1508,7 @@ bool CMainApplication::BInit()
 	m_fFarClip = 30.0f;
 
 	m_uiVertcount = 0;
+	m_uiCubeVertcount = 0;
 	m_uiCompanionWindowIndexSize = 0;
 
 	if ( !BInitVulkan() )
@@ -664,6 +1523,9 @@ bool CMainApplication::BInit()
 		return false;
 	}
 
+	for ( vr::TrackedDeviceIndex_t unDevice = 0; unDevice < vr::k_unMaxTrackedDeviceCount; unDevice++ )
+		UpdateTrackedDeviceClass( unDevice );
+
 	return true;
 }
 
@@ -831,6 +1693,14 @@ bool CMainApplication::BInitVulkanInstance()
 		}
 	}
 
+#ifdef VK_NV_shading_rate_image
+	// VK_NV_shading_rate_image depends on it, and its features and texel size are queried through it
+	if ( m_foveation.m_bEnabled )
+	{
+		requiredInstanceExtensions.push_back( VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME );
+	}
+#endif
+
 	uint32_t nInstanceExtensionCount = 0;
 	nResult = vkEnumerateInstanceExtensionProperties( NULL, &nInstanceExtensionCount, NULL );
 	if ( nResult != VK_SUCCESS )
@@ -972,6 +1842,21 @@ bool CMainApplication::BInitVulkanDevice()
 	vkGetPhysicalDeviceMemoryProperties( m_pPhysicalDevice, &m_physicalDeviceMemoryProperties );
 	vkGetPhysicalDeviceFeatures( m_pPhysicalDevice, &m_physicalDeviceFeatures );
 
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties( m_pPhysicalDevice, VK_FORMAT_R8G8B8A8_UNORM, &formatProperties );
+	const VkFormatFeatureFlags nMipBlitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	m_bGenerateMipsOnGpu = ( formatProperties.optimalTilingFeatures & nMipBlitFeatures ) == nMipBlitFeatures;
+
+	// -bindless indexes a texture per tracked device with a dynamically uniform push constant
+	if ( m_bBindless && ( !m_physicalDeviceFeatures.shaderSampledImageArrayDynamicIndexing ||
+		m_physicalDeviceProperties.limits.maxPerStageDescriptorSampledImages < vr::k_unMaxTrackedDeviceCount ||
+		m_physicalDeviceProperties.limits.maxDescriptorSetSampledImages < vr::k_unMaxTrackedDeviceCount ||
+		m_physicalDeviceProperties.limits.maxUniformBufferRange < sizeof( Matrix4 ) * vr::k_unMaxTrackedDeviceCount ) )
+	{
+		dprintf( "Device can't index %u render model textures, -bindless disabled\n", vr::k_unMaxTrackedDeviceCount );
+		m_bBindless = false;
+	}
+
 	//--------------------//
 	// VkDevice creation  //
 	//--------------------//
@@ -980,6 +1865,12 @@ bool CMainApplication::BInitVulkanDevice()
 	GetVulkanDeviceExtensionsRequired( m_pPhysicalDevice, requiredDeviceExtensions );
 	// Add additional required extensions
 	requiredDeviceExtensions.push_back( VK_KHR_SWAPCHAIN_EXTENSION_NAME );
+#ifdef VK_NV_shading_rate_image
+	if ( m_foveation.m_bEnabled )
+	{
+		requiredDeviceExtensions.push_back( VK_NV_SHADING_RATE_IMAGE_EXTENSION_NAME );
+	}
+#endif
 
 	// Find the first graphics queue
 	uint32_t nQueueCount = 0;
@@ -1065,6 +1956,37 @@ bool CMainApplication::BInitVulkanDevice()
 	deviceCreateInfo.ppEnabledExtensionNames = ppDeviceExtensionNames;
 	deviceCreateInfo.pEnabledFeatures = &m_physicalDeviceFeatures;
 
+#ifdef VK_NV_shading_rate_image
+	// -foveate only takes effect if the extension was enabled and the device has the feature
+	VkPhysicalDeviceShadingRateImageFeaturesNV shadingRateImageFeatures = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADING_RATE_IMAGE_FEATURES_NV };
+	bool bShadingRateImageExt = false;
+	for ( uint32_t nExt = 0; nExt < nEnabledDeviceExtensionCount; nExt++ )
+	{
+		bShadingRateImageExt = bShadingRateImageExt || strcmp( ppDeviceExtensionNames[ nExt ], VK_NV_SHADING_RATE_IMAGE_EXTENSION_NAME ) == 0;
+	}
+	PFN_vkGetPhysicalDeviceFeatures2KHR pfnGetPhysicalDeviceFeatures2 = ( PFN_vkGetPhysicalDeviceFeatures2KHR ) vkGetInstanceProcAddr( m_pInstance, "vkGetPhysicalDeviceFeatures2KHR" );
+	PFN_vkGetPhysicalDeviceProperties2KHR pfnGetPhysicalDeviceProperties2 = ( PFN_vkGetPhysicalDeviceProperties2KHR ) vkGetInstanceProcAddr( m_pInstance, "vkGetPhysicalDeviceProperties2KHR" );
+	if ( bShadingRateImageExt && pfnGetPhysicalDeviceFeatures2 && pfnGetPhysicalDeviceProperties2 )
+	{
+		VkPhysicalDeviceFeatures2KHR features2 = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR };
+		features2.pNext = &shadingRateImageFeatures;
+		pfnGetPhysicalDeviceFeatures2( m_pPhysicalDevice, &features2 );
+
+		VkPhysicalDeviceShadingRateImagePropertiesNV shadingRateImageProperties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADING_RATE_IMAGE_PROPERTIES_NV };
+		VkPhysicalDeviceProperties2KHR properties2 = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR };
+		properties2.pNext = &shadingRateImageProperties;
+		pfnGetPhysicalDeviceProperties2( m_pPhysicalDevice, &properties2 );
+
+		m_bShadingRateImage = shadingRateImageFeatures.shadingRateImage == VK_TRUE;
+		m_shadingRateTexelSize = shadingRateImageProperties.shadingRateTexelSize;
+	}
+	if ( m_bShadingRateImage )
+	{
+		shadingRateImageFeatures.shadingRateCoarseSampleOrder = VK_FALSE;
+		deviceCreateInfo.pNext = &shadingRateImageFeatures;
+	}
+#endif
+
 	nResult = vkCreateDevice( m_pPhysicalDevice, &deviceCreateInfo, nullptr, &m_pDevice );
 	if ( nResult != VK_SUCCESS )
 	{
@@ -1072,6 +1994,14 @@ bool CMainApplication::BInitVulkanDevice()
 		return false;
 	}
 
+#ifdef VK_NV_shading_rate_image
+	if ( m_bShadingRateImage )
+	{
+		g_pVkCmdBindShadingRateImageNV = ( PFN_vkCmdBindShadingRateImageNV ) vkGetDeviceProcAddr( m_pDevice, "vkCmdBindShadingRateImageNV" );
+		m_bShadingRateImage = g_pVkCmdBindShadingRateImageNV != nullptr;
+	}
+#endif
+
 	// Get the device queue
 	vkGetDeviceQueue( m_pDevice, m_nQueueFamilyIndex, 0, &m_pQueue );
 	return true;
@@ -1419,6 +2349,10 @@ bool CMainApplication::BInitVulkan()
 
 	VkResult nResult;
 
+	m_memoryAllocator.Init( m_pDevice, m_physicalDeviceMemoryProperties, m_physicalDeviceProperties.limits );
+	if ( !m_stagingRing.BInit( m_pDevice, &m_memoryAllocator, k_nStagingRingSize ) )
+		return false;
+
 	// Create the command pool
 	{
 		VkCommandPoolCreateInfo commandPoolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
@@ -1432,6 +2366,18 @@ bool CMainApplication::BInitVulkan()
 		}
 	}
 
+	if ( !BInitFrameTiming() )
+		return false;
+
+	if ( !BInitEyeRecordThreads() )
+		return false;
+
+	// Frame command buffers start with their fence signalled so the first wait on each returns at once
+	for ( uint32_t nFrame = 0; nFrame < m_nFramesInFlight; nFrame++ )
+	{
+		m_rFrameCommandBuffers[ nFrame ] = CreateCommandBuffer( true );
+	}
+
 	// Command buffer used during resource loading
 	m_currentCommandBuffer = GetCommandBuffer();
 	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
@@ -1456,6 +2402,7 @@ bool CMainApplication::BInitVulkan()
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &m_currentCommandBuffer.m_pCommandBuffer;
 	vkQueueSubmit( m_pQueue, 1, &submitInfo, m_currentCommandBuffer.m_pFence );
+	m_currentCommandBuffer.m_nStagingSubmission = m_stagingRing.EndSubmission();
 	m_commandBuffers.push_front( m_currentCommandBuffer );
 
 	m_currentCommandBuffer.m_pCommandBuffer = VK_NULL_HANDLE;
@@ -1496,6 +2443,17 @@ void CMainApplication::Shutdown()
 		vkDeviceWaitIdle( m_pDevice );
 	}
 
+	ShutdownEyeRecordThreads();
+
+	for( uint32_t unTrackedDevice = 0; unTrackedDevice < vr::k_unMaxTrackedDeviceCount; unTrackedDevice++ )
+	{
+		if( m_rPendingRenderModel[ unTrackedDevice ].m_pModel )
+		{
+			vr::VRRenderModels()->FreeRenderModel( m_rPendingRenderModel[ unTrackedDevice ].m_pModel );
+			m_rPendingRenderModel[ unTrackedDevice ].m_pModel = NULL;
+		}
+	}
+
 	if( m_pHMD )
 	{
 		vr::VR_Shutdown();
@@ -1508,6 +2466,12 @@ void CMainApplication::Shutdown()
 	}
 	m_vecRenderModels.clear();
 
+	if ( m_pTimingCsv )
+	{
+		fclose( m_pTimingCsv );
+		m_pTimingCsv = NULL;
+	}
+
 	if ( m_pDevice != VK_NULL_HANDLE )
 	{
 		for( std::deque< VulkanCommandBuffer_t >::iterator i = m_commandBuffers.begin(); i != m_commandBuffers.end(); i++ )
@@ -1515,9 +2479,21 @@ void CMainApplication::Shutdown()
 			vkFreeCommandBuffers( m_pDevice, m_pCommandPool, 1, &i->m_pCommandBuffer );
 			vkDestroyFence( m_pDevice, i->m_pFence, nullptr );
 		}
+		for ( uint32_t nFrame = 0; nFrame < m_nFramesInFlight; nFrame++ )
+		{
+			vkFreeCommandBuffers( m_pDevice, m_pCommandPool, 1, &m_rFrameCommandBuffers[ nFrame ].m_pCommandBuffer );
+			vkDestroyFence( m_pDevice, m_rFrameCommandBuffers[ nFrame ].m_pFence, nullptr );
+		}
 
 		vkDestroyCommandPool( m_pDevice, m_pCommandPool, nullptr );
+		for ( uint32_t nEye = 0; nEye < _countof( m_rEyeRecordThreads ); nEye++ )
+		{
+			// destroying the pool frees the secondary buffers allocated from it
+			vkDestroyCommandPool( m_pDevice, m_rEyeRecordThreads[ nEye ].m_pCommandPool, nullptr );
+		}
 		vkDestroyDescriptorPool( m_pDevice, m_pDescriptorPool, nullptr );
+		vkDestroyDescriptorPool( m_pDevice, m_pBindlessDescriptorPool, nullptr );
+		vkDestroyQueryPool( m_pDevice, m_pTimestampQueryPool, nullptr );
 
 		FramebufferDesc *pFramebufferDescs[2] = { &m_leftEyeDesc, &m_rightEyeDesc };
 		for ( int32_t nFramebuffer = 0; nFramebuffer < 2; nFramebuffer++ )
@@ -1526,10 +2502,10 @@ void CMainApplication::Shutdown()
 			{
 				vkDestroyImageView( m_pDevice, pFramebufferDescs[ nFramebuffer ]->m_pImageView, nullptr );
 				vkDestroyImage( m_pDevice, pFramebufferDescs[ nFramebuffer ]->m_pImage, nullptr );
-				vkFreeMemory( m_pDevice, pFramebufferDescs[ nFramebuffer ]->m_pDeviceMemory, nullptr );
+				m_memoryAllocator.Free( &pFramebufferDescs[ nFramebuffer ]->m_allocation );
 				vkDestroyImageView( m_pDevice, pFramebufferDescs[ nFramebuffer ]->m_pDepthStencilImageView, nullptr );
 				vkDestroyImage( m_pDevice, pFramebufferDescs[ nFramebuffer ]->m_pDepthStencilImage, nullptr );
-				vkFreeMemory( m_pDevice, pFramebufferDescs[ nFramebuffer ]->m_pDepthStencilDeviceMemory, nullptr );
+				m_memoryAllocator.Free( &pFramebufferDescs[ nFramebuffer ]->m_depthStencilAllocation );
 				vkDestroyRenderPass( m_pDevice, pFramebufferDescs[ nFramebuffer ]->m_pRenderPass, nullptr );
 				vkDestroyFramebuffer( m_pDevice, pFramebufferDescs[ nFramebuffer ]->m_pFramebuffer, nullptr );
 			}
@@ -1537,28 +2513,52 @@ void CMainApplication::Shutdown()
 
 		vkDestroyImageView( m_pDevice, m_pSceneImageView, nullptr );
 		vkDestroyImage( m_pDevice, m_pSceneImage, nullptr );
-		vkFreeMemory( m_pDevice, m_pSceneImageMemory, nullptr );
-		vkDestroyBuffer( m_pDevice, m_pSceneStagingBuffer, nullptr );
-		vkFreeMemory( m_pDevice, m_pSceneStagingBufferMemory, nullptr );
+		m_memoryAllocator.Free( &m_sceneImageAllocation );
 		vkDestroySampler( m_pDevice, m_pSceneSampler, nullptr );
+		vkDestroySampler( m_pDevice, m_pBindlessSampler, nullptr );
+		for ( uint32_t nFrame = 0; nFrame < k_unMaxFramesInFlight; nFrame++ )
+		{
+			for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+			{
+				vkDestroyBuffer( m_pDevice, m_pBindlessMatrixBuffer[ nFrame ][ nEye ], nullptr );
+				m_memoryAllocator.Free( &m_bindlessMatrixBufferAllocations[ nFrame ][ nEye ] );
+			}
+		}
+		for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+		{
+			vkDestroyImageView( m_pDevice, m_rpShadingRateImageView[ nEye ], nullptr );
+			vkDestroyImage( m_pDevice, m_rpShadingRateImage[ nEye ], nullptr );
+			m_memoryAllocator.Free( &m_rShadingRateImageAllocations[ nEye ] );
+		}
 		vkDestroyBuffer( m_pDevice, m_pSceneVertexBuffer, nullptr );
-		vkFreeMemory( m_pDevice, m_pSceneVertexBufferMemory, nullptr );
-		for ( uint32_t nEye = 0; nEye < _countof( m_pSceneConstantBuffer); nEye++ )
+		m_memoryAllocator.Free( &m_sceneVertexBufferAllocation );
+		for ( uint32_t nFrame = 0; nFrame < k_unMaxFramesInFlight; nFrame++ )
 		{
-			vkDestroyBuffer( m_pDevice, m_pSceneConstantBuffer[ nEye ], nullptr );
-			vkFreeMemory( m_pDevice, m_pSceneConstantBufferMemory[ nEye ], nullptr );
+			for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+			{
+				vkDestroyBuffer( m_pDevice, m_pSceneConstantBuffer[ nFrame ][ nEye ], nullptr );
+				m_memoryAllocator.Free( &m_sceneConstantBufferAllocations[ nFrame ][ nEye ] );
+			}
 		}
 	
 		vkDestroyBuffer( m_pDevice, m_pCompanionWindowVertexBuffer, nullptr );
-		vkFreeMemory( m_pDevice, m_pCompanionWindowVertexBufferMemory, nullptr );
+		m_memoryAllocator.Free( &m_companionWindowVertexBufferAllocation );
 		vkDestroyBuffer( m_pDevice, m_pCompanionWindowIndexBuffer, nullptr );
-		vkFreeMemory( m_pDevice, m_pCompanionWindowIndexBufferMemory, nullptr );
+		m_memoryAllocator.Free( &m_companionWindowIndexBufferAllocation );
 
-		vkDestroyBuffer( m_pDevice, m_pControllerAxesVertexBuffer, nullptr );
-		vkFreeMemory( m_pDevice, m_pControllerAxesVertexBufferMemory, nullptr );
+		for ( uint32_t nFrame = 0; nFrame < k_unMaxFramesInFlight; nFrame++ )
+		{
+			vkDestroyBuffer( m_pDevice, m_pControllerAxesVertexBuffer[ nFrame ], nullptr );
+			m_memoryAllocator.Free( &m_controllerAxesVertexBufferAllocations[ nFrame ] );
+		}
+
+		m_stagingRing.Shutdown();
+		m_memoryAllocator.Shutdown();
 
 		vkDestroyPipelineLayout( m_pDevice, m_pPipelineLayout, nullptr );
 		vkDestroyDescriptorSetLayout( m_pDevice, m_pDescriptorSetLayout, nullptr );
+		vkDestroyPipelineLayout( m_pDevice, m_pBindlessPipelineLayout, nullptr );
+		vkDestroyDescriptorSetLayout( m_pDevice, m_pBindlessDescriptorSetLayout, nullptr );
 		for ( uint32_t nPSO = 0; nPSO < PSO_COUNT; nPSO++ )
 		{
 			vkDestroyPipeline( m_pDevice, m_pPipelines[ nPSO ], nullptr );
@@ -1567,6 +2567,7 @@ void CMainApplication::Shutdown()
 		{
 			vkDestroyShaderModule( m_pDevice, m_pShaderModules[ nShader ], nullptr );
 		}
+		SavePipelineCache();
 		vkDestroyPipelineCache( m_pDevice, m_pPipelineCache, nullptr );
 
 		if ( m_pDebugReportCallback != VK_NULL_HANDLE )
@@ -1673,6 +2674,7 @@ void CMainApplication::ProcessVREvent( const vr::VREvent_t & event )
 	case vr::VREvent_TrackedDeviceActivated:
 		{
 			SetupRenderModelForTrackedDevice( event.trackedDeviceIndex );
+			UpdateTrackedDeviceClass( event.trackedDeviceIndex );
 			dprintf( "Device %u attached. Setting up render model.\n", event.trackedDeviceIndex );
 		}
 		break;
@@ -1696,16 +2698,33 @@ void CMainApplication::RenderFrame()
 {
 	if ( m_pHMD )
 	{
-		m_currentCommandBuffer = GetCommandBuffer();
+		// Wait for the GPU to finish the frame that last used this slot's resources
+		m_currentCommandBuffer = m_rFrameCommandBuffers[ m_nFrameSlot ];
+		vkWaitForFences( m_pDevice, 1, &m_currentCommandBuffer.m_pFence, VK_TRUE, UINT64_MAX );
+		vkResetFences( m_pDevice, 1, &m_currentCommandBuffer.m_pFence );
+		vkResetCommandBuffer( m_currentCommandBuffer.m_pCommandBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT );
+		m_stagingRing.Retire( m_currentCommandBuffer.m_nStagingSubmission );
 
 		// Start the command buffer
 		VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
 		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 		vkBeginCommandBuffer( m_currentCommandBuffer.m_pCommandBuffer, &commandBufferBeginInfo );
 
+		UpdateFrameTiming();
+		WriteGpuTimestamp( k_eGpuTimestamp_FrameStart );
+
+		UpdateRenderModelLoads();
+		UpdateBindlessTextures();
 		UpdateControllerAxes();
 		RenderStereoTargets();
-		RenderCompanionWindow();
+
+		// the mirror, and the swapchain image it is presented from, only every m_unCompanionInterval frames
+		m_bCompanionFrame = m_unCompanionInterval != 0 && m_unTimingFrame % m_unCompanionInterval == 0 && RenderCompanionWindow();
+		TransitionEyesForSubmit();
+		WriteGpuTimestamp( k_eGpuTimestamp_Companion );
+		if ( m_bLateLatch )
+			LateLatchViews();
+		m_unTimingFrame++;
 
 		// End the command buffer
 		vkEndCommandBuffer( m_currentCommandBuffer.m_pCommandBuffer );
@@ -1715,13 +2734,15 @@ void CMainApplication::RenderFrame()
 		VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &m_currentCommandBuffer.m_pCommandBuffer;
-		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.waitSemaphoreCount = m_bCompanionFrame ? 1 : 0;
 		submitInfo.pWaitSemaphores = &m_pSwapchainSemaphores[ m_nFrameIndex ];
 		submitInfo.pWaitDstStageMask = &nWaitDstStageMask;
 		vkQueueSubmit( m_pQueue, 1, &submitInfo, m_currentCommandBuffer.m_pFence );
 
-		// Add the command buffer back for later recycling
-		m_commandBuffers.push_front( m_currentCommandBuffer );
+		// The slot is reused m_nFramesInFlight frames from now
+		m_currentCommandBuffer.m_nStagingSubmission = m_stagingRing.EndSubmission();
+		m_rFrameCommandBuffers[ m_nFrameSlot ] = m_currentCommandBuffer;
+		m_nFrameSlot = ( m_nFrameSlot + 1 ) % m_nFramesInFlight;
 
 		m_currentCommandBuffer.m_pCommandBuffer = VK_NULL_HANDLE;
 		m_currentCommandBuffer.m_pFence = VK_NULL_HANDLE;
@@ -1753,13 +2774,19 @@ void CMainApplication::RenderFrame()
 		vr::VRCompositor()->Submit( vr::Eye_Right, &texture, &bounds );
 	}
 
-	VkPresentInfoKHR presentInfo = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
-	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-	presentInfo.pNext = NULL;
-	presentInfo.swapchainCount = 1;
-	presentInfo.pSwapchains = &m_pSwapchain;
-	presentInfo.pImageIndices = &m_nCurrentSwapchainImage;
-	vkQueuePresentKHR( m_pQueue, &presentInfo );
+	if ( m_bCompanionFrame )
+	{
+		VkPresentInfoKHR presentInfo = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
+		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		presentInfo.pNext = NULL;
+		presentInfo.swapchainCount = 1;
+		presentInfo.pSwapchains = &m_pSwapchain;
+		presentInfo.pImageIndices = &m_nCurrentSwapchainImage;
+		vkQueuePresentKHR( m_pQueue, &presentInfo );
+
+		// the acquire semaphore for the next mirrored frame
+		m_nFrameIndex = ( m_nFrameIndex + 1 ) % m_swapchainImages.size();
+	}
 
 	// Spew out the controller and pose count whenever they change.
 	if ( m_iTrackedControllerCount != m_iTrackedControllerCount_Last || m_iValidPoseCount != m_iValidPoseCount_Last )
@@ -1767,12 +2794,245 @@ void CMainApplication::RenderFrame()
 		m_iValidPoseCount_Last = m_iValidPoseCount;
 		m_iTrackedControllerCount_Last = m_iTrackedControllerCount;
 		
-		dprintf( "PoseCount:%d(%s) Controllers:%d\n", m_iValidPoseCount, m_strPoseClasses.c_str(), m_iTrackedControllerCount );
+		dprintf( "PoseCount:%d(%s) Controllers:%d\n", m_iValidPoseCount, m_rchPoseClasses, m_iTrackedControllerCount );
 	}
 
 	UpdateHMDMatrixPose();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Creates the timestamp query pool and opens the -timingcsv file
+//-----------------------------------------------------------------------------
+bool CMainApplication::BInitFrameTiming()
+{
+	if ( m_physicalDeviceProperties.limits.timestampComputeAndGraphics )
+	{
+		VkQueryPoolCreateInfo queryPoolCreateInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCreateInfo.queryCount = k_unTimingFrameCount * k_eGpuTimestamp_Count;
+		VkResult nResult = vkCreateQueryPool( m_pDevice, &queryPoolCreateInfo, nullptr, &m_pTimestampQueryPool );
+		if ( nResult != VK_SUCCESS )
+		{
+			dprintf( "vkCreateQueryPool returned error %d.", nResult );
+			return false;
+		}
+	}
+	else
+	{
+		dprintf( "Timestamp queries are not supported, GPU times will read as zero.\n" );
+	}
+
+	if ( !m_strTimingCsvPath.empty() )
+	{
+		m_pTimingCsv = fopen( m_strTimingCsvPath.c_str(), "w" );
+		if ( !m_pTimingCsv )
+		{
+			dprintf( "Unable to open %s for writing.\n", m_strTimingCsvPath.c_str() );
+			return false;
+		}
+
+		fprintf( m_pTimingCsv, "frame,left_eye_gpu_ms,right_eye_gpu_ms,companion_gpu_ms,"
+			"compositor_frame,pre_submit_gpu_ms,post_submit_gpu_ms,total_render_gpu_ms,compositor_render_gpu_ms,"
+			"compositor_render_cpu_ms,compositor_idle_cpu_ms,client_frame_interval_ms,submit_frame_ms,"
+			"num_frame_presents,num_mis_presented,num_dropped_frames,reprojection_flags,"
+			"late_latched,late_latch_gpu_started,late_latch_ms,late_latch_degrees,late_latch_mm\n" );
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes a GPU timestamp into the current frame's queries
+//-----------------------------------------------------------------------------
+void CMainApplication::WriteGpuTimestamp( EGpuTimestamp eTimestamp )
+{
+	if ( m_pTimestampQueryPool == VK_NULL_HANDLE )
+		return;
+
+	VkPipelineStageFlagBits nStage = ( eTimestamp == k_eGpuTimestamp_FrameStart ) ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	uint32_t unQuery = ( uint32_t )( m_unTimingFrame % k_unTimingFrameCount ) * k_eGpuTimestamp_Count + eTimestamp;
+	vkCmdWriteTimestamp( m_currentCommandBuffer.m_pCommandBuffer, nStage, m_pTimestampQueryPool, unQuery );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads back the timestamps of the frame whose queries are about to
+//          be reused and resets them in the current command buffer. Frames
+//          the GPU has not finished yet are skipped rather than waited on.
+//-----------------------------------------------------------------------------
+void CMainApplication::UpdateFrameTiming()
+{
+	if ( m_pTimestampQueryPool == VK_NULL_HANDLE )
+	{
+		float rflGpuMs[ k_eGpuTimestamp_Count - 1 ] = {};
+		RecordFrameTiming( m_unTimingFrame, rflGpuMs );
+		return;
+	}
+
+	uint32_t unFirstQuery = ( uint32_t )( m_unTimingFrame % k_unTimingFrameCount ) * k_eGpuTimestamp_Count;
+	if ( m_unTimingFrame >= k_unTimingFrameCount )
+	{
+		uint64_t rulTimestamps[ k_eGpuTimestamp_Count ];
+		if ( vkGetQueryPoolResults( m_pDevice, m_pTimestampQueryPool, unFirstQuery, k_eGpuTimestamp_Count, sizeof( rulTimestamps ), rulTimestamps, sizeof( uint64_t ), VK_QUERY_RESULT_64_BIT ) == VK_SUCCESS )
+		{
+			double flMsPerTick = m_physicalDeviceProperties.limits.timestampPeriod * 1e-6;
+			float rflGpuMs[ k_eGpuTimestamp_Count - 1 ];
+			for ( uint32_t i = 0; i < k_eGpuTimestamp_Count - 1; i++ )
+				rflGpuMs[ i ] = ( float )( ( rulTimestamps[ i + 1 ] - rulTimestamps[ i ] ) * flMsPerTick );
+
+			RecordFrameTiming( m_unTimingFrame - k_unTimingFrameCount, rflGpuMs );
+		}
+	}
+
+	vkCmdResetQueryPool( m_currentCommandBuffer.m_pCommandBuffer, m_pTimestampQueryPool, unFirstQuery, k_eGpuTimestamp_Count );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Pairs a frame's GPU times with the compositor's latest frame
+//          timing, appends them to the -timingcsv file and shows the averages
+//          in the companion window title twice a second.
+//-----------------------------------------------------------------------------
+void CMainApplication::RecordFrameTiming( uint64_t unFrame, const float *pflGpuMs )
+{
+	vr::Compositor_FrameTiming timing;
+	memset( &timing, 0, sizeof( timing ) );
+	timing.m_nSize = sizeof( vr::Compositor_FrameTiming );
+	vr::VRCompositor()->GetFrameTiming( &timing, 1 );
+
+	const LateLatch_t &latch = m_rLateLatch[ unFrame % k_unTimingFrameCount ];
+
+	// the rewrite lands before vkQueueSubmit, so the GPU never starts a latched frame early
+	if ( m_pTimingCsv )
+	{
+		fprintf( m_pTimingCsv, "%llu,%.4f,%.4f,%.4f,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%u,%u,%u,%u,%d,0,%.4f,%.4f,%.4f\n",
+			( unsigned long long )unFrame, pflGpuMs[ 0 ], pflGpuMs[ 1 ], pflGpuMs[ 2 ],
+			timing.m_nFrameIndex, timing.m_flPreSubmitGpuMs, timing.m_flPostSubmitGpuMs, timing.m_flTotalRenderGpuMs, timing.m_flCompositorRenderGpuMs,
+			timing.m_flCompositorRenderCpuMs, timing.m_flCompositorIdleCpuMs, timing.m_flClientFrameIntervalMs, timing.m_flSubmitFrameMs,
+			timing.m_nNumFramePresents, timing.m_nNumMisPresented, timing.m_nNumDroppedFrames, timing.m_nReprojectionFlags,
+			latch.m_bLatched ? 1 : 0, latch.m_flMs, latch.m_flDegrees, latch.m_flMillimeters );
+	}
+
+	m_frameTimingSums.m_unFrames++;
+	for ( uint32_t i = 0; i < k_eGpuTimestamp_Count - 1; i++ )
+		m_frameTimingSums.m_flGpuMs[ i ] += pflGpuMs[ i ];
+	m_frameTimingSums.m_flCompositorGpuMs += timing.m_flCompositorRenderGpuMs;
+	m_frameTimingSums.m_flFrameIntervalMs += timing.m_flClientFrameIntervalMs;
+	m_frameTimingSums.m_unDroppedFrames += timing.m_nNumDroppedFrames;
+	if ( latch.m_bLatched )
+	{
+		m_frameTimingSums.m_unLateLatched++;
+		m_frameTimingSums.m_flLateLatchMs += latch.m_flMs;
+		m_frameTimingSums.m_flLateLatchDegrees += latch.m_flDegrees;
+	}
+
+	uint32_t unTicks = SDL_GetTicks();
+	if ( unTicks - m_unFrameTimingTitleTicks < 500 )
+		return;
+	m_unFrameTimingTitleTicks = unTicks;
+
+	double flFrames = m_frameTimingSums.m_unFrames;
+	char rchTitle[ 512 ];
+	sprintf_s( rchTitle, sizeof( rchTitle ), "%s | GPU L %.2f R %.2f companion %.2f ms | compositor %.2f ms | interval %.2f ms | dropped %u",
+		m_strWindowTitle.c_str(), m_frameTimingSums.m_flGpuMs[ 0 ] / flFrames, m_frameTimingSums.m_flGpuMs[ 1 ] / flFrames, m_frameTimingSums.m_flGpuMs[ 2 ] / flFrames,
+		m_frameTimingSums.m_flCompositorGpuMs / flFrames, m_frameTimingSums.m_flFrameIntervalMs / flFrames, m_frameTimingSums.m_unDroppedFrames );
+	if ( m_bLateLatch && m_frameTimingSums.m_unLateLatched )
+	{
+		double flLatched = m_frameTimingSums.m_unLateLatched;
+		size_t unLength = strlen( rchTitle );
+		sprintf_s( rchTitle + unLength, sizeof( rchTitle ) - unLength, " | late latch %.2f ms %.3f deg",
+			m_frameTimingSums.m_flLateLatchMs / flLatched, m_frameTimingSums.m_flLateLatchDegrees / flLatched );
+	}
+	SDL_SetWindowTitle( m_pCompanionWindow, rchTitle );
+
+	memset( &m_frameTimingSums, 0, sizeof( m_frameTimingSums ) );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns where the pipeline cache for this device and driver lives.
+//          The driver's pipeline cache UUID is part of the name, so a driver
+//          update starts a new cache instead of offering it a stale one.
+//-----------------------------------------------------------------------------
+std::string CMainApplication::GetPipelineCachePath()
+{
+	char rchFileName[ 128 ];
+	int nLength = sprintf_s( rchFileName, sizeof( rchFileName ), "hellovr_vulkan_%04x_%04x_", m_physicalDeviceProperties.vendorID, m_physicalDeviceProperties.deviceID );
+	for ( uint32_t i = 0; i < VK_UUID_SIZE; i++ )
+		nLength += sprintf_s( rchFileName + nLength, sizeof( rchFileName ) - nLength, "%02x", m_physicalDeviceProperties.pipelineCacheUUID[ i ] );
+	sprintf_s( rchFileName + nLength, sizeof( rchFileName ) - nLength, ".pipelinecache" );
+
+	std::string sExecutableDirectory = Path_StripFilename( Path_GetExecutablePath() );
+	return Path_MakeAbsolute( rchFileName, sExecutableDirectory );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Creates the pipeline cache, seeded with the one saved by the last
+//          run when its header matches this device
+//-----------------------------------------------------------------------------
+void CMainApplication::CreatePipelineCache()
+{
+	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = { VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+
+	int nSize = 0;
+	unsigned char *pData = Path_ReadBinaryFile( GetPipelineCachePath(), &nSize );
+	if ( pData )
+	{
+		// Header layout from the spec: length, version, vendor ID, device ID, then the cache UUID
+		const uint32_t unHeaderSize = 16 + VK_UUID_SIZE;
+		uint32_t rHeader[ 4 ];
+		bool bHeaderMatches = nSize >= ( int )unHeaderSize;
+		if ( bHeaderMatches )
+		{
+			memcpy( rHeader, pData, sizeof( rHeader ) );
+			bHeaderMatches = rHeader[ 0 ] >= unHeaderSize && rHeader[ 1 ] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+				rHeader[ 2 ] == m_physicalDeviceProperties.vendorID && rHeader[ 3 ] == m_physicalDeviceProperties.deviceID &&
+				memcmp( pData + 16, m_physicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE ) == 0;
+		}
+
+		if ( bHeaderMatches )
+		{
+			pipelineCacheCreateInfo.initialDataSize = nSize;
+			pipelineCacheCreateInfo.pInitialData = pData;
+		}
+		else
+		{
+			dprintf( "Ignoring pipeline cache saved for a different device or driver.\n" );
+		}
+	}
+
+	VkResult nResult = vkCreatePipelineCache( m_pDevice, &pipelineCacheCreateInfo, NULL, &m_pPipelineCache );
+	if ( nResult != VK_SUCCESS && pipelineCacheCreateInfo.pInitialData )
+	{
+		// A corrupt cache should cost a cold start, not the whole run
+		pipelineCacheCreateInfo.initialDataSize = 0;
+		pipelineCacheCreateInfo.pInitialData = NULL;
+		vkCreatePipelineCache( m_pDevice, &pipelineCacheCreateInfo, NULL, &m_pPipelineCache );
+	}
+
+	delete [] pData;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes the pipeline cache to disk for the next run. The file is
+//          replaced atomically so an interrupted write never leaves a
+//          truncated cache behind.
+//-----------------------------------------------------------------------------
+void CMainApplication::SavePipelineCache()
+{
+	if ( m_pPipelineCache == VK_NULL_HANDLE )
+		return;
+
+	size_t nSize = 0;
+	if ( vkGetPipelineCacheData( m_pDevice, m_pPipelineCache, &nSize, NULL ) != VK_SUCCESS || nSize == 0 )
+		return;
 
-	m_nFrameIndex = ( m_nFrameIndex + 1 ) % m_swapchainImages.size();
+	std::vector< unsigned char > vecData( nSize );
+	if ( vkGetPipelineCacheData( m_pDevice, m_pPipelineCache, &nSize, &vecData[ 0 ] ) != VK_SUCCESS )
+		return;
+
+	std::string strPath = GetPipelineCachePath();
+	if ( !Path_WriteBinaryFileAtomic( strPath, &vecData[ 0 ], ( unsigned )nSize ) )
+	{
+		dprintf( "Unable to save the pipeline cache to %s\n", strPath.c_str() );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -1796,6 +3056,33 @@ bool CMainApplication::CreateAllShaders()
 		"ps"
 	};
 
+	// The -bindless render model shaders read the device index from a push constant:
+	//   binding 0: cbuffer of float4x4 matMVP[ k_unMaxTrackedDeviceCount ] for the eye ( VS )
+	//   binding 1: Texture2D diffuse[ k_unMaxTrackedDeviceCount ] ( PS )
+	//   binding 2: SamplerState ( PS )
+	//   push constant: uint nTrackedDevice, indexing both arrays ( VS and PS )
+	if ( m_bBindless )
+	{
+		for ( int32_t nStage = 0; nStage <= 1 && m_bBindless; nStage++ )
+		{
+			char shaderFileName[ 1024 ];
+			sprintf( shaderFileName, "../shaders/rendermodel_bindless_%s.spv", pStageNames[ nStage ] );
+			std::string shaderPath = Path_MakeAbsolute( shaderFileName, sExecutableDirectory );
+			FILE *fp = fopen( shaderPath.c_str(), "rb" );
+			if ( fp == NULL )
+			{
+				dprintf( "Missing SPIR-V file %s, -bindless disabled\n", shaderPath.c_str() );
+				m_bBindless = false;
+				break;
+			}
+			fclose( fp );
+		}
+		if ( m_bBindless )
+		{
+			pShaderNames[ PSO_RENDERMODEL ] = "rendermodel_bindless";
+		}
+	}
+
 	// Load the SPIR-V into shader modules
 	for ( int32_t nShader = 0; nShader < PSO_COUNT; nShader++ )
 	{
@@ -1879,9 +3166,34 @@ bool CMainApplication::CreateAllShaders()
 		return false;
 	}
 
-	// Create pipeline cache
-	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = { VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
-	vkCreatePipelineCache( m_pDevice, &pipelineCacheCreateInfo, NULL, &m_pPipelineCache );
+	if ( m_bBindless )
+	{
+		// The same bindings as above with an array of textures, plus the device index
+		layoutBindings[ 1 ].descriptorCount = vr::k_unMaxTrackedDeviceCount;
+		nResult = vkCreateDescriptorSetLayout( m_pDevice, &descriptorSetLayoutCreateInfo, nullptr, &m_pBindlessDescriptorSetLayout );
+		if ( nResult != VK_SUCCESS )
+		{
+			dprintf( "vkCreateDescriptorSetLayout failed with error %d\n", nResult );
+			return false;
+		}
+
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof( uint32_t );
+
+		pipelineLayoutCreateInfo.pSetLayouts = &m_pBindlessDescriptorSetLayout;
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+		nResult = vkCreatePipelineLayout( m_pDevice, &pipelineLayoutCreateInfo, nullptr, &m_pBindlessPipelineLayout );
+		if ( nResult != VK_SUCCESS )
+		{
+			dprintf( "vkCreatePipelineLayout failed with error %d\n", nResult );
+			return false;
+		}
+	}
+
+	CreatePipelineCache();
 	
 	// Renderpass for each PSO that is compatible with what it will render to
 	VkRenderPass pRenderPasses[ PSO_COUNT ] =
@@ -1988,6 +3300,25 @@ bool CMainApplication::CreateAllShaders()
 		vpState.viewportCount = 1;
 		vpState.scissorCount = 1;
 
+#ifdef VK_NV_shading_rate_image
+		// The eye passes shade at the rates of the bound image, whose texels index this palette
+		static const VkShadingRatePaletteEntryNV rShadingRates[ k_eFoveationRate_Count ] =
+		{
+			VK_SHADING_RATE_PALETTE_ENTRY_1_INVOCATION_PER_PIXEL_NV,
+			VK_SHADING_RATE_PALETTE_ENTRY_1_INVOCATION_PER_2X2_PIXELS_NV,
+			VK_SHADING_RATE_PALETTE_ENTRY_1_INVOCATION_PER_4X4_PIXELS_NV,
+		};
+		VkShadingRatePaletteNV shadingRatePalette = { k_eFoveationRate_Count, rShadingRates };
+		VkPipelineViewportShadingRateImageStateCreateInfoNV vpShadingRateState = { VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_SHADING_RATE_IMAGE_STATE_CREATE_INFO_NV };
+		vpShadingRateState.shadingRateImageEnable = VK_TRUE;
+		vpShadingRateState.viewportCount = 1;
+		vpShadingRateState.pShadingRatePalettes = &shadingRatePalette;
+		if ( m_bShadingRateImage && nPSO != PSO_COMPANION )
+		{
+			vpState.pNext = &vpShadingRateState;
+		}
+#endif
+
 		VkPipelineShaderStageCreateInfo shaderStages[ 2 ] = { };
 		shaderStages[ 0 ].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shaderStages[ 0 ].stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -1999,7 +3330,7 @@ bool CMainApplication::CreateAllShaders()
 		shaderStages[ 1 ].module = m_pShaderModules[ nPSO * 2 + 1 ];
 		shaderStages[ 1 ].pName = "PSMain";
 
-		pipelineCreateInfo.layout = m_pPipelineLayout;
+		pipelineCreateInfo.layout = ( m_bBindless && nPSO == PSO_RENDERMODEL ) ? m_pBindlessPipelineLayout : m_pPipelineLayout;
 
 		// Set pipeline states
 		pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
@@ -2045,69 +3376,76 @@ bool CMainApplication::CreateAllShaders()
 void CMainApplication::CreateAllDescriptorSets()
 {
 	VkDescriptorPoolSize poolSizes[ 3 ];
-	poolSizes[ 0 ].descriptorCount = NUM_DESCRIPTOR_SETS;
+	poolSizes[ 0 ].descriptorCount = NUM_DESCRIPTOR_SETS * k_unMaxFramesInFlight;
 	poolSizes[ 0 ].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[ 1 ].descriptorCount = NUM_DESCRIPTOR_SETS;
+	poolSizes[ 1 ].descriptorCount = NUM_DESCRIPTOR_SETS * k_unMaxFramesInFlight;
 	poolSizes[ 1 ].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-	poolSizes[ 2 ].descriptorCount = NUM_DESCRIPTOR_SETS;
+	poolSizes[ 2 ].descriptorCount = NUM_DESCRIPTOR_SETS * k_unMaxFramesInFlight;
 	poolSizes[ 2 ].type = VK_DESCRIPTOR_TYPE_SAMPLER;
 
 	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
 	descriptorPoolCreateInfo.flags = 0;
-	descriptorPoolCreateInfo.maxSets = NUM_DESCRIPTOR_SETS;
+	descriptorPoolCreateInfo.maxSets = NUM_DESCRIPTOR_SETS * k_unMaxFramesInFlight;
 	descriptorPoolCreateInfo.poolSizeCount = _countof( poolSizes );
 	descriptorPoolCreateInfo.pPoolSizes = &poolSizes[ 0 ];
 
 	vkCreateDescriptorPool( m_pDevice, &descriptorPoolCreateInfo, nullptr, &m_pDescriptorPool );
 
-	for ( int nDescriptorSet = 0; nDescriptorSet < NUM_DESCRIPTOR_SETS; nDescriptorSet++ )
+	for ( uint32_t nFrame = 0; nFrame < k_unMaxFramesInFlight; nFrame++ )
 	{
-		VkDescriptorSetAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
-		allocInfo.descriptorPool = m_pDescriptorPool;
-		allocInfo.descriptorSetCount = 1;
-		allocInfo.pSetLayouts = &m_pDescriptorSetLayout;
-		vkAllocateDescriptorSets( m_pDevice, &allocInfo, &m_pDescriptorSets[ nDescriptorSet ] );
+		for ( int nDescriptorSet = 0; nDescriptorSet < NUM_DESCRIPTOR_SETS; nDescriptorSet++ )
+		{
+			VkDescriptorSetAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+			allocInfo.descriptorPool = m_pDescriptorPool;
+			allocInfo.descriptorSetCount = 1;
+			allocInfo.pSetLayouts = &m_pDescriptorSetLayout;
+			vkAllocateDescriptorSets( m_pDevice, &allocInfo, &m_pDescriptorSets[ nFrame ][ nDescriptorSet ] );
+		}
 	}
 
-	// Scene descriptor sets
-	for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+	// Scene descriptor sets, one pair per frame in flight
+	for ( uint32_t nFrame = 0; nFrame < k_unMaxFramesInFlight; nFrame++ )
 	{
-		VkDescriptorBufferInfo bufferInfo = {};
-		bufferInfo.buffer = m_pSceneConstantBuffer[ nEye ];
-		bufferInfo.offset = 0;
-		bufferInfo.range = VK_WHOLE_SIZE;
+		for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+		{
+			VkDescriptorBufferInfo bufferInfo = {};
+			bufferInfo.buffer = m_pSceneConstantBuffer[ nFrame ][ nEye ];
+			bufferInfo.offset = 0;
+			bufferInfo.range = VK_WHOLE_SIZE;
 		
-		VkDescriptorImageInfo imageInfo = {};
-		imageInfo.imageView = m_pSceneImageView;
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			VkDescriptorImageInfo imageInfo = {};
+			imageInfo.imageView = m_pSceneImageView;
+			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 		
-		VkDescriptorImageInfo samplerInfo = {};
-		samplerInfo.sampler = m_pSceneSampler;
-
-		VkWriteDescriptorSet writeDescriptorSets[ 3 ] = { };
-		writeDescriptorSets[ 0 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[ 0 ].dstSet = m_pDescriptorSets[ DESCRIPTOR_SET_LEFT_EYE_SCENE + nEye ];
-		writeDescriptorSets[ 0 ].dstBinding = 0;
-		writeDescriptorSets[ 0 ].descriptorCount = 1;
-		writeDescriptorSets[ 0 ].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		writeDescriptorSets[ 0 ].pBufferInfo = &bufferInfo;
-		writeDescriptorSets[ 1 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[ 1 ].dstSet = m_pDescriptorSets[ DESCRIPTOR_SET_LEFT_EYE_SCENE + nEye ];
-		writeDescriptorSets[ 1 ].dstBinding = 1;
-		writeDescriptorSets[ 1 ].descriptorCount = 1;
-		writeDescriptorSets[ 1 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-		writeDescriptorSets[ 1 ].pImageInfo = &imageInfo;
-		writeDescriptorSets[ 2 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[ 2 ].dstSet = m_pDescriptorSets[ DESCRIPTOR_SET_LEFT_EYE_SCENE + nEye ];
-		writeDescriptorSets[ 2 ].dstBinding = 2;
-		writeDescriptorSets[ 2 ].descriptorCount = 1;
-		writeDescriptorSets[ 2 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-		writeDescriptorSets[ 2 ].pImageInfo = &samplerInfo;
+			VkDescriptorImageInfo samplerInfo = {};
+			samplerInfo.sampler = m_pSceneSampler;
+
+			VkWriteDescriptorSet writeDescriptorSets[ 3 ] = { };
+			writeDescriptorSets[ 0 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSets[ 0 ].dstSet = m_pDescriptorSets[ nFrame ][ DESCRIPTOR_SET_LEFT_EYE_SCENE + nEye ];
+			writeDescriptorSets[ 0 ].dstBinding = 0;
+			writeDescriptorSets[ 0 ].descriptorCount = 1;
+			writeDescriptorSets[ 0 ].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			writeDescriptorSets[ 0 ].pBufferInfo = &bufferInfo;
+			writeDescriptorSets[ 1 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSets[ 1 ].dstSet = m_pDescriptorSets[ nFrame ][ DESCRIPTOR_SET_LEFT_EYE_SCENE + nEye ];
+			writeDescriptorSets[ 1 ].dstBinding = 1;
+			writeDescriptorSets[ 1 ].descriptorCount = 1;
+			writeDescriptorSets[ 1 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			writeDescriptorSets[ 1 ].pImageInfo = &imageInfo;
+			writeDescriptorSets[ 2 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSets[ 2 ].dstSet = m_pDescriptorSets[ nFrame ][ DESCRIPTOR_SET_LEFT_EYE_SCENE + nEye ];
+			writeDescriptorSets[ 2 ].dstBinding = 2;
+			writeDescriptorSets[ 2 ].descriptorCount = 1;
+			writeDescriptorSets[ 2 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+			writeDescriptorSets[ 2 ].pImageInfo = &samplerInfo;
 		
-		vkUpdateDescriptorSets( m_pDevice, _countof( writeDescriptorSets ), writeDescriptorSets, 0, nullptr );
+			vkUpdateDescriptorSets( m_pDevice, _countof( writeDescriptorSets ), writeDescriptorSets, 0, nullptr );
+		}
 	}
 
 	// Companion window descriptor sets
+	for ( uint32_t nFrame = 0; nFrame < k_unMaxFramesInFlight; nFrame++ )
 	{
 		VkDescriptorImageInfo imageInfo = {};
 		imageInfo.imageView = m_leftEyeDesc.m_pImageView;
@@ -2115,7 +3453,7 @@ void CMainApplication::CreateAllDescriptorSets()
 
 		VkWriteDescriptorSet writeDescriptorSets[ 1 ] = { };
 		writeDescriptorSets[ 0 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[ 0 ].dstSet = m_pDescriptorSets[ DESCRIPTOR_SET_COMPANION_LEFT_TEXTURE ];
+		writeDescriptorSets[ 0 ].dstSet = m_pDescriptorSets[ nFrame ][ DESCRIPTOR_SET_COMPANION_LEFT_TEXTURE ];
 		writeDescriptorSets[ 0 ].dstBinding = 1;
 		writeDescriptorSets[ 0 ].descriptorCount = 1;
 		writeDescriptorSets[ 0 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
@@ -2123,10 +3461,162 @@ void CMainApplication::CreateAllDescriptorSets()
 		vkUpdateDescriptorSets( m_pDevice, _countof( writeDescriptorSets ), writeDescriptorSets, 0, nullptr );
 
 		imageInfo.imageView = m_rightEyeDesc.m_pImageView;
-		writeDescriptorSets[ 0 ].dstSet = m_pDescriptorSets[ DESCRIPTOR_SET_COMPANION_RIGHT_TEXTURE ];
+		writeDescriptorSets[ 0 ].dstSet = m_pDescriptorSets[ nFrame ][ DESCRIPTOR_SET_COMPANION_RIGHT_TEXTURE ];
 		vkUpdateDescriptorSets( m_pDevice, _countof( writeDescriptorSets ), writeDescriptorSets, 0, nullptr );
 	}
-	
+
+	if ( m_bBindless )
+	{
+		CreateBindlessDescriptorSets();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: -bindless. Creates the per eye matrix buffers and descriptor sets of
+//          every frame slot, with the scene texture in the array slots of
+//          devices that have no render model yet.
+//-----------------------------------------------------------------------------
+void CMainApplication::CreateBindlessDescriptorSets()
+{
+	VkDescriptorPoolSize poolSizes[ 3 ];
+	poolSizes[ 0 ].descriptorCount = k_unMaxFramesInFlight * 2;
+	poolSizes[ 0 ].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[ 1 ].descriptorCount = k_unMaxFramesInFlight * 2 * vr::k_unMaxTrackedDeviceCount;
+	poolSizes[ 1 ].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	poolSizes[ 2 ].descriptorCount = k_unMaxFramesInFlight * 2;
+	poolSizes[ 2 ].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+
+	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+	descriptorPoolCreateInfo.flags = 0;
+	descriptorPoolCreateInfo.maxSets = k_unMaxFramesInFlight * 2;
+	descriptorPoolCreateInfo.poolSizeCount = _countof( poolSizes );
+	descriptorPoolCreateInfo.pPoolSizes = &poolSizes[ 0 ];
+	vkCreateDescriptorPool( m_pDevice, &descriptorPoolCreateInfo, nullptr, &m_pBindlessDescriptorPool );
+
+	// One sampler for every render model, whatever its mip count
+	VkSamplerCreateInfo samplerCreateInfo = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+	samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.anisotropyEnable = VK_TRUE;
+	samplerCreateInfo.maxAnisotropy = 16.0f;
+	samplerCreateInfo.minLod = 0.0f;
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+	vkCreateSampler( m_pDevice, &samplerCreateInfo, nullptr, &m_pBindlessSampler );
+
+	VkDescriptorImageInfo imageInfos[ vr::k_unMaxTrackedDeviceCount ];
+	for ( uint32_t unTrackedDevice = 0; unTrackedDevice < vr::k_unMaxTrackedDeviceCount; unTrackedDevice++ )
+	{
+		imageInfos[ unTrackedDevice ].sampler = VK_NULL_HANDLE;
+		imageInfos[ unTrackedDevice ].imageView = m_pSceneImageView;
+		imageInfos[ unTrackedDevice ].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+
+	for ( uint32_t nFrame = 0; nFrame < k_unMaxFramesInFlight; nFrame++ )
+	{
+		for ( uint32_t unTrackedDevice = 0; unTrackedDevice < vr::k_unMaxTrackedDeviceCount; unTrackedDevice++ )
+		{
+			m_rpBindlessImageViews[ nFrame ][ unTrackedDevice ] = m_pSceneImageView;
+		}
+
+		for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+		{
+			VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+			bufferCreateInfo.size = sizeof( Matrix4 ) * vr::k_unMaxTrackedDeviceCount;
+			bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+			vkCreateBuffer( m_pDevice, &bufferCreateInfo, nullptr, &m_pBindlessMatrixBuffer[ nFrame ][ nEye ] );
+
+			if ( !m_memoryAllocator.BAllocateAndBindBuffer( m_pBindlessMatrixBuffer[ nFrame ][ nEye ], VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &m_bindlessMatrixBufferAllocations[ nFrame ][ nEye ] ) )
+			{
+				return;
+			}
+
+			// The allocator keeps the memory mapped persistently
+			m_pBindlessMatrixData[ nFrame ][ nEye ] = ( Matrix4 * )m_bindlessMatrixBufferAllocations[ nFrame ][ nEye ].m_pMappedData;
+
+			VkDescriptorSetAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+			allocInfo.descriptorPool = m_pBindlessDescriptorPool;
+			allocInfo.descriptorSetCount = 1;
+			allocInfo.pSetLayouts = &m_pBindlessDescriptorSetLayout;
+			vkAllocateDescriptorSets( m_pDevice, &allocInfo, &m_pBindlessDescriptorSets[ nFrame ][ nEye ] );
+
+			VkDescriptorBufferInfo bufferInfo = {};
+			bufferInfo.buffer = m_pBindlessMatrixBuffer[ nFrame ][ nEye ];
+			bufferInfo.offset = 0;
+			bufferInfo.range = VK_WHOLE_SIZE;
+
+			VkDescriptorImageInfo samplerInfo = {};
+			samplerInfo.sampler = m_pBindlessSampler;
+
+			VkWriteDescriptorSet writeDescriptorSets[ 3 ] = { };
+			writeDescriptorSets[ 0 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSets[ 0 ].dstSet = m_pBindlessDescriptorSets[ nFrame ][ nEye ];
+			writeDescriptorSets[ 0 ].dstBinding = 0;
+			writeDescriptorSets[ 0 ].descriptorCount = 1;
+			writeDescriptorSets[ 0 ].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			writeDescriptorSets[ 0 ].pBufferInfo = &bufferInfo;
+			writeDescriptorSets[ 1 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSets[ 1 ].dstSet = m_pBindlessDescriptorSets[ nFrame ][ nEye ];
+			writeDescriptorSets[ 1 ].dstBinding = 1;
+			writeDescriptorSets[ 1 ].descriptorCount = vr::k_unMaxTrackedDeviceCount;
+			writeDescriptorSets[ 1 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			writeDescriptorSets[ 1 ].pImageInfo = &imageInfos[ 0 ];
+			writeDescriptorSets[ 2 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSets[ 2 ].dstSet = m_pBindlessDescriptorSets[ nFrame ][ nEye ];
+			writeDescriptorSets[ 2 ].dstBinding = 2;
+			writeDescriptorSets[ 2 ].descriptorCount = 1;
+			writeDescriptorSets[ 2 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+			writeDescriptorSets[ 2 ].pImageInfo = &samplerInfo;
+
+			vkUpdateDescriptorSets( m_pDevice, _countof( writeDescriptorSets ), writeDescriptorSets, 0, nullptr );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: -bindless. Points this frame slot's texture array at the current
+//          render model of each tracked device. The slot's previous frame has
+//          retired, so its sets can be written.
+//-----------------------------------------------------------------------------
+void CMainApplication::UpdateBindlessTextures()
+{
+	if ( !m_bBindless )
+		return;
+
+	VkDescriptorImageInfo imageInfos[ vr::k_unMaxTrackedDeviceCount ];
+	VkWriteDescriptorSet writeDescriptorSets[ vr::k_unMaxTrackedDeviceCount * 2 ];
+	uint32_t unWriteCount = 0;
+	for ( uint32_t unTrackedDevice = 0; unTrackedDevice < vr::k_unMaxTrackedDeviceCount; unTrackedDevice++ )
+	{
+		VkImageView pImageView = m_rTrackedDeviceToRenderModel[ unTrackedDevice ] ? m_rTrackedDeviceToRenderModel[ unTrackedDevice ]->GetImageView() : m_pSceneImageView;
+		if ( m_rpBindlessImageViews[ m_nFrameSlot ][ unTrackedDevice ] == pImageView )
+			continue;
+		m_rpBindlessImageViews[ m_nFrameSlot ][ unTrackedDevice ] = pImageView;
+
+		VkDescriptorImageInfo &imageInfo = imageInfos[ unTrackedDevice ];
+		imageInfo.sampler = VK_NULL_HANDLE;
+		imageInfo.imageView = pImageView;
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+		{
+			VkWriteDescriptorSet &write = writeDescriptorSets[ unWriteCount++ ];
+			write = VkWriteDescriptorSet();
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = m_pBindlessDescriptorSets[ m_nFrameSlot ][ nEye ];
+			write.dstBinding = 1;
+			write.dstArrayElement = unTrackedDevice;
+			write.descriptorCount = 1;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			write.pImageInfo = &imageInfo;
+		}
+	}
+
+	if ( unWriteCount > 0 )
+	{
+		vkUpdateDescriptorSets( m_pDevice, unWriteCount, writeDescriptorSets, 0, nullptr );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -2137,20 +3627,29 @@ bool CMainApplication::SetupTexturemaps()
 	std::string sExecutableDirectory = Path_StripFilename( Path_GetExecutablePath() );
 	std::string strFullPath = Path_MakeAbsolute( "../cube_texture.png", sExecutableDirectory );
 	
-	std::vector< unsigned char > imageRGBA;
+	std::vector< unsigned char > vecPng;
+	lodepng::load_file( vecPng, strFullPath );
+	lodepng::State pngState;
 	unsigned nImageWidth, nImageHeight;
-	unsigned nError = lodepng::decode( imageRGBA, nImageWidth, nImageHeight, strFullPath.c_str() );
-	
-	if ( nError != 0 )
+	if ( vecPng.empty() || lodepng_inspect( &nImageWidth, &nImageHeight, &pngState, &vecPng[0], vecPng.size() ) != 0 )
 		return false;
-	
-	// Copy the base level to a buffer, reserve space for mips (overreserve by a bit to avoid having to calc mipchain size ahead of time)
-	VkDeviceSize nBufferSize = 0;
-	uint8_t *pBuffer = new uint8_t[ nImageWidth * nImageHeight * 4 * 2 ];
-	uint8_t *pPrevBuffer = pBuffer;
-	uint8_t *pCurBuffer = pBuffer;
-	memcpy( pCurBuffer, &imageRGBA[0], sizeof( uint8_t ) * nImageWidth * nImageHeight * 4 );
-	pCurBuffer += sizeof( uint8_t ) * nImageWidth * nImageHeight * 4;
+
+	// The base level is decoded row by row straight to where it is uploaded from: after it the
+	// CPU mip chain when that is built here (overreserve by a bit to avoid having to calc mipchain
+	// size ahead of time), else the staging memory itself
+	VkDeviceSize nBaseSize = ( VkDeviceSize )nImageWidth * nImageHeight * 4;
+	VkDeviceSize nBufferSize = nBaseSize;
+	uint8_t *pBuffer = nullptr;
+	if ( !m_bGenerateMipsOnGpu )
+	{
+		pBuffer = new uint8_t[ nBaseSize * 2 ];
+		DecodedRowTarget_t target = { pBuffer, nImageWidth * 4 };
+		if ( lodepng::decode_rows( CopyDecodedRow, &target, nImageWidth, nImageHeight, pngState, &vecPng[0], vecPng.size() ) != 0 )
+		{
+			delete [] pBuffer;
+			return false;
+		}
+	}
 
 	std::vector< VkBufferImageCopy > bufferImageCopies;
 	VkBufferImageCopy bufferImageCopy = {};
@@ -2172,18 +3671,25 @@ bool CMainApplication::SetupTexturemaps()
 	int nMipWidth = nImageWidth;
 	int nMipHeight = nImageHeight;
 
-	while( nMipWidth > 1 && nMipHeight > 1 )
+	uint32_t unMipLevels = CountMipLevels( nImageWidth, nImageHeight );
+	if ( !m_bGenerateMipsOnGpu )
 	{
-		GenMipMapRGBA( pPrevBuffer, pCurBuffer, nMipWidth, nMipHeight, &nMipWidth, &nMipHeight );
-		bufferImageCopy.bufferOffset = pCurBuffer - pBuffer;
-		bufferImageCopy.imageSubresource.mipLevel++;
-		bufferImageCopy.imageExtent.width = nMipWidth;
-		bufferImageCopy.imageExtent.height = nMipHeight;
-		bufferImageCopies.push_back( bufferImageCopy );
-		pPrevBuffer = pCurBuffer;
-		pCurBuffer += ( nMipWidth * nMipHeight * 4 * sizeof( uint8_t ) );
+		// Without GPU blits the whole chain is built here and uploaded
+		uint8_t *pPrevBuffer = pBuffer;
+		uint8_t *pCurBuffer = pBuffer + nBaseSize;
+		while( nMipWidth > 1 && nMipHeight > 1 )
+		{
+			GenMipMapRGBA( pPrevBuffer, pCurBuffer, nMipWidth, nMipHeight, &nMipWidth, &nMipHeight );
+			bufferImageCopy.bufferOffset = pCurBuffer - pBuffer;
+			bufferImageCopy.imageSubresource.mipLevel++;
+			bufferImageCopy.imageExtent.width = nMipWidth;
+			bufferImageCopy.imageExtent.height = nMipHeight;
+			bufferImageCopies.push_back( bufferImageCopy );
+			pPrevBuffer = pCurBuffer;
+			pCurBuffer += ( nMipWidth * nMipHeight * 4 * sizeof( uint8_t ) );
+		}
+		nBufferSize = pCurBuffer - pBuffer;
 	}
-	nBufferSize = pCurBuffer - pBuffer;
 
 	// Create the image
 	VkImageCreateInfo imageCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
@@ -2191,23 +3697,19 @@ bool CMainApplication::SetupTexturemaps()
 	imageCreateInfo.extent.width = nImageWidth;
 	imageCreateInfo.extent.height = nImageHeight;
 	imageCreateInfo.extent.depth = 1;
-	imageCreateInfo.mipLevels = ( uint32_t ) bufferImageCopies.size();
+	imageCreateInfo.mipLevels = unMipLevels;
 	imageCreateInfo.arrayLayers = 1;
 	imageCreateInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
 	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-	imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | ( m_bGenerateMipsOnGpu ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0 );
 	imageCreateInfo.flags = 0;
 	vkCreateImage( m_pDevice, &imageCreateInfo, nullptr, &m_pSceneImage );
-
-	VkMemoryRequirements memoryRequirements = {};
-	vkGetImageMemoryRequirements( m_pDevice, m_pSceneImage, &memoryRequirements );
-
-	VkMemoryAllocateInfo memoryAllocateInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
-	memoryAllocateInfo.allocationSize = memoryRequirements.size;
-	MemoryTypeFromProperties( m_physicalDeviceMemoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &memoryAllocateInfo.memoryTypeIndex );
-	vkAllocateMemory( m_pDevice, &memoryAllocateInfo, nullptr, &m_pSceneImageMemory );
-	vkBindImageMemory( m_pDevice, m_pSceneImage, m_pSceneImageMemory, 0 );
+	if ( !m_memoryAllocator.BAllocateAndBindImage( m_pSceneImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_sceneImageAllocation ) )
+	{
+		delete [] pBuffer;
+		return false;
+	}
 
 	VkImageViewCreateInfo imageViewCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
 	imageViewCreateInfo.flags = 0;
@@ -2222,11 +3724,29 @@ bool CMainApplication::SetupTexturemaps()
 	imageViewCreateInfo.subresourceRange.layerCount = 1;
 	vkCreateImageView( m_pDevice, &imageViewCreateInfo, nullptr, &m_pSceneImageView );
 
-	// Create a staging buffer
-	if ( !CreateVulkanBuffer( m_pDevice, m_physicalDeviceMemoryProperties, pBuffer, nBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, &m_pSceneStagingBuffer, &m_pSceneStagingBufferMemory ) )
+	// Copy the mip chain to staging memory, or decode the base level into it
+	VkBuffer pStagingBuffer;
+	VkDeviceSize nStagingOffset;
+	void *pStagingData;
+	if ( !m_stagingRing.BAllocate( nBufferSize, &pStagingBuffer, &nStagingOffset, &pStagingData ) )
 	{
+		delete [] pBuffer;
 		return false;
 	}
+	if ( pBuffer )
+	{
+		memcpy( pStagingData, pBuffer, nBufferSize );
+	}
+	else
+	{
+		DecodedRowTarget_t target = { ( uint8_t * )pStagingData, nImageWidth * 4 };
+		if ( lodepng::decode_rows( CopyDecodedRow, &target, nImageWidth, nImageHeight, pngState, &vecPng[0], vecPng.size() ) != 0 )
+			return false;
+	}
+	for ( size_t nCopy = 0; nCopy < bufferImageCopies.size(); nCopy++ )
+	{
+		bufferImageCopies[ nCopy ].bufferOffset += nStagingOffset;
+	}
 
 	// Transition the image to TRANSFER_DST to receive image
 	VkImageMemoryBarrier imageMemoryBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
@@ -2245,14 +3765,21 @@ bool CMainApplication::SetupTexturemaps()
 	vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
 
 	// Issue the copy to fill the image data
-	vkCmdCopyBufferToImage( m_currentCommandBuffer.m_pCommandBuffer, m_pSceneStagingBuffer, m_pSceneImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ( uint32_t ) bufferImageCopies.size(), &bufferImageCopies[ 0 ] );
+	vkCmdCopyBufferToImage( m_currentCommandBuffer.m_pCommandBuffer, pStagingBuffer, m_pSceneImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ( uint32_t ) bufferImageCopies.size(), &bufferImageCopies[ 0 ] );
 
-	// Transition the image to SHADER_READ_OPTIMAL for reading
-	imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+	if ( m_bGenerateMipsOnGpu )
+	{
+		GenerateMipChainOnGpu( m_currentCommandBuffer.m_pCommandBuffer, m_pSceneImage, nImageWidth, nImageHeight, unMipLevels );
+	}
+	else
+	{
+		// Transition the image to SHADER_READ_OPTIMAL for reading
+		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+	}
 	
 	// Create the sampler
 	VkSamplerCreateInfo samplerCreateInfo = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
@@ -2289,39 +3816,44 @@ void CMainApplication::GenMipMapRGBA( const uint8_t *pSrc, uint8_t *pDst, int nS
 
 	for ( int y = 0; y < *pDstHeightOut; y++ )
 	{
-		for ( int x = 0; x < *pDstWidthOut; x++ )
-		{
-			int nSrcIndex[4];
-			float r = 0.0f;
-			float g = 0.0f;
-			float b = 0.0f;
-			float a = 0.0f;
-
-			nSrcIndex[0] = ( ( ( y * 2 ) * nSrcWidth ) + ( x * 2 ) ) * 4;
-			nSrcIndex[1] = ( ( ( y * 2 ) * nSrcWidth ) + ( x * 2 + 1 ) ) * 4;
-			nSrcIndex[2] = ( ( ( ( y * 2 ) + 1 ) * nSrcWidth ) + ( x * 2 ) ) * 4;
-			nSrcIndex[3] = ( ( ( ( y * 2 ) + 1 ) * nSrcWidth ) + ( x * 2 + 1 ) ) * 4;
+		const uint8_t *pSrcRow0 = pSrc + ( y * 2 ) * nSrcWidth * 4;
+		const uint8_t *pSrcRow1 = pSrcRow0 + nSrcWidth * 4;
+		uint8_t *pDstRow = pDst + y * ( *pDstWidthOut ) * 4;
+		int x = 0;
 
-			// Sum all pixels
-			for ( int nSample = 0; nSample < 4; nSample++ )
+#if defined( HELLOVR_SSE2 )
+		// Four destination pixels at a time: each 2x2 block is summed in 16 bit lanes and divided by 4
+		const __m128i zero = _mm_setzero_si128();
+		for ( ; x + 4 <= *pDstWidthOut; x += 4 )
+		{
+			__m128i rAverage[ 2 ];
+			for ( int nHalf = 0; nHalf < 2; nHalf++ )
 			{
-				r += pSrc[ nSrcIndex[ nSample ] ];
-				g += pSrc[ nSrcIndex[ nSample ] + 1 ];
-				b += pSrc[ nSrcIndex[ nSample ] + 2 ];
-				a += pSrc[ nSrcIndex[ nSample ] + 3 ];
+				int nSrcOffset = ( x * 2 + nHalf * 4 ) * 4;
+				__m128i top = _mm_loadu_si128( ( const __m128i * )( pSrcRow0 + nSrcOffset ) );
+				__m128i bottom = _mm_loadu_si128( ( const __m128i * )( pSrcRow1 + nSrcOffset ) );
+
+				// vertical sums of source pixels 0,1 and 2,3, then add each pixel to its right neighbour
+				__m128i lo = _mm_add_epi16( _mm_unpacklo_epi8( top, zero ), _mm_unpacklo_epi8( bottom, zero ) );
+				__m128i hi = _mm_add_epi16( _mm_unpackhi_epi8( top, zero ), _mm_unpackhi_epi8( bottom, zero ) );
+				lo = _mm_add_epi16( lo, _mm_srli_si128( lo, 8 ) );
+				hi = _mm_add_epi16( hi, _mm_srli_si128( hi, 8 ) );
+				rAverage[ nHalf ] = _mm_srli_epi16( _mm_unpacklo_epi64( lo, hi ), 2 );
 			}
+			_mm_storeu_si128( ( __m128i * )( pDstRow + x * 4 ), _mm_packus_epi16( rAverage[ 0 ], rAverage[ 1 ] ) );
+		}
+#endif
 
-			// Average results
-			r /= 4.0;
-			g /= 4.0;
-			b /= 4.0;
-			a /= 4.0;
-
-			// Store resulting pixels
-			pDst[ ( y * ( *pDstWidthOut ) + x ) * 4 ] = ( uint8_t ) ( r );
-			pDst[ ( y * ( *pDstWidthOut ) + x ) * 4 + 1] = ( uint8_t ) ( g );
-			pDst[ ( y * ( *pDstWidthOut ) + x ) * 4 + 2] = ( uint8_t ) ( b );
-			pDst[ ( y * ( *pDstWidthOut ) + x ) * 4 + 3] = ( uint8_t ) ( a );
+		for ( ; x < *pDstWidthOut; x++ )
+		{
+			const uint8_t *pTop = pSrcRow0 + x * 2 * 4;
+			const uint8_t *pBottom = pSrcRow1 + x * 2 * 4;
+			for ( int nChannel = 0; nChannel < 4; nChannel++ )
+			{
+				// Average of the 2x2 block, truncated
+				int nSum = pTop[ nChannel ] + pTop[ nChannel + 4 ] + pBottom[ nChannel ] + pBottom[ nChannel + 4 ];
+				pDstRow[ x * 4 + nChannel ] = ( uint8_t ) ( nSum >> 2 );
+			}
 		}
 	}
 }
@@ -2334,60 +3866,75 @@ void CMainApplication::SetupScene()
 	if ( !m_pHMD )
 		return;
 
-	std::vector<float> vertdataarray;
+	// The scene shaders are prebuilt SPIR-V without a per instance offset, so the
+	// cubes are still baked into one vertex buffer. Build the cube once and copy
+	// it into every cell with a translation rather than transforming each corner
+	// of every cube by its own matrix. The cells go in bounding volume hierarchy
+	// order, so whatever survives culling is a few contiguous runs of vertices.
+	std::vector<float> cubedataarray;
 
 	Matrix4 matScale;
 	matScale.scale( m_fScale, m_fScale, m_fScale );
-	Matrix4 matTransform;
-	matTransform.translate(
-		-( (float)m_iSceneVolumeWidth * m_fScaleSpacing ) / 2.f,
-		-( (float)m_iSceneVolumeHeight * m_fScaleSpacing ) / 2.f,
-		-( (float)m_iSceneVolumeDepth * m_fScaleSpacing ) / 2.f);
-	
-	Matrix4 mat = matScale * matTransform;
+	AddCubeToScene( matScale, cubedataarray );
+
+	const size_t unCubeFloats = cubedataarray.size();
+	const float flCellSpacing = m_fScaleSpacing * m_fScale;
+	const float flOriginX = -( (float)m_iSceneVolumeWidth * flCellSpacing ) / 2.f;
+	const float flOriginY = -( (float)m_iSceneVolumeHeight * flCellSpacing ) / 2.f;
+	const float flOriginZ = -( (float)m_iSceneVolumeDepth * flCellSpacing ) / 2.f;
+
+	m_sceneBVH.Build( m_iSceneVolumeWidth, m_iSceneVolumeHeight, m_iSceneVolumeDepth, Vector3( flOriginX, flOriginY, flOriginZ ), flCellSpacing, m_fScale, 64 );
+	const std::vector< uint32_t > &vecCellOrder = m_sceneBVH.GetCellOrder();
+
+	std::vector<float> vertdataarray( unCubeFloats * vecCellOrder.size() );
+	float *pVertData = vertdataarray.data();
 
-	for( int z = 0; z< m_iSceneVolumeDepth; z++ )
+	for ( size_t unCell = 0; unCell < vecCellOrder.size(); unCell++ )
 	{
-		for( int y = 0; y< m_iSceneVolumeHeight; y++ )
+		const int x = vecCellOrder[ unCell ] % m_iSceneVolumeWidth;
+		const int y = ( vecCellOrder[ unCell ] / m_iSceneVolumeWidth ) % m_iSceneVolumeHeight;
+		const int z = vecCellOrder[ unCell ] / ( m_iSceneVolumeWidth * m_iSceneVolumeHeight );
+		const float flX = flOriginX + x * flCellSpacing;
+		const float flY = flOriginY + y * flCellSpacing;
+		const float flZ = flOriginZ + z * flCellSpacing;
+		for ( size_t i = 0; i < unCubeFloats; i += 5 )
 		{
-			for( int x = 0; x< m_iSceneVolumeWidth; x++ )
-			{
-				AddCubeToScene( mat, vertdataarray );
-				mat = mat * Matrix4().translate( m_fScaleSpacing, 0, 0 );
-			}
-			mat = mat * Matrix4().translate( -((float)m_iSceneVolumeWidth) * m_fScaleSpacing, m_fScaleSpacing, 0 );
+			pVertData[ 0 ] = cubedataarray[ i + 0 ] + flX;
+			pVertData[ 1 ] = cubedataarray[ i + 1 ] + flY;
+			pVertData[ 2 ] = cubedataarray[ i + 2 ] + flZ;
+			pVertData[ 3 ] = cubedataarray[ i + 3 ];
+			pVertData[ 4 ] = cubedataarray[ i + 4 ];
+			pVertData += 5;
 		}
-		mat = mat * Matrix4().translate( 0, -((float)m_iSceneVolumeHeight) * m_fScaleSpacing, m_fScaleSpacing );
 	}
 	m_uiVertcount = vertdataarray.size()/5;
+	m_uiCubeVertcount = unCubeFloats/5;
 	
 	// Create the vertex buffer and fill with data
-	if ( !CreateVulkanBuffer( m_pDevice, m_physicalDeviceMemoryProperties, &vertdataarray[ 0 ], vertdataarray.size() * sizeof( float ), 
-							  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &m_pSceneVertexBuffer, &m_pSceneVertexBufferMemory ) )
+	if ( !CreateVulkanBuffer( m_pDevice, &m_memoryAllocator, &vertdataarray[ 0 ], vertdataarray.size() * sizeof( float ), 
+							  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &m_pSceneVertexBuffer, &m_sceneVertexBufferAllocation ) )
 	{
 		return;
 	}
 	
-	// Create constant buffer to hold the per-eye CB data
-	for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+	// Create constant buffers to hold the per-eye CB data for each frame in flight
+	for ( uint32_t nFrame = 0; nFrame < k_unMaxFramesInFlight; nFrame++ )
 	{
-		VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-		bufferCreateInfo.size = sizeof( Matrix4 );
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-		vkCreateBuffer( m_pDevice, &bufferCreateInfo, nullptr, &m_pSceneConstantBuffer[ nEye ] );
-
-		VkMemoryRequirements memoryRequirements = { };
-		vkGetBufferMemoryRequirements( m_pDevice, m_pSceneConstantBuffer[ nEye ], &memoryRequirements );
-
-		VkMemoryAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
-		MemoryTypeFromProperties( m_physicalDeviceMemoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &allocInfo.memoryTypeIndex );
-		allocInfo.allocationSize = memoryRequirements.size;
+		for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+		{
+			VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+			bufferCreateInfo.size = sizeof( Matrix4 );
+			bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+			vkCreateBuffer( m_pDevice, &bufferCreateInfo, nullptr, &m_pSceneConstantBuffer[ nFrame ][ nEye ] );
 
-		vkAllocateMemory( m_pDevice, &allocInfo, nullptr, &m_pSceneConstantBufferMemory[ nEye ] );
-		vkBindBufferMemory( m_pDevice, m_pSceneConstantBuffer[ nEye ], m_pSceneConstantBufferMemory[ nEye ], 0 );
+			if ( !m_memoryAllocator.BAllocateAndBindBuffer( m_pSceneConstantBuffer[ nFrame ][ nEye ], VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &m_sceneConstantBufferAllocations[ nFrame ][ nEye ] ) )
+			{
+				return;
+			}
 
-		// Map and keep mapped persistently
-		vkMapMemory( m_pDevice, m_pSceneConstantBufferMemory[ nEye ], 0, VK_WHOLE_SIZE, 0, &m_pSceneConstantBufferData[ nEye ] );
+			// The allocator keeps the memory mapped persistently
+			m_pSceneConstantBufferData[ nFrame ][ nEye ] = m_sceneConstantBufferAllocations[ nFrame ][ nEye ].m_pMappedData;
+		}
 	}
 }
 
@@ -2533,36 +4080,24 @@ void CMainApplication::UpdateControllerAxes()
 	}
 
 	// Setup the VB the first time through.
-	if ( m_pControllerAxesVertexBuffer == VK_NULL_HANDLE && vertdataarray.size() > 0 )
+	if ( m_pControllerAxesVertexBuffer[ m_nFrameSlot ] == VK_NULL_HANDLE && vertdataarray.size() > 0 )
 	{
 		// Make big enough to hold up to the max number
 		VkDeviceSize nSize = sizeof( float ) * vertdataarray.size();
 		nSize *= vr::k_unMaxTrackedDeviceCount;
 
-		if ( !CreateVulkanBuffer( m_pDevice, m_physicalDeviceMemoryProperties, nullptr, nSize,
-								  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &m_pControllerAxesVertexBuffer, &m_pControllerAxesVertexBufferMemory ) )
+		if ( !CreateVulkanBuffer( m_pDevice, &m_memoryAllocator, nullptr, nSize,
+								  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &m_pControllerAxesVertexBuffer[ m_nFrameSlot ], &m_controllerAxesVertexBufferAllocations[ m_nFrameSlot ] ) )
 		{
 			return;
 		}
 	}
 
 	// Update the VB data
-	if ( m_pControllerAxesVertexBuffer != VK_NULL_HANDLE && vertdataarray.size() > 0 )
+	if ( m_pControllerAxesVertexBuffer[ m_nFrameSlot ] != VK_NULL_HANDLE && vertdataarray.size() > 0 )
 	{
-		void *pData;
-		VkResult nResult = vkMapMemory( m_pDevice, m_pControllerAxesVertexBufferMemory, 0, VK_WHOLE_SIZE, 0, &pData );
-		if ( nResult != VK_SUCCESS )
-		{
-			dprintf( "vkMapMemory returned error %d\n", nResult );
-			return;
-		}
-		memcpy( pData, &vertdataarray[ 0 ], vertdataarray.size() * sizeof( float ) );
-		vkUnmapMemory( m_pDevice, m_pControllerAxesVertexBufferMemory );
-
-		VkMappedMemoryRange memoryRange = { VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
-		memoryRange.memory = m_pControllerAxesVertexBufferMemory;
-		memoryRange.size = VK_WHOLE_SIZE;
-		vkFlushMappedMemoryRanges( m_pDevice, 1, &memoryRange );
+		memcpy( m_controllerAxesVertexBufferAllocations[ m_nFrameSlot ].m_pMappedData, &vertdataarray[ 0 ], vertdataarray.size() * sizeof( float ) );
+		m_memoryAllocator.FlushMappedAllocation( m_controllerAxesVertexBufferAllocations[ m_nFrameSlot ] );
 	}
 }
 
@@ -2606,31 +4141,12 @@ bool CMainApplication::CreateFrameBuffer( int nWidth, int nHeight, FramebufferDe
 		dprintf( "vkCreateImage failed for eye image with error %d\n", nResult );
 		return false;
 	}
-	VkMemoryRequirements memoryRequirements = {};
-	vkGetImageMemoryRequirements( m_pDevice, framebufferDesc.m_pImage, &memoryRequirements );
-
-	VkMemoryAllocateInfo memoryAllocateInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
-	memoryAllocateInfo.allocationSize = memoryRequirements.size;
-	if ( !MemoryTypeFromProperties( m_physicalDeviceMemoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &memoryAllocateInfo.memoryTypeIndex ) )
-	{
-		dprintf( "Failed to find memory type matching requirements.\n" );
-		return false;
-	}
-
-	nResult = vkAllocateMemory( m_pDevice, &memoryAllocateInfo, nullptr, &framebufferDesc.m_pDeviceMemory );
-	if ( nResult != VK_SUCCESS )
+	if ( !m_memoryAllocator.BAllocateAndBindImage( framebufferDesc.m_pImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &framebufferDesc.m_allocation ) )
 	{
 		dprintf( "Failed to find memory for image.\n" );
 		return false;
 	}
 
-	nResult = vkBindImageMemory( m_pDevice, framebufferDesc.m_pImage, framebufferDesc.m_pDeviceMemory, 0 );
-	if ( nResult != VK_SUCCESS )
-	{
-		dprintf( "Failed to bind memory for image.\n" );
-		return false;
-	}
-
 	VkImageViewCreateInfo imageViewCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
 	imageViewCreateInfo.flags = 0;
 	imageViewCreateInfo.image = framebufferDesc.m_pImage;
@@ -2661,28 +4177,11 @@ bool CMainApplication::CreateFrameBuffer( int nWidth, int nHeight, FramebufferDe
 		dprintf( "vkCreateImage failed for eye depth buffer with error %d\n", nResult );
 		return false;
 	}
-	vkGetImageMemoryRequirements( m_pDevice, framebufferDesc.m_pDepthStencilImage, &memoryRequirements );
-
-	memoryAllocateInfo.allocationSize = memoryRequirements.size;
-	if ( !MemoryTypeFromProperties( m_physicalDeviceMemoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &memoryAllocateInfo.memoryTypeIndex ) )
-	{
-		dprintf( "Failed to find memory type matching requirements.\n" );
-		return false;
-	}
-
-	nResult = vkAllocateMemory( m_pDevice, &memoryAllocateInfo, nullptr, &framebufferDesc.m_pDepthStencilDeviceMemory );
-	if ( nResult != VK_SUCCESS )
+	if ( !m_memoryAllocator.BAllocateAndBindImage( framebufferDesc.m_pDepthStencilImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &framebufferDesc.m_depthStencilAllocation ) )
 	{
 		dprintf( "Failed to find memory for image.\n" );
 		return false;
 	}
-
-	nResult = vkBindImageMemory( m_pDevice, framebufferDesc.m_pDepthStencilImage, framebufferDesc.m_pDepthStencilDeviceMemory, 0 );
-	if ( nResult != VK_SUCCESS )
-	{
-		dprintf( "Failed to bind memory for image.\n" );
-		return false;
-	}
 	
 	imageViewCreateInfo.image = framebufferDesc.m_pDepthStencilImage;
 	imageViewCreateInfo.format = imageCreateInfo.format;
@@ -2786,25 +4285,51 @@ CMainApplication::VulkanCommandBuffer_t CMainApplication::GetCommandBuffer()
 		if ( vkGetFenceStatus( m_pDevice, m_commandBuffers.back().m_pFence ) == VK_SUCCESS )
 		{
 			VulkanCommandBuffer_t *pCmdBuffer = &m_commandBuffers.back();
-			commandBuffer.m_pCommandBuffer = pCmdBuffer->m_pCommandBuffer;
-			commandBuffer.m_pFence = pCmdBuffer->m_pFence;
+			commandBuffer = *pCmdBuffer;
 
 			vkResetCommandBuffer( commandBuffer.m_pCommandBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT );
 			vkResetFences( m_pDevice, 1, &commandBuffer.m_pFence );
 			m_commandBuffers.pop_back();
+
+			// Uploads this buffer copied from are done with
+			m_stagingRing.Retire( commandBuffer.m_nStagingSubmission );
 			return commandBuffer;
 		}
 	}
 
-	// Create a new command buffer and associated fence
+	return CreateCommandBuffer( false );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Create a command buffer and associated fence. Frame command buffers
+// also get a secondary buffer per eye recording thread, and their fence starts
+// signalled as if a previous frame had completed.
+//-----------------------------------------------------------------------------
+CMainApplication::VulkanCommandBuffer_t CMainApplication::CreateCommandBuffer( bool bFrameCommandBuffer )
+{
+	VulkanCommandBuffer_t commandBuffer;
 	VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
 	commandBufferAllocateInfo.commandBufferCount = 1;
 	commandBufferAllocateInfo.commandPool = m_pCommandPool;
 	commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 	vkAllocateCommandBuffers( m_pDevice, &commandBufferAllocateInfo, &commandBuffer.m_pCommandBuffer );
 
+	// The recording threads are idle between frames, so their pools can be allocated from here
+	commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+	for ( uint32_t nEye = 0; nEye < _countof( commandBuffer.m_pEyeCommandBuffers ); nEye++ )
+	{
+		commandBuffer.m_pEyeCommandBuffers[ nEye ] = VK_NULL_HANDLE;
+		if ( bFrameCommandBuffer && m_rEyeRecordThreads[ nEye ].m_pCommandPool != VK_NULL_HANDLE )
+		{
+			commandBufferAllocateInfo.commandPool = m_rEyeRecordThreads[ nEye ].m_pCommandPool;
+			vkAllocateCommandBuffers( m_pDevice, &commandBufferAllocateInfo, &commandBuffer.m_pEyeCommandBuffers[ nEye ] );
+		}
+	}
+
 	VkFenceCreateInfo fenceCreateInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+	fenceCreateInfo.flags = bFrameCommandBuffer ? VK_FENCE_CREATE_SIGNALED_BIT : 0;
 	vkCreateFence( m_pDevice, &fenceCreateInfo, nullptr, &commandBuffer.m_pFence );
+	commandBuffer.m_nStagingSubmission = 0;
 	return commandBuffer;
 }
 
@@ -2822,7 +4347,117 @@ bool CMainApplication::SetupStereoRenderTargets()
 
 	CreateFrameBuffer( m_nRenderWidth, m_nRenderHeight, m_leftEyeDesc );
 	CreateFrameBuffer( m_nRenderWidth, m_nRenderHeight, m_rightEyeDesc );
+
+	if ( m_foveation.m_bEnabled )
+		SetupFoveation();
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Builds and uploads each eye's shading rate image for -foveate from
+//          its profile, centred where the eye's view axis crosses its target
+//          unless the command line placed it. Returns false, rendering at full
+//          rate, if the device can't use VK_NV_shading_rate_image. The eye
+//          pipelines are created with shading rate images enabled only if this
+//          succeeded, so it runs before CreateAllShaders.
+//-----------------------------------------------------------------------------
+bool CMainApplication::SetupFoveation()
+{
+#ifdef VK_NV_shading_rate_image
+	if ( !m_bShadingRateImage )
+	{
+		dprintf( "Foveation: VK_NV_shading_rate_image is not supported, rendering at full rate\n" );
+		return false;
+	}
+
+	uint32_t nTilesX = ( m_nRenderWidth + m_shadingRateTexelSize.width - 1 ) / m_shadingRateTexelSize.width;
+	uint32_t nTilesY = ( m_nRenderHeight + m_shadingRateTexelSize.height - 1 ) / m_shadingRateTexelSize.height;
+
+	std::vector< uint8_t > rvecRates[ 2 ];
+	for ( int nEye = 0; nEye < 2; nEye++ )
+	{
+		float flLeft, flRight, flTop, flBottom;
+		m_pHMD->GetProjectionRaw( ( vr::Hmd_Eye )nEye, &flLeft, &flRight, &flTop, &flBottom );
+		Foveation_SetDefaultCenter( &m_foveation, nEye, flLeft, flRight, flTop, flBottom );
+		Foveation_BuildRateImage( m_foveation.m_rProfile[ nEye ], m_nRenderWidth, m_nRenderHeight, m_shadingRateTexelSize.width, m_shadingRateTexelSize.height, false, &rvecRates[ nEye ] );
+
+		VkImageCreateInfo imageCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.extent.width = nTilesX;
+		imageCreateInfo.extent.height = nTilesY;
+		imageCreateInfo.extent.depth = 1;
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.format = VK_FORMAT_R8_UINT;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageCreateInfo.usage = VK_IMAGE_USAGE_SHADING_RATE_IMAGE_BIT_NV | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageCreateInfo.flags = 0;
+		vkCreateImage( m_pDevice, &imageCreateInfo, nullptr, &m_rpShadingRateImage[ nEye ] );
+		if ( !m_memoryAllocator.BAllocateAndBindImage( m_rpShadingRateImage[ nEye ], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_rShadingRateImageAllocations[ nEye ] ) )
+		{
+			m_bShadingRateImage = false;
+			return false;
+		}
+
+		VkImageViewCreateInfo imageViewCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+		imageViewCreateInfo.flags = 0;
+		imageViewCreateInfo.image = m_rpShadingRateImage[ nEye ];
+		imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		imageViewCreateInfo.format = imageCreateInfo.format;
+		imageViewCreateInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+		imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+		imageViewCreateInfo.subresourceRange.levelCount = 1;
+		imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+		imageViewCreateInfo.subresourceRange.layerCount = 1;
+		vkCreateImageView( m_pDevice, &imageViewCreateInfo, nullptr, &m_rpShadingRateImageView[ nEye ] );
+
+		// Copy the rates to staging memory, one tightly packed byte per tile
+		VkBuffer pStagingBuffer;
+		VkDeviceSize nStagingOffset;
+		void *pStagingData;
+		if ( !m_stagingRing.BAllocate( rvecRates[ nEye ].size(), &pStagingBuffer, &nStagingOffset, &pStagingData ) )
+		{
+			m_bShadingRateImage = false;
+			return false;
+		}
+		memcpy( pStagingData, &rvecRates[ nEye ][ 0 ], rvecRates[ nEye ].size() );
+
+		VkImageMemoryBarrier imageMemoryBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+		imageMemoryBarrier.srcAccessMask = 0;
+		imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageMemoryBarrier.image = m_rpShadingRateImage[ nEye ];
+		imageMemoryBarrier.subresourceRange = imageViewCreateInfo.subresourceRange;
+		imageMemoryBarrier.srcQueueFamilyIndex = m_nQueueFamilyIndex;
+		imageMemoryBarrier.dstQueueFamilyIndex = m_nQueueFamilyIndex;
+		vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+
+		VkBufferImageCopy bufferImageCopy = {};
+		bufferImageCopy.bufferOffset = nStagingOffset;
+		bufferImageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		bufferImageCopy.imageSubresource.layerCount = 1;
+		bufferImageCopy.imageExtent = imageCreateInfo.extent;
+		vkCmdCopyBufferToImage( m_currentCommandBuffer.m_pCommandBuffer, pStagingBuffer, m_rpShadingRateImage[ nEye ], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy );
+
+		// Transition to the layout vkCmdBindShadingRateImageNV expects
+		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADING_RATE_IMAGE_READ_BIT_NV;
+		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADING_RATE_OPTIMAL_NV;
+		vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_SHADING_RATE_IMAGE_BIT_NV, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+	}
+
+	dprintf( "Foveation: %ux%u pixel tiles, pixel shading left %.0f%% right %.0f%% of full rate\n", m_shadingRateTexelSize.width, m_shadingRateTexelSize.height,
+		100.0f * Foveation_GetInvocationFraction( rvecRates[ vr::Eye_Left ] ), 100.0f * Foveation_GetInvocationFraction( rvecRates[ vr::Eye_Right ] ) );
 	return true;
+#else
+	dprintf( "Foveation: built with Vulkan headers that lack VK_NV_shading_rate_image, rendering at full rate\n" );
+	return false;
+#endif
 }
 
 //-----------------------------------------------------------------------------
@@ -2848,8 +4483,8 @@ void CMainApplication::SetupCompanionWindow()
 	vVerts.push_back( VertexDataWindow( Vector2(1, 1), Vector2(1, 0)) );
 
 	// Create the vertex buffer and fill with data
-	if ( !CreateVulkanBuffer( m_pDevice, m_physicalDeviceMemoryProperties, &vVerts[ 0 ], sizeof( VertexDataWindow ) * vVerts.size(),
-							  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &m_pCompanionWindowVertexBuffer, &m_pCompanionWindowVertexBufferMemory ) )
+	if ( !CreateVulkanBuffer( m_pDevice, &m_memoryAllocator, &vVerts[ 0 ], sizeof( VertexDataWindow ) * vVerts.size(),
+							  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &m_pCompanionWindowVertexBuffer, &m_companionWindowVertexBufferAllocation ) )
 	{
 		return;
 	}
@@ -2857,8 +4492,8 @@ void CMainApplication::SetupCompanionWindow()
 	// Create index buffer
 	uint16_t vIndices[] = { 0, 1, 3,   0, 3, 2,   4, 5, 7,   4, 7, 6};
 	m_uiCompanionWindowIndexSize = _countof( vIndices );
-	if ( !CreateVulkanBuffer( m_pDevice, m_physicalDeviceMemoryProperties, &vIndices[ 0 ], sizeof( vIndices ),
-							  VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &m_pCompanionWindowIndexBuffer, &m_pCompanionWindowIndexBufferMemory ) )
+	if ( !CreateVulkanBuffer( m_pDevice, &m_memoryAllocator, &vIndices[ 0 ], sizeof( vIndices ),
+							  VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &m_pCompanionWindowIndexBuffer, &m_companionWindowIndexBufferAllocation ) )
 	{
 		return;
 	}
@@ -2888,6 +4523,17 @@ void CMainApplication::SetupCompanionWindow()
 //-----------------------------------------------------------------------------
 void CMainApplication::RenderStereoTargets()
 {
+	m_bIsInputAvailable = m_pHMD->IsInputAvailable();
+
+	// Start recording both eyes while the barriers and render passes are recorded here
+	if ( m_bEyeRecordThreads )
+	{
+		for ( uint32_t nEye = 0; nEye < _countof( m_rEyeRecordThreads ); nEye++ )
+		{
+			m_rEyeRecordThreads[ nEye ].m_pCommandBuffer = m_currentCommandBuffer.m_pEyeCommandBuffers[ nEye ];
+			SDL_SemPost( m_rEyeRecordThreads[ nEye ].m_pStartSemaphore );
+		}
+	}
 
 	// Set viewport and scissor
 	VkViewport viewport = { 0.0f, 0.0f, (float ) m_nRenderWidth, ( float ) m_nRenderHeight, 0.0f, 1.0f };
@@ -2945,9 +4591,18 @@ void CMainApplication::RenderStereoTargets()
 	clearValues[ 1 ].depthStencil.depth = 1.0f;
 	clearValues[ 1 ].depthStencil.stencil = 0;
 	renderPassBeginInfo.pClearValues = &clearValues[ 0 ];
-	vkCmdBeginRenderPass( m_currentCommandBuffer.m_pCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE );
+	VkSubpassContents nSubpassContents = m_bEyeRecordThreads ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+	vkCmdBeginRenderPass( m_currentCommandBuffer.m_pCommandBuffer, &renderPassBeginInfo, nSubpassContents );
 
-	RenderScene( vr::Eye_Left );
+	if ( m_bEyeRecordThreads )
+	{
+		SDL_SemWait( m_rEyeRecordThreads[ vr::Eye_Left ].m_pDoneSemaphore );
+		vkCmdExecuteCommands( m_currentCommandBuffer.m_pCommandBuffer, 1, &m_currentCommandBuffer.m_pEyeCommandBuffers[ vr::Eye_Left ] );
+	}
+	else
+	{
+		RenderScene( vr::Eye_Left, m_currentCommandBuffer.m_pCommandBuffer );
+	}
 
 	vkCmdEndRenderPass( m_currentCommandBuffer.m_pCommandBuffer );
 	
@@ -2961,6 +4616,8 @@ void CMainApplication::RenderStereoTargets()
 	vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
 	m_leftEyeDesc.m_nImageLayout = imageMemoryBarrier.newLayout;
 
+	WriteGpuTimestamp( k_eGpuTimestamp_LeftEye );
+
 	//-----------//
 	// Right Eye //
 	//-----------//
@@ -2991,86 +4648,258 @@ void CMainApplication::RenderStereoTargets()
 	renderPassBeginInfo.renderPass = m_rightEyeDesc.m_pRenderPass;
 	renderPassBeginInfo.framebuffer = m_rightEyeDesc.m_pFramebuffer;
 	renderPassBeginInfo.pClearValues = &clearValues[ 0 ];
-	vkCmdBeginRenderPass( m_currentCommandBuffer.m_pCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE );
+	vkCmdBeginRenderPass( m_currentCommandBuffer.m_pCommandBuffer, &renderPassBeginInfo, nSubpassContents );
+
+	if ( m_bEyeRecordThreads )
+	{
+		SDL_SemWait( m_rEyeRecordThreads[ vr::Eye_Right ].m_pDoneSemaphore );
+		vkCmdExecuteCommands( m_currentCommandBuffer.m_pCommandBuffer, 1, &m_currentCommandBuffer.m_pEyeCommandBuffers[ vr::Eye_Right ] );
+	}
+	else
+	{
+		RenderScene( vr::Eye_Right, m_currentCommandBuffer.m_pCommandBuffer );
+	}
+
+	vkCmdEndRenderPass( m_currentCommandBuffer.m_pCommandBuffer );
+	
+	// Transition eye image to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL for display on the companion window
+	imageMemoryBarrier.image = m_rightEyeDesc.m_pImage;
+	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	imageMemoryBarrier.oldLayout = m_rightEyeDesc.m_nImageLayout;
+	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+	m_rightEyeDesc.m_nImageLayout = imageMemoryBarrier.newLayout;
+
+	WriteGpuTimestamp( k_eGpuTimestamp_RightEye );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Renders a scene with respect to nEye. Runs on that eye's recording
+//          thread, so it only touches state owned by the eye or fixed for the frame.
+//-----------------------------------------------------------------------------
+void CMainApplication::RenderScene( vr::Hmd_Eye nEye, VkCommandBuffer pCommandBuffer )
+{
+	// -latelatch turns the view a little after this; leaves straddling the
+	// frustum are drawn whole, which covers that at the edges
+	Frustum_t frustum;
+	Frustum_FromViewProjection( GetCurrentViewProjectionMatrix( nEye ), &frustum );
+
+#ifdef VK_NV_shading_rate_image
+	// Secondary command buffers don't inherit the bound image, so it is bound with every eye's draws
+	if ( m_bShadingRateImage )
+	{
+		g_pVkCmdBindShadingRateImageNV( pCommandBuffer, m_rpShadingRateImageView[ nEye ], VK_IMAGE_LAYOUT_SHADING_RATE_OPTIMAL_NV );
+	}
+#endif
+
+	if( m_bShowCubes )
+	{
+		vkCmdBindPipeline( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_SCENE ] );
+		
+		// Update the persistently mapped pointer to the CB data with the latest matrix
+		memcpy( m_pSceneConstantBufferData[ m_nFrameSlot ][ nEye ], GetCurrentViewProjectionMatrix( nEye ).get(), sizeof( Matrix4 ) );
+
+		vkCmdBindDescriptorSets( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelineLayout, 0, 1, &m_pDescriptorSets[ m_nFrameSlot ][ DESCRIPTOR_SET_LEFT_EYE_SCENE + nEye ], 0, nullptr );
+
+		// Draw
+		VkDeviceSize nOffsets[ 1 ] = { 0 };
+		vkCmdBindVertexBuffers( pCommandBuffer, 0, 1, &m_pSceneVertexBuffer, &nOffsets[ 0 ] );
+		if ( m_bCulling )
+		{
+			// one draw per run of visible cells
+			std::vector< SceneCellRange_t > &vecRanges = m_rvecSceneRanges[ nEye ];
+			m_sceneBVH.Cull( &frustum, 1, &vecRanges );
+			for ( size_t i = 0; i < vecRanges.size(); i++ )
+				vkCmdDraw( pCommandBuffer, vecRanges[ i ].m_unCount * m_uiCubeVertcount, 1, vecRanges[ i ].m_unFirst * m_uiCubeVertcount, 0 );
+		}
+		else
+		{
+			vkCmdDraw( pCommandBuffer, m_uiVertcount, 1, 0, 0 );
+		}
+	}
+
+	if( m_bIsInputAvailable && m_pControllerAxesVertexBuffer[ m_nFrameSlot ] != VK_NULL_HANDLE )
+	{
+		// draw the controller axis lines
+		vkCmdBindPipeline( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_AXES ] );
+
+		VkDeviceSize nOffsets[ 1 ] = { 0 };
+		vkCmdBindVertexBuffers( pCommandBuffer, 0, 1, &m_pControllerAxesVertexBuffer[ m_nFrameSlot ], &nOffsets[ 0 ] );
+		vkCmdDraw( pCommandBuffer, m_uiControllerVertcount, 1, 0, 0 );
+	}
+
+	// ----- Render Model rendering -----
+	vkCmdBindPipeline( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_RENDERMODEL ] );
+	if ( m_bBindless )
+	{
+		// every model's matrix and texture is in the eye's set, the draws only push the device index
+		vkCmdBindDescriptorSets( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pBindlessPipelineLayout, 0, 1, &m_pBindlessDescriptorSets[ m_nFrameSlot ][ nEye ], 0, nullptr );
+	}
+	for( uint32_t unTrackedDevice = 0; unTrackedDevice < vr::k_unMaxTrackedDeviceCount; unTrackedDevice++ )
+	{
+		if( !m_rTrackedDeviceToRenderModel[ unTrackedDevice ] || !m_rbShowTrackedDevice[ unTrackedDevice ] )
+			continue;
+
+		const vr::TrackedDevicePose_t & pose = m_rTrackedDevicePose[ unTrackedDevice ];
+		if( !pose.bPoseIsValid )
+			continue;
+
+		if( !m_bIsInputAvailable && m_rDevClassChar[ unTrackedDevice ] == 'C' )
+			continue;
+
+		const Matrix4 & matDeviceToTracking = m_rmat4DevicePose[ unTrackedDevice ];
+		if ( m_bCulling )
+		{
+			const Vector3 &vCenter = m_rTrackedDeviceToRenderModel[ unTrackedDevice ]->GetBoundsCenter();
+			Vector4 vWorldCenter = matDeviceToTracking * Vector4( vCenter.x, vCenter.y, vCenter.z, 1.0f );
+			if ( Frustum_BSphereOutsideAll( &frustum, 1, Vector3( vWorldCenter.x, vWorldCenter.y, vWorldCenter.z ), m_rTrackedDeviceToRenderModel[ unTrackedDevice ]->GetBoundsRadius() ) )
+				continue;
+		}
+
+		Matrix4 matMVP = GetCurrentViewProjectionMatrix( nEye ) * matDeviceToTracking;
+		
+		if ( m_bBindless )
+		{
+			m_pBindlessMatrixData[ m_nFrameSlot ][ nEye ][ unTrackedDevice ] = matMVP;
+			vkCmdPushConstants( pCommandBuffer, m_pBindlessPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( uint32_t ), &unTrackedDevice );
+			m_rTrackedDeviceToRenderModel[ unTrackedDevice ]->DrawGeometry( pCommandBuffer );
+		}
+		else
+		{
+			m_rTrackedDeviceToRenderModel[ unTrackedDevice ]->Draw( m_nFrameSlot, nEye, pCommandBuffer, m_pPipelineLayout, matMVP );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Records nEye's scene into a secondary command buffer that continues
+//          the eye's render pass.
+//-----------------------------------------------------------------------------
+void CMainApplication::RecordEyeCommandBuffer( vr::Hmd_Eye nEye, VkCommandBuffer pCommandBuffer )
+{
+	const FramebufferDesc &eyeDesc = ( nEye == vr::Eye_Left ) ? m_leftEyeDesc : m_rightEyeDesc;
+
+	VkCommandBufferInheritanceInfo inheritanceInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+	inheritanceInfo.renderPass = eyeDesc.m_pRenderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = eyeDesc.m_pFramebuffer;
+
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+	vkBeginCommandBuffer( pCommandBuffer, &commandBufferBeginInfo );
+
+	// Dynamic state is not inherited from the primary command buffer
+	VkViewport viewport = { 0.0f, 0.0f, (float ) m_nRenderWidth, ( float ) m_nRenderHeight, 0.0f, 1.0f };
+	vkCmdSetViewport( pCommandBuffer, 0, 1, &viewport );
+	VkRect2D scissor = { 0, 0, m_nRenderWidth, m_nRenderHeight };
+	vkCmdSetScissor( pCommandBuffer, 0, 1, &scissor );
 
-	RenderScene( vr::Eye_Right );
+	RenderScene( nEye, pCommandBuffer );
 
-	vkCmdEndRenderPass( m_currentCommandBuffer.m_pCommandBuffer );
-	
-	// Transition eye image to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL for display on the companion window
-	imageMemoryBarrier.image = m_rightEyeDesc.m_pImage;
-	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	imageMemoryBarrier.oldLayout = m_rightEyeDesc.m_nImageLayout;
-	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
-	m_rightEyeDesc.m_nImageLayout = imageMemoryBarrier.newLayout;
+	vkEndCommandBuffer( pCommandBuffer );
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Renders a scene with respect to nEye.
+// Purpose: Worker loop of an eye's recording thread
 //-----------------------------------------------------------------------------
-void CMainApplication::RenderScene( vr::Hmd_Eye nEye )
+int SDLCALL CMainApplication::EyeRecordThreadMain( void *pData )
 {
-	if( m_bShowCubes )
-	{
-		vkCmdBindPipeline( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_SCENE ] );
-		
-		// Update the persistently mapped pointer to the CB data with the latest matrix
-		memcpy( m_pSceneConstantBufferData[ nEye ], GetCurrentViewProjectionMatrix( nEye ).get(), sizeof( Matrix4 ) );
+	EyeRecordThread_t *pThread = ( EyeRecordThread_t * )pData;
+	CMainApplication *pApplication = pThread->m_pApplication;
 
-		vkCmdBindDescriptorSets( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelineLayout, 0, 1, &m_pDescriptorSets[ DESCRIPTOR_SET_LEFT_EYE_SCENE + nEye ], 0, nullptr );
+	for ( ;; )
+	{
+		SDL_SemWait( pThread->m_pStartSemaphore );
+		if ( pApplication->m_bQuitEyeRecordThreads )
+			break;
 
-		// Draw
-		VkDeviceSize nOffsets[ 1 ] = { 0 };
-		vkCmdBindVertexBuffers( m_currentCommandBuffer.m_pCommandBuffer, 0, 1, &m_pSceneVertexBuffer, &nOffsets[ 0 ] );
-		vkCmdDraw( m_currentCommandBuffer.m_pCommandBuffer, m_uiVertcount, 1, 0, 0 );
+		pApplication->RecordEyeCommandBuffer( pThread->m_nEye, pThread->m_pCommandBuffer );
+		SDL_SemPost( pThread->m_pDoneSemaphore );
 	}
 
-	bool bIsInputAvailable = m_pHMD->IsInputAvailable();
-	if( bIsInputAvailable && m_pControllerAxesVertexBuffer != VK_NULL_HANDLE )
-	{
-		// draw the controller axis lines
-		vkCmdBindPipeline( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_AXES ] );
+	return 0;
+}
 
-		VkDeviceSize nOffsets[ 1 ] = { 0 };
-		vkCmdBindVertexBuffers( m_currentCommandBuffer.m_pCommandBuffer, 0, 1, &m_pControllerAxesVertexBuffer, &nOffsets[ 0 ] );
-		vkCmdDraw( m_currentCommandBuffer.m_pCommandBuffer, m_uiControllerVertcount, 1, 0, 0 );
-	}
+//-----------------------------------------------------------------------------
+// Purpose: Creates the per-eye command pools and starts the recording threads
+//-----------------------------------------------------------------------------
+bool CMainApplication::BInitEyeRecordThreads()
+{
+	if ( !m_bEyeRecordThreads )
+		return true;
 
-	// ----- Render Model rendering -----
-	vkCmdBindPipeline( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_RENDERMODEL ] );
-	for( uint32_t unTrackedDevice = 0; unTrackedDevice < vr::k_unMaxTrackedDeviceCount; unTrackedDevice++ )
+	for ( uint32_t nEye = 0; nEye < _countof( m_rEyeRecordThreads ); nEye++ )
 	{
-		if( !m_rTrackedDeviceToRenderModel[ unTrackedDevice ] || !m_rbShowTrackedDevice[ unTrackedDevice ] )
-			continue;
+		EyeRecordThread_t &thread = m_rEyeRecordThreads[ nEye ];
+		thread.m_pApplication = this;
+		thread.m_nEye = ( vr::Hmd_Eye )nEye;
 
-		const vr::TrackedDevicePose_t & pose = m_rTrackedDevicePose[ unTrackedDevice ];
-		if( !pose.bPoseIsValid )
-			continue;
+		VkCommandPoolCreateInfo commandPoolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+		commandPoolCreateInfo.queueFamilyIndex = m_nQueueFamilyIndex;
+		commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		VkResult nResult = vkCreateCommandPool( m_pDevice, &commandPoolCreateInfo, nullptr, &thread.m_pCommandPool );
+		if ( nResult != VK_SUCCESS )
+		{
+			dprintf( "vkCreateCommandPool returned error %d.", nResult );
+			return false;
+		}
 
-		if( !bIsInputAvailable && m_pHMD->GetTrackedDeviceClass( unTrackedDevice ) == vr::TrackedDeviceClass_Controller )
-			continue;
+		thread.m_pStartSemaphore = SDL_CreateSemaphore( 0 );
+		thread.m_pDoneSemaphore = SDL_CreateSemaphore( 0 );
+		thread.m_pThread = SDL_CreateThread( EyeRecordThreadMain, nEye == vr::Eye_Left ? "RecordLeftEye" : "RecordRightEye", &thread );
+		if ( !thread.m_pStartSemaphore || !thread.m_pDoneSemaphore || !thread.m_pThread )
+		{
+			dprintf( "Unable to start the eye recording threads: %s\n", SDL_GetError() );
+			return false;
+		}
+	}
 
-		const Matrix4 & matDeviceToTracking = m_rmat4DevicePose[ unTrackedDevice ];
-		Matrix4 matMVP = GetCurrentViewProjectionMatrix( nEye ) * matDeviceToTracking;
-		
-		m_rTrackedDeviceToRenderModel[ unTrackedDevice ]->Draw( nEye, m_currentCommandBuffer.m_pCommandBuffer, m_pPipelineLayout, matMVP );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stops the recording threads. Their command pools are destroyed
+//          with the rest of the Vulkan objects.
+//-----------------------------------------------------------------------------
+void CMainApplication::ShutdownEyeRecordThreads()
+{
+	m_bQuitEyeRecordThreads = true;
+	for ( uint32_t nEye = 0; nEye < _countof( m_rEyeRecordThreads ); nEye++ )
+	{
+		EyeRecordThread_t &thread = m_rEyeRecordThreads[ nEye ];
+		if ( thread.m_pThread )
+		{
+			SDL_SemPost( thread.m_pStartSemaphore );
+			SDL_WaitThread( thread.m_pThread, NULL );
+			thread.m_pThread = NULL;
+		}
+		if ( thread.m_pStartSemaphore )
+		{
+			SDL_DestroySemaphore( thread.m_pStartSemaphore );
+			thread.m_pStartSemaphore = NULL;
+		}
+		if ( thread.m_pDoneSemaphore )
+		{
+			SDL_DestroySemaphore( thread.m_pDoneSemaphore );
+			thread.m_pDoneSemaphore = NULL;
+		}
 	}
 }
 
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
-void CMainApplication::RenderCompanionWindow()
+bool CMainApplication::RenderCompanionWindow()
 {
 	// Get the next swapchain image
 	VkResult nResult = vkAcquireNextImageKHR( m_pDevice, m_pSwapchain, UINT64_MAX, m_pSwapchainSemaphores[ m_nFrameIndex ], VK_NULL_HANDLE, &m_nCurrentSwapchainImage );
 	if ( nResult != VK_SUCCESS )
 	{
 		dprintf( "Skipping companion window rendering, vkAcquireNextImageKHR returned %d\n", nResult );
-		return;
+		return false;
 	}
 
 	// Transition the swapchain image to COLOR_ATTACHMENT_OPTIMAL for rendering
@@ -3114,7 +4943,7 @@ void CMainApplication::RenderCompanionWindow()
 
 	// Bind the pipeline and descriptor set
 	vkCmdBindPipeline( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_COMPANION ] );
-	vkCmdBindDescriptorSets( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelineLayout, 0, 1, &m_pDescriptorSets[ DESCRIPTOR_SET_COMPANION_LEFT_TEXTURE ], 0, nullptr );
+	vkCmdBindDescriptorSets( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelineLayout, 0, 1, &m_pDescriptorSets[ m_nFrameSlot ][ DESCRIPTOR_SET_COMPANION_LEFT_TEXTURE ], 0, nullptr );
 
 	// Draw left eye texture to companion window
 	VkDeviceSize nOffsets[ 1 ] = { 0 };
@@ -3123,7 +4952,7 @@ void CMainApplication::RenderCompanionWindow()
 	vkCmdDrawIndexed( m_currentCommandBuffer.m_pCommandBuffer, m_uiCompanionWindowIndexSize / 2, 1, 0, 0, 0 );
 
 	// Draw right eye texture to companion window
-	vkCmdBindDescriptorSets( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelineLayout, 0, 1, &m_pDescriptorSets[ DESCRIPTOR_SET_COMPANION_RIGHT_TEXTURE ], 0, nullptr );
+	vkCmdBindDescriptorSets( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelineLayout, 0, 1, &m_pDescriptorSets[ m_nFrameSlot ][ DESCRIPTOR_SET_COMPANION_RIGHT_TEXTURE ], 0, nullptr );
 	vkCmdDrawIndexed( m_currentCommandBuffer.m_pCommandBuffer, m_uiCompanionWindowIndexSize / 2, 1, ( m_uiCompanionWindowIndexSize / 2 ), 0, 0 );
 
 	// End the renderpass
@@ -3135,8 +4964,24 @@ void CMainApplication::RenderCompanionWindow()
 	imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 	vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+	return true;
+}
 
-	// Transition both of the eye textures to VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL for SteamVR which requires this layout for submit
+//-----------------------------------------------------------------------------
+// Purpose: Transitions both of the eye textures to VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+//          for SteamVR which requires this layout for submit, whether or not the
+//          companion window read them this frame
+//-----------------------------------------------------------------------------
+void CMainApplication::TransitionEyesForSubmit()
+{
+	VkImageMemoryBarrier imageMemoryBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
+	imageMemoryBarrier.subresourceRange.levelCount = 1;
+	imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+	imageMemoryBarrier.subresourceRange.layerCount = 1;
+	imageMemoryBarrier.srcQueueFamilyIndex = m_nQueueFamilyIndex;
+	imageMemoryBarrier.dstQueueFamilyIndex = m_nQueueFamilyIndex;
 	imageMemoryBarrier.image = m_leftEyeDesc.m_pImage;
 	imageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
 	imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
@@ -3207,6 +5052,27 @@ Matrix4 CMainApplication::GetCurrentViewProjectionMatrix( vr::Hmd_Eye nEye )
 	return matMVP;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Caches a character representing the class of a tracked device.
+//          Called at startup and when a device is activated so the per frame
+//          pose update never has to query the runtime.
+//-----------------------------------------------------------------------------
+void CMainApplication::UpdateTrackedDeviceClass( vr::TrackedDeviceIndex_t unTrackedDeviceIndex )
+{
+	if ( !m_pHMD || unTrackedDeviceIndex >= vr::k_unMaxTrackedDeviceCount )
+		return;
+
+	switch ( m_pHMD->GetTrackedDeviceClass( unTrackedDeviceIndex ) )
+	{
+	case vr::TrackedDeviceClass_Controller:        m_rDevClassChar[unTrackedDeviceIndex] = 'C'; break;
+	case vr::TrackedDeviceClass_HMD:               m_rDevClassChar[unTrackedDeviceIndex] = 'H'; break;
+	case vr::TrackedDeviceClass_Invalid:           m_rDevClassChar[unTrackedDeviceIndex] = 'I'; break;
+	case vr::TrackedDeviceClass_GenericTracker:    m_rDevClassChar[unTrackedDeviceIndex] = 'G'; break;
+	case vr::TrackedDeviceClass_TrackingReference: m_rDevClassChar[unTrackedDeviceIndex] = 'T'; break;
+	default:                                       m_rDevClassChar[unTrackedDeviceIndex] = '?'; break;
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
@@ -3216,30 +5082,18 @@ void CMainApplication::UpdateHMDMatrixPose()
 		return;
 
 	vr::VRCompositor()->WaitGetPoses(m_rTrackedDevicePose, vr::k_unMaxTrackedDeviceCount, NULL, 0 );
+	m_ulPosesCounter = SDL_GetPerformanceCounter();
+
+	// converts every pose in one pass, the matrices of invalid poses are never read
+	ConvertSteamVRMatrixToMatrix4( m_rTrackedDevicePose, m_rmat4DevicePose, vr::k_unMaxTrackedDeviceCount );
 
 	m_iValidPoseCount = 0;
-	m_strPoseClasses = "";
 	for ( int nDevice = 0; nDevice < vr::k_unMaxTrackedDeviceCount; ++nDevice )
 	{
 		if ( m_rTrackedDevicePose[nDevice].bPoseIsValid )
-		{
-			m_iValidPoseCount++;
-			m_rmat4DevicePose[nDevice] = ConvertSteamVRMatrixToMatrix4( m_rTrackedDevicePose[nDevice].mDeviceToAbsoluteTracking );
-			if (m_rDevClassChar[nDevice]==0)
-			{
-				switch (m_pHMD->GetTrackedDeviceClass(nDevice))
-				{
-				case vr::TrackedDeviceClass_Controller:        m_rDevClassChar[nDevice] = 'C'; break;
-				case vr::TrackedDeviceClass_HMD:               m_rDevClassChar[nDevice] = 'H'; break;
-				case vr::TrackedDeviceClass_Invalid:           m_rDevClassChar[nDevice] = 'I'; break;
-				case vr::TrackedDeviceClass_GenericTracker:    m_rDevClassChar[nDevice] = 'G'; break;
-				case vr::TrackedDeviceClass_TrackingReference: m_rDevClassChar[nDevice] = 'T'; break;
-				default:                                       m_rDevClassChar[nDevice] = '?'; break;
-				}
-			}
-			m_strPoseClasses += m_rDevClassChar[nDevice];
-		}
+			m_rchPoseClasses[m_iValidPoseCount++] = m_rDevClassChar[nDevice];
 	}
+	m_rchPoseClasses[m_iValidPoseCount] = '\0';
 
 	if ( m_rTrackedDevicePose[vr::k_unTrackedDeviceIndex_Hmd].bPoseIsValid )
 	{
@@ -3249,109 +5103,128 @@ void CMainApplication::UpdateHMDMatrixPose()
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Finds a render model we've already loaded or loads a new one
+// Purpose: -latelatch. The frame's command buffers are recorded with the HMD
+//          pose WaitGetPoses predicted at the top of the frame; this predicts
+//          it again for the same photons and rewrites the view projection
+//          matrices in the frame's constant buffers. Those are host coherent
+//          and the GPU doesn't read them before vkQueueSubmit, so every draw
+//          of the frame sees the new pose.
 //-----------------------------------------------------------------------------
-VulkanRenderModel *CMainApplication::FindOrLoadRenderModel( vr::TrackedDeviceIndex_t unTrackedDeviceIndex, const char *pchRenderModelName )
+void CMainApplication::LateLatchViews()
 {
-	VulkanRenderModel *pRenderModel = NULL;
-	// To simplify the Vulkan rendering code, create an instance of the model for each model name.  This is less efficient
-	// memory wise, but simplifies the rendering code so we can store the transform in a constant buffer associated with
-	// the model itself.  You would not want to do this in a production application.
-	//for( std::vector< VulkanRenderModel * >::iterator i = m_vecRenderModels.begin(); i != m_vecRenderModels.end(); i++ )
-	//{
-		//if( !stricmp( (*i)->GetName().c_str(), pchRenderModelName ) )
-		//{
-			//pRenderModel = *i;
-			//break;
-		//}
-	//}
-
-	// load the model if we didn't find one
-	if( !pRenderModel )
-	{
-		vr::RenderModel_t *pModel;
-		vr::EVRRenderModelError error;
-		while ( 1 )
-		{
-			error = vr::VRRenderModels()->LoadRenderModel_Async( pchRenderModelName, &pModel );
-			if ( error != vr::VRRenderModelError_Loading )
-				break;
+	LateLatch_t &latch = m_rLateLatch[ m_unTimingFrame % k_unTimingFrameCount ];
+	memset( &latch, 0, sizeof( latch ) );
+
+	// the frame is shown at the vsync after this one
+	float flSecondsSinceLastVsync = 0.0f;
+	m_pHMD->GetTimeSinceLastVsync( &flSecondsSinceLastVsync, NULL );
+	float flSecondsToPhotons = 1.0f / m_flDisplayFrequency - flSecondsSinceLastVsync + m_flSecondsFromVsyncToPhotons;
+
+	vr::TrackedDevicePose_t pose;
+	m_pHMD->GetDeviceToAbsoluteTrackingPose( vr::VRCompositor()->GetTrackingSpace(), flSecondsToPhotons, &pose, 1 );
+	const vr::TrackedDevicePose_t &rendered = m_rTrackedDevicePose[ vr::k_unTrackedDeviceIndex_Hmd ];
+	if ( !pose.bPoseIsValid || !rendered.bPoseIsValid )
+		return;
 
-			ThreadSleep( 1 );
-		}
+	m_mat4HMDPose = ConvertSteamVRMatrixToMatrix4( pose.mDeviceToAbsoluteTracking );
+	m_mat4HMDPose.invert();
+	for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+	{
+		Matrix4 matViewProjection = GetCurrentViewProjectionMatrix( ( vr::Hmd_Eye )nEye );
+		if ( m_bShowCubes )
+			memcpy( m_pSceneConstantBufferData[ m_nFrameSlot ][ nEye ], matViewProjection.get(), sizeof( Matrix4 ) );
 
-		if ( error != vr::VRRenderModelError_None )
+		// the same render models RenderScene drew
+		for ( uint32_t unTrackedDevice = 0; unTrackedDevice < vr::k_unMaxTrackedDeviceCount; unTrackedDevice++ )
 		{
-			dprintf( "Unable to load render model %s - %s\n", pchRenderModelName, vr::VRRenderModels()->GetRenderModelErrorNameFromEnum( error ) );
-			return NULL; // move on to the next tracked device
+			if ( !m_rTrackedDeviceToRenderModel[ unTrackedDevice ] || !m_rbShowTrackedDevice[ unTrackedDevice ] )
+				continue;
+			if ( !m_rTrackedDevicePose[ unTrackedDevice ].bPoseIsValid )
+				continue;
+			if ( !m_bIsInputAvailable && m_rDevClassChar[ unTrackedDevice ] == 'C' )
+				continue;
+
+			Matrix4 matMVP = matViewProjection * m_rmat4DevicePose[ unTrackedDevice ];
+			if ( m_bBindless )
+				m_pBindlessMatrixData[ m_nFrameSlot ][ nEye ][ unTrackedDevice ] = matMVP;
+			else
+				m_rTrackedDeviceToRenderModel[ unTrackedDevice ]->UpdateMatrix( m_nFrameSlot, ( vr::EVREye )nEye, matMVP );
 		}
+	}
 
-		vr::RenderModel_TextureMap_t *pTexture;
-		while ( 1 )
-		{
-			error = vr::VRRenderModels()->LoadTexture_Async( pModel->diffuseTextureId, &pTexture );
-			if ( error != vr::VRRenderModelError_Loading )
-				break;
-
-			ThreadSleep( 1 );
-		}
+	// rotation between the two poses from the trace of R1^T * R2, and the distance between their origins
+	const vr::HmdMatrix34_t &a = rendered.mDeviceToAbsoluteTracking;
+	const vr::HmdMatrix34_t &b = pose.mDeviceToAbsoluteTracking;
+	float flTrace = 0.0f, flDistanceSquared = 0.0f;
+	for ( int i = 0; i < 3; i++ )
+	{
+		for ( int j = 0; j < 3; j++ )
+			flTrace += a.m[ i ][ j ] * b.m[ i ][ j ];
+		flDistanceSquared += ( b.m[ i ][ 3 ] - a.m[ i ][ 3 ] ) * ( b.m[ i ][ 3 ] - a.m[ i ][ 3 ] );
+	}
+	float flCos = ( flTrace - 1.0f ) * 0.5f;
+	latch.m_bLatched = true;
+	latch.m_flMs = ( float )( ( SDL_GetPerformanceCounter() - m_ulPosesCounter ) * 1000.0 / SDL_GetPerformanceFrequency() );
+	latch.m_flDegrees = acosf( flCos < -1.0f ? -1.0f : ( flCos > 1.0f ? 1.0f : flCos ) ) * 57.29578f;
+	latch.m_flMillimeters = sqrtf( flDistanceSquared ) * 1000.0f;
+}
 
-		if ( error != vr::VRRenderModelError_None )
-		{
-			dprintf( "Unable to load render texture id:%d for render model %s\n", pModel->diffuseTextureId, pchRenderModelName );
-			vr::VRRenderModels()->FreeRenderModel( pModel );
-			return NULL; // move on to the next tracked device
-		}
+//-----------------------------------------------------------------------------
+// Purpose: Creates the Vulkan resources for a render model the runtime has loaded
+//-----------------------------------------------------------------------------
+VulkanRenderModel *CMainApplication::CreateRenderModel( vr::TrackedDeviceIndex_t unTrackedDeviceIndex, const char *pchRenderModelName, const vr::RenderModel_t &vrModel, const vr::RenderModel_TextureMap_t &vrDiffuseTexture )
+{
+	// To simplify the Vulkan rendering code, create an instance of the model for each model name.  This is less efficient
+	// memory wise, but simplifies the rendering code so we can store the transform in a constant buffer associated with
+	// the model itself.  You would not want to do this in a production application.
+	VulkanRenderModel *pRenderModel = new VulkanRenderModel( pchRenderModelName );
+	VkDescriptorSet pDescriptorSets[ k_unMaxFramesInFlight ][ 2 ];
+	for ( uint32_t nFrame = 0; nFrame < k_unMaxFramesInFlight; nFrame++ )
+	{
+		pDescriptorSets[ nFrame ][ 0 ] = m_pDescriptorSets[ nFrame ][ DESCRIPTOR_SET_LEFT_EYE_RENDER_MODEL0 + unTrackedDeviceIndex ];
+		pDescriptorSets[ nFrame ][ 1 ] = m_pDescriptorSets[ nFrame ][ DESCRIPTOR_SET_RIGHT_EYE_RENDER_MODEL0 + unTrackedDeviceIndex ];
+	}
 
-		pRenderModel = new VulkanRenderModel( pchRenderModelName );
-		VkDescriptorSet pDescriptorSets[ 2 ] =
-		{
-			m_pDescriptorSets[ DESCRIPTOR_SET_LEFT_EYE_RENDER_MODEL0 + unTrackedDeviceIndex ],
-			m_pDescriptorSets[ DESCRIPTOR_SET_RIGHT_EYE_RENDER_MODEL0 + unTrackedDeviceIndex ],
-		};
+	// If this gets called during HandleInput() there will be no command buffer current, so create one
+	// and submit it immediately.
+	bool bNewCommandBuffer = false;
+	if ( m_currentCommandBuffer.m_pCommandBuffer == VK_NULL_HANDLE )
+	{
+		m_currentCommandBuffer = GetCommandBuffer();
 
-		// If this gets called during HandleInput() there will be no command buffer current, so create one
-		// and submit it immediately.
-		bool bNewCommandBuffer = false;
-		if ( m_currentCommandBuffer.m_pCommandBuffer == VK_NULL_HANDLE )
-		{
-			m_currentCommandBuffer = GetCommandBuffer();
+		// Start the command buffer
+		VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer( m_currentCommandBuffer.m_pCommandBuffer, &commandBufferBeginInfo );
+		bNewCommandBuffer = true;
+	}
+	if ( !pRenderModel->BInit( m_pDevice, &m_memoryAllocator, &m_stagingRing, m_currentCommandBuffer.m_pCommandBuffer, m_bGenerateMipsOnGpu, unTrackedDeviceIndex, pDescriptorSets, vrModel, vrDiffuseTexture ) )
+	{
+		dprintf( "Unable to create Vulkan model from render model %s\n", pchRenderModelName );
+		delete pRenderModel;
+		pRenderModel = NULL;
+	}
+	else
+	{
+		m_vecRenderModels.push_back( pRenderModel );
 
-			// Start the command buffer
-			VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-			commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-			vkBeginCommandBuffer( m_currentCommandBuffer.m_pCommandBuffer, &commandBufferBeginInfo );
-			bNewCommandBuffer = true;
-		}
-		if ( !pRenderModel->BInit( m_pDevice, m_physicalDeviceMemoryProperties, m_currentCommandBuffer.m_pCommandBuffer, unTrackedDeviceIndex, pDescriptorSets, *pModel, *pTexture ) )
+		// If this is during HandleInput() there is was no command buffer current, so submit it now.
+		if ( bNewCommandBuffer )
 		{
-			dprintf( "Unable to create Vulkan model from render model %s\n", pchRenderModelName );
-			delete pRenderModel;
-			pRenderModel = NULL;
-		}
-		else
-		{
-			m_vecRenderModels.push_back( pRenderModel );
-
-			// If this is during HandleInput() there is was no command buffer current, so submit it now.
-			if ( bNewCommandBuffer )
-			{
-				vkEndCommandBuffer( m_currentCommandBuffer.m_pCommandBuffer );
-
-				// Submit now
-				VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-				submitInfo.commandBufferCount = 1;
-				submitInfo.pCommandBuffers = &m_currentCommandBuffer.m_pCommandBuffer;
-				vkQueueSubmit( m_pQueue, 1, &submitInfo, m_currentCommandBuffer.m_pFence );
-				m_commandBuffers.push_front( m_currentCommandBuffer );
-
-				// Reset current command buffer
-				m_currentCommandBuffer.m_pCommandBuffer = VK_NULL_HANDLE;
-				m_currentCommandBuffer.m_pFence = VK_NULL_HANDLE;
-			}
+			vkEndCommandBuffer( m_currentCommandBuffer.m_pCommandBuffer );
+
+			// Submit now
+			VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &m_currentCommandBuffer.m_pCommandBuffer;
+			vkQueueSubmit( m_pQueue, 1, &submitInfo, m_currentCommandBuffer.m_pFence );
+			m_currentCommandBuffer.m_nStagingSubmission = m_stagingRing.EndSubmission();
+			m_commandBuffers.push_front( m_currentCommandBuffer );
+
+			// Reset current command buffer
+			m_currentCommandBuffer.m_pCommandBuffer = VK_NULL_HANDLE;
+			m_currentCommandBuffer.m_pFence = VK_NULL_HANDLE;
 		}
-		vr::VRRenderModels()->FreeRenderModel( pModel );
-		vr::VRRenderModels()->FreeTexture( pTexture );
 	}
 
 	return pRenderModel;
@@ -3365,18 +5238,79 @@ void CMainApplication::SetupRenderModelForTrackedDevice( vr::TrackedDeviceIndex_
 	if( unTrackedDeviceIndex >= vr::k_unMaxTrackedDeviceCount )
 		return;
 
-	// try to find a model we've already set up
-	std::string sRenderModelName = GetTrackedDeviceString( m_pHMD, unTrackedDeviceIndex, vr::Prop_RenderModelName_String );
-	VulkanRenderModel *pRenderModel = FindOrLoadRenderModel( unTrackedDeviceIndex, sRenderModelName.c_str() );
-	if( !pRenderModel )
+	// the runtime loads the model in the background, UpdateRenderModelLoads creates it once it is ready
+	PendingRenderModel_t &pending = m_rPendingRenderModel[ unTrackedDeviceIndex ];
+	if( pending.m_pModel )
+	{
+		vr::VRRenderModels()->FreeRenderModel( pending.m_pModel );
+		pending.m_pModel = NULL;
+	}
+	pending.m_sName = GetTrackedDeviceString( m_pHMD, unTrackedDeviceIndex, vr::Prop_RenderModelName_String );
+	if( pending.m_sName.empty() )
 	{
 		std::string sTrackingSystemName = GetTrackedDeviceString( m_pHMD, unTrackedDeviceIndex, vr::Prop_TrackingSystemName_String );
-		dprintf( "Unable to load render model for tracked device %d (%s.%s)", unTrackedDeviceIndex, sTrackingSystemName.c_str(), sRenderModelName.c_str() );
+		dprintf( "Unable to load render model for tracked device %d (%s.%s)", unTrackedDeviceIndex, sTrackingSystemName.c_str(), pending.m_sName.c_str() );
 	}
-	else
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Polls the runtime once per frame for the render models that are
+//          still loading, so a device appearing never stalls the frame
+//-----------------------------------------------------------------------------
+void CMainApplication::UpdateRenderModelLoads()
+{
+	for( uint32_t unTrackedDevice = 0; unTrackedDevice < vr::k_unMaxTrackedDeviceCount; unTrackedDevice++ )
 	{
-		m_rTrackedDeviceToRenderModel[ unTrackedDeviceIndex ] = pRenderModel;
-		m_rbShowTrackedDevice[ unTrackedDeviceIndex ] = true;
+		PendingRenderModel_t &pending = m_rPendingRenderModel[ unTrackedDevice ];
+		if( pending.m_sName.empty() )
+			continue;
+
+		vr::EVRRenderModelError error;
+		if( !pending.m_pModel )
+		{
+			vr::RenderModel_t *pModel;
+			error = vr::VRRenderModels()->LoadRenderModel_Async( pending.m_sName.c_str(), &pModel );
+			if ( error == vr::VRRenderModelError_Loading )
+				continue;
+
+			if ( error != vr::VRRenderModelError_None )
+				dprintf( "Unable to load render model %s - %s\n", pending.m_sName.c_str(), vr::VRRenderModels()->GetRenderModelErrorNameFromEnum( error ) );
+			else
+				pending.m_pModel = pModel;
+		}
+
+		VulkanRenderModel *pRenderModel = NULL;
+		if( pending.m_pModel )
+		{
+			vr::RenderModel_TextureMap_t *pTexture;
+			error = vr::VRRenderModels()->LoadTexture_Async( pending.m_pModel->diffuseTextureId, &pTexture );
+			if ( error == vr::VRRenderModelError_Loading )
+				continue;
+
+			if ( error != vr::VRRenderModelError_None )
+			{
+				dprintf( "Unable to load render texture id:%d for render model %s\n", pending.m_pModel->diffuseTextureId, pending.m_sName.c_str() );
+			}
+			else
+			{
+				pRenderModel = CreateRenderModel( unTrackedDevice, pending.m_sName.c_str(), *pending.m_pModel, *pTexture );
+				vr::VRRenderModels()->FreeTexture( pTexture );
+			}
+			vr::VRRenderModels()->FreeRenderModel( pending.m_pModel );
+			pending.m_pModel = NULL;
+		}
+
+		if( !pRenderModel )
+		{
+			std::string sTrackingSystemName = GetTrackedDeviceString( m_pHMD, unTrackedDevice, vr::Prop_TrackingSystemName_String );
+			dprintf( "Unable to load render model for tracked device %d (%s.%s)", unTrackedDevice, sTrackingSystemName.c_str(), pending.m_sName.c_str() );
+		}
+		else
+		{
+			m_rTrackedDeviceToRenderModel[ unTrackedDevice ] = pRenderModel;
+			m_rbShowTrackedDevice[ unTrackedDevice ] = true;
+		}
+		pending.m_sName.clear();
 	}
 }
 
@@ -3414,25 +5348,34 @@ Matrix4 CMainApplication::ConvertSteamVRMatrixToMatrix4( const vr::HmdMatrix34_t
 	return matrixObj;
 }
 
+
+//-----------------------------------------------------------------------------
+// Purpose: Converts the device to tracking matrices of an array of poses
+//-----------------------------------------------------------------------------
+void CMainApplication::ConvertSteamVRMatrixToMatrix4( const vr::TrackedDevicePose_t *pPoses, Matrix4 *pMatrices, uint32_t unCount )
+{
+	convertRowMajor3x4( pMatrices, &pPoses[0].mDeviceToAbsoluteTracking.m[0][0], sizeof( vr::TrackedDevicePose_t ), (int)unCount );
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Create/destroy Vulkan Render Models
 //-----------------------------------------------------------------------------
 VulkanRenderModel::VulkanRenderModel( const std::string & sRenderModelName )
 	: m_sModelName( sRenderModelName )
 	, m_pDevice( VK_NULL_HANDLE )
+	, m_pAllocator( nullptr )
 	, m_pVertexBuffer( VK_NULL_HANDLE )
-	, m_pVertexBufferMemory( VK_NULL_HANDLE )
+	, m_vertexBufferAllocation()
 	, m_pIndexBuffer( VK_NULL_HANDLE )
-	, m_pIndexBufferMemory( VK_NULL_HANDLE )
+	, m_indexBufferAllocation()
 	, m_pImage( VK_NULL_HANDLE )
-	, m_pImageMemory( VK_NULL_HANDLE )
+	, m_imageAllocation()
 	, m_pImageView( VK_NULL_HANDLE )
-	, m_pImageStagingBuffer( VK_NULL_HANDLE )
-	, m_pImageStagingBufferMemory( VK_NULL_HANDLE )
 	, m_pSampler( VK_NULL_HANDLE )
+	, m_flBoundsRadius( 0.0f )
 {
 	memset( m_pConstantBuffer, 0, sizeof( m_pConstantBuffer ) );
-	memset( m_pConstantBufferMemory, 0, sizeof( m_pConstantBufferMemory ) );
+	memset( m_constantBufferAllocations, 0, sizeof( m_constantBufferAllocations ) );
 	memset( m_pConstantBufferData, 0, sizeof( m_pConstantBufferData ) );
 	memset( m_pDescriptorSets, 0, sizeof( m_pDescriptorSets ) );
 }
@@ -3445,18 +5388,17 @@ VulkanRenderModel::~VulkanRenderModel()
 //-----------------------------------------------------------------------------
 // Purpose: Allocates and populates the Vulkan resources for a render model
 //-----------------------------------------------------------------------------
-bool VulkanRenderModel::BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryProperties &memoryProperties, VkCommandBuffer pCommandBuffer, vr::TrackedDeviceIndex_t unTrackedDeviceIndex, VkDescriptorSet pDescriptorSets[ 2 ], const vr::RenderModel_t & vrModel, const vr::RenderModel_TextureMap_t & vrDiffuseTexture )
+bool VulkanRenderModel::BInit( VkDevice pDevice, CVulkanMemoryAllocator *pAllocator, CVulkanStagingRing *pStagingRing, VkCommandBuffer pCommandBuffer, bool bGenerateMipsOnGpu, vr::TrackedDeviceIndex_t unTrackedDeviceIndex, VkDescriptorSet pDescriptorSets[ k_unMaxFramesInFlight ][ 2 ], const vr::RenderModel_t & vrModel, const vr::RenderModel_TextureMap_t & vrDiffuseTexture )
 {
 	m_pDevice = pDevice;
-	m_physicalDeviceMemoryProperties = memoryProperties;
+	m_pAllocator = pAllocator;
 	m_unTrackedDeviceIndex = unTrackedDeviceIndex;
-	m_pDescriptorSets[ 0 ] = pDescriptorSets[ 0 ];
-	m_pDescriptorSets[ 1 ] = pDescriptorSets[ 1 ];
+	memcpy( m_pDescriptorSets, pDescriptorSets, sizeof( m_pDescriptorSets ) );
 
 	// Create and populate the vertex buffer
 	{
-		if ( !CreateVulkanBuffer( m_pDevice, m_physicalDeviceMemoryProperties, vrModel.rVertexData, sizeof( vr::RenderModel_Vertex_t ) * vrModel.unVertexCount, 
-								  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &m_pVertexBuffer, &m_pVertexBufferMemory ) )
+		if ( !CreateVulkanBuffer( m_pDevice, m_pAllocator, vrModel.rVertexData, sizeof( vr::RenderModel_Vertex_t ) * vrModel.unVertexCount, 
+								  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &m_pVertexBuffer, &m_vertexBufferAllocation ) )
 		{
 			return false;
 		}
@@ -3464,8 +5406,8 @@ bool VulkanRenderModel::BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryPro
 
 	// Create and populate the index buffer
 	{
-		if ( !CreateVulkanBuffer( m_pDevice, m_physicalDeviceMemoryProperties, vrModel.rIndexData, sizeof( uint16_t ) * vrModel.unTriangleCount * 3, 
-								  VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &m_pIndexBuffer, &m_pIndexBufferMemory ) )
+		if ( !CreateVulkanBuffer( m_pDevice, m_pAllocator, vrModel.rIndexData, sizeof( uint16_t ) * vrModel.unTriangleCount * 3, 
+								  VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &m_pIndexBuffer, &m_indexBufferAllocation ) )
 		{
 			return false;
 		}
@@ -3504,16 +5446,21 @@ bool VulkanRenderModel::BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryPro
 		int nMipWidth = nImageWidth;
 		int nMipHeight = nImageHeight;
 
-		while( nMipWidth > 1 && nMipHeight > 1 )
+		uint32_t unMipLevels = CountMipLevels( nImageWidth, nImageHeight );
+		if ( !bGenerateMipsOnGpu )
 		{
-			CMainApplication::GenMipMapRGBA( pPrevBuffer, pCurBuffer, nMipWidth, nMipHeight, &nMipWidth, &nMipHeight );
-			bufferImageCopy.bufferOffset = pCurBuffer - pBuffer;
-			bufferImageCopy.imageSubresource.mipLevel++;
-			bufferImageCopy.imageExtent.width = nMipWidth;
-			bufferImageCopy.imageExtent.height = nMipHeight;
-			bufferImageCopies.push_back( bufferImageCopy );
-			pPrevBuffer = pCurBuffer;
-			pCurBuffer += ( nMipWidth * nMipHeight * 4 * sizeof( uint8_t ) );
+			// Without GPU blits the whole chain is built here and uploaded
+			while( nMipWidth > 1 && nMipHeight > 1 )
+			{
+				CMainApplication::GenMipMapRGBA( pPrevBuffer, pCurBuffer, nMipWidth, nMipHeight, &nMipWidth, &nMipHeight );
+				bufferImageCopy.bufferOffset = pCurBuffer - pBuffer;
+				bufferImageCopy.imageSubresource.mipLevel++;
+				bufferImageCopy.imageExtent.width = nMipWidth;
+				bufferImageCopy.imageExtent.height = nMipHeight;
+				bufferImageCopies.push_back( bufferImageCopy );
+				pPrevBuffer = pCurBuffer;
+				pCurBuffer += ( nMipWidth * nMipHeight * 4 * sizeof( uint8_t ) );
+			}
 		}
 		nBufferSize = pCurBuffer - pBuffer;
 
@@ -3523,23 +5470,19 @@ bool VulkanRenderModel::BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryPro
 		imageCreateInfo.extent.width = nImageWidth;
 		imageCreateInfo.extent.height = nImageHeight;
 		imageCreateInfo.extent.depth = 1;
-		imageCreateInfo.mipLevels = ( uint32_t ) bufferImageCopies.size();
+		imageCreateInfo.mipLevels = unMipLevels;
 		imageCreateInfo.arrayLayers = 1;
 		imageCreateInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
 		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-		imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | ( bGenerateMipsOnGpu ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0 );
 		imageCreateInfo.flags = 0;
 		vkCreateImage( m_pDevice, &imageCreateInfo, nullptr, &m_pImage );
-
-		VkMemoryRequirements memoryRequirements = {};
-		vkGetImageMemoryRequirements( m_pDevice, m_pImage, &memoryRequirements );
-
-		VkMemoryAllocateInfo memoryAllocateInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
-		memoryAllocateInfo.allocationSize = memoryRequirements.size;
-		MemoryTypeFromProperties( m_physicalDeviceMemoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &memoryAllocateInfo.memoryTypeIndex );
-		vkAllocateMemory( m_pDevice, &memoryAllocateInfo, nullptr, &m_pImageMemory );
-		vkBindImageMemory( m_pDevice, m_pImage, m_pImageMemory, 0 );
+		if ( !m_pAllocator->BAllocateAndBindImage( m_pImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_imageAllocation ) )
+		{
+			delete [] pBuffer;
+			return false;
+		}
 
 		VkImageViewCreateInfo imageViewCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
 		imageViewCreateInfo.flags = 0;
@@ -3554,35 +5497,21 @@ bool VulkanRenderModel::BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryPro
 		imageViewCreateInfo.subresourceRange.layerCount = 1;
 		vkCreateImageView( m_pDevice, &imageViewCreateInfo, nullptr, &m_pImageView );
 
-		// Create a staging buffer
-		VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-		bufferCreateInfo.size = nBufferSize;
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		vkCreateBuffer( m_pDevice, &bufferCreateInfo, nullptr, &m_pImageStagingBuffer );
-		vkGetBufferMemoryRequirements( m_pDevice, m_pImageStagingBuffer, &memoryRequirements );
-
-		VkMemoryAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
-		MemoryTypeFromProperties( m_physicalDeviceMemoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &allocInfo.memoryTypeIndex );
-		allocInfo.allocationSize = memoryRequirements.size;
-
-		vkAllocateMemory( m_pDevice, &allocInfo, nullptr, &m_pImageStagingBufferMemory );
-		vkBindBufferMemory( m_pDevice, m_pImageStagingBuffer, m_pImageStagingBufferMemory, 0 );
-	
-		// Copy memory to the staging buffer
-		void *pData;
-		VkResult nResult = vkMapMemory( m_pDevice, m_pImageStagingBufferMemory, 0, VK_WHOLE_SIZE, 0, &pData );
-		if ( nResult != VK_SUCCESS )
+		// Copy memory to the staging ring
+		VkBuffer pStagingBuffer;
+		VkDeviceSize nStagingOffset;
+		void *pStagingData;
+		if ( !pStagingRing->BAllocate( nBufferSize, &pStagingBuffer, &nStagingOffset, &pStagingData ) )
 		{
-			dprintf( "vkMapMemory returned error %d\n", nResult );
+			delete [] pBuffer;
 			return false;
 		}
-		memcpy( pData, pBuffer, nBufferSize );
-		vkUnmapMemory( m_pDevice, m_pImageStagingBufferMemory );
-
-		VkMappedMemoryRange memoryRange = { VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
-		memoryRange.memory = m_pImageStagingBufferMemory;
-		memoryRange.size = VK_WHOLE_SIZE;
-		vkFlushMappedMemoryRanges( m_pDevice, 1, &memoryRange );
+		memcpy( pStagingData, pBuffer, nBufferSize );
+		delete [] pBuffer;
+		for ( size_t nCopy = 0; nCopy < bufferImageCopies.size(); nCopy++ )
+		{
+			bufferImageCopies[ nCopy ].bufferOffset += nStagingOffset;
+		}
 
 		// Transition the image to TRANSFER_DST to receive image
 		VkImageMemoryBarrier imageMemoryBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
@@ -3599,14 +5528,21 @@ bool VulkanRenderModel::BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryPro
 		vkCmdPipelineBarrier( pCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
 
 		// Issue the copy to fill the image data
-		vkCmdCopyBufferToImage( pCommandBuffer, m_pImageStagingBuffer, m_pImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ( uint32_t ) bufferImageCopies.size(), &bufferImageCopies[ 0 ] );
+		vkCmdCopyBufferToImage( pCommandBuffer, pStagingBuffer, m_pImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ( uint32_t ) bufferImageCopies.size(), &bufferImageCopies[ 0 ] );
 
-		// Transition the image to SHADER_READ_OPTIMAL for reading
-		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		vkCmdPipelineBarrier( pCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+		if ( bGenerateMipsOnGpu )
+		{
+			GenerateMipChainOnGpu( pCommandBuffer, m_pImage, nImageWidth, nImageHeight, unMipLevels );
+		}
+		else
+		{
+			// Transition the image to SHADER_READ_OPTIMAL for reading
+			imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			vkCmdPipelineBarrier( pCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+		}
 
 		// Create a sampler
 		VkSamplerCreateInfo samplerCreateInfo = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
@@ -3622,64 +5558,72 @@ bool VulkanRenderModel::BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryPro
 		vkCreateSampler( m_pDevice, &samplerCreateInfo, nullptr, &m_pSampler );
 	}
 
-	// Create a constant buffer to hold the transform (one for each eye)
-	for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+	// Create a constant buffer to hold the transform (one for each eye in each frame in flight)
+	for ( uint32_t nFrame = 0; nFrame < k_unMaxFramesInFlight; nFrame++ )
 	{
-		VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-		bufferCreateInfo.size = sizeof( Matrix4 );
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-		vkCreateBuffer( m_pDevice, &bufferCreateInfo, nullptr, &m_pConstantBuffer[ nEye ] );
+		for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+		{
+			VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+			bufferCreateInfo.size = sizeof( Matrix4 );
+			bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+			vkCreateBuffer( m_pDevice, &bufferCreateInfo, nullptr, &m_pConstantBuffer[ nFrame ][ nEye ] );
 		
-		VkMemoryRequirements memoryRequirements = {};
-		vkGetBufferMemoryRequirements( m_pDevice, m_pConstantBuffer[ nEye ], &memoryRequirements );
-		VkMemoryAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
-		MemoryTypeFromProperties( m_physicalDeviceMemoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &allocInfo.memoryTypeIndex );
-		allocInfo.allocationSize = memoryRequirements.size;
-
-		vkAllocateMemory( m_pDevice, &allocInfo, nullptr, &m_pConstantBufferMemory[ nEye ] );
-		vkBindBufferMemory( m_pDevice, m_pConstantBuffer[ nEye ], m_pConstantBufferMemory[ nEye ], 0 );
+			if ( !m_pAllocator->BAllocateAndBindBuffer( m_pConstantBuffer[ nFrame ][ nEye ], VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &m_constantBufferAllocations[ nFrame ][ nEye ] ) )
+			{
+				return false;
+			}
 
-		// Map and keep mapped persistently
-		vkMapMemory( m_pDevice, m_pConstantBufferMemory[ nEye ], 0, VK_WHOLE_SIZE, 0, &m_pConstantBufferData[ nEye ] );
+			// The allocator keeps the memory mapped persistently
+			m_pConstantBufferData[ nFrame ][ nEye ] = m_constantBufferAllocations[ nFrame ][ nEye ].m_pMappedData;
 
-		// Bake the descriptor set
-		VkDescriptorBufferInfo bufferInfo = {};
-		bufferInfo.buffer = m_pConstantBuffer[ nEye ];
-		bufferInfo.offset = 0;
-		bufferInfo.range = VK_WHOLE_SIZE;
+			// Bake the descriptor set
+			VkDescriptorBufferInfo bufferInfo = {};
+			bufferInfo.buffer = m_pConstantBuffer[ nFrame ][ nEye ];
+			bufferInfo.offset = 0;
+			bufferInfo.range = VK_WHOLE_SIZE;
 
-		VkDescriptorImageInfo imageInfo = {};
-		imageInfo.imageView = m_pImageView;
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			VkDescriptorImageInfo imageInfo = {};
+			imageInfo.imageView = m_pImageView;
+			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 		
-		VkDescriptorImageInfo samplerInfo = {};
-		samplerInfo.sampler = m_pSampler;
-
-		VkWriteDescriptorSet writeDescriptorSets[ 3 ] = { };
-		writeDescriptorSets[ 0 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[ 0 ].dstSet = m_pDescriptorSets[ nEye ];
-		writeDescriptorSets[ 0 ].dstBinding = 0;
-		writeDescriptorSets[ 0 ].descriptorCount = 1;
-		writeDescriptorSets[ 0 ].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		writeDescriptorSets[ 0 ].pBufferInfo = &bufferInfo;
-		writeDescriptorSets[ 1 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[ 1 ].dstSet = m_pDescriptorSets[ nEye ];
-		writeDescriptorSets[ 1 ].dstBinding = 1;
-		writeDescriptorSets[ 1 ].descriptorCount = 1;
-		writeDescriptorSets[ 1 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-		writeDescriptorSets[ 1 ].pImageInfo = &imageInfo;
-		writeDescriptorSets[ 2 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[ 2 ].dstSet = m_pDescriptorSets[ nEye ];
-		writeDescriptorSets[ 2 ].dstBinding = 2;
-		writeDescriptorSets[ 2 ].descriptorCount = 1;
-		writeDescriptorSets[ 2 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-		writeDescriptorSets[ 2 ].pImageInfo = &samplerInfo;
+			VkDescriptorImageInfo samplerInfo = {};
+			samplerInfo.sampler = m_pSampler;
+
+			VkWriteDescriptorSet writeDescriptorSets[ 3 ] = { };
+			writeDescriptorSets[ 0 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSets[ 0 ].dstSet = m_pDescriptorSets[ nFrame ][ nEye ];
+			writeDescriptorSets[ 0 ].dstBinding = 0;
+			writeDescriptorSets[ 0 ].descriptorCount = 1;
+			writeDescriptorSets[ 0 ].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			writeDescriptorSets[ 0 ].pBufferInfo = &bufferInfo;
+			writeDescriptorSets[ 1 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSets[ 1 ].dstSet = m_pDescriptorSets[ nFrame ][ nEye ];
+			writeDescriptorSets[ 1 ].dstBinding = 1;
+			writeDescriptorSets[ 1 ].descriptorCount = 1;
+			writeDescriptorSets[ 1 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			writeDescriptorSets[ 1 ].pImageInfo = &imageInfo;
+			writeDescriptorSets[ 2 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSets[ 2 ].dstSet = m_pDescriptorSets[ nFrame ][ nEye ];
+			writeDescriptorSets[ 2 ].dstBinding = 2;
+			writeDescriptorSets[ 2 ].descriptorCount = 1;
+			writeDescriptorSets[ 2 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+			writeDescriptorSets[ 2 ].pImageInfo = &samplerInfo;
 		
-		vkUpdateDescriptorSets( m_pDevice, _countof( writeDescriptorSets ), writeDescriptorSets, 0, nullptr );
+			vkUpdateDescriptorSets( m_pDevice, _countof( writeDescriptorSets ), writeDescriptorSets, 0, nullptr );
+		}
 	}
 
 	m_unVertexCount = vrModel.unTriangleCount * 3;
 
+	// bounding sphere around the center of the vertices' box, the positions gathered into
+	// separate x, y and z arrays so both passes run four vertices at a time
+	Vector3Batch vertexPositions;
+	vertexPositions.load( vrModel.rVertexData[ 0 ].vPosition.v, sizeof( vr::RenderModel_Vertex_t ), vrModel.unVertexCount );
+	Vector3 vMins, vMaxs;
+	vertexPositions.bounds( &vMins, &vMaxs );
+	m_vBoundsCenter = ( vMins + vMaxs ) * 0.5f;
+	m_flBoundsRadius = vertexPositions.maxDistance( m_vBoundsCenter );
+
 	return true;
 }
 
@@ -3694,10 +5638,9 @@ void VulkanRenderModel::Cleanup()
 		m_pVertexBuffer = VK_NULL_HANDLE;
 	}
 
-	if ( m_pVertexBufferMemory != VK_NULL_HANDLE )
+	if ( m_pAllocator != nullptr )
 	{
-		vkFreeMemory( m_pDevice, m_pVertexBufferMemory, nullptr );
-		m_pVertexBufferMemory = VK_NULL_HANDLE;
+		m_pAllocator->Free( &m_vertexBufferAllocation );
 	}
 
 	if ( m_pIndexBuffer != VK_NULL_HANDLE )
@@ -3706,10 +5649,9 @@ void VulkanRenderModel::Cleanup()
 		m_pIndexBuffer = VK_NULL_HANDLE;
 	}
 
-	if ( m_pIndexBufferMemory != VK_NULL_HANDLE )
+	if ( m_pAllocator != nullptr )
 	{
-		vkFreeMemory( m_pDevice, m_pIndexBufferMemory, nullptr );
-		m_pIndexBufferMemory = VK_NULL_HANDLE;
+		m_pAllocator->Free( &m_indexBufferAllocation );
 	}
 	
 	if ( m_pImage != VK_NULL_HANDLE )
@@ -3718,10 +5660,9 @@ void VulkanRenderModel::Cleanup()
 		m_pImage = VK_NULL_HANDLE;
 	}
 
-	if ( m_pImageMemory != VK_NULL_HANDLE )
+	if ( m_pAllocator != nullptr )
 	{
-		vkFreeMemory( m_pDevice, m_pImageMemory, nullptr );
-		m_pImageMemory = VK_NULL_HANDLE;
+		m_pAllocator->Free( &m_imageAllocation );
 	}
 	
 	if ( m_pImageView != VK_NULL_HANDLE )
@@ -3730,30 +5671,20 @@ void VulkanRenderModel::Cleanup()
 		m_pImageView = VK_NULL_HANDLE;
 	}
 
-	if ( m_pImageStagingBuffer != VK_NULL_HANDLE )
+	for ( uint32_t nFrame = 0; nFrame < k_unMaxFramesInFlight; nFrame++ )
 	{
-		vkDestroyBuffer( m_pDevice, m_pImageStagingBuffer, nullptr );
-		m_pImageStagingBuffer = VK_NULL_HANDLE;
-	}
-
-	if ( m_pImageStagingBufferMemory != VK_NULL_HANDLE )
-	{
-		vkFreeMemory( m_pDevice, m_pImageStagingBufferMemory, nullptr );
-		m_pImageStagingBufferMemory = VK_NULL_HANDLE;
-	}
-
-	for ( uint32_t nEye = 0; nEye < 2; nEye++ )
-	{
-		if ( m_pConstantBuffer[ nEye ] != VK_NULL_HANDLE )
+		for ( uint32_t nEye = 0; nEye < 2; nEye++ )
 		{
-			vkDestroyBuffer( m_pDevice, m_pConstantBuffer[ nEye ], nullptr );
-			m_pConstantBuffer[ nEye ] = VK_NULL_HANDLE;
-		}
+			if ( m_pConstantBuffer[ nFrame ][ nEye ] != VK_NULL_HANDLE )
+			{
+				vkDestroyBuffer( m_pDevice, m_pConstantBuffer[ nFrame ][ nEye ], nullptr );
+				m_pConstantBuffer[ nFrame ][ nEye ] = VK_NULL_HANDLE;
+			}
 
-		if ( m_pConstantBufferMemory != VK_NULL_HANDLE )
-		{
-			vkFreeMemory( m_pDevice, m_pConstantBufferMemory[ nEye ], nullptr );
-			m_pConstantBufferMemory[ nEye ] = VK_NULL_HANDLE;
+			if ( m_pAllocator != nullptr )
+			{
+				m_pAllocator->Free( &m_constantBufferAllocations[ nFrame ][ nEye ] );
+			}
 		}
 	}
 
@@ -3767,26 +5698,43 @@ void VulkanRenderModel::Cleanup()
 //-----------------------------------------------------------------------------
 // Purpose: Draws the render model
 //-----------------------------------------------------------------------------
-void VulkanRenderModel::Draw( vr::EVREye nEye, VkCommandBuffer pCommandBuffer, VkPipelineLayout pPipelineLayout, const Matrix4 &matMVP )
+void VulkanRenderModel::Draw( uint32_t nFrame, vr::EVREye nEye, VkCommandBuffer pCommandBuffer, VkPipelineLayout pPipelineLayout, const Matrix4 &matMVP )
 {
-	// Update the CB with the transform
-	memcpy( m_pConstantBufferData[ nEye ], &matMVP, sizeof( matMVP ) );
+	UpdateMatrix( nFrame, nEye, matMVP );
 
 	// Bind the descriptor set
-	vkCmdBindDescriptorSets( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pPipelineLayout, 0, 1, &m_pDescriptorSets[ nEye ], 0, nullptr );
+	vkCmdBindDescriptorSets( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pPipelineLayout, 0, 1, &m_pDescriptorSets[ nFrame ][ nEye ], 0, nullptr );
 	
-	// Bind the VB/IB and draw
+	DrawGeometry( pCommandBuffer );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Binds the VB/IB and draws, with whatever descriptors are bound
+//-----------------------------------------------------------------------------
+void VulkanRenderModel::DrawGeometry( VkCommandBuffer pCommandBuffer )
+{
 	VkDeviceSize nOffsets[ 1 ] = { 0 };
 	vkCmdBindVertexBuffers( pCommandBuffer, 0, 1, &m_pVertexBuffer, &nOffsets[ 0 ] );
 	vkCmdBindIndexBuffer( pCommandBuffer, m_pIndexBuffer, 0, VK_INDEX_TYPE_UINT16 );
 	vkCmdDrawIndexed( pCommandBuffer, m_unVertexCount, 1, 0, 0, 0 );
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Writes the transform into the frame's persistently mapped CB
+//-----------------------------------------------------------------------------
+void VulkanRenderModel::UpdateMatrix( uint32_t nFrame, vr::EVREye nEye, const Matrix4 &matMVP )
+{
+	memcpy( m_pConstantBufferData[ nFrame ][ nEye ], &matMVP, sizeof( matMVP ) );
+}
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
 int main(int argc, char *argv[])
 {
+	// find and map vrclient while the arguments are parsed and SDL starts up
+	vr::VR_PrefetchRuntime();
+
 	CMainApplication *pMainApplication = new CMainApplication( argc, argv );
 
 	if ( !pMainApplication->BInit() )
@@ -82,13 +82,13 @@ QString GetTrackedDeviceString( vr::IVRSystem *pHmd, vr::TrackedDeviceIndex_t un
 
 
 //-----------------------------------------------------------------------------
-// Purpose:
+// Purpose: Creates the overlay, named strDefaultName unless "-name" is given
 //-----------------------------------------------------------------------------
-bool COpenVROverlayController::Init()
+bool COpenVROverlayController::Init( const QString &strDefaultName )
 {
 	bool bSuccess = true;
 
-    m_strName = "systemoverlay";
+    m_strName = strDefaultName;
 
 	QStringList arguments = qApp->arguments();
 
@@ -134,9 +134,15 @@ bool COpenVROverlayController::Init()
         vr::VROverlay()->SetOverlayWidthInMeters( m_ulOverlayHandle, 1.5f );
         vr::VROverlay()->SetOverlayInputMethod( m_ulOverlayHandle, vr::VROverlayInputMethod_Mouse );
 	
+		// pump once per display frame so that mouse moves are coalesced to the rate the user can see them
+		int nPumpIntervalMs = 20;
+		float flDisplayFrequency = vr::VRSystem()->GetFloatTrackedDeviceProperty( vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float );
+		if( flDisplayFrequency > 0.f )
+			nPumpIntervalMs = qMax( 1, (int)( 1000.f / flDisplayFrequency ) );
+
 		m_pPumpEventsTimer = new QTimer( this );
 		connect(m_pPumpEventsTimer, SIGNAL( timeout() ), this, SLOT( OnTimeoutPumpEvents() ) );
-		m_pPumpEventsTimer->setInterval( 20 );
+		m_pPumpEventsTimer->setInterval( nPumpIntervalMs );
 		m_pPumpEventsTimer->start();
 
 	}
@@ -165,10 +171,26 @@ void COpenVROverlayController::Shutdown()
 
 
 //-----------------------------------------------------------------------------
-// Purpose:
+// Purpose: Re-renders only the parts of the scene that changed into the FBO
+//			and resubmits the texture. Damage that arrives while the overlay
+//			is hidden is kept until it is next visible.
 //-----------------------------------------------------------------------------
-void COpenVROverlayController::OnSceneChanged( const QList<QRectF>& )
+void COpenVROverlayController::OnSceneChanged( const QList<QRectF>& rectsChanged )
 {
+	if( !m_pFbo )
+		return;
+
+	// the widget sits at 0,0 so scene coordinates are texture coordinates
+	for( int i = 0; i < rectsChanged.size(); i++ )
+	{
+		m_dirtyRegion += rectsChanged[ i ].toAlignedRect();
+	}
+	m_dirtyRegion &= QRect( QPoint( 0, 0 ), m_pFbo->size() );
+
+	// nothing changed, so the texture the compositor already has is still good
+	if( m_dirtyRegion.isEmpty() )
+		return;
+
 	// skip rendering if the overlay isn't visible
     if( ( m_ulOverlayHandle == k_ulOverlayHandleInvalid ) || !vr::VROverlay() ||
         ( !vr::VROverlay()->IsOverlayVisible( m_ulOverlayHandle ) && !vr::VROverlay()->IsOverlayVisible( m_ulOverlayThumbnailHandle ) ) )
@@ -180,9 +202,20 @@ void COpenVROverlayController::OnSceneChanged( const QList<QRectF>& )
 	QOpenGLPaintDevice device( m_pFbo->size() );
 	QPainter painter( &device );
 
-	m_pScene->render( &painter );
+	QVector<QRect> rects = m_dirtyRegion.rects();
+	for( int i = 0; i < rects.size(); i++ )
+	{
+		// clear first so translucent parts of the widget don't accumulate over the old contents
+		painter.setCompositionMode( QPainter::CompositionMode_Source );
+		painter.fillRect( rects[ i ], Qt::transparent );
+		painter.setCompositionMode( QPainter::CompositionMode_SourceOver );
+
+		m_pScene->render( &painter, QRectF( rects[ i ] ), QRectF( rects[ i ] ) );
+	}
+	painter.end();
 
 	m_pFbo->release();
+	m_dirtyRegion = QRegion();
 
 	GLuint unTexture = m_pFbo->texture();
 	if( unTexture != 0 )
@@ -193,6 +226,31 @@ void COpenVROverlayController::OnSceneChanged( const QList<QRectF>& )
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Sends a single mouse move to the scene. Any repaint it causes
+//			comes back through the scene's changed() signal.
+//-----------------------------------------------------------------------------
+void COpenVROverlayController::SendMouseMove( const QPointF &ptNewMouse )
+{
+	QPoint ptGlobal = ptNewMouse.toPoint();
+	QGraphicsSceneMouseEvent mouseEvent( QEvent::GraphicsSceneMouseMove );
+	mouseEvent.setWidget( NULL );
+	mouseEvent.setPos( ptNewMouse );
+	mouseEvent.setScenePos( ptGlobal );
+	mouseEvent.setScreenPos( ptGlobal );
+	mouseEvent.setLastPos( m_ptLastMouse );
+	mouseEvent.setLastScenePos( m_pWidget->mapToGlobal( m_ptLastMouse.toPoint() ) );
+	mouseEvent.setLastScreenPos( m_pWidget->mapToGlobal( m_ptLastMouse.toPoint() ) );
+	mouseEvent.setButtons( m_lastMouseButtons );
+	mouseEvent.setButton( Qt::NoButton );
+	mouseEvent.setModifiers( 0 );
+	mouseEvent.setAccepted( false );
+
+	m_ptLastMouse = ptNewMouse;
+	QApplication::sendEvent( m_pScene, &mouseEvent );
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
@@ -201,32 +259,26 @@ void COpenVROverlayController::OnTimeoutPumpEvents()
     if( !vr::VRSystem() )
 		return;
 
+	// only the last mouse move of each pump is sent to the scene
+	bool bPendingMouseMove = false;
+	QPointF ptPendingMouse;
+
 	vr::VREvent_t vrEvent;
     while( vr::VROverlay()->PollNextOverlayEvent( m_ulOverlayHandle, &vrEvent, sizeof( vrEvent )  ) )
 	{
+		// button events use the last mouse position, so it has to be current before they are sent
+		if( bPendingMouseMove && vrEvent.eventType != vr::VREvent_MouseMove )
+		{
+			SendMouseMove( ptPendingMouse );
+			bPendingMouseMove = false;
+		}
+
 		switch( vrEvent.eventType )
 		{
 		case vr::VREvent_MouseMove:
 			{
-				QPointF ptNewMouse( vrEvent.data.mouse.x, vrEvent.data.mouse.y );
-				QPoint ptGlobal = ptNewMouse.toPoint();
-				QGraphicsSceneMouseEvent mouseEvent( QEvent::GraphicsSceneMouseMove );
-				mouseEvent.setWidget( NULL );
-				mouseEvent.setPos( ptNewMouse );
-				mouseEvent.setScenePos( ptGlobal );
-				mouseEvent.setScreenPos( ptGlobal );
-				mouseEvent.setLastPos( m_ptLastMouse );
-				mouseEvent.setLastScenePos( m_pWidget->mapToGlobal( m_ptLastMouse.toPoint() ) );
-				mouseEvent.setLastScreenPos( m_pWidget->mapToGlobal( m_ptLastMouse.toPoint() ) );
-				mouseEvent.setButtons( m_lastMouseButtons );
-				mouseEvent.setButton( Qt::NoButton );
-				mouseEvent.setModifiers( 0 );
-				mouseEvent.setAccepted( false );
-
-				m_ptLastMouse = ptNewMouse;
-				QApplication::sendEvent( m_pScene, &mouseEvent );
-
-				OnSceneChanged( QList<QRectF>() );
+				ptPendingMouse = QPointF( vrEvent.data.mouse.x, vrEvent.data.mouse.y );
+				bPendingMouseMove = true;
 			}
 			break;
 
@@ -292,6 +344,11 @@ void COpenVROverlayController::OnTimeoutPumpEvents()
 		}
 	}
 
+	if( bPendingMouseMove )
+	{
+		SendMouseMove( ptPendingMouse );
+	}
+
     if( m_ulOverlayThumbnailHandle != vr::k_ulOverlayHandleInvalid )
     {
         while( vr::VROverlay()->PollNextOverlayEvent( m_ulOverlayThumbnailHandle, &vrEvent, sizeof( vrEvent)  ) )
@@ -20,6 +20,7 @@
 #include <QtGui/QOpenGLFramebufferObject>
 #include <QtWidgets/QGraphicsScene>
 #include <QtGui/QOffscreenSurface>
+#include <QtGui/QRegion>
 
 class COpenVROverlayController : public QObject
 {
@@ -33,7 +34,7 @@ public:
     COpenVROverlayController();
     virtual ~COpenVROverlayController();
 
-	bool Init();
+	bool Init( const QString &strDefaultName = "systemoverlay" );
 	void Shutdown();
 	void EnableRestart();
 
@@ -56,6 +57,7 @@ protected:
 private:
 	bool ConnectToVRRuntime();
 	void DisconnectFromVRRuntime();
+	void SendMouseMove( const QPointF &ptNewMouse );
 
 	vr::TrackedDevicePose_t m_rTrackedDevicePose[ vr::k_unMaxTrackedDeviceCount ];
 	QString m_strVRDriver;
@@ -76,6 +78,9 @@ private:
 	QOpenGLFramebufferObject *m_pFbo;
 	QOffscreenSurface *m_pOffscreenSurface;
 
+	// parts of the FBO that are out of date with the scene
+	QRegion m_dirtyRegion;
+
 	QTimer *m_pPumpEventsTimer;
 
 	// the widget we're drawing into the texture
@@ -23,6 +23,48 @@
 const float DEG2RAD = 3.141593f / 180;
 const float EPSILON = 0.00001f;
 
+#if defined(MATRICES_SSE)
+#define MATRICES_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+#define MATRICES_SWIZZLE(v, x, y, z, w)    MATRICES_SHUFFLE(v, v, x, y, z, w)
+
+// a x b of the xyz lanes, w becomes 0 when both w are 0
+static inline __m128 cross3(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(MATRICES_SWIZZLE(a, 1, 2, 0, 3), MATRICES_SWIZZLE(b, 2, 0, 1, 3)),
+                      _mm_mul_ps(MATRICES_SWIZZLE(a, 2, 0, 1, 3), MATRICES_SWIZZLE(b, 1, 2, 0, 3)));
+}
+
+// sum of all 4 lanes, in every lane
+static inline __m128 horizontalSum(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ps(v, MATRICES_SWIZZLE(v, 1, 0, 0, 0));
+    return MATRICES_SWIZZLE(v, 0, 0, 0, 0);
+}
+
+// 2x2 matrices are packed as (m00, m01, m10, m11) for the block inverse below
+// A * B
+static inline __m128 mat2Mul(__m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, MATRICES_SWIZZLE(b, 0, 3, 0, 3)),
+                      _mm_mul_ps(MATRICES_SWIZZLE(a, 1, 0, 3, 2), MATRICES_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// adj(A) * B
+static inline __m128 mat2AdjMul(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(MATRICES_SWIZZLE(a, 3, 3, 0, 0), b),
+                      _mm_mul_ps(MATRICES_SWIZZLE(a, 1, 1, 2, 2), MATRICES_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+// A * adj(B)
+static inline __m128 mat2MulAdj(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, MATRICES_SWIZZLE(b, 3, 0, 3, 0)),
+                      _mm_mul_ps(MATRICES_SWIZZLE(a, 1, 0, 3, 2), MATRICES_SWIZZLE(b, 2, 1, 2, 1)));
+}
+#endif
+
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -249,6 +291,50 @@ Matrix4& Matrix4::invertEuclidean()
 ///////////////////////////////////////////////////////////////////////////////
 Matrix4& Matrix4::invertAffine()
 {
+#if defined(MATRICES_SSE)
+    // the rows of R^-1 are the cross products of the columns of R over det(R)
+    const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    const __m128 c0 = _mm_and_ps(MATRICES_LOAD(m), mask);
+    const __m128 c1 = _mm_and_ps(MATRICES_LOAD(m + 4), mask);
+    const __m128 c2 = _mm_and_ps(MATRICES_LOAD(m + 8), mask);
+    __m128 r0 = cross3(c1, c2);
+    __m128 r1 = cross3(c2, c0);
+    __m128 r2 = cross3(c0, c1);
+    __m128 r3 = _mm_setzero_ps();
+    const __m128 determinant = horizontalSum(_mm_mul_ps(c0, r0));
+    if(fabs(_mm_cvtss_f32(determinant)) <= EPSILON)
+    {
+        // same as Matrix3::invert(), R^-1 becomes identity
+        r0 = _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f);
+        r1 = _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f);
+        r2 = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+    }
+    else
+    {
+        const __m128 invDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+        r0 = _mm_mul_ps(r0, invDeterminant);
+        r1 = _mm_mul_ps(r1, invDeterminant);
+        r2 = _mm_mul_ps(r2, invDeterminant);
+    }
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);  // now the columns of R^-1
+
+    // -R^-1 * T
+    __m128 t = _mm_add_ps(_mm_mul_ps(r0, _mm_set1_ps(m[12])), _mm_mul_ps(r1, _mm_set1_ps(m[13])));
+    t = _mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(t, _mm_mul_ps(r2, _mm_set1_ps(m[14]))));
+
+    // the 4th row is left unchanged, like the scalar code does
+    float tmp[16];
+    _mm_storeu_ps(tmp, r0);
+    _mm_storeu_ps(tmp + 4, r1);
+    _mm_storeu_ps(tmp + 8, r2);
+    _mm_storeu_ps(tmp + 12, t);
+    m[0] = tmp[0];   m[1] = tmp[1];   m[2] = tmp[2];
+    m[4] = tmp[4];   m[5] = tmp[5];   m[6] = tmp[6];
+    m[8] = tmp[8];   m[9] = tmp[9];   m[10]= tmp[10];
+    m[12]= tmp[12];  m[13]= tmp[13];  m[14]= tmp[14];
+
+    return *this;
+#else
     // R^-1
     Matrix3 r(m[0],m[1],m[2], m[4],m[5],m[6], m[8],m[9],m[10]);
     r.invert();
@@ -269,6 +355,7 @@ Matrix4& Matrix4::invertAffine()
     //m[15] = 1.0f;
 
     return * this;
+#endif
 }
 
 
@@ -348,6 +435,59 @@ Matrix4& Matrix4::invertProjective()
 ///////////////////////////////////////////////////////////////////////////////
 Matrix4& Matrix4::invertGeneral()
 {
+#if defined(MATRICES_SSE)
+    // Blockwise inverse with 2x2 adjugates. The columns are treated as the rows
+    // of M^T; the inverse of M^T written out by rows is M^-1 by columns.
+    //   M^T = [ A | B ]   M^-1 = 1/|M| [ |D|A - B(D#C)  ... ]#, see the 2x2 helpers
+    //         [ C | D ]
+    const __m128 v0 = MATRICES_LOAD(m);
+    const __m128 v1 = MATRICES_LOAD(m + 4);
+    const __m128 v2 = MATRICES_LOAD(m + 8);
+    const __m128 v3 = MATRICES_LOAD(m + 12);
+
+    const __m128 a = _mm_movelh_ps(v0, v1);
+    const __m128 b = _mm_movehl_ps(v1, v0);
+    const __m128 c = _mm_movelh_ps(v2, v3);
+    const __m128 d = _mm_movehl_ps(v3, v2);
+
+    // (|A|, |B|, |C|, |D|)
+    const __m128 detSub = _mm_sub_ps(_mm_mul_ps(MATRICES_SHUFFLE(v0, v2, 0, 2, 0, 2), MATRICES_SHUFFLE(v1, v3, 1, 3, 1, 3)),
+                                     _mm_mul_ps(MATRICES_SHUFFLE(v0, v2, 1, 3, 1, 3), MATRICES_SHUFFLE(v1, v3, 0, 2, 0, 2)));
+    const __m128 detA = MATRICES_SWIZZLE(detSub, 0, 0, 0, 0);
+    const __m128 detB = MATRICES_SWIZZLE(detSub, 1, 1, 1, 1);
+    const __m128 detC = MATRICES_SWIZZLE(detSub, 2, 2, 2, 2);
+    const __m128 detD = MATRICES_SWIZZLE(detSub, 3, 3, 3, 3);
+
+    const __m128 dc = mat2AdjMul(d, c);     // D#C
+    const __m128 ab = mat2AdjMul(a, b);     // A#B
+    __m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), mat2Mul(b, dc));     // X# = |D|A - B(D#C)
+    __m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), mat2Mul(c, ab));     // W# = |A|D - C(A#B)
+    __m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), mat2MulAdj(d, ab));  // Y# = |B|C - D(A#B)#
+    __m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), mat2MulAdj(a, dc));  // Z# = |C|B - A(D#C)#
+
+    // |M| = |A||D| + |B||C| - tr((A#B)(D#C))
+    const __m128 trace = horizontalSum(_mm_mul_ps(ab, MATRICES_SWIZZLE(dc, 0, 2, 1, 3)));
+    const __m128 determinant = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), trace);
+    if(fabs(_mm_cvtss_f32(determinant)) <= EPSILON)
+    {
+        return identity();
+    }
+
+    // 1/|M| with the signs of the 2x2 adjugate
+    const __m128 invDeterminant = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), determinant);
+    x = _mm_mul_ps(x, invDeterminant);
+    y = _mm_mul_ps(y, invDeterminant);
+    z = _mm_mul_ps(z, invDeterminant);
+    w = _mm_mul_ps(w, invDeterminant);
+
+    // finishing the adjugates and interleaving the blocks in one shuffle each
+    MATRICES_STORE(m, MATRICES_SHUFFLE(x, y, 3, 1, 3, 1));
+    MATRICES_STORE(m + 4, MATRICES_SHUFFLE(x, y, 2, 0, 2, 0));
+    MATRICES_STORE(m + 8, MATRICES_SHUFFLE(z, w, 3, 1, 3, 1));
+    MATRICES_STORE(m + 12, MATRICES_SHUFFLE(z, w, 2, 0, 2, 0));
+
+    return *this;
+#else
     // get cofactors of minor matrices
     float cofactor0 = getCofactor(m[5],m[6],m[7], m[9],m[10],m[11], m[13],m[14],m[15]);
     float cofactor1 = getCofactor(m[4],m[6],m[7], m[8],m[10],m[11], m[12],m[14],m[15]);
@@ -401,6 +541,87 @@ Matrix4& Matrix4::invertGeneral()
     m[15]=  invDeterminant * cofactor15;
 
     return *this;
+#endif
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// multiply count vectors by the matrix, same as operator* on each of them.
+// in and out may be the same array.
+///////////////////////////////////////////////////////////////////////////////
+void Matrix4::transform(const Vector4* in, Vector4* out, int count) const
+{
+#if defined(MATRICES_SSE)
+    const __m128 c0 = MATRICES_LOAD(m);
+    const __m128 c1 = MATRICES_LOAD(m + 4);
+    const __m128 c2 = MATRICES_LOAD(m + 8);
+    const __m128 c3 = MATRICES_LOAD(m + 12);
+    for(int i = 0; i < count; ++i)
+    {
+        const Vector4 v = in[i];
+        __m128 r = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(v.x)), _mm_mul_ps(c1, _mm_set1_ps(v.y)));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(v.z)));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(v.w)));
+        _mm_storeu_ps(&out[i].x, r);
+    }
+#else
+    for(int i = 0; i < count; ++i)
+        out[i] = *this * in[i];
+#endif
+}
+
+
+
+void Matrix4::transform(const Vector3* in, Vector3* out, int count) const
+{
+#if defined(MATRICES_SSE)
+    const __m128 c0 = MATRICES_LOAD(m);
+    const __m128 c1 = MATRICES_LOAD(m + 4);
+    const __m128 c2 = MATRICES_LOAD(m + 8);
+    for(int i = 0; i < count; ++i)
+    {
+        const Vector3 v = in[i];
+        __m128 r = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(v.x)), _mm_mul_ps(c1, _mm_set1_ps(v.y)));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(v.z)));
+        _mm_storel_pi((__m64*)&out[i].x, r);
+        _mm_store_ss(&out[i].z, _mm_movehl_ps(r, r));
+    }
+#else
+    for(int i = 0; i < count; ++i)
+        out[i] = *this * in[i];
+#endif
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// convert row major 3x4 matrices to Matrix4, transposing them
+///////////////////////////////////////////////////////////////////////////////
+void convertRowMajor3x4(Matrix4* dst, const float* src, size_t srcStride, int count)
+{
+    for(int i = 0; i < count; ++i)
+    {
+        const float* s = (const float*)((const char*)src + i * srcStride);
+#if defined(MATRICES_SSE)
+        __m128 r0 = _mm_loadu_ps(s);
+        __m128 r1 = _mm_loadu_ps(s + 4);
+        __m128 r2 = _mm_loadu_ps(s + 8);
+        __m128 r3 = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        float columns[16];
+        _mm_storeu_ps(columns, r0);
+        _mm_storeu_ps(columns + 4, r1);
+        _mm_storeu_ps(columns + 8, r2);
+        _mm_storeu_ps(columns + 12, r3);
+        dst[i].set(columns);
+#else
+        dst[i].set(s[0], s[4], s[8], 0.0f,
+                   s[1], s[5], s[9], 0.0f,
+                   s[2], s[6], s[10], 0.0f,
+                   s[3], s[7], s[11], 1.0f);
+#endif
+    }
 }
 
 
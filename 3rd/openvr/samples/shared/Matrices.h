@@ -21,8 +21,28 @@
 
 #include <iostream>
 #include <iomanip>
+#include <cstddef>
 #include "Vectors.h"
 
+// Matrix4 multiplication, inversion and the batch functions use SSE when the
+// compiler targets it. Define MATRICES_NO_SIMD to build the scalar code only,
+// and MATRICES_ALIGNED to keep Matrix4 storage 16-byte aligned so that it is
+// read and written with aligned loads and stores.
+#if !defined(MATRICES_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MATRICES_SSE
+#include <emmintrin.h>
+#endif
+
+#if defined(MATRICES_ALIGNED)
+#define MATRICES_ALIGN alignas(16)
+#define MATRICES_LOAD(p) _mm_load_ps(p)
+#define MATRICES_STORE(p, v) _mm_store_ps(p, v)
+#else
+#define MATRICES_ALIGN
+#define MATRICES_LOAD(p) _mm_loadu_ps(p)
+#define MATRICES_STORE(p, v) _mm_storeu_ps(p, v)
+#endif
+
 ///////////////////////////////////////////////////////////////////////////
 // 2x2 matrix
 ///////////////////////////////////////////////////////////////////////////
@@ -189,6 +209,8 @@ public:
     Vector3     operator*(const Vector3& rhs) const;    // multiplication: v' = M * v
     Matrix4     operator*(const Matrix4& rhs) const;    // multiplication: M3 = M1 * M2
     Matrix4&    operator*=(const Matrix4& rhs);         // multiplication: M1' = M1 * M2
+    void        transform(const Vector4* in, Vector4* out, int count) const; // batch: out[i] = M * in[i]
+    void        transform(const Vector3* in, Vector3* out, int count) const; // batch: out[i] = M * in[i]
     bool        operator==(const Matrix4& rhs) const;   // exact compare, no epsilon
     bool        operator!=(const Matrix4& rhs) const;   // exact compare, no epsilon
     float       operator[](int index) const;            // subscript operator v[0], v[1]
@@ -207,11 +229,17 @@ private:
                             float m3, float m4, float m5,
                             float m6, float m7, float m8);
 
-    float m[16];
-    float tm[16];                                       // transpose m
+    MATRICES_ALIGN float m[16];
+    MATRICES_ALIGN float tm[16];                        // transpose m
 
 };
 
+// converts count row major 3x4 matrices (such as vr::HmdMatrix34_t) to Matrix4
+// with (0,0,0,1) as the 4th row. srcStride is the distance in bytes from one
+// source matrix to the next, so the matrices can be read in place from an
+// array of structs such as vr::TrackedDevicePose_t.
+void convertRowMajor3x4(Matrix4* dst, const float* src, size_t srcStride, int count);
+
 
 
 ///////////////////////////////////////////////////////////////////////////
@@ -798,10 +826,20 @@ inline Matrix4& Matrix4::operator-=(const Matrix4& rhs)
 
 inline Vector4 Matrix4::operator*(const Vector4& rhs) const
 {
+#if defined(MATRICES_SSE)
+    // sum of the columns scaled by the vector, in the same order as the scalar code
+    __m128 v = _mm_add_ps(_mm_mul_ps(MATRICES_LOAD(m), _mm_set1_ps(rhs.x)), _mm_mul_ps(MATRICES_LOAD(m + 4), _mm_set1_ps(rhs.y)));
+    v = _mm_add_ps(v, _mm_mul_ps(MATRICES_LOAD(m + 8), _mm_set1_ps(rhs.z)));
+    v = _mm_add_ps(v, _mm_mul_ps(MATRICES_LOAD(m + 12), _mm_set1_ps(rhs.w)));
+    float r[4];
+    _mm_storeu_ps(r, v);
+    return Vector4(r[0], r[1], r[2], r[3]);
+#else
     return Vector4(m[0]*rhs.x + m[4]*rhs.y + m[8]*rhs.z  + m[12]*rhs.w,
                    m[1]*rhs.x + m[5]*rhs.y + m[9]*rhs.z  + m[13]*rhs.w,
                    m[2]*rhs.x + m[6]*rhs.y + m[10]*rhs.z + m[14]*rhs.w,
                    m[3]*rhs.x + m[7]*rhs.y + m[11]*rhs.z + m[15]*rhs.w);
+#endif
 }
 
 
@@ -817,10 +855,28 @@ inline Vector3 Matrix4::operator*(const Vector3& rhs) const
 
 inline Matrix4 Matrix4::operator*(const Matrix4& n) const
 {
+#if defined(MATRICES_SSE)
+    // each column of the result is the columns of m scaled by a column of n
+    const __m128 c0 = MATRICES_LOAD(m);
+    const __m128 c1 = MATRICES_LOAD(m + 4);
+    const __m128 c2 = MATRICES_LOAD(m + 8);
+    const __m128 c3 = MATRICES_LOAD(m + 12);
+    float r[16];
+    for(int i = 0; i < 16; i += 4)
+    {
+        const __m128 b = MATRICES_LOAD(n.m + i);
+        __m128 v = _mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0))), _mm_mul_ps(c1, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+        v = _mm_add_ps(v, _mm_mul_ps(c2, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
+        v = _mm_add_ps(v, _mm_mul_ps(c3, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+        _mm_storeu_ps(r + i, v);
+    }
+    return Matrix4(r);
+#else
     return Matrix4(m[0]*n[0]  + m[4]*n[1]  + m[8]*n[2]  + m[12]*n[3],   m[1]*n[0]  + m[5]*n[1]  + m[9]*n[2]  + m[13]*n[3],   m[2]*n[0]  + m[6]*n[1]  + m[10]*n[2]  + m[14]*n[3],   m[3]*n[0]  + m[7]*n[1]  + m[11]*n[2]  + m[15]*n[3],
                    m[0]*n[4]  + m[4]*n[5]  + m[8]*n[6]  + m[12]*n[7],   m[1]*n[4]  + m[5]*n[5]  + m[9]*n[6]  + m[13]*n[7],   m[2]*n[4]  + m[6]*n[5]  + m[10]*n[6]  + m[14]*n[7],   m[3]*n[4]  + m[7]*n[5]  + m[11]*n[6]  + m[15]*n[7],
                    m[0]*n[8]  + m[4]*n[9]  + m[8]*n[10] + m[12]*n[11],  m[1]*n[8]  + m[5]*n[9]  + m[9]*n[10] + m[13]*n[11],  m[2]*n[8]  + m[6]*n[9]  + m[10]*n[10] + m[14]*n[11],  m[3]*n[8]  + m[7]*n[9]  + m[11]*n[10] + m[15]*n[11],
                    m[0]*n[12] + m[4]*n[13] + m[8]*n[14] + m[12]*n[15],  m[1]*n[12] + m[5]*n[13] + m[9]*n[14] + m[13]*n[15],  m[2]*n[12] + m[6]*n[13] + m[10]*n[14] + m[14]*n[15],  m[3]*n[12] + m[7]*n[13] + m[11]*n[14] + m[15]*n[15]);
+#endif
 }
 
 
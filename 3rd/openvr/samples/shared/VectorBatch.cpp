@@ -0,0 +1,508 @@
+///////////////////////////////////////////////////////////////////////////////
+// VectorBatch.cpp
+// ===============
+// Structure of arrays batch of 3D vectors
+//
+// The operations on the batch itself run over whole groups of 4, padding
+// included, which the capacity always holds. Those that reduce the batch or
+// write to the caller's arrays stop at size().
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+#include "VectorBatch.h"
+
+#if defined(MATRICES_SSE)
+// smallest and largest of the 4 lanes
+static inline float horizontalMin(__m128 v)
+{
+    v = _mm_min_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_min_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+static inline float horizontalMax(__m128 v)
+{
+    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_max_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(v);
+}
+#endif
+
+// number of floats the group loops run over
+static inline int paddedCount(int count)
+{
+    return (count + 3) & ~3;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ctors, copy and move
+///////////////////////////////////////////////////////////////////////////////
+Vector3Batch::Vector3Batch() : data(0), block(0), count(0), capacity(0)
+{
+}
+
+Vector3Batch::Vector3Batch(int count) : data(0), block(0), count(0), capacity(0)
+{
+    allocate(count);
+}
+
+Vector3Batch::Vector3Batch(const Vector3Batch& rhs) : data(0), block(0), count(0), capacity(0)
+{
+    *this = rhs;
+}
+
+Vector3Batch::Vector3Batch(Vector3Batch&& rhs) : data(rhs.data), block(rhs.block), count(rhs.count), capacity(rhs.capacity)
+{
+    rhs.data = 0;
+    rhs.block = 0;
+    rhs.count = rhs.capacity = 0;
+}
+
+Vector3Batch::~Vector3Batch()
+{
+    release();
+}
+
+Vector3Batch& Vector3Batch::operator=(const Vector3Batch& rhs)
+{
+    if(this != &rhs)
+    {
+        if(rhs.count > capacity)
+            allocate(rhs.count);
+        count = rhs.count;
+        if(count > 0)
+        {
+            std::memcpy(x(), rhs.x(), count * sizeof(float));
+            std::memcpy(y(), rhs.y(), count * sizeof(float));
+            std::memcpy(z(), rhs.z(), count * sizeof(float));
+        }
+    }
+    return *this;
+}
+
+Vector3Batch& Vector3Batch::operator=(Vector3Batch&& rhs)
+{
+    if(this != &rhs)
+    {
+        release();
+        std::swap(data, rhs.data);
+        std::swap(block, rhs.block);
+        std::swap(count, rhs.count);
+        std::swap(capacity, rhs.capacity);
+    }
+    return *this;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// replace the storage with count zero vectors
+///////////////////////////////////////////////////////////////////////////////
+void Vector3Batch::allocate(int count)
+{
+    release();
+    if(count <= 0)
+        return;
+
+    capacity = (count + 7) & ~7;
+    size_t bytes = 3 * (size_t)capacity * sizeof(float);
+    block = std::malloc(bytes + 31);
+    if(!block)
+    {
+        capacity = 0;
+        return;
+    }
+    data = (float*)(((uintptr_t)block + 31) & ~(uintptr_t)31);
+    std::memset(data, 0, bytes);
+    this->count = count;
+}
+
+void Vector3Batch::release()
+{
+    std::free(block);
+    data = 0;
+    block = 0;
+    count = capacity = 0;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// change the number of vectors
+///////////////////////////////////////////////////////////////////////////////
+void Vector3Batch::resize(int count)
+{
+    if(count < 0)
+        count = 0;
+    if(count > capacity)
+    {
+        Vector3Batch grown(std::max(count, capacity * 2));
+        grown = *this;
+        *this = std::move(grown);
+    }
+    else if(count > this->count)
+    {
+        // the lanes past the old size may hold what earlier operations left in the padding
+        std::memset(x() + this->count, 0, (count - this->count) * sizeof(float));
+        std::memset(y() + this->count, 0, (count - this->count) * sizeof(float));
+        std::memset(z() + this->count, 0, (count - this->count) * sizeof(float));
+    }
+    this->count = count;
+}
+
+
+
+Vector3 Vector3Batch::get(int index) const
+{
+    return Vector3(x()[index], y()[index], z()[index]);
+}
+
+void Vector3Batch::set(int index, const Vector3& v)
+{
+    x()[index] = v.x;
+    y()[index] = v.y;
+    z()[index] = v.z;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// gather from and scatter to strided arrays of structs
+///////////////////////////////////////////////////////////////////////////////
+void Vector3Batch::load(const float* src, size_t srcStride, int count)
+{
+    resize(count);
+    float* px = x();
+    float* py = y();
+    float* pz = z();
+    for(int i = 0; i < count; ++i)
+    {
+        const float* s = (const float*)((const char*)src + i * srcStride);
+        px[i] = s[0];
+        py[i] = s[1];
+        pz[i] = s[2];
+    }
+}
+
+void Vector3Batch::store(float* dst, size_t dstStride) const
+{
+    const float* px = x();
+    const float* py = y();
+    const float* pz = z();
+    for(int i = 0; i < count; ++i)
+    {
+        float* d = (float*)((char*)dst + i * dstStride);
+        d[0] = px[i];
+        d[1] = py[i];
+        d[2] = pz[i];
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// multiply every vector by the matrix, as a point or as a direction
+///////////////////////////////////////////////////////////////////////////////
+void Vector3Batch::transformPoints(const Matrix4& m)
+{
+    float* px = x();
+    float* py = y();
+    float* pz = z();
+    const int n = paddedCount(count);
+#if defined(MATRICES_SSE)
+    const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+    const __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+    const __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+    const __m128 m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]);
+    for(int i = 0; i < n; i += 4)
+    {
+        const __m128 vx = _mm_load_ps(px + i);
+        const __m128 vy = _mm_load_ps(py + i);
+        const __m128 vz = _mm_load_ps(pz + i);
+        _mm_store_ps(px + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, vx), _mm_mul_ps(m4, vy)), _mm_add_ps(_mm_mul_ps(m8, vz), m12)));
+        _mm_store_ps(py + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, vx), _mm_mul_ps(m5, vy)), _mm_add_ps(_mm_mul_ps(m9, vz), m13)));
+        _mm_store_ps(pz + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, vx), _mm_mul_ps(m6, vy)), _mm_add_ps(_mm_mul_ps(m10, vz), m14)));
+    }
+#else
+    for(int i = 0; i < n; ++i)
+    {
+        const float vx = px[i], vy = py[i], vz = pz[i];
+        px[i] = m[0]*vx + m[4]*vy + m[8]*vz + m[12];
+        py[i] = m[1]*vx + m[5]*vy + m[9]*vz + m[13];
+        pz[i] = m[2]*vx + m[6]*vy + m[10]*vz + m[14];
+    }
+#endif
+}
+
+void Vector3Batch::transformDirections(const Matrix4& m)
+{
+    float* px = x();
+    float* py = y();
+    float* pz = z();
+    const int n = paddedCount(count);
+#if defined(MATRICES_SSE)
+    const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+    const __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+    const __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+    for(int i = 0; i < n; i += 4)
+    {
+        const __m128 vx = _mm_load_ps(px + i);
+        const __m128 vy = _mm_load_ps(py + i);
+        const __m128 vz = _mm_load_ps(pz + i);
+        _mm_store_ps(px + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, vx), _mm_mul_ps(m4, vy)), _mm_mul_ps(m8, vz)));
+        _mm_store_ps(py + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, vx), _mm_mul_ps(m5, vy)), _mm_mul_ps(m9, vz)));
+        _mm_store_ps(pz + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, vx), _mm_mul_ps(m6, vy)), _mm_mul_ps(m10, vz)));
+    }
+#else
+    for(int i = 0; i < n; ++i)
+    {
+        const float vx = px[i], vy = py[i], vz = pz[i];
+        px[i] = m[0]*vx + m[4]*vy + m[8]*vz;
+        py[i] = m[1]*vx + m[5]*vy + m[9]*vz;
+        pz[i] = m[2]*vx + m[6]*vy + m[10]*vz;
+    }
+#endif
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// add a vector to or scale every vector
+///////////////////////////////////////////////////////////////////////////////
+Vector3Batch& Vector3Batch::operator+=(const Vector3& v)
+{
+    float* px = x();
+    float* py = y();
+    float* pz = z();
+    const int n = paddedCount(count);
+#if defined(MATRICES_SSE)
+    const __m128 ax = _mm_set1_ps(v.x), ay = _mm_set1_ps(v.y), az = _mm_set1_ps(v.z);
+    for(int i = 0; i < n; i += 4)
+    {
+        _mm_store_ps(px + i, _mm_add_ps(_mm_load_ps(px + i), ax));
+        _mm_store_ps(py + i, _mm_add_ps(_mm_load_ps(py + i), ay));
+        _mm_store_ps(pz + i, _mm_add_ps(_mm_load_ps(pz + i), az));
+    }
+#else
+    for(int i = 0; i < n; ++i)
+    {
+        px[i] += v.x;
+        py[i] += v.y;
+        pz[i] += v.z;
+    }
+#endif
+    return *this;
+}
+
+Vector3Batch& Vector3Batch::operator*=(float scale)
+{
+    float* px = x();
+    float* py = y();
+    float* pz = z();
+    const int n = paddedCount(count);
+#if defined(MATRICES_SSE)
+    const __m128 s = _mm_set1_ps(scale);
+    for(int i = 0; i < n; i += 4)
+    {
+        _mm_store_ps(px + i, _mm_mul_ps(_mm_load_ps(px + i), s));
+        _mm_store_ps(py + i, _mm_mul_ps(_mm_load_ps(py + i), s));
+        _mm_store_ps(pz + i, _mm_mul_ps(_mm_load_ps(pz + i), s));
+    }
+#else
+    for(int i = 0; i < n; ++i)
+    {
+        px[i] *= scale;
+        py[i] *= scale;
+        pz[i] *= scale;
+    }
+#endif
+    return *this;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// scale every non zero vector to unit length
+///////////////////////////////////////////////////////////////////////////////
+void Vector3Batch::normalize()
+{
+    float* px = x();
+    float* py = y();
+    float* pz = z();
+    const int n = paddedCount(count);
+#if defined(MATRICES_SSE)
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    for(int i = 0; i < n; i += 4)
+    {
+        const __m128 vx = _mm_load_ps(px + i);
+        const __m128 vy = _mm_load_ps(py + i);
+        const __m128 vz = _mm_load_ps(pz + i);
+        const __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+        // a full precision divide, as Vector3::normalize, and 1 for zero vectors
+        const __m128 nonZero = _mm_cmpgt_ps(lengthSq, zero);
+        __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSq));
+        invLength = _mm_or_ps(_mm_and_ps(nonZero, invLength), _mm_andnot_ps(nonZero, one));
+        _mm_store_ps(px + i, _mm_mul_ps(vx, invLength));
+        _mm_store_ps(py + i, _mm_mul_ps(vy, invLength));
+        _mm_store_ps(pz + i, _mm_mul_ps(vz, invLength));
+    }
+#else
+    for(int i = 0; i < n; ++i)
+    {
+        const float lengthSq = px[i]*px[i] + py[i]*py[i] + pz[i]*pz[i];
+        if(lengthSq > 0.0f)
+        {
+            const float invLength = 1.0f / sqrtf(lengthSq);
+            px[i] *= invLength;
+            py[i] *= invLength;
+            pz[i] *= invLength;
+        }
+    }
+#endif
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// dot and cross product of each pair of vectors
+///////////////////////////////////////////////////////////////////////////////
+void Vector3Batch::dot(const Vector3Batch& rhs, float* out) const
+{
+    const float* ax = x();
+    const float* ay = y();
+    const float* az = z();
+    const float* bx = rhs.x();
+    const float* by = rhs.y();
+    const float* bz = rhs.z();
+    const int n = std::min(count, rhs.count);
+    int i = 0;
+#if defined(MATRICES_SSE)
+    for(; i + 4 <= n; i += 4)
+    {
+        const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(ax + i), _mm_load_ps(bx + i)),
+                                               _mm_mul_ps(_mm_load_ps(ay + i), _mm_load_ps(by + i))),
+                                    _mm_mul_ps(_mm_load_ps(az + i), _mm_load_ps(bz + i)));
+        _mm_storeu_ps(out + i, d);
+    }
+#endif
+    for(; i < n; ++i)
+        out[i] = ax[i]*bx[i] + ay[i]*by[i] + az[i]*bz[i];
+}
+
+void Vector3Batch::cross(const Vector3Batch& rhs, Vector3Batch* out) const
+{
+    const int n = std::min(count, rhs.count);
+    out->resize(n);
+    const float* ax = x();
+    const float* ay = y();
+    const float* az = z();
+    const float* bx = rhs.x();
+    const float* by = rhs.y();
+    const float* bz = rhs.z();
+    float* ox = out->x();
+    float* oy = out->y();
+    float* oz = out->z();
+    // every lane is read before it is written, so out may be either input
+#if defined(MATRICES_SSE)
+    const int padded = paddedCount(n);
+    for(int i = 0; i < padded; i += 4)
+    {
+        const __m128 vax = _mm_load_ps(ax + i), vay = _mm_load_ps(ay + i), vaz = _mm_load_ps(az + i);
+        const __m128 vbx = _mm_load_ps(bx + i), vby = _mm_load_ps(by + i), vbz = _mm_load_ps(bz + i);
+        _mm_store_ps(ox + i, _mm_sub_ps(_mm_mul_ps(vay, vbz), _mm_mul_ps(vaz, vby)));
+        _mm_store_ps(oy + i, _mm_sub_ps(_mm_mul_ps(vaz, vbx), _mm_mul_ps(vax, vbz)));
+        _mm_store_ps(oz + i, _mm_sub_ps(_mm_mul_ps(vax, vby), _mm_mul_ps(vay, vbx)));
+    }
+#else
+    for(int i = 0; i < n; ++i)
+    {
+        const float vax = ax[i], vay = ay[i], vaz = az[i];
+        const float vbx = bx[i], vby = by[i], vbz = bz[i];
+        ox[i] = vay*vbz - vaz*vby;
+        oy[i] = vaz*vbx - vax*vbz;
+        oz[i] = vax*vby - vay*vbx;
+    }
+#endif
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// axis aligned bounds of all vectors
+///////////////////////////////////////////////////////////////////////////////
+void Vector3Batch::bounds(Vector3* mins, Vector3* maxs) const
+{
+    if(count == 0)
+        return;
+
+    const float* px = x();
+    const float* py = y();
+    const float* pz = z();
+    Vector3 lo(px[0], py[0], pz[0]);
+    Vector3 hi = lo;
+    int i = 0;
+#if defined(MATRICES_SSE)
+    if(count >= 4)
+    {
+        __m128 loX = _mm_load_ps(px), loY = _mm_load_ps(py), loZ = _mm_load_ps(pz);
+        __m128 hiX = loX, hiY = loY, hiZ = loZ;
+        for(i = 4; i + 4 <= count; i += 4)
+        {
+            const __m128 vx = _mm_load_ps(px + i);
+            const __m128 vy = _mm_load_ps(py + i);
+            const __m128 vz = _mm_load_ps(pz + i);
+            loX = _mm_min_ps(loX, vx); hiX = _mm_max_ps(hiX, vx);
+            loY = _mm_min_ps(loY, vy); hiY = _mm_max_ps(hiY, vy);
+            loZ = _mm_min_ps(loZ, vz); hiZ = _mm_max_ps(hiZ, vz);
+        }
+        lo.set(horizontalMin(loX), horizontalMin(loY), horizontalMin(loZ));
+        hi.set(horizontalMax(hiX), horizontalMax(hiY), horizontalMax(hiZ));
+    }
+#endif
+    for(; i < count; ++i)
+    {
+        lo.set(std::min(lo.x, px[i]), std::min(lo.y, py[i]), std::min(lo.z, pz[i]));
+        hi.set(std::max(hi.x, px[i]), std::max(hi.y, py[i]), std::max(hi.z, pz[i]));
+    }
+    *mins = lo;
+    *maxs = hi;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// distance from point to the farthest vector
+///////////////////////////////////////////////////////////////////////////////
+float Vector3Batch::maxDistance(const Vector3& point) const
+{
+    const float* px = x();
+    const float* py = y();
+    const float* pz = z();
+    float maxSq = 0.0f;
+    int i = 0;
+#if defined(MATRICES_SSE)
+    const __m128 cx = _mm_set1_ps(point.x), cy = _mm_set1_ps(point.y), cz = _mm_set1_ps(point.z);
+    __m128 maxSq4 = _mm_setzero_ps();
+    for(; i + 4 <= count; i += 4)
+    {
+        const __m128 dx = _mm_sub_ps(_mm_load_ps(px + i), cx);
+        const __m128 dy = _mm_sub_ps(_mm_load_ps(py + i), cy);
+        const __m128 dz = _mm_sub_ps(_mm_load_ps(pz + i), cz);
+        maxSq4 = _mm_max_ps(maxSq4, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+    }
+    maxSq = horizontalMax(maxSq4);
+#endif
+    for(; i < count; ++i)
+    {
+        const float dx = px[i] - point.x, dy = py[i] - point.y, dz = pz[i] - point.z;
+        maxSq = std::max(maxSq, dx*dx + dy*dy + dz*dz);
+    }
+    return sqrtf(maxSq);
+}
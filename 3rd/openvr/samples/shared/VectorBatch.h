@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// VectorBatch.h
+// =============
+// Structure of arrays batch of 3D vectors
+//
+// Vector3Batch keeps the x, y and z of many vectors in three separate arrays,
+// each 32-byte aligned and padded to a multiple of 8 floats, so whole groups
+// of vectors are processed with one SIMD instruction per component instead of
+// one Vector3 at a time. Use it where many positions, bone offsets or mesh
+// vertices go through the same operation.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef VECTOR_BATCH_H_DEF
+#define VECTOR_BATCH_H_DEF
+
+#include <cstddef>
+#include "Vectors.h"
+#include "Matrices.h"
+
+class Vector3Batch
+{
+public:
+    // ctors
+    Vector3Batch();
+    explicit Vector3Batch(int count);                   // count zero vectors
+    Vector3Batch(const Vector3Batch& rhs);
+    Vector3Batch(Vector3Batch&& rhs);
+    ~Vector3Batch();
+
+    Vector3Batch& operator=(const Vector3Batch& rhs);
+    Vector3Batch& operator=(Vector3Batch&& rhs);
+
+    // size and element access
+    void        resize(int count);                      // keeps the first vectors, new ones are zero
+    int         size() const        { return count; }
+    Vector3     get(int index) const;
+    void        set(int index, const Vector3& v);
+
+    // the component arrays, 32-byte aligned; the floats past size() are padding
+    float*       x()                { return data; }
+    float*       y()                { return data + capacity; }
+    float*       z()                { return data + 2 * capacity; }
+    const float* x() const          { return data; }
+    const float* y() const          { return data + capacity; }
+    const float* z() const          { return data + 2 * capacity; }
+
+    // gather/scatter count vectors of 3 floats, srcStride/dstStride bytes apart,
+    // so they can be read from and written to an array of structs in place
+    void        load(const float* src, size_t srcStride, int count);
+    void        store(float* dst, size_t dstStride) const;
+
+    // batch operations
+    void        transformPoints(const Matrix4& m);      // v = M * (x,y,z,1), no perspective divide
+    void        transformDirections(const Matrix4& m);  // v = M * v, the same as Matrix4 * Vector3
+    Vector3Batch& operator+=(const Vector3& v);         // add v to every vector
+    Vector3Batch& operator*=(float scale);              // scale every vector
+    void        normalize();                            // zero vectors are left as they are
+    void        dot(const Vector3Batch& rhs, float* out) const;   // out[i] = this[i] . rhs[i]
+    void        cross(const Vector3Batch& rhs, Vector3Batch* out) const; // out[i] = this[i] x rhs[i], out may be this
+    void        bounds(Vector3* mins, Vector3* maxs) const;       // axis aligned box, unchanged when empty
+    float       maxDistance(const Vector3& point) const;          // the farthest vector from point, 0 when empty
+
+private:
+    void        allocate(int count);
+    void        release();
+
+    float*      data;                                   // x, y and z arrays of capacity floats each
+    void*       block;                                  // what data was carved from
+    int         count;
+    int         capacity;                               // multiple of 8
+};
+
+#endif
@@ -0,0 +1,160 @@
+//========= Copyright Valve Corporation ============//
+#include "foveation.h"
+#include "strtools.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void Foveation_InitSettings( FoveationSettings_t *pSettings )
+{
+	pSettings->m_bEnabled = false;
+	for ( int nEye = 0; nEye < 2; nEye++ )
+	{
+		pSettings->m_rbCenterSet[ nEye ] = false;
+		pSettings->m_rProfile[ nEye ].m_flCenterU = 0.5f;
+		pSettings->m_rProfile[ nEye ].m_flCenterV = 0.5f;
+		pSettings->m_rProfile[ nEye ].m_flInnerRadius = 0.35f;
+		pSettings->m_rProfile[ nEye ].m_flOuterRadius = 0.7f;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns true if the n values after argv[ nArg ] are there and none
+//          of them is the next option
+//-----------------------------------------------------------------------------
+static bool HasValues( int argc, char *argv[], int nArg, int nValues )
+{
+	if ( argc <= nArg + nValues )
+		return false;
+
+	for ( int i = 1; i <= nValues; i++ )
+	{
+		if ( *argv[ nArg + i ] == '-' )
+			return false;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+bool Foveation_ParseArg( int argc, char *argv[], int *pnArg, FoveationSettings_t *pSettings )
+{
+	int nArg = *pnArg;
+	if ( !stricmp( argv[ nArg ], "-foveate" ) )
+	{
+		pSettings->m_bEnabled = true;
+		if ( HasValues( argc, argv, nArg, 2 ) )
+		{
+			for ( int nEye = 0; nEye < 2; nEye++ )
+			{
+				pSettings->m_rProfile[ nEye ].m_flInnerRadius = ( float )atof( argv[ nArg + 1 ] );
+				pSettings->m_rProfile[ nEye ].m_flOuterRadius = ( float )atof( argv[ nArg + 2 ] );
+			}
+			*pnArg += 2;
+		}
+		return true;
+	}
+
+	int nEye = -1;
+	if ( !stricmp( argv[ nArg ], "-foveateleft" ) )
+		nEye = 0;
+	else if ( !stricmp( argv[ nArg ], "-foveateright" ) )
+		nEye = 1;
+	if ( nEye < 0 || !HasValues( argc, argv, nArg, 4 ) )
+		return false;
+
+	FoveationProfile_t &profile = pSettings->m_rProfile[ nEye ];
+	profile.m_flCenterU = ( float )atof( argv[ nArg + 1 ] );
+	profile.m_flCenterV = ( float )atof( argv[ nArg + 2 ] );
+	profile.m_flInnerRadius = ( float )atof( argv[ nArg + 3 ] );
+	profile.m_flOuterRadius = ( float )atof( argv[ nArg + 4 ] );
+	pSettings->m_rbCenterSet[ nEye ] = true;
+	pSettings->m_bEnabled = true;
+	*pnArg += 4;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: The view axis is where the tangent is zero, the tangents run from
+//          left to right and top to bottom across the target
+//-----------------------------------------------------------------------------
+void Foveation_SetDefaultCenter( FoveationSettings_t *pSettings, int nEye, float flLeft, float flRight, float flTop, float flBottom )
+{
+	if ( pSettings->m_rbCenterSet[ nEye ] || flRight == flLeft || flBottom == flTop )
+		return;
+
+	pSettings->m_rProfile[ nEye ].m_flCenterU = -flLeft / ( flRight - flLeft );
+	pSettings->m_rProfile[ nEye ].m_flCenterV = -flTop / ( flBottom - flTop );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Classifies each tile by the distance of its centre from the
+//          profile's centre, measured in half target heights
+//-----------------------------------------------------------------------------
+void Foveation_BuildRateImage( const FoveationProfile_t &profile, uint32_t unWidth, uint32_t unHeight, uint32_t unTileWidth, uint32_t unTileHeight, bool bBottomUp, std::vector< uint8_t > *pvecRates )
+{
+	uint32_t unTilesX = ( unWidth + unTileWidth - 1 ) / unTileWidth;
+	uint32_t unTilesY = ( unHeight + unTileHeight - 1 ) / unTileHeight;
+	pvecRates->resize( ( size_t )unTilesX * unTilesY );
+
+	float flCenterX = profile.m_flCenterU * unWidth;
+	float flCenterY = profile.m_flCenterV * unHeight;
+	float flScale = 2.0f / unHeight;
+
+	for ( uint32_t y = 0; y < unTilesY; y++ )
+	{
+		float flY = ( y + 0.5f ) * unTileHeight;
+		if ( bBottomUp )
+			flY = unHeight - flY;
+
+		for ( uint32_t x = 0; x < unTilesX; x++ )
+		{
+			float flX = ( x + 0.5f ) * unTileWidth;
+			float flDistance = sqrtf( ( flX - flCenterX ) * ( flX - flCenterX ) + ( flY - flCenterY ) * ( flY - flCenterY ) ) * flScale;
+
+			uint8_t unRate = k_eFoveationRate_4x4;
+			if ( flDistance < profile.m_flInnerRadius )
+				unRate = k_eFoveationRate_Full;
+			else if ( flDistance < profile.m_flOuterRadius )
+				unRate = k_eFoveationRate_2x2;
+			( *pvecRates )[ y * unTilesX + x ] = unRate;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+float Foveation_GetInvocationFraction( const std::vector< uint8_t > &vecRates )
+{
+	static const float k_rflInvocations[ k_eFoveationRate_Count ] = { 1.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+	if ( vecRates.empty() )
+		return 1.0f;
+
+	double flSum = 0.0;
+	for ( size_t i = 0; i < vecRates.size(); i++ )
+		flSum += k_rflInvocations[ vecRates[ i ] < k_eFoveationRate_Count ? ( uint32_t )vecRates[ i ] : ( uint32_t )k_eFoveationRate_Full ];
+	return ( float )( flSum / vecRates.size() );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void Foveation_CombineRateImages( const std::vector< uint8_t > &vecOther, std::vector< uint8_t > *pvecRates )
+{
+	for ( size_t i = 0; i < pvecRates->size() && i < vecOther.size(); i++ )
+	{
+		if ( vecOther[ i ] < ( *pvecRates )[ i ] )
+			( *pvecRates )[ i ] = vecOther[ i ];
+	}
+}
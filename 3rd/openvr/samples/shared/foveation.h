@@ -0,0 +1,57 @@
+//========= Copyright Valve Corporation ============//
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+/** Coarser shading steps of a fixed foveation profile, each API maps them to its own rate values */
+enum EFoveationRate
+{
+	k_eFoveationRate_Full,                                   // one invocation per pixel
+	k_eFoveationRate_2x2,                                    // one invocation per 2x2 pixels
+	k_eFoveationRate_4x4,                                    // one invocation per 4x4 pixels
+	k_eFoveationRate_Count
+};
+
+/** Fixed foveation for one eye. Pixels closer to the centre than the inner
+* radius shade at full rate, those out to the outer radius at 2x2 and the rest
+* at 4x4. The centre is in render target UV, v down from the top row, and the
+* radii are fractions of half the target's height. */
+struct FoveationProfile_t
+{
+	float m_flCenterU;
+	float m_flCenterV;
+	float m_flInnerRadius;
+	float m_flOuterRadius;
+};
+
+/** What the foveation command line arguments asked for */
+struct FoveationSettings_t
+{
+	bool m_bEnabled;
+	bool m_rbCenterSet[ 2 ];                                 // else Foveation_SetDefaultCenter picks the eye's centre
+	FoveationProfile_t m_rProfile[ 2 ];
+};
+
+/** Disabled, with a 0.35 / 0.7 profile for -foveate without values */
+void Foveation_InitSettings( FoveationSettings_t *pSettings );
+
+/** Consumes -foveate <inner> <outer> ( both eyes ), -foveateleft <u> <v> <inner> <outer>
+* or -foveateright <u> <v> <inner> <outer> at argv[ *pnArg ] and leaves *pnArg on
+* its last value. Returns false if argv[ *pnArg ] is not one of them. */
+bool Foveation_ParseArg( int argc, char *argv[], int *pnArg, FoveationSettings_t *pSettings );
+
+/** Centres an eye that wasn't given a centre where its view axis crosses the
+* render target, from the eye's raw projection tangents ( IVRSystem::GetProjectionRaw ). */
+void Foveation_SetDefaultCenter( FoveationSettings_t *pSettings, int nEye, float flLeft, float flRight, float flTop, float flBottom );
+
+/** Fills one EFoveationRate per tile of a unWidth x unHeight target split into
+* unTileWidth x unTileHeight tiles, row by row. The first row is the top of the
+* target, or the bottom when bBottomUp is set as GL textures are. */
+void Foveation_BuildRateImage( const FoveationProfile_t &profile, uint32_t unWidth, uint32_t unHeight, uint32_t unTileWidth, uint32_t unTileHeight, bool bBottomUp, std::vector< uint8_t > *pvecRates );
+
+/** The fraction of the full rate pixel shader invocations an image leaves, edge tiles counted whole */
+float Foveation_GetInvocationFraction( const std::vector< uint8_t > &vecRates );
+
+/** Keeps the finer rate of each tile of two images of the same size, for a pass that draws both eyes */
+void Foveation_CombineRateImages( const std::vector< uint8_t > &vecOther, std::vector< uint8_t > *pvecRates );
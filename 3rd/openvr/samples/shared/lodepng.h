@@ -82,6 +82,31 @@ source files with custom allocators.*/
 #endif
 #endif
 
+#ifdef LODEPNG_COMPILE_ALLOCATORS
+/*
+Memory functions used by the built in allocators. Every allocation lodepng makes goes
+through them, including the buffers it returns to you, so with custom functions set
+those returned buffers must be released with your free_func instead of free. context is
+passed back unchanged to each call. All three functions must be given; they may be
+called from the encoder's worker threads when numthreads is used.
+*/
+typedef struct LodePNGAllocator
+{
+  void* (*malloc_func)(size_t size, void* context);
+  void* (*realloc_func)(void* ptr, size_t new_size, void* context);
+  void (*free_func)(void* ptr, void* context);
+  void* context;
+} LodePNGAllocator;
+
+/*
+Installs allocator hooks, e.g. a pool so that repeated decodes of same-size images reuse
+their scratch memory. Pass NULL to restore malloc, realloc and free. The setting is global:
+change it only while no decode or encode is running, and not between allocating a buffer
+and freeing it.
+*/
+void lodepng_set_allocator(const LodePNGAllocator* allocator);
+#endif /*LODEPNG_COMPILE_ALLOCATORS*/
+
 #ifdef LODEPNG_COMPILE_PNG
 /*The PNG color types (also used for raw).*/
 typedef enum LodePNGColorType
@@ -286,6 +311,10 @@ struct LodePNGCompressSettings /*deflate = compress*/
   unsigned minmatch; /*mininum lz77 length. 3 is normally best, 6 can be better for some PNGs. Default: 0*/
   unsigned nicematch; /*stop searching if >= this length found. Set to 258 for best compression. Default: 128*/
   unsigned lazymatching; /*use lazy matching: better compression but a bit slower. Default: true*/
+  /*number of threads deflate may split large inputs over, each compressing its own part without
+  references into the others (slightly larger output). 0 uses one per hardware thread. Only has effect
+  when lodepng is compiled as C++11 and the input is at least 512 KB. Default: 1*/
+  unsigned numthreads;
 
   /*use custom zlib encoder instead of built in one (default: null)*/
   unsigned (*custom_zlib)(unsigned char**, size_t*,
@@ -647,6 +676,36 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
                         LodePNGState* state,
                         const unsigned char* in, size_t insize);
 
+/*
+Same as lodepng_decode, but decodes into the caller's buffer out of outsize bytes instead of
+allocating one, e.g. a texture upload staging buffer reused for every frame. Nothing is
+allocated for the output: when no color conversion is needed the image is unfiltered straight
+into out. outsize must be at least lodepng_get_raw_size of the image in the output color mode
+(use lodepng_inspect to get w and h first if needed), otherwise error 91 is returned.
+*/
+unsigned lodepng_decode_into(unsigned char* out, size_t outsize, unsigned* w, unsigned* h,
+                             LodePNGState* state,
+                             const unsigned char* in, size_t insize);
+
+/*
+Receives one decoded row of lodepng_decode_rows: rowsize bytes, lodepng_get_raw_size of a
+w x 1 image in the output color mode. Return nonzero to stop decoding with error 92.
+*/
+typedef unsigned (*LodePNGRowCallback)(const unsigned char* row, size_t rowsize, unsigned y, void* context);
+
+/*
+Same as lodepng_decode, but hands the image to callback one row at a time, top to bottom,
+instead of returning it. Rows are unfiltered and converted in a small scratch buffer, so the
+callback can copy each straight into a mapped upload buffer (a GL pixel buffer object, Vulkan
+staging memory, a D3D12 upload heap) without the whole image ever being allocated, and
+without reading back from memory that may be write-combined. Every row starts at a byte, also
+below 8 bits per pixel. Adam7 interlaced images are still decoded whole before the first row
+is handed out. The row pointer is only valid during the call.
+*/
+unsigned lodepng_decode_rows(LodePNGRowCallback callback, void* context, unsigned* w, unsigned* h,
+                             LodePNGState* state,
+                             const unsigned char* in, size_t insize);
+
 /*
 Read the PNG header, but not the actual data. This returns only the information
 that is in the header chunk of the PNG, such as width, height and color type. The
@@ -826,6 +885,47 @@ unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
                 State& state,
                 const std::vector<unsigned char>& in);
+/*
+Same as lodepng_decode_into. The vector version replaces the contents of out (unlike decode,
+which appends) and keeps its capacity, so decoding same-size images into the same vector
+doesn't reallocate it.
+*/
+unsigned decode_into(unsigned char* out, size_t outsize, unsigned& w, unsigned& h,
+                     State& state,
+                     const unsigned char* in, size_t insize);
+unsigned decode_into(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
+                     State& state,
+                     const unsigned char* in, size_t insize);
+//Same as lodepng_decode_rows.
+unsigned decode_rows(LodePNGRowCallback callback, void* context, unsigned& w, unsigned& h,
+                     State& state,
+                     const unsigned char* in, size_t insize);
+
+/*
+One image of a decode_batch call. Give either the PNG in memory with in and insize (it must
+stay valid during the call) or a filename to load it from; out, w, h and error are the results.
+*/
+struct BatchImage
+{
+  BatchImage() : in(0), insize(0), w(0), h(0), error(0) {}
+  const unsigned char* in;
+  size_t insize;
+  std::string filename;
+  std::vector<unsigned char> out;
+  unsigned w, h;
+  unsigned error;
+};
+
+/*
+Decodes all images to the given color type on numthreads threads (0: one per hardware thread),
+the calling thread being one of them. Each thread keeps its own State and file buffer for all
+the images it takes, and results always land in the image they belong to, so the order of
+images is kept. Files are read on the threads as well. Returns the error of the first image
+that failed, or 0. When lodepng isn't compiled as C++11 the images are decoded one by one.
+*/
+unsigned decode_batch(std::vector<BatchImage>& images,
+                      LodePNGColorType colortype = LCT_RGBA, unsigned bitdepth = 8,
+                      unsigned numthreads = 0);
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_ENCODER
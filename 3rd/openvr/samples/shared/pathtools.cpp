@@ -653,7 +653,34 @@ bool Path_WriteBinaryFile(const std::string &strFilename, unsigned char *pData,
 		fclose(f);
 	}
 
-	return written = nSize ? true : false;
+	return written == nSize;
+}
+
+bool Path_WriteBinaryFileAtomic( const std::string &strFilename, unsigned char *pData, unsigned nSize )
+{
+	std::string strTmpFilename = strFilename + ".tmp";
+
+	if ( !Path_WriteBinaryFile( strTmpFilename, pData, nSize ) )
+		return false;
+
+	// Platform specific atomic file replacement
+#if defined( _WIN32 )
+	std::wstring wsFilename = UTF8to16( strFilename.c_str() );
+	std::wstring wsTmpFilename = UTF8to16( strTmpFilename.c_str() );
+	if ( !::ReplaceFileW( wsFilename.c_str(), wsTmpFilename.c_str(), nullptr, 0, 0, 0 ) )
+	{
+		// ReplaceFile needs an existing file to replace, so the first write is a plain move
+		if ( !::MoveFileExW( wsTmpFilename.c_str(), wsFilename.c_str(), MOVEFILE_REPLACE_EXISTING ) )
+			return false;
+	}
+#elif defined( POSIX )
+	if ( rename( strTmpFilename.c_str(), strFilename.c_str() ) == -1 )
+		return false;
+#else
+#error Do not know how to write atomic file
+#endif
+
+	return true;
 }
 
 std::string Path_ReadTextFile( const std::string &strFilename )
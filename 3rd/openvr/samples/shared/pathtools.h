@@ -84,6 +84,7 @@ std::string Path_FindParentSubDirectoryRecursively( const std::string &strStartD
 unsigned char * Path_ReadBinaryFile( const std::string &strFilename, int *pSize );
 uint32_t  Path_ReadBinaryFile( const std::string &strFilename, unsigned char *pBuffer, uint32_t unSize );
 bool Path_WriteBinaryFile( const std::string &strFilename, unsigned char *pData, unsigned nSize );
+bool Path_WriteBinaryFileAtomic( const std::string &strFilename, unsigned char *pData, unsigned nSize );
 std::string Path_ReadTextFile( const std::string &strFilename );
 bool Path_WriteStringToTextFile( const std::string &strFilename, const char *pchData );
 bool Path_WriteStringToTextFileAtomic( const std::string &strFilename, const char *pchData );
@@ -0,0 +1,210 @@
+//========= Copyright Valve Corporation ============//
+#include "scenecull.h"
+
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Purpose: Each plane is the fourth row of the matrix plus or minus one of the
+//          other three, normalized so the sphere test can use distances
+//-----------------------------------------------------------------------------
+void Frustum_FromViewProjection( const Matrix4 &matViewProjection, Frustum_t *pFrustum )
+{
+	const float *m = matViewProjection.get();
+	for ( int i = 0; i < 3; i++ )
+	{
+		pFrustum->m_rPlanes[ i * 2 + 0 ] = Vector4( m[ 3 ] + m[ i ], m[ 7 ] + m[ 4 + i ], m[ 11 ] + m[ 8 + i ], m[ 15 ] + m[ 12 + i ] );
+		pFrustum->m_rPlanes[ i * 2 + 1 ] = Vector4( m[ 3 ] - m[ i ], m[ 7 ] - m[ 4 + i ], m[ 11 ] - m[ 8 + i ], m[ 15 ] - m[ 12 + i ] );
+	}
+
+	for ( int i = 0; i < 6; i++ )
+	{
+		Vector4 &plane = pFrustum->m_rPlanes[ i ];
+		float flLength = sqrtf( plane.x * plane.x + plane.y * plane.y + plane.z * plane.z );
+		if ( flLength > 0.0f )
+			plane /= flLength;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+bool Frustum_BSphereOutsideAll( const Frustum_t *pFrusta, uint32_t unFrustumCount, const Vector3 &vCenter, float flRadius )
+{
+	for ( uint32_t unFrustum = 0; unFrustum < unFrustumCount; unFrustum++ )
+	{
+		bool bOutside = false;
+		for ( int i = 0; i < 6 && !bOutside; i++ )
+		{
+			const Vector4 &plane = pFrusta[ unFrustum ].m_rPlanes[ i ];
+			bOutside = plane.x * vCenter.x + plane.y * vCenter.y + plane.z * vCenter.z + plane.w < -flRadius;
+		}
+		if ( !bOutside )
+			return false;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns -1 if the box is outside the frustum, 1 if it is entirely
+//          inside and 0 if it straddles a plane
+//-----------------------------------------------------------------------------
+static int ClassifyBox( const Frustum_t &frustum, const Vector3 &vMins, const Vector3 &vMaxs )
+{
+	int nResult = 1;
+	for ( int i = 0; i < 6; i++ )
+	{
+		const Vector4 &plane = frustum.m_rPlanes[ i ];
+
+		// the corners furthest along and furthest against the plane normal
+		float flFar = plane.w
+			+ plane.x * ( plane.x >= 0.0f ? vMaxs.x : vMins.x )
+			+ plane.y * ( plane.y >= 0.0f ? vMaxs.y : vMins.y )
+			+ plane.z * ( plane.z >= 0.0f ? vMaxs.z : vMins.z );
+		if ( flFar < 0.0f )
+			return -1;
+
+		float flNear = plane.w
+			+ plane.x * ( plane.x >= 0.0f ? vMins.x : vMaxs.x )
+			+ plane.y * ( plane.y >= 0.0f ? vMins.y : vMaxs.y )
+			+ plane.z * ( plane.z >= 0.0f ? vMins.z : vMaxs.z );
+		if ( flNear < 0.0f )
+			nResult = 0;
+	}
+	return nResult;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+CSceneCellBVH::CSceneCellBVH()
+	: m_nWidth( 0 )
+	, m_nHeight( 0 )
+	, m_flCellSpacing( 0.0f )
+	, m_flCubeSize( 0.0f )
+	, m_unLeafCells( 1 )
+{
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CSceneCellBVH::Build( int nWidth, int nHeight, int nDepth, const Vector3 &vOrigin, float flCellSpacing, float flCubeSize, uint32_t unLeafCells )
+{
+	m_vecNodes.clear();
+	m_vecCellOrder.clear();
+	m_nWidth = nWidth;
+	m_nHeight = nHeight;
+	m_vOrigin = vOrigin;
+	m_flCellSpacing = flCellSpacing;
+	m_flCubeSize = flCubeSize;
+	m_unLeafCells = unLeafCells ? unLeafCells : 1;
+
+	if ( nWidth <= 0 || nHeight <= 0 || nDepth <= 0 )
+		return;
+
+	m_vecCellOrder.reserve( ( size_t )nWidth * nHeight * nDepth );
+	int rnMins[ 3 ] = { 0, 0, 0 };
+	int rnMaxs[ 3 ] = { nWidth, nHeight, nDepth };
+	BuildNode( rnMins, rnMaxs );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Appends the node for the cells in [pnMins, pnMaxs) and its subtree
+//          in depth first order
+//-----------------------------------------------------------------------------
+void CSceneCellBVH::BuildNode( const int *pnMins, const int *pnMaxs )
+{
+	uint32_t unNode = ( uint32_t )m_vecNodes.size();
+	m_vecNodes.push_back( Node_t() );
+
+	Node_t node;
+	node.m_vMins = m_vOrigin + Vector3( ( float )pnMins[ 0 ], ( float )pnMins[ 1 ], ( float )pnMins[ 2 ] ) * m_flCellSpacing;
+	node.m_vMaxs = m_vOrigin + Vector3( ( float )( pnMaxs[ 0 ] - 1 ), ( float )( pnMaxs[ 1 ] - 1 ), ( float )( pnMaxs[ 2 ] - 1 ) ) * m_flCellSpacing
+		+ Vector3( m_flCubeSize, m_flCubeSize, m_flCubeSize );
+	node.m_unFirstCell = ( uint32_t )m_vecCellOrder.size();
+	node.m_unCellCount = ( uint32_t )( ( pnMaxs[ 0 ] - pnMins[ 0 ] ) * ( pnMaxs[ 1 ] - pnMins[ 1 ] ) * ( pnMaxs[ 2 ] - pnMins[ 2 ] ) );
+	node.m_bLeaf = node.m_unCellCount <= m_unLeafCells;
+
+	if ( node.m_bLeaf )
+	{
+		for ( int z = pnMins[ 2 ]; z < pnMaxs[ 2 ]; z++ )
+			for ( int y = pnMins[ 1 ]; y < pnMaxs[ 1 ]; y++ )
+				for ( int x = pnMins[ 0 ]; x < pnMaxs[ 0 ]; x++ )
+					m_vecCellOrder.push_back( ( uint32_t )( x + m_nWidth * ( y + m_nHeight * z ) ) );
+	}
+	else
+	{
+		int nAxis = 0;
+		for ( int i = 1; i < 3; i++ )
+		{
+			if ( pnMaxs[ i ] - pnMins[ i ] > pnMaxs[ nAxis ] - pnMins[ nAxis ] )
+				nAxis = i;
+		}
+		int nSplit = ( pnMins[ nAxis ] + pnMaxs[ nAxis ] ) / 2;
+
+		int rnLeftMaxs[ 3 ] = { pnMaxs[ 0 ], pnMaxs[ 1 ], pnMaxs[ 2 ] };
+		rnLeftMaxs[ nAxis ] = nSplit;
+		BuildNode( pnMins, rnLeftMaxs );
+
+		int rnRightMins[ 3 ] = { pnMins[ 0 ], pnMins[ 1 ], pnMins[ 2 ] };
+		rnRightMins[ nAxis ] = nSplit;
+		BuildNode( rnRightMins, pnMaxs );
+	}
+
+	node.m_unSkip = ( uint32_t )m_vecNodes.size();
+	m_vecNodes[ unNode ] = node;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Walks the nodes in depth first order. A node outside every frustum
+//          or entirely inside one is resolved without visiting its subtree;
+//          leaves that straddle a plane are kept whole.
+//-----------------------------------------------------------------------------
+uint32_t CSceneCellBVH::Cull( const Frustum_t *pFrusta, uint32_t unFrustumCount, std::vector< SceneCellRange_t > *pRanges ) const
+{
+	pRanges->clear();
+	uint32_t unVisibleCells = 0;
+
+	uint32_t unNode = 0;
+	while ( unNode < m_vecNodes.size() )
+	{
+		const Node_t &node = m_vecNodes[ unNode ];
+
+		int nClass = -1;
+		for ( uint32_t unFrustum = 0; unFrustum < unFrustumCount && nClass < 1; unFrustum++ )
+		{
+			int nFrustumClass = ClassifyBox( pFrusta[ unFrustum ], node.m_vMins, node.m_vMaxs );
+			if ( nFrustumClass > nClass )
+				nClass = nFrustumClass;
+		}
+
+		if ( nClass == 0 && !node.m_bLeaf )
+		{
+			unNode++;
+			continue;
+		}
+
+		if ( nClass >= 0 )
+		{
+			if ( !pRanges->empty() && pRanges->back().m_unFirst + pRanges->back().m_unCount == node.m_unFirstCell )
+			{
+				pRanges->back().m_unCount += node.m_unCellCount;
+			}
+			else
+			{
+				SceneCellRange_t range = { node.m_unFirstCell, node.m_unCellCount };
+				pRanges->push_back( range );
+			}
+			unVisibleCells += node.m_unCellCount;
+		}
+		unNode = node.m_unSkip;
+	}
+
+	return unVisibleCells;
+}
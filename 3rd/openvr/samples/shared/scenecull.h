@@ -0,0 +1,72 @@
+//========= Copyright Valve Corporation ============//
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "Matrices.h"
+
+/** The six planes of a view projection's clip volume. A point p is inside a
+* plane when dot( plane.xyz, p ) + plane.w >= 0. */
+struct Frustum_t
+{
+	Vector4 m_rPlanes[ 6 ];
+};
+
+/** Extracts the frustum planes from a column major view projection matrix. */
+void Frustum_FromViewProjection( const Matrix4 &matViewProjection, Frustum_t *pFrustum );
+
+/** Returns true if the sphere is entirely outside every one of the frusta. */
+bool Frustum_BSphereOutsideAll( const Frustum_t *pFrusta, uint32_t unFrustumCount, const Vector3 &vCenter, float flRadius );
+
+/** A run of cells that are contiguous in CSceneCellBVH::GetCellOrder() */
+struct SceneCellRange_t
+{
+	uint32_t m_unFirst;
+	uint32_t m_unCount;
+};
+
+/** A bounding volume hierarchy over a regular width x height x depth grid of
+* cells, each holding a cube. The grid is split along its longest axis until a
+* leaf has at most unLeafCells cells. The cells are ordered so that every
+* node's cells are contiguous, which lets a node that is entirely inside a
+* frustum be drawn as one range without visiting its children. */
+class CSceneCellBVH
+{
+public:
+	CSceneCellBVH();
+
+	/** Cell ( x, y, z ) spans vOrigin + ( x, y, z ) * flCellSpacing to that plus flCubeSize on every axis. */
+	void Build( int nWidth, int nHeight, int nDepth, const Vector3 &vOrigin, float flCellSpacing, float flCubeSize, uint32_t unLeafCells );
+
+	/** Grid index x + width * ( y + height * z ) of every cell, in the order the ranges refer to */
+	const std::vector< uint32_t > &GetCellOrder() const { return m_vecCellOrder; }
+
+	/** Replaces pRanges with the cells visible in any of the frusta, adjacent
+	* ranges merged so each one can be a single draw. Returns the number of cells. */
+	uint32_t Cull( const Frustum_t *pFrusta, uint32_t unFrustumCount, std::vector< SceneCellRange_t > *pRanges ) const;
+
+	uint32_t GetCellCount() const { return ( uint32_t )m_vecCellOrder.size(); }
+
+private:
+	struct Node_t
+	{
+		Vector3 m_vMins;
+		Vector3 m_vMaxs;
+		uint32_t m_unFirstCell;
+		uint32_t m_unCellCount;
+		uint32_t m_unSkip;                                   // the node after this subtree, in depth first order
+		bool m_bLeaf;
+	};
+
+	void BuildNode( const int *pnMins, const int *pnMaxs );
+
+	std::vector< Node_t > m_vecNodes;
+	std::vector< uint32_t > m_vecCellOrder;
+	int m_nWidth;
+	int m_nHeight;
+	Vector3 m_vOrigin;
+	float m_flCellSpacing;
+	float m_flCubeSize;
+	uint32_t m_unLeafCells;
+};
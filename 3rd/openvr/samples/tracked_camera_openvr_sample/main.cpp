@@ -3,9 +3,36 @@
 
 #include "tracked_camera_openvr_sample.h"
 #include <QApplication>
+#include <stdlib.h>
+#include <string.h>
 
 int main(int argc, char *argv[])
 {
+    // -benchmark [seconds] [-device n]: no window, see RunTrackedCameraBenchmark
+    int nBenchmarkSeconds = 0;
+    vr::TrackedDeviceIndex_t unBenchmarkDevice = vr::k_unTrackedDeviceIndex_Hmd;
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( !strcmp( argv[i], "-benchmark" ) )
+        {
+            nBenchmarkSeconds = 10;
+            if ( ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
+            {
+                nBenchmarkSeconds = atoi( argv[ i + 1 ] );
+                i++;
+            }
+        }
+        else if ( !strcmp( argv[i], "-device" ) && ( argc > i + 1 ) )
+        {
+            unBenchmarkDevice = atoi( argv[ i + 1 ] );
+            i++;
+        }
+    }
+    if ( nBenchmarkSeconds > 0 )
+    {
+        return RunTrackedCameraBenchmark( unBenchmarkDevice, nBenchmarkSeconds );
+    }
+
     QApplication a(argc, argv);
     CQTrackedCameraOpenVRTest w;
     w.show();
@@ -3,64 +3,33 @@
 
 #include "tracked_camera_openvr_sample.h"
 
-//-----------------------------------------------------------------------------
-//-----------------------------------------------------------------------------
-CQCameraPreviewImage::CQCameraPreviewImage( QWidget *pParent ) : QWidget( pParent )
-{
-    m_pSourceImage = nullptr;
-
-    memset( &m_CurrentFrameHeader, 0, sizeof( m_CurrentFrameHeader ) );
-
-    setContentsMargins( 0, 0, 0, 0 );
-
-    // the image fully paints all of its pixels, qt does not need to do it
-    setAttribute( Qt::WA_OpaquePaintEvent, true );
-    setAttribute( Qt::WA_NoSystemBackground, true );
-    setAutoFillBackground( false );
-
-    setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Expanding );
-}
+#include <algorithm>
+#include <vector>
 
-//-----------------------------------------------------------------------------
-//-----------------------------------------------------------------------------
-CQCameraPreviewImage::~CQCameraPreviewImage()
-{
-}
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
 //-----------------------------------------------------------------------------
+// Purpose: Frame size, sequence and pose, drawn over either preview
 //-----------------------------------------------------------------------------
-void CQCameraPreviewImage::paintEvent( QPaintEvent *pEvent )
+static void DrawFrameHeaderLabels( QPainter &painter, const QRect &labelRect, const vr::CameraVideoStreamFrameHeader_t *pFrameHeader )
 {
-    QPainter painter( this );
-
-    // determine the allowable painting area properly inscribed by any border widgets
-    QRect paintRect = contentsRect().intersected( pEvent->rect() );
-    if ( paintRect.isEmpty() )
-    {
-        // nothing to do
-        return;
-    }
-
-    painter.fillRect( contentsRect(), QColor( 180, 180, 180 ) );
-
-    if ( m_pSourceImage && !m_pSourceImage->isNull() )
-    {
-        painter.drawImage( QPoint( 0, 0 ), *m_pSourceImage );
-    }
-
     QFont drawFont = painter.font();
     drawFont.setBold( true );
     painter.setFont( drawFont );
 
     int nLabelY = 0;
     painter.setPen( QColor( 0, 255, 255 ) );
-    painter.drawText( 0, nLabelY, contentsRect().width(), contentsRect().height(), Qt::AlignRight|Qt::AlignTop, QString( "Frame Size: %1x%2" ).arg( m_CurrentFrameHeader.nWidth ).arg( m_CurrentFrameHeader.nHeight ) );
+    painter.drawText( 0, nLabelY, labelRect.width(), labelRect.height(), Qt::AlignRight|Qt::AlignTop, QString( "Frame Size: %1x%2" ).arg( pFrameHeader->nWidth ).arg( pFrameHeader->nHeight ) );
     nLabelY += 20;
 
-    painter.drawText( 0, nLabelY, contentsRect().width(), contentsRect().height(), Qt::AlignRight|Qt::AlignTop, QString( "Frame Sequence: %1" ).arg( m_CurrentFrameHeader.nFrameSequence ) );
+    painter.drawText( 0, nLabelY, labelRect.width(), labelRect.height(), Qt::AlignRight|Qt::AlignTop, QString( "Frame Sequence: %1" ).arg( pFrameHeader->nFrameSequence ) );
     nLabelY += 30;
 
-    if ( m_CurrentFrameHeader.trackedDevicePose.bPoseIsValid )
+    if ( pFrameHeader->trackedDevicePose.bPoseIsValid )
     {
         painter.setPen( QColor( 0, 255, 0 ) );
     }
@@ -69,51 +38,99 @@ void CQCameraPreviewImage::paintEvent( QPaintEvent *pEvent )
         painter.setPen( QColor( 255, 255, 0 ) );
     }
 
-    painter.drawText( 0, nLabelY, contentsRect().width(), contentsRect().height(), Qt::AlignRight|Qt::AlignTop, QString( "Pose: %1" ).arg( m_CurrentFrameHeader.trackedDevicePose.bPoseIsValid ? "Valid" : "Invalid" ) );
+    painter.drawText( 0, nLabelY, labelRect.width(), labelRect.height(), Qt::AlignRight|Qt::AlignTop, QString( "Pose: %1" ).arg( pFrameHeader->trackedDevicePose.bPoseIsValid ? "Valid" : "Invalid" ) );
     nLabelY += 20;
 
     for ( int i = 0; i < 3; i++ )
     {
         // emit the matrix
-        vr::HmdMatrix34_t *pMatrix = &m_CurrentFrameHeader.trackedDevicePose.mDeviceToAbsoluteTracking;
+        const vr::HmdMatrix34_t *pMatrix = &pFrameHeader->trackedDevicePose.mDeviceToAbsoluteTracking;
         painter.drawText(
             0,
             nLabelY,
-            contentsRect().width(),
-            contentsRect().height(),
+            labelRect.width(),
+            labelRect.height(),
              Qt::AlignRight|Qt::AlignTop,
             QString( "%1 %2 %3 %4" ).arg( pMatrix->m[i][0], 2, 'f', 2 ).arg( pMatrix->m[i][1], 2, 'f', 2 ).arg( pMatrix->m[i][2], 2, 'f', 2 ).arg( pMatrix->m[i][3], 2, 'f', 2 ) );
         nLabelY += 20;
     }
     nLabelY += 10;
 
-    painter.drawText( 0, nLabelY, contentsRect().width(), contentsRect().height(), Qt::AlignRight|Qt::AlignTop, QString( "Pose Velocity:" ) );
+    painter.drawText( 0, nLabelY, labelRect.width(), labelRect.height(), Qt::AlignRight|Qt::AlignTop, QString( "Pose Velocity:" ) );
     nLabelY += 20;
 
-    vr::HmdVector3_t *pVelocity = &m_CurrentFrameHeader.trackedDevicePose.vVelocity;
+    const vr::HmdVector3_t *pVelocity = &pFrameHeader->trackedDevicePose.vVelocity;
     painter.drawText(
             0,
             nLabelY,
-            contentsRect().width(),
-            contentsRect().height(),
+            labelRect.width(),
+            labelRect.height(),
              Qt::AlignRight|Qt::AlignTop,
             QString( "%1 %2 %3" ).arg( pVelocity->v[0], 2, 'f', 2 ).arg( pVelocity->v[1], 2, 'f', 2 ).arg( pVelocity->v[2], 2, 'f', 2 ) );
     nLabelY += 30;
 
-    painter.drawText( 0, nLabelY, contentsRect().width(), contentsRect().height(), Qt::AlignRight|Qt::AlignTop, QString( "Pose Angular Velocity:" ) );
+    painter.drawText( 0, nLabelY, labelRect.width(), labelRect.height(), Qt::AlignRight|Qt::AlignTop, QString( "Pose Angular Velocity:" ) );
     nLabelY += 20;
 
-    vr::HmdVector3_t *pAngularVelocity = &m_CurrentFrameHeader.trackedDevicePose.vVelocity;
+    const vr::HmdVector3_t *pAngularVelocity = &pFrameHeader->trackedDevicePose.vVelocity;
     painter.drawText(
             0,
             nLabelY,
-            contentsRect().width(),
-            contentsRect().height(),
+            labelRect.width(),
+            labelRect.height(),
              Qt::AlignRight|Qt::AlignTop,
             QString( "%1 %2 %3" ).arg( pAngularVelocity->v[0], 2, 'f', 2 ).arg( pAngularVelocity->v[1], 2, 'f', 2 ).arg( pAngularVelocity->v[2], 2, 'f', 2 ) );
     nLabelY += 20;
 }
 
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+CQCameraPreviewImage::CQCameraPreviewImage( QWidget *pParent ) : QWidget( pParent )
+{
+    m_pSourceImage = nullptr;
+
+    memset( &m_CurrentFrameHeader, 0, sizeof( m_CurrentFrameHeader ) );
+
+    setContentsMargins( 0, 0, 0, 0 );
+
+    // the image fully paints all of its pixels, qt does not need to do it
+    setAttribute( Qt::WA_OpaquePaintEvent, true );
+    setAttribute( Qt::WA_NoSystemBackground, true );
+    setAutoFillBackground( false );
+
+    setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Expanding );
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+CQCameraPreviewImage::~CQCameraPreviewImage()
+{
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void CQCameraPreviewImage::paintEvent( QPaintEvent *pEvent )
+{
+    QPainter painter( this );
+
+    // determine the allowable painting area properly inscribed by any border widgets
+    QRect paintRect = contentsRect().intersected( pEvent->rect() );
+    if ( paintRect.isEmpty() )
+    {
+        // nothing to do
+        return;
+    }
+
+    painter.fillRect( contentsRect(), QColor( 180, 180, 180 ) );
+
+    if ( m_pSourceImage && !m_pSourceImage->isNull() )
+    {
+        painter.drawImage( QPoint( 0, 0 ), *m_pSourceImage );
+    }
+
+    DrawFrameHeaderLabels( painter, contentsRect(), &m_CurrentFrameHeader );
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 void CQCameraPreviewImage::SetFrameImage( const uint8_t *pFrameImage, uint32_t nFrameWidth, uint32_t nFrameHeight, const vr::CameraVideoStreamFrameHeader_t *pFrameHeader )
@@ -152,6 +169,125 @@ void CQCameraPreviewImage::SetFrameImage( const uint8_t *pFrameImage, uint32_t n
     update();
 }
 
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+CQCameraPreviewTexture::CQCameraPreviewTexture( QWidget *pParent ) : QOpenGLWidget( pParent )
+{
+    m_pTrackedCamera = nullptr;
+    m_hTrackedCamera = INVALID_TRACKED_CAMERA_HANDLE;
+    m_glFrameTexture = 0;
+
+    memset( &m_CurrentFrameHeader, 0, sizeof( m_CurrentFrameHeader ) );
+
+    setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Expanding );
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+CQCameraPreviewTexture::~CQCameraPreviewTexture()
+{
+    ReleaseFrameTexture();
+
+    makeCurrent();
+    if ( m_TextureBlitter.isCreated() )
+    {
+        m_TextureBlitter.destroy();
+    }
+    doneCurrent();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The undistorted image is a subregion of the camera's texture
+//-----------------------------------------------------------------------------
+void CQCameraPreviewTexture::SetTextureBounds( const vr::VRTextureBounds_t &textureBounds, uint32_t nTextureWidth, uint32_t nTextureHeight )
+{
+    m_TextureSize = QSize( nTextureWidth, nTextureHeight );
+    m_SourceRect = QRectF(
+        textureBounds.uMin * nTextureWidth,
+        textureBounds.vMin * nTextureHeight,
+        ( textureBounds.uMax - textureBounds.uMin ) * nTextureWidth,
+        ( textureBounds.vMax - textureBounds.vMin ) * nTextureHeight );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Swaps in the texture of the current frame, only its header is copied
+//-----------------------------------------------------------------------------
+vr::EVRTrackedCameraError CQCameraPreviewTexture::UpdateFrameTexture( vr::IVRTrackedCamera *pTrackedCamera, vr::TrackedCameraHandle_t hTrackedCamera, vr::CameraVideoStreamFrameHeader_t *pFrameHeader )
+{
+    // the texture name is only valid in the context it was fetched in
+    makeCurrent();
+
+    if ( m_glFrameTexture )
+    {
+        m_pTrackedCamera->ReleaseVideoStreamTextureGL( m_hTrackedCamera, m_glFrameTexture );
+        m_glFrameTexture = 0;
+    }
+
+    m_pTrackedCamera = pTrackedCamera;
+    m_hTrackedCamera = hTrackedCamera;
+    vr::EVRTrackedCameraError nCameraError = pTrackedCamera->GetVideoStreamTextureGL( hTrackedCamera, vr::VRTrackedCameraFrameType_Undistorted, &m_glFrameTexture, pFrameHeader, sizeof( *pFrameHeader ) );
+    if ( nCameraError != vr::VRTrackedCameraError_None )
+    {
+        m_glFrameTexture = 0;
+    }
+    else
+    {
+        m_CurrentFrameHeader = *pFrameHeader;
+    }
+
+    doneCurrent();
+
+    // schedule a repaint
+    update();
+
+    return nCameraError;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void CQCameraPreviewTexture::ReleaseFrameTexture()
+{
+    if ( !m_glFrameTexture )
+        return;
+
+    makeCurrent();
+    m_pTrackedCamera->ReleaseVideoStreamTextureGL( m_hTrackedCamera, m_glFrameTexture );
+    m_glFrameTexture = 0;
+    doneCurrent();
+
+    update();
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void CQCameraPreviewTexture::initializeGL()
+{
+    m_TextureBlitter.create();
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void CQCameraPreviewTexture::paintGL()
+{
+    QOpenGLFunctions *pFunctions = context()->functions();
+    pFunctions->glClearColor( 180 / 255.0f, 180 / 255.0f, 180 / 255.0f, 1.0f );
+    pFunctions->glClear( GL_COLOR_BUFFER_BIT );
+
+    if ( m_glFrameTexture && !m_SourceRect.isEmpty() )
+    {
+        // unscaled at the top left, like the image preview
+        QMatrix4x4 targetTransform = QOpenGLTextureBlitter::targetTransform( QRectF( QPointF( 0, 0 ), m_SourceRect.size() ), QRect( QPoint( 0, 0 ), size() ) );
+        QMatrix3x3 sourceTransform = QOpenGLTextureBlitter::sourceTransform( m_SourceRect, m_TextureSize, QOpenGLTextureBlitter::OriginTopLeft );
+
+        m_TextureBlitter.bind();
+        m_TextureBlitter.blit( m_glFrameTexture, targetTransform, sourceTransform );
+        m_TextureBlitter.release();
+    }
+
+    QPainter painter( this );
+    DrawFrameHeaderLabels( painter, rect(), &m_CurrentFrameHeader );
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 CQTrackedCameraOpenVRTest::CQTrackedCameraOpenVRTest( QWidget *pParent ) : QMainWindow( pParent )
@@ -166,6 +302,13 @@ CQTrackedCameraOpenVRTest::CQTrackedCameraOpenVRTest( QWidget *pParent ) : QMain
     m_nCameraFrameBufferSize = 0;
     m_pCameraFrameBuffer = nullptr;
 
+    m_bUseTexture = QCoreApplication::arguments().contains( "-gltexture" );
+    memset( &m_CameraTextureBounds, 0, sizeof( m_CameraTextureBounds ) );
+    m_nCameraTextureWidth = 0;
+    m_nCameraTextureHeight = 0;
+    m_nFramesReceived = 0;
+    m_nFramesMissed = 0;
+
     setWindowTitle( "Tracked Camera OpenVR Test" );
 
     CreatePrimaryWindows();
@@ -231,6 +374,10 @@ void CQTrackedCameraOpenVRTest::closeEvent( QCloseEvent *pCloseEvent )
 {
     if ( m_pVRTrackedCamera )
     {
+        if ( m_pCameraPreviewTexture )
+        {
+            m_pCameraPreviewTexture->ReleaseFrameTexture();
+        }
         m_pVRTrackedCamera->ReleaseVideoStreamingService( m_hTrackedCamera );
     }
 
@@ -300,7 +447,20 @@ void CQTrackedCameraOpenVRTest::LogMessage( ELogLevel nLogLevel, const char *pMe
 //-----------------------------------------------------------------------------
 void CQTrackedCameraOpenVRTest::CreatePrimaryWindows()
 {
-    m_pCameraPreviewImage = new CQCameraPreviewImage( this );
+    m_pCameraPreviewImage = nullptr;
+    m_pCameraPreviewTexture = nullptr;
+
+    QWidget *pCameraPreview;
+    if ( m_bUseTexture )
+    {
+        m_pCameraPreviewTexture = new CQCameraPreviewTexture( this );
+        pCameraPreview = m_pCameraPreviewTexture;
+    }
+    else
+    {
+        m_pCameraPreviewImage = new CQCameraPreviewImage( this );
+        pCameraPreview = m_pCameraPreviewImage;
+    }
 
     m_pMessageText = new QTextEdit();
     m_pMessageText->setLineWrapMode( QTextEdit::NoWrap );
@@ -316,10 +476,10 @@ void CQTrackedCameraOpenVRTest::CreatePrimaryWindows()
     m_pSplitter->setHandleWidth( 8 );
 
     m_pSplitter->setChildrenCollapsible( false );
-    m_pCameraPreviewImage->setMinimumHeight( 100 );
+    pCameraPreview->setMinimumHeight( 100 );
     m_pMessageText->setMinimumHeight( 100 );
 
-    m_pSplitter->addWidget( m_pCameraPreviewImage );
+    m_pSplitter->addWidget( pCameraPreview );
     m_pSplitter->addWidget( m_pMessageText );
 
     setCentralWidget( m_pSplitter );
@@ -360,14 +520,39 @@ void CQTrackedCameraOpenVRTest::OnDisplayRefreshTimeout()
 
     m_VideoSignalTime.restart();
 
-    // Frame has changed, do the more expensive frame buffer copy
-    nCameraError = m_pVRTrackedCamera->GetVideoStreamFrameBuffer( m_hTrackedCamera, vr::VRTrackedCameraFrameType_Undistorted, m_pCameraFrameBuffer, m_nCameraFrameBufferSize, &frameHeader, sizeof( frameHeader ) );
-    if ( nCameraError != vr::VRTrackedCameraError_None )
-        return;
+    if ( m_pCameraPreviewTexture )
+    {
+        // Frame has changed, hand its texture to the preview without a copy
+        nCameraError = m_pCameraPreviewTexture->UpdateFrameTexture( m_pVRTrackedCamera, m_hTrackedCamera, &frameHeader );
+        if ( nCameraError != vr::VRTrackedCameraError_None )
+            return;
+    }
+    else
+    {
+        // Frame has changed, do the more expensive frame buffer copy
+        nCameraError = m_pVRTrackedCamera->GetVideoStreamFrameBuffer( m_hTrackedCamera, vr::VRTrackedCameraFrameType_Undistorted, m_pCameraFrameBuffer, m_nCameraFrameBufferSize, &frameHeader, sizeof( frameHeader ) );
+        if ( nCameraError != vr::VRTrackedCameraError_None )
+            return;
+
+        m_pCameraPreviewImage->SetFrameImage( m_pCameraFrameBuffer, m_nCameraFrameWidth, m_nCameraFrameHeight, &frameHeader );
+    }
 
+    // sequences skipped between two refreshes are frames the camera delivered that were never shown
+    if ( m_nLastFrameSequence && frameHeader.nFrameSequence > m_nLastFrameSequence + 1 )
+    {
+        m_nFramesMissed += frameHeader.nFrameSequence - m_nLastFrameSequence - 1;
+    }
     m_nLastFrameSequence = frameHeader.nFrameSequence;
+    m_nFramesReceived++;
 
-    m_pCameraPreviewImage->SetFrameImage( m_pCameraFrameBuffer, m_nCameraFrameWidth, m_nCameraFrameHeight, &frameHeader );
+    int nElapsedMs = m_FrameRateTime.elapsed();
+    if ( nElapsedMs >= 5000 )
+    {
+        LogMessage( LogInfo, "%.1f frames/s shown, %u frames missed (%s)\n", m_nFramesReceived * 1000.0f / nElapsedMs, m_nFramesMissed, m_pCameraPreviewTexture ? "GL texture" : "frame buffer copy" );
+        m_nFramesReceived = 0;
+        m_nFramesMissed = 0;
+        m_FrameRateTime.restart();
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -406,8 +591,21 @@ bool CQTrackedCameraOpenVRTest::StartVideoPreview()
         memset( m_pCameraFrameBuffer, 0, m_nCameraFrameBufferSize );
     }
 
+    if ( m_pCameraPreviewTexture )
+    {
+        if ( m_pVRTrackedCamera->GetVideoStreamTextureSize( vr::k_unTrackedDeviceIndex_Hmd, vr::VRTrackedCameraFrameType_Undistorted, &m_CameraTextureBounds, &m_nCameraTextureWidth, &m_nCameraTextureHeight ) != vr::VRTrackedCameraError_None )
+        {
+            LogMessage( LogError, "GetVideoStreamTextureSize() Failed!\n" );
+            return false;
+        }
+        m_pCameraPreviewTexture->SetTextureBounds( m_CameraTextureBounds, m_nCameraTextureWidth, m_nCameraTextureHeight );
+    }
+
     m_nLastFrameSequence = 0;
     m_VideoSignalTime.start();
+    m_nFramesReceived = 0;
+    m_nFramesMissed = 0;
+    m_FrameRateTime.start();
 
     m_pVRTrackedCamera->AcquireVideoStreamingService( vr::k_unTrackedDeviceIndex_Hmd, &m_hTrackedCamera );
     if ( m_hTrackedCamera == INVALID_TRACKED_CAMERA_HANDLE )
@@ -425,6 +623,10 @@ void CQTrackedCameraOpenVRTest::StopVideoPreview()
 {
     LogMessage( LogInfo, "StopVideoPreview()\n" );
 
+    if ( m_pCameraPreviewTexture )
+    {
+        m_pCameraPreviewTexture->ReleaseFrameTexture();
+    }
     m_pVRTrackedCamera->ReleaseVideoStreamingService( m_hTrackedCamera );
     m_hTrackedCamera = INVALID_TRACKED_CAMERA_HANDLE;
 }
@@ -486,3 +688,160 @@ bool CQTrackedCameraOpenVRTest::InitOpenVR()
 
     return true;
 }
+
+//-----------------------------------------------------------------------------
+// Purpose: The host clock of CameraVideoStreamFrameHeader_t::ulFrameExposureTime
+//-----------------------------------------------------------------------------
+static uint64_t GetHostTicks( double *pflTicksPerSecond )
+{
+#if defined( _WIN32 )
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency( &frequency );
+    QueryPerformanceCounter( &counter );
+    *pflTicksPerSecond = (double)frequency.QuadPart;
+    return counter.QuadPart;
+#else
+    timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    *pflTicksPerSecond = 1e9;
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+static double GetPercentile( const std::vector< double > &sortedValues, double flPercentile )
+{
+    if ( sortedValues.empty() )
+        return 0.0;
+    size_t nIndex = (size_t)( flPercentile * ( sortedValues.size() - 1 ) + 0.5 );
+    if ( nIndex >= sortedValues.size() )
+        nIndex = sortedValues.size() - 1;
+    return sortedValues[ nIndex ];
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Streams each frame type in turn for nSeconds, polling the header
+// about every half millisecond and copying each new frame out as the preview
+// does. Reports the frames per second, the gaps in the frame sequence and the
+// time from the middle of the exposure to the frame being available to us.
+//-----------------------------------------------------------------------------
+int RunTrackedCameraBenchmark( vr::TrackedDeviceIndex_t unDeviceIndex, int nSeconds )
+{
+    static const char *const k_rpchFrameTypeNames[ vr::MAX_CAMERA_FRAME_TYPES ] = { "Distorted", "Undistorted", "MaximumUndistorted" };
+
+    vr::EVRInitError eError = vr::VRInitError_None;
+    vr::VR_Init( &eError, vr::VRApplication_Background );
+    if ( eError != vr::VRInitError_None )
+    {
+        fprintf( stderr, "Unable to init VR runtime: %s\n", vr::VR_GetVRInitErrorAsSymbol( eError ) );
+        return 1;
+    }
+
+    vr::IVRTrackedCamera *pTrackedCamera = vr::VRTrackedCamera();
+    bool bHasCamera = false;
+    if ( !pTrackedCamera || pTrackedCamera->HasCamera( unDeviceIndex, &bHasCamera ) != vr::VRTrackedCameraError_None || !bHasCamera )
+    {
+        fprintf( stderr, "No tracked camera on device %u\n", unDeviceIndex );
+        vr::VR_Shutdown();
+        return 1;
+    }
+
+    vr::TrackedCameraHandle_t hTrackedCamera = INVALID_TRACKED_CAMERA_HANDLE;
+    pTrackedCamera->AcquireVideoStreamingService( unDeviceIndex, &hTrackedCamera );
+    if ( hTrackedCamera == INVALID_TRACKED_CAMERA_HANDLE )
+    {
+        fprintf( stderr, "AcquireVideoStreamingService() Failed!\n" );
+        vr::VR_Shutdown();
+        return 1;
+    }
+
+    printf( "device %u, %d s per frame type\n", unDeviceIndex, nSeconds );
+    printf( "%-20s %11s %7s %7s %6s %7s %9s %9s %9s %8s\n", "frame type", "size", "frames", "fps", "gaps", "missed", "lat p50", "lat p95", "lat max", "copy ms" );
+
+    int nResult = 0;
+    for ( int nFrameType = 0; nFrameType < vr::MAX_CAMERA_FRAME_TYPES; nFrameType++ )
+    {
+        vr::EVRTrackedCameraFrameType eFrameType = (vr::EVRTrackedCameraFrameType)nFrameType;
+
+        uint32_t nFrameWidth = 0, nFrameHeight = 0, nFrameBufferSize = 0;
+        if ( pTrackedCamera->GetCameraFrameSize( unDeviceIndex, eFrameType, &nFrameWidth, &nFrameHeight, &nFrameBufferSize ) != vr::VRTrackedCameraError_None || !nFrameBufferSize )
+        {
+            printf( "%-20s not available\n", k_rpchFrameTypeNames[ nFrameType ] );
+            continue;
+        }
+
+        std::vector< uint8_t > frameBuffer( nFrameBufferSize );
+        std::vector< double > latenciesMs;
+        latenciesMs.reserve( nSeconds * 240 );
+
+        uint32_t nLastFrameSequence = 0;
+        uint32_t nFrames = 0;
+        uint32_t nGaps = 0;
+        uint32_t nMissed = 0;
+        double flCopySeconds = 0.0;
+
+        QElapsedTimer runTime;
+        runTime.start();
+        while ( runTime.elapsed() < nSeconds * 1000 )
+        {
+            vr::CameraVideoStreamFrameHeader_t frameHeader;
+            vr::EVRTrackedCameraError nCameraError = pTrackedCamera->GetVideoStreamFrameBuffer( hTrackedCamera, eFrameType, nullptr, 0, &frameHeader, sizeof( frameHeader ) );
+            if ( nCameraError != vr::VRTrackedCameraError_None || frameHeader.nFrameSequence == nLastFrameSequence )
+            {
+                QThread::usleep( 500 );
+                continue;
+            }
+
+            double flTicksPerSecond;
+            uint64_t ulAvailableTicks = GetHostTicks( &flTicksPerSecond );
+
+            QElapsedTimer copyTime;
+            copyTime.start();
+            nCameraError = pTrackedCamera->GetVideoStreamFrameBuffer( hTrackedCamera, eFrameType, frameBuffer.data(), nFrameBufferSize, &frameHeader, sizeof( frameHeader ) );
+            if ( nCameraError != vr::VRTrackedCameraError_None )
+                continue;
+
+            // the first frame was waiting before the run started, it only sets the baseline
+            if ( nLastFrameSequence != 0 )
+            {
+                flCopySeconds += copyTime.nsecsElapsed() * 1e-9;
+                nFrames++;
+                if ( frameHeader.nFrameSequence > nLastFrameSequence + 1 )
+                {
+                    nGaps++;
+                    nMissed += frameHeader.nFrameSequence - nLastFrameSequence - 1;
+                }
+                if ( frameHeader.ulFrameExposureTime && frameHeader.ulFrameExposureTime <= ulAvailableTicks )
+                {
+                    latenciesMs.push_back( ( ulAvailableTicks - frameHeader.ulFrameExposureTime ) * 1000.0 / flTicksPerSecond );
+                }
+            }
+            nLastFrameSequence = frameHeader.nFrameSequence;
+        }
+
+        std::sort( latenciesMs.begin(), latenciesMs.end() );
+        char frameSize[32];
+        sprintf_s( frameSize, sizeof( frameSize ), "%ux%u", nFrameWidth, nFrameHeight );
+        if ( latenciesMs.empty() )
+        {
+            printf( "%-20s %11s %7u %7.1f %6u %7u %9s %9s %9s %8.3f\n", k_rpchFrameTypeNames[ nFrameType ], frameSize, nFrames,
+                nFrames * 1000.0 / runTime.elapsed(), nGaps, nMissed, "n/a", "n/a", "n/a", nFrames ? flCopySeconds * 1000.0 / nFrames : 0.0 );
+        }
+        else
+        {
+            printf( "%-20s %11s %7u %7.1f %6u %7u %9.2f %9.2f %9.2f %8.3f\n", k_rpchFrameTypeNames[ nFrameType ], frameSize, nFrames,
+                nFrames * 1000.0 / runTime.elapsed(), nGaps, nMissed, GetPercentile( latenciesMs, 0.5 ), GetPercentile( latenciesMs, 0.95 ),
+                latenciesMs.back(), flCopySeconds * 1000.0 / nFrames );
+        }
+
+        if ( !nFrames )
+        {
+            nResult = 1;
+        }
+    }
+
+    pTrackedCamera->ReleaseVideoStreamingService( hTrackedCamera );
+    vr::VR_Shutdown();
+    return nResult;
+}
@@ -6,6 +6,8 @@
 
 #include <QtGui/QtGui>
 #include <QtWidgets/QtWidgets>
+#include <QtWidgets/QOpenGLWidget>
+#include <QtGui/QOpenGLTextureBlitter>
 #include <openvr.h>
 
 enum ELogLevel
@@ -40,6 +42,36 @@ private:
     vr::CameraVideoStreamFrameHeader_t m_CurrentFrameHeader;
 };
 
+//-----------------------------------------------------------------------------
+// Purpose: Preview drawn straight from the tracked camera's GL texture, so the
+// frame never comes back to the CPU
+//-----------------------------------------------------------------------------
+class CQCameraPreviewTexture : public QOpenGLWidget
+{
+    Q_OBJECT
+
+public:
+    CQCameraPreviewTexture( QWidget *pParent = NULL );
+    ~CQCameraPreviewTexture();
+
+    void SetTextureBounds( const vr::VRTextureBounds_t &textureBounds, uint32_t nTextureWidth, uint32_t nTextureHeight );
+    vr::EVRTrackedCameraError UpdateFrameTexture( vr::IVRTrackedCamera *pTrackedCamera, vr::TrackedCameraHandle_t hTrackedCamera, vr::CameraVideoStreamFrameHeader_t *pFrameHeader );
+    void ReleaseFrameTexture();
+
+protected:
+    virtual void initializeGL();
+    virtual void paintGL();
+
+private:
+    vr::IVRTrackedCamera	*m_pTrackedCamera;
+    vr::TrackedCameraHandle_t m_hTrackedCamera;
+    vr::glUInt_t			m_glFrameTexture;
+    QRectF					m_SourceRect;
+    QSize					m_TextureSize;
+    QOpenGLTextureBlitter	m_TextureBlitter;
+    vr::CameraVideoStreamFrameHeader_t m_CurrentFrameHeader;
+};
+
 class CQTrackedCameraOpenVRTest : public QMainWindow
 {
     Q_OBJECT
@@ -75,6 +107,7 @@ private:
     QTextEdit				*m_pMessageText;
     QSplitter				*m_pSplitter;
     CQCameraPreviewImage	*m_pCameraPreviewImage;
+    CQCameraPreviewTexture	*m_pCameraPreviewTexture;
     QMenu					*m_pMainMenu;
     QAction					*m_pExitAction;
     QAction					*m_pToggleStreamingAction;
@@ -89,6 +122,20 @@ private:
     uint8_t					*m_pCameraFrameBuffer;
 
     uint32_t				m_nLastFrameSequence;
+
+    // -gltexture: frames are drawn from the camera's GL texture instead of being copied out
+    bool					m_bUseTexture;
+    vr::VRTextureBounds_t	m_CameraTextureBounds;
+    uint32_t				m_nCameraTextureWidth;
+    uint32_t				m_nCameraTextureHeight;
+
+    // throughput, logged every few seconds
+    QTime					m_FrameRateTime;
+    uint32_t				m_nFramesReceived;
+    uint32_t				m_nFramesMissed;
 };
 
+// Headless: streams nSeconds of every frame type from the device's camera and prints throughput and latency
+extern int RunTrackedCameraBenchmark( vr::TrackedDeviceIndex_t unDeviceIndex, int nSeconds );
+
 #endif // TRACKED_CAMERA_OPENVR_SAMPLE_H
@@ -126,6 +126,9 @@ license you like.
 /// std::map
 /// as Value container.
 //#  define JSON_USE_CPPTL_SMALLMAP 1
+/// If defined, copies of an array or object Value share its members until one
+/// of them is modified. See Value.
+//#  define JSON_USE_COPY_ON_WRITE 1
 
 // If non-zero, the library uses exceptions to report bad input instead of C
 // assertion macros. The default is to use exceptions.
@@ -224,6 +227,18 @@ license you like.
 #define JSONCPP_DEPRECATED(message)
 #endif // if !defined(JSONCPP_DEPRECATED)
 
+#if defined(_MSC_VER) && _MSC_VER < 1900 // VC++ 2013 has no noexcept
+#define JSONCPP_NOEXCEPT
+#else
+#define JSONCPP_NOEXCEPT noexcept
+#endif
+
+#if defined(_MSC_VER) && _MSC_VER < 1900 // VC++ 2013 has no thread_local
+#define JSONCPP_THREAD_LOCAL __declspec(thread)
+#else
+#define JSONCPP_THREAD_LOCAL thread_local
+#endif
+
 namespace Json {
 typedef int Int;
 typedef unsigned int UInt;
@@ -398,7 +413,10 @@ public:
 #include <vector>
 #include <exception>
 
-#ifndef JSON_USE_CPPTL_SMALLMAP
+#if defined(JSON_USE_FLAT_OBJECT_MAP)
+#include <algorithm>
+#include <utility>
+#elif !defined(JSON_USE_CPPTL_SMALLMAP)
 #include <map>
 #else
 #include <cpptl/smallmap.h>
@@ -510,6 +528,207 @@ private:
   const char* c_str_;
 };
 
+/** \brief Monotonic memory for the Value trees built while it is in scope.
+ *
+ * While a ValueArena::Scope is alive on a thread, the object maps and the
+ * strings (values, member names and comments) of every Value created on that
+ * thread are carved out of the arena's blocks instead of the heap. Freeing them
+ * is a no-op; the memory comes back all at once when the arena is reset or
+ * destroyed. Parsing and discarding many documents then costs a few block
+ * allocations instead of one malloc/free per node and string.
+ *
+ * Every Value built inside a scope must be destroyed before the arena is reset
+ * or destroyed. Copies made after the scope has ended use the heap as usual.
+ *
+ * \code
+ * Json::ValueArena arena;
+ * for (...) {
+ *   Json::ValueArena::Scope scope(arena);
+ *   Json::Value root;
+ *   reader.parse(doc, root);
+ *   ...
+ *   root = Json::Value();
+ *   arena.reset();
+ * }
+ * \endcode
+ */
+class JSON_API ValueArena {
+public:
+  explicit ValueArena(size_t blockSize = 16 * 1024);
+  ~ValueArena();
+
+  /// Makes \c arena the current one for this thread until destroyed.
+  class JSON_API Scope {
+  public:
+    explicit Scope(ValueArena& arena);
+    ~Scope();
+
+  private:
+    Scope(Scope const&);
+    void operator=(Scope const&);
+
+    ValueArena* previous_;
+  };
+
+  /// Reuses the arena's memory from the start. Values from it must be gone.
+  void reset();
+
+  /// Bytes handed out since construction or the last reset().
+  size_t bytesUsed() const { return bytesUsed_; }
+
+  /// Used internally: memory from the current arena, or from the heap.
+  static void* allocate(size_t size);
+  /// Used internally: frees heap memory; arena memory waits for reset().
+  static void release(void* memory);
+
+private:
+  ValueArena(ValueArena const&);
+  void operator=(ValueArena const&);
+
+  void* allocateFromBlocks(size_t size);
+  void releaseBlocks(bool keepFirst);
+
+  std::vector<char*> blocks_;   // blockSize_ each; the last is being filled
+  std::vector<char*> oversized_; // single allocations larger than a block
+  size_t blockSize_;
+  size_t blockUsed_;            // bytes used in blocks_.back()
+  size_t bytesUsed_;
+  size_t liveAllocations_;
+};
+
+/** \brief Allocator for the object maps of Value, routed through ValueArena.
+ */
+template <typename T> class ValueArenaAllocator {
+public:
+  typedef T value_type;
+  template <typename U> struct rebind { typedef ValueArenaAllocator<U> other; };
+
+  ValueArenaAllocator() {}
+  template <typename U> ValueArenaAllocator(ValueArenaAllocator<U> const&) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(ValueArena::allocate(n * sizeof(T)));
+  }
+  void deallocate(T* p, size_t) { ValueArena::release(p); }
+
+  template <typename U> bool operator==(ValueArenaAllocator<U> const&) const {
+    return true;
+  }
+  template <typename U> bool operator!=(ValueArenaAllocator<U> const&) const {
+    return false;
+  }
+};
+
+#if defined(JSON_USE_FLAT_OBJECT_MAP)
+/** \brief Object storage kept as one sorted vector of (key, value) pairs.
+ *
+ * Defining JSON_USE_FLAT_OBJECT_MAP makes this Value::ObjectValues instead of
+ * std::map. The members of an object or array then sit next to each other,
+ * with one allocation per container instead of one per member, and lookups
+ * binary search contiguous memory. That suits the small objects of config and
+ * telemetry documents. Inserting or erasing a member is linear, and, unlike
+ * std::map, it moves the other members: references and iterators into the
+ * same object are invalidated by it.
+ *
+ * Only the part of the std::map interface that Value uses is provided.
+ */
+template <typename Key, typename T, typename Alloc>
+class FlatObjectMap {
+public:
+  typedef Key key_type;
+  typedef T mapped_type;
+  typedef std::pair<Key, T> value_type;
+  typedef std::vector<value_type,
+                      typename Alloc::template rebind<value_type>::other>
+      Storage;
+  typedef typename Storage::iterator iterator;
+  typedef typename Storage::const_iterator const_iterator;
+  typedef typename Storage::size_type size_type;
+
+  iterator begin() { return items_.begin(); }
+  iterator end() { return items_.end(); }
+  const_iterator begin() const { return items_.begin(); }
+  const_iterator end() const { return items_.end(); }
+  size_type size() const { return items_.size(); }
+  bool empty() const { return items_.empty(); }
+  void clear() { items_.clear(); }
+
+  iterator lower_bound(const Key& key) {
+    return std::lower_bound(items_.begin(), items_.end(), key, KeyLess());
+  }
+  const_iterator lower_bound(const Key& key) const {
+    return std::lower_bound(items_.begin(), items_.end(), key, KeyLess());
+  }
+  iterator find(const Key& key) {
+    iterator it = lower_bound(key);
+    return it != items_.end() && !(key < it->first) ? it : items_.end();
+  }
+  const_iterator find(const Key& key) const {
+    const_iterator it = lower_bound(key);
+    return it != items_.end() && !(key < it->first) ? it : items_.end();
+  }
+
+  /// \c hint is where the key would go, as from lower_bound(); appending
+  /// array elements in order is then constant time.
+  iterator insert(iterator hint, const value_type& value) {
+    bool hintFits =
+        (hint == items_.begin() || (hint - 1)->first < value.first) &&
+        (hint == items_.end() || value.first < hint->first);
+    if (!hintFits) {
+      hint = lower_bound(value.first);
+      if (hint != items_.end() && !(value.first < hint->first))
+        return hint;
+    }
+    return items_.insert(hint, value);
+  }
+#if JSON_HAS_RVALUE_REFERENCES
+  iterator insert(iterator hint, value_type&& value) {
+    bool hintFits =
+        (hint == items_.begin() || (hint - 1)->first < value.first) &&
+        (hint == items_.end() || value.first < hint->first);
+    if (!hintFits) {
+      hint = lower_bound(value.first);
+      if (hint != items_.end() && !(value.first < hint->first))
+        return hint;
+    }
+    return items_.insert(hint, std::move(value));
+  }
+#endif
+
+  void erase(iterator it) { items_.erase(it); }
+  size_type erase(const Key& key) {
+    iterator it = find(key);
+    if (it == items_.end())
+      return 0;
+    items_.erase(it);
+    return 1;
+  }
+
+  T& operator[](const Key& key) {
+    iterator it = lower_bound(key);
+    if (it == items_.end() || key < it->first)
+      it = items_.insert(it, value_type(key, T()));
+    return it->second;
+  }
+
+  bool operator==(const FlatObjectMap& other) const {
+    return items_ == other.items_;
+  }
+  bool operator<(const FlatObjectMap& other) const {
+    return items_ < other.items_;
+  }
+
+private:
+  struct KeyLess {
+    bool operator()(const value_type& item, const Key& key) const {
+      return item.first < key;
+    }
+  };
+
+  Storage items_;
+};
+#endif // if defined(JSON_USE_FLAT_OBJECT_MAP)
+
 /** \brief Represents a <a HREF="http://www.json.org">JSON</a> value.
  *
  * This class is a discriminated union wrapper that can represents a:
@@ -543,6 +762,14 @@ private:
  * exception if a bound is exceeded to avoid security holes in your app,
  * but the Value API does *not* check bounds. That is the responsibility
  * of the caller.
+ *
+ * With JSON_USE_COPY_ON_WRITE defined, copying an array or object takes a
+ * reference to its members instead of copying them, and the first non-const
+ * access to either copy gives that copy members of its own. A shared
+ * container is never modified, so copies can be read from several threads.
+ * As with any copy-on-write string, a reference or non-const iterator into a
+ * Value must not be written through after that Value has been copied: take it
+ * again after the copy.
  */
 class JSON_API Value {
   friend class ValueIteratorBase;
@@ -598,7 +825,7 @@ private:
     CZString(char const* str, unsigned length, DuplicationPolicy allocate);
     CZString(CZString const& other);
 #if JSON_HAS_RVALUE_REFERENCES
-    CZString(CZString&& other);
+    CZString(CZString&& other) JSONCPP_NOEXCEPT;
 #endif
     ~CZString();
     CZString& operator=(CZString other);
@@ -626,8 +853,13 @@ private:
   };
 
 public:
-#ifndef JSON_USE_CPPTL_SMALLMAP
-  typedef std::map<CZString, Value> ObjectValues;
+#if defined(JSON_USE_FLAT_OBJECT_MAP)
+  typedef FlatObjectMap<CZString, Value, ValueArenaAllocator<Value> >
+      ObjectValues;
+#elif !defined(JSON_USE_CPPTL_SMALLMAP)
+  typedef std::map<CZString, Value, std::less<CZString>,
+                   ValueArenaAllocator<std::pair<const CZString, Value> > >
+      ObjectValues;
 #else
   typedef CppTL::SmallMap<CZString, Value> ObjectValues;
 #endif // ifndef JSON_USE_CPPTL_SMALLMAP
@@ -680,15 +912,15 @@ Json::Value obj_value(Json::objectValue); // {}
   Value(const CppTL::ConstString& value);
 #endif
   Value(bool value);
-  /// Deep copy.
+  /// Deep copy, or shared members with JSON_USE_COPY_ON_WRITE.
   Value(const Value& other);
 #if JSON_HAS_RVALUE_REFERENCES
   /// Move constructor
-  Value(Value&& other);
+  Value(Value&& other) JSONCPP_NOEXCEPT;
 #endif
   ~Value();
 
-  /// Deep copy, then swap(other).
+  /// Copy, then swap(other).
   /// \note Over-write existing comments. To preserve comments, use #swapPayload().
   Value& operator=(Value other);
   /// Swap everything.
@@ -802,6 +1034,9 @@ Json::Value obj_value(Json::objectValue); // {}
   ///
   /// Equivalent to jsonvalue[jsonvalue.size()] = value;
   Value& append(const Value& value);
+#if JSON_HAS_RVALUE_REFERENCES
+  Value& append(Value&& value);
+#endif
 
   /// Access an object value by name, create a null member if it does not exist.
   /// \note Because of our implementation, keys are limited to 2^30 -1 chars.
@@ -949,6 +1184,9 @@ private:
 
   Value& resolveReference(const char* key);
   Value& resolveReference(const char* key, const char* end);
+  /// Before a non-const member access: gives this Value members of its own if
+  /// it shares them with copies (JSON_USE_COPY_ON_WRITE).
+  void detachObjectValues();
 
   struct CommentInfo {
     CommentInfo();
@@ -1274,6 +1512,25 @@ inline void swap(Json::Value& a, Json::Value& b) { a.swap(b); }
 
 namespace Json {
 
+/** \brief Receives the events of Reader::parse(beginDoc, endDoc, handler).
+ *
+ * Objects and arrays are reported as start/end pairs, with key() before each
+ * object member. Scalars (null, bool, number, string) come to value() as a
+ * Value that never holds an array or object. Return \c false from any
+ * callback to stop the parse there.
+ */
+class JSON_API SaxHandler {
+public:
+  virtual ~SaxHandler() {}
+
+  virtual bool startObject() { return true; }
+  virtual bool endObject() { return true; }
+  virtual bool startArray() { return true; }
+  virtual bool endArray() { return true; }
+  virtual bool key(const std::string& name) { (void)name; return true; }
+  virtual bool value(const Value& scalar) { (void)scalar; return true; }
+};
+
 /** \brief Unserialize a <a HREF="http://www.json.org">JSON</a> document into a
  *Value.
  *
@@ -1350,6 +1607,20 @@ public:
   /// \see Json::operator>>(std::istream&, Json::Value&).
   bool parse(std::istream& is, Value& root, bool collectComments = true);
 
+  /** \brief Read a <a HREF="http://www.json.org">JSON</a> document as a
+   * stream of events, without building a Value tree.
+   * \param beginDoc Pointer on the beginning of the UTF-8 encoded string of the
+   document to read.
+   * \param endDoc Pointer on the end of the UTF-8 encoded string of the
+   document to read.
+   *               Must be >= beginDoc.
+   * \param handler Receives the structure and scalar values in document order.
+   * \return \c true if the whole document was read, \c false if it is
+   * malformed (see getFormattedErrorMessages()) or a callback returned \c false.
+   * Parsing stops at the first error; comments are skipped.
+   */
+  bool parse(const char* beginDoc, const char* endDoc, SaxHandler& handler);
+
   /** \brief Returns a user friendly string that list errors in the parsed
    * document.
    * \return Formatted error message with the list of errors with their location
@@ -1477,6 +1748,9 @@ private:
   std::string getLocationSnippet(Location location) const;
   void addComment(Location begin, Location end, CommentPlacement placement);
   void skipCommentTokens(Token& token);
+  bool readValueEvents(SaxHandler& handler, int depth);
+  bool readObjectEvents(SaxHandler& handler, int depth);
+  bool readArrayEvents(SaxHandler& handler, int depth);
 
   typedef std::stack<Value*> Nodes;
   Nodes nodes_;
@@ -1851,6 +2125,27 @@ private:
   bool omitEndingLineFeed_;
 };
 
+/** \brief Writes a Value as compact JSON straight into caller-owned memory.
+ *
+ * The output matches FastWriter with omitEndingLineFeed(), but no stream,
+ * temporary strings or member name lists are involved: numbers and escapes
+ * are formatted on the stack and members are visited in place. Reusing the
+ * same std::string, or writing into a fixed char buffer, makes serializing
+ * allocation free once the buffer is large enough.
+ */
+class JSON_API BufferWriter {
+public:
+  /// Appends the document to \c out; clear it first to reuse its capacity.
+  static void write(const Value& root, std::string& out);
+
+  /** Writes the document into \c buffer, NUL terminated and cut short if it
+   * needs more than \c size - 1 chars.
+   * \return The length of the whole document, as snprintf() does; \c size
+   *         or more means the output was truncated.
+   */
+  static size_t write(const Value& root, char* buffer, size_t size);
+};
+
 /** \brief Writes a Value in <a HREF="http://www.json.org">JSON</a> format in a
  *human friendly way.
  *
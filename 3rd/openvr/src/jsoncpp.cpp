@@ -98,6 +98,8 @@ license you like.
  * It is an internal header that must not be exposed.
  */
 
+#include <cfloat>
+
 namespace Json {
 
 /// Converts a unicode code-point to UTF-8.
@@ -168,6 +170,80 @@ static inline void fixNumericLocale(char* begin, char* end) {
   }
 }
 
+/** Converts a number token to a double without a stream or sscanf.
+ *
+ * Only handles the case where the result is exact: a significand of at most
+ * 2^53 scaled by a power of ten of at most 22, both of which a double holds
+ * exactly, so one multiply or divide rounds correctly (Clinger's fast path).
+ * That covers the numbers we write ourselves, such as poses and timings.
+ * @return false if the token has to go through the slow path.
+ */
+static inline bool decodeDoubleExact(const char* begin, const char* end,
+                                     double& value) {
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+  // x87 style extended intermediates would round twice.
+  (void)begin;
+  (void)end;
+  (void)value;
+  return false;
+#else
+  static const double powersOf10[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  const char* current = begin;
+  bool isNegative = current != end && *current == '-';
+  if (isNegative)
+    ++current;
+  unsigned long long significand = 0;
+  int digits = 0;
+  int exponent = 0;
+  const char* integerBegin = current;
+  for (; current != end && *current >= '0' && *current <= '9'; ++current) {
+    if ((significand != 0 || *current != '0') && ++digits > 19)
+      return false;
+    significand = significand * 10 + static_cast<unsigned>(*current - '0');
+  }
+  if (current == integerBegin)
+    return false;
+  if (current != end && *current == '.') {
+    const char* fractionBegin = ++current;
+    for (; current != end && *current >= '0' && *current <= '9'; ++current) {
+      if ((significand != 0 || *current != '0') && ++digits > 19)
+        return false;
+      significand = significand * 10 + static_cast<unsigned>(*current - '0');
+      --exponent;
+    }
+    if (current == fractionBegin)
+      return false;
+  }
+  if (current != end && (*current == 'e' || *current == 'E')) {
+    ++current;
+    bool isNegativeExponent = false;
+    if (current != end && (*current == '+' || *current == '-'))
+      isNegativeExponent = *current++ == '-';
+    const char* exponentBegin = current;
+    int explicitExponent = 0;
+    for (; current != end && *current >= '0' && *current <= '9'; ++current) {
+      if (explicitExponent < 10000)
+        explicitExponent = explicitExponent * 10 + (*current - '0');
+    }
+    if (current == exponentBegin)
+      return false;
+    exponent += isNegativeExponent ? -explicitExponent : explicitExponent;
+  }
+  if (current != end || significand > (1ULL << 53) || exponent < -22 ||
+      exponent > 22)
+    return false;
+  double result = static_cast<double>(significand);
+  if (exponent < 0)
+    result /= powersOf10[-exponent];
+  else
+    result *= powersOf10[exponent];
+  value = isNegative ? -result : result;
+  return true;
+#endif
+}
+
 } // namespace Json {
 
 #endif // LIB_JSONCPP_JSON_TOOL_H_INCLUDED
@@ -676,6 +752,12 @@ bool Reader::readObject(Token& tokenStart) {
           "Missing ':' after object member name", colon, tokenObjectEnd);
     }
     Value& value = currentValue()[name];
+#if defined(JSON_USE_FLAT_OBJECT_MAP)
+    // The insert may have moved the previous sibling that a trailing comment
+    // would attach to; such a comment becomes a comment before this value.
+    lastValue_ = 0;
+    lastValueEnd_ = 0;
+#endif
     nodes_.push(&value);
     bool ok = readValue();
     nodes_.pop();
@@ -713,6 +795,12 @@ bool Reader::readArray(Token& tokenStart) {
   int index = 0;
   for (;;) {
     Value& value = currentValue()[index++];
+#if defined(JSON_USE_FLAT_OBJECT_MAP)
+    // The insert may have moved the previous sibling that a trailing comment
+    // would attach to; such a comment becomes a comment before this value.
+    lastValue_ = 0;
+    lastValueEnd_ = 0;
+#endif
     nodes_.push(&value);
     bool ok = readValue();
     nodes_.pop();
@@ -737,6 +825,147 @@ bool Reader::readArray(Token& tokenStart) {
   return true;
 }
 
+bool Reader::parse(const char* beginDoc,
+                   const char* endDoc,
+                   SaxHandler& handler) {
+  begin_ = beginDoc;
+  end_ = endDoc;
+  collectComments_ = false;
+  current_ = begin_;
+  lastValueEnd_ = 0;
+  lastValue_ = 0;
+  commentsBefore_ = "";
+  errors_.clear();
+  while (!nodes_.empty())
+    nodes_.pop();
+
+  if (!readValueEvents(handler, 0))
+    return false;
+  if (features_.strictRoot_) {
+    // the events leave nothing to check the root against, so look at the
+    // first token again
+    Location current = begin_;
+    while (current != end_ && (*current == ' ' || *current == '\t' ||
+                                *current == '\r' || *current == '\n'))
+      ++current;
+    if (current == end_ || (*current != '{' && *current != '[')) {
+      Token token;
+      token.type_ = tokenError;
+      token.start_ = beginDoc;
+      token.end_ = endDoc;
+      return addError(
+          "A valid JSON document must be either an array or an object value.",
+          token);
+    }
+  }
+  return true;
+}
+
+// The event reader walks the same tokens as readValue() and friends, but
+// hands each one to the handler instead of storing it, and stops at the
+// first error rather than recovering.
+bool Reader::readValueEvents(SaxHandler& handler, int depth) {
+  Token token;
+  if (depth >= stackLimit_g) {
+    token.type_ = tokenError;
+    token.start_ = current_;
+    token.end_ = current_;
+    return addError("Exceeded stackLimit in readValue().", token);
+  }
+
+  skipCommentTokens(token);
+  switch (token.type_) {
+  case tokenObjectBegin:
+    return handler.startObject() && readObjectEvents(handler, depth + 1);
+  case tokenArrayBegin:
+    return handler.startArray() && readArrayEvents(handler, depth + 1);
+  case tokenNumber: {
+    Value decoded;
+    return decodeNumber(token, decoded) && handler.value(decoded);
+  }
+  case tokenString: {
+    std::string decoded;
+    if (!decodeString(token, decoded))
+      return false;
+    return handler.value(Value(decoded));
+  }
+  case tokenTrue:
+    return handler.value(Value(true));
+  case tokenFalse:
+    return handler.value(Value(false));
+  case tokenNull:
+    return handler.value(Value());
+  case tokenArraySeparator:
+  case tokenObjectEnd:
+  case tokenArrayEnd:
+    if (features_.allowDroppedNullPlaceholders_) {
+      current_--;
+      return handler.value(Value());
+    } // Else, fall through...
+  default:
+    return addError("Syntax error: value, object or array expected.", token);
+  }
+}
+
+bool Reader::readObjectEvents(SaxHandler& handler, int depth) {
+  Token tokenName;
+  std::string name;
+  bool first = true;
+  for (;;) {
+    skipCommentTokens(tokenName);
+    if (tokenName.type_ == tokenObjectEnd && first) // empty object
+      return handler.endObject();
+    first = false;
+    name = "";
+    if (tokenName.type_ == tokenString) {
+      if (!decodeString(tokenName, name))
+        return false;
+    } else if (tokenName.type_ == tokenNumber && features_.allowNumericKeys_) {
+      Value numberName;
+      if (!decodeNumber(tokenName, numberName))
+        return false;
+      name = numberName.asString();
+    } else {
+      return addError("Missing '}' or object member name", tokenName);
+    }
+
+    Token colon;
+    skipCommentTokens(colon);
+    if (colon.type_ != tokenMemberSeparator)
+      return addError("Missing ':' after object member name", colon);
+    if (!handler.key(name) || !readValueEvents(handler, depth))
+      return false;
+
+    Token comma;
+    skipCommentTokens(comma);
+    if (comma.type_ == tokenObjectEnd)
+      return handler.endObject();
+    if (comma.type_ != tokenArraySeparator)
+      return addError("Missing ',' or '}' in object declaration", comma);
+  }
+}
+
+bool Reader::readArrayEvents(SaxHandler& handler, int depth) {
+  skipSpaces();
+  if (current_ != end_ && *current_ == ']') // empty array
+  {
+    Token endArray;
+    readToken(endArray);
+    return handler.endArray();
+  }
+  for (;;) {
+    if (!readValueEvents(handler, depth))
+      return false;
+
+    Token token;
+    skipCommentTokens(token);
+    if (token.type_ == tokenArrayEnd)
+      return handler.endArray();
+    if (token.type_ != tokenArraySeparator)
+      return addError("Missing ',' or ']' in array declaration", token);
+  }
+}
+
 bool Reader::decodeNumber(Token& token) {
   Value decoded;
   if (!decodeNumber(token, decoded))
@@ -801,6 +1030,10 @@ bool Reader::decodeDouble(Token& token) {
 
 bool Reader::decodeDouble(Token& token, Value& decoded) {
   double value = 0;
+  if (decodeDoubleExact(token.start_, token.end_, value)) {
+    decoded = value;
+    return true;
+  }
   std::string buffer(token.start_, token.end_);
   std::istringstream is(buffer);
   if (!(is >> value))
@@ -1675,6 +1908,12 @@ bool OurReader::readObject(Token& tokenStart) {
           msg, tokenName, tokenObjectEnd);
     }
     Value& value = currentValue()[name];
+#if defined(JSON_USE_FLAT_OBJECT_MAP)
+    // The insert may have moved the previous sibling that a trailing comment
+    // would attach to; such a comment becomes a comment before this value.
+    lastValue_ = 0;
+    lastValueEnd_ = 0;
+#endif
     nodes_.push(&value);
     bool ok = readValue();
     nodes_.pop();
@@ -1712,6 +1951,12 @@ bool OurReader::readArray(Token& tokenStart) {
   int index = 0;
   for (;;) {
     Value& value = currentValue()[index++];
+#if defined(JSON_USE_FLAT_OBJECT_MAP)
+    // The insert may have moved the previous sibling that a trailing comment
+    // would attach to; such a comment becomes a comment before this value.
+    lastValue_ = 0;
+    lastValueEnd_ = 0;
+#endif
     nodes_.push(&value);
     bool ok = readValue();
     nodes_.pop();
@@ -1798,6 +2043,10 @@ bool OurReader::decodeDouble(Token& token) {
 
 bool OurReader::decodeDouble(Token& token, Value& decoded) {
   double value = 0;
+  if (decodeDoubleExact(token.start_, token.end_, value)) {
+    decoded = value;
+    return true;
+  }
   const int bufferSize = 32;
   int count;
   int length = int(token.end_ - token.start_);
@@ -2449,6 +2698,9 @@ ValueIterator& ValueIterator::operator=(const SelfType& other) {
 #endif
 #include <cstddef> // size_t
 #include <algorithm> // min()
+#if defined(JSON_USE_COPY_ON_WRITE)
+#include <atomic>
+#endif
 
 #define JSON_ASSERT_UNREACHABLE assert(false)
 
@@ -2510,6 +2762,167 @@ static inline bool InRange(double d, T min, U max) {
 }
 #endif // if !defined(JSON_USE_INT64_DOUBLE_CONVERSION)
 
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class ValueArena
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+// Every allocation starts with the arena it came from, NULL for the heap, so
+// release() knows what to do whichever arena is current by then. The union
+// keeps what follows aligned for doubles on 32-bit targets too.
+union ValueArenaHeader {
+  ValueArena* arena_;
+  double align_;
+};
+
+static JSONCPP_THREAD_LOCAL ValueArena* currentValueArena_g = 0;
+
+ValueArena::ValueArena(size_t blockSize)
+    : blockSize_(blockSize < 256 ? 256 : blockSize), blockUsed_(0),
+      bytesUsed_(0), liveAllocations_(0) {}
+
+ValueArena::~ValueArena() {
+  assert(liveAllocations_ == 0 && "Json::Value outlived its ValueArena");
+  releaseBlocks(false);
+}
+
+ValueArena::Scope::Scope(ValueArena& arena) : previous_(currentValueArena_g) {
+  currentValueArena_g = &arena;
+}
+
+ValueArena::Scope::~Scope() { currentValueArena_g = previous_; }
+
+void ValueArena::reset() {
+  assert(liveAllocations_ == 0 && "Json::Value outlived a ValueArena::reset()");
+  releaseBlocks(true);
+  blockUsed_ = 0;
+  bytesUsed_ = 0;
+}
+
+void ValueArena::releaseBlocks(bool keepFirst) {
+  for (size_t i = keepFirst ? 1 : 0; i < blocks_.size(); ++i)
+    free(blocks_[i]);
+  blocks_.resize(keepFirst && !blocks_.empty() ? 1 : 0);
+  for (size_t i = 0; i < oversized_.size(); ++i)
+    free(oversized_[i]);
+  oversized_.clear();
+}
+
+void* ValueArena::allocateFromBlocks(size_t size) {
+  size = (size + sizeof(ValueArenaHeader) - 1) & ~(sizeof(ValueArenaHeader) - 1);
+  char* memory;
+  if (size > blockSize_ / 4) {
+    memory = static_cast<char*>(malloc(size));
+    if (memory)
+      oversized_.push_back(memory);
+  } else {
+    if (blocks_.empty() || blockUsed_ + size > blockSize_) {
+      char* block = static_cast<char*>(malloc(blockSize_));
+      if (!block)
+        return 0;
+      blocks_.push_back(block);
+      blockUsed_ = 0;
+    }
+    memory = blocks_.back() + blockUsed_;
+    blockUsed_ += size;
+  }
+  if (memory) {
+    bytesUsed_ += size;
+    ++liveAllocations_;
+  }
+  return memory;
+}
+
+void* ValueArena::allocate(size_t size) {
+  ValueArena* arena = currentValueArena_g;
+  size += sizeof(ValueArenaHeader);
+  ValueArenaHeader* header = static_cast<ValueArenaHeader*>(
+      arena ? arena->allocateFromBlocks(size) : malloc(size));
+  if (!header)
+    return 0;
+  header->arena_ = arena;
+  return header + 1;
+}
+
+void ValueArena::release(void* memory) {
+  if (!memory)
+    return;
+  ValueArenaHeader* header = static_cast<ValueArenaHeader*>(memory) - 1;
+  if (header->arena_)
+    --header->arena_->liveAllocations_;
+  else
+    free(header);
+}
+
+#if defined(JSON_USE_COPY_ON_WRITE)
+// Every map counts the Values holding it; a count above one means it is
+// shared and must not change.
+struct SharedObjectValues : Value::ObjectValues {
+  SharedObjectValues() : refs_(1) {}
+  explicit SharedObjectValues(const Value::ObjectValues& other)
+      : Value::ObjectValues(other), refs_(1) {}
+
+  mutable std::atomic<unsigned> refs_;
+};
+typedef SharedObjectValues AllocatedObjectValues;
+#else
+typedef Value::ObjectValues AllocatedObjectValues;
+#endif
+
+static Value::ObjectValues* newObjectValues() {
+  void* memory = ValueArena::allocate(sizeof(AllocatedObjectValues));
+  if (!memory)
+    throwRuntimeError("in Json::Value: Failed to allocate object value");
+  return new (memory) AllocatedObjectValues();
+}
+
+static Value::ObjectValues* newObjectValues(const Value::ObjectValues& other) {
+  void* memory = ValueArena::allocate(sizeof(AllocatedObjectValues));
+  if (!memory)
+    throwRuntimeError("in Json::Value: Failed to allocate object value");
+  try {
+    return new (memory) AllocatedObjectValues(other);
+  } catch (...) {
+    ValueArena::release(memory);
+    throw;
+  }
+}
+
+static void deleteObjectValues(Value::ObjectValues* map) {
+  AllocatedObjectValues* allocated = static_cast<AllocatedObjectValues*>(map);
+#if defined(JSON_USE_COPY_ON_WRITE)
+  if (--allocated->refs_ != 0)
+    return;
+#endif
+  allocated->~AllocatedObjectValues();
+  ValueArena::release(allocated);
+}
+
+static bool isSharedObjectValues(const Value::ObjectValues* map) {
+#if defined(JSON_USE_COPY_ON_WRITE)
+  return static_cast<const SharedObjectValues*>(map)->refs_ > 1;
+#else
+  (void)map;
+  return false;
+#endif
+}
+
+// The map for a copy of a Value. It is shared unless it lives in another
+// arena than the current one, which the copy could outlive.
+static Value::ObjectValues* copyObjectValues(const Value::ObjectValues* map) {
+#if defined(JSON_USE_COPY_ON_WRITE)
+  const ValueArenaHeader* header =
+      reinterpret_cast<const ValueArenaHeader*>(
+          static_cast<const SharedObjectValues*>(map)) - 1;
+  if (header->arena_ == currentValueArena_g) {
+    ++static_cast<const SharedObjectValues*>(map)->refs_;
+    return const_cast<Value::ObjectValues*>(map);
+  }
+#endif
+  return newObjectValues(*map);
+}
+
 /** Duplicates the specified string value.
  * @param value Pointer to the string to duplicate. Must be zero-terminated if
  *              length is "unknown".
@@ -2524,7 +2937,7 @@ static inline char* duplicateStringValue(const char* value,
   if (length >= (size_t)Value::maxInt)
     length = Value::maxInt - 1;
 
-  char* newString = static_cast<char*>(malloc(length + 1));
+  char* newString = static_cast<char*>(ValueArena::allocate(length + 1));
   if (newString == NULL) {
     throwRuntimeError(
         "in Json::Value::duplicateStringValue(): "
@@ -2547,7 +2960,7 @@ static inline char* duplicateAndPrefixStringValue(
                       "in Json::Value::duplicateAndPrefixStringValue(): "
                       "length too big for prefixing");
   unsigned actualLength = length + static_cast<unsigned>(sizeof(unsigned)) + 1U;
-  char* newString = static_cast<char*>(malloc(actualLength));
+  char* newString = static_cast<char*>(ValueArena::allocate(actualLength));
   if (newString == 0) {
     throwRuntimeError(
         "in Json::Value::duplicateAndPrefixStringValue(): "
@@ -2572,7 +2985,7 @@ inline static void decodePrefixedString(
 }
 /** Free the string duplicated by duplicateStringValue()/duplicateAndPrefixStringValue().
  */
-static inline void releaseStringValue(char* value) { free(value); }
+static inline void releaseStringValue(char* value) { ValueArena::release(value); }
 
 } // namespace Json
 
@@ -2674,7 +3087,7 @@ Value::CZString::CZString(const CZString& other)
 }
 
 #if JSON_HAS_RVALUE_REFERENCES
-Value::CZString::CZString(CZString&& other)
+Value::CZString::CZString(CZString&& other) JSONCPP_NOEXCEPT
   : cstr_(other.cstr_), index_(other.index_) {
   other.cstr_ = nullptr;
 }
@@ -2755,7 +3168,7 @@ Value::Value(ValueType vtype) {
     break;
   case arrayValue:
   case objectValue:
-    value_.map_ = new ObjectValues();
+    value_.map_ = newObjectValues();
     break;
   case booleanValue:
     value_.bool_ = false;
@@ -2852,7 +3265,7 @@ Value::Value(Value const& other)
     break;
   case arrayValue:
   case objectValue:
-    value_.map_ = new ObjectValues(*other.value_.map_);
+    value_.map_ = copyObjectValues(other.value_.map_);
     break;
   default:
     JSON_ASSERT_UNREACHABLE;
@@ -2876,7 +3289,7 @@ Value::Value(Value const& other)
 
 #if JSON_HAS_RVALUE_REFERENCES
 // Move constructor
-Value::Value(Value&& other) {
+Value::Value(Value&& other) JSONCPP_NOEXCEPT {
   initBasic(nullValue);
   swap(other);
 }
@@ -2896,7 +3309,7 @@ Value::~Value() {
     break;
   case arrayValue:
   case objectValue:
-    delete value_.map_;
+    deleteObjectValues(value_.map_);
     break;
   default:
     JSON_ASSERT_UNREACHABLE;
@@ -3030,8 +3443,9 @@ bool Value::operator==(const Value& other) const {
   }
   case arrayValue:
   case objectValue:
-    return value_.map_->size() == other.value_.map_->size() &&
-           (*value_.map_) == (*other.value_.map_);
+    return value_.map_ == other.value_.map_ ||
+           (value_.map_->size() == other.value_.map_->size() &&
+            (*value_.map_) == (*other.value_.map_));
   default:
     JSON_ASSERT_UNREACHABLE;
   }
@@ -3356,7 +3770,13 @@ void Value::clear() {
   switch (type_) {
   case arrayValue:
   case objectValue:
-    value_.map_->clear();
+    if (isSharedObjectValues(value_.map_)) {
+      // leave the members to the copies instead of copying them first
+      deleteObjectValues(value_.map_);
+      value_.map_ = newObjectValues();
+    } else {
+      value_.map_->clear();
+    }
     break;
   default:
     break;
@@ -3374,6 +3794,7 @@ void Value::resize(ArrayIndex newSize) {
   else if (newSize > oldSize)
     (*this)[newSize - 1];
   else {
+    detachObjectValues();
     for (ArrayIndex index = newSize; index < oldSize; ++index) {
       value_.map_->erase(index);
     }
@@ -3387,13 +3808,13 @@ Value& Value::operator[](ArrayIndex index) {
       "in Json::Value::operator[](ArrayIndex): requires arrayValue");
   if (type_ == nullValue)
     *this = Value(arrayValue);
+  detachObjectValues();
   CZString key(index);
   ObjectValues::iterator it = value_.map_->lower_bound(key);
   if (it != value_.map_->end() && (*it).first == key)
     return (*it).second;
 
-  ObjectValues::value_type defaultValue(key, nullRef);
-  it = value_.map_->insert(it, defaultValue);
+  it = value_.map_->insert(it, std::make_pair(key, Value()));
   return (*it).second;
 }
 
@@ -3433,6 +3854,15 @@ void Value::initBasic(ValueType vtype, bool allocated) {
   default_value_ = nullptr;
 }
 
+void Value::detachObjectValues() {
+  if ((type_ == arrayValue || type_ == objectValue) &&
+      isSharedObjectValues(value_.map_)) {
+    ObjectValues* map = newObjectValues(*value_.map_);
+    deleteObjectValues(value_.map_);
+    value_.map_ = map;
+  }
+}
+
 // Access an object value by name, create a null member if it does not exist.
 // @pre Type of '*this' is object or null.
 // @param key is null-terminated.
@@ -3442,14 +3872,14 @@ Value& Value::resolveReference(const char* key) {
       "in Json::Value::resolveReference(): requires objectValue");
   if (type_ == nullValue)
     *this = Value(objectValue);
+  detachObjectValues();
   CZString actualKey(
       key, static_cast<unsigned>(strlen(key)), CZString::noDuplication); // NOTE!
   ObjectValues::iterator it = value_.map_->lower_bound(actualKey);
   if (it != value_.map_->end() && (*it).first == actualKey)
     return (*it).second;
 
-  ObjectValues::value_type defaultValue(actualKey, nullRef);
-  it = value_.map_->insert(it, defaultValue);
+  it = value_.map_->insert(it, std::make_pair(actualKey, Value()));
   Value& value = (*it).second;
   return value;
 }
@@ -3462,14 +3892,15 @@ Value& Value::resolveReference(char const* key, char const* cend)
       "in Json::Value::resolveReference(key, end): requires objectValue");
   if (type_ == nullValue)
     *this = Value(objectValue);
+  detachObjectValues();
   CZString actualKey(
       key, static_cast<unsigned>(cend-key), CZString::duplicateOnCopy);
   ObjectValues::iterator it = value_.map_->lower_bound(actualKey);
   if (it != value_.map_->end() && (*it).first == actualKey)
     return (*it).second;
 
-  ObjectValues::value_type defaultValue(actualKey, nullRef);
-  it = value_.map_->insert(it, defaultValue);
+  // the pair's copy of the key owns its characters and is moved into the map
+  it = value_.map_->insert(it, std::make_pair(actualKey, Value()));
   Value& value = (*it).second;
   return value;
 }
@@ -3540,6 +3971,14 @@ Value const& Value::operator[](CppTL::ConstString const& key) const
 
 Value& Value::append(const Value& value) { return (*this)[size()] = value; }
 
+#if JSON_HAS_RVALUE_REFERENCES
+Value& Value::append(Value&& value) {
+  Value& appended = (*this)[size()];
+  appended.swap(value);
+  return appended;
+}
+#endif
+
 Value Value::get(char const* key, char const* cend, Value const& defaultValue) const
 {
   Value const* found = find(key, cend);
@@ -3569,11 +4008,12 @@ bool Value::removeMember(const char* key, const char* cend, Value* removed)
   if (type_ != objectValue) {
     return false;
   }
+  if (!find(key, cend))
+    return false;
+  detachObjectValues();
   CZString actualKey(key, static_cast<unsigned>(cend-key), CZString::noDuplication);
   ObjectValues::iterator it = value_.map_->find(actualKey);
-  if (it == value_.map_->end())
-    return false;
-  *removed = it->second;
+  removed->swap(it->second);
   value_.map_->erase(it);
   return true;
 }
@@ -3606,16 +4046,17 @@ bool Value::removeIndex(ArrayIndex index, Value* removed) {
     return false;
   }
   CZString key(index);
-  ObjectValues::iterator it = value_.map_->find(key);
-  if (it == value_.map_->end()) {
+  if (value_.map_->find(key) == value_.map_->end()) {
     return false;
   }
-  *removed = it->second;
+  detachObjectValues();
+  ObjectValues::iterator it = value_.map_->find(key);
+  removed->swap(it->second);
   ArrayIndex oldSize = size();
   // shift left all items left, into the place of the "removed"
   for (ArrayIndex i = index; i < (oldSize - 1); ++i){
     CZString keey(i);
-    (*value_.map_)[keey] = (*this)[i + 1];
+    (*value_.map_)[keey].swap((*this)[i + 1]);
   }
   // erase the last one ("leftover")
   CZString keyLast(oldSize - 1);
@@ -3861,6 +4302,7 @@ Value::iterator Value::begin() {
   switch (type_) {
   case arrayValue:
   case objectValue:
+    detachObjectValues();
     if (value_.map_)
       return iterator(value_.map_->begin());
     break;
@@ -3874,6 +4316,7 @@ Value::iterator Value::end() {
   switch (type_) {
   case arrayValue:
   case objectValue:
+    detachObjectValues();
     if (value_.map_)
       return iterator(value_.map_->end());
     break;
@@ -4176,34 +4619,268 @@ std::string valueToString(UInt value) {
 
 #endif // # if defined(JSON_HAS_INT64)
 
-std::string valueToString(double value, bool useSpecialFloats, unsigned int precision) {
-  // Allocate a buffer that is more than large enough to store the 16 digits of
-  // precision requested below.
-  char buffer[32];
-  int len = -1;
+// Shortest round-trip formatting of doubles: Grisu2, from Florian Loitsch,
+// "Printing Floating-Point Numbers Quickly and Accurately with Integers".
+// The digits always read back as the same double and are the shortest such
+// digits for all but a tiny fraction of values.
 
-  char formatString[6];
-  sprintf(formatString, "%%.%dg", precision);
+struct DiyFp {
+  DiyFp(unsigned long long significand, int exponent)
+      : f(significand), e(exponent) {}
+  unsigned long long f;
+  int e;
+};
+
+static DiyFp diyFpMultiply(const DiyFp& lhs, const DiyFp& rhs) {
+  const unsigned long long mask32 = 0xFFFFFFFFULL;
+  unsigned long long a = lhs.f >> 32, b = lhs.f & mask32;
+  unsigned long long c = rhs.f >> 32, d = rhs.f & mask32;
+  unsigned long long ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+  unsigned long long middle = (bd >> 32) + (ad & mask32) + (bc & mask32);
+  middle += 1ULL << 31; // round the dropped low half
+  return DiyFp(ac + (ad >> 32) + (bc >> 32) + (middle >> 32),
+               lhs.e + rhs.e + 64);
+}
+
+static DiyFp diyFpNormalize(DiyFp x) {
+  while (!(x.f & (1ULL << 63))) {
+    x.f <<= 1;
+    --x.e;
+  }
+  return x;
+}
+
+// 10^k for k = -348, -340, ..., 340, normalized to 64 bit significands.
+static const unsigned long long kCachedPowersF[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+static const short kCachedPowersE[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954,
+    -927, -901, -874, -847, -821, -794, -768, -741, -715, -688, -661,
+    -635, -608, -582, -555, -529, -502, -475, -449, -422, -396, -369,
+    -343, -316, -289, -263, -236, -210, -183, -157, -130, -103, -77,
+    -50, -24, 3, 30, 56, 83, 109, 136, 162, 189, 216,
+    242, 269, 295, 322, 348, 375, 402, 428, 455, 481, 508,
+    534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800,
+    827, 853, 880, 907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static void grisuRound(char* buffer, int length, unsigned long long delta,
+                       unsigned long long rest, unsigned long long tenKappa,
+                       unsigned long long distance) {
+  while (rest < distance && delta - rest >= tenKappa &&
+         (rest + tenKappa < distance ||
+          distance - rest > rest + tenKappa - distance)) {
+    buffer[length - 1]--;
+    rest += tenKappa;
+  }
+}
+
+/// Writes the digits of a positive finite double; the value is
+/// digits * 10^decimalExponent.
+static int grisu2(double value, char* buffer, int& decimalExponent) {
+  static const unsigned kPow10[] = {1,      10,      100,      1000,
+                                    10000,  100000,  1000000,  10000000,
+                                    100000000, 1000000000};
+  unsigned long long bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const unsigned long long hiddenBit = 1ULL << 52;
+  int biasedExponent = static_cast<int>((bits >> 52) & 0x7FF);
+  unsigned long long significand = bits & (hiddenBit - 1);
+  DiyFp v = biasedExponent != 0
+                ? DiyFp(significand + hiddenBit, biasedExponent - 1075)
+                : DiyFp(significand, -1074);
+
+  // Boundaries halfway to the neighbouring doubles, on the same exponent.
+  DiyFp plus = diyFpNormalize(DiyFp((v.f << 1) + 1, v.e - 1));
+  DiyFp minus = v.f == hiddenBit ? DiyFp((v.f << 2) - 1, v.e - 2)
+                                 : DiyFp((v.f << 1) - 1, v.e - 1);
+  minus.f <<= minus.e - plus.e;
+  minus.e = plus.e;
+
+  // Pick the cached power that brings the exponent into [-60, -32].
+  double dk = (-61 - plus.e) * 0.30102999566398114 + 347;
+  int k = static_cast<int>(dk);
+  if (dk - k > 0.0)
+    ++k;
+  unsigned index = static_cast<unsigned>((k >> 3) + 1);
+  decimalExponent = -(-348 + static_cast<int>(index << 3));
+  DiyFp cachedPower(kCachedPowersF[index], kCachedPowersE[index]);
+
+  DiyFp w = diyFpMultiply(diyFpNormalize(v), cachedPower);
+  DiyFp wPlus = diyFpMultiply(plus, cachedPower);
+  DiyFp wMinus = diyFpMultiply(minus, cachedPower);
+  wMinus.f++;
+  wPlus.f--;
+
+  // Generate digits of wPlus until they fall within delta of it.
+  unsigned long long delta = wPlus.f - wMinus.f;
+  unsigned long long distance = wPlus.f - w.f;
+  const int shift = -wPlus.e;
+  const unsigned long long one = 1ULL << shift;
+  unsigned integral = static_cast<unsigned>(wPlus.f >> shift);
+  unsigned long long fraction = wPlus.f & (one - 1);
+  int kappa = 10;
+  while (kappa > 0 && integral < kPow10[kappa - 1])
+    --kappa;
+  int length = 0;
+  while (kappa > 0) {
+    unsigned digit = integral / kPow10[kappa - 1];
+    integral %= kPow10[kappa - 1];
+    if (digit || length)
+      buffer[length++] = static_cast<char>('0' + digit);
+    --kappa;
+    unsigned long long rest =
+        (static_cast<unsigned long long>(integral) << shift) + fraction;
+    if (rest <= delta) {
+      decimalExponent += kappa;
+      grisuRound(buffer, length, delta, rest,
+                 static_cast<unsigned long long>(kPow10[kappa]) << shift,
+                 distance);
+      return length;
+    }
+  }
+  for (;;) {
+    fraction *= 10;
+    delta *= 10;
+    char digit = static_cast<char>(fraction >> shift);
+    if (digit || length)
+      buffer[length++] = static_cast<char>('0' + digit);
+    fraction &= one - 1;
+    --kappa;
+    if (fraction < delta) {
+      decimalExponent += kappa;
+      grisuRound(buffer, length, delta, fraction, one,
+                 -kappa < 10 ? distance * kPow10[-kappa] : 0);
+      return length;
+    }
+  }
+}
+
+/// Formats a finite double like printf("%.17g") would, but with the shortest
+/// digits that read back as the same value.
+static int formatShortestDouble(double value, char* buffer) {
+  char* current = buffer;
+  unsigned long long bits;
+  memcpy(&bits, &value, sizeof(bits));
+  if (bits >> 63) {
+    *current++ = '-';
+    value = -value;
+  }
+  if (value == 0.0) {
+    *current++ = '0';
+    *current = 0;
+    return static_cast<int>(current - buffer);
+  }
+  char digits[24];
+  int decimalExponent;
+  int length = grisu2(value, digits, decimalExponent);
+  int pointPosition = length + decimalExponent; // digits before the point
+  if (pointPosition - 1 < -4 || pointPosition - 1 >= 17) {
+    *current++ = digits[0];
+    if (length > 1) {
+      *current++ = '.';
+      memcpy(current, digits + 1, length - 1);
+      current += length - 1;
+    }
+    int exponent = pointPosition - 1;
+    *current++ = 'e';
+    *current++ = exponent < 0 ? '-' : '+';
+    if (exponent < 0)
+      exponent = -exponent;
+    if (exponent >= 100)
+      *current++ = static_cast<char>('0' + exponent / 100);
+    *current++ = static_cast<char>('0' + exponent / 10 % 10);
+    *current++ = static_cast<char>('0' + exponent % 10);
+  } else if (decimalExponent >= 0) {
+    memcpy(current, digits, length);
+    current += length;
+    for (int i = 0; i < decimalExponent; ++i)
+      *current++ = '0';
+  } else if (pointPosition > 0) {
+    memcpy(current, digits, pointPosition);
+    current += pointPosition;
+    *current++ = '.';
+    memcpy(current, digits + pointPosition, length - pointPosition);
+    current += length - pointPosition;
+  } else {
+    *current++ = '0';
+    *current++ = '.';
+    for (int i = pointPosition; i < 0; ++i)
+      *current++ = '0';
+    memcpy(current, digits, length);
+    current += length;
+  }
+  *current = 0;
+  return static_cast<int>(current - buffer);
+}
+
+/// Formats a double into \c buffer, which must hold 32 chars; returns the
+/// length written.
+static int formatDouble(double value, bool useSpecialFloats,
+                        unsigned int precision, char* buffer) {
+  const size_t bufferSize = 32;
+  int len = -1;
 
   // Print into the buffer. We need not request the alternative representation
   // that always has a decimal point because JSON doesn't distingish the
-  // concepts of reals and integers.
-  if (isfinite(value)) {
-    len = snprintf(buffer, sizeof(buffer), formatString, value);
+  // concepts of reals and integers. At the default precision of 17 digits,
+  // which is enough to round-trip, write the shortest digits that do.
+  if (isfinite(value) && precision == 17) {
+    len = formatShortestDouble(value, buffer);
+  } else if (isfinite(value)) {
+    char formatString[6];
+    sprintf(formatString, "%%.%dg", precision);
+    len = snprintf(buffer, bufferSize, formatString, value);
   } else {
     // IEEE standard states that NaN values will not compare to themselves
     if (value != value) {
-      len = snprintf(buffer, sizeof(buffer), useSpecialFloats ? "NaN" : "null");
+      len = snprintf(buffer, bufferSize, useSpecialFloats ? "NaN" : "null");
     } else if (value < 0) {
-      len = snprintf(buffer, sizeof(buffer), useSpecialFloats ? "-Infinity" : "-1e+9999");
+      len = snprintf(buffer, bufferSize, useSpecialFloats ? "-Infinity" : "-1e+9999");
     } else {
-      len = snprintf(buffer, sizeof(buffer), useSpecialFloats ? "Infinity" : "1e+9999");
+      len = snprintf(buffer, bufferSize, useSpecialFloats ? "Infinity" : "1e+9999");
     }
     // For those, we do not need to call fixNumLoc, but it is fast.
   }
   assert(len >= 0);
   fixNumericLocale(buffer, buffer + len);
-  return buffer;
+  return len;
+}
+
+std::string valueToString(double value, bool useSpecialFloats, unsigned int precision) {
+  // Allocate a buffer that is more than large enough to store the 16 digits of
+  // precision requested below.
+  char buffer[32];
+  return std::string(buffer, formatDouble(value, useSpecialFloats, precision, buffer));
 }
 
 std::string valueToString(double value) { return valueToString(value, false, 17); }
@@ -4429,6 +5106,157 @@ void FastWriter::writeValue(const Value& value) {
   }
 }
 
+// Class BufferWriter
+// //////////////////////////////////////////////////////////////////
+
+// Output targets of BufferWriter.
+struct StringSink {
+  explicit StringSink(std::string& out) : out_(out) {}
+  void append(const char* text, size_t length) { out_.append(text, length); }
+  void append(char c) { out_ += c; }
+
+  std::string& out_;
+};
+
+// Keeps counting past the end so that the caller learns the size needed.
+struct CharBufferSink {
+  CharBufferSink(char* buffer, size_t capacity)
+      : buffer_(buffer), capacity_(capacity), length_(0) {}
+  void append(const char* text, size_t length) {
+    if (length_ < capacity_)
+      memcpy(buffer_ + length_, text, std::min(length, capacity_ - length_));
+    length_ += length;
+  }
+  void append(char c) {
+    if (length_ < capacity_)
+      buffer_[length_] = c;
+    ++length_;
+  }
+
+  char* buffer_;
+  size_t capacity_;
+  size_t length_;
+};
+
+// Same escapes as valueToQuotedStringN, appending unescaped runs whole.
+template <typename Sink>
+static void writeQuotedString(const char* str, const char* end, Sink& sink) {
+  static const char hexDigits[] = "0123456789ABCDEF";
+  sink.append('"');
+  const char* run = str;
+  for (const char* c = str; c != end; ++c) {
+    char escape[6] = {'\\', 0, '0', '0', 0, 0};
+    size_t escapeLength = 2;
+    switch (*c) {
+    case '\"': escape[1] = '\"'; break;
+    case '\\': escape[1] = '\\'; break;
+    case '\b': escape[1] = 'b'; break;
+    case '\f': escape[1] = 'f'; break;
+    case '\n': escape[1] = 'n'; break;
+    case '\r': escape[1] = 'r'; break;
+    case '\t': escape[1] = 't'; break;
+    default:
+      if (!isControlCharacter(*c) && *c != 0)
+        continue;
+      escape[1] = 'u';
+      escape[4] = hexDigits[(*c >> 4) & 0xF];
+      escape[5] = hexDigits[*c & 0xF];
+      escapeLength = 6;
+      break;
+    }
+    sink.append(run, static_cast<size_t>(c - run));
+    sink.append(escape, escapeLength);
+    run = c + 1;
+  }
+  sink.append(run, static_cast<size_t>(end - run));
+  sink.append('"');
+}
+
+template <typename Sink>
+static void writeCompactValue(const Value& value, Sink& sink) {
+  switch (value.type()) {
+  case nullValue:
+    sink.append("null", 4);
+    break;
+  case intValue: {
+    UIntToStringBuffer buffer;
+    char* current = buffer + sizeof(buffer);
+    LargestInt number = value.asLargestInt();
+    uintToString(number < 0 ? LargestUInt(0) - LargestUInt(number)
+                            : LargestUInt(number),
+                 current);
+    if (number < 0)
+      *--current = '-';
+    sink.append(current, static_cast<size_t>(buffer + sizeof(buffer) - 1 - current));
+  } break;
+  case uintValue: {
+    UIntToStringBuffer buffer;
+    char* current = buffer + sizeof(buffer);
+    uintToString(value.asLargestUInt(), current);
+    sink.append(current, static_cast<size_t>(buffer + sizeof(buffer) - 1 - current));
+  } break;
+  case realValue: {
+    char buffer[32];
+    int length = formatDouble(value.asDouble(), false, 17, buffer);
+    sink.append(buffer, static_cast<size_t>(length));
+  } break;
+  case stringValue: {
+    char const* str;
+    char const* end;
+    if (value.getString(&str, &end))
+      writeQuotedString(str, end, sink);
+  } break;
+  case booleanValue:
+    if (value.asBool())
+      sink.append("true", 4);
+    else
+      sink.append("false", 5);
+    break;
+  case arrayValue: {
+    // Members are visited in place; indices missing from a sparse array are
+    // written as null, as indexing would return them.
+    sink.append('[');
+    ArrayIndex next = 0;
+    for (Value::const_iterator it = value.begin(); it != value.end(); ++it) {
+      for (; next <= it.index(); ++next) {
+        if (next > 0)
+          sink.append(',');
+        if (next < it.index())
+          sink.append("null", 4);
+      }
+      writeCompactValue(*it, sink);
+    }
+    sink.append(']');
+  } break;
+  case objectValue: {
+    sink.append('{');
+    for (Value::const_iterator it = value.begin(); it != value.end(); ++it) {
+      if (it != value.begin())
+        sink.append(',');
+      char const* nameEnd;
+      char const* name = it.memberName(&nameEnd);
+      writeQuotedString(name, nameEnd, sink);
+      sink.append(':');
+      writeCompactValue(*it, sink);
+    }
+    sink.append('}');
+  } break;
+  }
+}
+
+void BufferWriter::write(const Value& root, std::string& out) {
+  StringSink sink(out);
+  writeCompactValue(root, sink);
+}
+
+size_t BufferWriter::write(const Value& root, char* buffer, size_t size) {
+  CharBufferSink sink(buffer, size ? size - 1 : 0);
+  writeCompactValue(root, sink);
+  if (size)
+    buffer[std::min(sink.length_, size - 1)] = 0;
+  return sink.length_;
+}
+
 // Class StyledWriter
 // //////////////////////////////////////////////////////////////////
 
@@ -8,7 +8,10 @@
 #include "hmderrors_public.h"
 #include "strtools_public.h"
 #include "vrpathregistry_public.h"
+#include <atomic>
 #include <mutex>
+#include <thread>
+#include <string.h>
 
 using vr::EVRInitError;
 using vr::IVRSystem;
@@ -42,17 +45,242 @@ static std::recursive_mutex g_mutexSystem;
 
 typedef void* (*VRClientCoreFactoryFn)(const char *pInterfaceName, int *pReturnCode);
 
-static uint32_t g_nVRToken = 0;
+// bumped by every init and shutdown; atomic so the interface cache can check it without the lock
+static std::atomic<uint32_t> g_nVRToken( 0 );
 
 uint32_t VR_GetInitToken()
 {
-	return g_nVRToken;
+	return g_nVRToken.load();
+}
+
+// -------------------------------------------------------------------------------
+// Purpose: Lock-free cache of the interfaces resolved through the client core, so
+//			repeated VR_GetGenericInterface and VR_IsInterfaceVersionValid calls
+//			from several threads are a hash probe instead of a trip through
+//			g_mutexSystem. Entries are tagged with the init token they were
+//			resolved under; a shutdown or init bumps the token and so invalidates
+//			all of them at once.
+//
+//			Entries are written only with g_mutexSystem held, one at a time. Each
+//			has a sequence that is odd while it is written; a reader copies the
+//			entry and checks the sequence again, and treats a torn read as a miss.
+// -------------------------------------------------------------------------------
+enum EInterfaceCacheKind
+{
+	InterfaceCache_GenericInterface = 1,
+	InterfaceCache_VersionValid = 2,
+};
+
+static const uint32_t k_unInterfaceCacheSize = 64; // a power of two
+static const uint32_t k_unInterfaceCacheProbes = 8;
+static const size_t k_unInterfaceCacheVersionLength = 64; // longer versions aren't cached
+
+struct InterfaceCacheEntry_t
+{
+	std::atomic<uint32_t> unSequence; // 0 for never written, odd while written
+	uint32_t unToken;
+	uint32_t unHash;
+	uint32_t unKind;
+	void *pInterface;
+	char rchVersion[ k_unInterfaceCacheVersionLength ];
+};
+
+static InterfaceCacheEntry_t g_rgInterfaceCache[ k_unInterfaceCacheSize ];
+
+/** FNV-1a of the kind and version; false if the version is too long to cache */
+static bool HashInterfaceVersion( uint32_t unKind, const char *pchVersion, uint32_t *punHash )
+{
+	uint32_t unHash = 2166136261u ^ unKind;
+	size_t unLength = 0;
+	for ( const char *pch = pchVersion; *pch; pch++ )
+	{
+		if ( ++unLength >= k_unInterfaceCacheVersionLength )
+			return false;
+		unHash = ( unHash ^ (uint8_t)*pch ) * 16777619u;
+	}
+	*punHash = unHash;
+	return true;
+}
+
+static bool InterfaceCache_Find( uint32_t unKind, const char *pchVersion, void **ppInterface )
+{
+	uint32_t unHash;
+	if ( !pchVersion || !HashInterfaceVersion( unKind, pchVersion, &unHash ) )
+		return false;
+
+	uint32_t unToken = g_nVRToken.load( std::memory_order_acquire );
+	for ( uint32_t i = 0; i < k_unInterfaceCacheProbes; i++ )
+	{
+		InterfaceCacheEntry_t &entry = g_rgInterfaceCache[ ( unHash + i ) & ( k_unInterfaceCacheSize - 1 ) ];
+		uint32_t unSequence = entry.unSequence.load( std::memory_order_acquire );
+		if ( unSequence == 0 )
+			return false; // nothing was ever stored past here
+		if ( unSequence & 1 )
+			continue;
+
+		bool bMatch = entry.unToken == unToken && entry.unHash == unHash && entry.unKind == unKind
+			&& strncmp( entry.rchVersion, pchVersion, k_unInterfaceCacheVersionLength ) == 0;
+		void *pInterface = entry.pInterface;
+		std::atomic_thread_fence( std::memory_order_acquire );
+		if ( entry.unSequence.load( std::memory_order_relaxed ) != unSequence )
+			continue;
+		if ( bMatch )
+		{
+			*ppInterface = pInterface;
+			return true;
+		}
+	}
+	return false;
+}
+
+/** With g_mutexSystem held; a full probe chain just leaves the lookup uncached */
+static void InterfaceCache_Store( uint32_t unKind, const char *pchVersion, void *pInterface )
+{
+	uint32_t unHash;
+	if ( !pchVersion || !HashInterfaceVersion( unKind, pchVersion, &unHash ) )
+		return;
+
+	uint32_t unToken = g_nVRToken.load( std::memory_order_relaxed );
+	for ( uint32_t i = 0; i < k_unInterfaceCacheProbes; i++ )
+	{
+		InterfaceCacheEntry_t &entry = g_rgInterfaceCache[ ( unHash + i ) & ( k_unInterfaceCacheSize - 1 ) ];
+		uint32_t unSequence = entry.unSequence.load( std::memory_order_relaxed );
+		bool bCurrent = unSequence != 0 && entry.unToken == unToken;
+		if ( bCurrent && ( entry.unHash != unHash || entry.unKind != unKind || strcmp( entry.rchVersion, pchVersion ) != 0 ) )
+			continue; // another interface of this session
+
+		entry.unSequence.store( unSequence + 1, std::memory_order_relaxed );
+		std::atomic_thread_fence( std::memory_order_release );
+		entry.unToken = unToken;
+		entry.unHash = unHash;
+		entry.unKind = unKind;
+		entry.pInterface = pInterface;
+		strcpy_safe( entry.rchVersion, sizeof( entry.rchVersion ), pchVersion );
+		entry.unSequence.store( unSequence + 2, std::memory_order_release );
+		return;
+	}
 }
 
 EVRInitError VR_LoadHmdSystemInternal();
 void CleanupInternalInterfaces();
 
 
+// ---------------------------------------------------------------------------
+// Purpose: Finds vrclient through the path registry and checks the runtime's
+//			directories on the way
+// ---------------------------------------------------------------------------
+static EVRInitError VR_FindClientModule( std::string *psDLLPath )
+{
+	std::string sRuntimePath, sConfigPath, sLogPath;
+
+	bool bReadPathRegistry = CVRPathRegistry_Public::GetPaths( &sRuntimePath, &sConfigPath, &sLogPath, NULL, NULL );
+	if( !bReadPathRegistry )
+	{
+		return vr::VRInitError_Init_PathRegistryNotFound;
+	}
+
+	// figure out where we're going to look for vrclient.dll
+	// see if the specified path actually exists.
+	if( !Path_IsDirectory( sRuntimePath ) )
+	{
+		return vr::VRInitError_Init_InstallationNotFound;
+	}
+
+	// Because we don't have a way to select debug vs. release yet we'll just
+	// use debug if it's there
+#if defined( LINUX64 ) || defined( LINUXARM64 )
+	std::string sTestPath = Path_Join( sRuntimePath, "bin", PLATSUBDIR );
+#else
+	std::string sTestPath = Path_Join( sRuntimePath, "bin" );
+#endif
+	if( !Path_IsDirectory( sTestPath ) )
+	{
+		return vr::VRInitError_Init_InstallationCorrupt;
+	}
+
+#if defined( WIN64 )
+	*psDLLPath = Path_Join( sTestPath, "vrclient_x64" DYNAMIC_LIB_EXT );
+#else
+	*psDLLPath = Path_Join( sTestPath, "vrclient" DYNAMIC_LIB_EXT );
+#endif
+	return VRInitError_None;
+}
+
+
+// ---------------------------------------------------------------------------
+// Purpose: The background half of VR_PrefetchRuntime. The thread reads the
+//			path registry, maps vrclient and resolves its factory, then holds
+//			one cached reference to the module until the next load takes it.
+//			Only the first prefetch of a process does anything.
+// ---------------------------------------------------------------------------
+class CRuntimePrefetch
+{
+public:
+	CRuntimePrefetch() : m_bStarted( false ), m_pModule( NULL ) {}
+
+	~CRuntimePrefetch()
+	{
+		// a process that prefetched but never initialized still waits for the thread
+		std::lock_guard<std::mutex> lock( m_mutex );
+		if ( m_thread.joinable() )
+			m_thread.join();
+	}
+
+	void Start()
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		if ( m_bStarted )
+			return;
+
+		m_bStarted = true;
+		m_thread = std::thread( &CRuntimePrefetch::Run, this );
+	}
+
+	/** Waits for a running prefetch; the module it loaded, with its reference, or NULL */
+	SharedLibHandle Take()
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		if ( m_thread.joinable() )
+			m_thread.join();
+
+		SharedLibHandle pModule = m_pModule;
+		m_pModule = NULL;
+		return pModule;
+	}
+
+private:
+	void Run()
+	{
+		std::string sDLLPath;
+		if ( VR_FindClientModule( &sDLLPath ) != VRInitError_None )
+			return;
+
+		SharedLibHandle pModule = SharedLib_LoadCached( sDLLPath.c_str() );
+		if ( pModule )
+		{
+			// memoized now, so the lookup under g_mutexSystem is too
+			SharedLib_GetFunctionCached( pModule, "VRClientCoreFactory" );
+		}
+
+		// only read after the join
+		m_pModule = pModule;
+	}
+
+	std::mutex m_mutex;
+	std::thread m_thread;
+	bool m_bStarted;
+	SharedLibHandle m_pModule;
+};
+
+static CRuntimePrefetch g_runtimePrefetch;
+
+
+void VR_PrefetchRuntime()
+{
+	g_runtimePrefetch.Start();
+}
+
+
 uint32_t VR_InitInternal2( EVRInitError *peError, vr::EVRApplicationType eApplicationType, const char *pStartupInfo )
 {
 	std::lock_guard<std::recursive_mutex> lock( g_mutexSystem );
@@ -68,7 +296,7 @@ uint32_t VR_InitInternal2( EVRInitError *peError, vr::EVRApplicationType eApplic
 
 	if ( err != VRInitError_None )
 	{
-		SharedLib_Unload( g_pVRModule );
+		SharedLib_UnloadCached( g_pVRModule );
 		g_pHmdSystem = NULL;
 		g_pVRModule = NULL;
 
@@ -96,7 +324,7 @@ void VR_ShutdownInternal()
 	}
 	if ( g_pVRModule )
 	{
-		SharedLib_Unload( g_pVRModule );
+		SharedLib_UnloadCached( g_pVRModule );
 		g_pVRModule = NULL;
 	}
 
@@ -109,51 +337,32 @@ void VR_ShutdownInternal()
 
 EVRInitError VR_LoadHmdSystemInternal()
 {
-	std::string sRuntimePath, sConfigPath, sLogPath;
-
-	bool bReadPathRegistry = CVRPathRegistry_Public::GetPaths( &sRuntimePath, &sConfigPath, &sLogPath, NULL, NULL );
-	if( !bReadPathRegistry )
-	{
-		return vr::VRInitError_Init_PathRegistryNotFound;
-	}
-
-	// figure out where we're going to look for vrclient.dll
-	// see if the specified path actually exists.
-	if( !Path_IsDirectory( sRuntimePath ) )
-	{
-		return vr::VRInitError_Init_InstallationNotFound;
-	}
-
-	// Because we don't have a way to select debug vs. release yet we'll just
-	// use debug if it's there
-#if defined( LINUX64 ) || defined( LINUXARM64 )
-	std::string sTestPath = Path_Join( sRuntimePath, "bin", PLATSUBDIR );
-#else
-	std::string sTestPath = Path_Join( sRuntimePath, "bin" );
-#endif
-	if( !Path_IsDirectory( sTestPath ) )
-	{
-		return vr::VRInitError_Init_InstallationCorrupt;
-	}
-
-#if defined( WIN64 )
-	std::string sDLLPath = Path_Join( sTestPath, "vrclient_x64" DYNAMIC_LIB_EXT );
-#else
-	std::string sDLLPath = Path_Join( sTestPath, "vrclient" DYNAMIC_LIB_EXT );
-#endif
-
-	// only look in the override
-	void *pMod = SharedLib_Load( sDLLPath.c_str() );
-	// nothing more to do if we can't load the DLL
+	// a prefetch hands over the module it loaded; when it failed, or there was
+	// none, the lookup runs here and reports why
+	void *pMod = g_runtimePrefetch.Take();
 	if( !pMod )
 	{
-		return vr::VRInitError_Init_VRClientDLLNotFound;
+		std::string sDLLPath;
+		EVRInitError err = VR_FindClientModule( &sDLLPath );
+		if( err != VRInitError_None )
+		{
+			return err;
+		}
+
+		// only look in the override; vrclient stays mapped across init/shutdown
+		// cycles, so after the first init this is a cache lookup
+		pMod = SharedLib_LoadCached( sDLLPath.c_str() );
+		// nothing more to do if we can't load the DLL
+		if( !pMod )
+		{
+			return vr::VRInitError_Init_VRClientDLLNotFound;
+		}
 	}
 
-	VRClientCoreFactoryFn fnFactory = ( VRClientCoreFactoryFn )( SharedLib_GetFunction( pMod, "VRClientCoreFactory" ) );
+	VRClientCoreFactoryFn fnFactory = ( VRClientCoreFactoryFn )( SharedLib_GetFunctionCached( pMod, "VRClientCoreFactory" ) );
 	if( !fnFactory )
 	{
-		SharedLib_Unload( pMod );
+		SharedLib_UnloadCached( pMod );
 		return vr::VRInitError_Init_FactoryNotFound;
 	}
 
@@ -161,7 +370,7 @@ EVRInitError VR_LoadHmdSystemInternal()
 	g_pHmdSystem = static_cast< IVRClientCore * > ( fnFactory( vr::IVRClientCore_Version, &nReturnCode ) );
 	if( !g_pHmdSystem )
 	{
-		SharedLib_Unload( pMod );
+		SharedLib_UnloadCached( pMod );
 		return vr::VRInitError_Init_InterfaceNotFound;
 	}
 
@@ -172,6 +381,14 @@ EVRInitError VR_LoadHmdSystemInternal()
 
 void *VR_GetGenericInterface(const char *pchInterfaceVersion, EVRInitError *peError)
 {
+	void *pInterface;
+	if ( InterfaceCache_Find( InterfaceCache_GenericInterface, pchInterfaceVersion, &pInterface ) )
+	{
+		if (peError)
+			*peError = VRInitError_None;
+		return pInterface;
+	}
+
 	std::lock_guard<std::recursive_mutex> lock( g_mutexSystem );
 
 	if (!g_pHmdSystem)
@@ -181,11 +398,21 @@ void *VR_GetGenericInterface(const char *pchInterfaceVersion, EVRInitError *peEr
 		return NULL;
 	}
 
-	return g_pHmdSystem->GetGenericInterface(pchInterfaceVersion, peError);
+	EVRInitError err = VRInitError_None;
+	pInterface = g_pHmdSystem->GetGenericInterface(pchInterfaceVersion, &err);
+	if ( pInterface && err == VRInitError_None )
+		InterfaceCache_Store( InterfaceCache_GenericInterface, pchInterfaceVersion, pInterface );
+	if (peError)
+		*peError = err;
+	return pInterface;
 }
 
 bool VR_IsInterfaceVersionValid(const char *pchInterfaceVersion)
 {
+	void *pUnused;
+	if ( InterfaceCache_Find( InterfaceCache_VersionValid, pchInterfaceVersion, &pUnused ) )
+		return true;
+
 	std::lock_guard<std::recursive_mutex> lock( g_mutexSystem );
 
 	if (!g_pHmdSystem)
@@ -193,7 +420,11 @@ bool VR_IsInterfaceVersionValid(const char *pchInterfaceVersion)
 		return false;
 	}
 
-	return g_pHmdSystem->IsInterfaceVersionValid(pchInterfaceVersion) == VRInitError_None;
+	// only valid versions are cached; an invalid one is the rare case
+	bool bValid = g_pHmdSystem->IsInterfaceVersionValid(pchInterfaceVersion) == VRInitError_None;
+	if ( bValid )
+		InterfaceCache_Store( InterfaceCache_VersionValid, pchInterfaceVersion, NULL );
+	return bValid;
 }
 
 bool VR_IsHmdPresent()
@@ -215,7 +446,7 @@ bool VR_IsHmdPresent()
 		bool bHasHmd = g_pHmdSystem->BIsHmdPresent();
 
 		g_pHmdSystem = NULL;
-		SharedLib_Unload( g_pVRModule );
+		SharedLib_UnloadCached( g_pVRModule );
 		g_pVRModule = NULL;
 
 		return bHasHmd;
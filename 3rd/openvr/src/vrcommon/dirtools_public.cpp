@@ -29,6 +29,11 @@ bool BCreateDirectoryRecursive( const char *pchPath )
 	if ( Path_IsDirectory( pchPath ) )
 		return true;
 
+	// Usually only the last directory is missing, which one mkdir creates;
+	// the parents are only probed when that fails
+	if ( BCreateDirectory( pchPath ) )
+		return true;
+
 	// copy the path into something we can munge
 	int len = (int)strlen( pchPath );
 	char *path = (char *)malloc( len + 1 );
@@ -81,21 +86,14 @@ bool BCreateDirectory( const char *pchPath )
 {
 #ifdef WIN32
 	std::wstring wPath = UTF8to16( pchPath );
-	if ( ::CreateDirectoryW( wPath.c_str(), NULL ) )
-		return true;
-
-	if ( ::GetLastError() == ERROR_ALREADY_EXISTS )
-		return true;
-
-	return false;
+	bool bCreated = ::CreateDirectoryW( wPath.c_str(), NULL ) || ::GetLastError() == ERROR_ALREADY_EXISTS;
 #else
 	int i = mkdir( pchPath, S_IRWXU | S_IRWXG | S_IRWXO );
-	if ( i == 0 )
-		return true;
-	if ( errno == EEXIST )
-		return true;
-
-	return false;
+	bool bCreated = i == 0 || errno == EEXIST;
 #endif
+
+	// a cached "missing" for the new directory would be wrong now
+	Path_InvalidateStatCache();
+	return bCreated;
 }
 
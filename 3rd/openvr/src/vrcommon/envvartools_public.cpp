@@ -2,8 +2,10 @@
 #include "envvartools_public.h"
 #include "strtools_public.h"
 #include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <cctype>
+#include <stdio.h>
 
 #if defined(_WIN32)
 #include <windows.h>
@@ -33,56 +35,128 @@ std::string GetEnvironmentVariable( const char *pchVarName )
 #endif
 }
 
-bool GetEnvironmentVariableAsBool( const char *pchVarName, bool bDefault )
+// ---------------------------------------------------------------------------
+// Purpose: Parses an environment value as a bool. Returns 1 or 0, or -1 with
+//			a warning if the value isn't recognized.
+// ---------------------------------------------------------------------------
+static int ParseEnvironmentVariableBool( const char *pchVarName, const std::string & sValue )
 {
-	std::string sValue = GetEnvironmentVariable( pchVarName );
+	static const char *k_rgchYesValues[] = { "y", "yes", "true" };
+	static const char *k_rgchNoValues[] = { "n", "no", "false" };
 
-	if ( sValue.empty() )
+	for ( const char *pchMatch : k_rgchYesValues )
 	{
-		return bDefault;
-	}
-
-	sValue = StringToLower( sValue );
-	std::string sYesValues[] = { "y", "yes", "true" };
-	std::string sNoValues[] = { "n", "no", "false" };
-
-	for ( std::string &sMatch : sYesValues )
-	{
-		if ( sMatch == sValue )
+		if ( StringEqualNoCase( pchMatch, strlen( pchMatch ), sValue.data(), sValue.length() ) )
 		{
-			return true;
+			return 1;
 		}
 	}
 
-	for ( std::string &sMatch : sNoValues )
+	for ( const char *pchMatch : k_rgchNoValues )
 	{
-		if ( sMatch == sValue )
+		if ( StringEqualNoCase( pchMatch, strlen( pchMatch ), sValue.data(), sValue.length() ) )
 		{
-			return false;
+			return 0;
 		}
 	}
 
 	if ( std::isdigit( sValue.at(0) ) )
 	{
-		return atoi( sValue.c_str() ) != 0;
+		return atoi( sValue.c_str() ) != 0 ? 1 : 0;
 	}
 
 	fprintf( stderr,
-			 "GetEnvironmentVariableAsBool(%s): Unable to parse value '%s', using default %d\n",
-			 pchVarName, sValue.c_str(), bDefault );
-	return bDefault;
+			 "GetEnvironmentVariableAsBool(%s): Unable to parse value '%s', using default\n",
+			 pchVarName, sValue.c_str() );
+	return -1;
+}
+
+bool GetEnvironmentVariableAsBool( const char *pchVarName, bool bDefault )
+{
+	std::string sValue = GetEnvironmentVariable( pchVarName );
+
+	if ( sValue.empty() )
+	{
+		return bDefault;
+	}
+
+	int nValue = ParseEnvironmentVariableBool( pchVarName, sValue );
+	return nValue < 0 ? bDefault : nValue != 0;
+}
+
+// generation of the environment as seen by CCachedEnvironmentVariable; never 0
+static std::atomic<uint32_t> s_unEnvironmentGeneration( 1 );
+
+void InvalidateEnvironmentVariableCache()
+{
+	uint32_t unGeneration = s_unEnvironmentGeneration.load();
+	while ( !s_unEnvironmentGeneration.compare_exchange_weak( unGeneration, unGeneration + 1 == 0 ? 1 : unGeneration + 1 ) )
+	{
+	}
 }
 
 bool SetEnvironmentVariable( const char *pchVarName, const char *pchVarValue )
 {
 #if defined(_WIN32)
-	return 0 != SetEnvironmentVariableA( pchVarName, pchVarValue );
+	bool bSet = 0 != SetEnvironmentVariableA( pchVarName, pchVarValue );
 #elif defined(POSIX)
+	bool bSet;
 	if( pchVarValue == NULL )
-		return 0 == unsetenv( pchVarName );
+		bSet = 0 == unsetenv( pchVarName );
 	else
-		return 0 == setenv( pchVarName, pchVarValue, 1 );
+		bSet = 0 == setenv( pchVarName, pchVarValue, 1 );
 #else
 #error "Unsupported Platform"
 #endif
+	InvalidateEnvironmentVariableCache();
+	return bSet;
+}
+
+CCachedEnvironmentVariable::CCachedEnvironmentVariable( const char *pchVarName )
+	: m_pchVarName( pchVarName )
+	, m_unGeneration( 0 )
+	, m_bSet( false )
+	, m_nBool( -1 )
+{
+}
+
+// ---------------------------------------------------------------------------
+// Purpose: Reads the variable again if the environment changed since the last
+//			read. The generation is taken before reading, so a change racing
+//			the read leaves the snapshot stale and it is read once more.
+// ---------------------------------------------------------------------------
+void CCachedEnvironmentVariable::Refresh()
+{
+	uint32_t unGeneration = s_unEnvironmentGeneration.load( std::memory_order_acquire );
+	if ( m_unGeneration.load( std::memory_order_acquire ) == unGeneration )
+		return;
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	if ( m_unGeneration.load( std::memory_order_relaxed ) == unGeneration )
+		return;
+
+	m_sValue = GetEnvironmentVariable( m_pchVarName );
+	m_bSet.store( !m_sValue.empty(), std::memory_order_relaxed );
+	m_nBool.store( m_sValue.empty() ? -1 : ParseEnvironmentVariableBool( m_pchVarName, m_sValue ), std::memory_order_relaxed );
+	m_unGeneration.store( unGeneration, std::memory_order_release );
+}
+
+std::string CCachedEnvironmentVariable::Get()
+{
+	Refresh();
+	std::lock_guard<std::mutex> lock( m_mutex );
+	return m_sValue;
+}
+
+bool CCachedEnvironmentVariable::IsSet()
+{
+	Refresh();
+	return m_bSet.load( std::memory_order_relaxed );
+}
+
+bool CCachedEnvironmentVariable::GetBool( bool bDefault )
+{
+	Refresh();
+	int nValue = m_nBool.load( std::memory_order_relaxed );
+	return nValue < 0 ? bDefault : nValue != 0;
 }
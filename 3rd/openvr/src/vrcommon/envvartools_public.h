@@ -2,7 +2,46 @@
 #pragma once
 
 #include <string>
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
 
 std::string GetEnvironmentVariable( const char *pchVarName );
 bool GetEnvironmentVariableAsBool( const char *pchVarName, bool bDefault );
 bool SetEnvironmentVariable( const char *pchVarName, const char *pchVarValue );
+
+/** Makes every CCachedEnvironmentVariable read the environment again on its next
+* use. SetEnvironmentVariable does this itself; call it after changing the
+* environment some other way. */
+void InvalidateEnvironmentVariableCache();
+
+/** A snapshot of one environment variable for code that checks it often, such as
+* debug or override flags read every frame. Make it static at the call site; once
+* read, IsSet and GetBool are a couple of atomic loads with no syscall or
+* allocation until the cache is invalidated. */
+class CCachedEnvironmentVariable
+{
+public:
+	explicit CCachedEnvironmentVariable( const char *pchVarName );
+
+	/** returns the value, or an empty string if the variable isn't set */
+	std::string Get();
+
+	bool IsSet();
+
+	/** parses the value as GetEnvironmentVariableAsBool does */
+	bool GetBool( bool bDefault );
+
+private:
+	CCachedEnvironmentVariable( const CCachedEnvironmentVariable & ) = delete;
+	CCachedEnvironmentVariable & operator=( const CCachedEnvironmentVariable & ) = delete;
+
+	void Refresh();
+
+	const char *m_pchVarName;
+	std::mutex m_mutex; // held while refreshing and while copying m_sValue
+	std::string m_sValue;
+	std::atomic<uint32_t> m_unGeneration; // generation m_sValue was read in, 0 for never
+	std::atomic<bool> m_bSet;
+	std::atomic<int> m_nBool; // 1 or 0 when the value parses as a bool, otherwise -1
+};
@@ -4,3 +4,7 @@
 const char *GetEnglishStringForHmdError( vr::EVRInitError eError );
 const char *GetIDForVRInitError( vr::EVRInitError eError );
 
+/** Parses a name from GetIDForVRInitError back into the error, e.g. from a log.
+* Returns false if the name isn't known. */
+bool GetVRInitErrorForID( const char *pchID, vr::EVRInitError *peError );
+
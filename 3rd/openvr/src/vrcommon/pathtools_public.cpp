@@ -17,6 +17,8 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <alloca.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #endif
 
 #if defined OSX
@@ -27,11 +29,15 @@
 #endif
 
 #include <sys/stat.h>
+#include <string.h>
 
 #include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
 
-/** Returns the path (including filename) to the current executable */
-std::string Path_GetExecutablePath()
+/** Asks the OS for the executable's path; Path_GetExecutablePath keeps the result */
+static std::string QueryExecutablePath()
 {
 #if defined( _WIN32 )
 	wchar_t *pwchPath = new wchar_t[MAX_UNICODE_PATH];
@@ -72,6 +78,14 @@ std::string Path_GetExecutablePath()
 
 }
 
+/** Returns the path (including filename) to the current executable */
+std::string Path_GetExecutablePath()
+{
+	// the executable can't change while the process runs
+	static const std::string s_sExecutablePath = QueryExecutablePath();
+	return s_sExecutablePath;
+}
+
 /** Returns the path of the current working directory */
 std::string Path_GetWorkingDirectory()
 {
@@ -233,13 +247,34 @@ std::string Path_FixSlashes( const std::string & sPath, char slash )
 		slash = Path_GetSlash();
 
 	std::string sFixed = sPath;
-	for( std::string::iterator i = sFixed.begin(); i != sFixed.end(); i++ )
+	Path_FixSlashesInPlace( sFixed, slash );
+	return sFixed;
+}
+
+
+void Path_FixSlashesInPlace( std::string & sPath, char slash )
+{
+	if( slash == 0 )
+		slash = Path_GetSlash();
+
+	for( std::string::iterator i = sPath.begin(); i != sPath.end(); i++ )
 	{
 		if( *i == '/' || *i == '\\' )
 			*i = slash;
 	}
+}
 
-	return sFixed;
+
+void Path_FixSlashesInPlace( char *pchPath, char slash )
+{
+	if( slash == 0 )
+		slash = Path_GetSlash();
+
+	for( char *pch = pchPath; *pch; pch++ )
+	{
+		if( *pch == '/' || *pch == '\\' )
+			*pch = slash;
+	}
 }
 
 
@@ -411,6 +446,146 @@ std::string Path_Compact( const std::string & sRawPath, char slash )
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Allocation-free versions of the path helpers. They produce the same
+//			strings as the std::string versions, built up in the caller's
+//			buffer; memmove everywhere since the buffer may be the input.
+//-----------------------------------------------------------------------------
+bool Path_StripFilename( const char *pchPath, char *pchBuffer, size_t unBufferSize, char slash )
+{
+	if( slash == 0 )
+		slash = Path_GetSlash();
+
+	const char *pchLastSlash = strrchr( pchPath, slash );
+	size_t unLength = pchLastSlash ? (size_t)( pchLastSlash - pchPath ) : strlen( pchPath );
+	if( unLength >= unBufferSize )
+		return false;
+
+	memmove( pchBuffer, pchPath, unLength );
+	pchBuffer[ unLength ] = 0;
+	return true;
+}
+
+
+bool Path_FixSlashes( const char *pchPath, char *pchBuffer, size_t unBufferSize, char slash )
+{
+	size_t unLength = strlen( pchPath );
+	if( unLength >= unBufferSize )
+		return false;
+
+	memmove( pchBuffer, pchPath, unLength + 1 );
+	Path_FixSlashesInPlace( pchBuffer, slash );
+	return true;
+}
+
+
+bool Path_Join( const char *pchFirst, const char *pchSecond, char *pchBuffer, size_t unBufferSize, char slash )
+{
+	if( slash == 0 )
+		slash = Path_GetSlash();
+
+	size_t unFirst = strlen( pchFirst );
+	size_t unSecond = strlen( pchSecond );
+	if( !unFirst )
+	{
+		if( unSecond >= unBufferSize )
+			return false;
+		memcpy( pchBuffer, pchSecond, unSecond + 1 );
+		return true;
+	}
+
+	// only insert a slash if we don't already have one
+	char cLast = pchFirst[ unFirst - 1 ];
+	if( cLast == '\\' || cLast == '/' )
+		unFirst--;
+	if( unFirst + 1 + unSecond >= unBufferSize )
+		return false;
+
+	memmove( pchBuffer, pchFirst, unFirst );
+	pchBuffer[ unFirst ] = slash;
+	memcpy( pchBuffer + unFirst + 1, pchSecond, unSecond + 1 );
+	return true;
+}
+
+
+bool Path_Compact( const char *pchRawPath, char *pchBuffer, size_t unBufferSize, char slash )
+{
+	if( slash == 0 )
+		slash = Path_GetSlash();
+
+	if( !Path_FixSlashes( pchRawPath, pchBuffer, unBufferSize, slash ) )
+		return false;
+	char *pchPath = pchBuffer;
+	size_t unLength = strlen( pchPath );
+
+	// strip out all /./
+	for( size_t i = 0; (i + 3) < unLength;  )
+	{
+		if( pchPath[ i ] == slash && pchPath[ i+1 ] == '.' && pchPath[ i+2 ] == slash )
+		{
+			memmove( pchPath + i + 1, pchPath + i + 3, unLength - ( i + 3 ) + 1 );
+			unLength -= 2;
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	// get rid of trailing /. but leave the path separator
+	if( unLength > 2 && pchPath[ unLength-1 ] == '.' && pchPath[ unLength-2 ] == slash )
+	{
+		pchPath[ --unLength ] = 0;
+	}
+
+	// get rid of leading ./
+	if( unLength > 2 && pchPath[ 0 ] == '.' && pchPath[ 1 ] == slash )
+	{
+		memmove( pchPath, pchPath + 2, unLength - 2 + 1 );
+		unLength -= 2;
+	}
+
+	// each time we encounter .. back up until we've found the previous directory name
+	// then get rid of both
+	size_t i = 0;
+	while( i < unLength )
+	{
+		if( i > 0 && unLength - i >= 2
+			&& pchPath[i] == '.'
+			&& pchPath[i+1] == '.'
+			&& ( i + 2 == unLength || pchPath[ i+2 ] == slash )
+			&& pchPath[ i-1 ] == slash )
+		{
+			// check if we've hit the start of the string and have a bogus path
+			if( i == 1 )
+			{
+				pchPath[ 0 ] = 0;
+				return true;
+			}
+
+			// find the separator before i-1
+			size_t iDirStart = i-2;
+			while( iDirStart > 0 && pchPath[ iDirStart - 1 ] != slash )
+				--iDirStart;
+
+			// remove everything from iDirStart to i+2
+			size_t unRemove = std::min( (i - iDirStart) + 3, unLength - iDirStart );
+			memmove( pchPath + iDirStart, pchPath + iDirStart + unRemove, unLength - ( iDirStart + unRemove ) + 1 );
+			unLength -= unRemove;
+
+			// start over
+			i = 0;
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	return true;
+}
+
+
 /** Returns true if these two paths are the same without respect for internal . or ..
 * sequences, slash type, or case (on case-insensitive platforms). */
 bool Path_IsSamePath( const std::string & sPath1, const std::string & sPath2 )
@@ -425,8 +600,8 @@ bool Path_IsSamePath( const std::string & sPath1, const std::string & sPath2 )
 }
 
 
-/** Returns the path to the current DLL or exe */
-std::string Path_GetThisModulePath()
+/** Asks the OS for the path of the module this code is in; Path_GetThisModulePath keeps the result */
+static std::string QueryThisModulePath()
 {
 	// gets the path of vrclient.dll itself
 #ifdef WIN32
@@ -454,17 +629,50 @@ std::string Path_GetThisModulePath()
 }
 
 
-/** returns true if the specified path exists and is a directory */
-bool Path_IsDirectory( const std::string & sPath )
+/** Returns the path to the current DLL or exe */
+std::string Path_GetThisModulePath()
 {
-	std::string sFixedPath = Path_FixSlashes( sPath );
-	if( sFixedPath.empty() )
-		return false;
-	char cLast = sFixedPath[ sFixedPath.length() - 1 ];
-	if( cLast == '/' || cLast == '\\' )
-		sFixedPath.erase( sFixedPath.end() - 1, sFixedPath.end() );
+	// a module is never moved while it is loaded
+	static const std::string s_sThisModulePath = QueryThisModulePath();
+	return s_sThisModulePath;
+}
 
-	// see if the specified path actually exists.
+
+//-----------------------------------------------------------------------------
+// Purpose: stat() results of recently probed paths. Runtime discovery and
+//			resource lookups ask about the same few paths many times in a
+//			row, so each answer is kept for k_flPathStatCacheSeconds; missing
+//			paths are cached as well. Writes through pathtools and dirtools
+//			drop the cache, other changes show up once an entry expires.
+//-----------------------------------------------------------------------------
+static const double k_flPathStatCacheSeconds = 0.5;
+static const size_t k_unPathStatCacheSize = 64;
+
+struct PathStatCacheEntry_t
+{
+	std::string sPath;
+	std::chrono::steady_clock::time_point expires;
+	bool bExists;
+	bool bIsDirectory;
+};
+
+struct PathStatCache_t
+{
+	std::mutex mutex;
+	std::vector< PathStatCacheEntry_t > vecEntries;
+};
+
+/** Never destroyed, so files written from static destructors in other modules can still use it */
+static PathStatCache_t & GetPathStatCache()
+{
+	static PathStatCache_t *s_pCache = new PathStatCache_t;
+	return *s_pCache;
+}
+
+/** Returns true if the fixed path exists, and in *pbIsDirectory whether it's a directory */
+static bool StatPath( const std::string & sFixedPath, bool *pbIsDirectory )
+{
+	*pbIsDirectory = false;
 
 #if defined(POSIX)
 	struct	stat	buf;
@@ -474,9 +682,9 @@ bool Path_IsDirectory( const std::string & sPath )
 	}
 
 #if defined( LINUX ) || defined( OSX )
-	return S_ISDIR( buf.st_mode );
+	*pbIsDirectory = S_ISDIR( buf.st_mode );
 #else
-	return (buf.st_mode & _S_IFDIR) != 0;
+	*pbIsDirectory = (buf.st_mode & _S_IFDIR) != 0;
 #endif
 
 #else
@@ -487,8 +695,79 @@ bool Path_IsDirectory( const std::string & sPath )
 		return false;
 	}
 
-	return (buf.st_mode & _S_IFDIR) != 0;
+	*pbIsDirectory = (buf.st_mode & _S_IFDIR) != 0;
 #endif
+
+	return true;
+}
+
+/** StatPath through the cache */
+static bool StatPathCached( const std::string & sFixedPath, bool *pbIsDirectory )
+{
+	PathStatCache_t & cache = GetPathStatCache();
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	{
+		std::lock_guard< std::mutex > lock( cache.mutex );
+		for ( const PathStatCacheEntry_t & entry : cache.vecEntries )
+		{
+			if ( entry.sPath == sFixedPath && entry.expires > now )
+			{
+				*pbIsDirectory = entry.bIsDirectory;
+				return entry.bExists;
+			}
+		}
+	}
+
+	// the syscall runs unlocked; two threads probing the same path both ask the OS
+	bool bExists = StatPath( sFixedPath, pbIsDirectory );
+
+	std::lock_guard< std::mutex > lock( cache.mutex );
+	PathStatCacheEntry_t *pSlot = nullptr;
+	for ( PathStatCacheEntry_t & entry : cache.vecEntries )
+	{
+		if ( entry.sPath == sFixedPath )
+		{
+			pSlot = &entry;
+			break;
+		}
+		if ( !pSlot || entry.expires < pSlot->expires )
+			pSlot = &entry;
+	}
+	if ( !pSlot || ( pSlot->sPath != sFixedPath && cache.vecEntries.size() < k_unPathStatCacheSize ) )
+	{
+		cache.vecEntries.push_back( PathStatCacheEntry_t() );
+		pSlot = &cache.vecEntries.back();
+	}
+	pSlot->sPath = sFixedPath;
+	pSlot->expires = now + std::chrono::duration_cast< std::chrono::steady_clock::duration >( std::chrono::duration< double >( k_flPathStatCacheSeconds ) );
+	pSlot->bExists = bExists;
+	pSlot->bIsDirectory = *pbIsDirectory;
+	return bExists;
+}
+
+
+/** Forgets every cached Path_Exists and Path_IsDirectory answer */
+void Path_InvalidateStatCache()
+{
+	PathStatCache_t & cache = GetPathStatCache();
+	std::lock_guard< std::mutex > lock( cache.mutex );
+	cache.vecEntries.clear();
+}
+
+
+/** returns true if the specified path exists and is a directory */
+bool Path_IsDirectory( const std::string & sPath )
+{
+	std::string sFixedPath = Path_FixSlashes( sPath );
+	if( sFixedPath.empty() )
+		return false;
+	char cLast = sFixedPath[ sFixedPath.length() - 1 ];
+	if( cLast == '/' || cLast == '\\' )
+		sFixedPath.erase( sFixedPath.end() - 1, sFixedPath.end() );
+
+	// see if the specified path actually exists.
+	bool bIsDirectory;
+	return StatPathCached( sFixedPath, &bIsDirectory ) && bIsDirectory;
 }
 
 /** returns true if the specified path represents an app bundle */
@@ -514,22 +793,8 @@ bool Path_Exists( const std::string & sPath )
 	if( sFixedPath.empty() )
 		return false;
 
-#if defined( WIN32 )
-	struct	_stat	buf;
-	std::wstring wsFixedPath = UTF8to16( sFixedPath.c_str() );
-	if ( _wstat( wsFixedPath.c_str(), &buf ) == -1 )
-	{
-		return false;
-	}
-#else
-	struct stat buf;
-	if ( stat ( sFixedPath.c_str(), &buf ) == -1)
-	{
-		return false;
-	}
-#endif
-
-	return true;
+	bool bIsDirectory;
+	return StatPathCached( sFixedPath, &bIsDirectory );
 }
 
 
@@ -667,6 +932,107 @@ uint32_t  Path_ReadBinaryFile( const std::string &strFilename, unsigned char *pB
 	return unSizeToReturn;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Read-only mapping of a whole file. Neither the file nor the mapping
+//			object has to stay open once the view exists, so only the view is
+//			kept.
+//-----------------------------------------------------------------------------
+CPathMappedFile::CPathMappedFile()
+	: m_pData( nullptr )
+	, m_unSize( 0 )
+{
+}
+
+CPathMappedFile::~CPathMappedFile()
+{
+	Close();
+}
+
+CPathMappedFile::CPathMappedFile( CPathMappedFile &&other )
+	: m_pData( other.m_pData )
+	, m_unSize( other.m_unSize )
+{
+	other.m_pData = nullptr;
+	other.m_unSize = 0;
+}
+
+CPathMappedFile &CPathMappedFile::operator=( CPathMappedFile &&other )
+{
+	if ( this != &other )
+	{
+		Close();
+		m_pData = other.m_pData;
+		m_unSize = other.m_unSize;
+		other.m_pData = nullptr;
+		other.m_unSize = 0;
+	}
+	return *this;
+}
+
+bool CPathMappedFile::BOpen( const std::string &strFilename )
+{
+	Close();
+
+#if defined( _WIN32 )
+	std::wstring wstrFilename = UTF8to16( strFilename.c_str() );
+	// shared the same way as Path_ReadBinaryFile's _wfsopen
+	HANDLE hFile = CreateFileW( wstrFilename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( hFile == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER size;
+	const void *pView = NULL;
+	if ( GetFileSizeEx( hFile, &size ) && size.QuadPart > 0 && (uint64_t)size.QuadPart <= (uint64_t)SIZE_MAX )
+	{
+		HANDLE hMapping = CreateFileMappingW( hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+		if ( hMapping != NULL )
+		{
+			pView = MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 );
+			CloseHandle( hMapping );
+		}
+	}
+	CloseHandle( hFile );
+
+	if ( !pView )
+		return false;
+	m_pData = (const unsigned char *)pView;
+	m_unSize = (uint64_t)size.QuadPart;
+#else
+	int fd = open( strFilename.c_str(), O_RDONLY );
+	if ( fd == -1 )
+		return false;
+
+	struct stat buf;
+	void *pView = MAP_FAILED;
+	if ( fstat( fd, &buf ) == 0 && buf.st_size > 0 && (uint64_t)buf.st_size <= (uint64_t)SIZE_MAX )
+	{
+		pView = mmap( NULL, (size_t)buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	}
+	close( fd );
+
+	if ( pView == MAP_FAILED )
+		return false;
+	m_pData = (const unsigned char *)pView;
+	m_unSize = (uint64_t)buf.st_size;
+#endif
+
+	return true;
+}
+
+void CPathMappedFile::Close()
+{
+	if ( !m_pData )
+		return;
+
+#if defined( _WIN32 )
+	UnmapViewOfFile( m_pData );
+#else
+	munmap( (void *)m_pData, (size_t)m_unSize );
+#endif
+	m_pData = nullptr;
+	m_unSize = 0;
+}
+
 bool Path_WriteBinaryFile(const std::string &strFilename, unsigned char *pData, unsigned nSize)
 {
 	FILE *f;
@@ -685,6 +1051,7 @@ bool Path_WriteBinaryFile(const std::string &strFilename, unsigned char *pData,
 	if (f != NULL) {
 		written = fwrite(pData, sizeof(unsigned char), nSize, f);
 		fclose(f);
+		Path_InvalidateStatCache();
 	}
 
 	return written == nSize ? true : false;
@@ -758,6 +1125,7 @@ bool Path_WriteStringToTextFile( const std::string &strFilename, const char *pch
 	{
 		ok = fputs( pchData, f) >= 0;
 		fclose(f);
+		Path_InvalidateStatCache();
 	}
 
 	return ok;
@@ -787,6 +1155,7 @@ bool Path_WriteStringToTextFileAtomic( const std::string &strFilename, const cha
 #error Do not know how to write atomic file
 #endif
 
+	Path_InvalidateStatCache();
 	return true;
 }
 
@@ -802,11 +1171,8 @@ bool Path_WriteStringToTextFileAtomic( const std::string &strFilename, const cha
 // ----------------------------------------------------------------------------------------------------------------------------
 std::string Path_FilePathToUrl( const std::string & sRelativePath, const std::string & sBasePath )
 {
-	if ( StringHasPrefix( sRelativePath, "http://" )
-		|| StringHasPrefix( sRelativePath, "https://" )
-		|| StringHasPrefix( sRelativePath, "vr-input-workshop://" )
-		|| StringHasPrefix( sRelativePath, "file://" )
-	   )
+	static const CStringPrefixMatcher k_urlSchemes = { "http://", "https://", "vr-input-workshop://", "file://" };
+	if ( k_urlSchemes.Match( sRelativePath ) >= 0 )
 	{
 		return sRelativePath;
 	}
@@ -889,10 +1255,13 @@ std::string GetUserDocumentsPath()
 // -----------------------------------------------------------------------------------------------------
 bool Path_UnlinkFile( const std::string &strFilename )
 {
+	bool bUnlinked;
 #if defined( WIN32 )
 	std::wstring wsFilename = UTF8to16( strFilename.c_str() );
-	return ( 0 != DeleteFileW( wsFilename.c_str() ) );
+	bUnlinked = ( 0 != DeleteFileW( wsFilename.c_str() ) );
 #else
-	return ( 0 == unlink( strFilename.c_str() ) );
+	bUnlinked = ( 0 == unlink( strFilename.c_str() ) );
 #endif
+	Path_InvalidateStatCache();
+	return bUnlinked;
 }
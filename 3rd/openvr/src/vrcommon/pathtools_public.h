@@ -2,9 +2,10 @@
 #pragma once
 
 #include <string>
+#include <stddef.h>
 #include <stdint.h>
 
-/** Returns the path (including filename) to the current executable */
+/** Returns the path (including filename) to the current executable, looked up once */
 std::string Path_GetExecutablePath();
 
 /** Returns the path of the current working directory */
@@ -16,7 +17,7 @@ bool Path_SetWorkingDirectory( const std::string & sPath );
 /** Gets the path to a temporary directory. */
 std::string Path_GetTemporaryDirectory();
 
-/** returns the path (including filename) of the current shared lib or DLL */
+/** returns the path (including filename) of the current shared lib or DLL, looked up once */
 std::string Path_GetThisModulePath();
 
 /** Returns the specified path without its filename.
@@ -67,6 +68,21 @@ std::string Path_Join(
 * will be used. */
 std::string Path_Compact( const std::string & sRawPath, char slash = 0 );
 
+/** Allocation-free versions of the above, for startup code that chains them.
+* Each writes a NUL-terminated result into pchBuffer and returns false, leaving
+* the buffer untouched, if the result plus its terminator doesn't fit in
+* unBufferSize bytes. pchBuffer may be the input path (pchFirst for Path_Join)
+* to work in place; the other inputs must not overlap it. A broken path gives
+* Path_Compact an empty result, as for the std::string version. */
+bool Path_StripFilename( const char *pchPath, char *pchBuffer, size_t unBufferSize, char slash = 0 );
+bool Path_FixSlashes( const char *pchPath, char *pchBuffer, size_t unBufferSize, char slash = 0 );
+bool Path_Join( const char *pchFirst, const char *pchSecond, char *pchBuffer, size_t unBufferSize, char slash = 0 );
+bool Path_Compact( const char *pchRawPath, char *pchBuffer, size_t unBufferSize, char slash = 0 );
+
+/** Fixes the directory separators without copying the path */
+void Path_FixSlashesInPlace( std::string & sPath, char slash = 0 );
+void Path_FixSlashesInPlace( char *pchPath, char slash = 0 );
+
 /** Returns true if these two paths are the same without respect for internal . or ..
 * sequences, slash type, or case (on case-insensitive platforms). */
 bool Path_IsSamePath( const std::string & sPath1, const std::string & sPath2 );
@@ -74,7 +90,9 @@ bool Path_IsSamePath( const std::string & sPath1, const std::string & sPath2 );
 //** Removed trailing slashes */
 std::string Path_RemoveTrailingSlash( const std::string & sRawPath, char slash = 0 );
 
-/** returns true if the specified path exists and is a directory */
+/** returns true if the specified path exists and is a directory. Like Path_Exists
+* the answer may be up to half a second old unless Path_InvalidateStatCache was
+* called; files written or deleted through these helpers invalidate it. */
 bool Path_IsDirectory( const std::string & sPath );
 
 /** returns true if the specified path represents an app bundle */
@@ -83,6 +101,10 @@ bool Path_IsAppBundle( const std::string & sPath );
 /** returns true if the the path exists */
 bool Path_Exists( const std::string & sPath );
 
+/** Makes the next Path_Exists and Path_IsDirectory calls ask the OS again, for
+* callers that change the file system some other way and check right after. */
+void Path_InvalidateStatCache();
+
 /** Helper functions to find parent directories or subdirectories of parent directories */
 std::string Path_FindParentDirectoryRecursively( const std::string &strStartDirectory, const std::string &strDirectoryName );
 std::string Path_FindParentSubDirectoryRecursively( const std::string &strStartDirectory, const std::string &strDirectoryName );
@@ -98,6 +120,37 @@ std::string Path_ReadTextFile( const std::string &strFilename );
 bool Path_WriteStringToTextFile( const std::string &strFilename, const char *pchData );
 bool Path_WriteStringToTextFileAtomic( const std::string &strFilename, const char *pchData );
 
+/** A read-only view of a whole file mapped into memory, for large files that
+* Path_ReadBinaryFile would copy up front. Pages are read in by the OS as they
+* are touched, and the view is unmapped when the object is closed or destroyed.
+* The file can't be resized while it's mapped on Windows; elsewhere truncating
+* it under the view makes reads past the new end fault, so map files that are
+* not being written. */
+class CPathMappedFile
+{
+public:
+	CPathMappedFile();
+	~CPathMappedFile();
+	CPathMappedFile( CPathMappedFile &&other );
+	CPathMappedFile &operator=( CPathMappedFile &&other );
+
+	/** Maps the whole file. Returns false, leaving the object closed, if it
+	* can't be opened or mapped or is empty. */
+	bool BOpen( const std::string &strFilename );
+	void Close();
+
+	bool BIsOpen() const { return m_pData != nullptr; }
+	const unsigned char *GetData() const { return m_pData; }
+	uint64_t GetSize() const { return m_unSize; }
+
+private:
+	CPathMappedFile( const CPathMappedFile & ) = delete;
+	CPathMappedFile &operator=( const CPathMappedFile & ) = delete;
+
+	const unsigned char *m_pData;
+	uint64_t m_unSize;
+};
+
 /** Returns a file:// url for paths, or an http or https url if that's what was provided */
 std::string Path_FilePathToUrl( const std::string & sRelativePath, const std::string & sBasePath );
 
@@ -1,6 +1,9 @@
 //========= Copyright Valve Corporation ============//
 #include "sharedlibtools_public.h"
 #include <string.h>
+#include <map>
+#include <mutex>
+#include <string>
 
 #if defined(_WIN32)
 #include <windows.h>
@@ -41,3 +44,106 @@ void SharedLib_Unload( SharedLibHandle lib )
 }
 
 
+// ---------------------------------------------------------------------------
+// Purpose: Process-wide table of the modules loaded through SharedLib_LoadCached,
+//			keyed by the path they were loaded from. An entry whose refcount
+//			drops to zero keeps its module and symbols until SharedLib_PurgeCache.
+// ---------------------------------------------------------------------------
+struct CachedSharedLib_t
+{
+	SharedLibHandle hLib;
+	int nRefCount;
+	std::map< std::string, void * > mapSymbols;
+};
+
+static std::mutex s_mutexSharedLibCache;
+static std::map< std::string, CachedSharedLib_t > s_mapSharedLibCache;
+
+static CachedSharedLib_t *FindCachedSharedLib( SharedLibHandle lib )
+{
+	for ( auto & entry : s_mapSharedLibCache )
+	{
+		if ( entry.second.hLib == lib )
+			return &entry.second;
+	}
+	return NULL;
+}
+
+SharedLibHandle SharedLib_LoadCached( const char *pchPath )
+{
+	std::lock_guard<std::mutex> lock( s_mutexSharedLibCache );
+
+	auto iter = s_mapSharedLibCache.find( pchPath );
+	if ( iter != s_mapSharedLibCache.end() )
+	{
+		iter->second.nRefCount++;
+		return iter->second.hLib;
+	}
+
+	SharedLibHandle lib = SharedLib_Load( pchPath );
+	if ( !lib )
+		return NULL;
+
+	// the same module under another path shares one entry, so the handle
+	// maps back to a single refcount
+	CachedSharedLib_t *pCached = FindCachedSharedLib( lib );
+	if ( pCached )
+	{
+		SharedLib_Unload( lib );
+		pCached->nRefCount++;
+		return lib;
+	}
+
+	CachedSharedLib_t &cached = s_mapSharedLibCache[ pchPath ];
+	cached.hLib = lib;
+	cached.nRefCount = 1;
+	return lib;
+}
+
+void *SharedLib_GetFunctionCached( SharedLibHandle lib, const char *pchFunctionName )
+{
+	std::lock_guard<std::mutex> lock( s_mutexSharedLibCache );
+
+	CachedSharedLib_t *pCached = FindCachedSharedLib( lib );
+	if ( !pCached )
+		return SharedLib_GetFunction( lib, pchFunctionName );
+
+	auto iter = pCached->mapSymbols.find( pchFunctionName );
+	if ( iter != pCached->mapSymbols.end() )
+		return iter->second;
+
+	// misses are memoized too; a module's exports don't change while it is mapped
+	void *pFunction = SharedLib_GetFunction( lib, pchFunctionName );
+	pCached->mapSymbols[ pchFunctionName ] = pFunction;
+	return pFunction;
+}
+
+void SharedLib_UnloadCached( SharedLibHandle lib )
+{
+	if ( !lib )
+		return;
+
+	std::lock_guard<std::mutex> lock( s_mutexSharedLibCache );
+
+	CachedSharedLib_t *pCached = FindCachedSharedLib( lib );
+	if ( pCached && pCached->nRefCount > 0 )
+		pCached->nRefCount--;
+}
+
+void SharedLib_PurgeCache()
+{
+	std::lock_guard<std::mutex> lock( s_mutexSharedLibCache );
+
+	for ( auto iter = s_mapSharedLibCache.begin(); iter != s_mapSharedLibCache.end(); )
+	{
+		if ( iter->second.nRefCount == 0 )
+		{
+			SharedLib_Unload( iter->second.hLib );
+			iter = s_mapSharedLibCache.erase( iter );
+		}
+		else
+		{
+			++iter;
+		}
+	}
+}
@@ -7,4 +7,13 @@ SharedLibHandle SharedLib_Load( const char *pchPath );
 void *SharedLib_GetFunction( SharedLibHandle lib, const char *pchFunctionName);
 void SharedLib_Unload( SharedLibHandle lib );
 
-
+/** Cached versions of the above for modules that are loaded and unloaded
+* repeatedly, such as vrclient across init/shutdown cycles. Loads are refcounted
+* per path, and a module stays mapped, with the symbols resolved from it
+* memoized, after its last SharedLib_UnloadCached so the next load is a lookup.
+* SharedLib_PurgeCache really unloads the modules nobody holds. Handles from
+* SharedLib_LoadCached must only be released with SharedLib_UnloadCached. */
+SharedLibHandle SharedLib_LoadCached( const char *pchPath );
+void *SharedLib_GetFunctionCached( SharedLibHandle lib, const char *pchFunctionName );
+void SharedLib_UnloadCached( SharedLibHandle lib );
+void SharedLib_PurgeCache();
@@ -10,6 +10,11 @@
 #include <locale>
 #include <codecvt>
 
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define STRTOOLS_SSE2 1
+#endif
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
@@ -25,6 +30,11 @@ bool StringHasPrefixCaseSensitive( const std::string & sString, const std::strin
 
 
 bool StringHasSuffix( const std::string &sString, const std::string &sSuffix )
+{
+	return StringHasSuffix( sString.data(), sString.length(), sSuffix.data(), sSuffix.length() );
+}
+
+bool StringHasSuffixCaseSensitive( const std::string &sString, const std::string &sSuffix )
 {
 	size_t cStrLen = sString.length();
 	size_t cSuffixLen = sSuffix.length();
@@ -34,34 +44,181 @@ bool StringHasSuffix( const std::string &sString, const std::string &sSuffix )
 
 	std::string sStringSuffix = sString.substr( cStrLen - cSuffixLen, cSuffixLen );
 
-	return 0 == stricmp( sStringSuffix.c_str(), sSuffix.c_str() );
+	return 0 == strncmp( sStringSuffix.c_str(), sSuffix.c_str(),cSuffixLen );
 }
 
-bool StringHasSuffixCaseSensitive( const std::string &sString, const std::string &sSuffix )
+//-----------------------------------------------------------------------------
+// Purpose: Case-insensitive comparisons over (pointer, length) pairs. Only
+//			ASCII letters are folded, as strnicmp does in the C locale, and
+//			nothing is copied.
+//-----------------------------------------------------------------------------
+static inline unsigned char FoldASCII( unsigned char c )
 {
-	size_t cStrLen = sString.length();
-	size_t cSuffixLen = sSuffix.length();
+	return ( c >= 'A' && c <= 'Z' ) ? (unsigned char)( c + ( 'a' - 'A' ) ) : c;
+}
 
-	if ( cSuffixLen > cStrLen )
-		return false;
+static bool EqualNoCase( const char *pchA, const char *pchB, size_t unLength )
+{
+	for ( size_t i = 0; i < unLength; i++ )
+	{
+		if ( FoldASCII( (unsigned char)pchA[ i ] ) != FoldASCII( (unsigned char)pchB[ i ] ) )
+			return false;
+	}
+	return true;
+}
 
-	std::string sStringSuffix = sString.substr( cStrLen - cSuffixLen, cSuffixLen );
+bool StringEqualNoCase( const char *pchA, size_t unALen, const char *pchB, size_t unBLen )
+{
+	return unALen == unBLen && EqualNoCase( pchA, pchB, unALen );
+}
 
-	return 0 == strncmp( sStringSuffix.c_str(), sSuffix.c_str(),cSuffixLen );
+bool StringHasPrefix( const char *pchString, size_t unStringLen, const char *pchPrefix, size_t unPrefixLen )
+{
+	return unPrefixLen <= unStringLen && EqualNoCase( pchString, pchPrefix, unPrefixLen );
+}
+
+bool StringHasSuffix( const char *pchString, size_t unStringLen, const char *pchSuffix, size_t unSuffixLen )
+{
+	return unSuffixLen <= unStringLen && EqualNoCase( pchString + unStringLen - unSuffixLen, pchSuffix, unSuffixLen );
 }
 
 //-----------------------------------------------------------------------------
-// Purpose:
+// Purpose: Buckets the prefixes by their folded first character so a match
+//			only compares against the prefixes that can possibly fit.
+//-----------------------------------------------------------------------------
+CStringPrefixMatcher::CStringPrefixMatcher( std::initializer_list< const char * > prefixes )
+{
+	for ( const char *pchPrefix : prefixes )
+	{
+		AddPrefix( pchPrefix );
+	}
+}
+
+void CStringPrefixMatcher::AddPrefix( const std::string & sPrefix )
+{
+	int nIndex = (int)m_vecPrefixes.size();
+	m_vecPrefixes.push_back( sPrefix );
+	if ( sPrefix.empty() )
+	{
+		if ( m_nEmptyPrefix < 0 )
+			m_nEmptyPrefix = nIndex;
+		return;
+	}
+	m_vecBuckets[ FoldASCII( (unsigned char)sPrefix[ 0 ] ) ].push_back( nIndex );
+}
+
+int CStringPrefixMatcher::Match( const char *pchString, size_t unStringLen ) const
+{
+	if ( unStringLen > 0 )
+	{
+		// indices are pushed in order, so the first hit is the earliest prefix
+		for ( int nIndex : m_vecBuckets[ FoldASCII( (unsigned char)pchString[ 0 ] ) ] )
+		{
+			if ( m_nEmptyPrefix >= 0 && m_nEmptyPrefix < nIndex )
+				break;
+			const std::string & sPrefix = m_vecPrefixes[ nIndex ];
+			if ( StringHasPrefix( pchString, unStringLen, sPrefix.data(), sPrefix.length() ) )
+				return nIndex;
+		}
+	}
+	return m_nEmptyPrefix;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies the leading run of 7-bit ASCII characters of a string,
+//			widening or narrowing each to the other width, and returns its
+//			length. ASCII is the same code unit in UTF-8 and UTF-16/32, so
+//			the run needs no decoding; with SSE2 it's checked and converted
+//			16 bytes at a time. wchar_t is 16 bits on Windows and 32 elsewhere.
+//-----------------------------------------------------------------------------
+static size_t WidenAsciiPrefix( const char *pchIn, size_t unLength, wchar_t *pwchOut )
+{
+	size_t i = 0;
+#if defined( STRTOOLS_SSE2 )
+	const __m128i zero = _mm_setzero_si128();
+	for ( ; i + 16 <= unLength; i += 16 )
+	{
+		__m128i bytes = _mm_loadu_si128( (const __m128i *)( pchIn + i ) );
+		if ( _mm_movemask_epi8( bytes ) != 0 )
+			break; // a byte with the high bit set, finish below
+		__m128i lo = _mm_unpacklo_epi8( bytes, zero );
+		__m128i hi = _mm_unpackhi_epi8( bytes, zero );
+		if ( sizeof( wchar_t ) == 2 )
+		{
+			_mm_storeu_si128( (__m128i *)( pwchOut + i ), lo );
+			_mm_storeu_si128( (__m128i *)( pwchOut + i + 8 ), hi );
+		}
+		else
+		{
+			_mm_storeu_si128( (__m128i *)( pwchOut + i ), _mm_unpacklo_epi16( lo, zero ) );
+			_mm_storeu_si128( (__m128i *)( pwchOut + i + 4 ), _mm_unpackhi_epi16( lo, zero ) );
+			_mm_storeu_si128( (__m128i *)( pwchOut + i + 8 ), _mm_unpacklo_epi16( hi, zero ) );
+			_mm_storeu_si128( (__m128i *)( pwchOut + i + 12 ), _mm_unpackhi_epi16( hi, zero ) );
+		}
+	}
+#endif
+	for ( ; i < unLength && (unsigned char)pchIn[ i ] < 0x80; i++ )
+	{
+		pwchOut[ i ] = (wchar_t)pchIn[ i ];
+	}
+	return i;
+}
+
+static size_t NarrowAsciiPrefix( const wchar_t *pwchIn, size_t unLength, char *pchOut )
+{
+	size_t i = 0;
+#if defined( STRTOOLS_SSE2 )
+	const size_t unPerVector = 16 / sizeof( wchar_t );
+	const __m128i nonAscii = sizeof( wchar_t ) == 2 ? _mm_set1_epi16( (short)0xff80 ) : _mm_set1_epi32( (int)0xffffff80 );
+	for ( ; i + 16 <= unLength; i += 16 )
+	{
+		__m128i units[ 4 ];
+		__m128i any = _mm_setzero_si128();
+		for ( size_t v = 0; v < 16 / unPerVector; v++ )
+		{
+			units[ v ] = _mm_loadu_si128( (const __m128i *)( pwchIn + i + v * unPerVector ) );
+			any = _mm_or_si128( any, _mm_and_si128( units[ v ], nonAscii ) );
+		}
+		if ( _mm_movemask_epi8( _mm_cmpeq_epi8( any, _mm_setzero_si128() ) ) != 0xffff )
+			break;
+
+		// every unit is below 0x80, so the saturating packs are exact
+		__m128i bytes;
+		if ( sizeof( wchar_t ) == 2 )
+			bytes = _mm_packus_epi16( units[ 0 ], units[ 1 ] );
+		else
+			bytes = _mm_packus_epi16( _mm_packs_epi32( units[ 0 ], units[ 1 ] ), _mm_packs_epi32( units[ 2 ], units[ 3 ] ) );
+		_mm_storeu_si128( (__m128i *)( pchOut + i ), bytes );
+	}
+#endif
+	for ( ; i < unLength && (uint32_t)pwchIn[ i ] < 0x80; i++ )
+	{
+		pchOut[ i ] = (char)pwchIn[ i ];
+	}
+	return i;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Conversions between UTF-8 and UTF-16. The ASCII prefix, which is
+//			usually the whole string, is copied directly; codecvt converts
+//			whatever follows it.
 //-----------------------------------------------------------------------------
 
 std::string UTF16to8(const wchar_t * in)
 {
 	try
 	{
+		size_t unLength = wcslen( in );
+		std::string sOut( unLength, '\0' );
+		size_t unAscii = unLength ? NarrowAsciiPrefix( in, unLength, &sOut[ 0 ] ) : 0;
+		if ( unAscii == unLength )
+			return sOut;
+		sOut.resize( unAscii );
+
 		typedef std::codecvt_utf8< wchar_t > convert_type;
 		std::wstring_convert< convert_type, wchar_t > converter;
 
-		return converter.to_bytes( in );
+		return sOut + converter.to_bytes( in + unAscii );
 	}
 	catch ( ... )
 	{
@@ -74,10 +231,17 @@ std::wstring UTF8to16(const char * in)
 {
 	try
 	{
+		size_t unLength = strlen( in );
+		std::wstring sOut( unLength, L'\0' );
+		size_t unAscii = unLength ? WidenAsciiPrefix( in, unLength, &sOut[ 0 ] ) : 0;
+		if ( unAscii == unLength )
+			return sOut;
+		sOut.resize( unAscii );
+
 		typedef std::codecvt_utf8< wchar_t > convert_type;
 		std::wstring_convert< convert_type, wchar_t > converter;
 
-		return converter.from_bytes( in );
+		return sOut + converter.from_bytes( in + unAscii );
 	}
 	catch ( ... )
 	{
@@ -424,55 +588,124 @@ std::vector<std::string> TokenizeString( const std::string & sString, char cToke
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Repairs a should-be-UTF-8 string to a for-sure-is-UTF-8 string, plus return boolean if we subbed in '?' somewhere
+// Purpose: Checks the multi-byte sequence starting at p. Returns its length
+//			if it is well-formed, otherwise 0 with *punInvalid set to the
+//			length of its longest valid-looking start, which is at least 1.
+//			Overlong forms, surrogates and code points above U+10FFFF are
+//			rejected.
 //-----------------------------------------------------------------------------
-bool RepairUTF8( const char *pbegin, const char *pend, std::string & sOutputUtf8 )
+static size_t UTF8SequenceLength( const unsigned char *p, const unsigned char *end, size_t *punInvalid )
 {
-	typedef std::codecvt_utf8<char32_t> facet_type;
-	facet_type myfacet;
+	unsigned char c = *p;
+	if ( c < 0x80 )
+		return 1;
+
+	size_t unLength;
+	unsigned char lo = 0x80, hi = 0xbf; // allowed range of the second byte
+	if ( c >= 0xc2 && c <= 0xdf )
+		unLength = 2;
+	else if ( c >= 0xe0 && c <= 0xef )
+	{
+		unLength = 3;
+		if ( c == 0xe0 )
+			lo = 0xa0; // overlong
+		else if ( c == 0xed )
+			hi = 0x9f; // surrogates
+	}
+	else if ( c >= 0xf0 && c <= 0xf4 )
+	{
+		unLength = 4;
+		if ( c == 0xf0 )
+			lo = 0x90; // overlong
+		else if ( c == 0xf4 )
+			hi = 0x8f; // above U+10FFFF
+	}
+	else
+	{
+		*punInvalid = 1;
+		return 0;
+	}
 
-	std::mbstate_t mystate = std::mbstate_t();
+	size_t i = 1;
+	if ( p + i != end && p[ i ] >= lo && p[ i ] <= hi )
+	{
+		for ( i++; i < unLength && p + i != end && ( p[ i ] & 0xc0 ) == 0x80; i++ )
+		{
+		}
+	}
+	if ( i == unLength )
+		return unLength;
 
-	sOutputUtf8.clear();
-	sOutputUtf8.reserve( pend - pbegin );
-	bool bSqueakyClean = true;
+	*punInvalid = i;
+	return 0;
+}
 
-	const char *pmid = pbegin;
+//-----------------------------------------------------------------------------
+// Purpose: Returns the length of the longest prefix of [pbegin, pend) that is
+//			well-formed UTF-8. Runs of ASCII are skipped 16 bytes at a time
+//			with SSE2.
+//-----------------------------------------------------------------------------
+static size_t ValidUTF8Prefix( const char *pbegin, const char *pend )
+{
+	const unsigned char *p = (const unsigned char *)pbegin;
+	const unsigned char *end = (const unsigned char *)pend;
 
-	while ( pmid != pend )
+	while ( p != end )
 	{
-		char32_t out = 0xdeadbeef, *pout;
-		pbegin = pmid;
-		switch ( myfacet.in( mystate, pbegin, pend, pmid, &out, &out + 1, pout ) )
+#if defined( STRTOOLS_SSE2 )
+		while ( end - p >= 16 && _mm_movemask_epi8( _mm_loadu_si128( (const __m128i *)p ) ) == 0 )
 		{
-		case facet_type::ok:
-			// could convert back, but no need
-			for ( const char *p = pbegin; p != pmid; ++p )
-			{
-				sOutputUtf8 += *p;
-			}
+			p += 16;
+		}
+		if ( p == end )
 			break;
-
-		case facet_type::noconv:
-			// unexpected! always converting type
-			bSqueakyClean = false;
+#endif
+		size_t unInvalid;
+		size_t unLength = UTF8SequenceLength( p, end, &unInvalid );
+		if ( unLength == 0 )
 			break;
+		p += unLength;
+	}
 
-		case facet_type::partial:
-			sOutputUtf8 += '?';
-			pmid++;  // partial consumes 0, so make progress
-			bSqueakyClean = false;
-			break;
+	return (const char *)p - pbegin;
+}
 
-		case facet_type::error:
-			sOutputUtf8 += '?';
-			// error consumes some bytes
-			bSqueakyClean = false;
-			break;
-		}
+//-----------------------------------------------------------------------------
+// Purpose: returns true if the string is well-formed UTF-8
+//-----------------------------------------------------------------------------
+bool IsValidUTF8( const char *pbegin, const char *pend )
+{
+	return ValidUTF8Prefix( pbegin, pend ) == (size_t)( pend - pbegin );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Repairs a should-be-UTF-8 string to a for-sure-is-UTF-8 string, plus return boolean if we subbed in '?' somewhere
+//			Valid runs are appended whole; each ill-formed sequence becomes
+//			a single '?'.
+//-----------------------------------------------------------------------------
+bool RepairUTF8( const char *pbegin, const char *pend, std::string & sOutputUtf8 )
+{
+	size_t unValid = ValidUTF8Prefix( pbegin, pend );
+	sOutputUtf8.assign( pbegin, unValid );
+	if ( pbegin + unValid == pend )
+		return true;
+
+	sOutputUtf8.reserve( pend - pbegin );
+
+	const char *pmid = pbegin + unValid;
+	while ( pmid != pend )
+	{
+		size_t unInvalid = 1;
+		UTF8SequenceLength( (const unsigned char *)pmid, (const unsigned char *)pend, &unInvalid );
+		sOutputUtf8 += '?';
+		pmid += unInvalid;
+
+		unValid = ValidUTF8Prefix( pmid, pend );
+		sOutputUtf8.append( pmid, unValid );
+		pmid += unValid;
 	}
 
-	return bSqueakyClean;
+	return false;
 }
 
 //-----------------------------------------------------------------------------
@@ -482,3 +715,18 @@ bool RepairUTF8( const std::string & sInputUtf8, std::string & sOutputUtf8 )
 {
 	return RepairUTF8( sInputUtf8.data(), sInputUtf8.data() + sInputUtf8.size(), sOutputUtf8 );
 }
+
+//-----------------------------------------------------------------------------
+// Purpose: Repairs a should-be-UTF-8 string in place. Valid strings, the
+//			common case, are scanned and left untouched without a copy.
+//-----------------------------------------------------------------------------
+bool RepairUTF8InPlace( std::string & sUtf8 )
+{
+	if ( IsValidUTF8( sUtf8.data(), sUtf8.data() + sUtf8.size() ) )
+		return true;
+
+	std::string sRepaired;
+	bool bSqueakyClean = RepairUTF8( sUtf8, sRepaired );
+	sUtf8.swap( sRepaired );
+	return bSqueakyClean;
+}
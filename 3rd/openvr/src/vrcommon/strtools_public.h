@@ -2,9 +2,11 @@
 #pragma once
 
 #include <string>
+#include <stddef.h>
 #include <stdint.h>
 #include <sys/types.h>
 #include <vector>
+#include <initializer_list>
 
 /** returns true if the string has the prefix */
 bool StringHasPrefix( const std::string & sString, const std::string & sPrefix );
@@ -14,6 +16,34 @@ bool StringHasPrefixCaseSensitive( const std::string & sString, const std::strin
 bool StringHasSuffix( const std::string &sString, const std::string &sSuffix );
 bool StringHasSuffixCaseSensitive( const std::string &sString, const std::string &sSuffix );
 
+/** Case-insensitive comparisons that don't allocate. Only ASCII letters are
+* folded. The strings are (pointer, length) pairs and need not be NUL-terminated. */
+bool StringEqualNoCase( const char *pchA, size_t unALen, const char *pchB, size_t unBLen );
+bool StringHasPrefix( const char *pchString, size_t unStringLen, const char *pchPrefix, size_t unPrefixLen );
+bool StringHasSuffix( const char *pchString, size_t unStringLen, const char *pchSuffix, size_t unSuffixLen );
+
+/** Matches one string case-insensitively against a fixed set of prefixes.
+* Build it once and reuse it; Match doesn't allocate. */
+class CStringPrefixMatcher
+{
+public:
+	CStringPrefixMatcher() {}
+	CStringPrefixMatcher( std::initializer_list< const char * > prefixes );
+
+	void AddPrefix( const std::string & sPrefix );
+
+	/** returns the index of the first added prefix the string starts with, or -1 */
+	int Match( const char *pchString, size_t unStringLen ) const;
+	int Match( const std::string & sString ) const { return Match( sString.data(), sString.length() ); }
+
+	size_t GetPrefixCount() const { return m_vecPrefixes.size(); }
+
+private:
+	std::vector< std::string > m_vecPrefixes;
+	std::vector< int > m_vecBuckets[ 256 ]; // prefix indices by folded first character
+	int m_nEmptyPrefix = -1;
+};
+
 /** converts a UTF-16 string to a UTF-8 string */
 std::string UTF16to8(const wchar_t * in);
 
@@ -25,6 +55,12 @@ std::wstring UTF8to16(const char * in);
 bool RepairUTF8( const char *begin, const char *end, std::string & sOutputUtf8 );
 bool RepairUTF8( const std::string & sInputUtf8, std::string & sOutputUtf8 );
 
+/** Same as RepairUTF8, but leaves the string untouched, with no copy, when it is already valid */
+bool RepairUTF8InPlace( std::string & sUtf8 );
+
+/** returns true if the string is well-formed UTF-8 */
+bool IsValidUTF8( const char *begin, const char *end );
+
 /** safely copy a string into a buffer */
 void strcpy_safe( char *pchBuffer, size_t unBufferSizeBytes, const char *pchSource );
 template< size_t bufferSize >
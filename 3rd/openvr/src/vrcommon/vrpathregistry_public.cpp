@@ -20,7 +20,12 @@
 #include <stdio.h>
 #endif
 
+#include <sys/stat.h>
+
 #include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #ifndef VRLog
 	#if defined( __MINGW32__ )
@@ -121,7 +126,7 @@ std::string CVRPathRegistry_Public::GetOpenVRConfigPath()
 #else
 	#warning "Unsupported platform"
 #endif
-	sConfigPath = Path_FixSlashes( sConfigPath );
+	Path_FixSlashesInPlace( sConfigPath );
 	return sConfigPath;
 }
 
@@ -147,34 +152,136 @@ std::string CVRPathRegistry_Public::GetVRPathRegistryFilename()
 #else
 	#error "Unsupported platform"
 #endif
-	sPath = Path_FixSlashes( sPath );
+	Path_FixSlashesInPlace( sPath );
 	return sPath;
 }
 
 
 // ---------------------------------------------------------------------------
-// Purpose: Converts JSON to a history array
+// Purpose: Pulls the history arrays out of the registry JSON as it is read,
+//			without building a Json::Value tree. Only members of the root
+//			object are looked at; anything else is skipped.
 // ---------------------------------------------------------------------------
-static void ParseStringListFromJson( std::vector< std::string > *pvecHistory, const Json::Value & root, const char *pchArrayName )
+class CPathRegistryJsonHandler : public Json::SaxHandler
 {
-	if( !root.isMember( pchArrayName ) )
-		return;
+public:
+	enum EList
+	{
+		List_Runtime,
+		List_Config,
+		List_Log,
+		List_ExternalDrivers,
+		List_Count,
+		List_None = List_Count,
+	};
+
+	std::vector< std::string > m_rgvecLists[ List_Count ];
+	bool m_rgbListFound[ List_Count ] = {};
+
+	virtual bool startObject() override
+	{
+		// Json::Value reads an object as a string list with a throw
+		if ( m_nDepth == 1 && m_eMember != List_None )
+			return false;
+		StartListEntry();
+		m_nDepth++;
+		return true;
+	}
 
-	const Json::Value & arrayNode = root[ pchArrayName ];
-	if( !arrayNode )
+	virtual bool endObject() override
 	{
-		VRLog( "VR Path Registry node %s is not an array\n", pchArrayName );
-		return;
+		m_nDepth--;
+		if ( m_nDepth == 1 )
+			m_eMember = List_None;
+		return true;
 	}
 
-	pvecHistory->clear();
-	pvecHistory->reserve( arrayNode.size() );
-	for( uint32_t unIndex = 0; unIndex < arrayNode.size(); unIndex++ )
+	virtual bool startArray() override
 	{
-		std::string sPath( arrayNode[ unIndex ].asString() );
-		pvecHistory->push_back( sPath );
+		if ( m_nDepth == 0 )
+			return false; // the root has to be an object
+		StartListEntry();
+		if ( m_nDepth == 1 && m_eMember != List_None )
+		{
+			m_rgbListFound[ m_eMember ] = true;
+			m_rgvecLists[ m_eMember ].clear();
+			m_bInList = true;
+		}
+		m_nDepth++;
+		return true;
+	}
+
+	virtual bool endArray() override
+	{
+		m_nDepth--;
+		if ( m_nDepth == 1 )
+		{
+			m_bInList = false;
+			m_eMember = List_None;
+		}
+		return true;
+	}
+
+	virtual bool key( const std::string & sName ) override
+	{
+		if ( m_nDepth != 1 )
+			return true;
+
+		m_eMember = List_None;
+		for ( int i = 0; i < List_Count; i++ )
+		{
+			if ( sName == k_rgchListNames[ i ] )
+				m_eMember = (EList)i;
+		}
+		return true;
 	}
-}
+
+	virtual bool value( const Json::Value & scalar ) override
+	{
+		if ( m_nDepth == 0 )
+			return scalar.isNull(); // a null document just has no lists
+
+		if ( m_nDepth == 2 && m_bInList )
+		{
+			m_rgvecLists[ m_eMember ].push_back( scalar.asString() );
+		}
+		else if ( m_nDepth == 1 && m_eMember != List_None )
+		{
+			if ( m_eMember == List_ExternalDrivers )
+			{
+				// only read when it is an array
+			}
+			else if ( scalar.isNull() )
+			{
+				VRLog( "VR Path Registry node %s is not an array\n", k_rgchListNames[ m_eMember ] );
+			}
+			else
+			{
+				// any other scalar reads as an empty list
+				m_rgbListFound[ m_eMember ] = true;
+				m_rgvecLists[ m_eMember ].clear();
+			}
+			m_eMember = List_None;
+		}
+		return true;
+	}
+
+private:
+	/** a container in a string list reads as an empty string, as asString gives it */
+	void StartListEntry()
+	{
+		if ( m_nDepth == 2 && m_bInList )
+			m_rgvecLists[ m_eMember ].push_back( "" );
+	}
+
+	static const char * const k_rgchListNames[ List_Count ];
+
+	int m_nDepth = 0;
+	EList m_eMember = List_None; // the root member whose value is next
+	bool m_bInList = false;
+};
+
+const char * const CPathRegistryJsonHandler::k_rgchListNames[ List_Count ] = { "runtime", "config", "log", "external_drivers" };
 
 
 // ---------------------------------------------------------------------------
@@ -228,25 +335,16 @@ bool CVRPathRegistry_Public::BLoadFromFile()
 		return false;
 	}
 
-	Json::Value root;
-	Json::CharReaderBuilder builder;
-	std::istringstream istream( sRegistryContents );
-	std::string sErrors;
+	CPathRegistryJsonHandler handler;
+	Json::Reader reader;
 
 	try {
-		if ( !parseFromStream( builder, istream, &root, &sErrors ) )
+		if ( !reader.parse( sRegistryContents.data(), sRegistryContents.data() + sRegistryContents.size(), handler ) )
 		{
-			VRLog( "Unable to parse %s: %s\n", sRegPath.c_str(), sErrors.c_str() );
+			std::string sErrors = reader.getFormattedErrorMessages();
+			VRLog( "Unable to parse %s: %s\n", sRegPath.c_str(), sErrors.empty() ? "unexpected JSON structure" : sErrors.c_str() );
 			return false;
 		}
-
-		ParseStringListFromJson( &m_vecRuntimePath, root, "runtime" );
-		ParseStringListFromJson( &m_vecConfigPath, root, "config" );
-		ParseStringListFromJson( &m_vecLogPath, root, "log" );
-		if ( root.isMember( "external_drivers" ) && root["external_drivers"].isArray() )
-		{
-			ParseStringListFromJson( &m_vecExternalDrivers, root, "external_drivers" );
-		}
 	}
 	catch ( ... )
 	{
@@ -254,22 +352,139 @@ bool CVRPathRegistry_Public::BLoadFromFile()
 		return false;
 	}
 
+	std::vector< std::string > *rgpvecLists[ CPathRegistryJsonHandler::List_Count ] = { &m_vecRuntimePath, &m_vecConfigPath, &m_vecLogPath, &m_vecExternalDrivers };
+	for ( int i = 0; i < CPathRegistryJsonHandler::List_Count; i++ )
+	{
+		if ( handler.m_rgbListFound[ i ] )
+			rgpvecLists[ i ]->swap( handler.m_rgvecLists[ i ] );
+	}
+
 	return true;
 }
 
 
+// the process-wide copy of the registry LoadCachedRegistry keeps; defined
+// before s_registrySaver, whose destructor may still save
+static std::mutex s_mutexCachedRegistry;
+static bool s_bCacheValid = false;
+
+/** Makes the next GetPaths read the file again, for saves from this process */
+static void InvalidateCachedRegistry()
+{
+	std::lock_guard<std::mutex> lock( s_mutexCachedRegistry );
+	s_bCacheValid = false;
+}
+
 // ---------------------------------------------------------------------------
-// Purpose: Saves the config file to its well known location
+// Purpose: Writes the registry contents through a temporary file that is
+//			renamed over the registry, so a reader never sees half a file
 // ---------------------------------------------------------------------------
-bool CVRPathRegistry_Public::BSaveToFile() const
+static bool WriteRegistryFile( const std::string &sRegPath, const std::string &sRegistryContents )
 {
-#if defined( DASHBOARD_BUILD_MODE )
-	return false;
-#else
-	std::string sRegPath = GetVRPathRegistryFilename();
-	if( sRegPath.empty() )
+	// make sure the directory we're writing into actually exists
+	std::string sRegDirectory = Path_StripFilename( sRegPath );
+	if( !BCreateDirectoryRecursive( sRegDirectory.c_str() ) )
+	{
+		VRLog( "Unable to create path registry directory %s\n", sRegDirectory.c_str() );
 		return false;
-	
+	}
+
+	bool bWritten = Path_WriteStringToTextFileAtomic( sRegPath, sRegistryContents.c_str() );
+
+	// a rewrite within the same second and of the same size would look unchanged
+	InvalidateCachedRegistry();
+
+	if( !bWritten )
+	{
+		VRLog( "Unable to write VR path registry to %s\n", sRegPath.c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Purpose: Writes the files queued by BSaveToFileAsync on a thread of its own
+//			that runs while there is something to write. Only the newest
+//			contents waiting are written; a save queued while an older one
+//			waits replaces it. Both strings keep their capacity, so steady
+//			saves reuse the same two buffers.
+// ---------------------------------------------------------------------------
+class CPathRegistrySaver
+{
+public:
+	~CPathRegistrySaver()
+	{
+		WaitForIdle();
+	}
+
+	/** Takes sRegistryContents, leaving it with a spare buffer */
+	void Queue( const std::string &sRegPath, std::string &sRegistryContents )
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_sPendingPath = sRegPath;
+		m_sPending.swap( sRegistryContents );
+		m_bPending = true;
+		if ( m_bRunning )
+			return;
+
+		// a thread that finished has already let go of the lock
+		if ( m_thread.joinable() )
+			m_thread.join();
+		m_bRunning = true;
+		m_thread = std::thread( &CPathRegistrySaver::Run, this );
+	}
+
+	bool WaitForIdle()
+	{
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_idle.wait( lock, [this] { return !m_bRunning; } );
+		if ( m_thread.joinable() )
+			m_thread.join();
+		return m_bLastSaved;
+	}
+
+private:
+	void Run()
+	{
+		std::unique_lock<std::mutex> lock( m_mutex );
+		while ( m_bPending )
+		{
+			m_sWritingPath.swap( m_sPendingPath );
+			m_sWriting.swap( m_sPending );
+			m_bPending = false;
+			lock.unlock();
+
+			bool bSaved = WriteRegistryFile( m_sWritingPath, m_sWriting );
+
+			lock.lock();
+			m_bLastSaved = bSaved;
+		}
+		m_bRunning = false;
+		m_idle.notify_all();
+	}
+
+	std::mutex m_mutex; // everything but the writing strings, which belong to the thread
+	std::condition_variable m_idle;
+	std::thread m_thread;
+	std::string m_sPendingPath;
+	std::string m_sPending;
+	std::string m_sWritingPath;
+	std::string m_sWriting;
+	bool m_bPending = false;
+	bool m_bRunning = false;
+	bool m_bLastSaved = true;
+};
+
+static CPathRegistrySaver s_registrySaver;
+
+
+// ---------------------------------------------------------------------------
+// Purpose: Serializes the registry as the file stores it
+// ---------------------------------------------------------------------------
+void CVRPathRegistry_Public::ToRegistryContents( std::string &sRegistryContents ) const
+{
 	Json::Value root;
 	
 	root[ "version" ] = 1;
@@ -281,27 +496,62 @@ bool CVRPathRegistry_Public::BSaveToFile() const
 	StringListToJson( m_vecExternalDrivers, root, "external_drivers" );
 
 	Json::StreamWriterBuilder builder;
-	std::string sRegistryContents = Json::writeString( builder, root );
+	sRegistryContents = Json::writeString( builder, root );
+}
 
-	// make sure the directory we're writing into actually exists
-	std::string sRegDirectory = Path_StripFilename( sRegPath );
-	if( !BCreateDirectoryRecursive( sRegDirectory.c_str() ) )
-	{
-		VRLog( "Unable to create path registry directory %s\n", sRegDirectory.c_str() );
+
+// ---------------------------------------------------------------------------
+// Purpose: Saves the config file to its well known location
+// ---------------------------------------------------------------------------
+bool CVRPathRegistry_Public::BSaveToFile() const
+{
+#if defined( DASHBOARD_BUILD_MODE )
+	return false;
+#else
+	std::string sRegPath = GetVRPathRegistryFilename();
+	if( sRegPath.empty() )
 		return false;
-	}
 
-	if( !Path_WriteStringToTextFile( sRegPath, sRegistryContents.c_str() ) )
-	{
-		VRLog( "Unable to write VR path registry to %s\n", sRegPath.c_str() );
+	std::string sRegistryContents;
+	ToRegistryContents( sRegistryContents );
+
+	// an async save still waiting would overwrite this one
+	s_registrySaver.WaitForIdle();
+	return WriteRegistryFile( sRegPath, sRegistryContents );
+#endif
+}
+
+
+// ---------------------------------------------------------------------------
+// Purpose: Saves the config file to its well known location without waiting
+//			for the disk
+// ---------------------------------------------------------------------------
+bool CVRPathRegistry_Public::BSaveToFileAsync() const
+{
+#if defined( DASHBOARD_BUILD_MODE )
+	return false;
+#else
+	std::string sRegPath = GetVRPathRegistryFilename();
+	if( sRegPath.empty() )
 		return false;
-	}
 
+	std::string sRegistryContents;
+	ToRegistryContents( sRegistryContents );
+	s_registrySaver.Queue( sRegPath, sRegistryContents );
 	return true;
 #endif
 }
 
 
+// ---------------------------------------------------------------------------
+// Purpose: Blocks until the saves queued by BSaveToFileAsync are written
+// ---------------------------------------------------------------------------
+bool CVRPathRegistry_Public::WaitForPendingSaves()
+{
+	return s_registrySaver.WaitForIdle();
+}
+
+
 // ---------------------------------------------------------------------------
 // Purpose: Returns the current runtime path or NULL if no path is configured.
 // ---------------------------------------------------------------------------
@@ -339,6 +589,66 @@ std::string CVRPathRegistry_Public::GetLogPath() const
 
 
 
+// ---------------------------------------------------------------------------
+// Purpose: Modification time and size of the registry file, or false if it
+//			can't be stat'ed
+// ---------------------------------------------------------------------------
+static bool GetRegistryFileStamp( const std::string &sRegPath, int64_t *pnModifiedTime, int64_t *pnSize )
+{
+#if defined( WIN32 )
+	struct	_stat64	buf;
+	std::wstring wsRegPath = UTF8to16( sRegPath.c_str() );
+	if ( _wstat64( wsRegPath.c_str(), &buf ) == -1 )
+		return false;
+#else
+	struct stat buf;
+	if ( stat( sRegPath.c_str(), &buf ) == -1 )
+		return false;
+#endif
+
+	*pnModifiedTime = (int64_t)buf.st_mtime;
+	*pnSize = (int64_t)buf.st_size;
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Purpose: Process-wide copy of the registry. The file is read and parsed
+//			again only when its path, modification time or size differs from
+//			the last parse, so repeated runtime probes cost a stat. A rewrite
+//			within the same second that keeps the size is not noticed.
+// ---------------------------------------------------------------------------
+static bool LoadCachedRegistry( CVRPathRegistry_Public *pPathReg )
+{
+	static CVRPathRegistry_Public s_cachedRegistry;
+	static bool s_bCachedLoaded = false;
+	static std::string s_sCachedPath;
+	static int64_t s_nCachedModifiedTime = 0;
+	static int64_t s_nCachedSize = 0;
+
+	std::string sRegPath = CVRPathRegistry_Public::GetVRPathRegistryFilename();
+	int64_t nModifiedTime = 0, nSize = 0;
+	bool bStamped = !sRegPath.empty() && GetRegistryFileStamp( sRegPath, &nModifiedTime, &nSize );
+
+	std::lock_guard<std::mutex> lock( s_mutexCachedRegistry );
+
+	// a file that can't be stat'ed can't be read either; keep trying so the
+	// failure is logged and a registry created later is picked up
+	if ( !bStamped || !s_bCacheValid || sRegPath != s_sCachedPath || nModifiedTime != s_nCachedModifiedTime || nSize != s_nCachedSize )
+	{
+		s_cachedRegistry = CVRPathRegistry_Public();
+		s_bCachedLoaded = s_cachedRegistry.BLoadFromFile();
+		s_bCacheValid = bStamped;
+		s_sCachedPath = sRegPath;
+		s_nCachedModifiedTime = nModifiedTime;
+		s_nCachedSize = nSize;
+	}
+
+	*pPathReg = s_cachedRegistry;
+	return s_bCachedLoaded;
+}
+
+
 // ---------------------------------------------------------------------------
 // Purpose: Returns paths using the path registry and the provided override 
 //			values. Pass NULL for any paths you don't care about.
@@ -346,7 +656,7 @@ std::string CVRPathRegistry_Public::GetLogPath() const
 bool CVRPathRegistry_Public::GetPaths( std::string *psRuntimePath, std::string *psConfigPath, std::string *psLogPath, const char *pchConfigPathOverride, const char *pchLogPathOverride, std::vector<std::string> *pvecExternalDrivers )
 {
 	CVRPathRegistry_Public pathReg;
-	bool bLoadedRegistry = pathReg.BLoadFromFile();
+	bool bLoadedRegistry = LoadCachedRegistry( &pathReg );
 	int nCountEnvironmentVariables = 0;
 
 	if( psRuntimePath )
@@ -25,6 +25,16 @@ public:
 	bool BLoadFromFile();
 	bool BSaveToFile() const;
 
+	/** Serializes the registry on this thread and writes it on a background one, so
+	* the caller doesn't wait for the disk. Like BSaveToFile the file is replaced
+	* through a temporary. A save queued before an older one is written supersedes
+	* it. Returns false only if there is nowhere to save to. */
+	bool BSaveToFileAsync() const;
+
+	/** Blocks until the queued async saves are written; false if the last one failed.
+	* Call it before unloading the module that queued them. */
+	static bool WaitForPendingSaves();
+
 	bool ToJsonString( std::string &sJsonString );
 
 	// methods to get the current values
@@ -42,4 +52,7 @@ protected:
 
 	// full list of external drivers
 	StringVector_t m_vecExternalDrivers;
+
+private:
+	void ToRegistryContents( std::string &sRegistryContents ) const;
 };
@@ -0,0 +1,101 @@
+#include "allocaudit.h"
+
+#include <stdlib.h>
+
+#include <new>
+
+// the counter of the calling thread, null on threads that aren't audited
+static thread_local CAllocationCounter* s_pAllocationCounter = nullptr;
+
+CScopedAllocationAudit::CScopedAllocationAudit(CAllocationCounter* pCounter)
+	: m_pPrevious(s_pAllocationCounter)
+{
+	if (AllocationAuditEnabled())
+		s_pAllocationCounter = pCounter;
+}
+
+CScopedAllocationAudit::~CScopedAllocationAudit()
+{
+	if (AllocationAuditEnabled())
+		s_pAllocationCounter = m_pPrevious;
+}
+
+#if ZEDM_ALLOCATION_AUDIT
+// --------------------------------------------------------------------------
+// Purpose: The replaced global allocation functions. Straight to malloc and
+// free; the counter is the only extra work, and only on audited threads.
+// --------------------------------------------------------------------------
+static void* AuditedAllocate(size_t unBytes)
+{
+	CAllocationCounter* pCounter = s_pAllocationCounter;
+	if (pCounter)
+		pCounter->CountAllocation(unBytes);
+	return malloc(unBytes ? unBytes : 1);
+}
+
+static void AuditedFree(void* pMemory)
+{
+	if (!pMemory)
+		return;
+	CAllocationCounter* pCounter = s_pAllocationCounter;
+	if (pCounter)
+		pCounter->CountFree();
+	free(pMemory);
+}
+
+void* operator new(size_t unBytes)
+{
+	void* pMemory = AuditedAllocate(unBytes);
+	if (!pMemory)
+		throw std::bad_alloc();
+	return pMemory;
+}
+
+void* operator new[](size_t unBytes)
+{
+	void* pMemory = AuditedAllocate(unBytes);
+	if (!pMemory)
+		throw std::bad_alloc();
+	return pMemory;
+}
+
+void* operator new(size_t unBytes, const std::nothrow_t&) noexcept
+{
+	return AuditedAllocate(unBytes);
+}
+
+void* operator new[](size_t unBytes, const std::nothrow_t&) noexcept
+{
+	return AuditedAllocate(unBytes);
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	AuditedFree(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	AuditedFree(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+	AuditedFree(pMemory);
+}
+
+void operator delete[](void* pMemory, size_t) noexcept
+{
+	AuditedFree(pMemory);
+}
+
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept
+{
+	AuditedFree(pMemory);
+}
+
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept
+{
+	AuditedFree(pMemory);
+}
+#endif
@@ -0,0 +1,90 @@
+#ifndef ALLOCAUDIT_H
+#define ALLOCAUDIT_H
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Allocation audit, a debug build option (ZEDM_ALLOCATION_AUDIT in CMake):
+// the driver replaces the global operator new and delete and counts them on
+// the threads that are bound to a CAllocationCounter, the grab thread, the IMU
+// publisher and the rig fusion. Once tracking has settled their counts should
+// stay where they are; any growth between two "stats" requests is a heap call
+// on the hot path. Only the driver's own code is counted, the ZED SDK and
+// vrserver allocate from their own modules.
+#ifndef ZEDM_ALLOCATION_AUDIT
+#define ZEDM_ALLOCATION_AUDIT 0
+#endif
+
+constexpr bool AllocationAuditEnabled()
+{
+	return ZEDM_ALLOCATION_AUDIT != 0;
+}
+
+struct AllocationCounts_t
+{
+	uint64_t ulAllocations;
+	uint64_t ulFrees;
+	uint64_t ulBytes; // allocated, frees aren't sized
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: The counts of the threads bound to it, one at a time; written by
+// that thread only, read by anyone
+//-----------------------------------------------------------------------------
+class CAllocationCounter
+{
+public:
+	CAllocationCounter()
+		: m_ulAllocations(0)
+		, m_ulFrees(0)
+		, m_ulBytes(0)
+	{
+	}
+
+	void CountAllocation(size_t unBytes)
+	{
+		m_ulAllocations.store(m_ulAllocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		m_ulBytes.store(m_ulBytes.load(std::memory_order_relaxed) + unBytes, std::memory_order_relaxed);
+	}
+
+	void CountFree()
+	{
+		m_ulFrees.store(m_ulFrees.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	AllocationCounts_t GetCounts() const
+	{
+		AllocationCounts_t counts;
+		counts.ulAllocations = m_ulAllocations.load(std::memory_order_relaxed);
+		counts.ulFrees = m_ulFrees.load(std::memory_order_relaxed);
+		counts.ulBytes = m_ulBytes.load(std::memory_order_relaxed);
+		return counts;
+	}
+
+private:
+	std::atomic<uint64_t> m_ulAllocations;
+	std::atomic<uint64_t> m_ulFrees;
+	std::atomic<uint64_t> m_ulBytes;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Counts the calling thread's allocations into pCounter for its
+// lifetime. Nothing without the audit built in.
+//-----------------------------------------------------------------------------
+class CScopedAllocationAudit
+{
+public:
+	explicit CScopedAllocationAudit(CAllocationCounter* pCounter);
+	~CScopedAllocationAudit();
+
+private:
+	CScopedAllocationAudit(const CScopedAllocationAudit&) = delete;
+	CScopedAllocationAudit& operator=(const CScopedAllocationAudit&) = delete;
+
+	CAllocationCounter* m_pPrevious;
+};
+
+#endif // ALLOCAUDIT_H
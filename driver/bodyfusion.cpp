@@ -0,0 +1,314 @@
+#include "bodyfusion.h"
+#include "driverlog.h"
+#include "hmdmath.h"
+#include "zedtracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+using namespace vr;
+
+static const double k_flDegreesToRadians = 3.14159265358979323846 / 180.0;
+
+// like the body tracker's, the fused joints are as noisy as the detections
+static const double k_flFusedVelocitySmoothing = 0.1;
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void TransformPoint(const HmdQuaternion_t& qRotation, const double vecTranslation[3], const double vecIn[3], double vecOut[3])
+{
+	HmdQuaternion_RotateVector(qRotation, vecIn, vecOut);
+	for (int i = 0; i < 3; i++)
+		vecOut[i] += vecTranslation[i];
+}
+
+bool ParseBodyFusionNodes(const std::string& sBodyFusionNodes, std::vector<BodyFusionNode_t>* pvecNodes)
+{
+	pvecNodes->clear();
+	std::stringstream entries(sBodyFusionNodes);
+	std::string sEntry;
+	while (std::getline(entries, sEntry, ';'))
+	{
+		if (sEntry.find_first_not_of(" \t") == std::string::npos)
+			continue;
+
+		std::istringstream fields(sEntry);
+		BodyFusionNode_t node;
+		double flYaw, flPitch, flRoll;
+		if (!(fields >> node.unNode >> node.vecPosition[0] >> node.vecPosition[1] >> node.vecPosition[2] >> flYaw >> flPitch >> flRoll)
+			|| node.unNode < 1 || node.unNode > k_unMaxFusionNodes)
+			return false;
+		node.qRotation = HmdQuaternion_FromYawPitchRoll(flYaw * k_flDegreesToRadians, flPitch * k_flDegreesToRadians, flRoll * k_flDegreesToRadians);
+		pvecNodes->push_back(node);
+	}
+	return true;
+}
+
+CBodyFusion::CBodyFusion()
+	: m_pTracker(nullptr)
+	, m_bHaveHips(false)
+	, m_ulHipsTimestampNs(0)
+{
+	memset(m_rgNodes, 0, sizeof(m_rgNodes));
+	memset(m_vecHips, 0, sizeof(m_vecHips));
+	for (int i = 0; i < BodyJoint_Count; i++)
+	{
+		m_rgunObjectIds[i] = k_unTrackedDeviceIndexInvalid;
+		m_rgVelocity[i].SetSmoothingTimeConstant(k_flFusedVelocitySmoothing);
+	}
+}
+
+CBodyFusion::~CBodyFusion()
+{
+	Stop();
+}
+
+bool CBodyFusion::Start(CZedTracker* pTracker, uint16_t unPort, const std::vector<BodyFusionNode_t>& vecNodes)
+{
+	Stop();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pTracker = pTracker;
+		memset(m_rgNodes, 0, sizeof(m_rgNodes));
+		for (Node_t& node : m_rgNodes)
+			node.qRotation = HmdQuaternion_Identity();
+		m_rgNodes[0].bPlaced = true;
+		for (const BodyFusionNode_t& placement : vecNodes)
+		{
+			Node_t& node = m_rgNodes[placement.unNode];
+			node.bPlaced = true;
+			for (int i = 0; i < 3; i++)
+				node.vecPosition[i] = placement.vecPosition[i];
+			node.qRotation = placement.qRotation;
+		}
+		m_bHaveHips = false;
+		for (int i = 0; i < BodyJoint_Count; i++)
+			m_rgVelocity[i].Reset();
+	}
+
+	if (!m_receiver.Start(unPort, this))
+		return false;
+	DriverLog("Body fusion: %u node(s) placed\n", (unsigned)vecNodes.size());
+	return true;
+}
+
+void CBodyFusion::Stop()
+{
+	m_receiver.Stop();
+}
+
+void CBodyFusion::ReadPose(EBodyJoint eJoint, DriverPose_t* pPose) const
+{
+	BodyPoses_t poses;
+	if (m_poses.Read(&poses) == 0)
+	{
+		*pPose = DriverPose_Uninitialized();
+		return;
+	}
+	*pPose = poses.rgPoses[eJoint];
+}
+
+void CBodyFusion::OnBodySkeleton(const ZedBodySkeleton_t* pSkeleton, const DriverPose_t& /*poseTemplate*/, double flTimeOffset)
+{
+	// the skeleton's age puts it on the steady clock; a replay's count as taken now
+	uint64_t ulTimestampNs = (uint64_t)((int64_t)GetSteadyNanoseconds() + (int64_t)llround(flTimeOffset * 1e9));
+
+	double vecCamera[3] = { 0.0, 0.0, 0.0 };
+	DriverPose_t cameraPose;
+	if (m_pTracker && m_pTracker->ReadPose(&cameraPose) != 0 && cameraPose.poseIsValid)
+	{
+		for (int i = 0; i < 3; i++)
+			vecCamera[i] = cameraPose.vecPosition[i];
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	StoreSkeleton(m_rgNodes[0], pSkeleton, ulTimestampNs, vecCamera);
+	Fuse();
+}
+
+void CBodyFusion::OnRemoteSkeleton(uint32_t unNode, const ZedBodySkeleton_t* pSkeleton, const double vecCamera[3])
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Node_t& node = m_rgNodes[unNode];
+	if (!node.bPlaced)
+	{
+		if (!node.bWarned)
+			DriverLog("Body fusion: node %u isn't in bodyFusionNodes, its skeletons are ignored\n", unNode);
+		node.bWarned = true;
+		return;
+	}
+
+	StoreSkeleton(node, pSkeleton, pSkeleton ? pSkeleton->ulTimestampNs : 0, vecCamera);
+	Fuse();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Keeps only the published joints, moved into the fusing camera's
+// driver space, and their velocities from the node's skeleton before, for
+// carrying them forward to a newer one's time.
+//-----------------------------------------------------------------------------
+void CBodyFusion::StoreSkeleton(Node_t& node, const ZedBodySkeleton_t* pSkeleton, uint64_t ulTimestampNs, const double vecCamera[3])
+{
+	if (!pSkeleton)
+	{
+		node.bHaveSkeleton = false;
+		return;
+	}
+
+	bool bContinues = node.bHaveSkeleton && node.nBodyId == pSkeleton->nBodyId && ulTimestampNs > node.ulTimestampNs
+		&& ulTimestampNs - node.ulTimestampNs <= k_ulMaxSkewNs;
+	double flElapsed = bContinues ? (ulTimestampNs - node.ulTimestampNs) * 1e-9 : 0.0;
+
+	TransformPoint(node.qRotation, node.vecPosition, vecCamera, node.vecCamera);
+	for (int i = 0; i < BodyJoint_Count; i++)
+	{
+		int nKeypoint = GetBodyJointKeypoint((EBodyJoint)i);
+		if (!pSkeleton->rgbValid[nKeypoint])
+		{
+			node.rgbValid[i] = false;
+			continue;
+		}
+
+		double vecPosition[3];
+		TransformPoint(node.qRotation, node.vecPosition, pSkeleton->rgvecPosition[nKeypoint], vecPosition);
+		for (int j = 0; j < 3; j++)
+		{
+			node.rgvecVelocity[i][j] = bContinues && node.rgbValid[i] ? (vecPosition[j] - node.rgvecPosition[i][j]) / flElapsed : 0.0;
+			node.rgvecPosition[i][j] = vecPosition[j];
+		}
+		node.rgqRotation[i] = HmdQuaternion_Normalize(HmdQuaternion_Multiply(node.qRotation, pSkeleton->rgqRotation[nKeypoint]));
+		node.rgbValid[i] = true;
+	}
+	node.nBodyId = pSkeleton->nBodyId;
+	node.ulTimestampNs = ulTimestampNs;
+	node.bHaveSkeleton = true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: All joints of the nodes' latest skeletons at the newest one's
+// time, published in one burst like the body tracker's
+//-----------------------------------------------------------------------------
+void CBodyFusion::Fuse()
+{
+	DriverPose_t poseTemplate;
+	m_pTracker->GetPoseTemplate(&poseTemplate);
+
+	uint64_t ulNewestNs = 0;
+	for (const Node_t& node : m_rgNodes)
+	{
+		if (node.bHaveSkeleton && node.ulTimestampNs > ulNewestNs)
+			ulNewestNs = node.ulTimestampNs;
+	}
+	if (m_bHaveHips && (ulNewestNs == 0 || ulNewestNs - m_ulHipsTimestampNs > k_ulReacquireNs))
+		m_bHaveHips = false;
+
+	// which nodes take part: recent enough, and following the fused body
+	bool rgbUsed[k_unMaxFusionNodes + 1];
+	for (uint32_t n = 0; n <= k_unMaxFusionNodes; n++)
+	{
+		const Node_t& node = m_rgNodes[n];
+		rgbUsed[n] = node.bHaveSkeleton && ulNewestNs - node.ulTimestampNs <= k_ulMaxSkewNs;
+		if (!rgbUsed[n] || !m_bHaveHips || !node.rgbValid[BodyJoint_Hips])
+			continue;
+
+		double flAge = (ulNewestNs - node.ulTimestampNs) * 1e-9;
+		double flDistanceSquared = 0.0;
+		for (int j = 0; j < 3; j++)
+		{
+			double flDelta = node.rgvecPosition[BodyJoint_Hips][j] + node.rgvecVelocity[BodyJoint_Hips][j] * flAge - m_vecHips[j];
+			flDistanceSquared += flDelta * flDelta;
+		}
+		rgbUsed[n] = flDistanceSquared <= k_flMaxHipsDistance * k_flMaxHipsDistance;
+	}
+
+	double flTimeOffset = ulNewestNs != 0 ? ((int64_t)ulNewestNs - (int64_t)GetSteadyNanoseconds()) * 1e-9 : 0.0;
+	BodyPoses_t poses;
+	for (int i = 0; i < BodyJoint_Count; i++)
+	{
+		double flWeightSum = 0.0;
+		double vecPosition[3] = { 0.0, 0.0, 0.0 };
+		HmdQuaternion_t qSum = { 0.0, 0.0, 0.0, 0.0 };
+		HmdQuaternion_t qReference = HmdQuaternion_Identity();
+		for (uint32_t n = 0; n <= k_unMaxFusionNodes; n++)
+		{
+			const Node_t& node = m_rgNodes[n];
+			if (!rgbUsed[n] || !node.rgbValid[i])
+				continue;
+
+			double flAgeNs = (double)(ulNewestNs - node.ulTimestampNs);
+			double vecJoint[3];
+			double flDistanceSquared = 0.0;
+			for (int j = 0; j < 3; j++)
+			{
+				vecJoint[j] = node.rgvecPosition[i][j] + node.rgvecVelocity[i][j] * flAgeNs * 1e-9;
+				flDistanceSquared += (vecJoint[j] - node.vecCamera[j]) * (vecJoint[j] - node.vecCamera[j]);
+			}
+			// a skeleton k_ulMaxSkewNs old counts half as much as a current one
+			double flWeight = (1.0 - 0.5 * flAgeNs / k_ulMaxSkewNs) / std::max(flDistanceSquared, k_flMinWeightDistance * k_flMinWeightDistance);
+
+			// q and -q are the same rotation; summed they would cancel
+			HmdQuaternion_t q = node.rgqRotation[i];
+			if (flWeightSum == 0.0)
+				qReference = q;
+			double flSign = HmdQuaternion_Dot(q, qReference) < 0.0 ? -1.0 : 1.0;
+			qSum.w += q.w * flSign * flWeight;
+			qSum.x += q.x * flSign * flWeight;
+			qSum.y += q.y * flSign * flWeight;
+			qSum.z += q.z * flSign * flWeight;
+			for (int j = 0; j < 3; j++)
+				vecPosition[j] += vecJoint[j] * flWeight;
+			flWeightSum += flWeight;
+		}
+
+		DriverPose_t& pose = poses.rgPoses[i];
+		pose = poseTemplate;
+		if (flWeightSum == 0.0)
+		{
+			m_rgVelocity[i].Reset();
+			pose.poseIsValid = false;
+			pose.result = TrackingResult_Running_OutOfRange;
+			continue;
+		}
+
+		for (int j = 0; j < 3; j++)
+			vecPosition[j] /= flWeightSum;
+		HmdQuaternion_t qRotation = HmdQuaternion_Normalize(qSum);
+		m_rgVelocity[i].AddSample(vecPosition, qRotation, ulNewestNs);
+		for (int j = 0; j < 3; j++)
+		{
+			pose.vecPosition[j] = vecPosition[j];
+			pose.vecVelocity[j] = m_rgVelocity[i].GetVelocity()[j];
+			pose.vecAngularVelocity[j] = m_rgVelocity[i].GetAngularVelocity()[j];
+		}
+		pose.qRotation = qRotation;
+		pose.poseTimeOffset = flTimeOffset;
+	}
+
+	if (poses.rgPoses[BodyJoint_Hips].poseIsValid)
+	{
+		for (int j = 0; j < 3; j++)
+			m_vecHips[j] = poses.rgPoses[BodyJoint_Hips].vecPosition[j];
+		m_ulHipsTimestampNs = ulNewestNs;
+		m_bHaveHips = true;
+	}
+
+	m_poses.Write(poses);
+	Submit(poses);
+}
+
+void CBodyFusion::Submit(const BodyPoses_t& poses)
+{
+	for (int i = 0; i < BodyJoint_Count; i++)
+	{
+		TrackedDeviceIndex_t unObjectId = m_rgunObjectIds[i].load();
+		if (unObjectId != k_unTrackedDeviceIndexInvalid)
+			VRServerDriverHost()->TrackedDevicePoseUpdated(unObjectId, poses.rgPoses[i], sizeof(DriverPose_t));
+	}
+}
@@ -0,0 +1,133 @@
+#ifndef BODYFUSION_H
+#define BODYFUSION_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bodytracker.h"
+#include "poseestimator.h"
+#include "posestream.h"
+#include "seqlock.h"
+
+class CZedTracker;
+
+//-----------------------------------------------------------------------------
+// Purpose: Where one body fusion node's world sits, from bodyFusionNodes
+//-----------------------------------------------------------------------------
+struct BodyFusionNode_t
+{
+	uint32_t unNode;
+	double vecPosition[3]; // the node's driver origin in the fusing camera's driver space, meters
+	vr::HmdQuaternion_t qRotation;
+};
+
+// parses bodyFusionNodes, "node x y z yaw pitch roll" per node (meters,
+// degrees) separated by ';'; false on a malformed entry or node id
+extern bool ParseBodyFusionNodes(const std::string& sBodyFusionNodes, std::vector<BodyFusionNode_t>* pvecNodes);
+
+//-----------------------------------------------------------------------------
+// Purpose: One set of body trackers from the skeletons of several ZEDs: the
+// fusing camera's own body tracker, if it runs one, and nodes on other
+// machines sending with zedm_posesender --body, so the detection runs there
+// and the render PC only fuses.
+//
+// Every skeleton is moved into the fusing camera's driver space as it
+// arrives, remote ones through their node's bodyFusionNodes placement, with
+// its timestamp already on the local steady clock (CSkeletonStreamReceiver).
+// Each arrival fuses the latest skeleton of every node at the newest time
+// among them: older ones are carried forward by their joints' velocities,
+// and those more than k_ulMaxSkewNs behind aren't used. A joint is the
+// weighted mean of the nodes that see it; the weight falls with the square
+// of its distance from the node's camera, where depth is noisier, and with
+// the skeleton's age. A joint hidden from one camera comes from the others,
+// and only when no node sees it is the tracker out of range.
+//
+// Nodes follow whichever body they found first. Only nodes whose hips are
+// within k_flMaxHipsDistance of the fused hips take part, so a node that
+// follows another person doesn't pull the trackers over; after a second
+// without fused hips any node's body is taken.
+//
+// Fusion runs on the thread the skeleton came in on, the body tracker's
+// publisher or the receive thread, under one mutex; it is a few dozen
+// multiply-adds per joint.
+//-----------------------------------------------------------------------------
+class CBodyFusion : public IBodyJointSource, public IBodySkeletonListener, public ISkeletonStreamListener
+{
+public:
+	CBodyFusion();
+	~CBodyFusion();
+
+	/** Listens on unPort for the nodes in vecNodes; pTracker, the fusing camera's, must outlive Stop */
+	bool Start(CZedTracker* pTracker, uint16_t unPort, const std::vector<BodyFusionNode_t>& vecNodes);
+
+	/** Joins the receive thread. The camera's body tracker must not call in any more. */
+	void Stop();
+
+	bool IsRunning() const { return m_receiver.IsRunning(); }
+
+	virtual void SetObjectId(EBodyJoint eJoint, vr::TrackedDeviceIndex_t unObjectId) override { m_rgunObjectIds[eJoint].store(unObjectId); }
+	virtual void ReadPose(EBodyJoint eJoint, vr::DriverPose_t* pPose) const override;
+
+	/** The fusing camera's own skeletons, node 0 */
+	virtual void OnBodySkeleton(const ZedBodySkeleton_t* pSkeleton, const vr::DriverPose_t& poseTemplate, double flTimeOffset) override;
+
+	virtual void OnRemoteSkeleton(uint32_t unNode, const ZedBodySkeleton_t* pSkeleton, const double vecCamera[3]) override;
+
+private:
+	CBodyFusion(const CBodyFusion&) = delete;
+	CBodyFusion& operator=(const CBodyFusion&) = delete;
+
+	// detections come at 15-30 Hz; a skeleton further behind the newest isn't carried forward
+	static const uint64_t k_ulMaxSkewNs = 100000000ull;
+	static const uint64_t k_ulReacquireNs = 1000000000ull;
+	static constexpr double k_flMaxHipsDistance = 0.5;
+	static constexpr double k_flMinWeightDistance = 0.5; // closer than this all weigh the same
+
+	struct BodyPoses_t
+	{
+		vr::DriverPose_t rgPoses[BodyJoint_Count];
+	};
+
+	// the latest skeleton of a node, its joints in the fusing camera's driver space
+	struct Node_t
+	{
+		bool bPlaced; // in bodyFusionNodes; node 0 always is
+		bool bWarned; // about skeletons from a node that isn't
+		double vecPosition[3];
+		vr::HmdQuaternion_t qRotation;
+		bool bHaveSkeleton;
+		int nBodyId;
+		uint64_t ulTimestampNs; // local steady clock
+		double vecCamera[3];
+		bool rgbValid[BodyJoint_Count];
+		double rgvecPosition[BodyJoint_Count][3];
+		vr::HmdQuaternion_t rgqRotation[BodyJoint_Count];
+		double rgvecVelocity[BodyJoint_Count][3]; // from the skeleton before, zero after a gap
+	};
+
+	void StoreSkeleton(Node_t& node, const ZedBodySkeleton_t* pSkeleton, uint64_t ulTimestampNs, const double vecCamera[3]);
+	void Fuse();
+	void Submit(const BodyPoses_t& poses);
+
+	CZedTracker* m_pTracker;
+	CSkeletonStreamReceiver m_receiver;
+
+	std::mutex m_mutex; // everything up to m_rgVelocity
+	Node_t m_rgNodes[k_unMaxFusionNodes + 1]; // by node id, 0 is the fusing camera
+	bool m_bHaveHips;
+	double m_vecHips[3];
+	uint64_t m_ulHipsTimestampNs;
+	CPoseVelocityEstimator m_rgVelocity[BodyJoint_Count];
+
+	std::atomic<vr::TrackedDeviceIndex_t> m_rgunObjectIds[BodyJoint_Count];
+	CSeqLock<BodyPoses_t> m_poses;
+};
+
+#endif // BODYFUSION_H
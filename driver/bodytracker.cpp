@@ -0,0 +1,405 @@
+#include "bodytracker.h"
+#include "driverlog.h"
+#include "hmdmath.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <chrono>
+
+using namespace vr;
+using namespace sl;
+
+// parent of every POSE_34 joint, -1 for the root; parents come before their children
+static const int k_rgnPose34Parents[k_nBodySkeletonJoints] = {
+	-1, 0, 1, 2,                        // pelvis, naval spine, chest spine, neck
+	2, 4, 5, 6, 7, 8, 7,                // left clavicle, shoulder, elbow, wrist, hand, handtip, thumb
+	2, 11, 12, 13, 14, 15, 14,          // right clavicle, shoulder, elbow, wrist, hand, handtip, thumb
+	0, 18, 19, 20,                      // left hip, knee, ankle, foot
+	0, 22, 23, 24,                      // right hip, knee, ankle, foot
+	3, 26, 26, 26, 26, 26,              // head, nose, left eye, left ear, right eye, right ear
+	20, 24                              // left heel, right heel
+};
+
+// trackers sit on the ankles rather than the toes
+static const BODY_PARTS_POSE_34 k_rgeJointParts[BodyJoint_Count] = {
+	BODY_PARTS_POSE_34::PELVIS,
+	BODY_PARTS_POSE_34::LEFT_ANKLE,
+	BODY_PARTS_POSE_34::RIGHT_ANKLE,
+	BODY_PARTS_POSE_34::LEFT_ELBOW,
+	BODY_PARTS_POSE_34::RIGHT_ELBOW,
+};
+
+static const char* const k_rgpchJointNames[BodyJoint_Count] = { "hips", "left_foot", "right_foot", "left_elbow", "right_elbow" };
+
+// detections are 15-30 Hz and noisier than the head pose
+static const double k_flBodyVelocitySmoothing = 0.1;
+
+const char* GetBodyJointName(EBodyJoint eJoint)
+{
+	return eJoint >= 0 && eJoint < BodyJoint_Count ? k_rgpchJointNames[eJoint] : "unknown";
+}
+
+int GetBodyJointKeypoint(EBodyJoint eJoint)
+{
+	return (int)k_rgeJointParts[eJoint];
+}
+
+CZedBodyTracker::CZedBodyTracker()
+	: m_pZed(nullptr)
+	, m_bReplay(false)
+	, m_ulLastDetectionNs(0)
+	, m_nBodyId(-1)
+	, m_pPublisher(nullptr)
+	, m_bSkeletonPending(false)
+	, m_bBodyLost(false)
+	, m_bStopPublisher(false)
+	, m_bPoseFilterChanged(false)
+	, m_bPoseFilterEnabled(false)
+	, m_bSubmitFilterChanged(false)
+	, m_bDedup(false)
+	, m_flDedupPosition(0.0)
+	, m_flDedupRotation(0.0)
+	, m_flDedupKeepAlive(0.0)
+	, m_nPublishedBodyId(-1)
+{
+	memset(&m_pendingSkeleton, 0, sizeof(m_pendingSkeleton));
+	memset(&m_poseFilterParams, 0, sizeof(m_poseFilterParams));
+	memset(&m_poseTemplate, 0, sizeof(m_poseTemplate));
+	for (int i = 0; i < BodyJoint_Count; i++)
+	{
+		m_rgunObjectIds[i] = k_unTrackedDeviceIndexInvalid;
+		m_rgVelocity[i].SetSmoothingTimeConstant(k_flBodyVelocitySmoothing);
+	}
+	for (int i = 0; i < k_nBodySkeletonListeners; i++)
+		m_rgpListeners[i] = nullptr;
+}
+
+CZedBodyTracker::~CZedBodyTracker()
+{
+	if (m_pPublisher)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_publisherMutex);
+			m_bStopPublisher = true;
+		}
+		m_publisherWake.notify_one();
+		m_pPublisher->join();
+		delete m_pPublisher;
+	}
+}
+
+bool CZedBodyTracker::Enable(Camera& zed, float flConfidenceThreshold, bool bReplay)
+{
+	Disable(zed);
+
+	ObjectDetectionParameters params;
+	params.detection_model = DETECTION_MODEL::HUMAN_BODY_FAST;
+	params.body_format = BODY_FORMAT::POSE_34;
+	params.enable_body_fitting = true; // the local joint rotations
+	params.enable_tracking = true;     // stable ids, so the trackers stay on one person
+	params.image_sync = false;         // inference on the SDK's thread, grab() doesn't wait for it
+
+	ERROR_CODE eError = zed.enableObjectDetection(params);
+	if (eError != ERROR_CODE::SUCCESS)
+	{
+		DriverLog("Unable to enable body tracking: %s\n", toString(eError).c_str());
+		return false;
+	}
+
+	m_runtimeParams = ObjectDetectionRuntimeParameters();
+	m_runtimeParams.detection_confidence_threshold = flConfidenceThreshold;
+	m_pZed = &zed;
+	m_bReplay = bReplay;
+	m_ulLastDetectionNs = 0;
+	m_nBodyId = -1;
+	m_bSkeletonPending = false;
+	m_bBodyLost = false;
+	m_bStopPublisher = false;
+	m_pPublisher = new std::thread(&CZedBodyTracker::RunPublisher, this);
+	return true;
+}
+
+void CZedBodyTracker::Disable(Camera& zed)
+{
+	if (!m_pPublisher)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_publisherMutex);
+		m_bStopPublisher = true;
+	}
+	m_publisherWake.notify_one();
+	m_pPublisher->join();
+	delete m_pPublisher;
+	m_pPublisher = nullptr;
+
+	zed.disableObjectDetection();
+	m_pZed = nullptr;
+
+	DriverPose_t poseTemplate;
+	{
+		std::lock_guard<std::mutex> lock(m_publisherMutex);
+		poseTemplate = m_poseTemplate;
+	}
+	PublishTrackingLost(poseTemplate);
+}
+
+void CZedBodyTracker::SetPoseTemplate(const DriverPose_t& poseTemplate)
+{
+	std::lock_guard<std::mutex> lock(m_publisherMutex);
+	m_poseTemplate = poseTemplate;
+
+	// joints are tracked in driver space directly; the head offset is the camera's
+	m_poseTemplate.qDriverFromHeadRotation = HmdQuaternion_Identity();
+	for (int i = 0; i < 3; i++)
+		m_poseTemplate.vecDriverFromHeadTranslation[i] = 0.0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Positions and global rotations of every joint. Missing keypoints
+// are NaN; the rotation chain is still composed through them.
+//-----------------------------------------------------------------------------
+bool CZedBodyTracker::FillSkeleton(const ObjectData& body, uint64_t ulTimestampNs, ZedBodySkeleton_t* pSkeleton) const
+{
+	if (body.keypoint.size() != (size_t)k_nBodySkeletonJoints || body.local_orientation_per_joint.size() != (size_t)k_nBodySkeletonJoints)
+		return false;
+
+	pSkeleton->ulTimestampNs = ulTimestampNs;
+	pSkeleton->nBodyId = body.id;
+	for (int i = 0; i < k_nBodySkeletonJoints; i++)
+	{
+		const float3& keypoint = body.keypoint[i];
+		pSkeleton->rgbValid[i] = std::isfinite(keypoint.x) && std::isfinite(keypoint.y) && std::isfinite(keypoint.z);
+		pSkeleton->rgvecPosition[i][0] = keypoint.x;
+		pSkeleton->rgvecPosition[i][1] = keypoint.y;
+		pSkeleton->rgvecPosition[i][2] = keypoint.z;
+
+		const float4& local = i == 0 ? body.global_root_orientation : body.local_orientation_per_joint[i];
+		HmdQuaternion_t qLocal = HmdQuaternion_Init(local.w, local.x, local.y, local.z);
+		if (!std::isfinite(qLocal.w) || !std::isfinite(qLocal.x) || !std::isfinite(qLocal.y) || !std::isfinite(qLocal.z))
+			qLocal = HmdQuaternion_Identity();
+
+		int nParent = k_rgnPose34Parents[i];
+		pSkeleton->rgqRotation[i] = HmdQuaternion_Normalize(nParent < 0 ? qLocal : HmdQuaternion_Multiply(pSkeleton->rgqRotation[nParent], qLocal));
+	}
+	return pSkeleton->rgbValid[(int)BODY_PARTS_POSE_34::PELVIS];
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: retrieveObjects returns the newest finished detection without
+// waiting for inference; most grabs find nothing new and return here.
+//-----------------------------------------------------------------------------
+void CZedBodyTracker::Update(Camera& zed)
+{
+	if (!m_pPublisher)
+		return;
+
+	if (zed.retrieveObjects(m_objects, m_runtimeParams) != ERROR_CODE::SUCCESS || !m_objects.is_new)
+		return;
+	uint64_t ulTimestampNs = m_objects.timestamp.getNanoseconds();
+	if (ulTimestampNs == m_ulLastDetectionNs)
+		return;
+	m_ulLastDetectionNs = ulTimestampNs;
+
+	// stay with the body followed so far while it is tracked, else take the most confident
+	const ObjectData* pBody = nullptr;
+	for (const ObjectData& object : m_objects.object_list)
+	{
+		if (object.tracking_state != OBJECT_TRACKING_STATE::OK)
+			continue;
+		if (object.id == m_nBodyId)
+		{
+			pBody = &object;
+			break;
+		}
+		if (!pBody || object.confidence > pBody->confidence)
+			pBody = &object;
+	}
+
+	ZedBodySkeleton_t skeleton;
+	bool bFound = pBody && FillSkeleton(*pBody, ulTimestampNs, &skeleton);
+	if (!bFound && m_nBodyId < 0)
+		return;
+	m_nBodyId = bFound ? pBody->id : -1;
+
+	if (bFound)
+		m_skeleton.Write(skeleton);
+	{
+		std::lock_guard<std::mutex> lock(m_publisherMutex);
+		if (bFound)
+		{
+			m_pendingSkeleton = skeleton;
+			m_bSkeletonPending = true;
+		}
+		else
+		{
+			m_bBodyLost = true;
+		}
+	}
+	m_publisherWake.notify_one();
+}
+
+void CZedBodyTracker::RunPublisher()
+{
+	while (true)
+	{
+		ZedBodySkeleton_t skeleton;
+		bool bSkeleton, bLost;
+		DriverPose_t poseTemplate;
+		{
+			std::unique_lock<std::mutex> lock(m_publisherMutex);
+			m_publisherWake.wait(lock, [this] { return m_bStopPublisher || m_bSkeletonPending || m_bBodyLost; });
+			if (m_bStopPublisher)
+				return;
+
+			bSkeleton = m_bSkeletonPending;
+			bLost = m_bBodyLost;
+			if (bSkeleton)
+				skeleton = m_pendingSkeleton;
+			m_bSkeletonPending = false;
+			m_bBodyLost = false;
+			poseTemplate = m_poseTemplate;
+			if (m_bPoseFilterChanged)
+			{
+				m_poseFilter.Configure(m_bPoseFilterEnabled, m_poseFilterParams);
+				m_bPoseFilterChanged = false;
+			}
+			if (m_bSubmitFilterChanged)
+			{
+				for (int i = 0; i < BodyJoint_Count; i++)
+					m_rgSubmitFilters[i].Configure(m_bDedup, m_flDedupPosition, m_flDedupRotation, m_flDedupKeepAlive);
+				m_bSubmitFilterChanged = false;
+			}
+		}
+
+		// a skeleton that arrived after the loss supersedes it
+		if (bSkeleton)
+			PublishPoses(skeleton, poseTemplate);
+		else if (bLost)
+			PublishTrackingLost(poseTemplate);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Every joint's pose is built before the first one is submitted,
+// then all are submitted in one burst with the same time offset.
+//-----------------------------------------------------------------------------
+void CZedBodyTracker::PublishPoses(const ZedBodySkeleton_t& skeleton, const DriverPose_t& poseTemplate)
+{
+	if (skeleton.nBodyId != m_nPublishedBodyId)
+	{
+		// velocities across two people would be nonsense
+		for (int i = 0; i < BodyJoint_Count; i++)
+			m_rgVelocity[i].Reset();
+		m_nPublishedBodyId = skeleton.nBodyId;
+	}
+
+	double flTimeOffset = 0.0;
+	if (!m_bReplay && m_pZed)
+	{
+		uint64_t ulNowNs = m_pZed->getTimestamp(TIME_REFERENCE::CURRENT).getNanoseconds();
+		if (ulNowNs != 0)
+			flTimeOffset = ((int64_t)skeleton.ulTimestampNs - (int64_t)ulNowNs) * 1e-9;
+	}
+
+	BodyPoses_t poses;
+	for (int i = 0; i < BodyJoint_Count; i++)
+	{
+		int nPart = (int)k_rgeJointParts[i];
+		DriverPose_t& pose = poses.rgPoses[i];
+		pose = poseTemplate;
+		if (!skeleton.rgbValid[nPart])
+		{
+			m_rgVelocity[i].Reset();
+			pose.poseIsValid = false;
+			pose.result = TrackingResult_Running_OutOfRange;
+			continue;
+		}
+
+		m_rgVelocity[i].AddSample(skeleton.rgvecPosition[nPart], skeleton.rgqRotation[nPart], skeleton.ulTimestampNs);
+		for (int j = 0; j < 3; j++)
+		{
+			pose.vecPosition[j] = skeleton.rgvecPosition[nPart][j];
+			pose.vecVelocity[j] = m_rgVelocity[i].GetVelocity()[j];
+			pose.vecAngularVelocity[j] = m_rgVelocity[i].GetAngularVelocity()[j];
+		}
+		pose.qRotation = skeleton.rgqRotation[nPart];
+		pose.poseTimeOffset = flTimeOffset;
+	}
+
+	static_assert(BodyJoint_Count <= CPoseFilterBank::k_unMaxPoses, "one filter bank holds every joint");
+	m_poseFilter.Filter(poses.rgPoses, BodyJoint_Count, skeleton.ulTimestampNs);
+
+	m_poses.Write(poses);
+	SubmitPoses(poses, skeleton.ulTimestampNs);
+	NotifyListeners(&skeleton, poseTemplate, flTimeOffset);
+}
+
+void CZedBodyTracker::PublishTrackingLost(const DriverPose_t& poseTemplate)
+{
+	BodyPoses_t poses;
+	for (int i = 0; i < BodyJoint_Count; i++)
+	{
+		m_rgVelocity[i].Reset();
+		poses.rgPoses[i] = poseTemplate;
+		poses.rgPoses[i].poseIsValid = false;
+		poses.rgPoses[i].result = TrackingResult_Running_OutOfRange;
+	}
+	m_nPublishedBodyId = -1;
+	m_poseFilter.Reset();
+
+	m_poses.Write(poses);
+	SubmitPoses(poses, 0);
+	NotifyListeners(nullptr, poseTemplate, 0.0);
+}
+
+void CZedBodyTracker::SetPoseFilter(bool bEnabled, const OneEuroParams_t& params)
+{
+	std::lock_guard<std::mutex> lock(m_publisherMutex);
+	m_bPoseFilterEnabled = bEnabled;
+	m_poseFilterParams = params;
+	m_bPoseFilterChanged = true;
+}
+
+void CZedBodyTracker::SetSubmitFilter(bool bEnabled, double flPositionThreshold, double flRotationThresholdDegrees, double flKeepAliveSeconds)
+{
+	std::lock_guard<std::mutex> lock(m_publisherMutex);
+	m_bDedup = bEnabled;
+	m_flDedupPosition = flPositionThreshold;
+	m_flDedupRotation = flRotationThresholdDegrees;
+	m_flDedupKeepAlive = flKeepAliveSeconds;
+	m_bSubmitFilterChanged = true;
+}
+
+void CZedBodyTracker::SubmitPoses(const BodyPoses_t& poses, uint64_t ulSampleTimestampNs)
+{
+	uint64_t ulNowNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	for (int i = 0; i < BodyJoint_Count; i++)
+	{
+		TrackedDeviceIndex_t unObjectId = m_rgunObjectIds[i].load();
+		if (unObjectId != k_unTrackedDeviceIndexInvalid && m_rgSubmitFilters[i].ShouldSubmit(poses.rgPoses[i], ulSampleTimestampNs, ulNowNs))
+			VRServerDriverHost()->TrackedDevicePoseUpdated(unObjectId, poses.rgPoses[i], sizeof(DriverPose_t));
+	}
+}
+
+void CZedBodyTracker::NotifyListeners(const ZedBodySkeleton_t* pSkeleton, const DriverPose_t& poseTemplate, double flTimeOffset)
+{
+	for (int i = 0; i < k_nBodySkeletonListeners; i++)
+	{
+		IBodySkeletonListener* pListener = m_rgpListeners[i].load();
+		if (pListener)
+			pListener->OnBodySkeleton(pSkeleton, poseTemplate, flTimeOffset);
+	}
+}
+
+void CZedBodyTracker::ReadPose(EBodyJoint eJoint, DriverPose_t* pPose) const
+{
+	BodyPoses_t poses;
+	if (m_poses.Read(&poses) == 0)
+	{
+		*pPose = DriverPose_Uninitialized();
+		return;
+	}
+	*pPose = poses.rgPoses[eJoint];
+}
@@ -0,0 +1,185 @@
+#ifndef BODYTRACKER_H
+#define BODYTRACKER_H
+
+#pragma once
+
+#include <openvr_driver.h>
+#include <sl/Camera.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "posededup.h"
+#include "posefilter.h"
+#include "poseestimator.h"
+#include "seqlock.h"
+
+// joints of the ZED's BODY_FORMAT::POSE_34 skeleton
+static const int k_nBodySkeletonJoints = 34;
+
+//-----------------------------------------------------------------------------
+// Purpose: The joints published as virtual trackers
+//-----------------------------------------------------------------------------
+enum EBodyJoint
+{
+	BodyJoint_Hips,
+	BodyJoint_LeftFoot,
+	BodyJoint_RightFoot,
+	BodyJoint_LeftElbow,
+	BodyJoint_RightElbow,
+	BodyJoint_Count
+};
+
+/** Short lower-case name, used in serial numbers */
+extern const char* GetBodyJointName(EBodyJoint eJoint);
+
+/** The POSE_34 keypoint the joint's tracker follows */
+extern int GetBodyJointKeypoint(EBodyJoint eJoint);
+
+//-----------------------------------------------------------------------------
+// Purpose: One body from one detection, every POSE_34 joint in ZED world
+// (driver) space. Rotations are global, composed from the SDK's local ones.
+//-----------------------------------------------------------------------------
+struct ZedBodySkeleton_t
+{
+	uint64_t ulTimestampNs; // ZED clock, the image the detection ran on
+	int nBodyId;
+	bool rgbValid[k_nBodySkeletonJoints];
+	double rgvecPosition[k_nBodySkeletonJoints][3];
+	vr::HmdQuaternion_t rgqRotation[k_nBodySkeletonJoints];
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Receives every skeleton on the publisher thread, after the joint
+// trackers were submitted. pSkeleton is null when the body was lost.
+//-----------------------------------------------------------------------------
+class IBodySkeletonListener
+{
+public:
+	virtual void OnBodySkeleton(const ZedBodySkeleton_t* pSkeleton, const vr::DriverPose_t& poseTemplate, double flTimeOffset) = 0;
+
+protected:
+	virtual ~IBodySkeletonListener() {}
+};
+
+// listener slots, one per hand and one for body fusion
+static const int k_nBodySkeletonListeners = 3;
+static const int k_nBodyFusionListenerSlot = 2;
+
+//-----------------------------------------------------------------------------
+// Purpose: Where the body tracker devices get their poses: a camera's own
+// CZedBodyTracker, or CBodyFusion
+//-----------------------------------------------------------------------------
+class IBodyJointSource
+{
+public:
+	virtual void SetObjectId(EBodyJoint eJoint, vr::TrackedDeviceIndex_t unObjectId) = 0;
+
+	/** Any thread: the joint's latest pose, invalid before the first detection */
+	virtual void ReadPose(EBodyJoint eJoint, vr::DriverPose_t* pPose) const = 0;
+
+protected:
+	virtual ~IBodyJointSource() {}
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: ZED body tracking published as BodyJoint_Count virtual trackers.
+//
+// Detection runs asynchronously inside the SDK (image_sync off), at whatever
+// rate the GPU allows, without slowing grab(). The grab thread only collects
+// a finished detection and hands the skeleton over. A publisher thread then
+// builds every joint's pose from that one skeleton and submits them back to
+// back, so all trackers of a detection share a timestamp and the host calls
+// come in one burst per detection instead of trickling in per joint.
+//-----------------------------------------------------------------------------
+class CZedBodyTracker : public IBodyJointSource
+{
+public:
+	CZedBodyTracker();
+	~CZedBodyTracker();
+
+	/** Grab thread: starts detection on the camera that was just opened.
+	* Keypoints are in world space only if grab() measures in REFERENCE_FRAME::WORLD. */
+	bool Enable(sl::Camera& zed, float flConfidenceThreshold, bool bReplay);
+
+	/** Grab thread: stops detection and the publisher, trackers report out of range */
+	void Disable(sl::Camera& zed);
+
+	bool IsEnabled() const { return m_pPublisher != nullptr; }
+
+	/** Grab thread, after each grab: hands a new detection to the publisher */
+	void Update(sl::Camera& zed);
+
+	/** Grab thread: the world-from-driver transform the poses are published with */
+	void SetPoseTemplate(const vr::DriverPose_t& poseTemplate);
+
+	/** Any thread: bodyFilter smoothing of the joint poses */
+	void SetPoseFilter(bool bEnabled, const OneEuroParams_t& params);
+
+	/** Any thread: poseDedup for the joint trackers, see CPoseSubmitFilter::Configure */
+	void SetSubmitFilter(bool bEnabled, double flPositionThreshold, double flRotationThresholdDegrees, double flKeepAliveSeconds);
+
+	virtual void SetObjectId(EBodyJoint eJoint, vr::TrackedDeviceIndex_t unObjectId) override { m_rgunObjectIds[eJoint].store(unObjectId); }
+
+	/** Any thread: listeners must outlive the tracker or be cleared before they're destroyed */
+	void SetSkeletonListener(int nSlot, IBodySkeletonListener* pListener) { m_rgpListeners[nSlot].store(pListener); }
+
+	virtual void ReadPose(EBodyJoint eJoint, vr::DriverPose_t* pPose) const override;
+
+	/** Any thread: the latest skeleton, false before the first detection */
+	bool ReadSkeleton(ZedBodySkeleton_t* pSkeleton) const { return m_skeleton.Read(pSkeleton) != 0; }
+
+private:
+	CZedBodyTracker(const CZedBodyTracker&) = delete;
+	CZedBodyTracker& operator=(const CZedBodyTracker&) = delete;
+
+	struct BodyPoses_t
+	{
+		vr::DriverPose_t rgPoses[BodyJoint_Count];
+	};
+
+	bool FillSkeleton(const sl::ObjectData& body, uint64_t ulTimestampNs, ZedBodySkeleton_t* pSkeleton) const;
+	void RunPublisher();
+	void PublishPoses(const ZedBodySkeleton_t& skeleton, const vr::DriverPose_t& poseTemplate);
+	void PublishTrackingLost(const vr::DriverPose_t& poseTemplate);
+	void SubmitPoses(const BodyPoses_t& poses, uint64_t ulSampleTimestampNs);
+	void NotifyListeners(const ZedBodySkeleton_t* pSkeleton, const vr::DriverPose_t& poseTemplate, double flTimeOffset);
+
+	sl::Camera* m_pZed; // for the current time, while enabled
+	bool m_bReplay;
+	sl::Objects m_objects; // grab thread's, reused for every retrieveObjects
+	sl::ObjectDetectionRuntimeParameters m_runtimeParams;
+	uint64_t m_ulLastDetectionNs;
+	int m_nBodyId; // the body followed, -1 for none
+
+	std::thread* m_pPublisher;
+	std::mutex m_publisherMutex; // everything up to m_flDedupKeepAlive
+	std::condition_variable m_publisherWake;
+	ZedBodySkeleton_t m_pendingSkeleton;
+	bool m_bSkeletonPending;
+	bool m_bBodyLost;
+	vr::DriverPose_t m_poseTemplate;
+	bool m_bStopPublisher;
+	bool m_bPoseFilterChanged;
+	bool m_bPoseFilterEnabled;
+	OneEuroParams_t m_poseFilterParams;
+	bool m_bSubmitFilterChanged;
+	bool m_bDedup;
+	double m_flDedupPosition;
+	double m_flDedupRotation;
+	double m_flDedupKeepAlive;
+	CPoseSubmitFilter m_rgSubmitFilters[BodyJoint_Count]; // publisher's
+	CPoseFilterBank m_poseFilter; // publisher's, all joints of a detection at once
+	CPoseVelocityEstimator m_rgVelocity[BodyJoint_Count]; // publisher's
+	int m_nPublishedBodyId; // publisher's
+
+	std::atomic<vr::TrackedDeviceIndex_t> m_rgunObjectIds[BodyJoint_Count];
+	std::atomic<IBodySkeletonListener*> m_rgpListeners[k_nBodySkeletonListeners];
+	CSeqLock<ZedBodySkeleton_t> m_skeleton;
+	CSeqLock<BodyPoses_t> m_poses;
+};
+
+#endif // BODYTRACKER_H
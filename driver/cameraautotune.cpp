@@ -0,0 +1,165 @@
+#include "cameraautotune.h"
+#include "latencystats.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+
+using namespace sl;
+
+static const char* const k_pchAutoTuneHeader = "zedm-autotune 1";
+
+// tracking settles in the first second, the rest is measured
+static const double k_flWarmupSeconds = 1.0;
+static const double k_flMeasureSeconds = 3.0;
+
+// a profile that drops more frames than this is overloading the GPU
+static const double k_flMinFpsFraction = 0.9;
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string GetAutoTuneFingerprint(const std::string& sCameraModel, unsigned int unCameraSerial, int nGpu)
+{
+	char rchGpuName[256] = "unknown GPU";
+	CUdevice device;
+	if (cuDeviceGet(&device, nGpu >= 0 ? nGpu : 0) == CUDA_SUCCESS)
+		cuDeviceGetName(rchGpuName, sizeof(rchGpuName), device);
+
+	return sCameraModel + " " + std::to_string(unCameraSerial) + ", " + rchGpuName + ", SDK " + Camera::getSDKVersion().c_str();
+}
+
+bool LoadCameraAutoTune(const std::string& sPath, CameraAutoTune_t* pAutoTune)
+{
+	FILE* pFile = fopen(sPath.c_str(), "r");
+	if (!pFile)
+		return false;
+
+	CameraAutoTune_t autoTune;
+	char rchLine[512] = {};
+	bool bRead = fgets(rchLine, sizeof(rchLine), pFile) && strncmp(rchLine, k_pchAutoTuneHeader, strlen(k_pchAutoTuneHeader)) == 0
+		&& fgets(rchLine, sizeof(rchLine), pFile) && strncmp(rchLine, "fingerprint ", 12) == 0;
+	if (bRead)
+	{
+		autoTune.sFingerprint = rchLine + 12;
+		while (!autoTune.sFingerprint.empty() && (autoTune.sFingerprint.back() == '\n' || autoTune.sFingerprint.back() == '\r'))
+			autoTune.sFingerprint.pop_back();
+	}
+	for (int i = 0; bRead && i < CameraProfile_Count; i++)
+	{
+		// one line per profile, in the order of ECameraProfile
+		char rchName[64] = {};
+		int nRan = 0;
+		CameraProfileBenchmark_t& benchmark = autoTune.rgBenchmarks[i];
+		bRead = fscanf(pFile, " %63s %d %lf %lf", rchName, &nRan, &benchmark.flFps, &benchmark.flLatencyP95Ms) == 4
+			&& strcmp(rchName, GetCameraProfile((ECameraProfile)i).pchName) == 0;
+		benchmark.bRan = nRan != 0;
+	}
+	fclose(pFile);
+
+	if (bRead)
+		*pAutoTune = autoTune;
+	return bRead;
+}
+
+bool SaveCameraAutoTune(const std::string& sPath, const CameraAutoTune_t& autoTune)
+{
+	FILE* pFile = fopen(sPath.c_str(), "w");
+	if (!pFile)
+		return false;
+
+	fprintf(pFile, "%s\nfingerprint %s\n", k_pchAutoTuneHeader, autoTune.sFingerprint.c_str());
+	for (int i = 0; i < CameraProfile_Count; i++)
+	{
+		const CameraProfileBenchmark_t& benchmark = autoTune.rgBenchmarks[i];
+		fprintf(pFile, "%s %d %.2f %.2f\n", GetCameraProfile((ECameraProfile)i).pchName, benchmark.bRan ? 1 : 0, benchmark.flFps, benchmark.flLatencyP95Ms);
+	}
+	return fclose(pFile) == 0;
+}
+
+CameraProfileBenchmark_t BenchmarkCameraProfile(unsigned int unCameraSerial, ECameraProfile eProfile, bool bDepthPerGrab,
+	const std::string& sCalibrationDir, const CCudaDeviceSelection& gpu, const std::atomic<bool>& bStop)
+{
+	CameraProfileBenchmark_t benchmark = {};
+	const CameraProfile_t& profile = GetCameraProfile(eProfile);
+
+	// as OpenCamera configures it, minus what only the driver needs
+	InitParameters init_params;
+	init_params.camera_resolution = profile.eResolution;
+	init_params.camera_fps = profile.nFps;
+	init_params.depth_mode = profile.eDepthMode;
+	init_params.coordinate_system = COORDINATE_SYSTEM::RIGHT_HANDED_Y_UP;
+	init_params.coordinate_units = UNIT::METER;
+	init_params.sdk_gpu_id = gpu.GetDevice();
+	init_params.sdk_cuda_ctx = gpu.GetContext();
+	if (!bDepthPerGrab)
+		init_params.depth_stabilization = 0;
+	if (unCameraSerial != 0)
+		init_params.input.setFromSerialNumber(unCameraSerial);
+	if (!sCalibrationDir.empty())
+		init_params.optional_settings_path = sCalibrationDir.c_str();
+
+	Camera zed;
+	if (zed.open(init_params) != ERROR_CODE::SUCCESS)
+		return benchmark;
+
+	PositionalTrackingParameters tracking_parameters;
+	tracking_parameters.enable_area_memory = profile.bAreaMemory;
+	tracking_parameters.enable_pose_smoothing = profile.bPoseSmoothing;
+	if (zed.enablePositionalTracking(tracking_parameters) != ERROR_CODE::SUCCESS)
+	{
+		zed.close();
+		return benchmark;
+	}
+
+	RuntimeParameters runtime_parameters;
+	runtime_parameters.enable_depth = bDepthPerGrab;
+
+	CLatencyHistogram latency;
+	Pose pose;
+	uint64_t ulStartNs = GetSteadyNanoseconds();
+	uint64_t ulMeasureStartNs = ulStartNs + (uint64_t)(k_flWarmupSeconds * 1e9);
+	uint64_t ulEndNs = ulMeasureStartNs + (uint64_t)(k_flMeasureSeconds * 1e9);
+	uint64_t ulFrames = 0;
+	uint64_t ulNowNs = ulStartNs;
+	while (ulNowNs < ulEndNs && !bStop)
+	{
+		bool bGrabbed = zed.grab(runtime_parameters) == ERROR_CODE::SUCCESS;
+		if (bGrabbed)
+			zed.getPosition(pose, REFERENCE_FRAME::WORLD);
+		ulNowNs = GetSteadyNanoseconds();
+		if (!bGrabbed || ulNowNs < ulMeasureStartNs)
+			continue;
+
+		ulFrames++;
+		uint64_t ulImageNs = zed.getTimestamp(TIME_REFERENCE::IMAGE).getNanoseconds();
+		uint64_t ulPoseNs = zed.getTimestamp(TIME_REFERENCE::CURRENT).getNanoseconds();
+		if (ulImageNs != 0 && ulPoseNs > ulImageNs)
+			latency.Record(ulPoseNs - ulImageNs);
+	}
+
+	zed.disablePositionalTracking();
+	zed.close();
+
+	LatencySummary_t summary = latency.Summarize();
+	benchmark.bRan = !bStop && summary.ulCount > 0;
+	benchmark.flFps = ulFrames / k_flMeasureSeconds;
+	benchmark.flLatencyP95Ms = summary.flP95Us / 1000.0;
+	return benchmark;
+}
+
+ECameraProfile PickCameraProfile(const CameraAutoTune_t& autoTune, double flBudgetMs)
+{
+	// the profiles are declared from the lightest to the most demanding
+	for (int i = CameraProfile_Count - 1; i >= 0; i--)
+	{
+		const CameraProfileBenchmark_t& benchmark = autoTune.rgBenchmarks[i];
+		if (benchmark.bRan && benchmark.flLatencyP95Ms <= flBudgetMs
+			&& benchmark.flFps >= k_flMinFpsFraction * GetCameraProfile((ECameraProfile)i).nFps)
+			return (ECameraProfile)i;
+	}
+	return CameraProfile_LowLatency;
+}
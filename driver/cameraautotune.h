@@ -0,0 +1,52 @@
+#ifndef CAMERAAUTOTUNE_H
+#define CAMERAAUTOTUNE_H
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "cameraprofile.h"
+#include "cudadevice.h"
+
+struct CameraProfileBenchmark_t
+{
+	bool bRan; // the camera opened and tracked with the profile
+	double flFps; // frames grabbed per second
+	double flLatencyP95Ms; // image timestamp -> pose, 95th percentile
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: cameraProfile "auto": every profile benchmarked on this machine
+// and camera, and what it was measured on. Kept in autoTunePath so the
+// benchmark only runs on the first start and again when the fingerprint
+// changes, i.e. another camera, GPU or SDK version.
+//-----------------------------------------------------------------------------
+struct CameraAutoTune_t
+{
+	std::string sFingerprint;
+	CameraProfileBenchmark_t rgBenchmarks[CameraProfile_Count];
+};
+
+/** What a benchmark of camera unCameraSerial on GPU nGpu depends on; model and SDK version included */
+extern std::string GetAutoTuneFingerprint(const std::string& sCameraModel, unsigned int unCameraSerial, int nGpu);
+
+/** An autoTunePath file; false if it is missing or unreadable */
+extern bool LoadCameraAutoTune(const std::string& sPath, CameraAutoTune_t* pAutoTune);
+extern bool SaveCameraAutoTune(const std::string& sPath, const CameraAutoTune_t& autoTune);
+
+//-----------------------------------------------------------------------------
+// Purpose: Opens the camera with profile eProfile on a Camera of its own,
+// tracks for a few seconds and measures the frame rate and how late the
+// poses are, with or without a depth map per grab as the driver would.
+// sCalibrationDir is passed on as optional_settings_path, see sdkCachePath.
+// The camera must not be open elsewhere. Returns early, with bRan false,
+// once bStop is set.
+//-----------------------------------------------------------------------------
+extern CameraProfileBenchmark_t BenchmarkCameraProfile(unsigned int unCameraSerial, ECameraProfile eProfile, bool bDepthPerGrab,
+	const std::string& sCalibrationDir, const CCudaDeviceSelection& gpu, const std::atomic<bool>& bStop);
+
+/** The most demanding profile whose poses are within flBudgetMs at 90% of its frame rate; low_latency if none is */
+extern ECameraProfile PickCameraProfile(const CameraAutoTune_t& autoTune, double flBudgetMs);
+
+#endif // CAMERAAUTOTUNE_H
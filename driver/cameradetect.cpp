@@ -0,0 +1,84 @@
+#include "cameradetect.h"
+
+#include <sl/Camera.hpp>
+
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <setupapi.h>
+#else
+#include <dirent.h>
+#include <stdio.h>
+#endif
+
+#if defined(_WIN32)
+uint32_t CountZedUsbDevices()
+{
+	HDEVINFO hDevices = SetupDiGetClassDevsA(nullptr, "USB", nullptr, DIGCF_PRESENT | DIGCF_ALLCLASSES);
+	if (hDevices == INVALID_HANDLE_VALUE)
+		return 0;
+
+	uint32_t unCount = 0;
+	SP_DEVINFO_DATA device;
+	device.cbSize = sizeof(device);
+	for (DWORD i = 0; SetupDiEnumDeviceInfo(hDevices, i, &device); i++)
+	{
+		// a list of strings; the first one has the vendor
+		char rchIds[512] = {};
+		if (!SetupDiGetDeviceRegistryPropertyA(hDevices, &device, SPDRP_HARDWAREID, nullptr, (PBYTE)rchIds, sizeof(rchIds) - 1, nullptr))
+			continue;
+		// e.g. USB\VID_2B03&PID_F682&REV_0100, 2B03 being Stereolabs
+		if (strstr(rchIds, "VID_2B03"))
+			unCount++;
+	}
+	SetupDiDestroyDeviceInfoList(hDevices);
+	return unCount;
+}
+#else
+uint32_t CountZedUsbDevices()
+{
+	DIR* pDir = opendir("/sys/bus/usb/devices");
+	if (!pDir)
+		return 0;
+
+	uint32_t unCount = 0;
+	while (dirent* pEntry = readdir(pDir))
+	{
+		if (pEntry->d_name[0] == '.')
+			continue;
+		char rchPath[512];
+		snprintf(rchPath, sizeof(rchPath), "/sys/bus/usb/devices/%s/idVendor", pEntry->d_name);
+		FILE* pFile = fopen(rchPath, "r");
+		if (!pFile)
+			continue;
+		char rchVendor[8] = {};
+		if (fgets(rchVendor, sizeof(rchVendor), pFile) && strncmp(rchVendor, "2b03", 4) == 0)
+			unCount++;
+		fclose(pFile);
+	}
+	closedir(pDir);
+	return unCount;
+}
+#endif
+
+std::vector<unsigned int> EnumerateZedCameras()
+{
+	std::vector<unsigned int> vecSerials;
+	for (const sl::DeviceProperties& device : sl::Camera::getDeviceList())
+	{
+		if (device.serial_number != 0)
+			vecSerials.push_back(device.serial_number);
+	}
+	return vecSerials;
+}
+
+std::string GetZedModelName(unsigned int unCameraSerial)
+{
+	for (const sl::DeviceProperties& device : sl::Camera::getDeviceList())
+	{
+		if (device.serial_number == unCameraSerial)
+			return sl::toString(device.camera_model).c_str();
+	}
+	return "ZED";
+}
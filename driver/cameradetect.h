@@ -0,0 +1,32 @@
+#ifndef CAMERADETECT_H
+#define CAMERADETECT_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Purpose: Number of Stereolabs USB devices present, from the OS device list
+// (SetupAPI on Windows, sysfs elsewhere) without loading the ZED SDK. A few
+// milliseconds, cheap enough to poll for hot-plugged cameras. Every camera
+// may show up as more than one device (video and sensors), so only a change
+// in the count means something.
+//-----------------------------------------------------------------------------
+extern uint32_t CountZedUsbDevices();
+
+//-----------------------------------------------------------------------------
+// Purpose: Serial numbers of the connected ZED cameras, from the SDK. The
+// first call loads the SDK and CUDA, which take a while; with the driver's
+// delay-loaded imports that only happens once a camera is there.
+//-----------------------------------------------------------------------------
+extern std::vector<unsigned int> EnumerateZedCameras();
+
+//-----------------------------------------------------------------------------
+// Purpose: The SDK's name of the connected camera's model, e.g. "ZED-M", or
+// "ZED" if it isn't in the device list
+//-----------------------------------------------------------------------------
+extern std::string GetZedModelName(unsigned int unCameraSerial);
+
+#endif // CAMERADETECT_H
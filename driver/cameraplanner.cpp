@@ -0,0 +1,257 @@
+#include "cameraplanner.h"
+#include "driverlog.h"
+#include "threadscheduling.h"
+
+#include <cuda.h>
+#include <sl/Camera.hpp>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <setupapi.h>
+#include <cfgmgr32.h>
+#else
+#include <limits.h>
+#include <stdlib.h>
+#endif
+
+// of a controller's fastest link, what the cameras' video can count on
+static const double k_flUsbUsableFraction = 0.6;
+
+// a link whose speed isn't known is taken for USB 3.0
+static const uint32_t k_unDefaultUsbSpeedMbps = 5000;
+
+#if defined(_WIN32)
+// the camera's device interface, up the device tree to the PCI host controller
+static void FindUsbController(const sl::DeviceProperties& device, std::string* psController, uint32_t* punSpeedMbps)
+{
+	HDEVINFO hDevices = SetupDiCreateDeviceInfoList(nullptr, nullptr);
+	if (hDevices == INVALID_HANDLE_VALUE)
+		return;
+
+	SP_DEVICE_INTERFACE_DATA deviceInterface;
+	deviceInterface.cbSize = sizeof(deviceInterface);
+	SP_DEVINFO_DATA deviceInfo;
+	deviceInfo.cbSize = sizeof(deviceInfo);
+	if (SetupDiOpenDeviceInterfaceA(hDevices, device.path.c_str(), 0, &deviceInterface)
+		&& (SetupDiGetDeviceInterfaceDetailA(hDevices, &deviceInterface, nullptr, 0, nullptr, &deviceInfo) || GetLastError() == ERROR_INSUFFICIENT_BUFFER))
+	{
+		DEVINST devInst = deviceInfo.DevInst;
+		DEVINST parent;
+		while (CM_Get_Parent(&parent, devInst, 0) == CR_SUCCESS)
+		{
+			char rchId[MAX_DEVICE_ID_LEN] = {};
+			if (CM_Get_Device_IDA(parent, rchId, sizeof(rchId), 0) != CR_SUCCESS)
+				break;
+			// the root hub tells the controller's generation, not the link's
+			if (strncmp(rchId, "USB\\ROOT_HUB30", 14) == 0)
+				*punSpeedMbps = 5000;
+			else if (strncmp(rchId, "USB\\ROOT_HUB20", 14) == 0)
+				*punSpeedMbps = 480;
+			if (strncmp(rchId, "PCI\\", 4) == 0)
+			{
+				*psController = rchId;
+				break;
+			}
+			devInst = parent;
+		}
+	}
+	SetupDiDestroyDeviceInfoList(hDevices);
+}
+#else
+// /dev/videoN, through sysfs: .../<controller PCI address>/usbN/<port>/<port>:<interface>
+static void FindUsbController(const sl::DeviceProperties& device, std::string* psController, uint32_t* punSpeedMbps)
+{
+	std::string sPath = device.path.c_str();
+	size_t unName = sPath.rfind('/');
+	std::string sSysPath = "/sys/class/video4linux/" + sPath.substr(unName == std::string::npos ? 0 : unName + 1) + "/device";
+
+	char rchInterface[PATH_MAX];
+	if (!realpath(sSysPath.c_str(), rchInterface))
+		return;
+	std::string sInterface = rchInterface;
+
+	size_t unBus = sInterface.find("/usb");
+	if (unBus != std::string::npos)
+	{
+		size_t unController = sInterface.rfind('/', unBus - 1);
+		*psController = sInterface.substr(unController + 1, unBus - unController - 1);
+	}
+
+	// the speed is the USB device's, one level above the interface
+	std::string sSpeedPath = sInterface.substr(0, sInterface.rfind('/')) + "/speed";
+	FILE* pFile = fopen(sSpeedPath.c_str(), "r");
+	if (pFile)
+	{
+		unsigned int unSpeed = 0;
+		if (fscanf(pFile, "%u", &unSpeed) == 1)
+			*punSpeedMbps = unSpeed;
+		fclose(pFile);
+	}
+}
+#endif
+
+// usable multiprocessors of every CUDA device, device 0's halved; empty without CUDA
+static std::vector<double> GetCudaCapacities()
+{
+	std::vector<double> vecCapacities;
+	int nCount = 0;
+	if (cuInit(0) != CUDA_SUCCESS || cuDeviceGetCount(&nCount) != CUDA_SUCCESS)
+		return vecCapacities;
+
+	for (int i = 0; i < nCount; i++)
+	{
+		CUdevice device;
+		int nSMs = 0;
+		if (cuDeviceGet(&device, i) != CUDA_SUCCESS
+			|| cuDeviceGetAttribute(&nSMs, CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT, device) != CUDA_SUCCESS)
+			nSMs = 0;
+		vecCapacities.push_back(i == 0 ? 0.5 * nSMs : (double)nSMs);
+	}
+	return vecCapacities;
+}
+
+std::vector<CameraPlacement_t> PlanCameraPlacement(const std::vector<unsigned int>& vecSerials, const ZedmSettings_t& settings)
+{
+	// cameraProfile "auto" tunes below the ceiling, so starts from the top
+	ECameraProfile eRequested = (ECameraProfile)(CameraProfile_Count - 1);
+	FindCameraProfile(settings.sCameraProfile.c_str(), &eRequested);
+
+	std::vector<sl::DeviceProperties> vecDevices = sl::Camera::getDeviceList();
+	std::vector<CameraPlacement_t> vecPlan;
+	for (unsigned int unSerial : vecSerials)
+	{
+		CameraPlacement_t placement;
+		placement.unSerial = unSerial;
+		placement.unUsbSpeedMbps = 0;
+		placement.nCudaDevice = settings.nCudaDevice;
+		placement.ulCpuMask = 0;
+		placement.eProfileCeiling = eRequested;
+		for (const sl::DeviceProperties& device : vecDevices)
+		{
+			if (device.serial_number == unSerial)
+				FindUsbController(device, &placement.sUsbController, &placement.unUsbSpeedMbps);
+		}
+		vecPlan.push_back(placement);
+	}
+
+	// USB: step the heaviest camera of an oversubscribed controller down until it fits
+	std::vector<std::string> vecControllers;
+	for (const CameraPlacement_t& placement : vecPlan)
+	{
+		if (std::find(vecControllers.begin(), vecControllers.end(), placement.sUsbController) == vecControllers.end())
+			vecControllers.push_back(placement.sUsbController);
+	}
+	for (const std::string& sController : vecControllers)
+	{
+		uint32_t unSpeedMbps = 0;
+		for (const CameraPlacement_t& placement : vecPlan)
+		{
+			if (placement.sUsbController == sController)
+				unSpeedMbps = std::max(unSpeedMbps, placement.unUsbSpeedMbps);
+		}
+		double flBudgetMbps = k_flUsbUsableFraction * (unSpeedMbps ? unSpeedMbps : k_unDefaultUsbSpeedMbps);
+
+		for (;;)
+		{
+			double flTotalMbps = 0.0;
+			CameraPlacement_t* pHeaviest = nullptr;
+			for (CameraPlacement_t& placement : vecPlan)
+			{
+				if (placement.sUsbController != sController)
+					continue;
+				double flMbps = GetCameraProfileBandwidthMbps(placement.eProfileCeiling);
+				flTotalMbps += flMbps;
+				if (placement.eProfileCeiling > 0 && (!pHeaviest || flMbps > GetCameraProfileBandwidthMbps(pHeaviest->eProfileCeiling)))
+					pHeaviest = &placement;
+			}
+			if (flTotalMbps <= flBudgetMbps)
+				break;
+			if (!pHeaviest)
+			{
+				DriverLog("USB controller %s: %.0f Mbit/s needed at the lowest profiles, %.0f available\n",
+					sController.empty() ? "(unknown)" : sController.c_str(), flTotalMbps, flBudgetMbps);
+				break;
+			}
+			pHeaviest->eProfileCeiling = (ECameraProfile)(pHeaviest->eProfileCeiling - 1);
+		}
+	}
+
+	// GPU: heaviest cameras first, each to the device with the least load per multiprocessor
+	std::vector<double> vecCapacities = settings.nCudaDevice < 0 ? GetCudaCapacities() : std::vector<double>();
+	if (vecCapacities.size() > 1)
+	{
+		std::vector<CameraPlacement_t*> vecByLoad;
+		for (CameraPlacement_t& placement : vecPlan)
+			vecByLoad.push_back(&placement);
+		std::stable_sort(vecByLoad.begin(), vecByLoad.end(), [](const CameraPlacement_t* pA, const CameraPlacement_t* pB) {
+			return GetCameraProfileBandwidthMbps(pA->eProfileCeiling) > GetCameraProfileBandwidthMbps(pB->eProfileCeiling);
+		});
+
+		std::vector<double> vecLoads(vecCapacities.size(), 0.0);
+		for (CameraPlacement_t* pPlacement : vecByLoad)
+		{
+			double flLoad = GetCameraProfileBandwidthMbps(pPlacement->eProfileCeiling);
+			int nBest = -1;
+			for (size_t i = 0; i < vecCapacities.size(); i++)
+			{
+				if (vecCapacities[i] <= 0.0)
+					continue;
+				if (nBest < 0 || (vecLoads[i] + flLoad) / vecCapacities[i] < (vecLoads[nBest] + flLoad) / vecCapacities[nBest])
+					nBest = (int)i;
+			}
+			if (nBest < 0)
+				break;
+			vecLoads[nBest] += flLoad;
+			pPlacement->nCudaDevice = nBest;
+		}
+	}
+
+	// CPU: consecutive cores of the allowed ones per camera
+	uint64_t ulAllowed = ParseAffinityMask(settings.sThreadAffinityMask);
+	if (ulAllowed == 0)
+	{
+		unsigned int unCores = std::min(std::thread::hardware_concurrency(), 64u);
+		ulAllowed = unCores >= 64 ? ~0ull : (1ull << unCores) - 1;
+	}
+	std::vector<int> vecCores;
+	for (int i = 0; i < 64; i++)
+	{
+		if (ulAllowed & (1ull << i))
+			vecCores.push_back(i);
+	}
+	if (!vecCores.empty())
+	{
+		size_t unPerCamera = std::max<size_t>(1, vecCores.size() / vecPlan.size());
+		for (size_t i = 0; i < vecPlan.size(); i++)
+		{
+			for (size_t j = 0; j < unPerCamera; j++)
+				vecPlan[i].ulCpuMask |= 1ull << vecCores[(i * unPerCamera + j) % vecCores.size()];
+		}
+	}
+
+	for (const CameraPlacement_t& placement : vecPlan)
+	{
+		DriverLog("ZED %u: USB controller %s at %u Mbit/s, up to camera profile %s, CUDA device %d, CPU mask 0x%llx\n", placement.unSerial,
+			placement.sUsbController.empty() ? "(unknown)" : placement.sUsbController.c_str(), placement.unUsbSpeedMbps,
+			GetCameraProfile(placement.eProfileCeiling).pchName, placement.nCudaDevice, (unsigned long long)placement.ulCpuMask);
+	}
+	return vecPlan;
+}
+
+void ApplyCameraPlacement(const CameraPlacement_t& placement, ZedmSettings_t* pSettings)
+{
+	pSettings->nCudaDevice = placement.nCudaDevice;
+	if (placement.ulCpuMask != 0)
+	{
+		char rchMask[32];
+		snprintf(rchMask, sizeof(rchMask), "0x%llx", (unsigned long long)placement.ulCpuMask);
+		pSettings->sThreadAffinityMask = rchMask;
+	}
+	pSettings->nCameraProfileCeiling = placement.eProfileCeiling;
+}
@@ -0,0 +1,51 @@
+#ifndef CAMERAPLANNER_H
+#define CAMERAPLANNER_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cameraprofile.h"
+#include "driversettings.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Where one camera of a multi-camera rig runs, see cameraPlanner
+//-----------------------------------------------------------------------------
+struct CameraPlacement_t
+{
+	unsigned int unSerial;
+	std::string sUsbController; // the host controller's PCI location or device id, "" if not found
+	uint32_t unUsbSpeedMbps; // the camera's link, 0 if not found
+	int nCudaDevice; // -1 leaves it to cudaDevice
+	uint64_t ulCpuMask; // grab and IMU threads, 0 leaves them to threadAffinityMask
+	ECameraProfile eProfileCeiling; // the most demanding profile its controller has bandwidth for
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: cameraPlanner: at startup, with more than one camera connected,
+// spreads the cameras over what the machine has so that they don't starve
+// each other.
+//
+// USB: cameras on the same host controller share its bandwidth, about 60% of
+// the fastest link on it being usable for video. While a controller's
+// cameras need more than that at cameraProfile, the one using the most steps
+// down a profile; eProfileCeiling is where each ends up. The controllers are
+// found through sysfs on Linux and the device tree (SetupAPI) on Windows;
+// cameras whose controller isn't found are counted on one shared controller.
+//
+// GPU: without a cudaDevice, each camera goes to the CUDA device with the
+// least load per multiprocessor, heaviest cameras first; device 0 counts
+// half, it renders the compositor.
+//
+// CPU: the cores of threadAffinityMask, or all of them, split into one
+// disjoint set per camera for its grab and IMU threads; with fewer cores
+// than cameras the sets wrap around.
+//-----------------------------------------------------------------------------
+extern std::vector<CameraPlacement_t> PlanCameraPlacement(const std::vector<unsigned int>& vecSerials, const ZedmSettings_t& settings);
+
+/** The placement in the settings of its camera's device */
+extern void ApplyCameraPlacement(const CameraPlacement_t& placement, ZedmSettings_t* pSettings);
+
+#endif // CAMERAPLANNER_H
@@ -0,0 +1,38 @@
+#include "cameraprofile.h"
+
+#include <string.h>
+
+using namespace sl;
+
+static const CameraProfile_t k_rgCameraProfiles[CameraProfile_Count] =
+{
+	// name, resolution, fps, depth mode, area memory, pose smoothing
+	{ "low_latency", RESOLUTION::VGA, 100, DEPTH_MODE::PERFORMANCE, true, false },
+	{ "balanced", RESOLUTION::HD720, 60, DEPTH_MODE::PERFORMANCE, true, false },
+	{ "high_accuracy", RESOLUTION::HD1080, 30, DEPTH_MODE::ULTRA, true, true },
+};
+
+const CameraProfile_t& GetCameraProfile(ECameraProfile eProfile)
+{
+	return k_rgCameraProfiles[eProfile];
+}
+
+bool FindCameraProfile(const char* pchName, ECameraProfile* peProfile)
+{
+	for (int i = 0; i < CameraProfile_Count; i++)
+	{
+		if (strcmp(pchName, k_rgCameraProfiles[i].pchName) == 0)
+		{
+			*peProfile = (ECameraProfile)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+double GetCameraProfileBandwidthMbps(ECameraProfile eProfile)
+{
+	const CameraProfile_t& profile = k_rgCameraProfiles[eProfile];
+	Resolution resolution = getResolution(profile.eResolution);
+	return 2.0 * resolution.width * resolution.height * 16.0 * profile.nFps / 1e6;
+}
@@ -0,0 +1,45 @@
+#ifndef CAMERAPROFILE_H
+#define CAMERAPROFILE_H
+
+#pragma once
+
+#include <sl/Camera.hpp>
+
+//-----------------------------------------------------------------------------
+// Purpose: Named camera configurations selected with the cameraProfile
+// setting or DebugRequest("profile <name>"). Switching profiles reopens the
+// camera on the grab thread.
+//
+// low_latency    VGA at 100 fps, PERFORMANCE depth
+// balanced       HD720 at 60 fps, PERFORMANCE depth (default)
+// high_accuracy  HD1080 at 30 fps, ULTRA depth, pose smoothing
+//
+// cameraProfile "auto" picks one of these at startup, see cameraautotune.h.
+//-----------------------------------------------------------------------------
+enum ECameraProfile
+{
+	CameraProfile_LowLatency,
+	CameraProfile_Balanced,
+	CameraProfile_HighAccuracy,
+	CameraProfile_Count,
+};
+
+struct CameraProfile_t
+{
+	const char* pchName;
+	sl::RESOLUTION eResolution;
+	int nFps;
+	sl::DEPTH_MODE eDepthMode;
+	bool bAreaMemory;
+	bool bPoseSmoothing;
+};
+
+extern const CameraProfile_t& GetCameraProfile(ECameraProfile eProfile);
+
+/** Returns false and leaves *peProfile alone if pchName isn't a profile name */
+extern bool FindCameraProfile(const char* pchName, ECameraProfile* peProfile);
+
+/** USB bandwidth of the profile's video stream in Mbit/s: both images, YUV 4:2:2 */
+extern double GetCameraProfileBandwidthMbps(ECameraProfile eProfile);
+
+#endif // CAMERAPROFILE_H
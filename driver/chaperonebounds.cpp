@@ -0,0 +1,570 @@
+#include "chaperonebounds.h"
+#include "driverlog.h"
+#include "hmdmath.h"
+#include "zedtracker.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace vr;
+
+// Prop_CurrentUniverseId_Uint64 of every device of the driver
+static const uint64_t k_ulUniverseId = 27;
+
+struct OutlinePoint_t
+{
+	double x, z;
+};
+
+static double DistanceToSegmentSquared(const OutlinePoint_t& p, const OutlinePoint_t& a, const OutlinePoint_t& b)
+{
+	double dx = b.x - a.x, dz = b.z - a.z;
+	double flLengthSquared = dx * dx + dz * dz;
+	double t = flLengthSquared > 0.0 ? ((p.x - a.x) * dx + (p.z - a.z) * dz) / flLengthSquared : 0.0;
+	t = t < 0.0 ? 0.0 : t > 1.0 ? 1.0 : t;
+	double ex = a.x + t * dx - p.x, ez = a.z + t * dz - p.z;
+	return ex * ex + ez * ez;
+}
+
+// Douglas-Peucker on the open run vecPoints[nFirst..nLast], marking the points kept
+static void SimplifyRun(const std::vector<OutlinePoint_t>& vecPoints, size_t nFirst, size_t nLast, double flToleranceSquared, std::vector<uint8_t>* pvecKeep)
+{
+	std::vector<std::pair<size_t, size_t>> vecStack;
+	vecStack.push_back(std::make_pair(nFirst, nLast));
+	while (!vecStack.empty())
+	{
+		size_t a = vecStack.back().first, b = vecStack.back().second;
+		vecStack.pop_back();
+		double flFarthest = 0.0;
+		size_t nFarthest = a;
+		for (size_t i = a + 1; i < b; i++)
+		{
+			double flDistance = DistanceToSegmentSquared(vecPoints[i], vecPoints[a], vecPoints[b % vecPoints.size()]);
+			if (flDistance > flFarthest)
+			{
+				flFarthest = flDistance;
+				nFarthest = i;
+			}
+		}
+		if (flFarthest <= flToleranceSquared)
+			continue;
+		(*pvecKeep)[nFarthest] = 1;
+		vecStack.push_back(std::make_pair(a, nFarthest));
+		vecStack.push_back(std::make_pair(nFarthest, b));
+	}
+}
+
+CChaperoneGenerator::CChaperoneGenerator()
+	: m_pTracker(nullptr)
+	, m_flThreshold(0.0)
+	, m_ulMapVersion(0)
+	, m_flFloorHeight(0.0)
+	, m_bHaveFloor(false)
+	, m_nSeedCell(-1)
+	, m_unRevision(0)
+{
+	memset(&m_lastTemplate, 0, sizeof(m_lastTemplate));
+	ChaperoneBounds_t bounds = {};
+	m_bounds.Write(bounds);
+}
+
+CChaperoneGenerator::~CChaperoneGenerator()
+{
+	Stop();
+}
+
+void CChaperoneGenerator::Start(CWorkerPool* pPool, CZedTracker* pTracker, const std::string& sPath, float flIntervalSeconds, float flThreshold)
+{
+	Stop();
+
+	m_pTracker = pTracker;
+	m_sPath = sPath;
+	m_flThreshold = flThreshold;
+	m_ulMapVersion = 0;
+	m_bHaveFloor = false;
+	m_mapChunks.clear();
+	m_vecFloorCount.assign(k_nGridCells * k_nGridCells, 0);
+	m_vecObstacleCount.assign(k_nGridCells * k_nGridCells, 0);
+	m_vecMark.assign(k_nGridCells * k_nGridCells, 0);
+	m_vecRoom.assign(k_nGridCells * k_nGridCells, 0);
+	m_vecWritten.clear();
+	m_nSeedCell = -1;
+	uint64_t ulIntervalNs = (uint64_t)((flIntervalSeconds > 1.0f ? flIntervalSeconds : 1.0f) * 1e9);
+	m_tick.Start(pPool, WorkPriority_Low, ulIntervalNs, [this] { Tick(); });
+	DriverLog("Chaperone bounds from the spatial map to %s\n", m_sPath.c_str());
+}
+
+void CChaperoneGenerator::Stop()
+{
+	m_tick.Stop();
+	m_pTracker = nullptr;
+}
+
+bool CChaperoneGenerator::TakeBounds(uint32_t unSinceRevision, ChaperoneBounds_t* pBounds) const
+{
+	m_bounds.Read(pBounds);
+	return pBounds->unRevision != 0 && pBounds->unRevision != unSinceRevision;
+}
+
+int CChaperoneGenerator::GetCell(double x, double z) const
+{
+	int cx = (int)std::floor(x / k_flCellSize) + k_nGridCells / 2;
+	int cz = (int)std::floor(z / k_flCellSize) + k_nGridCells / 2;
+	if (cx < 0 || cz < 0 || cx >= k_nGridCells || cz >= k_nGridCells)
+		return -1;
+	return cz * k_nGridCells + cx;
+}
+
+void CChaperoneGenerator::Tick()
+{
+	DriverPose_t poseTemplate;
+	m_pTracker->GetPoseTemplate(&poseTemplate);
+
+	// the world transform is a yaw and a translation, so the universe's floor is one driver height
+	double flFloorHeight = -poseTemplate.vecWorldFromDriverTranslation[1];
+	if (!m_bHaveFloor || std::fabs(flFloorHeight - m_flFloorHeight) > k_flMaxFloorChange)
+	{
+		m_mapChunks.clear();
+		std::fill(m_vecFloorCount.begin(), m_vecFloorCount.end(), 0);
+		std::fill(m_vecObstacleCount.begin(), m_vecObstacleCount.end(), 0);
+		m_ulMapVersion = 0;
+		m_flFloorHeight = flFloorHeight;
+		m_bHaveFloor = true;
+	}
+
+	std::vector<SpatialMapChunkDelta_t> vecChanged;
+	uint64_t ulVersion = m_pTracker->GetSpatialMapper().GetChangedChunks(m_ulMapVersion, &vecChanged);
+	for (const SpatialMapChunkDelta_t& delta : vecChanged)
+	{
+		RemoveChunk(delta.unChunk);
+		if (!delta.pChunk)
+			continue;
+		ChunkCells_t& cells = m_mapChunks[delta.unChunk];
+		RasterizeChunk(*delta.pChunk, &cells);
+	}
+	m_ulMapVersion = ulVersion;
+
+	bool bMoved = memcmp(&poseTemplate.qWorldFromDriverRotation, &m_lastTemplate.qWorldFromDriverRotation, sizeof(HmdQuaternion_t)) != 0
+		|| memcmp(poseTemplate.vecWorldFromDriverTranslation, m_lastTemplate.vecWorldFromDriverTranslation, sizeof(double) * 3) != 0;
+	m_lastTemplate = poseTemplate;
+	if (vecChanged.empty() && !bMoved)
+		return;
+
+	DriverPose_t pose;
+	double vecCamera[3] = { 0.0, 0.0, 0.0 };
+	if (m_pTracker->GetPoseAt(m_pTracker->GetCameraTimeNs(), &pose) && pose.poseIsValid)
+		memcpy(vecCamera, pose.vecPosition, sizeof(vecCamera));
+	if (!FindRoom(vecCamera))
+		return;
+
+	std::vector<double> vecOutline;
+	if (!TraceOutline(&vecOutline))
+		return;
+	for (size_t i = 0; i < vecOutline.size(); i += 2)
+	{
+		double vecDriver[3] = { vecOutline[i], m_flFloorHeight, vecOutline[i + 1] };
+		double vecWorld[3];
+		HmdQuaternion_RotateVector(poseTemplate.qWorldFromDriverRotation, vecDriver, vecWorld);
+		vecOutline[i] = vecWorld[0] + poseTemplate.vecWorldFromDriverTranslation[0];
+		vecOutline[i + 1] = vecWorld[2] + poseTemplate.vecWorldFromDriverTranslation[2];
+	}
+	if (!HasMoved(vecOutline))
+		return;
+
+	double flPlayWidth, flPlayDepth;
+	FindPlayArea(poseTemplate, &flPlayWidth, &flPlayDepth);
+	if (!WriteFile(vecOutline, flPlayWidth, flPlayDepth))
+	{
+		DriverLog("Unable to write chaperone bounds to %s\n", m_sPath.c_str());
+		return;
+	}
+
+	m_vecWritten.swap(vecOutline);
+	ChaperoneBounds_t bounds;
+	bounds.unRevision = ++m_unRevision;
+	bounds.unWalls = (uint32_t)(m_vecWritten.size() / 2);
+	bounds.flPlayWidth = flPlayWidth;
+	bounds.flPlayDepth = flPlayDepth;
+	m_bounds.Write(bounds);
+	DriverLog("Chaperone bounds updated: %u walls, play area %.1f x %.1f m\n", bounds.unWalls, flPlayWidth, flPlayDepth);
+}
+
+void CChaperoneGenerator::RemoveChunk(uint32_t unChunk)
+{
+	auto it = m_mapChunks.find(unChunk);
+	if (it == m_mapChunks.end())
+		return;
+	for (uint32_t unCell : it->second.vecFloor)
+		m_vecFloorCount[unCell]--;
+	for (uint32_t unCell : it->second.vecObstacle)
+		m_vecObstacleCount[unCell]--;
+	m_mapChunks.erase(it);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Triangles lying on the floor are filled into the cells they
+// cover. Any other triangle marks the cells under the points of its edges
+// that are at obstacle height, which catches walls standing on the floor as
+// well as table tops. A cell counts once per chunk.
+//-----------------------------------------------------------------------------
+void CChaperoneGenerator::RasterizeChunk(const SpatialMapChunk_t& chunk, ChunkCells_t* pCells)
+{
+	static const uint8_t k_unFloorMark = 1, k_unObstacleMark = 2;
+	auto Mark = [this, pCells](int nCell, uint8_t unMark) {
+		if (nCell < 0 || (m_vecMark[nCell] & unMark))
+			return;
+		m_vecMark[nCell] |= unMark;
+		(unMark == k_unFloorMark ? pCells->vecFloor : pCells->vecObstacle).push_back((uint32_t)nCell);
+	};
+
+	for (const sl::uint3& triangle : chunk.vecTriangles)
+	{
+		if (triangle.x >= chunk.vecVertices.size() || triangle.y >= chunk.vecVertices.size() || triangle.z >= chunk.vecVertices.size())
+			continue;
+		const sl::float3* rgpVertices[3] = { &chunk.vecVertices[triangle.x], &chunk.vecVertices[triangle.y], &chunk.vecVertices[triangle.z] };
+		double rgflHeight[3];
+		bool bFloor = true;
+		for (int i = 0; i < 3; i++)
+		{
+			rgflHeight[i] = rgpVertices[i]->y - m_flFloorHeight;
+			bFloor = bFloor && std::fabs(rgflHeight[i]) < k_flFloorTolerance;
+		}
+
+		if (bFloor)
+		{
+			double ax = rgpVertices[0]->x, az = rgpVertices[0]->z;
+			double bx = rgpVertices[1]->x, bz = rgpVertices[1]->z;
+			double cx = rgpVertices[2]->x, cz = rgpVertices[2]->z;
+			double flArea = (bx - ax) * (cz - az) - (cx - ax) * (bz - az);
+			if (std::fabs(flArea) < 1e-9)
+				continue;
+			int nMinX = (int)std::floor(std::fmin(ax, std::fmin(bx, cx)) / k_flCellSize), nMaxX = (int)std::floor(std::fmax(ax, std::fmax(bx, cx)) / k_flCellSize);
+			int nMinZ = (int)std::floor(std::fmin(az, std::fmin(bz, cz)) / k_flCellSize), nMaxZ = (int)std::floor(std::fmax(az, std::fmax(bz, cz)) / k_flCellSize);
+			for (int z = nMinZ; z <= nMaxZ; z++)
+			{
+				for (int x = nMinX; x <= nMaxX; x++)
+				{
+					// the cell's center, in barycentric coordinates of the triangle
+					double px = (x + 0.5) * k_flCellSize, pz = (z + 0.5) * k_flCellSize;
+					double u = ((bx - px) * (cz - pz) - (cx - px) * (bz - pz)) / flArea;
+					double v = ((cx - px) * (az - pz) - (ax - px) * (cz - pz)) / flArea;
+					bool bInside = u >= 0.0 && v >= 0.0 && u + v <= 1.0;
+					// small triangles may cover no cell center at all
+					if (bInside || (x == nMinX && x == nMaxX && z == nMinZ && z == nMaxZ))
+						Mark(GetCell(px, pz), k_unFloorMark);
+				}
+			}
+			continue;
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			const sl::float3& a = *rgpVertices[i];
+			const sl::float3& b = *rgpVertices[(i + 1) % 3];
+			double flHeightA = rgflHeight[i], flHeightB = rgflHeight[(i + 1) % 3];
+			double flLength = std::sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y) + (b.z - a.z) * (b.z - a.z));
+			int nSteps = (int)(flLength / (0.5 * k_flCellSize)) + 1;
+			for (int n = 0; n <= nSteps; n++)
+			{
+				double t = (double)n / nSteps;
+				double flHeight = flHeightA + t * (flHeightB - flHeightA);
+				if (flHeight >= k_flMinObstacleHeight && flHeight <= k_flMaxObstacleHeight)
+					Mark(GetCell(a.x + t * (b.x - a.x), a.z + t * (b.z - a.z)), k_unObstacleMark);
+			}
+		}
+	}
+
+	for (uint32_t unCell : pCells->vecFloor)
+	{
+		m_vecMark[unCell] = 0;
+		m_vecFloorCount[unCell]++;
+	}
+	for (uint32_t unCell : pCells->vecObstacle)
+	{
+		m_vecMark[unCell] = 0;
+		m_vecObstacleCount[unCell]++;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The free floor 4-connected to the cell under the camera, or to the
+// one it was last over if it's above something now (a table, a wall's cell).
+//-----------------------------------------------------------------------------
+bool CChaperoneGenerator::FindRoom(const double vecCamera[3])
+{
+	auto IsFree = [this](int nCell) { return m_vecFloorCount[nCell] > 0 && m_vecObstacleCount[nCell] == 0; };
+
+	int nSeed = GetCell(vecCamera[0], vecCamera[2]);
+	if (nSeed >= 0 && IsFree(nSeed))
+		m_nSeedCell = nSeed;
+	else if (m_nSeedCell < 0 || !IsFree(m_nSeedCell))
+		return false;
+
+	std::fill(m_vecRoom.begin(), m_vecRoom.end(), 0);
+	std::vector<int> vecQueue;
+	vecQueue.push_back(m_nSeedCell);
+	m_vecRoom[m_nSeedCell] = 1;
+	for (size_t n = 0; n < vecQueue.size(); n++)
+	{
+		int nCell = vecQueue[n];
+		int x = nCell % k_nGridCells, z = nCell / k_nGridCells;
+		const int rgnNeighbors[4] = { x > 0 ? nCell - 1 : -1, x + 1 < k_nGridCells ? nCell + 1 : -1,
+			z > 0 ? nCell - k_nGridCells : -1, z + 1 < k_nGridCells ? nCell + k_nGridCells : -1 };
+		for (int nNeighbor : rgnNeighbors)
+		{
+			if (nNeighbor >= 0 && !m_vecRoom[nNeighbor] && IsFree(nNeighbor))
+			{
+				m_vecRoom[nNeighbor] = 1;
+				vecQueue.push_back(nNeighbor);
+			}
+		}
+	}
+	return vecQueue.size() * k_flCellSize * k_flCellSize >= k_flMinRoomArea;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The room's outer outline in driver x/z pairs. Every room cell side
+// facing outside is an edge, directed so the room is on its left, and the
+// edges are walked into loops. Where two room cells only touch at a corner
+// the walk turns right, into the other cell, so the loops are only split by
+// holes, whose outlines are smaller than the outer one. Collinear points are
+// dropped and the rest simplified to k_flSimplifyTolerance.
+//-----------------------------------------------------------------------------
+bool CChaperoneGenerator::TraceOutline(std::vector<double>* pvecOutline)
+{
+	const int nLattice = k_nGridCells + 1;
+	m_vecOutEdges.assign(nLattice * nLattice * 2, -1);
+	auto AddEdge = [this, nLattice](int x0, int z0, int x1, int z1) {
+		int nFrom = (z0 * nLattice + x0) * 2;
+		m_vecOutEdges[m_vecOutEdges[nFrom] < 0 ? nFrom : nFrom + 1] = z1 * nLattice + x1;
+	};
+	auto InRoom = [this](int x, int z) { return x >= 0 && z >= 0 && x < k_nGridCells && z < k_nGridCells && m_vecRoom[z * k_nGridCells + x]; };
+
+	for (int z = 0; z < k_nGridCells; z++)
+	{
+		for (int x = 0; x < k_nGridCells; x++)
+		{
+			if (!InRoom(x, z))
+				continue;
+			if (!InRoom(x, z - 1))
+				AddEdge(x, z, x + 1, z);
+			if (!InRoom(x + 1, z))
+				AddEdge(x + 1, z, x + 1, z + 1);
+			if (!InRoom(x, z + 1))
+				AddEdge(x + 1, z + 1, x, z + 1);
+			if (!InRoom(x - 1, z))
+				AddEdge(x, z + 1, x, z);
+		}
+	}
+
+	std::vector<int> vecBest, vecLoop;
+	double flBestArea = 0.0;
+	for (int nStart = 0; nStart < nLattice * nLattice; nStart++)
+	{
+		if (m_vecOutEdges[nStart * 2] < 0 && m_vecOutEdges[nStart * 2 + 1] < 0)
+			continue;
+
+		vecLoop.clear();
+		int nVertex = nStart, dx = 0, dz = 0;
+		while (true)
+		{
+			int* pnOut = &m_vecOutEdges[nVertex * 2];
+			int nSlot = pnOut[0] >= 0 ? 0 : pnOut[1] >= 0 ? 1 : -1;
+			if (nSlot < 0)
+				break;
+			if (pnOut[0] >= 0 && pnOut[1] >= 0)
+			{
+				// the right turn of (dx, dz) is (dz, -dx)
+				int nTarget = pnOut[1];
+				if (nTarget % nLattice - nVertex % nLattice == dz && nTarget / nLattice - nVertex / nLattice == -dx)
+					nSlot = 1;
+			}
+			int nNext = pnOut[nSlot];
+			pnOut[nSlot] = -1;
+			dx = nNext % nLattice - nVertex % nLattice;
+			dz = nNext / nLattice - nVertex / nLattice;
+			vecLoop.push_back(nVertex);
+			nVertex = nNext;
+		}
+
+		double flArea = 0.0;
+		for (size_t i = 0; i < vecLoop.size(); i++)
+		{
+			int a = vecLoop[i], b = vecLoop[(i + 1) % vecLoop.size()];
+			flArea += (double)(a % nLattice) * (b / nLattice) - (double)(b % nLattice) * (a / nLattice);
+		}
+		if (flArea > flBestArea)
+		{
+			flBestArea = flArea;
+			vecBest.swap(vecLoop);
+		}
+	}
+	if (vecBest.size() < 4)
+		return false;
+
+	// corners only; cell edges are axis aligned
+	std::vector<OutlinePoint_t> vecPoints;
+	for (size_t i = 0; i < vecBest.size(); i++)
+	{
+		int nPrev = vecBest[(i + vecBest.size() - 1) % vecBest.size()], nThis = vecBest[i], nNext = vecBest[(i + 1) % vecBest.size()];
+		int dx0 = nThis % nLattice - nPrev % nLattice, dz0 = nThis / nLattice - nPrev / nLattice;
+		int dx1 = nNext % nLattice - nThis % nLattice, dz1 = nNext / nLattice - nThis / nLattice;
+		if (dx0 == dx1 && dz0 == dz1)
+			continue;
+		OutlinePoint_t point = { (nThis % nLattice - k_nGridCells / 2) * k_flCellSize, (nThis / nLattice - k_nGridCells / 2) * k_flCellSize };
+		vecPoints.push_back(point);
+	}
+	if (vecPoints.size() < 3)
+		return false;
+
+	// a closed outline is two runs, from the first point to the one farthest from it and back
+	size_t nFarthest = 0;
+	double flFarthest = 0.0;
+	for (size_t i = 1; i < vecPoints.size(); i++)
+	{
+		double dx = vecPoints[i].x - vecPoints[0].x, dz = vecPoints[i].z - vecPoints[0].z;
+		if (dx * dx + dz * dz > flFarthest)
+		{
+			flFarthest = dx * dx + dz * dz;
+			nFarthest = i;
+		}
+	}
+	std::vector<uint8_t> vecKeep(vecPoints.size(), 0);
+	vecKeep[0] = 1;
+	vecKeep[nFarthest] = 1;
+	double flToleranceSquared = k_flSimplifyTolerance * k_flSimplifyTolerance;
+	SimplifyRun(vecPoints, 0, nFarthest, flToleranceSquared, &vecKeep);
+	SimplifyRun(vecPoints, nFarthest, vecPoints.size(), flToleranceSquared, &vecKeep);
+
+	pvecOutline->clear();
+	for (size_t i = 0; i < vecPoints.size(); i++)
+	{
+		if (!vecKeep[i])
+			continue;
+		pvecOutline->push_back(vecPoints[i].x);
+		pvecOutline->push_back(vecPoints[i].z);
+	}
+	return pvecOutline->size() >= 6;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: SteamVR centers the play area on the universe origin along its
+// axes, so it's the largest such rectangle on the room's floor, grown a cell
+// at a time on whichever side still fits. Zero when the origin is off the room.
+//-----------------------------------------------------------------------------
+void CChaperoneGenerator::FindPlayArea(const DriverPose_t& poseTemplate, double* pflWidth, double* pflDepth) const
+{
+	HmdQuaternion_t qDriverFromWorld = HmdQuaternion_Conjugate(poseTemplate.qWorldFromDriverRotation);
+	auto IsInRoom = [&](double x, double z) {
+		double vecWorld[3] = { x - poseTemplate.vecWorldFromDriverTranslation[0], 0.0, z - poseTemplate.vecWorldFromDriverTranslation[2] };
+		double vecDriver[3];
+		HmdQuaternion_RotateVector(qDriverFromWorld, vecWorld, vecDriver);
+		int nCell = GetCell(vecDriver[0], vecDriver[2]);
+		return nCell >= 0 && m_vecRoom[nCell] != 0;
+	};
+	// both edges of the strip at half-extent flFixed along one axis, sampled along the other up to flAlong
+	auto IsStripInRoom = [&](bool bAlongX, double flFixed, double flAlong) {
+		for (double t = -flAlong; t <= flAlong + 1e-9; t += 0.5 * k_flCellSize)
+		{
+			if (bAlongX ? !IsInRoom(t, flFixed) || !IsInRoom(t, -flFixed) : !IsInRoom(flFixed, t) || !IsInRoom(-flFixed, t))
+				return false;
+		}
+		return true;
+	};
+
+	double flHalfWidth = 0.0, flHalfDepth = 0.0;
+	if (IsInRoom(0.0, 0.0))
+	{
+		bool bGrowX = true, bGrowZ = true;
+		while (bGrowX || bGrowZ)
+		{
+			if (bGrowX)
+			{
+				bGrowX = IsStripInRoom(false, flHalfWidth + k_flCellSize, flHalfDepth);
+				if (bGrowX)
+					flHalfWidth += k_flCellSize;
+			}
+			if (bGrowZ)
+			{
+				bGrowZ = IsStripInRoom(true, flHalfDepth + k_flCellSize, flHalfWidth);
+				if (bGrowZ)
+					flHalfDepth += k_flCellSize;
+			}
+		}
+	}
+	*pflWidth = 2.0 * flHalfWidth;
+	*pflDepth = 2.0 * flHalfDepth;
+}
+
+// any point of either outline farther than the threshold from the other
+bool CChaperoneGenerator::HasMoved(const std::vector<double>& vecOutline) const
+{
+	if (m_vecWritten.empty())
+		return true;
+
+	double flThresholdSquared = m_flThreshold * m_flThreshold;
+	auto IsAway = [flThresholdSquared](const std::vector<double>& vecFrom, const std::vector<double>& vecTo) {
+		size_t nTo = vecTo.size() / 2;
+		for (size_t i = 0; i < vecFrom.size(); i += 2)
+		{
+			OutlinePoint_t p = { vecFrom[i], vecFrom[i + 1] };
+			double flNearest = HUGE_VAL;
+			for (size_t j = 0; j < nTo; j++)
+			{
+				size_t k = (j + 1) % nTo;
+				OutlinePoint_t a = { vecTo[j * 2], vecTo[j * 2 + 1] }, b = { vecTo[k * 2], vecTo[k * 2 + 1] };
+				flNearest = std::fmin(flNearest, DistanceToSegmentSquared(p, a, b));
+			}
+			if (flNearest > flThresholdSquared)
+				return true;
+		}
+		return false;
+	};
+	return IsAway(vecOutline, m_vecWritten) || IsAway(m_vecWritten, vecOutline);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: SteamVR's chaperone_info format, one universe, the walls as quads
+// from the floor up. Written next to the file and renamed over it, so
+// SteamVR never reads half of one.
+//-----------------------------------------------------------------------------
+bool CChaperoneGenerator::WriteFile(const std::vector<double>& vecOutline, double flPlayWidth, double flPlayDepth) const
+{
+	std::string sTempPath = m_sPath + ".tmp";
+	FILE* pFile = fopen(sTempPath.c_str(), "w");
+	if (!pFile)
+		return false;
+
+	fprintf(pFile, "{\n\t\"jsonid\" : \"chaperone_info\",\n\t\"universes\" : [\n\t\t{\n\t\t\t\"collision_bounds\" : [\n");
+	size_t nPoints = vecOutline.size() / 2;
+	for (size_t i = 0; i < nPoints; i++)
+	{
+		size_t j = (i + 1) % nPoints;
+		double x0 = vecOutline[i * 2], z0 = vecOutline[i * 2 + 1], x1 = vecOutline[j * 2], z1 = vecOutline[j * 2 + 1];
+		fprintf(pFile, "\t\t\t\t[ [ %.4f, 0, %.4f ], [ %.4f, %.2f, %.4f ], [ %.4f, %.2f, %.4f ], [ %.4f, 0, %.4f ] ]%s\n",
+			x0, z0, x0, k_flWallHeight, z0, x1, k_flWallHeight, z1, x1, z1, i + 1 < nPoints ? "," : "");
+	}
+	fprintf(pFile, "\t\t\t],\n\t\t\t\"play_area\" : [ %.2f, %.2f ],\n", flPlayWidth, flPlayDepth);
+	fprintf(pFile, "\t\t\t\"seated\" : { \"translation\" : [ 0, 0, 0 ], \"yaw\" : 0 },\n");
+	fprintf(pFile, "\t\t\t\"standing\" : { \"translation\" : [ 0, 0, 0 ], \"yaw\" : 0 },\n");
+	fprintf(pFile, "\t\t\t\"universeID\" : \"%llu\"\n\t\t}\n\t],\n\t\"version\" : 5\n}\n", (unsigned long long)k_ulUniverseId);
+
+	bool bOk = !ferror(pFile);
+	bOk = fclose(pFile) == 0 && bOk;
+
+#if defined(_WIN32)
+	// rename doesn't replace on Windows
+	if (bOk)
+		remove(m_sPath.c_str());
+#endif
+	if (!bOk || rename(sTempPath.c_str(), m_sPath.c_str()) != 0)
+	{
+		remove(sTempPath.c_str());
+		return false;
+	}
+	return true;
+}
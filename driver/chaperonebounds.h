@@ -0,0 +1,121 @@
+#ifndef CHAPERONEBOUNDS_H
+#define CHAPERONEBOUNDS_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "seqlock.h"
+#include "spatialmapping.h"
+#include "workerpool.h"
+
+class CZedTracker;
+
+//-----------------------------------------------------------------------------
+// Purpose: The bounds CChaperoneGenerator last wrote, for the provider
+//-----------------------------------------------------------------------------
+struct ChaperoneBounds_t
+{
+	uint32_t unRevision; // 0 until the first file was written, then counts up
+	uint32_t unWalls;
+	double flPlayWidth; // meters, x
+	double flPlayDepth; // meters, z
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Playspace bounds from the spatial map, written as a SteamVR
+// chaperone file (chaperonePath) the HMD device points SteamVR at, so an
+// installation doesn't need room setup redone by hand.
+//
+// A periodic job on the worker pool takes the chunks that changed since its
+// last run from the camera's CSpatialMapper and rasterizes only those into a
+// floor plan: a grid of k_flCellSize cells over the floor, each counting the
+// chunks that saw floor there and the chunks that saw an obstacle between
+// k_flMinObstacleHeight and k_flMaxObstacleHeight above it. The floor is the
+// driver height that lands at 0 in the universe, so it follows worldOffset
+// and autoFloorHeight; when it moves the plan is rebuilt from scratch.
+//
+// The free floor connected to the camera's position is the room. Its outline
+// is traced along the cell edges, simplified, and compared with the bounds
+// written last; only when some point of either moved more than
+// chaperoneThreshold is a new file written and a new revision published. The
+// provider takes it from RunFrame. Nothing of this runs on the tracking path.
+//-----------------------------------------------------------------------------
+class CChaperoneGenerator
+{
+public:
+	CChaperoneGenerator();
+	~CChaperoneGenerator();
+
+	/** Starts generating into sPath every flIntervalSeconds; the pool and pTracker, the camera's, must
+	* outlive Stop. Restarts with an empty floor plan. */
+	void Start(CWorkerPool* pPool, CZedTracker* pTracker, const std::string& sPath, float flIntervalSeconds, float flThreshold);
+
+	/** Waits for the job in flight; the file stays */
+	void Stop();
+
+	bool IsRunning() const { return m_tick.IsRunning(); }
+	const std::string& GetPath() const { return m_sPath; }
+
+	/** Any thread: the bounds last written, false if none were written after unSinceRevision */
+	bool TakeBounds(uint32_t unSinceRevision, ChaperoneBounds_t* pBounds) const;
+
+private:
+	CChaperoneGenerator(const CChaperoneGenerator&) = delete;
+	CChaperoneGenerator& operator=(const CChaperoneGenerator&) = delete;
+
+	static constexpr double k_flCellSize = 0.1;
+	static const int k_nGridCells = 256; // per side, centered on the driver origin
+	static constexpr double k_flFloorTolerance = 0.08;
+	static constexpr double k_flMinObstacleHeight = 0.15; // a rug or a cable isn't a wall
+	static constexpr double k_flMaxObstacleHeight = 2.0; // the ceiling isn't either
+	static constexpr double k_flWallHeight = 2.43; // SteamVR's own
+	static constexpr double k_flSimplifyTolerance = 0.15;
+	static constexpr double k_flMinRoomArea = 1.0; // square meters
+	static constexpr double k_flMaxFloorChange = 0.02;
+
+	struct ChunkCells_t
+	{
+		std::vector<uint32_t> vecFloor; // cell indices, each once
+		std::vector<uint32_t> vecObstacle;
+	};
+
+	void Tick();
+	void RasterizeChunk(const SpatialMapChunk_t& chunk, ChunkCells_t* pCells);
+	void RemoveChunk(uint32_t unChunk);
+	int GetCell(double x, double z) const;
+	bool FindRoom(const double vecCamera[3]);
+	bool TraceOutline(std::vector<double>* pvecOutline);
+	void FindPlayArea(const vr::DriverPose_t& poseTemplate, double* pflWidth, double* pflDepth) const;
+	bool HasMoved(const std::vector<double>& vecOutline) const;
+	bool WriteFile(const std::vector<double>& vecOutline, double flPlayWidth, double flPlayDepth) const;
+
+	CPeriodicJob m_tick;
+	CZedTracker* m_pTracker;
+	std::string m_sPath;
+	double m_flThreshold;
+
+	// the job's; one tick runs at a time
+	uint64_t m_ulMapVersion;
+	double m_flFloorHeight; // driver y the plan was built for
+	bool m_bHaveFloor;
+	std::unordered_map<uint32_t, ChunkCells_t> m_mapChunks;
+	std::vector<uint16_t> m_vecFloorCount;
+	std::vector<uint16_t> m_vecObstacleCount;
+	std::vector<uint8_t> m_vecMark; // scratch, per cell
+	std::vector<uint8_t> m_vecRoom; // the connected free floor of the last run
+	std::vector<int> m_vecOutEdges; // scratch, two per lattice vertex
+	std::vector<double> m_vecWritten; // outline last written, universe x/z pairs
+	vr::DriverPose_t m_lastTemplate; // world transform of the last run
+	int m_nSeedCell; // last cell the camera was over, -1 before it was over the floor
+	uint32_t m_unRevision;
+
+	CSeqLock<ChaperoneBounds_t> m_bounds;
+};
+
+#endif // CHAPERONEBOUNDS_H
@@ -0,0 +1,184 @@
+#ifndef CLOCKTRANSLATOR_H
+#define CLOCKTRANSLATOR_H
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "seqlock.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Line fitted by CClockTranslator:
+// target = ulTargetOrigin + (source - ulSourceOrigin) * (1 + flDrift) + flResidual.
+//-----------------------------------------------------------------------------
+struct ClockFit_t
+{
+	bool bValid;
+	uint64_t ulSourceOrigin;
+	uint64_t ulTargetOrigin;
+	double flDrift; // target seconds gained per source second
+	double flResidualNs; // RMS distance of the pairs from the line
+	uint32_t unPairs;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Maps timestamps of one clock onto another, here the ZED SDK's onto
+// the steady clock that SteamVR's poseTimeOffset is relative to.
+//
+// Pairs of readings go in at a few per second. Each pair is the midpoint of
+// two target readings around one source reading, and only tight brackets
+// are used, so preemption between the reads doesn't turn into offset error.
+// Least squares over the last k_unWindow pairs gives offset and drift. A
+// window of a few seconds keeps up with the slow drift of two oscillators
+// (and NTP slews of an SDK clock that follows the wall clock), while taking
+// out the jitter of any single pair.
+//
+// One thread adds pairs; the fit is published through a CSeqLock, so any
+// thread can translate.
+//-----------------------------------------------------------------------------
+class CClockTranslator
+{
+public:
+	static const uint32_t k_unWindow = 64;
+
+	CClockTranslator()
+	{
+		Reset();
+	}
+
+	/** Drops every pair, e.g. when the source clock may have jumped. Adding thread only. */
+	void Reset()
+	{
+		m_unCount = 0;
+		m_unNext = 0;
+		ClockFit_t fit = {};
+		m_fit.Write(fit);
+	}
+
+	/** ulSourceNs read between ulTargetBeforeNs and ulTargetAfterNs. False if the
+	* bracket was too wide to be useful and the pair was dropped. */
+	bool AddPair(uint64_t ulSourceNs, uint64_t ulTargetBeforeNs, uint64_t ulTargetAfterNs)
+	{
+		if (ulSourceNs == 0 || ulTargetAfterNs < ulTargetBeforeNs || ulTargetAfterNs - ulTargetBeforeNs > k_ulMaxBracketNs)
+			return false;
+
+		Pair_t& pair = m_rgPairs[m_unNext];
+		pair.ulSourceNs = ulSourceNs;
+		pair.ulTargetNs = ulTargetBeforeNs + (ulTargetAfterNs - ulTargetBeforeNs) / 2;
+		m_unNext = (m_unNext + 1) % k_unWindow;
+		if (m_unCount < k_unWindow)
+			m_unCount++;
+
+		Fit();
+		return true;
+	}
+
+	/** Any thread. False until the first pair. */
+	bool GetFit(ClockFit_t* pFit) const
+	{
+		m_fit.Read(pFit);
+		return pFit->bValid;
+	}
+
+	/** ulSourceNs on the target clock; any thread. False until the first pair. */
+	bool ToTarget(uint64_t ulSourceNs, uint64_t* pulTargetNs) const
+	{
+		ClockFit_t fit;
+		if (!GetFit(&fit))
+			return false;
+
+		double flSinceOrigin = (double)(int64_t)(ulSourceNs - fit.ulSourceOrigin);
+		*pulTargetNs = fit.ulTargetOrigin + (uint64_t)(int64_t)llround(flSinceOrigin * (1.0 + fit.flDrift));
+		return true;
+	}
+
+	/** The inverse of ToTarget */
+	bool ToSource(uint64_t ulTargetNs, uint64_t* pulSourceNs) const
+	{
+		ClockFit_t fit;
+		if (!GetFit(&fit))
+			return false;
+
+		double flSinceOrigin = (double)(int64_t)(ulTargetNs - fit.ulTargetOrigin);
+		*pulSourceNs = fit.ulSourceOrigin + (uint64_t)(int64_t)llround(flSinceOrigin / (1.0 + fit.flDrift));
+		return true;
+	}
+
+private:
+	struct Pair_t
+	{
+		uint64_t ulSourceNs;
+		uint64_t ulTargetNs;
+	};
+
+	// a good bracket is a few microseconds; one this wide was interrupted
+	static const uint64_t k_ulMaxBracketNs = 200000;
+	// below this many pairs, or this little time spread, drift isn't observable
+	static const uint32_t k_unMinPairsForDrift = 8;
+	static constexpr double k_flMinSpreadNs = 1e9;
+	// far beyond any crystal; a larger slope is a clock jump, not drift
+	static constexpr double k_flMaxDrift = 500e-6;
+
+	void Fit()
+	{
+		// relative to the newest pair, so the doubles keep nanosecond precision
+		const Pair_t& newest = m_rgPairs[(m_unNext + k_unWindow - 1) % k_unWindow];
+		double flMeanX = 0.0, flMeanY = 0.0;
+		double flMinX = 0.0, flMaxX = 0.0;
+		for (uint32_t i = 0; i < m_unCount; i++)
+		{
+			double x = (double)(int64_t)(m_rgPairs[i].ulSourceNs - newest.ulSourceNs);
+			double y = (double)(int64_t)(m_rgPairs[i].ulTargetNs - newest.ulTargetNs);
+			flMeanX += x;
+			flMeanY += y;
+			flMinX = x < flMinX ? x : flMinX;
+			flMaxX = x > flMaxX ? x : flMaxX;
+		}
+		flMeanX /= m_unCount;
+		flMeanY /= m_unCount;
+
+		double flDrift = 0.0;
+		if (m_unCount >= k_unMinPairsForDrift && flMaxX - flMinX >= k_flMinSpreadNs)
+		{
+			double flSxx = 0.0, flSxy = 0.0;
+			for (uint32_t i = 0; i < m_unCount; i++)
+			{
+				double x = (double)(int64_t)(m_rgPairs[i].ulSourceNs - newest.ulSourceNs) - flMeanX;
+				double y = (double)(int64_t)(m_rgPairs[i].ulTargetNs - newest.ulTargetNs) - flMeanY;
+				flSxx += x * x;
+				flSxy += x * y;
+			}
+			// the slope of target over source, minus the 1 both clocks share
+			flDrift = flSxx > 0.0 ? (flSxy - flSxx) / flSxx : 0.0;
+			if (fabs(flDrift) > k_flMaxDrift)
+				flDrift = 0.0;
+		}
+
+		double flResidual = 0.0;
+		for (uint32_t i = 0; i < m_unCount; i++)
+		{
+			double x = (double)(int64_t)(m_rgPairs[i].ulSourceNs - newest.ulSourceNs) - flMeanX;
+			double y = (double)(int64_t)(m_rgPairs[i].ulTargetNs - newest.ulTargetNs) - flMeanY;
+			double flError = y - x * (1.0 + flDrift);
+			flResidual += flError * flError;
+		}
+
+		// the line passes through the mean; the origin stays at the newest pair's source time
+		ClockFit_t fit;
+		fit.bValid = true;
+		fit.ulSourceOrigin = newest.ulSourceNs;
+		fit.ulTargetOrigin = newest.ulTargetNs + (uint64_t)(int64_t)llround(flMeanY - flMeanX * (1.0 + flDrift));
+		fit.flDrift = flDrift;
+		fit.flResidualNs = sqrt(flResidual / m_unCount);
+		fit.unPairs = m_unCount;
+		m_fit.Write(fit);
+	}
+
+	Pair_t m_rgPairs[k_unWindow];
+	uint32_t m_unCount;
+	uint32_t m_unNext;
+	CSeqLock<ClockFit_t> m_fit;
+};
+
+#endif // CLOCKTRANSLATOR_H
@@ -0,0 +1,52 @@
+#ifndef COSTMETER_H
+#define COSTMETER_H
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+// Purpose: Rolling load of a growing time counter, e.g. a thread's CPU time:
+// the share of wall time it went up by, as an exponential average over about
+// k_flTimeConstant seconds. 1 is one core, or one GPU kept busy. Sampled by
+// one thread at a steady interval; read by anyone.
+//
+// A counter that goes backwards was replaced, e.g. the IMU thread of a
+// reopened camera, and counts from zero.
+//-----------------------------------------------------------------------------
+class CCostMeter
+{
+public:
+	CCostMeter()
+		: m_ulLastTotalNs(0)
+		, m_ulLastSampleNs(0)
+		, m_flLoad(0.0f)
+	{
+	}
+
+	void Sample(uint64_t ulTotalNs, uint64_t ulNowNs)
+	{
+		if (m_ulLastSampleNs != 0 && ulNowNs > m_ulLastSampleNs)
+		{
+			uint64_t ulSpentNs = ulTotalNs >= m_ulLastTotalNs ? ulTotalNs - m_ulLastTotalNs : ulTotalNs;
+			double flElapsed = (ulNowNs - m_ulLastSampleNs) * 1e-9;
+			double flAlpha = flElapsed >= k_flTimeConstant ? 1.0 : flElapsed / k_flTimeConstant;
+			float flLoad = m_flLoad.load(std::memory_order_relaxed);
+			m_flLoad.store((float)(flLoad + (ulSpentNs * 1e-9 / flElapsed - flLoad) * flAlpha), std::memory_order_relaxed);
+		}
+		m_ulLastTotalNs = ulTotalNs;
+		m_ulLastSampleNs = ulNowNs;
+	}
+
+	float GetLoad() const { return m_flLoad.load(std::memory_order_relaxed); }
+
+private:
+	static constexpr double k_flTimeConstant = 10.0;
+
+	uint64_t m_ulLastTotalNs;
+	uint64_t m_ulLastSampleNs;
+	std::atomic<float> m_flLoad;
+};
+
+#endif // COSTMETER_H
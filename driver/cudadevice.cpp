@@ -0,0 +1,134 @@
+#include "cudadevice.h"
+#include "driverlog.h"
+
+static const char* GetCudaErrorString(CUresult eResult)
+{
+	const char* pchError = nullptr;
+	if (cuGetErrorString(eResult, &pchError) != CUDA_SUCCESS || !pchError)
+		return "unknown error";
+	return pchError;
+}
+
+// the device with the most multiprocessors, skipping device 0 when there is another one
+static int PickSecondaryDevice()
+{
+	int nCount = 0;
+	if (cuDeviceGetCount(&nCount) != CUDA_SUCCESS || nCount < 2)
+		return -1;
+
+	int nBest = -1;
+	int nBestSMs = 0;
+	for (int i = 1; i < nCount; i++)
+	{
+		CUdevice device;
+		int nSMs = 0;
+		int nIntegrated = 0;
+		if (cuDeviceGet(&device, i) != CUDA_SUCCESS
+			|| cuDeviceGetAttribute(&nSMs, CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT, device) != CUDA_SUCCESS)
+			continue;
+		cuDeviceGetAttribute(&nIntegrated, CU_DEVICE_ATTRIBUTE_INTEGRATED, device);
+		if (nIntegrated)
+			continue;
+		if (nSMs > nBestSMs)
+		{
+			nBest = i;
+			nBestSMs = nSMs;
+		}
+	}
+	return nBest;
+}
+
+CCudaDeviceSelection::CCudaDeviceSelection(const ZedmSettings_t& settings)
+	: m_nDevice(-1)
+	, m_cuContext(nullptr)
+{
+	CUresult eResult = cuInit(0);
+	if (eResult != CUDA_SUCCESS)
+	{
+		DriverLog("cuInit failed: %s, leaving GPU selection to the ZED SDK\n", GetCudaErrorString(eResult));
+		return;
+	}
+
+	m_nDevice = settings.nCudaDevice >= 0 ? settings.nCudaDevice : PickSecondaryDevice();
+
+	int nContextDevice = m_nDevice >= 0 ? m_nDevice : 0;
+	CUdevice device;
+	if (cuDeviceGet(&device, nContextDevice) != CUDA_SUCCESS)
+	{
+		DriverLog("CUDA device %d not found, leaving GPU selection to the ZED SDK\n", nContextDevice);
+		m_nDevice = -1;
+		return;
+	}
+
+	char rchName[256] = { 0 };
+	cuDeviceGetName(rchName, sizeof(rchName), device);
+
+	if (settings.bShareCudaContext)
+	{
+		eResult = cuDevicePrimaryCtxRetain(&m_cuContext, device);
+		if (eResult != CUDA_SUCCESS)
+		{
+			DriverLog("Unable to retain the primary context of CUDA device %d: %s\n", nContextDevice, GetCudaErrorString(eResult));
+			m_cuContext = nullptr;
+		}
+		else
+		{
+			// the SDK takes the device from the context
+			m_nDevice = nContextDevice;
+		}
+	}
+
+	if (m_nDevice >= 0)
+		DriverLog("ZED SDK on CUDA device %d (%s)%s\n", m_nDevice, rchName, m_cuContext ? ", shared primary context" : "");
+}
+
+CCudaDeviceSelection::~CCudaDeviceSelection()
+{
+	if (m_cuContext)
+	{
+		CUdevice device;
+		if (cuDeviceGet(&device, m_nDevice) == CUDA_SUCCESS)
+			cuDevicePrimaryCtxRelease(device);
+	}
+}
+
+bool CLowPriorityStream::Create()
+{
+	// the least priority is the greatest number
+	int nLeastPriority = 0;
+	int nGreatestPriority = 0;
+	if (cuCtxGetStreamPriorityRange(&nLeastPriority, &nGreatestPriority) != CUDA_SUCCESS)
+		nLeastPriority = 0;
+
+	if (cuStreamCreateWithPriority(&m_cuStream, CU_STREAM_NON_BLOCKING, nLeastPriority) != CUDA_SUCCESS)
+	{
+		m_cuStream = nullptr;
+		return false;
+	}
+	if (cuEventCreate(&m_cuQueued, CU_EVENT_DISABLE_TIMING) != CUDA_SUCCESS)
+	{
+		cuStreamDestroy(m_cuStream);
+		m_cuStream = nullptr;
+		m_cuQueued = nullptr;
+		return false;
+	}
+	return true;
+}
+
+void CLowPriorityStream::Destroy()
+{
+	if (m_cuStream)
+	{
+		cuEventDestroy(m_cuQueued);
+		cuStreamDestroy(m_cuStream);
+	}
+	m_cuStream = nullptr;
+	m_cuQueued = nullptr;
+}
+
+CUstream CLowPriorityStream::Follow(CUstream cuAfter)
+{
+	if (!m_cuStream || cuEventRecord(m_cuQueued, cuAfter) != CUDA_SUCCESS || cuStreamWaitEvent(m_cuStream, m_cuQueued, 0) != CUDA_SUCCESS)
+		return cuAfter;
+	return m_cuStream;
+}
@@ -0,0 +1,73 @@
+#ifndef CUDADEVICE_H
+#define CUDADEVICE_H
+
+#pragma once
+
+#include <cuda.h>
+
+#include "driversettings.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Chooses the GPU the ZED SDK runs its CUDA work on, for the
+// lifetime of the grab thread. By default the SDK creates a private context
+// on device 0, which is normally also the GPU the compositor renders on.
+//
+// cudaDevice >= 0 selects that device. -1 (the default) picks automatically:
+// on a machine with several CUDA devices the one with the most multiprocessors
+// other than device 0, else whatever the SDK would pick. With
+// shareCudaContext set, the SDK runs in the device's primary context instead
+// of creating its own, so other CUDA users in vrserver don't pay for context
+// switches against it.
+//-----------------------------------------------------------------------------
+class CCudaDeviceSelection
+{
+public:
+	explicit CCudaDeviceSelection(const ZedmSettings_t& settings);
+	~CCudaDeviceSelection();
+
+	/** Value for InitParameters::sdk_gpu_id, -1 lets the SDK choose */
+	int GetDevice() const { return m_nDevice; }
+
+	/** Value for InitParameters::sdk_cuda_ctx, null unless a context is shared */
+	CUcontext GetContext() const { return m_cuContext; }
+
+private:
+	CCudaDeviceSelection(const CCudaDeviceSelection&) = delete;
+	CCudaDeviceSelection& operator=(const CCudaDeviceSelection&) = delete;
+
+	int m_nDevice;
+	CUcontext m_cuContext;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: The driver's own GPU work after the SDK's, the copies into shared
+// textures: on a stream of the context's lowest priority, so the SDK's
+// tracking and any other CUDA user of the GPU get scheduled ahead of it.
+// Ordered after what is queued on the SDK's stream with an event rather
+// than running on it. Create and Destroy with the context current.
+//-----------------------------------------------------------------------------
+class CLowPriorityStream
+{
+public:
+	CLowPriorityStream()
+		: m_cuStream(nullptr)
+		, m_cuQueued(nullptr)
+	{
+	}
+
+	/** False if no stream could be created; Follow then returns the SDK's stream */
+	bool Create();
+	void Destroy();
+
+	/** The stream to queue work on that has to follow everything queued on cuAfter so far */
+	CUstream Follow(CUstream cuAfter);
+
+private:
+	CLowPriorityStream(const CLowPriorityStream&) = delete;
+	CLowPriorityStream& operator=(const CLowPriorityStream&) = delete;
+
+	CUstream m_cuStream;
+	CUevent m_cuQueued;
+};
+
+#endif // CUDADEVICE_H
@@ -0,0 +1,150 @@
+#ifndef DEADRECKONING_H
+#define DEADRECKONING_H
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+// Purpose: Carries the position forward on the accelerometer alone while
+// visual tracking is lost, for deadReckoningTime seconds.
+//
+// Accelerations are in the tracking world (Y up), gravity included, as the
+// IMU measures them rotated by the fused orientation. While tracking is good
+// the driver feeds every sample through AddTrackedSample. Since the device
+// doesn't keep accelerating, the average of those samples is gravity plus
+// the sensor's bias and the orientation error. Subtracting that average
+// leaves the motion itself. Velocity starts at the visual velocity and decays
+// with deadReckoningDamping, so leftover bias shows up as a bounded offset
+// instead of a position that runs away quadratically.
+//
+// Single threaded: owned by whichever thread publishes poses, like CPoseFusion.
+//-----------------------------------------------------------------------------
+class CDeadReckoner
+{
+public:
+	CDeadReckoner()
+		: m_ulHorizonNs(0)
+		, m_flDampingSeconds(k_flDefaultDampingSeconds)
+	{
+		Reset();
+	}
+
+	/** Horizon 0 disables dead reckoning; the pose becomes invalid as soon as tracking is lost */
+	void Configure(double flHorizonSeconds, double flDampingSeconds)
+	{
+		m_ulHorizonNs = flHorizonSeconds > 0.0 ? (uint64_t)(flHorizonSeconds * 1e9) : 0;
+		m_flDampingSeconds = flDampingSeconds > 1e-3 ? flDampingSeconds : 1e-3;
+	}
+
+	bool IsEnabled() const { return m_ulHorizonNs != 0; }
+
+	void Reset()
+	{
+		m_bActive = false;
+		m_bHaveBias = false;
+		m_ulLastBiasNs = 0;
+		m_ulStartNs = 0;
+		m_ulLastNs = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			m_vecBias[i] = 0.0;
+			m_vecPosition[i] = 0.0;
+			m_vecVelocity[i] = 0.0;
+		}
+	}
+
+	/** While visual tracking is good; ends any dead reckoning */
+	void AddTrackedSample(const double vecWorldAccel[3], uint64_t ulTimestampNs)
+	{
+		m_bActive = false;
+		if (!m_bHaveBias || ulTimestampNs <= m_ulLastBiasNs)
+		{
+			for (int i = 0; i < 3; i++)
+				m_vecBias[i] = vecWorldAccel[i];
+			m_bHaveBias = true;
+		}
+		else
+		{
+			double flAlpha = 1.0 - exp(-(ulTimestampNs - m_ulLastBiasNs) * 1e-9 / k_flBiasTimeConstant);
+			for (int i = 0; i < 3; i++)
+				m_vecBias[i] += flAlpha * (vecWorldAccel[i] - m_vecBias[i]);
+		}
+		m_ulLastBiasNs = ulTimestampNs;
+	}
+
+	/** A gravity estimate to start from, e.g. once the IMU bias is known; ignored once there is one */
+	void SeedGravity(const double vecWorldAccel[3], uint64_t ulTimestampNs)
+	{
+		if (m_bHaveBias)
+			return;
+		for (int i = 0; i < 3; i++)
+			m_vecBias[i] = vecWorldAccel[i];
+		m_bHaveBias = true;
+		m_ulLastBiasNs = ulTimestampNs;
+	}
+
+	/** First sample after tracking was lost, from the last fused position and velocity */
+	void Start(const double vecPosition[3], const double vecVelocity[3], uint64_t ulTimestampNs)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			m_vecPosition[i] = vecPosition[i];
+			m_vecVelocity[i] = vecVelocity[i];
+		}
+		m_ulStartNs = ulTimestampNs;
+		m_ulLastNs = ulTimestampNs;
+		m_bActive = true;
+	}
+
+	bool IsActive() const { return m_bActive; }
+
+	/** Integrates one sample. False when disabled, not started, without a gravity
+	* estimate yet, or once the horizon has passed. */
+	bool AddSample(const double vecWorldAccel[3], uint64_t ulTimestampNs, double vecPosition[3], double vecVelocity[3])
+	{
+		if (!m_bActive || !m_bHaveBias || ulTimestampNs - m_ulStartNs > m_ulHorizonNs)
+			return false;
+
+		if (ulTimestampNs > m_ulLastNs)
+		{
+			double flDt = (ulTimestampNs - m_ulLastNs) * 1e-9;
+			double flDecay = exp(-flDt / m_flDampingSeconds);
+			for (int i = 0; i < 3; i++)
+			{
+				// semi-implicit Euler: the new velocity moves the position
+				m_vecVelocity[i] = (m_vecVelocity[i] + (vecWorldAccel[i] - m_vecBias[i]) * flDt) * flDecay;
+				m_vecPosition[i] += m_vecVelocity[i] * flDt;
+			}
+			m_ulLastNs = ulTimestampNs;
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			vecPosition[i] = m_vecPosition[i];
+			vecVelocity[i] = m_vecVelocity[i];
+		}
+		return true;
+	}
+
+private:
+	static constexpr double k_flDefaultDampingSeconds = 0.3;
+	// long against any motion, short against the bias drifting with temperature
+	static constexpr double k_flBiasTimeConstant = 2.0;
+
+	uint64_t m_ulHorizonNs;
+	double m_flDampingSeconds;
+
+	bool m_bHaveBias;
+	uint64_t m_ulLastBiasNs;
+	double m_vecBias[3];
+
+	bool m_bActive;
+	uint64_t m_ulStartNs;
+	uint64_t m_ulLastNs;
+	double m_vecPosition[3];
+	double m_vecVelocity[3];
+};
+
+#endif // DEADRECKONING_H
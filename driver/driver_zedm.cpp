@@ -1,7 +1,37 @@
 //============ Copyright (c) Valve Corporation, All rights reserved. ============
 #include <openvr_driver.h>
+#include "bodyfusion.h"
+#include "cameradetect.h"
+#include "chaperonebounds.h"
+#include "cameraplanner.h"
 #include "driverlog.h"
-
+#include "grabberclient.h"
+#include "handskeleton.h"
+#include "memorybudget.h"
+#include "propertybatch.h"
+#include "posestream.h"
+#include "rigfusion.h"
+#include "sharedpose.h"
+#include "sharedstats.h"
+#include "spatialanchors.h"
+#include "syntheticload.h"
+#include "telemetry.h"
+#include "tracezones.h"
+#include "workerpool.h"
+#include "worldcalibration.h"
+#include "zeddisplaycomponent.h"
+#include "zedtracker.h"
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <thread>
 #include <chrono>
@@ -11,7 +41,11 @@
 #include <iostream>
 #include <iomanip>
 
+#if defined(_WIN32)
 #include <windows.h>
+#else
+#include <unistd.h>
+#endif
 
 using namespace vr;
 using namespace sl;
@@ -26,111 +60,87 @@ using namespace sl;
 #error "Unsupported Platform."
 #endif
 
-inline HmdQuaternion_t HmdQuaternion_Init(double w, double x, double y, double z)
+// IOBuffer depth of the raw IMU stream, about 2.5 s at the ZED's 400 Hz
+static const uint32_t k_unImuBufferSamples = 1024;
+
+// rereads the driver_zedm section and hands it to every tracker, see CServerDriver_Zedm::ReloadSettings
+static void ReloadDriverSettings();
+
+// File name of process unPid's executable, empty if it can't be looked up
+static std::string GetProcessExecutableName(uint32_t unPid)
 {
-	HmdQuaternion_t quat;
-	quat.w = w;
-	quat.x = x;
-	quat.y = y;
-	quat.z = z;
-	return quat;
+#if defined(_WIN32)
+	HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, unPid);
+	if (!hProcess)
+		return std::string();
+	char rchPath[MAX_PATH];
+	DWORD unLength = sizeof(rchPath);
+	bool bFound = QueryFullProcessImageNameA(hProcess, 0, rchPath, &unLength) != 0;
+	CloseHandle(hProcess);
+	if (!bFound)
+		return std::string();
+	std::string sPath(rchPath, unLength);
+#else
+	char rchPath[4096];
+	ssize_t nLength = readlink(("/proc/" + std::to_string(unPid) + "/exe").c_str(), rchPath, sizeof(rchPath));
+	if (nLength <= 0)
+		return std::string();
+	std::string sPath(rchPath, nLength);
+#endif
+	size_t unSlash = sPath.find_last_of("/\\");
+	return unSlash == std::string::npos ? sPath : sPath.substr(unSlash + 1);
 }
 
-int runPoseTracking(vr::TrackedDeviceIndex_t* m_unObjectId) {
-	try
+// predictionApps: the horizon of the "executable=seconds" pair naming sExecutable, case insensitively
+static bool FindAppPredictionHorizon(const std::string& sApps, const std::string& sExecutable, float* pflHorizon)
+{
+	size_t unStart = 0;
+	while (unStart < sApps.size())
 	{
-		// Create a ZED camera object
-		Camera zed;
-
-		// Set configuration parameters
-		InitParameters init_params;
-		init_params.camera_resolution = RESOLUTION::HD720; // Use HD720 video mode (default fps: 60)
-		init_params.coordinate_system = COORDINATE_SYSTEM::RIGHT_HANDED_Y_UP; // Use a right-handed Y-up coordinate system
-		init_params.coordinate_units = UNIT::METER; // Set units in meters
-		init_params.sensors_required = true;
-
-		// Open the camera
-		zed.open(init_params);
-		// Enable positional tracking with default parameters
-		PositionalTrackingParameters tracking_parameters;
-		zed.enablePositionalTracking(tracking_parameters);
-
-		// Track the camera position during 1000 frames
-		int i = 0;
-		Pose zed_pose;
-
-		// Check if the camera is a ZED M and therefore if an IMU is available
-		SensorsData sensor_data;
-
-		while (true)
+		size_t unEnd = sApps.find(';', unStart);
+		if (unEnd == std::string::npos)
+			unEnd = sApps.size();
+		std::string sPair = sApps.substr(unStart, unEnd - unStart);
+		unStart = unEnd + 1;
+
+		size_t unEquals = sPair.find('=');
+		if (unEquals != sExecutable.size())
+			continue;
+		bool bMatch = true;
+		for (size_t i = 0; i < unEquals && bMatch; i++)
+			bMatch = tolower((unsigned char)sPair[i]) == tolower((unsigned char)sExecutable[i]);
+		if (bMatch)
 		{
-			if (zed.grab() == ERROR_CODE::SUCCESS) {
-				zed.getPosition(zed_pose, REFERENCE_FRAME::WORLD);
-
-				// get the translation information
-				auto zed_translation = zed_pose.getTranslation();
-
-				//	Display the translation and timestamp
-				//	DriverLog("\nTranslation: Tx: %.3f, Ty: %.3f, Tz: %.3f, Timestamp: %llu\n", zed_translation.tx,
-				//	zed_translation.ty, zed_translation.tz, (long long unsigned int) zed_pose.timestamp.getNanoseconds());
-
-				// get the orientation information
-				auto zed_orientation = zed_pose.getOrientation();
-
-				// Display the orientation quaternion
-				DriverLog("Orientation: Ox: %.3f, Oy: %.3f, Oz: %.3f, Ow: %.3f\n", zed_orientation.ox,
-					zed_orientation.oy, zed_orientation.oz, zed_orientation.ow);
-
-				// Get IMU data
-				zed.getSensorsData(sensor_data, TIME_REFERENCE::IMAGE);
-
-				auto imu_orientation = sensor_data.imu.pose.getOrientation();
-
-				// Filtered orientation quaternion
-				DriverLog("IMU Orientation: Ox: %.3f, Oy: %.3f, Oz: %.3f, Ow: %.3f\n", imu_orientation.ox,
-					imu_orientation.oy, imu_orientation.oz, imu_orientation.ow);
-
-				DriverPose_t pose = { 0 };
-				pose.poseIsValid = true;
-				pose.result = TrackingResult_Running_OK;
-				pose.deviceIsConnected = true;
-
-				// TO DO: Expose to vr settings/launcher
-				pose.qWorldFromDriverRotation = HmdQuaternion_Init(1, 0, 0, 0);
-				pose.qDriverFromHeadRotation = HmdQuaternion_Init(1, 0, 0, 0);
-
-				pose.vecPosition[0] = zed_translation.tx;
-				pose.vecPosition[1] = zed_translation.ty;
-				pose.vecPosition[2] = zed_translation.tz;
-
-				pose.qRotation.w = imu_orientation.ow;
-				pose.qRotation.x = imu_orientation.ox;
-				pose.qRotation.y = imu_orientation.oy;
-				pose.qRotation.z = imu_orientation.oz;
-
-				if (*m_unObjectId != vr::k_unTrackedDeviceIndexInvalid)
-				{
-					vr::VRServerDriverHost()->TrackedDevicePoseUpdated(*m_unObjectId, pose, sizeof(DriverPose_t));
-				}
-			}
+			*pflHorizon = strtof(sPair.c_str() + unEquals + 1, nullptr);
+			return true;
 		}
-		// Disable positional tracking and close the camera
-		zed.disablePositionalTracking();
-		zed.close();
-		return EXIT_SUCCESS;
-	}
-	catch (const std::exception& e)
-	{
-		DriverLog("%s\n", e.what());
-		return EXIT_FAILURE;
 	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: snprintf onto the end of a DebugRequest response; output past the
+// end of the buffer is dropped.
+//-----------------------------------------------------------------------------
+static void AppendResponse(char* pchBuffer, uint32_t unBufferSize, uint32_t* punOffset, const char* pchFormat, ...)
+{
+	if (*punOffset >= unBufferSize)
+		return;
+
+	va_list args;
+	va_start(args, pchFormat);
+	int nWritten = vsnprintf(pchBuffer + *punOffset, unBufferSize - *punOffset, pchFormat, args);
+	va_end(args);
 
+	if (nWritten > 0)
+		*punOffset += (uint32_t)nWritten;
 }
 
-// keys for use with the settings API
-static const char* const k_pch_Sample_Section = "driver_zedm";
-static const char* const k_pch_Sample_SerialNumber_String = "serialNumber";
-static const char* const k_pch_Sample_ModelNumber_String = "modelNumber";
+static void AppendAllocationCounts(char* pchBuffer, uint32_t unBufferSize, uint32_t* punOffset, const char* pchThread, const AllocationCounts_t& counts)
+{
+	AppendResponse(pchBuffer, unBufferSize, punOffset, "\"%s\":{\"new\":%llu,\"delete\":%llu,\"bytes\":%llu}", pchThread,
+		(unsigned long long)counts.ulAllocations, (unsigned long long)counts.ulFrees, (unsigned long long)counts.ulBytes);
+}
 
 //-----------------------------------------------------------------------------
 // Purpose:This part of the code sets up the actual device as far as SteamVR is concerned. (note that device type is determined by the CServerDriver_Zedm (Currently line 256)
@@ -138,18 +148,80 @@ static const char* const k_pch_Sample_ModelNumber_String = "modelNumber";
 class CZedmDriver : public vr::ITrackedDeviceServerDriver
 {
 public:
-	CZedmDriver()
+	CZedmDriver(const ZedmSettings_t& settings, unsigned int unCameraSerial, CWorkerPool* pWorkerPool)
+		: m_pSettings(std::make_shared<ZedmSettings_t>(settings))
+		, m_unCameraSerial(unCameraSerial)
 	{
+		m_zedTracker.SetWorkerPool(pWorkerPool);
 		m_unObjectId = vr::k_unTrackedDeviceIndexInvalid;
 		m_ulPropertyContainer = vr::k_ulInvalidPropertyContainer;
-		// TO DO: Plugin actual info
-		m_sSerialNumber = "CTRL_1234";
-
-		m_sModelNumber = "MyController";
+		m_unLastPoseSequence = 0;
+		m_ulImuBuffer = vr::k_ulInvalidIOBufferHandle;
+		m_ulSharedStatsNs = 0;
+		m_pRigFusion = nullptr;
+		m_bPlaced = false;
+		m_pMemoryBudget = std::make_shared<MemoryBudget_t>();
+		// receiver mode: the poses come from a ZED on another machine, see posestream.h
+		m_pRemote = settings.nRemotePort != 0 ? new CPoseStreamReceiver() : nullptr;
+		// grabber mode: the camera is in a helper process, see grabberclient.h
+		m_pGrabber = !m_pRemote && !settings.sGrabberPath.empty() ? new CGrabberClient() : nullptr;
+		m_pDisplay = settings.bHmdMode ? new CZedDisplayComponent(settings) : nullptr;
+		// the camera's own serial and model; a replay, or a camera the SDK didn't
+		// list, only has them once it is open, which is after the device is added
+		if (m_pRemote)
+		{
+			m_sSerialNumber = "ZED_REMOTE";
+			m_sModelNumber = "ZED (remote)";
+		}
+		else if (m_pGrabber)
+		{
+			m_sSerialNumber = k_pchGrabberSerialNumber;
+			m_sModelNumber = "ZED (grabber)";
+		}
+		else if (unCameraSerial)
+		{
+			m_sSerialNumber = "ZED_" + std::to_string(unCameraSerial);
+			m_sModelNumber = GetZedModelName(unCameraSerial);
+		}
+		else
+		{
+			m_sSerialNumber = settings.sSvoPath.empty() ? "ZED" : "ZED_REPLAY";
+			m_sModelNumber = "ZED";
+		}
 	}
 
 	virtual ~CZedmDriver()
 	{
+		delete m_pRemote;
+		delete m_pGrabber;
+		delete m_pDisplay;
+	}
+
+	bool IsHmd() const { return m_pDisplay != nullptr; }
+
+	/** From the provider, before the device is added: the device is a rig's and
+	* shows its fused pose instead of the camera's */
+	void SetRigFusion(CRigFusion* pRigFusion) { m_pRigFusion = pRigFusion; }
+
+	/** From the provider, before tracking starts: cameraPlanner's placement, already in
+	* the settings it was constructed with, kept through reloads and reported in the stats */
+	void SetCameraPlacement(const CameraPlacement_t& placement)
+	{
+		m_placement = placement;
+		m_bPlaced = true;
+	}
+
+	/** From the provider, before tracking starts: the memory budget, likewise already applied */
+	void SetMemoryBudget(const MemoryBudget_t& budget) { std::atomic_store(&m_pMemoryBudget, std::shared_ptr<const MemoryBudget_t>(std::make_shared<MemoryBudget_t>(budget))); }
+
+	/** From the provider, before the device is added: the camera opens and the
+	* tracking starts up while SteamVR registers the device, instead of after Activate */
+	void StartTracking()
+	{
+		if (m_pRemote || m_pGrabber)
+			return;
+		if (!m_zedTracker.Start(*std::atomic_load(&m_pSettings), m_unCameraSerial))
+			DriverLog("Unable to create tracking thread\n");
 	}
 
 
@@ -158,46 +230,151 @@ public:
 		m_unObjectId = unObjectId;
 		m_ulPropertyContainer = vr::VRProperties()->TrackedDeviceToPropertyContainer(m_unObjectId);
 
-		vr::VRProperties()->SetStringProperty(m_ulPropertyContainer, Prop_ModelNumber_String, m_sModelNumber.c_str());
-		vr::VRProperties()->SetStringProperty(m_ulPropertyContainer, Prop_RenderModelName_String, m_sModelNumber.c_str());
+		// all in one round trip, there can be many devices per driver
+		CPropertyBatch properties;
+		properties.SetString(Prop_ModelNumber_String, m_sModelNumber);
+		properties.SetString(Prop_ManufacturerName_String, "Stereolabs");
+		properties.SetString(Prop_RenderModelName_String, "{htc}vr_tracker_vive_1_0");
 
 		// return a constant that's not 0 (invalid) or 1 (reserved for Oculus)
-		vr::VRProperties()->SetUint64Property(m_ulPropertyContainer, Prop_CurrentUniverseId_Uint64, 27);
+		properties.SetUint64(Prop_CurrentUniverseId_Uint64, 27);
 
 		// avoid "not fullscreen" warnings from vrmonitor |Fullscreen error still present
-		vr::VRProperties()->SetBoolProperty(m_ulPropertyContainer, Prop_IsOnDesktop_Bool, false);
+		properties.SetBool(Prop_IsOnDesktop_Bool, false);
 
 		// The Realsense Driver is intended to be a tracked device yall
-		vr::VRProperties()->SetBoolProperty(m_ulPropertyContainer, Prop_NeverTracked_Bool, false);
+		properties.SetBool(Prop_NeverTracked_Bool, false);
 
 		// our device is not a controller, it's a generic tracker | No Change upon commenting line out. | very confusing because at one point this did *something* maybe.
-		vr::VRProperties()->SetInt32Property(m_ulPropertyContainer, Prop_ControllerRoleHint_Int32, TrackedControllerRole_OptOut);
+		// In hmdMode it's the headset, with a display instead of a role.
+		if (m_pDisplay)
+			m_pDisplay->AddProperties(&properties);
+		else
+			properties.SetInt32(Prop_ControllerRoleHint_Int32, TrackedControllerRole_OptOut);
+
+		if (m_pRemote || m_pGrabber)
+		{
+			properties.Write(m_ulPropertyContainer);
+			DriverLog("Driver has been initialized\n");
+			return m_pRemote ? ActivateRemote() : ActivateGrabber();
+		}
+
+		// the ZED's rectified stereo pair, served by CZedCameraComponent
+		properties.SetBool(Prop_HasCamera_Bool, true);
+		properties.SetInt32(Prop_NumCameras_Int32, 2);
+		properties.SetInt32(Prop_CameraFrameLayout_Int32, EVRTrackedCameraFrameLayout_Stereo | EVRTrackedCameraFrameLayout_HorizontalLayout);
+		properties.SetInt32(Prop_CameraStreamFormat_Int32, CVS_FORMAT_RGB24);
+		properties.SetString(Prop_InputProfilePath_String, "{zedm}/input/zedm_tracker_profile.json");
+		properties.Write(m_ulPropertyContainer);
+
+		// the tracking state for applications to fade content by, see CZedTracker::SetConfidenceComponent
+		vr::VRInputComponentHandle_t ulConfidence;
+		if (vr::VRDriverInput()->CreateScalarComponent(m_ulPropertyContainer, "/input/tracking/confidence", &ulConfidence,
+			VRScalarType_Absolute, VRScalarUnits_NormalizedOneSided) == VRInputError_None)
+		{
+			if (m_pRigFusion)
+				m_pRigFusion->SetConfidenceComponent(ulConfidence);
+			else
+				m_zedTracker.SetConfidenceComponent(ulConfidence);
+		}
+		else
+			DriverLog("Unable to create the tracking confidence input\n");
 
 		DriverLog("Driver has been initialized\n");
 
-		// pose thread for zedm
-		m_pPoseThread = new std::thread(runPoseTracking, &m_unObjectId);
-		if (!m_pPoseThread)
+		if (OpenImuBuffer())
+			m_zedTracker.SetImuBuffer(m_ulImuBuffer);
+
+		std::shared_ptr<const ZedmSettings_t> pSettings = std::atomic_load(&m_pSettings);
+		if (pSettings->bSharedMemoryExport && m_sharedPoses.Open(GetSharedPoseName(m_sSerialNumber)))
+			m_zedTracker.SetSharedPoseWriter(&m_sharedPoses);
+		if (pSettings->bSharedMemoryExport)
+			m_sharedStats.Open(GetSharedStatsName(m_sSerialNumber));
+
+		// the pose threads are usually running since StartTracking, this only passes the
+		// settings on; after a Deactivate it resumes the parked grab thread. A rig's
+		// poses are submitted by the fusion thread, not the camera's.
+		if (m_pRigFusion)
+			m_pRigFusion->SetObjectId(m_unObjectId);
+		else
+			m_zedTracker.SetObjectId(m_unObjectId);
+		if (!m_zedTracker.Start(*pSettings, m_unCameraSerial))
 		{
 			DriverLog("Unable to create tracking thread\n");
 			return VRInitError_Driver_Failed;
 		}
 
+		// still opening the camera: show the device as initializing rather than lost
+		DriverPose_t pose;
+		if (m_zedTracker.ReadPose(&pose) == 0 && (!m_pRigFusion || m_pRigFusion->ReadPose(&pose) == 0))
+		{
+			m_zedTracker.GetPoseTemplate(&pose);
+			pose.poseIsValid = false;
+			pose.result = TrackingResult_Calibrating_InProgress;
+			vr::VRServerDriverHost()->TrackedDevicePoseUpdated(m_unObjectId, pose, sizeof(DriverPose_t));
+		}
+
 		return VRInitError_None;
 	}
 
 	virtual void Deactivate()
 	{
 		m_unObjectId = vr::k_unTrackedDeviceIndexInvalid;
+		if (m_pRemote)
+		{
+			// the receive thread keeps running, a reactivation picks up the stream where it is
+			m_pRemote->SetObjectId(m_unObjectId);
+			return;
+		}
+		if (m_pGrabber)
+		{
+			// the poll thread and the helper keep running too
+			m_pGrabber->SetObjectId(m_unObjectId);
+			m_pGrabber->SetImuBuffer(vr::k_ulInvalidIOBufferHandle);
+			CloseImuBuffer();
+			return;
+		}
+		m_zedTracker.SetObjectId(m_unObjectId);
+		m_zedTracker.SetConfidenceComponent(vr::k_ulInvalidInputComponentHandle);
+		if (m_pRigFusion)
+		{
+			m_pRigFusion->SetObjectId(m_unObjectId);
+			m_pRigFusion->SetConfidenceComponent(vr::k_ulInvalidInputComponentHandle);
+		}
+
+		// vrserver is shutting down or the device is going away; keep what was mapped
+		m_zedTracker.RequestAreaSave();
+
+		// the camera stays open until the driver is cleaned up, so a reactivation is immediate
+		m_zedTracker.Pause();
+
+		m_zedTracker.SetImuBuffer(vr::k_ulInvalidIOBufferHandle);
+		CloseImuBuffer();
+
+		m_zedTracker.SetSharedPoseWriter(nullptr);
+		m_sharedPoses.Close();
+		m_sharedStats.Close();
 	}
 
 	virtual void EnterStandby()
 	{
+		if (std::atomic_load(&m_pSettings)->bStandbyPause)
+			m_zedTracker.SetStandby(true);
+	}
+
+	/** From the provider's LeaveStandby, SteamVR doesn't tell devices */
+	void LeaveStandby()
+	{
+		m_zedTracker.SetStandby(false);
 	}
 
 	void* GetComponent(const char* pchComponentNameAndVersion)
 	{
-		// override this to add a component to a driver
+		if (m_pDisplay && strcmp(pchComponentNameAndVersion, vr::IVRDisplayComponent_Version) == 0)
+			return m_pDisplay;
+		if (!m_pRemote && !m_pGrabber && strcmp(pchComponentNameAndVersion, vr::IVRCameraComponent_Version) == 0)
+			return m_zedTracker.GetCameraComponent();
+
 		return NULL;
 	}
 
@@ -205,34 +382,412 @@ public:
 	{
 	}
 
-	/** debug request from a client */
+	/** debug request from a client.
+	* "stats": JSON object with the tracker's live figures and latency percentiles
+	* "latency": the per-stage latency histograms as text
+	* "latency_reset": clears the latency histograms
+	* "profile <name>": switches the camera profile
+	* "reload_settings": rereads the driver_zedm settings for all devices
+	* "save_area": saves the tracking map to areaFilePath in the background
+	* "record start", "record stop": records the camera to svoRecordPath; "record": the file being recorded
+	* "passthrough": JSON with the GPU passthrough textures' shared handles and the newest one
+	* "occlusion": JSON with the reduced-resolution depth textures' size, shared handles and the newest one
+	* "proximity": JSON with the nearest obstacle distance in each sector around the user
+	* "spatial_map [version]": JSON with the map version and the chunks changed since version, 0 or none for all */
 	virtual void DebugRequest(const char* pchRequest, char* pchResponseBuffer, uint32_t unResponseBufferSize)
 	{
-		if (unResponseBufferSize >= 1)
-			pchResponseBuffer[0] = 0;
+		if (unResponseBufferSize < 1)
+			return;
+		pchResponseBuffer[0] = 0;
+		uint32_t unOffset = 0;
+		std::shared_ptr<const ZedmSettings_t> pSettings = std::atomic_load(&m_pSettings);
+
+		if (m_pRemote && strcmp(pchRequest, "stats") == 0)
+		{
+			PoseStreamStats_t stats;
+			m_pRemote->GetStats(&stats);
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset,
+				"{\"serial\":\"%s\",\"remote_port\":%d,\"connected\":%s,\"received\":%llu,\"lost\":%llu,\"late\":%llu,\"malformed\":%llu,"
+				"\"clock_offset_ms\":%.3f,\"jitter_ms\":%.3f,\"buffer_delay_ms\":%.1f,\"log_queue_depth\":%u,\"log_dropped\":%llu}",
+				m_sSerialNumber.c_str(), pSettings->nRemotePort, stats.bConnected ? "true" : "false", (unsigned long long)stats.ulReceived,
+				(unsigned long long)stats.ulLost, (unsigned long long)stats.ulLate, (unsigned long long)stats.ulMalformed,
+				stats.flClockOffsetMs, stats.flJitterMs, stats.flBufferDelayMs, GetDriverLogQueueDepth(), (unsigned long long)GetDriverLogDroppedCount());
+
+			if (unOffset >= unResponseBufferSize)
+				pchResponseBuffer[0] = 0;
+		}
+		else if (m_pGrabber && strcmp(pchRequest, "stats") == 0)
+		{
+			GrabberClientStats_t stats;
+			m_pGrabber->GetStats(&stats);
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset,
+				"{\"serial\":\"%s\",\"grabber_running\":%s,\"grabber_launches\":%u,\"connected\":%s,\"submitted\":%llu,\"coalesced\":%llu,"
+				"\"imu_samples\":%llu,\"log_queue_depth\":%u,\"log_dropped\":%llu}",
+				m_sSerialNumber.c_str(), stats.bProcessRunning ? "true" : "false", stats.unLaunches, stats.bConnected ? "true" : "false",
+				(unsigned long long)stats.ulSubmitted, (unsigned long long)stats.ulCoalesced, (unsigned long long)stats.ulImuSamples,
+				GetDriverLogQueueDepth(), (unsigned long long)GetDriverLogDroppedCount());
+
+			if (unOffset >= unResponseBufferSize)
+				pchResponseBuffer[0] = 0;
+		}
+		else if (strcmp(pchRequest, "stats") == 0)
+		{
+			ZedTrackerStats_t stats;
+			m_zedTracker.GetStats(&stats);
+
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset,
+				"{\"serial\":\"%s\",\"grab_fps\":%.2f,\"frames_grabbed\":%llu,\"frames_dropped\":%u,\"grab_failures\":%llu,\"recorder_dropped\":%llu,"
+				"\"tracking_state\":\"%s\",\"imu_publisher\":%s,\"imu_rate\":%.1f,\"imu_samples\":%llu,\"imu_missed\":%llu,\"imu_skipped\":%llu,\"imu_bias\":\"%s\","
+				"\"pose_publish_rate\":%.1f,\"poses_published\":%llu,\"pose_thread_cpu_s\":%.3f,\"imu_thread_cpu_s\":%.3f,"
+				"\"log_queue_depth\":%u,\"log_dropped\":%llu,\"camera_profile\":\"%s\",\"relocalizing\":%s,\"floor_height\":%.3f,\"floor_detected\":%s,"
+				"\"grab_divisor\":%d,\"motion_energy\":%.1f,\"gpu_load\":%.2f,\"frame_cpu_ms\":%.2f,\"poses_deduplicated\":%llu,\"dead_reckoning\":%s,\"tracking_losses\":%llu,"
+				"\"clock_fit\":%s,\"clock_drift_ppm\":%.2f,\"clock_residual_us\":%.1f,\"grab_stalled\":%s,\"grab_stalls\":%llu,"
+				"\"cpu_load\":{\"grab\":%.3f,\"imu\":%.3f,\"workers\":%.3f},\"gpu_copy_load\":{\"passthrough\":%.4f,\"mr_capture\":%.4f,\"occlusion\":%.4f,\"proximity\":%.4f},\"latency_us\":{",
+				m_sSerialNumber.c_str(), stats.flGrabFps, (unsigned long long)stats.ulFramesGrabbed, stats.unFramesDropped,
+				(unsigned long long)stats.ulGrabFailures, (unsigned long long)stats.ulRecorderDropped, sl::toString(stats.eTrackingState).c_str(),
+				stats.bImuPublisherRunning ? "true" : "false", stats.flImuRate, (unsigned long long)stats.ulImuSamples,
+				(unsigned long long)stats.ulImuSamplesMissed, (unsigned long long)stats.ulImuSamplesSkipped,
+				stats.bImuBiasEstimated ? "estimated" : stats.bImuBiasCached ? "cached" : "none", stats.flPosePublishRate, (unsigned long long)stats.ulPosesPublished, stats.flPoseThreadCpuSeconds,
+				stats.flImuThreadCpuSeconds, GetDriverLogQueueDepth(), (unsigned long long)GetDriverLogDroppedCount(),
+				GetCameraProfile(stats.eCameraProfile).pchName, stats.bRelocalizing ? "true" : "false",
+				stats.flFloorHeight, stats.bFloorDetected ? "true" : "false", stats.nGrabDivisor, stats.flMotionEnergy, stats.flGpuLoad, stats.flFrameCpuMs,
+				(unsigned long long)stats.ulPosesDeduplicated, stats.bDeadReckoning ? "true" : "false", (unsigned long long)stats.ulTrackingLosses,
+				stats.bClockFit ? "true" : "false", stats.flClockDriftPpm, stats.flClockResidualUs,
+				stats.bGrabStalled ? "true" : "false", (unsigned long long)stats.ulGrabStalls,
+				stats.flGrabCpuLoad, stats.flImuCpuLoad, stats.flWorkerCpuLoad, stats.flPassthroughGpuLoad,
+				stats.flMrCaptureGpuLoad, stats.flOcclusionGpuLoad, stats.flProximityGpuLoad);
+
+			for (int i = 0; i < LatencyStage_Count; i++)
+			{
+				LatencySummary_t summary = m_zedTracker.GetLatencySummary((ELatencyStage)i);
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset,
+					"%s\"%s\":{\"n\":%llu,\"p50\":%.0f,\"p95\":%.0f,\"p99\":%.0f,\"max\":%.0f}", i ? "," : "",
+					GetLatencyStageName((ELatencyStage)i), (unsigned long long)summary.ulCount, summary.flP50Us,
+					summary.flP95Us, summary.flP99Us, summary.flMaxUs);
+			}
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "}");
+
+			if (stats.recording.bRequested || stats.recording.ulFramesRecorded)
+			{
+				const SvoRecordingStats_t& recording = stats.recording;
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset,
+					",\"recording\":{\"active\":%s,\"recorded\":%llu,\"skipped\":%llu,\"failed\":%llu,\"segments\":%u,\"bitrate_kbps\":%u,"
+					"\"frame_divisor\":%d,\"compression_ms\":%.2f}",
+					recording.bRecording ? "true" : "false", (unsigned long long)recording.ulFramesRecorded, (unsigned long long)recording.ulFramesSkipped,
+					(unsigned long long)recording.ulFramesFailed, recording.unSegments, recording.unBitrateKbps, recording.nFrameDivisor, recording.flCompressionMs);
+			}
+
+			if (!pSettings->sMarkerIds.empty())
+			{
+				CZedMarkerTracker* pMarkers = m_zedTracker.GetMarkerTracker();
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, ",\"markers\":{\"detections\":%llu,\"detection_ms\":%.2f}",
+					(unsigned long long)pMarkers->GetDetectionCount(), pMarkers->GetDetectionMs());
+			}
+
+			if (m_bPlaced)
+			{
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset,
+					",\"placement\":{\"usb_controller\":\"%s\",\"usb_mbps\":%u,\"profile_ceiling\":\"%s\",\"bandwidth_mbps\":%.0f,\"cuda_device\":%d,\"cpu_mask\":\"0x%llx\"}",
+					m_placement.sUsbController.c_str(), m_placement.unUsbSpeedMbps, GetCameraProfile(m_placement.eProfileCeiling).pchName,
+					GetCameraProfileBandwidthMbps(m_placement.eProfileCeiling), m_placement.nCudaDevice, (unsigned long long)m_placement.ulCpuMask);
+			}
+
+			// the estimate of this camera next to what the process and the GPU really hold
+			double flProcessMb = 0.0;
+			GetProcessMemoryMb(&flProcessMb);
+			std::shared_ptr<const MemoryBudget_t> pMemoryBudget = std::atomic_load(&m_pMemoryBudget);
+			const MemoryFootprint_t& footprint = pMemoryBudget->estimate;
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset,
+				",\"memory\":{\"budget_host_mb\":%d,\"budget_gpu_mb\":%d,\"estimate_host_mb\":%.0f,\"estimate_gpu_mb\":%.0f,\"fits\":%s,"
+				"\"process_host_mb\":%.0f,\"gpu_used_mb\":%.0f,\"gpu_total_mb\":%.0f,\"items\":{",
+				pSettings->nMemoryBudgetHost, pSettings->nMemoryBudgetGpu, footprint.flHostMb, footprint.flGpuMb, pMemoryBudget->bFits ? "true" : "false",
+				flProcessMb, stats.flGpuUsedMb, stats.flGpuTotalMb);
+			for (int i = 0; i < MemoryItem_Count; i++)
+			{
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "%s\"%s\":{\"host\":%.1f,\"gpu\":%.1f}", i ? "," : "",
+					GetMemoryItemName((EMemoryItem)i), footprint.rgflHostMb[i], footprint.rgflGpuMb[i]);
+			}
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "},\"trimmed\":[");
+			for (int i = 0, nListed = 0; i < MemoryTrim_Count; i++)
+			{
+				if (pMemoryBudget->unTrims & (1u << i))
+					AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "%s\"%s\"", nListed++ ? "," : "", GetMemoryTrimName(i));
+			}
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "]}");
+
+			// heap calls of each pose thread since it started; steady tracking adds none
+			if (AllocationAuditEnabled())
+			{
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, ",\"allocations\":{");
+				AppendAllocationCounts(pchResponseBuffer, unResponseBufferSize, &unOffset, "grab", stats.grabAllocations);
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, ",");
+				AppendAllocationCounts(pchResponseBuffer, unResponseBufferSize, &unOffset, "imu", stats.imuAllocations);
+				if (m_pRigFusion)
+				{
+					AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, ",");
+					AppendAllocationCounts(pchResponseBuffer, unResponseBufferSize, &unOffset, "rig", m_pRigFusion->GetAllocationCounts());
+				}
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "}");
+			}
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "}");
+
+			// a truncated object is worse than none
+			if (unOffset >= unResponseBufferSize)
+				pchResponseBuffer[0] = 0;
+		}
+		else if (strcmp(pchRequest, "latency") == 0)
+		{
+			for (int i = 0; i < LatencyStage_Count; i++)
+			{
+				LatencySummary_t summary = m_zedTracker.GetLatencySummary((ELatencyStage)i);
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset,
+					"%s: n=%llu p50=%.0fus p95=%.0fus p99=%.0fus max=%.0fus\n", GetLatencyStageName((ELatencyStage)i),
+					(unsigned long long)summary.ulCount, summary.flP50Us, summary.flP95Us, summary.flP99Us, summary.flMaxUs);
+			}
+		}
+		else if (strcmp(pchRequest, "latency_reset") == 0)
+		{
+			m_zedTracker.ResetLatencyStats();
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "ok");
+		}
+		else if (strcmp(pchRequest, "reload_settings") == 0)
+		{
+			ReloadDriverSettings();
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "ok");
+		}
+		else if (strcmp(pchRequest, "save_area") == 0)
+		{
+			if (pSettings->sAreaFilePath.empty())
+			{
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "no areaFilePath");
+				return;
+			}
+			m_zedTracker.RequestAreaSave();
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "ok");
+		}
+		else if (strcmp(pchRequest, "record start") == 0 || strcmp(pchRequest, "record stop") == 0)
+		{
+			bool bRecord = strcmp(pchRequest, "record start") == 0;
+			if (bRecord && pSettings->sSvoRecordPath.empty())
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "no svoRecordPath");
+			else if (!m_zedTracker.RequestRecording(bRecord))
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "not available during replay");
+			else
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "ok");
+		}
+		else if (strcmp(pchRequest, "record") == 0)
+		{
+			std::string sFileName = m_zedTracker.GetRecordingFileName();
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "%s", sFileName.empty() ? "not recording" : sFileName.c_str());
+		}
+		else if (strcmp(pchRequest, "passthrough") == 0)
+		{
+			GpuPassthroughInfo_t info;
+			if (!m_zedTracker.GetGpuPassthroughInfo(&info))
+			{
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "not available");
+				return;
+			}
+
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset,
+				"{\"width\":%u,\"height\":%u,\"format\":\"B8G8R8A8_UNORM\",\"latest\":%d,\"sequence\":%u,\"timestamp_ns\":%llu,\"handles\":[",
+				info.unWidth, info.unHeight, info.nLatestBuffer, info.unFrameSequence, (unsigned long long)info.ulImageTimestampNs);
+			for (int i = 0; i < info.nBufferCount; i++)
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "%s%llu", i ? "," : "", (unsigned long long)info.rgulSharedHandles[i]);
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "]}");
+
+			if (unOffset >= unResponseBufferSize)
+				pchResponseBuffer[0] = 0;
+		}
+		else if (strcmp(pchRequest, "occlusion") == 0)
+		{
+			OcclusionDepthInfo_t info;
+			if (!m_zedTracker.GetOcclusionDepthInfo(&info))
+			{
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "not available");
+				return;
+			}
+
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset,
+				"{\"width\":%u,\"height\":%u,\"divisor\":%u,\"format\":\"R32_FLOAT\",\"latest\":%d,\"sequence\":%u,\"timestamp_ns\":%llu,\"handles\":[",
+				info.unWidth, info.unHeight, info.unDivisor, info.nLatestBuffer, info.unFrameSequence, (unsigned long long)info.ulImageTimestampNs);
+			for (int i = 0; i < k_nOcclusionDepthBuffers; i++)
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "%s%llu", i ? "," : "", (unsigned long long)info.rgulSharedHandles[i]);
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "]}");
+
+			if (unOffset >= unResponseBufferSize)
+				pchResponseBuffer[0] = 0;
+		}
+		else if (strcmp(pchRequest, "proximity") == 0)
+		{
+			ProximitySectors_t sectors;
+			if (!m_zedTracker.GetProximitySectors(&sectors))
+			{
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "not available");
+				return;
+			}
+
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset,
+				"{\"first_angle\":%.4f,\"sector_angle\":%.4f,\"range\":%.2f,\"sequence\":%u,\"timestamp_ns\":%llu,\"distances\":[",
+				sectors.flFirstAngle, sectors.flSectorAngle, sectors.flRange, sectors.unFrameSequence, (unsigned long long)sectors.ulImageTimestampNs);
+			for (uint32_t i = 0; i < sectors.unSectors; i++)
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "%s%.3f", i ? "," : "", sectors.rgflDistance[i]);
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "]}");
+
+			if (unOffset >= unResponseBufferSize)
+				pchResponseBuffer[0] = 0;
+		}
+		else if (strncmp(pchRequest, "spatial_map", 11) == 0 && (pchRequest[11] == 0 || pchRequest[11] == ' '))
+		{
+			unsigned long long ulSinceVersion = pchRequest[11] ? strtoull(pchRequest + 12, nullptr, 10) : 0;
+			std::vector<SpatialMapChunkDelta_t> vecChanged;
+			const CSpatialMapper& mapper = m_zedTracker.GetSpatialMapper();
+			uint64_t ulVersion = mapper.GetChangedChunks(ulSinceVersion, &vecChanged);
+
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "{\"state\":\"%s\",\"version\":%llu,\"changed\":[",
+				sl::toString(mapper.GetState()).c_str(), (unsigned long long)ulVersion);
+			for (size_t i = 0; i < vecChanged.size(); i++)
+			{
+				const SpatialMapChunkDelta_t& delta = vecChanged[i];
+				if (delta.pChunk)
+					AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "%s{\"chunk\":%u,\"version\":%llu,\"vertices\":%u,\"triangles\":%u}",
+						i ? "," : "", delta.unChunk, (unsigned long long)delta.ulVersion, (unsigned)delta.pChunk->vecVertices.size(), (unsigned)delta.pChunk->vecTriangles.size());
+				else
+					AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "%s{\"chunk\":%u,\"version\":%llu,\"removed\":true}",
+						i ? "," : "", delta.unChunk, (unsigned long long)delta.ulVersion);
+			}
+			AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "]}");
+
+			if (unOffset >= unResponseBufferSize)
+				pchResponseBuffer[0] = 0;
+		}
+		else if (strncmp(pchRequest, "profile ", 8) == 0)
+		{
+			ECameraProfile eProfile;
+			if (!FindCameraProfile(pchRequest + 8, &eProfile))
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "unknown profile");
+			else if (!m_zedTracker.RequestCameraProfile(eProfile))
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "not available during replay");
+			else
+				AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset, "ok");
+		}
 	}
 
-	virtual DriverPose_t GetPose() // hook in the realsense here bois
+	virtual DriverPose_t GetPose()
 	{
 		DriverPose_t pose = { 0 };
-		pose.poseIsValid = true;
-		pose.result = TrackingResult_Running_OK;
-		pose.deviceIsConnected = true;
+		std::shared_ptr<const ZedmSettings_t> pSettings = std::atomic_load(&m_pSettings);
+
+		if (m_pRemote)
+		{
+			if (m_pRemote->GetPoseAt(CPoseStreamReceiver::GetLocalTimeNs(), &pose) || m_pRemote->ReadPose(&pose) != 0)
+				return pose;
+
+			CZedTracker::BuildPoseTemplate(*pSettings, &pose);
+			pose.poseIsValid = false;
+			pose.result = TrackingResult_Uninitialized;
+			return pose;
+		}
+
+		if (m_pGrabber)
+		{
+			if (m_pGrabber->ReadPose(&pose) != 0)
+				return pose;
+
+			// the helper is still opening the camera
+			CZedTracker::BuildPoseTemplate(*pSettings, &pose);
+			pose.poseIsValid = false;
+			pose.result = TrackingResult_Calibrating_InProgress;
+			return pose;
+		}
+
+		if (m_pRigFusion && m_pRigFusion->ReadPose(&pose) != 0)
+			return pose;
+
+		// asked for the pose now, which is usually between two published samples
+		if (pSettings->sSvoPath.empty() && m_zedTracker.GetPoseAt(m_zedTracker.GetCameraTimeNs(), &pose))
+			return pose;
 
-		pose.qWorldFromDriverRotation = HmdQuaternion_Init(1, 0, 0, 0);
-		pose.qDriverFromHeadRotation = HmdQuaternion_Init(1, 0, 0, 0);
+		if (m_zedTracker.ReadPose(&pose) != 0)
+			return pose;
+
+		// nothing published by the tracking thread yet, the camera is still opening
+		m_zedTracker.GetPoseTemplate(&pose);
+		pose.poseIsValid = false;
+		pose.result = TrackingResult_Calibrating_InProgress;
 
 		return pose;
 	}
 
+	/** New settings snapshot, swapped in whole; the per-device pose recording path, body, marker and object tracking and placement are kept */
+	void UpdateSettings(const ZedmSettings_t& settings)
+	{
+		std::shared_ptr<const ZedmSettings_t> pPrevious = std::atomic_load(&m_pSettings);
+		std::shared_ptr<ZedmSettings_t> pUpdated = std::make_shared<ZedmSettings_t>(settings);
+		pUpdated->sPoseRecordingPath = pPrevious->sPoseRecordingPath;
+		pUpdated->bBodyTracking = pPrevious->bBodyTracking;
+		pUpdated->sMarkerIds = pPrevious->sMarkerIds;
+		pUpdated->nObjectTrackers = pPrevious->nObjectTrackers;
+		if (m_bPlaced)
+			ApplyCameraPlacement(m_placement, pUpdated.get());
+		std::shared_ptr<MemoryBudget_t> pMemoryBudget = std::make_shared<MemoryBudget_t>();
+		ApplyMemoryBudget(pUpdated.get(), pMemoryBudget.get());
+		if (pMemoryBudget->unTrims != std::atomic_load(&m_pMemoryBudget)->unTrims)
+			LogMemoryBudget(m_unCameraSerial, *pMemoryBudget);
+		std::shared_ptr<const ZedmSettings_t> pSettings = pUpdated;
+		std::atomic_store(&m_pSettings, pSettings);
+		std::atomic_store(&m_pMemoryBudget, std::shared_ptr<const MemoryBudget_t>(pMemoryBudget));
+		if (m_pRemote)
+		{
+			// the port and buffer delay are fixed while the receiver runs
+			DriverPose_t poseTemplate;
+			CZedTracker::BuildPoseTemplate(*pSettings, &poseTemplate);
+			m_pRemote->SetPoseTemplate(poseTemplate);
+			return;
+		}
+		if (m_pGrabber)
+		{
+			// the helper keeps the settings it was launched with, the calibration is applied here
+			DriverPose_t poseTemplate;
+			CZedTracker::BuildPoseTemplate(*pSettings, &poseTemplate);
+			m_pGrabber->SetPoseTemplate(poseTemplate);
+			return;
+		}
+		m_zedTracker.UpdateSettings(*pSettings);
+	}
+
 	void RunFrame()
 	{
-		// In a real driver, this should happen from some pose tracking thread.
 		// The RunFrame interval is unspecified and can be very irregular if some other
-		// driver blocks it for some periodic task.
-		if (m_unObjectId != vr::k_unTrackedDeviceIndexInvalid)
+		// driver blocks it for some periodic task, so only forward the latest pose from
+		// the tracking thread, and only if a new one arrived since the last call.
+		// When the IMU publisher is running it submits poses itself at IMU rate, and
+		// in receiver mode the receive thread does as the poses are played out, in
+		// grabber mode the poll thread, and for a rig the fusion thread.
+		if (m_sharedStats.IsOpen())
+			PublishSharedStats();
+		if (m_pRemote || m_pGrabber || m_pRigFusion)
+			return;
+
+		// markers are detected a few times a second; between those they're interpolated at this rate
+		if (!std::atomic_load(&m_pSettings)->sMarkerIds.empty())
+			m_zedTracker.GetMarkerTracker()->Publish(m_zedTracker.GetCameraTimeNs());
+
+		if (m_unObjectId != vr::k_unTrackedDeviceIndexInvalid && !m_zedTracker.SubmitsPoses())
 		{
-			// vr::VRServerDriverHost()->TrackedDevicePoseUpdated( m_unObjectId, GetPose(), sizeof( DriverPose_t ) );
+			DriverPose_t pose;
+			uint64_t ulSampleTimestampNs;
+			uint32_t unSequence = m_zedTracker.ReadPose(&pose, &ulSampleTimestampNs);
+			if (unSequence != 0 && unSequence != m_unLastPoseSequence)
+			{
+				m_unLastPoseSequence = unSequence;
+				if (!m_zedTracker.ShouldSubmitPose(pose, ulSampleTimestampNs))
+					return;
+				m_zedTracker.PredictPose(&pose);
+				TRACE_ZONE("TrackedDevicePoseUpdated");
+				vr::VRServerDriverHost()->TrackedDevicePoseUpdated(m_unObjectId, pose, sizeof(DriverPose_t));
+				m_zedTracker.RecordPoseSubmitted(ulSampleTimestampNs);
+			}
 		}
 	}
 
@@ -243,69 +798,1242 @@ public:
 
 	std::string GetSerialNumber() const { return m_sSerialNumber; }
 
+	CZedBodyTracker* GetBodyTracker() { return m_zedTracker.GetBodyTracker(); }
+
+	CZedMarkerTracker* GetMarkerTracker() { return m_zedTracker.GetMarkerTracker(); }
+	CZedObjectTracker* GetObjectTracker() { return m_zedTracker.GetObjectTracker(); }
+
+	/** The camera's tracker, nullptr in receiver and grabber mode */
+	CZedTracker* GetZedTracker() { return m_pRemote || m_pGrabber ? nullptr : &m_zedTracker; }
+
+	/** Points SteamVR at a chaperone file; setting it again has the new bounds read */
+	void SetChaperonePath(const std::string& sPath)
+	{
+		if (m_ulPropertyContainer != vr::k_ulInvalidPropertyContainer)
+			vr::VRProperties()->SetStringProperty(m_ulPropertyContainer, Prop_DriverProvidedChaperonePath_String, sPath.c_str());
+	}
+
+	void SetGpuLoad(float flGpuLoad) { m_zedTracker.SetGpuLoad(flGpuLoad); }
+
+	void SetVsync(uint64_t ulVsyncNs, double flFrameSeconds) { m_zedTracker.SetVsync(ulVsyncNs, flFrameSeconds); }
+
+	/** The current world-from-driver transform, and whether the camera is tracking, for the spatial anchors */
+	void GetAnchorSpace(vr::DriverPose_t* pPose, bool* pbTracking) const
+	{
+		std::shared_ptr<const ZedmSettings_t> pSettings = std::atomic_load(&m_pSettings);
+		if (m_pRemote)
+		{
+			PoseStreamStats_t stats;
+			m_pRemote->GetStats(&stats);
+			CZedTracker::BuildPoseTemplate(*pSettings, pPose);
+			*pbTracking = stats.bConnected;
+			return;
+		}
+		if (m_pGrabber)
+		{
+			vr::DriverPose_t pose;
+			CZedTracker::BuildPoseTemplate(*pSettings, pPose);
+			*pbTracking = m_pGrabber->ReadPose(&pose) != 0 && pose.poseIsValid;
+			return;
+		}
+		m_zedTracker.GetPoseTemplate(pPose);
+		*pbTracking = m_zedTracker.GetTrackingState() == POSITIONAL_TRACKING_STATE::OK;
+	}
+
 private:
+	/** sharedMemoryExport: the tracker's figures for status tools, every k_ulSharedStatsIntervalNs at most */
+	void PublishSharedStats()
+	{
+		uint64_t ulNowNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		if (ulNowNs - m_ulSharedStatsNs < k_ulSharedStatsIntervalNs)
+			return;
+		m_ulSharedStatsNs = ulNowNs;
+
+		ZedTrackerStats_t stats;
+		m_zedTracker.GetStats(&stats);
+
+		SharedStats_t shared = {};
+		shared.ulWriteTimestampNs = ulNowNs;
+		shared.nTrackingState = (int32_t)stats.eTrackingState;
+		shared.unFlags = (stats.bImuPublisherRunning ? SharedStatsFlag_ImuPublisher : 0) | (stats.bDeadReckoning ? SharedStatsFlag_DeadReckoning : 0)
+			| (stats.bRelocalizing ? SharedStatsFlag_Relocalizing : 0) | (stats.bGrabStalled ? SharedStatsFlag_GrabStalled : 0);
+		snprintf(shared.rgchTrackingState, sizeof(shared.rgchTrackingState), "%s", sl::toString(stats.eTrackingState).c_str());
+		shared.flGrabFps = stats.flGrabFps;
+		shared.ulFramesGrabbed = stats.ulFramesGrabbed;
+		shared.ulFramesDropped = stats.unFramesDropped;
+		shared.ulGrabFailures = stats.ulGrabFailures;
+		shared.ulGrabStalls = stats.ulGrabStalls;
+		shared.flPosePublishRate = stats.flPosePublishRate;
+		shared.ulPosesPublished = stats.ulPosesPublished;
+		shared.flImuRate = stats.flImuRate;
+		for (int i = 0; i < LatencyStage_Count; i++)
+			shared.rgLatency[i] = m_zedTracker.GetLatencySummary((ELatencyStage)i);
+
+		ProximitySectors_t sectors;
+		if (m_zedTracker.GetProximitySectors(&sectors))
+		{
+			shared.unProximitySectors = sectors.unSectors;
+			shared.flProximityFirstAngle = sectors.flFirstAngle;
+			shared.flProximitySectorAngle = sectors.flSectorAngle;
+			shared.flProximityRange = sectors.flRange;
+			memcpy(shared.rgflProximity, sectors.rgflDistance, sizeof(shared.rgflProximity));
+		}
+		m_sharedStats.Write(shared);
+	}
+
+	/** Receiver mode's part of Activate: no camera, the receive thread starts instead of the tracker */
+	EVRInitError ActivateRemote()
+	{
+		std::shared_ptr<const ZedmSettings_t> pSettings = std::atomic_load(&m_pSettings);
+		DriverPose_t poseTemplate;
+		CZedTracker::BuildPoseTemplate(*pSettings, &poseTemplate);
+		m_pRemote->SetPoseTemplate(poseTemplate);
+		m_pRemote->SetObjectId(m_unObjectId);
+		if (!m_pRemote->Start((uint16_t)pSettings->nRemotePort, pSettings->flRemoteJitterDelay))
+		{
+			DriverLog("Unable to start the pose stream receiver\n");
+			return VRInitError_Driver_Failed;
+		}
+		return VRInitError_None;
+	}
+
+	/** Grabber mode's part of Activate: the poll thread, and the helper, start instead of the tracker */
+	EVRInitError ActivateGrabber()
+	{
+		std::shared_ptr<const ZedmSettings_t> pSettings = std::atomic_load(&m_pSettings);
+		DriverPose_t poseTemplate;
+		CZedTracker::BuildPoseTemplate(*pSettings, &poseTemplate);
+		m_pGrabber->SetPoseTemplate(poseTemplate);
+		m_pGrabber->SetObjectId(m_unObjectId);
+
+		// the helper's IMU samples, forwarded by the poll thread
+		if (OpenImuBuffer())
+			m_pGrabber->SetImuBuffer(m_ulImuBuffer);
+
+		std::string sProcessPath = pSettings->sGrabberPath == "-" ? std::string() : pSettings->sGrabberPath;
+		if (!m_pGrabber->Start(GetSharedPoseName(m_sSerialNumber), sProcessPath, pSettings->sGrabberArgs))
+		{
+			DriverLog("Unable to start the grabber client\n");
+			return VRInitError_Driver_Failed;
+		}
+		return VRInitError_None;
+	}
+
+	/** The raw IMU samples for other processes, see CZedTracker::SetImuBuffer */
+	bool OpenImuBuffer()
+	{
+		std::string sImuPath = "/devices/zedm/" + m_sSerialNumber + "/imu";
+		if (vr::VRIOBuffer() && vr::VRIOBuffer()->Open(sImuPath.c_str(), (vr::EIOBufferMode)(vr::IOBufferMode_Write | vr::IOBufferMode_Create),
+			sizeof(vr::ImuSample_t), k_unImuBufferSamples, &m_ulImuBuffer) == vr::IOBuffer_Success)
+			return true;
+
+		DriverLog("Unable to create IMU buffer %s\n", sImuPath.c_str());
+		m_ulImuBuffer = vr::k_ulInvalidIOBufferHandle;
+		return false;
+	}
+
+	void CloseImuBuffer()
+	{
+		if (m_ulImuBuffer != vr::k_ulInvalidIOBufferHandle)
+		{
+			vr::VRIOBuffer()->Close(m_ulImuBuffer);
+			m_ulImuBuffer = vr::k_ulInvalidIOBufferHandle;
+		}
+	}
+
 	vr::TrackedDeviceIndex_t m_unObjectId;
 	vr::PropertyContainerHandle_t m_ulPropertyContainer;
 
 	std::string m_sSerialNumber;
 	std::string m_sModelNumber;
-	std::thread* m_pPoseThread;
+
+	// replaced whole by UpdateSettings and read by every thread with
+	// std::atomic_load/atomic_store, each call keeps its own reference
+	std::shared_ptr<const ZedmSettings_t> m_pSettings;
+	unsigned int m_unCameraSerial;
+	CZedTracker m_zedTracker;
+	uint32_t m_unLastPoseSequence;
+	vr::IOBufferHandle_t m_ulImuBuffer;
+	CSharedPoseWriter m_sharedPoses;
+	CSharedStatsWriter m_sharedStats;
+	uint64_t m_ulSharedStatsNs; // steady clock of the last PublishSharedStats
+	CPoseStreamReceiver* m_pRemote; // receiver mode, m_zedTracker is never started then
+	CGrabberClient* m_pGrabber; // grabber mode, nor then
+	CRigFusion* m_pRigFusion; // the provider's, if this is a rig's device
+	CZedDisplayComponent* m_pDisplay; // hmdMode
+	CameraPlacement_t m_placement; // cameraPlanner's, if m_bPlaced
+	bool m_bPlaced;
+	std::shared_ptr<const MemoryBudget_t> m_pMemoryBudget; // what memoryBudgetHost and memoryBudgetGpu trimmed from m_pSettings, swapped likewise
 };
 
 //-----------------------------------------------------------------------------
-// Purpose:
+// Purpose: One joint of the body seen by a ZED, as a generic tracker. Poses
+// are pushed by the camera's CZedBodyTracker, or by CBodyFusion with
+// bodyFusionPort set, all joints at once.
 //-----------------------------------------------------------------------------
-class CServerDriver_Zedm : public IServerTrackedDeviceProvider
+class CZedBodyTrackerDriver : public vr::ITrackedDeviceServerDriver
 {
 public:
-	virtual EVRInitError Init(vr::IVRDriverContext* pDriverContext);
-	virtual void Cleanup();
-	virtual const char* const* GetInterfaceVersions() { return vr::k_InterfaceVersions; }
-	virtual void RunFrame();
-	virtual bool ShouldBlockStandbyMode() { return false; }
-	virtual void EnterStandby() {}
-	virtual void LeaveStandby() {}
-
-private:
-	CZedmDriver* m_pTracker = nullptr;
-};
+	CZedBodyTrackerDriver(IBodyJointSource* pBodyTracker, EBodyJoint eJoint, const std::string& sCameraSerialNumber)
+		: m_pBodyTracker(pBodyTracker)
+		, m_eJoint(eJoint)
+		, m_unObjectId(vr::k_unTrackedDeviceIndexInvalid)
+	{
+		m_sSerialNumber = sCameraSerialNumber + "_body_" + GetBodyJointName(eJoint);
+	}
 
-CServerDriver_Zedm g_serverDriverNull;
+	virtual ~CZedBodyTrackerDriver()
+	{
+	}
 
+	virtual EVRInitError Activate(vr::TrackedDeviceIndex_t unObjectId)
+	{
+		m_unObjectId = unObjectId;
+		vr::PropertyContainerHandle_t ulPropertyContainer = vr::VRProperties()->TrackedDeviceToPropertyContainer(m_unObjectId);
+
+		CPropertyBatch properties;
+		properties.SetString(Prop_ModelNumber_String, "ZED body tracker");
+		properties.SetString(Prop_ManufacturerName_String, "Stereolabs");
+		properties.SetString(Prop_RenderModelName_String, "{htc}vr_tracker_vive_1_0");
+		properties.SetUint64(Prop_CurrentUniverseId_Uint64, 27); // the camera's
+		properties.SetBool(Prop_NeverTracked_Bool, false);
+		properties.SetInt32(Prop_ControllerRoleHint_Int32, TrackedControllerRole_OptOut);
+		properties.Write(ulPropertyContainer);
+
+		m_pBodyTracker->SetObjectId(m_eJoint, m_unObjectId);
+		return VRInitError_None;
+	}
 
-EVRInitError CServerDriver_Zedm::Init(vr::IVRDriverContext* pDriverContext)
-{
-	VR_INIT_SERVER_DRIVER_CONTEXT(pDriverContext);
-	InitDriverLog(vr::VRDriverLog());
+	virtual void Deactivate()
+	{
+		m_pBodyTracker->SetObjectId(m_eJoint, vr::k_unTrackedDeviceIndexInvalid);
+		m_unObjectId = vr::k_unTrackedDeviceIndexInvalid;
+	}
 
-	m_pTracker = new CZedmDriver();
-	vr::VRServerDriverHost()->TrackedDeviceAdded(m_pTracker->GetSerialNumber().c_str(), vr::TrackedDeviceClass_GenericTracker, m_pTracker);
+	virtual void EnterStandby() {}
+	virtual void* GetComponent(const char* pchComponentNameAndVersion) { return NULL; }
+	virtual void DebugRequest(const char* pchRequest, char* pchResponseBuffer, uint32_t unResponseBufferSize)
+	{
+		if (unResponseBufferSize >= 1)
+			pchResponseBuffer[0] = 0;
+	}
 
-	return VRInitError_None;
-}
+	virtual DriverPose_t GetPose()
+	{
+		DriverPose_t pose;
+		m_pBodyTracker->ReadPose(m_eJoint, &pose);
+		return pose;
+	}
 
-void CServerDriver_Zedm::Cleanup()
-{
-	CleanupDriverLog();
-	delete m_pTracker;
-	m_pTracker = NULL;
-}
+	std::string GetSerialNumber() const { return m_sSerialNumber; }
 
+private:
+	IBodyJointSource* m_pBodyTracker;
+	EBodyJoint m_eJoint;
+	vr::TrackedDeviceIndex_t m_unObjectId;
+	std::string m_sSerialNumber;
+};
 
-void CServerDriver_Zedm::RunFrame()
+//-----------------------------------------------------------------------------
+// Purpose: One fiducial marker seen by a ZED, as a generic tracker. Poses are
+// pushed by the camera's CZedMarkerTracker from the camera device's RunFrame.
+//-----------------------------------------------------------------------------
+class CZedMarkerDriver : public vr::ITrackedDeviceServerDriver
 {
-	if (m_pTracker)
+public:
+	CZedMarkerDriver(CZedMarkerTracker* pMarkerTracker, int nMarker, int nMarkerId, const std::string& sCameraSerialNumber)
+		: m_pMarkerTracker(pMarkerTracker)
+		, m_nMarker(nMarker)
+		, m_unObjectId(vr::k_unTrackedDeviceIndexInvalid)
 	{
-		m_pTracker->RunFrame();
+		m_sSerialNumber = sCameraSerialNumber + "_marker_" + std::to_string(nMarkerId);
 	}
 
-	vr::VREvent_t vrEvent;
-	while (vr::VRServerDriverHost()->PollNextEvent(&vrEvent, sizeof(vrEvent)))
+	virtual ~CZedMarkerDriver()
 	{
-		if (m_pTracker)
-		{
-			m_pTracker->ProcessEvent(vrEvent);
+	}
+
+	virtual EVRInitError Activate(vr::TrackedDeviceIndex_t unObjectId)
+	{
+		m_unObjectId = unObjectId;
+		vr::PropertyContainerHandle_t ulPropertyContainer = vr::VRProperties()->TrackedDeviceToPropertyContainer(m_unObjectId);
+
+		CPropertyBatch properties;
+		properties.SetString(Prop_ModelNumber_String, "ZED marker");
+		properties.SetString(Prop_ManufacturerName_String, "Stereolabs");
+		properties.SetString(Prop_RenderModelName_String, "{htc}vr_tracker_vive_1_0");
+		properties.SetUint64(Prop_CurrentUniverseId_Uint64, 27); // the camera's
+		properties.SetBool(Prop_NeverTracked_Bool, false);
+		properties.SetInt32(Prop_ControllerRoleHint_Int32, TrackedControllerRole_OptOut);
+		properties.Write(ulPropertyContainer);
+
+		m_pMarkerTracker->SetObjectId(m_nMarker, m_unObjectId);
+		return VRInitError_None;
+	}
+
+	virtual void Deactivate()
+	{
+		m_pMarkerTracker->SetObjectId(m_nMarker, vr::k_unTrackedDeviceIndexInvalid);
+		m_unObjectId = vr::k_unTrackedDeviceIndexInvalid;
+	}
+
+	virtual void EnterStandby() {}
+	virtual void* GetComponent(const char* pchComponentNameAndVersion) { return NULL; }
+	virtual void DebugRequest(const char* pchRequest, char* pchResponseBuffer, uint32_t unResponseBufferSize)
+	{
+		if (unResponseBufferSize >= 1)
+			pchResponseBuffer[0] = 0;
+	}
+
+	virtual DriverPose_t GetPose()
+	{
+		DriverPose_t pose;
+		m_pMarkerTracker->ReadPose(m_nMarker, &pose);
+		return pose;
+	}
+
+	std::string GetSerialNumber() const { return m_sSerialNumber; }
+
+private:
+	CZedMarkerTracker* m_pMarkerTracker;
+	int m_nMarker;
+	vr::TrackedDeviceIndex_t m_unObjectId;
+	std::string m_sSerialNumber;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: One detected prop, as a generic tracker. Which object it follows
+// is up to the camera's CZedObjectTracker, which pushes the poses of all of
+// them at once.
+//-----------------------------------------------------------------------------
+class CZedObjectDriver : public vr::ITrackedDeviceServerDriver
+{
+public:
+	CZedObjectDriver(CZedObjectTracker* pObjectTracker, int nTracker, const std::string& sCameraSerialNumber)
+		: m_pObjectTracker(pObjectTracker)
+		, m_nTracker(nTracker)
+		, m_unObjectId(vr::k_unTrackedDeviceIndexInvalid)
+	{
+		m_sSerialNumber = sCameraSerialNumber + "_object_" + std::to_string(nTracker);
+	}
+
+	virtual ~CZedObjectDriver()
+	{
+	}
+
+	virtual EVRInitError Activate(vr::TrackedDeviceIndex_t unObjectId)
+	{
+		m_unObjectId = unObjectId;
+		vr::PropertyContainerHandle_t ulPropertyContainer = vr::VRProperties()->TrackedDeviceToPropertyContainer(m_unObjectId);
+
+		CPropertyBatch properties;
+		properties.SetString(Prop_ModelNumber_String, "ZED object");
+		properties.SetString(Prop_ManufacturerName_String, "Stereolabs");
+		properties.SetString(Prop_RenderModelName_String, "{htc}vr_tracker_vive_1_0");
+		properties.SetUint64(Prop_CurrentUniverseId_Uint64, 27); // the camera's
+		properties.SetBool(Prop_NeverTracked_Bool, false);
+		properties.SetInt32(Prop_ControllerRoleHint_Int32, TrackedControllerRole_OptOut);
+		properties.Write(ulPropertyContainer);
+
+		m_pObjectTracker->SetObjectId(m_nTracker, m_unObjectId);
+		return VRInitError_None;
+	}
+
+	virtual void Deactivate()
+	{
+		m_pObjectTracker->SetObjectId(m_nTracker, vr::k_unTrackedDeviceIndexInvalid);
+		m_unObjectId = vr::k_unTrackedDeviceIndexInvalid;
+	}
+
+	virtual void EnterStandby() {}
+	virtual void* GetComponent(const char* pchComponentNameAndVersion) { return NULL; }
+	virtual void DebugRequest(const char* pchRequest, char* pchResponseBuffer, uint32_t unResponseBufferSize)
+	{
+		if (unResponseBufferSize >= 1)
+			pchResponseBuffer[0] = 0;
+	}
+
+	virtual DriverPose_t GetPose()
+	{
+		DriverPose_t pose;
+		m_pObjectTracker->ReadPose(m_nTracker, &pose);
+		return pose;
+	}
+
+	std::string GetSerialNumber() const { return m_sSerialNumber; }
+
+private:
+	CZedObjectTracker* m_pObjectTracker;
+	int m_nTracker;
+	vr::TrackedDeviceIndex_t m_unObjectId;
+	std::string m_sSerialNumber;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: One hand of the body seen by a ZED, as a controller with only a
+// skeleton input. The camera's CZedBodyTracker calls OnBodySkeleton on its
+// publisher thread, so retargeting never runs on the grab thread.
+//-----------------------------------------------------------------------------
+class CZedHandDriver : public vr::ITrackedDeviceServerDriver, public IBodySkeletonListener
+{
+public:
+	CZedHandDriver(CZedBodyTracker* pBodyTracker, EHand eHand, const std::string& sCameraSerialNumber)
+		: m_pBodyTracker(pBodyTracker)
+		, m_retargeter(eHand)
+		, m_unObjectId(vr::k_unTrackedDeviceIndexInvalid)
+		, m_ulSkeleton(vr::k_ulInvalidInputComponentHandle)
+	{
+		m_sSerialNumber = sCameraSerialNumber + (eHand == Hand_Left ? "_hand_left" : "_hand_right");
+		m_retargeter.GetReferencePose(m_rgBones);
+	}
+
+	virtual ~CZedHandDriver()
+	{
+	}
+
+	virtual EVRInitError Activate(vr::TrackedDeviceIndex_t unObjectId)
+	{
+		bool bLeft = m_retargeter.GetHand() == Hand_Left;
+		m_unObjectId = unObjectId;
+		vr::PropertyContainerHandle_t ulPropertyContainer = vr::VRProperties()->TrackedDeviceToPropertyContainer(m_unObjectId);
+
+		// before the skeleton component, whose input profile this names
+		CPropertyBatch properties;
+		properties.SetString(Prop_ModelNumber_String, "ZED hand");
+		properties.SetString(Prop_ManufacturerName_String, "Stereolabs");
+		properties.SetString(Prop_ControllerType_String, "zedm_hand");
+		properties.SetString(Prop_InputProfilePath_String, "{zedm}/input/zedm_hand_profile.json");
+		properties.SetUint64(Prop_CurrentUniverseId_Uint64, 27); // the camera's
+		properties.SetBool(Prop_NeverTracked_Bool, false);
+		properties.SetInt32(Prop_ControllerRoleHint_Int32, bLeft ? TrackedControllerRole_LeftHand : TrackedControllerRole_RightHand);
+		properties.Write(ulPropertyContainer);
+
+		EVRInputError eError = vr::VRDriverInput()->CreateSkeletonComponent(ulPropertyContainer,
+			bLeft ? "/input/skeleton/left" : "/input/skeleton/right",
+			bLeft ? "/skeleton/hand/left" : "/skeleton/hand/right",
+			"/pose/raw", VRSkeletalTracking_Partial, nullptr, 0, &m_ulSkeleton);
+		if (eError != VRInputError_None)
+			DriverLog("Unable to create the %s hand skeleton: %d\n", bLeft ? "left" : "right", eError);
+
+		m_pBodyTracker->SetSkeletonListener((int)m_retargeter.GetHand(), this);
+		return VRInitError_None;
+	}
+
+	virtual void Deactivate()
+	{
+		m_pBodyTracker->SetSkeletonListener((int)m_retargeter.GetHand(), nullptr);
+		m_unObjectId = vr::k_unTrackedDeviceIndexInvalid;
+	}
+
+	virtual void EnterStandby() {}
+	virtual void* GetComponent(const char* pchComponentNameAndVersion) { return NULL; }
+	virtual void DebugRequest(const char* pchRequest, char* pchResponseBuffer, uint32_t unResponseBufferSize)
+	{
+		if (unResponseBufferSize >= 1)
+			pchResponseBuffer[0] = 0;
+	}
+
+	virtual DriverPose_t GetPose()
+	{
+		DriverPose_t pose;
+		if (m_pose.Read(&pose) == 0)
+		{
+			memset(&pose, 0, sizeof(pose));
+			pose.qRotation = HmdQuaternion_Identity();
+			pose.qWorldFromDriverRotation = HmdQuaternion_Identity();
+			pose.qDriverFromHeadRotation = HmdQuaternion_Identity();
+			pose.result = TrackingResult_Uninitialized;
 		}
+		return pose;
+	}
+
+	/** Publisher thread: the bones go into m_rgBones, which only this thread touches after Activate */
+	virtual void OnBodySkeleton(const ZedBodySkeleton_t* pSkeleton, const vr::DriverPose_t& poseTemplate, double flTimeOffset)
+	{
+		DriverPose_t pose = poseTemplate;
+		pose.poseTimeOffset = flTimeOffset;
+		if (!pSkeleton || !m_retargeter.Retarget(*pSkeleton, m_rgBones, pose.vecPosition, &pose.qRotation))
+		{
+			pose.poseIsValid = false;
+			pose.result = TrackingResult_Running_OutOfRange;
+		}
+
+		m_pose.Write(pose);
+		vr::TrackedDeviceIndex_t unObjectId = m_unObjectId;
+		if (unObjectId == vr::k_unTrackedDeviceIndexInvalid)
+			return;
+		vr::VRServerDriverHost()->TrackedDevicePoseUpdated(unObjectId, pose, sizeof(DriverPose_t));
+		if (pose.poseIsValid && m_ulSkeleton != vr::k_ulInvalidInputComponentHandle)
+		{
+			// no controller is held, both ranges get the same hand
+			vr::VRDriverInput()->UpdateSkeletonComponent(m_ulSkeleton, VRSkeletalMotionRange_WithController, m_rgBones, k_unHandBoneCount);
+			vr::VRDriverInput()->UpdateSkeletonComponent(m_ulSkeleton, VRSkeletalMotionRange_WithoutController, m_rgBones, k_unHandBoneCount);
+		}
+	}
+
+	std::string GetSerialNumber() const { return m_sSerialNumber; }
+
+private:
+	CZedBodyTracker* m_pBodyTracker;
+	CHandSkeletonRetargeter m_retargeter;
+	std::atomic<vr::TrackedDeviceIndex_t> m_unObjectId;
+	vr::VRInputComponentHandle_t m_ulSkeleton;
+	std::string m_sSerialNumber;
+	vr::VRBoneTransform_t m_rgBones[k_unHandBoneCount]; // publisher's
+	CSeqLock<DriverPose_t> m_pose;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: syntheticTrackers: one load-generating tracker, see syntheticload.h.
+// Its thread starts with the first Activate and runs until the driver is
+// cleaned up, so a deactivated device keeps loading the pipeline.
+//-----------------------------------------------------------------------------
+class CZedSyntheticDriver : public vr::ITrackedDeviceServerDriver
+{
+public:
+	CZedSyntheticDriver(const CSyntheticMotion* pMotion, uint32_t unIndex, uint32_t unCount, const ZedmSettings_t& settings)
+		: m_tracker(pMotion, unIndex, unCount)
+		, m_settings(settings)
+		, m_unObjectId(vr::k_unTrackedDeviceIndexInvalid)
+	{
+		m_sSerialNumber = "ZED_SYNTHETIC_" + std::to_string(unIndex);
+		DriverPose_t poseTemplate;
+		CZedTracker::BuildPoseTemplate(settings, &poseTemplate);
+		m_tracker.SetPoseTemplate(poseTemplate);
+	}
+
+	virtual ~CZedSyntheticDriver()
+	{
+	}
+
+	virtual EVRInitError Activate(vr::TrackedDeviceIndex_t unObjectId)
+	{
+		m_unObjectId = unObjectId;
+		vr::PropertyContainerHandle_t ulPropertyContainer = vr::VRProperties()->TrackedDeviceToPropertyContainer(m_unObjectId);
+
+		CPropertyBatch properties;
+		properties.SetString(Prop_ModelNumber_String, "ZED synthetic tracker");
+		properties.SetString(Prop_ManufacturerName_String, "Stereolabs");
+		properties.SetString(Prop_RenderModelName_String, "{htc}vr_tracker_vive_1_0");
+		properties.SetUint64(Prop_CurrentUniverseId_Uint64, 27); // the cameras'
+		properties.SetBool(Prop_NeverTracked_Bool, false);
+		properties.SetInt32(Prop_ControllerRoleHint_Int32, TrackedControllerRole_OptOut);
+		properties.Write(ulPropertyContainer);
+
+		m_tracker.SetObjectId(m_unObjectId);
+		m_tracker.Start(m_settings, m_settings.flSyntheticRate);
+		return VRInitError_None;
+	}
+
+	virtual void Deactivate()
+	{
+		m_tracker.SetObjectId(vr::k_unTrackedDeviceIndexInvalid);
+		m_unObjectId = vr::k_unTrackedDeviceIndexInvalid;
+	}
+
+	virtual void EnterStandby() {}
+	virtual void* GetComponent(const char* pchComponentNameAndVersion) { return NULL; }
+
+	/** "stats": JSON with the publish counts, the wake-up lateness and the time spent in TrackedDevicePoseUpdated */
+	virtual void DebugRequest(const char* pchRequest, char* pchResponseBuffer, uint32_t unResponseBufferSize)
+	{
+		if (unResponseBufferSize < 1)
+			return;
+		pchResponseBuffer[0] = 0;
+		if (strcmp(pchRequest, "stats") != 0)
+			return;
+
+		SyntheticTrackerStats_t stats;
+		m_tracker.GetStats(&stats);
+		uint32_t unOffset = 0;
+		AppendResponse(pchResponseBuffer, unResponseBufferSize, &unOffset,
+			"{\"serial\":\"%s\",\"rate_hz\":%.1f,\"ticks\":%llu,\"missed_ticks\":%llu,\"submitted\":%llu,\"deduplicated\":%llu,"
+			"\"wake_late_us\":{\"p50\":%.0f,\"p99\":%.0f,\"max\":%.0f},\"submit_us\":{\"p50\":%.0f,\"p99\":%.0f,\"max\":%.0f}}",
+			m_sSerialNumber.c_str(), m_settings.flSyntheticRate, (unsigned long long)stats.ulTicks, (unsigned long long)stats.ulMissedTicks,
+			(unsigned long long)stats.ulSubmitted, (unsigned long long)stats.ulDeduplicated,
+			stats.wakeLateness.flP50Us, stats.wakeLateness.flP99Us, stats.wakeLateness.flMaxUs,
+			stats.submitCall.flP50Us, stats.submitCall.flP99Us, stats.submitCall.flMaxUs);
+		if (unOffset >= unResponseBufferSize)
+			pchResponseBuffer[0] = 0;
+	}
+
+	virtual DriverPose_t GetPose()
+	{
+		DriverPose_t pose;
+		if (m_tracker.ReadPose(&pose) != 0)
+			return pose;
+
+		CZedTracker::BuildPoseTemplate(m_settings, &pose);
+		pose.poseIsValid = false;
+		pose.result = TrackingResult_Uninitialized;
+		return pose;
+	}
+
+	/** The calibration applies right away, the rate and filters at startup */
+	void UpdateSettings(const ZedmSettings_t& settings)
+	{
+		DriverPose_t poseTemplate;
+		CZedTracker::BuildPoseTemplate(settings, &poseTemplate);
+		m_tracker.SetPoseTemplate(poseTemplate);
+	}
+
+	std::string GetSerialNumber() const { return m_sSerialNumber; }
+
+private:
+	CSyntheticTracker m_tracker;
+	ZedmSettings_t m_settings;
+	vr::TrackedDeviceIndex_t m_unObjectId;
+	std::string m_sSerialNumber;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+class CServerDriver_Zedm : public IServerTrackedDeviceProvider
+{
+public:
+	virtual EVRInitError Init(vr::IVRDriverContext* pDriverContext);
+	virtual void Cleanup();
+	virtual const char* const* GetInterfaceVersions() { return vr::k_InterfaceVersions; }
+	virtual void RunFrame();
+	virtual bool ShouldBlockStandbyMode() { return false; }
+	virtual void EnterStandby();
+	virtual void LeaveStandby();
+
+	void ReloadSettings();
+
+private:
+	void UpdateFrameTiming();
+	void UpdateWorldCalibrator();
+	void ApplyWorldCalibration();
+	void UpdateChaperoneGenerator();
+	void ApplyChaperoneBounds();
+	void UpdateTelemetry();
+	void ApplyAppPrediction(ZedmSettings_t* pSettings) const;
+	CZedmDriver* AddCameraDevice(unsigned int unCameraSerial, bool bMultiCamera, bool bRegister = true);
+	void StartRigFusion(std::vector<unsigned int>* pvecCameraSerials);
+	void PollCameras();
+	void AddPluggedCameras();
+	void AddSyntheticTrackers();
+
+	static const uint64_t k_ulCameraPollIntervalNs = 2000000000ull;
+	static const int k_nCameraEnumerations = 3; // the SDK may list a camera a bit after the OS
+
+	std::vector<CZedmDriver*> m_vecTrackers;
+	std::vector<CZedBodyTrackerDriver*> m_vecBodyTrackers; // of the first camera
+	std::vector<CZedHandDriver*> m_vecHands; // of the first camera
+	std::vector<CZedMarkerDriver*> m_vecMarkers; // of the first camera
+	std::vector<CZedObjectDriver*> m_vecObjects; // of the first camera
+	std::vector<CZedSyntheticDriver*> m_vecSyntheticTrackers;
+	CSyntheticMotion m_syntheticMotion; // theirs, read only once they run
+	std::shared_ptr<const ZedmSettings_t> m_pSettings; // std::atomic_load/atomic_store, like the devices'
+	std::mutex m_settingsMutex; // RunFrame and DebugRequest can both reload
+	std::atomic<uint32_t> m_unSceneProcessId{ 0 }; // RunFrame's, for predictionApps
+	CSpatialAnchorIndex m_spatialAnchors; // in the space of the first device
+	CWorkerPool m_workerPool; // background jobs of every device
+	CWorldCalibrator m_worldCalibrator; // of the first camera, a job on m_workerPool
+	uint32_t m_unAppliedCalibration = 0;
+	CChaperoneGenerator m_chaperoneGenerator; // chaperonePath, the first camera's map, a job on m_workerPool
+	uint32_t m_unAppliedChaperone = 0;
+	CRigFusion m_rigFusion; // rigCameras, the first cameras' trackers
+	CBodyFusion m_bodyFusion; // bodyFusionPort, the first camera's body trackers
+	CTelemetryExporter m_telemetry; // telemetryCollector, every camera's stats, a job on m_workerPool
+	std::vector<CameraPlacement_t> m_vecCameraPlan; // cameraPlanner, the cameras there at startup
+
+	// hot-plug: PollCameras on the pool finds them, RunFrame adds their devices
+	CPeriodicJob m_cameraPoll;
+	uint32_t m_unUsbDevices = 0; // the poll's
+	int m_nPendingEnumerations = 0; // the poll's
+	std::vector<unsigned int> m_vecKnownCameras; // the poll's
+	std::mutex m_pluggedMutex;
+	std::vector<unsigned int> m_vecPluggedCameras;
+};
+
+CServerDriver_Zedm g_serverDriverNull;
+
+static void ReloadDriverSettings()
+{
+	g_serverDriverNull.ReloadSettings();
+}
+
+
+EVRInitError CServerDriver_Zedm::Init(vr::IVRDriverContext* pDriverContext)
+{
+	VR_INIT_SERVER_DRIVER_CONTEXT(pDriverContext);
+	InitDriverLog(vr::VRDriverLog());
+	ZedmSettings_t settings;
+	LoadDriverSettings(&settings);
+	std::shared_ptr<const ZedmSettings_t> pSettings = std::make_shared<ZedmSettings_t>(settings);
+	std::atomic_store(&m_pSettings, pSettings);
+
+	if (!pSettings->sBinaryLogPath.empty() && !OpenBinaryDriverLog(pSettings->sBinaryLogPath.c_str()))
+		DriverLog("Unable to open binary log %s\n", pSettings->sBinaryLogPath.c_str());
+	if ((!pSettings->sTraceZonesPath.empty() || pSettings->bTraceZonesEtw || pSettings->bTraceZonesNvtx)
+		&& !StartTraceZones(pSettings->sTraceZonesPath.c_str(), pSettings->bTraceZonesEtw, pSettings->bTraceZonesNvtx))
+		DriverLog("Unable to start tracing to %s\n", pSettings->bTraceZonesEtw ? "ETW" : pSettings->bTraceZonesNvtx ? "NVTX" : pSettings->sTraceZonesPath.c_str());
+
+	m_workerPool.Start(pSettings->nWorkerThreads > 0 ? (uint32_t)pSettings->nWorkerThreads : 0);
+
+	// one tracked device, with its own Camera and grab thread, per connected ZED.
+	// Each sl::Camera keeps its own CUDA context and stream, so the cameras don't
+	// serialize on each other. A replay, or no camera found by the SDK, gets a
+	// single device that opens whatever the SDK picks, and so do receiver and
+	// grabber mode, without a camera in vrserver. With no ZED on the USB at all the SDK isn't even loaded,
+	// and cameras plugged in later are added as they show up.
+	std::vector<unsigned int> vecCameraSerials;
+	bool bPollCameras = false;
+	if (pSettings->nRemotePort != 0)
+		DriverLog("Receiver mode: poses from UDP port %d\n", pSettings->nRemotePort);
+	else if (!pSettings->sGrabberPath.empty())
+		DriverLog("Grabber mode: the camera runs in %s\n", pSettings->sGrabberPath.c_str());
+	else if (pSettings->sSvoPath.empty())
+	{
+		m_unUsbDevices = CountZedUsbDevices();
+		if (m_unUsbDevices != 0)
+			vecCameraSerials = EnumerateZedCameras();
+		m_vecKnownCameras = vecCameraSerials;
+		bPollCameras = m_unUsbDevices == 0 || !vecCameraSerials.empty();
+	}
+	if (vecCameraSerials.empty() && !bPollCameras)
+		vecCameraSerials.push_back(0);
+	DriverLog("Found %u ZED camera(s)\n", vecCameraSerials.empty() || vecCameraSerials[0] == 0 ? 0u : (unsigned)vecCameraSerials.size());
+
+	if (pSettings->bCameraPlanner && vecCameraSerials.size() > 1)
+		m_vecCameraPlan = PlanCameraPlacement(vecCameraSerials, *pSettings);
+	if (!pSettings->sRigCameras.empty())
+		StartRigFusion(&vecCameraSerials);
+	for (unsigned int unCameraSerial : vecCameraSerials)
+		AddCameraDevice(unCameraSerial, vecCameraSerials.size() > 1);
+
+	if (bPollCameras)
+	{
+		if (vecCameraSerials.empty())
+			DriverLog("No ZED connected, waiting for one\n");
+		m_cameraPoll.Start(&m_workerPool, WorkPriority_Low, k_ulCameraPollIntervalNs, [this] { PollCameras(); });
+	}
+
+	if (pSettings->nSyntheticTrackers > 0)
+		AddSyntheticTrackers();
+
+	UpdateTelemetry();
+	return VRInitError_None;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: syntheticTrackers: the load generators, after the cameras so those
+// keep their device indices. SteamVR refuses devices beyond its limit.
+//-----------------------------------------------------------------------------
+void CServerDriver_Zedm::AddSyntheticTrackers()
+{
+	std::shared_ptr<const ZedmSettings_t> pSettings = std::atomic_load(&m_pSettings);
+	if (!pSettings->sSyntheticRecording.empty() && !m_syntheticMotion.LoadRecording(pSettings->sSyntheticRecording))
+		DriverLog("Unable to load the poses of %s, synthetic trackers move procedurally\n", pSettings->sSyntheticRecording.c_str());
+
+	uint32_t unCount = (uint32_t)pSettings->nSyntheticTrackers < vr::k_unMaxTrackedDeviceCount ? (uint32_t)pSettings->nSyntheticTrackers : vr::k_unMaxTrackedDeviceCount;
+	uint32_t unAdded = 0;
+	for (uint32_t i = 0; i < unCount; i++)
+	{
+		CZedSyntheticDriver* pSynthetic = new CZedSyntheticDriver(&m_syntheticMotion, i, unCount, *pSettings);
+		m_vecSyntheticTrackers.push_back(pSynthetic);
+		if (vr::VRServerDriverHost()->TrackedDeviceAdded(pSynthetic->GetSerialNumber().c_str(), vr::TrackedDeviceClass_GenericTracker, pSynthetic))
+			unAdded++;
+	}
+	DriverLog("Added %u of %u synthetic trackers at %.0f Hz\n", unAdded, unCount, pSettings->flSyntheticRate);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: rigCameras: the connected cameras of the rig become one device,
+// the first one's, with the others' trackers running unregistered. They are
+// taken out of the list; the rest are added as usual. Only cameras there at
+// startup join, a rig camera plugged in later is a device of its own.
+//-----------------------------------------------------------------------------
+void CServerDriver_Zedm::StartRigFusion(std::vector<unsigned int>* pvecCameraSerials)
+{
+	std::shared_ptr<const ZedmSettings_t> pSettings = std::atomic_load(&m_pSettings);
+	std::vector<RigCamera_t> vecRig;
+	if (!ParseRigCameras(pSettings->sRigCameras, &vecRig))
+	{
+		DriverLog("Unable to parse rigCameras \"%s\"\n", pSettings->sRigCameras.c_str());
+		return;
+	}
+
+	std::vector<RigCamera_t> vecConnected;
+	for (const RigCamera_t& camera : vecRig)
+	{
+		if (std::find(pvecCameraSerials->begin(), pvecCameraSerials->end(), camera.unSerial) != pvecCameraSerials->end())
+			vecConnected.push_back(camera);
+		else
+			DriverLog("Rig camera ZED %u is not connected\n", camera.unSerial);
+	}
+	if (vecConnected.size() < 2)
+	{
+		DriverLog("Fewer than two rig cameras connected, no rig\n");
+		return;
+	}
+
+	std::vector<CZedTracker*> vecTrackers;
+	for (size_t i = 0; i < vecConnected.size(); i++)
+	{
+		CZedmDriver* pDevice = AddCameraDevice(vecConnected[i].unSerial, true, i == 0);
+		if (i == 0)
+			pDevice->SetRigFusion(&m_rigFusion);
+		vecTrackers.push_back(pDevice->GetZedTracker());
+		pvecCameraSerials->erase(std::find(pvecCameraSerials->begin(), pvecCameraSerials->end(), vecConnected[i].unSerial));
+	}
+	m_rigFusion.Start(vecTrackers, vecConnected, *pSettings);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The tracked devices of one camera: its tracker, and the body and
+// hand trackers if it is the first. Unregistered, only the tracker runs, for
+// a rig.
+//-----------------------------------------------------------------------------
+CZedmDriver* CServerDriver_Zedm::AddCameraDevice(unsigned int unCameraSerial, bool bMultiCamera, bool bRegister)
+{
+	ZedmSettings_t settings = *std::atomic_load(&m_pSettings);
+	if (bMultiCamera && !settings.sPoseRecordingPath.empty())
+		settings.sPoseRecordingPath += "." + std::to_string(unCameraSerial);
+
+	// one headset, the first camera
+	settings.bHmdMode = settings.bHmdMode && m_vecTrackers.empty();
+
+	const CameraPlacement_t* pPlacement = nullptr;
+	for (const CameraPlacement_t& placement : m_vecCameraPlan)
+	{
+		if (placement.unSerial == unCameraSerial)
+			pPlacement = &placement;
+	}
+	if (pPlacement)
+		ApplyCameraPlacement(*pPlacement, &settings);
+
+	// one set of body trackers; a second camera would see the same person,
+	// more cameras take part through body fusion
+	settings.bBodyTracking = settings.bBodyTracking && m_vecTrackers.empty() && settings.nRemotePort == 0 && settings.sGrabberPath.empty();
+
+	// the same goes for the markers and objects, and their devices are added once
+	if (!m_vecTrackers.empty() || settings.nRemotePort != 0 || !settings.sGrabberPath.empty())
+	{
+		settings.sMarkerIds.clear();
+		settings.nObjectTrackers = 0;
+	}
+	if (settings.nObjectTrackers > 0 && settings.bBodyTracking)
+	{
+		// SDK 3 runs one object detection model per camera
+		DriverLog("ZED %u: objectTrackers need the detection model bodyTracking uses, object tracking off\n", unCameraSerial);
+		settings.nObjectTrackers = 0;
+	}
+	if (settings.nObjectTrackers > k_nMaxObjectTrackers)
+		settings.nObjectTrackers = k_nMaxObjectTrackers;
+
+	// with the features this camera runs decided, and its profile ceiling
+	MemoryBudget_t memoryBudget;
+	ApplyMemoryBudget(&settings, &memoryBudget);
+	LogMemoryBudget(unCameraSerial, memoryBudget);
+
+	CZedmDriver* pTracker = new CZedmDriver(settings, unCameraSerial, &m_workerPool);
+	if (pPlacement)
+		pTracker->SetCameraPlacement(*pPlacement);
+	pTracker->SetMemoryBudget(memoryBudget);
+	pTracker->StartTracking();
+	m_vecTrackers.push_back(pTracker);
+	if (pTracker->GetZedTracker())
+		m_telemetry.AddSource(pTracker->GetSerialNumber(), pTracker->GetZedTracker());
+	if (!bRegister)
+		return pTracker;
+	vr::VRServerDriverHost()->TrackedDeviceAdded(pTracker->GetSerialNumber().c_str(),
+		pTracker->IsHmd() ? vr::TrackedDeviceClass_HMD : vr::TrackedDeviceClass_GenericTracker, pTracker);
+
+	// the body trackers are fused from the nodes' skeletons and the camera's own, if it has any
+	bool bBodyFusion = false;
+	if (m_vecTrackers.size() == 1 && settings.nBodyFusionPort > 0 && settings.nBodyFusionPort <= 65535 && pTracker->GetZedTracker())
+	{
+		std::vector<BodyFusionNode_t> vecNodes;
+		if (!ParseBodyFusionNodes(settings.sBodyFusionNodes, &vecNodes))
+			DriverLog("Malformed bodyFusionNodes, no body fusion\n");
+		else
+			bBodyFusion = m_bodyFusion.Start(pTracker->GetZedTracker(), (uint16_t)settings.nBodyFusionPort, vecNodes);
+	}
+	if (bBodyFusion && settings.bBodyTracking)
+		pTracker->GetBodyTracker()->SetSkeletonListener(k_nBodyFusionListenerSlot, &m_bodyFusion);
+
+	IBodyJointSource* pJointSource = bBodyFusion ? (IBodyJointSource*)&m_bodyFusion : pTracker->GetBodyTracker();
+	for (int i = 0; (settings.bBodyTracking || bBodyFusion) && i < BodyJoint_Count; i++)
+	{
+		CZedBodyTrackerDriver* pBodyTracker = new CZedBodyTrackerDriver(pJointSource, (EBodyJoint)i, pTracker->GetSerialNumber());
+		m_vecBodyTrackers.push_back(pBodyTracker);
+		vr::VRServerDriverHost()->TrackedDeviceAdded(pBodyTracker->GetSerialNumber().c_str(), vr::TrackedDeviceClass_GenericTracker, pBodyTracker);
+	}
+	for (int i = 0; settings.bBodyTracking && settings.bHandTracking && i < Hand_Count; i++)
+	{
+		CZedHandDriver* pHand = new CZedHandDriver(pTracker->GetBodyTracker(), (EHand)i, pTracker->GetSerialNumber());
+		m_vecHands.push_back(pHand);
+		vr::VRServerDriverHost()->TrackedDeviceAdded(pHand->GetSerialNumber().c_str(), vr::TrackedDeviceClass_Controller, pHand);
+	}
+
+	std::vector<int> vecMarkerIds = ParseMarkerIds(settings.sMarkerIds);
+	for (size_t i = 0; i < vecMarkerIds.size(); i++)
+	{
+		CZedMarkerDriver* pMarker = new CZedMarkerDriver(pTracker->GetMarkerTracker(), (int)i, vecMarkerIds[i], pTracker->GetSerialNumber());
+		m_vecMarkers.push_back(pMarker);
+		vr::VRServerDriverHost()->TrackedDeviceAdded(pMarker->GetSerialNumber().c_str(), vr::TrackedDeviceClass_GenericTracker, pMarker);
+	}
+	for (int i = 0; i < settings.nObjectTrackers; i++)
+	{
+		CZedObjectDriver* pObject = new CZedObjectDriver(pTracker->GetObjectTracker(), i, pTracker->GetSerialNumber());
+		m_vecObjects.push_back(pObject);
+		vr::VRServerDriverHost()->TrackedDeviceAdded(pObject->GetSerialNumber().c_str(), vr::TrackedDeviceClass_GenericTracker, pObject);
+	}
+
+	// the calibrator samples the first camera, the chaperone comes from its map
+	if (m_vecTrackers.size() == 1)
+	{
+		UpdateWorldCalibrator();
+		UpdateChaperoneGenerator();
+	}
+	return pTracker;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hot-plug, a job on the pool. Counting the USB devices costs a few
+// milliseconds; only when there are more than before is the SDK asked for
+// the serials, which loads it the first time.
+//-----------------------------------------------------------------------------
+void CServerDriver_Zedm::PollCameras()
+{
+	uint32_t unUsbDevices = CountZedUsbDevices();
+	if (unUsbDevices > m_unUsbDevices)
+		m_nPendingEnumerations = k_nCameraEnumerations;
+	m_unUsbDevices = unUsbDevices;
+	if (m_nPendingEnumerations == 0)
+		return;
+	m_nPendingEnumerations--;
+
+	std::vector<unsigned int> vecNew;
+	for (unsigned int unCameraSerial : EnumerateZedCameras())
+	{
+		if (std::find(m_vecKnownCameras.begin(), m_vecKnownCameras.end(), unCameraSerial) != m_vecKnownCameras.end())
+			continue;
+		DriverLog("ZED %u plugged in\n", unCameraSerial);
+		m_vecKnownCameras.push_back(unCameraSerial);
+		vecNew.push_back(unCameraSerial);
+	}
+	if (vecNew.empty())
+		return;
+	m_nPendingEnumerations = 0;
+
+	std::lock_guard<std::mutex> lock(m_pluggedMutex);
+	m_vecPluggedCameras.insert(m_vecPluggedCameras.end(), vecNew.begin(), vecNew.end());
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds the devices of the cameras PollCameras found, on the thread
+// that owns the device list
+//-----------------------------------------------------------------------------
+void CServerDriver_Zedm::AddPluggedCameras()
+{
+	std::vector<unsigned int> vecPlugged;
+	{
+		std::lock_guard<std::mutex> lock(m_pluggedMutex);
+		vecPlugged.swap(m_vecPluggedCameras);
+	}
+	if (vecPlugged.empty())
+		return;
+
+	// DebugRequest reloads the settings into the device list too
+	std::lock_guard<std::mutex> lock(m_settingsMutex);
+	for (unsigned int unCameraSerial : vecPlugged)
+		AddCameraDevice(unCameraSerial, !m_vecTrackers.empty() || vecPlugged.size() > 1);
+}
+
+void CServerDriver_Zedm::Cleanup()
+{
+	// no devices added from here on
+	m_cameraPoll.Stop();
+	m_vecPluggedCameras.clear();
+
+	// before the trackers they sample
+	m_rigFusion.Stop();
+	m_worldCalibrator.Stop();
+	m_chaperoneGenerator.Stop();
+	m_telemetry.Stop();
+	if (!m_vecTrackers.empty() && m_bodyFusion.IsRunning())
+		m_vecTrackers[0]->GetBodyTracker()->SetSkeletonListener(k_nBodyFusionListenerSlot, nullptr);
+	m_bodyFusion.Stop();
+
+	for (CZedBodyTrackerDriver* pBodyTracker : m_vecBodyTrackers)
+		delete pBodyTracker;
+	m_vecBodyTrackers.clear();
+	for (CZedMarkerDriver* pMarker : m_vecMarkers)
+		delete pMarker;
+	m_vecMarkers.clear();
+	for (CZedObjectDriver* pObject : m_vecObjects)
+		delete pObject;
+	m_vecObjects.clear();
+	for (CZedSyntheticDriver* pSynthetic : m_vecSyntheticTrackers)
+		delete pSynthetic;
+	m_vecSyntheticTrackers.clear();
+	for (CZedmDriver* pTracker : m_vecTrackers)
+		delete pTracker;
+	m_vecTrackers.clear();
+
+	// after the trackers, whose body tracker publishers call into the hands
+	for (CZedHandDriver* pHand : m_vecHands)
+		delete pHand;
+	m_vecHands.clear();
+
+	// every job's owner is gone by now
+	m_workerPool.Stop();
+
+	// no zones left, the threads that record them are all gone
+	StopTraceZones();
+
+	// last, the trackers log while their cameras close
+	CleanupDriverLog();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: The whole system is idle; the cameras stop grabbing so GPU and
+// CPU are free for whatever else runs on the machine.
+//-----------------------------------------------------------------------------
+void CServerDriver_Zedm::EnterStandby()
+{
+	DriverLog("Entering standby\n");
+	for (CZedmDriver* pTracker : m_vecTrackers)
+		pTracker->EnterStandby();
+}
+
+void CServerDriver_Zedm::LeaveStandby()
+{
+	DriverLog("Leaving standby\n");
+	for (CZedmDriver* pTracker : m_vecTrackers)
+		pTracker->LeaveStandby();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Rereads the settings into a new snapshot and passes it to every
+// device. SteamVR has no change event for a driver's own section, so this
+// runs on any of the *SettingChanged events it does send, and on
+// DebugRequest("reload_settings") for tuning tools.
+//-----------------------------------------------------------------------------
+void CServerDriver_Zedm::ReloadSettings()
+{
+	std::lock_guard<std::mutex> lock(m_settingsMutex);
+
+	ZedmSettings_t settings;
+	LoadDriverSettings(&settings);
+	ApplyAppPrediction(&settings);
+	std::shared_ptr<const ZedmSettings_t> pSettings = std::make_shared<ZedmSettings_t>(settings);
+	std::atomic_store(&m_pSettings, pSettings);
+	for (CZedmDriver* pTracker : m_vecTrackers)
+		pTracker->UpdateSettings(settings);
+	for (CZedSyntheticDriver* pSynthetic : m_vecSyntheticTrackers)
+		pSynthetic->UpdateSettings(settings);
+	UpdateWorldCalibrator();
+	UpdateChaperoneGenerator();
+	UpdateTelemetry();
+	DriverLog("Settings reloaded\n");
+}
+
+// predictionApps: the scene application's own horizon in place of predictionHorizon
+void CServerDriver_Zedm::ApplyAppPrediction(ZedmSettings_t* pSettings) const
+{
+	uint32_t unSceneProcessId = m_unSceneProcessId;
+	if (pSettings->sPredictionApps.empty() || unSceneProcessId == 0)
+		return;
+
+	std::string sExecutable = GetProcessExecutableName(unSceneProcessId);
+	float flHorizon;
+	if (sExecutable.empty() || !FindAppPredictionHorizon(pSettings->sPredictionApps, sExecutable, &flHorizon))
+		return;
+	pSettings->flPredictionHorizon = flHorizon;
+	DriverLog("Prediction horizon %.1f ms for %s\n", flHorizon * 1e3f, sExecutable.c_str());
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts, restarts or stops the calibrator of the first camera for
+// the calibrationDevice setting. Called with the settings in place.
+//-----------------------------------------------------------------------------
+void CServerDriver_Zedm::UpdateWorldCalibrator()
+{
+	std::shared_ptr<const ZedmSettings_t> pSettings = std::atomic_load(&m_pSettings);
+	CZedTracker* pTracker = m_vecTrackers.empty() ? nullptr : m_vecTrackers[0]->GetZedTracker();
+	if (pSettings->sCalibrationDevice.empty() || !pTracker)
+	{
+		m_worldCalibrator.Stop();
+		return;
+	}
+	if (!m_worldCalibrator.IsRunning() || m_worldCalibrator.GetDeviceSerial() != pSettings->sCalibrationDevice)
+		m_worldCalibrator.Start(&m_workerPool, pTracker, pSettings->sCalibrationDevice);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: A new solution of the calibrator goes into worldOffset / worldYaw,
+// so it persists, and reaches the trackers with the reload. The offset the
+// floor detection adds on top is taken back out of the solved one.
+//-----------------------------------------------------------------------------
+void CServerDriver_Zedm::ApplyWorldCalibration()
+{
+	WorldCalibration_t solution;
+	if (!m_worldCalibrator.TakeSolution(m_unAppliedCalibration, &solution))
+		return;
+	m_unAppliedCalibration = solution.unSolution;
+
+	DriverPose_t anchorSpace;
+	bool bTracking;
+	m_vecTrackers[0]->GetAnchorSpace(&anchorSpace, &bTracking);
+	std::shared_ptr<const ZedmSettings_t> pSettings = std::atomic_load(&m_pSettings);
+	const char* const rgpchOffsetKeys[3] = { k_pch_Sample_WorldOffsetX_Float, k_pch_Sample_WorldOffsetY_Float, k_pch_Sample_WorldOffsetZ_Float };
+	for (int i = 0; i < 3; i++)
+	{
+		double flDetected = anchorSpace.vecWorldFromDriverTranslation[i] - pSettings->vecWorldFromDriverTranslation[i];
+		vr::VRSettings()->SetFloat(k_pch_Sample_Section, rgpchOffsetKeys[i], (float)(solution.vecOffset[i] - flDetected));
+	}
+	vr::VRSettings()->SetFloat(k_pch_Sample_Section, k_pch_Sample_WorldYaw_Float, (float)solution.flYaw);
+	ReloadSettings();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts, restarts or stops the chaperone generator of the first
+// camera for the chaperonePath setting. Called with the settings in place.
+//-----------------------------------------------------------------------------
+void CServerDriver_Zedm::UpdateChaperoneGenerator()
+{
+	std::shared_ptr<const ZedmSettings_t> pSettings = std::atomic_load(&m_pSettings);
+	CZedTracker* pTracker = m_vecTrackers.empty() ? nullptr : m_vecTrackers[0]->GetZedTracker();
+	if (pSettings->sChaperonePath.empty() || !pTracker)
+	{
+		m_chaperoneGenerator.Stop();
+		return;
+	}
+	if (!pSettings->bSpatialMapping)
+	{
+		if (m_chaperoneGenerator.IsRunning() || m_vecTrackers.size() == 1)
+			DriverLog("chaperonePath needs spatialMapping, no chaperone bounds\n");
+		m_chaperoneGenerator.Stop();
+		return;
+	}
+	if (!m_chaperoneGenerator.IsRunning() || m_chaperoneGenerator.GetPath() != pSettings->sChaperonePath)
+		m_chaperoneGenerator.Start(&m_workerPool, pTracker, pSettings->sChaperonePath, pSettings->flChaperoneInterval, pSettings->flChaperoneThreshold);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts, restarts or stops pushing the stats for the telemetry
+// settings. Called with the settings in place.
+//-----------------------------------------------------------------------------
+void CServerDriver_Zedm::UpdateTelemetry()
+{
+	std::shared_ptr<const ZedmSettings_t> pSettings = std::atomic_load(&m_pSettings);
+	if (pSettings->sTelemetryCollector.empty())
+	{
+		m_telemetry.Stop();
+		return;
+	}
+	if (m_telemetry.IsRunning() && m_telemetry.GetCollector() == pSettings->sTelemetryCollector && m_telemetry.GetPrefix() == pSettings->sTelemetryPrefix
+		&& m_telemetry.GetInterval() == pSettings->flTelemetryInterval)
+		return;
+	m_telemetry.Start(&m_workerPool, pSettings->sTelemetryCollector, pSettings->sTelemetryPrefix, pSettings->flTelemetryInterval);
+}
+
+// the first camera's device hands a newly written file to SteamVR
+void CServerDriver_Zedm::ApplyChaperoneBounds()
+{
+	ChaperoneBounds_t bounds;
+	if (!m_chaperoneGenerator.TakeBounds(m_unAppliedChaperone, &bounds))
+		return;
+	m_unAppliedChaperone = bounds.unRevision;
+	m_vecTrackers[0]->SetChaperonePath(m_chaperoneGenerator.GetPath());
+}
+
+static bool IsSettingsChangedEvent(uint32_t eventType)
+{
+	return (eventType >= VREvent_BackgroundSettingHasChanged && eventType <= VREvent_DismissedWarningsSectionSettingChanged)
+		|| eventType == VREvent_ChaperoneSettingsHaveChanged
+		|| eventType == VREvent_AudioSettingsHaveChanged;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: From the compositor's latest frame: its GPU time over the HMD's
+// frame budget for frameGovernor, where a dropped frame counts as fully
+// loaded, and its vsync for vsyncPublish.
+//-----------------------------------------------------------------------------
+void CServerDriver_Zedm::UpdateFrameTiming()
+{
+	vr::Compositor_FrameTiming timing = {};
+	timing.m_nSize = sizeof(timing);
+	if (vr::VRServerDriverHost()->GetFrameTimings(&timing, 1) == 0)
+		return;
+
+	vr::PropertyContainerHandle_t ulHmd = vr::VRProperties()->TrackedDeviceToPropertyContainer(vr::k_unTrackedDeviceIndex_Hmd);
+	float flDisplayFrequency = vr::VRProperties()->GetFloatProperty(ulHmd, Prop_DisplayFrequency_Float);
+	if (flDisplayFrequency <= 0.0f)
+		flDisplayFrequency = 90.0f;
+
+	std::shared_ptr<const ZedmSettings_t> pSettings = std::atomic_load(&m_pSettings);
+
+	if (pSettings->bVsyncPublish && timing.m_flSystemTimeInSeconds > 0.0)
+	{
+		uint64_t ulVsyncNs = (uint64_t)(timing.m_flSystemTimeInSeconds * 1e9);
+		for (CZedmDriver* pTracker : m_vecTrackers)
+			pTracker->SetVsync(ulVsyncNs, 1.0 / flDisplayFrequency);
+	}
+
+	if (!pSettings->bFrameGovernor)
+		return;
+	float flGpuLoad = timing.m_flTotalRenderGpuMs * flDisplayFrequency / 1000.0f;
+	if (timing.m_nNumDroppedFrames > 0 && flGpuLoad < 1.0f)
+		flGpuLoad = 1.0f;
+	for (CZedmDriver* pTracker : m_vecTrackers)
+		pTracker->SetGpuLoad(flGpuLoad);
+}
+
+void CServerDriver_Zedm::RunFrame()
+{
+	if (m_cameraPoll.IsRunning())
+		AddPluggedCameras();
+
+	for (CZedmDriver* pTracker : m_vecTrackers)
+	{
+		pTracker->RunFrame();
+	}
+
+	std::shared_ptr<const ZedmSettings_t> pSettings = std::atomic_load(&m_pSettings);
+
+	if (pSettings->bFrameGovernor || pSettings->bVsyncPublish)
+		UpdateFrameTiming();
+
+	bool bReloadSettings = false;
+	vr::VREvent_t vrEvent;
+	while (vr::VRServerDriverHost()->PollNextEvent(&vrEvent, sizeof(vrEvent)))
+	{
+		bReloadSettings = bReloadSettings || IsSettingsChangedEvent(vrEvent.eventType);
+		if (vrEvent.eventType == VREvent_SceneApplicationChanged)
+		{
+			m_unSceneProcessId = vrEvent.data.process.pid;
+			bReloadSettings = bReloadSettings || !pSettings->sPredictionApps.empty();
+		}
+		m_spatialAnchors.ProcessEvent(vrEvent);
+		for (CZedmDriver* pTracker : m_vecTrackers)
+		{
+			pTracker->ProcessEvent(vrEvent);
+		}
+	}
+
+	// once per batch of events, however many settings changed
+	if (bReloadSettings)
+		ReloadSettings();
+
+	if (m_worldCalibrator.IsRunning())
+		ApplyWorldCalibration();
+	if (m_chaperoneGenerator.IsRunning())
+		ApplyChaperoneBounds();
+
+	if (!m_vecTrackers.empty())
+	{
+		DriverPose_t anchorSpace;
+		bool bTracking;
+		m_vecTrackers[0]->GetAnchorSpace(&anchorSpace, &bTracking);
+		m_spatialAnchors.Update(anchorSpace, bTracking);
 	}
 }
 
@@ -3,32 +3,489 @@
 #include <stdio.h>
 #include <stdarg.h>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 static vr::IVRDriverLog * s_pLogFile = NULL;
 
 #if !defined( WIN32)
 #define vsnprintf_s vsnprintf
 #endif
 
+// --------------------------------------------------------------------------
+// Purpose: Bounded multi-producer / single-consumer queue of formatted log
+// lines. Producers claim a slot with one CAS and format straight into it; the
+// flush thread forwards completed slots to vrserver. A full queue drops the
+// line and counts it, so logging never blocks the caller.
+// --------------------------------------------------------------------------
+static const uint32_t k_unLogRecordSize = 1024;
+static const uint32_t k_unLogQueueSize = 256; // must be a power of two
+static const std::chrono::milliseconds k_LogFlushInterval( 10 );
+
+struct LogRecord_t
+{
+	std::atomic< uint32_t > unSequence;
+	bool bBinary;
+	BinaryLogRecordHeader_t binaryHeader;
+	char rchText[ k_unLogRecordSize ]; // formatted text, or binary argument payload
+};
+
+static LogRecord_t s_rLogQueue[ k_unLogQueueSize ];
+static std::atomic< uint32_t > s_unLogEnqueuePos( 0 );
+static std::atomic< uint32_t > s_unLogDequeuePos( 0 ); // written by the flusher only, atomic for GetDriverLogQueueDepth
+static std::atomic< uint32_t > s_unLogDropped( 0 );
+static std::atomic< uint64_t > s_ulLogDroppedTotal( 0 );
+
+static std::thread *s_pLogFlushThread = NULL;
+static std::atomic< bool > s_bLogFlushRunning( false );
+
+// format strings of DriverTrace call sites, indexed by format id
+static const uint32_t k_unMaxLogFormats = 1024;
+static const char *s_rpchLogFormats[ k_unMaxLogFormats ];
+static std::atomic< uint32_t > s_unLogFormatCount( 0 );
+
+// binary log file, written by the flush thread only
+static std::atomic< FILE * > s_pBinaryLogFile( NULL );
+static bool s_rbLogFormatWritten[ k_unMaxLogFormats ];
+
+static LogRecord_t *ClaimLogRecord( uint32_t *punPos )
+{
+	uint32_t unPos = s_unLogEnqueuePos.load( std::memory_order_relaxed );
+	for ( ;; )
+	{
+		LogRecord_t *pRecord = &s_rLogQueue[ unPos & ( k_unLogQueueSize - 1 ) ];
+		uint32_t unSequence = pRecord->unSequence.load( std::memory_order_acquire );
+		int32_t nDiff = (int32_t)unSequence - (int32_t)unPos;
+		if ( nDiff == 0 )
+		{
+			if ( s_unLogEnqueuePos.compare_exchange_weak( unPos, unPos + 1, std::memory_order_relaxed ) )
+			{
+				*punPos = unPos;
+				return pRecord;
+			}
+		}
+		else if ( nDiff < 0 )
+		{
+			// the flush thread hasn't caught up with this slot yet
+			return NULL;
+		}
+		else
+		{
+			unPos = s_unLogEnqueuePos.load( std::memory_order_relaxed );
+		}
+	}
+}
+
+static const char *GetLogFormat( uint32_t unFormatId )
+{
+	return unFormatId < k_unMaxLogFormats && s_rpchLogFormats[ unFormatId ] ? s_rpchLogFormats[ unFormatId ] : "<unknown format>\n";
+}
+
+static void WriteBinaryLogRecord( FILE *pFile, const LogRecord_t *pRecord )
+{
+	uint32_t unFormatId = pRecord->binaryHeader.unFormatId;
+	if ( unFormatId < k_unMaxLogFormats && !s_rbLogFormatWritten[ unFormatId ] )
+	{
+		// first use of this call site in the file: emit its format string so the decoder can resolve the id
+		const char *pchFormat = GetLogFormat( unFormatId );
+		BinaryLogRecordHeader_t formatHeader = pRecord->binaryHeader;
+		formatHeader.unType = BinaryLogRecord_Format;
+		formatHeader.unPayloadSize = (uint16_t)strlen( pchFormat );
+		fwrite( &formatHeader, sizeof( formatHeader ), 1, pFile );
+		fwrite( pchFormat, 1, formatHeader.unPayloadSize, pFile );
+		s_rbLogFormatWritten[ unFormatId ] = true;
+	}
+
+	fwrite( &pRecord->binaryHeader, sizeof( pRecord->binaryHeader ), 1, pFile );
+	fwrite( pRecord->rchText, 1, pRecord->binaryHeader.unPayloadSize, pFile );
+}
+
+// Forwards every completed record to vrserver or the binary log. Only called from one thread at a time.
+static void FlushLogQueue()
+{
+	FILE *pBinaryLogFile = s_pBinaryLogFile.load();
+	bool bWroteBinary = false;
+
+	uint32_t unDequeuePos = s_unLogDequeuePos.load( std::memory_order_relaxed );
+	for ( ;; )
+	{
+		LogRecord_t *pRecord = &s_rLogQueue[ unDequeuePos & ( k_unLogQueueSize - 1 ) ];
+		if ( pRecord->unSequence.load( std::memory_order_acquire ) != unDequeuePos + 1 )
+			break;
+
+		if ( !pRecord->bBinary )
+		{
+			if ( s_pLogFile )
+				s_pLogFile->Log( pRecord->rchText );
+		}
+		else
+		{
+			if ( pBinaryLogFile )
+			{
+				WriteBinaryLogRecord( pBinaryLogFile, pRecord );
+				bWroteBinary = true;
+			}
+
+			// without a binary log, or for anything an operator should see, format here, off the caller's thread
+			if ( s_pLogFile && ( !pBinaryLogFile || pRecord->binaryHeader.unLevel >= DriverLogLevel_Warning ) )
+			{
+				char buf[ k_unLogRecordSize ];
+				FormatBinaryLogRecord( GetLogFormat( pRecord->binaryHeader.unFormatId ), (const uint8_t *)pRecord->rchText,
+					pRecord->binaryHeader.unPayloadSize, buf, sizeof( buf ) );
+				s_pLogFile->Log( buf );
+			}
+		}
+
+		pRecord->unSequence.store( unDequeuePos + k_unLogQueueSize, std::memory_order_release );
+		unDequeuePos++;
+		s_unLogDequeuePos.store( unDequeuePos, std::memory_order_relaxed );
+	}
+
+	uint32_t unDropped = s_unLogDropped.exchange( 0 );
+	s_ulLogDroppedTotal += unDropped;
+	if ( unDropped && s_pLogFile )
+	{
+		char buf[ 64 ];
+		snprintf( buf, sizeof( buf ), "Log queue full, dropped %u messages\n", unDropped );
+		s_pLogFile->Log( buf );
+	}
+
+	if ( bWroteBinary )
+		fflush( pBinaryLogFile );
+}
+
+static void LogFlushThread()
+{
+	while ( s_bLogFlushRunning )
+	{
+		std::this_thread::sleep_for( k_LogFlushInterval );
+		FlushLogQueue();
+	}
+}
+
 bool InitDriverLog( vr::IVRDriverLog *pDriverLog )
 {
 	if( s_pLogFile )
 		return false;
 	s_pLogFile = pDriverLog;
+
+	uint32_t unDequeuePos = s_unLogDequeuePos.load();
+	for ( uint32_t i = 0; i < k_unLogQueueSize; i++ )
+		s_rLogQueue[ i ].unSequence.store( unDequeuePos + i, std::memory_order_relaxed );
+	s_unLogEnqueuePos = unDequeuePos;
+
+	s_bLogFlushRunning = true;
+	s_pLogFlushThread = new std::thread( LogFlushThread );
+
 	return s_pLogFile != NULL;
 }
 
 void CleanupDriverLog()
 {
+	if ( s_pLogFlushThread )
+	{
+		s_bLogFlushRunning = false;
+		s_pLogFlushThread->join();
+		delete s_pLogFlushThread;
+		s_pLogFlushThread = NULL;
+	}
+
+	// deliver whatever was queued after the thread's last pass
+	FlushLogQueue();
 	s_pLogFile = NULL;
+
+	FILE *pBinaryLogFile = s_pBinaryLogFile.exchange( NULL );
+	if ( pBinaryLogFile )
+		fclose( pBinaryLogFile );
+}
+
+uint32_t GetDriverLogQueueDepth()
+{
+	return s_unLogEnqueuePos.load( std::memory_order_relaxed ) - s_unLogDequeuePos.load( std::memory_order_relaxed );
+}
+
+uint64_t GetDriverLogDroppedCount()
+{
+	return s_ulLogDroppedTotal.load( std::memory_order_relaxed ) + s_unLogDropped.load( std::memory_order_relaxed );
+}
+
+bool OpenBinaryDriverLog( const char *pchPath )
+{
+	if ( s_pBinaryLogFile.load() )
+		return false;
+
+	FILE *pFile = fopen( pchPath, "wb" );
+	if ( !pFile )
+		return false;
+
+	BinaryLogFileHeader_t header;
+	header.unMagic = k_unBinaryLogMagic;
+	header.unVersion = k_unBinaryLogVersion;
+	fwrite( &header, sizeof( header ), 1, pFile );
+
+	for ( uint32_t i = 0; i < k_unMaxLogFormats; i++ )
+		s_rbLogFormatWritten[ i ] = false;
+
+	s_pBinaryLogFile = pFile;
+	return true;
+}
+
+uint32_t RegisterDriverLogFormat( const char *pchFormat )
+{
+	uint32_t unFormatId = s_unLogFormatCount++;
+	if ( unFormatId < k_unMaxLogFormats )
+		s_rpchLogFormats[ unFormatId ] = pchFormat;
+	return unFormatId;
+}
+
+void CBinaryLogArgs::Put( const char *pchValue )
+{
+	if ( !pchValue )
+		pchValue = "(null)";
+
+	size_t unLength = strlen( pchValue );
+	if ( m_unSize + 1 + sizeof( uint16_t ) >= sizeof( m_rgData ) )
+		return;
+	size_t unSpace = sizeof( m_rgData ) - m_unSize - 1 - sizeof( uint16_t );
+	uint16_t unStored = (uint16_t)( unLength < unSpace ? unLength : unSpace );
+
+	m_rgData[ m_unSize++ ] = BinaryLogArg_String;
+	memcpy( m_rgData + m_unSize, &unStored, sizeof( unStored ) );
+	m_unSize += sizeof( unStored );
+	memcpy( m_rgData + m_unSize, pchValue, unStored );
+	m_unSize += unStored;
+}
+
+void SubmitDriverLogRecord( EDriverLogLevel eLevel, uint32_t unFormatId, const CBinaryLogArgs &args )
+{
+	BinaryLogRecordHeader_t header;
+	header.unPayloadSize = (uint16_t)args.GetSize();
+	header.unType = BinaryLogRecord_Event;
+	header.unLevel = (uint8_t)eLevel;
+	header.unFormatId = unFormatId;
+	header.ulTimestampNs = (uint64_t)std::chrono::duration_cast< std::chrono::nanoseconds >(
+		std::chrono::steady_clock::now().time_since_epoch() ).count();
+
+	if ( !s_bLogFlushRunning )
+	{
+		char buf[ k_unLogRecordSize ];
+		FormatBinaryLogRecord( GetLogFormat( unFormatId ), args.GetData(), args.GetSize(), buf, sizeof( buf ) );
+		if ( s_pLogFile )
+			s_pLogFile->Log( buf );
+		return;
+	}
+
+	uint32_t unPos;
+	LogRecord_t *pRecord = ClaimLogRecord( &unPos );
+	if ( !pRecord )
+	{
+		s_unLogDropped++;
+		return;
+	}
+
+	pRecord->bBinary = true;
+	pRecord->binaryHeader = header;
+	memcpy( pRecord->rchText, args.GetData(), args.GetSize() );
+	pRecord->unSequence.store( unPos + 1, std::memory_order_release );
+}
+
+// --------------------------------------------------------------------------
+// Purpose: printf for a binary argument payload. Each conversion in the format
+// string consumes the next tagged value; length modifiers in the format are
+// ignored because every value was widened to 64 bits when it was recorded.
+// --------------------------------------------------------------------------
+void FormatBinaryLogRecord( const char *pchFormat, const uint8_t *pArgs, uint32_t unArgSize, char *pchOut, uint32_t unOutSize )
+{
+	if ( !unOutSize )
+		return;
+
+	uint32_t unArgPos = 0;
+	uint32_t unOut = 0;
+	const char *pch = pchFormat;
+
+	struct Arg_t
+	{
+		uint8_t unTag;
+		int64_t nValue;
+		uint64_t unValue;
+		double flValue;
+		const char *pchValue;
+		uint16_t unLength;
+	};
+
+	auto NextArg = [&]( Arg_t *pArg ) -> bool
+	{
+		if ( unArgPos >= unArgSize )
+			return false;
+		pArg->unTag = pArgs[ unArgPos++ ];
+		pArg->nValue = 0;
+		pArg->unValue = 0;
+		pArg->flValue = 0.0;
+		pArg->pchValue = "";
+		pArg->unLength = 0;
+		if ( pArg->unTag == BinaryLogArg_String )
+		{
+			if ( unArgPos + sizeof( uint16_t ) > unArgSize )
+				return false;
+			memcpy( &pArg->unLength, pArgs + unArgPos, sizeof( uint16_t ) );
+			unArgPos += sizeof( uint16_t );
+			if ( unArgPos + pArg->unLength > unArgSize )
+				return false;
+			pArg->pchValue = (const char *)pArgs + unArgPos;
+			unArgPos += pArg->unLength;
+			return true;
+		}
+
+		if ( unArgPos + 8 > unArgSize )
+			return false;
+		memcpy( &pArg->unValue, pArgs + unArgPos, 8 );
+		unArgPos += 8;
+		memcpy( &pArg->nValue, &pArg->unValue, 8 );
+		memcpy( &pArg->flValue, &pArg->unValue, 8 );
+		if ( pArg->unTag == BinaryLogArg_Double )
+		{
+			pArg->nValue = (int64_t)pArg->flValue;
+			pArg->unValue = (uint64_t)pArg->flValue;
+		}
+		else
+		{
+			pArg->flValue = pArg->unTag == BinaryLogArg_Int64 ? (double)pArg->nValue : (double)pArg->unValue;
+		}
+		return true;
+	};
+
+	auto Append = [&]( const char *pchText, size_t unLength )
+	{
+		for ( size_t i = 0; i < unLength && unOut + 1 < unOutSize; i++ )
+			pchOut[ unOut++ ] = pchText[ i ];
+	};
+
+	while ( *pch )
+	{
+		if ( *pch != '%' )
+		{
+			Append( pch++, 1 );
+			continue;
+		}
+
+		if ( pch[ 1 ] == '%' )
+		{
+			Append( "%", 1 );
+			pch += 2;
+			continue;
+		}
+
+		// collect flags, width and precision; drop length modifiers
+		char rchSpec[ 32 ];
+		uint32_t unSpec = 0;
+		rchSpec[ unSpec++ ] = *pch++;
+		int rnStar[ 2 ];
+		int nStars = 0;
+		while ( *pch && strchr( "-+ #0123456789.*", *pch ) && unSpec < sizeof( rchSpec ) - 4 )
+		{
+			if ( *pch == '*' && nStars < 2 )
+			{
+				Arg_t starArg;
+				rnStar[ nStars++ ] = NextArg( &starArg ) ? (int)starArg.nValue : 0;
+			}
+			rchSpec[ unSpec++ ] = *pch++;
+		}
+		while ( *pch && strchr( "hljztLI6432", *pch ) )
+			pch++;
+
+		char chConversion = *pch;
+		if ( !chConversion )
+			break;
+		pch++;
+
+		Arg_t arg;
+		if ( !NextArg( &arg ) )
+		{
+			Append( "<missing>", 9 );
+			continue;
+		}
+
+		char rchValue[ 512 ];
+		int nLength = 0;
+		if ( strchr( "diouxXc", chConversion ) )
+		{
+			bool bSigned = chConversion == 'd' || chConversion == 'i' || chConversion == 'c';
+			if ( chConversion != 'c' )
+			{
+				rchSpec[ unSpec++ ] = 'l';
+				rchSpec[ unSpec++ ] = 'l';
+			}
+			rchSpec[ unSpec++ ] = chConversion;
+			rchSpec[ unSpec ] = 0;
+			if ( chConversion == 'c' )
+				nLength = nStars == 0 ? snprintf( rchValue, sizeof( rchValue ), rchSpec, (int)arg.nValue )
+					: snprintf( rchValue, sizeof( rchValue ), rchSpec, rnStar[ 0 ], (int)arg.nValue );
+			else if ( bSigned )
+				nLength = nStars == 0 ? snprintf( rchValue, sizeof( rchValue ), rchSpec, (long long)arg.nValue )
+					: nStars == 1 ? snprintf( rchValue, sizeof( rchValue ), rchSpec, rnStar[ 0 ], (long long)arg.nValue )
+					: snprintf( rchValue, sizeof( rchValue ), rchSpec, rnStar[ 0 ], rnStar[ 1 ], (long long)arg.nValue );
+			else
+				nLength = nStars == 0 ? snprintf( rchValue, sizeof( rchValue ), rchSpec, (unsigned long long)arg.unValue )
+					: nStars == 1 ? snprintf( rchValue, sizeof( rchValue ), rchSpec, rnStar[ 0 ], (unsigned long long)arg.unValue )
+					: snprintf( rchValue, sizeof( rchValue ), rchSpec, rnStar[ 0 ], rnStar[ 1 ], (unsigned long long)arg.unValue );
+		}
+		else if ( strchr( "fFeEgGaA", chConversion ) )
+		{
+			rchSpec[ unSpec++ ] = chConversion;
+			rchSpec[ unSpec ] = 0;
+			nLength = nStars == 0 ? snprintf( rchValue, sizeof( rchValue ), rchSpec, arg.flValue )
+				: nStars == 1 ? snprintf( rchValue, sizeof( rchValue ), rchSpec, rnStar[ 0 ], arg.flValue )
+				: snprintf( rchValue, sizeof( rchValue ), rchSpec, rnStar[ 0 ], rnStar[ 1 ], arg.flValue );
+		}
+		else if ( chConversion == 's' )
+		{
+			// the payload string isn't terminated
+			char rchString[ k_unMaxBinaryLogArgs + 1 ];
+			memcpy( rchString, arg.pchValue, arg.unLength );
+			rchString[ arg.unLength ] = 0;
+			rchSpec[ unSpec++ ] = 's';
+			rchSpec[ unSpec ] = 0;
+			nLength = nStars == 0 ? snprintf( rchValue, sizeof( rchValue ), rchSpec, rchString )
+				: nStars == 1 ? snprintf( rchValue, sizeof( rchValue ), rchSpec, rnStar[ 0 ], rchString )
+				: snprintf( rchValue, sizeof( rchValue ), rchSpec, rnStar[ 0 ], rnStar[ 1 ], rchString );
+		}
+		else if ( chConversion == 'p' )
+		{
+			nLength = snprintf( rchValue, sizeof( rchValue ), "0x%llx", (unsigned long long)arg.unValue );
+		}
+
+		if ( nLength > 0 )
+			Append( rchValue, nLength < (int)sizeof( rchValue ) ? nLength : sizeof( rchValue ) - 1 );
+	}
+
+	pchOut[ unOut ] = 0;
 }
 
 static void DriverLogVarArgs( const char *pMsgFormat, va_list args )
 {
-	char buf[1024];
-	vsnprintf_s( buf, sizeof(buf), pMsgFormat, args );
+	if ( !s_bLogFlushRunning )
+	{
+		// not initialized (or shutting down): log synchronously
+		char buf[ k_unLogRecordSize ];
+		vsnprintf_s( buf, sizeof(buf), pMsgFormat, args );
 
-	if( s_pLogFile )
-		s_pLogFile->Log( buf );
+		if( s_pLogFile )
+			s_pLogFile->Log( buf );
+		return;
+	}
+
+	uint32_t unPos;
+	LogRecord_t *pRecord = ClaimLogRecord( &unPos );
+	if ( !pRecord )
+	{
+		s_unLogDropped++;
+		return;
+	}
+
+	pRecord->bBinary = false;
+	vsnprintf_s( pRecord->rchText, sizeof( pRecord->rchText ), pMsgFormat, args );
+	pRecord->unSequence.store( unPos + 1, std::memory_order_release );
 }
 
 
@@ -45,7 +502,7 @@ void DriverLog( const char *pMsgFormat, ... )
 
 void DebugDriverLog( const char *pMsgFormat, ... )
 {
-#ifdef _DEBUG
+#if DRIVERLOG_MIN_LEVEL <= 1 // DriverLogLevel_Debug
 	va_list args;
 	va_start( args, pMsgFormat );
 
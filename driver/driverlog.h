@@ -5,14 +5,40 @@
 
 #pragma once
 
+#include <stdint.h>
+#include <string.h>
 #include <string>
 #include <openvr_driver.h>
 
+enum EDriverLogLevel
+{
+	DriverLogLevel_Trace = 0,
+	DriverLogLevel_Debug = 1,
+	DriverLogLevel_Info = 2,
+	DriverLogLevel_Warning = 3,
+	DriverLogLevel_Error = 4,
+};
+
+// Lowest level compiled into the driver, as a number so the build can set it.
+// Calls below it are removed at compile time.
+#ifndef DRIVERLOG_MIN_LEVEL
+#ifdef _DEBUG
+#define DRIVERLOG_MIN_LEVEL 0 // DriverLogLevel_Trace
+#else
+#define DRIVERLOG_MIN_LEVEL 2 // DriverLogLevel_Info
+#endif
+#endif
+
+constexpr bool DriverLogLevelEnabled( EDriverLogLevel eLevel )
+{
+	return (int)eLevel >= DRIVERLOG_MIN_LEVEL;
+}
+
 extern void DriverLog( const char *pchFormat, ... );
 
 
 // --------------------------------------------------------------------------
-// Purpose: Write to the log file only in debug builds
+// Purpose: Write to the log file only when the debug level is compiled in
 // --------------------------------------------------------------------------
 extern void DebugDriverLog( const char *pchFormat, ... );
 
@@ -20,6 +46,133 @@ extern void DebugDriverLog( const char *pchFormat, ... );
 extern bool InitDriverLog( vr::IVRDriverLog *pDriverLog );
 extern void CleanupDriverLog();
 
+/** Records waiting for the flush thread, and records dropped because the queue was full */
+extern uint32_t GetDriverLogQueueDepth();
+extern uint64_t GetDriverLogDroppedCount();
+
+
+// --------------------------------------------------------------------------
+// Purpose: Binary log records. Instead of formatting on the calling thread,
+// DriverTrace stores the format string id and the raw argument values; the
+// flush thread either appends the record to the binary log file (decoded
+// offline by zedm_logdecode) or formats it for vrserver.txt itself.
+//
+// Supported argument types are integers, floating point values, C strings
+// and pointers, which covers the printf conversions used by the driver.
+// --------------------------------------------------------------------------
+#define DriverTrace( eLevel, pchFormat, ... ) \
+	do \
+	{ \
+		if ( DriverLogLevelEnabled( eLevel ) ) \
+		{ \
+			static const uint32_t s_unFormatId = RegisterDriverLogFormat( pchFormat ); \
+			WriteDriverLogRecord( eLevel, s_unFormatId, ##__VA_ARGS__ ); \
+		} \
+	} while ( 0 )
+
+#define DriverLogTrace( pchFormat, ... ) DriverTrace( DriverLogLevel_Trace, pchFormat, ##__VA_ARGS__ )
+#define DriverLogDebug( pchFormat, ... ) DriverTrace( DriverLogLevel_Debug, pchFormat, ##__VA_ARGS__ )
+#define DriverLogInfo( pchFormat, ... ) DriverTrace( DriverLogLevel_Info, pchFormat, ##__VA_ARGS__ )
+#define DriverLogWarning( pchFormat, ... ) DriverTrace( DriverLogLevel_Warning, pchFormat, ##__VA_ARGS__ )
+#define DriverLogError( pchFormat, ... ) DriverTrace( DriverLogLevel_Error, pchFormat, ##__VA_ARGS__ )
+
+/** Starts appending binary records to pchPath. Returns false if the file can't be created. */
+extern bool OpenBinaryDriverLog( const char *pchPath );
+
+/** Assigns an id to a format string literal. The pointer must stay valid for the life of the driver. */
+extern uint32_t RegisterDriverLogFormat( const char *pchFormat );
+
+// binary file layout: BinaryLogFileHeader_t, then BinaryLogRecordHeader_t + payload records
+static const uint32_t k_unBinaryLogMagic = 0x474c5a5a; // "ZZLG"
+static const uint32_t k_unBinaryLogVersion = 1;
+static const uint32_t k_unMaxBinaryLogArgs = 768;
+
+enum EBinaryLogRecordType
+{
+	BinaryLogRecord_Format = 0,	// payload: format string of unFormatId
+	BinaryLogRecord_Event = 1,	// payload: tagged argument values
+};
+
+enum EBinaryLogArgTag
+{
+	BinaryLogArg_Int64 = 1,
+	BinaryLogArg_UInt64 = 2,
+	BinaryLogArg_Double = 3,
+	BinaryLogArg_String = 4,	// followed by uint16_t length and the characters
+	BinaryLogArg_Pointer = 5,
+};
+
+#pragma pack( push, 1 )
+struct BinaryLogFileHeader_t
+{
+	uint32_t unMagic;
+	uint32_t unVersion;
+};
+
+struct BinaryLogRecordHeader_t
+{
+	uint16_t unPayloadSize;
+	uint8_t unType;
+	uint8_t unLevel;
+	uint32_t unFormatId;
+	uint64_t ulTimestampNs;
+};
+#pragma pack( pop )
+
+/** Formats a tagged argument payload with its format string; shared by the flush thread and the offline decoder. */
+extern void FormatBinaryLogRecord( const char *pchFormat, const uint8_t *pArgs, uint32_t unArgSize, char *pchOut, uint32_t unOutSize );
+
+class CBinaryLogArgs
+{
+public:
+	CBinaryLogArgs() : m_unSize( 0 ) {}
+
+	void Put( int nValue ) { PutScalar( BinaryLogArg_Int64, (int64_t)nValue ); }
+	void Put( long nValue ) { PutScalar( BinaryLogArg_Int64, (int64_t)nValue ); }
+	void Put( long long nValue ) { PutScalar( BinaryLogArg_Int64, (int64_t)nValue ); }
+	void Put( unsigned int unValue ) { PutScalar( BinaryLogArg_UInt64, (uint64_t)unValue ); }
+	void Put( unsigned long unValue ) { PutScalar( BinaryLogArg_UInt64, (uint64_t)unValue ); }
+	void Put( unsigned long long unValue ) { PutScalar( BinaryLogArg_UInt64, (uint64_t)unValue ); }
+	void Put( double flValue ) { PutScalar( BinaryLogArg_Double, flValue ); }
+	void Put( const void *pValue ) { PutScalar( BinaryLogArg_Pointer, (uint64_t)(uintptr_t)pValue ); }
+	void Put( const char *pchValue );
+	void Put( char *pchValue ) { Put( (const char *)pchValue ); }
+
+	const uint8_t *GetData() const { return m_rgData; }
+	uint32_t GetSize() const { return m_unSize; }
+
+private:
+	template< typename T >
+	void PutScalar( uint8_t unTag, T value )
+	{
+		if ( m_unSize + 1 + sizeof( T ) > sizeof( m_rgData ) )
+			return;
+		m_rgData[ m_unSize++ ] = unTag;
+		memcpy( m_rgData + m_unSize, &value, sizeof( T ) );
+		m_unSize += sizeof( T );
+	}
+
+	uint8_t m_rgData[ k_unMaxBinaryLogArgs ];
+	uint32_t m_unSize;
+};
+
+extern void SubmitDriverLogRecord( EDriverLogLevel eLevel, uint32_t unFormatId, const CBinaryLogArgs &args );
+
+inline void AppendDriverLogArgs( CBinaryLogArgs & ) {}
+
+template< typename T, typename... Rest >
+inline void AppendDriverLogArgs( CBinaryLogArgs &args, T value, Rest... rest )
+{
+	args.Put( value );
+	AppendDriverLogArgs( args, rest... );
+}
 
+template< typename... Args >
+inline void WriteDriverLogRecord( EDriverLogLevel eLevel, uint32_t unFormatId, Args... args )
+{
+	CBinaryLogArgs binaryArgs;
+	AppendDriverLogArgs( binaryArgs, args... );
+	SubmitDriverLogRecord( eLevel, unFormatId, binaryArgs );
+}
 
-#endif // DRIVERLOG_H
\ No newline at end of file
+#endif // DRIVERLOG_H
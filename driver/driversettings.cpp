@@ -0,0 +1,175 @@
+#include "driversettings.h"
+#include "hmdmath.h"
+
+static const double k_flDegreesToRadians = 3.14159265358979323846 / 180.0;
+
+static bool GetBoolSetting(const char* pchKey, bool bDefault)
+{
+	vr::EVRSettingsError eError = vr::VRSettingsError_None;
+	bool bValue = vr::VRSettings()->GetBool(k_pch_Sample_Section, pchKey, &eError);
+	return eError == vr::VRSettingsError_None ? bValue : bDefault;
+}
+
+static int32_t GetInt32Setting(const char* pchKey, int32_t nDefault)
+{
+	vr::EVRSettingsError eError = vr::VRSettingsError_None;
+	int32_t nValue = vr::VRSettings()->GetInt32(k_pch_Sample_Section, pchKey, &eError);
+	return eError == vr::VRSettingsError_None ? nValue : nDefault;
+}
+
+static float GetFloatSetting(const char* pchKey, float flDefault)
+{
+	vr::EVRSettingsError eError = vr::VRSettingsError_None;
+	float flValue = vr::VRSettings()->GetFloat(k_pch_Sample_Section, pchKey, &eError);
+	return eError == vr::VRSettingsError_None ? flValue : flDefault;
+}
+
+static std::string GetStringSetting(const char* pchKey, const char* pchDefault)
+{
+	char rchValue[1024];
+	vr::EVRSettingsError eError = vr::VRSettingsError_None;
+	vr::VRSettings()->GetString(k_pch_Sample_Section, pchKey, rchValue, sizeof(rchValue), &eError);
+	return eError == vr::VRSettingsError_None ? rchValue : pchDefault;
+}
+
+void LoadDriverSettings(ZedmSettings_t* pSettings)
+{
+	const ZedmSettings_t defaults;
+
+	pSettings->nTraceInterval = GetInt32Setting(k_pch_Sample_TraceInterval_Int32, defaults.nTraceInterval);
+	pSettings->bTraceEveryFrame = GetBoolSetting(k_pch_Sample_TraceEveryFrame_Bool, defaults.bTraceEveryFrame);
+	pSettings->sBinaryLogPath = GetStringSetting(k_pch_Sample_BinaryLogPath_String, defaults.sBinaryLogPath.c_str());
+	pSettings->sSvoPath = GetStringSetting(k_pch_Sample_SvoPath_String, defaults.sSvoPath.c_str());
+	pSettings->bSvoRealTime = GetBoolSetting(k_pch_Sample_SvoRealTime_Bool, defaults.bSvoRealTime);
+	pSettings->bSvoLoop = GetBoolSetting(k_pch_Sample_SvoLoop_Bool, defaults.bSvoLoop);
+	pSettings->sPoseRecordingPath = GetStringSetting(k_pch_Sample_PoseRecordingPath_String, defaults.sPoseRecordingPath.c_str());
+	pSettings->sThreadAffinityMask = GetStringSetting(k_pch_Sample_ThreadAffinityMask_String, defaults.sThreadAffinityMask.c_str());
+	pSettings->nThreadPriority = GetInt32Setting(k_pch_Sample_ThreadPriority_Int32, defaults.nThreadPriority);
+	pSettings->sThreadMmcssTask = GetStringSetting(k_pch_Sample_ThreadMmcssTask_String, defaults.sThreadMmcssTask.c_str());
+	pSettings->nCudaDevice = GetInt32Setting(k_pch_Sample_CudaDevice_Int32, defaults.nCudaDevice);
+	pSettings->bShareCudaContext = GetBoolSetting(k_pch_Sample_ShareCudaContext_Bool, defaults.bShareCudaContext);
+	pSettings->bTrackingOnly = GetBoolSetting(k_pch_Sample_TrackingOnly_Bool, defaults.bTrackingOnly);
+	pSettings->sCameraProfile = GetStringSetting(k_pch_Sample_CameraProfile_String, defaults.sCameraProfile.c_str());
+	pSettings->sAutoTunePath = GetStringSetting(k_pch_Sample_AutoTunePath_String, defaults.sAutoTunePath.c_str());
+	pSettings->flAutoTuneBudget = GetFloatSetting(k_pch_Sample_AutoTuneBudget_Float, defaults.flAutoTuneBudget);
+	pSettings->rgflWorldOffset[0] = GetFloatSetting(k_pch_Sample_WorldOffsetX_Float, defaults.rgflWorldOffset[0]);
+	pSettings->rgflWorldOffset[1] = GetFloatSetting(k_pch_Sample_WorldOffsetY_Float, defaults.rgflWorldOffset[1]);
+	pSettings->rgflWorldOffset[2] = GetFloatSetting(k_pch_Sample_WorldOffsetZ_Float, defaults.rgflWorldOffset[2]);
+	pSettings->flWorldYaw = GetFloatSetting(k_pch_Sample_WorldYaw_Float, defaults.flWorldYaw);
+	pSettings->rgflHeadOffset[0] = GetFloatSetting(k_pch_Sample_HeadOffsetX_Float, defaults.rgflHeadOffset[0]);
+	pSettings->rgflHeadOffset[1] = GetFloatSetting(k_pch_Sample_HeadOffsetY_Float, defaults.rgflHeadOffset[1]);
+	pSettings->rgflHeadOffset[2] = GetFloatSetting(k_pch_Sample_HeadOffsetZ_Float, defaults.rgflHeadOffset[2]);
+	pSettings->flHeadYaw = GetFloatSetting(k_pch_Sample_HeadYaw_Float, defaults.flHeadYaw);
+	pSettings->flHeadPitch = GetFloatSetting(k_pch_Sample_HeadPitch_Float, defaults.flHeadPitch);
+	pSettings->flHeadRoll = GetFloatSetting(k_pch_Sample_HeadRoll_Float, defaults.flHeadRoll);
+	pSettings->flFusionTimeConstant = GetFloatSetting(k_pch_Sample_FusionTimeConstant_Float, defaults.flFusionTimeConstant);
+	pSettings->flVelocitySmoothing = GetFloatSetting(k_pch_Sample_VelocitySmoothing_Float, defaults.flVelocitySmoothing);
+	pSettings->flDeadReckoningTime = GetFloatSetting(k_pch_Sample_DeadReckoningTime_Float, defaults.flDeadReckoningTime);
+	pSettings->flDeadReckoningDamping = GetFloatSetting(k_pch_Sample_DeadReckoningDamping_Float, defaults.flDeadReckoningDamping);
+	pSettings->bGpuPassthrough = GetBoolSetting(k_pch_Sample_GpuPassthrough_Bool, defaults.bGpuPassthrough);
+	pSettings->nPassthroughBuffers = GetInt32Setting(k_pch_Sample_PassthroughBuffers_Int32, defaults.nPassthroughBuffers);
+	pSettings->sAreaFilePath = GetStringSetting(k_pch_Sample_AreaFilePath_String, defaults.sAreaFilePath.c_str());
+	pSettings->sRoiMaskPath = GetStringSetting(k_pch_Sample_RoiMaskPath_String, defaults.sRoiMaskPath.c_str());
+	pSettings->sImuBiasPath = GetStringSetting(k_pch_Sample_ImuBiasPath_String, defaults.sImuBiasPath.c_str());
+	pSettings->sSdkCachePath = GetStringSetting(k_pch_Sample_SdkCachePath_String, defaults.sSdkCachePath.c_str());
+	pSettings->bSpatialMapping = GetBoolSetting(k_pch_Sample_SpatialMapping_Bool, defaults.bSpatialMapping);
+	pSettings->flSpatialMappingResolution = GetFloatSetting(k_pch_Sample_SpatialMappingResolution_Float, defaults.flSpatialMappingResolution);
+	pSettings->flSpatialMappingRange = GetFloatSetting(k_pch_Sample_SpatialMappingRange_Float, defaults.flSpatialMappingRange);
+	pSettings->flSpatialMappingInterval = GetFloatSetting(k_pch_Sample_SpatialMappingInterval_Float, defaults.flSpatialMappingInterval);
+	pSettings->bAutoFloorHeight = GetBoolSetting(k_pch_Sample_AutoFloorHeight_Bool, defaults.bAutoFloorHeight);
+	pSettings->bBodyTracking = GetBoolSetting(k_pch_Sample_BodyTracking_Bool, defaults.bBodyTracking);
+	pSettings->flBodyConfidence = GetFloatSetting(k_pch_Sample_BodyConfidence_Float, defaults.flBodyConfidence);
+	pSettings->bHandTracking = GetBoolSetting(k_pch_Sample_HandTracking_Bool, defaults.bHandTracking);
+	pSettings->bStandbyPause = GetBoolSetting(k_pch_Sample_StandbyPause_Bool, defaults.bStandbyPause);
+	pSettings->bFrameGovernor = GetBoolSetting(k_pch_Sample_FrameGovernor_Bool, defaults.bFrameGovernor);
+	pSettings->nGovernorMaxDivisor = GetInt32Setting(k_pch_Sample_GovernorMaxDivisor_Int32, defaults.nGovernorMaxDivisor);
+	pSettings->flGovernorMotionThreshold = GetFloatSetting(k_pch_Sample_GovernorMotionThreshold_Float, defaults.flGovernorMotionThreshold);
+	pSettings->flGovernorStaticTime = GetFloatSetting(k_pch_Sample_GovernorStaticTime_Float, defaults.flGovernorStaticTime);
+	pSettings->flGovernorGpuLoad = GetFloatSetting(k_pch_Sample_GovernorGpuLoad_Float, defaults.flGovernorGpuLoad);
+	pSettings->bPoseFilter = GetBoolSetting(k_pch_Sample_PoseFilter_Bool, defaults.bPoseFilter);
+	pSettings->flFilterMinCutoff = GetFloatSetting(k_pch_Sample_FilterMinCutoff_Float, defaults.flFilterMinCutoff);
+	pSettings->flFilterBeta = GetFloatSetting(k_pch_Sample_FilterBeta_Float, defaults.flFilterBeta);
+	pSettings->flFilterDerivativeCutoff = GetFloatSetting(k_pch_Sample_FilterDerivativeCutoff_Float, defaults.flFilterDerivativeCutoff);
+	pSettings->bBodyFilter = GetBoolSetting(k_pch_Sample_BodyFilter_Bool, defaults.bBodyFilter);
+	pSettings->flBodyFilterMinCutoff = GetFloatSetting(k_pch_Sample_BodyFilterMinCutoff_Float, defaults.flBodyFilterMinCutoff);
+	pSettings->flBodyFilterBeta = GetFloatSetting(k_pch_Sample_BodyFilterBeta_Float, defaults.flBodyFilterBeta);
+	pSettings->bPoseDedup = GetBoolSetting(k_pch_Sample_PoseDedup_Bool, defaults.bPoseDedup);
+	pSettings->flDedupPosition = GetFloatSetting(k_pch_Sample_DedupPosition_Float, defaults.flDedupPosition);
+	pSettings->flDedupRotation = GetFloatSetting(k_pch_Sample_DedupRotation_Float, defaults.flDedupRotation);
+	pSettings->flDedupKeepAlive = GetFloatSetting(k_pch_Sample_DedupKeepAlive_Float, defaults.flDedupKeepAlive);
+	pSettings->flPredictionHorizon = GetFloatSetting(k_pch_Sample_PredictionHorizon_Float, defaults.flPredictionHorizon);
+	pSettings->flPredictionJerk = GetFloatSetting(k_pch_Sample_PredictionJerk_Float, defaults.flPredictionJerk);
+	pSettings->flPredictionAngularAcceleration = GetFloatSetting(k_pch_Sample_PredictionAngularAcceleration_Float, defaults.flPredictionAngularAcceleration);
+	pSettings->sPredictionApps = GetStringSetting(k_pch_Sample_PredictionApps_String, defaults.sPredictionApps.c_str());
+	pSettings->bExposureTimestamp = GetBoolSetting(k_pch_Sample_ExposureTimestamp_Bool, defaults.bExposureTimestamp);
+	pSettings->flCameraTransportDelay = GetFloatSetting(k_pch_Sample_CameraTransportDelay_Float, defaults.flCameraTransportDelay);
+	pSettings->nRemotePort = GetInt32Setting(k_pch_Sample_RemotePort_Int32, defaults.nRemotePort);
+	pSettings->flRemoteJitterDelay = GetFloatSetting(k_pch_Sample_RemoteJitterDelay_Float, defaults.flRemoteJitterDelay);
+	pSettings->sGrabberPath = GetStringSetting(k_pch_Sample_GrabberPath_String, defaults.sGrabberPath.c_str());
+	pSettings->sGrabberArgs = GetStringSetting(k_pch_Sample_GrabberArgs_String, defaults.sGrabberArgs.c_str());
+	pSettings->nSyntheticTrackers = GetInt32Setting(k_pch_Sample_SyntheticTrackers_Int32, defaults.nSyntheticTrackers);
+	pSettings->flSyntheticRate = GetFloatSetting(k_pch_Sample_SyntheticRate_Float, defaults.flSyntheticRate);
+	pSettings->sSyntheticRecording = GetStringSetting(k_pch_Sample_SyntheticRecording_String, defaults.sSyntheticRecording.c_str());
+	pSettings->bSharedMemoryExport = GetBoolSetting(k_pch_Sample_SharedMemoryExport_Bool, defaults.bSharedMemoryExport);
+	pSettings->bVsyncPublish = GetBoolSetting(k_pch_Sample_VsyncPublish_Bool, defaults.bVsyncPublish);
+	pSettings->flVsyncPublishLead = GetFloatSetting(k_pch_Sample_VsyncPublishLead_Float, defaults.flVsyncPublishLead);
+	pSettings->bHmdMode = GetBoolSetting(k_pch_Sample_HmdMode_Bool, defaults.bHmdMode);
+	pSettings->nHmdWindowX = GetInt32Setting(k_pch_Sample_HmdWindowX_Int32, defaults.nHmdWindowX);
+	pSettings->nHmdWindowY = GetInt32Setting(k_pch_Sample_HmdWindowY_Int32, defaults.nHmdWindowY);
+	pSettings->nHmdWindowWidth = GetInt32Setting(k_pch_Sample_HmdWindowWidth_Int32, defaults.nHmdWindowWidth);
+	pSettings->nHmdWindowHeight = GetInt32Setting(k_pch_Sample_HmdWindowHeight_Int32, defaults.nHmdWindowHeight);
+	pSettings->nHmdRenderWidth = GetInt32Setting(k_pch_Sample_HmdRenderWidth_Int32, defaults.nHmdRenderWidth);
+	pSettings->nHmdRenderHeight = GetInt32Setting(k_pch_Sample_HmdRenderHeight_Int32, defaults.nHmdRenderHeight);
+	pSettings->flHmdDisplayFrequency = GetFloatSetting(k_pch_Sample_HmdDisplayFrequency_Float, defaults.flHmdDisplayFrequency);
+	pSettings->flHmdSecondsFromVsyncToPhotons = GetFloatSetting(k_pch_Sample_HmdSecondsFromVsyncToPhotons_Float, defaults.flHmdSecondsFromVsyncToPhotons);
+	pSettings->flHmdIpd = GetFloatSetting(k_pch_Sample_HmdIpd_Float, defaults.flHmdIpd);
+	pSettings->sCalibrationDevice = GetStringSetting(k_pch_Sample_CalibrationDevice_String, defaults.sCalibrationDevice.c_str());
+	pSettings->nWorkerThreads = GetInt32Setting(k_pch_Sample_WorkerThreads_Int32, defaults.nWorkerThreads);
+	pSettings->flGrabStallTimeout = GetFloatSetting(k_pch_Sample_GrabStallTimeout_Float, defaults.flGrabStallTimeout);
+	pSettings->nFrameSkip = GetInt32Setting(k_pch_Sample_FrameSkip_Int32, defaults.nFrameSkip);
+	pSettings->flFrameCpuBudget = GetFloatSetting(k_pch_Sample_FrameCpuBudget_Float, defaults.flFrameCpuBudget);
+	pSettings->bImuOnly = GetBoolSetting(k_pch_Sample_ImuOnly_Bool, defaults.bImuOnly);
+	pSettings->sRigCameras = GetStringSetting(k_pch_Sample_RigCameras_String, defaults.sRigCameras.c_str());
+	pSettings->bCameraPlanner = GetBoolSetting(k_pch_Sample_CameraPlanner_Bool, defaults.bCameraPlanner);
+	pSettings->sTraceZonesPath = GetStringSetting(k_pch_Sample_TraceZonesPath_String, defaults.sTraceZonesPath.c_str());
+	pSettings->bTraceZonesEtw = GetBoolSetting(k_pch_Sample_TraceZonesEtw_Bool, defaults.bTraceZonesEtw);
+	pSettings->bTraceZonesNvtx = GetBoolSetting(k_pch_Sample_TraceZonesNvtx_Bool, defaults.bTraceZonesNvtx);
+	pSettings->bMrCapture = GetBoolSetting(k_pch_Sample_MrCapture_Bool, defaults.bMrCapture);
+	pSettings->nMrCaptureBuffers = GetInt32Setting(k_pch_Sample_MrCaptureBuffers_Int32, defaults.nMrCaptureBuffers);
+	pSettings->bOcclusionDepth = GetBoolSetting(k_pch_Sample_OcclusionDepth_Bool, defaults.bOcclusionDepth);
+	pSettings->nOcclusionDepthDivisor = GetInt32Setting(k_pch_Sample_OcclusionDepthDivisor_Int32, defaults.nOcclusionDepthDivisor);
+	pSettings->bProximityWarning = GetBoolSetting(k_pch_Sample_ProximityWarning_Bool, defaults.bProximityWarning);
+	pSettings->nProximitySectors = GetInt32Setting(k_pch_Sample_ProximitySectors_Int32, defaults.nProximitySectors);
+	pSettings->flProximityRange = GetFloatSetting(k_pch_Sample_ProximityRange_Float, defaults.flProximityRange);
+	pSettings->sSvoRecordPath = GetStringSetting(k_pch_Sample_SvoRecordPath_String, defaults.sSvoRecordPath.c_str());
+	pSettings->sSvoRecordCodec = GetStringSetting(k_pch_Sample_SvoRecordCodec_String, defaults.sSvoRecordCodec.c_str());
+	pSettings->nSvoRecordBitrate = GetInt32Setting(k_pch_Sample_SvoRecordBitrate_Int32, defaults.nSvoRecordBitrate);
+	pSettings->flSvoRecordBudget = GetFloatSetting(k_pch_Sample_SvoRecordBudget_Float, defaults.flSvoRecordBudget);
+	pSettings->sMarkerIds = GetStringSetting(k_pch_Sample_MarkerIds_String, defaults.sMarkerIds.c_str());
+	pSettings->sMarkerDictionary = GetStringSetting(k_pch_Sample_MarkerDictionary_String, defaults.sMarkerDictionary.c_str());
+	pSettings->flMarkerSize = GetFloatSetting(k_pch_Sample_MarkerSize_Float, defaults.flMarkerSize);
+	pSettings->flMarkerRate = GetFloatSetting(k_pch_Sample_MarkerRate_Float, defaults.flMarkerRate);
+	pSettings->nObjectTrackers = GetInt32Setting(k_pch_Sample_ObjectTrackers_Int32, defaults.nObjectTrackers);
+	pSettings->sObjectClasses = GetStringSetting(k_pch_Sample_ObjectClasses_String, defaults.sObjectClasses.c_str());
+	pSettings->flObjectConfidence = GetFloatSetting(k_pch_Sample_ObjectConfidence_Float, defaults.flObjectConfidence);
+	pSettings->sChaperonePath = GetStringSetting(k_pch_Sample_ChaperonePath_String, defaults.sChaperonePath.c_str());
+	pSettings->flChaperoneInterval = GetFloatSetting(k_pch_Sample_ChaperoneInterval_Float, defaults.flChaperoneInterval);
+	pSettings->flChaperoneThreshold = GetFloatSetting(k_pch_Sample_ChaperoneThreshold_Float, defaults.flChaperoneThreshold);
+	pSettings->nBodyFusionPort = GetInt32Setting(k_pch_Sample_BodyFusionPort_Int32, defaults.nBodyFusionPort);
+	pSettings->sBodyFusionNodes = GetStringSetting(k_pch_Sample_BodyFusionNodes_String, defaults.sBodyFusionNodes.c_str());
+	pSettings->nMemoryBudgetHost = GetInt32Setting(k_pch_Sample_MemoryBudgetHost_Int32, defaults.nMemoryBudgetHost);
+	pSettings->nMemoryBudgetGpu = GetInt32Setting(k_pch_Sample_MemoryBudgetGpu_Int32, defaults.nMemoryBudgetGpu);
+	pSettings->sTelemetryCollector = GetStringSetting(k_pch_Sample_TelemetryCollector_String, defaults.sTelemetryCollector.c_str());
+	pSettings->sTelemetryPrefix = GetStringSetting(k_pch_Sample_TelemetryPrefix_String, defaults.sTelemetryPrefix.c_str());
+	pSettings->flTelemetryInterval = GetFloatSetting(k_pch_Sample_TelemetryInterval_Float, defaults.flTelemetryInterval);
+
+	// computed once here rather than for every pose
+	pSettings->qWorldFromDriverRotation = HmdQuaternion_FromYawPitchRoll(pSettings->flWorldYaw * k_flDegreesToRadians, 0.0, 0.0);
+	pSettings->qDriverFromHeadRotation = HmdQuaternion_FromYawPitchRoll(pSettings->flHeadYaw * k_flDegreesToRadians,
+		pSettings->flHeadPitch * k_flDegreesToRadians, pSettings->flHeadRoll * k_flDegreesToRadians);
+	for (int i = 0; i < 3; i++)
+	{
+		pSettings->vecWorldFromDriverTranslation[i] = pSettings->rgflWorldOffset[i];
+		pSettings->vecDriverFromHeadTranslation[i] = pSettings->rgflHeadOffset[i];
+	}
+}
@@ -0,0 +1,524 @@
+#ifndef DRIVERSETTINGS_H
+#define DRIVERSETTINGS_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <string>
+
+// keys for use with the settings API
+static const char* const k_pch_Sample_Section = "driver_zedm";
+static const char* const k_pch_Sample_SerialNumber_String = "serialNumber";
+static const char* const k_pch_Sample_ModelNumber_String = "modelNumber";
+static const char* const k_pch_Sample_TraceInterval_Int32 = "traceInterval";
+static const char* const k_pch_Sample_TraceEveryFrame_Bool = "traceEveryFrame";
+static const char* const k_pch_Sample_BinaryLogPath_String = "binaryLogPath";
+static const char* const k_pch_Sample_SvoPath_String = "svoPath";
+static const char* const k_pch_Sample_SvoRealTime_Bool = "svoRealTime";
+static const char* const k_pch_Sample_SvoLoop_Bool = "svoLoop";
+static const char* const k_pch_Sample_PoseRecordingPath_String = "poseRecordingPath";
+static const char* const k_pch_Sample_ThreadAffinityMask_String = "threadAffinityMask";
+static const char* const k_pch_Sample_ThreadPriority_Int32 = "threadPriority";
+static const char* const k_pch_Sample_ThreadMmcssTask_String = "threadMmcssTask";
+static const char* const k_pch_Sample_CudaDevice_Int32 = "cudaDevice";
+static const char* const k_pch_Sample_ShareCudaContext_Bool = "shareCudaContext";
+static const char* const k_pch_Sample_TrackingOnly_Bool = "trackingOnly";
+static const char* const k_pch_Sample_CameraProfile_String = "cameraProfile";
+static const char* const k_pch_Sample_AutoTunePath_String = "autoTunePath";
+static const char* const k_pch_Sample_AutoTuneBudget_Float = "autoTuneBudget";
+static const char* const k_pch_Sample_WorldOffsetX_Float = "worldOffsetX";
+static const char* const k_pch_Sample_WorldOffsetY_Float = "worldOffsetY";
+static const char* const k_pch_Sample_WorldOffsetZ_Float = "worldOffsetZ";
+static const char* const k_pch_Sample_WorldYaw_Float = "worldYaw";
+static const char* const k_pch_Sample_HeadOffsetX_Float = "headOffsetX";
+static const char* const k_pch_Sample_HeadOffsetY_Float = "headOffsetY";
+static const char* const k_pch_Sample_HeadOffsetZ_Float = "headOffsetZ";
+static const char* const k_pch_Sample_HeadYaw_Float = "headYaw";
+static const char* const k_pch_Sample_HeadPitch_Float = "headPitch";
+static const char* const k_pch_Sample_HeadRoll_Float = "headRoll";
+static const char* const k_pch_Sample_FusionTimeConstant_Float = "fusionTimeConstant";
+static const char* const k_pch_Sample_VelocitySmoothing_Float = "velocitySmoothing";
+static const char* const k_pch_Sample_DeadReckoningTime_Float = "deadReckoningTime";
+static const char* const k_pch_Sample_DeadReckoningDamping_Float = "deadReckoningDamping";
+static const char* const k_pch_Sample_GpuPassthrough_Bool = "gpuPassthrough";
+static const char* const k_pch_Sample_PassthroughBuffers_Int32 = "passthroughBuffers";
+static const char* const k_pch_Sample_AreaFilePath_String = "areaFilePath";
+static const char* const k_pch_Sample_RoiMaskPath_String = "roiMaskPath";
+static const char* const k_pch_Sample_ImuBiasPath_String = "imuBiasPath";
+static const char* const k_pch_Sample_SdkCachePath_String = "sdkCachePath";
+static const char* const k_pch_Sample_SpatialMapping_Bool = "spatialMapping";
+static const char* const k_pch_Sample_SpatialMappingResolution_Float = "spatialMappingResolution";
+static const char* const k_pch_Sample_SpatialMappingRange_Float = "spatialMappingRange";
+static const char* const k_pch_Sample_SpatialMappingInterval_Float = "spatialMappingInterval";
+static const char* const k_pch_Sample_AutoFloorHeight_Bool = "autoFloorHeight";
+static const char* const k_pch_Sample_BodyTracking_Bool = "bodyTracking";
+static const char* const k_pch_Sample_BodyConfidence_Float = "bodyConfidence";
+static const char* const k_pch_Sample_HandTracking_Bool = "handTracking";
+static const char* const k_pch_Sample_StandbyPause_Bool = "standbyPause";
+static const char* const k_pch_Sample_FrameGovernor_Bool = "frameGovernor";
+static const char* const k_pch_Sample_GovernorMaxDivisor_Int32 = "governorMaxDivisor";
+static const char* const k_pch_Sample_GovernorMotionThreshold_Float = "governorMotionThreshold";
+static const char* const k_pch_Sample_GovernorStaticTime_Float = "governorStaticTime";
+static const char* const k_pch_Sample_GovernorGpuLoad_Float = "governorGpuLoad";
+static const char* const k_pch_Sample_PoseFilter_Bool = "poseFilter";
+static const char* const k_pch_Sample_FilterMinCutoff_Float = "filterMinCutoff";
+static const char* const k_pch_Sample_FilterBeta_Float = "filterBeta";
+static const char* const k_pch_Sample_FilterDerivativeCutoff_Float = "filterDerivativeCutoff";
+static const char* const k_pch_Sample_BodyFilter_Bool = "bodyFilter";
+static const char* const k_pch_Sample_BodyFilterMinCutoff_Float = "bodyFilterMinCutoff";
+static const char* const k_pch_Sample_BodyFilterBeta_Float = "bodyFilterBeta";
+static const char* const k_pch_Sample_PoseDedup_Bool = "poseDedup";
+static const char* const k_pch_Sample_DedupPosition_Float = "dedupPosition";
+static const char* const k_pch_Sample_DedupRotation_Float = "dedupRotation";
+static const char* const k_pch_Sample_DedupKeepAlive_Float = "dedupKeepAlive";
+static const char* const k_pch_Sample_PredictionHorizon_Float = "predictionHorizon";
+static const char* const k_pch_Sample_PredictionJerk_Float = "predictionJerk";
+static const char* const k_pch_Sample_PredictionAngularAcceleration_Float = "predictionAngularAcceleration";
+static const char* const k_pch_Sample_PredictionApps_String = "predictionApps";
+static const char* const k_pch_Sample_ExposureTimestamp_Bool = "exposureTimestamp";
+static const char* const k_pch_Sample_CameraTransportDelay_Float = "cameraTransportDelay";
+static const char* const k_pch_Sample_RemotePort_Int32 = "remotePort";
+static const char* const k_pch_Sample_RemoteJitterDelay_Float = "remoteJitterDelay";
+static const char* const k_pch_Sample_GrabberPath_String = "grabberPath";
+static const char* const k_pch_Sample_GrabberArgs_String = "grabberArgs";
+static const char* const k_pch_Sample_SyntheticTrackers_Int32 = "syntheticTrackers";
+static const char* const k_pch_Sample_SyntheticRate_Float = "syntheticRate";
+static const char* const k_pch_Sample_SyntheticRecording_String = "syntheticRecording";
+static const char* const k_pch_Sample_SharedMemoryExport_Bool = "sharedMemoryExport";
+static const char* const k_pch_Sample_VsyncPublish_Bool = "vsyncPublish";
+static const char* const k_pch_Sample_VsyncPublishLead_Float = "vsyncPublishLead";
+static const char* const k_pch_Sample_HmdMode_Bool = "hmdMode";
+static const char* const k_pch_Sample_HmdWindowX_Int32 = "hmdWindowX";
+static const char* const k_pch_Sample_HmdWindowY_Int32 = "hmdWindowY";
+static const char* const k_pch_Sample_HmdWindowWidth_Int32 = "hmdWindowWidth";
+static const char* const k_pch_Sample_HmdWindowHeight_Int32 = "hmdWindowHeight";
+static const char* const k_pch_Sample_HmdRenderWidth_Int32 = "hmdRenderWidth";
+static const char* const k_pch_Sample_HmdRenderHeight_Int32 = "hmdRenderHeight";
+static const char* const k_pch_Sample_HmdDisplayFrequency_Float = "hmdDisplayFrequency";
+static const char* const k_pch_Sample_HmdSecondsFromVsyncToPhotons_Float = "hmdSecondsFromVsyncToPhotons";
+static const char* const k_pch_Sample_HmdIpd_Float = "hmdIpd";
+static const char* const k_pch_Sample_CalibrationDevice_String = "calibrationDevice";
+static const char* const k_pch_Sample_WorkerThreads_Int32 = "workerThreads";
+static const char* const k_pch_Sample_GrabStallTimeout_Float = "grabStallTimeout";
+static const char* const k_pch_Sample_FrameSkip_Int32 = "frameSkip";
+static const char* const k_pch_Sample_FrameCpuBudget_Float = "frameCpuBudget";
+static const char* const k_pch_Sample_ImuOnly_Bool = "imuOnly";
+static const char* const k_pch_Sample_CameraPlanner_Bool = "cameraPlanner";
+static const char* const k_pch_Sample_RigCameras_String = "rigCameras";
+static const char* const k_pch_Sample_TraceZonesPath_String = "traceZonesPath";
+static const char* const k_pch_Sample_TraceZonesEtw_Bool = "traceZonesEtw";
+static const char* const k_pch_Sample_TraceZonesNvtx_Bool = "traceZonesNvtx";
+static const char* const k_pch_Sample_MrCapture_Bool = "mrCapture";
+static const char* const k_pch_Sample_MrCaptureBuffers_Int32 = "mrCaptureBuffers";
+static const char* const k_pch_Sample_OcclusionDepth_Bool = "occlusionDepth";
+static const char* const k_pch_Sample_OcclusionDepthDivisor_Int32 = "occlusionDepthDivisor";
+static const char* const k_pch_Sample_ProximityWarning_Bool = "proximityWarning";
+static const char* const k_pch_Sample_ProximitySectors_Int32 = "proximitySectors";
+static const char* const k_pch_Sample_ProximityRange_Float = "proximityRange";
+static const char* const k_pch_Sample_SvoRecordPath_String = "svoRecordPath";
+static const char* const k_pch_Sample_SvoRecordCodec_String = "svoRecordCodec";
+static const char* const k_pch_Sample_SvoRecordBitrate_Int32 = "svoRecordBitrate";
+static const char* const k_pch_Sample_SvoRecordBudget_Float = "svoRecordBudget";
+static const char* const k_pch_Sample_MarkerIds_String = "markerIds";
+static const char* const k_pch_Sample_MarkerDictionary_String = "markerDictionary";
+static const char* const k_pch_Sample_MarkerSize_Float = "markerSize";
+static const char* const k_pch_Sample_MarkerRate_Float = "markerRate";
+static const char* const k_pch_Sample_ObjectTrackers_Int32 = "objectTrackers";
+static const char* const k_pch_Sample_ObjectClasses_String = "objectClasses";
+static const char* const k_pch_Sample_ObjectConfidence_Float = "objectConfidence";
+static const char* const k_pch_Sample_ChaperonePath_String = "chaperonePath";
+static const char* const k_pch_Sample_ChaperoneInterval_Float = "chaperoneInterval";
+static const char* const k_pch_Sample_ChaperoneThreshold_Float = "chaperoneThreshold";
+static const char* const k_pch_Sample_BodyFusionPort_Int32 = "bodyFusionPort";
+static const char* const k_pch_Sample_BodyFusionNodes_String = "bodyFusionNodes";
+static const char* const k_pch_Sample_MemoryBudgetHost_Int32 = "memoryBudgetHost";
+static const char* const k_pch_Sample_MemoryBudgetGpu_Int32 = "memoryBudgetGpu";
+static const char* const k_pch_Sample_TelemetryCollector_String = "telemetryCollector";
+static const char* const k_pch_Sample_TelemetryPrefix_String = "telemetryPrefix";
+static const char* const k_pch_Sample_TelemetryInterval_Float = "telemetryInterval";
+
+//-----------------------------------------------------------------------------
+// Purpose: Values read from the driver_zedm settings section. Keys missing
+// from the user's steamvr.vrsettings fall back to the defaults below, so the
+// driver does not depend on a default.vrsettings.
+//
+// Settings are reloaded at runtime (see CServerDriver_Zedm::ReloadSettings).
+// Calibration, smoothing, tracing and cameraProfile apply immediately; the
+// rest only takes effect when the camera or thread it configures is next
+// started.
+//-----------------------------------------------------------------------------
+struct ZedmSettings_t
+{
+	// log a one-line tracking summary every N camera frames, 0 disables it
+	int32_t nTraceInterval = 0;
+
+	// dump every frame's poses to the log; debugging only, costs a vsnprintf
+	// and a synchronous host call per line on the tracking thread
+	bool bTraceEveryFrame = false;
+
+	// when set, DriverTrace records are written to this file in binary form
+	// (see zedm_logdecode) instead of being formatted into vrserver.txt
+	std::string sBinaryLogPath;
+
+	// replay this SVO recording instead of opening a camera
+	std::string sSvoPath;
+
+	// play the SVO at its recorded rate; off, frames are decoded as fast as possible
+	bool bSvoRealTime = true;
+
+	// start the SVO over at its end instead of stopping, for soak runs (see zedm_soak)
+	bool bSvoLoop = false;
+
+	// when set, every visual pose, IMU sample and published pose is appended
+	// to this file (see poserecorder.h)
+	std::string sPoseRecordingPath;
+
+	// scheduling of the grab and IMU threads, see threadscheduling.h. The
+	// affinity mask is a string so it can be written in hex and hold 64 CPUs.
+	std::string sThreadAffinityMask;
+	int32_t nThreadPriority = 0;
+	std::string sThreadMmcssTask;
+
+	// GPU for the ZED SDK, see cudadevice.h. -1 prefers a GPU other than
+	// device 0 so camera processing doesn't compete with the compositor.
+	int32_t nCudaDevice = -1;
+	bool bShareCudaContext = false;
+
+	// only the pose is consumed: don't compute a depth map per grab
+	bool bTrackingOnly = true;
+
+	// resolution, fps, depth mode and tracking parameters, see cameraprofile.h
+	std::string sCameraProfile = "balanced";
+
+	// cameraProfile "auto", see cameraautotune.h: at startup the most
+	// demanding profile whose poses are within autoTuneBudget (ms from the
+	// image timestamp, 95th percentile) of being grabbed. The benchmark
+	// results are kept in autoTunePath ("{serial}" as with roiMaskPath) and
+	// only measured again for another camera, GPU or SDK; without a path
+	// every start benchmarks, which takes about 20 s.
+	std::string sAutoTunePath;
+	float flAutoTuneBudget = 40.0f;
+
+	// calibration: camera tracking space in the SteamVR universe (meters, yaw
+	// in degrees), and the tracked point relative to the camera. Converted to
+	// the DriverPose_t transforms below by LoadDriverSettings.
+	float rgflWorldOffset[3] = { 0.0f, 0.0f, 0.0f };
+	float flWorldYaw = 0.0f;
+	float rgflHeadOffset[3] = { 0.0f, 0.0f, 0.0f };
+	float flHeadYaw = 0.0f;
+	float flHeadPitch = 0.0f;
+	float flHeadRoll = 0.0f;
+
+	// smoothing, in seconds: how fast IMU drift is pulled towards visual
+	// odometry (posefusion.h) and the velocity filter (poseestimator.h)
+	float flFusionTimeConstant = 0.5f;
+	float flVelocitySmoothing = 0.02f;
+
+	// once visual tracking is lost the IMU carries the pose on for
+	// deadReckoningTime seconds (0: invalid at once), with the velocity
+	// decaying at deadReckoningDamping, see deadreckoning.h
+	float flDeadReckoningTime = 0.5f;
+	float flDeadReckoningDamping = 0.3f;
+
+	// share the stereo image as D3D11 textures without leaving the GPU, see
+	// gpupassthrough.h; two or three textures
+	bool bGpuPassthrough = false;
+	int32_t nPassthroughBuffers = 3;
+
+	// positional tracking map: loaded when the camera opens, so tracking
+	// relocalizes into last session's space, and saved when it closes
+	std::string sAreaFilePath;
+
+	// image of the pixels visual tracking may use (non-zero) and the ones it
+	// skips (black), e.g. the rig in view; "{serial}" is replaced by the
+	// camera's serial number so every camera can have its own
+	std::string sRoiMaskPath;
+
+	// IMU gyro and accelerometer bias, see imubias.h: loaded when the camera
+	// opens so the first samples are already corrected, re-estimated in the
+	// first second the camera is at rest and saved when it closes; "{serial}"
+	// as with roiMaskPath
+	std::string sImuBiasPath;
+
+	// offline startup, see sdkcache.h: directory of the cameras' calibration
+	// files, filled in by zedm_prewarm. When set, a camera whose calibration
+	// isn't there isn't opened, rather than the SDK downloading it, and body
+	// tracking stays off if its model isn't optimized yet rather than the
+	// SDK optimizing it for minutes. Empty lets the SDK do both as it goes.
+	std::string sSdkCachePath;
+
+	// incremental room mesh, see spatialmapping.h: chunk resolution and
+	// integration range in meters (0 lets the SDK pick), and seconds between
+	// mesh refreshes. Keeps a depth map computed per grab even with trackingOnly.
+	bool bSpatialMapping = false;
+	float flSpatialMappingResolution = 0.05f;
+	float flSpatialMappingRange = 0.0f;
+	float flSpatialMappingInterval = 2.0f;
+
+	// find the floor with the ZED and put it at height 0 in the SteamVR
+	// universe, see floordetector.h; worldOffsetY is added on top
+	bool bAutoFloorHeight = false;
+
+	// hips, feet and elbows of a person in view as virtual trackers of the
+	// first camera, see bodytracker.h; detections below bodyConfidence (0-100)
+	// are ignored. Registered at startup only.
+	bool bBodyTracking = false;
+	float flBodyConfidence = 40.0f;
+
+	// both hands of that person as skeletal input devices, see
+	// handskeleton.h; needs bodyTracking
+	bool bHandTracking = false;
+
+	// stop grabbing while SteamVR is in standby; the camera stays open with
+	// tracking enabled, so tracking resumes where it was on wake-up
+	bool bStandbyPause = true;
+
+	// process fewer camera frames while the device is static or the GPU is
+	// overloaded, see grabgovernor.h: down to one in governorMaxDivisor after
+	// governorStaticTime seconds below governorMotionThreshold (deg/s), or
+	// sooner when the compositor's GPU time exceeds governorGpuLoad of the
+	// frame budget. Ignored during replays.
+	bool bFrameGovernor = false;
+	int32_t nGovernorMaxDivisor = 3;
+	float flGovernorMotionThreshold = 5.0f;
+	float flGovernorStaticTime = 2.0f;
+	float flGovernorGpuLoad = 0.9f;
+
+	// One-Euro smoothing of the published poses, see posefilter.h: the camera
+	// device's with poseFilter, the body trackers' with bodyFilter, each with
+	// its own minimum cutoff (Hz) and beta; filterDerivativeCutoff is shared
+	bool bPoseFilter = false;
+	float flFilterMinCutoff = 1.0f;
+	float flFilterBeta = 0.5f;
+	float flFilterDerivativeCutoff = 1.0f;
+	bool bBodyFilter = false;
+	float flBodyFilterMinCutoff = 1.0f;
+	float flBodyFilterBeta = 0.3f;
+
+	// skip pose submissions that repeat the last sample or moved less than
+	// dedupPosition (m) and dedupRotation (degrees), see posededup.h; one is
+	// sent at least every dedupKeepAlive seconds regardless
+	bool bPoseDedup = false;
+	float flDedupPosition = 0.0005f;
+	float flDedupRotation = 0.05f;
+	float flDedupKeepAlive = 0.1f;
+
+	// Kalman prediction right before submission, see posepredictor.h: poses
+	// reach SteamVR as predicted predictionHorizon seconds (at most 0.1) after
+	// the submission, 0 submits them as sampled. predictionApps sets the
+	// horizon per scene application, "executable=seconds" pairs separated by
+	// ';', e.g. "vrchat.exe=0.012;hlvr.exe=0.02"; others get predictionHorizon
+	float flPredictionHorizon = 0.0f;
+	float flPredictionJerk = 50.0f;
+	float flPredictionAngularAcceleration = 50.0f;
+	std::string sPredictionApps;
+
+	// the camera pose is sampled in the middle of the exposure, not at the
+	// image timestamp: exposureTimestamp moves every visual sample back by
+	// half the current exposure, which auto exposure lengthens in dim rooms,
+	// plus cameraTransportDelay seconds between the end of the exposure and
+	// the timestamp, before fusion and prediction see it
+	bool bExposureTimestamp = true;
+	float flCameraTransportDelay = 0.0f;
+
+	// receiver mode, see posestream.h: a nonzero remotePort takes the poses
+	// zedm_posesender streams to that UDP port instead of opening a local
+	// camera; each one is held remoteJitterDelay seconds against network jitter,
+	// which should also cover the span of the sender's batches to keep their cadence
+	int32_t nRemotePort = 0;
+	float flRemoteJitterDelay = 0.005f;
+
+	// grabber mode, see grabberclient.h: a nonempty grabberPath runs the camera
+	// in that helper process instead of vrserver, e.g. zedm_grabber(.exe)
+	// relative to the driver binary, and takes its poses and IMU samples from
+	// shared memory. grabberArgs are passed on to it as space separated
+	// driver_zedm/key=value settings. "-" launches nothing and waits for a
+	// helper started by hand. Read at startup only.
+	std::string sGrabberPath;
+	std::string sGrabberArgs;
+
+	// benchmarking vrserver and the publishing path: syntheticTrackers extra
+	// generic trackers, next to any cameras, each publishing at syntheticRate
+	// Hz from its own thread, see syntheticload.h. They move procedurally, or
+	// replay the poses of a poseRecordingPath file given as syntheticRecording.
+	// 0 disables; read at startup only.
+	int32_t nSyntheticTrackers = 0;
+	float flSyntheticRate = 200.0f;
+	std::string sSyntheticRecording;
+
+	// publish every pose and IMU sample into the shared memory segment
+	// zedm_<serial> for other local processes, see sharedpose.h, and the
+	// device's stats into zedm_<serial>_stats, see sharedstats.h
+	bool bSharedMemoryExport = false;
+
+	// the IMU publisher submits once per compositor frame, vsyncPublishLead
+	// seconds before the predicted vsync, instead of at every IMU sample; see
+	// vsyncscheduler.h. Without frame timings it falls back to every sample.
+	bool bVsyncPublish = false;
+	float flVsyncPublishLead = 0.004f;
+
+	// the first camera's device is the headset itself: an HMD with a virtual
+	// display of these dimensions (see zeddisplaycomponent.h) instead of a
+	// generic tracker; the head calibration above is the camera's mount.
+	// Read at startup only.
+	bool bHmdMode = false;
+	int32_t nHmdWindowX = 0;
+	int32_t nHmdWindowY = 0;
+	int32_t nHmdWindowWidth = 1920;
+	int32_t nHmdWindowHeight = 1080;
+	int32_t nHmdRenderWidth = 1344;
+	int32_t nHmdRenderHeight = 1512;
+	float flHmdDisplayFrequency = 90.0f;
+	float flHmdSecondsFromVsyncToPhotons = 0.011f;
+	float flHmdIpd = 0.063f;
+
+	// serial number of a device tracked by another driver, e.g. a tracker on
+	// the camera rig, that the first camera's world offset and yaw are solved
+	// against continuously and written back to, see worldcalibration.h.
+	// Empty disables it.
+	std::string sCalibrationDevice;
+
+	// threads of the pool background jobs run on, see workerpool.h; 0 uses a
+	// quarter of the cores, at most 4. Read at startup only.
+	int32_t nWorkerThreads = 0;
+
+	// seconds an open camera may go without a frame before the grab thread
+	// grabs again and then reopens it, see grabwatchdog.h; 0 disables
+	float flGrabStallTimeout = 1.0f;
+
+	// for stations that can't keep up, see grabgovernor.h: process at most
+	// every frameSkip-th camera frame, and skip more while the grab thread
+	// needs over frameCpuBudget ms of CPU per camera frame (0 disables),
+	// whether or not frameGovernor is on. Ignored during replays.
+	int32_t nFrameSkip = 1;
+	float flFrameCpuBudget = 0.0f;
+
+	// a 3DOF tracker for seated use: the IMU's orientation at full rate, no
+	// images grabbed and no positional tracking, so next to no GPU work. Needs
+	// a model with an IMU; takes effect when the camera is next opened.
+	bool bImuOnly = false;
+
+	// cameras on one rigid body, e.g. a front and a rear ZED, fused into one
+	// tracked device: "serial x y z yaw pitch roll" per camera, the camera's
+	// place on the body in meters and degrees, separated by ';'. The first
+	// connected one's device is the rig's. Read at startup only; see rigfusion.h.
+	std::string sRigCameras;
+
+	// with several cameras connected at startup, a GPU, CPU cores and a
+	// highest camera profile per camera that fit the USB controllers they
+	// share, see cameraplanner.h. Overrides cudaDevice and threadAffinityMask
+	// for them; cameras plugged in later aren't planned.
+	bool bCameraPlanner = true;
+
+	// timing zones around the per-pose and GPU work, see tracezones.h: a
+	// Chrome trace JSON file for Perfetto, ETW events for WPA and GPUView
+	// (Windows), and/or NVTX ranges for Nsight Systems. Off by default; read
+	// at startup only.
+	std::string sTraceZonesPath;
+	bool bTraceZonesEtw = false;
+	bool bTraceZonesNvtx = false;
+
+	// left image, depth and the pose at the image's timestamp in a ring of
+	// shared textures and memory for mixed-reality compositors, see
+	// mrcapture.h; two to four frames. Computes depth every grab.
+	bool bMrCapture = false;
+	int32_t nMrCaptureBuffers = 3;
+
+	// a depth map at 1/occlusionDepthDivisor of the image resolution in shared
+	// textures, for occluding virtual content with the real world, see
+	// occlusiondepth.h. Computes depth every grab.
+	bool bOcclusionDepth = false;
+	int32_t nOcclusionDepthDivisor = 4;
+
+	// the nearest obstacle within proximityRange meters in each of
+	// proximitySectors (1-32) slices of the camera's view, from a small CUDA
+	// kernel over a low-resolution depth map, see proximitywarning.h; for
+	// collision warnings in overlays without spatialMapping. Computes depth
+	// every grab.
+	bool bProximityWarning = false;
+	int32_t nProximitySectors = 8;
+	float flProximityRange = 1.5f;
+
+	// field recordings, see svorecorder.h: directory the SVO files of
+	// DebugRequest("record start") go to, empty to refuse recording; "h264" or
+	// "h265"; starting bitrate in kbit/s, 0 for the SDK's default; time (ms)
+	// the encoder may take out of each grab before the recording degrades
+	std::string sSvoRecordPath;
+	std::string sSvoRecordCodec = "h265";
+	int32_t nSvoRecordBitrate = 8000;
+	float flSvoRecordBudget = 3.0f;
+
+	// fiducial markers as virtual trackers, see markertracker.h: the ids to
+	// publish ("0,3,7"), empty for none; "aruco_4x4_50", "aruco_5x5_100",
+	// "aruco_6x6_250" or "apriltag_16h5", "apriltag_25h9", "apriltag_36h10",
+	// "apriltag_36h11"; edge of the printed square (m); detections per second.
+	// First camera only, the devices are added at startup.
+	std::string sMarkerIds;
+	std::string sMarkerDictionary = "apriltag_36h11";
+	float flMarkerSize = 0.1f;
+	float flMarkerRate = 15.0f;
+
+	// props found by object detection as virtual trackers, see
+	// objecttracker.h: how many trackers, 0 for none; the classes to track,
+	// of "person", "vehicle", "bag", "animal", "electronics",
+	// "fruit_vegetable", "sport"; detections below objectConfidence (0-100)
+	// are ignored. First camera only, the devices are added at startup. The
+	// SDK runs one detection model per camera, so not with bodyTracking.
+	int32_t nObjectTrackers = 0;
+	std::string sObjectClasses = "sport,bag,electronics";
+	float flObjectConfidence = 50.0f;
+
+	// chaperone bounds from the first camera's spatial map, see
+	// chaperonebounds.h: the file written and handed to SteamVR, empty for
+	// none; needs spatialMapping, and takes effect when that camera is the
+	// HMD. Regenerated every chaperoneInterval seconds, rewritten only when a
+	// wall moved more than chaperoneThreshold meters.
+	std::string sChaperonePath;
+	float flChaperoneInterval = 10.0f;
+	float flChaperoneThreshold = 0.2f;
+
+	// body tracking fused from several ZEDs, see bodyfusion.h: a nonzero
+	// bodyFusionPort takes skeletons from zedm_posesender --body on other
+	// machines, and the first camera's own with bodyTracking, into one set of
+	// body trackers. bodyFusionNodes places each node's world in this
+	// camera's: "node x y z yaw pitch roll" per node, meters and degrees,
+	// separated by ';'. Read at startup only.
+	int32_t nBodyFusionPort = 0;
+	std::string sBodyFusionNodes;
+
+	// memory ceiling of each camera's features in MB, system and GPU, 0 for
+	// none, see memorybudget.h: area memory, spatial mapping and texture
+	// resolution, recording and the camera profile ceiling are given up in a
+	// fixed order until the estimate fits. The game isn't counted.
+	int32_t nMemoryBudgetHost = 0;
+	int32_t nMemoryBudgetGpu = 0;
+
+	// fleet telemetry, see telemetry.h: every camera's stats pushed as statsd
+	// lines over UDP to telemetryCollector, "host" or "host:port" (8125),
+	// empty for none, every telemetryInterval seconds. Metric names start
+	// with telemetryPrefix, "{host}" being this machine's name.
+	std::string sTelemetryCollector;
+	std::string sTelemetryPrefix = "zedm.{host}";
+	float flTelemetryInterval = 10.0f;
+
+	// derived from the calibration values, never read from IVRSettings
+	vr::HmdQuaternion_t qWorldFromDriverRotation = { 1.0, 0.0, 0.0, 0.0 };
+	double vecWorldFromDriverTranslation[3] = { 0.0, 0.0, 0.0 };
+	vr::HmdQuaternion_t qDriverFromHeadRotation = { 1.0, 0.0, 0.0, 0.0 };
+	double vecDriverFromHeadTranslation[3] = { 0.0, 0.0, 0.0 };
+
+	// per camera from cameraPlanner, never read from IVRSettings: the most
+	// demanding ECameraProfile it may use, -1 for any
+	int32_t nCameraProfileCeiling = -1;
+
+	// per camera from memoryBudgetHost and memoryBudgetGpu, never read from
+	// IVRSettings: false turns area memory off whatever the profile says
+	bool bAllowAreaMemory = true;
+};
+
+/** Reads the driver_zedm section. Called at Init and again whenever the
+* settings may have changed; the result is treated as an immutable snapshot. */
+extern void LoadDriverSettings(ZedmSettings_t* pSettings);
+
+#endif // DRIVERSETTINGS_H
@@ -0,0 +1,17 @@
+# Turns a PTX file into a header holding it as a C string, so the driver can
+# load the module with cuModuleLoadData without a file next to it.
+#
+# cmake -DPTX_FILE=in.ptx -DHEADER_FILE=out.h -DSYMBOL=k_rgchName -P embedptx.cmake
+file(READ ${PTX_FILE} PTX_TEXT)
+
+# one literal per line, MSVC limits the length of a single one
+string(REPLACE "\\" "\\\\" PTX_TEXT "${PTX_TEXT}")
+string(REPLACE "\"" "\\\"" PTX_TEXT "${PTX_TEXT}")
+string(REPLACE "\r" "" PTX_TEXT "${PTX_TEXT}")
+string(REPLACE "\n" "\\n\"\n\t\"" PTX_TEXT "${PTX_TEXT}")
+
+file(WRITE ${HEADER_FILE}
+  "// generated from ${PTX_FILE} by embedptx.cmake\n"
+  "#pragma once\n"
+  "static const char ${SYMBOL}[] =\n"
+  "\t\"${PTX_TEXT}\";\n")
@@ -0,0 +1,70 @@
+#include "floordetector.h"
+#include "driverlog.h"
+
+#include <math.h>
+
+using namespace sl;
+
+static const uint64_t k_ulSearchIntervalNs = 1000000000ull;
+static const uint64_t k_ulRevalidateIntervalNs = 60000000000ull;
+
+// heights closer than this are the same floor
+static const double k_flFloorTolerance = 0.03;
+
+// cosine of the largest tilt from world up accepted for a floor normal
+static const float k_flMinFloorNormalY = 0.95f;
+
+CFloorDetector::CFloorDetector()
+{
+	Reset();
+}
+
+void CFloorDetector::Reset()
+{
+	m_ulNextAttemptNs = 0;
+	m_bHaveFloor = false;
+	m_flFloorHeight = 0.0;
+	m_bHaveCandidate = false;
+	m_flCandidateHeight = 0.0;
+}
+
+bool CFloorDetector::Update(Camera& zed, uint64_t ulNowNs, double* pflFloorHeight)
+{
+	m_ulNextAttemptNs = ulNowNs + (m_bHaveFloor ? k_ulRevalidateIntervalNs : k_ulSearchIntervalNs);
+
+	Transform resetTrackingFloorFrame;
+	if (zed.findFloorPlane(m_plane, resetTrackingFloorFrame) != ERROR_CODE::SUCCESS)
+		return false;
+	if (m_plane.type != PLANE_TYPE::HORIZONTAL || m_plane.getNormal().y < k_flMinFloorNormalY)
+		return false;
+
+	double flHeight = m_plane.getCenter().y;
+	if (!m_bHaveFloor)
+	{
+		m_bHaveFloor = true;
+		m_flFloorHeight = flHeight;
+		*pflFloorHeight = flHeight;
+		DriverLog("Floor found %.3f m below the tracking origin\n", -flHeight);
+		return true;
+	}
+
+	if (fabs(flHeight - m_flFloorHeight) <= k_flFloorTolerance)
+	{
+		m_bHaveCandidate = false;
+		return false;
+	}
+	if (!m_bHaveCandidate || fabs(flHeight - m_flCandidateHeight) > k_flFloorTolerance)
+	{
+		// first disagreement, ask for a second opinion soon
+		m_bHaveCandidate = true;
+		m_flCandidateHeight = flHeight;
+		m_ulNextAttemptNs = ulNowNs + k_ulSearchIntervalNs;
+		return false;
+	}
+
+	DriverLog("Floor moved by %.3f m\n", flHeight - m_flFloorHeight);
+	m_bHaveCandidate = false;
+	m_flFloorHeight = (flHeight + m_flCandidateHeight) * 0.5;
+	*pflFloorHeight = m_flFloorHeight;
+	return true;
+}
@@ -0,0 +1,47 @@
+#ifndef FLOORDETECTOR_H
+#define FLOORDETECTOR_H
+
+#pragma once
+
+#include <sl/Camera.hpp>
+
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds the floor height in ZED world space once per tracking
+// session, for autoFloorHeight, and re-validates it at a low rate.
+//
+// findFloorPlane works on the depth of the last grab, so it has to run on the
+// grab thread. The detector only schedules it: IsDue says whether the next
+// grab should compute depth for an attempt, at most one per second until a
+// floor is found and one a minute after that. A re-validation that disagrees
+// with the cached height only replaces it when a second one a second later
+// agrees with it, so a table seen once doesn't move the playspace.
+//-----------------------------------------------------------------------------
+class CFloorDetector
+{
+public:
+	CFloorDetector();
+
+	/** Forgets the floor, e.g. when the world frame changed */
+	void Reset();
+
+	/** Whether an attempt should be made after the next grab */
+	bool IsDue(uint64_t ulNowNs) const { return ulNowNs >= m_ulNextAttemptNs; }
+
+	/** After a grab with depth and tracking, when IsDue: looks for the floor.
+	* True when the accepted floor height changed, returned in *pflFloorHeight. */
+	bool Update(sl::Camera& zed, uint64_t ulNowNs, double* pflFloorHeight);
+
+	bool HasFloor() const { return m_bHaveFloor; }
+
+private:
+	uint64_t m_ulNextAttemptNs;
+	bool m_bHaveFloor;
+	double m_flFloorHeight; // ZED world y, meters
+	bool m_bHaveCandidate; // a re-validation that disagreed with m_flFloorHeight
+	double m_flCandidateHeight;
+	sl::Plane m_plane; // reused for every attempt
+};
+
+#endif // FLOORDETECTOR_H
@@ -0,0 +1,307 @@
+#include "gpupassthrough.h"
+#include "driverlog.h"
+#include "tracezones.h"
+
+#include <string.h>
+
+#if defined(_WIN32)
+#include <d3d11.h>
+#include <dxgi.h>
+#include <cudaD3D11.h>
+#endif
+
+using namespace sl;
+
+CGpuPassthrough::CGpuPassthrough()
+	: m_pDevice(nullptr)
+	, m_cuContext(nullptr)
+	, m_cuCopyStart(nullptr)
+	, m_cuCopyEnd(nullptr)
+	, m_ulGpuNs(0)
+{
+	memset(m_rgpTextures, 0, sizeof(m_rgpTextures));
+	memset(m_rgResources, 0, sizeof(m_rgResources));
+	memset(&m_info, 0, sizeof(m_info));
+	m_info.nLatestBuffer = -1;
+}
+
+CGpuPassthrough::~CGpuPassthrough()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+ID3D11Device* CreateD3D11DeviceForCuda(CUdevice cuDevice)
+{
+	IDXGIFactory1* pFactory = nullptr;
+	if (FAILED(CreateDXGIFactory1(__uuidof(IDXGIFactory1), (void**)&pFactory)))
+		return nullptr;
+
+	IDXGIAdapter1* pAdapter = nullptr;
+	for (UINT i = 0; pFactory->EnumAdapters1(i, &pAdapter) != DXGI_ERROR_NOT_FOUND; i++)
+	{
+		CUdevice cuAdapterDevice;
+		if (cuD3D11GetDevice(&cuAdapterDevice, pAdapter) == CUDA_SUCCESS && cuAdapterDevice == cuDevice)
+			break;
+		pAdapter->Release();
+		pAdapter = nullptr;
+	}
+	pFactory->Release();
+
+	if (!pAdapter)
+		return nullptr;
+
+	ID3D11Device* pDevice = nullptr;
+	D3D_FEATURE_LEVEL eFeatureLevel = D3D_FEATURE_LEVEL_11_0;
+	HRESULT hr = D3D11CreateDevice(pAdapter, D3D_DRIVER_TYPE_UNKNOWN, nullptr, 0, &eFeatureLevel, 1, D3D11_SDK_VERSION, &pDevice, nullptr, nullptr);
+	pAdapter->Release();
+	return SUCCEEDED(hr) ? pDevice : nullptr;
+}
+
+bool CreateCudaSharedTexture(ID3D11Device* pDevice, uint32_t unWidth, uint32_t unHeight, uint32_t unDxgiFormat,
+	ID3D11Texture2D** ppTexture, CUgraphicsResource* pResource, uint64_t* pulSharedHandle)
+{
+	D3D11_TEXTURE2D_DESC desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.Width = unWidth;
+	desc.Height = unHeight;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = (DXGI_FORMAT)unDxgiFormat;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_SHARED;
+
+	IDXGIResource* pDxgiResource = nullptr;
+	HANDLE hShared = nullptr;
+	bool bOk = SUCCEEDED(pDevice->CreateTexture2D(&desc, nullptr, ppTexture))
+		&& SUCCEEDED((*ppTexture)->QueryInterface(__uuidof(IDXGIResource), (void**)&pDxgiResource))
+		&& SUCCEEDED(pDxgiResource->GetSharedHandle(&hShared))
+		&& cuGraphicsD3D11RegisterResource(pResource, *ppTexture, CU_GRAPHICS_REGISTER_FLAGS_NONE) == CUDA_SUCCESS;
+	if (pDxgiResource)
+		pDxgiResource->Release();
+	if (!bOk)
+		return false;
+
+	// every frame replaces the whole texture
+	cuGraphicsResourceSetMapFlags(*pResource, CU_GRAPHICS_MAP_RESOURCE_FLAGS_WRITE_DISCARD);
+	*pulSharedHandle = (uint64_t)(uintptr_t)hShared;
+	return true;
+}
+
+bool CGpuPassthrough::Open(Camera& zed, int nBuffers)
+{
+	Close();
+
+	nBuffers = nBuffers < 2 ? 2 : nBuffers > k_nMaxPassthroughBuffers ? k_nMaxPassthroughBuffers : nBuffers;
+	Resolution resolution = zed.getCameraInformation().camera_configuration.resolution;
+	UINT unWidth = (UINT)resolution.width * 2;
+	UINT unHeight = (UINT)resolution.height;
+
+	m_cuContext = zed.getCUDAContext();
+	CUdevice cuDevice;
+	if (!m_cuContext || cuCtxPushCurrent(m_cuContext) != CUDA_SUCCESS)
+	{
+		DriverLog("GPU passthrough: no CUDA context\n");
+		m_cuContext = nullptr;
+		return false;
+	}
+	bool bOk = cuCtxGetDevice(&cuDevice) == CUDA_SUCCESS && (m_pDevice = CreateD3D11DeviceForCuda(cuDevice)) != nullptr;
+	if (!bOk)
+		DriverLog("GPU passthrough: no D3D11 device on the ZED SDK's GPU\n");
+
+	// the copies are timed, not needed for the passthrough itself
+	if (bOk && (cuEventCreate(&m_cuCopyStart, CU_EVENT_DEFAULT) != CUDA_SUCCESS || cuEventCreate(&m_cuCopyEnd, CU_EVENT_DEFAULT) != CUDA_SUCCESS))
+	{
+		if (m_cuCopyStart)
+			cuEventDestroy(m_cuCopyStart);
+		m_cuCopyStart = m_cuCopyEnd = nullptr;
+	}
+	if (bOk && !m_copyStream.Create())
+		DriverLog("GPU passthrough: no low-priority CUDA stream, copying on the SDK's\n");
+
+	// the SDK's BGRA layout, so the copy is a plain memcpy
+	uint64_t rgulHandles[k_nMaxPassthroughBuffers] = {};
+	for (int i = 0; bOk && i < nBuffers; i++)
+	{
+		bOk = CreateCudaSharedTexture(m_pDevice, unWidth, unHeight, DXGI_FORMAT_B8G8R8A8_UNORM, &m_rgpTextures[i], &m_rgResources[i], &rgulHandles[i]);
+		if (!bOk)
+			DriverLog("GPU passthrough: unable to create shared texture %d\n", i);
+	}
+
+	CUcontext cuPopped;
+	cuCtxPopCurrent(&cuPopped);
+
+	if (!bOk)
+	{
+		Close();
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	memset(&m_info, 0, sizeof(m_info));
+	m_info.unWidth = unWidth;
+	m_info.unHeight = unHeight;
+	m_info.nBufferCount = nBuffers;
+	memcpy(m_info.rgulSharedHandles, rgulHandles, sizeof(rgulHandles));
+	m_info.nLatestBuffer = -1;
+
+	DriverLog("GPU passthrough: %d shared textures of %ux%u\n", nBuffers, unWidth, unHeight);
+	return true;
+}
+
+void CGpuPassthrough::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		memset(&m_info, 0, sizeof(m_info));
+		m_info.nLatestBuffer = -1;
+	}
+
+	bool bPushed = m_cuContext && cuCtxPushCurrent(m_cuContext) == CUDA_SUCCESS;
+	for (int i = 0; i < k_nMaxPassthroughBuffers; i++)
+	{
+		if (m_rgResources[i])
+		{
+			cuGraphicsUnregisterResource(m_rgResources[i]);
+			m_rgResources[i] = nullptr;
+		}
+		if (m_rgpTextures[i])
+		{
+			m_rgpTextures[i]->Release();
+			m_rgpTextures[i] = nullptr;
+		}
+	}
+	m_gpuImage.free();
+	if (bPushed && m_cuCopyStart)
+	{
+		cuEventDestroy(m_cuCopyStart);
+		cuEventDestroy(m_cuCopyEnd);
+	}
+	m_cuCopyStart = m_cuCopyEnd = nullptr;
+	if (bPushed)
+	{
+		m_copyStream.Destroy();
+		CUcontext cuPopped;
+		cuCtxPopCurrent(&cuPopped);
+	}
+	m_cuContext = nullptr;
+
+	if (m_pDevice)
+	{
+		m_pDevice->Release();
+		m_pDevice = nullptr;
+	}
+}
+
+void CGpuPassthrough::SubmitFrame(Camera& zed, uint64_t ulImageTimestampNs)
+{
+	if (!m_pDevice)
+		return;
+
+	TRACE_ZONE("passthrough");
+	{
+		TRACE_ZONE("retrieveImage");
+		if (zed.retrieveImage(m_gpuImage, VIEW::SIDE_BY_SIDE, MEM::GPU) != ERROR_CODE::SUCCESS)
+			return;
+	}
+
+	int nBuffer;
+	uint32_t unWidth, unHeight;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		nBuffer = (m_info.nLatestBuffer + 1) % m_info.nBufferCount;
+		unWidth = m_info.unWidth;
+		unHeight = m_info.unHeight;
+	}
+	if (m_gpuImage.getWidth() != unWidth || m_gpuImage.getHeight() != unHeight)
+		return;
+
+	if (cuCtxPushCurrent(m_cuContext) != CUDA_SUCCESS)
+		return;
+
+	// map, copy and unmap after retrieveImage, at low priority
+	CUstream cuStream = m_copyStream.Follow(zed.getCUDAStream());
+	CUgraphicsResource cuResource = m_rgResources[nBuffer];
+	bool bCopied = false;
+	if (m_cuCopyStart)
+		cuEventRecord(m_cuCopyStart, cuStream);
+	if (cuGraphicsMapResources(1, &cuResource, cuStream) == CUDA_SUCCESS)
+	{
+		CUarray cuArray;
+		if (cuGraphicsSubResourceGetMappedArray(&cuArray, cuResource, 0, 0) == CUDA_SUCCESS)
+		{
+			CUDA_MEMCPY2D copy;
+			memset(&copy, 0, sizeof(copy));
+			copy.srcMemoryType = CU_MEMORYTYPE_DEVICE;
+			copy.srcDevice = (CUdeviceptr)(uintptr_t)m_gpuImage.getPtr<sl::uchar1>(MEM::GPU);
+			copy.srcPitch = m_gpuImage.getStepBytes(MEM::GPU);
+			copy.dstMemoryType = CU_MEMORYTYPE_ARRAY;
+			copy.dstArray = cuArray;
+			copy.WidthInBytes = (size_t)unWidth * 4;
+			copy.Height = unHeight;
+			bCopied = cuMemcpy2DAsync(&copy, cuStream) == CUDA_SUCCESS;
+		}
+		cuGraphicsUnmapResources(1, &cuResource, cuStream);
+		if (m_cuCopyStart)
+			cuEventRecord(m_cuCopyEnd, cuStream);
+
+		// consumers on other devices can't wait on our stream, so the texture
+		// has to be complete before it is published
+		bCopied = bCopied && cuStreamSynchronize(cuStream) == CUDA_SUCCESS;
+
+		// both events are done after the synchronize
+		float flCopyMs;
+		if (bCopied && m_cuCopyStart && cuEventElapsedTime(&flCopyMs, m_cuCopyStart, m_cuCopyEnd) == CUDA_SUCCESS)
+			m_ulGpuNs += (uint64_t)(flCopyMs * 1e6f);
+	}
+
+	CUcontext cuPopped;
+	cuCtxPopCurrent(&cuPopped);
+
+	if (!bCopied)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_info.nLatestBuffer = nBuffer;
+	m_info.unFrameSequence++;
+	m_info.ulImageTimestampNs = ulImageTimestampNs;
+}
+
+#else
+// the textures are D3D11 resources; elsewhere Open fails and the rest never runs
+ID3D11Device* CreateD3D11DeviceForCuda(CUdevice /*cuDevice*/)
+{
+	return nullptr;
+}
+
+bool CreateCudaSharedTexture(ID3D11Device* /*pDevice*/, uint32_t /*unWidth*/, uint32_t /*unHeight*/, uint32_t /*unDxgiFormat*/,
+	ID3D11Texture2D** /*ppTexture*/, CUgraphicsResource* /*pResource*/, uint64_t* /*pulSharedHandle*/)
+{
+	return false;
+}
+
+bool CGpuPassthrough::Open(Camera& /*zed*/, int /*nBuffers*/)
+{
+	DriverLog("GPU passthrough: needs D3D11, not available on this platform\n");
+	return false;
+}
+
+void CGpuPassthrough::Close()
+{
+}
+
+void CGpuPassthrough::SubmitFrame(Camera& /*zed*/, uint64_t /*ulImageTimestampNs*/)
+{
+}
+#endif
+
+bool CGpuPassthrough::GetInfo(GpuPassthroughInfo_t* pInfo) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_info.nBufferCount == 0)
+		return false;
+	*pInfo = m_info;
+	return true;
+}
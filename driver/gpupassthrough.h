@@ -0,0 +1,98 @@
+#ifndef GPUPASSTHROUGH_H
+#define GPUPASSTHROUGH_H
+
+#pragma once
+
+#include <sl/Camera.hpp>
+#include <cuda.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "cudadevice.h"
+
+struct ID3D11Device;
+struct ID3D11Texture2D;
+
+static const int k_nMaxPassthroughBuffers = 3;
+
+//-----------------------------------------------------------------------------
+// Purpose: A D3D11 device on the DXGI adapter backing cuDevice, null if there
+// is none; CUDA can only register resources of a device on its own adapter.
+//-----------------------------------------------------------------------------
+extern ID3D11Device* CreateD3D11DeviceForCuda(CUdevice cuDevice);
+
+//-----------------------------------------------------------------------------
+// Purpose: A shareable texture of the device's, registered with the current
+// CUDA context for whole-texture writes, and its legacy DXGI shared handle
+//-----------------------------------------------------------------------------
+extern bool CreateCudaSharedTexture(ID3D11Device* pDevice, uint32_t unWidth, uint32_t unHeight, uint32_t unDxgiFormat,
+	ID3D11Texture2D** ppTexture, CUgraphicsResource* pResource, uint64_t* pulSharedHandle);
+
+//-----------------------------------------------------------------------------
+// Purpose: What a passthrough consumer needs to open the textures and find
+// the newest frame. Handles are legacy DXGI shared handles, valid in any
+// process on the same adapter via ID3D11Device::OpenSharedResource.
+//-----------------------------------------------------------------------------
+struct GpuPassthroughInfo_t
+{
+	uint32_t unWidth;
+	uint32_t unHeight;
+	int nBufferCount;
+	uint64_t rgulSharedHandles[k_nMaxPassthroughBuffers];
+	int nLatestBuffer; // -1 until the first frame
+	uint32_t unFrameSequence;
+	uint64_t ulImageTimestampNs; // ZED clock
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Zero-copy passthrough. The side-by-side BGRA image stays in GPU
+// memory (retrieveImage with MEM::GPU) and is copied device to device into
+// one of two or three D3D11 shared textures registered with CUDA, on the
+// adapter the ZED SDK runs on. Compared to the IVRCameraComponent stream it
+// skips the download to host memory and the consumer's upload.
+//
+// Buffers are written round robin, never the one published last; a consumer
+// should copy or sample the latest texture within one camera frame.
+// Everything but GetInfo is called from the grab thread.
+//-----------------------------------------------------------------------------
+class CGpuPassthrough
+{
+public:
+	CGpuPassthrough();
+	~CGpuPassthrough();
+
+	/** Creates the textures for the camera that was just opened. nBuffers is clamped to 2..k_nMaxPassthroughBuffers. */
+	bool Open(sl::Camera& zed, int nBuffers);
+	void Close();
+	bool IsOpen() const { return m_pDevice != nullptr; }
+
+	/** Copies the image of the last grab() into the next texture and publishes it */
+	void SubmitFrame(sl::Camera& zed, uint64_t ulImageTimestampNs);
+
+	/** False while closed */
+	bool GetInfo(GpuPassthroughInfo_t* pInfo) const;
+
+	/** Any thread: GPU time of the copies so far, from CUDA events around them */
+	uint64_t GetGpuNanoseconds() const { return m_ulGpuNs.load(); }
+
+private:
+	CGpuPassthrough(const CGpuPassthrough&) = delete;
+	CGpuPassthrough& operator=(const CGpuPassthrough&) = delete;
+
+	ID3D11Device* m_pDevice;
+	ID3D11Texture2D* m_rgpTextures[k_nMaxPassthroughBuffers];
+	CUgraphicsResource m_rgResources[k_nMaxPassthroughBuffers];
+	CUcontext m_cuContext; // the ZED SDK's
+	sl::Mat m_gpuImage;    // reused for every frame
+	CUevent m_cuCopyStart; // null if the events couldn't be created
+	CUevent m_cuCopyEnd;
+	CLowPriorityStream m_copyStream;
+	std::atomic<uint64_t> m_ulGpuNs;
+
+	mutable std::mutex m_mutex; // m_info, read by GetInfo
+	GpuPassthroughInfo_t m_info;
+};
+
+#endif // GPUPASSTHROUGH_H
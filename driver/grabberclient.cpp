@@ -0,0 +1,443 @@
+#include "grabberclient.h"
+#include "driverlog.h"
+#include "precisetimer.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+#include <chrono>
+#include <sstream>
+#include <vector>
+
+using namespace vr;
+
+// the rings are polled at about twice the IMU rate, like the IMU publisher polls the SDK
+static const uint64_t k_ulGrabberPollNs = 500000ull;
+
+// while the segment isn't there yet, how often it is looked for
+static const uint64_t k_ulGrabberOpenRetryNs = 100000000ull;
+
+// without a new pose for this long the device is out of range, as in receiver mode
+static const uint64_t k_ulGrabberTimeoutNs = 500000000ull;
+
+// a helper that wrote poses and then stops for this long is hung in the SDK; longer
+// than the grab watchdog takes to reopen the camera, and the IMU publisher writes meanwhile
+static const uint64_t k_ulGrabberHangNs = 10000000000ull;
+
+// relaunch delay after an exit, doubled up to the maximum; reset once a helper runs this long
+static const uint64_t k_ulRelaunchDelayMinNs = 1000000000ull;
+static const uint64_t k_ulRelaunchDelayMaxNs = 30000000000ull;
+static const uint64_t k_ulGrabberStableNs = 60000000000ull;
+
+// how long a helper gets to close the camera before it is killed
+static const uint32_t k_unExitTimeoutMs = 2000;
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** The directory of the driver binary, with the separator; a relative helper path is relative to it */
+static std::string GetDriverDirectory()
+{
+	std::string sPath;
+#if defined(_WIN32)
+	HMODULE hModule = nullptr;
+	char rgchPath[MAX_PATH];
+	if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)&GetDriverDirectory, &hModule)
+		&& GetModuleFileNameA(hModule, rgchPath, sizeof(rgchPath)) < sizeof(rgchPath))
+		sPath = rgchPath;
+#else
+	Dl_info info;
+	if (dladdr((void*)&GetDriverDirectory, &info) && info.dli_fname)
+		sPath = info.dli_fname;
+#endif
+	size_t unSeparator = sPath.find_last_of("/\\");
+	return unSeparator == std::string::npos ? std::string() : sPath.substr(0, unSeparator + 1);
+}
+
+static bool IsAbsolutePath(const std::string& sPath)
+{
+#if defined(_WIN32)
+	return (!sPath.empty() && (sPath[0] == '\\' || sPath[0] == '/')) || (sPath.size() > 1 && sPath[1] == ':');
+#else
+	return !sPath.empty() && sPath[0] == '/';
+#endif
+}
+
+CGrabberClient::CGrabberClient()
+	: m_pThread(nullptr)
+	, m_bRunning(false)
+	, m_unObjectId(k_unTrackedDeviceIndexInvalid)
+	, m_ulImuBuffer(k_ulInvalidIOBufferHandle)
+	, m_ulOpenAttemptNs(0)
+	, m_bHavePose(false)
+	, m_ulLastPoseWrite(0)
+	, m_ulNextImu(0)
+	, m_ulLastPoseNs(0)
+	, m_ulLaunchedNs(0)
+	, m_ulRelaunchNs(0)
+	, m_ulRelaunchDelayNs(k_ulRelaunchDelayMinNs)
+	, m_process(0)
+	, m_hJob(nullptr)
+	, m_bConnected(false)
+	, m_bProcessRunning(false)
+	, m_ulSubmitted(0)
+	, m_ulCoalesced(0)
+	, m_ulImuSamples(0)
+	, m_unLaunches(0)
+{
+}
+
+CGrabberClient::~CGrabberClient()
+{
+	Stop();
+}
+
+bool CGrabberClient::Start(const std::string& sSegmentName, const std::string& sProcessPath, const std::string& sArguments)
+{
+	if (m_pThread)
+		return true;
+
+	m_sSegmentName = sSegmentName;
+	m_sProcessPath = sProcessPath.empty() || IsAbsolutePath(sProcessPath) ? sProcessPath : GetDriverDirectory() + sProcessPath;
+	m_sArguments = sArguments;
+
+#if defined(_WIN32)
+	if (!m_sProcessPath.empty())
+	{
+		m_hJob = CreateJobObjectW(nullptr, nullptr);
+		JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+		limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+		if (!m_hJob || !SetInformationJobObject(m_hJob, JobObjectExtendedLimitInformation, &limits, sizeof(limits)))
+			DriverLog("Grabber: unable to create a job, the helper may outlive vrserver\n");
+	}
+#endif
+
+	m_bRunning = true;
+	m_pThread = new std::thread(&CGrabberClient::Run, this);
+	if (m_sProcessPath.empty())
+		DriverLog("Grabber: waiting for a helper to write %s\n", m_sSegmentName.c_str());
+	return true;
+}
+
+void CGrabberClient::Stop()
+{
+	if (!m_pThread)
+		return;
+
+	m_bRunning = false;
+	m_pThread->join();
+	delete m_pThread;
+	m_pThread = nullptr;
+
+#if defined(_WIN32)
+	if (m_hJob)
+		CloseHandle(m_hJob);
+#endif
+	m_hJob = nullptr;
+}
+
+void CGrabberClient::GetStats(GrabberClientStats_t* pStats) const
+{
+	pStats->bConnected = m_bConnected.load();
+	pStats->bProcessRunning = m_bProcessRunning.load();
+	pStats->ulSubmitted = m_ulSubmitted.load();
+	pStats->ulCoalesced = m_ulCoalesced.load();
+	pStats->ulImuSamples = m_ulImuSamples.load();
+	pStats->unLaunches = m_unLaunches.load();
+}
+
+void CGrabberClient::Run()
+{
+	CPreciseTimer pollTimer;
+	pollTimer.Start(k_ulGrabberPollNs);
+
+	if (!m_sProcessPath.empty() && !LaunchProcess())
+		m_ulRelaunchNs = GetSteadyNanoseconds() + m_ulRelaunchDelayNs;
+
+	while (m_bRunning)
+	{
+		pollTimer.WaitForNextTick();
+		uint64_t ulNowNs = GetSteadyNanoseconds();
+
+		if (!m_reader.IsOpen() && ulNowNs - m_ulOpenAttemptNs >= k_ulGrabberOpenRetryNs)
+		{
+			m_ulOpenAttemptNs = ulNowNs;
+			if (m_reader.Open(m_sSegmentName))
+			{
+				// what is in there already was written by an earlier helper, or is about to be stale
+				m_ulNextImu = m_reader.GetImuWriteCount();
+				DriverLog("Grabber: reading %s\n", m_sSegmentName.c_str());
+			}
+		}
+
+		if (m_reader.IsOpen())
+		{
+			SubmitLatestPose(ulNowNs);
+			ForwardImuSamples();
+		}
+
+		if (m_bConnected && ulNowNs - m_ulLastPoseNs > k_ulGrabberTimeoutNs)
+			PublishLost();
+
+		if (!m_sProcessPath.empty())
+			SuperviseProcess(ulNowNs);
+	}
+
+	KillProcess();
+	m_reader.Close();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The newest pose in the ring, if it is new, with this driver's
+// calibration on it. The ones written since the last poll are older, and
+// vrserver only keeps the latest anyway.
+//-----------------------------------------------------------------------------
+void CGrabberClient::SubmitLatestPose(uint64_t ulNowNs)
+{
+	SharedPoseSample_t sample;
+	uint64_t ulWriteNumber;
+	if (!m_reader.ReadLatestPose(&sample, &ulWriteNumber) || (m_bHavePose && ulWriteNumber == m_ulLastPoseWrite))
+		return;
+
+	// a recreated segment counts from 0 again
+	if (m_bHavePose && ulWriteNumber > m_ulLastPoseWrite)
+		m_ulCoalesced += ulWriteNumber - m_ulLastPoseWrite - 1;
+	m_bHavePose = true;
+	m_ulLastPoseWrite = ulWriteNumber;
+	m_ulLastPoseNs = ulNowNs;
+	if (!m_bConnected)
+		DriverLog("Grabber: receiving poses\n");
+	m_bConnected = true;
+
+	DriverPose_t pose;
+	m_poseTemplate.Read(&pose);
+	pose.poseIsValid = (sample.unFlags & SharedPoseFlag_Valid) != 0;
+	pose.deviceIsConnected = (sample.unFlags & SharedPoseFlag_Connected) != 0;
+	pose.result = (ETrackingResult)sample.nResult;
+	// relative to when the helper published it, which is at most a poll interval ago
+	pose.poseTimeOffset = sample.flPoseTimeOffset;
+	for (int i = 0; i < 3; i++)
+	{
+		pose.vecPosition[i] = sample.vecPosition[i];
+		pose.vecVelocity[i] = sample.vecVelocity[i];
+		pose.vecAngularVelocity[i] = sample.vecAngularVelocity[i];
+	}
+	pose.qRotation.w = sample.qRotation[0];
+	pose.qRotation.x = sample.qRotation[1];
+	pose.qRotation.y = sample.qRotation[2];
+	pose.qRotation.z = sample.qRotation[3];
+	m_poseHandoff.Write(pose);
+
+	TrackedDeviceIndex_t unObjectId = m_unObjectId.load();
+	if (unObjectId != k_unTrackedDeviceIndexInvalid)
+	{
+		VRServerDriverHost()->TrackedDevicePoseUpdated(unObjectId, pose, sizeof(DriverPose_t));
+		m_ulSubmitted++;
+	}
+}
+
+/** The IMU samples written since the last poll go to the IOBuffer, as CZedTracker::WriteImuBuffer does in process */
+void CGrabberClient::ForwardImuSamples()
+{
+	uint64_t ulWriteCount = m_reader.GetImuWriteCount();
+	if (m_ulNextImu > ulWriteCount)
+		m_ulNextImu = ulWriteCount;
+
+	IOBufferHandle_t ulImuBuffer = m_ulImuBuffer.load();
+	if (ulImuBuffer == k_ulInvalidIOBufferHandle || !VRIOBuffer() || !VRIOBuffer()->HasReaders(ulImuBuffer))
+	{
+		m_ulNextImu = ulWriteCount;
+		return;
+	}
+
+	SharedImuSample_t rgSamples[64];
+	uint32_t unRead;
+	while ((unRead = m_reader.ReadImuSamples(&m_ulNextImu, rgSamples, 64)) != 0)
+	{
+		for (uint32_t i = 0; i < unRead; i++)
+		{
+			ImuSample_t sample;
+			sample.fSampleTime = rgSamples[i].ulSampleTimestampNs * 1e-9;
+			for (int j = 0; j < 3; j++)
+			{
+				sample.vAccel.v[j] = rgSamples[i].vecAccel[j];
+				sample.vGyro.v[j] = rgSamples[i].vecGyro[j];
+			}
+			sample.unOffScaleFlags = 0;
+			VRIOBuffer()->Write(ulImuBuffer, &sample, sizeof(sample));
+		}
+		m_ulImuSamples += unRead;
+	}
+}
+
+/** The helper stopped writing: an invalid pose replaces the stale one */
+void CGrabberClient::PublishLost()
+{
+	DriverLog("Grabber: no poses for %.1f s\n", k_ulGrabberTimeoutNs * 1e-9);
+	m_bConnected = false;
+
+	DriverPose_t pose;
+	m_poseTemplate.Read(&pose);
+	pose.poseIsValid = false;
+	pose.result = TrackingResult_Running_OutOfRange;
+	m_poseHandoff.Write(pose);
+
+	TrackedDeviceIndex_t unObjectId = m_unObjectId.load();
+	if (unObjectId != k_unTrackedDeviceIndexInvalid)
+		VRServerDriverHost()->TrackedDevicePoseUpdated(unObjectId, pose, sizeof(DriverPose_t));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Keeps the helper running: relaunches it once its delay is up after
+// an exit, and kills it when it hangs. Each exit in a row doubles the delay,
+// so a helper that can't open the camera doesn't spin.
+//-----------------------------------------------------------------------------
+void CGrabberClient::SuperviseProcess(uint64_t ulNowNs)
+{
+	if (m_process != 0)
+	{
+		if (!IsProcessRunning())
+		{
+			DriverLog("Grabber: helper exited, relaunching in %.0f s\n", m_ulRelaunchDelayNs * 1e-9);
+			m_ulRelaunchNs = ulNowNs + m_ulRelaunchDelayNs;
+			m_ulRelaunchDelayNs = m_ulRelaunchDelayNs * 2 < k_ulRelaunchDelayMaxNs ? m_ulRelaunchDelayNs * 2 : k_ulRelaunchDelayMaxNs;
+		}
+		else if (m_ulLastPoseNs > m_ulLaunchedNs && ulNowNs - m_ulLastPoseNs > k_ulGrabberHangNs)
+		{
+			DriverLog("Grabber: helper hung, killing it\n");
+			KillProcess();
+			m_ulRelaunchNs = ulNowNs;
+		}
+		else if (ulNowNs - m_ulLaunchedNs > k_ulGrabberStableNs)
+		{
+			m_ulRelaunchDelayNs = k_ulRelaunchDelayMinNs;
+		}
+	}
+	else if (m_ulRelaunchNs != 0 && ulNowNs >= m_ulRelaunchNs)
+	{
+		m_ulRelaunchNs = 0;
+		if (!LaunchProcess())
+		{
+			m_ulRelaunchNs = ulNowNs + m_ulRelaunchDelayNs;
+			m_ulRelaunchDelayNs = m_ulRelaunchDelayNs * 2 < k_ulRelaunchDelayMaxNs ? m_ulRelaunchDelayNs * 2 : k_ulRelaunchDelayMaxNs;
+		}
+	}
+}
+
+bool CGrabberClient::LaunchProcess()
+{
+	// the segment name first, then the settings assignments
+	std::vector<std::string> vecArguments;
+	vecArguments.push_back(m_sSegmentName);
+	std::istringstream arguments(m_sArguments);
+	std::string sArgument;
+	while (arguments >> sArgument)
+		vecArguments.push_back(sArgument);
+
+#if defined(_WIN32)
+	std::string sCommandLine = "\"" + m_sProcessPath + "\"";
+	for (const std::string& s : vecArguments)
+		sCommandLine += " " + s;
+	std::vector<char> vecCommandLine(sCommandLine.begin(), sCommandLine.end());
+	vecCommandLine.push_back(0);
+
+	// suspended until it is in the job, so not even its first thread can outlive vrserver
+	STARTUPINFOA startup = {};
+	startup.cb = sizeof(startup);
+	PROCESS_INFORMATION info;
+	if (!CreateProcessA(m_sProcessPath.c_str(), vecCommandLine.data(), nullptr, nullptr, FALSE, CREATE_NO_WINDOW | CREATE_SUSPENDED,
+		nullptr, nullptr, &startup, &info))
+	{
+		DriverLog("Grabber: unable to launch %s (error %lu)\n", m_sProcessPath.c_str(), GetLastError());
+		return false;
+	}
+	if (m_hJob)
+		AssignProcessToJobObject(m_hJob, info.hProcess);
+	ResumeThread(info.hThread);
+	CloseHandle(info.hThread);
+	m_process = (uintptr_t)info.hProcess;
+#else
+	std::vector<char*> vecArgv;
+	vecArgv.push_back(const_cast<char*>(m_sProcessPath.c_str()));
+	for (std::string& s : vecArguments)
+		vecArgv.push_back(&s[0]);
+	vecArgv.push_back(nullptr);
+
+	pid_t pid;
+	int nError = posix_spawn(&pid, m_sProcessPath.c_str(), nullptr, nullptr, vecArgv.data(), environ);
+	if (nError != 0)
+	{
+		DriverLog("Grabber: unable to launch %s (error %d)\n", m_sProcessPath.c_str(), nError);
+		return false;
+	}
+	m_process = (uintptr_t)pid;
+#endif
+
+	m_ulLaunchedNs = GetSteadyNanoseconds();
+	m_unLaunches++;
+	m_bProcessRunning = true;
+	DriverLog("Grabber: launched %s\n", m_sProcessPath.c_str());
+	return true;
+}
+
+/** Reaps an exited helper, m_process is 0 then */
+bool CGrabberClient::IsProcessRunning()
+{
+	if (m_process == 0)
+		return false;
+
+#if defined(_WIN32)
+	if (WaitForSingleObject((HANDLE)m_process, 0) == WAIT_TIMEOUT)
+		return true;
+	CloseHandle((HANDLE)m_process);
+#else
+	int nStatus;
+	if (waitpid((pid_t)m_process, &nStatus, WNOHANG) == 0)
+		return true;
+#endif
+	m_process = 0;
+	m_bProcessRunning = false;
+	return false;
+}
+
+/** Asks the helper to close the camera and exit, and kills it if it doesn't in time */
+void CGrabberClient::KillProcess()
+{
+	if (m_process == 0)
+		return;
+
+#if defined(_WIN32)
+	// no console or window to ask it by; the SDK closes the camera with the process
+	TerminateProcess((HANDLE)m_process, 1);
+	WaitForSingleObject((HANDLE)m_process, k_unExitTimeoutMs);
+	CloseHandle((HANDLE)m_process);
+#else
+	pid_t pid = (pid_t)m_process;
+	kill(pid, SIGTERM);
+	int nStatus;
+	uint32_t unWaitedMs = 0;
+	while (waitpid(pid, &nStatus, WNOHANG) == 0)
+	{
+		if (unWaitedMs >= k_unExitTimeoutMs)
+		{
+			kill(pid, SIGKILL);
+			waitpid(pid, &nStatus, 0);
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		unWaitedMs += 10;
+	}
+#endif
+	m_process = 0;
+	m_bProcessRunning = false;
+}
@@ -0,0 +1,111 @@
+#ifndef GRABBERCLIENT_H
+#define GRABBERCLIENT_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "seqlock.h"
+#include "sharedpose.h"
+
+// the device serial in grabber mode; the helper writes the segment of this serial
+static const char* const k_pchGrabberSerialNumber = "ZED_GRABBER";
+
+struct GrabberClientStats_t
+{
+	bool bConnected; // poses are arriving
+	bool bProcessRunning; // the helper this driver launched, false when it is started by hand
+	uint64_t ulSubmitted; // poses submitted, the newest at each poll
+	uint64_t ulCoalesced; // written between two polls and never submitted
+	uint64_t ulImuSamples; // forwarded to the IOBuffer
+	uint32_t unLaunches; // helper processes started
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Grabber mode of the driver: the ZED SDK and CUDA run in a helper
+// process, zedm_grabber, that writes its poses and IMU samples into the
+// shared memory rings of sharedpose.h. A stall or crash of the SDK then
+// takes down the helper, not vrserver, and the helper runs at its own
+// priority class.
+//
+// The poll thread reads the rings lock-free every k_ulGrabberPollNs, submits
+// the newest pose and forwards the IMU samples to the device's IOBuffer. After
+// half a second without a pose the device is published as out of range. When
+// given a helper to launch it also owns that process: it is started with the
+// poll thread, relaunched with a growing delay whenever it exits, killed and
+// relaunched when it stops writing for k_ulGrabberHangNs, and killed on Stop.
+// On Windows the helper is in a job that goes away with vrserver, so it never
+// outlives a crashed server; elsewhere the helper watches its parent.
+//-----------------------------------------------------------------------------
+class CGrabberClient
+{
+public:
+	CGrabberClient();
+	~CGrabberClient();
+
+	/** Starts the poll thread on segment sSegmentName, and the helper at
+	* sProcessPath with sArguments (space separated) unless the path is empty */
+	bool Start(const std::string& sSegmentName, const std::string& sProcessPath, const std::string& sArguments);
+
+	/** Joins the poll thread and ends the helper; idempotent */
+	void Stop();
+
+	void SetObjectId(vr::TrackedDeviceIndex_t unObjectId) { m_unObjectId.store(unObjectId); }
+	void SetImuBuffer(vr::IOBufferHandle_t ulImuBuffer) { m_ulImuBuffer.store(ulImuBuffer); }
+
+	/** The constant fields of the published poses, the calibration included; one thread at a time */
+	void SetPoseTemplate(const vr::DriverPose_t& poseTemplate) { m_poseTemplate.Write(poseTemplate); }
+
+	/** Latest pose submitted, 0 if none yet */
+	uint32_t ReadPose(vr::DriverPose_t* pPose) const { return m_poseHandoff.Read(pPose); }
+
+	void GetStats(GrabberClientStats_t* pStats) const;
+
+private:
+	void Run();
+	void SubmitLatestPose(uint64_t ulNowNs);
+	void ForwardImuSamples();
+	void PublishLost();
+	void SuperviseProcess(uint64_t ulNowNs);
+
+	bool LaunchProcess();
+	bool IsProcessRunning();
+	void KillProcess();
+
+	std::string m_sSegmentName;
+	std::string m_sProcessPath;
+	std::string m_sArguments;
+	std::thread* m_pThread;
+	std::atomic<bool> m_bRunning;
+	std::atomic<vr::TrackedDeviceIndex_t> m_unObjectId;
+	std::atomic<vr::IOBufferHandle_t> m_ulImuBuffer;
+	CSeqLock<vr::DriverPose_t> m_poseTemplate;
+	CSeqLock<vr::DriverPose_t> m_poseHandoff;
+
+	// poll thread's
+	CSharedPoseReader m_reader;
+	uint64_t m_ulOpenAttemptNs;
+	bool m_bHavePose;
+	uint64_t m_ulLastPoseWrite;
+	uint64_t m_ulNextImu;
+	uint64_t m_ulLastPoseNs; // steady clock of the last new pose
+	uint64_t m_ulLaunchedNs; // steady clock of the last launch
+	uint64_t m_ulRelaunchNs; // when the exited helper is started again, 0 while it runs
+	uint64_t m_ulRelaunchDelayNs;
+	uintptr_t m_process; // the HANDLE on Windows, the pid elsewhere, 0 for none
+	void* m_hJob; // Windows: kills the helper when vrserver exits
+
+	std::atomic<bool> m_bConnected;
+	std::atomic<bool> m_bProcessRunning;
+	std::atomic<uint64_t> m_ulSubmitted;
+	std::atomic<uint64_t> m_ulCoalesced;
+	std::atomic<uint64_t> m_ulImuSamples;
+	std::atomic<uint32_t> m_unLaunches;
+};
+
+#endif // GRABBERCLIENT_H
@@ -0,0 +1,171 @@
+#include "grabgovernor.h"
+
+#include <math.h>
+
+// how fast the motion energy falls off once the device stops; rises are immediate
+static const double k_flMotionDecaySeconds = 0.2;
+
+// each step towards a lower rate waits this long, so a pause doesn't drop straight to the minimum
+static const uint64_t k_ulStepIntervalNs = 1000000000ull;
+
+// motion energy is in deg/s of rotation; translation is weighted onto that scale
+static const float k_flAccelWeight = 10.0f; // 1 m/s^2 of acceleration ~ 10 deg/s
+static const float k_flVelocityWeight = 100.0f; // 0.1 m/s ~ 10 deg/s
+
+// motion this many times the threshold is fast: the GPU load no longer lowers the rate
+static const float k_flFastMotionFactor = 4.0f;
+
+// frameCpuBudget: smoothing of the CPU time per frame, the thread times are coarse
+static const float k_flFrameCostAlpha = 0.05f;
+
+// the budget divisor comes down once the cost fits this share of the budget at the lower divisor
+static const double k_flBudgetHeadroom = 0.8;
+
+static const int k_nMaxBudgetDivisor = 8;
+
+static const float k_flGravity = 9.81f;
+static const double k_flRadiansToDegrees = 180.0 / 3.14159265358979323846;
+
+CGrabRateGovernor::CGrabRateGovernor()
+	: m_bEnabled(false)
+	, m_nMaxDivisor(1)
+	, m_flMotionThreshold(5.0f)
+	, m_ulStaticNs(2000000000ull)
+	, m_flGpuLoadThreshold(0.9f)
+	, m_ulLastMotionTimestampNs(0)
+	, m_flMotionEnergy(0.0f)
+	, m_flGpuLoad(0.0f)
+	, m_nDivisor(1)
+	, m_ulMovingNs(0)
+	, m_ulLastStepNs(0)
+	, m_nFrameSkip(1)
+	, m_flCpuBudgetNs(0.0)
+	, m_nBudgetDivisor(1)
+	, m_ulLastBudgetStepNs(0)
+	, m_flFrameCpuMs(0.0f)
+{
+}
+
+void CGrabRateGovernor::Configure(bool bEnabled, int nMaxDivisor, float flMotionThreshold, float flStaticSeconds, float flGpuLoadThreshold)
+{
+	m_bEnabled = bEnabled;
+	m_nMaxDivisor = nMaxDivisor < 1 ? 1 : nMaxDivisor;
+	m_flMotionThreshold = flMotionThreshold;
+	m_ulStaticNs = flStaticSeconds > 0.0f ? (uint64_t)(flStaticSeconds * 1e9) : 0;
+	m_flGpuLoadThreshold = flGpuLoadThreshold;
+}
+
+void CGrabRateGovernor::ConfigureFrameSkip(int nFrameSkip, float flCpuBudgetMs)
+{
+	m_nFrameSkip = nFrameSkip < 1 ? 1 : nFrameSkip;
+	m_flCpuBudgetNs = flCpuBudgetMs > 0.0f ? flCpuBudgetMs * 1e6 : 0.0;
+	if (m_flCpuBudgetNs == 0.0)
+		m_nBudgetDivisor = 1;
+}
+
+void CGrabRateGovernor::Reset()
+{
+	m_nDivisor = 1;
+	m_ulMovingNs = 0;
+	m_ulLastStepNs = 0;
+	m_nBudgetDivisor = 1;
+	m_ulLastBudgetStepNs = 0;
+	m_flFrameCpuMs = 0.0f;
+}
+
+void CGrabRateGovernor::AddFrameCost(uint64_t ulCpuNs, uint64_t ulNowNs)
+{
+	float flFrameCpuMs = m_flFrameCpuMs.load();
+	flFrameCpuMs = flFrameCpuMs == 0.0f ? ulCpuNs * 1e-6f : flFrameCpuMs + (ulCpuNs * 1e-6f - flFrameCpuMs) * k_flFrameCostAlpha;
+	m_flFrameCpuMs = flFrameCpuMs;
+	if (m_flCpuBudgetNs == 0.0)
+		return;
+
+	// a processed frame may use the budget of every camera frame it stands for
+	double flCostNs = flFrameCpuMs * 1e6;
+	int nNeeded = (int)ceil(flCostNs / m_flCpuBudgetNs);
+	if (nNeeded > k_nMaxBudgetDivisor)
+		nNeeded = k_nMaxBudgetDivisor;
+	if (nNeeded > m_nBudgetDivisor)
+	{
+		m_nBudgetDivisor = nNeeded;
+		m_ulLastBudgetStepNs = ulNowNs;
+	}
+	else if (m_nBudgetDivisor > 1 && flCostNs < k_flBudgetHeadroom * m_flCpuBudgetNs * (m_nBudgetDivisor - 1)
+		&& ulNowNs - m_ulLastBudgetStepNs >= k_ulStepIntervalNs)
+	{
+		m_nBudgetDivisor--;
+		m_ulLastBudgetStepNs = ulNowNs;
+	}
+}
+
+void CGrabRateGovernor::AddImuSample(const float vecGyro[3], const float vecAccel[3], uint64_t ulTimestampNs)
+{
+	float flRotation = sqrtf(vecGyro[0] * vecGyro[0] + vecGyro[1] * vecGyro[1] + vecGyro[2] * vecGyro[2]);
+	float flAccel = sqrtf(vecAccel[0] * vecAccel[0] + vecAccel[1] * vecAccel[1] + vecAccel[2] * vecAccel[2]);
+	AddMotionSample(flRotation + k_flAccelWeight * fabsf(flAccel - k_flGravity), ulTimestampNs);
+}
+
+void CGrabRateGovernor::AddVisualSample(const double vecVelocity[3], const double vecAngularVelocity[3], uint64_t ulTimestampNs)
+{
+	double flRotation = sqrt(vecAngularVelocity[0] * vecAngularVelocity[0] + vecAngularVelocity[1] * vecAngularVelocity[1]
+		+ vecAngularVelocity[2] * vecAngularVelocity[2]) * k_flRadiansToDegrees;
+	double flSpeed = sqrt(vecVelocity[0] * vecVelocity[0] + vecVelocity[1] * vecVelocity[1] + vecVelocity[2] * vecVelocity[2]);
+	AddMotionSample((float)(flRotation + k_flVelocityWeight * flSpeed), ulTimestampNs);
+}
+
+void CGrabRateGovernor::AddMotionSample(float flEnergy, uint64_t ulTimestampNs)
+{
+	float flPrevious = m_flMotionEnergy.load();
+	if (flEnergy < flPrevious && ulTimestampNs > m_ulLastMotionTimestampNs && m_ulLastMotionTimestampNs != 0)
+	{
+		double flAlpha = 1.0 - exp(-(ulTimestampNs - m_ulLastMotionTimestampNs) * 1e-9 / k_flMotionDecaySeconds);
+		flEnergy = (float)(flPrevious + (flEnergy - flPrevious) * flAlpha);
+	}
+	m_flMotionEnergy = flEnergy;
+	m_ulLastMotionTimestampNs = ulTimestampNs;
+}
+
+int CGrabRateGovernor::Update(uint64_t ulNowNs)
+{
+	int nFloor = m_nFrameSkip > m_nBudgetDivisor ? m_nFrameSkip : m_nBudgetDivisor;
+	if (!m_bEnabled)
+	{
+		m_nDivisor = nFloor;
+		return nFloor;
+	}
+
+	float flEnergy = m_flMotionEnergy.load();
+	bool bOverloaded = m_flGpuLoad.load() > m_flGpuLoadThreshold;
+	if (flEnergy > m_flMotionThreshold || m_ulMovingNs == 0)
+		m_ulMovingNs = ulNowNs;
+
+	int nTarget;
+	if (flEnergy > m_flMotionThreshold * k_flFastMotionFactor)
+		nTarget = 1;
+	else if (flEnergy > m_flMotionThreshold)
+		nTarget = bOverloaded ? 2 : 1;
+	else if (bOverloaded || ulNowNs - m_ulMovingNs >= m_ulStaticNs)
+		nTarget = m_nMaxDivisor;
+	else
+		nTarget = 1;
+	if (nTarget > m_nMaxDivisor)
+		nTarget = m_nMaxDivisor;
+
+	// faster at once, slower one step at a time
+	int nDivisor = m_nDivisor.load();
+	if (nTarget < nDivisor)
+	{
+		nDivisor = nTarget;
+		m_ulLastStepNs = ulNowNs;
+	}
+	else if (nTarget > nDivisor && ulNowNs - m_ulLastStepNs >= k_ulStepIntervalNs)
+	{
+		nDivisor++;
+		m_ulLastStepNs = ulNowNs;
+	}
+	if (nDivisor < nFloor)
+		nDivisor = nFloor;
+	m_nDivisor = nDivisor;
+	return nDivisor;
+}
@@ -0,0 +1,88 @@
+#ifndef GRABGOVERNOR_H
+#define GRABGOVERNOR_H
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+// Purpose: Decides how many camera frames the grab thread processes, for
+// frameGovernor. Every grab runs tracking (and depth, if needed) on the GPU,
+// so processing every Nth frame saves close to (N-1)/N of that work.
+//
+// The rate is chosen from two inputs. Motion energy comes from the IMU, or
+// from the visual velocity on models without one. Any motion restores the
+// full rate at once. After governorStaticTime seconds without motion the
+// divisor rises one step per second, up to governorMaxDivisor. Compositor
+// GPU load above governorGpuLoad skips that wait when static, and halves the
+// rate during slow motion, but never while the device moves fast.
+//
+// Independently of frameGovernor, frameSkip processes at most every Nth
+// frame, and frameCpuBudget raises the divisor as far as needed to keep the
+// grab thread's average CPU time per camera frame below the budget. These
+// are floors under the motion based divisor and apply at once, since on a
+// station that can't keep up a stale backlog is worse than skipped frames;
+// the IMU publisher carries the pose in between.
+//
+// Resolution isn't governed. Changing it means reopening the camera, and
+// tracking is lost for seconds while that happens; it stays with cameraProfile.
+//-----------------------------------------------------------------------------
+class CGrabRateGovernor
+{
+public:
+	CGrabRateGovernor();
+
+	void Configure(bool bEnabled, int nMaxDivisor, float flMotionThreshold, float flStaticSeconds, float flGpuLoadThreshold);
+
+	/** frameSkip and frameCpuBudget (ms per camera frame, 0 disables) */
+	void ConfigureFrameSkip(int nFrameSkip, float flCpuBudgetMs);
+
+	/** Back to the full rate, e.g. after the camera was reopened */
+	void Reset();
+
+	/** From whichever thread reads the IMU (one at a time): gyro in deg/s, accel in m/s^2 */
+	void AddImuSample(const float vecGyro[3], const float vecAccel[3], uint64_t ulTimestampNs);
+
+	/** Grab thread, on models without an IMU: the visual velocities in m/s and rad/s */
+	void AddVisualSample(const double vecVelocity[3], const double vecAngularVelocity[3], uint64_t ulTimestampNs);
+
+	/** Any thread: the compositor's GPU time of the last frame over the frame budget */
+	void SetGpuLoad(float flGpuLoad) { m_flGpuLoad.store(flGpuLoad); }
+
+	/** Grab thread, after each processed frame: its CPU time since the previous one */
+	void AddFrameCost(uint64_t ulCpuNs, uint64_t ulNowNs);
+
+	/** Grab thread, before each grab: processes one camera frame out of the result */
+	int Update(uint64_t ulNowNs);
+
+	int GetDivisor() const { return m_nDivisor.load(); }
+	float GetMotionEnergy() const { return m_flMotionEnergy.load(); }
+	float GetGpuLoad() const { return m_flGpuLoad.load(); }
+	float GetFrameCpuMs() const { return m_flFrameCpuMs.load(); }
+
+private:
+	void AddMotionSample(float flEnergy, uint64_t ulTimestampNs);
+
+	bool m_bEnabled;
+	int m_nMaxDivisor;
+	float m_flMotionThreshold;
+	uint64_t m_ulStaticNs;
+	float m_flGpuLoadThreshold;
+
+	uint64_t m_ulLastMotionTimestampNs; // writer's
+	std::atomic<float> m_flMotionEnergy;
+	std::atomic<float> m_flGpuLoad;
+	std::atomic<int> m_nDivisor;
+	uint64_t m_ulMovingNs; // grab thread's: last time motion was seen
+	uint64_t m_ulLastStepNs;
+
+	// frameSkip / frameCpuBudget, the grab thread's
+	int m_nFrameSkip;
+	double m_flCpuBudgetNs;
+	int m_nBudgetDivisor;
+	uint64_t m_ulLastBudgetStepNs;
+	std::atomic<float> m_flFrameCpuMs; // average per processed frame
+};
+
+#endif // GRABGOVERNOR_H
@@ -0,0 +1,112 @@
+#include "grabwatchdog.h"
+#include "driverlog.h"
+
+#include <chrono>
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CGrabWatchdog::CGrabWatchdog()
+	: m_unCameraSerial(0)
+	, m_ulLastFrameNs(0)
+	, m_unFramesDropped(0)
+	, m_ulStallTimeoutNs(0)
+	, m_eRecovery(GrabRecovery_None)
+	, m_bStalled(false)
+	, m_ulStalls(0)
+	, m_eEscalation(GrabRecovery_None)
+	, m_ulEscalatedNs(0)
+	, m_unFramesDroppedAtStall(0)
+{
+}
+
+CGrabWatchdog::~CGrabWatchdog()
+{
+	Stop();
+}
+
+void CGrabWatchdog::Start(CWorkerPool* pPool, unsigned int unCameraSerial, std::function<void()> pfnWake)
+{
+	Stop();
+
+	m_unCameraSerial = unCameraSerial;
+	m_pfnWake = pfnWake;
+	m_eEscalation = GrabRecovery_None;
+	m_check.Start(pPool, WorkPriority_High, k_ulCheckIntervalNs, [this] { Check(); });
+}
+
+void CGrabWatchdog::SetStallTimeout(float flSeconds)
+{
+	m_ulStallTimeoutNs = flSeconds > 0.0f ? (uint64_t)(flSeconds * 1e9) : 0;
+}
+
+void CGrabWatchdog::Arm(uint64_t ulNowNs)
+{
+	m_ulLastFrameNs = ulNowNs;
+}
+
+void CGrabWatchdog::Disarm()
+{
+	m_ulLastFrameNs = 0;
+	m_eRecovery = GrabRecovery_None;
+}
+
+void CGrabWatchdog::FrameArrived(uint64_t ulNowNs, uint32_t unFramesDropped)
+{
+	m_unFramesDropped.store(unFramesDropped, std::memory_order_relaxed);
+	m_ulLastFrameNs.store(ulNowNs, std::memory_order_release);
+}
+
+void CGrabWatchdog::RequestRecovery(EGrabRecovery eRecovery)
+{
+	m_eRecovery = eRecovery;
+	if (m_pfnWake)
+		m_pfnWake();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: One look at the heartbeat, every k_ulCheckIntervalNs. A stall first
+// gets a re-grab; a reopen only if that didn't bring the frames back within
+// another timeout.
+//-----------------------------------------------------------------------------
+void CGrabWatchdog::Check()
+{
+	uint64_t ulLastFrameNs = m_ulLastFrameNs.load(std::memory_order_acquire);
+	uint64_t ulTimeoutNs = m_ulStallTimeoutNs.load();
+	uint64_t ulNowNs = GetSteadyNanoseconds();
+	if (ulLastFrameNs == 0 || ulTimeoutNs == 0)
+	{
+		// closed or paused: the grab thread is already past the stall, or reopening
+		m_bStalled = false;
+		m_eEscalation = GrabRecovery_None;
+	}
+	else if (ulNowNs < ulLastFrameNs + ulTimeoutNs)
+	{
+		if (m_bStalled)
+		{
+			DriverLog("ZED %u: frames back, %u dropped during the stall\n", m_unCameraSerial,
+				m_unFramesDropped.load() - m_unFramesDroppedAtStall);
+			m_bStalled = false;
+		}
+		m_eEscalation = GrabRecovery_None;
+	}
+	else if (!m_bStalled)
+	{
+		DriverLog("ZED %u: no frame for %.1f s, grabbing again\n", m_unCameraSerial, (ulNowNs - ulLastFrameNs) * 1e-9);
+		m_bStalled = true;
+		m_ulStalls++;
+		m_unFramesDroppedAtStall = m_unFramesDropped.load();
+		m_eEscalation = GrabRecovery_Regrab;
+		m_ulEscalatedNs = ulNowNs;
+		RequestRecovery(GrabRecovery_Regrab);
+	}
+	else if (m_eEscalation == GrabRecovery_Regrab && ulNowNs - m_ulEscalatedNs >= ulTimeoutNs)
+	{
+		DriverLog("ZED %u: still no frame after %.1f s, reopening the camera\n", m_unCameraSerial, (ulNowNs - ulLastFrameNs) * 1e-9);
+		m_eEscalation = GrabRecovery_Reopen;
+		m_ulEscalatedNs = ulNowNs;
+		RequestRecovery(GrabRecovery_Reopen);
+	}
+}
@@ -0,0 +1,94 @@
+#ifndef GRABWATCHDOG_H
+#define GRABWATCHDOG_H
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include "workerpool.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: What CGrabWatchdog asks the grab thread to do about a stall
+//-----------------------------------------------------------------------------
+enum EGrabRecovery
+{
+	GrabRecovery_None,
+	GrabRecovery_Regrab, // drop the retry back-off and frame skipping, grab again at once
+	GrabRecovery_Reopen, // close the camera and open it again
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Notices when an open camera stops delivering frames, e.g. a USB
+// stall, and escalates: once no frame arrived for grabStallTimeout the grab
+// thread is asked to re-grab, and after another timeout without one to
+// reopen the camera. While stalled the IMU publisher dead reckons as if
+// visual tracking was lost.
+//
+// The grab thread reports each frame as a heartbeat and arms the watchdog
+// only while the camera is open and not paused. The check is a periodic job
+// on the worker pool, so a grab() that blocks inside the SDK is still seen;
+// the recovery itself runs on the grab thread as soon as grab() returns,
+// since the camera must not be closed under a grab in progress.
+//-----------------------------------------------------------------------------
+class CGrabWatchdog
+{
+public:
+	CGrabWatchdog();
+	~CGrabWatchdog();
+
+	/** Starts the check job; pfnWake is called after a recovery is requested so a
+	* sleeping grab thread takes it. Pool and callback must outlive Stop. */
+	void Start(CWorkerPool* pPool, unsigned int unCameraSerial, std::function<void()> pfnWake);
+
+	/** Waits for the job in flight */
+	void Stop() { m_check.Stop(); }
+
+	/** Any thread: seconds without a frame before recovering, 0 disables */
+	void SetStallTimeout(float flSeconds);
+
+	/** Grab thread: the camera is open and grabbing from now on */
+	void Arm(uint64_t ulNowNs);
+
+	/** Grab thread: closed or paused, whatever the time since the last frame */
+	void Disarm();
+
+	/** Grab thread: every frame grabbed, with the SDK's dropped frame count */
+	void FrameArrived(uint64_t ulNowNs, uint32_t unFramesDropped);
+
+	/** Grab thread: the recovery requested since the last call, once */
+	EGrabRecovery TakeRecovery() { return m_eRecovery.exchange(GrabRecovery_None); }
+
+	bool IsRecoveryRequested() const { return m_eRecovery.load() != GrabRecovery_None; }
+	bool IsStalled() const { return m_bStalled.load(); }
+	uint64_t GetStallCount() const { return m_ulStalls.load(); }
+
+private:
+	CGrabWatchdog(const CGrabWatchdog&) = delete;
+	CGrabWatchdog& operator=(const CGrabWatchdog&) = delete;
+
+	static const uint64_t k_ulCheckIntervalNs = 100000000ull;
+
+	void Check();
+	void RequestRecovery(EGrabRecovery eRecovery);
+
+	CPeriodicJob m_check;
+	unsigned int m_unCameraSerial;
+	std::function<void()> m_pfnWake;
+
+	// the grab thread's heartbeat; 0 while disarmed
+	std::atomic<uint64_t> m_ulLastFrameNs;
+	std::atomic<uint32_t> m_unFramesDropped;
+	std::atomic<uint64_t> m_ulStallTimeoutNs;
+	std::atomic<EGrabRecovery> m_eRecovery;
+	std::atomic<bool> m_bStalled;
+	std::atomic<uint64_t> m_ulStalls;
+
+	// the job's
+	EGrabRecovery m_eEscalation; // the last recovery requested in this stall
+	uint64_t m_ulEscalatedNs;
+	uint32_t m_unFramesDroppedAtStall;
+};
+
+#endif // GRABWATCHDOG_H
@@ -0,0 +1,276 @@
+#include "handskeleton.h"
+#include "hmdmath.h"
+
+#include <math.h>
+#include <string.h>
+
+using namespace vr;
+using namespace sl;
+
+//-----------------------------------------------------------------------------
+// SteamVR's open hand reference pose for the left hand, parent space,
+// position then rotation (w, x, y, z). The aux bones are derived per update.
+//-----------------------------------------------------------------------------
+static const float k_rgflLeftOpenHand[k_unHandBoneCount - 5][7] = {
+	{ 0.000000f, 0.000000f, 0.000000f, 1.000000f, 0.000000f, 0.000000f, 0.000000f }, // root
+	{ -0.034038f, 0.036503f, 0.164722f, -0.055147f, -0.078608f, -0.920279f, 0.379296f }, // wrist
+	{ -0.012083f, 0.028070f, 0.025050f, 0.464112f, 0.567418f, 0.272106f, 0.623374f }, // thumb 0..3
+	{ 0.040406f, 0.000000f, -0.000000f, 0.994838f, 0.082939f, 0.019454f, 0.055130f },
+	{ 0.032517f, 0.000000f, 0.000000f, 0.974793f, -0.003213f, 0.021867f, -0.222015f },
+	{ 0.030464f, -0.000000f, -0.000000f, 1.000000f, -0.000000f, -0.000000f, -0.000000f },
+	{ 0.000632f, 0.026866f, 0.015002f, 0.644251f, 0.421979f, -0.478202f, 0.422133f }, // index 0..4
+	{ 0.074204f, -0.005002f, 0.000234f, 0.995332f, 0.007007f, -0.039124f, 0.087949f },
+	{ 0.043930f, -0.000000f, -0.000000f, 0.997891f, 0.045808f, 0.002142f, -0.045943f },
+	{ 0.028695f, 0.000000f, 0.000000f, 0.999649f, 0.001850f, -0.022782f, -0.013409f },
+	{ 0.022821f, 0.000000f, -0.000000f, 1.000000f, -0.000000f, 0.000000f, -0.000000f },
+	{ 0.002177f, 0.007120f, 0.016319f, 0.546723f, 0.541276f, -0.442520f, 0.460749f }, // middle 0..4
+	{ 0.070953f, 0.000779f, 0.000997f, 0.980294f, -0.167261f, -0.078959f, 0.069368f },
+	{ 0.043108f, 0.000000f, 0.000000f, 0.997947f, 0.018493f, 0.013192f, 0.059886f },
+	{ 0.033266f, 0.000000f, 0.000000f, 0.997394f, -0.003328f, -0.028225f, -0.066315f },
+	{ 0.025892f, -0.000000f, 0.000000f, 1.000000f, -0.000000f, 0.000000f, 0.000000f },
+	{ 0.000513f, -0.006545f, 0.016348f, 0.516692f, 0.550144f, -0.495548f, 0.429888f }, // ring 0..4
+	{ 0.065876f, 0.001786f, 0.000693f, 0.990420f, -0.058696f, -0.101820f, 0.072495f },
+	{ 0.040697f, 0.000000f, 0.000000f, 0.999545f, -0.002240f, 0.000004f, 0.030081f },
+	{ 0.028747f, -0.000000f, -0.000000f, 0.999102f, -0.000721f, -0.012693f, 0.040420f },
+	{ 0.022430f, -0.000000f, 0.000000f, 1.000000f, 0.000000f, 0.000000f, 0.000000f },
+	{ -0.002478f, -0.018981f, 0.015214f, 0.526918f, 0.523940f, -0.584025f, 0.326740f }, // pinky 0..4
+	{ 0.062878f, 0.002844f, 0.000332f, 0.986609f, -0.059615f, -0.135163f, 0.069132f },
+	{ 0.030220f, 0.000000f, 0.000000f, 0.994317f, 0.001896f, -0.000132f, 0.106446f },
+	{ 0.018187f, 0.000000f, 0.000000f, 0.995931f, -0.002010f, -0.052079f, -0.073526f },
+	{ 0.018018f, 0.000000f, 0.000000f, 1.000000f, 0.000000f, 0.000000f, 0.000000f },
+};
+
+// curled joints and their flexion at a full curl, in radians about the bone's z axis
+static const int k_nCurlLanes = 16;
+static const int k_rgnCurlBones[k_nCurlLanes] = { 7, 8, 9, 12, 13, 14, 17, 18, 19, 22, 23, 24, 3, 4, -1, -1 };
+static const float k_rgflMaxCurl[k_nCurlLanes] = {
+	1.40f, 1.75f, 1.13f, 1.40f, 1.75f, 1.13f, 1.40f, 1.75f, 1.13f, 1.40f, 1.75f, 1.13f, // proximal, middle, distal
+	0.87f, 1.05f, 0.0f, 0.0f // thumb proximal, distal
+};
+static const int k_nThumbLane = 12;
+
+// aux bones are the model space transforms of each finger's distal joint
+static const int k_rgrgnAuxChains[5][5] = {
+	{ 1, 2, 3, 4, -1 },
+	{ 1, 6, 7, 8, 9 },
+	{ 1, 11, 12, 13, 14 },
+	{ 1, 16, 17, 18, 19 },
+	{ 1, 21, 22, 23, 24 },
+};
+
+// the ZED's joint frames are world aligned in the T-pose: the left arm points
+// along +x, the back of the hand +y and the thumb +z (-x, +y, +z on the right).
+// SteamVR's wrist bone has the fingers along +z and the thumb along +y, the
+// back of the hand +x on the left and -x on the right.
+static const HmdQuaternion_t k_rgqZedFromSkeletonWrist[Hand_Count] = {
+	{ 0.5, 0.5, 0.5, 0.5 },
+	{ 0.5, 0.5, -0.5, -0.5 },
+};
+
+// POSE_34 joints of each hand
+struct HandJoints_t
+{
+	BODY_PARTS_POSE_34 eWrist, eHand, eHandTip, eThumb;
+};
+static const HandJoints_t k_rgHandJoints[Hand_Count] = {
+	{ BODY_PARTS_POSE_34::LEFT_WRIST, BODY_PARTS_POSE_34::LEFT_HAND, BODY_PARTS_POSE_34::LEFT_HANDTIP, BODY_PARTS_POSE_34::LEFT_THUMB },
+	{ BODY_PARTS_POSE_34::RIGHT_WRIST, BODY_PARTS_POSE_34::RIGHT_HAND, BODY_PARTS_POSE_34::RIGHT_HANDTIP, BODY_PARTS_POSE_34::RIGHT_THUMB },
+};
+
+static const double k_flPi = 3.14159265358979323846;
+
+static HmdQuaternion_t ToDouble(const HmdQuaternionf_t& q)
+{
+	return HmdQuaternion_Init(q.w, q.x, q.y, q.z);
+}
+
+// angle between two vectors, 0 if either is degenerate
+static double AngleBetween(const double a[3], const double b[3])
+{
+	double flLengths = sqrt((a[0] * a[0] + a[1] * a[1] + a[2] * a[2]) * (b[0] * b[0] + b[1] * b[1] + b[2] * b[2]));
+	if (flLengths < 1e-12)
+		return 0.0;
+	double flCos = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) / flLengths;
+	return acos(flCos < -1.0 ? -1.0 : flCos > 1.0 ? 1.0 : flCos);
+}
+
+static float Saturate(double flValue)
+{
+	return (float)(flValue < 0.0 ? 0.0 : flValue > 1.0 ? 1.0 : flValue);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The right hand mirrors the left. Its wrist is reflected across the
+// root's YZ plane; bones below it have their axes flipped so the rotations of
+// the finger joints stay the same and only their offsets change sign.
+//-----------------------------------------------------------------------------
+CHandSkeletonRetargeter::CHandSkeletonRetargeter(EHand eHand)
+	: m_eHand(eHand)
+{
+	memset(m_rgReference, 0, sizeof(m_rgReference));
+	for (uint32_t i = 0; i < k_unHandBoneCount - 5; i++)
+	{
+		const float* pflBone = k_rgflLeftOpenHand[i];
+		VRBoneTransform_t& bone = m_rgReference[i];
+		bone.position.v[0] = pflBone[0];
+		bone.position.v[1] = pflBone[1];
+		bone.position.v[2] = pflBone[2];
+		bone.position.v[3] = 1.0f;
+		bone.orientation.w = pflBone[3];
+		bone.orientation.x = pflBone[4];
+		bone.orientation.y = pflBone[5];
+		bone.orientation.z = pflBone[6];
+		if (eHand == Hand_Left || i == 0)
+			continue;
+
+		bool bWrist = i == 1;
+		bool bMetacarpal = i == 2 || i == 6 || i == 11 || i == 16 || i == 21;
+		if (bWrist)
+		{
+			bone.position.v[0] = -pflBone[0];
+			bone.orientation.y = -pflBone[5];
+			bone.orientation.z = -pflBone[6];
+		}
+		else if (bMetacarpal)
+		{
+			bone.position.v[0] = -pflBone[0];
+			bone.orientation.w = pflBone[4];
+			bone.orientation.x = -pflBone[3];
+			bone.orientation.y = pflBone[6];
+			bone.orientation.z = -pflBone[5];
+		}
+		else
+		{
+			for (int j = 0; j < 3; j++)
+				bone.position.v[j] = -pflBone[j];
+		}
+	}
+	UpdateAuxBones(m_rgReference);
+}
+
+void CHandSkeletonRetargeter::GetReferencePose(VRBoneTransform_t rgBones[k_unHandBoneCount]) const
+{
+	memcpy(rgBones, m_rgReference, sizeof(m_rgReference));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: rgBones[b] = reference[b] * rotation about z, for every curled
+// joint at once: the quaternions are loaded as four lanes of each component.
+//-----------------------------------------------------------------------------
+void CHandSkeletonRetargeter::ApplyCurl(float flFingerCurl, float flThumbCurl, VRBoneTransform_t rgBones[k_unHandBoneCount]) const
+{
+	alignas(16) float rgflW[k_nCurlLanes], rgflX[k_nCurlLanes], rgflY[k_nCurlLanes], rgflZ[k_nCurlLanes];
+	alignas(16) float rgflCos[k_nCurlLanes], rgflSin[k_nCurlLanes];
+	for (int i = 0; i < k_nCurlLanes; i++)
+	{
+		int nBone = k_rgnCurlBones[i];
+		const HmdQuaternionf_t& q = m_rgReference[nBone < 0 ? 0 : nBone].orientation;
+		rgflW[i] = q.w;
+		rgflX[i] = q.x;
+		rgflY[i] = q.y;
+		rgflZ[i] = q.z;
+
+		float flHalfAngle = 0.5f * k_rgflMaxCurl[i] * (i < k_nThumbLane ? flFingerCurl : flThumbCurl);
+		rgflCos[i] = cosf(flHalfAngle);
+		rgflSin[i] = sinf(flHalfAngle);
+	}
+
+#if defined(HMDMATH_SSE2) || defined(HMDMATH_AVX)
+	for (int i = 0; i < k_nCurlLanes; i += 4)
+	{
+		__m128 w = _mm_load_ps(rgflW + i), x = _mm_load_ps(rgflX + i), y = _mm_load_ps(rgflY + i), z = _mm_load_ps(rgflZ + i);
+		__m128 c = _mm_load_ps(rgflCos + i), s = _mm_load_ps(rgflSin + i);
+		_mm_store_ps(rgflW + i, _mm_sub_ps(_mm_mul_ps(w, c), _mm_mul_ps(z, s)));
+		_mm_store_ps(rgflX + i, _mm_add_ps(_mm_mul_ps(x, c), _mm_mul_ps(y, s)));
+		_mm_store_ps(rgflY + i, _mm_sub_ps(_mm_mul_ps(y, c), _mm_mul_ps(x, s)));
+		_mm_store_ps(rgflZ + i, _mm_add_ps(_mm_mul_ps(z, c), _mm_mul_ps(w, s)));
+	}
+#else
+	for (int i = 0; i < k_nCurlLanes; i++)
+	{
+		float w = rgflW[i], x = rgflX[i], y = rgflY[i], z = rgflZ[i];
+		rgflW[i] = w * rgflCos[i] - z * rgflSin[i];
+		rgflX[i] = x * rgflCos[i] + y * rgflSin[i];
+		rgflY[i] = y * rgflCos[i] - x * rgflSin[i];
+		rgflZ[i] = z * rgflCos[i] + w * rgflSin[i];
+	}
+#endif
+
+	for (int i = 0; i < k_nCurlLanes; i++)
+	{
+		int nBone = k_rgnCurlBones[i];
+		if (nBone < 0)
+			continue;
+		rgBones[nBone].orientation.w = rgflW[i];
+		rgBones[nBone].orientation.x = rgflX[i];
+		rgBones[nBone].orientation.y = rgflY[i];
+		rgBones[nBone].orientation.z = rgflZ[i];
+	}
+}
+
+void CHandSkeletonRetargeter::UpdateAuxBones(VRBoneTransform_t rgBones[k_unHandBoneCount]) const
+{
+	for (int nFinger = 0; nFinger < 5; nFinger++)
+	{
+		double vecPosition[3] = { 0.0, 0.0, 0.0 };
+		HmdQuaternion_t qRotation = HmdQuaternion_Identity();
+		for (int j = 0; j < 5 && k_rgrgnAuxChains[nFinger][j] >= 0; j++)
+		{
+			const VRBoneTransform_t& bone = rgBones[k_rgrgnAuxChains[nFinger][j]];
+			double vecLocal[3] = { bone.position.v[0], bone.position.v[1], bone.position.v[2] };
+			double vecRotated[3];
+			HmdQuaternion_RotateVector(qRotation, vecLocal, vecRotated);
+			for (int k = 0; k < 3; k++)
+				vecPosition[k] += vecRotated[k];
+			qRotation = HmdQuaternion_Multiply(qRotation, ToDouble(bone.orientation));
+		}
+
+		VRBoneTransform_t& aux = rgBones[k_unHandBoneCount - 5 + nFinger];
+		aux.position.v[0] = (float)vecPosition[0];
+		aux.position.v[1] = (float)vecPosition[1];
+		aux.position.v[2] = (float)vecPosition[2];
+		aux.position.v[3] = 1.0f;
+		qRotation = HmdQuaternion_Normalize(qRotation);
+		aux.orientation.w = (float)qRotation.w;
+		aux.orientation.x = (float)qRotation.x;
+		aux.orientation.y = (float)qRotation.y;
+		aux.orientation.z = (float)qRotation.z;
+	}
+}
+
+bool CHandSkeletonRetargeter::Retarget(const ZedBodySkeleton_t& skeleton, VRBoneTransform_t rgBones[k_unHandBoneCount],
+	double vecRootPosition[3], HmdQuaternion_t* pqRootRotation) const
+{
+	const HandJoints_t& joints = k_rgHandJoints[m_eHand];
+	int nWrist = (int)joints.eWrist, nHand = (int)joints.eHand, nHandTip = (int)joints.eHandTip, nThumb = (int)joints.eThumb;
+	if (!skeleton.rgbValid[nWrist] || !skeleton.rgbValid[nHand])
+		return false;
+
+	double vecPalm[3], vecFingers[3], vecThumb[3];
+	for (int i = 0; i < 3; i++)
+	{
+		vecPalm[i] = skeleton.rgvecPosition[nHand][i] - skeleton.rgvecPosition[nWrist][i];
+		vecFingers[i] = skeleton.rgvecPosition[nHandTip][i] - skeleton.rgvecPosition[nHand][i];
+		vecThumb[i] = skeleton.rgvecPosition[nThumb][i] - skeleton.rgvecPosition[nWrist][i];
+	}
+
+	// a fist bends the tips back ~150 degrees; a tucked thumb lies within ~10 degrees of the palm, a spread one ~35
+	float flFingerCurl = skeleton.rgbValid[nHandTip] ? Saturate(AngleBetween(vecPalm, vecFingers) / (150.0 * k_flPi / 180.0)) : 0.0f;
+	float flThumbCurl = skeleton.rgbValid[nThumb] ? Saturate((35.0 * k_flPi / 180.0 - AngleBetween(vecPalm, vecThumb)) / (25.0 * k_flPi / 180.0)) : 0.0f;
+
+	memcpy(rgBones, m_rgReference, sizeof(m_rgReference));
+	ApplyCurl(flFingerCurl, flThumbCurl, rgBones);
+	UpdateAuxBones(rgBones);
+
+	// the root is placed so the skeleton's wrist bone lands on the ZED's wrist
+	const VRBoneTransform_t& wrist = m_rgReference[1];
+	HmdQuaternion_t qWristWorld = HmdQuaternion_Multiply(skeleton.rgqRotation[nWrist], k_rgqZedFromSkeletonWrist[m_eHand]);
+	*pqRootRotation = HmdQuaternion_Normalize(HmdQuaternion_Multiply(qWristWorld, HmdQuaternion_Conjugate(ToDouble(wrist.orientation))));
+
+	double vecWristOffset[3] = { wrist.position.v[0], wrist.position.v[1], wrist.position.v[2] };
+	double vecRotated[3];
+	HmdQuaternion_RotateVector(*pqRootRotation, vecWristOffset, vecRotated);
+	for (int i = 0; i < 3; i++)
+		vecRootPosition[i] = skeleton.rgvecPosition[nWrist][i] - vecRotated[i];
+	return true;
+}
@@ -0,0 +1,56 @@
+#ifndef HANDSKELETON_H
+#define HANDSKELETON_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <cstdint>
+
+#include "bodytracker.h"
+
+// bones of the SteamVR hand skeleton, eBone_Root .. eBone_Aux_PinkyFinger
+static const uint32_t k_unHandBoneCount = 31;
+
+enum EHand
+{
+	Hand_Left,
+	Hand_Right,
+	Hand_Count
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Retargets the hand joints of a POSE_34 body (wrist, hand, hand tip
+// and thumb) onto the SteamVR hand skeleton.
+//
+// POSE_34 has no finger joints, so the skeleton is SteamVR's open hand
+// reference pose with two estimated parameters: the curl of the four fingers,
+// from the bend between the wrist-to-knuckle and knuckle-to-tip directions,
+// and the curl of the thumb. The curled rotations of all finger joints are
+// computed together, four joints per SSE instruction, into the caller's
+// transforms; nothing is allocated per update.
+//-----------------------------------------------------------------------------
+class CHandSkeletonRetargeter
+{
+public:
+	explicit CHandSkeletonRetargeter(EHand eHand);
+
+	/** Fills rgBones and the skeleton root's pose in ZED world space.
+	* False if the skeleton doesn't have this hand's wrist and knuckles. */
+	bool Retarget(const ZedBodySkeleton_t& skeleton, vr::VRBoneTransform_t rgBones[k_unHandBoneCount],
+		double vecRootPosition[3], vr::HmdQuaternion_t* pqRootRotation) const;
+
+	/** The open hand, e.g. while the hand isn't seen */
+	void GetReferencePose(vr::VRBoneTransform_t rgBones[k_unHandBoneCount]) const;
+
+	EHand GetHand() const { return m_eHand; }
+
+private:
+	void ApplyCurl(float flFingerCurl, float flThumbCurl, vr::VRBoneTransform_t rgBones[k_unHandBoneCount]) const;
+	void UpdateAuxBones(vr::VRBoneTransform_t rgBones[k_unHandBoneCount]) const;
+
+	EHand m_eHand;
+	vr::VRBoneTransform_t m_rgReference[k_unHandBoneCount];
+};
+
+#endif // HANDSKELETON_H
@@ -0,0 +1,270 @@
+#ifndef HMDMATH_H
+#define HMDMATH_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define HMDMATH_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HMDMATH_SSE2 1
+#endif
+
+//-----------------------------------------------------------------------------
+// Purpose: Quaternion and vector helpers on the OpenVR types. Quaternions are
+// unit (w, x, y, z) rotations, composed right to left like matrices: a * b
+// applies b first. The single-value functions are scalar and constexpr where
+// the language allows; the *Batch functions take many values at once and use
+// AVX or SSE2 when the compiler targets them. zedm_mathbench compares them
+// with the samples' Matrices.cpp.
+//-----------------------------------------------------------------------------
+
+constexpr vr::HmdQuaternion_t HmdQuaternion_Init(double w, double x, double y, double z)
+{
+	return vr::HmdQuaternion_t{ w, x, y, z };
+}
+
+constexpr vr::HmdQuaternion_t HmdQuaternion_Identity()
+{
+	return vr::HmdQuaternion_t{ 1.0, 0.0, 0.0, 0.0 };
+}
+
+constexpr vr::HmdQuaternion_t HmdQuaternion_Multiply(const vr::HmdQuaternion_t& a, const vr::HmdQuaternion_t& b)
+{
+	return vr::HmdQuaternion_t{
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+		a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+		a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+		a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w
+	};
+}
+
+// inverse of a unit quaternion
+constexpr vr::HmdQuaternion_t HmdQuaternion_Conjugate(const vr::HmdQuaternion_t& q)
+{
+	return vr::HmdQuaternion_t{ q.w, -q.x, -q.y, -q.z };
+}
+
+constexpr double HmdQuaternion_Dot(const vr::HmdQuaternion_t& a, const vr::HmdQuaternion_t& b)
+{
+	return a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline vr::HmdQuaternion_t HmdQuaternion_Normalize(const vr::HmdQuaternion_t& q)
+{
+	double flLength = sqrt(HmdQuaternion_Dot(q, q));
+	if (flLength < 1e-12)
+		return HmdQuaternion_Identity();
+	return HmdQuaternion_Init(q.w / flLength, q.x / flLength, q.y / flLength, q.z / flLength);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Spherical interpolation from a (t = 0) to b (t = 1) along the
+// shorter arc. Falls back to a normalized lerp for nearly equal rotations.
+//-----------------------------------------------------------------------------
+inline vr::HmdQuaternion_t HmdQuaternion_Slerp(const vr::HmdQuaternion_t& a, const vr::HmdQuaternion_t& b, double t)
+{
+	double flCos = HmdQuaternion_Dot(a, b);
+	double flSign = 1.0;
+	if (flCos < 0.0)
+	{
+		flCos = -flCos;
+		flSign = -1.0;
+	}
+
+	double flWeightA = 1.0 - t;
+	double flWeightB = t;
+	if (flCos < 0.9995)
+	{
+		double flAngle = acos(flCos);
+		double flSin = sin(flAngle);
+		flWeightA = sin((1.0 - t) * flAngle) / flSin;
+		flWeightB = sin(t * flAngle) / flSin;
+	}
+	flWeightB *= flSign;
+
+	return HmdQuaternion_Normalize(HmdQuaternion_Init(
+		flWeightA * a.w + flWeightB * b.w,
+		flWeightA * a.x + flWeightB * b.x,
+		flWeightA * a.y + flWeightB * b.y,
+		flWeightA * a.z + flWeightB * b.z));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Rotates vecIn by quaternion q (v' = q * v * q^-1).
+//-----------------------------------------------------------------------------
+inline void HmdQuaternion_RotateVector(const vr::HmdQuaternion_t& q, const double vecIn[3], double vecOut[3])
+{
+	// t = 2 * cross(q.xyz, v); v' = v + w * t + cross(q.xyz, t)
+	double tx = 2.0 * (q.y * vecIn[2] - q.z * vecIn[1]);
+	double ty = 2.0 * (q.z * vecIn[0] - q.x * vecIn[2]);
+	double tz = 2.0 * (q.x * vecIn[1] - q.y * vecIn[0]);
+	vecOut[0] = vecIn[0] + q.w * tx + (q.y * tz - q.z * ty);
+	vecOut[1] = vecIn[1] + q.w * ty + (q.z * tx - q.x * tz);
+	vecOut[2] = vecIn[2] + q.w * tz + (q.x * ty - q.y * tx);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Rotation of |vecRotation| radians about vecRotation's direction,
+// e.g. an angular velocity times a time step.
+//-----------------------------------------------------------------------------
+inline vr::HmdQuaternion_t HmdQuaternion_FromRotationVector(const double vecRotation[3])
+{
+	double flAngle = sqrt(vecRotation[0] * vecRotation[0] + vecRotation[1] * vecRotation[1] + vecRotation[2] * vecRotation[2]);
+	if (flAngle < 1e-12)
+		return HmdQuaternion_Identity();
+	double flScale = sin(0.5 * flAngle) / flAngle;
+	return HmdQuaternion_Init(cos(0.5 * flAngle), vecRotation[0] * flScale, vecRotation[1] * flScale, vecRotation[2] * flScale);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Inverse of HmdQuaternion_FromRotationVector, the short way around
+//-----------------------------------------------------------------------------
+inline void HmdQuaternion_ToRotationVector(const vr::HmdQuaternion_t& q, double vecRotation[3])
+{
+	double flSign = q.w < 0.0 ? -1.0 : 1.0;
+	double flSinHalf = sqrt(q.x * q.x + q.y * q.y + q.z * q.z);
+	double flScale = flSinHalf > 1e-12 ? 2.0 * atan2(flSinHalf, flSign * q.w) / flSinHalf : 2.0;
+	vecRotation[0] = flSign * q.x * flScale;
+	vecRotation[1] = flSign * q.y * flScale;
+	vecRotation[2] = flSign * q.z * flScale;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Rotation from Euler angles in radians for the Y-up driver space:
+// yaw about +Y, then pitch about +X, then roll about +Z (q = yaw * pitch * roll).
+//-----------------------------------------------------------------------------
+inline vr::HmdQuaternion_t HmdQuaternion_FromYawPitchRoll(double flYaw, double flPitch, double flRoll)
+{
+	vr::HmdQuaternion_t qYaw = HmdQuaternion_Init(cos(0.5 * flYaw), 0.0, sin(0.5 * flYaw), 0.0);
+	vr::HmdQuaternion_t qPitch = HmdQuaternion_Init(cos(0.5 * flPitch), sin(0.5 * flPitch), 0.0, 0.0);
+	vr::HmdQuaternion_t qRoll = HmdQuaternion_Init(cos(0.5 * flRoll), 0.0, 0.0, sin(0.5 * flRoll));
+	return HmdQuaternion_Multiply(qYaw, HmdQuaternion_Multiply(qPitch, qRoll));
+}
+
+// row major 3x3 rotation matrix of a unit quaternion
+inline void HmdQuaternion_ToMatrix(const vr::HmdQuaternion_t& q, double rgflMatrix[3][3])
+{
+	double xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	double xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	double wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+	rgflMatrix[0][0] = 1.0 - 2.0 * (yy + zz); rgflMatrix[0][1] = 2.0 * (xy - wz); rgflMatrix[0][2] = 2.0 * (xz + wy);
+	rgflMatrix[1][0] = 2.0 * (xy + wz); rgflMatrix[1][1] = 1.0 - 2.0 * (xx + zz); rgflMatrix[1][2] = 2.0 * (yz - wx);
+	rgflMatrix[2][0] = 2.0 * (xz - wy); rgflMatrix[2][1] = 2.0 * (yz + wx); rgflMatrix[2][2] = 1.0 - 2.0 * (xx + yy);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: pOut[i] = q * pIn[i] for unCount quaternions, e.g. moving every
+// device rotation into another space. pOut may alias pIn.
+//-----------------------------------------------------------------------------
+inline void HmdQuaternion_MultiplyBatch(const vr::HmdQuaternion_t& q, const vr::HmdQuaternion_t* pIn, vr::HmdQuaternion_t* pOut, uint32_t unCount)
+{
+	// left multiplication by q is a fixed 4x4 matrix; these are its columns for (w, x, y, z) input
+#if defined(HMDMATH_AVX)
+	const __m256d colW = _mm256_setr_pd(q.w, q.x, q.y, q.z);
+	const __m256d colX = _mm256_setr_pd(-q.x, q.w, q.z, -q.y);
+	const __m256d colY = _mm256_setr_pd(-q.y, -q.z, q.w, q.x);
+	const __m256d colZ = _mm256_setr_pd(-q.z, q.y, -q.x, q.w);
+	for (uint32_t i = 0; i < unCount; i++)
+	{
+		const double* p = &pIn[i].w;
+		__m256d r = _mm256_mul_pd(colW, _mm256_broadcast_sd(p + 0));
+		r = _mm256_add_pd(r, _mm256_mul_pd(colX, _mm256_broadcast_sd(p + 1)));
+		r = _mm256_add_pd(r, _mm256_mul_pd(colY, _mm256_broadcast_sd(p + 2)));
+		r = _mm256_add_pd(r, _mm256_mul_pd(colZ, _mm256_broadcast_sd(p + 3)));
+		_mm256_storeu_pd(&pOut[i].w, r);
+	}
+#elif defined(HMDMATH_SSE2)
+	const __m128d colWLo = _mm_setr_pd(q.w, q.x), colWHi = _mm_setr_pd(q.y, q.z);
+	const __m128d colXLo = _mm_setr_pd(-q.x, q.w), colXHi = _mm_setr_pd(q.z, -q.y);
+	const __m128d colYLo = _mm_setr_pd(-q.y, -q.z), colYHi = _mm_setr_pd(q.w, q.x);
+	const __m128d colZLo = _mm_setr_pd(-q.z, q.y), colZHi = _mm_setr_pd(-q.x, q.w);
+	for (uint32_t i = 0; i < unCount; i++)
+	{
+		const double* p = &pIn[i].w;
+		__m128d w = _mm_set1_pd(p[0]), x = _mm_set1_pd(p[1]), y = _mm_set1_pd(p[2]), z = _mm_set1_pd(p[3]);
+		__m128d lo = _mm_add_pd(_mm_add_pd(_mm_mul_pd(colWLo, w), _mm_mul_pd(colXLo, x)), _mm_add_pd(_mm_mul_pd(colYLo, y), _mm_mul_pd(colZLo, z)));
+		__m128d hi = _mm_add_pd(_mm_add_pd(_mm_mul_pd(colWHi, w), _mm_mul_pd(colXHi, x)), _mm_add_pd(_mm_mul_pd(colYHi, y), _mm_mul_pd(colZHi, z)));
+		_mm_storeu_pd(&pOut[i].w, lo);
+		_mm_storeu_pd(&pOut[i].y, hi);
+	}
+#else
+	for (uint32_t i = 0; i < unCount; i++)
+		pOut[i] = HmdQuaternion_Multiply(q, pIn[i]);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Rotates unCount vectors in place by q, then adds vecTranslation.
+// Structure-of-arrays so four (AVX) or two (SSE2) vectors go through each
+// instruction, e.g. device positions or a mesh being moved into tracking
+// space. Pass a null vecTranslation for a pure rotation.
+//-----------------------------------------------------------------------------
+inline void HmdQuaternion_TransformBatch(const vr::HmdQuaternion_t& q, const double* vecTranslation, double* pX, double* pY, double* pZ, uint32_t unCount)
+{
+	double m[3][3];
+	HmdQuaternion_ToMatrix(q, m);
+	const double t[3] = {
+		vecTranslation ? vecTranslation[0] : 0.0,
+		vecTranslation ? vecTranslation[1] : 0.0,
+		vecTranslation ? vecTranslation[2] : 0.0
+	};
+
+	uint32_t i = 0;
+#if defined(HMDMATH_AVX)
+	const __m256d m00 = _mm256_set1_pd(m[0][0]), m01 = _mm256_set1_pd(m[0][1]), m02 = _mm256_set1_pd(m[0][2]);
+	const __m256d m10 = _mm256_set1_pd(m[1][0]), m11 = _mm256_set1_pd(m[1][1]), m12 = _mm256_set1_pd(m[1][2]);
+	const __m256d m20 = _mm256_set1_pd(m[2][0]), m21 = _mm256_set1_pd(m[2][1]), m22 = _mm256_set1_pd(m[2][2]);
+	const __m256d tx = _mm256_set1_pd(t[0]), ty = _mm256_set1_pd(t[1]), tz = _mm256_set1_pd(t[2]);
+	for (; i + 4 <= unCount; i += 4)
+	{
+		__m256d x = _mm256_loadu_pd(pX + i), y = _mm256_loadu_pd(pY + i), z = _mm256_loadu_pd(pZ + i);
+		_mm256_storeu_pd(pX + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m00, x), _mm256_mul_pd(m01, y)), _mm256_add_pd(_mm256_mul_pd(m02, z), tx)));
+		_mm256_storeu_pd(pY + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m10, x), _mm256_mul_pd(m11, y)), _mm256_add_pd(_mm256_mul_pd(m12, z), ty)));
+		_mm256_storeu_pd(pZ + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m20, x), _mm256_mul_pd(m21, y)), _mm256_add_pd(_mm256_mul_pd(m22, z), tz)));
+	}
+#elif defined(HMDMATH_SSE2)
+	const __m128d m00 = _mm_set1_pd(m[0][0]), m01 = _mm_set1_pd(m[0][1]), m02 = _mm_set1_pd(m[0][2]);
+	const __m128d m10 = _mm_set1_pd(m[1][0]), m11 = _mm_set1_pd(m[1][1]), m12 = _mm_set1_pd(m[1][2]);
+	const __m128d m20 = _mm_set1_pd(m[2][0]), m21 = _mm_set1_pd(m[2][1]), m22 = _mm_set1_pd(m[2][2]);
+	const __m128d tx = _mm_set1_pd(t[0]), ty = _mm_set1_pd(t[1]), tz = _mm_set1_pd(t[2]);
+	for (; i + 2 <= unCount; i += 2)
+	{
+		__m128d x = _mm_loadu_pd(pX + i), y = _mm_loadu_pd(pY + i), z = _mm_loadu_pd(pZ + i);
+		_mm_storeu_pd(pX + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(m00, x), _mm_mul_pd(m01, y)), _mm_add_pd(_mm_mul_pd(m02, z), tx)));
+		_mm_storeu_pd(pY + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(m10, x), _mm_mul_pd(m11, y)), _mm_add_pd(_mm_mul_pd(m12, z), ty)));
+		_mm_storeu_pd(pZ + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(m20, x), _mm_mul_pd(m21, y)), _mm_add_pd(_mm_mul_pd(m22, z), tz)));
+	}
+#endif
+	for (; i < unCount; i++)
+	{
+		double x = pX[i], y = pY[i], z = pZ[i];
+		pX[i] = m[0][0] * x + m[0][1] * y + m[0][2] * z + t[0];
+		pY[i] = m[1][0] * x + m[1][1] * y + m[1][2] * z + t[1];
+		pZ[i] = m[2][0] * x + m[2][1] * y + m[2][2] * z + t[2];
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: A connected device without a pose yet, what the trackers report
+// until their first result is published.
+//-----------------------------------------------------------------------------
+inline vr::DriverPose_t DriverPose_Uninitialized()
+{
+	vr::DriverPose_t pose = {};
+	pose.qRotation = HmdQuaternion_Identity();
+	pose.qWorldFromDriverRotation = HmdQuaternion_Identity();
+	pose.qDriverFromHeadRotation = HmdQuaternion_Identity();
+	pose.poseIsValid = false;
+	pose.result = vr::TrackingResult_Uninitialized;
+	pose.deviceIsConnected = true;
+	return pose;
+}
+
+#endif // HMDMATH_H
@@ -0,0 +1,123 @@
+#include "imubias.h"
+#include "hmdmath.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace vr;
+
+static const uint64_t k_ulStationaryNs = 1000000000ull;
+
+// at least this many samples to the second, ~1/4 of the ZED's rate
+static const uint32_t k_unMinSamples = 100;
+
+// deviations from the running averages still counted as holding still
+static const double k_flStationaryGyro = 0.05;
+static const double k_flStationaryAccel = 0.3;
+
+// larger offsets are slow motion or a tilted gravity estimate, not bias
+static const double k_flMaxGyroBias = 0.1;
+static const double k_flMaxAccelBias = 1.0;
+
+static const char* const k_pchImuBiasHeader = "zedm-imu-bias 1";
+
+CImuBiasEstimator::CImuBiasEstimator()
+{
+	Reset();
+}
+
+void CImuBiasEstimator::Reset()
+{
+	m_ulStartNs = 0;
+	m_unSamples = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		m_vecGyroSum[i] = 0.0;
+		m_vecAccelSum[i] = 0.0;
+	}
+}
+
+void CImuBiasEstimator::Restart(const ImuRingSample_t& sample)
+{
+	Reset();
+	m_ulStartNs = sample.ulTimestampNs;
+}
+
+bool CImuBiasEstimator::AddSample(const ImuRingSample_t& sample, ImuBias_t* pBias)
+{
+	// gravity is up in the world, the IMU frame is the orientation's conjugate
+	static const double vecGravity[3] = { 0.0, k_flStandardGravity, 0.0 };
+	double vecImuGravity[3];
+	HmdQuaternion_RotateVector(HmdQuaternion_Conjugate(sample.qOrientation), vecGravity, vecImuGravity);
+
+	double vecAccel[3];
+	for (int i = 0; i < 3; i++)
+		vecAccel[i] = sample.vecAccel[i] - vecImuGravity[i];
+
+	if (m_unSamples == 0 || sample.ulTimestampNs <= m_ulStartNs)
+		Restart(sample);
+	for (int i = 0; i < 3 && m_unSamples > 0; i++)
+	{
+		if (fabs(sample.vecGyro[i] - m_vecGyroSum[i] / m_unSamples) > k_flStationaryGyro
+			|| fabs(vecAccel[i] - m_vecAccelSum[i] / m_unSamples) > k_flStationaryAccel)
+		{
+			Restart(sample);
+		}
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		m_vecGyroSum[i] += sample.vecGyro[i];
+		m_vecAccelSum[i] += vecAccel[i];
+	}
+	m_unSamples++;
+
+	if (sample.ulTimestampNs - m_ulStartNs < k_ulStationaryNs || m_unSamples < k_unMinSamples)
+		return false;
+
+	ImuBias_t bias;
+	double flGyroSquared = 0.0, flAccelSquared = 0.0;
+	for (int i = 0; i < 3; i++)
+	{
+		bias.vecGyro[i] = m_vecGyroSum[i] / m_unSamples;
+		bias.vecAccel[i] = m_vecAccelSum[i] / m_unSamples;
+		flGyroSquared += bias.vecGyro[i] * bias.vecGyro[i];
+		flAccelSquared += bias.vecAccel[i] * bias.vecAccel[i];
+	}
+	Reset();
+	if (flGyroSquared > k_flMaxGyroBias * k_flMaxGyroBias || flAccelSquared > k_flMaxAccelBias * k_flMaxAccelBias)
+		return false;
+
+	*pBias = bias;
+	return true;
+}
+
+bool LoadImuBias(const std::string& sPath, ImuBias_t* pBias)
+{
+	FILE* pFile = fopen(sPath.c_str(), "r");
+	if (!pFile)
+		return false;
+
+	char rchHeader[32] = {};
+	ImuBias_t bias;
+	bool bRead = fgets(rchHeader, sizeof(rchHeader), pFile) && strncmp(rchHeader, k_pchImuBiasHeader, strlen(k_pchImuBiasHeader)) == 0
+		&& fscanf(pFile, " gyro %lf %lf %lf", &bias.vecGyro[0], &bias.vecGyro[1], &bias.vecGyro[2]) == 3
+		&& fscanf(pFile, " accel %lf %lf %lf", &bias.vecAccel[0], &bias.vecAccel[1], &bias.vecAccel[2]) == 3;
+	fclose(pFile);
+
+	if (bRead)
+		*pBias = bias;
+	return bRead;
+}
+
+bool SaveImuBias(const std::string& sPath, const ImuBias_t& bias)
+{
+	FILE* pFile = fopen(sPath.c_str(), "w");
+	if (!pFile)
+		return false;
+
+	fprintf(pFile, "%s\ngyro %.9g %.9g %.9g\naccel %.9g %.9g %.9g\n", k_pchImuBiasHeader,
+		bias.vecGyro[0], bias.vecGyro[1], bias.vecGyro[2], bias.vecAccel[0], bias.vecAccel[1], bias.vecAccel[2]);
+	return fclose(pFile) == 0;
+}
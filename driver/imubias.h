@@ -0,0 +1,67 @@
+#ifndef IMUBIAS_H
+#define IMUBIAS_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "imuring.h"
+
+// what the accelerometer reads at rest, upwards, m/s^2
+static const double k_flStandardGravity = 9.80665;
+
+//-----------------------------------------------------------------------------
+// Purpose: Gyro and accelerometer offsets in the IMU's own frame, subtracted
+// from every sample before it goes into the ring.
+//-----------------------------------------------------------------------------
+struct ImuBias_t
+{
+	double vecGyro[3]; // rad/s
+	double vecAccel[3]; // m/s^2, gravity excluded
+};
+
+inline void ApplyImuBias(const ImuBias_t& bias, ImuRingSample_t* pSample)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		pSample->vecGyro[i] -= bias.vecGyro[i];
+		pSample->vecAccel[i] -= bias.vecAccel[i];
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Estimates the IMU bias from the first second the camera holds
+// still. At rest the gyro should read zero and the accelerometer gravity,
+// which the SDK's gravity aligned orientation places in the IMU frame; the
+// averages of what they read instead are the bias. Any sample that strays
+// from the running averages by more than sensor noise restarts the second,
+// and an estimate too large to be bias is thrown away.
+//
+// Single threaded: owned by the IMU poller, fed raw samples.
+//-----------------------------------------------------------------------------
+class CImuBiasEstimator
+{
+public:
+	CImuBiasEstimator();
+
+	void Reset();
+
+	/** True once, when a full second at rest has been averaged into *pBias */
+	bool AddSample(const ImuRingSample_t& sample, ImuBias_t* pBias);
+
+private:
+	void Restart(const ImuRingSample_t& sample);
+
+	uint64_t m_ulStartNs;
+	uint32_t m_unSamples;
+	double m_vecGyroSum[3];
+	double m_vecAccelSum[3]; // the reading less gravity in the IMU frame
+};
+
+/** An imuBiasPath file; false if it is missing or unreadable */
+extern bool LoadImuBias(const std::string& sPath, ImuBias_t* pBias);
+
+extern bool SaveImuBias(const std::string& sPath, const ImuBias_t& bias);
+
+#endif // IMUBIAS_H
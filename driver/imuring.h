@@ -0,0 +1,136 @@
+#ifndef IMURING_H
+#define IMURING_H
+
+#pragma once
+
+#include "wakeevent.h"
+
+#include <openvr_driver.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+// Purpose: One IMU sample as the poller read it from the SDK. The orientation
+// is the SDK's gravity-aligned fusion; gyro and accel are raw, in the camera
+// frame.
+//-----------------------------------------------------------------------------
+struct ImuRingSample_t
+{
+	uint64_t ulTimestampNs; // ZED clock
+	vr::HmdQuaternion_t qOrientation;
+	double vecGyro[3]; // rad/s
+	double vecAccel[3]; // m/s^2
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Every IMU sample, in order, from the thread that polls the SDK to
+// those that consume them. Same slot protocol as CPoseHistory: single writer,
+// any number of readers, no locks or allocation; a reader that falls more than
+// the capacity behind skips what was overwritten and is told how much.
+// Readers can sleep in WaitForWrite until the next sample instead of polling.
+//-----------------------------------------------------------------------------
+class CImuRing
+{
+public:
+	// ~2.5 s at the ZED's 400 Hz
+	static const uint32_t k_unCapacity = 1024;
+
+	CImuRing()
+		: m_ulWriteCount(0)
+	{
+		for (uint32_t i = 0; i < k_unCapacity; i++)
+		{
+			m_rgSlots[i].ulSequence.store(0, std::memory_order_relaxed);
+			memset(&m_rgSlots[i].sample, 0, sizeof(m_rgSlots[i].sample));
+		}
+	}
+
+	/** Appends a sample. Writer thread only. */
+	void Write(const ImuRingSample_t& sample)
+	{
+		uint64_t ulIndex = m_ulWriteCount.load(std::memory_order_relaxed);
+		Slot_t& slot = m_rgSlots[ulIndex % k_unCapacity];
+
+		// odd while the slot is being written, then 2 * (index + 1)
+		slot.ulSequence.store(2 * ulIndex + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		memcpy(&slot.sample, &sample, sizeof(sample));
+		slot.ulSequence.store(2 * ulIndex + 2, std::memory_order_release);
+
+		m_ulWriteCount.store(ulIndex + 1, std::memory_order_release);
+		m_writeEvent.Notify();
+	}
+
+	/** Samples written so far; a reader starting now passes this as *pulNext */
+	uint64_t GetWriteCount() const { return m_ulWriteCount.load(std::memory_order_acquire); }
+
+	/** Sleeps until there is a sample from write number ulNext on, until ulDeadlineNs on the
+	* steady clock (0 for none) or until WakeReaders; true when there is one to read */
+	bool WaitForWrite(uint64_t ulNext, uint64_t ulDeadlineNs = 0)
+	{
+		uint32_t unGeneration = m_writeEvent.GetGeneration();
+		if (GetWriteCount() > ulNext)
+			return true;
+		m_writeEvent.Wait(unGeneration, ulDeadlineNs);
+		return GetWriteCount() > ulNext;
+	}
+
+	/** Ends the readers' WaitForWrite without a sample, e.g. to stop them */
+	void WakeReaders() { m_writeEvent.Notify(); }
+
+	/** Samples since write number *pulNext, up to unMax of them, and advances *pulNext.
+	* Samples overwritten before they were read are skipped; *pulSkipped counts them. */
+	uint32_t Read(uint64_t* pulNext, ImuRingSample_t* pOut, uint32_t unMax, uint64_t* pulSkipped = nullptr) const
+	{
+		uint64_t ulEnd = m_ulWriteCount.load(std::memory_order_acquire);
+		uint64_t ulSkipped = 0;
+		uint32_t unRead = 0;
+
+		while (*pulNext < ulEnd && unRead < unMax)
+		{
+			// the oldest slot may be rewritten while it is copied, so stay one clear of it
+			if (ulEnd - *pulNext >= k_unCapacity)
+			{
+				uint64_t ulOldest = ulEnd - k_unCapacity + 1;
+				ulSkipped += ulOldest - *pulNext;
+				*pulNext = ulOldest;
+			}
+			if (ReadSlot(*pulNext, &pOut[unRead]))
+				unRead++;
+			else
+				ulSkipped++;
+			(*pulNext)++;
+		}
+
+		if (pulSkipped)
+			*pulSkipped = ulSkipped;
+		return unRead;
+	}
+
+private:
+	struct Slot_t
+	{
+		std::atomic<uint64_t> ulSequence;
+		ImuRingSample_t sample;
+	};
+
+	// copies the sample of write number ulIndex; false if it has been overwritten or is being written
+	bool ReadSlot(uint64_t ulIndex, ImuRingSample_t* pOut) const
+	{
+		const Slot_t& slot = m_rgSlots[ulIndex % k_unCapacity];
+		uint64_t ulExpected = 2 * ulIndex + 2;
+		if (slot.ulSequence.load(std::memory_order_acquire) != ulExpected)
+			return false;
+		memcpy(pOut, &slot.sample, sizeof(*pOut));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return slot.ulSequence.load(std::memory_order_relaxed) == ulExpected;
+	}
+
+	Slot_t m_rgSlots[k_unCapacity];
+	std::atomic<uint64_t> m_ulWriteCount;
+	CWakeEvent m_writeEvent;
+};
+
+#endif // IMURING_H
@@ -0,0 +1,82 @@
+#include "latencystats.h"
+
+static const char* const k_rpchLatencyStageNames[LatencyStage_Count] =
+{
+	"exposure_to_grab",
+	"grab",
+	"get_position",
+	"get_sensors_data",
+	"exposure_to_submit",
+	"grab_cpu",
+	"imu_wake_late",
+};
+
+const char* GetLatencyStageName(ELatencyStage eStage)
+{
+	return eStage < LatencyStage_Count ? k_rpchLatencyStageNames[eStage] : "unknown";
+}
+
+void CLatencyHistogram::Reset()
+{
+	for (uint32_t i = 0; i < k_unBucketCount; i++)
+		m_rgunBuckets[i].store(0, std::memory_order_relaxed);
+	m_ulMaxUs.store(0, std::memory_order_relaxed);
+}
+
+void CLatencyHistogram::Merge(const CLatencyHistogram& other)
+{
+	for (uint32_t i = 0; i < k_unBucketCount; i++)
+		m_rgunBuckets[i].fetch_add(other.m_rgunBuckets[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+	uint64_t ulOtherMax = other.m_ulMaxUs.load(std::memory_order_relaxed);
+	uint64_t ulMax = m_ulMaxUs.load(std::memory_order_relaxed);
+	while (ulOtherMax > ulMax && !m_ulMaxUs.compare_exchange_weak(ulMax, ulOtherMax, std::memory_order_relaxed))
+	{
+	}
+}
+
+double CLatencyHistogram::GetBucketMidpointUs(uint32_t unBucket)
+{
+	if (unBucket < k_unLinearBuckets)
+		return unBucket + 0.5;
+
+	uint32_t unExponent = 4 + (unBucket - k_unLinearBuckets) / k_unSubBuckets;
+	uint32_t unSubBucket = (unBucket - k_unLinearBuckets) % k_unSubBuckets;
+	double flWidth = (double)(1ull << (unExponent - 3));
+	return (double)(1ull << unExponent) + (unSubBucket + 0.5) * flWidth;
+}
+
+LatencySummary_t CLatencyHistogram::Summarize() const
+{
+	uint32_t rgunCounts[k_unBucketCount];
+	uint64_t ulCount = 0;
+	for (uint32_t i = 0; i < k_unBucketCount; i++)
+	{
+		rgunCounts[i] = m_rgunBuckets[i].load(std::memory_order_relaxed);
+		ulCount += rgunCounts[i];
+	}
+
+	LatencySummary_t summary = {};
+	summary.ulCount = ulCount;
+	summary.flMaxUs = (double)m_ulMaxUs.load(std::memory_order_relaxed);
+	if (ulCount == 0)
+		return summary;
+
+	const double rgflQuantiles[3] = { 0.50, 0.95, 0.99 };
+	double* rgpflResults[3] = { &summary.flP50Us, &summary.flP95Us, &summary.flP99Us };
+
+	uint64_t ulSeen = 0;
+	uint32_t unQuantile = 0;
+	for (uint32_t i = 0; i < k_unBucketCount && unQuantile < 3; i++)
+	{
+		ulSeen += rgunCounts[i];
+		while (unQuantile < 3 && ulSeen >= (uint64_t)(rgflQuantiles[unQuantile] * ulCount + 0.5) && ulSeen > 0)
+		{
+			// a bucket midpoint can overshoot the largest sample seen
+			double flValue = GetBucketMidpointUs(i);
+			*rgpflResults[unQuantile++] = flValue < summary.flMaxUs ? flValue : summary.flMaxUs;
+		}
+	}
+
+	return summary;
+}
@@ -0,0 +1,141 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+// Purpose: Stages of the tracking pipeline that are timed. Durations of SDK
+// calls use the steady clock; the Exposure* stages are measured against the
+// ZED clock, from the image (or IMU sample) timestamp to the given point.
+// GrabCpu is thread CPU time rather than a duration.
+//-----------------------------------------------------------------------------
+enum ELatencyStage
+{
+	LatencyStage_ExposureToGrab = 0,	// image timestamp -> grab() returned
+	LatencyStage_Grab,					// duration of grab()
+	LatencyStage_GetPosition,			// duration of getPosition()
+	LatencyStage_GetSensorsData,		// duration of getSensorsData(), either thread
+	LatencyStage_ExposureToSubmit,		// sample timestamp -> TrackedDevicePoseUpdated
+	LatencyStage_GrabCpu,				// grab thread CPU time per processed frame, for frameCpuBudget
+	LatencyStage_ImuWake,				// IMU publisher woken up after its scheduled poll
+
+	LatencyStage_Count
+};
+
+extern const char* GetLatencyStageName(ELatencyStage eStage);
+
+struct LatencySummary_t
+{
+	uint64_t ulCount;
+	double flP50Us;
+	double flP95Us;
+	double flP99Us;
+	double flMaxUs;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Lock-free log-linear histogram of latencies. Below 16 us every
+// microsecond has its own bucket, above that each power of two is split into
+// 8 buckets, so percentiles are accurate to about 12%. Record() can be called
+// from any number of threads; Summarize() and Reset() are not synchronized
+// with it and may see a sample or two in flight.
+//-----------------------------------------------------------------------------
+class CLatencyHistogram
+{
+public:
+	CLatencyHistogram() { Reset(); }
+
+	void Record(uint64_t ulNanoseconds)
+	{
+		uint64_t ulMicroseconds = ulNanoseconds / 1000;
+		m_rgunBuckets[GetBucket(ulMicroseconds)].fetch_add(1, std::memory_order_relaxed);
+
+		uint64_t ulMax = m_ulMaxUs.load(std::memory_order_relaxed);
+		while (ulMicroseconds > ulMax && !m_ulMaxUs.compare_exchange_weak(ulMax, ulMicroseconds, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void Reset();
+	LatencySummary_t Summarize() const;
+
+	/** Adds other's samples to these, e.g. per-thread histograms once the threads are done */
+	void Merge(const CLatencyHistogram& other);
+
+private:
+	static const uint32_t k_unLinearBuckets = 16;
+	static const uint32_t k_unSubBuckets = 8;
+	static const uint32_t k_unBucketCount = 224;
+
+	static uint32_t GetBucket(uint64_t ulMicroseconds)
+	{
+		if (ulMicroseconds < k_unLinearBuckets)
+			return (uint32_t)ulMicroseconds;
+
+		uint32_t unExponent = 4;
+		while ((ulMicroseconds >> (unExponent + 1)) != 0)
+			unExponent++;
+		uint32_t unBucket = k_unLinearBuckets + (unExponent - 4) * k_unSubBuckets + (uint32_t)((ulMicroseconds >> (unExponent - 3)) & (k_unSubBuckets - 1));
+		return unBucket < k_unBucketCount ? unBucket : k_unBucketCount - 1;
+	}
+
+	static double GetBucketMidpointUs(uint32_t unBucket);
+
+	std::atomic<uint32_t> m_rgunBuckets[k_unBucketCount];
+	std::atomic<uint64_t> m_ulMaxUs;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Event counter with a rate averaged over roughly one second. Tick()
+// must only be called from one thread; the getters can be called from any.
+//-----------------------------------------------------------------------------
+class CRateCounter
+{
+public:
+	CRateCounter() : m_ulTotal(0), m_flRate(0.0), m_ulRateTimestampNs(0), m_ulWindowStartNs(0), m_unWindowCount(0) {}
+
+	void Tick(uint64_t ulNowNs)
+	{
+		m_ulTotal.store(m_ulTotal.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+		if (m_ulWindowStartNs == 0)
+			m_ulWindowStartNs = ulNowNs;
+		m_unWindowCount++;
+
+		uint64_t ulElapsedNs = ulNowNs - m_ulWindowStartNs;
+		if (ulElapsedNs >= k_ulWindowNs)
+		{
+			m_flRate.store(m_unWindowCount * 1e9 / ulElapsedNs, std::memory_order_relaxed);
+			m_ulRateTimestampNs.store(ulNowNs, std::memory_order_relaxed);
+			m_ulWindowStartNs = ulNowNs;
+			m_unWindowCount = 0;
+		}
+	}
+
+	uint64_t GetTotal() const { return m_ulTotal.load(std::memory_order_relaxed); }
+
+	/** Events per second over the last window, 0 once no event was seen for two windows */
+	double GetRate(uint64_t ulNowNs) const
+	{
+		uint64_t ulRateTimestampNs = m_ulRateTimestampNs.load(std::memory_order_relaxed);
+		if (ulRateTimestampNs == 0 || ulNowNs - ulRateTimestampNs > 2 * k_ulWindowNs)
+			return 0.0;
+		return m_flRate.load(std::memory_order_relaxed);
+	}
+
+private:
+	static const uint64_t k_ulWindowNs = 1000000000;
+
+	std::atomic<uint64_t> m_ulTotal;
+	std::atomic<double> m_flRate;
+	std::atomic<uint64_t> m_ulRateTimestampNs;
+
+	// owned by the ticking thread
+	uint64_t m_ulWindowStartNs;
+	uint32_t m_unWindowCount;
+};
+
+#endif // LATENCYSTATS_H
@@ -0,0 +1,335 @@
+#include "markertracker.h"
+#include "driverlog.h"
+#include "hmdmath.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#if defined(ZEDM_MARKERS)
+#include <opencv2/calib3d.hpp>
+#include <opencv2/objdetect/aruco_detector.hpp>
+#endif
+
+using namespace sl;
+using namespace vr;
+
+// a marker out of view keeps its last pose this long before it reports out of range
+static const uint64_t k_ulMarkerHoldNs = 500000000ull;
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<int> ParseMarkerIds(const std::string& sMarkerIds)
+{
+	std::vector<int> vecIds;
+	const char* pch = sMarkerIds.c_str();
+	while (*pch && vecIds.size() < (size_t)k_nMaxMarkers)
+	{
+		char* pchEnd;
+		long nId = strtol(pch, &pchEnd, 10);
+		if (pchEnd == pch)
+		{
+			pch++;
+			continue;
+		}
+		if (nId >= 0)
+			vecIds.push_back((int)nId);
+		pch = pchEnd;
+	}
+	return vecIds;
+}
+
+#if defined(ZEDM_MARKERS)
+struct CZedMarkerTracker::Detector_t
+{
+	cv::aruco::ArucoDetector detector;
+	std::vector<int> vecIds;
+	std::vector<std::vector<cv::Point2f>> vecCorners;
+};
+
+static bool FindDictionary(const std::string& sName, cv::aruco::PredefinedDictionaryType* peDictionary)
+{
+	static const struct
+	{
+		const char* pchName;
+		cv::aruco::PredefinedDictionaryType eDictionary;
+	} k_rgDictionaries[] = {
+		{ "aruco_4x4_50", cv::aruco::DICT_4X4_50 },
+		{ "aruco_5x5_100", cv::aruco::DICT_5X5_100 },
+		{ "aruco_6x6_250", cv::aruco::DICT_6X6_250 },
+		{ "apriltag_16h5", cv::aruco::DICT_APRILTAG_16h5 },
+		{ "apriltag_25h9", cv::aruco::DICT_APRILTAG_25h9 },
+		{ "apriltag_36h10", cv::aruco::DICT_APRILTAG_36h10 },
+		{ "apriltag_36h11", cv::aruco::DICT_APRILTAG_36h11 },
+	};
+	for (const auto& entry : k_rgDictionaries)
+	{
+		if (sName == entry.pchName)
+		{
+			*peDictionary = entry.eDictionary;
+			return true;
+		}
+	}
+	return false;
+}
+#else
+struct CZedMarkerTracker::Detector_t
+{
+};
+#endif
+
+CZedMarkerTracker::CZedMarkerTracker()
+	: m_pPool(nullptr)
+	, m_flMarkerSize(0.1)
+	, m_ulIntervalNs(0)
+	, m_ulNextDetectionNs(0)
+	, m_qCameraRotation(HmdQuaternion_Identity())
+	, m_ulImageTimestampNs(0)
+	, m_bJobInFlight(false)
+	, m_ulDetections(0)
+	, m_flDetectionMs(0.0f)
+{
+	memset(m_vecCameraPosition, 0, sizeof(m_vecCameraPosition));
+	memset(m_rgflIntrinsics, 0, sizeof(m_rgflIntrinsics));
+	for (int i = 0; i < k_nMaxMarkers; i++)
+	{
+		m_rgMarkers[i].ulLastSeenNs.store(0);
+		m_rgMarkers[i].bLostPublished = false;
+		m_rgunObjectIds[i].store(k_unTrackedDeviceIndexInvalid);
+	}
+}
+
+CZedMarkerTracker::~CZedMarkerTracker()
+{
+	Disable();
+}
+
+bool CZedMarkerTracker::Enable(Camera& zed, const ZedmSettings_t& settings, CWorkerPool* pPool)
+{
+	Disable();
+
+	m_vecIds = ParseMarkerIds(settings.sMarkerIds);
+	if (m_vecIds.empty() || !pPool || settings.flMarkerRate <= 0.0f)
+		return false;
+
+#if defined(ZEDM_MARKERS)
+	cv::aruco::PredefinedDictionaryType eDictionary;
+	if (!FindDictionary(settings.sMarkerDictionary, &eDictionary))
+	{
+		DriverLog("Markers: unknown markerDictionary %s\n", settings.sMarkerDictionary.c_str());
+		return false;
+	}
+	cv::aruco::DetectorParameters params;
+	params.cornerRefinementMethod = cv::aruco::CORNER_REFINE_SUBPIX; // the pose is only as good as the corners
+	m_pDetector.reset(new Detector_t{ cv::aruco::ArucoDetector(cv::aruco::getPredefinedDictionary(eDictionary), params), {}, {} });
+#else
+	DriverLog("Markers: built without OpenCV's ArUco module, markerIds ignored\n");
+	return false;
+#endif
+
+	// the images are rectified, the left camera has no distortion left
+	const CameraParameters& left = zed.getCameraInformation().camera_configuration.calibration_parameters.left_cam;
+	m_rgflIntrinsics[0] = left.fx;
+	m_rgflIntrinsics[1] = left.fy;
+	m_rgflIntrinsics[2] = left.cx;
+	m_rgflIntrinsics[3] = left.cy;
+
+	m_flMarkerSize = settings.flMarkerSize;
+	m_ulIntervalNs = (uint64_t)(1e9 / settings.flMarkerRate);
+	m_ulNextDetectionNs = 0;
+	for (int i = 0; i < k_nMaxMarkers; i++)
+	{
+		m_rgMarkers[i].velocity.Reset();
+		m_rgMarkers[i].history.Clear();
+		m_rgMarkers[i].ulLastSeenNs = 0;
+	}
+	m_pPool = pPool;
+	DriverLog("Markers: %u %s markers of %.3f m at %.0f Hz\n", (unsigned)m_vecIds.size(), settings.sMarkerDictionary.c_str(),
+		m_flMarkerSize, settings.flMarkerRate);
+	return true;
+}
+
+void CZedMarkerTracker::Disable()
+{
+	if (!m_pPool)
+		return;
+
+	{
+		std::unique_lock<std::mutex> lock(m_jobMutex);
+		m_jobDone.wait(lock, [this] { return !m_bJobInFlight; });
+	}
+	m_pPool = nullptr;
+	m_pDetector.reset();
+
+	// Publish reports them out of range from here on
+	for (int i = 0; i < k_nMaxMarkers; i++)
+		m_rgMarkers[i].ulLastSeenNs = 0;
+}
+
+void CZedMarkerTracker::SetPoseTemplate(const DriverPose_t& poseTemplate)
+{
+	// markers are tracked in driver space directly; the head offset is the camera's
+	DriverPose_t markerTemplate = poseTemplate;
+	markerTemplate.qDriverFromHeadRotation = HmdQuaternion_Identity();
+	for (int i = 0; i < 3; i++)
+		markerTemplate.vecDriverFromHeadTranslation[i] = 0.0;
+	m_poseTemplate.Write(markerTemplate);
+}
+
+void CZedMarkerTracker::Update(Camera& zed, const double vecCameraPosition[3], const HmdQuaternion_t& qCameraRotation, uint64_t ulImageTimestampNs)
+{
+	if (!m_pPool)
+		return;
+
+	uint64_t ulNowNs = GetSteadyNanoseconds();
+	if (ulNowNs < m_ulNextDetectionNs)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		if (m_bJobInFlight)
+			return;
+	}
+
+	// grayscale conversion on the GPU, one byte per pixel comes down
+	if (zed.retrieveImage(m_image, VIEW::LEFT_GRAY, MEM::CPU) != ERROR_CODE::SUCCESS)
+		return;
+	for (int i = 0; i < 3; i++)
+		m_vecCameraPosition[i] = vecCameraPosition[i];
+	m_qCameraRotation = qCameraRotation;
+	m_ulImageTimestampNs = ulImageTimestampNs;
+	m_ulNextDetectionNs = ulNowNs + m_ulIntervalNs;
+
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_bJobInFlight = true;
+	}
+	m_pPool->Submit(WorkPriority_Normal, [this] {
+		Detect();
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_bJobInFlight = false;
+		m_jobDone.notify_all();
+	});
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The detection job: the pose of every configured marker in the
+// image, in ZED world space, into its history
+//-----------------------------------------------------------------------------
+void CZedMarkerTracker::Detect()
+{
+#if defined(ZEDM_MARKERS)
+	uint64_t ulStartNs = GetSteadyNanoseconds();
+	cv::Mat image((int)m_image.getHeight(), (int)m_image.getWidth(), CV_8UC1, m_image.getPtr<sl::uchar1>(MEM::CPU), m_image.getStepBytes(MEM::CPU));
+	Detector_t& detector = *m_pDetector;
+	detector.detector.detectMarkers(image, detector.vecCorners, detector.vecIds);
+
+	const double flHalf = 0.5 * m_flMarkerSize;
+	const std::vector<cv::Point3f> vecObjectPoints = {
+		cv::Point3f((float)-flHalf, (float)flHalf, 0.0f), cv::Point3f((float)flHalf, (float)flHalf, 0.0f),
+		cv::Point3f((float)flHalf, (float)-flHalf, 0.0f), cv::Point3f((float)-flHalf, (float)-flHalf, 0.0f)
+	};
+	const cv::Matx33d cameraMatrix(m_rgflIntrinsics[0], 0.0, m_rgflIntrinsics[2], 0.0, m_rgflIntrinsics[1], m_rgflIntrinsics[3], 0.0, 0.0, 1.0);
+
+	// OpenCV's camera looks down +z with y down, the SDK's down -z with y up: a half turn about x.
+	// The marker keeps OpenCV's axes, x right and y up on the print, z out of its face.
+	const HmdQuaternion_t qFlip = HmdQuaternion_Init(0.0, 1.0, 0.0, 0.0);
+
+	for (size_t i = 0; i < detector.vecIds.size(); i++)
+	{
+		int nMarker = -1;
+		for (size_t j = 0; j < m_vecIds.size(); j++)
+		{
+			if (m_vecIds[j] == detector.vecIds[i])
+				nMarker = (int)j;
+		}
+		if (nMarker < 0)
+			continue;
+
+		cv::Vec3d rvec, tvec;
+		if (!cv::solvePnP(vecObjectPoints, detector.vecCorners[i], cameraMatrix, cv::noArray(), rvec, tvec, false, cv::SOLVEPNP_IPPE_SQUARE))
+			continue;
+
+		double vecRotation[3] = { rvec[0], rvec[1], rvec[2] };
+		HmdQuaternion_t qMarkerInCamera = HmdQuaternion_Multiply(qFlip, HmdQuaternion_FromRotationVector(vecRotation));
+		double vecMarkerInCamera[3] = { tvec[0], -tvec[1], -tvec[2] };
+
+		PoseHistorySample_t sample;
+		sample.ulTimestampNs = m_ulImageTimestampNs;
+		HmdQuaternion_RotateVector(m_qCameraRotation, vecMarkerInCamera, sample.vecPosition);
+		for (int j = 0; j < 3; j++)
+			sample.vecPosition[j] += m_vecCameraPosition[j];
+		sample.qRotation = HmdQuaternion_Normalize(HmdQuaternion_Multiply(m_qCameraRotation, qMarkerInCamera));
+
+		Marker_t& marker = m_rgMarkers[nMarker];
+		PoseHistorySample_t previous;
+		if (marker.history.GetLatest(&previous) && previous.ulTimestampNs >= sample.ulTimestampNs)
+			continue;
+		marker.velocity.AddSample(sample.vecPosition, sample.qRotation, sample.ulTimestampNs);
+		for (int j = 0; j < 3; j++)
+		{
+			sample.vecVelocity[j] = marker.velocity.GetVelocity()[j];
+			sample.vecAngularVelocity[j] = marker.velocity.GetAngularVelocity()[j];
+		}
+		marker.history.Write(sample);
+		marker.ulLastSeenNs = sample.ulTimestampNs;
+	}
+
+	m_ulDetections++;
+	m_flDetectionMs = (GetSteadyNanoseconds() - ulStartNs) * 1e-6f;
+#endif
+}
+
+void CZedMarkerTracker::Publish(uint64_t ulNowNs)
+{
+	DriverPose_t poseTemplate;
+	if (m_poseTemplate.Read(&poseTemplate) == 0)
+		return;
+
+	for (int i = 0; i < k_nMaxMarkers; i++)
+	{
+		Marker_t& marker = m_rgMarkers[i];
+		uint64_t ulLastSeenNs = marker.ulLastSeenNs.load();
+		DriverPose_t pose = poseTemplate;
+
+		// between detections and a little past the last one the history has the pose; held after that
+		PoseHistorySample_t sample;
+		bool bHeld = ulLastSeenNs != 0 && ulNowNs < ulLastSeenNs + k_ulMarkerHoldNs;
+		bool bQueried = bHeld && marker.history.Query(ulNowNs, &sample);
+		bool bValid = bQueried || (bHeld && marker.history.GetLatest(&sample));
+		if (bValid)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				pose.vecPosition[j] = sample.vecPosition[j];
+				pose.vecVelocity[j] = bQueried ? sample.vecVelocity[j] : 0.0;
+				pose.vecAngularVelocity[j] = bQueried ? sample.vecAngularVelocity[j] : 0.0;
+			}
+			pose.qRotation = sample.qRotation;
+			pose.poseIsValid = true;
+			pose.result = TrackingResult_Running_OK;
+			marker.bLostPublished = false;
+		}
+		else
+		{
+			pose.poseIsValid = false;
+			pose.result = ulLastSeenNs == 0 ? TrackingResult_Calibrating_InProgress : TrackingResult_Running_OutOfRange;
+		}
+		m_rgPoses[i].Write(pose);
+
+		TrackedDeviceIndex_t unObjectId = m_rgunObjectIds[i].load();
+		if (unObjectId == k_unTrackedDeviceIndexInvalid || (!bValid && marker.bLostPublished))
+			continue;
+		marker.bLostPublished = !bValid;
+		VRServerDriverHost()->TrackedDevicePoseUpdated(unObjectId, pose, sizeof(DriverPose_t));
+	}
+}
+
+void CZedMarkerTracker::ReadPose(int nMarker, DriverPose_t* pPose) const
+{
+	if (nMarker < 0 || nMarker >= k_nMaxMarkers || m_rgPoses[nMarker].Read(pPose) == 0)
+		*pPose = DriverPose_Uninitialized();
+}
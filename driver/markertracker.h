@@ -0,0 +1,121 @@
+#ifndef MARKERTRACKER_H
+#define MARKERTRACKER_H
+
+#pragma once
+
+#include <openvr_driver.h>
+#include <sl/Camera.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "driversettings.h"
+#include "poseestimator.h"
+#include "posehistory.h"
+#include "seqlock.h"
+#include "workerpool.h"
+
+// markerIds beyond this many are ignored
+static const int k_nMaxMarkers = 16;
+
+/** The marker ids of a markerIds list ("0,3,7"), at most k_nMaxMarkers */
+extern std::vector<int> ParseMarkerIds(const std::string& sMarkerIds);
+
+//-----------------------------------------------------------------------------
+// Purpose: Printed ArUco or AprilTag markers on props, published as virtual
+// trackers, one per id in markerIds.
+//
+// Detection runs at markerRate on the worker pool, one frame in flight at a
+// time. The grab thread only has the SDK convert the left image to grayscale
+// on the GPU and hands over that one 8-bit plane along with the camera's
+// pose at the image; the job finds the markers in it (OpenCV's ArUco
+// detector, ZEDM_MARKERS builds), solves each one's pose from its corners
+// and the rectified intrinsics, and writes it in ZED world (driver) space
+// into the marker's CPoseHistory, with velocities from the detections.
+//
+// Publish runs at the driver's frame rate and queries every history at the
+// current ZED time, so the trackers move smoothly between detections, and
+// keeps the last pose for a moment when a marker drops out of view.
+//-----------------------------------------------------------------------------
+class CZedMarkerTracker
+{
+public:
+	CZedMarkerTracker();
+	~CZedMarkerTracker();
+
+	/** Grab thread: starts detecting on the camera that was just opened; false if there is nothing to detect */
+	bool Enable(sl::Camera& zed, const ZedmSettings_t& settings, CWorkerPool* pPool);
+
+	/** Grab thread: waits for a detection in flight; the trackers report out of range */
+	void Disable();
+
+	bool IsEnabled() const { return m_pPool != nullptr; }
+
+	/** Grab thread: the world-from-driver transform the poses are published with */
+	void SetPoseTemplate(const vr::DriverPose_t& poseTemplate);
+
+	/** Grab thread, after a tracked grab: starts a detection on this image when one is due.
+	* The camera pose is the left camera's in ZED world space at the image. */
+	void Update(sl::Camera& zed, const double vecCameraPosition[3], const vr::HmdQuaternion_t& qCameraRotation, uint64_t ulImageTimestampNs);
+
+	/** Any thread but one at a time: submits every marker's pose at ulNowNs on the ZED clock */
+	void Publish(uint64_t ulNowNs);
+
+	/** Index of markerIds the device at nMarker shows */
+	void SetObjectId(int nMarker, vr::TrackedDeviceIndex_t unObjectId) { m_rgunObjectIds[nMarker].store(unObjectId); }
+
+	/** Any thread: the marker's latest published pose, invalid before the first detection */
+	void ReadPose(int nMarker, vr::DriverPose_t* pPose) const;
+
+	/** Detections finished, and the time (ms) the last one took on the worker */
+	uint64_t GetDetectionCount() const { return m_ulDetections.load(); }
+	float GetDetectionMs() const { return m_flDetectionMs.load(); }
+
+private:
+	CZedMarkerTracker(const CZedMarkerTracker&) = delete;
+	CZedMarkerTracker& operator=(const CZedMarkerTracker&) = delete;
+
+	struct Detector_t; // OpenCV's state, ZEDM_MARKERS builds
+
+	struct Marker_t
+	{
+		CPoseHistory history; // written by the detection job
+		CPoseVelocityEstimator velocity; // the job's
+		std::atomic<uint64_t> ulLastSeenNs; // ZED clock, 0 before the first detection
+		bool bLostPublished; // Publish's
+	};
+
+	void Detect();
+
+	CWorkerPool* m_pPool;
+	std::unique_ptr<Detector_t> m_pDetector;
+	std::vector<int> m_vecIds;
+	double m_flMarkerSize; // m, edge of the black square
+	uint64_t m_ulIntervalNs;
+	uint64_t m_ulNextDetectionNs; // grab thread's
+
+	// what the job works on, the grab thread's again once it is done
+	sl::Mat m_image; // LEFT_GRAY on the CPU
+	double m_vecCameraPosition[3];
+	vr::HmdQuaternion_t m_qCameraRotation;
+	uint64_t m_ulImageTimestampNs;
+	double m_rgflIntrinsics[4]; // fx, fy, cx, cy of the rectified left camera
+
+	std::mutex m_jobMutex;
+	std::condition_variable m_jobDone;
+	bool m_bJobInFlight;
+
+	Marker_t m_rgMarkers[k_nMaxMarkers];
+	CSeqLock<vr::DriverPose_t> m_poseTemplate;
+	CSeqLock<vr::DriverPose_t> m_rgPoses[k_nMaxMarkers];
+	std::atomic<vr::TrackedDeviceIndex_t> m_rgunObjectIds[k_nMaxMarkers];
+	std::atomic<uint64_t> m_ulDetections;
+	std::atomic<float> m_flDetectionMs;
+};
+
+#endif // MARKERTRACKER_H
@@ -0,0 +1,366 @@
+#include "memorybudget.h"
+#include "cameraprofile.h"
+#include "driverlog.h"
+#include "gpupassthrough.h"
+#include "markertracker.h"
+#include "mrcapture.h"
+#include "occlusiondepth.h"
+#include "posehistory.h"
+
+#include <sl/Camera.hpp>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace sl;
+
+static const double k_flBytesPerMb = 1024.0 * 1024.0;
+
+// the SDK with the camera open and tracking, before any image: its CUDA
+// context, kernels and the tracking's state
+static const double k_flSdkHostMb = 200.0;
+static const double k_flSdkGpuMb = 350.0;
+static const int k_nSdkGpuImages = 6; // BGRA: raw, rectified and retrieved, of both eyes
+static const int k_nUsbFrames = 4; // side by side YUV 4:2:2 frames queued by the capture
+
+// the depth mode's own buffers, whether or not a map is retrieved
+static const double k_flDepthPerformanceGpuMb = 100.0;
+static const double k_flDepthQualityGpuMb = 200.0;
+static const double k_flDepthUltraGpuMb = 300.0;
+static const double k_flDepthOtherGpuMb = 500.0; // the learned modes of later SDKs
+static const int k_nDepthMapBytes = 8; // depth and confidence per pixel
+
+static const double k_flAreaMemoryHostMb = 150.0;
+static const double k_flAreaMemoryGpuMb = 50.0;
+
+// at the SDK's default 5 cm chunks; the mesh grows with the square of the resolution
+static const double k_flSpatialMappingHostMb = 200.0;
+static const double k_flSpatialMappingGpuMb = 300.0;
+static const float k_flDefaultSpatialMappingResolution = 0.05f;
+static const float k_flMaxSpatialMappingResolution = 0.2f;
+
+static const double k_flBodyHostMb = 150.0;
+static const double k_flBodyGpuMb = 700.0;
+static const double k_flObjectHostMb = 100.0;
+static const double k_flObjectGpuMb = 500.0;
+static const double k_flMarkerHostMb = 10.0; // the detector, besides its gray images
+
+static const double k_flSvoEncoderHostMb = 100.0;
+static const double k_flSvoEncoderGpuMb = 150.0; // the hardware encoder's session and surfaces
+static const double k_flPoseRecordingHostMb = 0.5;
+
+static const int k_nMaxOcclusionDepthDivisor = 8; // COcclusionDepth's
+
+static const char* const k_rgpchItemNames[MemoryItem_Count] =
+{
+	"camera",
+	"depth",
+	"area_memory",
+	"spatial_mapping",
+	"detection",
+	"textures",
+	"recording",
+	"pose_history",
+};
+
+static const char* const k_rgpchTrimNames[MemoryTrim_Count] =
+{
+	"texture_buffers",
+	"occlusion_resolution",
+	"spatial_mapping_resolution",
+	"svo_recording",
+	"camera_profile",
+	"area_memory",
+	"spatial_mapping",
+};
+
+const char* GetMemoryItemName(EMemoryItem eItem)
+{
+	return k_rgpchItemNames[eItem];
+}
+
+const char* GetMemoryTrimName(int nBit)
+{
+	return k_rgpchTrimNames[nBit];
+}
+
+// zedtracker.cpp's: the features that use a depth map from every grab
+static bool NeedsDepthPerGrab(const ZedmSettings_t& settings)
+{
+	return !settings.bTrackingOnly || settings.bSpatialMapping || settings.bBodyTracking || settings.nObjectTrackers > 0 || settings.bMrCapture
+		|| settings.bOcclusionDepth;
+}
+
+// the most demanding profile the camera may run
+static ECameraProfile GetWorstCameraProfile(const ZedmSettings_t& settings)
+{
+	if (settings.nCameraProfileCeiling >= 0 && settings.nCameraProfileCeiling < CameraProfile_Count)
+		return (ECameraProfile)settings.nCameraProfileCeiling;
+	return CameraProfile_HighAccuracy;
+}
+
+static double GetDepthModeGpuMb(DEPTH_MODE eMode)
+{
+	switch (eMode)
+	{
+	case DEPTH_MODE::PERFORMANCE:
+		return k_flDepthPerformanceGpuMb;
+	case DEPTH_MODE::QUALITY:
+		return k_flDepthQualityGpuMb;
+	case DEPTH_MODE::ULTRA:
+		return k_flDepthUltraGpuMb;
+	default:
+		return k_flDepthOtherGpuMb;
+	}
+}
+
+static double GetSpatialMappingScale(float flResolution)
+{
+	if (flResolution <= 0.0f)
+		flResolution = k_flDefaultSpatialMappingResolution;
+	double flScale = k_flDefaultSpatialMappingResolution / flResolution;
+	return flScale * flScale;
+}
+
+void EstimateMemoryFootprint(const ZedmSettings_t& settings, MemoryFootprint_t* pFootprint)
+{
+	memset(pFootprint, 0, sizeof(*pFootprint));
+	double* rgflHost = pFootprint->rgflHostMb;
+	double* rgflGpu = pFootprint->rgflGpuMb;
+
+	const CameraProfile_t& profile = GetCameraProfile(GetWorstCameraProfile(settings));
+	Resolution resolution = getResolution(profile.eResolution);
+	double flPixels = (double)resolution.width * resolution.height;
+
+	rgflHost[MemoryItem_Camera] = k_flSdkHostMb + k_nUsbFrames * 2.0 * flPixels * 2.0 / k_flBytesPerMb;
+	rgflGpu[MemoryItem_Camera] = k_flSdkGpuMb + k_nSdkGpuImages * flPixels * 4.0 / k_flBytesPerMb;
+
+	rgflGpu[MemoryItem_Depth] = GetDepthModeGpuMb(profile.eDepthMode);
+	if (NeedsDepthPerGrab(settings))
+		rgflGpu[MemoryItem_Depth] += flPixels * k_nDepthMapBytes / k_flBytesPerMb;
+
+	if (settings.bAllowAreaMemory && (profile.bAreaMemory || !settings.sAreaFilePath.empty()))
+	{
+		rgflHost[MemoryItem_AreaMemory] = k_flAreaMemoryHostMb;
+		rgflGpu[MemoryItem_AreaMemory] = k_flAreaMemoryGpuMb;
+	}
+
+	if (settings.bSpatialMapping)
+	{
+		double flScale = GetSpatialMappingScale(settings.flSpatialMappingResolution);
+		rgflHost[MemoryItem_SpatialMapping] = k_flSpatialMappingHostMb * flScale;
+		rgflGpu[MemoryItem_SpatialMapping] = k_flSpatialMappingGpuMb * flScale;
+	}
+
+	if (settings.bBodyTracking)
+	{
+		rgflHost[MemoryItem_Detection] += k_flBodyHostMb;
+		rgflGpu[MemoryItem_Detection] += k_flBodyGpuMb;
+	}
+	if (settings.nObjectTrackers > 0)
+	{
+		rgflHost[MemoryItem_Detection] += k_flObjectHostMb;
+		rgflGpu[MemoryItem_Detection] += k_flObjectGpuMb;
+	}
+	std::vector<int> vecMarkerIds = ParseMarkerIds(settings.sMarkerIds);
+	if (!vecMarkerIds.empty())
+		rgflHost[MemoryItem_Detection] += k_flMarkerHostMb + 2.0 * flPixels / k_flBytesPerMb;
+
+	if (settings.bGpuPassthrough)
+	{
+		int nBuffers = std::min(std::max(settings.nPassthroughBuffers, 2), k_nMaxPassthroughBuffers);
+		rgflGpu[MemoryItem_Textures] += nBuffers * 2.0 * flPixels * 4.0 / k_flBytesPerMb;
+	}
+	if (settings.bMrCapture)
+	{
+		int nBuffers = std::min(std::max(settings.nMrCaptureBuffers, 2), k_nMaxMrCaptureBuffers);
+		rgflGpu[MemoryItem_Textures] += nBuffers * flPixels * (4.0 + 4.0) / k_flBytesPerMb;
+	}
+	if (settings.bOcclusionDepth)
+	{
+		int nDivisor = std::min(std::max(settings.nOcclusionDepthDivisor, 1), k_nMaxOcclusionDepthDivisor);
+		rgflGpu[MemoryItem_Textures] += (k_nOcclusionDepthBuffers + 1) * flPixels / (nDivisor * nDivisor) * 4.0 / k_flBytesPerMb;
+	}
+
+	if (!settings.sSvoRecordPath.empty())
+	{
+		rgflHost[MemoryItem_Recording] += k_flSvoEncoderHostMb;
+		rgflGpu[MemoryItem_Recording] += k_flSvoEncoderGpuMb;
+	}
+	if (!settings.sPoseRecordingPath.empty())
+		rgflHost[MemoryItem_Recording] += k_flPoseRecordingHostMb;
+
+	// the tracker's and one per marker
+	rgflHost[MemoryItem_PoseHistory] = (1 + vecMarkerIds.size()) * sizeof(CPoseHistory) / k_flBytesPerMb;
+
+	for (int i = 0; i < MemoryItem_Count; i++)
+	{
+		pFootprint->flHostMb += rgflHost[i];
+		pFootprint->flGpuMb += rgflGpu[i];
+	}
+}
+
+// how far the estimate is over the budget, both added up
+static double GetOverBudgetMb(const ZedmSettings_t& settings, const MemoryFootprint_t& footprint)
+{
+	double flOver = 0.0;
+	if (settings.nMemoryBudgetHost > 0)
+		flOver += std::max(0.0, footprint.flHostMb - settings.nMemoryBudgetHost);
+	if (settings.nMemoryBudgetGpu > 0)
+		flOver += std::max(0.0, footprint.flGpuMb - settings.nMemoryBudgetGpu);
+	return flOver;
+}
+
+// one step of a trim; false when it has nothing left to give
+static bool TrimOnce(EMemoryTrim eTrim, ZedmSettings_t* pSettings)
+{
+	switch (eTrim)
+	{
+	case MemoryTrim_TextureBuffers:
+		if ((!pSettings->bGpuPassthrough || pSettings->nPassthroughBuffers <= 2) && (!pSettings->bMrCapture || pSettings->nMrCaptureBuffers <= 2))
+			return false;
+		pSettings->nPassthroughBuffers = std::min(pSettings->nPassthroughBuffers, 2);
+		pSettings->nMrCaptureBuffers = std::min(pSettings->nMrCaptureBuffers, 2);
+		return true;
+	case MemoryTrim_OcclusionResolution:
+		if (!pSettings->bOcclusionDepth || pSettings->nOcclusionDepthDivisor >= k_nMaxOcclusionDepthDivisor)
+			return false;
+		pSettings->nOcclusionDepthDivisor = std::min(std::max(pSettings->nOcclusionDepthDivisor, 1) * 2, k_nMaxOcclusionDepthDivisor);
+		return true;
+	case MemoryTrim_SpatialMappingResolution:
+	{
+		float flResolution = pSettings->flSpatialMappingResolution > 0.0f ? pSettings->flSpatialMappingResolution : k_flDefaultSpatialMappingResolution;
+		if (!pSettings->bSpatialMapping || flResolution >= k_flMaxSpatialMappingResolution)
+			return false;
+		pSettings->flSpatialMappingResolution = std::min(flResolution * 2.0f, k_flMaxSpatialMappingResolution);
+		return true;
+	}
+	case MemoryTrim_SvoRecording:
+		if (pSettings->sSvoRecordPath.empty())
+			return false;
+		pSettings->sSvoRecordPath.clear();
+		return true;
+	case MemoryTrim_CameraProfile:
+	{
+		ECameraProfile eProfile = GetWorstCameraProfile(*pSettings);
+		if (eProfile == CameraProfile_LowLatency)
+			return false;
+		pSettings->nCameraProfileCeiling = eProfile - 1;
+		return true;
+	}
+	case MemoryTrim_AreaMemory:
+		if (!pSettings->bAllowAreaMemory)
+			return false;
+		pSettings->bAllowAreaMemory = false;
+		pSettings->sAreaFilePath.clear();
+		return true;
+	case MemoryTrim_SpatialMapping:
+		if (!pSettings->bSpatialMapping)
+			return false;
+		pSettings->bSpatialMapping = false;
+		return true;
+	default:
+		return false;
+	}
+}
+
+void ApplyMemoryBudget(ZedmSettings_t* pSettings, MemoryBudget_t* pBudget)
+{
+	EstimateMemoryFootprint(*pSettings, &pBudget->requested);
+	pBudget->estimate = pBudget->requested;
+	pBudget->unTrims = 0;
+	pBudget->bCapped = (pSettings->nMemoryBudgetHost > 0 || pSettings->nMemoryBudgetGpu > 0) && pSettings->nRemotePort == 0 && pSettings->sGrabberPath.empty();
+	pBudget->bFits = true;
+	if (!pBudget->bCapped)
+		return;
+
+	double flOver = GetOverBudgetMb(*pSettings, pBudget->estimate);
+	for (int nBit = 0; nBit < MemoryTrim_Count && flOver > 0.0; nBit++)
+	{
+		EMemoryTrim eTrim = (EMemoryTrim)(1 << nBit);
+		for (;;)
+		{
+			ZedmSettings_t trial = *pSettings;
+			if (!TrimOnce(eTrim, &trial))
+				break;
+			MemoryFootprint_t footprint;
+			EstimateMemoryFootprint(trial, &footprint);
+			double flTrialOver = GetOverBudgetMb(trial, footprint);
+			if (flTrialOver >= flOver)
+				break;
+
+			*pSettings = trial;
+			pBudget->estimate = footprint;
+			pBudget->unTrims |= eTrim;
+			flOver = flTrialOver;
+			if (flOver <= 0.0)
+				break;
+		}
+	}
+	pBudget->bFits = flOver <= 0.0;
+}
+
+void LogMemoryBudget(unsigned int unCameraSerial, const MemoryBudget_t& budget)
+{
+	if (!budget.bCapped)
+		return;
+
+	DriverLog("ZED %u: memory estimate %.0f MB host, %.0f MB GPU, trimmed to %.0f MB host, %.0f MB GPU\n", unCameraSerial,
+		budget.requested.flHostMb, budget.requested.flGpuMb, budget.estimate.flHostMb, budget.estimate.flGpuMb);
+	for (int i = 0; i < MemoryTrim_Count; i++)
+	{
+		if (budget.unTrims & (1u << i))
+			DriverLog("ZED %u: memory budget: %s trimmed\n", unCameraSerial, GetMemoryTrimName(i));
+	}
+	if (!budget.bFits)
+		DriverLog("ZED %u: over the memory budget with everything trimmed that can be\n", unCameraSerial);
+}
+
+bool GetProcessMemoryMb(double* pflMb)
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return false;
+	*pflMb = counters.WorkingSetSize / k_flBytesPerMb;
+	return true;
+#else
+	FILE* pFile = fopen("/proc/self/statm", "r");
+	if (!pFile)
+		return false;
+	unsigned long ulSize = 0;
+	unsigned long ulResident = 0;
+	bool bOk = fscanf(pFile, "%lu %lu", &ulSize, &ulResident) == 2;
+	fclose(pFile);
+	if (!bOk)
+		return false;
+	*pflMb = (double)ulResident * sysconf(_SC_PAGESIZE) / k_flBytesPerMb;
+	return true;
+#endif
+}
+
+bool GetGpuMemoryMb(CUcontext cuContext, double* pflUsedMb, double* pflTotalMb)
+{
+	if (!cuContext || cuCtxPushCurrent(cuContext) != CUDA_SUCCESS)
+		return false;
+	size_t unFree = 0;
+	size_t unTotal = 0;
+	bool bOk = cuMemGetInfo(&unFree, &unTotal) == CUDA_SUCCESS;
+	CUcontext cuPopped;
+	cuCtxPopCurrent(&cuPopped);
+	if (!bOk)
+		return false;
+	*pflUsedMb = (unTotal - unFree) / k_flBytesPerMb;
+	*pflTotalMb = unTotal / k_flBytesPerMb;
+	return true;
+}
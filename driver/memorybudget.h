@@ -0,0 +1,104 @@
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#pragma once
+
+#include <cuda.h>
+
+#include <cstdint>
+
+#include "driversettings.h"
+
+enum EMemoryItem
+{
+	MemoryItem_Camera, // the SDK's CUDA context and tracking, the images
+	MemoryItem_Depth,
+	MemoryItem_AreaMemory,
+	MemoryItem_SpatialMapping,
+	MemoryItem_Detection, // body, object and marker detection
+	MemoryItem_Textures, // passthrough, MR capture and occlusion depth rings
+	MemoryItem_Recording, // SVO encoder and the pose recording ring
+	MemoryItem_PoseHistory,
+	MemoryItem_Count,
+};
+
+/** Short name for the stats, e.g. "spatial_mapping" */
+extern const char* GetMemoryItemName(EMemoryItem eItem);
+
+//-----------------------------------------------------------------------------
+// Purpose: Estimated memory of one camera's features, MB
+//-----------------------------------------------------------------------------
+struct MemoryFootprint_t
+{
+	double rgflHostMb[MemoryItem_Count];
+	double rgflGpuMb[MemoryItem_Count];
+	double flHostMb;
+	double flGpuMb;
+};
+
+// what ApplyMemoryBudget gave up, bits in the order they're tried
+enum EMemoryTrim
+{
+	MemoryTrim_TextureBuffers = 1 << 0, // passthrough and MR capture rings down to two
+	MemoryTrim_OcclusionResolution = 1 << 1, // occlusionDepthDivisor raised
+	MemoryTrim_SpatialMappingResolution = 1 << 2, // coarser chunks
+	MemoryTrim_SvoRecording = 1 << 3, // svoRecordPath cleared, recording refused
+	MemoryTrim_CameraProfile = 1 << 4, // lower camera profile ceiling
+	MemoryTrim_AreaMemory = 1 << 5, // no area memory, areaFilePath ignored
+	MemoryTrim_SpatialMapping = 1 << 6,
+	MemoryTrim_Count = 7,
+};
+
+/** Short name of one bit of EMemoryTrim for the stats and the log, e.g. "area_memory" */
+extern const char* GetMemoryTrimName(int nBit);
+
+//-----------------------------------------------------------------------------
+// Purpose: The outcome of memoryBudgetHost and memoryBudgetGpu for a camera
+//-----------------------------------------------------------------------------
+struct MemoryBudget_t
+{
+	bool bCapped; // a budget is set and the camera runs in this process
+	MemoryFootprint_t requested; // as configured
+	MemoryFootprint_t estimate; // after the trims
+	uint32_t unTrims; // EMemoryTrim bits
+	bool bFits; // false when everything that can go went and it is still over
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: memoryBudgetHost, memoryBudgetGpu: a deterministic ceiling on
+// what one camera's features may take of system and GPU memory, for 8 GB
+// GPUs where the SDK and the game already run close to the limit.
+//
+// The footprint is a static model of each feature from the settings, not a
+// measurement: what the SDK allocates comes out of the resolution, depth
+// mode and enabled modules, so the same settings always give the same
+// figures and the trims are the same on every start. Its constants are on
+// the high side. The camera profile counted is the most demanding the
+// camera may switch to, its ceiling or high_accuracy, since
+// DebugRequest("profile") and cameraProfile "auto" may pick it later.
+//
+// While the estimate is over, the trims of EMemoryTrim are applied in their
+// order, each one only while it lowers the part that is over: the cheapest
+// to the experience first, the features the user asked for last. Body,
+// object and marker tracking aren't trimmed, their devices are registered.
+// The pose history and the pose recording ring are fixed and small, they
+// are counted but not trimmed.
+//
+// The stats report the estimate next to the process's resident memory and
+// the GPU's memory in use, which includes the game's.
+//-----------------------------------------------------------------------------
+extern void EstimateMemoryFootprint(const ZedmSettings_t& settings, MemoryFootprint_t* pFootprint);
+
+/** Trims pSettings to the budget; does nothing but estimate without one, or in receiver and grabber modes */
+extern void ApplyMemoryBudget(ZedmSettings_t* pSettings, MemoryBudget_t* pBudget);
+
+/** The trims applied, one line each */
+extern void LogMemoryBudget(unsigned int unCameraSerial, const MemoryBudget_t& budget);
+
+/** Resident memory of this process, MB; false if unknown */
+extern bool GetProcessMemoryMb(double* pflMb);
+
+/** Memory in use on cuContext's device, everyone's, and its total, MB; any thread */
+extern bool GetGpuMemoryMb(CUcontext cuContext, double* pflUsedMb, double* pflTotalMb);
+
+#endif // MEMORYBUDGET_H
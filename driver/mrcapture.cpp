@@ -0,0 +1,295 @@
+#include "mrcapture.h"
+#include "driverlog.h"
+#include "gpupassthrough.h"
+#include "tracezones.h"
+
+#include <algorithm>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <d3d11.h>
+#include <dxgi.h>
+#include <cudaD3D11.h>
+#endif
+
+using namespace sl;
+
+std::string GetMrCaptureName(unsigned int unCameraSerial)
+{
+	return "zedm_mr_" + std::to_string(unCameraSerial);
+}
+
+CMrCaptureExport::CMrCaptureExport()
+	: m_pDevice(nullptr)
+	, m_cuContext(nullptr)
+	, m_cuCopyStart(nullptr)
+	, m_cuCopyEnd(nullptr)
+	, m_ulGpuNs(0)
+	, m_pMappingHandle(nullptr)
+	, m_pHeader(nullptr)
+	, m_ulFrameCount(0)
+	, m_nLatestBuffer(-1)
+{
+	memset(m_rgpColorTextures, 0, sizeof(m_rgpColorTextures));
+	memset(m_rgpDepthTextures, 0, sizeof(m_rgpDepthTextures));
+	memset(m_rgColorResources, 0, sizeof(m_rgColorResources));
+	memset(m_rgDepthResources, 0, sizeof(m_rgDepthResources));
+}
+
+CMrCaptureExport::~CMrCaptureExport()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+bool CMrCaptureExport::Open(Camera& zed, int nBuffers)
+{
+	Close();
+
+	nBuffers = std::min(std::max(nBuffers, 2), k_nMaxMrCaptureBuffers);
+	CameraInformation info = zed.getCameraInformation();
+	uint32_t unWidth = (uint32_t)info.camera_configuration.resolution.width;
+	uint32_t unHeight = (uint32_t)info.camera_configuration.resolution.height;
+	std::string sName = GetMrCaptureName(info.serial_number);
+
+	CUdevice cuDevice;
+	m_cuContext = zed.getCUDAContext();
+	if (!m_cuContext || cuCtxPushCurrent(m_cuContext) != CUDA_SUCCESS)
+	{
+		DriverLog("MR capture: no CUDA context\n");
+		m_cuContext = nullptr;
+		return false;
+	}
+	bool bOk = cuCtxGetDevice(&cuDevice) == CUDA_SUCCESS && (m_pDevice = CreateD3D11DeviceForCuda(cuDevice)) != nullptr;
+	if (!bOk)
+		DriverLog("MR capture: no D3D11 device on the ZED SDK's GPU\n");
+
+	if (bOk && (cuEventCreate(&m_cuCopyStart, CU_EVENT_DEFAULT) != CUDA_SUCCESS || cuEventCreate(&m_cuCopyEnd, CU_EVENT_DEFAULT) != CUDA_SUCCESS))
+	{
+		if (m_cuCopyStart)
+			cuEventDestroy(m_cuCopyStart);
+		m_cuCopyStart = m_cuCopyEnd = nullptr;
+	}
+	if (bOk && !m_copyStream.Create())
+		DriverLog("Mixed reality capture: no low-priority CUDA stream, copying on the SDK's\n");
+
+	// BGRA and 32-bit float are the SDK's own layouts, so the copies are plain memcpys
+	uint64_t rgulColorHandles[k_nMaxMrCaptureBuffers] = {};
+	uint64_t rgulDepthHandles[k_nMaxMrCaptureBuffers] = {};
+	for (int i = 0; bOk && i < nBuffers; i++)
+	{
+		bOk = CreateCudaSharedTexture(m_pDevice, unWidth, unHeight, DXGI_FORMAT_B8G8R8A8_UNORM, &m_rgpColorTextures[i], &m_rgColorResources[i], &rgulColorHandles[i])
+			&& CreateCudaSharedTexture(m_pDevice, unWidth, unHeight, DXGI_FORMAT_R32_FLOAT, &m_rgpDepthTextures[i], &m_rgDepthResources[i], &rgulDepthHandles[i]);
+		if (!bOk)
+			DriverLog("MR capture: unable to create shared textures %d\n", i);
+	}
+
+	CUcontext cuPopped;
+	cuCtxPopCurrent(&cuPopped);
+
+	bool bCreated = false;
+	void* pData = bOk ? MapSharedSegment(sName, sizeof(MrCaptureHeader_t), true, &m_pMappingHandle, &bCreated) : nullptr;
+	if (bOk && !pData)
+		DriverLog("Unable to create shared memory %s\n", sName.c_str());
+	if (!pData)
+	{
+		Close();
+		return false;
+	}
+
+	// a segment still mapped by a reader continues its frame count; the rest
+	// is rewritten, since the textures are new. Readers check the magic last.
+	MrCaptureHeader_t* pHeader = (MrCaptureHeader_t*)pData;
+	bool bCompatible = !bCreated && pHeader->unVersion == k_unMrCaptureVersion;
+	uint32_t unSessionId = bCompatible ? pHeader->unSessionId : 0;
+	m_ulFrameCount = bCompatible ? pHeader->ulFrameCount.load(std::memory_order_relaxed) : 0;
+
+	pHeader->unMagic = 0;
+	std::atomic_thread_fence(std::memory_order_release);
+	memset((uint8_t*)pData + sizeof(uint32_t), 0, sizeof(MrCaptureHeader_t) - sizeof(uint32_t));
+	pHeader->unVersion = k_unMrCaptureVersion;
+	pHeader->unWidth = unWidth;
+	pHeader->unHeight = unHeight;
+	pHeader->unBufferCount = (uint32_t)nBuffers;
+	pHeader->unColorFormat = DXGI_FORMAT_B8G8R8A8_UNORM;
+	pHeader->unDepthFormat = DXGI_FORMAT_R32_FLOAT;
+	pHeader->unSessionId = unSessionId + 1 != 0 ? unSessionId + 1 : 1;
+	memcpy(pHeader->rgulColorHandles, rgulColorHandles, sizeof(rgulColorHandles));
+	memcpy(pHeader->rgulDepthHandles, rgulDepthHandles, sizeof(rgulDepthHandles));
+	pHeader->ulFrameCount.store(m_ulFrameCount, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	pHeader->unMagic = k_unMrCaptureMagic;
+
+	m_pHeader = pHeader;
+	m_nLatestBuffer = -1;
+	DriverLog("MR capture: %d frames of %ux%u exported to %s\n", nBuffers, unWidth, unHeight, sName.c_str());
+	return true;
+}
+
+void CMrCaptureExport::Close()
+{
+	if (m_pHeader)
+	{
+		// the handles are about to go away; a reader that keeps the segment sees that
+		m_pHeader->unMagic = 0;
+		std::atomic_thread_fence(std::memory_order_release);
+		m_pHeader->unSessionId = 0;
+		UnmapSharedSegment(m_pHeader, sizeof(MrCaptureHeader_t), m_pMappingHandle);
+		m_pHeader = nullptr;
+		m_pMappingHandle = nullptr;
+	}
+
+	bool bPushed = m_cuContext && cuCtxPushCurrent(m_cuContext) == CUDA_SUCCESS;
+	for (int i = 0; i < k_nMaxMrCaptureBuffers; i++)
+	{
+		CUgraphicsResource* rgpResources[] = { &m_rgColorResources[i], &m_rgDepthResources[i] };
+		ID3D11Texture2D** rgppTextures[] = { &m_rgpColorTextures[i], &m_rgpDepthTextures[i] };
+		for (int j = 0; j < 2; j++)
+		{
+			if (*rgpResources[j])
+			{
+				cuGraphicsUnregisterResource(*rgpResources[j]);
+				*rgpResources[j] = nullptr;
+			}
+			if (*rgppTextures[j])
+			{
+				(*rgppTextures[j])->Release();
+				*rgppTextures[j] = nullptr;
+			}
+		}
+	}
+	m_gpuImage.free();
+	m_gpuDepth.free();
+	if (bPushed && m_cuCopyStart)
+	{
+		cuEventDestroy(m_cuCopyStart);
+		cuEventDestroy(m_cuCopyEnd);
+	}
+	m_cuCopyStart = m_cuCopyEnd = nullptr;
+	if (bPushed)
+	{
+		m_copyStream.Destroy();
+		CUcontext cuPopped;
+		cuCtxPopCurrent(&cuPopped);
+	}
+	m_cuContext = nullptr;
+
+	if (m_pDevice)
+	{
+		m_pDevice->Release();
+		m_pDevice = nullptr;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Maps, copies into and unmaps one texture, all queued on cuStream
+// behind the retrieve that filled source
+//-----------------------------------------------------------------------------
+bool CMrCaptureExport::CopyToTexture(Mat& source, CUgraphicsResource cuResource, size_t unRowBytes, CUstream cuStream)
+{
+	if (cuGraphicsMapResources(1, &cuResource, cuStream) != CUDA_SUCCESS)
+		return false;
+
+	bool bCopied = false;
+	CUarray cuArray;
+	if (cuGraphicsSubResourceGetMappedArray(&cuArray, cuResource, 0, 0) == CUDA_SUCCESS)
+	{
+		CUDA_MEMCPY2D copy;
+		memset(&copy, 0, sizeof(copy));
+		copy.srcMemoryType = CU_MEMORYTYPE_DEVICE;
+		copy.srcDevice = (CUdeviceptr)(uintptr_t)source.getPtr<sl::uchar1>(MEM::GPU);
+		copy.srcPitch = source.getStepBytes(MEM::GPU);
+		copy.dstMemoryType = CU_MEMORYTYPE_ARRAY;
+		copy.dstArray = cuArray;
+		copy.WidthInBytes = unRowBytes;
+		copy.Height = source.getHeight();
+		bCopied = cuMemcpy2DAsync(&copy, cuStream) == CUDA_SUCCESS;
+	}
+	cuGraphicsUnmapResources(1, &cuResource, cuStream);
+	return bCopied;
+}
+
+void CMrCaptureExport::SubmitFrame(Camera& zed, const vr::DriverPose_t& pose, bool bPoseAtImage, uint64_t ulImageTimestampNs)
+{
+	if (!m_pHeader)
+		return;
+
+	uint32_t unWidth = m_pHeader->unWidth;
+	uint32_t unHeight = m_pHeader->unHeight;
+	uint32_t unFlags = bPoseAtImage ? MrCaptureFrame_PoseAtImage : 0;
+	TRACE_ZONE("mrCapture");
+	{
+		TRACE_ZONE("retrieveImage");
+		if (zed.retrieveImage(m_gpuImage, VIEW::LEFT, MEM::GPU) == ERROR_CODE::SUCCESS
+			&& m_gpuImage.getWidth() == unWidth && m_gpuImage.getHeight() == unHeight)
+			unFlags |= MrCaptureFrame_Color;
+	}
+	{
+		TRACE_ZONE("retrieveMeasure");
+		if (zed.retrieveMeasure(m_gpuDepth, MEASURE::DEPTH, MEM::GPU) == ERROR_CODE::SUCCESS
+			&& m_gpuDepth.getWidth() == unWidth && m_gpuDepth.getHeight() == unHeight)
+			unFlags |= MrCaptureFrame_Depth;
+	}
+	if (!(unFlags & (MrCaptureFrame_Color | MrCaptureFrame_Depth)))
+		return;
+
+	if (cuCtxPushCurrent(m_cuContext) != CUDA_SUCCESS)
+		return;
+
+	// the slot is odd before its textures change, so a reader copying them
+	// sees the sequence move; it stays odd if the copy fails
+	int nBuffer = (m_nLatestBuffer + 1) % (int)m_pHeader->unBufferCount;
+	MrCaptureSlot_t& slot = m_pHeader->rgSlots[nBuffer];
+	uint64_t ulFrame = m_ulFrameCount;
+	slot.ulSequence.store(2 * ulFrame + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	// after the retrieves, at low priority
+	CUstream cuStream = m_copyStream.Follow(zed.getCUDAStream());
+	bool bCopied = true;
+	if (m_cuCopyStart)
+		cuEventRecord(m_cuCopyStart, cuStream);
+	if (unFlags & MrCaptureFrame_Color)
+		bCopied = CopyToTexture(m_gpuImage, m_rgColorResources[nBuffer], (size_t)unWidth * 4, cuStream);
+	if (bCopied && (unFlags & MrCaptureFrame_Depth))
+		bCopied = CopyToTexture(m_gpuDepth, m_rgDepthResources[nBuffer], (size_t)unWidth * sizeof(float), cuStream);
+	if (m_cuCopyStart)
+		cuEventRecord(m_cuCopyEnd, cuStream);
+
+	// readers on other devices can't wait on our stream
+	bCopied = bCopied && cuStreamSynchronize(cuStream) == CUDA_SUCCESS;
+	float flCopyMs;
+	if (bCopied && m_cuCopyStart && cuEventElapsedTime(&flCopyMs, m_cuCopyStart, m_cuCopyEnd) == CUDA_SUCCESS)
+		m_ulGpuNs += (uint64_t)(flCopyMs * 1e6f);
+
+	CUcontext cuPopped;
+	cuCtxPopCurrent(&cuPopped);
+
+	if (!bCopied)
+		return;
+
+	m_ulFrameCount++;
+	slot.ulFrameNumber = ulFrame;
+	slot.ulImageTimestampNs = ulImageTimestampNs;
+	slot.unBuffer = (uint32_t)nBuffer;
+	slot.unFlags = unFlags;
+	FillSharedPoseSample(pose, ulImageTimestampNs, &slot.pose);
+	slot.ulSequence.store(2 * ulFrame + 2, std::memory_order_release);
+	m_pHeader->ulFrameCount.store(m_ulFrameCount, std::memory_order_release);
+	m_nLatestBuffer = nBuffer;
+}
+#else
+bool CMrCaptureExport::Open(Camera& /*zed*/, int /*nBuffers*/)
+{
+	DriverLog("MR capture: needs D3D11, not available on this platform\n");
+	return false;
+}
+
+void CMrCaptureExport::Close()
+{
+}
+
+void CMrCaptureExport::SubmitFrame(Camera& /*zed*/, const vr::DriverPose_t& /*pose*/, bool /*bPoseAtImage*/, uint64_t /*ulImageTimestampNs*/)
+{
+}
+#endif
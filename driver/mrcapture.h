@@ -0,0 +1,130 @@
+#ifndef MRCAPTURE_H
+#define MRCAPTURE_H
+
+#pragma once
+
+#include <sl/Camera.hpp>
+#include <cuda.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "cudadevice.h"
+#include "sharedpose.h"
+
+struct ID3D11Device;
+struct ID3D11Texture2D;
+
+static const uint32_t k_unMrCaptureMagic = 0x43524d5a; // "ZMRC"
+static const uint32_t k_unMrCaptureVersion = 1;
+
+static const int k_nMaxMrCaptureBuffers = 4;
+
+enum EMrCaptureFrameFlags
+{
+	MrCaptureFrame_Color = 1 << 0, // the left image was copied
+	MrCaptureFrame_Depth = 1 << 1, // the depth map was copied
+	MrCaptureFrame_PoseAtImage = 1 << 2, // the pose is from the pose history at the image timestamp, not the visual sample
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: One frame of the ring. The sequence is odd while the slot is
+// written and 2 * (frame number + 1) once it holds that frame, as in
+// sharedpose.h, and it turns odd before the buffer's textures are touched. A
+// reader copies the slot and the textures of buffer unBuffer, then checks the
+// sequence again; if it moved, the copy is torn.
+//-----------------------------------------------------------------------------
+struct MrCaptureSlot_t
+{
+	std::atomic<uint64_t> ulSequence;
+	uint64_t ulFrameNumber;
+	uint64_t ulImageTimestampNs; // ZED clock, the same clock as the pose's
+	uint32_t unBuffer;
+	uint32_t unFlags; // EMrCaptureFrameFlags
+	SharedPoseSample_t pose; // the camera's pose when the image was exposed
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: The whole segment. Handles are legacy DXGI shared handles, valid
+// in any process on the same adapter via ID3D11Device::OpenSharedResource;
+// the color textures are BGRA, the depth textures one float of meters per
+// pixel (NaN or inf where there is none), both at the image resolution.
+// They change whenever the camera is reopened, along with unSessionId.
+//-----------------------------------------------------------------------------
+struct MrCaptureHeader_t
+{
+	uint32_t unMagic;
+	uint32_t unVersion;
+	uint32_t unWidth;
+	uint32_t unHeight;
+	uint32_t unBufferCount;
+	uint32_t unColorFormat; // DXGI_FORMAT
+	uint32_t unDepthFormat; // DXGI_FORMAT
+	uint32_t unSessionId; // bumped on every open, 0 while closed
+	uint64_t rgulColorHandles[k_nMaxMrCaptureBuffers];
+	uint64_t rgulDepthHandles[k_nMaxMrCaptureBuffers];
+	std::atomic<uint64_t> ulFrameCount;
+	MrCaptureSlot_t rgSlots[k_nMaxMrCaptureBuffers];
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Mixed-reality capture export. Every grabbed frame's left image and
+// depth map stay in GPU memory and are copied device to device into a ring of
+// D3D11 shared textures, as CGpuPassthrough does for the stereo image, and
+// the camera's pose at the image timestamp goes into the matching slot of a
+// named shared memory segment ("zedm_mr_<serial>"). A compositor such as LIV
+// or an OBS plugin then has image, depth and pose of one instant without
+// matching them up over the camera component and vrserver.
+//
+// Buffers are written round robin, never the one published last, so a
+// reader has a frame's time to copy it. Everything is called from the grab
+// thread.
+//-----------------------------------------------------------------------------
+class CMrCaptureExport
+{
+public:
+	CMrCaptureExport();
+	~CMrCaptureExport();
+
+	/** Creates textures and segment for the camera that was just opened. nBuffers is clamped to 2..k_nMaxMrCaptureBuffers. */
+	bool Open(sl::Camera& zed, int nBuffers);
+	void Close();
+	bool IsOpen() const { return m_pHeader != nullptr; }
+
+	/** Copies the last grab()'s left image and depth and publishes them with pose.
+	* bPoseAtImage tells the pose is from the history at the image timestamp. */
+	void SubmitFrame(sl::Camera& zed, const vr::DriverPose_t& pose, bool bPoseAtImage, uint64_t ulImageTimestampNs);
+
+	/** GPU time of the copies so far, from CUDA events around them */
+	uint64_t GetGpuNanoseconds() const { return m_ulGpuNs.load(); }
+
+private:
+	CMrCaptureExport(const CMrCaptureExport&) = delete;
+	CMrCaptureExport& operator=(const CMrCaptureExport&) = delete;
+
+	bool CopyToTexture(sl::Mat& source, CUgraphicsResource cuResource, size_t unRowBytes, CUstream cuStream);
+
+	ID3D11Device* m_pDevice;
+	ID3D11Texture2D* m_rgpColorTextures[k_nMaxMrCaptureBuffers];
+	ID3D11Texture2D* m_rgpDepthTextures[k_nMaxMrCaptureBuffers];
+	CUgraphicsResource m_rgColorResources[k_nMaxMrCaptureBuffers];
+	CUgraphicsResource m_rgDepthResources[k_nMaxMrCaptureBuffers];
+	CUcontext m_cuContext; // the ZED SDK's
+	sl::Mat m_gpuImage; // reused for every frame
+	sl::Mat m_gpuDepth;
+	CUevent m_cuCopyStart; // null if the events couldn't be created
+	CUevent m_cuCopyEnd;
+	CLowPriorityStream m_copyStream;
+	std::atomic<uint64_t> m_ulGpuNs;
+
+	void* m_pMappingHandle;
+	MrCaptureHeader_t* m_pHeader;
+	uint64_t m_ulFrameCount;
+	int m_nLatestBuffer;
+};
+
+/** The segment name of a camera, from its serial number */
+extern std::string GetMrCaptureName(unsigned int unCameraSerial);
+
+#endif // MRCAPTURE_H
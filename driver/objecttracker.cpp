@@ -0,0 +1,403 @@
+#include "objecttracker.h"
+#include "driverlog.h"
+#include "hmdmath.h"
+
+#include <ctype.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <chrono>
+#include <cmath>
+
+using namespace vr;
+using namespace sl;
+
+// a tracker keeps its object this long after the SDK last reported it, then is free for another
+static const uint64_t k_ulSlotHoldNs = 1000000000ull;
+
+struct ObjectClassName_t
+{
+	const char* pchName;
+	OBJECT_CLASS eClass;
+};
+
+static const ObjectClassName_t k_rgObjectClasses[] = {
+	{ "person", OBJECT_CLASS::PERSON },
+	{ "vehicle", OBJECT_CLASS::VEHICLE },
+	{ "bag", OBJECT_CLASS::BAG },
+	{ "animal", OBJECT_CLASS::ANIMAL },
+	{ "electronics", OBJECT_CLASS::ELECTRONICS },
+	{ "fruit_vegetable", OBJECT_CLASS::FRUIT_VEGETABLE },
+	{ "sport", OBJECT_CLASS::SPORT },
+};
+
+uint32_t ParseObjectClasses(const std::string& sClasses)
+{
+	uint32_t unMask = 0;
+	size_t nStart = 0;
+	while (nStart <= sClasses.size())
+	{
+		size_t nEnd = sClasses.find(',', nStart);
+		if (nEnd == std::string::npos)
+			nEnd = sClasses.size();
+
+		std::string sName;
+		for (size_t i = nStart; i < nEnd; i++)
+		{
+			if (!isspace((unsigned char)sClasses[i]))
+				sName += (char)tolower((unsigned char)sClasses[i]);
+		}
+		if (!sName.empty())
+		{
+			bool bKnown = false;
+			for (const ObjectClassName_t& objectClass : k_rgObjectClasses)
+			{
+				if (sName == objectClass.pchName)
+				{
+					unMask |= 1u << (int)objectClass.eClass;
+					bKnown = true;
+				}
+			}
+			if (!bKnown)
+				DriverLog("Unknown object class \"%s\" in objectClasses\n", sName.c_str());
+		}
+		nStart = nEnd + 1;
+	}
+	return unMask;
+}
+
+CZedObjectTracker::CZedObjectTracker()
+	: m_pZed(nullptr)
+	, m_bReplay(false)
+	, m_nTrackers(0)
+	, m_ulLastDetectionNs(0)
+	, m_pPublisher(nullptr)
+	, m_bFramePending(false)
+	, m_bStopPublisher(false)
+	, m_bSubmitFilterChanged(false)
+	, m_bDedup(false)
+	, m_flDedupPosition(0.0)
+	, m_flDedupRotation(0.0)
+	, m_flDedupKeepAlive(0.0)
+{
+	memset(&m_frame, 0, sizeof(m_frame));
+	memset(&m_pendingFrame, 0, sizeof(m_pendingFrame));
+	memset(&m_publishFrame, 0, sizeof(m_publishFrame));
+	memset(&m_poseTemplate, 0, sizeof(m_poseTemplate));
+	memset(&m_lastPoses, 0, sizeof(m_lastPoses));
+	for (int i = 0; i < k_nMaxObjectTrackers; i++)
+	{
+		m_rgunObjectIds[i] = k_unTrackedDeviceIndexInvalid;
+		m_rgSlots[i].nId = -1;
+		m_rgSlots[i].ulLastSeenNs = 0;
+	}
+}
+
+CZedObjectTracker::~CZedObjectTracker()
+{
+	if (m_pPublisher)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_publisherMutex);
+			m_bStopPublisher = true;
+		}
+		m_publisherWake.notify_one();
+		m_pPublisher->join();
+		delete m_pPublisher;
+	}
+}
+
+bool CZedObjectTracker::Enable(Camera& zed, int nTrackers, uint32_t unClassMask, float flConfidenceThreshold, bool bReplay)
+{
+	Disable(zed);
+	if (nTrackers <= 0 || unClassMask == 0)
+		return false;
+
+	ObjectDetectionParameters params;
+	params.detection_model = DETECTION_MODEL::MULTI_CLASS_BOX;
+	params.enable_tracking = true; // stable ids, so a tracker stays on one object
+	params.image_sync = false;     // inference on the SDK's thread, grab() doesn't wait for it
+
+	ERROR_CODE eError = zed.enableObjectDetection(params);
+	if (eError != ERROR_CODE::SUCCESS)
+	{
+		DriverLog("Unable to enable object detection: %s\n", toString(eError).c_str());
+		return false;
+	}
+
+	m_runtimeParams = ObjectDetectionRuntimeParameters();
+	m_runtimeParams.detection_confidence_threshold = flConfidenceThreshold;
+	for (const ObjectClassName_t& objectClass : k_rgObjectClasses)
+	{
+		if (unClassMask & (1u << (int)objectClass.eClass))
+			m_runtimeParams.object_class_filter.push_back(objectClass.eClass);
+	}
+	m_pZed = &zed;
+	m_bReplay = bReplay;
+	m_nTrackers = nTrackers < k_nMaxObjectTrackers ? nTrackers : k_nMaxObjectTrackers;
+	m_ulLastDetectionNs = 0;
+	m_bFramePending = false;
+	m_bStopPublisher = false;
+	for (int i = 0; i < k_nMaxObjectTrackers; i++)
+		m_rgSlots[i].nId = -1;
+	m_pPublisher = new std::thread(&CZedObjectTracker::RunPublisher, this);
+	return true;
+}
+
+void CZedObjectTracker::Disable(Camera& zed)
+{
+	if (!m_pPublisher)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_publisherMutex);
+		m_bStopPublisher = true;
+	}
+	m_publisherWake.notify_one();
+	m_pPublisher->join();
+	delete m_pPublisher;
+	m_pPublisher = nullptr;
+
+	zed.disableObjectDetection();
+	m_pZed = nullptr;
+
+	DriverPose_t poseTemplate;
+	{
+		std::lock_guard<std::mutex> lock(m_publisherMutex);
+		poseTemplate = m_poseTemplate;
+	}
+	for (int i = 0; i < k_nMaxObjectTrackers; i++)
+		m_rgSlots[i].nId = -1;
+	PublishTrackingLost(poseTemplate);
+}
+
+void CZedObjectTracker::SetPoseTemplate(const DriverPose_t& poseTemplate)
+{
+	std::lock_guard<std::mutex> lock(m_publisherMutex);
+	m_poseTemplate = poseTemplate;
+
+	// objects are tracked in driver space directly; the head offset is the camera's
+	m_poseTemplate.qDriverFromHeadRotation = HmdQuaternion_Identity();
+	for (int i = 0; i < 3; i++)
+		m_poseTemplate.vecDriverFromHeadTranslation[i] = 0.0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: retrieveObjects returns the newest finished detection without
+// waiting for inference; most grabs find nothing new and return here.
+//-----------------------------------------------------------------------------
+void CZedObjectTracker::Update(Camera& zed)
+{
+	if (!m_pPublisher)
+		return;
+
+	if (zed.retrieveObjects(m_objects, m_runtimeParams) != ERROR_CODE::SUCCESS || !m_objects.is_new)
+		return;
+	uint64_t ulTimestampNs = m_objects.timestamp.getNanoseconds();
+	if (ulTimestampNs == m_ulLastDetectionNs)
+		return;
+	m_ulLastDetectionNs = ulTimestampNs;
+
+	m_frame.ulTimestampNs = ulTimestampNs;
+	m_frame.nObjects = 0;
+	for (const ObjectData& object : m_objects.object_list)
+	{
+		if (m_frame.nObjects == k_nMaxDetectedObjects)
+			break;
+		if (object.tracking_state != OBJECT_TRACKING_STATE::OK)
+			continue;
+		if (!std::isfinite(object.position.x) || !std::isfinite(object.position.y) || !std::isfinite(object.position.z))
+			continue;
+
+		ZedObjectFrame_t::Object_t& entry = m_frame.rgObjects[m_frame.nObjects++];
+		entry.nId = object.id;
+		entry.eClass = object.label;
+		entry.flConfidence = object.confidence;
+		for (int i = 0; i < 3; i++)
+		{
+			entry.vecPosition[i] = object.position[i];
+			entry.vecVelocity[i] = std::isfinite(object.velocity[i]) ? object.velocity[i] : 0.0f;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_publisherMutex);
+		memcpy(&m_pendingFrame, &m_frame, offsetof(ZedObjectFrame_t, rgObjects) + m_frame.nObjects * sizeof(ZedObjectFrame_t::Object_t));
+		m_bFramePending = true;
+	}
+	m_publisherWake.notify_one();
+}
+
+void CZedObjectTracker::RunPublisher()
+{
+	while (true)
+	{
+		DriverPose_t poseTemplate;
+		{
+			std::unique_lock<std::mutex> lock(m_publisherMutex);
+			m_publisherWake.wait(lock, [this] { return m_bStopPublisher || m_bFramePending; });
+			if (m_bStopPublisher)
+				return;
+
+			memcpy(&m_publishFrame, &m_pendingFrame, offsetof(ZedObjectFrame_t, rgObjects) + m_pendingFrame.nObjects * sizeof(ZedObjectFrame_t::Object_t));
+			m_bFramePending = false;
+			poseTemplate = m_poseTemplate;
+			if (m_bSubmitFilterChanged)
+			{
+				for (int i = 0; i < k_nMaxObjectTrackers; i++)
+					m_rgSubmitFilters[i].Configure(m_bDedup, m_flDedupPosition, m_flDedupRotation, m_flDedupKeepAlive);
+				m_bSubmitFilterChanged = false;
+			}
+		}
+
+		PublishPoses(m_publishFrame, poseTemplate);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gives every tracker the frame's index of its object, -1 if it has
+// none this frame. Ids already on a tracker keep it; new ids take free
+// trackers in the order the SDK lists them, and ids beyond the trackers
+// there are aren't published.
+//-----------------------------------------------------------------------------
+void CZedObjectTracker::AssignSlots(const ZedObjectFrame_t& frame, int* pnSlotObjects)
+{
+	bool rgbTaken[k_nMaxDetectedObjects] = {};
+	for (int nSlot = 0; nSlot < m_nTrackers; nSlot++)
+	{
+		pnSlotObjects[nSlot] = -1;
+		if (m_rgSlots[nSlot].nId < 0)
+			continue;
+		for (int i = 0; i < frame.nObjects; i++)
+		{
+			if (frame.rgObjects[i].nId == m_rgSlots[nSlot].nId)
+			{
+				pnSlotObjects[nSlot] = i;
+				rgbTaken[i] = true;
+				break;
+			}
+		}
+		if (pnSlotObjects[nSlot] < 0 && frame.ulTimestampNs - m_rgSlots[nSlot].ulLastSeenNs > k_ulSlotHoldNs)
+			m_rgSlots[nSlot].nId = -1;
+	}
+
+	int nSlot = 0;
+	for (int i = 0; i < frame.nObjects; i++)
+	{
+		if (rgbTaken[i])
+			continue;
+		while (nSlot < m_nTrackers && m_rgSlots[nSlot].nId >= 0)
+			nSlot++;
+		if (nSlot == m_nTrackers)
+			break;
+		m_rgSlots[nSlot].nId = frame.rgObjects[i].nId;
+		m_rgSubmitFilters[nSlot].Reset();
+		pnSlotObjects[nSlot] = i;
+	}
+
+	for (int nSlot = 0; nSlot < m_nTrackers; nSlot++)
+	{
+		if (pnSlotObjects[nSlot] >= 0)
+			m_rgSlots[nSlot].ulLastSeenNs = frame.ulTimestampNs;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Every tracker's pose is built before the first one is submitted,
+// then all are submitted in one pass with the same time offset. A tracker
+// whose object is briefly gone holds its last position at rest.
+//-----------------------------------------------------------------------------
+void CZedObjectTracker::PublishPoses(const ZedObjectFrame_t& frame, const DriverPose_t& poseTemplate)
+{
+	int rgnSlotObjects[k_nMaxObjectTrackers];
+	AssignSlots(frame, rgnSlotObjects);
+
+	double flTimeOffset = 0.0;
+	if (!m_bReplay && m_pZed)
+	{
+		uint64_t ulNowNs = m_pZed->getTimestamp(TIME_REFERENCE::CURRENT).getNanoseconds();
+		if (ulNowNs != 0)
+			flTimeOffset = ((int64_t)frame.ulTimestampNs - (int64_t)ulNowNs) * 1e-9;
+	}
+
+	ObjectPoses_t& poses = m_lastPoses;
+	for (int nSlot = 0; nSlot < m_nTrackers; nSlot++)
+	{
+		DriverPose_t& pose = poses.rgPoses[nSlot];
+		int nObject = rgnSlotObjects[nSlot];
+		if (nObject < 0)
+		{
+			if (m_rgSlots[nSlot].nId < 0 || !pose.poseIsValid)
+			{
+				pose = poseTemplate;
+				pose.poseIsValid = false;
+				pose.result = TrackingResult_Running_OutOfRange;
+			}
+			else
+			{
+				for (int j = 0; j < 3; j++)
+					pose.vecVelocity[j] = 0.0;
+			}
+			continue;
+		}
+
+		const ZedObjectFrame_t::Object_t& object = frame.rgObjects[nObject];
+		pose = poseTemplate;
+		for (int j = 0; j < 3; j++)
+		{
+			pose.vecPosition[j] = object.vecPosition[j];
+			pose.vecVelocity[j] = object.vecVelocity[j];
+		}
+		pose.qRotation = HmdQuaternion_Identity();
+		pose.poseTimeOffset = flTimeOffset;
+	}
+
+	m_poses.Write(poses);
+	SubmitPoses(poses, frame.ulTimestampNs);
+}
+
+void CZedObjectTracker::PublishTrackingLost(const DriverPose_t& poseTemplate)
+{
+	ObjectPoses_t& poses = m_lastPoses;
+	for (int i = 0; i < k_nMaxObjectTrackers; i++)
+	{
+		poses.rgPoses[i] = poseTemplate;
+		poses.rgPoses[i].poseIsValid = false;
+		poses.rgPoses[i].result = TrackingResult_Running_OutOfRange;
+	}
+
+	m_poses.Write(poses);
+	SubmitPoses(poses, 0);
+}
+
+void CZedObjectTracker::SetSubmitFilter(bool bEnabled, double flPositionThreshold, double flRotationThresholdDegrees, double flKeepAliveSeconds)
+{
+	std::lock_guard<std::mutex> lock(m_publisherMutex);
+	m_bDedup = bEnabled;
+	m_flDedupPosition = flPositionThreshold;
+	m_flDedupRotation = flRotationThresholdDegrees;
+	m_flDedupKeepAlive = flKeepAliveSeconds;
+	m_bSubmitFilterChanged = true;
+}
+
+void CZedObjectTracker::SubmitPoses(const ObjectPoses_t& poses, uint64_t ulSampleTimestampNs)
+{
+	uint64_t ulNowNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	for (int i = 0; i < k_nMaxObjectTrackers; i++)
+	{
+		TrackedDeviceIndex_t unObjectId = m_rgunObjectIds[i].load();
+		if (unObjectId != k_unTrackedDeviceIndexInvalid && m_rgSubmitFilters[i].ShouldSubmit(poses.rgPoses[i], ulSampleTimestampNs, ulNowNs))
+			VRServerDriverHost()->TrackedDevicePoseUpdated(unObjectId, poses.rgPoses[i], sizeof(DriverPose_t));
+	}
+}
+
+void CZedObjectTracker::ReadPose(int nTracker, DriverPose_t* pPose) const
+{
+	ObjectPoses_t poses;
+	if (nTracker < 0 || nTracker >= k_nMaxObjectTrackers || m_poses.Read(&poses) == 0)
+	{
+		*pPose = DriverPose_Uninitialized();
+		return;
+	}
+	*pPose = poses.rgPoses[nTracker];
+}
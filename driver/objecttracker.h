@@ -0,0 +1,143 @@
+#ifndef OBJECTTRACKER_H
+#define OBJECTTRACKER_H
+
+#pragma once
+
+#include <openvr_driver.h>
+#include <sl/Camera.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "posededup.h"
+#include "seqlock.h"
+
+// objectTrackers beyond this many are ignored
+static const int k_nMaxObjectTrackers = 16;
+
+// objects of one detection looked at, the rest are dropped
+static const int k_nMaxDetectedObjects = 64;
+
+//-----------------------------------------------------------------------------
+// Purpose: One detection as the grab thread hands it over: every object of
+// the selected classes the SDK is tracking, in ZED world (driver) space
+//-----------------------------------------------------------------------------
+struct ZedObjectFrame_t
+{
+	struct Object_t
+	{
+		int nId; // the SDK's tracking id, stable while the object is tracked
+		sl::OBJECT_CLASS eClass;
+		float flConfidence;
+		double vecPosition[3];
+		double vecVelocity[3];
+	};
+
+	uint64_t ulTimestampNs; // ZED clock, the image the detection ran on
+	int nObjects;
+	Object_t rgObjects[k_nMaxDetectedObjects];
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Props found by ZED object detection (MULTI_CLASS_BOX), published
+// as objectTrackers virtual trackers.
+//
+// Like body tracking, inference runs on the SDK's thread at its own cadence
+// (image_sync off) and the grab thread only collects a finished detection.
+// A publisher thread then keeps each tracker on one object: an SDK id keeps
+// its tracker while the SDK tracks it, a new id takes a free tracker, and a
+// tracker is freed once its id has been gone for a second. All trackers'
+// poses of a detection are built into one array, written to the readers
+// once and submitted back to back, so an extra object costs one pose and
+// one host call, nothing per object in locks or wake-ups.
+//
+// The SDK reports where an object is, not how it is turned; the poses keep
+// the world's orientation.
+//-----------------------------------------------------------------------------
+class CZedObjectTracker
+{
+public:
+	CZedObjectTracker();
+	~CZedObjectTracker();
+
+	/** Grab thread: starts detection on the camera that was just opened. unClassMask has a bit per
+	* sl::OBJECT_CLASS; positions are in world space only if grab() measures in REFERENCE_FRAME::WORLD. */
+	bool Enable(sl::Camera& zed, int nTrackers, uint32_t unClassMask, float flConfidenceThreshold, bool bReplay);
+
+	/** Grab thread: stops detection and the publisher, trackers report out of range */
+	void Disable(sl::Camera& zed);
+
+	bool IsEnabled() const { return m_pPublisher != nullptr; }
+
+	/** Grab thread, after each grab: hands a new detection to the publisher */
+	void Update(sl::Camera& zed);
+
+	/** Grab thread: the world-from-driver transform the poses are published with */
+	void SetPoseTemplate(const vr::DriverPose_t& poseTemplate);
+
+	/** Any thread: poseDedup for the object trackers, see CPoseSubmitFilter::Configure */
+	void SetSubmitFilter(bool bEnabled, double flPositionThreshold, double flRotationThresholdDegrees, double flKeepAliveSeconds);
+
+	void SetObjectId(int nTracker, vr::TrackedDeviceIndex_t unObjectId) { m_rgunObjectIds[nTracker].store(unObjectId); }
+
+	/** Any thread: the tracker's latest pose, invalid before it was first given an object */
+	void ReadPose(int nTracker, vr::DriverPose_t* pPose) const;
+
+private:
+	CZedObjectTracker(const CZedObjectTracker&) = delete;
+	CZedObjectTracker& operator=(const CZedObjectTracker&) = delete;
+
+	struct ObjectPoses_t
+	{
+		vr::DriverPose_t rgPoses[k_nMaxObjectTrackers];
+	};
+
+	struct Slot_t
+	{
+		int nId; // -1 while free
+		uint64_t ulLastSeenNs;
+	};
+
+	void RunPublisher();
+	void AssignSlots(const ZedObjectFrame_t& frame, int* pnSlotObjects);
+	void PublishPoses(const ZedObjectFrame_t& frame, const vr::DriverPose_t& poseTemplate);
+	void PublishTrackingLost(const vr::DriverPose_t& poseTemplate);
+	void SubmitPoses(const ObjectPoses_t& poses, uint64_t ulSampleTimestampNs);
+
+	sl::Camera* m_pZed; // for the current time, while enabled
+	bool m_bReplay;
+	int m_nTrackers;
+	sl::Objects m_objects; // grab thread's, reused for every retrieveObjects
+	sl::ObjectDetectionRuntimeParameters m_runtimeParams;
+	uint64_t m_ulLastDetectionNs;
+	ZedObjectFrame_t m_frame; // grab thread's, built in place
+
+	std::thread* m_pPublisher;
+	std::mutex m_publisherMutex; // everything up to m_flDedupKeepAlive
+	std::condition_variable m_publisherWake;
+	ZedObjectFrame_t m_pendingFrame;
+	bool m_bFramePending;
+	vr::DriverPose_t m_poseTemplate;
+	bool m_bStopPublisher;
+	bool m_bSubmitFilterChanged;
+	bool m_bDedup;
+	double m_flDedupPosition;
+	double m_flDedupRotation;
+	double m_flDedupKeepAlive;
+	ZedObjectFrame_t m_publishFrame; // publisher's
+	Slot_t m_rgSlots[k_nMaxObjectTrackers]; // publisher's
+	ObjectPoses_t m_lastPoses; // publisher's, held while an object is briefly gone
+	CPoseSubmitFilter m_rgSubmitFilters[k_nMaxObjectTrackers]; // publisher's
+
+	std::atomic<vr::TrackedDeviceIndex_t> m_rgunObjectIds[k_nMaxObjectTrackers];
+	CSeqLock<ObjectPoses_t> m_poses;
+};
+
+/** The sl::OBJECT_CLASS bits of an objectClasses list ("sport,bag"), 0 if it names none */
+extern uint32_t ParseObjectClasses(const std::string& sClasses);
+
+#endif // OBJECTTRACKER_H
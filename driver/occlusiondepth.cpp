@@ -0,0 +1,235 @@
+#include "occlusiondepth.h"
+#include "driverlog.h"
+#include "gpupassthrough.h"
+#include "tracezones.h"
+
+#include <string.h>
+
+#if defined(_WIN32)
+#include <d3d11.h>
+#include <dxgi.h>
+#include <cudaD3D11.h>
+#endif
+
+using namespace sl;
+
+COcclusionDepth::COcclusionDepth()
+	: m_pDevice(nullptr)
+	, m_cuContext(nullptr)
+	, m_cuCopyStart(nullptr)
+	, m_cuCopyEnd(nullptr)
+	, m_ulGpuNs(0)
+{
+	memset(m_rgpTextures, 0, sizeof(m_rgpTextures));
+	memset(m_rgResources, 0, sizeof(m_rgResources));
+	memset(&m_info, 0, sizeof(m_info));
+	m_info.nLatestBuffer = -1;
+}
+
+COcclusionDepth::~COcclusionDepth()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+bool COcclusionDepth::Open(Camera& zed, uint32_t unDivisor)
+{
+	Close();
+
+	unDivisor = unDivisor < 1 ? 1 : unDivisor > 8 ? 8 : unDivisor;
+	Resolution resolution = zed.getCameraInformation().camera_configuration.resolution;
+	uint32_t unWidth = (uint32_t)resolution.width / unDivisor;
+	uint32_t unHeight = (uint32_t)resolution.height / unDivisor;
+
+	m_cuContext = zed.getCUDAContext();
+	CUdevice cuDevice;
+	if (!m_cuContext || cuCtxPushCurrent(m_cuContext) != CUDA_SUCCESS)
+	{
+		DriverLog("Occlusion depth: no CUDA context\n");
+		m_cuContext = nullptr;
+		return false;
+	}
+	bool bOk = cuCtxGetDevice(&cuDevice) == CUDA_SUCCESS && (m_pDevice = CreateD3D11DeviceForCuda(cuDevice)) != nullptr;
+	if (!bOk)
+		DriverLog("Occlusion depth: no D3D11 device on the ZED SDK's GPU\n");
+
+	if (bOk && (cuEventCreate(&m_cuCopyStart, CU_EVENT_DEFAULT) != CUDA_SUCCESS || cuEventCreate(&m_cuCopyEnd, CU_EVENT_DEFAULT) != CUDA_SUCCESS))
+	{
+		if (m_cuCopyStart)
+			cuEventDestroy(m_cuCopyStart);
+		m_cuCopyStart = m_cuCopyEnd = nullptr;
+	}
+	if (bOk && !m_copyStream.Create())
+		DriverLog("Occlusion depth: no low-priority CUDA stream, copying on the SDK's\n");
+
+	// the SDK's F32_C1 layout, so the copy is a plain memcpy
+	uint64_t rgulHandles[k_nOcclusionDepthBuffers] = {};
+	for (int i = 0; bOk && i < k_nOcclusionDepthBuffers; i++)
+	{
+		bOk = CreateCudaSharedTexture(m_pDevice, unWidth, unHeight, DXGI_FORMAT_R32_FLOAT, &m_rgpTextures[i], &m_rgResources[i], &rgulHandles[i]);
+		if (!bOk)
+			DriverLog("Occlusion depth: unable to create shared texture %d\n", i);
+	}
+
+	CUcontext cuPopped;
+	cuCtxPopCurrent(&cuPopped);
+
+	if (!bOk)
+	{
+		Close();
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	memset(&m_info, 0, sizeof(m_info));
+	m_info.unWidth = unWidth;
+	m_info.unHeight = unHeight;
+	m_info.unDivisor = unDivisor;
+	memcpy(m_info.rgulSharedHandles, rgulHandles, sizeof(rgulHandles));
+	m_info.nLatestBuffer = -1;
+
+	DriverLog("Occlusion depth: %ux%u, 1/%u of the image resolution\n", unWidth, unHeight, unDivisor);
+	return true;
+}
+
+void COcclusionDepth::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		memset(&m_info, 0, sizeof(m_info));
+		m_info.nLatestBuffer = -1;
+	}
+
+	bool bPushed = m_cuContext && cuCtxPushCurrent(m_cuContext) == CUDA_SUCCESS;
+	for (int i = 0; i < k_nOcclusionDepthBuffers; i++)
+	{
+		if (m_rgResources[i])
+		{
+			cuGraphicsUnregisterResource(m_rgResources[i]);
+			m_rgResources[i] = nullptr;
+		}
+		if (m_rgpTextures[i])
+		{
+			m_rgpTextures[i]->Release();
+			m_rgpTextures[i] = nullptr;
+		}
+	}
+	m_gpuDepth.free();
+	if (bPushed && m_cuCopyStart)
+	{
+		cuEventDestroy(m_cuCopyStart);
+		cuEventDestroy(m_cuCopyEnd);
+	}
+	m_cuCopyStart = m_cuCopyEnd = nullptr;
+	if (bPushed)
+	{
+		m_copyStream.Destroy();
+		CUcontext cuPopped;
+		cuCtxPopCurrent(&cuPopped);
+	}
+	m_cuContext = nullptr;
+
+	if (m_pDevice)
+	{
+		m_pDevice->Release();
+		m_pDevice = nullptr;
+	}
+}
+
+void COcclusionDepth::SubmitFrame(Camera& zed, uint64_t ulImageTimestampNs)
+{
+	if (!m_pDevice)
+		return;
+
+	int nBuffer;
+	uint32_t unWidth, unHeight;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		nBuffer = (m_info.nLatestBuffer + 1) % k_nOcclusionDepthBuffers;
+		unWidth = m_info.unWidth;
+		unHeight = m_info.unHeight;
+	}
+
+	TRACE_ZONE("occlusionDepth");
+	{
+		// resampled by the SDK on its stream, without leaving the GPU
+		TRACE_ZONE("retrieveMeasure");
+		if (zed.retrieveMeasure(m_gpuDepth, MEASURE::DEPTH, MEM::GPU, Resolution(unWidth, unHeight)) != ERROR_CODE::SUCCESS)
+			return;
+	}
+	if (m_gpuDepth.getWidth() != unWidth || m_gpuDepth.getHeight() != unHeight)
+		return;
+
+	if (cuCtxPushCurrent(m_cuContext) != CUDA_SUCCESS)
+		return;
+
+	// after the resampling, at low priority
+	CUstream cuStream = m_copyStream.Follow(zed.getCUDAStream());
+	CUgraphicsResource cuResource = m_rgResources[nBuffer];
+	bool bCopied = false;
+	if (m_cuCopyStart)
+		cuEventRecord(m_cuCopyStart, cuStream);
+	if (cuGraphicsMapResources(1, &cuResource, cuStream) == CUDA_SUCCESS)
+	{
+		CUarray cuArray;
+		if (cuGraphicsSubResourceGetMappedArray(&cuArray, cuResource, 0, 0) == CUDA_SUCCESS)
+		{
+			CUDA_MEMCPY2D copy;
+			memset(&copy, 0, sizeof(copy));
+			copy.srcMemoryType = CU_MEMORYTYPE_DEVICE;
+			copy.srcDevice = (CUdeviceptr)(uintptr_t)m_gpuDepth.getPtr<sl::uchar1>(MEM::GPU);
+			copy.srcPitch = m_gpuDepth.getStepBytes(MEM::GPU);
+			copy.dstMemoryType = CU_MEMORYTYPE_ARRAY;
+			copy.dstArray = cuArray;
+			copy.WidthInBytes = (size_t)unWidth * sizeof(float);
+			copy.Height = unHeight;
+			bCopied = cuMemcpy2DAsync(&copy, cuStream) == CUDA_SUCCESS;
+		}
+		cuGraphicsUnmapResources(1, &cuResource, cuStream);
+		if (m_cuCopyStart)
+			cuEventRecord(m_cuCopyEnd, cuStream);
+
+		// consumers on other devices can't wait on our stream
+		bCopied = bCopied && cuStreamSynchronize(cuStream) == CUDA_SUCCESS;
+
+		float flCopyMs;
+		if (bCopied && m_cuCopyStart && cuEventElapsedTime(&flCopyMs, m_cuCopyStart, m_cuCopyEnd) == CUDA_SUCCESS)
+			m_ulGpuNs += (uint64_t)(flCopyMs * 1e6f);
+	}
+
+	CUcontext cuPopped;
+	cuCtxPopCurrent(&cuPopped);
+
+	if (!bCopied)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_info.nLatestBuffer = nBuffer;
+	m_info.unFrameSequence++;
+	m_info.ulImageTimestampNs = ulImageTimestampNs;
+}
+
+#else
+bool COcclusionDepth::Open(Camera& /*zed*/, uint32_t /*unDivisor*/)
+{
+	DriverLog("Occlusion depth: needs D3D11, not available on this platform\n");
+	return false;
+}
+
+void COcclusionDepth::Close()
+{
+}
+
+void COcclusionDepth::SubmitFrame(Camera& /*zed*/, uint64_t /*ulImageTimestampNs*/)
+{
+}
+#endif
+
+bool COcclusionDepth::GetInfo(OcclusionDepthInfo_t* pInfo) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_info.unWidth == 0)
+		return false;
+	*pInfo = m_info;
+	return true;
+}
@@ -0,0 +1,86 @@
+#ifndef OCCLUSIONDEPTH_H
+#define OCCLUSIONDEPTH_H
+
+#pragma once
+
+#include <sl/Camera.hpp>
+#include <cuda.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "cudadevice.h"
+
+struct ID3D11Device;
+struct ID3D11Texture2D;
+
+static const int k_nOcclusionDepthBuffers = 3;
+
+//-----------------------------------------------------------------------------
+// Purpose: What an occlusion consumer needs to open the textures and find the
+// newest depth map, as in GpuPassthroughInfo_t
+//-----------------------------------------------------------------------------
+struct OcclusionDepthInfo_t
+{
+	uint32_t unWidth;
+	uint32_t unHeight;
+	uint32_t unDivisor; // of the image resolution
+	uint64_t rgulSharedHandles[k_nOcclusionDepthBuffers];
+	int nLatestBuffer; // -1 until the first frame
+	uint32_t unFrameSequence;
+	uint64_t ulImageTimestampNs; // ZED clock
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: A reduced-resolution depth map for real-world occlusion in MR
+// apps. Full-resolution depth costs more to sample every eye frame than the
+// occlusion test needs, so the SDK resamples the depth map to a fraction of
+// the image resolution in GPU memory (retrieveMeasure with a resolution and
+// MEM::GPU) and the result is copied device to device into one of three
+// D3D11 shared textures of meters (DXGI_FORMAT_R32_FLOAT), as
+// CGpuPassthrough does for the image. A quarter of the resolution is a
+// sixteenth of the bytes.
+//
+// Buffers are written round robin, never the one published last. Everything
+// but GetInfo is called from the grab thread.
+//-----------------------------------------------------------------------------
+class COcclusionDepth
+{
+public:
+	COcclusionDepth();
+	~COcclusionDepth();
+
+	/** Creates the textures for the camera that was just opened; unDivisor is clamped to 1..8 */
+	bool Open(sl::Camera& zed, uint32_t unDivisor);
+	void Close();
+	bool IsOpen() const { return m_pDevice != nullptr; }
+
+	/** Resamples the depth of the last grab() into the next texture and publishes it */
+	void SubmitFrame(sl::Camera& zed, uint64_t ulImageTimestampNs);
+
+	/** False while closed */
+	bool GetInfo(OcclusionDepthInfo_t* pInfo) const;
+
+	/** Any thread: GPU time of the copies so far, from CUDA events around them */
+	uint64_t GetGpuNanoseconds() const { return m_ulGpuNs.load(); }
+
+private:
+	COcclusionDepth(const COcclusionDepth&) = delete;
+	COcclusionDepth& operator=(const COcclusionDepth&) = delete;
+
+	ID3D11Device* m_pDevice;
+	ID3D11Texture2D* m_rgpTextures[k_nOcclusionDepthBuffers];
+	CUgraphicsResource m_rgResources[k_nOcclusionDepthBuffers];
+	CUcontext m_cuContext; // the ZED SDK's
+	sl::Mat m_gpuDepth; // reused for every frame, at the reduced resolution
+	CUevent m_cuCopyStart; // null if the events couldn't be created
+	CUevent m_cuCopyEnd;
+	CLowPriorityStream m_copyStream;
+	std::atomic<uint64_t> m_ulGpuNs;
+
+	mutable std::mutex m_mutex; // m_info, read by GetInfo
+	OcclusionDepthInfo_t m_info;
+};
+
+#endif // OCCLUSIONDEPTH_H
@@ -0,0 +1,111 @@
+#ifndef POSEDEDUP_H
+#define POSEDEDUP_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "hmdmath.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Decides whether a pose is worth a TrackedDevicePoseUpdated, for
+// poseDedup. A pose is dropped when its sample timestamp was submitted
+// already. It is also dropped when it moved less than the position and
+// rotation thresholds from the last submitted pose. A change of validity,
+// result or world transform is always submitted, and so is any pose once
+// the keep-alive interval has passed, so SteamVR never sees a device go
+// silent. Single thread; whoever submits owns it.
+//-----------------------------------------------------------------------------
+class CPoseSubmitFilter
+{
+public:
+	CPoseSubmitFilter()
+		: m_bEnabled(false)
+		, m_flPositionThreshold(0.0)
+		, m_flRotationThreshold(0.0)
+		, m_ulKeepAliveNs(0)
+		, m_bHaveLast(false)
+		, m_ulLastTimestampNs(0)
+		, m_ulLastSubmitNs(0)
+		, m_ulSkipped(0)
+	{
+		memset(&m_lastPose, 0, sizeof(m_lastPose));
+	}
+
+	/** Thresholds in meters and degrees, keep-alive in seconds */
+	void Configure(bool bEnabled, double flPositionThreshold, double flRotationThresholdDegrees, double flKeepAliveSeconds)
+	{
+		m_bEnabled = bEnabled;
+		m_flPositionThreshold = flPositionThreshold;
+		// compared against |dot| of the quaternions, cos of half the angle
+		m_flRotationThreshold = std::cos(0.5 * flRotationThresholdDegrees * 3.14159265358979323846 / 180.0);
+		m_ulKeepAliveNs = flKeepAliveSeconds > 0.0 ? (uint64_t)(flKeepAliveSeconds * 1e9) : 0;
+	}
+
+	void Reset() { m_bHaveLast = false; }
+
+	/** True to submit; the pose then becomes the reference for the next ones.
+	* ulSampleTimestampNs 0 means the pose has no sample, e.g. tracking lost. */
+	bool ShouldSubmit(const vr::DriverPose_t& pose, uint64_t ulSampleTimestampNs, uint64_t ulNowNs)
+	{
+		if (m_bEnabled && m_bHaveLast && ulNowNs - m_ulLastSubmitNs < m_ulKeepAliveNs && IsSameState(pose))
+		{
+			if (ulSampleTimestampNs != 0 && ulSampleTimestampNs == m_ulLastTimestampNs)
+			{
+				m_ulSkipped++;
+				return false;
+			}
+			if (!pose.poseIsValid || IsBelowThresholds(pose))
+			{
+				m_ulSkipped++;
+				return false;
+			}
+		}
+
+		m_lastPose = pose;
+		m_ulLastTimestampNs = ulSampleTimestampNs;
+		m_ulLastSubmitNs = ulNowNs;
+		m_bHaveLast = true;
+		return true;
+	}
+
+	uint64_t GetSkippedCount() const { return m_ulSkipped; }
+
+private:
+	bool IsSameState(const vr::DriverPose_t& pose) const
+	{
+		return pose.poseIsValid == m_lastPose.poseIsValid && pose.result == m_lastPose.result
+			&& pose.deviceIsConnected == m_lastPose.deviceIsConnected
+			&& memcmp(&pose.qWorldFromDriverRotation, &m_lastPose.qWorldFromDriverRotation, sizeof(pose.qWorldFromDriverRotation)) == 0
+			&& memcmp(pose.vecWorldFromDriverTranslation, m_lastPose.vecWorldFromDriverTranslation, sizeof(pose.vecWorldFromDriverTranslation)) == 0;
+	}
+
+	bool IsBelowThresholds(const vr::DriverPose_t& pose) const
+	{
+		double flDistanceSquared = 0.0;
+		for (int i = 0; i < 3; i++)
+		{
+			double flDelta = pose.vecPosition[i] - m_lastPose.vecPosition[i];
+			flDistanceSquared += flDelta * flDelta;
+		}
+		return flDistanceSquared < m_flPositionThreshold * m_flPositionThreshold
+			&& std::fabs(HmdQuaternion_Dot(pose.qRotation, m_lastPose.qRotation)) > m_flRotationThreshold;
+	}
+
+	bool m_bEnabled;
+	double m_flPositionThreshold;
+	double m_flRotationThreshold;
+	uint64_t m_ulKeepAliveNs;
+
+	bool m_bHaveLast;
+	vr::DriverPose_t m_lastPose;
+	uint64_t m_ulLastTimestampNs;
+	uint64_t m_ulLastSubmitNs;
+	uint64_t m_ulSkipped;
+};
+
+#endif // POSEDEDUP_H
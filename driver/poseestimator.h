@@ -0,0 +1,111 @@
+#ifndef POSEESTIMATOR_H
+#define POSEESTIMATOR_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <cmath>
+#include <cstdint>
+
+#include "hmdmath.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Derives smoothed linear and angular velocity from consecutive
+// tracked poses so SteamVR can extrapolate between our updates. Angular
+// velocity is expressed in driver world space, like vecAngularVelocity.
+// Acceleration is deliberately not estimated: a second finite difference of
+// visual odometry is too noisy to help the compositor's prediction.
+//-----------------------------------------------------------------------------
+class CPoseVelocityEstimator
+{
+public:
+	CPoseVelocityEstimator()
+		: m_flSmoothingTimeConstant(k_flDefaultSmoothingTimeConstant)
+	{
+		Reset();
+	}
+
+	/** Time constant of the exponential smoothing applied to the raw finite differences, in seconds */
+	void SetSmoothingTimeConstant(double flSeconds) { m_flSmoothingTimeConstant = flSeconds > 1e-4 ? flSeconds : 1e-4; }
+
+	void Reset()
+	{
+		m_ulLastTimestampNs = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			m_vecLastPosition[i] = 0.0;
+			m_vecVelocity[i] = 0.0;
+			m_vecAngularVelocity[i] = 0.0;
+		}
+		m_qLastRotation = HmdQuaternion_Identity();
+	}
+
+	/** Feeds a new tracked sample. Duplicate or out-of-order timestamps are ignored,
+	* and a gap longer than k_flMaxSampleGap restarts the estimate from zero. */
+	void AddSample(const double vecPosition[3], const vr::HmdQuaternion_t& qRotation, uint64_t ulTimestampNs)
+	{
+		if (ulTimestampNs <= m_ulLastTimestampNs)
+			return;
+
+		double flDt = (ulTimestampNs - m_ulLastTimestampNs) * 1e-9;
+		bool bContinuous = m_ulLastTimestampNs != 0 && flDt <= k_flMaxSampleGap;
+
+		if (bContinuous)
+		{
+			double flAlpha = 1.0 - exp(-flDt / m_flSmoothingTimeConstant);
+
+			for (int i = 0; i < 3; i++)
+			{
+				double flRaw = (vecPosition[i] - m_vecLastPosition[i]) / flDt;
+				m_vecVelocity[i] += flAlpha * (flRaw - m_vecVelocity[i]);
+			}
+
+			// world-space delta rotation: dq = q * q_last^-1, then axis-angle / dt
+			vr::HmdQuaternion_t qDelta = HmdQuaternion_Multiply(qRotation, HmdQuaternion_Conjugate(m_qLastRotation));
+			double dw = qDelta.w, dx = qDelta.x, dy = qDelta.y, dz = qDelta.z;
+			if (dw < 0.0)
+			{
+				// take the short way around
+				dw = -dw; dx = -dx; dy = -dy; dz = -dz;
+			}
+
+			double flSinHalf = sqrt(dx * dx + dy * dy + dz * dz);
+			double flScale = flSinHalf > 1e-9 ? 2.0 * atan2(flSinHalf, dw) / (flSinHalf * flDt) : 2.0 / flDt;
+			double vecRaw[3] = { dx * flScale, dy * flScale, dz * flScale };
+			for (int i = 0; i < 3; i++)
+				m_vecAngularVelocity[i] += flAlpha * (vecRaw[i] - m_vecAngularVelocity[i]);
+		}
+		else
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				m_vecVelocity[i] = 0.0;
+				m_vecAngularVelocity[i] = 0.0;
+			}
+		}
+
+		for (int i = 0; i < 3; i++)
+			m_vecLastPosition[i] = vecPosition[i];
+		m_qLastRotation = qRotation;
+		m_ulLastTimestampNs = ulTimestampNs;
+	}
+
+	const double* GetVelocity() const { return m_vecVelocity; }
+	const double* GetAngularVelocity() const { return m_vecAngularVelocity; }
+
+private:
+	// samples further apart than this are treated as a tracking gap
+	static constexpr double k_flMaxSampleGap = 0.1;
+	static constexpr double k_flDefaultSmoothingTimeConstant = 0.02;
+
+	double m_flSmoothingTimeConstant;
+
+	uint64_t m_ulLastTimestampNs;
+	double m_vecLastPosition[3];
+	vr::HmdQuaternion_t m_qLastRotation;
+	double m_vecVelocity[3];
+	double m_vecAngularVelocity[3];
+};
+
+#endif // POSEESTIMATOR_H
@@ -0,0 +1,157 @@
+#include "posefilter.h"
+#include "hmdmath.h"
+
+#include <math.h>
+#include <string.h>
+
+using namespace vr;
+
+// a gap longer than this restarts the filters rather than smoothing across it
+static const double k_flMaxFilterGap = 0.5;
+
+static const double k_flTwoPi = 2.0 * 3.14159265358979323846;
+
+// smoothing weight of a low-pass at flCutoff Hz over flDt seconds: t / (t + 1), t = 2 pi fc dt
+static double GetSmoothingWeight(double flCutoff, double flDt)
+{
+	double t = k_flTwoPi * flCutoff * flDt;
+	return t / (t + 1.0);
+}
+
+CPoseFilterBank::CPoseFilterBank()
+	: m_bEnabled(false)
+	, m_ulLastTimestampNs(0)
+{
+	m_params.flMinCutoff = 1.0;
+	m_params.flBeta = 0.0;
+	m_params.flDerivativeCutoff = 1.0;
+	Reset();
+}
+
+void CPoseFilterBank::Configure(bool bEnabled, const OneEuroParams_t& params)
+{
+	if (bEnabled != m_bEnabled)
+		Reset();
+	m_bEnabled = bEnabled;
+	m_params = params;
+}
+
+void CPoseFilterBank::Reset()
+{
+	m_ulLastTimestampNs = 0;
+	memset(m_rgbHaveState, 0, sizeof(m_rgbHaveState));
+	memset(m_rgflValue, 0, sizeof(m_rgflValue));
+	memset(m_rgflSpeed, 0, sizeof(m_rgflSpeed));
+	memset(m_rgflRaw, 0, sizeof(m_rgflRaw));
+	for (uint32_t i = 0; i < k_unMaxPoses; i++)
+	{
+		m_rgqRotation[i] = HmdQuaternion_Identity();
+		m_rgflAngularSpeed[i] = 0.0;
+	}
+}
+
+void CPoseFilterBank::Filter(DriverPose_t* pPoses, uint32_t unCount, uint64_t ulTimestampNs)
+{
+	if (!m_bEnabled)
+		return;
+	if (unCount > k_unMaxPoses)
+		unCount = k_unMaxPoses;
+
+	double flDt = m_ulLastTimestampNs != 0 && ulTimestampNs > m_ulLastTimestampNs ? (ulTimestampNs - m_ulLastTimestampNs) * 1e-9 : 0.0;
+	if (flDt <= 0.0 || flDt > k_flMaxFilterGap)
+	{
+		memset(m_rgbHaveState, 0, sizeof(m_rgbHaveState));
+		flDt = 0.0;
+	}
+	m_ulLastTimestampNs = ulTimestampNs;
+
+	// stage the inputs; a pose without history starts at its sample, the rest hold still
+	for (uint32_t i = 0; i < k_unMaxPoses; i++)
+	{
+		bool bValid = i < unCount && pPoses[i].poseIsValid;
+		if (i < unCount && !bValid)
+			m_rgbHaveState[i] = false;
+		for (int nAxis = 0; nAxis < 3; nAxis++)
+		{
+			uint32_t unLane = nAxis * k_unMaxPoses + i;
+			m_rgflRaw[unLane] = bValid ? pPoses[i].vecPosition[nAxis] : m_rgflValue[unLane];
+			if (bValid && !m_rgbHaveState[i])
+			{
+				m_rgflValue[unLane] = m_rgflRaw[unLane];
+				m_rgflSpeed[unLane] = 0.0;
+			}
+		}
+	}
+
+	if (flDt > 0.0)
+	{
+		// x' = x + a (raw - x), a from a cutoff that follows the smoothed speed
+		const double flDerivativeWeight = GetSmoothingWeight(m_params.flDerivativeCutoff, flDt);
+		const double flTwoPiDt = k_flTwoPi * flDt;
+		uint32_t unLane = 0;
+#if defined(HMDMATH_AVX)
+		const __m256d invDt = _mm256_set1_pd(1.0 / flDt), dWeight = _mm256_set1_pd(flDerivativeWeight);
+		const __m256d minCutoff = _mm256_set1_pd(m_params.flMinCutoff), beta = _mm256_set1_pd(m_params.flBeta);
+		const __m256d twoPiDt = _mm256_set1_pd(flTwoPiDt), one = _mm256_set1_pd(1.0), signMask = _mm256_set1_pd(-0.0);
+		for (; unLane + 4 <= k_unLanes; unLane += 4)
+		{
+			__m256d x = _mm256_loadu_pd(m_rgflValue + unLane), s = _mm256_loadu_pd(m_rgflSpeed + unLane);
+			__m256d delta = _mm256_sub_pd(_mm256_loadu_pd(m_rgflRaw + unLane), x);
+			s = _mm256_add_pd(s, _mm256_mul_pd(dWeight, _mm256_sub_pd(_mm256_mul_pd(delta, invDt), s)));
+			__m256d t = _mm256_mul_pd(twoPiDt, _mm256_add_pd(minCutoff, _mm256_mul_pd(beta, _mm256_andnot_pd(signMask, s))));
+			__m256d a = _mm256_div_pd(t, _mm256_add_pd(t, one));
+			_mm256_storeu_pd(m_rgflSpeed + unLane, s);
+			_mm256_storeu_pd(m_rgflValue + unLane, _mm256_add_pd(x, _mm256_mul_pd(a, delta)));
+		}
+#elif defined(HMDMATH_SSE2)
+		const __m128d invDt = _mm_set1_pd(1.0 / flDt), dWeight = _mm_set1_pd(flDerivativeWeight);
+		const __m128d minCutoff = _mm_set1_pd(m_params.flMinCutoff), beta = _mm_set1_pd(m_params.flBeta);
+		const __m128d twoPiDt = _mm_set1_pd(flTwoPiDt), one = _mm_set1_pd(1.0), signMask = _mm_set1_pd(-0.0);
+		for (; unLane + 2 <= k_unLanes; unLane += 2)
+		{
+			__m128d x = _mm_loadu_pd(m_rgflValue + unLane), s = _mm_loadu_pd(m_rgflSpeed + unLane);
+			__m128d delta = _mm_sub_pd(_mm_loadu_pd(m_rgflRaw + unLane), x);
+			s = _mm_add_pd(s, _mm_mul_pd(dWeight, _mm_sub_pd(_mm_mul_pd(delta, invDt), s)));
+			__m128d t = _mm_mul_pd(twoPiDt, _mm_add_pd(minCutoff, _mm_mul_pd(beta, _mm_andnot_pd(signMask, s))));
+			__m128d a = _mm_div_pd(t, _mm_add_pd(t, one));
+			_mm_storeu_pd(m_rgflSpeed + unLane, s);
+			_mm_storeu_pd(m_rgflValue + unLane, _mm_add_pd(x, _mm_mul_pd(a, delta)));
+		}
+#endif
+		for (; unLane < k_unLanes; unLane++)
+		{
+			double x = m_rgflValue[unLane];
+			double delta = m_rgflRaw[unLane] - x;
+			double s = m_rgflSpeed[unLane] + flDerivativeWeight * (delta / flDt - m_rgflSpeed[unLane]);
+			double t = flTwoPiDt * (m_params.flMinCutoff + m_params.flBeta * fabs(s));
+			m_rgflSpeed[unLane] = s;
+			m_rgflValue[unLane] = x + t / (t + 1.0) * delta;
+		}
+	}
+
+	for (uint32_t i = 0; i < unCount; i++)
+	{
+		DriverPose_t& pose = pPoses[i];
+		if (!pose.poseIsValid)
+			continue;
+
+		if (!m_rgbHaveState[i] || flDt <= 0.0)
+		{
+			m_rgqRotation[i] = pose.qRotation;
+			m_rgflAngularSpeed[i] = 0.0;
+		}
+		else
+		{
+			double flCos = fabs(HmdQuaternion_Dot(m_rgqRotation[i], pose.qRotation));
+			double flAngle = 2.0 * acos(flCos > 1.0 ? 1.0 : flCos);
+			m_rgflAngularSpeed[i] += GetSmoothingWeight(m_params.flDerivativeCutoff, flDt) * (flAngle / flDt - m_rgflAngularSpeed[i]);
+			double flWeight = GetSmoothingWeight(m_params.flMinCutoff + m_params.flBeta * m_rgflAngularSpeed[i], flDt);
+			m_rgqRotation[i] = HmdQuaternion_Slerp(m_rgqRotation[i], pose.qRotation, flWeight);
+		}
+		m_rgbHaveState[i] = true;
+
+		for (int nAxis = 0; nAxis < 3; nAxis++)
+			pose.vecPosition[nAxis] = m_rgflValue[nAxis * k_unMaxPoses + i];
+		pose.qRotation = m_rgqRotation[i];
+	}
+}
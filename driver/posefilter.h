@@ -0,0 +1,70 @@
+#ifndef POSEFILTER_H
+#define POSEFILTER_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+// Purpose: One-Euro filter parameters. The cutoff frequency (Hz) rises from
+// flMinCutoff by flBeta per unit of filtered speed (m/s, rad/s), so a still
+// device gets heavy smoothing and a moving one almost none. The speed itself
+// is smoothed at flDerivativeCutoff.
+//-----------------------------------------------------------------------------
+struct OneEuroParams_t
+{
+	double flMinCutoff;
+	double flBeta;
+	double flDerivativeCutoff;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: One-Euro filters for the positions and rotations of up to
+// k_unMaxPoses poses sampled together, e.g. the joints of one body detection,
+// or a single device.
+//
+// Positions are filtered per axis. All axes of all poses share dt and the
+// parameters, so the state is kept as one structure-of-arrays block and
+// filtered four (AVX) or two (SSE2) values per instruction. Rotations use the
+// same filter on the angle between the last filtered and the new rotation, and
+// slerp towards the new one by the resulting weight. Filtering is in place
+// on the caller's poses; nothing is allocated.
+//-----------------------------------------------------------------------------
+class CPoseFilterBank
+{
+public:
+	static const uint32_t k_unMaxPoses = 8;
+
+	CPoseFilterBank();
+
+	/** A change of parameters keeps the state; disabling forgets it */
+	void Configure(bool bEnabled, const OneEuroParams_t& params);
+
+	bool IsEnabled() const { return m_bEnabled; }
+
+	/** Forgets every pose's history, the next sample passes unfiltered */
+	void Reset();
+
+	/** Filters vecPosition and qRotation of unCount poses (at most k_unMaxPoses), all
+	* sampled at ulTimestampNs. Invalid poses pass through and restart their filter. */
+	void Filter(vr::DriverPose_t* pPoses, uint32_t unCount, uint64_t ulTimestampNs);
+
+private:
+	static const uint32_t k_unLanes = 3 * k_unMaxPoses; // axis-major: lane = axis * k_unMaxPoses + pose
+
+	bool m_bEnabled;
+	OneEuroParams_t m_params;
+	uint64_t m_ulLastTimestampNs;
+	bool m_rgbHaveState[k_unMaxPoses];
+
+	double m_rgflValue[k_unLanes]; // filtered position
+	double m_rgflSpeed[k_unLanes]; // filtered derivative
+	double m_rgflRaw[k_unLanes]; // this update's input
+
+	vr::HmdQuaternion_t m_rgqRotation[k_unMaxPoses];
+	double m_rgflAngularSpeed[k_unMaxPoses];
+};
+
+#endif // POSEFILTER_H
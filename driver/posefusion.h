@@ -0,0 +1,194 @@
+#ifndef POSEFUSION_H
+#define POSEFUSION_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <cmath>
+#include <cstdint>
+
+#include "hmdmath.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Joins visual odometry and IMU orientation into one consistent pose
+// at IMU rate, with both halves taken at the same instant.
+//
+// The IMU orientation is gravity aligned but has its own yaw reference and
+// drifts; visual rotation is in the tracking world but arrives a frame late.
+// Every visual sample is therefore compared with the IMU orientation
+// interpolated to the visual timestamp, and the rotation between the two
+// frames (qCorrection) is pulled towards that difference with a
+// complementary filter. Output rotation is qCorrection * IMU; output position
+// is the visual position carried forward to the requested time.
+//
+// Single threaded: owned by whichever thread publishes poses.
+//-----------------------------------------------------------------------------
+class CPoseFusion
+{
+public:
+	struct FusedPose_t
+	{
+		double vecPosition[3];
+		double vecVelocity[3];
+		vr::HmdQuaternion_t qRotation;
+	};
+
+	CPoseFusion()
+		: m_flCorrectionTimeConstant(k_flDefaultCorrectionTimeConstant)
+	{
+		Reset();
+	}
+
+	/** How quickly IMU drift is pulled towards visual odometry, in seconds */
+	void SetCorrectionTimeConstant(double flSeconds) { m_flCorrectionTimeConstant = flSeconds > 1e-3 ? flSeconds : 1e-3; }
+
+	void Reset()
+	{
+		m_unImuCount = 0;
+		m_unImuHead = 0;
+		m_ulVisualTimestampNs = 0;
+		m_bHasCorrection = false;
+		m_qCorrection = HmdQuaternion_Identity();
+		for (int i = 0; i < 3; i++)
+		{
+			m_vecPosition[i] = 0.0;
+			m_vecVelocity[i] = 0.0;
+		}
+	}
+
+	/** IMU fused orientation; samples must arrive in timestamp order */
+	void AddImuSample(const vr::HmdQuaternion_t& qRotation, uint64_t ulTimestampNs)
+	{
+		if (m_unImuCount > 0 && ulTimestampNs <= GetImuSample(m_unImuCount - 1).ulTimestampNs)
+			return;
+
+		m_rgImuHistory[m_unImuHead].qRotation = qRotation;
+		m_rgImuHistory[m_unImuHead].ulTimestampNs = ulTimestampNs;
+		m_unImuHead = (m_unImuHead + 1) % k_unImuHistorySize;
+		if (m_unImuCount < k_unImuHistorySize)
+			m_unImuCount++;
+	}
+
+	/** Visual odometry result; ignored if not newer than the previous one */
+	void AddVisualSample(const double vecPosition[3], const double vecVelocity[3], const vr::HmdQuaternion_t& qRotation, uint64_t ulTimestampNs)
+	{
+		if (ulTimestampNs <= m_ulVisualTimestampNs)
+			return;
+
+		double flDt = m_ulVisualTimestampNs ? (ulTimestampNs - m_ulVisualTimestampNs) * 1e-9 : 0.0;
+		for (int i = 0; i < 3; i++)
+		{
+			m_vecPosition[i] = vecPosition[i];
+			m_vecVelocity[i] = vecVelocity[i];
+		}
+		m_ulVisualTimestampNs = ulTimestampNs;
+
+		vr::HmdQuaternion_t qImu;
+		if (!GetImuRotation(ulTimestampNs, &qImu))
+			return;
+
+		// rotation that maps the IMU frame onto the visual frame at this instant
+		vr::HmdQuaternion_t qTarget = HmdQuaternion_Normalize(HmdQuaternion_Multiply(qRotation, HmdQuaternion_Conjugate(qImu)));
+		if (!m_bHasCorrection || flDt > k_flMaxVisualGap)
+		{
+			m_qCorrection = qTarget;
+			m_bHasCorrection = true;
+		}
+		else
+		{
+			m_qCorrection = HmdQuaternion_Slerp(m_qCorrection, qTarget, 1.0 - exp(-flDt / m_flCorrectionTimeConstant));
+		}
+	}
+
+	/** Pose at ulTimestampNs. False until both a visual and an IMU sample have been added. */
+	bool GetPose(uint64_t ulTimestampNs, FusedPose_t* pPose) const
+	{
+		vr::HmdQuaternion_t qImu;
+		if (!m_bHasCorrection || !GetImuRotation(ulTimestampNs, &qImu))
+			return false;
+
+		pPose->qRotation = HmdQuaternion_Normalize(HmdQuaternion_Multiply(m_qCorrection, qImu));
+
+		double flExtrapolation = ((int64_t)ulTimestampNs - (int64_t)m_ulVisualTimestampNs) * 1e-9;
+		if (flExtrapolation < 0.0)
+			flExtrapolation = 0.0;
+		else if (flExtrapolation > k_flMaxPositionExtrapolation)
+			flExtrapolation = k_flMaxPositionExtrapolation;
+
+		for (int i = 0; i < 3; i++)
+		{
+			pPose->vecPosition[i] = m_vecPosition[i] + m_vecVelocity[i] * flExtrapolation;
+			pPose->vecVelocity[i] = m_vecVelocity[i];
+		}
+		return true;
+	}
+
+	/** Maps an orientation from the IMU frame into the tracking world */
+	vr::HmdQuaternion_t GetCorrection() const { return m_qCorrection; }
+
+private:
+	struct ImuSample_t
+	{
+		vr::HmdQuaternion_t qRotation;
+		uint64_t ulTimestampNs;
+	};
+
+	// 400 Hz IMU: ~0.6 s of history, several camera frames of latency
+	static const uint32_t k_unImuHistorySize = 256;
+	static constexpr double k_flDefaultCorrectionTimeConstant = 0.5;
+	// visual samples further apart than this snap the correction instead of blending
+	static constexpr double k_flMaxVisualGap = 0.5;
+	// upper bound for carrying the visual position forward
+	static constexpr double k_flMaxPositionExtrapolation = 0.05;
+
+	// i = 0 is the oldest sample still held
+	const ImuSample_t& GetImuSample(uint32_t i) const
+	{
+		return m_rgImuHistory[(m_unImuHead + k_unImuHistorySize - m_unImuCount + i) % k_unImuHistorySize];
+	}
+
+	// IMU orientation interpolated to ulTimestampNs, clamped to the history held
+	bool GetImuRotation(uint64_t ulTimestampNs, vr::HmdQuaternion_t* pqRotation) const
+	{
+		if (m_unImuCount == 0)
+			return false;
+
+		const ImuSample_t& newest = GetImuSample(m_unImuCount - 1);
+		if (ulTimestampNs >= newest.ulTimestampNs)
+		{
+			*pqRotation = newest.qRotation;
+			return true;
+		}
+
+		// samples are in order and recent times are the common query, so walk back from the newest
+		for (uint32_t i = m_unImuCount - 1; i > 0; i--)
+		{
+			const ImuSample_t& before = GetImuSample(i - 1);
+			if (before.ulTimestampNs <= ulTimestampNs)
+			{
+				const ImuSample_t& after = GetImuSample(i);
+				double t = (double)(ulTimestampNs - before.ulTimestampNs) / (double)(after.ulTimestampNs - before.ulTimestampNs);
+				*pqRotation = HmdQuaternion_Slerp(before.qRotation, after.qRotation, t);
+				return true;
+			}
+		}
+
+		*pqRotation = GetImuSample(0).qRotation;
+		return true;
+	}
+
+	ImuSample_t m_rgImuHistory[k_unImuHistorySize];
+	uint32_t m_unImuCount;
+	uint32_t m_unImuHead;
+
+	uint64_t m_ulVisualTimestampNs;
+	double m_vecPosition[3];
+	double m_vecVelocity[3];
+
+	vr::HmdQuaternion_t m_qCorrection;
+	bool m_bHasCorrection;
+	double m_flCorrectionTimeConstant;
+};
+
+#endif // POSEFUSION_H
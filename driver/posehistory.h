@@ -0,0 +1,204 @@
+#ifndef POSEHISTORY_H
+#define POSEHISTORY_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "hmdmath.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: One published pose as kept by CPoseHistory. Angular velocity is in
+// world space, like DriverPose_t::vecAngularVelocity.
+//-----------------------------------------------------------------------------
+struct PoseHistorySample_t
+{
+	uint64_t ulTimestampNs;
+	double vecPosition[3];
+	double vecVelocity[3];
+	vr::HmdQuaternion_t qRotation;
+	double vecAngularVelocity[3];
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Fixed-capacity ring of the most recent published poses, with a
+// "pose at time t" query for anything that needs the head somewhere other
+// than at the latest sample (GetPose, streaming, compositing).
+//
+// Single writer, any number of readers, no locks or allocation. Every slot is
+// a small sequence lock that also records which write filled it, so a reader
+// that races the writer around the ring notices and starts over. Between two
+// samples the query interpolates (lerp, slerp); after the newest it
+// extrapolates with the newest velocities for at most k_flMaxExtrapolation.
+//-----------------------------------------------------------------------------
+class CPoseHistory
+{
+public:
+	// ~1.3 s at the 800 Hz the IMU publisher can reach
+	static const uint32_t k_unCapacity = 1024;
+
+	CPoseHistory()
+		: m_ulWriteCount(0)
+		, m_ulFirstValid(0)
+	{
+		for (uint32_t i = 0; i < k_unCapacity; i++)
+		{
+			m_rgSlots[i].ulSequence.store(0, std::memory_order_relaxed);
+			memset(&m_rgSlots[i].sample, 0, sizeof(m_rgSlots[i].sample));
+		}
+	}
+
+	/** Appends a sample; timestamps must increase. Writer thread only. */
+	void Write(const PoseHistorySample_t& sample)
+	{
+		uint64_t ulIndex = m_ulWriteCount.load(std::memory_order_relaxed);
+		Slot_t& slot = m_rgSlots[ulIndex % k_unCapacity];
+
+		// odd while the slot is being written, then 2 * (index + 1)
+		slot.ulSequence.store(2 * ulIndex + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		memcpy(&slot.sample, &sample, sizeof(sample));
+		slot.ulSequence.store(2 * ulIndex + 2, std::memory_order_release);
+
+		m_ulWriteCount.store(ulIndex + 1, std::memory_order_release);
+	}
+
+	/** Forgets everything written so far, e.g. when tracking is lost. Writer thread only. */
+	void Clear()
+	{
+		m_ulFirstValid.store(m_ulWriteCount.load(std::memory_order_relaxed), std::memory_order_release);
+	}
+
+	/** Newest sample; false if there is none */
+	bool GetLatest(PoseHistorySample_t* pOut) const
+	{
+		for (;;)
+		{
+			uint64_t ulEnd = m_ulWriteCount.load(std::memory_order_acquire);
+			if (ulEnd <= m_ulFirstValid.load(std::memory_order_acquire))
+				return false;
+			if (ReadSlot(ulEnd - 1, pOut))
+				return true;
+		}
+	}
+
+	/** Pose at ulTimestampNs. False if the time is older than the history held,
+	* or more than k_flMaxExtrapolation past the newest sample. */
+	bool Query(uint64_t ulTimestampNs, PoseHistorySample_t* pOut) const
+	{
+		for (;;)
+		{
+			uint64_t ulEnd = m_ulWriteCount.load(std::memory_order_acquire);
+			uint64_t ulBegin = m_ulFirstValid.load(std::memory_order_acquire);
+			if (ulEnd > k_unCapacity && ulBegin < ulEnd - k_unCapacity)
+				ulBegin = ulEnd - k_unCapacity;
+			if (ulEnd <= ulBegin)
+				return false;
+
+			PoseHistorySample_t newest;
+			if (!ReadSlot(ulEnd - 1, &newest))
+				continue;
+			if (ulTimestampNs >= newest.ulTimestampNs)
+				return Extrapolate(newest, ulTimestampNs, pOut);
+
+			// binary search for the last sample at or before ulTimestampNs
+			uint64_t ulLow = ulBegin, ulHigh = ulEnd - 1;
+			PoseHistorySample_t before;
+			if (!ReadSlot(ulLow, &before))
+				continue;
+			if (ulTimestampNs < before.ulTimestampNs)
+				return false;
+
+			bool bTorn = false;
+			while (ulHigh - ulLow > 1)
+			{
+				uint64_t ulMid = ulLow + (ulHigh - ulLow) / 2;
+				PoseHistorySample_t mid;
+				if (!ReadSlot(ulMid, &mid))
+				{
+					bTorn = true;
+					break;
+				}
+				if (mid.ulTimestampNs <= ulTimestampNs)
+				{
+					ulLow = ulMid;
+					before = mid;
+				}
+				else
+				{
+					ulHigh = ulMid;
+				}
+			}
+
+			PoseHistorySample_t after;
+			if (bTorn || !ReadSlot(ulLow, &before) || !ReadSlot(ulHigh, &after))
+				continue;
+
+			Interpolate(before, after, ulTimestampNs, pOut);
+			return true;
+		}
+	}
+
+private:
+	static constexpr double k_flMaxExtrapolation = 0.1;
+
+	struct Slot_t
+	{
+		std::atomic<uint64_t> ulSequence;
+		PoseHistorySample_t sample;
+	};
+
+	// copies the sample of write number ulIndex; false if it has been overwritten or is being written
+	bool ReadSlot(uint64_t ulIndex, PoseHistorySample_t* pOut) const
+	{
+		const Slot_t& slot = m_rgSlots[ulIndex % k_unCapacity];
+		uint64_t ulExpected = 2 * ulIndex + 2;
+		if (slot.ulSequence.load(std::memory_order_acquire) != ulExpected)
+			return false;
+		memcpy(pOut, &slot.sample, sizeof(*pOut));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return slot.ulSequence.load(std::memory_order_relaxed) == ulExpected;
+	}
+
+	static void Interpolate(const PoseHistorySample_t& a, const PoseHistorySample_t& b, uint64_t ulTimestampNs, PoseHistorySample_t* pOut)
+	{
+		double t = b.ulTimestampNs > a.ulTimestampNs ? (double)(ulTimestampNs - a.ulTimestampNs) / (double)(b.ulTimestampNs - a.ulTimestampNs) : 0.0;
+		pOut->ulTimestampNs = ulTimestampNs;
+		for (int i = 0; i < 3; i++)
+		{
+			pOut->vecPosition[i] = a.vecPosition[i] + (b.vecPosition[i] - a.vecPosition[i]) * t;
+			pOut->vecVelocity[i] = a.vecVelocity[i] + (b.vecVelocity[i] - a.vecVelocity[i]) * t;
+			pOut->vecAngularVelocity[i] = a.vecAngularVelocity[i] + (b.vecAngularVelocity[i] - a.vecAngularVelocity[i]) * t;
+		}
+		pOut->qRotation = HmdQuaternion_Slerp(a.qRotation, b.qRotation, t);
+	}
+
+	static bool Extrapolate(const PoseHistorySample_t& newest, uint64_t ulTimestampNs, PoseHistorySample_t* pOut)
+	{
+		double flDt = (ulTimestampNs - newest.ulTimestampNs) * 1e-9;
+		if (flDt > k_flMaxExtrapolation)
+			return false;
+
+		*pOut = newest;
+		pOut->ulTimestampNs = ulTimestampNs;
+		double vecRotation[3];
+		for (int i = 0; i < 3; i++)
+		{
+			pOut->vecPosition[i] += newest.vecVelocity[i] * flDt;
+			vecRotation[i] = newest.vecAngularVelocity[i] * flDt;
+		}
+		// world-space angular velocity applies on the left
+		pOut->qRotation = HmdQuaternion_Normalize(HmdQuaternion_Multiply(HmdQuaternion_FromRotationVector(vecRotation), newest.qRotation));
+		return true;
+	}
+
+	Slot_t m_rgSlots[k_unCapacity];
+	std::atomic<uint64_t> m_ulWriteCount;
+	std::atomic<uint64_t> m_ulFirstValid;
+};
+
+#endif // POSEHISTORY_H
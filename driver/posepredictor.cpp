@@ -0,0 +1,276 @@
+#include "posepredictor.h"
+#include "hmdmath.h"
+
+#include <math.h>
+#include <string.h>
+
+using namespace vr;
+
+// a gap longer than this restarts the filters rather than predicting across it
+static const double k_flMaxUpdateGap = 0.5;
+
+// furthest Predict extrapolates, whatever it is asked for
+static const double k_flMaxPredictionSeconds = 0.1;
+
+// measurement noise of the published poses: ZED visual odometry fused with the IMU
+static const double k_flPositionNoise = 0.002; // m
+static const double k_flRotationNoise = 0.002; // rad
+
+// uncertainty of a pose's first update, which starts at rest
+static const double k_flStartVelocity = 1.0; // m/s
+static const double k_flStartAcceleration = 10.0; // m/s^2
+static const double k_flStartAngularVelocity = 3.0; // rad/s
+
+// the lane operations, AVX or SSE2 as hmdmath.h found them, one double otherwise
+#if defined(HMDMATH_AVX)
+typedef __m256d Lanes_t;
+static const uint32_t k_unLaneWidth = 4;
+static inline Lanes_t LanesLoad(const double* p) { return _mm256_loadu_pd(p); }
+static inline void LanesStore(double* p, Lanes_t a) { _mm256_storeu_pd(p, a); }
+static inline Lanes_t LanesSet(double f) { return _mm256_set1_pd(f); }
+static inline Lanes_t LanesAdd(Lanes_t a, Lanes_t b) { return _mm256_add_pd(a, b); }
+static inline Lanes_t LanesSub(Lanes_t a, Lanes_t b) { return _mm256_sub_pd(a, b); }
+static inline Lanes_t LanesMul(Lanes_t a, Lanes_t b) { return _mm256_mul_pd(a, b); }
+static inline Lanes_t LanesDiv(Lanes_t a, Lanes_t b) { return _mm256_div_pd(a, b); }
+#elif defined(HMDMATH_SSE2)
+typedef __m128d Lanes_t;
+static const uint32_t k_unLaneWidth = 2;
+static inline Lanes_t LanesLoad(const double* p) { return _mm_loadu_pd(p); }
+static inline void LanesStore(double* p, Lanes_t a) { _mm_storeu_pd(p, a); }
+static inline Lanes_t LanesSet(double f) { return _mm_set1_pd(f); }
+static inline Lanes_t LanesAdd(Lanes_t a, Lanes_t b) { return _mm_add_pd(a, b); }
+static inline Lanes_t LanesSub(Lanes_t a, Lanes_t b) { return _mm_sub_pd(a, b); }
+static inline Lanes_t LanesMul(Lanes_t a, Lanes_t b) { return _mm_mul_pd(a, b); }
+static inline Lanes_t LanesDiv(Lanes_t a, Lanes_t b) { return _mm_div_pd(a, b); }
+#else
+typedef double Lanes_t;
+static const uint32_t k_unLaneWidth = 1;
+static inline Lanes_t LanesLoad(const double* p) { return *p; }
+static inline void LanesStore(double* p, Lanes_t a) { *p = a; }
+static inline Lanes_t LanesSet(double f) { return f; }
+static inline Lanes_t LanesAdd(Lanes_t a, Lanes_t b) { return a + b; }
+static inline Lanes_t LanesSub(Lanes_t a, Lanes_t b) { return a - b; }
+static inline Lanes_t LanesMul(Lanes_t a, Lanes_t b) { return a * b; }
+static inline Lanes_t LanesDiv(Lanes_t a, Lanes_t b) { return a / b; }
+#endif
+
+CPosePredictorBank::CPosePredictorBank()
+	: m_bEnabled(false)
+	, m_ulLastTimestampNs(0)
+{
+	m_params.flJerk = 1.0;
+	m_params.flAngularAcceleration = 1.0;
+	Reset();
+}
+
+void CPosePredictorBank::Configure(bool bEnabled, const PredictorParams_t& params)
+{
+	if (bEnabled != m_bEnabled)
+		Reset();
+	m_bEnabled = bEnabled;
+	m_params = params;
+}
+
+void CPosePredictorBank::Reset()
+{
+	m_ulLastTimestampNs = 0;
+	memset(m_rgbHaveState, 0, sizeof(m_rgbHaveState));
+	for (uint32_t i = 0; i < k_unMaxPoses; i++)
+	{
+		DriverPose_t rest = {};
+		rest.qRotation = HmdQuaternion_Identity();
+		StartPose(i, rest);
+	}
+}
+
+void CPosePredictorBank::StartPose(uint32_t unPose, const DriverPose_t& pose)
+{
+	for (int nAxis = 0; nAxis < 3; nAxis++)
+	{
+		uint32_t unLane = nAxis * k_unMaxPoses + unPose;
+		m_rgflPosition[unLane] = pose.vecPosition[nAxis];
+		m_rgflVelocity[unLane] = 0.0;
+		m_rgflAcceleration[unLane] = 0.0;
+		m_rgflP00[unLane] = k_flPositionNoise * k_flPositionNoise;
+		m_rgflP01[unLane] = m_rgflP02[unLane] = m_rgflP12[unLane] = 0.0;
+		m_rgflP11[unLane] = k_flStartVelocity * k_flStartVelocity;
+		m_rgflP22[unLane] = k_flStartAcceleration * k_flStartAcceleration;
+		m_rgflMeasured[unLane] = pose.vecPosition[nAxis];
+
+		m_rgflAngularVelocity[unLane] = 0.0;
+		m_rgflR00[unLane] = k_flRotationNoise * k_flRotationNoise;
+		m_rgflR01[unLane] = 0.0;
+		m_rgflR11[unLane] = k_flStartAngularVelocity * k_flStartAngularVelocity;
+		m_rgflRotationError[unLane] = 0.0;
+	}
+	m_rgqRotation[unPose] = pose.qRotation;
+}
+
+void CPosePredictorBank::Update(const DriverPose_t* pPoses, uint32_t unCount, uint64_t ulTimestampNs)
+{
+	if (!m_bEnabled)
+		return;
+	if (unCount > k_unMaxPoses)
+		unCount = k_unMaxPoses;
+
+	double flDt = m_ulLastTimestampNs != 0 && ulTimestampNs > m_ulLastTimestampNs ? (ulTimestampNs - m_ulLastTimestampNs) * 1e-9 : 0.0;
+	if (flDt <= 0.0 || flDt > k_flMaxUpdateGap)
+	{
+		memset(m_rgbHaveState, 0, sizeof(m_rgbHaveState));
+		flDt = 0.0;
+	}
+	m_ulLastTimestampNs = ulTimestampNs;
+
+	// stage the measurements: the position, and the rotation from the predicted one to the
+	// measured one. Lanes without a measurement run along and are restarted afterwards.
+	for (uint32_t i = 0; i < k_unMaxPoses; i++)
+	{
+		if (i >= unCount || !pPoses[i].poseIsValid)
+			m_rgbHaveState[i] = false;
+		if (!m_rgbHaveState[i])
+			continue;
+
+		double vecStep[3], vecError[3];
+		for (int nAxis = 0; nAxis < 3; nAxis++)
+		{
+			uint32_t unLane = nAxis * k_unMaxPoses + i;
+			m_rgflMeasured[unLane] = pPoses[i].vecPosition[nAxis];
+			vecStep[nAxis] = m_rgflAngularVelocity[unLane] * flDt;
+		}
+		m_rgqRotation[i] = HmdQuaternion_Normalize(HmdQuaternion_Multiply(HmdQuaternion_FromRotationVector(vecStep), m_rgqRotation[i]));
+		HmdQuaternion_ToRotationVector(HmdQuaternion_Multiply(pPoses[i].qRotation, HmdQuaternion_Conjugate(m_rgqRotation[i])), vecError);
+		for (int nAxis = 0; nAxis < 3; nAxis++)
+			m_rgflRotationError[nAxis * k_unMaxPoses + i] = vecError[nAxis];
+	}
+
+	if (flDt > 0.0)
+	{
+		const double h = flDt, h2 = 0.5 * flDt * flDt;
+
+		// white jerk q over dt: q [dt^5/20 dt^4/8 dt^3/6; dt^3/3 dt^2/2; dt]
+		const double q = m_params.flJerk * m_params.flJerk;
+		const Lanes_t dt = LanesSet(h), halfDt2 = LanesSet(h2);
+		const Lanes_t q00 = LanesSet(q * pow(h, 5) / 20.0), q01 = LanesSet(q * pow(h, 4) / 8.0), q02 = LanesSet(q * pow(h, 3) / 6.0);
+		const Lanes_t q11 = LanesSet(q * pow(h, 3) / 3.0), q12 = LanesSet(q * h * h / 2.0), q22 = LanesSet(q * h);
+		const Lanes_t r = LanesSet(k_flPositionNoise * k_flPositionNoise);
+		for (uint32_t unLane = 0; unLane < k_unLanes; unLane += k_unLaneWidth)
+		{
+			Lanes_t x = LanesLoad(m_rgflPosition + unLane), v = LanesLoad(m_rgflVelocity + unLane), a = LanesLoad(m_rgflAcceleration + unLane);
+			Lanes_t p00 = LanesLoad(m_rgflP00 + unLane), p01 = LanesLoad(m_rgflP01 + unLane), p02 = LanesLoad(m_rgflP02 + unLane);
+			Lanes_t p11 = LanesLoad(m_rgflP11 + unLane), p12 = LanesLoad(m_rgflP12 + unLane), p22 = LanesLoad(m_rgflP22 + unLane);
+
+			// x = F x, P = F P F' + Q with F = [1 dt dt^2/2; 0 1 dt; 0 0 1]
+			x = LanesAdd(x, LanesAdd(LanesMul(dt, v), LanesMul(halfDt2, a)));
+			v = LanesAdd(v, LanesMul(dt, a));
+			Lanes_t a00 = LanesAdd(p00, LanesAdd(LanesMul(dt, p01), LanesMul(halfDt2, p02)));
+			Lanes_t a01 = LanesAdd(p01, LanesAdd(LanesMul(dt, p11), LanesMul(halfDt2, p12)));
+			Lanes_t a02 = LanesAdd(p02, LanesAdd(LanesMul(dt, p12), LanesMul(halfDt2, p22)));
+			Lanes_t a11 = LanesAdd(p11, LanesMul(dt, p12));
+			Lanes_t a12 = LanesAdd(p12, LanesMul(dt, p22));
+			p00 = LanesAdd(LanesAdd(a00, LanesAdd(LanesMul(dt, a01), LanesMul(halfDt2, a02))), q00);
+			p01 = LanesAdd(LanesAdd(a01, LanesMul(dt, a02)), q01);
+			p02 = LanesAdd(a02, q02);
+			p11 = LanesAdd(LanesAdd(a11, LanesMul(dt, a12)), q11);
+			p12 = LanesAdd(a12, q12);
+			p22 = LanesAdd(p22, q22);
+
+			// measuring the position: K = P[0] / (P00 + r)
+			Lanes_t s = LanesAdd(p00, r);
+			Lanes_t k0 = LanesDiv(p00, s), k1 = LanesDiv(p01, s), k2 = LanesDiv(p02, s);
+			Lanes_t y = LanesSub(LanesLoad(m_rgflMeasured + unLane), x);
+			LanesStore(m_rgflPosition + unLane, LanesAdd(x, LanesMul(k0, y)));
+			LanesStore(m_rgflVelocity + unLane, LanesAdd(v, LanesMul(k1, y)));
+			LanesStore(m_rgflAcceleration + unLane, LanesAdd(a, LanesMul(k2, y)));
+			LanesStore(m_rgflP11 + unLane, LanesSub(p11, LanesMul(k1, p01)));
+			LanesStore(m_rgflP12 + unLane, LanesSub(p12, LanesMul(k1, p02)));
+			LanesStore(m_rgflP22 + unLane, LanesSub(p22, LanesMul(k2, p02)));
+			LanesStore(m_rgflP00 + unLane, LanesSub(p00, LanesMul(k0, p00)));
+			LanesStore(m_rgflP01 + unLane, LanesSub(p01, LanesMul(k0, p01)));
+			LanesStore(m_rgflP02 + unLane, LanesSub(p02, LanesMul(k0, p02)));
+		}
+
+		// white angular acceleration over dt: q [dt^3/3 dt^2/2; dt]; the error is 0 after each update
+		const double qa = m_params.flAngularAcceleration * m_params.flAngularAcceleration;
+		const Lanes_t twoDt = LanesSet(2.0 * h), dtSquared = LanesSet(h * h);
+		const Lanes_t qr00 = LanesSet(qa * pow(h, 3) / 3.0), qr01 = LanesSet(qa * h * h / 2.0), qr11 = LanesSet(qa * h);
+		const Lanes_t rr = LanesSet(k_flRotationNoise * k_flRotationNoise);
+		for (uint32_t unLane = 0; unLane < k_unLanes; unLane += k_unLaneWidth)
+		{
+			Lanes_t w = LanesLoad(m_rgflAngularVelocity + unLane);
+			Lanes_t r00 = LanesLoad(m_rgflR00 + unLane), r01 = LanesLoad(m_rgflR01 + unLane), r11 = LanesLoad(m_rgflR11 + unLane);
+
+			r00 = LanesAdd(LanesAdd(r00, LanesAdd(LanesMul(twoDt, r01), LanesMul(dtSquared, r11))), qr00);
+			r01 = LanesAdd(LanesAdd(r01, LanesMul(dt, r11)), qr01);
+			r11 = LanesAdd(r11, qr11);
+
+			Lanes_t s = LanesAdd(r00, rr);
+			Lanes_t k0 = LanesDiv(r00, s), k1 = LanesDiv(r01, s);
+			Lanes_t y = LanesLoad(m_rgflRotationError + unLane);
+			LanesStore(m_rgflRotationError + unLane, LanesMul(k0, y));
+			LanesStore(m_rgflAngularVelocity + unLane, LanesAdd(w, LanesMul(k1, y)));
+			LanesStore(m_rgflR11 + unLane, LanesSub(r11, LanesMul(k1, r01)));
+			LanesStore(m_rgflR00 + unLane, LanesSub(r00, LanesMul(k0, r00)));
+			LanesStore(m_rgflR01 + unLane, LanesSub(r01, LanesMul(k0, r01)));
+		}
+	}
+
+	for (uint32_t i = 0; i < unCount; i++)
+	{
+		if (!pPoses[i].poseIsValid)
+			continue;
+		if (!m_rgbHaveState[i] || flDt <= 0.0)
+		{
+			StartPose(i, pPoses[i]);
+			m_rgbHaveState[i] = true;
+			continue;
+		}
+
+		double vecCorrection[3];
+		for (int nAxis = 0; nAxis < 3; nAxis++)
+			vecCorrection[nAxis] = m_rgflRotationError[nAxis * k_unMaxPoses + i];
+		m_rgqRotation[i] = HmdQuaternion_Normalize(HmdQuaternion_Multiply(HmdQuaternion_FromRotationVector(vecCorrection), m_rgqRotation[i]));
+	}
+}
+
+double CPosePredictorBank::Predict(DriverPose_t* pPoses, uint32_t unCount, double flSeconds) const
+{
+	if (!m_bEnabled)
+		return 0.0;
+	if (unCount > k_unMaxPoses)
+		unCount = k_unMaxPoses;
+	if (flSeconds < 0.0)
+		flSeconds = 0.0;
+	else if (flSeconds > k_flMaxPredictionSeconds)
+		flSeconds = k_flMaxPredictionSeconds;
+
+	double rgflPosition[k_unLanes], rgflVelocity[k_unLanes], rgflStep[k_unLanes];
+	const Lanes_t t = LanesSet(flSeconds), halfT2 = LanesSet(0.5 * flSeconds * flSeconds);
+	for (uint32_t unLane = 0; unLane < k_unLanes; unLane += k_unLaneWidth)
+	{
+		Lanes_t v = LanesLoad(m_rgflVelocity + unLane), a = LanesLoad(m_rgflAcceleration + unLane);
+		LanesStore(rgflPosition + unLane, LanesAdd(LanesLoad(m_rgflPosition + unLane), LanesAdd(LanesMul(t, v), LanesMul(halfT2, a))));
+		LanesStore(rgflVelocity + unLane, LanesAdd(v, LanesMul(t, a)));
+		LanesStore(rgflStep + unLane, LanesMul(t, LanesLoad(m_rgflAngularVelocity + unLane)));
+	}
+
+	for (uint32_t i = 0; i < unCount; i++)
+	{
+		DriverPose_t& pose = pPoses[i];
+		if (!pose.poseIsValid || !m_rgbHaveState[i])
+			continue;
+
+		double vecStep[3];
+		for (int nAxis = 0; nAxis < 3; nAxis++)
+		{
+			uint32_t unLane = nAxis * k_unMaxPoses + i;
+			pose.vecPosition[nAxis] = rgflPosition[unLane];
+			pose.vecVelocity[nAxis] = rgflVelocity[unLane];
+			pose.vecAcceleration[nAxis] = m_rgflAcceleration[unLane];
+			pose.vecAngularVelocity[nAxis] = m_rgflAngularVelocity[unLane];
+			pose.vecAngularAcceleration[nAxis] = 0.0;
+			vecStep[nAxis] = rgflStep[unLane];
+		}
+		pose.qRotation = HmdQuaternion_Normalize(HmdQuaternion_Multiply(HmdQuaternion_FromRotationVector(vecStep), m_rgqRotation[i]));
+	}
+	return flSeconds;
+}
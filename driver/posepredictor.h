@@ -0,0 +1,87 @@
+#ifndef POSEPREDICTOR_H
+#define POSEPREDICTOR_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+// Purpose: Kalman predictor noise. Motion is modelled as constant
+// acceleration disturbed by white jerk, and rotation as constant angular
+// velocity disturbed by white angular acceleration; larger values follow
+// changes of motion sooner and smooth less.
+//-----------------------------------------------------------------------------
+struct PredictorParams_t
+{
+	double flJerk; // m/s^3 per sqrt(Hz)
+	double flAngularAcceleration; // rad/s^2 per sqrt(Hz)
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Kalman predictors for the poses of up to k_unMaxPoses devices
+// sampled together, e.g. one camera or the joints of a body. Update feeds the
+// published poses; Predict extrapolates them to any time up to
+// k_flMaxPredictionSeconds after the last update, just before submission.
+//
+// Every position axis is its own filter on position, velocity and
+// acceleration. Rotation is filtered the same way, per world axis on the
+// error between the predicted and the measured rotation, with the angular
+// velocity; the error is folded back into the quaternion after each update.
+// All axes of all poses share dt and the noise, so the state is kept as one
+// structure-of-arrays block, axis-major like CPoseFilterBank, and stepped
+// four (AVX) or two (SSE2) lanes per instruction. Nothing is allocated.
+//
+// Not thread safe: callers serialize Update and Predict.
+//-----------------------------------------------------------------------------
+class CPosePredictorBank
+{
+public:
+	static const uint32_t k_unMaxPoses = 8;
+
+	CPosePredictorBank();
+
+	/** A change of parameters keeps the state; disabling forgets it */
+	void Configure(bool bEnabled, const PredictorParams_t& params);
+
+	bool IsEnabled() const { return m_bEnabled; }
+
+	/** Forgets every pose's state, the next update starts them at rest */
+	void Reset();
+
+	/** unCount poses (at most k_unMaxPoses), all sampled at ulTimestampNs. Invalid poses,
+	* and poses past unCount, restart their filters. */
+	void Update(const vr::DriverPose_t* pPoses, uint32_t unCount, uint64_t ulTimestampNs);
+
+	/** Replaces the motion of the valid poses among the first unCount by their state
+	* flSeconds after the last update: position, rotation, and their derivatives.
+	* Returns the seconds actually predicted, flSeconds clamped to [0, 0.1]. */
+	double Predict(vr::DriverPose_t* pPoses, uint32_t unCount, double flSeconds) const;
+
+private:
+	static const uint32_t k_unLanes = 3 * k_unMaxPoses; // axis-major: lane = axis * k_unMaxPoses + pose
+
+	void StartPose(uint32_t unPose, const vr::DriverPose_t& pose);
+
+	bool m_bEnabled;
+	PredictorParams_t m_params;
+	uint64_t m_ulLastTimestampNs;
+	bool m_rgbHaveState[k_unMaxPoses];
+
+	// position, and its covariance as the upper triangle of a 3x3
+	double m_rgflPosition[k_unLanes];
+	double m_rgflVelocity[k_unLanes];
+	double m_rgflAcceleration[k_unLanes];
+	double m_rgflP00[k_unLanes], m_rgflP01[k_unLanes], m_rgflP02[k_unLanes];
+	double m_rgflP11[k_unLanes], m_rgflP12[k_unLanes], m_rgflP22[k_unLanes];
+	double m_rgflMeasured[k_unLanes]; // this update's position
+
+	// rotation: the quaternion, the angular velocity, and the 2x2 covariance of error and velocity
+	vr::HmdQuaternion_t m_rgqRotation[k_unMaxPoses];
+	double m_rgflAngularVelocity[k_unLanes];
+	double m_rgflR00[k_unLanes], m_rgflR01[k_unLanes], m_rgflR11[k_unLanes];
+	double m_rgflRotationError[k_unLanes]; // measured less predicted rotation in, the correction out
+};
+
+#endif // POSEPREDICTOR_H
@@ -0,0 +1,179 @@
+#include "poserecorder.h"
+
+#include <string.h>
+
+#include <chrono>
+#include <limits>
+
+static const std::chrono::milliseconds k_RecorderFlushInterval(5);
+
+CPoseRecorder::CPoseRecorder()
+	: m_pFile(nullptr)
+	, m_pWriterThread(nullptr)
+	, m_bRunning(false)
+	, m_pRing(nullptr)
+	, m_unEnqueuePos(0)
+	, m_unDequeuePos(0)
+	, m_ulDropped(0)
+	, m_ulLastTimestampNs(0)
+	, m_bHeaderWritten(false)
+{
+}
+
+CPoseRecorder::~CPoseRecorder()
+{
+	Close();
+	delete[] m_pRing;
+}
+
+bool CPoseRecorder::Open(const char* pchPath)
+{
+	if (m_pFile)
+		return false;
+
+	m_pFile = fopen(pchPath, "wb");
+	if (!m_pFile)
+		return false;
+
+	if (!m_pRing)
+		m_pRing = new PendingRecord_t[k_unRingSize];
+	for (uint32_t i = 0; i < k_unRingSize; i++)
+		m_pRing[i].unSequence.store(i, std::memory_order_relaxed);
+	m_unEnqueuePos = 0;
+	m_unDequeuePos = 0;
+	m_ulLastTimestampNs = 0;
+	m_bHeaderWritten = false;
+
+	m_bRunning = true;
+	m_pWriterThread = new std::thread(&CPoseRecorder::RunWriter, this);
+	return true;
+}
+
+void CPoseRecorder::Close()
+{
+	if (!m_pWriterThread)
+		return;
+
+	m_bRunning = false;
+	m_pWriterThread->join();
+	delete m_pWriterThread;
+	m_pWriterThread = nullptr;
+
+	fclose(m_pFile);
+	m_pFile = nullptr;
+}
+
+void CPoseRecorder::Record(EPoseRecordType eType, uint64_t ulTimestampNs, const float* pflValues, uint32_t unValueCount, uint8_t unFlags)
+{
+	if (!m_bRunning.load(std::memory_order_relaxed))
+		return;
+
+	// claim a slot, same scheme as the driver log queue
+	uint32_t unPos = m_unEnqueuePos.load(std::memory_order_relaxed);
+	PendingRecord_t* pRecord;
+	for (;;)
+	{
+		pRecord = &m_pRing[unPos & (k_unRingSize - 1)];
+		int32_t nDiff = (int32_t)pRecord->unSequence.load(std::memory_order_acquire) - (int32_t)unPos;
+		if (nDiff == 0)
+		{
+			if (m_unEnqueuePos.compare_exchange_weak(unPos, unPos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (nDiff < 0)
+		{
+			m_ulDropped++;
+			return;
+		}
+		else
+		{
+			unPos = m_unEnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	pRecord->unType = (uint8_t)eType;
+	pRecord->unFlags = unFlags;
+	pRecord->ulTimestampNs = ulTimestampNs;
+	if (unValueCount > k_unPoseRecordValues)
+		unValueCount = k_unPoseRecordValues;
+	memcpy(pRecord->rgflValues, pflValues, unValueCount * sizeof(float));
+	memset(pRecord->rgflValues + unValueCount, 0, (k_unPoseRecordValues - unValueCount) * sizeof(float));
+
+	pRecord->unSequence.store(unPos + 1, std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Turns one pending record into one or two file records, prefixing a
+// sync record if the timestamp delta doesn't fit in 32 bits.
+//-----------------------------------------------------------------------------
+void CPoseRecorder::Encode(const PendingRecord_t& pending, PoseRecord_t* pOut, uint32_t* punCount)
+{
+	int64_t nDelta = (int64_t)(pending.ulTimestampNs - m_ulLastTimestampNs);
+	if (nDelta > std::numeric_limits<int32_t>::max() || nDelta < std::numeric_limits<int32_t>::min())
+	{
+		PoseRecord_t& sync = pOut[(*punCount)++];
+		memset(&sync, 0, sizeof(sync));
+		sync.unType = PoseRecord_Sync;
+		sync.ulAbsoluteTimestampNs = pending.ulTimestampNs;
+		nDelta = 0;
+	}
+
+	PoseRecord_t& record = pOut[(*punCount)++];
+	record.unType = pending.unType;
+	record.unFlags = pending.unFlags;
+	record.unReserved = 0;
+	record.nDeltaNs = (int32_t)nDelta;
+	memcpy(record.rgflValues, pending.rgflValues, sizeof(record.rgflValues));
+
+	m_ulLastTimestampNs = pending.ulTimestampNs;
+}
+
+uint32_t CPoseRecorder::Drain(PoseRecord_t* pOut, uint32_t unMaxRecords)
+{
+	uint32_t unCount = 0;
+	while (unCount + 2 <= unMaxRecords)
+	{
+		PendingRecord_t& pending = m_pRing[m_unDequeuePos & (k_unRingSize - 1)];
+		if (pending.unSequence.load(std::memory_order_acquire) != m_unDequeuePos + 1)
+			break;
+
+		if (!m_bHeaderWritten)
+		{
+			PoseRecordingHeader_t header;
+			header.unMagic = k_unPoseRecordingMagic;
+			header.unVersion = k_unPoseRecordingVersion;
+			header.unRecordSize = k_unPoseRecordSize;
+			header.unReserved = 0;
+			header.ulFirstTimestampNs = pending.ulTimestampNs;
+			fwrite(&header, sizeof(header), 1, m_pFile);
+			m_ulLastTimestampNs = pending.ulTimestampNs;
+			m_bHeaderWritten = true;
+		}
+
+		Encode(pending, pOut, &unCount);
+
+		pending.unSequence.store(m_unDequeuePos + k_unRingSize, std::memory_order_release);
+		m_unDequeuePos++;
+	}
+	return unCount;
+}
+
+void CPoseRecorder::RunWriter()
+{
+	PoseRecord_t rgBatch[k_unWriteBatch];
+
+	for (;;)
+	{
+		bool bRunning = m_bRunning.load();
+
+		uint32_t unCount;
+		while ((unCount = Drain(rgBatch, k_unWriteBatch)) != 0)
+			fwrite(rgBatch, sizeof(PoseRecord_t), unCount, m_pFile);
+		fflush(m_pFile);
+
+		// one more drain after Close() so nothing recorded before it is lost
+		if (!bRunning)
+			break;
+		std::this_thread::sleep_for(k_RecorderFlushInterval);
+	}
+}
@@ -0,0 +1,114 @@
+#ifndef POSERECORDER_H
+#define POSERECORDER_H
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+//-----------------------------------------------------------------------------
+// Recording file layout: PoseRecordingHeader_t, then PoseRecord_t entries, all
+// k_unPoseRecordSize bytes, in the order they were written. Each record stores
+// its timestamp as a signed nanosecond delta to the previous record; a
+// PoseRecord_Sync record carries an absolute timestamp whenever the delta
+// doesn't fit. Fixed-size records keep a memory-mapped file indexable.
+//-----------------------------------------------------------------------------
+static const uint32_t k_unPoseRecordingMagic = 0x525a5a5a; // "ZZZR"
+static const uint32_t k_unPoseRecordingVersion = 1;
+static const uint32_t k_unPoseRecordValues = 14;
+
+enum EPoseRecordType
+{
+	PoseRecord_Sync = 0,		// values unused; ulAbsoluteTimestampNs in place of the values
+	PoseRecord_Visual = 1,		// position[3], rotation wxyz[4], velocity[3], angular velocity[3]
+	PoseRecord_Imu = 2,			// rotation wxyz[4], gyro rad/s[3], acceleration m/s^2[3]
+	PoseRecord_Published = 3,	// position[3], rotation wxyz[4], velocity[3], angular velocity[3], poseTimeOffset
+};
+
+// PoseRecord_t::unFlags for PoseRecord_Published
+static const uint8_t k_unPoseRecordFlag_Valid = 0x01;
+static const uint8_t k_unPoseRecordFlag_Submitted = 0x02;
+
+#pragma pack( push, 1 )
+struct PoseRecordingHeader_t
+{
+	uint32_t unMagic;
+	uint32_t unVersion;
+	uint32_t unRecordSize;
+	uint32_t unReserved;
+	uint64_t ulFirstTimestampNs;	// the first record's delta is relative to this
+};
+
+struct PoseRecord_t
+{
+	uint8_t unType;
+	uint8_t unFlags;
+	uint16_t unReserved;
+	int32_t nDeltaNs;
+	union
+	{
+		float rgflValues[k_unPoseRecordValues];
+		uint64_t ulAbsoluteTimestampNs;
+	};
+};
+#pragma pack( pop )
+
+static const uint32_t k_unPoseRecordSize = sizeof(PoseRecord_t);
+
+//-----------------------------------------------------------------------------
+// Purpose: Append-only writer for the format above. Record() only copies into
+// a pre-allocated ring and never blocks; a background thread delta-encodes
+// and writes. When the writer falls behind by a whole ring, records are
+// dropped and counted rather than stalling the tracking threads.
+//-----------------------------------------------------------------------------
+class CPoseRecorder
+{
+public:
+	CPoseRecorder();
+	~CPoseRecorder();
+
+	bool Open(const char* pchPath);
+	void Close();
+	bool IsOpen() const { return m_bRunning.load(std::memory_order_relaxed); }
+
+	/** Safe to call from any thread; a no-op when no file is open. Missing values are zeroed. */
+	void Record(EPoseRecordType eType, uint64_t ulTimestampNs, const float* pflValues, uint32_t unValueCount, uint8_t unFlags = 0);
+
+	uint64_t GetDroppedCount() const { return m_ulDropped.load(std::memory_order_relaxed); }
+
+private:
+	struct PendingRecord_t
+	{
+		std::atomic<uint32_t> unSequence;
+		uint8_t unType;
+		uint8_t unFlags;
+		uint64_t ulTimestampNs;
+		float rgflValues[k_unPoseRecordValues];
+	};
+
+	static const uint32_t k_unRingSize = 4096; // must be a power of two; ~10 s of IMU-rate records
+	static const uint32_t k_unWriteBatch = 256;
+
+	void RunWriter();
+	uint32_t Drain(PoseRecord_t* pOut, uint32_t unMaxRecords);
+	void Encode(const PendingRecord_t& pending, PoseRecord_t* pOut, uint32_t* punCount);
+
+	FILE* m_pFile;
+	std::thread* m_pWriterThread;
+	std::atomic<bool> m_bRunning;
+
+	PendingRecord_t* m_pRing;
+	std::atomic<uint32_t> m_unEnqueuePos;
+	uint32_t m_unDequeuePos;
+	std::atomic<uint64_t> m_ulDropped;
+
+	// encoder state, writer thread only
+	uint64_t m_ulLastTimestampNs;
+	bool m_bHeaderWritten;
+};
+
+#endif // POSERECORDER_H
@@ -0,0 +1,917 @@
+#include "posestream.h"
+#include "driverlog.h"
+#include "udpsocket.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+using namespace vr;
+
+// how long the receive thread blocks at most, and so the play-out resolution
+static const uint32_t k_unReceiveTimeoutMs = 1;
+
+// without a datagram for this long the node is considered gone
+static const uint64_t k_ulLinkTimeoutNs = 500000000ull;
+
+// the clock offset is the minimum over k_unOffsetBuckets of these, a 2 s window
+static const uint64_t k_ulOffsetBucketNs = 250000000ull;
+
+// RFC 3550 jitter: each transit difference moves the estimate by 1/16
+static const double k_flJitterGain = 1.0 / 16.0;
+
+// skeletons come at the detection rate, the link loss needs no finer check
+static const uint32_t k_unSkeletonReceiveTimeoutMs = 10;
+
+// the largest skeleton datagram
+static const size_t k_unMaxSkeletonSize = sizeof(ZedSkeletonHeader_t) + k_nBodySkeletonJoints * sizeof(ZedCompactJoint_t);
+
+// the largest datagram of either version
+static const size_t k_unMaxDatagramSize = sizeof(ZedPoseBatchHeader_t) + k_unMaxPoseBatch * sizeof(ZedCompactPose_t);
+static_assert(k_unMaxDatagramSize >= sizeof(ZedPoseDatagram_t), "a batch is the largest datagram");
+
+// the three smallest quaternion components are within +-1/sqrt(2)
+static const double k_flRotationScale = 32767.0 * 1.41421356237309504880;
+
+CPoseStreamSender::CPoseStreamSender()
+	: m_socket(k_unInvalidSocket)
+	, m_unAddress(0)
+	, m_unPort(0)
+	, m_unSequence(0)
+	, m_ulSent(0)
+	, m_ulDatagrams(0)
+	, m_unBatchSize(1)
+	, m_ulLastBatchedNs(0)
+{
+	memset(&m_batchHeader, 0, sizeof(m_batchHeader));
+}
+
+CPoseStreamSender::~CPoseStreamSender()
+{
+	Close();
+}
+
+bool CPoseStreamSender::Open(const char* pchHost, uint16_t unPort, uint32_t unBatchSize)
+{
+	Close();
+	if (!InitSockets())
+		return false;
+
+	m_unBatchSize = std::min(std::max(unBatchSize, 1u), k_unMaxPoseBatch);
+	m_batchHeader.unCount = 0;
+
+	if (!ResolveHost(pchHost, &m_unAddress))
+	{
+		DriverLog("Pose stream: unable to resolve %s\n", pchHost);
+		CleanupSockets();
+		return false;
+	}
+
+	m_socket = OpenUdpSocket();
+	if (m_socket == k_unInvalidSocket)
+	{
+		CleanupSockets();
+		return false;
+	}
+	m_unPort = unPort;
+	return true;
+}
+
+void CPoseStreamSender::Close()
+{
+	if (m_socket == k_unInvalidSocket)
+		return;
+	// the last pose's time stands in for the send time
+	Flush(m_ulLastBatchedNs);
+	CloseSocket(m_socket);
+	m_socket = k_unInvalidSocket;
+	CleanupSockets();
+}
+
+static int16_t QuantizeInt16(double flValue)
+{
+	return (int16_t)lround(std::min(std::max(flValue, -32767.0), 32767.0));
+}
+
+static int32_t QuantizeInt32(double flValue)
+{
+	return (int32_t)llround(std::min(std::max(flValue, -2147483647.0), 2147483647.0));
+}
+
+// smallest three, returns the index of the component left out
+static int PackRotation(const HmdQuaternion_t& qRotation, int16_t rgnRotation[3])
+{
+	HmdQuaternion_t q = HmdQuaternion_Normalize(qRotation);
+	const double rgflComponents[4] = { q.w, q.x, q.y, q.z };
+	int nLargest = 0;
+	for (int i = 1; i < 4; i++)
+	{
+		if (fabs(rgflComponents[i]) > fabs(rgflComponents[nLargest]))
+			nLargest = i;
+	}
+	// q and -q are the same rotation, so the left-out component can be positive
+	double flSign = rgflComponents[nLargest] < 0.0 ? -1.0 : 1.0;
+	for (int i = 0, j = 0; i < 4; i++)
+	{
+		if (i != nLargest)
+			rgnRotation[j++] = QuantizeInt16(rgflComponents[i] * flSign * k_flRotationScale);
+	}
+	return nLargest;
+}
+
+// w, x, y, z
+static void UnpackRotation(const int16_t rgnRotation[3], int nLargest, double rgflComponents[4])
+{
+	double flSumSquares = 0.0;
+	for (int i = 0, j = 0; i < 4; i++)
+	{
+		if (i == nLargest)
+			continue;
+		rgflComponents[i] = rgnRotation[j++] / k_flRotationScale;
+		flSumSquares += rgflComponents[i] * rgflComponents[i];
+	}
+	rgflComponents[nLargest] = sqrt(std::max(1.0 - flSumSquares, 0.0));
+}
+
+void EncodeCompactPose(const DriverPose_t& pose, uint16_t unTimestampDeltaUs, ZedCompactPose_t* pCompact)
+{
+	int nLargest = PackRotation(pose.qRotation, pCompact->rgnRotation);
+	pCompact->unTimestampDeltaUs = unTimestampDeltaUs;
+	pCompact->unFlags = (uint8_t)((pose.poseIsValid ? PoseDatagramFlag_Valid : 0) | (pose.deviceIsConnected ? PoseDatagramFlag_Connected : 0)
+		| (nLargest << PoseDatagramFlag_LargestShift));
+	pCompact->unResult = (uint8_t)pose.result;
+	for (int i = 0; i < 3; i++)
+	{
+		pCompact->rgnPositionMm[i] = QuantizeInt32(pose.vecPosition[i] * 1000.0);
+		pCompact->rgnVelocityMmps[i] = QuantizeInt16(pose.vecVelocity[i] * 1000.0);
+		pCompact->rgnAngularVelocityMradps[i] = QuantizeInt16(pose.vecAngularVelocity[i] * 1000.0);
+	}
+}
+
+void DecodeCompactPose(const ZedCompactPose_t& compact, ZedPoseDatagram_t* pDatagram)
+{
+	pDatagram->unFlags = compact.unFlags & (PoseDatagramFlag_Valid | PoseDatagramFlag_Connected);
+	pDatagram->nResult = compact.unResult;
+	for (int i = 0; i < 3; i++)
+	{
+		pDatagram->vecPosition[i] = compact.rgnPositionMm[i] * 1e-3;
+		pDatagram->vecVelocity[i] = compact.rgnVelocityMmps[i] * 1e-3f;
+		pDatagram->vecAngularVelocity[i] = compact.rgnAngularVelocityMradps[i] * 1e-3f;
+	}
+
+	double rgflComponents[4];
+	UnpackRotation(compact.rgnRotation, (compact.unFlags & PoseDatagramFlag_LargestMask) >> PoseDatagramFlag_LargestShift, rgflComponents);
+	for (int i = 0; i < 4; i++)
+		pDatagram->qRotation[i] = (float)rgflComponents[i];
+}
+
+bool CPoseStreamSender::Send(const DriverPose_t& pose, uint64_t ulSampleTimestampNs, uint64_t ulNowNs)
+{
+	if (m_socket == k_unInvalidSocket)
+		return false;
+
+	// the delta is 16 bits of microseconds; a gap or a step back starts a new batch
+	if (m_batchHeader.unCount > 0
+		&& (ulSampleTimestampNs < m_ulLastBatchedNs || ulSampleTimestampNs - m_ulLastBatchedNs > 65535000ull))
+		Flush(ulNowNs);
+
+	uint16_t unDeltaUs = 0;
+	if (m_batchHeader.unCount == 0)
+	{
+		m_batchHeader.unMagic = k_unPoseDatagramMagic;
+		m_batchHeader.unVersion = k_unPoseBatchVersion;
+		m_batchHeader.unReserved = 0;
+		m_batchHeader.unSequence = m_unSequence;
+		m_batchHeader.ulFirstSampleTimestampNs = ulSampleTimestampNs;
+		m_ulLastBatchedNs = ulSampleTimestampNs;
+	}
+	else
+	{
+		// from the timestamp the receiver reconstructs, so rounding doesn't add up
+		unDeltaUs = (uint16_t)((ulSampleTimestampNs - m_ulLastBatchedNs + 500) / 1000);
+		m_ulLastBatchedNs += unDeltaUs * 1000ull;
+	}
+	EncodeCompactPose(pose, unDeltaUs, &m_rgBatch[m_batchHeader.unCount++]);
+	m_unSequence++;
+
+	if (m_batchHeader.unCount < m_unBatchSize)
+		return true;
+	return Flush(ulNowNs);
+}
+
+bool CPoseStreamSender::Flush(uint64_t ulNowNs)
+{
+	if (m_socket == k_unInvalidSocket || m_batchHeader.unCount == 0)
+		return true;
+
+	// as late as possible, the receiver's clock offset is measured against it
+	uint32_t unCount = m_batchHeader.unCount;
+	m_batchHeader.ulSendTimestampNs = ulNowNs;
+	uint8_t rgDatagram[k_unMaxDatagramSize];
+	size_t unSize = sizeof(m_batchHeader) + unCount * sizeof(ZedCompactPose_t);
+	memcpy(rgDatagram, &m_batchHeader, sizeof(m_batchHeader));
+	memcpy(rgDatagram + sizeof(m_batchHeader), m_rgBatch, unCount * sizeof(ZedCompactPose_t));
+	m_batchHeader.unCount = 0;
+	if (!SendDatagram(m_socket, m_unAddress, m_unPort, rgDatagram, unSize))
+		return false;
+	m_ulSent += unCount;
+	m_ulDatagrams++;
+	return true;
+}
+
+CPoseStreamReceiver::CPoseStreamReceiver()
+	: m_socket(k_unInvalidSocket)
+	, m_pThread(nullptr)
+	, m_bRunning(false)
+	, m_unObjectId(k_unTrackedDeviceIndexInvalid)
+	, m_ulJitterDelayNs(0)
+	, m_unBuffered(0)
+	, m_bHavePlayedOut(false)
+	, m_unLastSequence(0)
+	, m_ulLastLocalSampleNs(0)
+	, m_ulLastReceivedNs(0)
+	, m_ulOffsetBucketStartNs(0)
+	, m_unOffsetBucket(0)
+	, m_bHaveOffset(false)
+	, m_nPreviousTransitNs(0)
+	, m_flJitterNs(0.0)
+	, m_bConnected(false)
+	, m_ulReceived(0)
+	, m_ulLost(0)
+	, m_ulLate(0)
+	, m_ulMalformed(0)
+	, m_nClockOffsetNs(0)
+	, m_flJitterReportNs(0.0)
+{
+	memset(m_rgnOffsetMinNs, 0, sizeof(m_rgnOffsetMinNs));
+}
+
+CPoseStreamReceiver::~CPoseStreamReceiver()
+{
+	Stop();
+}
+
+uint64_t CPoseStreamReceiver::GetLocalTimeNs()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool CPoseStreamReceiver::Start(uint16_t unPort, double flJitterDelaySeconds)
+{
+	if (m_pThread)
+		return true;
+	if (!InitSockets())
+		return false;
+
+	m_socket = OpenUdpSocket();
+	if (m_socket == k_unInvalidSocket)
+	{
+		CleanupSockets();
+		return false;
+	}
+
+	if (!BindUdpSocket(m_socket, unPort) || !SetReceiveTimeout(m_socket, k_unReceiveTimeoutMs))
+	{
+		DriverLog("Pose stream: unable to listen on UDP port %u\n", (unsigned)unPort);
+		CloseSocket(m_socket);
+		m_socket = k_unInvalidSocket;
+		CleanupSockets();
+		return false;
+	}
+
+	m_ulJitterDelayNs = flJitterDelaySeconds > 0.0 ? (uint64_t)(flJitterDelaySeconds * 1e9) : 0;
+	m_bRunning = true;
+	m_pThread = new std::thread(&CPoseStreamReceiver::Run, this);
+	DriverLog("Pose stream: listening on UDP port %u\n", (unsigned)unPort);
+	return true;
+}
+
+void CPoseStreamReceiver::Stop()
+{
+	if (!m_pThread)
+		return;
+
+	m_bRunning = false;
+	m_pThread->join();
+	delete m_pThread;
+	m_pThread = nullptr;
+
+	CloseSocket(m_socket);
+	m_socket = k_unInvalidSocket;
+	CleanupSockets();
+}
+
+uint32_t CPoseStreamReceiver::ReadPose(DriverPose_t* pPose, uint64_t* pulSampleTimestampNs) const
+{
+	PlayedOutPose_t played;
+	uint32_t unSequence = m_poseHandoff.Read(&played);
+	if (unSequence == 0)
+		return 0;
+
+	*pPose = played.pose;
+	if (pulSampleTimestampNs)
+		*pulSampleTimestampNs = played.ulSampleTimestampNs;
+	return unSequence;
+}
+
+bool CPoseStreamReceiver::GetPoseAt(uint64_t ulTimestampNs, DriverPose_t* pPose) const
+{
+	PoseHistorySample_t sample;
+	if (!m_poseHistory.Query(ulTimestampNs, &sample))
+		return false;
+
+	PlayedOutPose_t played;
+	if (m_poseHandoff.Read(&played) == 0 || !played.pose.poseIsValid)
+		return false;
+
+	*pPose = played.pose;
+	pPose->qRotation = sample.qRotation;
+	for (int i = 0; i < 3; i++)
+	{
+		pPose->vecPosition[i] = sample.vecPosition[i];
+		pPose->vecVelocity[i] = sample.vecVelocity[i];
+		pPose->vecAngularVelocity[i] = sample.vecAngularVelocity[i];
+	}
+	pPose->poseTimeOffset = 0.0;
+	return true;
+}
+
+void CPoseStreamReceiver::GetStats(PoseStreamStats_t* pStats) const
+{
+	pStats->bConnected = m_bConnected.load();
+	pStats->ulReceived = m_ulReceived.load();
+	pStats->ulLost = m_ulLost.load();
+	pStats->ulLate = m_ulLate.load();
+	pStats->ulMalformed = m_ulMalformed.load();
+	pStats->flClockOffsetMs = m_nClockOffsetNs.load() * 1e-6;
+	pStats->flJitterMs = m_flJitterReportNs.load() * 1e-6;
+	pStats->flBufferDelayMs = m_ulJitterDelayNs * 1e-6;
+}
+
+void CPoseStreamReceiver::Run()
+{
+#if defined(_WIN32)
+	// the receive timeout is bound to the system timer resolution (15.6ms by default)
+	timeBeginPeriod(1);
+#endif
+
+	// one byte more than the largest datagram, so a longer one is recognized as malformed
+	uint8_t rgBuffer[k_unMaxDatagramSize + 1];
+	while (m_bRunning)
+	{
+		int nReceived = ReceiveDatagram(m_socket, rgBuffer, sizeof(rgBuffer));
+		uint64_t ulNowNs = GetLocalTimeNs();
+		if (nReceived > 0)
+			Receive(rgBuffer, (size_t)nReceived, ulNowNs);
+
+		ReleaseDue(ulNowNs);
+
+		if (m_bConnected && ulNowNs - m_ulLastReceivedNs > k_ulLinkTimeoutNs)
+			PublishLinkLost();
+	}
+
+#if defined(_WIN32)
+	timeEndPeriod(1);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks a datagram of either version and buffers its poses. Each
+// pose of a batch is released as if it had been sent on its own, the batch's
+// send time less the time it waited for the later ones.
+//-----------------------------------------------------------------------------
+void CPoseStreamReceiver::Receive(const uint8_t* pData, size_t unSize, uint64_t ulReceivedNs)
+{
+	ZedPoseBatchHeader_t header;
+	if (unSize < sizeof(header))
+	{
+		m_ulMalformed++;
+		return;
+	}
+	memcpy(&header, pData, sizeof(header));
+
+	if (header.unMagic == k_unPoseDatagramMagic && header.unVersion == k_unPoseDatagramVersion && unSize == sizeof(ZedPoseDatagram_t))
+	{
+		ZedPoseDatagram_t datagram;
+		memcpy(&datagram, pData, sizeof(datagram));
+		m_ulReceived++;
+		ReceiveClock(datagram.ulSendTimestampNs, ulReceivedNs);
+		Buffer(datagram, ulReceivedNs);
+		return;
+	}
+
+	if (header.unMagic != k_unPoseDatagramMagic || header.unVersion != k_unPoseBatchVersion || header.unCount == 0
+		|| header.unCount > k_unMaxPoseBatch || unSize != sizeof(header) + header.unCount * sizeof(ZedCompactPose_t))
+	{
+		m_ulMalformed++;
+		return;
+	}
+
+	ZedPoseDatagram_t rgDecoded[k_unMaxPoseBatch];
+	uint64_t ulSampleNs = header.ulFirstSampleTimestampNs;
+	for (uint32_t i = 0; i < header.unCount; i++)
+	{
+		ZedCompactPose_t compact;
+		memcpy(&compact, pData + sizeof(header) + i * sizeof(compact), sizeof(compact));
+		ulSampleNs += compact.unTimestampDeltaUs * 1000ull;
+
+		ZedPoseDatagram_t& datagram = rgDecoded[i];
+		memset(&datagram, 0, sizeof(datagram));
+		DecodeCompactPose(compact, &datagram);
+		datagram.unMagic = k_unPoseDatagramMagic;
+		datagram.unVersion = k_unPoseDatagramVersion;
+		datagram.unSequence = header.unSequence + i;
+		datagram.ulSampleTimestampNs = ulSampleNs;
+	}
+	uint64_t ulHeldNs = header.ulSendTimestampNs > ulSampleNs ? header.ulSendTimestampNs - ulSampleNs : 0;
+	for (uint32_t i = 0; i < header.unCount; i++)
+		rgDecoded[i].ulSendTimestampNs = rgDecoded[i].ulSampleTimestampNs + ulHeldNs;
+
+	m_ulReceived += header.unCount;
+	ReceiveClock(header.ulSendTimestampNs, ulReceivedNs);
+	for (uint32_t i = 0; i < header.unCount; i++)
+		Buffer(rgDecoded[i], ulReceivedNs);
+}
+
+void CPoseStreamReceiver::ReceiveClock(uint64_t ulSendTimestampNs, uint64_t ulReceivedNs)
+{
+	m_ulLastReceivedNs = ulReceivedNs;
+	if (!m_bConnected)
+	{
+		DriverLog("Pose stream: remote node connected\n");
+		m_bConnected = true;
+	}
+
+	int64_t nTransitNs = (int64_t)ulReceivedNs - (int64_t)ulSendTimestampNs;
+	if (m_bHaveOffset)
+	{
+		int64_t nDifferenceNs = nTransitNs - m_nPreviousTransitNs;
+		m_flJitterNs += k_flJitterGain * ((double)(nDifferenceNs < 0 ? -nDifferenceNs : nDifferenceNs) - m_flJitterNs);
+		m_flJitterReportNs = m_flJitterNs;
+	}
+	m_nPreviousTransitNs = nTransitNs;
+	UpdateClockOffset(nTransitNs, ulReceivedNs);
+}
+
+void CPoseStreamReceiver::Buffer(const ZedPoseDatagram_t& datagram, uint64_t ulReceivedNs)
+{
+	// sequence numbers wrap, so they are compared by distance
+	if (m_bHavePlayedOut && (int32_t)(datagram.unSequence - m_unLastSequence) <= 0)
+	{
+		m_ulLate++;
+		return;
+	}
+
+	uint32_t unInsert = m_unBuffered;
+	while (unInsert > 0 && (int32_t)(datagram.unSequence - m_rgBuffer[unInsert - 1].datagram.unSequence) < 0)
+		unInsert--;
+	if (unInsert > 0 && m_rgBuffer[unInsert - 1].datagram.unSequence == datagram.unSequence)
+		return; // duplicate
+
+	// full: the oldest goes out early rather than being dropped
+	if (m_unBuffered == k_unJitterBufferSize)
+	{
+		PlayOut(m_rgBuffer[0], ulReceivedNs);
+		memmove(m_rgBuffer, m_rgBuffer + 1, (m_unBuffered - 1) * sizeof(m_rgBuffer[0]));
+		m_unBuffered--;
+		if (unInsert > 0)
+			unInsert--;
+	}
+
+	memmove(m_rgBuffer + unInsert + 1, m_rgBuffer + unInsert, (m_unBuffered - unInsert) * sizeof(m_rgBuffer[0]));
+	BufferedPose_t& buffered = m_rgBuffer[unInsert];
+	buffered.datagram = datagram;
+	int64_t nOffsetNs = m_nClockOffsetNs.load();
+	buffered.ulLocalSampleNs = (uint64_t)((int64_t)datagram.ulSampleTimestampNs + nOffsetNs);
+	buffered.ulReleaseNs = (uint64_t)((int64_t)datagram.ulSendTimestampNs + nOffsetNs) + m_ulJitterDelayNs;
+	m_unBuffered++;
+}
+
+void CPoseStreamReceiver::UpdateClockOffset(int64_t nOffsetNs, uint64_t ulReceivedNs)
+{
+	if (!m_bHaveOffset)
+	{
+		for (uint32_t i = 0; i < k_unOffsetBuckets; i++)
+			m_rgnOffsetMinNs[i] = nOffsetNs;
+		m_unOffsetBucket = 0;
+		m_ulOffsetBucketStartNs = ulReceivedNs;
+		m_bHaveOffset = true;
+	}
+	else if (ulReceivedNs - m_ulOffsetBucketStartNs >= k_ulOffsetBucketNs)
+	{
+		// the oldest bucket leaves the window; drift is followed one bucket at a time
+		m_unOffsetBucket = (m_unOffsetBucket + 1) % k_unOffsetBuckets;
+		m_rgnOffsetMinNs[m_unOffsetBucket] = nOffsetNs;
+		m_ulOffsetBucketStartNs = ulReceivedNs;
+	}
+	else if (nOffsetNs < m_rgnOffsetMinNs[m_unOffsetBucket])
+	{
+		m_rgnOffsetMinNs[m_unOffsetBucket] = nOffsetNs;
+	}
+
+	int64_t nMinimumNs = m_rgnOffsetMinNs[0];
+	for (uint32_t i = 1; i < k_unOffsetBuckets; i++)
+	{
+		if (m_rgnOffsetMinNs[i] < nMinimumNs)
+			nMinimumNs = m_rgnOffsetMinNs[i];
+	}
+	m_nClockOffsetNs = nMinimumNs;
+}
+
+void CPoseStreamReceiver::ReleaseDue(uint64_t ulNowNs)
+{
+	uint32_t unDue = 0;
+	while (unDue < m_unBuffered && m_rgBuffer[unDue].ulReleaseNs <= ulNowNs)
+		PlayOut(m_rgBuffer[unDue++], ulNowNs);
+	if (unDue == 0)
+		return;
+
+	memmove(m_rgBuffer, m_rgBuffer + unDue, (m_unBuffered - unDue) * sizeof(m_rgBuffer[0]));
+	m_unBuffered -= unDue;
+}
+
+void CPoseStreamReceiver::PlayOut(const BufferedPose_t& buffered, uint64_t ulNowNs)
+{
+	const ZedPoseDatagram_t& datagram = buffered.datagram;
+	if (m_bHavePlayedOut)
+	{
+		int32_t nGap = (int32_t)(datagram.unSequence - m_unLastSequence) - 1;
+		if (nGap > 0)
+			m_ulLost += (uint64_t)nGap;
+	}
+	m_bHavePlayedOut = true;
+	m_unLastSequence = datagram.unSequence;
+
+	// the history needs increasing timestamps, a shrinking offset mustn't move one back
+	uint64_t ulSampleNs = buffered.ulLocalSampleNs > m_ulLastLocalSampleNs ? buffered.ulLocalSampleNs : m_ulLastLocalSampleNs + 1;
+	m_ulLastLocalSampleNs = ulSampleNs;
+
+	PlayedOutPose_t played;
+	m_poseTemplate.Read(&played.pose);
+	played.pose.poseIsValid = (datagram.unFlags & PoseDatagramFlag_Valid) != 0;
+	played.pose.deviceIsConnected = (datagram.unFlags & PoseDatagramFlag_Connected) != 0;
+	played.pose.result = (ETrackingResult)datagram.nResult;
+	played.ulSampleTimestampNs = ulSampleNs;
+
+	if (played.pose.poseIsValid)
+	{
+		PoseHistorySample_t sample;
+		sample.ulTimestampNs = ulSampleNs;
+		for (int i = 0; i < 3; i++)
+		{
+			sample.vecPosition[i] = played.pose.vecPosition[i] = datagram.vecPosition[i];
+			sample.vecVelocity[i] = played.pose.vecVelocity[i] = datagram.vecVelocity[i];
+			sample.vecAngularVelocity[i] = played.pose.vecAngularVelocity[i] = datagram.vecAngularVelocity[i];
+		}
+		sample.qRotation = played.pose.qRotation = HmdQuaternion_Normalize(
+			HmdQuaternion_Init(datagram.qRotation[0], datagram.qRotation[1], datagram.qRotation[2], datagram.qRotation[3]));
+		m_poseHistory.Write(sample);
+	}
+	else
+	{
+		m_poseHistory.Clear();
+	}
+	played.pose.poseTimeOffset = ((int64_t)ulSampleNs - (int64_t)ulNowNs) * 1e-9;
+	m_poseHandoff.Write(played);
+
+	TrackedDeviceIndex_t unObjectId = m_unObjectId.load();
+	if (unObjectId != k_unTrackedDeviceIndexInvalid)
+		VRServerDriverHost()->TrackedDevicePoseUpdated(unObjectId, played.pose, sizeof(DriverPose_t));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The node stopped sending. Anything still buffered is long stale, an
+// invalid pose replaces it; the next datagram starts over with a new clock offset and
+// sequence, since the node may have been restarted.
+//-----------------------------------------------------------------------------
+void CPoseStreamReceiver::PublishLinkLost()
+{
+	m_unBuffered = 0;
+	DriverLog("Pose stream: remote node lost\n");
+	m_bConnected = false;
+	m_bHaveOffset = false;
+	m_bHavePlayedOut = false;
+	m_poseHistory.Clear();
+
+	PlayedOutPose_t played;
+	m_poseTemplate.Read(&played.pose);
+	played.pose.poseIsValid = false;
+	played.pose.result = TrackingResult_Running_OutOfRange;
+	played.ulSampleTimestampNs = 0;
+	m_poseHandoff.Write(played);
+
+	TrackedDeviceIndex_t unObjectId = m_unObjectId.load();
+	if (unObjectId != k_unTrackedDeviceIndexInvalid)
+		VRServerDriverHost()->TrackedDevicePoseUpdated(unObjectId, played.pose, sizeof(DriverPose_t));
+}
+
+CSkeletonStreamSender::CSkeletonStreamSender()
+	: m_socket(k_unInvalidSocket)
+	, m_unAddress(0)
+	, m_unPort(0)
+	, m_unNode(0)
+	, m_unSequence(0)
+	, m_ulLastTimestampNs(0)
+	, m_ulSent(0)
+{
+	CameraPosition_t camera = {};
+	m_cameraPosition.Write(camera);
+}
+
+CSkeletonStreamSender::~CSkeletonStreamSender()
+{
+	Close();
+}
+
+bool CSkeletonStreamSender::Open(const char* pchHost, uint16_t unPort, uint32_t unNode)
+{
+	Close();
+	if (unNode < 1 || unNode > k_unMaxFusionNodes || !InitSockets())
+		return false;
+
+	if (!ResolveHost(pchHost, &m_unAddress))
+	{
+		DriverLog("Skeleton stream: unable to resolve %s\n", pchHost);
+		CleanupSockets();
+		return false;
+	}
+
+	m_socket = OpenUdpSocket();
+	if (m_socket == k_unInvalidSocket)
+	{
+		CleanupSockets();
+		return false;
+	}
+	m_unPort = unPort;
+	m_unNode = (uint8_t)unNode;
+	return true;
+}
+
+void CSkeletonStreamSender::Close()
+{
+	if (m_socket == k_unInvalidSocket)
+		return;
+	CloseSocket(m_socket);
+	m_socket = k_unInvalidSocket;
+	CleanupSockets();
+}
+
+void CSkeletonStreamSender::SetCameraPosition(const double vecPosition[3])
+{
+	CameraPosition_t camera;
+	for (int i = 0; i < 3; i++)
+		camera.vecPosition[i] = vecPosition[i];
+	m_cameraPosition.Write(camera);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: On the body tracker's publisher thread. It has no clock of its
+// own; the skeleton's time offset says how old it is, which puts the send
+// time on the ZED clock the sample time is on.
+//-----------------------------------------------------------------------------
+void CSkeletonStreamSender::OnBodySkeleton(const ZedBodySkeleton_t* pSkeleton, const DriverPose_t& /*poseTemplate*/, double flTimeOffset)
+{
+	if (m_socket == k_unInvalidSocket)
+		return;
+
+	CameraPosition_t camera;
+	m_cameraPosition.Read(&camera);
+
+	ZedSkeletonHeader_t header;
+	header.unMagic = k_unPoseDatagramMagic;
+	header.unVersion = k_unSkeletonVersion;
+	header.unNode = m_unNode;
+	header.unJoints = pSkeleton ? (uint8_t)k_nBodySkeletonJoints : 0;
+	header.unSequence = m_unSequence++;
+	header.nBodyId = pSkeleton ? pSkeleton->nBodyId : -1;
+	header.ulValidMask = 0;
+	for (int i = 0; i < 3; i++)
+		header.rgnCameraMm[i] = QuantizeInt32(camera.vecPosition[i] * 1000.0);
+	if (pSkeleton)
+	{
+		m_ulLastTimestampNs = pSkeleton->ulTimestampNs;
+		header.ulSampleTimestampNs = pSkeleton->ulTimestampNs;
+		header.ulSendTimestampNs = pSkeleton->ulTimestampNs + (uint64_t)llround(std::max(-flTimeOffset, 0.0) * 1e9);
+	}
+	else
+	{
+		header.ulSampleTimestampNs = 0;
+		header.ulSendTimestampNs = m_ulLastTimestampNs;
+	}
+
+	uint8_t rgDatagram[k_unMaxSkeletonSize];
+	for (int i = 0; i < header.unJoints; i++)
+	{
+		// an undetected joint's values are NaN, it goes out as zeros
+		ZedCompactJoint_t joint;
+		memset(&joint, 0, sizeof(joint));
+		if (pSkeleton->rgbValid[i])
+		{
+			for (int j = 0; j < 3; j++)
+				joint.rgnPositionMm[j] = QuantizeInt32(pSkeleton->rgvecPosition[i][j] * 1000.0);
+			joint.unLargest = (uint8_t)PackRotation(pSkeleton->rgqRotation[i], joint.rgnRotation);
+			header.ulValidMask |= 1ull << i;
+		}
+		memcpy(rgDatagram + sizeof(header) + i * sizeof(joint), &joint, sizeof(joint));
+	}
+	memcpy(rgDatagram, &header, sizeof(header));
+
+	if (SendDatagram(m_socket, m_unAddress, m_unPort, rgDatagram, sizeof(header) + header.unJoints * sizeof(ZedCompactJoint_t)))
+		m_ulSent++;
+}
+
+CSkeletonStreamReceiver::CSkeletonStreamReceiver()
+	: m_socket(k_unInvalidSocket)
+	, m_pThread(nullptr)
+	, m_bRunning(false)
+	, m_pListener(nullptr)
+	, m_ulReceived(0)
+	, m_ulMalformed(0)
+{
+	for (Node_t& node : m_rgNodes)
+	{
+		node.bConnected = false;
+		node.unLastSequence = 0;
+		node.ulLastReceivedNs = 0;
+		node.rgnTransitMinNs[0] = node.rgnTransitMinNs[1] = 0;
+		node.ulBucketStartNs = 0;
+	}
+}
+
+CSkeletonStreamReceiver::~CSkeletonStreamReceiver()
+{
+	Stop();
+}
+
+bool CSkeletonStreamReceiver::Start(uint16_t unPort, ISkeletonStreamListener* pListener)
+{
+	if (m_pThread)
+		return true;
+	if (!InitSockets())
+		return false;
+
+	m_socket = OpenUdpSocket();
+	if (m_socket == k_unInvalidSocket)
+	{
+		CleanupSockets();
+		return false;
+	}
+
+	if (!BindUdpSocket(m_socket, unPort) || !SetReceiveTimeout(m_socket, k_unSkeletonReceiveTimeoutMs))
+	{
+		DriverLog("Body fusion: unable to listen on UDP port %u\n", (unsigned)unPort);
+		CloseSocket(m_socket);
+		m_socket = k_unInvalidSocket;
+		CleanupSockets();
+		return false;
+	}
+
+	m_pListener = pListener;
+	m_bRunning = true;
+	m_pThread = new std::thread(&CSkeletonStreamReceiver::Run, this);
+	DriverLog("Body fusion: listening on UDP port %u\n", (unsigned)unPort);
+	return true;
+}
+
+void CSkeletonStreamReceiver::Stop()
+{
+	if (!m_pThread)
+		return;
+
+	m_bRunning = false;
+	m_pThread->join();
+	delete m_pThread;
+	m_pThread = nullptr;
+
+	CloseSocket(m_socket);
+	m_socket = k_unInvalidSocket;
+	CleanupSockets();
+}
+
+bool CSkeletonStreamReceiver::GetClockFit(uint32_t unNode, ClockFit_t* pFit) const
+{
+	if (unNode < 1 || unNode > k_unMaxFusionNodes)
+		return false;
+	return m_rgNodes[unNode - 1].clock.GetFit(pFit);
+}
+
+void CSkeletonStreamReceiver::Run()
+{
+	// one byte more than the largest datagram, so a longer one is recognized as malformed
+	uint8_t rgBuffer[k_unMaxSkeletonSize + 1];
+	while (m_bRunning)
+	{
+		int nReceived = ReceiveDatagram(m_socket, rgBuffer, sizeof(rgBuffer));
+		uint64_t ulNowNs = CPoseStreamReceiver::GetLocalTimeNs();
+		if (nReceived > 0)
+			Receive(rgBuffer, (size_t)nReceived, ulNowNs);
+
+		for (uint32_t i = 0; i < k_unMaxFusionNodes; i++)
+		{
+			Node_t& node = m_rgNodes[i];
+			if (!node.bConnected || ulNowNs - node.ulLastReceivedNs <= k_ulLinkTimeoutNs)
+				continue;
+
+			// the node may have been restarted, its next datagram starts over
+			DriverLog("Body fusion: node %u lost\n", i + 1);
+			node.bConnected = false;
+			const double vecCamera[3] = { 0.0, 0.0, 0.0 };
+			m_pListener->OnRemoteSkeleton(i + 1, nullptr, vecCamera);
+		}
+	}
+}
+
+void CSkeletonStreamReceiver::Receive(const uint8_t* pData, size_t unSize, uint64_t ulReceivedNs)
+{
+	ZedSkeletonHeader_t header;
+	if (unSize < sizeof(header))
+	{
+		m_ulMalformed++;
+		return;
+	}
+	memcpy(&header, pData, sizeof(header));
+	if (header.unMagic != k_unPoseDatagramMagic || header.unVersion != k_unSkeletonVersion || header.unNode < 1 || header.unNode > k_unMaxFusionNodes
+		|| (header.unJoints != 0 && header.unJoints != k_nBodySkeletonJoints) || unSize != sizeof(header) + header.unJoints * sizeof(ZedCompactJoint_t))
+	{
+		m_ulMalformed++;
+		return;
+	}
+
+	// an older skeleton than the last one would only move the joints back
+	Node_t& node = m_rgNodes[header.unNode - 1];
+	if (node.bConnected && (int32_t)(header.unSequence - node.unLastSequence) <= 0)
+		return;
+	if (!node.bConnected)
+	{
+		DriverLog("Body fusion: node %u connected\n", (unsigned)header.unNode);
+		node.bConnected = true;
+		node.clock.Reset();
+		node.ulBucketStartNs = 0;
+	}
+	node.unLastSequence = header.unSequence;
+	node.ulLastReceivedNs = ulReceivedNs;
+	m_ulReceived++;
+
+	double vecCamera[3];
+	for (int i = 0; i < 3; i++)
+		vecCamera[i] = header.rgnCameraMm[i] * 1e-3;
+	if (header.unJoints == 0)
+	{
+		m_pListener->OnRemoteSkeleton(header.unNode, nullptr, vecCamera);
+		return;
+	}
+
+	ReceiveClock(node, header.ulSendTimestampNs, ulReceivedNs);
+	if (!node.clock.ToTarget(header.ulSampleTimestampNs, &m_skeleton.ulTimestampNs))
+		return;
+
+	m_skeleton.nBodyId = header.nBodyId;
+	for (int i = 0; i < k_nBodySkeletonJoints; i++)
+	{
+		ZedCompactJoint_t joint;
+		memcpy(&joint, pData + sizeof(header) + i * sizeof(joint), sizeof(joint));
+		m_skeleton.rgbValid[i] = (header.ulValidMask & (1ull << i)) != 0;
+		for (int j = 0; j < 3; j++)
+			m_skeleton.rgvecPosition[i][j] = joint.rgnPositionMm[j] * 1e-3;
+
+		double rgflComponents[4];
+		UnpackRotation(joint.rgnRotation, joint.unLargest & 3, rgflComponents);
+		m_skeleton.rgqRotation[i] = HmdQuaternion_Init(rgflComponents[0], rgflComponents[1], rgflComponents[2], rgflComponents[3]);
+	}
+	m_pListener->OnRemoteSkeleton(header.unNode, &m_skeleton, vecCamera);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Feeds the node's clock translator with the skeletons that came
+// through fastest. The fastest transit is the minimum over the current and
+// the previous bucket, so it follows a route change within two seconds.
+//-----------------------------------------------------------------------------
+void CSkeletonStreamReceiver::ReceiveClock(Node_t& node, uint64_t ulSendTimestampNs, uint64_t ulReceivedNs)
+{
+	int64_t nTransitNs = (int64_t)ulReceivedNs - (int64_t)ulSendTimestampNs;
+	if (node.ulBucketStartNs == 0)
+	{
+		node.rgnTransitMinNs[0] = node.rgnTransitMinNs[1] = nTransitNs;
+		node.ulBucketStartNs = ulReceivedNs;
+	}
+	else if (ulReceivedNs - node.ulBucketStartNs >= k_ulTransitBucketNs)
+	{
+		node.rgnTransitMinNs[1] = node.rgnTransitMinNs[0];
+		node.rgnTransitMinNs[0] = nTransitNs;
+		node.ulBucketStartNs = ulReceivedNs;
+	}
+	else if (nTransitNs < node.rgnTransitMinNs[0])
+	{
+		node.rgnTransitMinNs[0] = nTransitNs;
+	}
+
+	int64_t nFastestNs = std::min(node.rgnTransitMinNs[0], node.rgnTransitMinNs[1]);
+	if (nTransitNs <= nFastestNs + (int64_t)k_ulTransitSlackNs)
+		node.clock.AddPair(ulSendTimestampNs, ulReceivedNs, ulReceivedNs);
+}
@@ -0,0 +1,417 @@
+#ifndef POSESTREAM_H
+#define POSESTREAM_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "bodytracker.h"
+#include "clocktranslator.h"
+#include "posehistory.h"
+#include "seqlock.h"
+
+static const uint32_t k_unPoseDatagramMagic = 0x5044455a; // "ZEDP" on the wire
+static const uint16_t k_unPoseDatagramVersion = 1; // one full pose
+static const uint16_t k_unPoseBatchVersion = 2; // a batch of compact poses
+static const uint16_t k_unSkeletonVersion = 3; // one body skeleton, for body fusion
+
+// a full batch is well under a 1500 byte MTU
+static const uint32_t k_unMaxPoseBatch = 16;
+
+enum EPoseDatagramFlags
+{
+	PoseDatagramFlag_Valid = 1 << 0,
+	PoseDatagramFlag_Connected = 1 << 1,
+
+	// compact poses only: which quaternion component was left out, 0..3 for w, x, y, z
+	PoseDatagramFlag_LargestShift = 2,
+	PoseDatagramFlag_LargestMask = 3 << PoseDatagramFlag_LargestShift,
+};
+
+#pragma pack(push, 1)
+//-----------------------------------------------------------------------------
+// Purpose: One pose of a remote ZED node on the wire, one per UDP datagram,
+// little endian. Only the dynamic fields travel; the receiver applies its own
+// calibration (poseTemplate). Both timestamps are on the sender's clock.
+// Version 1 of the protocol; the receiver also decodes batches into these.
+//-----------------------------------------------------------------------------
+struct ZedPoseDatagram_t
+{
+	uint32_t unMagic;
+	uint16_t unVersion;
+	uint16_t unFlags; // EPoseDatagramFlags
+	uint32_t unSequence; // +1 per datagram, wraps
+	int32_t nResult; // vr::ETrackingResult
+	uint64_t ulSampleTimestampNs;
+	uint64_t ulSendTimestampNs; // right before the datagram is sent
+	double vecPosition[3];
+	float vecVelocity[3];
+	float vecAngularVelocity[3];
+	float qRotation[4]; // w, x, y, z
+};
+#pragma pack(pop)
+
+static_assert(sizeof(ZedPoseDatagram_t) == 96, "the datagram layout is part of the protocol");
+
+#pragma pack(push, 1)
+//-----------------------------------------------------------------------------
+// Purpose: Version 2: a header and unCount compact poses in one datagram, a
+// third of the bytes per pose and one datagram per few IMU-rate samples.
+// Positions are in millimeters, velocities in mm/s and mrad/s, saturating.
+// The rotation is smallest three: the largest component is left out (its
+// index in the flags) and made positive, the other three are scaled by
+// 32767 * sqrt(2). Sequence numbers are unSequence + the pose's index.
+//-----------------------------------------------------------------------------
+struct ZedPoseBatchHeader_t
+{
+	uint32_t unMagic;
+	uint16_t unVersion;
+	uint8_t unCount;
+	uint8_t unReserved;
+	uint32_t unSequence; // of the first pose
+	uint64_t ulFirstSampleTimestampNs;
+	uint64_t ulSendTimestampNs;
+};
+
+struct ZedCompactPose_t
+{
+	uint16_t unTimestampDeltaUs; // since the previous pose of the batch, 0 for the first
+	uint8_t unFlags; // EPoseDatagramFlags
+	uint8_t unResult; // vr::ETrackingResult
+	int32_t rgnPositionMm[3];
+	int16_t rgnRotation[3];
+	int16_t rgnVelocityMmps[3];
+	int16_t rgnAngularVelocityMradps[3];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(ZedPoseBatchHeader_t) == 28 && sizeof(ZedCompactPose_t) == 34, "the batch layout is part of the protocol");
+
+// body fusion node ids are 1..k_unMaxFusionNodes, 0 is the fusing driver's own camera
+static const uint32_t k_unMaxFusionNodes = 8;
+
+#pragma pack(push, 1)
+//-----------------------------------------------------------------------------
+// Purpose: Version 3: the skeleton of the body a node follows, every POSE_34
+// joint in the node's driver space, for a driver with bodyFusionPort set.
+// unJoints compact joints follow the header, k_nBodySkeletonJoints, or none
+// when the body was lost. Positions and rotations are packed like those of
+// version 2; the camera's position lets the receiver weigh the joints by
+// their distance from it.
+//-----------------------------------------------------------------------------
+struct ZedSkeletonHeader_t
+{
+	uint32_t unMagic;
+	uint16_t unVersion;
+	uint8_t unNode; // 1..k_unMaxFusionNodes
+	uint8_t unJoints;
+	uint32_t unSequence; // +1 per datagram, wraps
+	int32_t nBodyId;
+	uint64_t ulValidMask; // a bit per joint
+	int32_t rgnCameraMm[3];
+	uint64_t ulSampleTimestampNs;
+	uint64_t ulSendTimestampNs;
+};
+
+struct ZedCompactJoint_t
+{
+	int32_t rgnPositionMm[3];
+	int16_t rgnRotation[3];
+	uint8_t unLargest; // the left-out quaternion component, 0..3 for w, x, y, z
+};
+#pragma pack(pop)
+
+static_assert(sizeof(ZedSkeletonHeader_t) == 52 && sizeof(ZedCompactJoint_t) == 19, "the skeleton layout is part of the protocol");
+static_assert(k_nBodySkeletonJoints <= 64, "a valid bit per joint");
+
+//-----------------------------------------------------------------------------
+// Purpose: Sends the poses of a ZED pipeline running on this machine to a
+// driver in receiver mode (remotePort) on another one, as batches of compact
+// poses. A batch goes out once it holds unBatchSize poses, or earlier when
+// the next pose is too far apart for the timestamp delta; batching holds a
+// pose back by up to unBatchSize - 1 samples, which the receiver's jitter
+// delay has to cover.
+//-----------------------------------------------------------------------------
+class CPoseStreamSender
+{
+public:
+	CPoseStreamSender();
+	~CPoseStreamSender();
+
+	/** pchHost is an IPv4 address or a host name; unBatchSize is clamped to 1..k_unMaxPoseBatch */
+	bool Open(const char* pchHost, uint16_t unPort, uint32_t unBatchSize = 1);
+
+	/** Sends what is batched first */
+	void Close();
+
+	/** ulSampleTimestampNs and ulNowNs on the same clock, e.g. the ZED's */
+	bool Send(const vr::DriverPose_t& pose, uint64_t ulSampleTimestampNs, uint64_t ulNowNs);
+
+	/** Sends the poses batched so far, if any */
+	bool Flush(uint64_t ulNowNs);
+
+	/** Poses and datagrams that went out */
+	uint64_t GetSentCount() const { return m_ulSent; }
+	uint64_t GetDatagramCount() const { return m_ulDatagrams; }
+
+private:
+	uintptr_t m_socket;
+	uint32_t m_unAddress; // network byte order
+	uint16_t m_unPort;
+	uint32_t m_unSequence;
+	uint64_t m_ulSent;
+	uint64_t m_ulDatagrams;
+
+	uint32_t m_unBatchSize;
+	ZedPoseBatchHeader_t m_batchHeader;
+	ZedCompactPose_t m_rgBatch[k_unMaxPoseBatch];
+	uint64_t m_ulLastBatchedNs; // as the receiver will reconstruct it
+};
+
+/** Packs pose into the compact layout; ulTimestampDeltaUs must fit 16 bits */
+extern void EncodeCompactPose(const vr::DriverPose_t& pose, uint16_t unTimestampDeltaUs, ZedCompactPose_t* pCompact);
+
+/** Unpacks a compact pose into the full layout, all but the sequence and timestamps */
+extern void DecodeCompactPose(const ZedCompactPose_t& compact, ZedPoseDatagram_t* pDatagram);
+
+//-----------------------------------------------------------------------------
+// Purpose: A body fusion node's side: registered as a skeleton listener of
+// the node's CZedBodyTracker, it sends every skeleton to the fusing driver
+// as it is published, one datagram each. Skeletons come at the detection
+// rate, so there is nothing to batch.
+//-----------------------------------------------------------------------------
+class CSkeletonStreamSender : public IBodySkeletonListener
+{
+public:
+	CSkeletonStreamSender();
+	~CSkeletonStreamSender();
+
+	/** pchHost is an IPv4 address or a host name; unNode is 1..k_unMaxFusionNodes */
+	bool Open(const char* pchHost, uint16_t unPort, uint32_t unNode);
+
+	/** After the listener was cleared */
+	void Close();
+
+	/** Any thread: the node camera's position, in the skeletons' space */
+	void SetCameraPosition(const double vecPosition[3]);
+
+	virtual void OnBodySkeleton(const ZedBodySkeleton_t* pSkeleton, const vr::DriverPose_t& poseTemplate, double flTimeOffset) override;
+
+	uint64_t GetSentCount() const { return m_ulSent.load(); }
+
+private:
+	struct CameraPosition_t
+	{
+		double vecPosition[3];
+	};
+
+	uintptr_t m_socket;
+	uint32_t m_unAddress; // network byte order
+	uint16_t m_unPort;
+	uint8_t m_unNode;
+	uint32_t m_unSequence; // the body tracker's publisher's
+	uint64_t m_ulLastTimestampNs; // of the last skeleton, the send time of a loss
+	std::atomic<uint64_t> m_ulSent;
+	CSeqLock<CameraPosition_t> m_cameraPosition;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Receives what CSkeletonStreamReceiver decoded, on its thread. The
+// skeleton's timestamp is on CPoseStreamReceiver::GetLocalTimeNs's clock,
+// pSkeleton is null when the node lost its body or went silent.
+//-----------------------------------------------------------------------------
+class ISkeletonStreamListener
+{
+public:
+	virtual void OnRemoteSkeleton(uint32_t unNode, const ZedBodySkeleton_t* pSkeleton, const double vecCamera[3]) = 0;
+
+protected:
+	virtual ~ISkeletonStreamListener() {}
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: The fusing driver's side: a UDP socket the nodes' skeletons
+// arrive on, from any number of nodes at once.
+//
+// Each node's timestamps are mapped onto the local steady clock by its own
+// CClockTranslator. The pairs fed to it are (send time, arrival) of the
+// datagrams whose transit was within k_ulTransitSlackNs of the fastest seen
+// lately, the ones that waited in no queue, so the fit follows the node's
+// offset and drift rather than the network's jitter. Like the pose stream,
+// the offset includes the fastest transit. A node silent for half a second
+// is reported lost and starts over with a fresh fit.
+//-----------------------------------------------------------------------------
+class CSkeletonStreamReceiver
+{
+public:
+	CSkeletonStreamReceiver();
+	~CSkeletonStreamReceiver();
+
+	/** Binds unPort on every interface and starts the receive thread, which calls pListener */
+	bool Start(uint16_t unPort, ISkeletonStreamListener* pListener);
+
+	/** Joins the receive thread; idempotent */
+	void Stop();
+
+	bool IsRunning() const { return m_pThread != nullptr; }
+
+	/** Any thread: the node's clock fit, false before its first datagram */
+	bool GetClockFit(uint32_t unNode, ClockFit_t* pFit) const;
+
+	uint64_t GetReceivedCount() const { return m_ulReceived.load(); }
+	uint64_t GetMalformedCount() const { return m_ulMalformed.load(); }
+
+private:
+	struct Node_t
+	{
+		bool bConnected;
+		uint32_t unLastSequence;
+		uint64_t ulLastReceivedNs;
+		int64_t rgnTransitMinNs[2]; // this bucket's and the last one's
+		uint64_t ulBucketStartNs;
+		CClockTranslator clock;
+	};
+
+	// a skeleton within this of the fastest transit carries a clock pair
+	static const uint64_t k_ulTransitSlackNs = 1000000;
+	// the fastest transit is the minimum over this and the bucket before
+	static const uint64_t k_ulTransitBucketNs = 1000000000ull;
+
+	void Run();
+	void Receive(const uint8_t* pData, size_t unSize, uint64_t ulReceivedNs);
+	void ReceiveClock(Node_t& node, uint64_t ulSendTimestampNs, uint64_t ulReceivedNs);
+
+	uintptr_t m_socket;
+	std::thread* m_pThread;
+	std::atomic<bool> m_bRunning;
+	ISkeletonStreamListener* m_pListener;
+	Node_t m_rgNodes[k_unMaxFusionNodes]; // by node id - 1
+	ZedBodySkeleton_t m_skeleton; // receive thread's, decoded into
+
+	std::atomic<uint64_t> m_ulReceived;
+	std::atomic<uint64_t> m_ulMalformed;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Live figures of a CPoseStreamReceiver, for DebugRequest("stats")
+//-----------------------------------------------------------------------------
+struct PoseStreamStats_t
+{
+	bool bConnected;
+	uint64_t ulReceived; // poses; a batch counts all of them
+	uint64_t ulLost; // sequence numbers never seen
+	uint64_t ulLate; // arrived after a newer datagram was played out
+	uint64_t ulMalformed;
+	double flClockOffsetMs; // receiver minus sender clock, including the fastest transit
+	double flJitterMs; // smoothed variation of the transit time
+	double flBufferDelayMs; // jitter buffer delay in effect
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Receiver mode of the driver: a UDP socket fed by zedm_posesender
+// on a remote node instead of a local camera.
+//
+// The receive thread translates sample timestamps into the local steady clock
+// with a sliding-window minimum of (arrival - send time). That is the clock
+// offset plus the fastest transit seen, so samples land at the earliest time
+// they could have arrived. Datagrams then wait in a small jitter buffer,
+// ordered by sequence number, until remoteJitterDelay past that time. They go
+// out in order, into the pose history and to the host; one that arrives after
+// a newer one was played out is dropped. After half a second without
+// datagrams the pose is published as out of range.
+//-----------------------------------------------------------------------------
+class CPoseStreamReceiver
+{
+public:
+	CPoseStreamReceiver();
+	~CPoseStreamReceiver();
+
+	/** Binds unPort on every interface and starts the receive thread */
+	bool Start(uint16_t unPort, double flJitterDelaySeconds);
+
+	/** Joins the receive thread; idempotent */
+	void Stop();
+
+	void SetObjectId(vr::TrackedDeviceIndex_t unObjectId) { m_unObjectId.store(unObjectId); }
+
+	/** The constant fields of the published poses; one thread at a time */
+	void SetPoseTemplate(const vr::DriverPose_t& poseTemplate) { m_poseTemplate.Write(poseTemplate); }
+
+	/** Latest pose played out, 0 if none yet. The timestamp is on GetLocalTimeNs's clock. */
+	uint32_t ReadPose(vr::DriverPose_t* pPose, uint64_t* pulSampleTimestampNs = nullptr) const;
+
+	/** The played-out poses interpolated or extrapolated to ulTimestampNs on GetLocalTimeNs's clock */
+	bool GetPoseAt(uint64_t ulTimestampNs, vr::DriverPose_t* pPose) const;
+
+	void GetStats(PoseStreamStats_t* pStats) const;
+
+	/** The clock of the translated timestamps */
+	static uint64_t GetLocalTimeNs();
+
+private:
+	struct PlayedOutPose_t
+	{
+		vr::DriverPose_t pose;
+		uint64_t ulSampleTimestampNs;
+	};
+
+	struct BufferedPose_t
+	{
+		ZedPoseDatagram_t datagram;
+		uint64_t ulLocalSampleNs;
+		uint64_t ulReleaseNs; // local time it is played out
+	};
+
+	// a few frames at IMU rate; a datagram that would need more is released early
+	static const uint32_t k_unJitterBufferSize = 32;
+	// the offset minimum is kept per bucket, so the window slides by one bucket at a time
+	static const uint32_t k_unOffsetBuckets = 8;
+
+	void Run();
+	void Receive(const uint8_t* pData, size_t unSize, uint64_t ulReceivedNs);
+	void ReceiveClock(uint64_t ulSendTimestampNs, uint64_t ulReceivedNs);
+	void Buffer(const ZedPoseDatagram_t& datagram, uint64_t ulReceivedNs);
+	void UpdateClockOffset(int64_t nOffsetNs, uint64_t ulReceivedNs);
+	void ReleaseDue(uint64_t ulNowNs);
+	void PlayOut(const BufferedPose_t& buffered, uint64_t ulNowNs);
+	void PublishLinkLost();
+
+	uintptr_t m_socket;
+	std::thread* m_pThread;
+	std::atomic<bool> m_bRunning;
+	std::atomic<vr::TrackedDeviceIndex_t> m_unObjectId;
+	uint64_t m_ulJitterDelayNs;
+	CSeqLock<vr::DriverPose_t> m_poseTemplate;
+
+	// receive thread's
+	BufferedPose_t m_rgBuffer[k_unJitterBufferSize]; // by sequence, oldest first
+	uint32_t m_unBuffered;
+	bool m_bHavePlayedOut;
+	uint32_t m_unLastSequence;
+	uint64_t m_ulLastLocalSampleNs;
+	uint64_t m_ulLastReceivedNs;
+	int64_t m_rgnOffsetMinNs[k_unOffsetBuckets];
+	uint64_t m_ulOffsetBucketStartNs;
+	uint32_t m_unOffsetBucket;
+	bool m_bHaveOffset;
+	int64_t m_nPreviousTransitNs;
+	double m_flJitterNs;
+
+	CSeqLock<PlayedOutPose_t> m_poseHandoff;
+	CPoseHistory m_poseHistory;
+
+	// written by the receive thread, read by GetStats
+	std::atomic<bool> m_bConnected;
+	std::atomic<uint64_t> m_ulReceived;
+	std::atomic<uint64_t> m_ulLost;
+	std::atomic<uint64_t> m_ulLate;
+	std::atomic<uint64_t> m_ulMalformed;
+	std::atomic<int64_t> m_nClockOffsetNs;
+	std::atomic<double> m_flJitterReportNs;
+};
+
+#endif // POSESTREAM_H
@@ -0,0 +1,108 @@
+#include "precisetimer.h"
+#include "latencystats.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+// Windows 10 1803 and later; older versions fail the create
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <errno.h>
+#include <time.h>
+#endif
+
+#include <chrono>
+#include <thread>
+
+// steady_clock is QueryPerformanceCounter on Windows and CLOCK_MONOTONIC elsewhere
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CPreciseTimer::CPreciseTimer()
+	: m_hTimer(nullptr)
+	, m_bRaisedTimerResolution(false)
+	, m_ulPeriodNs(0)
+	, m_ulNextTickNs(0)
+	, m_pLateness(nullptr)
+	, m_ulMissedTicks(0)
+{
+#if defined(_WIN32)
+	m_hTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!m_hTimer)
+	{
+		// a plain waitable timer is bound to the system timer resolution (15.6ms by default)
+		m_hTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+		timeBeginPeriod(1);
+		m_bRaisedTimerResolution = true;
+	}
+#endif
+}
+
+CPreciseTimer::~CPreciseTimer()
+{
+#if defined(_WIN32)
+	if (m_hTimer)
+		CloseHandle(m_hTimer);
+	if (m_bRaisedTimerResolution)
+		timeEndPeriod(1);
+#endif
+}
+
+void CPreciseTimer::Start(uint64_t ulPeriodNs, CLatencyHistogram* pLateness)
+{
+	m_ulPeriodNs = ulPeriodNs > 0 ? ulPeriodNs : 1;
+	m_ulNextTickNs = GetSteadyNanoseconds() + m_ulPeriodNs;
+	m_pLateness = pLateness;
+	m_ulMissedTicks.store(0, std::memory_order_relaxed);
+}
+
+uint32_t CPreciseTimer::WaitForNextTick()
+{
+	SleepUntil(m_ulNextTickNs);
+
+	uint64_t ulNowNs = GetSteadyNanoseconds();
+	if (m_pLateness)
+		m_pLateness->Record(ulNowNs > m_ulNextTickNs ? ulNowNs - m_ulNextTickNs : 0);
+
+	// the schedule stays where Start put it, a late wake-up doesn't push the next tick back
+	m_ulNextTickNs += m_ulPeriodNs;
+	if (ulNowNs < m_ulNextTickNs)
+		return 0;
+
+	uint64_t ulSkipped = (ulNowNs - m_ulNextTickNs) / m_ulPeriodNs + 1;
+	m_ulNextTickNs += ulSkipped * m_ulPeriodNs;
+	m_ulMissedTicks.fetch_add(ulSkipped, std::memory_order_relaxed);
+	return (uint32_t)ulSkipped;
+}
+
+void CPreciseTimer::SleepUntil(uint64_t ulDeadlineNs)
+{
+	uint64_t ulNowNs = GetSteadyNanoseconds();
+	if (ulDeadlineNs <= ulNowNs)
+		return;
+
+#if defined(_WIN32)
+	if (m_hTimer)
+	{
+		// relative, in 100 ns units, rounded up so the wait never ends early
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -(LONGLONG)((ulDeadlineNs - ulNowNs + 99) / 100);
+		if (SetWaitableTimerEx(m_hTimer, &dueTime, 0, nullptr, nullptr, nullptr, 0))
+		{
+			WaitForSingleObject(m_hTimer, INFINITE);
+			return;
+		}
+	}
+	std::this_thread::sleep_for(std::chrono::nanoseconds(ulDeadlineNs - ulNowNs));
+#else
+	timespec deadline;
+	deadline.tv_sec = (time_t)(ulDeadlineNs / 1000000000);
+	deadline.tv_nsec = (long)(ulDeadlineNs % 1000000000);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR)
+	{
+	}
+#endif
+}
@@ -0,0 +1,55 @@
+#ifndef PRECISETIMER_H
+#define PRECISETIMER_H
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+class CLatencyHistogram;
+
+//-----------------------------------------------------------------------------
+// Purpose: Periodic wake-ups for a publishing thread, on an absolute schedule
+// so the work done between them doesn't add up as drift. Sleeps on a high
+// resolution waitable timer on Windows (with timeBeginPeriod(1) where those
+// aren't available) and on clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME)
+// elsewhere. Times are on the steady clock.
+//
+// A tick that is overslept entirely is skipped and counted rather than run
+// in a burst, so a stalled thread catches up with the schedule, not with the
+// work. One thread per timer; create it on the thread that waits on it.
+//-----------------------------------------------------------------------------
+class CPreciseTimer
+{
+public:
+	CPreciseTimer();
+	~CPreciseTimer();
+
+	/** Ticks every ulPeriodNs from now. How late each wake-up is goes into pLateness, if given. */
+	void Start(uint64_t ulPeriodNs, CLatencyHistogram* pLateness = nullptr);
+
+	/** Sleeps until the next tick; returns the ticks that were skipped since the last one */
+	uint32_t WaitForNextTick();
+
+	/** Sleeps until ulDeadlineNs on the steady clock, without moving the schedule */
+	void SleepUntil(uint64_t ulDeadlineNs);
+
+	uint64_t GetNextTickNs() const { return m_ulNextTickNs; }
+	uint64_t GetPeriodNs() const { return m_ulPeriodNs; }
+
+	/** Any thread: ticks skipped since Start */
+	uint64_t GetMissedTicks() const { return m_ulMissedTicks.load(std::memory_order_relaxed); }
+
+	/** True when the waits don't depend on the system timer resolution */
+	bool IsHighResolution() const { return !m_bRaisedTimerResolution; }
+
+private:
+	void* m_hTimer;
+	bool m_bRaisedTimerResolution;
+	uint64_t m_ulPeriodNs;
+	uint64_t m_ulNextTickNs;
+	CLatencyHistogram* m_pLateness;
+	std::atomic<uint64_t> m_ulMissedTicks;
+};
+
+#endif // PRECISETIMER_H
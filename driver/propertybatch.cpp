@@ -0,0 +1,75 @@
+#include "propertybatch.h"
+#include "driverlog.h"
+
+using namespace vr;
+
+void CPropertyBatch::Add(ETrackedDeviceProperty prop, PropertyTypeTag_t unTag, void* pvBuffer, uint32_t unBufferSize)
+{
+	PropertyWrite_t write = {};
+	write.prop = prop;
+	write.writeType = PropertyWrite_Set;
+	write.pvBuffer = pvBuffer;
+	write.unBufferSize = unBufferSize;
+	write.unTag = unTag;
+	m_vecWrites.push_back(write);
+}
+
+CPropertyBatch::Value_t* CPropertyBatch::AddValue()
+{
+	m_values.emplace_back();
+	return &m_values.back();
+}
+
+void CPropertyBatch::SetString(ETrackedDeviceProperty prop, const std::string& sValue)
+{
+	m_strings.push_back(sValue);
+	std::string& sStored = m_strings.back();
+	Add(prop, k_unStringPropertyTag, &sStored[0], (uint32_t)sStored.size() + 1);
+}
+
+void CPropertyBatch::SetBool(ETrackedDeviceProperty prop, bool bValue)
+{
+	Value_t* pValue = AddValue();
+	pValue->bValue = bValue;
+	Add(prop, k_unBoolPropertyTag, &pValue->bValue, sizeof(bool));
+}
+
+void CPropertyBatch::SetInt32(ETrackedDeviceProperty prop, int32_t nValue)
+{
+	Value_t* pValue = AddValue();
+	pValue->nValue = nValue;
+	Add(prop, k_unInt32PropertyTag, &pValue->nValue, sizeof(int32_t));
+}
+
+void CPropertyBatch::SetUint64(ETrackedDeviceProperty prop, uint64_t ulValue)
+{
+	Value_t* pValue = AddValue();
+	pValue->ulValue = ulValue;
+	Add(prop, k_unUint64PropertyTag, &pValue->ulValue, sizeof(uint64_t));
+}
+
+void CPropertyBatch::SetFloat(ETrackedDeviceProperty prop, float flValue)
+{
+	Value_t* pValue = AddValue();
+	pValue->flValue = flValue;
+	Add(prop, k_unFloatPropertyTag, &pValue->flValue, sizeof(float));
+}
+
+ETrackedPropertyError CPropertyBatch::Write(PropertyContainerHandle_t ulPropertyContainer)
+{
+	ETrackedPropertyError eError = TrackedProp_Success;
+	if (!m_vecWrites.empty())
+	{
+		eError = VRPropertiesRaw()->WritePropertyBatch(ulPropertyContainer, m_vecWrites.data(), (uint32_t)m_vecWrites.size());
+		for (const PropertyWrite_t& write : m_vecWrites)
+		{
+			if (write.eError != TrackedProp_Success)
+				DriverLog("Unable to set property %d: %s\n", (int)write.prop, VRPropertiesRaw()->GetPropErrorNameFromEnum(write.eError));
+		}
+	}
+
+	m_vecWrites.clear();
+	m_values.clear();
+	m_strings.clear();
+	return eError;
+}
@@ -0,0 +1,51 @@
+#ifndef PROPERTYBATCH_H
+#define PROPERTYBATCH_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Purpose: The properties of a device collected in Activate and written with
+// one IVRProperties::WritePropertyBatch (the raw interface, the helpers
+// don't have it), a single round trip into vrserver instead of one per
+// property. The values are copied, so temporaries are
+// fine. Failed entries are logged by Write.
+//-----------------------------------------------------------------------------
+class CPropertyBatch
+{
+public:
+	void SetString(vr::ETrackedDeviceProperty prop, const std::string& sValue);
+	void SetBool(vr::ETrackedDeviceProperty prop, bool bValue);
+	void SetInt32(vr::ETrackedDeviceProperty prop, int32_t nValue);
+	void SetUint64(vr::ETrackedDeviceProperty prop, uint64_t ulValue);
+	void SetFloat(vr::ETrackedDeviceProperty prop, float flValue);
+
+	/** Writes everything set so far and starts over */
+	vr::ETrackedPropertyError Write(vr::PropertyContainerHandle_t ulPropertyContainer);
+
+private:
+	union Value_t
+	{
+		bool bValue;
+		int32_t nValue;
+		uint64_t ulValue;
+		float flValue;
+	};
+
+	void Add(vr::ETrackedDeviceProperty prop, vr::PropertyTypeTag_t unTag, void* pvBuffer, uint32_t unBufferSize);
+	Value_t* AddValue();
+
+	std::vector<vr::PropertyWrite_t> m_vecWrites;
+
+	// deques, so the buffers the writes point at stay where they are
+	std::deque<Value_t> m_values;
+	std::deque<std::string> m_strings;
+};
+
+#endif // PROPERTYBATCH_H
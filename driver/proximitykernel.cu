@@ -0,0 +1,53 @@
+//-----------------------------------------------------------------------------
+// Purpose: The nearest obstacle per sector of the camera's view, for
+// CProximityWarning. Compiled to PTX at build time, embedded in the driver
+// and loaded through the driver API in the SDK's context, so the driver
+// needs no CUDA runtime. One thread per depth pixel: the point is levelled
+// with the camera's tilt, kept if it is between the heights of an obstacle,
+// and its horizontal distance goes into its sector's minimum, first per
+// block in shared memory, then once per block and sector in global memory.
+//-----------------------------------------------------------------------------
+#include "proximitykernel.h"
+
+extern "C" __global__ void ProximitySectors(ProximityKernelParams_t params)
+{
+	__shared__ unsigned int rgunBlockMm[k_unMaxProximitySectors];
+	unsigned int unThread = threadIdx.y * blockDim.x + threadIdx.x;
+	if (unThread < params.unSectors)
+		rgunBlockMm[unThread] = 0xffffffffu;
+	__syncthreads();
+
+	unsigned int x = blockIdx.x * blockDim.x + threadIdx.x;
+	unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
+	if (x < params.unWidth && y < params.unHeight)
+	{
+		const float* pRow = (const float*)(params.ulDepth + (unsigned long long)y * params.unPitch);
+		float flDepth = pRow[x];
+
+		// false for NaN and both infinities: occluded, too far and too close to measure
+		if (flDepth > 0.0f && flDepth < 1e6f)
+		{
+			// right handed, y up, looking down -z
+			float cx = (x - params.flCx) / params.flFx * flDepth;
+			float cy = (params.flCy - y) / params.flFy * flDepth;
+			float cz = -flDepth;
+			const float* R = params.rgflLevelFromCamera;
+			float lx = R[0] * cx + R[1] * cy + R[2] * cz;
+			float ly = R[3] * cx + R[4] * cy + R[5] * cz;
+			float lz = R[6] * cx + R[7] * cy + R[8] * cz;
+
+			float flHeight = params.flCameraHeight + ly;
+			float flDistance = sqrtf(lx * lx + lz * lz);
+			if (flHeight >= params.flMinHeight && flHeight <= params.flMaxHeight && flDistance <= params.flMaxDistance)
+			{
+				int nSector = (int)floorf((atan2f(lx, -lz) - params.flFirstAngle) / params.flSectorAngle);
+				if (nSector >= 0 && nSector < (int)params.unSectors)
+					atomicMin(&rgunBlockMm[nSector], (unsigned int)(flDistance * 1000.0f));
+			}
+		}
+	}
+	__syncthreads();
+
+	if (unThread < params.unSectors && rgunBlockMm[unThread] != 0xffffffffu)
+		atomicMin((unsigned int*)params.ulSectorMm + unThread, rgunBlockMm[unThread]);
+}
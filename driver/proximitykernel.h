@@ -0,0 +1,37 @@
+#ifndef PROXIMITYKERNEL_H
+#define PROXIMITYKERNEL_H
+
+#pragma once
+
+#include <stdint.h>
+
+// the most sectors the kernel reduces into, one per thread of the first warp
+static const uint32_t k_unMaxProximitySectors = 32;
+
+// threads per block along each axis of the depth map
+static const uint32_t k_unProximityBlockSize = 16;
+
+//-----------------------------------------------------------------------------
+// Purpose: The one argument of the ProximitySectors kernel in
+// proximitykernel.cu, filled in by CProximityWarning. Plain types only, the
+// same layout on the host and in the PTX. Pointers are device addresses.
+//-----------------------------------------------------------------------------
+struct ProximityKernelParams_t
+{
+	uint64_t ulDepth; // F32_C1 meters, NaN and +-infinity where there is no depth
+	uint64_t ulSectorMm; // uint32_t per sector, nearest distance in mm, UINT32_MAX for none
+	uint32_t unPitch; // bytes per depth row
+	uint32_t unWidth;
+	uint32_t unHeight;
+	uint32_t unSectors;
+	float flFx, flFy, flCx, flCy; // intrinsics at the depth map's resolution
+	float rgflLevelFromCamera[9]; // row major: camera axes to gravity level, yaw kept
+	float flCameraHeight; // meters above the floor
+	float flMinHeight; // obstacles are points between these heights above the floor
+	float flMaxHeight;
+	float flMaxDistance; // meters, horizontally
+	float flFirstAngle; // radians, left edge of sector 0, negative to the left
+	float flSectorAngle;
+};
+
+#endif // PROXIMITYKERNEL_H
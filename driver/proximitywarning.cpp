@@ -0,0 +1,224 @@
+#include "proximitywarning.h"
+#include "driverlog.h"
+#include "hmdmath.h"
+#include "proximitykernel_ptx.h"
+#include "tracezones.h"
+
+#include <math.h>
+#include <string.h>
+
+using namespace sl;
+
+CProximityWarning::CProximityWarning()
+	: m_cuContext(nullptr)
+	, m_cuModule(nullptr)
+	, m_cuFunction(nullptr)
+	, m_cuSectorMm(0)
+	, m_punSectorMm(nullptr)
+	, m_cuStart(nullptr)
+	, m_cuDone(nullptr)
+	, m_bInFlight(false)
+	, m_ulInFlightTimestampNs(0)
+	, m_unFrameSequence(0)
+	, m_ulGpuNs(0)
+{
+	memset(&m_params, 0, sizeof(m_params));
+}
+
+CProximityWarning::~CProximityWarning()
+{
+	Close();
+}
+
+bool CProximityWarning::Open(Camera& zed, uint32_t unSectors, float flRange)
+{
+	Close();
+
+	m_cuContext = zed.getCUDAContext();
+	if (!m_cuContext || cuCtxPushCurrent(m_cuContext) != CUDA_SUCCESS)
+	{
+		DriverLog("Proximity warning: no CUDA context\n");
+		m_cuContext = nullptr;
+		return false;
+	}
+
+	// JIT compiled for this GPU on the first load, the driver caches it after that
+	CUresult eResult = cuModuleLoadData(&m_cuModule, k_rgchProximityPtx);
+	if (eResult == CUDA_SUCCESS)
+		eResult = cuModuleGetFunction(&m_cuFunction, m_cuModule, "ProximitySectors");
+	if (eResult != CUDA_SUCCESS)
+		DriverLog("Proximity warning: unable to load the kernel (CUDA error %d)\n", (int)eResult);
+
+	unSectors = unSectors < 1 ? 1 : unSectors > k_unMaxProximitySectors ? k_unMaxProximitySectors : unSectors;
+	bool bOk = eResult == CUDA_SUCCESS
+		&& cuMemAlloc(&m_cuSectorMm, unSectors * sizeof(uint32_t)) == CUDA_SUCCESS
+		&& cuMemAllocHost((void**)&m_punSectorMm, unSectors * sizeof(uint32_t)) == CUDA_SUCCESS
+		&& cuEventCreate(&m_cuStart, CU_EVENT_DEFAULT) == CUDA_SUCCESS
+		&& cuEventCreate(&m_cuDone, CU_EVENT_DEFAULT) == CUDA_SUCCESS;
+	if (bOk && !m_stream.Create())
+		DriverLog("Proximity warning: no low-priority CUDA stream, running on the SDK's\n");
+
+	CUcontext cuPopped;
+	cuCtxPopCurrent(&cuPopped);
+
+	if (!bOk)
+	{
+		m_cuFunction = nullptr;
+		Close();
+		return false;
+	}
+
+	// the depth is the left camera's, its intrinsics scaled to the resampled map
+	const CameraParameters& left = zed.getCameraInformation().camera_configuration.calibration_parameters.left_cam;
+	Resolution resolution = zed.getCameraInformation().camera_configuration.resolution;
+	m_params.unWidth = (uint32_t)resolution.width / k_unDepthDivisor;
+	m_params.unHeight = (uint32_t)resolution.height / k_unDepthDivisor;
+	m_params.ulSectorMm = (uint64_t)m_cuSectorMm;
+	m_params.unSectors = unSectors;
+	float flScaleX = (float)m_params.unWidth / (float)resolution.width;
+	float flScaleY = (float)m_params.unHeight / (float)resolution.height;
+	m_params.flFx = left.fx * flScaleX;
+	m_params.flFy = left.fy * flScaleY;
+	m_params.flCx = left.cx * flScaleX;
+	m_params.flCy = left.cy * flScaleY;
+	m_params.flMinHeight = k_flMinObstacleHeight;
+	m_params.flMaxHeight = k_flMaxObstacleHeight;
+	m_params.flMaxDistance = flRange > 0.0f ? flRange : 1.0f;
+
+	// the sectors span the wider half of the view on both sides of the heading
+	float flHalfView = atanf((left.cx > resolution.width - left.cx ? left.cx : resolution.width - left.cx) / left.fx);
+	m_params.flFirstAngle = -flHalfView;
+	m_params.flSectorAngle = 2.0f * flHalfView / unSectors;
+
+	DriverLog("Proximity warning: %u sectors of %.0f degrees, %.1f m range, on %ux%u depth\n", unSectors,
+		m_params.flSectorAngle * 180.0f / 3.14159265f, m_params.flMaxDistance, m_params.unWidth, m_params.unHeight);
+	return true;
+}
+
+void CProximityWarning::Close()
+{
+	bool bPushed = m_cuContext && cuCtxPushCurrent(m_cuContext) == CUDA_SUCCESS;
+	if (bPushed)
+	{
+		// nothing may still write into the memory freed below
+		if (m_bInFlight)
+			cuEventSynchronize(m_cuDone);
+		if (m_cuStart)
+			cuEventDestroy(m_cuStart);
+		if (m_cuDone)
+			cuEventDestroy(m_cuDone);
+		if (m_punSectorMm)
+			cuMemFreeHost(m_punSectorMm);
+		if (m_cuSectorMm)
+			cuMemFree(m_cuSectorMm);
+		if (m_cuModule)
+			cuModuleUnload(m_cuModule);
+		m_stream.Destroy();
+	}
+	m_gpuDepth.free();
+	if (bPushed)
+	{
+		CUcontext cuPopped;
+		cuCtxPopCurrent(&cuPopped);
+	}
+
+	m_cuContext = nullptr;
+	m_cuModule = nullptr;
+	m_cuFunction = nullptr;
+	m_cuSectorMm = 0;
+	m_punSectorMm = nullptr;
+	m_cuStart = m_cuDone = nullptr;
+	m_bInFlight = false;
+
+	ProximitySectors_t none;
+	memset(&none, 0, sizeof(none));
+	m_sectors.Write(none);
+}
+
+void CProximityWarning::SubmitFrame(Camera& zed, const double vecPosition[3], const vr::HmdQuaternion_t& qRotation, double flFloorHeight,
+	uint64_t ulImageTimestampNs)
+{
+	if (!m_cuFunction)
+		return;
+
+	TRACE_ZONE("proximityWarning");
+
+	// the previous kernel first; while it runs, its depth map can't be replaced
+	if (m_bInFlight)
+	{
+		CUresult eDone = cuEventQuery(m_cuDone);
+		if (eDone == CUDA_ERROR_NOT_READY)
+			return;
+		m_bInFlight = false;
+		if (eDone == CUDA_SUCCESS)
+			PublishSectors();
+	}
+
+	{
+		// resampled by the SDK on its stream, without leaving the GPU
+		TRACE_ZONE("retrieveMeasure");
+		if (zed.retrieveMeasure(m_gpuDepth, MEASURE::DEPTH, MEM::GPU, Resolution(m_params.unWidth, m_params.unHeight)) != ERROR_CODE::SUCCESS)
+			return;
+	}
+	if (m_gpuDepth.getWidth() != m_params.unWidth || m_gpuDepth.getHeight() != m_params.unHeight)
+		return;
+
+	// the camera's tilt taken out, its heading kept: yaw of the forward (-z) axis
+	double vecForward[3];
+	double vecMinusZ[3] = { 0.0, 0.0, -1.0 };
+	HmdQuaternion_RotateVector(qRotation, vecMinusZ, vecForward);
+	vr::HmdQuaternion_t qYaw = HmdQuaternion_FromYawPitchRoll(atan2(-vecForward[0], -vecForward[2]), 0.0, 0.0);
+	double rgflLevel[3][3];
+	HmdQuaternion_ToMatrix(HmdQuaternion_Multiply(HmdQuaternion_Conjugate(qYaw), qRotation), rgflLevel);
+
+	ProximityKernelParams_t params = m_params;
+	params.ulDepth = (uint64_t)(uintptr_t)m_gpuDepth.getPtr<sl::uchar1>(MEM::GPU);
+	params.unPitch = (uint32_t)m_gpuDepth.getStepBytes(MEM::GPU);
+	for (int i = 0; i < 9; i++)
+		params.rgflLevelFromCamera[i] = (float)rgflLevel[i / 3][i % 3];
+	params.flCameraHeight = (float)(vecPosition[1] - flFloorHeight);
+
+	if (cuCtxPushCurrent(m_cuContext) != CUDA_SUCCESS)
+		return;
+
+	// after the resampling, at low priority
+	CUstream cuStream = m_stream.Follow(zed.getCUDAStream());
+	void* rgpArgs[] = { &params };
+	cuEventRecord(m_cuStart, cuStream);
+	bool bQueued = cuMemsetD32Async(m_cuSectorMm, 0xffffffffu, params.unSectors, cuStream) == CUDA_SUCCESS
+		&& cuLaunchKernel(m_cuFunction, (params.unWidth + k_unProximityBlockSize - 1) / k_unProximityBlockSize,
+			(params.unHeight + k_unProximityBlockSize - 1) / k_unProximityBlockSize, 1,
+			k_unProximityBlockSize, k_unProximityBlockSize, 1, 0, cuStream, rgpArgs, nullptr) == CUDA_SUCCESS
+		&& cuMemcpyDtoHAsync(m_punSectorMm, m_cuSectorMm, params.unSectors * sizeof(uint32_t), cuStream) == CUDA_SUCCESS
+		&& cuEventRecord(m_cuDone, cuStream) == CUDA_SUCCESS;
+
+	CUcontext cuPopped;
+	cuCtxPopCurrent(&cuPopped);
+
+	m_bInFlight = bQueued;
+	m_ulInFlightTimestampNs = ulImageTimestampNs;
+}
+
+void CProximityWarning::PublishSectors()
+{
+	float flGpuMs;
+	if (cuEventElapsedTime(&flGpuMs, m_cuStart, m_cuDone) == CUDA_SUCCESS)
+		m_ulGpuNs += (uint64_t)(flGpuMs * 1e6f);
+
+	ProximitySectors_t sectors;
+	memset(&sectors, 0, sizeof(sectors));
+	sectors.unSectors = m_params.unSectors;
+	sectors.flFirstAngle = m_params.flFirstAngle;
+	sectors.flSectorAngle = m_params.flSectorAngle;
+	sectors.flRange = m_params.flMaxDistance;
+	for (uint32_t i = 0; i < m_params.unSectors; i++)
+		sectors.rgflDistance[i] = m_punSectorMm[i] == 0xffffffffu ? -1.0f : m_punSectorMm[i] * 0.001f;
+	sectors.unFrameSequence = ++m_unFrameSequence;
+	sectors.ulImageTimestampNs = m_ulInFlightTimestampNs;
+	m_sectors.Write(sectors);
+}
+
+bool CProximityWarning::GetSectors(ProximitySectors_t* pSectors) const
+{
+	return m_sectors.Read(pSectors) != 0 && pSectors->unSectors != 0;
+}
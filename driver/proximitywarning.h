@@ -0,0 +1,97 @@
+#ifndef PROXIMITYWARNING_H
+#define PROXIMITYWARNING_H
+
+#pragma once
+
+#include <sl/Camera.hpp>
+#include <openvr_driver.h>
+#include <cuda.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include "cudadevice.h"
+#include "proximitykernel.h"
+#include "seqlock.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: The nearest obstacle in each sector of the camera's horizontal
+// field of view, as CProximityWarning last measured it
+//-----------------------------------------------------------------------------
+struct ProximitySectors_t
+{
+	uint32_t unSectors; // 0 until the first measurement
+	float flFirstAngle; // radians from the camera's heading to the left edge of sector 0, negative to the left
+	float flSectorAngle;
+	float flRange; // meters; nothing nearer than this is -1
+	float rgflDistance[k_unMaxProximitySectors]; // meters, horizontally from the camera, or -1
+	uint32_t unFrameSequence;
+	uint64_t ulImageTimestampNs; // ZED clock
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Collision warnings for obstacles the spatial map doesn't have,
+// e.g. a chair moved into the room, at a fraction of mapping's cost. The SDK
+// resamples the depth of each grab to 1/k_unDepthDivisor of the image
+// resolution in GPU memory, and a small kernel (proximitykernel.cu) reduces
+// it to the nearest distance per sector: points levelled with the camera's
+// tilt, between k_flMinObstacleHeight and k_flMaxObstacleHeight above the
+// floor, measured horizontally. Only the sector distances are copied back.
+//
+// The kernel runs on a low-priority stream after the SDK's work and nothing
+// waits for it. The next SubmitFrame publishes the result once its event has
+// completed, so the sectors are one frame old; a frame whose predecessor is
+// still running on the GPU is skipped rather than queued. Everything but
+// GetSectors and GetGpuNanoseconds is called from the grab thread.
+//-----------------------------------------------------------------------------
+class CProximityWarning
+{
+public:
+	CProximityWarning();
+	~CProximityWarning();
+
+	/** Loads the kernel for the camera that was just opened; unSectors is clamped to 1..k_unMaxProximitySectors */
+	bool Open(sl::Camera& zed, uint32_t unSectors, float flRange);
+	void Close();
+	bool IsOpen() const { return m_cuFunction != nullptr; }
+
+	/** Publishes the previous frame's sectors if they are ready, then measures the depth of the
+	* last grab(). The camera pose and the floor height are in driver space. */
+	void SubmitFrame(sl::Camera& zed, const double vecPosition[3], const vr::HmdQuaternion_t& qRotation, double flFloorHeight,
+		uint64_t ulImageTimestampNs);
+
+	/** Any thread: false until the first measurement */
+	bool GetSectors(ProximitySectors_t* pSectors) const;
+
+	/** Any thread: GPU time of the kernels and copies so far, from CUDA events around them */
+	uint64_t GetGpuNanoseconds() const { return m_ulGpuNs.load(); }
+
+private:
+	CProximityWarning(const CProximityWarning&) = delete;
+	CProximityWarning& operator=(const CProximityWarning&) = delete;
+
+	static const uint32_t k_unDepthDivisor = 4;
+	static constexpr float k_flMinObstacleHeight = 0.15f; // as the chaperone generator's
+	static constexpr float k_flMaxObstacleHeight = 2.0f;
+
+	void PublishSectors();
+
+	CUcontext m_cuContext; // the ZED SDK's
+	CUmodule m_cuModule;
+	CUfunction m_cuFunction;
+	CUdeviceptr m_cuSectorMm;
+	uint32_t* m_punSectorMm; // page-locked, the kernel's result copied back
+	CUevent m_cuStart;
+	CUevent m_cuDone;
+	CLowPriorityStream m_stream;
+	sl::Mat m_gpuDepth; // reused for every frame, at the reduced resolution
+	ProximityKernelParams_t m_params; // what doesn't change per frame
+	bool m_bInFlight;
+	uint64_t m_ulInFlightTimestampNs;
+	uint32_t m_unFrameSequence;
+	std::atomic<uint64_t> m_ulGpuNs;
+
+	CSeqLock<ProximitySectors_t> m_sectors;
+};
+
+#endif // PROXIMITYWARNING_H
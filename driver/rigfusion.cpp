@@ -0,0 +1,296 @@
+#include "rigfusion.h"
+#include "driverlog.h"
+#include "hmdmath.h"
+#include "precisetimer.h"
+#include "threadscheduling.h"
+#include "tracezones.h"
+#include "zedtracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+using namespace vr;
+
+// the IMU publishers run at IMU rate; the rig pose is put together about as often
+static const std::chrono::microseconds k_FusionInterval(2000);
+
+// how fast a camera's alignment follows once set; its drift is slow
+static const double k_flAlignTimeConstant = 10.0;
+
+// an estimate from dead reckoning counts this much against a tracked one
+static const double k_flDeadReckoningWeight = 0.25;
+
+static const double k_flDegreesToRadians = 3.14159265358979323846 / 180.0;
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void Cross(const double a[3], const double b[3], double vecOut[3])
+{
+	vecOut[0] = a[1] * b[2] - a[2] * b[1];
+	vecOut[1] = a[2] * b[0] - a[0] * b[2];
+	vecOut[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+bool ParseRigCameras(const std::string& sRigCameras, std::vector<RigCamera_t>* pvecCameras)
+{
+	pvecCameras->clear();
+	std::stringstream entries(sRigCameras);
+	std::string sEntry;
+	while (std::getline(entries, sEntry, ';'))
+	{
+		if (sEntry.find_first_not_of(" \t") == std::string::npos)
+			continue;
+
+		std::istringstream fields(sEntry);
+		RigCamera_t camera;
+		double flYaw, flPitch, flRoll;
+		if (!(fields >> camera.unSerial >> camera.vecPosition[0] >> camera.vecPosition[1] >> camera.vecPosition[2] >> flYaw >> flPitch >> flRoll))
+			return false;
+		camera.qRotation = HmdQuaternion_FromYawPitchRoll(flYaw * k_flDegreesToRadians, flPitch * k_flDegreesToRadians, flRoll * k_flDegreesToRadians);
+		pvecCameras->push_back(camera);
+	}
+	return true;
+}
+
+CRigFusion::CRigFusion()
+	: m_pThread(nullptr)
+	, m_bStopRequested(false)
+	, m_unObjectId(k_unTrackedDeviceIndexInvalid)
+	, m_ulConfidenceComponent(k_ulInvalidInputComponentHandle)
+	, m_flConfidence(-1.0f)
+{
+}
+
+CRigFusion::~CRigFusion()
+{
+	Stop();
+}
+
+void CRigFusion::Start(const std::vector<CZedTracker*>& vecTrackers, const std::vector<RigCamera_t>& vecCameras, const ZedmSettings_t& settings)
+{
+	Stop();
+
+	m_vecMembers.clear();
+	for (size_t i = 0; i < vecTrackers.size() && i < vecCameras.size(); i++)
+	{
+		Member_t member;
+		member.pTracker = vecTrackers[i];
+		member.camera = vecCameras[i];
+		member.bAligned = i == 0;
+		member.qAlign = HmdQuaternion_Identity();
+		member.vecAlign[0] = member.vecAlign[1] = member.vecAlign[2] = 0.0;
+		m_vecMembers.push_back(member);
+	}
+	m_settings = settings;
+	m_bStopRequested = false;
+	m_pThread = new std::thread(&CRigFusion::Run, this);
+	DriverLog("Rig of %u cameras, ZED %u first\n", (unsigned)m_vecMembers.size(), m_vecMembers.empty() ? 0u : m_vecMembers[0].camera.unSerial);
+}
+
+void CRigFusion::Stop()
+{
+	if (!m_pThread)
+		return;
+
+	m_bStopRequested = true;
+	m_pThread->join();
+	delete m_pThread;
+	m_pThread = nullptr;
+}
+
+void CRigFusion::SetConfidenceComponent(VRInputComponentHandle_t ulComponent)
+{
+	m_flConfidence = -1.0f;
+	m_ulConfidenceComponent = ulComponent;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The rig body as one camera sees it now, from its pose history
+//-----------------------------------------------------------------------------
+bool CRigFusion::Sample(Member_t& member, BodyEstimate_t* pEstimate)
+{
+	DriverPose_t pose;
+	if (!member.pTracker->GetPoseAt(member.pTracker->GetCameraTimeNs(), &pose))
+		return false;
+
+	if (pose.result == TrackingResult_Running_OK)
+		pEstimate->flWeight = 1.0;
+	else if (pose.result == TrackingResult_Fallback_RotationOnly)
+		pEstimate->flWeight = k_flDeadReckoningWeight;
+	else
+		return false;
+	pEstimate->eResult = pose.result;
+
+	// body = camera * inverse(camera in body)
+	pEstimate->qRotation = HmdQuaternion_Multiply(pose.qRotation, HmdQuaternion_Conjugate(member.camera.qRotation));
+	double vecLever[3];
+	HmdQuaternion_RotateVector(pEstimate->qRotation, member.camera.vecPosition, vecLever);
+
+	// the body turns about the camera, so it moves by the lever arm on top
+	double vecLeverVelocity[3];
+	double vecBodyFromCamera[3] = { -vecLever[0], -vecLever[1], -vecLever[2] };
+	Cross(pose.vecAngularVelocity, vecBodyFromCamera, vecLeverVelocity);
+	for (int i = 0; i < 3; i++)
+	{
+		pEstimate->vecPosition[i] = pose.vecPosition[i] - vecLever[i];
+		pEstimate->vecVelocity[i] = pose.vecVelocity[i] + vecLeverVelocity[i];
+		pEstimate->vecAngularVelocity[i] = pose.vecAngularVelocity[i];
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: With both tracking, the member's world is where it puts the body
+// where the first camera does
+//-----------------------------------------------------------------------------
+void CRigFusion::UpdateAlignment(Member_t& member, const BodyEstimate_t& reference, const BodyEstimate_t& estimate, double flDeltaSeconds)
+{
+	HmdQuaternion_t qAlign = HmdQuaternion_Normalize(HmdQuaternion_Multiply(reference.qRotation, HmdQuaternion_Conjugate(estimate.qRotation)));
+	double vecRotated[3];
+	HmdQuaternion_RotateVector(qAlign, estimate.vecPosition, vecRotated);
+
+	double flAlpha = member.bAligned ? std::min(1.0, flDeltaSeconds / k_flAlignTimeConstant) : 1.0;
+	if (!member.bAligned)
+		DriverLog("Rig: ZED %u aligned to ZED %u\n", member.camera.unSerial, m_vecMembers[0].camera.unSerial);
+	member.qAlign = HmdQuaternion_Slerp(member.qAlign, qAlign, flAlpha);
+	for (int i = 0; i < 3; i++)
+		member.vecAlign[i] += (reference.vecPosition[i] - vecRotated[i] - member.vecAlign[i]) * flAlpha;
+	member.bAligned = true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The weighted mean of the aligned estimates, in the rig's world
+//-----------------------------------------------------------------------------
+bool CRigFusion::Fuse(DriverPose_t* pPose, double flDeltaSeconds)
+{
+	TRACE_ZONE("fusion");
+	BodyEstimate_t reference;
+	bool bReference = Sample(m_vecMembers[0], &reference);
+
+	double flTotalWeight = 0.0;
+	double rgflRotation[4] = {};
+	double vecPosition[3] = {}, vecVelocity[3] = {}, vecAngularVelocity[3] = {};
+	ETrackingResult eResult = TrackingResult_Fallback_RotationOnly;
+	HmdQuaternion_t qFirst = HmdQuaternion_Identity();
+	for (size_t i = 0; i < m_vecMembers.size(); i++)
+	{
+		Member_t& member = m_vecMembers[i];
+		BodyEstimate_t estimate;
+		if (i == 0)
+		{
+			if (!bReference)
+				continue;
+			estimate = reference;
+		}
+		else
+		{
+			if (!Sample(member, &estimate))
+				continue;
+			if (bReference && reference.eResult == TrackingResult_Running_OK && estimate.eResult == TrackingResult_Running_OK)
+				UpdateAlignment(member, reference, estimate, flDeltaSeconds);
+			if (!member.bAligned)
+				continue;
+
+			HmdQuaternion_t qAligned = HmdQuaternion_Multiply(member.qAlign, estimate.qRotation);
+			double vecAligned[3];
+			HmdQuaternion_RotateVector(member.qAlign, estimate.vecPosition, vecAligned);
+			for (int j = 0; j < 3; j++)
+				estimate.vecPosition[j] = vecAligned[j] + member.vecAlign[j];
+			HmdQuaternion_RotateVector(member.qAlign, estimate.vecVelocity, vecAligned);
+			memcpy(estimate.vecVelocity, vecAligned, sizeof(vecAligned));
+			HmdQuaternion_RotateVector(member.qAlign, estimate.vecAngularVelocity, vecAligned);
+			memcpy(estimate.vecAngularVelocity, vecAligned, sizeof(vecAligned));
+			estimate.qRotation = qAligned;
+		}
+
+		// q and -q are the same rotation; sum them on one side
+		HmdQuaternion_t q = estimate.qRotation;
+		if (flTotalWeight == 0.0)
+			qFirst = q;
+		else if (HmdQuaternion_Dot(qFirst, q) < 0.0)
+			q = HmdQuaternion_Init(-q.w, -q.x, -q.y, -q.z);
+
+		double w = estimate.flWeight;
+		flTotalWeight += w;
+		rgflRotation[0] += w * q.w;
+		rgflRotation[1] += w * q.x;
+		rgflRotation[2] += w * q.y;
+		rgflRotation[3] += w * q.z;
+		for (int j = 0; j < 3; j++)
+		{
+			vecPosition[j] += w * estimate.vecPosition[j];
+			vecVelocity[j] += w * estimate.vecVelocity[j];
+			vecAngularVelocity[j] += w * estimate.vecAngularVelocity[j];
+		}
+		if (estimate.eResult == TrackingResult_Running_OK)
+			eResult = TrackingResult_Running_OK;
+	}
+
+	// the first camera's transforms and head offset, for the rig body
+	m_vecMembers[0].pTracker->GetPoseTemplate(pPose);
+	pPose->poseTimeOffset = 0.0;
+	if (flTotalWeight == 0.0)
+	{
+		pPose->poseIsValid = false;
+		pPose->result = TrackingResult_Running_OutOfRange;
+		return false;
+	}
+
+	pPose->result = eResult;
+	pPose->qRotation = HmdQuaternion_Normalize(HmdQuaternion_Init(rgflRotation[0], rgflRotation[1], rgflRotation[2], rgflRotation[3]));
+	for (int j = 0; j < 3; j++)
+	{
+		pPose->vecPosition[j] = vecPosition[j] / flTotalWeight;
+		pPose->vecVelocity[j] = vecVelocity[j] / flTotalWeight;
+		pPose->vecAngularVelocity[j] = vecAngularVelocity[j] / flTotalWeight;
+	}
+	return true;
+}
+
+void CRigFusion::UpdateConfidence(const DriverPose_t& pose)
+{
+	VRInputComponentHandle_t ulComponent = m_ulConfidenceComponent.load();
+	if (ulComponent == k_ulInvalidInputComponentHandle)
+		return;
+	float flConfidence = !pose.poseIsValid ? 0.0f : pose.result == TrackingResult_Running_OK ? 1.0f : 0.5f;
+	if (m_flConfidence.exchange(flConfidence) != flConfidence)
+		VRDriverInput()->UpdateScalarComponent(ulComponent, flConfidence, 0.0);
+}
+
+void CRigFusion::Run()
+{
+	CScopedThreadScheduling scheduling("RigFusion", m_settings);
+	CScopedAllocationAudit allocationAudit(&m_allocations);
+
+	// a fixed rate that doesn't drift by the time each fusion takes
+	CPreciseTimer fusionTimer;
+	fusionTimer.Start((uint64_t)std::chrono::nanoseconds(k_FusionInterval).count());
+
+	uint64_t ulLastNs = GetSteadyNanoseconds();
+	bool bLostSubmitted = false;
+	while (!m_bStopRequested)
+	{
+		fusionTimer.WaitForNextTick();
+		uint64_t ulNowNs = GetSteadyNanoseconds();
+		double flDeltaSeconds = (ulNowNs - ulLastNs) * 1e-9;
+		ulLastNs = ulNowNs;
+
+		DriverPose_t pose;
+		bool bValid = Fuse(&pose, flDeltaSeconds);
+		m_pose.Write(pose);
+		UpdateConfidence(pose);
+
+		// a lost rig is told once, not every tick
+		TrackedDeviceIndex_t unObjectId = m_unObjectId.load();
+		if (unObjectId == k_unTrackedDeviceIndexInvalid || (!bValid && bLostSubmitted))
+			continue;
+		TRACE_ZONE("TrackedDevicePoseUpdated");
+		VRServerDriverHost()->TrackedDevicePoseUpdated(unObjectId, pose, sizeof(DriverPose_t));
+		bLostSubmitted = !bValid;
+	}
+}
@@ -0,0 +1,115 @@
+#ifndef RIGFUSION_H
+#define RIGFUSION_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "allocaudit.h"
+#include "driversettings.h"
+#include "seqlock.h"
+
+class CZedTracker;
+
+//-----------------------------------------------------------------------------
+// Purpose: Where one camera of a rig sits on the rigid body, from rigCameras
+//-----------------------------------------------------------------------------
+struct RigCamera_t
+{
+	unsigned int unSerial;
+	double vecPosition[3]; // camera in the rig frame, meters
+	vr::HmdQuaternion_t qRotation;
+};
+
+// parses rigCameras, "serial x y z yaw pitch roll" per camera (meters,
+// degrees) separated by ';'; false on a malformed entry
+extern bool ParseRigCameras(const std::string& sRigCameras, std::vector<RigCamera_t>* pvecCameras);
+
+//-----------------------------------------------------------------------------
+// Purpose: Several cameras on one rigid body, e.g. a front and a rear ZED,
+// as one tracked device. Every camera keeps its own grab loop; a fusion
+// thread samples each camera's pose history at its own current time, so no
+// camera waits for another, and publishes the rig's pose.
+//
+// Each camera has its own world frame. The first one's is the rig's; the
+// others are aligned to it from the extrinsics whenever both cameras track,
+// at first at once and from then on slowly, so the rig doesn't jump when a
+// camera's estimate does. The rig pose is the mean of the cameras' estimates
+// weighted by their tracking result: one that is lost drops out, one that
+// only dead reckons counts a quarter.
+//-----------------------------------------------------------------------------
+class CRigFusion
+{
+public:
+	CRigFusion();
+	~CRigFusion();
+
+	/** The trackers in rigCameras order, the first the device's; they must outlive Stop */
+	void Start(const std::vector<CZedTracker*>& vecTrackers, const std::vector<RigCamera_t>& vecCameras, const ZedmSettings_t& settings);
+	void Stop();
+
+	bool IsRunning() const { return m_pThread != nullptr; }
+
+	/** The device the rig's poses are submitted for, invalid while none */
+	void SetObjectId(vr::TrackedDeviceIndex_t unObjectId) { m_unObjectId.store(unObjectId); }
+
+	/** As CZedTracker::SetConfidenceComponent, for the rig */
+	void SetConfidenceComponent(vr::VRInputComponentHandle_t ulComponent);
+
+	/** The latest rig pose; a sequence of 0 if there is none yet */
+	uint32_t ReadPose(vr::DriverPose_t* pPose) const { return m_pose.Read(pPose); }
+
+	/** The fusion thread's, ZEDM_ALLOCATION_AUDIT builds only */
+	AllocationCounts_t GetAllocationCounts() const { return m_allocations.GetCounts(); }
+
+private:
+	CRigFusion(const CRigFusion&) = delete;
+	CRigFusion& operator=(const CRigFusion&) = delete;
+
+	struct Member_t
+	{
+		CZedTracker* pTracker;
+		RigCamera_t camera;
+
+		// rig world from this camera's world
+		bool bAligned;
+		vr::HmdQuaternion_t qAlign;
+		double vecAlign[3];
+	};
+
+	// the body's pose as one camera sees it, in that camera's world
+	struct BodyEstimate_t
+	{
+		double flWeight;
+		vr::ETrackingResult eResult;
+		vr::HmdQuaternion_t qRotation;
+		double vecPosition[3];
+		double vecVelocity[3];
+		double vecAngularVelocity[3];
+	};
+
+	void Run();
+	bool Sample(Member_t& member, BodyEstimate_t* pEstimate);
+	void UpdateAlignment(Member_t& member, const BodyEstimate_t& reference, const BodyEstimate_t& estimate, double flDeltaSeconds);
+	bool Fuse(vr::DriverPose_t* pPose, double flDeltaSeconds);
+	void UpdateConfidence(const vr::DriverPose_t& pose);
+
+	std::vector<Member_t> m_vecMembers;
+	ZedmSettings_t m_settings;
+	std::thread* m_pThread;
+	std::atomic<bool> m_bStopRequested;
+
+	std::atomic<vr::TrackedDeviceIndex_t> m_unObjectId;
+	std::atomic<vr::VRInputComponentHandle_t> m_ulConfidenceComponent;
+	std::atomic<float> m_flConfidence; // the last value sent, -1 for none
+	CSeqLock<vr::DriverPose_t> m_pose;
+	CAllocationCounter m_allocations;
+};
+
+#endif // RIGFUSION_H
@@ -0,0 +1,114 @@
+#include "sdkcache.h"
+
+#include <sl/Camera.hpp>
+
+#include <errno.h>
+#include <stdio.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// where the SDK keeps the calibration files it downloads
+#if defined(_WIN32)
+static const char* const k_pchSdkSettingsDir = "C:/ProgramData/Stereolabs/settings";
+#else
+static const char* const k_pchSdkSettingsDir = "/usr/local/zed/settings";
+#endif
+
+// the model behind DETECTION_MODEL::HUMAN_BODY_FAST, see CZedBodyTracker::Enable
+static const sl::AI_MODELS k_eBodyTrackingModel = sl::AI_MODELS::HUMAN_BODY_FAST_DETECTION;
+
+static std::string JoinPath(const std::string& sDir, const std::string& sName)
+{
+	if (sDir.empty() || sDir.back() == '/' || sDir.back() == '\\')
+		return sDir + sName;
+	return sDir + "/" + sName;
+}
+
+static bool MakeDirectory(const std::string& sDir)
+{
+#if defined(_WIN32)
+	return _mkdir(sDir.c_str()) == 0 || errno == EEXIST;
+#else
+	return mkdir(sDir.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+std::string GetCalibrationFileName(unsigned int unCameraSerial)
+{
+	return "SN" + std::to_string(unCameraSerial) + ".conf";
+}
+
+bool IsCalibrationCached(const std::string& sCacheDir, unsigned int unCameraSerial)
+{
+	FILE* pFile = fopen(JoinPath(sCacheDir, GetCalibrationFileName(unCameraSerial)).c_str(), "rb");
+	if (!pFile)
+		return false;
+	fclose(pFile);
+	return true;
+}
+
+bool CacheCalibration(const std::string& sCacheDir, unsigned int unCameraSerial)
+{
+	std::string sName = GetCalibrationFileName(unCameraSerial);
+	FILE* pSource = fopen(JoinPath(k_pchSdkSettingsDir, sName).c_str(), "rb");
+	if (!pSource)
+		return false;
+	if (!MakeDirectory(sCacheDir))
+	{
+		fclose(pSource);
+		return false;
+	}
+
+	// written aside and renamed, so a driver starting meanwhile never reads half of it
+	std::string sPath = JoinPath(sCacheDir, sName);
+	std::string sTempPath = sPath + ".tmp";
+	FILE* pTarget = fopen(sTempPath.c_str(), "wb");
+	if (!pTarget)
+	{
+		fclose(pSource);
+		return false;
+	}
+	bool bOk = true;
+	char rchBuffer[4096];
+	size_t unRead;
+	while ((unRead = fread(rchBuffer, 1, sizeof(rchBuffer), pSource)) > 0)
+	{
+		if (fwrite(rchBuffer, 1, unRead, pTarget) != unRead)
+		{
+			bOk = false;
+			break;
+		}
+	}
+	bOk = !ferror(pSource) && bOk;
+	fclose(pSource);
+	bOk = fclose(pTarget) == 0 && bOk;
+
+#if defined(_WIN32)
+	// rename doesn't replace on Windows
+	if (bOk)
+		remove(sPath.c_str());
+#endif
+	if (!bOk || rename(sTempPath.c_str(), sPath.c_str()) != 0)
+	{
+		remove(sTempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool IsBodyTrackingModelReady(int nGpu)
+{
+	sl::AI_Model_status status = sl::checkAIModelStatus(k_eBodyTrackingModel, nGpu);
+	return status.downloaded && status.optimized;
+}
+
+bool PrepareBodyTrackingModel(int nGpu)
+{
+	if (IsBodyTrackingModelReady(nGpu))
+		return true;
+	return sl::optimizeAIModel(k_eBodyTrackingModel, nGpu) == sl::ERROR_CODE::SUCCESS;
+}
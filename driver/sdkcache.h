@@ -0,0 +1,35 @@
+#ifndef SDKCACHE_H
+#define SDKCACHE_H
+
+#pragma once
+
+#include <string>
+
+//-----------------------------------------------------------------------------
+// Purpose: What the ZED SDK would otherwise fetch or build while a camera
+// opens, prepared ahead of time so it opens offline and fast; see
+// sdkCachePath. Calibration files (SN<serial>.conf) live in the cache
+// directory. The AI models live where the SDK keeps them, SDK 3 has no way
+// to move them, so for those there is only the check. zedm_prewarm fills
+// both in.
+//-----------------------------------------------------------------------------
+
+/** The SDK's own name of a camera's calibration file, e.g. "SN12345.conf" */
+extern std::string GetCalibrationFileName(unsigned int unCameraSerial);
+
+/** Whether sCacheDir has the calibration of camera unCameraSerial */
+extern bool IsCalibrationCached(const std::string& sCacheDir, unsigned int unCameraSerial);
+
+/** Copies the calibration the SDK downloaded for unCameraSerial into sCacheDir,
+* creating it; false if the SDK has none or the copy failed */
+extern bool CacheCalibration(const std::string& sCacheDir, unsigned int unCameraSerial);
+
+/** Whether the body tracking model is downloaded and optimized for GPU nGpu,
+* i.e. enabling body tracking won't spend minutes on either */
+extern bool IsBodyTrackingModelReady(int nGpu);
+
+/** Downloads and optimizes the body tracking model for GPU nGpu if needed;
+* minutes the first time. For zedm_prewarm, never on the driver's threads. */
+extern bool PrepareBodyTrackingModel(int nGpu);
+
+#endif // SDKCACHE_H
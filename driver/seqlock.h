@@ -0,0 +1,70 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+//-----------------------------------------------------------------------------
+// Purpose: Single-writer / multi-reader sequence lock holding the latest value
+// of a plain struct (e.g. DriverPose_t). The writer never waits on readers;
+// readers copy the value out and retry only if a write overlapped their copy,
+// so both sides run in constant time without a mutex.
+//-----------------------------------------------------------------------------
+template< typename T >
+class CSeqLock
+{
+	static_assert( std::is_trivially_copyable< T >::value, "CSeqLock requires a trivially copyable type" );
+
+public:
+	CSeqLock()
+		: m_unSequence( 0 )
+	{
+		memset( &m_value, 0, sizeof( m_value ) );
+	}
+
+	/** Publishes a new value. Must only be called from one thread at a time. */
+	void Write( const T &value )
+	{
+		uint32_t unSequence = m_unSequence.load( std::memory_order_relaxed );
+		m_unSequence.store( unSequence + 1, std::memory_order_relaxed );
+		std::atomic_thread_fence( std::memory_order_release );
+
+		memcpy( &m_value, &value, sizeof( T ) );
+
+		m_unSequence.store( unSequence + 2, std::memory_order_release );
+	}
+
+	/** Copies the latest value into pOut and returns its sequence number.
+	* A sequence of 0 means nothing has been written yet. */
+	uint32_t Read( T *pOut ) const
+	{
+		for ( ;; )
+		{
+			uint32_t unBefore = m_unSequence.load( std::memory_order_acquire );
+			if ( unBefore & 1 )
+				continue;
+
+			memcpy( pOut, &m_value, sizeof( T ) );
+			std::atomic_thread_fence( std::memory_order_acquire );
+
+			if ( m_unSequence.load( std::memory_order_relaxed ) == unBefore )
+				return unBefore;
+		}
+	}
+
+	/** Returns the sequence number of the latest completed write without copying the value. */
+	uint32_t GetSequence() const
+	{
+		return m_unSequence.load( std::memory_order_acquire ) & ~1u;
+	}
+
+private:
+	std::atomic< uint32_t > m_unSequence;
+	T m_value;
+};
+
+#endif // SEQLOCK_H
@@ -0,0 +1,365 @@
+#include "sharedpose.h"
+#include "driverlog.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <string.h>
+
+template <typename T>
+struct SharedSlot_t
+{
+	std::atomic<uint64_t> ulSequence;
+	T sample;
+};
+
+// slots start on their own cache lines, away from the write counters
+static const uint32_t k_unSharedHeaderSize = 64;
+static_assert(sizeof(SharedPoseHeader_t) <= k_unSharedHeaderSize, "header outgrew its cache line");
+
+static const uint32_t k_unPoseSlotsOffset = k_unSharedHeaderSize;
+static const uint32_t k_unImuSlotsOffset = k_unPoseSlotsOffset + k_unSharedPoseCapacity * sizeof(SharedSlot_t<SharedPoseSample_t>);
+static const size_t k_unSharedSegmentSize = k_unImuSlotsOffset + k_unSharedImuCapacity * sizeof(SharedSlot_t<SharedImuSample_t>);
+
+std::string GetSharedPoseName(const std::string& sSerialNumber)
+{
+	return "zedm_" + sSerialNumber;
+}
+
+void* MapSharedSegment(const std::string& sName, size_t unSize, bool bCreate, void** ppMappingHandle, bool* pbCreated)
+{
+	*ppMappingHandle = nullptr;
+	if (pbCreated)
+		*pbCreated = false;
+
+#if defined(_WIN32)
+	// Local\ is the session's namespace, which vrserver and the user's tools share
+	std::string sPath = "Local\\" + sName;
+	HANDLE hMapping;
+	if (bCreate)
+	{
+		hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, (DWORD)unSize, sPath.c_str());
+		if (hMapping && pbCreated)
+			*pbCreated = GetLastError() != ERROR_ALREADY_EXISTS;
+	}
+	else
+	{
+		hMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, sPath.c_str());
+	}
+	if (!hMapping)
+		return nullptr;
+
+	void* pData = MapViewOfFile(hMapping, bCreate ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, unSize);
+	if (!pData)
+	{
+		CloseHandle(hMapping);
+		return nullptr;
+	}
+	*ppMappingHandle = hMapping;
+	return pData;
+#else
+	std::string sPath = "/" + sName;
+	int nFile = shm_open(sPath.c_str(), bCreate ? O_RDWR | O_CREAT : O_RDONLY, 0600);
+	if (nFile < 0)
+		return nullptr;
+
+	struct stat fileStat;
+	if (fstat(nFile, &fileStat) != 0)
+	{
+		::close(nFile);
+		return nullptr;
+	}
+	if (bCreate && (size_t)fileStat.st_size != unSize)
+	{
+		// new, or from an older layout; either way it starts over zero filled
+		if (ftruncate(nFile, 0) != 0 || ftruncate(nFile, unSize) != 0)
+		{
+			::close(nFile);
+			return nullptr;
+		}
+		if (pbCreated)
+			*pbCreated = true;
+	}
+	else if (!bCreate && (size_t)fileStat.st_size < unSize)
+	{
+		::close(nFile);
+		return nullptr;
+	}
+
+	void* pData = mmap(nullptr, unSize, bCreate ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, nFile, 0);
+	::close(nFile);
+	return pData != MAP_FAILED ? pData : nullptr;
+#endif
+}
+
+void UnmapSharedSegment(const void* pData, size_t unSize, void* pMappingHandle)
+{
+#if defined(_WIN32)
+	if (pData)
+		UnmapViewOfFile(pData);
+	if (pMappingHandle)
+		CloseHandle(pMappingHandle);
+#else
+	(void)pMappingHandle;
+	if (pData)
+		munmap((void*)pData, unSize);
+#endif
+}
+
+template <typename T>
+static SharedSlot_t<T>* GetSlots(SharedPoseHeader_t* pHeader, uint32_t unOffset)
+{
+	return (SharedSlot_t<T>*)((uint8_t*)pHeader + unOffset);
+}
+
+template <typename T>
+static const SharedSlot_t<T>* GetSlots(const SharedPoseHeader_t* pHeader, uint32_t unOffset)
+{
+	return (const SharedSlot_t<T>*)((const uint8_t*)pHeader + unOffset);
+}
+
+template <typename T>
+static void WriteSlot(SharedSlot_t<T>* pSlots, uint32_t unCapacity, std::atomic<uint64_t>* pulWriteCount, const T& sample)
+{
+	uint64_t ulIndex = pulWriteCount->load(std::memory_order_relaxed);
+	SharedSlot_t<T>& slot = pSlots[ulIndex % unCapacity];
+
+	slot.ulSequence.store(2 * ulIndex + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(&slot.sample, &sample, sizeof(sample));
+	slot.ulSequence.store(2 * ulIndex + 2, std::memory_order_release);
+
+	pulWriteCount->store(ulIndex + 1, std::memory_order_release);
+}
+
+// copies write number ulIndex; false if it has been overwritten or is being written
+template <typename T>
+static bool ReadSlot(const SharedSlot_t<T>* pSlots, uint32_t unCapacity, uint64_t ulIndex, T* pOut)
+{
+	const SharedSlot_t<T>& slot = pSlots[ulIndex % unCapacity];
+	uint64_t ulExpected = 2 * ulIndex + 2;
+	if (slot.ulSequence.load(std::memory_order_acquire) != ulExpected)
+		return false;
+	memcpy(pOut, &slot.sample, sizeof(*pOut));
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return slot.ulSequence.load(std::memory_order_relaxed) == ulExpected;
+}
+
+template <typename T>
+static uint32_t ReadSlots(const SharedSlot_t<T>* pSlots, uint32_t unCapacity, const std::atomic<uint64_t>& ulWriteCount,
+	uint64_t* pulNext, T* pOut, uint32_t unMax, uint64_t* pulSkipped)
+{
+	uint64_t ulEnd = ulWriteCount.load(std::memory_order_acquire);
+	uint64_t ulSkipped = 0;
+	uint32_t unRead = 0;
+
+	// the writer reopened the segment's counts from 0, or is a new one
+	if (*pulNext > ulEnd)
+		*pulNext = ulEnd;
+
+	while (*pulNext < ulEnd && unRead < unMax)
+	{
+		// the oldest slot may be rewritten while it is copied, so stay one clear of it
+		if (ulEnd - *pulNext >= unCapacity)
+		{
+			uint64_t ulOldest = ulEnd - unCapacity + 1;
+			ulSkipped += ulOldest - *pulNext;
+			*pulNext = ulOldest;
+		}
+		if (ReadSlot(pSlots, unCapacity, *pulNext, &pOut[unRead]))
+			unRead++;
+		else
+			ulSkipped++;
+		(*pulNext)++;
+	}
+
+	if (pulSkipped)
+		*pulSkipped = ulSkipped;
+	return unRead;
+}
+
+CSharedPoseWriter::CSharedPoseWriter()
+	: m_pMappingHandle(nullptr)
+	, m_pHeader(nullptr)
+{
+}
+
+CSharedPoseWriter::~CSharedPoseWriter()
+{
+	Close();
+}
+
+bool CSharedPoseWriter::Open(const std::string& sName)
+{
+	Close();
+
+	bool bCreated;
+	void* pData = MapSharedSegment(sName, k_unSharedSegmentSize, true, &m_pMappingHandle, &bCreated);
+	if (!pData)
+	{
+		DriverLog("Unable to create shared memory %s\n", sName.c_str());
+		return false;
+	}
+
+	SharedPoseHeader_t* pHeader = (SharedPoseHeader_t*)pData;
+	if (bCreated || pHeader->unMagic != k_unSharedPoseMagic || pHeader->unVersion != k_unSharedPoseVersion
+		|| pHeader->unPoseSlotsOffset != k_unPoseSlotsOffset || pHeader->unImuSlotsOffset != k_unImuSlotsOffset)
+	{
+		// readers check the magic last, after everything else is in place
+		pHeader->unMagic = 0;
+		std::atomic_thread_fence(std::memory_order_release);
+		memset((uint8_t*)pData + sizeof(uint32_t), 0, k_unSharedSegmentSize - sizeof(uint32_t));
+		pHeader->unVersion = k_unSharedPoseVersion;
+		pHeader->unPoseCapacity = k_unSharedPoseCapacity;
+		pHeader->unPoseSlotSize = sizeof(SharedSlot_t<SharedPoseSample_t>);
+		pHeader->unPoseSlotsOffset = k_unPoseSlotsOffset;
+		pHeader->unImuCapacity = k_unSharedImuCapacity;
+		pHeader->unImuSlotSize = sizeof(SharedSlot_t<SharedImuSample_t>);
+		pHeader->unImuSlotsOffset = k_unImuSlotsOffset;
+		pHeader->ulPoseWriteCount.store(0, std::memory_order_relaxed);
+		pHeader->ulImuWriteCount.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		pHeader->unMagic = k_unSharedPoseMagic;
+	}
+
+	m_pHeader = pHeader;
+	DriverLog("Exporting poses to shared memory %s\n", sName.c_str());
+	return true;
+}
+
+void CSharedPoseWriter::Close()
+{
+	UnmapSharedSegment(m_pHeader, k_unSharedSegmentSize, m_pMappingHandle);
+	m_pHeader = nullptr;
+	m_pMappingHandle = nullptr;
+}
+
+void FillSharedPoseSample(const vr::DriverPose_t& pose, uint64_t ulSampleTimestampNs, SharedPoseSample_t* pSample)
+{
+	SharedPoseSample_t& sample = *pSample;
+	sample.ulSampleTimestampNs = ulSampleTimestampNs;
+	sample.unFlags = (pose.poseIsValid ? SharedPoseFlag_Valid : 0) | (pose.deviceIsConnected ? SharedPoseFlag_Connected : 0);
+	sample.nResult = pose.result;
+	sample.flPoseTimeOffset = pose.poseTimeOffset;
+	for (int i = 0; i < 3; i++)
+	{
+		sample.vecPosition[i] = pose.vecPosition[i];
+		sample.vecVelocity[i] = pose.vecVelocity[i];
+		sample.vecAngularVelocity[i] = pose.vecAngularVelocity[i];
+		sample.vecWorldFromDriverTranslation[i] = pose.vecWorldFromDriverTranslation[i];
+		sample.vecDriverFromHeadTranslation[i] = pose.vecDriverFromHeadTranslation[i];
+	}
+	const vr::HmdQuaternion_t* rgqSource[3] = { &pose.qRotation, &pose.qWorldFromDriverRotation, &pose.qDriverFromHeadRotation };
+	double* rgqTarget[3] = { sample.qRotation, sample.qWorldFromDriverRotation, sample.qDriverFromHeadRotation };
+	for (int i = 0; i < 3; i++)
+	{
+		rgqTarget[i][0] = rgqSource[i]->w;
+		rgqTarget[i][1] = rgqSource[i]->x;
+		rgqTarget[i][2] = rgqSource[i]->y;
+		rgqTarget[i][3] = rgqSource[i]->z;
+	}
+}
+
+void CSharedPoseWriter::WritePose(const vr::DriverPose_t& pose, uint64_t ulSampleTimestampNs)
+{
+	if (!m_pHeader)
+		return;
+
+	SharedPoseSample_t sample;
+	FillSharedPoseSample(pose, ulSampleTimestampNs, &sample);
+	WriteSlot(GetSlots<SharedPoseSample_t>(m_pHeader, k_unPoseSlotsOffset), k_unSharedPoseCapacity, &m_pHeader->ulPoseWriteCount, sample);
+}
+
+void CSharedPoseWriter::WriteImu(const SharedImuSample_t& sample)
+{
+	if (!m_pHeader)
+		return;
+
+	WriteSlot(GetSlots<SharedImuSample_t>(m_pHeader, k_unImuSlotsOffset), k_unSharedImuCapacity, &m_pHeader->ulImuWriteCount, sample);
+}
+
+CSharedPoseReader::CSharedPoseReader()
+	: m_pMappingHandle(nullptr)
+	, m_pHeader(nullptr)
+{
+}
+
+CSharedPoseReader::~CSharedPoseReader()
+{
+	Close();
+}
+
+bool CSharedPoseReader::Open(const std::string& sName)
+{
+	Close();
+
+	void* pData = MapSharedSegment(sName, k_unSharedSegmentSize, false, &m_pMappingHandle, nullptr);
+	if (!pData)
+		return false;
+
+	const SharedPoseHeader_t* pHeader = (const SharedPoseHeader_t*)pData;
+	uint32_t unMagic = pHeader->unMagic;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (unMagic != k_unSharedPoseMagic || pHeader->unVersion != k_unSharedPoseVersion
+		|| pHeader->unPoseCapacity != k_unSharedPoseCapacity || pHeader->unPoseSlotSize != sizeof(SharedSlot_t<SharedPoseSample_t>)
+		|| pHeader->unPoseSlotsOffset != k_unPoseSlotsOffset || pHeader->unImuCapacity != k_unSharedImuCapacity
+		|| pHeader->unImuSlotSize != sizeof(SharedSlot_t<SharedImuSample_t>) || pHeader->unImuSlotsOffset != k_unImuSlotsOffset)
+	{
+		UnmapSharedSegment(pData, k_unSharedSegmentSize, m_pMappingHandle);
+		m_pMappingHandle = nullptr;
+		return false;
+	}
+
+	m_pHeader = pHeader;
+	return true;
+}
+
+void CSharedPoseReader::Close()
+{
+	UnmapSharedSegment(m_pHeader, k_unSharedSegmentSize, m_pMappingHandle);
+	m_pHeader = nullptr;
+	m_pMappingHandle = nullptr;
+}
+
+bool CSharedPoseReader::ReadLatestPose(SharedPoseSample_t* pOut, uint64_t* pulWriteNumber) const
+{
+	if (!m_pHeader)
+		return false;
+
+	const SharedSlot_t<SharedPoseSample_t>* pSlots = GetSlots<SharedPoseSample_t>(m_pHeader, k_unPoseSlotsOffset);
+	for (int nAttempt = 0; nAttempt < 16; nAttempt++)
+	{
+		uint64_t ulEnd = m_pHeader->ulPoseWriteCount.load(std::memory_order_acquire);
+		if (ulEnd == 0)
+			return false;
+		if (ReadSlot(pSlots, k_unSharedPoseCapacity, ulEnd - 1, pOut))
+		{
+			if (pulWriteNumber)
+				*pulWriteNumber = ulEnd - 1;
+			return true;
+		}
+	}
+	return false;
+}
+
+uint32_t CSharedPoseReader::ReadPoses(uint64_t* pulNext, SharedPoseSample_t* pOut, uint32_t unMax, uint64_t* pulSkipped) const
+{
+	if (!m_pHeader)
+		return 0;
+	return ReadSlots(GetSlots<SharedPoseSample_t>(m_pHeader, k_unPoseSlotsOffset), k_unSharedPoseCapacity,
+		m_pHeader->ulPoseWriteCount, pulNext, pOut, unMax, pulSkipped);
+}
+
+uint32_t CSharedPoseReader::ReadImuSamples(uint64_t* pulNext, SharedImuSample_t* pOut, uint32_t unMax, uint64_t* pulSkipped) const
+{
+	if (!m_pHeader)
+		return 0;
+	return ReadSlots(GetSlots<SharedImuSample_t>(m_pHeader, k_unImuSlotsOffset), k_unSharedImuCapacity,
+		m_pHeader->ulImuWriteCount, pulNext, pOut, unMax, pulSkipped);
+}
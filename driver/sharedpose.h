@@ -0,0 +1,154 @@
+#ifndef SHAREDPOSE_H
+#define SHAREDPOSE_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+static const uint32_t k_unSharedPoseMagic = 0x4d44455a; // "ZEDM"
+static const uint32_t k_unSharedPoseVersion = 1;
+
+static const uint32_t k_unSharedPoseCapacity = 512; // ~0.6 s at IMU rate
+static const uint32_t k_unSharedImuCapacity = 1024; // ~2.5 s at 400 Hz
+
+// the counters and sequences are shared with other processes, so they must not take a lock
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared memory needs lock-free 64-bit atomics");
+
+enum ESharedPoseFlags
+{
+	SharedPoseFlag_Valid = 1 << 0,
+	SharedPoseFlag_Connected = 1 << 1,
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: One published pose, as in DriverPose_t: the position and rotation
+// are in driver space, the two transforms take it to the tracking universe
+// and to the head. Quaternions are w, x, y, z.
+//-----------------------------------------------------------------------------
+struct SharedPoseSample_t
+{
+	uint64_t ulSampleTimestampNs; // ZED clock, 0 for a pose not built from a sample
+	uint32_t unFlags; // ESharedPoseFlags
+	int32_t nResult; // vr::ETrackingResult
+	double flPoseTimeOffset;
+	double vecPosition[3];
+	double qRotation[4];
+	double vecVelocity[3];
+	double vecAngularVelocity[3];
+	double qWorldFromDriverRotation[4];
+	double vecWorldFromDriverTranslation[3];
+	double qDriverFromHeadRotation[4];
+	double vecDriverFromHeadTranslation[3];
+};
+
+/** One raw IMU sample in the camera frame, like vr::ImuSample_t */
+struct SharedImuSample_t
+{
+	uint64_t ulSampleTimestampNs; // ZED clock
+	float vecAccel[3]; // m/s^2
+	float vecGyro[3]; // rad/s
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Start of the segment. The rings follow at the given offsets; each
+// slot is a 64-bit sequence followed by its sample, the slot size apart.
+//-----------------------------------------------------------------------------
+struct SharedPoseHeader_t
+{
+	uint32_t unMagic;
+	uint32_t unVersion;
+	uint32_t unPoseCapacity;
+	uint32_t unPoseSlotSize;
+	uint32_t unPoseSlotsOffset;
+	uint32_t unImuCapacity;
+	uint32_t unImuSlotSize;
+	uint32_t unImuSlotsOffset;
+	std::atomic<uint64_t> ulPoseWriteCount;
+	std::atomic<uint64_t> ulImuWriteCount;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Publishes a device's poses and IMU samples into a named shared
+// memory segment ("zedm_<serial>") for local processes that need the same
+// data without the camera or a round trip through vrserver.
+//
+// Each ring works like CPoseHistory: a slot's sequence is odd while it's
+// written and 2 * (write number + 1) once it holds that write, so a reader
+// copies the sample and checks the sequence again, without ever blocking the
+// writer. One writer per ring; the poses come from whichever thread
+// publishes, the IMU samples from the IMU publisher.
+//
+// Reopening a segment that is still mapped somewhere continues its counts,
+// so readers survive a device deactivation.
+//-----------------------------------------------------------------------------
+class CSharedPoseWriter
+{
+public:
+	CSharedPoseWriter();
+	~CSharedPoseWriter();
+
+	bool Open(const std::string& sName);
+	void Close();
+	bool IsOpen() const { return m_pHeader != nullptr; }
+
+	void WritePose(const vr::DriverPose_t& pose, uint64_t ulSampleTimestampNs);
+	void WriteImu(const SharedImuSample_t& sample);
+
+private:
+	void* m_pMappingHandle;
+	SharedPoseHeader_t* m_pHeader;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Read side of the segment, for the tools and other processes. Any
+// number of readers, none of them visible to the writer.
+//-----------------------------------------------------------------------------
+class CSharedPoseReader
+{
+public:
+	CSharedPoseReader();
+	~CSharedPoseReader();
+
+	/** False until the driver has created the segment */
+	bool Open(const std::string& sName);
+	void Close();
+	bool IsOpen() const { return m_pHeader != nullptr; }
+
+	/** Newest pose; false if none has been written or it was being rewritten throughout */
+	bool ReadLatestPose(SharedPoseSample_t* pOut, uint64_t* pulWriteNumber = nullptr) const;
+
+	/** Poses since write number *pulNext, up to unMax of them, and advances *pulNext.
+	* Poses overwritten before they were read are skipped; *pulSkipped counts them. */
+	uint32_t ReadPoses(uint64_t* pulNext, SharedPoseSample_t* pOut, uint32_t unMax, uint64_t* pulSkipped = nullptr) const;
+
+	/** The same for IMU samples */
+	uint32_t ReadImuSamples(uint64_t* pulNext, SharedImuSample_t* pOut, uint32_t unMax, uint64_t* pulSkipped = nullptr) const;
+
+	uint64_t GetPoseWriteCount() const { return m_pHeader ? m_pHeader->ulPoseWriteCount.load(std::memory_order_acquire) : 0; }
+	uint64_t GetImuWriteCount() const { return m_pHeader ? m_pHeader->ulImuWriteCount.load(std::memory_order_acquire) : 0; }
+
+private:
+	void* m_pMappingHandle;
+	const SharedPoseHeader_t* m_pHeader;
+};
+
+/** The segment name of a device, from its serial number */
+extern std::string GetSharedPoseName(const std::string& sSerialNumber);
+
+/** A published pose in the shared layout */
+extern void FillSharedPoseSample(const vr::DriverPose_t& pose, uint64_t ulSampleTimestampNs, SharedPoseSample_t* pSample);
+
+//-----------------------------------------------------------------------------
+// Purpose: Maps the named segment of unSize bytes in the session's namespace,
+// creating it if bCreate. pbCreated tells whether it is new, i.e. zero
+// filled. For the other shared exports, see mrcapture.h.
+//-----------------------------------------------------------------------------
+extern void* MapSharedSegment(const std::string& sName, size_t unSize, bool bCreate, void** ppMappingHandle, bool* pbCreated);
+extern void UnmapSharedSegment(const void* pData, size_t unSize, void* pMappingHandle);
+
+#endif // SHAREDPOSE_H
@@ -0,0 +1,142 @@
+#include "sharedstats.h"
+#include "sharedpose.h"
+#include "driverlog.h"
+
+#include <string.h>
+
+static const size_t k_unSharedStatsSegmentSize = sizeof(SharedStatsHeader_t);
+
+std::string GetSharedStatsName(const std::string& sSerialNumber)
+{
+	return GetSharedPoseName(sSerialNumber) + "_stats";
+}
+
+CSharedStatsWriter::CSharedStatsWriter()
+	: m_pMappingHandle(nullptr)
+	, m_pHeader(nullptr)
+{
+}
+
+CSharedStatsWriter::~CSharedStatsWriter()
+{
+	Close();
+}
+
+bool CSharedStatsWriter::Open(const std::string& sName)
+{
+	Close();
+
+	bool bCreated;
+	void* pData = MapSharedSegment(sName, k_unSharedStatsSegmentSize, true, &m_pMappingHandle, &bCreated);
+	if (!pData)
+	{
+		DriverLog("Unable to create shared memory %s\n", sName.c_str());
+		return false;
+	}
+
+	SharedStatsHeader_t* pHeader = (SharedStatsHeader_t*)pData;
+	if (bCreated || pHeader->unMagic != k_unSharedStatsMagic || pHeader->unVersion != k_unSharedStatsVersion
+		|| pHeader->unStatsSize != sizeof(SharedStats_t) || pHeader->unLatencyStageCount != LatencyStage_Count)
+	{
+		// readers check the magic last, after everything else is in place
+		pHeader->unMagic = 0;
+		std::atomic_thread_fence(std::memory_order_release);
+		memset((uint8_t*)pData + sizeof(uint32_t), 0, k_unSharedStatsSegmentSize - sizeof(uint32_t));
+		pHeader->unVersion = k_unSharedStatsVersion;
+		pHeader->unStatsSize = sizeof(SharedStats_t);
+		pHeader->unLatencyStageCount = LatencyStage_Count;
+		pHeader->ulSequence.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		pHeader->unMagic = k_unSharedStatsMagic;
+	}
+
+	m_pHeader = pHeader;
+	DriverLog("Exporting stats to shared memory %s\n", sName.c_str());
+	return true;
+}
+
+void CSharedStatsWriter::Close()
+{
+	UnmapSharedSegment(m_pHeader, k_unSharedStatsSegmentSize, m_pMappingHandle);
+	m_pHeader = nullptr;
+	m_pMappingHandle = nullptr;
+}
+
+void CSharedStatsWriter::Write(const SharedStats_t& stats)
+{
+	if (!m_pHeader)
+		return;
+
+	// a reopened segment continues its count, so the write number keeps growing
+	uint64_t ulSequence = m_pHeader->ulSequence.load(std::memory_order_relaxed) & ~1ull;
+	m_pHeader->ulSequence.store(ulSequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(&m_pHeader->stats, &stats, sizeof(stats));
+	m_pHeader->ulSequence.store(ulSequence + 2, std::memory_order_release);
+}
+
+CSharedStatsReader::CSharedStatsReader()
+	: m_pMappingHandle(nullptr)
+	, m_pHeader(nullptr)
+{
+}
+
+CSharedStatsReader::~CSharedStatsReader()
+{
+	Close();
+}
+
+bool CSharedStatsReader::Open(const std::string& sName)
+{
+	Close();
+
+	void* pData = MapSharedSegment(sName, k_unSharedStatsSegmentSize, false, &m_pMappingHandle, nullptr);
+	if (!pData)
+		return false;
+
+	const SharedStatsHeader_t* pHeader = (const SharedStatsHeader_t*)pData;
+	uint32_t unMagic = pHeader->unMagic;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (unMagic != k_unSharedStatsMagic || pHeader->unVersion != k_unSharedStatsVersion
+		|| pHeader->unStatsSize != sizeof(SharedStats_t) || pHeader->unLatencyStageCount != LatencyStage_Count)
+	{
+		UnmapSharedSegment(pData, k_unSharedStatsSegmentSize, m_pMappingHandle);
+		m_pMappingHandle = nullptr;
+		return false;
+	}
+
+	m_pHeader = pHeader;
+	return true;
+}
+
+void CSharedStatsReader::Close()
+{
+	UnmapSharedSegment(m_pHeader, k_unSharedStatsSegmentSize, m_pMappingHandle);
+	m_pHeader = nullptr;
+	m_pMappingHandle = nullptr;
+}
+
+bool CSharedStatsReader::Read(SharedStats_t* pOut, uint64_t* pulWriteNumber) const
+{
+	if (!m_pHeader)
+		return false;
+
+	for (int nAttempt = 0; nAttempt < 16; nAttempt++)
+	{
+		uint64_t ulBefore = m_pHeader->ulSequence.load(std::memory_order_acquire);
+		if (ulBefore == 0)
+			return false;
+		if (ulBefore & 1)
+			continue;
+
+		memcpy(pOut, &m_pHeader->stats, sizeof(*pOut));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (m_pHeader->ulSequence.load(std::memory_order_relaxed) == ulBefore)
+		{
+			if (pulWriteNumber)
+				*pulWriteNumber = ulBefore / 2 - 1;
+			return true;
+		}
+	}
+	return false;
+}
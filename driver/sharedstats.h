@@ -0,0 +1,119 @@
+#ifndef SHAREDSTATS_H
+#define SHAREDSTATS_H
+
+#pragma once
+
+#include "latencystats.h"
+#include "proximitykernel.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+static const uint32_t k_unSharedStatsMagic = 0x5453445a; // "ZDST"
+static const uint32_t k_unSharedStatsVersion = 2;
+
+/** How often a device rewrites its stats, from RunFrame */
+static const uint64_t k_ulSharedStatsIntervalNs = 100000000;
+
+enum ESharedStatsFlags
+{
+	SharedStatsFlag_ImuPublisher = 1 << 0,
+	SharedStatsFlag_DeadReckoning = 1 << 1,
+	SharedStatsFlag_Relocalizing = 1 << 2,
+	SharedStatsFlag_GrabStalled = 1 << 3,
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: A device's pipeline health, a subset of ZedTrackerStats_t plus the
+// latency summaries and the proximityWarning sectors. The tracking state is
+// given by name as well, so that readers don't need the ZED SDK.
+//-----------------------------------------------------------------------------
+struct SharedStats_t
+{
+	uint64_t ulWriteTimestampNs; // steady clock of vrserver
+	int32_t nTrackingState; // sl::POSITIONAL_TRACKING_STATE
+	uint32_t unFlags; // ESharedStatsFlags
+	char rgchTrackingState[32];
+	double flGrabFps;
+	uint64_t ulFramesGrabbed;
+	uint64_t ulFramesDropped;
+	uint64_t ulGrabFailures;
+	uint64_t ulGrabStalls;
+	double flPosePublishRate;
+	uint64_t ulPosesPublished;
+	double flImuRate;
+	LatencySummary_t rgLatency[LatencyStage_Count];
+
+	// proximityWarning, as in ProximitySectors_t; no sectors while it is off
+	uint32_t unProximitySectors;
+	float flProximityFirstAngle;
+	float flProximitySectorAngle;
+	float flProximityRange;
+	float rgflProximity[k_unMaxProximitySectors]; // meters, -1 for nothing in range
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: The whole segment. The sequence is odd while the stats are written
+// and 2 * (write number + 1) after, as in sharedpose.h.
+//-----------------------------------------------------------------------------
+struct SharedStatsHeader_t
+{
+	uint32_t unMagic;
+	uint32_t unVersion;
+	uint32_t unStatsSize;
+	uint32_t unLatencyStageCount;
+	std::atomic<uint64_t> ulSequence;
+	SharedStats_t stats;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Publishes a device's stats into the named shared memory segment
+// "zedm_<serial>_stats" next to its poses, for status tools such as
+// zedm_statusoverlay. Only the latest stats are kept; one writer.
+//-----------------------------------------------------------------------------
+class CSharedStatsWriter
+{
+public:
+	CSharedStatsWriter();
+	~CSharedStatsWriter();
+
+	bool Open(const std::string& sName);
+	void Close();
+	bool IsOpen() const { return m_pHeader != nullptr; }
+
+	void Write(const SharedStats_t& stats);
+
+private:
+	void* m_pMappingHandle;
+	SharedStatsHeader_t* m_pHeader;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Read side of the segment. Any number of readers, none of them
+// visible to the writer.
+//-----------------------------------------------------------------------------
+class CSharedStatsReader
+{
+public:
+	CSharedStatsReader();
+	~CSharedStatsReader();
+
+	/** False until the driver has created the segment */
+	bool Open(const std::string& sName);
+	void Close();
+	bool IsOpen() const { return m_pHeader != nullptr; }
+
+	/** Latest stats and their write number; false if none were written yet or
+	* they were being rewritten throughout */
+	bool Read(SharedStats_t* pOut, uint64_t* pulWriteNumber = nullptr) const;
+
+private:
+	void* m_pMappingHandle;
+	const SharedStatsHeader_t* m_pHeader;
+};
+
+/** The stats segment name of a device, from its serial number */
+extern std::string GetSharedStatsName(const std::string& sSerialNumber);
+
+#endif // SHAREDSTATS_H
@@ -0,0 +1,148 @@
+#include "spatialanchors.h"
+#include "driverlog.h"
+#include "hmdmath.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace vr;
+
+// versioned so a later format can still read anchors saved by this one
+static const char* const k_pchDescriptorFormat = "zedm1 %lf %lf %lf %lf %lf %lf %lf";
+static const uint32_t k_unMaxDescriptorLength = 256;
+
+// how long an unavailable anchor is reported as such before SteamVR asks again
+static const double k_flNotYetAvailableDuration = 1.0;
+
+CSpatialAnchorIndex::CSpatialAnchorIndex()
+	: m_qWorldFromDriverRotation(HmdQuaternion_Identity())
+	, m_bTracking(false)
+{
+	for (int i = 0; i < 3; i++)
+		m_vecWorldFromDriverTranslation[i] = 0.0;
+}
+
+void CSpatialAnchorIndex::ComputeWorldPose(Anchor_t* pAnchor) const
+{
+	SpatialAnchorDriverPose_t& pose = pAnchor->worldPose;
+	pose.qWorldRotation = HmdQuaternion_Multiply(m_qWorldFromDriverRotation, pAnchor->qDriverRotation);
+
+	double vecRotated[3];
+	HmdQuaternion_RotateVector(m_qWorldFromDriverRotation, pAnchor->vecDriverPosition, vecRotated);
+	for (int i = 0; i < 3; i++)
+		pose.vWorldTranslation.v[i] = vecRotated[i] + m_vecWorldFromDriverTranslation[i];
+
+	pose.ulRequiredUniverseId = 0;
+	pose.fValidDuration = -1.0; // we push every change ourselves
+}
+
+void CSpatialAnchorIndex::PublishPose(SpatialAnchorHandle_t unHandle, Anchor_t* pAnchor)
+{
+	if (!m_bTracking)
+	{
+		VRDriverSpatialAnchors()->SetSpatialAnchorPoseError(unHandle, VRSpatialAnchorError_NotYetAvailable, k_flNotYetAvailableDuration);
+		return;
+	}
+	VRDriverSpatialAnchors()->UpdateSpatialAnchorPose(unHandle, &pAnchor->worldPose);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: An application registered a descriptor, e.g. one saved in an
+// earlier session, and wants its pose.
+//-----------------------------------------------------------------------------
+void CSpatialAnchorIndex::ResolveDescriptor(SpatialAnchorHandle_t unHandle)
+{
+	auto it = m_mapAnchors.find(unHandle);
+	if (it != m_mapAnchors.end())
+	{
+		PublishPose(unHandle, &it->second);
+		return;
+	}
+
+	char rchDescriptor[k_unMaxDescriptorLength] = { 0 };
+	uint32_t unLength = sizeof(rchDescriptor);
+	if (VRDriverSpatialAnchors()->GetSpatialAnchorDescriptor(unHandle, rchDescriptor, &unLength, false) != VRSpatialAnchorError_Success)
+		return;
+
+	Anchor_t anchor;
+	double w, x, y, z;
+	if (sscanf(rchDescriptor, k_pchDescriptorFormat, &anchor.vecDriverPosition[0], &anchor.vecDriverPosition[1],
+		&anchor.vecDriverPosition[2], &w, &x, &y, &z) != 7)
+	{
+		DriverLog("Spatial anchor %u: unrecognized descriptor\n", unHandle);
+		VRDriverSpatialAnchors()->SetSpatialAnchorPoseError(unHandle, VRSpatialAnchorError_PermanentlyUnavailable, -1.0);
+		return;
+	}
+	anchor.qDriverRotation = HmdQuaternion_Normalize(HmdQuaternion_Init(w, x, y, z));
+	ComputeWorldPose(&anchor);
+
+	Anchor_t& indexed = m_mapAnchors[unHandle] = anchor;
+	PublishPose(unHandle, &indexed);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: An application created an anchor at a pose and wants a descriptor
+// it can save.
+//-----------------------------------------------------------------------------
+void CSpatialAnchorIndex::CreateDescriptor(SpatialAnchorHandle_t unHandle)
+{
+	SpatialAnchorDriverPose_t worldPose;
+	if (VRDriverSpatialAnchors()->GetSpatialAnchorPose(unHandle, &worldPose) != VRSpatialAnchorError_Success)
+		return;
+
+	// back into ZED world space, the frame the map is stored in
+	HmdQuaternion_t qDriverFromWorld = HmdQuaternion_Conjugate(m_qWorldFromDriverRotation);
+	double vecOffset[3];
+	for (int i = 0; i < 3; i++)
+		vecOffset[i] = worldPose.vWorldTranslation.v[i] - m_vecWorldFromDriverTranslation[i];
+
+	Anchor_t anchor;
+	HmdQuaternion_RotateVector(qDriverFromWorld, vecOffset, anchor.vecDriverPosition);
+	anchor.qDriverRotation = HmdQuaternion_Normalize(HmdQuaternion_Multiply(qDriverFromWorld, worldPose.qWorldRotation));
+	ComputeWorldPose(&anchor);
+	m_mapAnchors[unHandle] = anchor;
+
+	char rchDescriptor[k_unMaxDescriptorLength];
+	snprintf(rchDescriptor, sizeof(rchDescriptor), "zedm1 %.6f %.6f %.6f %.9f %.9f %.9f %.9f",
+		anchor.vecDriverPosition[0], anchor.vecDriverPosition[1], anchor.vecDriverPosition[2],
+		anchor.qDriverRotation.w, anchor.qDriverRotation.x, anchor.qDriverRotation.y, anchor.qDriverRotation.z);
+	VRDriverSpatialAnchors()->UpdateSpatialAnchorDescriptor(unHandle, rchDescriptor);
+}
+
+void CSpatialAnchorIndex::ProcessEvent(const VREvent_t& vrEvent)
+{
+	if (vrEvent.eventType != VREvent_SpatialAnchors_RequestPoseUpdate && vrEvent.eventType != VREvent_SpatialAnchors_RequestDescriptorUpdate)
+		return;
+	if (!VRDriverSpatialAnchors())
+		return;
+
+	if (vrEvent.eventType == VREvent_SpatialAnchors_RequestPoseUpdate)
+		ResolveDescriptor(vrEvent.data.spatialAnchor.unHandle);
+	else
+		CreateDescriptor(vrEvent.data.spatialAnchor.unHandle);
+}
+
+void CSpatialAnchorIndex::Update(const DriverPose_t& pose, bool bTracking)
+{
+	bool bCalibrationChanged = memcmp(&pose.qWorldFromDriverRotation, &m_qWorldFromDriverRotation, sizeof(m_qWorldFromDriverRotation)) != 0
+		|| memcmp(pose.vecWorldFromDriverTranslation, m_vecWorldFromDriverTranslation, sizeof(m_vecWorldFromDriverTranslation)) != 0;
+	bool bTrackingChanged = bTracking != m_bTracking;
+	if (!bCalibrationChanged && !bTrackingChanged)
+		return;
+
+	m_qWorldFromDriverRotation = pose.qWorldFromDriverRotation;
+	memcpy(m_vecWorldFromDriverTranslation, pose.vecWorldFromDriverTranslation, sizeof(m_vecWorldFromDriverTranslation));
+	m_bTracking = bTracking;
+
+	if (m_mapAnchors.empty() || !VRDriverSpatialAnchors())
+		return;
+
+	// only here, not per query
+	for (auto& entry : m_mapAnchors)
+	{
+		if (bCalibrationChanged)
+			ComputeWorldPose(&entry.second);
+		PublishPose(entry.first, &entry.second);
+	}
+	DriverLog("Spatial anchors: %u %s\n", (unsigned)m_mapAnchors.size(), m_bTracking ? "updated" : "unavailable until tracking resumes");
+}
@@ -0,0 +1,58 @@
+#ifndef SPATIALANCHORS_H
+#define SPATIALANCHORS_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <unordered_map>
+
+//-----------------------------------------------------------------------------
+// Purpose: Spatial anchors resolved against the ZED's positional tracking
+// map. Descriptors hold the anchor in ZED world space, which area memory
+// keeps stable across sessions on the same rig; poses handed to SteamVR are
+// that location through the current world-from-driver calibration.
+//
+// Every anchor seen this session stays in an index with its SteamVR pose
+// already computed. Pose requests are answered from the index; the poses
+// are only recomputed and pushed when the calibration changes or tracking
+// comes back after a loss (the SDK relocalizing in its map). While tracking
+// is lost anchors report VRSpatialAnchorError_NotYetAvailable.
+//
+// SteamVR only routes anchor requests to a driver whose manifest has
+// "spatialAnchorsSupport": true. All calls are made from RunFrame.
+//-----------------------------------------------------------------------------
+class CSpatialAnchorIndex
+{
+public:
+	CSpatialAnchorIndex();
+
+	/** Handles the VREvent_SpatialAnchors_Request* events, ignores everything else */
+	void ProcessEvent(const vr::VREvent_t& vrEvent);
+
+	/** Once per RunFrame with a pose of the device that defines the anchor space,
+	* for its world-from-driver transform, and whether that device is tracking */
+	void Update(const vr::DriverPose_t& pose, bool bTracking);
+
+private:
+	struct Anchor_t
+	{
+		vr::HmdQuaternion_t qDriverRotation;
+		double vecDriverPosition[3];
+		vr::SpatialAnchorDriverPose_t worldPose; // valid while m_bTracking
+	};
+
+	void ResolveDescriptor(vr::SpatialAnchorHandle_t unHandle);
+	void CreateDescriptor(vr::SpatialAnchorHandle_t unHandle);
+	void PublishPose(vr::SpatialAnchorHandle_t unHandle, Anchor_t* pAnchor);
+	void ComputeWorldPose(Anchor_t* pAnchor) const;
+
+	std::unordered_map<vr::SpatialAnchorHandle_t, Anchor_t> m_mapAnchors;
+
+	// the mapping the cached world poses were computed with
+	vr::HmdQuaternion_t m_qWorldFromDriverRotation;
+	double m_vecWorldFromDriverTranslation[3];
+	bool m_bTracking;
+};
+
+#endif // SPATIALANCHORS_H
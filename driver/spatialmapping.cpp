@@ -0,0 +1,241 @@
+#include "spatialmapping.h"
+#include "driverlog.h"
+
+#include <chrono>
+
+using namespace sl;
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CSpatialMapper::CSpatialMapper()
+	: m_ulRefreshIntervalNs(0)
+	, m_ulLastRequestNs(0)
+	, m_eRefresh(Refresh_Idle)
+	, m_eState(SPATIAL_MAPPING_STATE::NOT_ENABLED)
+	, m_pWorker(nullptr)
+	, m_bStopWorker(false)
+	, m_ulVersion(0)
+{
+}
+
+CSpatialMapper::~CSpatialMapper()
+{
+	if (m_pWorker)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_workerMutex);
+			m_bStopWorker = true;
+		}
+		m_workerWake.notify_one();
+		m_pWorker->join();
+		delete m_pWorker;
+	}
+}
+
+bool CSpatialMapper::Enable(Camera& zed, float flResolution, float flRange, float flRefreshInterval)
+{
+	Disable(zed);
+
+	// the SDK starts a new map, whatever consumers hold is gone
+	RemoveAllChunks();
+	m_mesh.clear();
+
+	SpatialMappingParameters params;
+	params.map_type = SpatialMappingParameters::SPATIAL_MAP_TYPE::MESH;
+	params.resolution_meter = flResolution;
+	if (flRange > 0.0f)
+		params.range_meter = flRange;
+	else
+		params.set(SpatialMappingParameters::MAPPING_RANGE::AUTO);
+	params.use_chunk_only = true; // only the chunks are read, don't rebuild the merged mesh
+	params.save_texture = false;
+
+	ERROR_CODE eError = zed.enableSpatialMapping(params);
+	if (eError != ERROR_CODE::SUCCESS)
+	{
+		DriverLog("Unable to enable spatial mapping: %s\n", toString(eError).c_str());
+		return false;
+	}
+
+	m_ulRefreshIntervalNs = (uint64_t)((flRefreshInterval > 0.1f ? flRefreshInterval : 0.1f) * 1e9);
+	m_ulLastRequestNs = GetSteadyNanoseconds();
+	m_eRefresh = Refresh_Idle;
+	m_bStopWorker = false;
+	m_pWorker = new std::thread(&CSpatialMapper::RunWorker, this);
+
+	DriverLog("Spatial mapping at %.2f m resolution, refreshed every %.1f s\n", params.resolution_meter, m_ulRefreshIntervalNs * 1e-9);
+	return true;
+}
+
+void CSpatialMapper::Disable(Camera& zed)
+{
+	if (!m_pWorker)
+		return;
+
+	// lets a refresh being processed finish, so the published chunks are complete
+	{
+		std::lock_guard<std::mutex> lock(m_workerMutex);
+		m_bStopWorker = true;
+	}
+	m_workerWake.notify_one();
+	m_pWorker->join();
+	delete m_pWorker;
+	m_pWorker = nullptr;
+
+	zed.disableSpatialMapping();
+	m_eRefresh = Refresh_Idle;
+	m_eState = SPATIAL_MAPPING_STATE::NOT_ENABLED;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Two non-blocking SDK calls per grab at most; the mesh is only
+// retrieved once the SDK reports it extracted.
+//-----------------------------------------------------------------------------
+void CSpatialMapper::Update(Camera& zed)
+{
+	if (!m_pWorker)
+		return;
+
+	m_eState = zed.getSpatialMappingState();
+
+	switch (m_eRefresh.load())
+	{
+	case Refresh_Idle:
+	{
+		uint64_t ulNowNs = GetSteadyNanoseconds();
+		if (ulNowNs - m_ulLastRequestNs < m_ulRefreshIntervalNs || m_eState.load() != SPATIAL_MAPPING_STATE::OK)
+			return;
+		m_ulLastRequestNs = ulNowNs;
+		zed.requestSpatialMapAsync();
+		m_eRefresh = Refresh_Requested;
+		break;
+	}
+
+	case Refresh_Requested:
+		if (zed.getSpatialMapRequestStatusAsync() != ERROR_CODE::SUCCESS)
+			return;
+		if (zed.retrieveSpatialMapAsync(m_mesh) != ERROR_CODE::SUCCESS)
+		{
+			m_eRefresh = Refresh_Idle;
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_workerMutex);
+			m_eRefresh = Refresh_Processing;
+		}
+		m_workerWake.notify_one();
+		break;
+
+	case Refresh_Processing:
+		break;
+	}
+}
+
+void CSpatialMapper::RunWorker()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_workerMutex);
+			m_workerWake.wait(lock, [this] { return m_bStopWorker || m_eRefresh.load() == Refresh_Processing; });
+			if (m_eRefresh.load() != Refresh_Processing)
+				return;
+		}
+
+		PublishUpdatedChunks();
+		m_eRefresh = Refresh_Idle;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Worker: copies the chunks the SDK refilled out of m_mesh. All
+// chunks changed by one refresh share one new version.
+//-----------------------------------------------------------------------------
+void CSpatialMapper::PublishUpdatedChunks()
+{
+	size_t unPublished;
+	{
+		std::lock_guard<std::mutex> lock(m_chunkMutex);
+		unPublished = m_vecChunks.size();
+	}
+
+	std::vector<std::pair<uint32_t, std::shared_ptr<const SpatialMapChunk_t>>> vecUpdated;
+	for (size_t i = 0; i < m_mesh.chunks.size(); i++)
+	{
+		const Chunk& chunk = m_mesh.chunks[i];
+		if (!chunk.has_been_updated && i < unPublished)
+			continue;
+
+		std::shared_ptr<SpatialMapChunk_t> pChunk = std::make_shared<SpatialMapChunk_t>();
+		pChunk->vecVertices = chunk.vertices;
+		pChunk->vecTriangles = chunk.triangles;
+		vecUpdated.emplace_back((uint32_t)i, std::move(pChunk));
+	}
+
+	std::lock_guard<std::mutex> lock(m_chunkMutex);
+	bool bRemoved = m_vecChunks.size() > m_mesh.chunks.size();
+	if (vecUpdated.empty() && !bRemoved)
+		return;
+
+	uint64_t ulVersion = ++m_ulVersion;
+	if (m_vecChunks.size() < m_mesh.chunks.size())
+		m_vecChunks.resize(m_mesh.chunks.size(), ChunkEntry_t{ 0, nullptr });
+	for (auto& updated : vecUpdated)
+	{
+		m_vecChunks[updated.first].ulVersion = ulVersion;
+		m_vecChunks[updated.first].pChunk = std::move(updated.second);
+	}
+
+	// the index stays allocated so a consumer still sees the removal
+	for (size_t i = m_mesh.chunks.size(); i < m_vecChunks.size(); i++)
+	{
+		if (m_vecChunks[i].pChunk)
+		{
+			m_vecChunks[i].ulVersion = ulVersion;
+			m_vecChunks[i].pChunk.reset();
+		}
+	}
+}
+
+void CSpatialMapper::RemoveAllChunks()
+{
+	std::lock_guard<std::mutex> lock(m_chunkMutex);
+	if (m_vecChunks.empty())
+		return;
+
+	uint64_t ulVersion = ++m_ulVersion;
+	for (ChunkEntry_t& entry : m_vecChunks)
+	{
+		if (entry.pChunk)
+		{
+			entry.ulVersion = ulVersion;
+			entry.pChunk.reset();
+		}
+	}
+}
+
+uint64_t CSpatialMapper::GetChangedChunks(uint64_t ulSinceVersion, std::vector<SpatialMapChunkDelta_t>* pChanged) const
+{
+	pChanged->clear();
+
+	std::lock_guard<std::mutex> lock(m_chunkMutex);
+	for (size_t i = 0; i < m_vecChunks.size(); i++)
+	{
+		const ChunkEntry_t& entry = m_vecChunks[i];
+		if (entry.ulVersion <= ulSinceVersion)
+			continue;
+		// a consumer starting from scratch has nothing to remove
+		if (ulSinceVersion == 0 && !entry.pChunk)
+			continue;
+
+		SpatialMapChunkDelta_t delta;
+		delta.unChunk = (uint32_t)i;
+		delta.ulVersion = entry.ulVersion;
+		delta.pChunk = entry.pChunk;
+		pChanged->push_back(delta);
+	}
+	return m_ulVersion;
+}
@@ -0,0 +1,112 @@
+#ifndef SPATIALMAPPING_H
+#define SPATIALMAPPING_H
+
+#pragma once
+
+#include <sl/Camera.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Purpose: One chunk of the spatial map as handed to consumers. Immutable once
+// published; a changed chunk is published as a new object.
+//-----------------------------------------------------------------------------
+struct SpatialMapChunk_t
+{
+	std::vector<sl::float3> vecVertices; // ZED world (driver) space, meters
+	std::vector<sl::uint3> vecTriangles;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: A chunk that changed since the version a consumer last saw.
+// pChunk is null when the chunk no longer exists.
+//-----------------------------------------------------------------------------
+struct SpatialMapChunkDelta_t
+{
+	uint32_t unChunk;
+	uint64_t ulVersion;
+	std::shared_ptr<const SpatialMapChunk_t> pChunk;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Optional incremental mesh of the room from ZED spatial mapping,
+// e.g. for chaperone generation or occlusion.
+//
+// The SDK integrates depth on its own threads. Every refresh interval the grab
+// thread requests the mesh and, once the SDK has it ready, retrieves it; that
+// only copies the chunks the SDK marked updated. A worker then turns those
+// chunks into SpatialMapChunk_t objects stamped with a new map version, so the
+// grab thread never walks the mesh. While the worker runs no new mesh is
+// requested, which bounds the work to one refresh in flight.
+//
+// Consumers keep the version they last saw and ask for what changed since
+// with GetChangedChunks, so their cost follows the changes, not the size of
+// the mapped area; version 0 gets everything.
+//-----------------------------------------------------------------------------
+class CSpatialMapper
+{
+public:
+	CSpatialMapper();
+	~CSpatialMapper();
+
+	/** Grab thread: starts mapping on the camera that was just opened. Chunks of
+	* a previous session are reported removed. */
+	bool Enable(sl::Camera& zed, float flResolution, float flRange, float flRefreshInterval);
+
+	/** Grab thread: stops mapping, waiting for the worker. The published chunks stay readable. */
+	void Disable(sl::Camera& zed);
+
+	bool IsEnabled() const { return m_pWorker != nullptr; }
+
+	/** Grab thread, once per iteration: requests and retrieves the mesh at the refresh interval */
+	void Update(sl::Camera& zed);
+
+	/** Any thread: chunks changed after ulSinceVersion, returns the current map version */
+	uint64_t GetChangedChunks(uint64_t ulSinceVersion, std::vector<SpatialMapChunkDelta_t>* pChanged) const;
+
+	sl::SPATIAL_MAPPING_STATE GetState() const { return m_eState.load(); }
+
+private:
+	CSpatialMapper(const CSpatialMapper&) = delete;
+	CSpatialMapper& operator=(const CSpatialMapper&) = delete;
+
+	enum ERefreshState
+	{
+		Refresh_Idle,
+		Refresh_Requested,  // waiting for the SDK to extract the mesh
+		Refresh_Processing, // m_mesh belongs to the worker
+	};
+
+	struct ChunkEntry_t
+	{
+		uint64_t ulVersion;
+		std::shared_ptr<const SpatialMapChunk_t> pChunk;
+	};
+
+	void RunWorker();
+	void PublishUpdatedChunks();
+	void RemoveAllChunks();
+
+	sl::Mesh m_mesh; // kept across refreshes so the SDK only refills updated chunks
+	uint64_t m_ulRefreshIntervalNs;
+	uint64_t m_ulLastRequestNs;
+	std::atomic<ERefreshState> m_eRefresh;
+	std::atomic<sl::SPATIAL_MAPPING_STATE> m_eState;
+
+	std::thread* m_pWorker;
+	std::mutex m_workerMutex;
+	std::condition_variable m_workerWake;
+	bool m_bStopWorker;
+
+	mutable std::mutex m_chunkMutex; // m_vecChunks and m_ulVersion
+	std::vector<ChunkEntry_t> m_vecChunks;
+	uint64_t m_ulVersion;
+};
+
+#endif // SPATIALMAPPING_H
@@ -0,0 +1,272 @@
+#include "svorecorder.h"
+#include "driverlog.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#include <chrono>
+
+using namespace sl;
+
+// the degrade steps: the bitrate is halved down to this, then frames are skipped up to one in k_nMaxFrameDivisor
+static const uint32_t k_unMinBitrateKbps = 2000;
+static const int k_nMaxFrameDivisor = 8;
+
+// over budget is decided per window; skipping is eased after this long within half the budget
+static const uint64_t k_ulWindowNs = 1000000000ull;
+static const uint64_t k_ulRecoverNs = 10000000000ull;
+
+static const float k_flCompressionSmoothing = 0.1f;
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string JoinPath(const std::string& sDir, const std::string& sName)
+{
+	if (sDir.empty() || sDir.back() == '/' || sDir.back() == '\\')
+		return sDir + sName;
+	return sDir + "/" + sName;
+}
+
+static std::string GetLocalTimeStamp()
+{
+	time_t now = time(nullptr);
+	struct tm local;
+#if defined(_WIN32)
+	localtime_s(&local, &now);
+#else
+	localtime_r(&now, &local);
+#endif
+	char rgchStamp[32];
+	strftime(rgchStamp, sizeof(rgchStamp), "%Y%m%d-%H%M%S", &local);
+	return rgchStamp;
+}
+
+CSvoRecorder::CSvoRecorder()
+	: m_bRequested(false)
+	, m_bRecording(false)
+	, m_unCameraSerial(0)
+	, m_unBitrateKbps(0)
+	, m_ulFrameIndex(0)
+	, m_bPaused(false)
+	, m_bRestartSegment(false)
+	, m_ulWindowStartNs(0)
+	, m_unWindowFailures(0)
+	, m_ulWithinBudgetSinceNs(0)
+	, m_ulFramesRecorded(0)
+	, m_ulFramesSkipped(0)
+	, m_ulFramesFailed(0)
+	, m_unSegments(0)
+	, m_unCurrentBitrateKbps(0)
+	, m_nFrameDivisor(1)
+	, m_flCompressionMs(0.0f)
+{
+}
+
+void CSvoRecorder::Update(Camera& zed, const ZedmSettings_t& settings, unsigned int unCameraSerial)
+{
+	bool bRequested = m_bRequested.load();
+	if (m_bRecording && (!bRequested || m_bRestartSegment))
+	{
+		zed.disableRecording();
+		m_bRecording = false;
+		if (!bRequested)
+		{
+			DriverLog("ZED %u: recording stopped, %llu frames recorded, %llu skipped, %llu failed\n", m_unCameraSerial,
+				(unsigned long long)m_ulFramesRecorded.load(), (unsigned long long)m_ulFramesSkipped.load(), (unsigned long long)m_ulFramesFailed.load());
+			std::lock_guard<std::mutex> lock(m_fileNameMutex);
+			m_sFileName.clear();
+		}
+	}
+	if (!bRequested)
+	{
+		m_sRecordingStamp.clear();
+		return;
+	}
+	if (m_bRecording)
+		return;
+
+	if (m_sRecordingStamp.empty())
+	{
+		if (settings.sSvoRecordPath.empty())
+		{
+			m_bRequested = false;
+			return;
+		}
+
+		// a new recording; its segments keep these settings
+		m_settings = settings;
+		m_unCameraSerial = unCameraSerial;
+		m_sRecordingStamp = GetLocalTimeStamp();
+		m_unBitrateKbps = settings.nSvoRecordBitrate > 0 ? (uint32_t)settings.nSvoRecordBitrate : 0;
+		m_nFrameDivisor = 1;
+		m_ulFramesRecorded = 0;
+		m_ulFramesSkipped = 0;
+		m_ulFramesFailed = 0;
+		m_unSegments = 0;
+		m_flCompressionMs = 0.0f;
+	}
+
+	if (!StartSegment(zed, unCameraSerial))
+	{
+		m_bRequested = false;
+		m_sRecordingStamp.clear();
+		std::lock_guard<std::mutex> lock(m_fileNameMutex);
+		m_sFileName.clear();
+	}
+}
+
+bool CSvoRecorder::StartSegment(Camera& zed, unsigned int unCameraSerial)
+{
+	char rgchName[96];
+	snprintf(rgchName, sizeof(rgchName), "zedm_%u_%s_%u.svo", unCameraSerial, m_sRecordingStamp.c_str(), m_unSegments.load() + 1);
+	std::string sPath = JoinPath(m_settings.sSvoRecordPath, rgchName);
+
+	RecordingParameters params;
+	params.video_filename = sPath.c_str();
+	params.compression_mode = m_settings.sSvoRecordCodec == "h265" ? SVO_COMPRESSION_MODE::H265 : SVO_COMPRESSION_MODE::H264;
+	params.bitrate = m_unBitrateKbps;
+	ERROR_CODE eError = zed.enableRecording(params);
+	if (eError != ERROR_CODE::SUCCESS && params.compression_mode == SVO_COMPRESSION_MODE::H265)
+	{
+		// H.265 needs a Pascal or newer encoder
+		DriverLog("ZED %u: H.265 recording unavailable (%s), recording H.264\n", unCameraSerial, toString(eError).c_str());
+		params.compression_mode = SVO_COMPRESSION_MODE::H264;
+		eError = zed.enableRecording(params);
+	}
+	if (eError != ERROR_CODE::SUCCESS)
+	{
+		DriverLog("ZED %u: unable to record to %s: %s\n", unCameraSerial, sPath.c_str(), toString(eError).c_str());
+		return false;
+	}
+
+	m_bRecording = true;
+	m_bRestartSegment = false;
+	m_bPaused = false;
+	m_ulFrameIndex = 0;
+	m_ulWindowStartNs = GetSteadyNanoseconds();
+	m_unWindowFailures = 0;
+	m_ulWithinBudgetSinceNs = 0;
+	m_unSegments++;
+	m_unCurrentBitrateKbps = m_unBitrateKbps;
+	{
+		std::lock_guard<std::mutex> lock(m_fileNameMutex);
+		m_sFileName = sPath;
+	}
+	DriverLog("ZED %u: recording to %s\n", unCameraSerial, sPath.c_str());
+	return true;
+}
+
+void CSvoRecorder::FrameGrabbed(Camera& zed)
+{
+	if (!m_bRecording)
+		return;
+
+	RecordingStatus status = zed.getRecordingStatus();
+	if (m_bPaused)
+	{
+		m_ulFramesSkipped++;
+	}
+	else if (status.status)
+	{
+		m_ulFramesRecorded++;
+		float flCompressionMs = m_flCompressionMs.load();
+		flCompressionMs += k_flCompressionSmoothing * ((float)status.current_compression_time - flCompressionMs);
+		m_flCompressionMs = flCompressionMs;
+	}
+	else
+	{
+		m_ulFramesFailed++;
+		m_unWindowFailures++;
+	}
+	m_ulFrameIndex++;
+
+	uint64_t ulNowNs = GetSteadyNanoseconds();
+	float flBudgetMs = m_settings.flSvoRecordBudget;
+	if (ulNowNs - m_ulWindowStartNs >= k_ulWindowNs)
+	{
+		if (m_unWindowFailures > 0 || (flBudgetMs > 0.0f && m_flCompressionMs.load() > flBudgetMs))
+			Degrade();
+		m_ulWindowStartNs = ulNowNs;
+		m_unWindowFailures = 0;
+	}
+
+	// frame skipping comes back a step at a time once there is room for it
+	if (flBudgetMs > 0.0f && m_flCompressionMs.load() < 0.5f * flBudgetMs && m_unWindowFailures == 0)
+	{
+		if (m_ulWithinBudgetSinceNs == 0)
+			m_ulWithinBudgetSinceNs = ulNowNs;
+		else if (ulNowNs - m_ulWithinBudgetSinceNs >= k_ulRecoverNs && m_nFrameDivisor.load() > 1)
+		{
+			m_nFrameDivisor = m_nFrameDivisor.load() / 2;
+			m_ulWithinBudgetSinceNs = ulNowNs;
+			DriverLog("ZED %u: recording caught up, one frame in %d\n", m_unCameraSerial, m_nFrameDivisor.load());
+		}
+	}
+	else
+	{
+		m_ulWithinBudgetSinceNs = 0;
+	}
+
+	// the SDK records the next grab unless paused
+	bool bPause = m_ulFrameIndex % (uint64_t)m_nFrameDivisor.load() != 0;
+	if (bPause != m_bPaused)
+	{
+		zed.pauseRecording(bPause);
+		m_bPaused = bPause;
+	}
+}
+
+void CSvoRecorder::Degrade()
+{
+	// 0 is the SDK's default for the resolution, which has no known value to halve
+	if (m_unBitrateKbps / 2 >= k_unMinBitrateKbps)
+	{
+		m_unBitrateKbps /= 2;
+		m_bRestartSegment = true;
+		DriverLog("ZED %u: recording falls behind (%.1f ms per frame), new segment at %u kbit/s\n", m_unCameraSerial,
+			m_flCompressionMs.load(), m_unBitrateKbps);
+		return;
+	}
+
+	int nFrameDivisor = m_nFrameDivisor.load();
+	if (nFrameDivisor < k_nMaxFrameDivisor)
+	{
+		m_nFrameDivisor = nFrameDivisor * 2;
+		m_ulWithinBudgetSinceNs = 0;
+		DriverLog("ZED %u: recording falls behind (%.1f ms per frame), one frame in %d\n", m_unCameraSerial,
+			m_flCompressionMs.load(), nFrameDivisor * 2);
+	}
+}
+
+void CSvoRecorder::Close(Camera& zed)
+{
+	if (!m_bRecording)
+		return;
+
+	zed.disableRecording();
+	m_bRecording = false;
+	std::lock_guard<std::mutex> lock(m_fileNameMutex);
+	m_sFileName.clear();
+}
+
+void CSvoRecorder::GetStats(SvoRecordingStats_t* pStats) const
+{
+	pStats->bRequested = m_bRequested.load();
+	pStats->bRecording = m_bRecording.load();
+	pStats->ulFramesRecorded = m_ulFramesRecorded.load();
+	pStats->ulFramesSkipped = m_ulFramesSkipped.load();
+	pStats->ulFramesFailed = m_ulFramesFailed.load();
+	pStats->unSegments = m_unSegments.load();
+	pStats->unBitrateKbps = m_unCurrentBitrateKbps.load();
+	pStats->nFrameDivisor = m_nFrameDivisor.load();
+	pStats->flCompressionMs = m_flCompressionMs.load();
+}
+
+std::string CSvoRecorder::GetFileName() const
+{
+	std::lock_guard<std::mutex> lock(m_fileNameMutex);
+	return m_sFileName;
+}
@@ -0,0 +1,107 @@
+#ifndef SVORECORDER_H
+#define SVORECORDER_H
+
+#pragma once
+
+#include <sl/Camera.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "driversettings.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Live figures of a field recording, for DebugRequest("stats")
+//-----------------------------------------------------------------------------
+struct SvoRecordingStats_t
+{
+	bool bRequested;
+	bool bRecording;
+	uint64_t ulFramesRecorded;
+	uint64_t ulFramesSkipped; // left out on purpose to keep up
+	uint64_t ulFramesFailed; // the SDK couldn't encode or write them
+	uint32_t unSegments; // files written this recording
+	uint32_t unBitrateKbps; // of the current segment
+	int nFrameDivisor; // one grabbed frame recorded out of this many
+	float flCompressionMs; // smoothed time the SDK spends on a recorded frame inside grab
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Records the camera to SVO with the SDK's hardware H.264/H.265
+// encoder while tracking goes on, for reproducing tracking bugs from the
+// field. Started and stopped from DebugRequest("record ..."), into
+// svoRecordPath; off otherwise.
+//
+// The SDK encodes and writes each recorded frame inside grab, so the time it
+// takes comes straight out of the pose rate. Per frame the recorder gets
+// svoRecordBudget of it: when the smoothed compression time runs over, or
+// frames fail to write because the disk fell behind, the recording degrades,
+// first to a lower bitrate (a new segment file, the SDK can't change it on
+// the fly), then to only every 2nd, 4th, 8th frame by pausing the recording
+// for the grabs in between. Frame skipping is eased off again after a while
+// well within the budget.
+//
+// A camera reopen ends the SDK's recording; while it is still requested, the
+// next Update starts a new segment.
+//-----------------------------------------------------------------------------
+class CSvoRecorder
+{
+public:
+	CSvoRecorder();
+
+	/** Any thread: asks the grab thread to start or stop recording */
+	void Request(bool bRecord) { m_bRequested = bRecord; }
+
+	/** Grab thread, before each grab: starts or stops the recording as requested */
+	void Update(sl::Camera& zed, const ZedmSettings_t& settings, unsigned int unCameraSerial);
+
+	/** Grab thread, after each successful grab: accounts the frame and decides about the next */
+	void FrameGrabbed(sl::Camera& zed);
+
+	/** Grab thread, before the camera closes; the request stays */
+	void Close(sl::Camera& zed);
+
+	bool IsRecording() const { return m_bRecording.load(); }
+
+	void GetStats(SvoRecordingStats_t* pStats) const;
+
+	/** The segment being written, empty if none */
+	std::string GetFileName() const;
+
+private:
+	CSvoRecorder(const CSvoRecorder&) = delete;
+	CSvoRecorder& operator=(const CSvoRecorder&) = delete;
+
+	bool StartSegment(sl::Camera& zed, unsigned int unCameraSerial);
+	void Degrade();
+
+	std::atomic<bool> m_bRequested;
+	std::atomic<bool> m_bRecording;
+
+	// grab thread's
+	ZedmSettings_t m_settings; // as of the recording's start
+	unsigned int m_unCameraSerial;
+	std::string m_sRecordingStamp; // start time of the recording, shared by its segments
+	uint32_t m_unBitrateKbps;
+	uint64_t m_ulFrameIndex; // grabs since the segment started
+	bool m_bPaused;
+	bool m_bRestartSegment; // the bitrate changed
+	uint64_t m_ulWindowStartNs;
+	uint32_t m_unWindowFailures;
+	uint64_t m_ulWithinBudgetSinceNs; // 0 while over half the budget
+
+	std::atomic<uint64_t> m_ulFramesRecorded;
+	std::atomic<uint64_t> m_ulFramesSkipped;
+	std::atomic<uint64_t> m_ulFramesFailed;
+	std::atomic<uint32_t> m_unSegments;
+	std::atomic<uint32_t> m_unCurrentBitrateKbps;
+	std::atomic<int> m_nFrameDivisor;
+	std::atomic<float> m_flCompressionMs;
+
+	mutable std::mutex m_fileNameMutex;
+	std::string m_sFileName;
+};
+
+#endif // SVORECORDER_H
@@ -0,0 +1,238 @@
+#include "syntheticload.h"
+#include "driverlog.h"
+#include "hmdmath.h"
+#include "poserecorder.h"
+#include "precisetimer.h"
+#include "threadscheduling.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <chrono>
+
+using namespace vr;
+
+// the devices stand on a grid of this many columns, this far apart (m), at head height
+static const uint32_t k_unGridColumns = 8;
+static const double k_flGridSpacing = 0.5;
+static const double k_flGridHeight = 1.2;
+
+// procedural motion: a figure-eight of this size (m) and period (s), slightly different per device
+static const double k_flFigureRadius = 0.3;
+static const double k_flFigurePeriod = 4.0;
+static const double k_flFigurePeriodStep = 0.05;
+
+static const double k_flPi = 3.14159265358979323846;
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool CSyntheticMotion::LoadRecording(const std::string& sPath)
+{
+	m_vecRecorded.clear();
+
+	FILE* pFile = fopen(sPath.c_str(), "rb");
+	if (!pFile)
+		return false;
+
+	PoseRecordingHeader_t header;
+	if (fread(&header, sizeof(header), 1, pFile) != 1 || header.unMagic != k_unPoseRecordingMagic
+		|| header.unVersion != k_unPoseRecordingVersion || header.unRecordSize != k_unPoseRecordSize)
+	{
+		fclose(pFile);
+		return false;
+	}
+
+	// the same walk as CPoseRecordingView::CIterator, keeping what was published
+	uint64_t ulTimestampNs = header.ulFirstTimestampNs;
+	uint64_t ulFirstNs = 0;
+	PoseRecord_t record;
+	while (fread(&record, sizeof(record), 1, pFile) == 1)
+	{
+		if (record.unType == PoseRecord_Sync)
+		{
+			ulTimestampNs = record.ulAbsoluteTimestampNs;
+			continue;
+		}
+		ulTimestampNs += (int64_t)record.nDeltaNs;
+		if (record.unType != PoseRecord_Published || !(record.unFlags & k_unPoseRecordFlag_Valid))
+			continue;
+		if (m_vecRecorded.empty())
+			ulFirstNs = ulTimestampNs;
+		if (ulTimestampNs < ulFirstNs || (!m_vecRecorded.empty() && ulTimestampNs - ulFirstNs <= m_vecRecorded.back().ulOffsetNs))
+			continue;
+
+		RecordedPose_t pose;
+		pose.ulOffsetNs = ulTimestampNs - ulFirstNs;
+		for (int i = 0; i < 3; i++)
+		{
+			pose.vecPosition[i] = record.rgflValues[i];
+			pose.vecVelocity[i] = record.rgflValues[7 + i];
+			pose.vecAngularVelocity[i] = record.rgflValues[10 + i];
+		}
+		for (int i = 0; i < 4; i++)
+			pose.qRotation[i] = record.rgflValues[3 + i];
+		m_vecRecorded.push_back(pose);
+	}
+	fclose(pFile);
+
+	// a loop needs some length to it
+	if (m_vecRecorded.size() < 2)
+		m_vecRecorded.clear();
+	return !m_vecRecorded.empty();
+}
+
+void CSyntheticMotion::Sample(uint64_t ulTimeNs, uint32_t unDevice, uint32_t unDeviceCount, DriverPose_t* pPose) const
+{
+	double vecOrigin[3] = {
+		((double)(unDevice % k_unGridColumns) - 0.5 * (k_unGridColumns - 1)) * k_flGridSpacing,
+		k_flGridHeight,
+		-(double)(unDevice / k_unGridColumns) * k_flGridSpacing
+	};
+
+	pPose->poseIsValid = true;
+	pPose->deviceIsConnected = true;
+	pPose->result = TrackingResult_Running_OK;
+	pPose->poseTimeOffset = 0.0;
+
+	if (!m_vecRecorded.empty())
+	{
+		// staggered through the loop so the devices don't move in lockstep
+		uint64_t ulLengthNs = m_vecRecorded.back().ulOffsetNs;
+		uint64_t ulOffsetNs = (ulTimeNs + ulLengthNs / (unDeviceCount ? unDeviceCount : 1) * unDevice) % ulLengthNs;
+		size_t unLow = 0, unHigh = m_vecRecorded.size() - 1;
+		while (unHigh - unLow > 1)
+		{
+			size_t unMid = (unLow + unHigh) / 2;
+			if (m_vecRecorded[unMid].ulOffsetNs <= ulOffsetNs)
+				unLow = unMid;
+			else
+				unHigh = unMid;
+		}
+
+		// the recording's own origin stays at the first device's place
+		const RecordedPose_t& recorded = m_vecRecorded[unLow];
+		const RecordedPose_t& first = m_vecRecorded[0];
+		for (int i = 0; i < 3; i++)
+		{
+			pPose->vecPosition[i] = recorded.vecPosition[i] - first.vecPosition[i] + vecOrigin[i];
+			pPose->vecVelocity[i] = recorded.vecVelocity[i];
+			pPose->vecAngularVelocity[i] = recorded.vecAngularVelocity[i];
+		}
+		pPose->qRotation = HmdQuaternion_Normalize(HmdQuaternion_Init(recorded.qRotation[0], recorded.qRotation[1], recorded.qRotation[2], recorded.qRotation[3]));
+		return;
+	}
+
+	// a horizontal figure-eight, facing along it as it yaws back and forth
+	double flOmega = 2.0 * k_flPi / (k_flFigurePeriod + k_flFigurePeriodStep * unDevice);
+	double flPhase = flOmega * (ulTimeNs * 1e-9) + unDevice;
+	pPose->vecPosition[0] = vecOrigin[0] + k_flFigureRadius * sin(flPhase);
+	pPose->vecPosition[1] = vecOrigin[1];
+	pPose->vecPosition[2] = vecOrigin[2] + 0.5 * k_flFigureRadius * sin(2.0 * flPhase);
+	pPose->vecVelocity[0] = k_flFigureRadius * flOmega * cos(flPhase);
+	pPose->vecVelocity[1] = 0.0;
+	pPose->vecVelocity[2] = k_flFigureRadius * flOmega * cos(2.0 * flPhase);
+
+	double flYaw = 0.5 * sin(flPhase);
+	pPose->qRotation = HmdQuaternion_FromYawPitchRoll(flYaw, 0.0, 0.0);
+	pPose->vecAngularVelocity[0] = 0.0;
+	pPose->vecAngularVelocity[1] = 0.5 * flOmega * cos(flPhase);
+	pPose->vecAngularVelocity[2] = 0.0;
+}
+
+CSyntheticTracker::CSyntheticTracker(const CSyntheticMotion* pMotion, uint32_t unIndex, uint32_t unCount)
+	: m_pMotion(pMotion)
+	, m_unIndex(unIndex)
+	, m_unCount(unCount)
+	, m_pThread(nullptr)
+	, m_bRunning(false)
+	, m_unObjectId(k_unTrackedDeviceIndexInvalid)
+	, m_ulTicks(0)
+	, m_ulMissedTicks(0)
+	, m_ulSubmitted(0)
+	, m_ulDeduplicated(0)
+{
+}
+
+CSyntheticTracker::~CSyntheticTracker()
+{
+	Stop();
+}
+
+void CSyntheticTracker::Start(const ZedmSettings_t& settings, double flRateHz)
+{
+	if (m_pThread)
+		return;
+
+	uint64_t ulPeriodNs = (uint64_t)(1e9 / (flRateHz > 1.0 ? flRateHz : 1.0));
+	m_bRunning = true;
+	m_pThread = new std::thread(&CSyntheticTracker::Run, this, settings, ulPeriodNs);
+}
+
+void CSyntheticTracker::Stop()
+{
+	if (!m_pThread)
+		return;
+
+	m_bRunning = false;
+	m_pThread->join();
+	delete m_pThread;
+	m_pThread = nullptr;
+}
+
+void CSyntheticTracker::GetStats(SyntheticTrackerStats_t* pStats) const
+{
+	pStats->ulTicks = m_ulTicks.load();
+	pStats->ulMissedTicks = m_ulMissedTicks.load();
+	pStats->ulSubmitted = m_ulSubmitted.load();
+	pStats->ulDeduplicated = m_ulDeduplicated.load();
+	pStats->wakeLateness = m_wakeLateness.Summarize();
+	pStats->submitCall = m_submitCall.Summarize();
+}
+
+void CSyntheticTracker::Run(ZedmSettings_t settings, uint64_t ulPeriodNs)
+{
+	CScopedThreadScheduling scheduling("Synthetic", settings);
+
+	// the camera device's publish filters, see ConfigurePublishFilters in zedtracker.cpp
+	OneEuroParams_t params = { settings.flFilterMinCutoff, settings.flFilterBeta, settings.flFilterDerivativeCutoff };
+	m_poseFilter.Configure(settings.bPoseFilter, params);
+	m_submitFilter.Configure(settings.bPoseDedup, settings.flDedupPosition, settings.flDedupRotation, settings.flDedupKeepAlive);
+	PredictorParams_t predictorParams = { settings.flPredictionJerk, settings.flPredictionAngularAcceleration };
+	m_predictor.Configure(settings.flPredictionHorizon > 0.0f, predictorParams);
+
+	CPreciseTimer timer;
+	timer.Start(ulPeriodNs, &m_wakeLateness);
+	while (m_bRunning)
+	{
+		timer.WaitForNextTick();
+		uint64_t ulNowNs = GetSteadyNanoseconds();
+
+		DriverPose_t pose;
+		m_poseTemplate.Read(&pose);
+		m_pMotion->Sample(ulNowNs, m_unIndex, m_unCount, &pose);
+		if (m_poseFilter.IsEnabled())
+			m_poseFilter.Filter(&pose, 1, ulNowNs);
+		m_predictor.Update(&pose, 1, ulNowNs);
+		m_poseHandoff.Write(pose);
+		m_ulTicks++;
+		m_ulMissedTicks.store(timer.GetMissedTicks(), std::memory_order_relaxed);
+
+		TrackedDeviceIndex_t unObjectId = m_unObjectId.load();
+		if (unObjectId == k_unTrackedDeviceIndexInvalid)
+			continue;
+		if (!m_submitFilter.ShouldSubmit(pose, ulNowNs, ulNowNs))
+		{
+			m_ulDeduplicated++;
+			continue;
+		}
+
+		pose.poseTimeOffset += m_predictor.Predict(&pose, 1, settings.flPredictionHorizon);
+		uint64_t ulSubmitNs = GetSteadyNanoseconds();
+		VRServerDriverHost()->TrackedDevicePoseUpdated(unObjectId, pose, sizeof(DriverPose_t));
+		m_submitCall.Record(GetSteadyNanoseconds() - ulSubmitNs);
+		m_ulSubmitted++;
+	}
+}
@@ -0,0 +1,116 @@
+#ifndef SYNTHETICLOAD_H
+#define SYNTHETICLOAD_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "driversettings.h"
+#include "latencystats.h"
+#include "posededup.h"
+#include "posefilter.h"
+#include "posepredictor.h"
+#include "seqlock.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: The motion of the synthetic trackers. Procedural by default, each
+// device on its own slow figure-eight; or the published poses of a pose
+// recording, looped, each device a fraction of the recording later than the
+// one before and placed on a grid so none of them coincide. Immutable once
+// loaded, shared by all devices' threads.
+//-----------------------------------------------------------------------------
+class CSyntheticMotion
+{
+public:
+	/** The valid published poses of a poseRecordingPath file; false if it has none */
+	bool LoadRecording(const std::string& sPath);
+
+	/** Device unDevice of unDeviceCount at ulTimeNs on any clock */
+	void Sample(uint64_t ulTimeNs, uint32_t unDevice, uint32_t unDeviceCount, vr::DriverPose_t* pPose) const;
+
+private:
+	struct RecordedPose_t
+	{
+		uint64_t ulOffsetNs; // from the first pose
+		float vecPosition[3];
+		float qRotation[4]; // w, x, y, z
+		float vecVelocity[3];
+		float vecAngularVelocity[3];
+	};
+
+	std::vector<RecordedPose_t> m_vecRecorded;
+};
+
+struct SyntheticTrackerStats_t
+{
+	uint64_t ulTicks;
+	uint64_t ulMissedTicks; // the thread woke up too late for a whole period
+	uint64_t ulSubmitted;
+	uint64_t ulDeduplicated;
+	LatencySummary_t wakeLateness;
+	LatencySummary_t submitCall; // time spent in TrackedDevicePoseUpdated
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: A tracker that generates load rather than tracking anything, for
+// measuring how vrserver and the publishing path scale with the number of
+// devices and their rate. Like a camera's IMU publisher, each one has its own
+// thread with the tracking threads' scheduling, woken by a CPreciseTimer at
+// the rate; every pose then goes through the same poseFilter smoothing, pose
+// handoff, poseDedup filter and prediction before TrackedDevicePoseUpdated,
+// and the time that call takes is recorded.
+//-----------------------------------------------------------------------------
+class CSyntheticTracker
+{
+public:
+	CSyntheticTracker(const CSyntheticMotion* pMotion, uint32_t unIndex, uint32_t unCount);
+	~CSyntheticTracker();
+
+	/** Starts the thread at flRateHz, publishing from then on; idempotent */
+	void Start(const ZedmSettings_t& settings, double flRateHz);
+
+	/** Joins the thread */
+	void Stop();
+
+	void SetObjectId(vr::TrackedDeviceIndex_t unObjectId) { m_unObjectId.store(unObjectId); }
+
+	/** The constant fields of the published poses, the calibration included; one thread at a time */
+	void SetPoseTemplate(const vr::DriverPose_t& poseTemplate) { m_poseTemplate.Write(poseTemplate); }
+
+	/** Latest pose published, 0 if none yet */
+	uint32_t ReadPose(vr::DriverPose_t* pPose) const { return m_poseHandoff.Read(pPose); }
+
+	void GetStats(SyntheticTrackerStats_t* pStats) const;
+
+private:
+	void Run(ZedmSettings_t settings, uint64_t ulPeriodNs);
+
+	const CSyntheticMotion* m_pMotion;
+	uint32_t m_unIndex;
+	uint32_t m_unCount;
+	std::thread* m_pThread;
+	std::atomic<bool> m_bRunning;
+	std::atomic<vr::TrackedDeviceIndex_t> m_unObjectId;
+	CSeqLock<vr::DriverPose_t> m_poseTemplate;
+	CSeqLock<vr::DriverPose_t> m_poseHandoff;
+
+	// publisher thread's
+	CPoseFilterBank m_poseFilter;
+	CPoseSubmitFilter m_submitFilter;
+	CPosePredictorBank m_predictor;
+
+	std::atomic<uint64_t> m_ulTicks;
+	std::atomic<uint64_t> m_ulMissedTicks;
+	std::atomic<uint64_t> m_ulSubmitted;
+	std::atomic<uint64_t> m_ulDeduplicated;
+	CLatencyHistogram m_wakeLateness;
+	CLatencyHistogram m_submitCall;
+};
+
+#endif // SYNTHETICLOAD_H
@@ -0,0 +1,221 @@
+#include "telemetry.h"
+#include "driverlog.h"
+#include "memorybudget.h"
+#include "udpsocket.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+// "{host}" in the prefix: this machine's name, its dots would be statsd levels
+static std::string ExpandPrefix(const std::string& sPrefix)
+{
+	size_t unPos = sPrefix.find("{host}");
+	if (unPos == std::string::npos)
+		return sPrefix;
+	char rgchHost[256] = {};
+	if (gethostname(rgchHost, sizeof(rgchHost) - 1) != 0 || !rgchHost[0])
+		strcpy(rgchHost, "unknown");
+	for (char* pch = rgchHost; *pch; pch++)
+	{
+		if (*pch == '.' || *pch == ':' || *pch == '|' || *pch == ' ')
+			*pch = '_';
+	}
+	return sPrefix.substr(0, unPos) + rgchHost + sPrefix.substr(unPos + 6);
+}
+
+CTelemetryExporter::CTelemetryExporter()
+	: m_flIntervalSeconds(0.0f)
+	, m_socket(k_unInvalidSocket)
+	, m_unAddress(0)
+	, m_unPort(0)
+	, m_unDatagramSize(0)
+	, m_ulLastLogDropped(0)
+	, m_ulDatagrams(0)
+	, m_ulSendFailures(0)
+{
+}
+
+CTelemetryExporter::~CTelemetryExporter()
+{
+	Stop();
+}
+
+bool CTelemetryExporter::Start(CWorkerPool* pPool, const std::string& sCollector, const std::string& sPrefix, float flIntervalSeconds)
+{
+	Stop();
+	m_sCollector = sCollector;
+	m_sConfiguredPrefix = sPrefix;
+	m_flIntervalSeconds = flIntervalSeconds;
+	if (!InitSockets())
+		return false;
+
+	std::string sHost = sCollector;
+	m_unPort = k_unDefaultPort;
+	size_t unColon = sCollector.rfind(':');
+	if (unColon != std::string::npos)
+	{
+		sHost = sCollector.substr(0, unColon);
+		m_unPort = (uint16_t)atoi(sCollector.c_str() + unColon + 1);
+	}
+	if (sHost.empty() || m_unPort == 0 || !ResolveHost(sHost.c_str(), &m_unAddress))
+	{
+		DriverLog("Telemetry: unable to resolve collector %s\n", sCollector.c_str());
+		CleanupSockets();
+		return false;
+	}
+	m_socket = OpenUdpSocket();
+	if (m_socket == k_unInvalidSocket)
+	{
+		CleanupSockets();
+		return false;
+	}
+	m_sPrefix = ExpandPrefix(sPrefix);
+
+	flIntervalSeconds = std::max(flIntervalSeconds, 1.0f);
+	m_push.Start(pPool, WorkPriority_Low, (uint64_t)(flIntervalSeconds * 1e9f), [this] { Push(); });
+	DriverLog("Telemetry: %s.* to %s every %.0f s\n", m_sPrefix.c_str(), sCollector.c_str(), flIntervalSeconds);
+	return true;
+}
+
+void CTelemetryExporter::Stop()
+{
+	m_push.Stop();
+	if (m_socket == k_unInvalidSocket)
+		return;
+	CloseSocket(m_socket);
+	m_socket = k_unInvalidSocket;
+	CleanupSockets();
+}
+
+void CTelemetryExporter::AddSource(const std::string& sName, CZedTracker* pTracker)
+{
+	std::lock_guard<std::mutex> lock(m_sourcesMutex);
+	Source_t source;
+	source.sName = sName;
+	source.pTracker = pTracker;
+	source.bHaveLast = false;
+	source.last = ZedTrackerStats_t();
+	m_vecSources.push_back(source);
+}
+
+void CTelemetryExporter::Push()
+{
+	std::lock_guard<std::mutex> lock(m_sourcesMutex);
+	m_unDatagramSize = 0;
+
+	for (Source_t& source : m_vecSources)
+		PushSource(source);
+
+	double flProcessMb;
+	if (GetProcessMemoryMb(&flProcessMb))
+		AddGauge("driver", "process_mb", flProcessMb);
+	uint64_t ulLogDropped = GetDriverLogDroppedCount();
+	AddCounter("driver", "log_dropped", ulLogDropped, m_ulLastLogDropped);
+	m_ulLastLogDropped = ulLogDropped;
+
+	Flush();
+}
+
+void CTelemetryExporter::PushSource(Source_t& source)
+{
+	ZedTrackerStats_t stats;
+	source.pTracker->GetStats(&stats);
+	const char* pchName = source.sName.c_str();
+
+	AddGauge(pchName, "grab_fps", stats.flGrabFps);
+	AddGauge(pchName, "pose_rate", stats.flPosePublishRate);
+	AddGauge(pchName, "imu_rate", stats.flImuRate);
+	AddGauge(pchName, "tracking", stats.eTrackingState == sl::POSITIONAL_TRACKING_STATE::OK ? 1.0 : 0.0);
+	AddGauge(pchName, "dead_reckoning", stats.bDeadReckoning ? 1.0 : 0.0);
+	AddGauge(pchName, "grab_divisor", stats.nGrabDivisor);
+	AddGauge(pchName, "frame_cpu_ms", stats.flFrameCpuMs);
+	AddGauge(pchName, "gpu_load", stats.flGpuLoad);
+	AddGauge(pchName, "cpu.grab", stats.flGrabCpuLoad);
+	AddGauge(pchName, "cpu.imu", stats.flImuCpuLoad);
+	AddGauge(pchName, "cpu.workers", stats.flWorkerCpuLoad);
+	AddGauge(pchName, "gpu.passthrough", stats.flPassthroughGpuLoad);
+	AddGauge(pchName, "gpu.mr_capture", stats.flMrCaptureGpuLoad);
+	AddGauge(pchName, "gpu.occlusion", stats.flOcclusionGpuLoad);
+	if (stats.flGpuTotalMb > 0.0f)
+		AddGauge(pchName, "gpu_memory_mb", stats.flGpuUsedMb);
+	if (stats.bClockFit)
+		AddGauge(pchName, "clock_drift_ppm", stats.flClockDriftPpm);
+
+	for (int i = 0; i < LatencyStage_Count; i++)
+	{
+		LatencySummary_t summary = source.pTracker->GetLatencySummary((ELatencyStage)i);
+		if (summary.ulCount == 0)
+			continue;
+		char rgchMetric[64];
+		const char* pchStage = GetLatencyStageName((ELatencyStage)i);
+		snprintf(rgchMetric, sizeof(rgchMetric), "latency.%s.p50", pchStage);
+		AddGauge(pchName, rgchMetric, summary.flP50Us);
+		snprintf(rgchMetric, sizeof(rgchMetric), "latency.%s.p95", pchStage);
+		AddGauge(pchName, rgchMetric, summary.flP95Us);
+		snprintf(rgchMetric, sizeof(rgchMetric), "latency.%s.p99", pchStage);
+		AddGauge(pchName, rgchMetric, summary.flP99Us);
+	}
+
+	// the first push only takes the totals, a counter's value is what happened since the one before
+	if (source.bHaveLast)
+	{
+		const ZedTrackerStats_t& last = source.last;
+		AddCounter(pchName, "frames_grabbed", stats.ulFramesGrabbed, last.ulFramesGrabbed);
+		AddCounter(pchName, "frames_dropped", stats.unFramesDropped, last.unFramesDropped);
+		AddCounter(pchName, "grab_failures", stats.ulGrabFailures, last.ulGrabFailures);
+		AddCounter(pchName, "grab_stalls", stats.ulGrabStalls, last.ulGrabStalls);
+		AddCounter(pchName, "tracking_losses", stats.ulTrackingLosses, last.ulTrackingLosses);
+		AddCounter(pchName, "imu_missed", stats.ulImuSamplesMissed, last.ulImuSamplesMissed);
+		AddCounter(pchName, "imu_skipped", stats.ulImuSamplesSkipped, last.ulImuSamplesSkipped);
+		AddCounter(pchName, "poses_published", stats.ulPosesPublished, last.ulPosesPublished);
+		AddCounter(pchName, "poses_deduplicated", stats.ulPosesDeduplicated, last.ulPosesDeduplicated);
+		AddCounter(pchName, "recorder_dropped", stats.ulRecorderDropped, last.ulRecorderDropped);
+	}
+	source.last = stats;
+	source.bHaveLast = true;
+}
+
+void CTelemetryExporter::AddGauge(const char* pchSource, const char* pchMetric, double flValue)
+{
+	int nLength = snprintf(m_rgchLine, sizeof(m_rgchLine), "%s.%s.%s:%.4g|g\n", m_sPrefix.c_str(), pchSource, pchMetric, flValue);
+	if (nLength > 0 && (size_t)nLength < sizeof(m_rgchLine))
+		AddLine(m_rgchLine, (size_t)nLength);
+}
+
+// a total that went down was reset, by a reopen of the camera; all of it is new then
+void CTelemetryExporter::AddCounter(const char* pchSource, const char* pchMetric, uint64_t ulTotal, uint64_t ulLast)
+{
+	uint64_t ulDelta = ulTotal >= ulLast ? ulTotal - ulLast : ulTotal;
+	int nLength = snprintf(m_rgchLine, sizeof(m_rgchLine), "%s.%s.%s:%llu|c\n", m_sPrefix.c_str(), pchSource, pchMetric, (unsigned long long)ulDelta);
+	if (nLength > 0 && (size_t)nLength < sizeof(m_rgchLine))
+		AddLine(m_rgchLine, (size_t)nLength);
+}
+
+void CTelemetryExporter::AddLine(const char* pchLine, size_t unLength)
+{
+	if (m_unDatagramSize + unLength > sizeof(m_rgchDatagram))
+		Flush();
+	memcpy(m_rgchDatagram + m_unDatagramSize, pchLine, unLength);
+	m_unDatagramSize += unLength;
+}
+
+void CTelemetryExporter::Flush()
+{
+	if (m_unDatagramSize == 0)
+		return;
+	// the collector splits on newlines, the last one is optional
+	if (SendDatagram(m_socket, m_unAddress, m_unPort, m_rgchDatagram, m_unDatagramSize - 1))
+		m_ulDatagrams++;
+	else
+		m_ulSendFailures++;
+	m_unDatagramSize = 0;
+}
@@ -0,0 +1,96 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "workerpool.h"
+#include "zedtracker.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: telemetryCollector: the stats of every camera pushed to a statsd
+// collector over UDP, for dashboards across a fleet of stations without
+// polling each one through vrcmd.
+//
+// A periodic job on the worker pool reads each camera's ZedTrackerStats_t and
+// latency percentiles and formats them as statsd lines,
+// "<prefix>.<device>.<metric>:<value>|g" for rates, loads and latencies,
+// "|c" with the increase since the last push for the running totals (frames,
+// drops, tracking losses, stalls). Lines are packed into datagrams of at
+// most k_unMaxDatagramSize, which no network on the way fragments; both
+// buffers are members, so a push allocates nothing. A datagram that can't be
+// sent is dropped and counted, statsd is lossy anyway.
+//-----------------------------------------------------------------------------
+class CTelemetryExporter
+{
+public:
+	CTelemetryExporter();
+	~CTelemetryExporter();
+
+	/** Pushes every flIntervalSeconds to sCollector, "host" or "host:port"; "{host}" in sPrefix is this
+	* machine's name. The pool must outlive Stop. False if the collector doesn't resolve. */
+	bool Start(CWorkerPool* pPool, const std::string& sCollector, const std::string& sPrefix, float flIntervalSeconds);
+
+	/** Waits for the push in flight */
+	void Stop();
+
+	bool IsRunning() const { return m_push.IsRunning(); }
+	const std::string& GetCollector() const { return m_sCollector; }
+	const std::string& GetPrefix() const { return m_sConfiguredPrefix; }
+	float GetInterval() const { return m_flIntervalSeconds; }
+
+	/** A camera whose stats go out as sName, kept across restarts; pTracker must outlive Stop */
+	void AddSource(const std::string& sName, CZedTracker* pTracker);
+
+	uint64_t GetDatagramCount() const { return m_ulDatagrams.load(); }
+	uint64_t GetSendFailures() const { return m_ulSendFailures.load(); }
+
+private:
+	CTelemetryExporter(const CTelemetryExporter&) = delete;
+	CTelemetryExporter& operator=(const CTelemetryExporter&) = delete;
+
+	static const uint16_t k_unDefaultPort = 8125;
+	static const size_t k_unMaxDatagramSize = 1400;
+	static const size_t k_unMaxLineSize = 256;
+
+	struct Source_t
+	{
+		std::string sName;
+		CZedTracker* pTracker;
+		bool bHaveLast; // last holds the totals of the push before
+		ZedTrackerStats_t last;
+	};
+
+	void Push();
+	void PushSource(Source_t& source);
+	void AddGauge(const char* pchSource, const char* pchMetric, double flValue);
+	void AddCounter(const char* pchSource, const char* pchMetric, uint64_t ulTotal, uint64_t ulLast);
+	void AddLine(const char* pchLine, size_t unLength);
+	void Flush();
+
+	CPeriodicJob m_push;
+	std::string m_sCollector;
+	std::string m_sConfiguredPrefix;
+	std::string m_sPrefix; // with the host name in
+	float m_flIntervalSeconds;
+	uintptr_t m_socket;
+	uint32_t m_unAddress; // network byte order
+	uint16_t m_unPort;
+
+	std::mutex m_sourcesMutex; // the list, and everything below while a push runs
+	std::vector<Source_t> m_vecSources;
+	char m_rgchDatagram[k_unMaxDatagramSize];
+	size_t m_unDatagramSize;
+	char m_rgchLine[k_unMaxLineSize];
+	uint64_t m_ulLastLogDropped;
+
+	std::atomic<uint64_t> m_ulDatagrams;
+	std::atomic<uint64_t> m_ulSendFailures;
+};
+
+#endif // TELEMETRY_H
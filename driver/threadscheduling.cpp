@@ -0,0 +1,118 @@
+#include "threadscheduling.h"
+#include "driverlog.h"
+#include "tracezones.h"
+
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <avrt.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+uint64_t ParseAffinityMask(const std::string& sMask)
+{
+	if (sMask.empty())
+		return 0;
+	return strtoull(sMask.c_str(), nullptr, 0);
+}
+
+CScopedThreadScheduling::CScopedThreadScheduling(const char* pchThreadName, const ZedmSettings_t& settings)
+	: m_hMmcssTask(nullptr)
+{
+	SetTraceThreadName(pchThreadName);
+	uint64_t ulAffinityMask = ParseAffinityMask(settings.sThreadAffinityMask);
+
+#if defined(_WIN32)
+	if (ulAffinityMask != 0 && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)ulAffinityMask) == 0)
+		DriverLog("%s thread: SetThreadAffinityMask(0x%llx) failed: %lu\n", pchThreadName, (unsigned long long)ulAffinityMask, GetLastError());
+
+	if (!settings.sThreadMmcssTask.empty())
+	{
+		DWORD dwTaskIndex = 0;
+		m_hMmcssTask = AvSetMmThreadCharacteristicsA(settings.sThreadMmcssTask.c_str(), &dwTaskIndex);
+		if (m_hMmcssTask)
+			AvSetMmThreadPriority(m_hMmcssTask, AVRT_PRIORITY_HIGH);
+		else
+			DriverLog("%s thread: MMCSS task \"%s\" failed: %lu\n", pchThreadName, settings.sThreadMmcssTask.c_str(), GetLastError());
+	}
+
+	if (!m_hMmcssTask && settings.nThreadPriority != 0 && !SetThreadPriority(GetCurrentThread(), settings.nThreadPriority))
+		DriverLog("%s thread: SetThreadPriority(%d) failed: %lu\n", pchThreadName, settings.nThreadPriority, GetLastError());
+#else
+	if (ulAffinityMask != 0)
+	{
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		for (int i = 0; i < 64 && i < CPU_SETSIZE; i++)
+		{
+			if (ulAffinityMask & (1ull << i))
+				CPU_SET(i, &cpuSet);
+		}
+		int nError = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+		if (nError != 0)
+			DriverLog("%s thread: pthread_setaffinity_np(0x%llx) failed: %d\n", pchThreadName, (unsigned long long)ulAffinityMask, nError);
+	}
+
+	if (settings.nThreadPriority > 0)
+	{
+		sched_param param;
+		param.sched_priority = settings.nThreadPriority;
+		int nError = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (nError != 0)
+			DriverLog("%s thread: SCHED_FIFO %d failed: %d\n", pchThreadName, settings.nThreadPriority, nError);
+	}
+#endif
+}
+
+CScopedThreadScheduling::~CScopedThreadScheduling()
+{
+#if defined(_WIN32)
+	if (m_hMmcssTask)
+		AvRevertMmThreadCharacteristics(m_hMmcssTask);
+#endif
+}
+
+#if defined(_WIN32)
+static uint64_t GetThreadCpuNanoseconds(HANDLE hThread)
+{
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (!GetThreadTimes(hThread, &creationTime, &exitTime, &kernelTime, &userTime))
+		return 0;
+
+	// FILETIME counts 100ns intervals
+	uint64_t ulKernel = ((uint64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+	uint64_t ulUser = ((uint64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+	return (ulKernel + ulUser) * 100;
+}
+#else
+static uint64_t GetThreadCpuNanoseconds(pthread_t thread)
+{
+	clockid_t clockId;
+	timespec time;
+	if (pthread_getcpuclockid(thread, &clockId) != 0 || clock_gettime(clockId, &time) != 0)
+		return 0;
+	return (uint64_t)time.tv_sec * 1000000000ull + (uint64_t)time.tv_nsec;
+}
+#endif
+
+uint64_t GetThreadCpuNanoseconds(std::thread* pThread)
+{
+#if defined(_WIN32)
+	return pThread ? GetThreadCpuNanoseconds((HANDLE)pThread->native_handle()) : 0;
+#else
+	return pThread ? GetThreadCpuNanoseconds(pThread->native_handle()) : 0;
+#endif
+}
+
+uint64_t GetCurrentThreadCpuNanoseconds()
+{
+#if defined(_WIN32)
+	return GetThreadCpuNanoseconds(GetCurrentThread());
+#else
+	return GetThreadCpuNanoseconds(pthread_self());
+#endif
+}
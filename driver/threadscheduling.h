@@ -0,0 +1,40 @@
+#ifndef THREADSCHEDULING_H
+#define THREADSCHEDULING_H
+
+#pragma once
+
+#include <stdint.h>
+
+#include <thread>
+
+#include "driversettings.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Applies the threadAffinityMask/threadPriority/threadMmcssTask
+// settings to the calling thread for its lifetime. Constructed first thing
+// on the grab and IMU threads. Failures are logged and otherwise ignored, the
+// thread just keeps its default scheduling.
+//
+// threadPriority is a Win32 THREAD_PRIORITY_* value on Windows; elsewhere a
+// positive value selects SCHED_FIFO at that priority. threadMmcssTask
+// registers the thread with the multimedia class scheduler ("Games",
+// "Pro Audio", ...), which takes precedence over threadPriority.
+//-----------------------------------------------------------------------------
+class CScopedThreadScheduling
+{
+public:
+	CScopedThreadScheduling(const char* pchThreadName, const ZedmSettings_t& settings);
+	~CScopedThreadScheduling();
+
+private:
+	void* m_hMmcssTask;
+};
+
+// parses a "0x..." or decimal CPU mask from the settings; 0 means no affinity
+extern uint64_t ParseAffinityMask(const std::string& sMask);
+
+// CPU time, user and kernel, a thread has consumed so far; 0 if unknown or not running
+extern uint64_t GetThreadCpuNanoseconds(std::thread* pThread);
+extern uint64_t GetCurrentThreadCpuNanoseconds();
+
+#endif // THREADSCHEDULING_H
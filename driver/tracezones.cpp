@@ -0,0 +1,256 @@
+#include "tracezones.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <TraceLoggingProvider.h>
+#include <winmeta.h>
+
+// {5B1C3F7A-2E4D-4A8B-9C61-3F0E8D2A7B14}
+TRACELOGGING_DEFINE_PROVIDER(g_hZedTraceProvider, "OpenVR.ZedM",
+	(0x5b1c3f7a, 0x2e4d, 0x4a8b, 0x9c, 0x61, 0x3f, 0x0e, 0x8d, 0x2a, 0x7b, 0x14));
+#else
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(ZEDM_NVTX)
+#include <nvtx3/nvToolsExt.h>
+#endif
+
+std::atomic<bool> g_bTraceZonesEnabled(false);
+
+// --------------------------------------------------------------------------
+// Purpose: The queue for the trace file, the same bounded multi-producer /
+// single-consumer scheme as the log queue: a slot is claimed with one CAS,
+// filled, and released to the writer thread by its sequence number.
+// --------------------------------------------------------------------------
+static const uint32_t k_unTraceQueueSize = 8192; // must be a power of two
+static const std::chrono::milliseconds k_TraceWriteInterval(50);
+
+struct TraceRecord_t
+{
+	std::atomic<uint32_t> unSequence;
+	const char* pchName;
+	uint32_t unThreadId;
+	bool bThreadName; // a thread_name metadata event instead of a zone
+	uint64_t ulBeginNs;
+	uint64_t ulEndNs;
+};
+
+static TraceRecord_t s_rTraceQueue[k_unTraceQueueSize];
+static std::atomic<uint32_t> s_unTraceEnqueuePos(0);
+static uint32_t s_unTraceDequeuePos = 0; // the writer's
+static std::atomic<uint64_t> s_ulTraceDropped(0);
+
+static FILE* s_pTraceFile = nullptr;
+static bool s_bTraceFirstEvent = true;
+static std::thread* s_pTraceWriteThread = nullptr;
+static std::atomic<bool> s_bTraceWriteRunning(false);
+static bool s_bTraceEtw = false;
+static bool s_bTraceNvtx = false;
+
+static std::atomic<uint32_t> s_unNextTraceThreadId(1);
+static thread_local uint32_t s_unTraceThreadId = 0;
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t GetTraceThreadId()
+{
+	if (s_unTraceThreadId == 0)
+		s_unTraceThreadId = s_unNextTraceThreadId++;
+	return s_unTraceThreadId;
+}
+
+static void PushTraceRecord(const char* pchName, bool bThreadName, uint64_t ulBeginNs, uint64_t ulEndNs)
+{
+	if (!s_bTraceWriteRunning.load(std::memory_order_relaxed))
+		return;
+
+	uint32_t unPos = s_unTraceEnqueuePos.load(std::memory_order_relaxed);
+	TraceRecord_t* pRecord;
+	for (;;)
+	{
+		pRecord = &s_rTraceQueue[unPos & (k_unTraceQueueSize - 1)];
+		int32_t nDiff = (int32_t)pRecord->unSequence.load(std::memory_order_acquire) - (int32_t)unPos;
+		if (nDiff == 0)
+		{
+			if (s_unTraceEnqueuePos.compare_exchange_weak(unPos, unPos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (nDiff < 0)
+		{
+			// the writer hasn't caught up with this slot yet
+			s_ulTraceDropped++;
+			return;
+		}
+		else
+		{
+			unPos = s_unTraceEnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	pRecord->pchName = pchName;
+	pRecord->unThreadId = GetTraceThreadId();
+	pRecord->bThreadName = bThreadName;
+	pRecord->ulBeginNs = ulBeginNs;
+	pRecord->ulEndNs = ulEndNs;
+	pRecord->unSequence.store(unPos + 1, std::memory_order_release);
+}
+
+// Appends every completed record to the file. Only called from one thread at a time.
+static void WriteTraceQueue()
+{
+	bool bWrote = false;
+	for (;;)
+	{
+		TraceRecord_t* pRecord = &s_rTraceQueue[s_unTraceDequeuePos & (k_unTraceQueueSize - 1)];
+		if (pRecord->unSequence.load(std::memory_order_acquire) != s_unTraceDequeuePos + 1)
+			break;
+
+		// "ts" and "dur" are microseconds, on the steady clock (QPC on Windows, as ETW)
+		fputs(s_bTraceFirstEvent ? "\n" : ",\n", s_pTraceFile);
+		s_bTraceFirstEvent = false;
+		if (pRecord->bThreadName)
+		{
+			fprintf(s_pTraceFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+				pRecord->unThreadId, pRecord->pchName);
+		}
+		else
+		{
+			fprintf(s_pTraceFile, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				pRecord->pchName, pRecord->unThreadId, pRecord->ulBeginNs * 1e-3, (pRecord->ulEndNs - pRecord->ulBeginNs) * 1e-3);
+		}
+		bWrote = true;
+
+		pRecord->unSequence.store(s_unTraceDequeuePos + k_unTraceQueueSize, std::memory_order_release);
+		s_unTraceDequeuePos++;
+	}
+
+	if (bWrote)
+		fflush(s_pTraceFile);
+}
+
+static void TraceWriteThread()
+{
+	while (s_bTraceWriteRunning)
+	{
+		std::this_thread::sleep_for(k_TraceWriteInterval);
+		WriteTraceQueue();
+	}
+}
+
+bool StartTraceZones(const char* pchChromeTracePath, bool bEtw, bool bNvtx)
+{
+	bool bOk = true;
+#if defined(ZEDM_NVTX)
+	s_bTraceNvtx = bNvtx;
+#else
+	bOk = !bNvtx;
+#endif
+#if defined(_WIN32)
+	if (bEtw && TraceLoggingRegister(g_hZedTraceProvider) == S_OK)
+		s_bTraceEtw = true;
+	else if (bEtw)
+		bOk = false;
+#else
+	(void)bEtw;
+#endif
+
+	if (pchChromeTracePath && *pchChromeTracePath && (s_pTraceFile = fopen(pchChromeTracePath, "w")) != nullptr)
+	{
+		fputs("[", s_pTraceFile);
+		s_bTraceFirstEvent = true;
+		for (uint32_t i = 0; i < k_unTraceQueueSize; i++)
+			s_rTraceQueue[i].unSequence.store(s_unTraceDequeuePos + i, std::memory_order_relaxed);
+		s_unTraceEnqueuePos = s_unTraceDequeuePos;
+		s_bTraceWriteRunning = true;
+		s_pTraceWriteThread = new std::thread(TraceWriteThread);
+	}
+	else if (pchChromeTracePath && *pchChromeTracePath)
+	{
+		bOk = false;
+	}
+
+	g_bTraceZonesEnabled = s_bTraceEtw || s_bTraceNvtx || s_pTraceFile != nullptr;
+	return bOk;
+}
+
+void StopTraceZones()
+{
+	g_bTraceZonesEnabled = false;
+
+	if (s_pTraceWriteThread)
+	{
+		s_bTraceWriteRunning = false;
+		s_pTraceWriteThread->join();
+		delete s_pTraceWriteThread;
+		s_pTraceWriteThread = nullptr;
+
+		// whatever was queued after the thread's last pass
+		WriteTraceQueue();
+		fputs("\n]\n", s_pTraceFile);
+		fclose(s_pTraceFile);
+		s_pTraceFile = nullptr;
+	}
+
+#if defined(_WIN32)
+	if (s_bTraceEtw)
+		TraceLoggingUnregister(g_hZedTraceProvider);
+#endif
+	s_bTraceEtw = false;
+	s_bTraceNvtx = false;
+}
+
+void SetTraceThreadName(const char* pchName)
+{
+#if defined(ZEDM_NVTX)
+	if (s_bTraceNvtx)
+	{
+#if defined(_WIN32)
+		nvtxNameOsThreadA(GetCurrentThreadId(), pchName);
+#else
+		nvtxNameOsThreadA((uint32_t)syscall(SYS_gettid), pchName);
+#endif
+	}
+#endif
+	PushTraceRecord(pchName, true, 0, 0);
+}
+
+uint64_t GetTraceZonesDropped()
+{
+	return s_ulTraceDropped.load(std::memory_order_relaxed);
+}
+
+void CTraceZone::Begin()
+{
+	m_ulBeginNs = GetSteadyNanoseconds();
+#if defined(ZEDM_NVTX)
+	if (s_bTraceNvtx)
+		nvtxRangePushA(m_pchName);
+#endif
+#if defined(_WIN32)
+	if (s_bTraceEtw && TraceLoggingProviderEnabled(g_hZedTraceProvider, 0, 0))
+		TraceLoggingWrite(g_hZedTraceProvider, "Zone", TraceLoggingOpcode(WINEVENT_OPCODE_START), TraceLoggingString(m_pchName, "Name"));
+#endif
+}
+
+void CTraceZone::End()
+{
+#if defined(ZEDM_NVTX)
+	if (s_bTraceNvtx)
+		nvtxRangePop();
+#endif
+#if defined(_WIN32)
+	if (s_bTraceEtw && TraceLoggingProviderEnabled(g_hZedTraceProvider, 0, 0))
+		TraceLoggingWrite(g_hZedTraceProvider, "Zone", TraceLoggingOpcode(WINEVENT_OPCODE_STOP), TraceLoggingString(m_pchName, "Name"));
+#endif
+	PushTraceRecord(m_pchName, false, m_ulBeginNs, GetSteadyNanoseconds());
+}
@@ -0,0 +1,76 @@
+#ifndef TRACEZONES_H
+#define TRACEZONES_H
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+// Purpose: Optional timing zones around the driver's work per pose (grab,
+// getPosition, getSensorsData, fusion, filtering, TrackedDevicePoseUpdated)
+// and the GPU work it starts (retrieves and texture copies), for lining the
+// driver's threads up against SteamVR's frame timing.
+//
+// Three outputs, all off by default: NVTX ranges, which Nsight Systems shows
+// above the CUDA work each zone queued, in builds with the NVTX headers
+// (ZEDM_NVTX); ETW events of the "OpenVR.ZedM" provider
+// on Windows, start and stop per zone, for a WPA or GPUView capture next to
+// vrserver and the compositor; and a Chrome trace JSON file for Perfetto or
+// chrome://tracing, written by a background thread from a bounded queue the
+// zones only copy into, so a zone never waits on the disk. A full queue drops
+// the zone. Zone and thread names must be string literals.
+//
+// While neither is on a zone is one relaxed load.
+//-----------------------------------------------------------------------------
+
+/** Once, at startup; pchChromeTracePath null or empty for no file. False if the file can't be created,
+* or NVTX isn't compiled in. */
+extern bool StartTraceZones(const char* pchChromeTracePath, bool bEtw, bool bNvtx = false);
+
+/** Writes what is queued and closes the file */
+extern void StopTraceZones();
+
+/** Names the calling thread in the trace file */
+extern void SetTraceThreadName(const char* pchName);
+
+/** Zones dropped because the queue was full */
+extern uint64_t GetTraceZonesDropped();
+
+extern std::atomic<bool> g_bTraceZonesEnabled;
+
+class CTraceZone
+{
+public:
+	explicit CTraceZone(const char* pchName)
+		: m_pchName(pchName)
+		, m_ulBeginNs(0)
+	{
+		if (g_bTraceZonesEnabled.load(std::memory_order_relaxed))
+			Begin();
+	}
+
+	~CTraceZone()
+	{
+		if (m_ulBeginNs != 0)
+			End();
+	}
+
+private:
+	CTraceZone(const CTraceZone&) = delete;
+	CTraceZone& operator=(const CTraceZone&) = delete;
+
+	void Begin();
+	void End();
+
+	const char* m_pchName;
+	uint64_t m_ulBeginNs;
+};
+
+#define TRACE_ZONE_CONCAT2(a, b) a##b
+#define TRACE_ZONE_CONCAT(a, b) TRACE_ZONE_CONCAT2(a, b)
+
+// a zone from here to the end of the scope
+#define TRACE_ZONE(pchName) CTraceZone TRACE_ZONE_CONCAT(traceZone_, __LINE__)(pchName)
+
+#endif // TRACEZONES_H
@@ -0,0 +1,118 @@
+#include "udpsocket.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include <string.h>
+
+bool InitSockets()
+{
+#if defined(_WIN32)
+	WSADATA wsaData;
+	return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+	return true;
+#endif
+}
+
+void CleanupSockets()
+{
+#if defined(_WIN32)
+	WSACleanup();
+#endif
+}
+
+uintptr_t OpenUdpSocket()
+{
+#if defined(_WIN32)
+	SOCKET s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	return s == INVALID_SOCKET ? k_unInvalidSocket : (uintptr_t)s;
+#else
+	int s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	return s < 0 ? k_unInvalidSocket : (uintptr_t)s;
+#endif
+}
+
+void CloseSocket(uintptr_t socket)
+{
+#if defined(_WIN32)
+	closesocket((SOCKET)socket);
+#else
+	close((int)socket);
+#endif
+}
+
+bool ResolveHost(const char* pchHost, uint32_t* punAddress)
+{
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo* pResult = nullptr;
+	if (getaddrinfo(pchHost, nullptr, &hints, &pResult) != 0 || !pResult)
+		return false;
+	*punAddress = ((const sockaddr_in*)pResult->ai_addr)->sin_addr.s_addr;
+	freeaddrinfo(pResult);
+	return true;
+}
+
+bool SendDatagram(uintptr_t socket, uint32_t unAddress, uint16_t unPort, const void* pData, size_t unSize)
+{
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(unPort);
+	address.sin_addr.s_addr = unAddress;
+#if defined(_WIN32)
+	int nSent = sendto((SOCKET)socket, (const char*)pData, (int)unSize, 0, (const sockaddr*)&address, sizeof(address));
+#else
+	ssize_t nSent = sendto((int)socket, pData, unSize, 0, (const sockaddr*)&address, sizeof(address));
+#endif
+	return nSent == (int)unSize;
+}
+
+bool BindUdpSocket(uintptr_t socket, uint16_t unPort)
+{
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(unPort);
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+#if defined(_WIN32)
+	return bind((SOCKET)socket, (const sockaddr*)&address, sizeof(address)) == 0;
+#else
+	return bind((int)socket, (const sockaddr*)&address, sizeof(address)) == 0;
+#endif
+}
+
+bool SetReceiveTimeout(uintptr_t socket, uint32_t unMilliseconds)
+{
+#if defined(_WIN32)
+	DWORD dwTimeout = unMilliseconds;
+	return setsockopt((SOCKET)socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&dwTimeout, sizeof(dwTimeout)) == 0;
+#else
+	timeval timeout;
+	timeout.tv_sec = unMilliseconds / 1000;
+	timeout.tv_usec = (unMilliseconds % 1000) * 1000;
+	return setsockopt((int)socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0;
+#endif
+}
+
+int ReceiveDatagram(uintptr_t socket, void* pBuffer, size_t unSize)
+{
+#if defined(_WIN32)
+	return recvfrom((SOCKET)socket, (char*)pBuffer, (int)unSize, 0, nullptr, nullptr);
+#else
+	return (int)recvfrom((int)socket, pBuffer, unSize, 0, nullptr, nullptr);
+#endif
+}
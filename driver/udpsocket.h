@@ -0,0 +1,38 @@
+#ifndef UDPSOCKET_H
+#define UDPSOCKET_H
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Purpose: Thin IPv4 UDP socket wrappers shared by the pose stream and the
+// telemetry sender. Sockets are carried as uintptr_t so the headers of their
+// users stay free of winsock2.h; addresses are in network byte order. Every
+// successful InitSockets is paired with one CleanupSockets.
+//-----------------------------------------------------------------------------
+
+// INVALID_SOCKET on Windows, -1 cast the same way elsewhere
+static const uintptr_t k_unInvalidSocket = ~(uintptr_t)0;
+
+extern bool InitSockets();
+extern void CleanupSockets();
+
+// k_unInvalidSocket if the socket couldn't be created
+extern uintptr_t OpenUdpSocket();
+extern void CloseSocket(uintptr_t socket);
+
+// first IPv4 address of a host name or dotted quad
+extern bool ResolveHost(const char* pchHost, uint32_t* punAddress);
+
+extern bool SendDatagram(uintptr_t socket, uint32_t unAddress, uint16_t unPort, const void* pData, size_t unSize);
+
+// binds to the port on all interfaces
+extern bool BindUdpSocket(uintptr_t socket, uint16_t unPort);
+extern bool SetReceiveTimeout(uintptr_t socket, uint32_t unMilliseconds);
+
+// size of the received datagram, 0 or less on timeout or error
+extern int ReceiveDatagram(uintptr_t socket, void* pBuffer, size_t unSize);
+
+#endif // UDPSOCKET_H
@@ -0,0 +1,82 @@
+#ifndef VSYNCSCHEDULER_H
+#define VSYNCSCHEDULER_H
+
+#pragma once
+
+#include <cstdint>
+
+#include "seqlock.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Predicts the compositor's vsyncs from its frame timings and picks
+// the moments the IMU publisher submits at, vsyncPublishLead before each one,
+// so the pose the compositor samples for a frame is the freshest there is
+// rather than whichever the IMU happened to deliver last.
+//
+// The provider's RunFrame feeds the latest vsync time and the display's frame
+// period; the IMU publisher asks for submission times. All times are on the
+// steady clock, which is what Compositor_FrameTiming::m_flSystemTimeInSeconds
+// counts on Windows (QueryPerformanceCounter).
+//-----------------------------------------------------------------------------
+class CVsyncScheduler
+{
+public:
+	CVsyncScheduler()
+	{
+		Timing_t timing = {};
+		m_timing.Write(timing);
+	}
+
+	/** Provider thread; a vsync on another time base than the steady clock is ignored */
+	void SetVsync(uint64_t ulVsyncNs, double flFrameSeconds, uint64_t ulNowNs)
+	{
+		if (flFrameSeconds <= 0.0 || flFrameSeconds > 0.1)
+			return;
+		int64_t nAgeNs = (int64_t)(ulNowNs - ulVsyncNs);
+		if (nAgeNs < -(int64_t)k_ulMaxVsyncAgeNs || nAgeNs > (int64_t)k_ulMaxVsyncAgeNs)
+			return;
+
+		Timing_t timing;
+		timing.ulVsyncNs = ulVsyncNs;
+		timing.ulPeriodNs = (uint64_t)(flFrameSeconds * 1e9);
+		timing.ulUpdatedNs = ulNowNs;
+		m_timing.Write(timing);
+	}
+
+	/** The first submission time, ulLeadNs before a vsync, after ulAfterNs. False while
+	* there is no recent frame timing, e.g. with the compositor not rendering. */
+	bool GetSubmitTime(uint64_t ulAfterNs, uint64_t ulLeadNs, uint64_t* pulSubmitNs) const
+	{
+		Timing_t timing;
+		m_timing.Read(&timing);
+		if (timing.ulPeriodNs == 0 || (int64_t)(ulAfterNs - timing.ulUpdatedNs) > (int64_t)k_ulMaxVsyncAgeNs)
+			return false;
+
+		// the lead is at most a frame, vsyncs repeat every period from the last one seen
+		ulLeadNs = ulLeadNs < timing.ulPeriodNs ? ulLeadNs : timing.ulPeriodNs;
+		uint64_t ulFirstNs = timing.ulVsyncNs - ulLeadNs;
+		if (ulAfterNs < ulFirstNs)
+		{
+			*pulSubmitNs = ulFirstNs;
+			return true;
+		}
+		uint64_t ulPeriods = (ulAfterNs - ulFirstNs) / timing.ulPeriodNs + 1;
+		*pulSubmitNs = ulFirstNs + ulPeriods * timing.ulPeriodNs;
+		return true;
+	}
+
+private:
+	struct Timing_t
+	{
+		uint64_t ulVsyncNs;
+		uint64_t ulPeriodNs;
+		uint64_t ulUpdatedNs;
+	};
+
+	// RunFrame comes every frame; without an update for this long the prediction is stale
+	static const uint64_t k_ulMaxVsyncAgeNs = 1000000000ull;
+
+	CSeqLock<Timing_t> m_timing;
+};
+
+#endif // VSYNCSCHEDULER_H
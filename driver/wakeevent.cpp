@@ -0,0 +1,77 @@
+#include "wakeevent.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+
+// the kernel waits on the atomic's storage as a plain 32-bit word
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "CWakeEvent needs a plain 32-bit atomic");
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CWakeEvent::CWakeEvent()
+	: m_unGeneration(0)
+	, m_unWaiters(0)
+{
+}
+
+bool CWakeEvent::Wait(uint32_t unGeneration, uint64_t ulDeadlineNs)
+{
+	// counted before the generation is compared, so a Notify either sees the
+	// waiter or has already moved the generation on
+	m_unWaiters.fetch_add(1, std::memory_order_seq_cst);
+
+	bool bNotified = true;
+	while (m_unGeneration.load(std::memory_order_seq_cst) == unGeneration)
+	{
+		uint64_t ulNowNs = ulDeadlineNs != 0 ? GetSteadyNanoseconds() : 0;
+		if (ulDeadlineNs != 0 && ulNowNs >= ulDeadlineNs)
+		{
+			bNotified = false;
+			break;
+		}
+
+		// returns at once if the generation moved on in the meantime; spurious
+		// and interrupted wake-ups go round the loop
+#if defined(_WIN32)
+		DWORD dwMilliseconds = INFINITE;
+		if (ulDeadlineNs != 0)
+			dwMilliseconds = (DWORD)((ulDeadlineNs - ulNowNs + 999999) / 1000000);
+		WaitOnAddress(&m_unGeneration, &unGeneration, sizeof(unGeneration), dwMilliseconds);
+#else
+		// FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC deadline, the steady clock's
+		timespec deadline;
+		deadline.tv_sec = (time_t)(ulDeadlineNs / 1000000000);
+		deadline.tv_nsec = (long)(ulDeadlineNs % 1000000000);
+		syscall(SYS_futex, &m_unGeneration, FUTEX_WAIT_BITSET_PRIVATE, unGeneration,
+			ulDeadlineNs != 0 ? &deadline : nullptr, nullptr, FUTEX_BITSET_MATCH_ANY);
+#endif
+	}
+
+	m_unWaiters.fetch_sub(1, std::memory_order_relaxed);
+	return bNotified;
+}
+
+void CWakeEvent::Notify()
+{
+	m_unGeneration.fetch_add(1, std::memory_order_seq_cst);
+	if (m_unWaiters.load(std::memory_order_seq_cst) == 0)
+		return;
+
+#if defined(_WIN32)
+	WakeByAddressAll(&m_unGeneration);
+#else
+	syscall(SYS_futex, &m_unGeneration, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
@@ -0,0 +1,44 @@
+#ifndef WAKEEVENT_H
+#define WAKEEVENT_H
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+// Purpose: Wakes the threads that wait for a lock-free structure to change,
+// e.g. a ring's readers when a sample lands, without a mutex on the writer's
+// side. Waiters sleep in the kernel on a 32-bit generation count, WaitOnAddress
+// on Windows and a private futex on Linux, so an idle stage costs no CPU and
+// a Notify wakes it in a few microseconds rather than at its next poll.
+//
+// To wait, read the generation with GetGeneration, check for the work, and
+// only then Wait with that generation: a Notify that comes after the read,
+// even before Wait is entered, ends the wait at once. Notify is one atomic
+// add while nobody waits.
+//-----------------------------------------------------------------------------
+class CWakeEvent
+{
+public:
+	CWakeEvent();
+
+	uint32_t GetGeneration() const { return m_unGeneration.load(std::memory_order_seq_cst); }
+
+	/** Sleeps until Notify is called after unGeneration was read, or until ulDeadlineNs
+	* on the steady clock, 0 for none. Returns false when the deadline passed first.
+	* On Windows timeouts have the resolution of the system timer. */
+	bool Wait(uint32_t unGeneration, uint64_t ulDeadlineNs = 0);
+
+	/** Wakes all waiters; any thread */
+	void Notify();
+
+private:
+	CWakeEvent(const CWakeEvent&) = delete;
+	CWakeEvent& operator=(const CWakeEvent&) = delete;
+
+	std::atomic<uint32_t> m_unGeneration; // the address the waiters sleep on
+	std::atomic<uint32_t> m_unWaiters;
+};
+
+#endif // WAKEEVENT_H
@@ -0,0 +1,295 @@
+#include "workerpool.h"
+#include "driverlog.h"
+#include "threadscheduling.h"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+// the pool and index of the worker running on this thread, for Submit from a job
+static thread_local const CWorkerPool* s_pCurrentPool = nullptr;
+static thread_local uint32_t s_unCurrentWorker = 0;
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CWorkerPool::CWorkerPool()
+	: m_unNextQueue(0)
+	, m_unQueued(0)
+	, m_ulNextTimer(1)
+	, m_bStop(false)
+{
+}
+
+CWorkerPool::~CWorkerPool()
+{
+	Stop();
+}
+
+void CWorkerPool::Start(uint32_t unWorkers)
+{
+	Stop();
+
+	// a quarter of the cores: the grab, IMU and compositor threads come first
+	if (unWorkers == 0)
+		unWorkers = std::min(std::max(std::thread::hardware_concurrency() / 4, 1u), 4u);
+
+	m_bStop = false;
+	for (uint32_t i = 0; i < unWorkers; i++)
+		m_vecQueues.push_back(new Queue_t());
+	for (uint32_t i = 0; i < unWorkers; i++)
+		m_vecWorkers.push_back(new std::thread(&CWorkerPool::RunWorker, this, i));
+
+	DriverLog("Worker pool with %u thread(s)\n", unWorkers);
+}
+
+void CWorkerPool::Stop()
+{
+	if (m_vecWorkers.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_bStop = true;
+	}
+	m_wake.notify_all();
+	for (std::thread* pWorker : m_vecWorkers)
+	{
+		pWorker->join();
+		delete pWorker;
+	}
+	m_vecWorkers.clear();
+
+	for (Queue_t* pQueue : m_vecQueues)
+		delete pQueue;
+	m_vecQueues.clear();
+	m_vecTimers.clear();
+	m_unQueued = 0;
+}
+
+uint64_t CWorkerPool::GetCpuNanoseconds() const
+{
+	uint64_t ulCpuNs = 0;
+	for (std::thread* pWorker : m_vecWorkers)
+		ulCpuNs += GetThreadCpuNanoseconds(pWorker);
+	return ulCpuNs;
+}
+
+void CWorkerPool::Submit(EWorkPriority ePriority, Job_t job)
+{
+	if (m_vecQueues.empty())
+		return;
+
+	uint32_t unQueue = s_pCurrentPool == this ? s_unCurrentWorker : m_unNextQueue++ % (uint32_t)m_vecQueues.size();
+	Push(unQueue, ePriority, std::move(job));
+
+	// under the mutex, so a worker between its last look and its wait sees it
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+	}
+	m_wake.notify_one();
+}
+
+uint64_t CWorkerPool::SubmitAfter(EWorkPriority ePriority, uint64_t ulDelayNs, Job_t job)
+{
+	if (m_vecQueues.empty())
+		return 0;
+
+	Timer_t timer;
+	timer.ulDueNs = GetSteadyNanoseconds() + ulDelayNs;
+	timer.ePriority = ePriority;
+	timer.job = std::move(job);
+	uint64_t ulTimer;
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		timer.ulTimer = ulTimer = m_ulNextTimer++;
+		m_vecTimers.push_back(std::move(timer));
+		std::push_heap(m_vecTimers.begin(), m_vecTimers.end(), &CWorkerPool::IsLater);
+	}
+	// one sleeping worker has to wait for a new earliest timer
+	m_wake.notify_one();
+	return ulTimer;
+}
+
+bool CWorkerPool::CancelTimer(uint64_t ulTimer)
+{
+	std::lock_guard<std::mutex> lock(m_wakeMutex);
+	for (size_t i = 0; i < m_vecTimers.size(); i++)
+	{
+		if (m_vecTimers[i].ulTimer != ulTimer)
+			continue;
+		m_vecTimers.erase(m_vecTimers.begin() + i);
+		std::make_heap(m_vecTimers.begin(), m_vecTimers.end(), &CWorkerPool::IsLater);
+		return true;
+	}
+	return false;
+}
+
+void CWorkerPool::Push(uint32_t unQueue, EWorkPriority ePriority, Job_t job)
+{
+	Queue_t* pQueue = m_vecQueues[unQueue];
+	{
+		std::lock_guard<std::mutex> lock(pQueue->mutex);
+		pQueue->rgJobs[ePriority].push_back(std::move(job));
+	}
+	m_unQueued++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Moves the timers that are due onto the queues, with m_wakeMutex
+// held. Returns when the next one is due, 0 if there is none.
+//-----------------------------------------------------------------------------
+uint64_t CWorkerPool::ReleaseDueTimers(uint64_t ulNowNs)
+{
+	while (!m_vecTimers.empty() && m_vecTimers.front().ulDueNs <= ulNowNs)
+	{
+		std::pop_heap(m_vecTimers.begin(), m_vecTimers.end(), &CWorkerPool::IsLater);
+		Timer_t& timer = m_vecTimers.back();
+		Push(m_unNextQueue++ % (uint32_t)m_vecQueues.size(), timer.ePriority, std::move(timer.job));
+		m_vecTimers.pop_back();
+	}
+	return m_vecTimers.empty() ? 0 : m_vecTimers.front().ulDueNs;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Highest priority first: the front of the worker's own queue, else
+// the back of another's, starting with the worker's neighbour.
+//-----------------------------------------------------------------------------
+bool CWorkerPool::TakeJob(uint32_t unWorker, Job_t* pJob)
+{
+	if (m_unQueued.load() == 0)
+		return false;
+
+	uint32_t unQueues = (uint32_t)m_vecQueues.size();
+	for (int nPriority = 0; nPriority < WorkPriority_Count; nPriority++)
+	{
+		for (uint32_t i = 0; i < unQueues; i++)
+		{
+			Queue_t* pQueue = m_vecQueues[(unWorker + i) % unQueues];
+			std::lock_guard<std::mutex> lock(pQueue->mutex);
+			std::deque<Job_t>& jobs = pQueue->rgJobs[nPriority];
+			if (jobs.empty())
+				continue;
+			if (i == 0)
+			{
+				*pJob = std::move(jobs.front());
+				jobs.pop_front();
+			}
+			else
+			{
+				*pJob = std::move(jobs.back());
+				jobs.pop_back();
+			}
+			m_unQueued--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void CWorkerPool::RunWorker(uint32_t unWorker)
+{
+	s_pCurrentPool = this;
+	s_unCurrentWorker = unWorker;
+#if defined(_WIN32)
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+
+	for (;;)
+	{
+		Job_t job;
+		if (TakeJob(unWorker, &job))
+		{
+			job();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		if (m_bStop)
+			break;
+		uint64_t ulNextDueNs = ReleaseDueTimers(GetSteadyNanoseconds());
+		if (m_unQueued.load() != 0)
+			continue;
+		if (ulNextDueNs != 0)
+			m_wake.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::nanoseconds(ulNextDueNs)));
+		else
+			m_wake.wait(lock);
+	}
+}
+
+CPeriodicJob::CPeriodicJob()
+	: m_pPool(nullptr)
+	, m_ePriority(WorkPriority_Normal)
+	, m_ulIntervalNs(0)
+	, m_bStop(false)
+	, m_bScheduled(false)
+	, m_ulTimer(0)
+{
+}
+
+CPeriodicJob::~CPeriodicJob()
+{
+	Stop();
+}
+
+void CPeriodicJob::Start(CWorkerPool* pPool, EWorkPriority ePriority, uint64_t ulIntervalNs, CWorkerPool::Job_t job)
+{
+	Stop();
+
+	m_pPool = pPool;
+	m_ePriority = ePriority;
+	m_ulIntervalNs = ulIntervalNs;
+	m_job = std::move(job);
+
+	// the first run may come before SubmitAfter returns with a short interval
+	std::lock_guard<std::mutex> lock(m_stopMutex);
+	m_bStop = false;
+	m_bScheduled = true;
+	m_ulTimer = m_pPool->SubmitAfter(m_ePriority, m_ulIntervalNs, [this] { Run(); });
+}
+
+void CPeriodicJob::Stop()
+{
+	if (!m_pPool)
+		return;
+
+	// a run still waiting for its time never starts, one queued or running sees the flag
+	{
+		std::unique_lock<std::mutex> lock(m_stopMutex);
+		m_bStop = true;
+		if (m_bScheduled && m_pPool->CancelTimer(m_ulTimer))
+			m_bScheduled = false;
+		m_stopped.wait(lock, [this] { return !m_bScheduled; });
+	}
+	m_pPool = nullptr;
+	m_job = nullptr;
+}
+
+void CPeriodicJob::Run()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_stopMutex);
+		if (m_bStop)
+		{
+			m_bScheduled = false;
+			m_stopped.notify_all();
+			return;
+		}
+	}
+
+	m_job();
+
+	std::lock_guard<std::mutex> lock(m_stopMutex);
+	if (m_bStop)
+	{
+		m_bScheduled = false;
+		m_stopped.notify_all();
+		return;
+	}
+	m_ulTimer = m_pPool->SubmitAfter(m_ePriority, m_ulIntervalNs, [this] { Run(); });
+}
@@ -0,0 +1,146 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Purpose: Classes of background work, served in this order
+//-----------------------------------------------------------------------------
+enum EWorkPriority
+{
+	WorkPriority_High,   // someone waits for the result, e.g. a device coming up
+	WorkPriority_Normal, // periodic upkeep, e.g. calibration
+	WorkPriority_Low,    // bulk work and I/O, e.g. meshes and files
+
+	WorkPriority_Count
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Driver-wide pool for background jobs, owned by CServerDriver_Zedm,
+// so they share a few threads below normal priority instead of each keeping a
+// thread that competes with the grab, IMU and compositor threads.
+//
+// Every worker has a queue per priority. A job submitted from a worker goes
+// to its own queue, others are spread round robin. A worker takes the front
+// of its own queue and, when that is empty, steals from the back of the
+// others', always the highest priority there is first. Delayed jobs wait in
+// one timer queue until they are due.
+//
+// Jobs must not block for long; whatever waits on hardware keeps its own
+// thread. Their owners have to stop submitting, and wait for the jobs in
+// flight, before the pool stops; delayed jobs not yet due are dropped then.
+//-----------------------------------------------------------------------------
+class CWorkerPool
+{
+public:
+	typedef std::function<void()> Job_t;
+
+	CWorkerPool();
+	~CWorkerPool();
+
+	/** unWorkers 0 picks a count from the number of cores */
+	void Start(uint32_t unWorkers);
+
+	/** Finishes the queued jobs and drops the delayed ones */
+	void Stop();
+
+	/** Any thread, also a job */
+	void Submit(EWorkPriority ePriority, Job_t job);
+
+	/** Submits the job ulDelayNs from now; returns the timer for CancelTimer */
+	uint64_t SubmitAfter(EWorkPriority ePriority, uint64_t ulDelayNs, Job_t job);
+
+	/** Drops a delayed job that is not due yet; false if it already went to a queue */
+	bool CancelTimer(uint64_t ulTimer);
+
+	uint32_t GetWorkerCount() const { return (uint32_t)m_vecWorkers.size(); }
+
+	/** CPU time of all workers so far; from a job or the thread that started the pool */
+	uint64_t GetCpuNanoseconds() const;
+
+private:
+	CWorkerPool(const CWorkerPool&) = delete;
+	CWorkerPool& operator=(const CWorkerPool&) = delete;
+
+	struct Queue_t
+	{
+		std::mutex mutex;
+		std::deque<Job_t> rgJobs[WorkPriority_Count];
+	};
+
+	struct Timer_t
+	{
+		uint64_t ulTimer;
+		uint64_t ulDueNs;
+		EWorkPriority ePriority;
+		Job_t job;
+	};
+
+	static bool IsLater(const Timer_t& a, const Timer_t& b) { return a.ulDueNs > b.ulDueNs; }
+
+	void RunWorker(uint32_t unWorker);
+	bool TakeJob(uint32_t unWorker, Job_t* pJob);
+	void Push(uint32_t unQueue, EWorkPriority ePriority, Job_t job);
+	uint64_t ReleaseDueTimers(uint64_t ulNowNs);
+
+	std::vector<std::thread*> m_vecWorkers;
+	std::vector<Queue_t*> m_vecQueues;
+	std::atomic<uint32_t> m_unNextQueue;
+	std::atomic<uint32_t> m_unQueued;
+
+	// the timers and m_bStop; checked by a worker before it sleeps
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;
+	std::vector<Timer_t> m_vecTimers; // heap, earliest first
+	uint64_t m_ulNextTimer;
+	bool m_bStop;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: A job that runs every interval on a CWorkerPool until stopped, one
+// run at a time. The interval counts from the end of one run to the start of
+// the next.
+//-----------------------------------------------------------------------------
+class CPeriodicJob
+{
+public:
+	CPeriodicJob();
+	~CPeriodicJob();
+
+	/** The first run is one interval from now; the pool must outlive Stop */
+	void Start(CWorkerPool* pPool, EWorkPriority ePriority, uint64_t ulIntervalNs, CWorkerPool::Job_t job);
+
+	/** Cancels the next run, or waits for the one in flight; there is none afterwards */
+	void Stop();
+
+	bool IsRunning() const { return m_pPool != nullptr; }
+
+private:
+	CPeriodicJob(const CPeriodicJob&) = delete;
+	CPeriodicJob& operator=(const CPeriodicJob&) = delete;
+
+	void Run();
+
+	CWorkerPool* m_pPool;
+	EWorkPriority m_ePriority;
+	uint64_t m_ulIntervalNs;
+	CWorkerPool::Job_t m_job;
+
+	// a run is waiting, queued or running until Stop cancels its timer or it sees m_bStop
+	std::mutex m_stopMutex;
+	std::condition_variable m_stopped;
+	bool m_bStop;
+	bool m_bScheduled;
+	uint64_t m_ulTimer; // of the next run
+};
+
+#endif // WORKERPOOL_H
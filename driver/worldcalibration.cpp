@@ -0,0 +1,233 @@
+#include "worldcalibration.h"
+#include "driverlog.h"
+#include "hmdmath.h"
+#include "zedtracker.h"
+
+#include <chrono>
+#include <cmath>
+
+using namespace vr;
+
+static const double k_flRadiansToDegrees = 180.0 / 3.14159265358979323846;
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CWorldCalibrator::CWorldCalibrator()
+	: m_pTracker(nullptr)
+	, m_unDevice(k_unTrackedDeviceIndexInvalid)
+	, m_ulNextSolveNs(0)
+	, m_bNewPairs(false)
+	, m_unCount(0)
+	, m_unNext(0)
+{
+	m_published = {};
+	m_solution.Write(m_published);
+}
+
+CWorldCalibrator::~CWorldCalibrator()
+{
+	Stop();
+}
+
+void CWorldCalibrator::Start(CWorkerPool* pPool, CZedTracker* pTracker, const std::string& sDeviceSerial)
+{
+	Stop();
+
+	m_pTracker = pTracker;
+	m_sDeviceSerial = sDeviceSerial;
+	m_unDevice = k_unTrackedDeviceIndexInvalid;
+	m_ulNextSolveNs = GetSteadyNanoseconds() + k_ulSolveIntervalNs;
+	m_bNewPairs = false;
+	m_unCount = 0;
+	m_unNext = 0;
+	m_tick.Start(pPool, WorkPriority_Normal, (uint64_t)(1e9 / k_flSampleRate), [this] { Tick(); });
+	DriverLog("World calibration against %s\n", m_sDeviceSerial.c_str());
+}
+
+void CWorldCalibrator::Stop()
+{
+	m_tick.Stop();
+	m_pTracker = nullptr;
+}
+
+bool CWorldCalibrator::TakeSolution(uint32_t unSinceSolution, WorldCalibration_t* pSolution) const
+{
+	m_solution.Read(pSolution);
+	return pSolution->unSolution != 0 && pSolution->unSolution != unSinceSolution;
+}
+
+void CWorldCalibrator::Tick()
+{
+	// device indices are never reused, so one found stays valid; the
+	// device may just not have been added yet when calibration started
+	if (m_unDevice == k_unTrackedDeviceIndexInvalid && !FindDevice(&m_unDevice))
+		m_unDevice = k_unTrackedDeviceIndexInvalid;
+
+	Pair_t pair;
+	if (m_unDevice != k_unTrackedDeviceIndexInvalid && Sample(m_unDevice, &pair) && AddPair(pair))
+		m_bNewPairs = true;
+
+	// nothing new to solve with while the rig stands still
+	uint64_t ulNowNs = GetSteadyNanoseconds();
+	if (ulNowNs >= m_ulNextSolveNs)
+	{
+		m_ulNextSolveNs = ulNowNs + k_ulSolveIntervalNs;
+		if (m_unCount >= k_unMinPairs && m_bNewPairs)
+		{
+			m_bNewPairs = false;
+			Solve();
+		}
+	}
+}
+
+bool CWorldCalibrator::FindDevice(vr::TrackedDeviceIndex_t* punDevice) const
+{
+	char rchSerial[k_unMaxPropertyStringSize];
+	for (TrackedDeviceIndex_t i = 0; i < k_unMaxTrackedDeviceCount; i++)
+	{
+		PropertyContainerHandle_t ulContainer = VRProperties()->TrackedDeviceToPropertyContainer(i);
+		if (ulContainer == k_ulInvalidPropertyContainer)
+			continue;
+		ETrackedPropertyError eError = TrackedProp_Success;
+		VRProperties()->GetStringProperty(ulContainer, Prop_SerialNumber_String, rchSerial, sizeof(rchSerial), &eError);
+		if (eError == TrackedProp_Success && m_sDeviceSerial == rchSerial)
+		{
+			*punDevice = i;
+			DriverLog("World calibration device %s is device %u\n", rchSerial, i);
+			return true;
+		}
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Both poses at the current time. The camera's is interpolated in its
+// pose history, the other device's comes predicted to now by its driver.
+//-----------------------------------------------------------------------------
+bool CWorldCalibrator::Sample(vr::TrackedDeviceIndex_t unDevice, Pair_t* pPair) const
+{
+	TrackedDevicePose_t rgDevicePoses[k_unMaxTrackedDeviceCount];
+	VRServerDriverHost()->GetRawTrackedDevicePoses(0.0f, rgDevicePoses, unDevice + 1);
+	const TrackedDevicePose_t& devicePose = rgDevicePoses[unDevice];
+	if (!devicePose.bDeviceIsConnected || !devicePose.bPoseIsValid || devicePose.eTrackingResult != TrackingResult_Running_OK)
+		return false;
+
+	DriverPose_t pose;
+	if (!m_pTracker->GetPoseAt(m_pTracker->GetCameraTimeNs(), &pose) || !pose.poseIsValid || pose.result != TrackingResult_Running_OK)
+		return false;
+
+	const HmdVector3_t& velocity = devicePose.vVelocity;
+	double flDeviceSpeed = sqrt(velocity.v[0] * velocity.v[0] + velocity.v[1] * velocity.v[1] + velocity.v[2] * velocity.v[2]);
+	double flCameraSpeed = sqrt(pose.vecVelocity[0] * pose.vecVelocity[0] + pose.vecVelocity[1] * pose.vecVelocity[1] + pose.vecVelocity[2] * pose.vecVelocity[2]);
+	if (flDeviceSpeed > k_flMaxSpeed || flCameraSpeed > k_flMaxSpeed)
+		return false;
+
+	double vecHead[3];
+	HmdQuaternion_RotateVector(pose.qRotation, pose.vecDriverFromHeadTranslation, vecHead);
+	for (int i = 0; i < 3; i++)
+	{
+		pPair->vecDriver[i] = pose.vecPosition[i] + vecHead[i];
+		pPair->vecWorld[i] = devicePose.mDeviceToAbsoluteTracking.m[i][3];
+	}
+	return true;
+}
+
+bool CWorldCalibrator::AddPair(const Pair_t& pair)
+{
+	if (m_unCount > 0)
+	{
+		const Pair_t& last = m_rgPairs[(m_unNext + k_unWindow - 1) % k_unWindow];
+		double flDistanceSquared = 0.0;
+		for (int i = 0; i < 3; i++)
+			flDistanceSquared += (pair.vecWorld[i] - last.vecWorld[i]) * (pair.vecWorld[i] - last.vecWorld[i]);
+		if (flDistanceSquared < k_flMinPairDistance * k_flMinPairDistance)
+			return false;
+	}
+
+	m_rgPairs[m_unNext] = pair;
+	m_unNext = (m_unNext + 1) % k_unWindow;
+	if (m_unCount < k_unWindow)
+		m_unCount++;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: world = R_y(yaw) * driver + offset in the least squares sense. With
+// both point sets centered, the yaw maximizing sum(world . R * driver) is
+// atan2 of the summed horizontal cross and dot products; the offset maps the
+// driver centroid onto the world centroid.
+//-----------------------------------------------------------------------------
+void CWorldCalibrator::Solve()
+{
+	double vecDriverMean[3] = { 0.0, 0.0, 0.0 };
+	double vecWorldMean[3] = { 0.0, 0.0, 0.0 };
+	for (uint32_t n = 0; n < m_unCount; n++)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			vecDriverMean[i] += m_rgPairs[n].vecDriver[i] / m_unCount;
+			vecWorldMean[i] += m_rgPairs[n].vecWorld[i] / m_unCount;
+		}
+	}
+
+	double flDot = 0.0, flCross = 0.0, flSpread = 0.0;
+	for (uint32_t n = 0; n < m_unCount; n++)
+	{
+		double px = m_rgPairs[n].vecDriver[0] - vecDriverMean[0], pz = m_rgPairs[n].vecDriver[2] - vecDriverMean[2];
+		double qx = m_rgPairs[n].vecWorld[0] - vecWorldMean[0], qz = m_rgPairs[n].vecWorld[2] - vecWorldMean[2];
+		flDot += qx * px + qz * pz;
+		flCross += qx * pz - qz * px;
+		flSpread += px * px + pz * pz;
+	}
+	// over a small area a little noise is a lot of yaw
+	if (sqrt(flSpread / m_unCount) < k_flMinSpread)
+		return;
+
+	double flYaw = atan2(flCross, flDot);
+	HmdQuaternion_t qRotation = HmdQuaternion_FromYawPitchRoll(flYaw, 0.0, 0.0);
+
+	WorldCalibration_t solution;
+	double vecRotatedMean[3];
+	HmdQuaternion_RotateVector(qRotation, vecDriverMean, vecRotatedMean);
+	for (int i = 0; i < 3; i++)
+		solution.vecOffset[i] = vecWorldMean[i] - vecRotatedMean[i];
+	solution.flYaw = flYaw * k_flRadiansToDegrees;
+	solution.unPairs = m_unCount;
+
+	double flResidual = 0.0;
+	for (uint32_t n = 0; n < m_unCount; n++)
+	{
+		double vecMapped[3];
+		HmdQuaternion_RotateVector(qRotation, m_rgPairs[n].vecDriver, vecMapped);
+		for (int i = 0; i < 3; i++)
+		{
+			double flError = vecMapped[i] + solution.vecOffset[i] - m_rgPairs[n].vecWorld[i];
+			flResidual += flError * flError;
+		}
+	}
+	solution.flResidual = sqrt(flResidual / m_unCount);
+	if (solution.flResidual > k_flMaxResidual)
+	{
+		DriverLogTrace("World calibration rejected, residual %.3f m over %u pairs\n", solution.flResidual, m_unCount);
+		return;
+	}
+
+	if (m_published.unSolution != 0)
+	{
+		double flYawChange = fabs(remainder(solution.flYaw - m_published.flYaw, 360.0));
+		double flOffsetChangeSquared = 0.0;
+		for (int i = 0; i < 3; i++)
+			flOffsetChangeSquared += (solution.vecOffset[i] - m_published.vecOffset[i]) * (solution.vecOffset[i] - m_published.vecOffset[i]);
+		if (flYawChange < k_flMinYawChange && flOffsetChangeSquared < k_flMinOffsetChange * k_flMinOffsetChange)
+			return;
+	}
+
+	solution.unSolution = m_published.unSolution + 1;
+	m_published = solution;
+	m_solution.Write(solution);
+	DriverLog("World calibration: offset %.3f %.3f %.3f m, yaw %.2f deg, residual %.3f m over %u pairs\n",
+		solution.vecOffset[0], solution.vecOffset[1], solution.vecOffset[2], solution.flYaw, solution.flResidual, solution.unPairs);
+}
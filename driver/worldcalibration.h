@@ -0,0 +1,117 @@
+#ifndef WORLDCALIBRATION_H
+#define WORLDCALIBRATION_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <cstdint>
+#include <string>
+
+#include "seqlock.h"
+#include "workerpool.h"
+
+class CZedTracker;
+
+//-----------------------------------------------------------------------------
+// Purpose: World-from-driver transform solved by CWorldCalibrator, in the
+// units of the worldOffset / worldYaw settings.
+//-----------------------------------------------------------------------------
+struct WorldCalibration_t
+{
+	uint32_t unSolution; // 0 until the first solution, then counts up
+	double vecOffset[3]; // meters
+	double flYaw; // degrees
+	double flResidual; // RMS of the pairs in the window after the fit, meters
+	uint32_t unPairs;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Online calibration against another tracked device, e.g. a
+// lighthouse tracker mounted on the camera rig, so the ZED's world lines up
+// with the SteamVR universe without recording pose pairs by hand.
+//
+// A periodic job on the worker pool samples both devices at k_flSampleRate:
+// the other device's raw pose from the driver host and the camera's tracked
+// point (the head calibration applied to its driver-space pose) from the
+// pose history, both at the current time. The head calibration is expected
+// to put the tracked point at the other device's origin. Pairs are only kept
+// once the rig moved k_flMinPairDistance since the last one and while it
+// isn't moving fast, so a still rig doesn't flood the window with one point
+// and a few milliseconds of latency between the two don't become error.
+//
+// Both spaces are gravity aligned, the ZED's by its IMU and the universe by
+// room setup, so the transform is a yaw and a translation, which is all the
+// world settings can hold anyway. The least squares yaw has a closed form,
+// the 2D case of Kabsch, and is solved about once a second over the last
+// k_unWindow pairs. A solution is only published when the pairs spread wide
+// enough to fix the yaw, fit within k_flMaxResidual, and differ from the
+// last one published; the provider takes it from RunFrame and writes it to
+// the settings, where it replaces the transform in one new snapshot.
+//-----------------------------------------------------------------------------
+class CWorldCalibrator
+{
+public:
+	static const uint32_t k_unWindow = 256;
+
+	CWorldCalibrator();
+	~CWorldCalibrator();
+
+	/** Starts sampling against the device with this Prop_SerialNumber_String;
+	* the pool and pTracker, the camera's, must outlive Stop. Restarts with an empty window. */
+	void Start(CWorkerPool* pPool, CZedTracker* pTracker, const std::string& sDeviceSerial);
+
+	/** Waits for the job in flight; the window is dropped */
+	void Stop();
+
+	bool IsRunning() const { return m_tick.IsRunning(); }
+	const std::string& GetDeviceSerial() const { return m_sDeviceSerial; }
+
+	/** Any thread: the latest solution, false if none was published after unSinceSolution */
+	bool TakeSolution(uint32_t unSinceSolution, WorldCalibration_t* pSolution) const;
+
+private:
+	CWorldCalibrator(const CWorldCalibrator&) = delete;
+	CWorldCalibrator& operator=(const CWorldCalibrator&) = delete;
+
+	struct Pair_t
+	{
+		double vecDriver[3]; // camera's tracked point, driver space
+		double vecWorld[3]; // other device, universe space
+	};
+
+	static constexpr double k_flSampleRate = 20.0;
+	static const uint64_t k_ulSolveIntervalNs = 1000000000ull;
+	static const uint32_t k_unMinPairs = 50;
+	static constexpr double k_flMinPairDistance = 0.05;
+	static constexpr double k_flMaxSpeed = 1.0; // m/s
+	// horizontal RMS distance of the pairs from their centroid
+	static constexpr double k_flMinSpread = 0.2;
+	static constexpr double k_flMaxResidual = 0.05;
+	// below these a new solution is the same calibration
+	static constexpr double k_flMinOffsetChange = 0.005;
+	static constexpr double k_flMinYawChange = 0.2;
+
+	void Tick();
+	bool FindDevice(vr::TrackedDeviceIndex_t* punDevice) const;
+	bool Sample(vr::TrackedDeviceIndex_t unDevice, Pair_t* pPair) const;
+	bool AddPair(const Pair_t& pair); // false if too close to the last one
+	void Solve();
+
+	CPeriodicJob m_tick;
+	CZedTracker* m_pTracker;
+	std::string m_sDeviceSerial;
+
+	// the job's; one tick runs at a time
+	vr::TrackedDeviceIndex_t m_unDevice;
+	uint64_t m_ulNextSolveNs;
+	bool m_bNewPairs;
+	Pair_t m_rgPairs[k_unWindow];
+	uint32_t m_unCount;
+	uint32_t m_unNext;
+	WorldCalibration_t m_published;
+
+	CSeqLock<WorldCalibration_t> m_solution;
+};
+
+#endif // WORLDCALIBRATION_H
@@ -0,0 +1,591 @@
+#include "zedcameracomponent.h"
+#include "driverlog.h"
+#include "hmdmath.h"
+#include "tracezones.h"
+
+#include <string.h>
+
+#include <chrono>
+
+using namespace vr;
+using namespace sl;
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The driver pose with its world and head transforms applied, which
+// is what a tracked camera client expects in m_RawTrackedDevicePose.
+//-----------------------------------------------------------------------------
+static void GetTrackedDevicePose(const DriverPose_t& pose, TrackedDevicePose_t* pTrackedPose)
+{
+	HmdQuaternion_t qRotation = HmdQuaternion_Multiply(HmdQuaternion_Multiply(pose.qWorldFromDriverRotation, pose.qRotation), pose.qDriverFromHeadRotation);
+
+	double vecHead[3], vecPosition[3];
+	HmdQuaternion_RotateVector(pose.qRotation, pose.vecDriverFromHeadTranslation, vecHead);
+	for (int i = 0; i < 3; i++)
+		vecHead[i] += pose.vecPosition[i];
+	HmdQuaternion_RotateVector(pose.qWorldFromDriverRotation, vecHead, vecPosition);
+
+	double vecVelocity[3], vecAngularVelocity[3];
+	HmdQuaternion_RotateVector(pose.qWorldFromDriverRotation, pose.vecVelocity, vecVelocity);
+	HmdQuaternion_RotateVector(pose.qWorldFromDriverRotation, pose.vecAngularVelocity, vecAngularVelocity);
+
+	double rgflRotation[3][3];
+	HmdQuaternion_ToMatrix(qRotation, rgflRotation);
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+			pTrackedPose->mDeviceToAbsoluteTracking.m[i][j] = (float)rgflRotation[i][j];
+		pTrackedPose->mDeviceToAbsoluteTracking.m[i][3] = (float)(vecPosition[i] + pose.vecWorldFromDriverTranslation[i]);
+		pTrackedPose->vVelocity.v[i] = (float)vecVelocity[i];
+		pTrackedPose->vAngularVelocity.v[i] = (float)vecAngularVelocity[i];
+	}
+	pTrackedPose->eTrackingResult = pose.result;
+	pTrackedPose->bPoseIsValid = pose.poseIsValid;
+	pTrackedPose->bDeviceIsConnected = pose.deviceIsConnected;
+}
+
+CZedCameraComponent::CZedCameraComponent()
+	: m_bHaveCalibration(false)
+	, m_flCameraFps(0.0f)
+	, m_nBufferCount(k_nDefaultFrameBuffers)
+	, m_unBufferSize(0)
+	, m_bExternalBuffers(false)
+	, m_unOwnedBuffersSize(0)
+	, m_nLatestSlot(-1)
+	, m_unFrameSequence(0)
+	, m_unStreamGeneration(0)
+	, m_ulStreamStartNs(0)
+	, m_ulFirstImageTimestampNs(0)
+	, m_pSinkCallback(nullptr)
+	, m_eCompatibilityMode(CAMERA_COMPAT_MODE_BULK_DEFAULT)
+	, m_cuImageContext(nullptr)
+	, m_bIntegratedGpu(false)
+	, m_cuMappedDevice(0)
+	, m_cuMappedOwner(nullptr)
+	, m_pMappedImage(nullptr)
+	, m_cuMappedImage(0)
+	, m_unMappedImageSize(0)
+	, m_bStreaming(false)
+	, m_bPaused(false)
+	, m_nAutoExposureRequest(-1)
+	, m_ulFramesDropped(0)
+{
+	memset(m_rgpExternalBuffers, 0, sizeof(m_rgpExternalBuffers));
+	memset(m_rgSlots, 0, sizeof(m_rgSlots));
+}
+
+CZedCameraComponent::~CZedCameraComponent()
+{
+	m_image.free();
+	ReleaseMappedImage();
+}
+
+void CZedCameraComponent::SetCameraInformation(const CameraInformation& info)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_calibration = info.camera_configuration.calibration_parameters;
+	m_flCameraFps = info.camera_configuration.fps;
+	m_bHaveCalibration = true;
+}
+
+bool CZedCameraComponent::GetFrameSize(uint32_t* pWidth, uint32_t* pHeight) const
+{
+	if (!m_bHaveCalibration)
+		return false;
+
+	*pWidth = (uint32_t)m_calibration.left_cam.image_size.width * 2;
+	*pHeight = (uint32_t)m_calibration.left_cam.image_size.height;
+	return *pWidth != 0 && *pHeight != 0;
+}
+
+const CameraParameters* CZedCameraComponent::GetCameraParameters(uint32_t nCameraIndex) const
+{
+	if (!m_bHaveCalibration)
+		return nullptr;
+	if (nCameraIndex == 0)
+		return &m_calibration.left_cam;
+	if (nCameraIndex == 1)
+		return &m_calibration.right_cam;
+	return nullptr;
+}
+
+void CZedCameraComponent::ApplyPendingSettings(Camera& zed)
+{
+	int nAutoExposure = m_nAutoExposureRequest.exchange(-1);
+	if (nAutoExposure >= 0)
+		zed.setCameraSettings(VIDEO_SETTINGS::AEC_AGC, nAutoExposure);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The allocation outlives the SDK's context, which goes away with
+// the camera: it is made in the device's primary context, retained until the
+// memory is freed, and is portable so the SDK's context can write to it.
+//-----------------------------------------------------------------------------
+bool CZedCameraComponent::AllocateMappedImage(CUcontext cuContext, size_t unSize)
+{
+	ReleaseMappedImage();
+
+	CUdevice cuDevice;
+	if (cuCtxPushCurrent(cuContext) != CUDA_SUCCESS)
+		return false;
+	bool bOk = cuCtxGetDevice(&cuDevice) == CUDA_SUCCESS;
+	CUcontext cuPopped;
+	cuCtxPopCurrent(&cuPopped);
+	if (!bOk || cuDevicePrimaryCtxRetain(&m_cuMappedOwner, cuDevice) != CUDA_SUCCESS)
+		return false;
+	m_cuMappedDevice = cuDevice;
+
+	if (cuCtxPushCurrent(m_cuMappedOwner) == CUDA_SUCCESS)
+	{
+		if (cuMemHostAlloc(&m_pMappedImage, unSize, CU_MEMHOSTALLOC_PORTABLE | CU_MEMHOSTALLOC_DEVICEMAP) != CUDA_SUCCESS)
+			m_pMappedImage = nullptr;
+		cuCtxPopCurrent(&cuPopped);
+	}
+	if (m_pMappedImage && cuCtxPushCurrent(cuContext) == CUDA_SUCCESS)
+	{
+		if (cuMemHostGetDevicePointer(&m_cuMappedImage, m_pMappedImage, 0) != CUDA_SUCCESS)
+			m_cuMappedImage = 0;
+		cuCtxPopCurrent(&cuPopped);
+	}
+	if (!m_cuMappedImage)
+	{
+		ReleaseMappedImage();
+		return false;
+	}
+	m_unMappedImageSize = unSize;
+	return true;
+}
+
+void CZedCameraComponent::ReleaseMappedImage()
+{
+	if (!m_cuMappedOwner)
+		return;
+
+	CUcontext cuPopped;
+	if (m_pMappedImage && cuCtxPushCurrent(m_cuMappedOwner) == CUDA_SUCCESS)
+	{
+		cuMemFreeHost(m_pMappedImage);
+		cuCtxPopCurrent(&cuPopped);
+	}
+	cuDevicePrimaryCtxRelease(m_cuMappedDevice);
+	m_cuMappedOwner = nullptr;
+	m_pMappedImage = nullptr;
+	m_cuMappedImage = 0;
+	m_unMappedImageSize = 0;
+}
+
+bool CZedCameraComponent::RetrieveImage(Camera& zed)
+{
+	CUcontext cuContext = zed.getCUDAContext();
+	if (cuContext != m_cuImageContext)
+	{
+		// a new SDK context, i.e. a camera (re)opened: the old mapping goes with it
+		m_image.free();
+		ReleaseMappedImage();
+		m_cuImageContext = cuContext;
+
+		m_bIntegratedGpu = false;
+		CUdevice cuDevice;
+		int nIntegrated = 0;
+		if (cuContext && cuCtxPushCurrent(cuContext) == CUDA_SUCCESS)
+		{
+			if (cuCtxGetDevice(&cuDevice) == CUDA_SUCCESS && cuDeviceGetAttribute(&nIntegrated, CU_DEVICE_ATTRIBUTE_INTEGRATED, cuDevice) == CUDA_SUCCESS)
+				m_bIntegratedGpu = nIntegrated != 0;
+			CUcontext cuPopped;
+			cuCtxPopCurrent(&cuPopped);
+		}
+		if (m_bIntegratedGpu)
+			DriverLog("Camera stream: integrated GPU, frames are read from mapped memory\n");
+	}
+
+	if (!m_bIntegratedGpu)
+		return zed.retrieveImage(m_image, VIEW::SIDE_BY_SIDE, MEM::CPU) == ERROR_CODE::SUCCESS;
+
+	uint32_t unWidth, unHeight;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!GetFrameSize(&unWidth, &unHeight))
+			return false;
+	}
+	size_t unStep = (size_t)unWidth * 4;
+	if (m_image.getWidth() != unWidth || m_image.getHeight() != unHeight || m_image.getPtr<sl::uchar1>(MEM::CPU) != m_pMappedImage)
+	{
+		m_image.free();
+		if (unStep * unHeight > m_unMappedImageSize && !AllocateMappedImage(cuContext, unStep * unHeight))
+		{
+			// a plain host image then, copied by the SDK
+			m_bIntegratedGpu = false;
+			return zed.retrieveImage(m_image, VIEW::SIDE_BY_SIDE, MEM::CPU) == ERROR_CODE::SUCCESS;
+		}
+		m_image = Mat(unWidth, unHeight, MAT_TYPE::U8_C4, (sl::uchar1*)m_pMappedImage, unStep, (sl::uchar1*)(uintptr_t)m_cuMappedImage, unStep);
+	}
+
+	if (zed.retrieveImage(m_image, VIEW::SIDE_BY_SIDE, MEM::GPU) != ERROR_CODE::SUCCESS)
+		return false;
+
+	// written on the SDK's stream; had it reallocated the image, its host side needs the copy after all
+	if (cuStreamSynchronize(zed.getCUDAStream()) != CUDA_SUCCESS)
+		return false;
+	if (m_image.getPtr<sl::uchar1>(MEM::GPU) != (sl::uchar1*)(uintptr_t)m_cuMappedImage)
+		return m_image.updateCPUfromGPU() == ERROR_CODE::SUCCESS;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills the oldest buffer nobody holds. The conversion runs outside
+// the lock so vrserver never waits for it; the slot is marked as being written
+// instead, which keeps GetVideoStreamFrame and the next frame off it.
+//-----------------------------------------------------------------------------
+void CZedCameraComponent::SubmitFrame(Camera& zed, const DriverPose_t& pose, uint64_t ulImageTimestampNs)
+{
+	if (!IsStreaming())
+		return;
+
+	{
+		TRACE_ZONE("retrieveImage");
+		if (!RetrieveImage(zed))
+			return;
+	}
+
+	uint32_t unWidth = (uint32_t)m_image.getWidth();
+	uint32_t unHeight = (uint32_t)m_image.getHeight();
+	uint32_t unImageSize = unWidth * unHeight * 3;
+	const uint8_t* pSource = m_image.getPtr<uint8_t>(MEM::CPU);
+	size_t unSourceStep = m_image.getStepBytes(MEM::CPU);
+
+	int nSlot = -1;
+	uint32_t unGeneration;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_bStreaming || !pSource || unImageSize == 0 || unImageSize > m_unBufferSize)
+		{
+			m_ulFramesDropped++;
+			return;
+		}
+
+		uint32_t unOldestSequence = 0;
+		for (int i = 0; i < m_nBufferCount; i++)
+		{
+			const FrameSlot_t& slot = m_rgSlots[i];
+			if (i == m_nLatestSlot || slot.unRefs != 0 || slot.bWriting)
+				continue;
+			if (nSlot < 0 || slot.frame.m_nFrameSequence < unOldestSequence)
+			{
+				nSlot = i;
+				unOldestSequence = slot.frame.m_nFrameSequence;
+			}
+		}
+
+		if (nSlot < 0)
+		{
+			// every buffer is held by a client
+			m_ulFramesDropped++;
+			return;
+		}
+		m_rgSlots[nSlot].bWriting = true;
+		unGeneration = m_unStreamGeneration;
+		if (m_ulFirstImageTimestampNs == 0)
+			m_ulFirstImageTimestampNs = ulImageTimestampNs;
+	}
+
+	FrameSlot_t& slot = m_rgSlots[nSlot];
+
+	// BGRA -> RGB24
+	for (uint32_t y = 0; y < unHeight; y++)
+	{
+		const uint8_t* pIn = pSource + y * unSourceStep;
+		uint8_t* pOut = slot.pData + y * unWidth * 3;
+		for (uint32_t x = 0; x < unWidth; x++, pIn += 4, pOut += 3)
+		{
+			pOut[0] = pIn[2];
+			pOut[1] = pIn[1];
+			pOut[2] = pIn[0];
+		}
+	}
+
+	ICameraVideoSinkCallback* pSinkCallback;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		slot.bWriting = false;
+		if (!m_bStreaming || unGeneration != m_unStreamGeneration)
+			return;
+
+		CameraVideoStreamFrame_t& frame = slot.frame;
+		frame.m_nStreamFormat = CVS_FORMAT_RGB24;
+		frame.m_nWidth = unWidth;
+		frame.m_nHeight = unHeight;
+		frame.m_nImageDataSize = unImageSize;
+		frame.m_nFrameSequence = m_unFrameSequence++;
+		frame.m_nBufferIndex = (uint32_t)nSlot;
+		frame.m_nBufferCount = (uint32_t)m_nBufferCount;
+		frame.m_flFrameElapsedTime = (ulImageTimestampNs - m_ulFirstImageTimestampNs) * 1e-9;
+		frame.m_flFrameDeliveryRate = m_flCameraFps;
+		frame.m_flFrameCaptureTime_DriverAbsolute = ulImageTimestampNs * 1e-9;
+		GetTrackedDevicePose(pose, &frame.m_RawTrackedDevicePose);
+		frame.m_pImageData = (uint64_t)(uintptr_t)slot.pData;
+
+		m_nLatestSlot = nSlot;
+		pSinkCallback = m_pSinkCallback;
+	}
+
+	if (pSinkCallback)
+		pSinkCallback->OnCameraVideoSinkCallback();
+}
+
+bool CZedCameraComponent::GetCameraFrameDimensions(ECameraVideoStreamFormat nVideoStreamFormat, uint32_t* pWidth, uint32_t* pHeight)
+{
+	if (nVideoStreamFormat != CVS_FORMAT_RGB24)
+		return false;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return GetFrameSize(pWidth, pHeight);
+}
+
+bool CZedCameraComponent::GetCameraFrameBufferingRequirements(int* pDefaultFrameQueueSize, uint32_t* pFrameBufferDataSize)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	uint32_t unWidth, unHeight;
+	if (!GetFrameSize(&unWidth, &unHeight))
+		return false;
+
+	*pDefaultFrameQueueSize = k_nDefaultFrameBuffers;
+	*pFrameBufferDataSize = unWidth * unHeight * 3;
+	return true;
+}
+
+bool CZedCameraComponent::SetCameraFrameBuffering(int nFrameBufferCount, void** ppFrameBuffers, uint32_t nFrameBufferDataSize)
+{
+	// two buffers at least: one a client holds, one the grab thread fills
+	if (nFrameBufferCount < 2 || nFrameBufferCount > k_nMaxFrameBuffers)
+		return false;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_bStreaming)
+		return false;
+
+	m_nBufferCount = nFrameBufferCount;
+	m_bExternalBuffers = ppFrameBuffers != nullptr;
+	for (int i = 0; i < k_nMaxFrameBuffers; i++)
+		m_rgpExternalBuffers[i] = m_bExternalBuffers && i < nFrameBufferCount ? ppFrameBuffers[i] : nullptr;
+	m_unBufferSize = m_bExternalBuffers ? nFrameBufferDataSize : 0;
+	return true;
+}
+
+bool CZedCameraComponent::SetCameraVideoStreamFormat(ECameraVideoStreamFormat nVideoStreamFormat)
+{
+	// the ZED delivers BGRA, RGB24 is the only format we convert to
+	return nVideoStreamFormat == CVS_FORMAT_RGB24;
+}
+
+bool CZedCameraComponent::StartVideoStream()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_bStreaming)
+		return true;
+
+	// a frame still being converted from the previous stream would write into the pool
+	for (int i = 0; i < k_nMaxFrameBuffers; i++)
+	{
+		if (m_rgSlots[i].bWriting)
+			return false;
+	}
+
+	if (!m_bExternalBuffers)
+	{
+		// our own pool, sized for the camera that is open now
+		uint32_t unWidth, unHeight;
+		if (!GetFrameSize(&unWidth, &unHeight))
+		{
+			DriverLog("Camera stream requested before the ZED was opened\n");
+			return false;
+		}
+		m_unBufferSize = unWidth * unHeight * 3;
+
+		size_t unPoolSize = (size_t)m_unBufferSize * m_nBufferCount;
+		if (unPoolSize > m_unOwnedBuffersSize)
+		{
+			m_pOwnedBuffers.reset(new uint8_t[unPoolSize]);
+			m_unOwnedBuffersSize = unPoolSize;
+		}
+	}
+
+	for (int i = 0; i < k_nMaxFrameBuffers; i++)
+	{
+		FrameSlot_t& slot = m_rgSlots[i];
+		memset(&slot.frame, 0, sizeof(slot.frame));
+		slot.pData = i >= m_nBufferCount ? nullptr
+			: m_bExternalBuffers ? (uint8_t*)m_rgpExternalBuffers[i] : m_pOwnedBuffers.get() + (size_t)m_unBufferSize * i;
+		slot.unRefs = 0;
+		slot.bWriting = false;
+	}
+	m_nLatestSlot = -1;
+	m_unFrameSequence = 0;
+	m_ulStreamStartNs = GetSteadyNanoseconds();
+	m_ulFirstImageTimestampNs = 0;
+	m_unStreamGeneration++;
+
+	m_bPaused = false;
+	m_bStreaming = true;
+	DriverLog("Camera stream started, %d buffers of %u bytes\n", m_nBufferCount, m_unBufferSize);
+	return true;
+}
+
+void CZedCameraComponent::StopVideoStream()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_bStreaming = false;
+	m_nLatestSlot = -1;
+}
+
+bool CZedCameraComponent::IsVideoStreamActive(bool* pbPaused, float* pflElapsedTime)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (pbPaused)
+		*pbPaused = m_bPaused;
+	if (pflElapsedTime)
+		*pflElapsedTime = m_bStreaming ? (float)((GetSteadyNanoseconds() - m_ulStreamStartNs) * 1e-9) : 0.0f;
+	return m_bStreaming;
+}
+
+const CameraVideoStreamFrame_t* CZedCameraComponent::GetVideoStreamFrame()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_bStreaming || m_nLatestSlot < 0)
+		return nullptr;
+
+	FrameSlot_t& slot = m_rgSlots[m_nLatestSlot];
+	slot.unRefs++;
+	return &slot.frame;
+}
+
+void CZedCameraComponent::ReleaseVideoStreamFrame(const CameraVideoStreamFrame_t* pFrameImage)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (int i = 0; i < k_nMaxFrameBuffers; i++)
+	{
+		if (&m_rgSlots[i].frame == pFrameImage && m_rgSlots[i].unRefs > 0)
+		{
+			m_rgSlots[i].unRefs--;
+			return;
+		}
+	}
+}
+
+bool CZedCameraComponent::SetAutoExposure(bool bEnable)
+{
+	m_nAutoExposureRequest = bEnable ? 1 : 0;
+	return true;
+}
+
+bool CZedCameraComponent::PauseVideoStream()
+{
+	if (!m_bStreaming)
+		return false;
+	m_bPaused = true;
+	return true;
+}
+
+bool CZedCameraComponent::ResumeVideoStream()
+{
+	if (!m_bStreaming)
+		return false;
+	m_bPaused = false;
+	return true;
+}
+
+bool CZedCameraComponent::GetCameraDistortion(uint32_t nCameraIndex, float flInputU, float flInputV, float* pflOutputU, float* pflOutputV)
+{
+	// the SDK already rectifies the images
+	if (nCameraIndex > 1)
+		return false;
+	*pflOutputU = flInputU;
+	*pflOutputV = flInputV;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Pinhole projection of one rectified eye, in the same layout as
+// IVRSystem::GetProjectionMatrix.
+//-----------------------------------------------------------------------------
+bool CZedCameraComponent::GetCameraProjection(uint32_t nCameraIndex, EVRTrackedCameraFrameType /*eFrameType*/, float flZNear, float flZFar, HmdMatrix44_t* pProjection)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const CameraParameters* pCamera = GetCameraParameters(nCameraIndex);
+	if (!pCamera || pCamera->fx <= 0.0f || pCamera->fy <= 0.0f || flZNear == flZFar)
+		return false;
+
+	// tangents of the image edges; image y points down, so top is negative
+	float flLeft = -pCamera->cx / pCamera->fx;
+	float flRight = (pCamera->image_size.width - pCamera->cx) / pCamera->fx;
+	float flTop = -pCamera->cy / pCamera->fy;
+	float flBottom = (pCamera->image_size.height - pCamera->cy) / pCamera->fy;
+
+	float flIdx = 1.0f / (flRight - flLeft);
+	float flIdy = 1.0f / (flBottom - flTop);
+	float flQ = flZFar / (flZNear - flZFar);
+
+	memset(pProjection, 0, sizeof(*pProjection));
+	pProjection->m[0][0] = 2.0f * flIdx;
+	pProjection->m[0][2] = (flRight + flLeft) * flIdx;
+	pProjection->m[1][1] = 2.0f * flIdy;
+	pProjection->m[1][2] = (flBottom + flTop) * flIdy;
+	pProjection->m[2][2] = flQ;
+	pProjection->m[2][3] = flQ * flZNear;
+	pProjection->m[3][2] = -1.0f;
+	return true;
+}
+
+bool CZedCameraComponent::SetCameraVideoSinkCallback(ICameraVideoSinkCallback* pCameraVideoSinkCallback)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_pSinkCallback = pCameraVideoSinkCallback;
+	return true;
+}
+
+bool CZedCameraComponent::GetCameraCompatibilityMode(ECameraCompatibilityMode* pCameraCompatibilityMode)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	*pCameraCompatibilityMode = m_eCompatibilityMode;
+	return true;
+}
+
+bool CZedCameraComponent::SetCameraCompatibilityMode(ECameraCompatibilityMode nCameraCompatibilityMode)
+{
+	// the transfer mode is the ZED SDK's business, only remember what was asked for
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_eCompatibilityMode = nCameraCompatibilityMode;
+	return true;
+}
+
+bool CZedCameraComponent::GetCameraFrameBounds(EVRTrackedCameraFrameType /*eFrameType*/, uint32_t* pLeft, uint32_t* pTop, uint32_t* pWidth, uint32_t* pHeight)
+{
+	// rectified images have no invalid border, every frame type is the full frame
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!GetFrameSize(pWidth, pHeight))
+		return false;
+	*pLeft = 0;
+	*pTop = 0;
+	return true;
+}
+
+bool CZedCameraComponent::GetCameraIntrinsics(uint32_t nCameraIndex, EVRTrackedCameraFrameType /*eFrameType*/, HmdVector2_t* pFocalLength, HmdVector2_t* pCenter,
+	EVRDistortionFunctionType* peDistortionType, double rCoefficients[k_unMaxDistortionFunctionParameters])
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const CameraParameters* pCamera = GetCameraParameters(nCameraIndex);
+	if (!pCamera)
+		return false;
+
+	pFocalLength->v[0] = pCamera->fx;
+	pFocalLength->v[1] = pCamera->fy;
+	pCenter->v[0] = pCamera->cx;
+	pCenter->v[1] = pCamera->cy;
+	*peDistortionType = VRDistortionFunctionType_None;
+	for (uint32_t i = 0; i < k_unMaxDistortionFunctionParameters; i++)
+		rCoefficients[i] = 0.0;
+	return true;
+}
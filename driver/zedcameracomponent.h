@@ -0,0 +1,138 @@
+#ifndef ZEDCAMERACOMPONENT_H
+#define ZEDCAMERACOMPONENT_H
+
+#pragma once
+
+#include <openvr_driver.h>
+#include <sl/Camera.hpp>
+#include <cuda.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+//-----------------------------------------------------------------------------
+// Purpose: IVRCameraComponent for the ZED, so the tracked camera API and room
+// view passthrough can use its rectified stereo images. Frames are RGB24 with
+// the left and right image side by side.
+//
+// Frames live in a fixed pool: the buffers vrserver passes to
+// SetCameraFrameBuffering, or one allocation made by StartVideoStream when it
+// doesn't. The grab thread converts each image into a buffer no client holds
+// and GetVideoStreamFrame hands out the newest one without copying it, so the
+// stream never allocates per frame and a slow client only causes drops.
+//
+// On an integrated GPU (Jetson) the SDK writes the image into mapped host
+// memory the CPU reads directly, instead of a device allocation that
+// retrieveImage would then copy to the host.
+//-----------------------------------------------------------------------------
+class CZedCameraComponent : public vr::IVRCameraComponent
+{
+public:
+	CZedCameraComponent();
+	~CZedCameraComponent();
+
+	/** Grab thread: the calibration of the camera just opened. Frames that no longer
+	* fit the configured buffers after a resolution change are dropped. */
+	void SetCameraInformation(const sl::CameraInformation& info);
+
+	/** True while a client wants frames; the grab thread skips retrieveImage otherwise */
+	bool IsStreaming() const { return m_bStreaming.load() && !m_bPaused.load(); }
+
+	/** Grab thread: converts the image of the last grab() into a free buffer and
+	* makes it the newest frame. pose is the tracked pose at ulImageTimestampNs. */
+	void SubmitFrame(sl::Camera& zed, const vr::DriverPose_t& pose, uint64_t ulImageTimestampNs);
+
+	/** Grab thread: applies camera controls requested through the component */
+	void ApplyPendingSettings(sl::Camera& zed);
+
+	uint64_t GetFramesDropped() const { return m_ulFramesDropped.load(); }
+
+	// IVRCameraComponent
+	virtual bool GetCameraFrameDimensions(vr::ECameraVideoStreamFormat nVideoStreamFormat, uint32_t* pWidth, uint32_t* pHeight) override;
+	virtual bool GetCameraFrameBufferingRequirements(int* pDefaultFrameQueueSize, uint32_t* pFrameBufferDataSize) override;
+	virtual bool SetCameraFrameBuffering(int nFrameBufferCount, void** ppFrameBuffers, uint32_t nFrameBufferDataSize) override;
+	virtual bool SetCameraVideoStreamFormat(vr::ECameraVideoStreamFormat nVideoStreamFormat) override;
+	virtual vr::ECameraVideoStreamFormat GetCameraVideoStreamFormat() override { return vr::CVS_FORMAT_RGB24; }
+	virtual bool StartVideoStream() override;
+	virtual void StopVideoStream() override;
+	virtual bool IsVideoStreamActive(bool* pbPaused, float* pflElapsedTime) override;
+	virtual const vr::CameraVideoStreamFrame_t* GetVideoStreamFrame() override;
+	virtual void ReleaseVideoStreamFrame(const vr::CameraVideoStreamFrame_t* pFrameImage) override;
+	virtual bool SetAutoExposure(bool bEnable) override;
+	virtual bool PauseVideoStream() override;
+	virtual bool ResumeVideoStream() override;
+	virtual bool GetCameraDistortion(uint32_t nCameraIndex, float flInputU, float flInputV, float* pflOutputU, float* pflOutputV) override;
+	virtual bool GetCameraProjection(uint32_t nCameraIndex, vr::EVRTrackedCameraFrameType eFrameType, float flZNear, float flZFar, vr::HmdMatrix44_t* pProjection) override;
+	virtual bool SetFrameRate(int /*nISPFrameRate*/, int /*nSensorFrameRate*/) override { return false; }
+	virtual bool SetCameraVideoSinkCallback(vr::ICameraVideoSinkCallback* pCameraVideoSinkCallback) override;
+	virtual bool GetCameraCompatibilityMode(vr::ECameraCompatibilityMode* pCameraCompatibilityMode) override;
+	virtual bool SetCameraCompatibilityMode(vr::ECameraCompatibilityMode nCameraCompatibilityMode) override;
+	virtual bool GetCameraFrameBounds(vr::EVRTrackedCameraFrameType eFrameType, uint32_t* pLeft, uint32_t* pTop, uint32_t* pWidth, uint32_t* pHeight) override;
+	virtual bool GetCameraIntrinsics(uint32_t nCameraIndex, vr::EVRTrackedCameraFrameType eFrameType, vr::HmdVector2_t* pFocalLength, vr::HmdVector2_t* pCenter,
+		vr::EVRDistortionFunctionType* peDistortionType, double rCoefficients[vr::k_unMaxDistortionFunctionParameters]) override;
+
+private:
+	static const int k_nMaxFrameBuffers = 8;
+	static const int k_nDefaultFrameBuffers = 3;
+
+	struct FrameSlot_t
+	{
+		vr::CameraVideoStreamFrame_t frame;
+		uint8_t* pData;
+		uint32_t unRefs; // GetVideoStreamFrame calls not yet released
+		bool bWriting;   // being filled by the grab thread
+	};
+
+	/** Full side-by-side frame size, false before the first camera was opened. Needs m_mutex. */
+	bool GetFrameSize(uint32_t* pWidth, uint32_t* pHeight) const;
+	const sl::CameraParameters* GetCameraParameters(uint32_t nCameraIndex) const;
+
+	/** Grab thread: the side-by-side image of the last grab() into m_image, readable from the CPU */
+	bool RetrieveImage(sl::Camera& zed);
+	bool AllocateMappedImage(CUcontext cuContext, size_t unSize);
+	void ReleaseMappedImage();
+
+	mutable std::mutex m_mutex; // everything below up to m_image
+
+	bool m_bHaveCalibration;
+	sl::CalibrationParameters m_calibration;
+	float m_flCameraFps;
+
+	// pool configuration, fixed while streaming
+	int m_nBufferCount;
+	uint32_t m_unBufferSize;
+	void* m_rgpExternalBuffers[k_nMaxFrameBuffers];
+	bool m_bExternalBuffers;
+	std::unique_ptr<uint8_t[]> m_pOwnedBuffers;
+	size_t m_unOwnedBuffersSize;
+
+	FrameSlot_t m_rgSlots[k_nMaxFrameBuffers];
+	int m_nLatestSlot;
+	uint32_t m_unFrameSequence;
+	uint32_t m_unStreamGeneration; // frames converted across a restart are discarded
+	uint64_t m_ulStreamStartNs; // steady clock
+	uint64_t m_ulFirstImageTimestampNs; // ZED clock
+
+	vr::ICameraVideoSinkCallback* m_pSinkCallback;
+	vr::ECameraCompatibilityMode m_eCompatibilityMode;
+
+	sl::Mat m_image; // grab thread's BGRA staging image, reused for every frame
+
+	// grab thread's, integrated GPUs only: m_image wraps this mapped host memory
+	CUcontext m_cuImageContext; // the SDK's context m_bIntegratedGpu was checked in
+	bool m_bIntegratedGpu;
+	CUdevice m_cuMappedDevice;
+	CUcontext m_cuMappedOwner; // the device's primary context, retained while allocated
+	void* m_pMappedImage;
+	CUdeviceptr m_cuMappedImage;
+	size_t m_unMappedImageSize;
+
+	std::atomic<bool> m_bStreaming;
+	std::atomic<bool> m_bPaused;
+	std::atomic<int> m_nAutoExposureRequest; // -1 none, else the requested bool
+	std::atomic<uint64_t> m_ulFramesDropped;
+};
+
+#endif // ZEDCAMERACOMPONENT_H
@@ -0,0 +1,69 @@
+#include "zeddisplaycomponent.h"
+
+using namespace vr;
+
+static uint32_t ClampDimension(int32_t nValue, uint32_t unDefault)
+{
+	return nValue > 0 && nValue <= 16384 ? (uint32_t)nValue : unDefault;
+}
+
+CZedDisplayComponent::CZedDisplayComponent(const ZedmSettings_t& settings)
+	: m_nWindowX(settings.nHmdWindowX)
+	, m_nWindowY(settings.nHmdWindowY)
+	, m_unWindowWidth(ClampDimension(settings.nHmdWindowWidth, 1920))
+	, m_unWindowHeight(ClampDimension(settings.nHmdWindowHeight, 1080))
+	, m_unRenderWidth(ClampDimension(settings.nHmdRenderWidth, 1344))
+	, m_unRenderHeight(ClampDimension(settings.nHmdRenderHeight, 1512))
+	, m_flDisplayFrequency(settings.flHmdDisplayFrequency > 0.0f ? settings.flHmdDisplayFrequency : 90.0f)
+	, m_flSecondsFromVsyncToPhotons(settings.flHmdSecondsFromVsyncToPhotons >= 0.0f ? settings.flHmdSecondsFromVsyncToPhotons : 0.0f)
+	, m_flIpd(settings.flHmdIpd > 0.0f ? settings.flHmdIpd : 0.063f)
+{
+}
+
+void CZedDisplayComponent::AddProperties(CPropertyBatch* pBatch) const
+{
+	pBatch->SetFloat(Prop_UserIpdMeters_Float, m_flIpd);
+	pBatch->SetFloat(Prop_UserHeadToEyeDepthMeters_Float, 0.0f);
+	pBatch->SetFloat(Prop_DisplayFrequency_Float, m_flDisplayFrequency);
+	pBatch->SetFloat(Prop_SecondsFromVsyncToPhotons_Float, m_flSecondsFromVsyncToPhotons);
+}
+
+void CZedDisplayComponent::GetWindowBounds(int32_t* pnX, int32_t* pnY, uint32_t* pnWidth, uint32_t* pnHeight)
+{
+	*pnX = m_nWindowX;
+	*pnY = m_nWindowY;
+	*pnWidth = m_unWindowWidth;
+	*pnHeight = m_unWindowHeight;
+}
+
+void CZedDisplayComponent::GetRecommendedRenderTargetSize(uint32_t* pnWidth, uint32_t* pnHeight)
+{
+	*pnWidth = m_unRenderWidth;
+	*pnHeight = m_unRenderHeight;
+}
+
+void CZedDisplayComponent::GetEyeOutputViewport(EVREye eEye, uint32_t* pnX, uint32_t* pnY, uint32_t* pnWidth, uint32_t* pnHeight)
+{
+	// side by side, left eye first
+	*pnX = eEye == Eye_Left ? 0 : m_unWindowWidth / 2;
+	*pnY = 0;
+	*pnWidth = m_unWindowWidth / 2;
+	*pnHeight = m_unWindowHeight;
+}
+
+void CZedDisplayComponent::GetProjectionRaw(EVREye /*eEye*/, float* pfLeft, float* pfRight, float* pfTop, float* pfBottom)
+{
+	// 90 degrees each way; tangents of the half angles
+	*pfLeft = -1.0f;
+	*pfRight = 1.0f;
+	*pfTop = -1.0f;
+	*pfBottom = 1.0f;
+}
+
+DistortionCoordinates_t CZedDisplayComponent::ComputeDistortion(EVREye /*eEye*/, float fU, float fV)
+{
+	DistortionCoordinates_t coordinates;
+	coordinates.rfRed[0] = coordinates.rfGreen[0] = coordinates.rfBlue[0] = fU;
+	coordinates.rfRed[1] = coordinates.rfGreen[1] = coordinates.rfBlue[1] = fV;
+	return coordinates;
+}
@@ -0,0 +1,53 @@
+#ifndef ZEDDISPLAYCOMPONENT_H
+#define ZEDDISPLAYCOMPONENT_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include "driversettings.h"
+#include "propertybatch.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: IVRDisplayComponent of the device in hmdMode. It makes the ZED's
+// pose the headset's own pose without an overlay app copying it onto a
+// tracker.
+//
+// The display is virtual. It is a window of the hmdWindow* size with plain,
+// undistorted projections, like the OpenVR sample driver's, so the
+// compositor has somewhere to present. What is worn is a headset driven
+// elsewhere, or a mirror of this window. The mount is the existing
+// headOffset / headYaw / headPitch / headRoll calibration, which becomes
+// the pose's driver-from-head transform.
+//-----------------------------------------------------------------------------
+class CZedDisplayComponent : public vr::IVRDisplayComponent
+{
+public:
+	explicit CZedDisplayComponent(const ZedmSettings_t& settings);
+	virtual ~CZedDisplayComponent() {}
+
+	/** The HMD properties of the device, for Activate's batch */
+	void AddProperties(CPropertyBatch* pBatch) const;
+
+	// IVRDisplayComponent
+	virtual void GetWindowBounds(int32_t* pnX, int32_t* pnY, uint32_t* pnWidth, uint32_t* pnHeight) override;
+	virtual bool IsDisplayOnDesktop() override { return true; }
+	virtual bool IsDisplayRealDisplay() override { return false; }
+	virtual void GetRecommendedRenderTargetSize(uint32_t* pnWidth, uint32_t* pnHeight) override;
+	virtual void GetEyeOutputViewport(vr::EVREye eEye, uint32_t* pnX, uint32_t* pnY, uint32_t* pnWidth, uint32_t* pnHeight) override;
+	virtual void GetProjectionRaw(vr::EVREye eEye, float* pfLeft, float* pfRight, float* pfTop, float* pfBottom) override;
+	virtual vr::DistortionCoordinates_t ComputeDistortion(vr::EVREye eEye, float fU, float fV) override;
+
+private:
+	int32_t m_nWindowX;
+	int32_t m_nWindowY;
+	uint32_t m_unWindowWidth;
+	uint32_t m_unWindowHeight;
+	uint32_t m_unRenderWidth;
+	uint32_t m_unRenderHeight;
+	float m_flDisplayFrequency;
+	float m_flSecondsFromVsyncToPhotons;
+	float m_flIpd;
+};
+
+#endif // ZEDDISPLAYCOMPONENT_H
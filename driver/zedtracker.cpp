@@ -0,0 +1,2286 @@
+#include "zedtracker.h"
+#include "cameraautotune.h"
+#include "cameradetect.h"
+#include "driverlog.h"
+#include "precisetimer.h"
+#include "sdkcache.h"
+#include "threadscheduling.h"
+#include "tracezones.h"
+
+#include <string.h>
+
+#include <chrono>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <stdio.h>
+#include <sys/stat.h>
+#endif
+
+using namespace vr;
+using namespace sl;
+
+// Polling period of the IMU poller. The SDK only hands out its newest IMU
+// sample, so to see every one of the ZED Mini / ZED 2's ~400 Hz it asks five
+// times per sample period; a poll can then run 2 ms late without a loss.
+static const std::chrono::microseconds k_ImuPollInterval(500);
+
+// Drain period of the IMU publisher with vsyncPublish, twice per IMU sample.
+// Otherwise it sleeps until the poller writes a sample.
+static const std::chrono::microseconds k_ImuPublishInterval(1250);
+
+// longest the publisher sleeps without a sample before it looks at the run flag again
+static const std::chrono::milliseconds k_ImuIdleWait(100);
+
+// most samples the publisher takes from the ring per wake-up, two publish periods' worth normally
+static const uint32_t k_unImuDrainBatch = 32;
+
+// sampling rate assumed for the missed sample count when the SDK doesn't report one
+static const float k_flDefaultImuRate = 400.0f;
+
+// ZED gyroscope rates are reported in degrees per second
+static const double k_flDegreesToRadians = 3.14159265358979323846 / 180.0;
+
+// Consecutive grab() failures before the pose is reported as out of range
+static const uint32_t k_unFailuresBeforeTrackingLost = 5;
+
+// Upper bounds of the exponential back-off between grab() retries and between camera reopen attempts
+static const std::chrono::milliseconds k_GrabRetryMaxInterval(100);
+static const std::chrono::milliseconds k_ReconnectMaxInterval(2000);
+
+// 1 ms after the first failure, doubling up to maxInterval
+static std::chrono::milliseconds GetBackoffInterval(uint32_t unFailures, std::chrono::milliseconds maxInterval)
+{
+	uint32_t unShift = unFailures > 1 ? unFailures - 1 : 0;
+	if (unShift > 16)
+		unShift = 16;
+	std::chrono::milliseconds interval(1ll << unShift);
+	return interval < maxInterval ? interval : maxInterval;
+}
+
+// grab() errors that mean the camera is gone and has to be reopened
+static bool IsCameraLost(ERROR_CODE eError)
+{
+	switch (eError)
+	{
+	case ERROR_CODE::CAMERA_NOT_DETECTED:
+	case ERROR_CODE::CAMERA_DETECTION_ISSUE:
+	case ERROR_CODE::CANNOT_START_CAMERA_STREAM:
+	case ERROR_CODE::CAMERA_NOT_INITIALIZED:
+	case ERROR_CODE::CAMERA_FAILED_TO_SETUP:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// VIDEO_SETTINGS::EXPOSURE maps 0-100 linearly onto exposure times from this
+// up to a longest one that depends on the frame rate
+static const double k_flMinExposureMs = 0.17072;
+
+// the longest exposure of the sensor at each frame rate the camera offers:
+// 15 and 30 fps (HD2K, HD1080, HD720, VGA), 60 fps (HD1080, HD720) and
+// 100 fps (VGA only)
+static const double k_flMaxExposureMs30Fps = 19.97;
+static const double k_flMaxExposureMs60Fps = 10.84072;
+static const double k_flMaxExposureMs100Fps = 10.106624;
+
+//-----------------------------------------------------------------------------
+// Purpose: How long before the image timestamp the middle of the image's
+// exposure was: half the exposure nExposure stands for at nFps plus the
+// transport delay in seconds. An nExposure outside 0-100, e.g. the -1 the SDK
+// reports while it can't read the setting, leaves just the transport delay.
+//-----------------------------------------------------------------------------
+static uint64_t GetMidExposureOffsetNs(int nExposure, int nFps, float flTransportDelay)
+{
+	double flOffsetMs = flTransportDelay > 0.0f ? flTransportDelay * 1000.0 : 0.0;
+	if (nExposure >= 0 && nExposure <= 100)
+	{
+		double flMaxExposureMs = nFps <= 30 ? k_flMaxExposureMs30Fps : nFps <= 60 ? k_flMaxExposureMs60Fps : k_flMaxExposureMs100Fps;
+		flOffsetMs += 0.5 * (k_flMinExposureMs + (flMaxExposureMs - k_flMinExposureMs) * nExposure / 100.0);
+	}
+	return (uint64_t)(flOffsetMs * 1e6);
+}
+
+// How long poses are held back while the SDK looks for the loaded area map.
+// Past it the saved map is probably of another room; it isn't overwritten
+// unless tracking converges later on.
+static const double k_flRelocalizeTimeout = 30.0;
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// pairs for the clock translation; 64 of them span 6.4 s
+static const uint64_t k_ulClockPairIntervalNs = 100000000ull;
+
+//-----------------------------------------------------------------------------
+// Purpose: Everything in a published pose that only depends on the settings,
+// filled in once per snapshot instead of for every pose.
+//-----------------------------------------------------------------------------
+static std::shared_ptr<const ZedTrackerConfig_t> CreateTrackerConfig(const ZedmSettings_t& settings, bool bFloorDetected = false, double flFloorHeight = 0.0)
+{
+	std::shared_ptr<ZedTrackerConfig_t> pConfig = std::make_shared<ZedTrackerConfig_t>();
+	pConfig->settings = settings;
+	pConfig->bFloorDetected = bFloorDetected;
+	pConfig->flFloorHeight = flFloorHeight;
+
+	DriverPose_t& pose = pConfig->poseTemplate;
+	memset(&pose, 0, sizeof(pose));
+	pose.poseIsValid = true;
+	pose.result = TrackingResult_Running_OK;
+	pose.deviceIsConnected = true;
+	pose.qWorldFromDriverRotation = settings.qWorldFromDriverRotation;
+	pose.qDriverFromHeadRotation = settings.qDriverFromHeadRotation;
+	for (int i = 0; i < 3; i++)
+	{
+		pose.vecWorldFromDriverTranslation[i] = settings.vecWorldFromDriverTranslation[i];
+		pose.vecDriverFromHeadTranslation[i] = settings.vecDriverFromHeadTranslation[i];
+	}
+
+	// the world rotation is a yaw, so the floor's height in ZED space carries over unchanged
+	if (settings.bAutoFloorHeight && bFloorDetected)
+		pose.vecWorldFromDriverTranslation[1] -= flFloorHeight;
+
+	pose.qRotation = HmdQuaternion_Identity();
+	return pConfig;
+}
+
+static void ConfigureFusion(CPoseFusion* pFusion, CDeadReckoner* pDeadReckoner, const ZedmSettings_t& settings)
+{
+	pFusion->SetCorrectionTimeConstant(settings.flFusionTimeConstant);
+	pDeadReckoner->Configure(settings.flDeadReckoningTime, settings.flDeadReckoningDamping);
+}
+
+// What a pose built while tracking is in eTrackingState is reported as.
+// bDeadReckoning: visual tracking is lost but the IMU still carries the pose.
+static ETrackingResult GetTrackingResult(POSITIONAL_TRACKING_STATE eTrackingState, bool bDeadReckoning)
+{
+	switch (eTrackingState)
+	{
+	case POSITIONAL_TRACKING_STATE::OK:
+		return TrackingResult_Running_OK;
+	case POSITIONAL_TRACKING_STATE::SEARCHING_FLOOR_PLANE:
+		return TrackingResult_Calibrating_InProgress;
+	case POSITIONAL_TRACKING_STATE::OFF:
+		return TrackingResult_Uninitialized;
+	default:
+		// SEARCHING, FPS_TOO_LOW: lost what it was tracking
+		return bDeadReckoning ? TrackingResult_Fallback_RotationOnly : TrackingResult_Running_OutOfRange;
+	}
+}
+
+static void ConfigurePublishFilters(CPoseFilterBank* pPoseFilter, CPoseSubmitFilter* pSubmitFilter, CPosePredictorBank* pPredictor,
+	CZedBodyTracker* pBodyTracker, CZedObjectTracker* pObjectTracker, const ZedmSettings_t& settings)
+{
+	PredictorParams_t predictorParams = { settings.flPredictionJerk, settings.flPredictionAngularAcceleration };
+	pPredictor->Configure(settings.flPredictionHorizon > 0.0f, predictorParams);
+
+	OneEuroParams_t params = { settings.flFilterMinCutoff, settings.flFilterBeta, settings.flFilterDerivativeCutoff };
+	pPoseFilter->Configure(settings.bPoseFilter, params);
+	OneEuroParams_t bodyParams = { settings.flBodyFilterMinCutoff, settings.flBodyFilterBeta, settings.flFilterDerivativeCutoff };
+	pBodyTracker->SetPoseFilter(settings.bBodyFilter, bodyParams);
+
+	pSubmitFilter->Configure(settings.bPoseDedup, settings.flDedupPosition, settings.flDedupRotation, settings.flDedupKeepAlive);
+	pBodyTracker->SetSubmitFilter(settings.bPoseDedup, settings.flDedupPosition, settings.flDedupRotation, settings.flDedupKeepAlive);
+	pObjectTracker->SetSubmitFilter(settings.bPoseDedup, settings.flDedupPosition, settings.flDedupRotation, settings.flDedupKeepAlive);
+}
+
+CZedTracker::CZedTracker()
+	: m_bDepthPerGrab(true)
+	, m_unSettingsVersion(0)
+	, m_unGrabSettingsVersion(0)
+	, m_unCameraSerial(0)
+	, m_pPoseThread(nullptr)
+	, m_bStopRequested(false)
+	, m_bPauseRequested(false)
+	, m_bStandbyRequested(false)
+	, m_bPaused(false)
+	, m_bGrabThreadExited(false)
+	, m_pImuThread(nullptr)
+	, m_pImuPollThread(nullptr)
+	, m_ulImuSamplesMissed(0)
+	, m_ulImuSamplesSkipped(0)
+	, m_bImuBiasCached(false)
+	, m_bImuBiasEstimated(false)
+	, m_unObjectId(k_unTrackedDeviceIndexInvalid)
+	, m_ulImuBuffer(k_ulInvalidIOBufferHandle)
+	, m_pSharedPoses(nullptr)
+	, m_ulConfidenceComponent(k_ulInvalidInputComponentHandle)
+	, m_flConfidence(-1.0f)
+	, m_bImuPublisherRunning(false)
+	, m_bGrabFailing(false)
+	, m_bReplay(false)
+	, m_bHasImu(false)
+	, m_bImuOnly(false)
+	, m_bImuOnlyUnsupported(false)
+	, m_unFramesSinceTrace(0)
+	, m_ulLastHistoryTimestampNs(0)
+	, m_bDeadReckoning(false)
+	, m_bVisualTracked(false)
+	, m_ulVisualLostNs(0)
+	, m_ulNextClockPairNs(0)
+	, m_flPredictionHorizon(0.0)
+	, m_ulNextGrabNs(0)
+	, m_pWorkerPool(nullptr)
+	, m_flGrabFps(0.0f)
+	, m_unFramesDropped(0)
+	, m_eTrackingState(POSITIONAL_TRACKING_STATE::OFF)
+	, m_ulGrabFailures(0)
+	, m_ulTrackingLosses(0)
+	, m_flGpuUsedMb(0.0f)
+	, m_flGpuTotalMb(0.0f)
+	, m_bRelocalizing(false)
+	, m_ulRelocalizeStartNs(0)
+	, m_bAreaMapUsable(false)
+	, m_bAreaSaveRunning(false)
+	, m_bAreaSaveRequested(false)
+	, m_eActiveProfile(CameraProfile_Balanced)
+	, m_bAutoTuneProfile(false)
+	, m_nProfileCeiling(-1)
+	, m_eRequestedProfile(CameraProfile_Balanced)
+{
+}
+
+CZedTracker::~CZedTracker()
+{
+	Stop();
+}
+
+void CZedTracker::WaitForExit()
+{
+	if (m_pPoseThread)
+	{
+		m_pPoseThread->join();
+		delete m_pPoseThread;
+		m_pPoseThread = nullptr;
+	}
+}
+
+bool CZedTracker::HasExited()
+{
+	std::lock_guard<std::mutex> lock(m_runMutex);
+	return m_bGrabThreadExited;
+}
+
+bool CZedTracker::Start(const ZedmSettings_t& settings, unsigned int unCameraSerial)
+{
+	if (m_pPoseThread)
+	{
+		// reactivated: the camera is still open on the parked grab thread
+		UpdateSettings(settings);
+		{
+			std::lock_guard<std::mutex> lock(m_runMutex);
+			m_bPauseRequested = false;
+		}
+		m_runWake.notify_all();
+		return true;
+	}
+
+	m_bStopRequested = false;
+	m_bPauseRequested = false;
+	m_bPaused = false;
+	m_bGrabThreadExited = false;
+	m_pConfig = CreateTrackerConfig(settings);
+	m_pGrabConfig = m_pConfig;
+	{
+		std::lock_guard<std::mutex> lock(m_publishFilterMutex);
+		ConfigurePublishFilters(&m_poseFilter, &m_submitFilter, &m_posePredictor, &m_bodyTracker, &m_objectTracker, settings);
+		m_flPredictionHorizon = settings.flPredictionHorizon;
+	}
+	m_unCameraSerial = unCameraSerial;
+	m_bReplay = !settings.sSvoPath.empty();
+
+	m_bAutoTuneProfile = settings.sCameraProfile == "auto" && !m_bReplay;
+	m_nProfileCeiling = settings.nCameraProfileCeiling;
+	if (!FindCameraProfile(settings.sCameraProfile.c_str(), &m_eActiveProfile) && !m_bAutoTuneProfile)
+		DriverLog("Unknown camera profile %s, using %s\n", settings.sCameraProfile.c_str(), GetCameraProfile(m_eActiveProfile).pchName);
+	m_eActiveProfile = CapCameraProfile(m_eActiveProfile);
+	m_eRequestedProfile = m_eActiveProfile;
+
+	if (!settings.sPoseRecordingPath.empty() && !m_recorder.Open(settings.sPoseRecordingPath.c_str()))
+		DriverLog("Unable to open pose recording %s\n", settings.sPoseRecordingPath.c_str());
+
+	// a replay grabs as fast as it decodes, it can't stall on the camera
+	m_watchdog.SetStallTimeout(m_bReplay ? 0.0f : settings.flGrabStallTimeout);
+	if (m_pWorkerPool && !m_bReplay)
+	{
+		m_watchdog.Start(m_pWorkerPool, unCameraSerial, [this]
+		{
+			std::lock_guard<std::mutex> lock(m_runMutex);
+			m_runWake.notify_all();
+		});
+	}
+
+	m_pPoseThread = new std::thread(&CZedTracker::RunPoseTracking, this);
+	if (m_pWorkerPool)
+		m_costSampling.Start(m_pWorkerPool, WorkPriority_Low, k_ulCostSampleIntervalNs, [this] { SampleCosts(); });
+	return m_pPoseThread != nullptr;
+}
+
+void CZedTracker::Pause()
+{
+	if (!m_pPoseThread)
+		return;
+
+	std::unique_lock<std::mutex> lock(m_runMutex);
+	m_bPauseRequested = true;
+	m_runWake.notify_all();
+	m_runWake.wait(lock, [this] { return m_bPaused || m_bGrabThreadExited; });
+}
+
+void CZedTracker::SetStandby(bool bStandby)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_runMutex);
+		m_bStandbyRequested = bStandby;
+	}
+	m_runWake.notify_all();
+}
+
+void CZedTracker::Stop()
+{
+	if (!m_pPoseThread)
+		return;
+
+	m_watchdog.Stop();
+	m_costSampling.Stop();
+	{
+		std::lock_guard<std::mutex> lock(m_runMutex);
+		m_bStopRequested = true;
+	}
+	m_runWake.notify_all();
+	WaitForExit();
+}
+
+bool CZedTracker::WaitWhilePaused(bool bCameraOpen)
+{
+	if (!m_bPauseRequested && !m_bStandbyRequested)
+		return !m_bStopRequested;
+
+	// nothing reads the camera while parked, the IMU publisher included
+	uint64_t ulPausedNs = GetSteadyNanoseconds();
+	m_watchdog.Disarm();
+	if (bCameraOpen)
+		StopImuPublisher();
+	{
+		std::unique_lock<std::mutex> lock(m_runMutex);
+		m_bPaused = true;
+		m_runWake.notify_all();
+		m_runWake.wait(lock, [this] { return (!m_bPauseRequested && !m_bStandbyRequested) || m_bStopRequested; });
+		m_bPaused = false;
+	}
+	if (m_bStopRequested)
+		return false;
+
+	// a gap of unknown length since the last frame
+	DriverLog("ZED %u resumed after %.1f s\n", m_unCameraSerial, (GetSteadyNanoseconds() - ulPausedNs) * 1e-9);
+	if (bCameraOpen)
+	{
+		m_velocityEstimator.Reset();
+		m_fusion.Reset();
+		m_deadReckoner.Reset();
+		ConfigureFusion(&m_fusion, &m_deadReckoner, m_pGrabConfig->settings);
+		m_governor.Reset();
+		m_ulNextGrabNs = 0;
+		StartImuPublisher();
+		if (!m_bImuOnly)
+			m_watchdog.Arm(GetSteadyNanoseconds());
+	}
+	return true;
+}
+
+bool CZedTracker::SleepUnlessStopped(std::chrono::milliseconds interval, bool bCameraOpen)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_runMutex);
+		m_runWake.wait_for(lock, interval, [this]
+		{
+			return m_bStopRequested || m_bPauseRequested || m_bStandbyRequested || m_watchdog.IsRecoveryRequested();
+		});
+	}
+	return WaitWhilePaused(bCameraOpen);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stores the pose for GetPose()/RunFrame() and, from the IMU publisher,
+// pushes it straight to the host instead of waiting for the next RunFrame.
+//-----------------------------------------------------------------------------
+template <uint32_t unStages>
+void CZedTracker::PublishPose(const DriverPose_t& rawPose, uint64_t ulSampleTimestampNs, bool bSubmit)
+{
+	// poseFilter: everything downstream, history included, sees the smoothed pose
+	DriverPose_t pose = rawPose;
+	if ((unStages & PipelineStage_Filter) && (m_poseFilter.IsEnabled() || m_posePredictor.IsEnabled()))
+	{
+		TRACE_ZONE("filter");
+		std::lock_guard<std::mutex> lock(m_publishFilterMutex);
+		m_poseFilter.Filter(&pose, 1, ulSampleTimestampNs);
+		if (ulSampleTimestampNs != 0)
+			m_posePredictor.Update(&pose, 1, ulSampleTimestampNs);
+	}
+
+	ZedPublishedPose_t published;
+	published.pose = pose;
+	published.ulSampleTimestampNs = ulSampleTimestampNs;
+	m_poseHandoff.Write(published);
+	m_publishRate.Tick(GetSteadyNanoseconds());
+
+	CSharedPoseWriter* pSharedPoses = m_pSharedPoses.load();
+	if (pSharedPoses)
+		pSharedPoses->WritePose(pose, ulSampleTimestampNs);
+
+	if (!pose.poseIsValid || ulSampleTimestampNs == 0)
+	{
+		m_poseHistory.Clear();
+		m_ulLastHistoryTimestampNs = 0;
+	}
+	else if (ulSampleTimestampNs > m_ulLastHistoryTimestampNs)
+	{
+		PoseHistorySample_t sample;
+		sample.ulTimestampNs = ulSampleTimestampNs;
+		sample.qRotation = pose.qRotation;
+		for (int i = 0; i < 3; i++)
+		{
+			sample.vecPosition[i] = pose.vecPosition[i];
+			sample.vecVelocity[i] = pose.vecVelocity[i];
+			sample.vecAngularVelocity[i] = pose.vecAngularVelocity[i];
+		}
+		m_poseHistory.Write(sample);
+		m_ulLastHistoryTimestampNs = ulSampleTimestampNs;
+	}
+
+	// every frame of a replay is submitted, that's what it measures
+	TrackedDeviceIndex_t unObjectId = m_unObjectId.load();
+	bSubmit = bSubmit && unObjectId != k_unTrackedDeviceIndexInvalid && (m_bReplay || ShouldSubmitPose(pose, ulSampleTimestampNs));
+	if (bSubmit)
+	{
+		DriverPose_t submitted = pose;
+		if (unStages & PipelineStage_Filter)
+			PredictPose(&submitted);
+		TRACE_ZONE("TrackedDevicePoseUpdated");
+		VRServerDriverHost()->TrackedDevicePoseUpdated(unObjectId, submitted, sizeof(DriverPose_t));
+		RecordPoseSubmitted(ulSampleTimestampNs);
+	}
+	UpdateConfidence(pose);
+
+	if ((unStages & PipelineStage_Record) && m_recorder.IsOpen())
+	{
+		float rgflValues[k_unPoseRecordValues] = {
+			(float)pose.vecPosition[0], (float)pose.vecPosition[1], (float)pose.vecPosition[2],
+			(float)pose.qRotation.w, (float)pose.qRotation.x, (float)pose.qRotation.y, (float)pose.qRotation.z,
+			(float)pose.vecVelocity[0], (float)pose.vecVelocity[1], (float)pose.vecVelocity[2],
+			(float)pose.vecAngularVelocity[0], (float)pose.vecAngularVelocity[1], (float)pose.vecAngularVelocity[2],
+			(float)pose.poseTimeOffset
+		};
+		uint8_t unFlags = (pose.poseIsValid ? k_unPoseRecordFlag_Valid : 0) | (bSubmit ? k_unPoseRecordFlag_Submitted : 0);
+		m_recorder.Record(PoseRecord_Published, ulSampleTimestampNs, rgflValues, k_unPoseRecordValues, unFlags);
+	}
+}
+
+// The tracking result as the confidence scalar: 1 tracking, 0.5 carried by the
+// IMU alone, 0.25 still starting or relocalizing, 0 lost
+static float GetTrackingConfidence(const DriverPose_t& pose)
+{
+	if (!pose.poseIsValid)
+		return 0.0f;
+	switch (pose.result)
+	{
+	case TrackingResult_Running_OK:
+		return 1.0f;
+	case TrackingResult_Fallback_RotationOnly:
+		return 0.5f;
+	case TrackingResult_Calibrating_InProgress:
+		return 0.25f;
+	default:
+		return 0.0f;
+	}
+}
+
+void CZedTracker::SetConfidenceComponent(VRInputComponentHandle_t ulComponent)
+{
+	m_flConfidence = -1.0f;
+	m_ulConfidenceComponent = ulComponent;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: From PublishPose. Only a change is sent; the state rarely changes,
+// so this costs nothing per pose, and applications needn't poll.
+//-----------------------------------------------------------------------------
+void CZedTracker::UpdateConfidence(const DriverPose_t& pose)
+{
+	VRInputComponentHandle_t ulComponent = m_ulConfidenceComponent.load();
+	if (ulComponent == k_ulInvalidInputComponentHandle)
+		return;
+	float flConfidence = GetTrackingConfidence(pose);
+	if (m_flConfidence.exchange(flConfidence) != flConfidence)
+		VRDriverInput()->UpdateScalarComponent(ulComponent, flConfidence, 0.0);
+}
+
+void CZedTracker::RecordVisualPose(const ZedVisualPose_t& visual)
+{
+	if (!m_recorder.IsOpen())
+		return;
+
+	float rgflValues[13] = {
+		(float)visual.vecPosition[0], (float)visual.vecPosition[1], (float)visual.vecPosition[2],
+		(float)visual.qRotation.w, (float)visual.qRotation.x, (float)visual.qRotation.y, (float)visual.qRotation.z,
+		(float)visual.vecVelocity[0], (float)visual.vecVelocity[1], (float)visual.vecVelocity[2],
+		(float)visual.vecAngularVelocity[0], (float)visual.vecAngularVelocity[1], (float)visual.vecAngularVelocity[2]
+	};
+	m_recorder.Record(PoseRecord_Visual, visual.ulTimestampNs, rgflValues, 13);
+}
+
+// the SDK's sample in the ring's layout: radians, and the orientation as SteamVR's quaternion
+static void FillImuRingSample(const IMUData& imu, ImuRingSample_t* pSample)
+{
+	auto imu_orientation = imu.pose.getOrientation();
+	pSample->ulTimestampNs = imu.timestamp.getNanoseconds();
+	pSample->qOrientation = HmdQuaternion_Init(imu_orientation.ow, imu_orientation.ox, imu_orientation.oy, imu_orientation.oz);
+	pSample->vecGyro[0] = imu.angular_velocity.x * k_flDegreesToRadians;
+	pSample->vecGyro[1] = imu.angular_velocity.y * k_flDegreesToRadians;
+	pSample->vecGyro[2] = imu.angular_velocity.z * k_flDegreesToRadians;
+	pSample->vecAccel[0] = imu.linear_acceleration.x;
+	pSample->vecAccel[1] = imu.linear_acceleration.y;
+	pSample->vecAccel[2] = imu.linear_acceleration.z;
+}
+
+void CZedTracker::RecordImuSample(const ImuRingSample_t& imu)
+{
+	if (!m_recorder.IsOpen())
+		return;
+
+	float rgflValues[10] = {
+		(float)imu.qOrientation.w, (float)imu.qOrientation.x, (float)imu.qOrientation.y, (float)imu.qOrientation.z,
+		(float)imu.vecGyro[0], (float)imu.vecGyro[1], (float)imu.vecGyro[2],
+		(float)imu.vecAccel[0], (float)imu.vecAccel[1], (float)imu.vecAccel[2]
+	};
+	m_recorder.Record(PoseRecord_Imu, imu.ulTimestampNs, rgflValues, 10);
+}
+
+void CZedTracker::AddGovernorImuSample(const ImuRingSample_t& imu)
+{
+	// the governor's motion thresholds are in the SDK's degrees per second
+	float vecGyro[3] = { (float)(imu.vecGyro[0] / k_flDegreesToRadians), (float)(imu.vecGyro[1] / k_flDegreesToRadians), (float)(imu.vecGyro[2] / k_flDegreesToRadians) };
+	float vecAccel[3] = { (float)imu.vecAccel[0], (float)imu.vecAccel[1], (float)imu.vecAccel[2] };
+	m_governor.AddImuSample(vecGyro, vecAccel, imu.ulTimestampNs);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Raw IMU stream for other processes, through the IOBuffer and the
+// shared memory export. HasReaders is cheap, so with nobody listening the
+// sample isn't converted or copied for the IOBuffer.
+//-----------------------------------------------------------------------------
+void CZedTracker::WriteImuBuffer(const ImuRingSample_t& imu)
+{
+	CSharedPoseWriter* pSharedPoses = m_pSharedPoses.load();
+	if (pSharedPoses)
+	{
+		SharedImuSample_t shared;
+		shared.ulSampleTimestampNs = imu.ulTimestampNs;
+		for (int i = 0; i < 3; i++)
+		{
+			shared.vecAccel[i] = (float)imu.vecAccel[i];
+			shared.vecGyro[i] = (float)imu.vecGyro[i];
+		}
+		pSharedPoses->WriteImu(shared);
+	}
+
+	IOBufferHandle_t ulImuBuffer = m_ulImuBuffer.load();
+	if (ulImuBuffer == k_ulInvalidIOBufferHandle || !VRIOBuffer() || !VRIOBuffer()->HasReaders(ulImuBuffer))
+		return;
+
+	ImuSample_t sample;
+	sample.fSampleTime = imu.ulTimestampNs * 1e-9;
+	for (int i = 0; i < 3; i++)
+	{
+		sample.vAccel.v[i] = imu.vecAccel[i];
+		sample.vGyro.v[i] = imu.vecGyro[i];
+	}
+	sample.unOffScaleFlags = 0;
+	VRIOBuffer()->Write(ulImuBuffer, &sample, sizeof(sample));
+}
+
+uint32_t CZedTracker::ReadPose(DriverPose_t* pPose, uint64_t* pulSampleTimestampNs) const
+{
+	ZedPublishedPose_t published;
+	uint32_t unSequence = m_poseHandoff.Read(&published);
+	if (unSequence == 0)
+		return 0;
+
+	*pPose = published.pose;
+	if (pulSampleTimestampNs)
+		*pulSampleTimestampNs = published.ulSampleTimestampNs;
+	return unSequence;
+}
+
+bool CZedTracker::GetPoseAt(uint64_t ulTimestampNs, DriverPose_t* pPose) const
+{
+	PoseHistorySample_t sample;
+	if (!m_poseHistory.Query(ulTimestampNs, &sample))
+		return false;
+
+	// the rest of the pose (transforms, result) is whatever was last published
+	ZedPublishedPose_t published;
+	if (m_poseHandoff.Read(&published) == 0 || !published.pose.poseIsValid)
+		return false;
+
+	*pPose = published.pose;
+	pPose->qRotation = sample.qRotation;
+	for (int i = 0; i < 3; i++)
+	{
+		pPose->vecPosition[i] = sample.vecPosition[i];
+		pPose->vecVelocity[i] = sample.vecVelocity[i];
+		pPose->vecAngularVelocity[i] = sample.vecAngularVelocity[i];
+	}
+	pPose->poseTimeOffset = 0.0;
+	return true;
+}
+
+bool CZedTracker::ShouldSubmitPose(const DriverPose_t& pose, uint64_t ulSampleTimestampNs)
+{
+	std::lock_guard<std::mutex> lock(m_publishFilterMutex);
+	return m_submitFilter.ShouldSubmit(pose, ulSampleTimestampNs, GetSteadyNanoseconds());
+}
+
+void CZedTracker::PredictPose(DriverPose_t* pPose)
+{
+	std::lock_guard<std::mutex> lock(m_publishFilterMutex);
+	if (!m_posePredictor.IsEnabled() || !pPose->poseIsValid || m_bReplay)
+		return;
+
+	// from the sample, poseTimeOffset from now, to the horizon past now
+	pPose->poseTimeOffset += m_posePredictor.Predict(pPose, 1, m_flPredictionHorizon - pPose->poseTimeOffset);
+}
+
+void CZedTracker::RecordPoseSubmitted(uint64_t ulSampleTimestampNs)
+{
+	// recorded timestamps can't be compared with the current time
+	if (m_bReplay)
+		return;
+
+	uint64_t ulNowNs = m_zed.getTimestamp(TIME_REFERENCE::CURRENT).getNanoseconds();
+	if (ulSampleTimestampNs != 0 && ulNowNs > ulSampleTimestampNs)
+		m_rgLatency[LatencyStage_ExposureToSubmit].Record(ulNowNs - ulSampleTimestampNs);
+}
+
+// CPU time consumed by a thread so far, 0 if it isn't running
+static double GetThreadCpuSeconds(std::thread* pThread)
+{
+	return GetThreadCpuNanoseconds(pThread) * 1e-9;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Once a second on the pool: where the tracking's CPU and GPU time
+// went since the last sample
+//-----------------------------------------------------------------------------
+void CZedTracker::SampleCosts()
+{
+	uint64_t ulNowNs = GetSteadyNanoseconds();
+	m_grabCpu.Sample(GetThreadCpuNanoseconds(m_pPoseThread), ulNowNs);
+	{
+		std::lock_guard<std::mutex> lock(m_imuThreadMutex);
+		m_imuCpu.Sample(GetThreadCpuNanoseconds(m_pImuThread) + GetThreadCpuNanoseconds(m_pImuPollThread), ulNowNs);
+	}
+	m_workerCpu.Sample(m_pWorkerPool->GetCpuNanoseconds(), ulNowNs);
+	m_passthroughGpu.Sample(m_gpuPassthrough.GetGpuNanoseconds(), ulNowNs);
+	m_mrCaptureGpu.Sample(m_mrCapture.GetGpuNanoseconds(), ulNowNs);
+	m_occlusionGpu.Sample(m_occlusionDepth.GetGpuNanoseconds(), ulNowNs);
+	m_proximityGpu.Sample(m_proximityWarning.GetGpuNanoseconds(), ulNowNs);
+}
+
+void CZedTracker::GetStats(ZedTrackerStats_t* pStats) const
+{
+	uint64_t ulNowNs = GetSteadyNanoseconds();
+
+	pStats->flGrabFps = m_flGrabFps.load();
+	pStats->unFramesDropped = m_unFramesDropped.load();
+	pStats->eTrackingState = m_eTrackingState.load();
+	pStats->ulFramesGrabbed = m_grabRate.GetTotal();
+	pStats->ulGrabFailures = m_ulGrabFailures.load();
+	pStats->ulRecorderDropped = m_recorder.GetDroppedCount();
+	pStats->bImuPublisherRunning = m_bImuPublisherRunning.load();
+	pStats->flImuRate = m_imuRate.GetRate(ulNowNs);
+	pStats->ulImuSamples = m_imuRate.GetTotal();
+	pStats->ulImuSamplesMissed = m_ulImuSamplesMissed.load();
+	pStats->ulImuSamplesSkipped = m_ulImuSamplesSkipped.load();
+	pStats->bImuBiasCached = m_bImuBiasCached.load();
+	pStats->bImuBiasEstimated = m_bImuBiasEstimated.load();
+	pStats->flPosePublishRate = m_publishRate.GetRate(ulNowNs);
+	pStats->ulPosesPublished = m_publishRate.GetTotal();
+	pStats->flPoseThreadCpuSeconds = GetThreadCpuSeconds(m_pPoseThread);
+	pStats->eCameraProfile = m_eRequestedProfile.load();
+	pStats->bRelocalizing = m_bRelocalizing.load();
+	std::shared_ptr<const ZedTrackerConfig_t> pConfig = std::atomic_load(&m_pConfig);
+	pStats->bFloorDetected = pConfig && pConfig->bFloorDetected;
+	pStats->flFloorHeight = pStats->bFloorDetected ? pConfig->flFloorHeight : 0.0;
+	pStats->nGrabDivisor = m_governor.GetDivisor();
+	pStats->flMotionEnergy = m_governor.GetMotionEnergy();
+	pStats->flGpuLoad = m_governor.GetGpuLoad();
+	pStats->flFrameCpuMs = m_governor.GetFrameCpuMs();
+	{
+		std::lock_guard<std::mutex> lock(m_publishFilterMutex);
+		pStats->ulPosesDeduplicated = m_submitFilter.GetSkippedCount();
+	}
+	pStats->bDeadReckoning = m_bDeadReckoning.load();
+	pStats->ulTrackingLosses = m_ulTrackingLosses.load();
+	ClockFit_t clockFit;
+	pStats->bClockFit = m_clockTranslator.GetFit(&clockFit);
+	pStats->flClockDriftPpm = pStats->bClockFit ? clockFit.flDrift * 1e6 : 0.0;
+	pStats->flClockResidualUs = pStats->bClockFit ? clockFit.flResidualNs * 1e-3 : 0.0;
+	pStats->bGrabStalled = m_watchdog.IsStalled();
+	pStats->ulGrabStalls = m_watchdog.GetStallCount();
+	pStats->grabAllocations = m_grabAllocations.GetCounts();
+	pStats->imuAllocations = m_imuAllocations.GetCounts();
+	m_svoRecorder.GetStats(&pStats->recording);
+	pStats->flGrabCpuLoad = m_grabCpu.GetLoad();
+	pStats->flImuCpuLoad = m_imuCpu.GetLoad();
+	pStats->flWorkerCpuLoad = m_workerCpu.GetLoad();
+	pStats->flPassthroughGpuLoad = m_passthroughGpu.GetLoad();
+	pStats->flMrCaptureGpuLoad = m_mrCaptureGpu.GetLoad();
+	pStats->flOcclusionGpuLoad = m_occlusionGpu.GetLoad();
+	pStats->flProximityGpuLoad = m_proximityGpu.GetLoad();
+	pStats->flGpuUsedMb = m_flGpuUsedMb.load();
+	pStats->flGpuTotalMb = m_flGpuTotalMb.load();
+	{
+		// the grab thread replaces the IMU thread when it reopens the camera
+		std::lock_guard<std::mutex> lock(m_imuThreadMutex);
+		pStats->flImuThreadCpuSeconds = GetThreadCpuSeconds(m_pImuThread) + GetThreadCpuSeconds(m_pImuPollThread);
+	}
+}
+
+void CZedTracker::UpdateSettings(const ZedmSettings_t& settings)
+{
+	std::shared_ptr<const ZedTrackerConfig_t> pPrevious;
+	{
+		std::lock_guard<std::mutex> lock(m_configMutex);
+		pPrevious = std::atomic_load(&m_pConfig);
+		bool bFloorDetected = pPrevious && pPrevious->bFloorDetected;
+		std::atomic_store(&m_pConfig, CreateTrackerConfig(settings, bFloorDetected, bFloorDetected ? pPrevious->flFloorHeight : 0.0));
+		m_unSettingsVersion.fetch_add(1, std::memory_order_release);
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_publishFilterMutex);
+		ConfigurePublishFilters(&m_poseFilter, &m_submitFilter, &m_posePredictor, &m_bodyTracker, &m_objectTracker, settings);
+		m_flPredictionHorizon = settings.flPredictionHorizon;
+	}
+
+	if (!m_bReplay)
+		m_watchdog.SetStallTimeout(settings.flGrabStallTimeout);
+
+	ECameraProfile eProfile;
+	if (pPrevious && settings.sCameraProfile != pPrevious->settings.sCameraProfile && FindCameraProfile(settings.sCameraProfile.c_str(), &eProfile))
+		RequestCameraProfile(eProfile);
+}
+
+void CZedTracker::SetFloorHeight(bool bDetected, double flFloorHeight)
+{
+	std::lock_guard<std::mutex> lock(m_configMutex);
+	std::shared_ptr<const ZedTrackerConfig_t> pPrevious = std::atomic_load(&m_pConfig);
+	if (pPrevious->bFloorDetected == bDetected && (!bDetected || pPrevious->flFloorHeight == flFloorHeight))
+		return;
+	std::atomic_store(&m_pConfig, CreateTrackerConfig(pPrevious->settings, bDetected, flFloorHeight));
+	m_unSettingsVersion.fetch_add(1, std::memory_order_release);
+}
+
+bool CZedTracker::RefreshConfig(std::shared_ptr<const ZedTrackerConfig_t>* ppConfig, uint32_t* punVersion) const
+{
+	uint32_t unVersion = m_unSettingsVersion.load(std::memory_order_acquire);
+	if (unVersion == *punVersion && *ppConfig)
+		return false;
+
+	*ppConfig = std::atomic_load(&m_pConfig);
+	*punVersion = unVersion;
+	return true;
+}
+
+void CZedTracker::GetPoseTemplate(DriverPose_t* pPose) const
+{
+	std::shared_ptr<const ZedTrackerConfig_t> pConfig = std::atomic_load(&m_pConfig);
+	if (pConfig)
+		*pPose = pConfig->poseTemplate;
+	else
+		*pPose = CreateTrackerConfig(ZedmSettings_t())->poseTemplate;
+}
+
+void CZedTracker::BuildPoseTemplate(const ZedmSettings_t& settings, DriverPose_t* pPose)
+{
+	*pPose = CreateTrackerConfig(settings)->poseTemplate;
+}
+
+bool CZedTracker::RequestCameraProfile(ECameraProfile eProfile)
+{
+	// reopening would restart the recording
+	if (m_bReplay)
+		return false;
+
+	m_eRequestedProfile = CapCameraProfile(eProfile);
+	return true;
+}
+
+bool CZedTracker::RequestRecording(bool bRecord)
+{
+	// a replay is a recording already
+	if (m_bReplay)
+		return false;
+
+	m_svoRecorder.Request(bRecord);
+	return true;
+}
+
+// cameraPlanner: nothing more demanding than the camera's USB controller has bandwidth for; memoryBudgetGpu may lower it further
+ECameraProfile CZedTracker::CapCameraProfile(ECameraProfile eProfile) const
+{
+	if (m_nProfileCeiling >= 0 && eProfile > m_nProfileCeiling)
+	{
+		DriverLog("ZED %u: camera profile %s limited to %s by the camera planner or memory budget\n", m_unCameraSerial, GetCameraProfile(eProfile).pchName,
+			GetCameraProfile((ECameraProfile)m_nProfileCeiling).pchName);
+		return (ECameraProfile)m_nProfileCeiling;
+	}
+	return eProfile;
+}
+
+uint64_t CZedTracker::GetCameraTimeNs()
+{
+	uint64_t ulCameraNs;
+	if (!m_bReplay && m_clockTranslator.ToSource(GetSteadyNanoseconds(), &ulCameraNs))
+		return ulCameraNs;
+	return m_zed.getTimestamp(TIME_REFERENCE::CURRENT).getNanoseconds();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Grab thread, with the camera open: one more pair of ZED and steady
+// clock readings for the translation, every k_ulClockPairIntervalNs. The SDK
+// call is bracketed by two steady clock reads; of a few tries the tightest
+// bracket is kept, since a wide one means the thread was preempted in between.
+//-----------------------------------------------------------------------------
+void CZedTracker::UpdateClockTranslation()
+{
+	uint64_t ulNowNs = GetSteadyNanoseconds();
+	if (m_bReplay || ulNowNs < m_ulNextClockPairNs)
+		return;
+	m_ulNextClockPairNs = ulNowNs + k_ulClockPairIntervalNs;
+
+	uint64_t ulBestCameraNs = 0, ulBestBeforeNs = 0, ulBestAfterNs = ~0ull;
+	for (int i = 0; i < 3; i++)
+	{
+		uint64_t ulBeforeNs = GetSteadyNanoseconds();
+		uint64_t ulCameraNs = m_zed.getTimestamp(TIME_REFERENCE::CURRENT).getNanoseconds();
+		uint64_t ulAfterNs = GetSteadyNanoseconds();
+		if (ulAfterNs - ulBeforeNs < ulBestAfterNs - ulBestBeforeNs)
+		{
+			ulBestCameraNs = ulCameraNs;
+			ulBestBeforeNs = ulBeforeNs;
+			ulBestAfterNs = ulAfterNs;
+		}
+	}
+	m_clockTranslator.AddPair(ulBestCameraNs, ulBestBeforeNs, ulBestAfterNs);
+}
+
+void CZedTracker::SetVsync(uint64_t ulVsyncNs, double flFrameSeconds)
+{
+	m_vsync.SetVsync(ulVsyncNs, flFrameSeconds, GetSteadyNanoseconds());
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: IMU publisher, vsyncPublish: submits the newest published pose at
+// its scheduled time. It was published a moment ago, so its time offset is
+// taken again against the time it is actually submitted at.
+//-----------------------------------------------------------------------------
+void CZedTracker::SubmitLatestPose()
+{
+	TrackedDeviceIndex_t unObjectId = m_unObjectId.load();
+	ZedPublishedPose_t published;
+	if (unObjectId == k_unTrackedDeviceIndexInvalid || m_poseHandoff.Read(&published) == 0)
+		return;
+
+	if (published.ulSampleTimestampNs != 0)
+		published.pose.poseTimeOffset = GetPoseTimeOffset(published.ulSampleTimestampNs);
+	if (!ShouldSubmitPose(published.pose, published.ulSampleTimestampNs))
+		return;
+	PredictPose(&published.pose);
+	TRACE_ZONE("TrackedDevicePoseUpdated");
+	VRServerDriverHost()->TrackedDevicePoseUpdated(unObjectId, published.pose, sizeof(DriverPose_t));
+	RecordPoseSubmitted(published.ulSampleTimestampNs);
+}
+
+void CZedTracker::ResetLatencyStats()
+{
+	for (int i = 0; i < LatencyStage_Count; i++)
+		m_rgLatency[i].Reset();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: poseTimeOffset for a sample captured at ulSampleTimestampNs (ZED
+// clock), relative to now. Negative: the sample is already in the past.
+//-----------------------------------------------------------------------------
+double CZedTracker::GetPoseTimeOffset(uint64_t ulSampleTimestampNs)
+{
+	if (m_bReplay)
+		return 0.0;
+
+	// SteamVR's time base is the steady clock (QueryPerformanceCounter on Windows)
+	uint64_t ulSampleSteadyNs;
+	if (ulSampleTimestampNs != 0 && m_clockTranslator.ToTarget(ulSampleTimestampNs, &ulSampleSteadyNs))
+		return ((int64_t)ulSampleSteadyNs - (int64_t)GetSteadyNanoseconds()) * 1e-9;
+
+	// until the first pair, the SDK's current time is the best there is
+	uint64_t ulNowNs = m_zed.getTimestamp(TIME_REFERENCE::CURRENT).getNanoseconds();
+	if (ulNowNs == 0 || ulSampleTimestampNs == 0)
+		return 0.0;
+	return ((int64_t)ulSampleTimestampNs - (int64_t)ulNowNs) * 1e-9;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Tracking log output from the grab thread. These are binary records,
+// so the grab thread only copies the values; by default only a summary line
+// every traceInterval frames is written, if any. The per-frame dump needs
+// traceEveryFrame and is compiled out of release builds.
+//-----------------------------------------------------------------------------
+void CZedTracker::TraceFrame(const ZedVisualPose_t& visual)
+{
+	if (m_pGrabConfig->settings.bTraceEveryFrame)
+	{
+		DriverLogTrace("Frame %llu: Tx: %.3f, Ty: %.3f, Tz: %.3f, Ox: %.3f, Oy: %.3f, Oz: %.3f, Ow: %.3f\n",
+			(long long unsigned int)visual.ulTimestampNs, visual.vecPosition[0], visual.vecPosition[1], visual.vecPosition[2],
+			visual.qRotation.x, visual.qRotation.y, visual.qRotation.z, visual.qRotation.w);
+		return;
+	}
+
+	if (m_pGrabConfig->settings.nTraceInterval <= 0 || ++m_unFramesSinceTrace < (uint32_t)m_pGrabConfig->settings.nTraceInterval)
+		return;
+	m_unFramesSinceTrace = 0;
+
+	DriverLogInfo("Tracking: %.1f fps, position (%.3f, %.3f, %.3f), speed %.2f m/s\n", m_zed.getCurrentFPS(),
+		visual.vecPosition[0], visual.vecPosition[1], visual.vecPosition[2],
+		sqrt(visual.vecVelocity[0] * visual.vecVelocity[0] + visual.vecVelocity[1] * visual.vecVelocity[1] + visual.vecVelocity[2] * visual.vecVelocity[2]));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: roiMaskPath as the U8_C1 mask setRegionOfInterest takes, at the
+// camera's resolution. A pixel is kept if any color channel is above zero;
+// a mask drawn at another resolution is scaled, so one file works with every
+// cameraProfile. *pflMasked is the share of the image left out.
+//-----------------------------------------------------------------------------
+static bool LoadRoiMask(const std::string& sPath, const Resolution& resolution, Mat* pMask, double* pflMasked)
+{
+	Mat image;
+	if (image.read(sPath.c_str()) != ERROR_CODE::SUCCESS || image.getWidth() == 0 || image.getHeight() == 0)
+		return false;
+
+	MAT_TYPE eType = image.getDataType();
+	if (eType != MAT_TYPE::U8_C1 && eType != MAT_TYPE::U8_C2 && eType != MAT_TYPE::U8_C3 && eType != MAT_TYPE::U8_C4)
+		return false;
+	if (pMask->alloc(resolution, MAT_TYPE::U8_C1) != ERROR_CODE::SUCCESS)
+		return false;
+
+	// alpha isn't part of the mask
+	size_t unChannels = (size_t)image.getChannels();
+	size_t unColorChannels = unChannels == 2 || unChannels == 4 ? unChannels - 1 : unChannels;
+
+	const uint8_t* pSource = image.getPtr<uint8_t>(MEM::CPU);
+	uint8_t* pDest = pMask->getPtr<uint8_t>(MEM::CPU);
+	if (!pSource || !pDest)
+		return false;
+	size_t unSourceStep = image.getStepBytes(MEM::CPU);
+	size_t unDestStep = pMask->getStepBytes(MEM::CPU);
+	size_t unSourceWidth = image.getWidth(), unSourceHeight = image.getHeight();
+
+	size_t unMasked = 0;
+	for (size_t y = 0; y < resolution.height; y++)
+	{
+		const uint8_t* pSourceRow = pSource + (y * unSourceHeight / resolution.height) * unSourceStep;
+		uint8_t* pDestRow = pDest + y * unDestStep;
+		for (size_t x = 0; x < resolution.width; x++)
+		{
+			const uint8_t* pPixel = pSourceRow + (x * unSourceWidth / resolution.width) * unChannels;
+			bool bKeep = false;
+			for (size_t c = 0; c < unColorChannels; c++)
+				bKeep = bKeep || pPixel[c] != 0;
+			pDestRow[x] = bKeep ? 255 : 0;
+			if (!bKeep)
+				unMasked++;
+		}
+	}
+	*pflMasked = resolution.area() ? (double)unMasked / resolution.area() : 0.0;
+	return true;
+}
+
+static bool FileExists(const std::string& sPath)
+{
+#if defined(_WIN32)
+	return GetFileAttributesA(sPath.c_str()) != INVALID_FILE_ATTRIBUTES;
+#else
+	struct stat fileStat;
+	return stat(sPath.c_str(), &fileStat) == 0;
+#endif
+}
+
+// replaces sTarget if it exists, in one step on both platforms
+static bool MoveFileOver(const std::string& sSource, const std::string& sTarget)
+{
+#if defined(_WIN32)
+	return MoveFileExA(sSource.c_str(), sTarget.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return rename(sSource.c_str(), sTarget.c_str()) == 0;
+#endif
+}
+
+// the features that use a depth map from every grab; positional tracking alone only needs the depth mode
+static bool NeedsDepthPerGrab(const ZedmSettings_t& settings)
+{
+	return !settings.bTrackingOnly || settings.bSpatialMapping || settings.bBodyTracking || settings.nObjectTrackers > 0 || settings.bMrCapture
+		|| settings.bOcclusionDepth || settings.bProximityWarning;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: cameraProfile "auto": picks the profile from this machine's
+// benchmark, running it first if autoTunePath has none for this camera, GPU
+// and SDK. Called from the grab thread before the camera first opens.
+//-----------------------------------------------------------------------------
+void CZedTracker::AutoTuneCameraProfile(const CCudaDeviceSelection& gpu)
+{
+	const ZedmSettings_t& settings = m_pGrabConfig->settings;
+	unsigned int unSerial = m_unCameraSerial;
+	if (unSerial == 0)
+	{
+		std::vector<unsigned int> vecSerials = EnumerateZedCameras();
+		unSerial = vecSerials.empty() ? 0 : vecSerials[0];
+	}
+	if (unSerial == 0)
+	{
+		DriverLog("No ZED to tune the camera profile for, using %s\n", GetCameraProfile(m_eActiveProfile).pchName);
+		return;
+	}
+	// sdkCachePath: OpenCamera refuses it too, and says why
+	if (!settings.sSdkCachePath.empty() && !IsCalibrationCached(settings.sSdkCachePath, unSerial))
+		return;
+
+	std::string sPath = settings.sAutoTunePath;
+	size_t unSerialPos = sPath.find("{serial}");
+	if (unSerialPos != std::string::npos)
+		sPath.replace(unSerialPos, strlen("{serial}"), std::to_string(unSerial));
+
+	std::string sFingerprint = GetAutoTuneFingerprint(GetZedModelName(unSerial), unSerial, gpu.GetDevice());
+	CameraAutoTune_t autoTune;
+	if (sPath.empty() || !LoadCameraAutoTune(sPath, &autoTune) || autoTune.sFingerprint != sFingerprint)
+	{
+		DriverLog("ZED %u: benchmarking the camera profiles on %s\n", unSerial, sFingerprint.c_str());
+		PublishTrackingLost(TrackingResult_Calibrating_InProgress);
+		autoTune.sFingerprint = sFingerprint;
+		for (int i = 0; i < CameraProfile_Count; i++)
+		{
+			const CameraProfileBenchmark_t& benchmark = autoTune.rgBenchmarks[i] = BenchmarkCameraProfile(unSerial, (ECameraProfile)i,
+				NeedsDepthPerGrab(settings), settings.sSdkCachePath, gpu, m_bStopRequested);
+			if (m_bStopRequested)
+				return;
+			if (benchmark.bRan)
+				DriverLog("ZED %u: %s %.1f fps, poses %.1f ms after the image (p95)\n", unSerial, GetCameraProfile((ECameraProfile)i).pchName,
+					benchmark.flFps, benchmark.flLatencyP95Ms);
+			else
+				DriverLog("ZED %u: %s doesn't run on this camera\n", unSerial, GetCameraProfile((ECameraProfile)i).pchName);
+		}
+		if (!sPath.empty() && !SaveCameraAutoTune(sPath, autoTune))
+			DriverLog("ZED %u: unable to save the camera profile benchmark to %s\n", unSerial, sPath.c_str());
+	}
+
+	// a profile requested meanwhile wins
+	ECameraProfile eInitialProfile = m_eActiveProfile;
+	ECameraProfile eProfile = CapCameraProfile(PickCameraProfile(autoTune, settings.flAutoTuneBudget));
+	if (m_eRequestedProfile.compare_exchange_strong(eInitialProfile, eProfile))
+		m_eActiveProfile = eProfile;
+	DriverLog("ZED %u: camera profile %s for a %.0f ms latency budget\n", unSerial, GetCameraProfile(eProfile).pchName, settings.flAutoTuneBudget);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Opens the camera and starts positional tracking and, on models
+// with an IMU, the IMU publisher. Called from the grab thread only.
+//-----------------------------------------------------------------------------
+ERROR_CODE CZedTracker::OpenCamera(const CCudaDeviceSelection& gpu)
+{
+	// Set configuration parameters
+	InitParameters init_params;
+	const CameraProfile_t& profile = GetCameraProfile(m_eActiveProfile);
+	init_params.camera_resolution = profile.eResolution;
+	init_params.camera_fps = profile.nFps;
+	init_params.depth_mode = profile.eDepthMode;
+	init_params.coordinate_system = COORDINATE_SYSTEM::RIGHT_HANDED_Y_UP; // Use a right-handed Y-up coordinate system
+	init_params.coordinate_units = UNIT::METER; // Set units in meters
+	init_params.sensors_required = true;
+	init_params.sdk_gpu_id = gpu.GetDevice();
+	init_params.sdk_cuda_ctx = gpu.GetContext();
+
+	m_runtimeParams = RuntimeParameters();
+	m_bDepthPerGrab = true;
+	const ZedmSettings_t& settings = m_pGrabConfig->settings;
+	if (!NeedsDepthPerGrab(settings))
+	{
+		// positional tracking needs a depth mode, but not a depth map for every grab
+		init_params.depth_stabilization = 0;
+		m_bDepthPerGrab = false;
+	}
+	m_runtimeParams.enable_depth = m_bDepthPerGrab;
+	if (settings.bBodyTracking || settings.nObjectTrackers > 0)
+		m_runtimeParams.measure3D_reference_frame = REFERENCE_FRAME::WORLD; // keypoints and objects in tracking space
+
+	// imuOnly: SDK 3.7 can't open the sensors alone, the image stream runs at the
+	// lowest rate there is and is never grabbed, so it costs no GPU time
+	m_bImuOnly = settings.bImuOnly && !m_bReplay && !m_bImuOnlyUnsupported;
+	if (m_bImuOnly)
+	{
+		init_params.camera_resolution = RESOLUTION::VGA;
+		init_params.camera_fps = 15;
+		init_params.depth_mode = DEPTH_MODE::NONE;
+		m_bDepthPerGrab = false;
+	}
+
+	if (m_bReplay)
+	{
+		init_params.input.setFromSVOFile(m_pGrabConfig->settings.sSvoPath.c_str());
+		init_params.svo_real_time_mode = m_pGrabConfig->settings.bSvoRealTime;
+		init_params.sensors_required = false;
+	}
+	else if (m_unCameraSerial != 0)
+	{
+		init_params.input.setFromSerialNumber(m_unCameraSerial);
+	}
+
+	// sdkCachePath: the calibration comes from the cache, never from the network
+	if (!m_bReplay && !settings.sSdkCachePath.empty())
+	{
+		unsigned int unSerial = m_unCameraSerial;
+		if (unSerial == 0)
+		{
+			// the SDK opens the first camera there is
+			std::vector<unsigned int> vecSerials = EnumerateZedCameras();
+			unSerial = vecSerials.empty() ? 0 : vecSerials[0];
+		}
+		if (unSerial != 0 && !IsCalibrationCached(settings.sSdkCachePath, unSerial))
+		{
+			DriverLog("ZED %u: no calibration in %s, not opening it; run zedm_prewarm with the camera connected\n", unSerial,
+				settings.sSdkCachePath.c_str());
+			return ERROR_CODE::CALIBRATION_FILE_NOT_AVAILABLE;
+		}
+		init_params.optional_settings_path = settings.sSdkCachePath.c_str();
+	}
+
+	// Open the camera
+	ERROR_CODE eError = m_zed.open(init_params);
+	if (eError != ERROR_CODE::SUCCESS)
+	{
+		DriverLog("Unable to open ZED %u: %s\n", m_unCameraSerial, toString(eError).c_str());
+		return eError;
+	}
+
+	if (m_bImuOnly && m_zed.getCameraInformation().camera_model == MODEL::ZED)
+	{
+		DriverLog("ZED %u has no IMU, imuOnly ignored\n", m_unCameraSerial);
+		m_bImuOnlyUnsupported = true;
+		m_zed.close();
+		return OpenCamera(gpu);
+	}
+
+	m_bAreaMapUsable = false;
+	m_bAreaSaveRunning = false;
+	m_bRelocalizing = false;
+	if (!m_bImuOnly && (eError = EnableTracking(profile, gpu)) != ERROR_CODE::SUCCESS)
+	{
+		m_zed.close();
+		return eError;
+	}
+
+	m_cameraComponent.SetCameraInformation(m_zed.getCameraInformation());
+	if (!m_bImuOnly && m_pGrabConfig->settings.bGpuPassthrough && !m_gpuPassthrough.Open(m_zed, m_pGrabConfig->settings.nPassthroughBuffers))
+		DriverLog("ZED %u: GPU passthrough unavailable\n", m_unCameraSerial);
+	if (!m_bImuOnly && m_pGrabConfig->settings.bMrCapture && !m_mrCapture.Open(m_zed, m_pGrabConfig->settings.nMrCaptureBuffers))
+		DriverLog("ZED %u: MR capture export unavailable\n", m_unCameraSerial);
+	if (!m_bImuOnly && m_pGrabConfig->settings.bOcclusionDepth && !m_occlusionDepth.Open(m_zed, (uint32_t)m_pGrabConfig->settings.nOcclusionDepthDivisor))
+		DriverLog("ZED %u: occlusion depth unavailable\n", m_unCameraSerial);
+	if (!m_bImuOnly && m_pGrabConfig->settings.bProximityWarning
+		&& !m_proximityWarning.Open(m_zed, (uint32_t)m_pGrabConfig->settings.nProximitySectors, m_pGrabConfig->settings.flProximityRange))
+		DriverLog("ZED %u: proximity warning unavailable\n", m_unCameraSerial);
+
+	// a new world frame; with an area file the search waits until it is relocalized
+	m_floorDetector.Reset();
+	SetFloorHeight(false, 0.0);
+
+	m_velocityEstimator.Reset();
+	m_fusion.Reset();
+	m_deadReckoner.Reset();
+	ConfigureFusion(&m_fusion, &m_deadReckoner, m_pGrabConfig->settings);
+	m_bDeadReckoning = false;
+	m_clockTranslator.Reset();
+	m_ulNextClockPairNs = 0;
+	m_bVisualTracked = false;
+	m_ulVisualLostNs = 0;
+	m_governor.Reset();
+	m_ulNextGrabNs = 0;
+
+	// Check if the camera is a ZED M and therefore if an IMU is available.
+	// IMU samples of a recording can't be polled against the current time.
+	m_bHasImu = m_zed.getCameraInformation().camera_model != MODEL::ZED;
+	LoadCachedImuBias();
+	StartImuPublisher();
+	if (m_bImuOnly)
+	{
+		// no frames to watch
+		DriverLog("ZED %u opened for orientation only (imuOnly)\n", m_unCameraSerial);
+		return ERROR_CODE::SUCCESS;
+	}
+	m_watchdog.Arm(GetSteadyNanoseconds());
+
+	DriverLog("ZED %u opened with camera profile %s\n", m_unCameraSerial, profile.pchName);
+
+	return ERROR_CODE::SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: OpenCamera, apart from imuOnly: positional tracking with the
+// area file, and the features that run on top of it
+//-----------------------------------------------------------------------------
+ERROR_CODE CZedTracker::EnableTracking(const CameraProfile_t& profile, const CCudaDeviceSelection& gpu)
+{
+	const ZedmSettings_t& settings = m_pGrabConfig->settings;
+	ERROR_CODE eError;
+
+	PositionalTrackingParameters tracking_parameters;
+	tracking_parameters.enable_area_memory = m_pGrabConfig->settings.bAllowAreaMemory && (profile.bAreaMemory || !m_pGrabConfig->settings.sAreaFilePath.empty());
+	tracking_parameters.enable_pose_smoothing = profile.bPoseSmoothing;
+
+	m_sAreaFilePath = m_pGrabConfig->settings.sAreaFilePath;
+	bool bLoadArea = !m_sAreaFilePath.empty() && FileExists(m_sAreaFilePath);
+	if (bLoadArea)
+		tracking_parameters.area_file_path = m_sAreaFilePath.c_str();
+
+	eError = m_zed.enablePositionalTracking(tracking_parameters);
+	if (bLoadArea && (eError == ERROR_CODE::INVALID_AREA_FILE || eError == ERROR_CODE::INCOMPATIBLE_AREA_FILE))
+	{
+		// e.g. saved by another SDK version; start a new map, which replaces it on close
+		DriverLog("ZED %u: ignoring area file %s: %s\n", m_unCameraSerial, m_sAreaFilePath.c_str(), toString(eError).c_str());
+		bLoadArea = false;
+		tracking_parameters.area_file_path = "";
+		eError = m_zed.enablePositionalTracking(tracking_parameters);
+	}
+	if (eError != ERROR_CODE::SUCCESS)
+	{
+		DriverLog("Unable to enable positional tracking on ZED %u: %s\n", m_unCameraSerial, toString(eError).c_str());
+		return eError;
+	}
+
+	if (!settings.sRoiMaskPath.empty())
+	{
+		std::string sRoiMaskPath = settings.sRoiMaskPath;
+		size_t unSerial = sRoiMaskPath.find("{serial}");
+		if (unSerial != std::string::npos)
+			sRoiMaskPath.replace(unSerial, strlen("{serial}"), std::to_string(m_zed.getCameraInformation().serial_number));
+
+		// feature extraction skips the masked pixels from the next grab on
+		Mat roiMask;
+		double flMasked = 0.0;
+		if (!LoadRoiMask(sRoiMaskPath, m_zed.getCameraInformation().camera_configuration.resolution, &roiMask, &flMasked))
+			DriverLog("ZED %u: unable to load the region of interest %s\n", m_unCameraSerial, sRoiMaskPath.c_str());
+		else if ((eError = m_zed.setRegionOfInterest(roiMask)) != ERROR_CODE::SUCCESS)
+			DriverLog("ZED %u: region of interest %s rejected: %s\n", m_unCameraSerial, sRoiMaskPath.c_str(), toString(eError).c_str());
+		else
+			DriverLog("ZED %u: region of interest %s, %.0f%% of the image left out\n", m_unCameraSerial, sRoiMaskPath.c_str(), flMasked * 100.0);
+	}
+
+	if (settings.bSpatialMapping)
+		m_spatialMapper.Enable(m_zed, settings.flSpatialMappingResolution, settings.flSpatialMappingRange, settings.flSpatialMappingInterval);
+	if (settings.bBodyTracking && !settings.sSdkCachePath.empty() && !IsBodyTrackingModelReady(gpu.GetDevice()))
+	{
+		// enabling it would optimize the model right here, on the grab thread
+		DriverLog("ZED %u: body tracking model not optimized for this GPU, body tracking off; run zedm_prewarm\n", m_unCameraSerial);
+	}
+	else if (settings.bBodyTracking)
+	{
+		m_bodyTracker.SetPoseTemplate(m_pGrabConfig->poseTemplate);
+		m_bodyTracker.Enable(m_zed, settings.flBodyConfidence, m_bReplay);
+	}
+	if (!settings.sMarkerIds.empty())
+	{
+		m_markerTracker.SetPoseTemplate(m_pGrabConfig->poseTemplate);
+		m_markerTracker.Enable(m_zed, settings, m_pWorkerPool);
+	}
+	if (settings.nObjectTrackers > 0 && !m_bodyTracker.IsEnabled())
+	{
+		m_objectTracker.SetPoseTemplate(m_pGrabConfig->poseTemplate);
+		m_objectTracker.Enable(m_zed, settings.nObjectTrackers, ParseObjectClasses(settings.sObjectClasses), settings.flObjectConfidence, m_bReplay);
+	}
+
+	m_bRelocalizing = bLoadArea;
+	m_ulRelocalizeStartNs = GetSteadyNanoseconds();
+	if (bLoadArea)
+		DriverLog("ZED %u: relocalizing in %s\n", m_unCameraSerial, m_sAreaFilePath.c_str());
+	return ERROR_CODE::SUCCESS;
+}
+
+void CZedTracker::StartImuPublisher()
+{
+	if (m_bReplay || !m_bHasImu || m_pImuThread)
+		return;
+
+	m_bGrabFailing = false;
+	m_bImuPublisherRunning = true;
+	std::lock_guard<std::mutex> lock(m_imuThreadMutex);
+	m_pImuPollThread = new std::thread(&CZedTracker::RunImuPoller, this);
+	m_pImuThread = new std::thread(&CZedTracker::RunImuPublisher, this);
+}
+
+void CZedTracker::StopImuPublisher()
+{
+	if (!m_pImuThread)
+		return;
+
+	m_bImuPublisherRunning = false;
+	m_imuRing.WakeReaders();
+	m_pImuThread->join();
+	m_pImuPollThread->join();
+	SaveImuBiasEstimate();
+
+	std::lock_guard<std::mutex> lock(m_imuThreadMutex);
+	delete m_pImuThread;
+	delete m_pImuPollThread;
+	m_pImuThread = nullptr;
+	m_pImuPollThread = nullptr;
+}
+
+void CZedTracker::CloseCamera()
+{
+	m_watchdog.Disarm();
+
+	// the IMU publisher reads from m_zed, stop it first
+	StopImuPublisher();
+
+	// the textures are registered in the SDK's CUDA context
+	m_gpuPassthrough.Close();
+	m_mrCapture.Close();
+	m_occlusionDepth.Close();
+	m_proximityWarning.Close();
+	m_spatialMapper.Disable(m_zed); // needs tracking still enabled
+	m_bodyTracker.Disable(m_zed);
+	m_objectTracker.Disable(m_zed);
+	m_markerTracker.Disable();
+	m_svoRecorder.Close(m_zed);
+
+	// Disable positional tracking and close the camera. With an area file the
+	// SDK writes the map while disabling; it goes to a temporary name first so
+	// an interrupted save never leaves a truncated map behind.
+	if (!m_sAreaFilePath.empty() && m_bAreaMapUsable)
+	{
+		m_zed.disablePositionalTracking((m_sAreaFilePath + ".tmp").c_str());
+		CommitAreaFile();
+	}
+	else
+	{
+		m_zed.disablePositionalTracking();
+	}
+	m_zed.close();
+	m_bRelocalizing = false;
+}
+
+bool CZedTracker::ReopenCamera(const CCudaDeviceSelection& gpu)
+{
+	uint32_t unOpenAttempts = 0;
+	do
+	{
+		PublishTrackingLost(TrackingResult_Calibrating_OutOfRange);
+		if (!SleepUnlessStopped(GetBackoffInterval(++unOpenAttempts, k_ReconnectMaxInterval), false))
+			return false;
+	} while (OpenCamera(gpu) != ERROR_CODE::SUCCESS);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The bias saved for this camera, if imuBiasPath has one, so the
+// poller corrects the samples before it has seen the camera at rest
+//-----------------------------------------------------------------------------
+void CZedTracker::LoadCachedImuBias()
+{
+	m_bImuBiasCached = false;
+	m_bImuBiasEstimated = false;
+	m_sImuBiasPath.clear();
+	if (!m_bHasImu || m_bReplay || m_pGrabConfig->settings.sImuBiasPath.empty())
+		return;
+
+	m_sImuBiasPath = m_pGrabConfig->settings.sImuBiasPath;
+	size_t unSerial = m_sImuBiasPath.find("{serial}");
+	if (unSerial != std::string::npos)
+		m_sImuBiasPath.replace(unSerial, strlen("{serial}"), std::to_string(m_zed.getCameraInformation().serial_number));
+
+	if (LoadImuBias(m_sImuBiasPath, &m_imuBias))
+	{
+		m_bImuBiasCached = true;
+		DriverLog("ZED %u: IMU bias from %s, gyro %.3f %.3f %.3f deg/s\n", m_unCameraSerial, m_sImuBiasPath.c_str(),
+			m_imuBias.vecGyro[0] / k_flDegreesToRadians, m_imuBias.vecGyro[1] / k_flDegreesToRadians, m_imuBias.vecGyro[2] / k_flDegreesToRadians);
+	}
+}
+
+// With the poller joined, keeps what it estimated for the next session
+void CZedTracker::SaveImuBiasEstimate()
+{
+	if (!m_bImuBiasEstimated || m_sImuBiasPath.empty())
+		return;
+	if (SaveImuBias(m_sImuBiasPath, m_imuBias))
+		DriverLog("ZED %u: IMU bias saved to %s\n", m_unCameraSerial, m_sImuBiasPath.c_str());
+	else
+		DriverLog("ZED %u: unable to save the IMU bias to %s\n", m_unCameraSerial, m_sImuBiasPath.c_str());
+}
+
+// Moves a completed save over the previous map
+bool CZedTracker::CommitAreaFile()
+{
+	std::string sTempPath = m_sAreaFilePath + ".tmp";
+	if (!FileExists(sTempPath) || !MoveFileOver(sTempPath, m_sAreaFilePath))
+	{
+		DriverLog("ZED %u: unable to save area file %s\n", m_unCameraSerial, m_sAreaFilePath.c_str());
+		return false;
+	}
+	DriverLog("ZED %u: area file saved to %s\n", m_unCameraSerial, m_sAreaFilePath.c_str());
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Background save requested through RequestAreaSave. saveAreaMap
+// returns at once and the SDK exports on its own thread; the grab loop only
+// polls the export state once per frame and commits the file when it's done.
+//-----------------------------------------------------------------------------
+void CZedTracker::UpdateAreaSave()
+{
+	if (m_bAreaSaveRunning)
+	{
+		AREA_EXPORTING_STATE eState = m_zed.getAreaExportState();
+		if (eState == AREA_EXPORTING_STATE::RUNNING)
+			return;
+
+		m_bAreaSaveRunning = false;
+		if (eState == AREA_EXPORTING_STATE::SUCCESS)
+			CommitAreaFile();
+		else
+			DriverLog("ZED %u: area export failed: %d\n", m_unCameraSerial, (int)eState);
+		return;
+	}
+
+	if (!m_bAreaSaveRequested.exchange(false) || m_sAreaFilePath.empty())
+		return;
+	if (!m_bAreaMapUsable)
+	{
+		DriverLog("ZED %u: not saving the area map before tracking has converged\n", m_unCameraSerial);
+		return;
+	}
+	m_bAreaSaveRunning = m_zed.saveAreaMap((m_sAreaFilePath + ".tmp").c_str()) == ERROR_CODE::SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Tells SteamVR the pose is unusable without waiting for a frame,
+// e.g. while grab() fails or the camera is being reopened.
+//-----------------------------------------------------------------------------
+void CZedTracker::PublishTrackingLost(ETrackingResult eResult)
+{
+	DriverPose_t pose = m_pGrabConfig->poseTemplate;
+	pose.poseIsValid = false;
+	pose.result = eResult;
+
+	PublishPose<PipelineProfile_Full>(pose, 0, SubmitsPoses());
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: While tracking is good only teaches the dead reckoner what the
+// accelerometer reads at rest. Once it is lost, starts from the fused pose and
+// integrates the accelerometer for deadReckoningTime; the orientation stays
+// the fused one, the IMU doesn't need the camera for that.
+//-----------------------------------------------------------------------------
+bool CZedTracker::UpdateDeadReckoning(POSITIONAL_TRACKING_STATE eTrackingState, const ImuRingSample_t& imu, CPoseFusion::FusedPose_t* pFused)
+{
+	double vecWorldAccel[3];
+	HmdQuaternion_RotateVector(pFused->qRotation, imu.vecAccel, vecWorldAccel);
+	uint64_t ulImuTimestamp = imu.ulTimestampNs;
+
+	if (eTrackingState == POSITIONAL_TRACKING_STATE::OK)
+	{
+		m_deadReckoner.AddTrackedSample(vecWorldAccel, ulImuTimestamp);
+		m_bDeadReckoning = false;
+		return true;
+	}
+
+	// OFF and the floor search aren't a loss, there is nothing to carry on from
+	bool bReckoned = false;
+	if (eTrackingState == POSITIONAL_TRACKING_STATE::SEARCHING || eTrackingState == POSITIONAL_TRACKING_STATE::FPS_TOO_LOW)
+	{
+		if (!m_deadReckoner.IsActive())
+			m_deadReckoner.Start(pFused->vecPosition, pFused->vecVelocity, ulImuTimestamp);
+		bReckoned = m_deadReckoner.AddSample(vecWorldAccel, ulImuTimestamp, pFused->vecPosition, pFused->vecVelocity);
+	}
+	m_bDeadReckoning = bReckoned;
+	return bReckoned;
+}
+
+static void ConfigureGovernor(CGrabRateGovernor* pGovernor, const ZedmSettings_t& settings, bool bReplay)
+{
+	pGovernor->Configure(settings.bFrameGovernor && !bReplay, settings.nGovernorMaxDivisor, settings.flGovernorMotionThreshold,
+		settings.flGovernorStaticTime, settings.flGovernorGpuLoad);
+	pGovernor->ConfigureFrameSkip(bReplay ? 1 : settings.nFrameSkip, bReplay ? 0.0f : settings.flFrameCpuBudget);
+}
+
+void CZedTracker::RunPoseTracking()
+{
+	RunGrabLoop();
+
+	std::lock_guard<std::mutex> lock(m_runMutex);
+	m_bGrabThreadExited = true;
+	m_runWake.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Grab loop for the ZED. Publishes every visual pose into the
+// handoffs; this thread never calls into the host. Returns with the camera
+// closed once stopped.
+//-----------------------------------------------------------------------------
+void CZedTracker::RunGrabLoop()
+{
+	CScopedThreadScheduling scheduling("Grab", m_pGrabConfig->settings);
+	CScopedAllocationAudit allocationAudit(&m_grabAllocations);
+	CCudaDeviceSelection gpu(m_pGrabConfig->settings);
+	m_velocityEstimator.SetSmoothingTimeConstant(m_pGrabConfig->settings.flVelocitySmoothing);
+	ConfigureGovernor(&m_governor, m_pGrabConfig->settings, m_bReplay);
+
+	try
+	{
+		if (m_bAutoTuneProfile)
+			AutoTuneCameraProfile(gpu);
+
+		uint32_t unOpenAttempts = 0;
+		while (OpenCamera(gpu) != ERROR_CODE::SUCCESS)
+		{
+			// a replay that won't open isn't going to start working
+			if (m_bReplay)
+				return;
+			PublishTrackingLost(TrackingResult_Calibrating_OutOfRange);
+			if (!SleepUnlessStopped(GetBackoffInterval(++unOpenAttempts, k_ReconnectMaxInterval), false))
+				return;
+		}
+
+		Pose zed_pose;
+
+		SensorsData sensor_data;
+		uint32_t unConsecutiveFailures = 0;
+		bool bLostPublished = false; // the pose without tracking was published, and nothing since
+		uint64_t ulLastFrameCpuNs = 0; // frameCpuBudget: the thread's CPU time at the last processed frame
+		uint64_t ulNextGpuMemorySampleNs = 0;
+
+		while (!m_bStopRequested)
+		{
+			if (!WaitWhilePaused(true))
+				break;
+
+			// grabStallTimeout: the watchdog saw no frame for a while
+			EGrabRecovery eRecovery = m_watchdog.TakeRecovery();
+			if (eRecovery == GrabRecovery_Regrab)
+			{
+				unConsecutiveFailures = 0;
+				m_bGrabFailing = false;
+				m_governor.Reset();
+				m_ulNextGrabNs = 0;
+				ulLastFrameCpuNs = 0;
+			}
+			else if (eRecovery == GrabRecovery_Reopen)
+			{
+				CloseCamera();
+				if (!ReopenCamera(gpu))
+					return;
+				DriverLog("ZED %u reopened after a stall\n", m_unCameraSerial);
+				unConsecutiveFailures = 0;
+				bLostPublished = false;
+				continue;
+			}
+
+			if (RefreshConfig(&m_pGrabConfig, &m_unGrabSettingsVersion))
+			{
+				m_velocityEstimator.SetSmoothingTimeConstant(m_pGrabConfig->settings.flVelocitySmoothing);
+				if (!m_bImuPublisherRunning)
+					ConfigureFusion(&m_fusion, &m_deadReckoner, m_pGrabConfig->settings);
+				m_bodyTracker.SetPoseTemplate(m_pGrabConfig->poseTemplate);
+				m_markerTracker.SetPoseTemplate(m_pGrabConfig->poseTemplate);
+				m_objectTracker.SetPoseTemplate(m_pGrabConfig->poseTemplate);
+				ConfigureGovernor(&m_governor, m_pGrabConfig->settings, m_bReplay);
+			}
+
+			ECameraProfile eRequestedProfile = m_eRequestedProfile.load();
+			if (eRequestedProfile != m_eActiveProfile)
+			{
+				ECameraProfile ePreviousProfile = m_eActiveProfile;
+				CloseCamera();
+				m_eActiveProfile = eRequestedProfile;
+				if (OpenCamera(gpu) != ERROR_CODE::SUCCESS)
+				{
+					// e.g. a frame rate this model doesn't support; fall back to the working profile
+					DriverLog("ZED %u: camera profile %s failed, staying on %s\n", m_unCameraSerial,
+						GetCameraProfile(eRequestedProfile).pchName, GetCameraProfile(ePreviousProfile).pchName);
+					m_eActiveProfile = ePreviousProfile;
+					m_eRequestedProfile.compare_exchange_strong(eRequestedProfile, ePreviousProfile);
+
+					uint32_t unOpenAttempts = 0;
+					while (OpenCamera(gpu) != ERROR_CODE::SUCCESS)
+					{
+						PublishTrackingLost(TrackingResult_Calibrating_OutOfRange);
+						if (!SleepUnlessStopped(GetBackoffInterval(++unOpenAttempts, k_ReconnectMaxInterval), false))
+							return;
+					}
+				}
+				unConsecutiveFailures = 0;
+				bLostPublished = false;
+			}
+
+			if (m_bImuOnly)
+			{
+				// nothing to grab, the IMU publisher does the tracking
+				UpdateClockTranslation();
+				if (!SleepUnlessStopped(std::chrono::milliseconds(100), true))
+					break;
+				continue;
+			}
+
+			m_cameraComponent.ApplyPendingSettings(m_zed);
+			UpdateAreaSave();
+			m_spatialMapper.Update(m_zed);
+			if (!m_bReplay)
+				m_svoRecorder.Update(m_zed, m_pGrabConfig->settings, m_unCameraSerial);
+
+			// depth for this grab only when a floor search follows it
+			uint64_t ulGrabStartNs = GetSteadyNanoseconds();
+			bool bFloorSearch = m_pGrabConfig->settings.bAutoFloorHeight && !m_bRelocalizing
+				&& m_eTrackingState.load() == POSITIONAL_TRACKING_STATE::OK && m_floorDetector.IsDue(ulGrabStartNs);
+			m_runtimeParams.enable_depth = m_bDepthPerGrab || bFloorSearch;
+
+			// frameGovernor: the frames in between are left to the SDK, which drops them
+			int nGrabDivisor = m_governor.Update(ulGrabStartNs);
+			if (ulGrabStartNs < m_ulNextGrabNs)
+			{
+				if (!SleepUnlessStopped(std::chrono::milliseconds((m_ulNextGrabNs - ulGrabStartNs) / 1000000), true))
+					break;
+				ulGrabStartNs = GetSteadyNanoseconds();
+			}
+
+			ERROR_CODE eGrabError;
+			{
+				TRACE_ZONE("grab");
+				eGrabError = m_zed.grab(m_runtimeParams);
+			}
+			if (eGrabError == ERROR_CODE::SUCCESS) {
+				if (unConsecutiveFailures >= k_unFailuresBeforeTrackingLost)
+					m_bGrabFailing = false;
+				unConsecutiveFailures = 0;
+				uint64_t ulGrabEndNs = GetSteadyNanoseconds();
+
+				// wake up half a frame early so the grab gets the Nth frame rather than the one after
+				uint64_t ulFramePeriodNs = 1000000000ull / (uint64_t)GetCameraProfile(m_eActiveProfile).nFps;
+				m_ulNextGrabNs = nGrabDivisor > 1 ? ulGrabEndNs + (nGrabDivisor - 1) * ulFramePeriodNs - ulFramePeriodNs / 2 : 0;
+				m_rgLatency[LatencyStage_Grab].Record(ulGrabEndNs - ulGrabStartNs);
+
+				// everything this thread did for the frame, inside the SDK and out; sleeps cost nothing
+				uint64_t ulFrameCpuNs = GetCurrentThreadCpuNanoseconds();
+				if (ulLastFrameCpuNs != 0 && ulFrameCpuNs >= ulLastFrameCpuNs)
+				{
+					m_rgLatency[LatencyStage_GrabCpu].Record(ulFrameCpuNs - ulLastFrameCpuNs);
+					m_governor.AddFrameCost(ulFrameCpuNs - ulLastFrameCpuNs, ulGrabEndNs);
+				}
+				ulLastFrameCpuNs = ulFrameCpuNs;
+
+				if (!m_bReplay)
+				{
+					uint64_t ulImageNs = m_zed.getTimestamp(TIME_REFERENCE::IMAGE).getNanoseconds();
+					uint64_t ulGrabReturnNs = m_zed.getTimestamp(TIME_REFERENCE::CURRENT).getNanoseconds();
+					if (ulImageNs != 0 && ulGrabReturnNs > ulImageNs)
+						m_rgLatency[LatencyStage_ExposureToGrab].Record(ulGrabReturnNs - ulImageNs);
+					UpdateClockTranslation();
+				}
+
+				POSITIONAL_TRACKING_STATE eTrackingState;
+				{
+					TRACE_ZONE("getPosition");
+					eTrackingState = m_zed.getPosition(zed_pose, REFERENCE_FRAME::WORLD);
+				}
+				m_eTrackingState = eTrackingState;
+				m_rgLatency[LatencyStage_GetPosition].Record(GetSteadyNanoseconds() - ulGrabEndNs);
+
+				m_grabRate.Tick(ulGrabEndNs);
+				m_flGrabFps = m_zed.getCurrentFPS();
+				m_unFramesDropped = m_zed.getFrameDroppedCount();
+				m_watchdog.FrameArrived(ulGrabEndNs, m_unFramesDropped.load());
+				m_svoRecorder.FrameGrabbed(m_zed);
+
+				// a driver call into the SDK's context, so not every frame
+				if (ulGrabEndNs >= ulNextGpuMemorySampleNs)
+				{
+					double flUsedMb, flTotalMb;
+					if (GetGpuMemoryMb(m_zed.getCUDAContext(), &flUsedMb, &flTotalMb))
+					{
+						m_flGpuUsedMb = (float)flUsedMb;
+						m_flGpuTotalMb = (float)flTotalMb;
+					}
+					ulNextGpuMemorySampleNs = ulGrabEndNs + k_ulGpuMemorySampleIntervalNs;
+				}
+
+				if (eTrackingState == POSITIONAL_TRACKING_STATE::OK)
+					m_bAreaMapUsable = true;
+				if (m_bRelocalizing)
+				{
+					// the pose jumps into the saved map's space once the SDK matches it;
+					// until then it's relative to wherever the camera started
+					double flRelocalizeSeconds = (GetSteadyNanoseconds() - m_ulRelocalizeStartNs) * 1e-9;
+					if (eTrackingState != POSITIONAL_TRACKING_STATE::OK && flRelocalizeSeconds < k_flRelocalizeTimeout)
+					{
+						PublishTrackingLost(TrackingResult_Calibrating_InProgress);
+						continue;
+					}
+					if (eTrackingState == POSITIONAL_TRACKING_STATE::OK)
+						DriverLog("ZED %u: relocalized after %.1f s\n", m_unCameraSerial, flRelocalizeSeconds);
+					else
+						DriverLog("ZED %u: no match in the area file after %.0f s, tracking from here\n", m_unCameraSerial, flRelocalizeSeconds);
+					m_velocityEstimator.Reset();
+					m_bRelocalizing = false;
+				}
+
+				double flFloorHeight;
+				if (bFloorSearch && eTrackingState == POSITIONAL_TRACKING_STATE::OK && m_floorDetector.Update(m_zed, ulGrabStartNs, &flFloorHeight))
+					SetFloorHeight(true, flFloorHeight);
+
+				// while tracking is lost the SDK pose is frozen, or jumps as it searches;
+				// none of it reaches the handoffs, the publisher dead reckons on the IMU instead
+				bool bTracked = eTrackingState == POSITIONAL_TRACKING_STATE::OK;
+				if (bTracked != m_bVisualTracked)
+				{
+					uint64_t ulNowNs = GetSteadyNanoseconds();
+					if (!bTracked)
+					{
+						DriverLog("ZED %u: visual tracking lost: %s\n", m_unCameraSerial, toString(eTrackingState).c_str());
+						m_ulTrackingLosses++;
+					}
+					else if (m_ulVisualLostNs != 0)
+						DriverLog("ZED %u: visual tracking back after %.1f s\n", m_unCameraSerial, (ulNowNs - m_ulVisualLostNs) * 1e-9);
+					m_ulVisualLostNs = bTracked ? 0 : ulNowNs;
+					m_bVisualTracked = bTracked;
+
+					// the velocity across the gap would be the jump between the two poses
+					m_velocityEstimator.Reset();
+				}
+
+				// get the translation information
+				auto zed_translation = zed_pose.getTranslation();
+
+				// get the orientation information
+				auto zed_orientation = zed_pose.getOrientation();
+
+				ZedVisualPose_t visual;
+				visual.vecPosition[0] = zed_translation.tx;
+				visual.vecPosition[1] = zed_translation.ty;
+				visual.vecPosition[2] = zed_translation.tz;
+				visual.qRotation = HmdQuaternion_Init(zed_orientation.ow, zed_orientation.ox, zed_orientation.oy, zed_orientation.oz);
+				visual.ulTimestampNs = zed_pose.timestamp.getNanoseconds();
+
+				// exposureTimestamp: auto exposure changes the exposure from frame to frame
+				if (m_pGrabConfig->settings.bExposureTimestamp)
+				{
+					uint64_t ulOffsetNs = GetMidExposureOffsetNs(m_zed.getCameraSettings(VIDEO_SETTINGS::EXPOSURE),
+						GetCameraProfile(m_eActiveProfile).nFps, m_pGrabConfig->settings.flCameraTransportDelay);
+					if (ulOffsetNs < visual.ulTimestampNs)
+						visual.ulTimestampNs -= ulOffsetNs;
+				}
+
+				if (bTracked)
+					m_velocityEstimator.AddSample(visual.vecPosition, visual.qRotation, visual.ulTimestampNs);
+				for (int i = 0; i < 3; i++)
+				{
+					visual.vecVelocity[i] = m_velocityEstimator.GetVelocity()[i];
+					visual.vecAngularVelocity[i] = m_velocityEstimator.GetAngularVelocity()[i];
+				}
+				if (bTracked)
+				{
+					m_visualPose.Write(visual);
+					RecordVisualPose(visual);
+					if (!m_bHasImu)
+						m_governor.AddVisualSample(visual.vecVelocity, visual.vecAngularVelocity, visual.ulTimestampNs);
+
+					TraceFrame(visual);
+				}
+
+				m_bodyTracker.Update(m_zed);
+				m_objectTracker.Update(m_zed);
+				if (bTracked && m_markerTracker.IsEnabled())
+					m_markerTracker.Update(m_zed, visual.vecPosition, visual.qRotation, visual.ulTimestampNs);
+
+				if (m_gpuPassthrough.IsOpen())
+					m_gpuPassthrough.SubmitFrame(m_zed, visual.ulTimestampNs);
+				if (m_occlusionDepth.IsOpen())
+					m_occlusionDepth.SubmitFrame(m_zed, visual.ulTimestampNs);
+
+				// the floor in driver space, as the chaperone generator finds it
+				if (bTracked && m_proximityWarning.IsOpen())
+					m_proximityWarning.SubmitFrame(m_zed, visual.vecPosition, visual.qRotation,
+						-m_pGrabConfig->poseTemplate.vecWorldFromDriverTranslation[1], visual.ulTimestampNs);
+
+				if (m_cameraComponent.IsStreaming() || m_mrCapture.IsOpen())
+				{
+					// the image was exposed at the visual sample, so that is the pose it goes with
+					DriverPose_t framePose = m_pGrabConfig->poseTemplate;
+					for (int i = 0; i < 3; i++)
+					{
+						framePose.vecPosition[i] = visual.vecPosition[i];
+						framePose.vecVelocity[i] = visual.vecVelocity[i];
+						framePose.vecAngularVelocity[i] = visual.vecAngularVelocity[i];
+					}
+					framePose.qRotation = visual.qRotation;
+					framePose.poseIsValid = bTracked;
+					framePose.result = GetTrackingResult(eTrackingState, false);
+					if (m_cameraComponent.IsStreaming())
+						m_cameraComponent.SubmitFrame(m_zed, framePose, visual.ulTimestampNs);
+
+					// for compositing, the published pose at the same instant
+					// matches the headset; the visual sample only if there is none
+					if (m_mrCapture.IsOpen())
+					{
+						DriverPose_t imagePose;
+						bool bPoseAtImage = bTracked && GetPoseAt(visual.ulTimestampNs, &imagePose);
+						m_mrCapture.SubmitFrame(m_zed, bPoseAtImage ? imagePose : framePose, bPoseAtImage, visual.ulTimestampNs);
+					}
+				}
+
+				// the IMU publisher owns the head pose between (and at) camera frames
+				if (m_bImuPublisherRunning)
+					continue;
+
+				// only the dynamic fields are filled in per frame
+				DriverPose_t pose = m_pGrabConfig->poseTemplate;
+				for (int i = 0; i < 3; i++)
+				{
+					pose.vecPosition[i] = visual.vecPosition[i];
+					pose.vecVelocity[i] = visual.vecVelocity[i];
+					pose.vecAngularVelocity[i] = visual.vecAngularVelocity[i];
+				}
+				pose.qRotation = visual.qRotation;
+				bool bValid = bTracked;
+
+				if (m_bHasImu)
+				{
+					// IMU sample closest to the image, so both halves of the pose are from the same instant
+					uint64_t ulSensorsStartNs = GetSteadyNanoseconds();
+					{
+						TRACE_ZONE("getSensorsData");
+						m_zed.getSensorsData(sensor_data, TIME_REFERENCE::IMAGE);
+					}
+					m_rgLatency[LatencyStage_GetSensorsData].Record(GetSteadyNanoseconds() - ulSensorsStartNs);
+					ImuRingSample_t imu;
+					FillImuRingSample(sensor_data.imu, &imu);
+					RecordImuSample(imu);
+					AddGovernorImuSample(imu);
+
+					// Filtered orientation quaternion
+					if (m_pGrabConfig->settings.bTraceEveryFrame)
+					{
+						DriverLogTrace("IMU Orientation: Ox: %.3f, Oy: %.3f, Oz: %.3f, Ow: %.3f\n", imu.qOrientation.x,
+							imu.qOrientation.y, imu.qOrientation.z, imu.qOrientation.w);
+					}
+
+					m_fusion.AddImuSample(imu.qOrientation, imu.ulTimestampNs);
+					if (bTracked)
+						m_fusion.AddVisualSample(visual.vecPosition, visual.vecVelocity, visual.qRotation, visual.ulTimestampNs);
+
+					CPoseFusion::FusedPose_t fused;
+					bool bFused;
+					{
+						TRACE_ZONE("fusion");
+						bFused = m_fusion.GetPose(visual.ulTimestampNs, &fused);
+					}
+					if (bFused)
+					{
+						bValid = UpdateDeadReckoning(eTrackingState, imu, &fused);
+						pose.qRotation = fused.qRotation;
+						if (!bTracked)
+						{
+							for (int i = 0; i < 3; i++)
+							{
+								pose.vecPosition[i] = fused.vecPosition[i];
+								pose.vecVelocity[i] = fused.vecVelocity[i];
+							}
+							HmdQuaternion_RotateVector(pose.qRotation, imu.vecGyro, pose.vecAngularVelocity);
+						}
+					}
+				}
+
+				if (!bValid)
+				{
+					if (!bLostPublished)
+						PublishTrackingLost(GetTrackingResult(eTrackingState, false));
+					bLostPublished = true;
+					continue;
+				}
+				bLostPublished = false;
+				pose.result = GetTrackingResult(eTrackingState, !bTracked);
+				pose.poseTimeOffset = GetPoseTimeOffset(visual.ulTimestampNs);
+
+				// a replay can outrun RunFrame, so every frame goes straight to the host
+				PublishPose<PipelineProfile_Full>(pose, visual.ulTimestampNs, m_bReplay);
+			}
+			else if (m_bReplay && eGrabError == ERROR_CODE::END_OF_SVOFILE_REACHED)
+			{
+				if (!m_pGrabConfig->settings.bSvoLoop)
+				{
+					DriverLog("End of %s\n", m_pGrabConfig->settings.sSvoPath.c_str());
+					break;
+				}
+
+				// back to the first frame; the pose there is unrelated to the last one, so tracking starts over
+				DriverLog("End of %s, looping\n", m_pGrabConfig->settings.sSvoPath.c_str());
+				m_zed.setSVOPosition(0);
+				if (!m_bImuOnly)
+					m_zed.resetPositionalTracking(Transform());
+				m_velocityEstimator.Reset();
+				PublishTrackingLost(TrackingResult_Calibrating_InProgress);
+				bLostPublished = true;
+			}
+			else
+			{
+				m_ulGrabFailures++;
+				unConsecutiveFailures++;
+
+				if (IsCameraLost(eGrabError))
+				{
+					DriverLog("ZED %u lost: %s, reconnecting\n", m_unCameraSerial, toString(eGrabError).c_str());
+					CloseCamera();
+					if (!ReopenCamera(gpu))
+						return;
+
+					DriverLog("ZED %u reconnected\n", m_unCameraSerial);
+					unConsecutiveFailures = 0;
+					bLostPublished = false;
+					continue;
+				}
+
+				// transient: report the gap once it outlasts a few frames, and stop
+				// retrying grab() at full speed. While the IMU publisher runs, poses
+				// are its alone to publish; it turns the flag into the lost pose.
+				if (unConsecutiveFailures == k_unFailuresBeforeTrackingLost)
+				{
+					if (m_bImuPublisherRunning)
+						m_bGrabFailing = true;
+					else
+						PublishTrackingLost(TrackingResult_Running_OutOfRange);
+				}
+				if (!SleepUnlessStopped(GetBackoffInterval(unConsecutiveFailures, k_GrabRetryMaxInterval), true))
+					break;
+			}
+		}
+		CloseCamera();
+	}
+	catch (const std::exception& e)
+	{
+		DriverLog("%s\n", e.what());
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads every IMU sample out of the SDK into m_imuRing and the
+// IOBuffer. getSensorsData only returns the newest sample, so it is asked
+// several times per sample period; the timestamps tell which answers are new
+// and how many samples went by unseen between two polls. With imuBiasPath
+// the samples are corrected with the cached bias until the first second at
+// rest has given this session's.
+//-----------------------------------------------------------------------------
+void CZedTracker::RunImuPoller()
+{
+	std::shared_ptr<const ZedTrackerConfig_t> pConfig;
+	uint32_t unSettingsVersion = 0;
+	RefreshConfig(&pConfig, &unSettingsVersion);
+
+	CScopedThreadScheduling scheduling("IMU poll", pConfig->settings);
+
+	float flImuRate = m_zed.getCameraInformation().sensors_configuration.accelerometer_parameters.sampling_rate;
+	uint64_t ulSamplePeriodNs = (uint64_t)(1e9 / (flImuRate > 0.0f ? flImuRate : k_flDefaultImuRate));
+
+	CPreciseTimer pollTimer;
+	pollTimer.Start((uint64_t)std::chrono::nanoseconds(k_ImuPollInterval).count(), &m_rgLatency[LatencyStage_ImuWake]);
+
+	// once per camera open, a resume from standby keeps the estimate
+	bool bEstimateBias = !m_sImuBiasPath.empty() && !m_bImuBiasEstimated;
+	bool bApplyBias = m_bImuBiasCached || m_bImuBiasEstimated;
+	CImuBiasEstimator biasEstimator;
+
+	SensorsData sensor_data;
+	uint64_t ulLastImuTimestamp = 0;
+	while (m_bImuPublisherRunning)
+	{
+		pollTimer.WaitForNextTick();
+
+		uint64_t ulSensorsStartNs = GetSteadyNanoseconds();
+		ERROR_CODE eSensorsError;
+		{
+			TRACE_ZONE("getSensorsData");
+			eSensorsError = m_zed.getSensorsData(sensor_data, TIME_REFERENCE::CURRENT);
+		}
+		if (eSensorsError != ERROR_CODE::SUCCESS)
+			continue;
+		m_rgLatency[LatencyStage_GetSensorsData].Record(GetSteadyNanoseconds() - ulSensorsStartNs);
+
+		uint64_t ulImuTimestamp = sensor_data.imu.timestamp.getNanoseconds();
+		if (ulImuTimestamp <= ulLastImuTimestamp)
+			continue;
+
+		// more than one and a half periods since the last sample seen means some came and went
+		if (ulLastImuTimestamp != 0)
+		{
+			uint64_t ulGapNs = ulImuTimestamp - ulLastImuTimestamp;
+			if (ulGapNs > ulSamplePeriodNs + ulSamplePeriodNs / 2)
+				m_ulImuSamplesMissed += (ulGapNs + ulSamplePeriodNs / 2) / ulSamplePeriodNs - 1;
+		}
+		ulLastImuTimestamp = ulImuTimestamp;
+
+		ImuRingSample_t imu;
+		FillImuRingSample(sensor_data.imu, &imu);
+		if (bEstimateBias && biasEstimator.AddSample(imu, &m_imuBias))
+		{
+			bEstimateBias = false;
+			bApplyBias = true;
+			m_bImuBiasEstimated = true;
+		}
+		if (bApplyBias)
+			ApplyImuBias(m_imuBias, &imu);
+		m_imuRing.Write(imu);
+		m_imuRate.Tick(GetSteadyNanoseconds());
+		RecordImuSample(imu);
+		WriteImuBuffer(imu);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: What the IMU publisher carries from one pipeline profile's loop
+// into the next, e.g. across a settings change that turns poseFilter on
+//-----------------------------------------------------------------------------
+struct ImuPublisherState_t
+{
+	std::shared_ptr<const ZedTrackerConfig_t> pConfig;
+	uint32_t unSettingsVersion;
+	CPreciseTimer publishTimer;
+	uint64_t ulNextSample;
+	bool bLostPublished;
+	bool bSeedGravity;
+
+	// vsyncPublish: the next submission, 0 while poses go out as they are published
+	uint64_t ulNextSubmitNs;
+	bool bPosePending;
+};
+
+// the profile for the current settings; fusion is fixed per camera open, the recorder for the tracker's life
+uint32_t CZedTracker::SelectPipelineProfile(const ZedmSettings_t& settings) const
+{
+	bool bOptional = settings.bPoseFilter || settings.flPredictionHorizon > 0.0f || m_recorder.IsOpen();
+	if (m_bImuOnly)
+		return bOptional ? PipelineProfile_ImuOnlyFull : PipelineProfile_ImuOnly;
+	return bOptional ? PipelineProfile_Full : PipelineProfile_Tracking;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Feeds every IMU sample the poller read to the fusion and the dead
+// reckoner, and emits a pose for the newest of them, reusing the last visual
+// translation, or dead reckoning from it while visual tracking is lost. The
+// loop itself is RunImuPublisherPipeline, instantiated per EPipelineStage
+// profile.
+//-----------------------------------------------------------------------------
+void CZedTracker::RunImuPublisher()
+{
+	CScopedAllocationAudit allocationAudit(&m_imuAllocations);
+	ImuPublisherState_t state;
+	state.unSettingsVersion = 0;
+	RefreshConfig(&state.pConfig, &state.unSettingsVersion);
+	ConfigureFusion(&m_fusion, &m_deadReckoner, state.pConfig->settings);
+
+	CScopedThreadScheduling scheduling("IMU", state.pConfig->settings);
+
+	// vsyncPublish drains on an absolute schedule, so the time spent in each pass doesn't stretch the interval
+	state.publishTimer.Start((uint64_t)std::chrono::nanoseconds(k_ImuPublishInterval).count());
+
+	// only what arrives from now on, the ring may hold samples of the previous camera
+	state.ulNextSample = m_imuRing.GetWriteCount();
+	state.bLostPublished = false;
+
+	// corrected samples read gravity alone at rest, the dead reckoner needn't wait to learn it
+	state.bSeedGravity = m_bImuBiasCached || m_bImuBiasEstimated;
+
+	state.ulNextSubmitNs = 0;
+	state.bPosePending = false;
+
+	while (m_bImuPublisherRunning)
+	{
+		uint32_t unProfile = SelectPipelineProfile(state.pConfig->settings);
+		DriverLog("ZED %u: IMU publisher pipeline %s%s%s\n", m_unCameraSerial, (unProfile & PipelineStage_Fusion) ? "6DOF" : "3DOF",
+			(unProfile & PipelineStage_Filter) ? ", filtered" : "", (unProfile & PipelineStage_Record) ? ", recorded" : "");
+		switch (unProfile)
+		{
+		case PipelineProfile_ImuOnly:
+			RunImuPublisherPipeline<PipelineProfile_ImuOnly>(&state);
+			break;
+		case PipelineProfile_ImuOnlyFull:
+			RunImuPublisherPipeline<PipelineProfile_ImuOnlyFull>(&state);
+			break;
+		case PipelineProfile_Tracking:
+			RunImuPublisherPipeline<PipelineProfile_Tracking>(&state);
+			break;
+		default:
+			RunImuPublisherPipeline<PipelineProfile_Full>(&state);
+			break;
+		}
+	}
+}
+
+template <uint32_t unStages>
+void CZedTracker::RunImuPublisherPipeline(ImuPublisherState_t* pState)
+{
+	ImuRingSample_t rgSamples[k_unImuDrainBatch];
+
+	while (m_bImuPublisherRunning)
+	{
+		// woken by the poller's write, the sample is published microseconds after it landed.
+		// Submissions need the precise timer; wake up for them rather than up to a publish
+		// interval after.
+		if (pState->ulNextSubmitNs == 0)
+			m_imuRing.WaitForWrite(pState->ulNextSample, GetSteadyNanoseconds() + (uint64_t)std::chrono::nanoseconds(k_ImuIdleWait).count());
+		else if (pState->ulNextSubmitNs < pState->publishTimer.GetNextTickNs())
+			pState->publishTimer.SleepUntil(pState->ulNextSubmitNs);
+		else
+			pState->publishTimer.WaitForNextTick();
+
+		if (RefreshConfig(&pState->pConfig, &pState->unSettingsVersion))
+		{
+			ConfigureFusion(&m_fusion, &m_deadReckoner, pState->pConfig->settings);
+			if (SelectPipelineProfile(pState->pConfig->settings) != unStages)
+				return;
+		}
+		const ZedTrackerConfig_t& config = *pState->pConfig;
+
+		// submissions are scheduled one at a time, each from the then latest vsync
+		uint64_t ulNowNs = GetSteadyNanoseconds();
+		if (!config.settings.bVsyncPublish)
+		{
+			pState->ulNextSubmitNs = 0;
+		}
+		else if (pState->ulNextSubmitNs == 0 || ulNowNs >= pState->ulNextSubmitNs)
+		{
+			if (pState->ulNextSubmitNs != 0 && pState->bPosePending)
+				SubmitLatestPose();
+			pState->bPosePending = false;
+
+			uint64_t ulLeadNs = (uint64_t)(config.settings.flVsyncPublishLead > 0.0f ? config.settings.flVsyncPublishLead * 1e9 : 0.0);
+			if (!m_vsync.GetSubmitTime(ulNowNs, ulLeadNs, &pState->ulNextSubmitNs))
+				pState->ulNextSubmitNs = 0;
+		}
+		bool bSubmitNow = pState->ulNextSubmitNs == 0;
+
+		uint64_t ulSkipped = 0;
+		uint32_t unSamples = m_imuRing.Read(&pState->ulNextSample, rgSamples, k_unImuDrainBatch, &ulSkipped);
+		m_ulImuSamplesSkipped += ulSkipped;
+		if (unSamples == 0)
+			continue;
+		const ImuRingSample_t& newest = rgSamples[unSamples - 1];
+
+		for (uint32_t i = 0; i < unSamples; i++)
+			AddGovernorImuSample(rgSamples[i]);
+
+		if (!(unStages & PipelineStage_Fusion))
+		{
+			// 3DOF: the SDK's gravity aligned orientation at the origin, yaw drifts slowly
+			DriverPose_t pose = config.poseTemplate;
+			pose.qRotation = newest.qOrientation;
+			HmdQuaternion_RotateVector(pose.qRotation, newest.vecGyro, pose.vecAngularVelocity);
+			pose.poseTimeOffset = GetPoseTimeOffset(newest.ulTimestampNs);
+			PublishPose<unStages>(pose, newest.ulTimestampNs, bSubmitNow);
+			pState->bPosePending = !bSubmitNow;
+			continue;
+		}
+		for (uint32_t i = 0; i < unSamples; i++)
+			m_fusion.AddImuSample(rgSamples[i].qOrientation, rgSamples[i].ulTimestampNs);
+		if (pState->bSeedGravity)
+		{
+			double vecGravity[3] = { 0.0, k_flStandardGravity, 0.0 };
+			m_deadReckoner.SeedGravity(vecGravity, rgSamples[0].ulTimestampNs);
+			pState->bSeedGravity = false;
+		}
+
+		// grab() keeps failing, the visual pose is stale: lost once, as the grab thread would
+		// have said. 3DOF poses don't need the camera's frames and go on.
+		if (m_bGrabFailing)
+		{
+			if (!pState->bLostPublished)
+			{
+				DriverPose_t lostPose = config.poseTemplate;
+				lostPose.poseIsValid = false;
+				lostPose.result = TrackingResult_Running_OutOfRange;
+				PublishPose<unStages>(lostPose, 0, true);
+			}
+			pState->bLostPublished = true;
+			pState->bPosePending = false;
+			continue;
+		}
+
+		// no position to pair the orientation with until the first frame is tracked,
+		// or until the grab thread has relocalized in the saved map
+		ZedVisualPose_t visual;
+		if (m_bRelocalizing || m_visualPose.Read(&visual) == 0)
+			continue;
+		m_fusion.AddVisualSample(visual.vecPosition, visual.vecVelocity, visual.qRotation, visual.ulTimestampNs);
+
+		// the visual pose above is the last one tracked; past the horizon SteamVR is told once.
+		// A stalled grab thread leaves the state as it was, a stall is a loss of tracking too.
+		POSITIONAL_TRACKING_STATE eTrackingState = m_watchdog.IsStalled() ? POSITIONAL_TRACKING_STATE::SEARCHING : m_eTrackingState.load();
+
+		// the dead reckoner integrates every sample, only the newest one's pose is published
+		CPoseFusion::FusedPose_t fused;
+		bool bFused = false;
+		bool bValid = false;
+		{
+			TRACE_ZONE("fusion");
+			for (uint32_t i = 0; i < unSamples; i++)
+			{
+				if (!m_fusion.GetPose(rgSamples[i].ulTimestampNs, &fused))
+					continue;
+				bFused = true;
+				bValid = UpdateDeadReckoning(eTrackingState, rgSamples[i], &fused);
+			}
+		}
+		if (!bFused)
+			continue;
+
+		if (!bValid)
+		{
+			if (!pState->bLostPublished)
+			{
+				DriverPose_t lostPose = config.poseTemplate;
+				lostPose.poseIsValid = false;
+				lostPose.result = GetTrackingResult(eTrackingState, false);
+				PublishPose<unStages>(lostPose, 0, true);
+			}
+			pState->bLostPublished = true;
+			pState->bPosePending = false;
+			continue;
+		}
+		pState->bLostPublished = false;
+
+		DriverPose_t pose = config.poseTemplate;
+		pose.result = GetTrackingResult(eTrackingState, eTrackingState != POSITIONAL_TRACKING_STATE::OK);
+		for (int i = 0; i < 3; i++)
+		{
+			pose.vecPosition[i] = fused.vecPosition[i];
+			pose.vecVelocity[i] = fused.vecVelocity[i];
+		}
+		pose.qRotation = fused.qRotation;
+
+		// gyro rates are in the camera body frame, SteamVR expects driver world space
+		HmdQuaternion_RotateVector(pose.qRotation, newest.vecGyro, pose.vecAngularVelocity);
+
+		pose.poseTimeOffset = GetPoseTimeOffset(newest.ulTimestampNs);
+
+		// vsyncPublish: into the history and handoff now, to the host at the next submission
+		PublishPose<unStages>(pose, newest.ulTimestampNs, bSubmitNow);
+		pState->bPosePending = !bSubmitNow;
+	}
+}
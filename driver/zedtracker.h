@@ -0,0 +1,496 @@
+#ifndef ZEDTRACKER_H
+#define ZEDTRACKER_H
+
+#pragma once
+
+#include <openvr_driver.h>
+#include <sl/Camera.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "allocaudit.h"
+#include "bodytracker.h"
+#include "cameraprofile.h"
+#include "clocktranslator.h"
+#include "costmeter.h"
+#include "cudadevice.h"
+#include "deadreckoning.h"
+#include "driversettings.h"
+#include "floordetector.h"
+#include "gpupassthrough.h"
+#include "grabgovernor.h"
+#include "grabwatchdog.h"
+#include "hmdmath.h"
+#include "imubias.h"
+#include "imuring.h"
+#include "latencystats.h"
+#include "markertracker.h"
+#include "memorybudget.h"
+#include "mrcapture.h"
+#include "objecttracker.h"
+#include "occlusiondepth.h"
+#include "proximitywarning.h"
+#include "poseestimator.h"
+#include "posededup.h"
+#include "posefilter.h"
+#include "posehistory.h"
+#include "posefusion.h"
+#include "posepredictor.h"
+#include "poserecorder.h"
+#include "seqlock.h"
+#include "sharedpose.h"
+#include "spatialmapping.h"
+#include "svorecorder.h"
+#include "vsyncscheduler.h"
+#include "zedcameracomponent.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Latest visual-odometry result from the grab thread, consumed by the
+// IMU publisher so it can pair fresh orientation with the last known position.
+//-----------------------------------------------------------------------------
+struct ZedVisualPose_t
+{
+	double vecPosition[3];
+	double vecVelocity[3];
+	vr::HmdQuaternion_t qRotation;
+	double vecAngularVelocity[3];
+	uint64_t ulTimestampNs;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: What the tracking threads hand to GetPose()/RunFrame(): the pose and
+// the ZED timestamp of the sample it was built from.
+//-----------------------------------------------------------------------------
+struct ZedPublishedPose_t
+{
+	vr::DriverPose_t pose;
+	uint64_t ulSampleTimestampNs;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Immutable snapshot the tracking threads work from, rebuilt by
+// Start and UpdateSettings.
+//-----------------------------------------------------------------------------
+struct ZedTrackerConfig_t
+{
+	ZedmSettings_t settings;
+
+	// floor height in ZED world space found this tracking session, applied to
+	// poseTemplate when autoFloorHeight is on
+	bool bFloorDetected;
+	double flFloorHeight;
+
+	// constant fields of every published pose (transforms, connected, result);
+	// publishers copy it and only fill in the dynamic fields
+	vr::DriverPose_t poseTemplate;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Live figures for DebugRequest("stats"). Rates are per second.
+//-----------------------------------------------------------------------------
+struct ZedTrackerStats_t
+{
+	float flGrabFps;
+	uint32_t unFramesDropped;
+	sl::POSITIONAL_TRACKING_STATE eTrackingState;
+	uint64_t ulFramesGrabbed;
+	uint64_t ulGrabFailures;
+	uint64_t ulRecorderDropped;
+	bool bImuPublisherRunning;
+	double flImuRate;
+	uint64_t ulImuSamples;
+	uint64_t ulImuSamplesMissed; // gaps in the timestamps the poller saw, at the IMU's sampling rate
+	uint64_t ulImuSamplesSkipped; // polled but overwritten before the publisher drained them
+	double flPosePublishRate;
+	uint64_t ulPosesPublished;
+	double flPoseThreadCpuSeconds;
+	double flImuThreadCpuSeconds;
+	ECameraProfile eCameraProfile;
+	bool bRelocalizing;
+	bool bFloorDetected;
+	double flFloorHeight;
+	int nGrabDivisor; // frameGovernor: one camera frame processed out of this many
+	float flMotionEnergy;
+	float flGpuLoad;
+	float flFrameCpuMs; // grab thread CPU time per processed frame, averaged
+	uint64_t ulPosesDeduplicated; // poseDedup: submissions skipped
+	bool bDeadReckoning; // visual tracking lost, the IMU carries the pose
+	uint64_t ulTrackingLosses; // visual tracking lost after it was OK
+	bool bImuBiasCached; // imuBiasPath: the samples were corrected from the start
+	bool bImuBiasEstimated; // imuBiasPath: estimated at rest this session
+	bool bClockFit; // the ZED clock is translated onto the steady clock
+	double flClockDriftPpm;
+	double flClockResidualUs;
+	bool bGrabStalled; // no frame for grabStallTimeout, recovering
+	uint64_t ulGrabStalls;
+	AllocationCounts_t grabAllocations; // ZEDM_ALLOCATION_AUDIT builds only
+	AllocationCounts_t imuAllocations;
+	SvoRecordingStats_t recording;
+
+	// rolling load, 1 is a core or the GPU kept busy, see CCostMeter
+	float flGrabCpuLoad;
+	float flImuCpuLoad;
+	float flWorkerCpuLoad; // the whole pool's, shared by every device
+	float flPassthroughGpuLoad; // the passthrough copies; the SDK's own kernels can't be timed
+	float flMrCaptureGpuLoad; // the MR capture copies
+	float flOcclusionGpuLoad; // the occlusion depth copies, not the SDK's resampling
+	float flProximityGpuLoad; // the proximity kernel and its copy back, not the SDK's resampling
+
+	// memoryBudgetGpu: the camera's GPU, everyone's use of it, 0 until the camera opened
+	float flGpuUsedMb;
+	float flGpuTotalMb;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: The optional stages of the IMU publisher's pose pipeline. The
+// publisher loop and PublishPose are instantiated per profile, chosen when
+// the publisher starts and again when the settings change, so a stage left
+// out of the profile is compiled out rather than tested for every sample.
+// The stages in a profile are still tested at run time, Full is what every
+// other caller of PublishPose uses.
+//-----------------------------------------------------------------------------
+enum EPipelineStage
+{
+	PipelineStage_Fusion = 0x1, // 6DOF: visual fusion and dead reckoning; without it the IMU's 3DOF orientation
+	PipelineStage_Filter = 0x2, // poseFilter, predictionHorizon
+	PipelineStage_Record = 0x4, // poseRecordingPath
+
+	PipelineProfile_ImuOnly = 0,
+	PipelineProfile_ImuOnlyFull = PipelineStage_Filter | PipelineStage_Record,
+	PipelineProfile_Tracking = PipelineStage_Fusion,
+	PipelineProfile_Full = PipelineStage_Fusion | PipelineStage_Filter | PipelineStage_Record,
+};
+
+struct ImuPublisherState_t;
+
+//-----------------------------------------------------------------------------
+// Purpose: Owns the ZED camera and the threads that turn its output into
+// DriverPose_t updates. The grab thread runs at camera rate; on models with an
+// IMU a poller thread reads every IMU sample from the SDK into m_imuRing and
+// the IOBuffer, and a publisher thread drains the ring into the fusion and
+// emits orientation updates at IMU rate.
+//
+// The grab thread lives from the first Start until Stop. Pause parks it with
+// the camera still open and tracking enabled, so a device that SteamVR
+// deactivates and activates again is back in the time of one grab instead of
+// a camera reopen.
+//-----------------------------------------------------------------------------
+class CZedTracker
+{
+public:
+	CZedTracker();
+	~CZedTracker();
+
+	/** Spawns the grab thread. The camera is opened on that thread; unCameraSerial
+	* selects a camera, 0 opens whichever the SDK picks. If the thread is already
+	* running, takes the new settings and resumes it instead. */
+	bool Start(const ZedmSettings_t& settings, unsigned int unCameraSerial = 0);
+
+	/** Blocks until the grab thread is parked (or has exited); no pose is
+	* published afterwards until the next Start */
+	void Pause();
+
+	/** Parks the grab thread like Pause while SteamVR is in standby, without
+	* waiting for it; independent of Pause, the thread runs when neither holds it */
+	void SetStandby(bool bStandby);
+
+	/** Ends the grab thread, closes the camera and joins; idempotent */
+	void Stop();
+
+	/** Blocks until the grab thread exits, which only happens at the end of an SVO replay, on Stop or on an error */
+	void WaitForExit();
+
+	/** True once the grab thread has exited on its own or because of Stop */
+	bool HasExited();
+
+	void SetObjectId(vr::TrackedDeviceIndex_t unObjectId) { m_unObjectId.store(unObjectId); }
+
+	/** Pool the grab watchdog checks on, before the first Start; without one there is no watchdog */
+	void SetWorkerPool(CWorkerPool* pPool) { m_pWorkerPool = pPool; }
+
+	/** IOBuffer of vr::ImuSample_t that receives every raw IMU sample while it has
+	* readers, k_ulInvalidIOBufferHandle to stop. Accel in m/s^2, gyro in rad/s,
+	* both in the camera frame; fSampleTime is seconds on the ZED clock. */
+	void SetImuBuffer(vr::IOBufferHandle_t ulImuBuffer) { m_ulImuBuffer.store(ulImuBuffer); }
+
+	/** sharedMemoryExport: segment that receives every published pose and raw IMU
+	* sample, nullptr to stop. Owned by the caller, kept open until after Pause. */
+	void SetSharedPoseWriter(CSharedPoseWriter* pWriter) { m_pSharedPoses.store(pWriter); }
+
+	/** The device's /input/tracking/confidence scalar, updated by whichever thread
+	* publishes when the tracking result changes; k_ulInvalidInputComponentHandle stops that */
+	void SetConfidenceComponent(vr::VRInputComponentHandle_t ulComponent);
+
+	/** Copies the latest published pose, returns 0 if none has been published yet */
+	uint32_t ReadPose(vr::DriverPose_t* pPose, uint64_t* pulSampleTimestampNs = nullptr) const;
+
+	/** The published pose interpolated or extrapolated to ulTimestampNs on the ZED
+	* clock, with poseTimeOffset 0. False if the time isn't covered by the pose history. */
+	bool GetPoseAt(uint64_t ulTimestampNs, vr::DriverPose_t* pPose) const;
+
+	/** Current time on the ZED clock, the time base of every sample timestamp. Translated
+	* from the steady clock once the clocks are fitted, asked from the SDK before. */
+	uint64_t GetCameraTimeNs();
+
+	/** poseDedup: false when the pose would repeat the last one submitted. A true
+	* result counts as submitted, so call it right before TrackedDevicePoseUpdated. */
+	bool ShouldSubmitPose(const vr::DriverPose_t& pose, uint64_t ulSampleTimestampNs);
+
+	/** Called after a pose read with ReadPose was passed to TrackedDevicePoseUpdated */
+	void RecordPoseSubmitted(uint64_t ulSampleTimestampNs);
+
+	/** predictionHorizon: the pose as predicted that far past now, with poseTimeOffset
+	* to match. Right before TrackedDevicePoseUpdated, on a pose from ReadPose. */
+	void PredictPose(vr::DriverPose_t* pPose);
+
+	LatencySummary_t GetLatencySummary(ELatencyStage eStage) const { return m_rgLatency[eStage].Summarize(); }
+	void ResetLatencyStats();
+
+	void GetStats(ZedTrackerStats_t* pStats) const;
+
+	sl::POSITIONAL_TRACKING_STATE GetTrackingState() const { return m_eTrackingState.load(); }
+
+	/** Asks the grab thread to save the area map to areaFilePath in the background */
+	void RequestAreaSave() { m_bAreaSaveRequested = true; }
+
+	/** Asks the grab thread to start or stop recording to svoRecordPath. Not possible during a replay. */
+	bool RequestRecording(bool bRecord);
+
+	/** The SVO file being recorded, empty if none */
+	std::string GetRecordingFileName() const { return m_svoRecorder.GetFileName(); }
+
+	/** Replaces the settings snapshot the tracking threads read; they pick it up
+	* on their next iteration. A new cameraProfile is requested as well. */
+	void UpdateSettings(const ZedmSettings_t& settings);
+
+	/** The constant part of this device's poses, for a pose built outside the tracking threads */
+	void GetPoseTemplate(vr::DriverPose_t* pPose) const;
+
+	/** The pose template these settings give before any floor detection, without a tracker */
+	static void BuildPoseTemplate(const ZedmSettings_t& settings, vr::DriverPose_t* pPose);
+
+	/** Asks the grab thread to reopen the camera with another profile. Not possible during a replay. */
+	bool RequestCameraProfile(ECameraProfile eProfile);
+
+	/** True when the tracking threads submit poses to the host themselves, so RunFrame must not */
+	bool SubmitsPoses() const { return m_bImuPublisherRunning.load() || m_bReplay; }
+
+	/** The IVRCameraComponent fed by the grab thread, for GetComponent */
+	CZedCameraComponent* GetCameraComponent() { return &m_cameraComponent; }
+
+	/** The shared passthrough textures, false unless gpuPassthrough is on and the camera is open */
+	bool GetGpuPassthroughInfo(GpuPassthroughInfo_t* pInfo) const { return m_gpuPassthrough.GetInfo(pInfo); }
+
+	/** The shared occlusion depth textures, false unless occlusionDepth is on and the camera is open */
+	bool GetOcclusionDepthInfo(OcclusionDepthInfo_t* pInfo) const { return m_occlusionDepth.GetInfo(pInfo); }
+
+	/** The nearest obstacle per sector, false unless proximityWarning is on and has measured */
+	bool GetProximitySectors(ProximitySectors_t* pSectors) const { return m_proximityWarning.GetSectors(pSectors); }
+
+	/** Any thread: the compositor's GPU time over the frame budget, for frameGovernor */
+	void SetGpuLoad(float flGpuLoad) { m_governor.SetGpuLoad(flGpuLoad); }
+
+	/** Any thread: the compositor's latest vsync on the steady clock and the frame period, for vsyncPublish */
+	void SetVsync(uint64_t ulVsyncNs, double flFrameSeconds);
+
+	/** The virtual trackers' poses, published while bodyTracking is on */
+	CZedBodyTracker* GetBodyTracker() { return &m_bodyTracker; }
+
+	/** The fiducial marker trackers, publishing while markerIds has any */
+	CZedMarkerTracker* GetMarkerTracker() { return &m_markerTracker; }
+
+	/** The object trackers, publishing while objectTrackers is above 0 */
+	CZedObjectTracker* GetObjectTracker() { return &m_objectTracker; }
+
+	/** The room mesh, empty unless spatialMapping is on */
+	const CSpatialMapper& GetSpatialMapper() const { return m_spatialMapper; }
+
+private:
+	/** Loads the current snapshot into *ppConfig if it changed since *punVersion */
+	bool RefreshConfig(std::shared_ptr<const ZedTrackerConfig_t>* ppConfig, uint32_t* punVersion) const;
+
+	/** Grab thread: publishes a snapshot with the floor found this session, or without one */
+	void SetFloorHeight(bool bDetected, double flFloorHeight);
+
+	void RunPoseTracking();
+	void RunGrabLoop();
+	ECameraProfile CapCameraProfile(ECameraProfile eProfile) const;
+	void AutoTuneCameraProfile(const CCudaDeviceSelection& gpu);
+	sl::ERROR_CODE OpenCamera(const CCudaDeviceSelection& gpu);
+	sl::ERROR_CODE EnableTracking(const CameraProfile_t& profile, const CCudaDeviceSelection& gpu);
+	void CloseCamera();
+
+	/** Grab thread: opens the closed camera again, retrying with back-off; false once stopped */
+	bool ReopenCamera(const CCudaDeviceSelection& gpu);
+	void StartImuPublisher();
+	void StopImuPublisher();
+	void RunImuPoller();
+
+	/** Grab thread: parks while a pause or standby is requested, false once stopped.
+	* bCameraOpen stops the IMU publisher for the pause and resets the filters after it. */
+	bool WaitWhilePaused(bool bCameraOpen);
+
+	/** Grab thread: sleeps for a retry interval, cut short by Pause or Stop; false once stopped */
+	bool SleepUnlessStopped(std::chrono::milliseconds interval, bool bCameraOpen);
+	void UpdateAreaSave();
+	bool CommitAreaFile();
+	void LoadCachedImuBias();
+	void SaveImuBiasEstimate();
+	void PublishTrackingLost(vr::ETrackingResult eResult);
+
+	/** Publishing thread: feeds one IMU sample's fused pose to the dead reckoner. While
+	* tracking is lost, replaces the position with the reckoned one; false once the
+	* pose is no longer valid. */
+	bool UpdateDeadReckoning(sl::POSITIONAL_TRACKING_STATE eTrackingState, const ImuRingSample_t& imu, CPoseFusion::FusedPose_t* pFused);
+	void RunImuPublisher();
+
+	/** Publishing thread: the loop of one EPipelineStage profile, returns when the settings select another or the publisher stops */
+	template <uint32_t unStages> void RunImuPublisherPipeline(ImuPublisherState_t* pState);
+	uint32_t SelectPipelineProfile(const ZedmSettings_t& settings) const;
+
+	/** The stages left out of unStages are skipped whatever their settings; PipelineProfile_Full tests them all */
+	template <uint32_t unStages> void PublishPose(const vr::DriverPose_t& rawPose, uint64_t ulSampleTimestampNs, bool bSubmit);
+	void UpdateConfidence(const vr::DriverPose_t& pose);
+	double GetPoseTimeOffset(uint64_t ulSampleTimestampNs);
+	void UpdateClockTranslation();
+	void SubmitLatestPose();
+
+	void TraceFrame(const ZedVisualPose_t& visual);
+	void RecordVisualPose(const ZedVisualPose_t& visual);
+	void RecordImuSample(const ImuRingSample_t& imu);
+	void AddGovernorImuSample(const ImuRingSample_t& imu);
+	void WriteImuBuffer(const ImuRingSample_t& imu);
+
+	sl::Camera m_zed;
+	sl::RuntimeParameters m_runtimeParams; // set by OpenCamera, used by every grab
+	bool m_bDepthPerGrab; // set by OpenCamera; otherwise depth is only computed for a floor search
+
+	// immutable snapshots: m_pConfig is swapped by UpdateSettings under
+	// std::atomic_load/atomic_store, each thread keeps its own reference
+	std::shared_ptr<const ZedTrackerConfig_t> m_pConfig;
+	std::mutex m_configMutex; // serializes UpdateSettings and SetFloorHeight
+	std::atomic<uint32_t> m_unSettingsVersion;
+	std::shared_ptr<const ZedTrackerConfig_t> m_pGrabConfig; // grab thread's
+	uint32_t m_unGrabSettingsVersion;
+
+	unsigned int m_unCameraSerial;
+
+	std::thread* m_pPoseThread;
+	std::atomic<bool> m_bStopRequested;
+	std::atomic<bool> m_bPauseRequested;
+	std::atomic<bool> m_bStandbyRequested;
+	std::mutex m_runMutex; // m_bPaused, m_bGrabThreadExited and the wake-ups on the two requests
+	std::condition_variable m_runWake;
+	bool m_bPaused;
+	bool m_bGrabThreadExited;
+	std::thread* m_pImuThread;
+	std::thread* m_pImuPollThread;
+	mutable std::mutex m_imuThreadMutex; // guards both IMU threads against GetStats while the camera is reopened
+	CImuRing m_imuRing; // the poller's, read by the publisher
+	std::atomic<uint64_t> m_ulImuSamplesMissed;
+	std::atomic<uint64_t> m_ulImuSamplesSkipped;
+
+	// IMU bias, see imuBiasPath. m_sImuBiasPath is fixed while the camera is open,
+	// m_imuBias belongs to the poller while it runs.
+	std::string m_sImuBiasPath;
+	ImuBias_t m_imuBias;
+	std::atomic<bool> m_bImuBiasCached;
+	std::atomic<bool> m_bImuBiasEstimated;
+	std::atomic<vr::TrackedDeviceIndex_t> m_unObjectId;
+	std::atomic<vr::IOBufferHandle_t> m_ulImuBuffer;
+	std::atomic<CSharedPoseWriter*> m_pSharedPoses;
+	std::atomic<vr::VRInputComponentHandle_t> m_ulConfidenceComponent;
+	std::atomic<float> m_flConfidence; // the last value sent, -1 for none
+	std::atomic<bool> m_bImuPublisherRunning;
+	std::atomic<bool> m_bGrabFailing; // set by the grab thread after repeated transient failures; the IMU publisher reports the loss
+	bool m_bReplay; // playing back sSvoPath, set before the grab thread starts
+	bool m_bHasImu; // set by OpenCamera
+	bool m_bImuOnly; // set by OpenCamera: orientation from the IMU, nothing grabbed
+	bool m_bImuOnlyUnsupported; // this camera has no IMU
+	uint32_t m_unFramesSinceTrace;
+
+	CSeqLock<ZedPublishedPose_t> m_poseHandoff;
+	CPoseHistory m_poseHistory; // written by PublishPose
+	uint64_t m_ulLastHistoryTimestampNs;
+	CSeqLock<ZedVisualPose_t> m_visualPose;
+	CPoseVelocityEstimator m_velocityEstimator;
+	CPoseFusion m_fusion; // IMU publisher's while it runs, the grab thread's otherwise
+	CDeadReckoner m_deadReckoner; // same owner as m_fusion
+	std::atomic<bool> m_bDeadReckoning;
+	bool m_bVisualTracked; // grab thread's: the last frame's state was OK
+	uint64_t m_ulVisualLostNs; // grab thread's: when tracking was lost, 0 before the first loss or while tracked
+	CClockTranslator m_clockTranslator; // ZED clock onto the steady clock, fed by the grab thread
+	uint64_t m_ulNextClockPairNs; // grab thread's
+	CVsyncScheduler m_vsync;
+
+	CPoseFilterBank m_poseFilter;
+	CPoseSubmitFilter m_submitFilter;
+	CPosePredictorBank m_posePredictor;
+	double m_flPredictionHorizon;
+	mutable std::mutex m_publishFilterMutex; // filters and predictor; PublishPose runs on the IMU publisher while it runs, otherwise on the grab thread, and RunFrame submits
+
+	CLatencyHistogram m_rgLatency[LatencyStage_Count];
+	CPoseRecorder m_recorder;
+	CZedCameraComponent m_cameraComponent;
+	CGpuPassthrough m_gpuPassthrough; // grab thread's, except GetInfo
+	CMrCaptureExport m_mrCapture; // grab thread's
+	COcclusionDepth m_occlusionDepth; // grab thread's, except GetInfo
+	CProximityWarning m_proximityWarning; // grab thread's, except GetSectors
+	CSpatialMapper m_spatialMapper;
+	CSvoRecorder m_svoRecorder; // grab thread's, except Request and the stats
+	CFloorDetector m_floorDetector; // grab thread's
+	CZedBodyTracker m_bodyTracker;
+	CZedMarkerTracker m_markerTracker; // grab thread's, except Publish and ReadPose
+	CZedObjectTracker m_objectTracker;
+	CGrabRateGovernor m_governor; // configured and updated by the grab thread, fed by whichever reads the IMU
+	uint64_t m_ulNextGrabNs; // grab thread's: frames before this are skipped
+	CGrabWatchdog m_watchdog;
+	CWorkerPool* m_pWorkerPool;
+
+	// written by the grab thread, read by GetStats
+	std::atomic<float> m_flGrabFps;
+	std::atomic<uint32_t> m_unFramesDropped;
+	std::atomic<sl::POSITIONAL_TRACKING_STATE> m_eTrackingState;
+	std::atomic<uint64_t> m_ulGrabFailures;
+	std::atomic<uint64_t> m_ulTrackingLosses;
+	CRateCounter m_grabRate;
+	CRateCounter m_imuRate;
+	CRateCounter m_publishRate;
+	CAllocationCounter m_grabAllocations; // ZEDM_ALLOCATION_AUDIT, see allocaudit.h
+	static const uint64_t k_ulGpuMemorySampleIntervalNs = 2000000000ull;
+	std::atomic<float> m_flGpuUsedMb; // the whole device's, 0 until sampled
+	std::atomic<float> m_flGpuTotalMb;
+
+	// cost accounting for the stats, sampled by a job on the worker pool
+	static const uint64_t k_ulCostSampleIntervalNs = 1000000000ull;
+	void SampleCosts();
+	CPeriodicJob m_costSampling;
+	CCostMeter m_grabCpu;
+	CCostMeter m_imuCpu;
+	CCostMeter m_workerCpu;
+	CCostMeter m_passthroughGpu;
+	CCostMeter m_mrCaptureGpu;
+	CCostMeter m_occlusionGpu;
+	CCostMeter m_proximityGpu;
+	CAllocationCounter m_imuAllocations; // every IMU thread's, across reopens
+
+	// area map persistence, see areaFilePath. m_sAreaFilePath is fixed while the camera is open.
+	std::string m_sAreaFilePath;
+	std::atomic<bool> m_bRelocalizing; // matching against the loaded map, poses are held back
+	uint64_t m_ulRelocalizeStartNs;
+	bool m_bAreaMapUsable; // tracked since opening, so saving won't replace a good map with an unmatched one
+	bool m_bAreaSaveRunning;
+	std::atomic<bool> m_bAreaSaveRequested;
+
+	ECameraProfile m_eActiveProfile; // grab thread only once started
+	bool m_bAutoTuneProfile; // cameraProfile "auto", picked before the camera first opens
+	int32_t m_nProfileCeiling; // cameraPlanner's, fixed once started
+	std::atomic<ECameraProfile> m_eRequestedProfile;
+};
+
+#endif // ZEDTRACKER_H
@@ -0,0 +1,286 @@
+#include "mockdrivercontext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------------------------------------
+// CMockDriverHost
+//-----------------------------------------------------------------------------
+bool CMockDriverHost::TrackedDeviceAdded(const char* pchDeviceSerialNumber, vr::ETrackedDeviceClass eDeviceClass, vr::ITrackedDeviceServerDriver* pDriver)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	MockTrackedDevice_t device;
+	device.sSerialNumber = pchDeviceSerialNumber ? pchDeviceSerialNumber : "";
+	device.eDeviceClass = eDeviceClass;
+	device.pDriver = pDriver;
+	m_vecDevices.push_back(device);
+	return true;
+}
+
+void CMockDriverHost::TrackedDevicePoseUpdated(uint32_t unWhichDevice, const vr::DriverPose_t& newPose, uint32_t unPoseStructSize)
+{
+	m_ulPoseUpdates++;
+	if (!m_bRecordPoses)
+		return;
+
+	MockPoseUpdate_t update;
+	update.unDeviceIndex = unWhichDevice;
+	update.ulReceivedNs = GetSteadyNanoseconds();
+	update.pose = newPose;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_vecPoseUpdates.push_back(update);
+}
+
+void CMockDriverHost::GetRawTrackedDevicePoses(float fPredictedSecondsFromNow, vr::TrackedDevicePose_t* pTrackedDevicePoseArray, uint32_t unTrackedDevicePoseArrayCount)
+{
+	for (uint32_t i = 0; i < unTrackedDevicePoseArrayCount; i++)
+		memset(&pTrackedDevicePoseArray[i], 0, sizeof(vr::TrackedDevicePose_t));
+}
+
+std::vector<MockPoseUpdate_t> CMockDriverHost::TakePoseUpdates()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::vector<MockPoseUpdate_t> vecUpdates;
+	vecUpdates.swap(m_vecPoseUpdates);
+	return vecUpdates;
+}
+
+std::vector<MockTrackedDevice_t> CMockDriverHost::GetDevices()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_vecDevices;
+}
+
+//-----------------------------------------------------------------------------
+// CMockSettings
+//-----------------------------------------------------------------------------
+bool CMockSettings::ParseAssignment(const char* pchAssignment)
+{
+	const char* pchSlash = strchr(pchAssignment, '/');
+	const char* pchEquals = strchr(pchAssignment, '=');
+	if (!pchSlash || !pchEquals || pchEquals < pchSlash)
+		return false;
+
+	std::string sSection(pchAssignment, pchSlash - pchAssignment);
+	std::string sKey(pchSlash + 1, pchEquals - pchSlash - 1);
+	SetString(sSection.c_str(), sKey.c_str(), pchEquals + 1);
+	return true;
+}
+
+const char* CMockSettings::GetSettingsErrorNameFromEnum(vr::EVRSettingsError eError)
+{
+	switch (eError)
+	{
+	case vr::VRSettingsError_None: return "None";
+	case vr::VRSettingsError_UnsetSettingHasNoDefault: return "UnsetSettingHasNoDefault";
+	default: return "Error";
+	}
+}
+
+bool CMockSettings::Find(const char* pchSection, const char* pchSettingsKey, std::string* psValue, vr::EVRSettingsError* peError)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto iter = m_mapValues.find(std::string(pchSection) + "/" + pchSettingsKey);
+	bool bFound = iter != m_mapValues.end();
+	if (bFound)
+		*psValue = iter->second;
+	if (peError)
+		*peError = bFound ? vr::VRSettingsError_None : vr::VRSettingsError_UnsetSettingHasNoDefault;
+	return bFound;
+}
+
+void CMockSettings::Store(const char* pchSection, const char* pchSettingsKey, const std::string& sValue, vr::EVRSettingsError* peError)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_mapValues[std::string(pchSection) + "/" + pchSettingsKey] = sValue;
+	if (peError)
+		*peError = vr::VRSettingsError_None;
+}
+
+void CMockSettings::SetBool(const char* pchSection, const char* pchSettingsKey, bool bValue, vr::EVRSettingsError* peError)
+{
+	Store(pchSection, pchSettingsKey, bValue ? "true" : "false", peError);
+}
+
+void CMockSettings::SetInt32(const char* pchSection, const char* pchSettingsKey, int32_t nValue, vr::EVRSettingsError* peError)
+{
+	Store(pchSection, pchSettingsKey, std::to_string(nValue), peError);
+}
+
+void CMockSettings::SetFloat(const char* pchSection, const char* pchSettingsKey, float flValue, vr::EVRSettingsError* peError)
+{
+	Store(pchSection, pchSettingsKey, std::to_string(flValue), peError);
+}
+
+void CMockSettings::SetString(const char* pchSection, const char* pchSettingsKey, const char* pchValue, vr::EVRSettingsError* peError)
+{
+	Store(pchSection, pchSettingsKey, pchValue, peError);
+}
+
+bool CMockSettings::GetBool(const char* pchSection, const char* pchSettingsKey, vr::EVRSettingsError* peError)
+{
+	std::string sValue;
+	if (!Find(pchSection, pchSettingsKey, &sValue, peError))
+		return false;
+	return sValue == "true" || sValue == "1";
+}
+
+int32_t CMockSettings::GetInt32(const char* pchSection, const char* pchSettingsKey, vr::EVRSettingsError* peError)
+{
+	std::string sValue;
+	if (!Find(pchSection, pchSettingsKey, &sValue, peError))
+		return 0;
+	return (int32_t)strtol(sValue.c_str(), nullptr, 10);
+}
+
+float CMockSettings::GetFloat(const char* pchSection, const char* pchSettingsKey, vr::EVRSettingsError* peError)
+{
+	std::string sValue;
+	if (!Find(pchSection, pchSettingsKey, &sValue, peError))
+		return 0.0f;
+	return strtof(sValue.c_str(), nullptr);
+}
+
+void CMockSettings::GetString(const char* pchSection, const char* pchSettingsKey, char* pchValue, uint32_t unValueLen, vr::EVRSettingsError* peError)
+{
+	std::string sValue;
+	Find(pchSection, pchSettingsKey, &sValue, peError);
+	if (unValueLen == 0)
+		return;
+	strncpy(pchValue, sValue.c_str(), unValueLen - 1);
+	pchValue[unValueLen - 1] = 0;
+}
+
+void CMockSettings::RemoveSection(const char* pchSection, vr::EVRSettingsError* peError)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::string sPrefix = std::string(pchSection) + "/";
+	for (auto iter = m_mapValues.begin(); iter != m_mapValues.end();)
+	{
+		if (iter->first.compare(0, sPrefix.size(), sPrefix) == 0)
+			iter = m_mapValues.erase(iter);
+		else
+			++iter;
+	}
+	if (peError)
+		*peError = vr::VRSettingsError_None;
+}
+
+void CMockSettings::RemoveKeyInSection(const char* pchSection, const char* pchSettingsKey, vr::EVRSettingsError* peError)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_mapValues.erase(std::string(pchSection) + "/" + pchSettingsKey);
+	if (peError)
+		*peError = vr::VRSettingsError_None;
+}
+
+//-----------------------------------------------------------------------------
+// CMockProperties
+//-----------------------------------------------------------------------------
+vr::ETrackedPropertyError CMockProperties::ReadPropertyBatch(vr::PropertyContainerHandle_t ulContainerHandle, vr::PropertyRead_t* pBatch, uint32_t unBatchEntryCount)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (uint32_t i = 0; i < unBatchEntryCount; i++)
+	{
+		vr::PropertyRead_t& read = pBatch[i];
+		auto iter = m_mapProperties.find(std::make_pair(ulContainerHandle, read.prop));
+		if (iter == m_mapProperties.end())
+		{
+			read.eError = vr::TrackedProp_UnknownProperty;
+			continue;
+		}
+
+		const Property_t& property = iter->second;
+		read.unTag = property.unTag;
+		read.unRequiredBufferSize = (uint32_t)property.vecData.size();
+		if (read.unBufferSize < property.vecData.size())
+		{
+			read.eError = vr::TrackedProp_BufferTooSmall;
+			continue;
+		}
+		if (!property.vecData.empty())
+			memcpy(read.pvBuffer, property.vecData.data(), property.vecData.size());
+		read.eError = vr::TrackedProp_Success;
+	}
+	return vr::TrackedProp_Success;
+}
+
+vr::ETrackedPropertyError CMockProperties::WritePropertyBatch(vr::PropertyContainerHandle_t ulContainerHandle, vr::PropertyWrite_t* pBatch, uint32_t unBatchEntryCount)
+{
+	m_ulWrites += unBatchEntryCount;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (uint32_t i = 0; i < unBatchEntryCount; i++)
+	{
+		vr::PropertyWrite_t& write = pBatch[i];
+		auto key = std::make_pair(ulContainerHandle, write.prop);
+		if (write.writeType == vr::PropertyWrite_Set)
+		{
+			Property_t& property = m_mapProperties[key];
+			property.unTag = write.unTag;
+			property.vecData.assign((const uint8_t*)write.pvBuffer, (const uint8_t*)write.pvBuffer + write.unBufferSize);
+		}
+		else
+		{
+			m_mapProperties.erase(key);
+		}
+		write.eError = vr::TrackedProp_Success;
+	}
+	return vr::TrackedProp_Success;
+}
+
+//-----------------------------------------------------------------------------
+// CMockDriverLog, CMockDriverManager, CMockResources
+//-----------------------------------------------------------------------------
+void CMockDriverLog::Log(const char* pchLogMessage)
+{
+	fputs(pchLogMessage, stdout);
+}
+
+uint32_t CMockDriverManager::GetDriverName(vr::DriverId_t nDriver, char* pchValue, uint32_t unBufferSize)
+{
+	static const char k_pchDriverName[] = "zedm";
+	if (pchValue && unBufferSize >= sizeof(k_pchDriverName))
+		memcpy(pchValue, k_pchDriverName, sizeof(k_pchDriverName));
+	return sizeof(k_pchDriverName);
+}
+
+uint32_t CMockResources::GetResourceFullPath(const char* pchResourceName, const char* pchResourceTypeDirectory, char* pchPathBuffer, uint32_t unBufferLen)
+{
+	if (pchPathBuffer && unBufferLen)
+		pchPathBuffer[0] = 0;
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// CMockDriverContext
+//-----------------------------------------------------------------------------
+void* CMockDriverContext::GetGenericInterface(const char* pchInterfaceVersion, vr::EVRInitError* peError)
+{
+	void* pInterface = nullptr;
+	if (strcmp(pchInterfaceVersion, vr::IVRServerDriverHost_Version) == 0)
+		pInterface = static_cast<vr::IVRServerDriverHost*>(&m_host);
+	else if (strcmp(pchInterfaceVersion, vr::IVRSettings_Version) == 0)
+		pInterface = static_cast<vr::IVRSettings*>(&m_settings);
+	else if (strcmp(pchInterfaceVersion, vr::IVRProperties_Version) == 0)
+		pInterface = static_cast<vr::IVRProperties*>(&m_properties);
+	else if (strcmp(pchInterfaceVersion, vr::IVRDriverLog_Version) == 0)
+		pInterface = static_cast<vr::IVRDriverLog*>(&m_log);
+	else if (strcmp(pchInterfaceVersion, vr::IVRDriverManager_Version) == 0)
+		pInterface = static_cast<vr::IVRDriverManager*>(&m_driverManager);
+	else if (strcmp(pchInterfaceVersion, vr::IVRResources_Version) == 0)
+		pInterface = static_cast<vr::IVRResources*>(&m_resources);
+
+	if (peError)
+		*peError = pInterface ? vr::VRInitError_None : vr::VRInitError_Init_InterfaceNotFound;
+	return pInterface;
+}
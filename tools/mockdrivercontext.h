@@ -0,0 +1,165 @@
+#ifndef MOCKDRIVERCONTEXT_H
+#define MOCKDRIVERCONTEXT_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Purpose: In-process stand-ins for the vrserver interfaces, so the driver (or
+// just its pose pipeline) can run in a plain executable under a profiler or a
+// soak test without SteamVR. Everything is thread safe because the driver
+// calls in from its own tracking threads.
+//-----------------------------------------------------------------------------
+
+/** One TrackedDevicePoseUpdated call, stamped with the steady clock on arrival */
+struct MockPoseUpdate_t
+{
+	uint32_t unDeviceIndex;
+	uint64_t ulReceivedNs;
+	vr::DriverPose_t pose;
+};
+
+struct MockTrackedDevice_t
+{
+	std::string sSerialNumber;
+	vr::ETrackedDeviceClass eDeviceClass;
+	vr::ITrackedDeviceServerDriver* pDriver;
+};
+
+class CMockDriverHost : public vr::IVRServerDriverHost
+{
+public:
+	CMockDriverHost() : m_ulPoseUpdates(0), m_bRecordPoses(true), m_bExiting(false) {}
+
+	/** Off, pose updates are only counted; the recording lock then stays off the driver's threads */
+	void SetRecordPoses(bool bRecord) { m_bRecordPoses = bRecord; }
+	void SetExiting(bool bExiting) { m_bExiting = bExiting; }
+
+	uint64_t GetPoseUpdateCount() const { return m_ulPoseUpdates.load(); }
+	std::vector<MockPoseUpdate_t> TakePoseUpdates();
+	std::vector<MockTrackedDevice_t> GetDevices();
+
+	virtual bool TrackedDeviceAdded(const char* pchDeviceSerialNumber, vr::ETrackedDeviceClass eDeviceClass, vr::ITrackedDeviceServerDriver* pDriver) override;
+	virtual void TrackedDevicePoseUpdated(uint32_t unWhichDevice, const vr::DriverPose_t& newPose, uint32_t unPoseStructSize) override;
+	virtual void VsyncEvent(double vsyncTimeOffsetSeconds) override {}
+	virtual void VendorSpecificEvent(uint32_t unWhichDevice, vr::EVREventType eventType, const vr::VREvent_Data_t& eventData, double eventTimeOffset) override {}
+	virtual bool IsExiting() override { return m_bExiting; }
+	virtual bool PollNextEvent(vr::VREvent_t* pEvent, uint32_t uncbVREvent) override { return false; }
+	virtual void GetRawTrackedDevicePoses(float fPredictedSecondsFromNow, vr::TrackedDevicePose_t* pTrackedDevicePoseArray, uint32_t unTrackedDevicePoseArrayCount) override;
+	virtual void TrackedDeviceDisplayTransformUpdated(uint32_t unWhichDevice, vr::HmdMatrix34_t eyeToHeadLeft, vr::HmdMatrix34_t eyeToHeadRight) override {}
+	virtual void RequestRestart(const char* pchLocalizedReason, const char* pchExecutableToStart, const char* pchArguments, const char* pchWorkingDirectory) override {}
+	virtual uint32_t GetFrameTimings(vr::Compositor_FrameTiming* pTiming, uint32_t nFrames) override { return 0; }
+
+private:
+	std::atomic<uint64_t> m_ulPoseUpdates;
+	std::atomic<bool> m_bRecordPoses;
+	std::atomic<bool> m_bExiting;
+
+	std::mutex m_mutex;
+	std::vector<MockPoseUpdate_t> m_vecPoseUpdates;
+	std::vector<MockTrackedDevice_t> m_vecDevices;
+};
+
+/** Keys are "section/key"; unset keys report VRSettingsError_UnsetSettingHasNoDefault like vrserver */
+class CMockSettings : public vr::IVRSettings
+{
+public:
+	/** Parses "section/key=value" as passed on a tool's command line */
+	bool ParseAssignment(const char* pchAssignment);
+
+	virtual const char* GetSettingsErrorNameFromEnum(vr::EVRSettingsError eError) override;
+	virtual void SetBool(const char* pchSection, const char* pchSettingsKey, bool bValue, vr::EVRSettingsError* peError = nullptr) override;
+	virtual void SetInt32(const char* pchSection, const char* pchSettingsKey, int32_t nValue, vr::EVRSettingsError* peError = nullptr) override;
+	virtual void SetFloat(const char* pchSection, const char* pchSettingsKey, float flValue, vr::EVRSettingsError* peError = nullptr) override;
+	virtual void SetString(const char* pchSection, const char* pchSettingsKey, const char* pchValue, vr::EVRSettingsError* peError = nullptr) override;
+	virtual bool GetBool(const char* pchSection, const char* pchSettingsKey, vr::EVRSettingsError* peError = nullptr) override;
+	virtual int32_t GetInt32(const char* pchSection, const char* pchSettingsKey, vr::EVRSettingsError* peError = nullptr) override;
+	virtual float GetFloat(const char* pchSection, const char* pchSettingsKey, vr::EVRSettingsError* peError = nullptr) override;
+	virtual void GetString(const char* pchSection, const char* pchSettingsKey, char* pchValue, uint32_t unValueLen, vr::EVRSettingsError* peError = nullptr) override;
+	virtual void RemoveSection(const char* pchSection, vr::EVRSettingsError* peError = nullptr) override;
+	virtual void RemoveKeyInSection(const char* pchSection, const char* pchSettingsKey, vr::EVRSettingsError* peError = nullptr) override;
+
+private:
+	bool Find(const char* pchSection, const char* pchSettingsKey, std::string* psValue, vr::EVRSettingsError* peError);
+	void Store(const char* pchSection, const char* pchSettingsKey, const std::string& sValue, vr::EVRSettingsError* peError);
+
+	std::mutex m_mutex;
+	std::map<std::string, std::string> m_mapValues;
+};
+
+/** Property containers are the device index plus one; values are kept as raw bytes and tag */
+class CMockProperties : public vr::IVRProperties
+{
+public:
+	CMockProperties() : m_ulWrites(0) {}
+
+	virtual vr::ETrackedPropertyError ReadPropertyBatch(vr::PropertyContainerHandle_t ulContainerHandle, vr::PropertyRead_t* pBatch, uint32_t unBatchEntryCount) override;
+	virtual vr::ETrackedPropertyError WritePropertyBatch(vr::PropertyContainerHandle_t ulContainerHandle, vr::PropertyWrite_t* pBatch, uint32_t unBatchEntryCount) override;
+	virtual const char* GetPropErrorNameFromEnum(vr::ETrackedPropertyError error) override { return "property error"; }
+	virtual vr::PropertyContainerHandle_t TrackedDeviceToPropertyContainer(vr::TrackedDeviceIndex_t nDevice) override { return (vr::PropertyContainerHandle_t)nDevice + 1; }
+
+	uint64_t GetWriteCount() const { return m_ulWrites.load(); }
+
+private:
+	struct Property_t
+	{
+		vr::PropertyTypeTag_t unTag;
+		std::vector<uint8_t> vecData;
+	};
+
+	std::atomic<uint64_t> m_ulWrites;
+	std::mutex m_mutex;
+	std::map<std::pair<vr::PropertyContainerHandle_t, vr::ETrackedDeviceProperty>, Property_t> m_mapProperties;
+};
+
+/** Writes driver log lines to stdout */
+class CMockDriverLog : public vr::IVRDriverLog
+{
+public:
+	virtual void Log(const char* pchLogMessage) override;
+};
+
+class CMockDriverManager : public vr::IVRDriverManager
+{
+public:
+	virtual uint32_t GetDriverCount() const override { return 1; }
+	virtual uint32_t GetDriverName(vr::DriverId_t nDriver, char* pchValue, uint32_t unBufferSize) override;
+	virtual vr::DriverHandle_t GetDriverHandle(const char* pchDriverName) override { return 1; }
+	virtual bool IsEnabled(vr::DriverId_t nDriver) const override { return nDriver == 0; }
+};
+
+/** There are no driver resources outside vrserver; every lookup fails */
+class CMockResources : public vr::IVRResources
+{
+public:
+	virtual uint32_t LoadSharedResource(const char* pchResourceName, char* pchBuffer, uint32_t unBufferLen) override { return 0; }
+	virtual uint32_t GetResourceFullPath(const char* pchResourceName, const char* pchResourceTypeDirectory, char* pchPathBuffer, uint32_t unBufferLen) override;
+};
+
+class CMockDriverContext : public vr::IVRDriverContext
+{
+public:
+	virtual void* GetGenericInterface(const char* pchInterfaceVersion, vr::EVRInitError* peError = nullptr) override;
+	virtual vr::DriverHandle_t GetDriverHandle() override { return 1; }
+
+	/** Points this module's openvr_driver.h accessors (VRServerDriverHost() etc.) at the
+	* context. A driver loaded from its own DLL gets the context through Init() instead. */
+	vr::EVRInitError Install() { return vr::InitServerDriverContext(this); }
+
+	CMockDriverHost m_host;
+	CMockSettings m_settings;
+	CMockProperties m_properties;
+	CMockDriverLog m_log;
+	CMockDriverManager m_driverManager;
+	CMockResources m_resources;
+};
+
+#endif // MOCKDRIVERCONTEXT_H
@@ -0,0 +1,143 @@
+#include "ndjsonwriter.h"
+
+CNdjsonWriter::CNdjsonWriter()
+	: m_pFile(nullptr)
+	, m_pWriterThread(nullptr)
+	, m_unBuffers(0)
+	, m_bStopping(false)
+	, m_bWriteFailed(false)
+	, m_ulRecords(0)
+	, m_ulBufferWaits(0)
+{
+}
+
+CNdjsonWriter::~CNdjsonWriter()
+{
+	Close();
+}
+
+bool CNdjsonWriter::Open(const char* pchPath, bool bAppend)
+{
+	Close();
+
+	m_pFile = fopen(pchPath, bAppend ? "ab" : "wb");
+	if (!m_pFile)
+		return false;
+
+	// room for the record that crosses k_unBufferSize
+	m_sFilling.clear();
+	m_sFilling.reserve(k_unBufferSize + k_unBufferSize / 4);
+	m_unBuffers = 1;
+	m_bStopping = false;
+	m_bWriteFailed = false;
+	m_ulRecords = 0;
+	m_ulBufferWaits = 0;
+	m_pWriterThread = new std::thread(&CNdjsonWriter::RunWriter, this);
+	return true;
+}
+
+bool CNdjsonWriter::Close()
+{
+	if (!m_pFile)
+		return true;
+
+	Flush();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_queued.notify_one();
+	m_pWriterThread->join();
+	delete m_pWriterThread;
+	m_pWriterThread = nullptr;
+
+	bool bFailed = m_bWriteFailed || fclose(m_pFile) != 0;
+	m_pFile = nullptr;
+	m_vecFree.clear();
+	m_unBuffers = 0;
+	return !bFailed;
+}
+
+void CNdjsonWriter::Write(const Json::Value& root)
+{
+	if (!m_pFile)
+		return;
+
+	Json::BufferWriter::write(root, m_sFilling);
+	EndRecord();
+}
+
+void CNdjsonWriter::WriteLine(const char* pchJson, size_t unLength)
+{
+	if (!m_pFile)
+		return;
+
+	size_t unStart = m_sFilling.size();
+	m_sFilling.append(pchJson, unLength);
+	for (size_t i = unStart; i < m_sFilling.size(); i++)
+	{
+		if (m_sFilling[i] == '\n' || m_sFilling[i] == '\r')
+			m_sFilling[i] = ' ';
+	}
+	EndRecord();
+}
+
+void CNdjsonWriter::EndRecord()
+{
+	m_sFilling.push_back('\n');
+	m_ulRecords++;
+	if (m_sFilling.size() >= k_unBufferSize)
+		Flush();
+}
+
+void CNdjsonWriter::Flush()
+{
+	if (!m_pFile || m_sFilling.empty())
+		return;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_vecFree.empty() && m_unBuffers >= k_unBufferCount)
+	{
+		m_ulBufferWaits++;
+		m_written.wait(lock, [this] { return !m_vecFree.empty(); });
+	}
+
+	m_vecQueued.push_back(std::move(m_sFilling));
+	if (!m_vecFree.empty())
+	{
+		m_sFilling = std::move(m_vecFree.back());
+		m_vecFree.pop_back();
+	}
+	else
+	{
+		m_sFilling = std::string();
+		m_sFilling.reserve(k_unBufferSize + k_unBufferSize / 4);
+		m_unBuffers++;
+	}
+	lock.unlock();
+	m_queued.notify_one();
+}
+
+void CNdjsonWriter::RunWriter()
+{
+	std::string sWriting;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_queued.wait(lock, [this] { return !m_vecQueued.empty() || m_bStopping; });
+		if (m_vecQueued.empty())
+			break;
+
+		sWriting = std::move(m_vecQueued.front());
+		m_vecQueued.erase(m_vecQueued.begin());
+		lock.unlock();
+
+		bool bWritten = fwrite(sWriting.data(), 1, sWriting.size(), m_pFile) == sWriting.size();
+		sWriting.clear();
+
+		lock.lock();
+		m_bWriteFailed = m_bWriteFailed || !bWritten;
+		m_vecFree.push_back(std::move(sWriting));
+		m_written.notify_one();
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef NDJSONWRITER_H
+#define NDJSONWRITER_H
+
+#pragma once
+
+#include "json/json.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Purpose: Streams records to a file as newline-delimited JSON, one compact
+// object per line, so exports of pose recordings and stats stay readable
+// without building the whole document as one Json::Value first.
+//
+// Records are serialized with Json::BufferWriter into the buffer being filled;
+// once it holds k_unBufferSize bytes it is handed to a background thread,
+// which writes it in one call and returns it for reuse. At most
+// k_unBufferCount buffers exist, so when the disk falls behind a full buffer
+// waits for a free one instead of memory growing; the waits are counted.
+//-----------------------------------------------------------------------------
+class CNdjsonWriter
+{
+public:
+	CNdjsonWriter();
+	~CNdjsonWriter();
+
+	/** Truncates pchPath, or appends to it with bAppend */
+	bool Open(const char* pchPath, bool bAppend = false);
+
+	/** Writes what is buffered and waits for it; false if any write failed */
+	bool Close();
+	bool IsOpen() const { return m_pFile != nullptr; }
+
+	/** One line with root as compact JSON; not thread safe, keep to one producer */
+	void Write(const Json::Value& root);
+
+	/** One line of already serialized JSON; line breaks in it become spaces */
+	void WriteLine(const char* pchJson, size_t unLength);
+
+	/** Hands the buffer being filled to the writer thread even if it isn't full */
+	void Flush();
+
+	uint64_t GetRecordCount() const { return m_ulRecords; }
+	uint64_t GetBufferWaits() const { return m_ulBufferWaits; }
+
+private:
+	CNdjsonWriter(const CNdjsonWriter&) = delete;
+	CNdjsonWriter& operator=(const CNdjsonWriter&) = delete;
+
+	static const size_t k_unBufferSize = 1024 * 1024;
+	static const size_t k_unBufferCount = 4;
+
+	void EndRecord();
+	void RunWriter();
+
+	FILE* m_pFile;
+	std::thread* m_pWriterThread;
+	std::string m_sFilling;
+
+	std::mutex m_mutex; // the lists, the buffer count and the flags
+	std::condition_variable m_queued;
+	std::condition_variable m_written;
+	std::vector<std::string> m_vecQueued; // oldest first
+	std::vector<std::string> m_vecFree;
+	size_t m_unBuffers; // filling, queued, being written or free
+	bool m_bStopping;
+	bool m_bWriteFailed;
+
+	uint64_t m_ulRecords;
+	uint64_t m_ulBufferWaits;
+};
+
+#endif // NDJSONWRITER_H
@@ -0,0 +1,85 @@
+#-----------------------------------------------------------------------------
+# Purpose: Profile-guided, link-time optimized release build of the driver,
+# trained on zedm_replaybench. Builds the plain release and benchmarks it,
+# rebuilds instrumented and replays the recording to collect the profile,
+# then rebuilds with the profile and LTO and benchmarks again, printing both
+# reports. The benchmark links the same core library objects as the driver,
+# so their profile applies to it. GCC or Clang only, see ZEDM_PGO.
+#
+# usage: cmake -DSVO=<recording.svo> [-DBUILD_DIR=build-pgo] [-DGENERATOR=Ninja]
+#              -P tools/pgo_build.cmake
+#-----------------------------------------------------------------------------
+cmake_minimum_required(VERSION 3.1)
+
+if(NOT SVO)
+  message(FATAL_ERROR "usage: cmake -DSVO=<recording.svo> [-DBUILD_DIR=dir] -P tools/pgo_build.cmake")
+endif()
+get_filename_component(SOURCE_DIR "${CMAKE_CURRENT_LIST_DIR}/.." ABSOLUTE)
+if(NOT BUILD_DIR)
+  set(BUILD_DIR "${SOURCE_DIR}/build-pgo")
+endif()
+get_filename_component(BUILD_DIR "${BUILD_DIR}" ABSOLUTE)
+set(PGO_DIR "${BUILD_DIR}/pgo")
+set(GENERATOR_ARGS "")
+if(GENERATOR)
+  set(GENERATOR_ARGS -G "${GENERATOR}")
+endif()
+
+# one build directory throughout: GCC finds an object's profile by its path
+function(buildStep name lto pgo)
+  message(STATUS "${name}: configuring with ZEDM_LTO=${lto} ZEDM_PGO=${pgo}")
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} ${GENERATOR_ARGS} -S ${SOURCE_DIR} -B ${BUILD_DIR}
+      -DCMAKE_BUILD_TYPE=Release -DZEDM_LTO=${lto} -DZEDM_PGO=${pgo} -DZEDM_PGO_DIR=${PGO_DIR}
+    RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${name}: configure failed")
+  endif()
+  # the flags change under every object, nothing is reusable
+  execute_process(COMMAND ${CMAKE_COMMAND} --build ${BUILD_DIR} --config Release --target clean)
+  execute_process(COMMAND ${CMAKE_COMMAND} --build ${BUILD_DIR} --config Release RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${name}: build failed")
+  endif()
+endfunction()
+
+function(runBenchmark name outputVariable)
+  file(GLOB_RECURSE benchmarks "${SOURCE_DIR}/bin/zedm_replaybench" "${SOURCE_DIR}/bin/zedm_replaybench.exe")
+  if(NOT benchmarks)
+    message(FATAL_ERROR "${name}: zedm_replaybench not found under ${SOURCE_DIR}/bin")
+  endif()
+  list(GET benchmarks 0 benchmark)
+  message(STATUS "${name}: replaying ${SVO}")
+  execute_process(COMMAND ${benchmark} ${SVO} RESULT_VARIABLE result OUTPUT_VARIABLE output)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${name}: zedm_replaybench failed")
+  endif()
+  set(${outputVariable} "${output}" PARENT_SCOPE)
+endfunction()
+
+buildStep("baseline" OFF "")
+runBenchmark("baseline" BASELINE_REPORT)
+
+file(REMOVE_RECURSE ${PGO_DIR})
+file(MAKE_DIRECTORY ${PGO_DIR})
+buildStep("instrumented" ON generate)
+runBenchmark("training" TRAINING_REPORT)
+
+# Clang writes one raw profile per process, merged into what ZEDM_PGO=use reads
+file(GLOB rawProfiles "${PGO_DIR}/*.profraw")
+if(rawProfiles)
+  find_program(LLVM_PROFDATA NAMES llvm-profdata)
+  if(NOT LLVM_PROFDATA)
+    message(FATAL_ERROR "llvm-profdata not found, needed to merge the Clang profile")
+  endif()
+  execute_process(COMMAND ${LLVM_PROFDATA} merge -output=${PGO_DIR}/zedm.profdata ${rawProfiles} RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "llvm-profdata merge failed")
+  endif()
+endif()
+
+buildStep("optimized" ON use)
+runBenchmark("optimized" OPTIMIZED_REPORT)
+
+message("\n-- before (-O2) --\n${BASELINE_REPORT}")
+message("-- after (-O2, LTO, PGO) --\n${OPTIMIZED_REPORT}")
@@ -0,0 +1,129 @@
+#include "poserecordingview.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CPoseRecordingView::CPoseRecordingView()
+	: m_pFileHandle(nullptr)
+	, m_pMappingHandle(nullptr)
+	, m_pData(nullptr)
+	, m_unSize(0)
+	, m_pHeader(nullptr)
+	, m_pRecords(nullptr)
+	, m_unRecordCount(0)
+{
+}
+
+CPoseRecordingView::~CPoseRecordingView()
+{
+	Close();
+}
+
+bool CPoseRecordingView::Open(const char* pchPath)
+{
+	Close();
+
+#if defined(_WIN32)
+	HANDLE hFile = CreateFileA(pchPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+	m_pFileHandle = hFile;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(hFile, &size) || size.QuadPart < (LONGLONG)sizeof(PoseRecordingHeader_t))
+	{
+		Close();
+		return false;
+	}
+	m_unSize = (size_t)size.QuadPart;
+
+	m_pMappingHandle = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_pMappingHandle)
+	{
+		Close();
+		return false;
+	}
+	m_pData = (const uint8_t*)MapViewOfFile(m_pMappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+	int nFile = open(pchPath, O_RDONLY);
+	if (nFile < 0)
+		return false;
+
+	struct stat fileStat;
+	if (fstat(nFile, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(PoseRecordingHeader_t))
+	{
+		::close(nFile);
+		return false;
+	}
+	m_unSize = (size_t)fileStat.st_size;
+
+	void* pData = mmap(nullptr, m_unSize, PROT_READ, MAP_SHARED, nFile, 0);
+	::close(nFile);
+	m_pData = pData != MAP_FAILED ? (const uint8_t*)pData : nullptr;
+#endif
+
+	if (!m_pData)
+	{
+		Close();
+		return false;
+	}
+
+	m_pHeader = (const PoseRecordingHeader_t*)m_pData;
+	if (m_pHeader->unMagic != k_unPoseRecordingMagic || m_pHeader->unVersion != k_unPoseRecordingVersion || m_pHeader->unRecordSize != k_unPoseRecordSize)
+	{
+		Close();
+		return false;
+	}
+
+	m_pRecords = (const PoseRecord_t*)(m_pData + sizeof(PoseRecordingHeader_t));
+	m_unRecordCount = (m_unSize - sizeof(PoseRecordingHeader_t)) / k_unPoseRecordSize;
+	return true;
+}
+
+void CPoseRecordingView::Close()
+{
+#if defined(_WIN32)
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_pMappingHandle)
+		CloseHandle(m_pMappingHandle);
+	if (m_pFileHandle)
+		CloseHandle(m_pFileHandle);
+#else
+	if (m_pData)
+		munmap((void*)m_pData, m_unSize);
+#endif
+
+	m_pFileHandle = nullptr;
+	m_pMappingHandle = nullptr;
+	m_pData = nullptr;
+	m_unSize = 0;
+	m_pHeader = nullptr;
+	m_pRecords = nullptr;
+	m_unRecordCount = 0;
+}
+
+bool CPoseRecordingView::CIterator::Next(const PoseRecord_t** ppRecord, uint64_t* pulTimestampNs)
+{
+	while (m_unIndex < m_unEnd)
+	{
+		const PoseRecord_t& record = m_view.GetRecord(m_unIndex++);
+		if (record.unType == PoseRecord_Sync)
+		{
+			m_ulTimestampNs = record.ulAbsoluteTimestampNs;
+			continue;
+		}
+
+		m_ulTimestampNs += (int64_t)record.nDeltaNs;
+		*ppRecord = &record;
+		*pulTimestampNs = m_ulTimestampNs;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,58 @@
+#ifndef POSERECORDINGVIEW_H
+#define POSERECORDINGVIEW_H
+
+#pragma once
+
+#include "poserecorder.h"
+
+#include <stddef.h>
+
+//-----------------------------------------------------------------------------
+// Purpose: Read-only memory mapping of a pose recording. Records are accessed
+// in place; a recording still being written can be opened and only the
+// records complete at open time are visible.
+//-----------------------------------------------------------------------------
+class CPoseRecordingView
+{
+public:
+	CPoseRecordingView();
+	~CPoseRecordingView();
+
+	bool Open(const char* pchPath);
+	void Close();
+
+	const PoseRecordingHeader_t* GetHeader() const { return m_pHeader; }
+	size_t GetRecordCount() const { return m_unRecordCount; }
+	const PoseRecord_t& GetRecord(size_t unIndex) const { return m_pRecords[unIndex]; }
+
+	/** Walks the records from the start, resolving the delta-encoded timestamps */
+	class CIterator
+	{
+	public:
+		explicit CIterator(const CPoseRecordingView& view) : m_view(view), m_unIndex(0), m_unEnd(view.GetRecordCount()), m_ulTimestampNs(view.GetHeader() ? view.GetHeader()->ulFirstTimestampNs : 0) {}
+
+		/** Records [unBegin, unEnd) only, ulTimestampNs being the one resolved just before unBegin */
+		CIterator(const CPoseRecordingView& view, size_t unBegin, size_t unEnd, uint64_t ulTimestampNs) : m_view(view), m_unIndex(unBegin), m_unEnd(unEnd), m_ulTimestampNs(ulTimestampNs) {}
+
+		/** Advances to the next data record, skipping sync records; false at the end */
+		bool Next(const PoseRecord_t** ppRecord, uint64_t* pulTimestampNs);
+
+	private:
+		const CPoseRecordingView& m_view;
+		size_t m_unIndex;
+		size_t m_unEnd;
+		uint64_t m_ulTimestampNs;
+	};
+
+private:
+	void* m_pFileHandle;
+	void* m_pMappingHandle;
+	const uint8_t* m_pData;
+	size_t m_unSize;
+
+	const PoseRecordingHeader_t* m_pHeader;
+	const PoseRecord_t* m_pRecords;
+	size_t m_unRecordCount;
+};
+
+#endif // POSERECORDINGVIEW_H
@@ -0,0 +1,129 @@
+//-----------------------------------------------------------------------------
+// Purpose: The helper process of the driver's grabber mode. Runs the pose
+// pipeline on the local ZED outside vrserver, at a raised priority class, and
+// writes every pose and IMU sample into the shared memory rings the driver
+// polls, see grabberclient.h. The driver launches and supervises it when
+// grabberPath is set; with grabberPath "-" it is started by hand. Settings
+// come as driver_zedm/key=value arguments; the calibration is the driver's.
+// It exits on SIGINT or SIGTERM, when the grab thread gives up, and, outside
+// Windows, when the process that started it is gone.
+//
+// usage: zedm_grabber <segment, e.g. zedm_ZED_GRABBER> [section/key=value ...]
+//-----------------------------------------------------------------------------
+#include "driverlog.h"
+#include "driversettings.h"
+#include "mockdrivercontext.h"
+#include "sharedpose.h"
+#include "workerpool.h"
+#include "zedtracker.h"
+
+#include <signal.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+static volatile sig_atomic_t g_bStopRequested = 0;
+
+static void OnStopSignal(int)
+{
+	g_bStopRequested = 1;
+}
+
+/** The camera pipeline ahead of the desktop, as the tracking threads are within vrserver */
+static void RaisePriorityClass()
+{
+#if defined(_WIN32)
+	if (!SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS))
+		DriverLog("Unable to raise the priority class (error %lu)\n", GetLastError());
+#else
+	// needs CAP_SYS_NICE or a matching RLIMIT_NICE
+	if (setpriority(PRIO_PROCESS, 0, -5) != 0)
+		DriverLog("Unable to raise the process priority, running at the default\n");
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <segment> [section/key=value ...]\n", argv[0]);
+		return 1;
+	}
+
+	// poses only go to the rings, the mock host just counts them
+	CMockDriverContext context;
+	for (int i = 2; i < argc; i++)
+	{
+		if (!context.m_settings.ParseAssignment(argv[i]))
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[i]);
+			return 1;
+		}
+	}
+	context.m_host.SetRecordPoses(false);
+	context.Install();
+	InitDriverLog(vr::VRDriverLog());
+
+	signal(SIGINT, OnStopSignal);
+	signal(SIGTERM, OnStopSignal);
+	RaisePriorityClass();
+#if !defined(_WIN32)
+	pid_t parentPid = getppid();
+#endif
+
+	ZedmSettings_t settings;
+	LoadDriverSettings(&settings);
+
+	CSharedPoseWriter writer;
+	if (!writer.Open(argv[1]))
+	{
+		fprintf(stderr, "Unable to create shared memory %s\n", argv[1]);
+		CleanupDriverLog();
+		return 1;
+	}
+
+	// for the grab watchdog, a stalled camera is reopened here rather than by relaunching
+	CWorkerPool workerPool;
+	workerPool.Start(1);
+
+	CZedTracker tracker;
+	tracker.SetWorkerPool(&workerPool);
+	tracker.SetSharedPoseWriter(&writer);
+	tracker.SetObjectId(0);
+	if (!tracker.Start(settings))
+	{
+		fprintf(stderr, "Unable to create tracking thread\n");
+		workerPool.Stop();
+		CleanupDriverLog();
+		return 1;
+	}
+
+	bool bParentGone = false;
+	while (!g_bStopRequested && !bParentGone && !tracker.HasExited())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+#if !defined(_WIN32)
+		bParentGone = getppid() != parentPid;
+#endif
+	}
+	if (bParentGone)
+		DriverLog("Parent process gone, exiting\n");
+
+	// the tracker writes into the segment until it has stopped
+	bool bTrackerExited = tracker.HasExited();
+	tracker.Stop();
+	tracker.SetSharedPoseWriter(nullptr);
+	workerPool.Stop();
+	writer.Close();
+
+	CleanupDriverLog();
+	return bTrackerExited ? 1 : 0;
+}
@@ -0,0 +1,383 @@
+//-----------------------------------------------------------------------------
+// Purpose: Benchmarks the grab path of the attached camera at every
+// resolution, frame rate and depth mode it supports: the sustained grab
+// rate, the cost of grab() and getPosition(), the frames the SDK dropped and
+// the GPU's utilization, written as CSV and JSON. The numbers to pick the
+// camera profiles for a machine by, and to compare two SDK versions on the
+// same one before upgrading.
+//
+// Each configuration opens the camera afresh with positional tracking on,
+// grabs for a warm-up, then measures. A frame rate the camera doesn't offer
+// at a resolution is skipped: the SDK opens it at another one. GPU
+// utilization comes from NVML, loaded at run time; without it the column is
+// -1. The camera must not be in use, close SteamVR first.
+//
+// usage: zedm_grabsweep [--serial N] [--gpu N] [--seconds N] [--warmup N] [--csv file] [--json file]
+//-----------------------------------------------------------------------------
+#include "cameraautotune.h"
+#include "latencystats.h"
+
+#include <sl/Camera.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+using namespace sl;
+
+// the frame rates the SDK offers, every resolution gets tried at each; those that don't open as asked are skipped
+static const RESOLUTION k_rgeResolutions[] = { RESOLUTION::HD2K, RESOLUTION::HD1080, RESOLUTION::HD720, RESOLUTION::VGA };
+static const int k_rgnFps[] = { 15, 30, 60, 100 };
+// positional tracking needs a depth mode, so there is no run without one
+static const DEPTH_MODE k_rgeDepthModes[] = { DEPTH_MODE::PERFORMANCE, DEPTH_MODE::QUALITY, DEPTH_MODE::ULTRA };
+
+// NVML's utilization is averaged over its own sample period, 1/6 s to 1 s depending on the GPU
+static const uint64_t k_ulGpuSampleIntervalNs = 250000000;
+
+struct SweepResult_t
+{
+	RESOLUTION eResolution;
+	int nFps;
+	DEPTH_MODE eDepthMode;
+	double flGrabRate; // frames grabbed per second
+	LatencySummary_t grab;
+	LatencySummary_t getPosition;
+	double flGetPositionMeanUs; // the histogram's buckets are whole microseconds, too coarse for getPosition alone
+	uint64_t ulFramesDropped;
+	uint64_t ulGrabFailures;
+	double flGpuUtilization; // percent, -1 without NVML
+};
+
+static uint64_t GetSteadyNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: GPU utilization through NVML, looked up by the CUDA device's PCI
+// bus id since NVML numbers the devices its own way. Only the few entry
+// points needed, declared here so the NVML headers aren't a build dependency.
+//-----------------------------------------------------------------------------
+class CGpuUtilization
+{
+public:
+	CGpuUtilization()
+		: m_pfnShutdown(nullptr)
+		, m_pfnGetUtilizationRates(nullptr)
+		, m_device(nullptr)
+	{
+	}
+
+	~CGpuUtilization()
+	{
+		if (m_pfnShutdown)
+			m_pfnShutdown();
+	}
+
+	bool Open(int nCudaDevice)
+	{
+		char rgchBusId[32];
+		CUdevice device;
+		if (cuInit(0) != CUDA_SUCCESS || cuDeviceGet(&device, nCudaDevice) != CUDA_SUCCESS
+			|| cuDeviceGetPCIBusId(rgchBusId, sizeof(rgchBusId), device) != CUDA_SUCCESS)
+			return false;
+
+#if defined(_WIN32)
+		HMODULE hModule = LoadLibraryA("nvml.dll");
+		auto GetSymbol = [hModule](const char* pchName) { return hModule ? (void*)GetProcAddress(hModule, pchName) : nullptr; };
+#else
+		void* pModule = dlopen("libnvidia-ml.so.1", RTLD_NOW | RTLD_LOCAL);
+		auto GetSymbol = [pModule](const char* pchName) { return pModule ? dlsym(pModule, pchName) : nullptr; };
+#endif
+		NvmlInitFn pfnInit = (NvmlInitFn)GetSymbol("nvmlInit_v2");
+		NvmlGetHandleByPciBusIdFn pfnGetHandle = (NvmlGetHandleByPciBusIdFn)GetSymbol("nvmlDeviceGetHandleByPciBusId_v2");
+		NvmlShutdownFn pfnShutdown = (NvmlShutdownFn)GetSymbol("nvmlShutdown");
+		m_pfnGetUtilizationRates = (NvmlGetUtilizationRatesFn)GetSymbol("nvmlDeviceGetUtilizationRates");
+		if (!pfnInit || !pfnGetHandle || !pfnShutdown || !m_pfnGetUtilizationRates || pfnInit() != 0)
+			return false;
+		m_pfnShutdown = pfnShutdown;
+		return pfnGetHandle(rgchBusId, &m_device) == 0;
+	}
+
+	/** Percent of the last NVML sample period the GPU was busy; false if unknown */
+	bool Sample(double* pflPercent)
+	{
+		NvmlUtilization_t utilization;
+		if (!m_device || m_pfnGetUtilizationRates(m_device, &utilization) != 0)
+			return false;
+		*pflPercent = utilization.unGpu;
+		return true;
+	}
+
+private:
+	CGpuUtilization(const CGpuUtilization&) = delete;
+	CGpuUtilization& operator=(const CGpuUtilization&) = delete;
+
+	struct NvmlUtilization_t
+	{
+		unsigned int unGpu;
+		unsigned int unMemory;
+	};
+	typedef int (*NvmlInitFn)();
+	typedef int (*NvmlShutdownFn)();
+	typedef int (*NvmlGetHandleByPciBusIdFn)(const char* pchBusId, void** pDevice);
+	typedef int (*NvmlGetUtilizationRatesFn)(void* device, NvmlUtilization_t* pUtilization);
+
+	NvmlShutdownFn m_pfnShutdown;
+	NvmlGetUtilizationRatesFn m_pfnGetUtilizationRates;
+	void* m_device;
+};
+
+// false if the camera doesn't open, or opens at another resolution or frame rate than asked
+static bool RunConfiguration(unsigned int unSerial, int nGpu, double flWarmupSeconds, double flMeasureSeconds, CGpuUtilization* pGpu,
+	SweepResult_t* pResult, std::string* psFingerprint)
+{
+	InitParameters init_params;
+	init_params.camera_resolution = pResult->eResolution;
+	init_params.camera_fps = pResult->nFps;
+	init_params.depth_mode = pResult->eDepthMode;
+	init_params.coordinate_system = COORDINATE_SYSTEM::RIGHT_HANDED_Y_UP;
+	init_params.coordinate_units = UNIT::METER;
+	init_params.sdk_gpu_id = nGpu;
+	if (unSerial != 0)
+		init_params.input.setFromSerialNumber(unSerial);
+
+	Camera zed;
+	ERROR_CODE eError = zed.open(init_params);
+	if (eError != ERROR_CODE::SUCCESS)
+	{
+		printf("  unable to open: %s\n", toString(eError).c_str());
+		return false;
+	}
+	CameraInformation information = zed.getCameraInformation();
+	if (psFingerprint->empty())
+		*psFingerprint = GetAutoTuneFingerprint(toString(information.camera_model).c_str(), information.serial_number, nGpu);
+	const CameraConfiguration& configuration = information.camera_configuration;
+	Resolution expected = getResolution(pResult->eResolution);
+	if ((int)(configuration.fps + 0.5f) != pResult->nFps || configuration.resolution.width != expected.width)
+	{
+		printf("  not offered, the camera opened at %zux%zu %.0f fps\n", configuration.resolution.width, configuration.resolution.height, configuration.fps);
+		zed.close();
+		return false;
+	}
+	if ((eError = zed.enablePositionalTracking(PositionalTrackingParameters())) != ERROR_CODE::SUCCESS)
+	{
+		printf("  unable to track: %s\n", toString(eError).c_str());
+		zed.close();
+		return false;
+	}
+
+	RuntimeParameters runtime_parameters;
+	CLatencyHistogram grab;
+	CLatencyHistogram getPosition;
+	uint64_t ulGetPositionNs = 0;
+	uint64_t ulFrames = 0;
+	uint64_t ulGrabFailures = 0;
+	double flGpuSum = 0.0;
+	int nGpuSamples = 0;
+	unsigned int unDroppedAtStart = 0;
+	Pose pose;
+
+	uint64_t ulStartNs = GetSteadyNanoseconds();
+	uint64_t ulMeasureStartNs = ulStartNs + (uint64_t)(flWarmupSeconds * 1e9);
+	uint64_t ulEndNs = ulMeasureStartNs + (uint64_t)(flMeasureSeconds * 1e9);
+	uint64_t ulNextGpuSampleNs = ulMeasureStartNs;
+	bool bMeasuring = false;
+	uint64_t ulNowNs = ulStartNs;
+	while (ulNowNs < ulEndNs)
+	{
+		uint64_t ulGrabStartNs = GetSteadyNanoseconds();
+		bool bGrabbed = zed.grab(runtime_parameters) == ERROR_CODE::SUCCESS;
+		uint64_t ulGrabEndNs = GetSteadyNanoseconds();
+		if (bGrabbed)
+			zed.getPosition(pose, REFERENCE_FRAME::WORLD);
+		ulNowNs = GetSteadyNanoseconds();
+		if (ulNowNs < ulMeasureStartNs)
+			continue;
+		if (!bMeasuring)
+		{
+			// the first frame after the warm-up only starts the count
+			unDroppedAtStart = zed.getFrameDroppedCount();
+			bMeasuring = true;
+			continue;
+		}
+
+		if (!bGrabbed)
+		{
+			ulGrabFailures++;
+			continue;
+		}
+		ulFrames++;
+		grab.Record(ulGrabEndNs - ulGrabStartNs);
+		getPosition.Record(ulNowNs - ulGrabEndNs);
+		ulGetPositionNs += ulNowNs - ulGrabEndNs;
+
+		double flPercent;
+		if (ulNowNs >= ulNextGpuSampleNs && pGpu->Sample(&flPercent))
+		{
+			flGpuSum += flPercent;
+			nGpuSamples++;
+			ulNextGpuSampleNs = ulNowNs + k_ulGpuSampleIntervalNs;
+		}
+	}
+	pResult->ulFramesDropped = zed.getFrameDroppedCount() - unDroppedAtStart;
+
+	zed.disablePositionalTracking();
+	zed.close();
+
+	pResult->flGrabRate = ulFrames / flMeasureSeconds;
+	pResult->grab = grab.Summarize();
+	pResult->getPosition = getPosition.Summarize();
+	pResult->flGetPositionMeanUs = ulFrames > 0 ? ulGetPositionNs / 1000.0 / ulFrames : 0.0;
+	pResult->ulGrabFailures = ulGrabFailures;
+	pResult->flGpuUtilization = nGpuSamples > 0 ? flGpuSum / nGpuSamples : -1.0;
+	return ulFrames > 0;
+}
+
+static void WriteCsv(FILE* pFile, const std::vector<SweepResult_t>& vecResults)
+{
+	fprintf(pFile, "resolution,fps,depth_mode,grab_rate,grab_p50_us,grab_p99_us,get_position_mean_us,get_position_p99_us,"
+		"frames_dropped,grab_failures,gpu_utilization\n");
+	for (const SweepResult_t& result : vecResults)
+	{
+		fprintf(pFile, "%s,%d,%s,%.2f,%.0f,%.0f,%.1f,%.0f,%llu,%llu,%.1f\n", toString(result.eResolution).c_str(), result.nFps,
+			toString(result.eDepthMode).c_str(), result.flGrabRate, result.grab.flP50Us, result.grab.flP99Us, result.flGetPositionMeanUs,
+			result.getPosition.flP99Us, (unsigned long long)result.ulFramesDropped, (unsigned long long)result.ulGrabFailures,
+			result.flGpuUtilization);
+	}
+}
+
+static void WriteJson(FILE* pFile, const std::string& sFingerprint, const std::vector<SweepResult_t>& vecResults)
+{
+	// the fingerprint holds no quotes or backslashes: model, serial, GPU name and SDK version
+	fprintf(pFile, "{\"fingerprint\":\"%s\",\"configurations\":[", sFingerprint.c_str());
+	for (size_t i = 0; i < vecResults.size(); i++)
+	{
+		const SweepResult_t& result = vecResults[i];
+		fprintf(pFile, "%s\n{\"resolution\":\"%s\",\"fps\":%d,\"depth_mode\":\"%s\",\"grab_rate\":%.2f,"
+			"\"grab_us\":{\"p50\":%.0f,\"p95\":%.0f,\"p99\":%.0f,\"max\":%.0f},"
+			"\"get_position_us\":{\"mean\":%.1f,\"p50\":%.0f,\"p95\":%.0f,\"p99\":%.0f,\"max\":%.0f},"
+			"\"frames_dropped\":%llu,\"grab_failures\":%llu,\"gpu_utilization\":%.1f}",
+			i > 0 ? "," : "", toString(result.eResolution).c_str(), result.nFps, toString(result.eDepthMode).c_str(), result.flGrabRate,
+			result.grab.flP50Us, result.grab.flP95Us, result.grab.flP99Us, result.grab.flMaxUs, result.flGetPositionMeanUs,
+			result.getPosition.flP50Us, result.getPosition.flP95Us, result.getPosition.flP99Us, result.getPosition.flMaxUs,
+			(unsigned long long)result.ulFramesDropped, (unsigned long long)result.ulGrabFailures, result.flGpuUtilization);
+	}
+	fprintf(pFile, "\n]}\n");
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int unSerial = 0;
+	int nGpu = 0;
+	double flMeasureSeconds = 10.0;
+	double flWarmupSeconds = 3.0;
+	const char* pchCsvPath = nullptr;
+	const char* pchJsonPath = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--serial") == 0 && i + 1 < argc)
+			unSerial = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--gpu") == 0 && i + 1 < argc)
+			nGpu = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+			flMeasureSeconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+			flWarmupSeconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+			pchCsvPath = argv[++i];
+		else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+			pchJsonPath = argv[++i];
+		else
+		{
+			fprintf(stderr, "usage: %s [--serial N] [--gpu N] [--seconds N] [--warmup N] [--csv file] [--json file]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (flMeasureSeconds <= 0.0)
+	{
+		fprintf(stderr, "--seconds must be positive\n");
+		return 1;
+	}
+
+	CGpuUtilization gpu;
+	if (!gpu.Open(nGpu))
+		printf("NVML unavailable, no GPU utilization\n");
+
+	// camera model and serial, GPU and SDK version, from the first configuration that opens
+	std::string sFingerprint;
+	std::vector<SweepResult_t> vecResults;
+	for (RESOLUTION eResolution : k_rgeResolutions)
+	{
+		for (int nFps : k_rgnFps)
+		{
+			for (DEPTH_MODE eDepthMode : k_rgeDepthModes)
+			{
+				SweepResult_t result = {};
+				result.eResolution = eResolution;
+				result.nFps = nFps;
+				result.eDepthMode = eDepthMode;
+				printf("%s %d fps, depth %s\n", toString(eResolution).c_str(), nFps, toString(eDepthMode).c_str());
+				if (!RunConfiguration(unSerial, nGpu, flWarmupSeconds, flMeasureSeconds, &gpu, &result, &sFingerprint))
+				{
+					// a frame rate that isn't offered isn't with any depth mode either
+					if (eDepthMode == k_rgeDepthModes[0])
+						break;
+					continue;
+				}
+				printf("  %.1f frames/s, grab p99 %.0f us, getPosition %.1f us mean, %llu dropped, GPU %.0f%%\n", result.flGrabRate,
+					result.grab.flP99Us, result.flGetPositionMeanUs, (unsigned long long)result.ulFramesDropped, result.flGpuUtilization);
+				vecResults.push_back(result);
+			}
+		}
+	}
+
+	if (vecResults.empty())
+	{
+		fprintf(stderr, "No configuration ran\n");
+		return 1;
+	}
+	printf("%s\n", sFingerprint.c_str());
+
+	bool bWritten = true;
+	if (pchCsvPath)
+	{
+		FILE* pFile = fopen(pchCsvPath, "w");
+		if (pFile)
+		{
+			WriteCsv(pFile, vecResults);
+			bWritten = fclose(pFile) == 0 && bWritten;
+		}
+		else
+			bWritten = false;
+	}
+	if (pchJsonPath)
+	{
+		FILE* pFile = fopen(pchJsonPath, "w");
+		if (pFile)
+		{
+			WriteJson(pFile, sFingerprint, vecResults);
+			bWritten = fclose(pFile) == 0 && bWritten;
+		}
+		else
+			bWritten = false;
+	}
+	if (!pchCsvPath && !pchJsonPath)
+		WriteCsv(stdout, vecResults);
+	if (!bWritten)
+	{
+		fprintf(stderr, "Unable to write the report\n");
+		return 1;
+	}
+	return 0;
+}
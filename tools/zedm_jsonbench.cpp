@@ -0,0 +1,163 @@
+//-----------------------------------------------------------------------------
+// Purpose: Times the vendored jsoncpp on documents shaped like the driver's
+// settings and recordings: parsing many small objects, looking members up by
+// name, copying and editing them, and writing them back with FastWriter and
+// BufferWriter. Built three times, with the default std::map object storage,
+// with JSON_USE_FLAT_OBJECT_MAP and with JSON_USE_COPY_ON_WRITE, so they can be
+// compared; all print the same checksum of the written document.
+//
+// usage: zedm_jsonbench [objects] [iterations]
+//-----------------------------------------------------------------------------
+#include "json/json.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+static const char* const k_rgpchKeys[] =
+{
+	"serial", "model", "firmware", "fps", "resolution", "depth_mode", "enabled",
+	"position_x", "position_y", "position_z", "yaw", "pitch", "roll", "latency_ms",
+};
+static const uint32_t k_unKeyCount = sizeof( k_rgpchKeys ) / sizeof( k_rgpchKeys[0] );
+
+template <typename F>
+static double TimeNanosecondsPerItem(uint32_t unCount, uint32_t unIterations, F func)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < unIterations; i++)
+		func();
+	double flNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	return flNs / ((double)unCount * unIterations);
+}
+
+static std::string BuildDocument(uint32_t unObjects)
+{
+	Json::Value root(Json::arrayValue);
+	for (uint32_t i = 0; i < unObjects; i++)
+	{
+		Json::Value entry(Json::objectValue);
+		// written in reverse so that the parser does not always append
+		for (uint32_t k = k_unKeyCount; k-- > 0; )
+		{
+			if (k % 3 == 0)
+				entry[k_rgpchKeys[k]] = Json::Value(std::string("value-") + std::to_string(i * k_unKeyCount + k));
+			else if (k % 3 == 1)
+				entry[k_rgpchKeys[k]] = Json::Value((int)(i * 31 + k));
+			else
+				entry[k_rgpchKeys[k]] = Json::Value(i * 0.25 + k);
+		}
+		root.append(entry);
+	}
+	return Json::FastWriter().write(root);
+}
+
+static uint32_t Checksum(const std::string& sText)
+{
+	uint32_t unHash = 2166136261u;
+	for (char c : sText)
+		unHash = (unHash ^ (uint8_t)c) * 16777619u;
+	return unHash;
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t unObjects = argc > 1 ? (uint32_t)atoi(argv[1]) : 2000;
+	uint32_t unIterations = argc > 2 ? (uint32_t)atoi(argv[2]) : 50;
+
+#if defined(JSON_USE_FLAT_OBJECT_MAP)
+	const char* pchStorage = "flat object map";
+#else
+	const char* pchStorage = "std::map objects";
+#endif
+#if defined(JSON_USE_COPY_ON_WRITE)
+	const char* pchCopies = ", copy-on-write";
+#else
+	const char* pchCopies = "";
+#endif
+	printf("jsoncpp: %s%s, %u objects x %u iterations\n", pchStorage, pchCopies, unObjects, unIterations);
+
+	const std::string sDocument = BuildDocument(unObjects);
+	Json::Reader reader;
+	Json::Value root;
+	if (!reader.parse(sDocument, root, false) || root.size() != unObjects)
+	{
+		printf("parse failed: %s\n", reader.getFormattedErrorMessages().c_str());
+		return 1;
+	}
+	printf("checksum: %08x\n", Checksum(Json::FastWriter().write(root)));
+
+	volatile double flSink = 0.0;
+
+	double flParseNs = TimeNanosecondsPerItem(unObjects, unIterations, [&]()
+	{
+		Json::Value parsed;
+		reader.parse(sDocument, parsed, false);
+		flSink = flSink + parsed.size();
+	});
+
+	std::vector<std::string> vecKeys(k_rgpchKeys, k_rgpchKeys + k_unKeyCount);
+	double flLookupNs = TimeNanosecondsPerItem(unObjects * k_unKeyCount, unIterations, [&]()
+	{
+		double flTotal = 0.0;
+		for (Json::ArrayIndex i = 0; i < unObjects; i++)
+		{
+			const Json::Value& entry = root[i];
+			for (const std::string& sKey : vecKeys)
+			{
+				const Json::Value* pValue = entry.find(sKey.data(), sKey.data() + sKey.size());
+				if (pValue && pValue->isNumeric())
+					flTotal += pValue->asDouble();
+			}
+		}
+		flSink = flSink + flTotal;
+	});
+
+	double flIterateNs = TimeNanosecondsPerItem(unObjects * k_unKeyCount, unIterations, [&]()
+	{
+		size_t unNames = 0;
+		for (const Json::Value& entry : root)
+			for (Json::Value::const_iterator it = entry.begin(); it != entry.end(); ++it)
+				unNames += it.name().size();
+		flSink = flSink + unNames;
+	});
+
+	// a settings snapshot that changes one member of one entry
+	double flCopyNs = TimeNanosecondsPerItem(unObjects, unIterations, [&]()
+	{
+		Json::Value copy(root);
+		copy[0u][k_rgpchKeys[1]] = Json::Value((int)copy.size());
+		flSink = flSink + copy[0u][k_rgpchKeys[1]].asInt();
+	});
+
+	Json::FastWriter fastWriter;
+	fastWriter.omitEndingLineFeed();
+	std::string sBuffered;
+	Json::BufferWriter::write(root, sBuffered);
+	std::vector<char> vecFixed(sBuffered.size() + 1);
+	size_t unFixedLength = Json::BufferWriter::write(root, vecFixed.data(), vecFixed.size());
+	bool bWritersMatch = sBuffered == fastWriter.write(root) && unFixedLength == sBuffered.size() && sBuffered == vecFixed.data();
+
+	double flFastWriterNs = TimeNanosecondsPerItem(unObjects, unIterations, [&]()
+	{
+		flSink = flSink + fastWriter.write(root).size();
+	});
+	double flBufferWriterNs = TimeNanosecondsPerItem(unObjects, unIterations, [&]()
+	{
+		sBuffered.clear();
+		Json::BufferWriter::write(root, sBuffered);
+		flSink = flSink + sBuffered.size();
+	});
+
+	printf("parse:   %7.1f ns/object\n", flParseNs);
+	printf("lookup:  %7.1f ns/member\n", flLookupNs);
+	printf("iterate: %7.1f ns/member\n", flIterateNs);
+	printf("copy:    %7.1f ns/object\n", flCopyNs);
+	printf("write:   %7.1f ns/object FastWriter  %7.1f ns/object BufferWriter%s\n", flFastWriterNs, flBufferWriterNs,
+		bWritersMatch ? "" : "  (OUTPUT DIFFERS)");
+
+	return bWritersMatch ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+//-----------------------------------------------------------------------------
+// Purpose: Turns a binary driver log (driver_zedm/binaryLogPath) back into
+// text, one line per record, prefixed with the record time in seconds
+// relative to the first record and its level.
+//
+// usage: zedm_logdecode <binary log> [min level 0-4]
+//-----------------------------------------------------------------------------
+#include "driverlog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+static const char* const k_rpchLevelNames[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR" };
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <binary log> [min level 0-4]\n", argv[0]);
+		return 1;
+	}
+
+	int nMinLevel = argc > 2 ? atoi(argv[2]) : 0;
+
+	FILE* pFile = fopen(argv[1], "rb");
+	if (!pFile)
+	{
+		fprintf(stderr, "Unable to open %s\n", argv[1]);
+		return 1;
+	}
+
+	BinaryLogFileHeader_t fileHeader;
+	if (fread(&fileHeader, sizeof(fileHeader), 1, pFile) != 1 || fileHeader.unMagic != k_unBinaryLogMagic)
+	{
+		fprintf(stderr, "%s is not a driver binary log\n", argv[1]);
+		fclose(pFile);
+		return 1;
+	}
+	if (fileHeader.unVersion != k_unBinaryLogVersion)
+	{
+		fprintf(stderr, "%s has version %u, expected %u\n", argv[1], fileHeader.unVersion, k_unBinaryLogVersion);
+		fclose(pFile);
+		return 1;
+	}
+
+	std::map<uint32_t, std::string> mapFormats;
+	std::vector<uint8_t> vecPayload;
+	uint64_t ulFirstTimestampNs = 0;
+	char rchText[4096];
+
+	BinaryLogRecordHeader_t header;
+	while (fread(&header, sizeof(header), 1, pFile) == 1)
+	{
+		vecPayload.resize(header.unPayloadSize);
+		if (header.unPayloadSize && fread(vecPayload.data(), 1, header.unPayloadSize, pFile) != header.unPayloadSize)
+		{
+			fprintf(stderr, "Truncated record at end of file\n");
+			break;
+		}
+
+		if (header.unType == BinaryLogRecord_Format)
+		{
+			mapFormats[header.unFormatId].assign((const char*)vecPayload.data(), vecPayload.size());
+			continue;
+		}
+
+		if (header.unType != BinaryLogRecord_Event || header.unLevel < nMinLevel)
+			continue;
+
+		if (!ulFirstTimestampNs)
+			ulFirstTimestampNs = header.ulTimestampNs;
+
+		auto iter = mapFormats.find(header.unFormatId);
+		const char* pchFormat = iter != mapFormats.end() ? iter->second.c_str() : "<unknown format>\n";
+		FormatBinaryLogRecord(pchFormat, vecPayload.data(), header.unPayloadSize, rchText, sizeof(rchText));
+
+		printf("%12.6f %-5s %s", (header.ulTimestampNs - ulFirstTimestampNs) * 1e-9,
+			header.unLevel < 5 ? k_rpchLevelNames[header.unLevel] : "?", rchText);
+	}
+
+	fclose(pFile);
+	return 0;
+}
@@ -0,0 +1,283 @@
+//-----------------------------------------------------------------------------
+// Purpose: Times the driver's hmdmath.h helpers against the scalar Matrix4
+// code from the OpenVR samples on the two batch jobs the driver has:
+// transforming many positions by one pose and composing many rotations with
+// one rotation. Also checks the SIMD paths against the scalar functions.
+// Then times Matrix4 itself: multiply, affine and general inverse, batch
+// transform and converting all tracked device poses, and the structure of
+// arrays Vector3Batch against the same work on an array of Vector3.
+// zedm_mathbench_scalar is the same benchmark built with MATRICES_NO_SIMD for
+// comparison.
+//
+// usage: zedm_mathbench [count] [iterations]
+//-----------------------------------------------------------------------------
+#include "hmdmath.h"
+
+#include "Matrices.h"
+#include "VectorBatch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+template <typename F>
+static double TimeNanosecondsPerItem(uint32_t unCount, uint32_t unIterations, F func)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < unIterations; i++)
+		func();
+	double flNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	return flNs / ((double)unCount * unIterations);
+}
+
+static double RandomUnit()
+{
+	return rand() / (double)RAND_MAX * 2.0 - 1.0;
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t unCount = argc > 1 ? (uint32_t)atoi(argv[1]) : 4096;
+	uint32_t unIterations = argc > 2 ? (uint32_t)atoi(argv[2]) : 2000;
+
+#if defined(HMDMATH_AVX)
+	printf("hmdmath: AVX, %u items x %u iterations\n", unCount, unIterations);
+#elif defined(HMDMATH_SSE2)
+	printf("hmdmath: SSE2, %u items x %u iterations\n", unCount, unIterations);
+#else
+	printf("hmdmath: scalar, %u items x %u iterations\n", unCount, unIterations);
+#endif
+#if defined(MATRICES_SSE)
+	printf("Matrix4: SSE\n");
+#else
+	printf("Matrix4: scalar\n");
+#endif
+
+	const vr::HmdQuaternion_t q = HmdQuaternion_Normalize(HmdQuaternion_Init(0.9, 0.1, -0.3, 0.2));
+	const double vecTranslation[3] = { 0.5, 1.5, -2.0 };
+
+	std::vector<double> vecX(unCount), vecY(unCount), vecZ(unCount);
+	std::vector<Vector3> vecPoints(unCount);
+	std::vector<vr::HmdQuaternion_t> vecRotations(unCount), vecComposed(unCount);
+	std::vector<Matrix4> vecMatrices(unCount), vecMatricesOut(unCount);
+	for (uint32_t i = 0; i < unCount; i++)
+	{
+		vecX[i] = RandomUnit();
+		vecY[i] = RandomUnit();
+		vecZ[i] = RandomUnit();
+		vecPoints[i] = Vector3((float)vecX[i], (float)vecY[i], (float)vecZ[i]);
+		vecRotations[i] = HmdQuaternion_Normalize(HmdQuaternion_Init(RandomUnit(), RandomUnit(), RandomUnit(), RandomUnit()));
+		vecMatrices[i].rotate((float)(RandomUnit() * 180.0), (float)RandomUnit(), (float)RandomUnit(), 1.0f);
+	}
+
+	// correctness first, on the untouched inputs
+	double flMaxError = 0.0;
+	{
+		std::vector<double> x(vecX), y(vecY), z(vecZ);
+		HmdQuaternion_TransformBatch(q, vecTranslation, x.data(), y.data(), z.data(), unCount);
+		HmdQuaternion_MultiplyBatch(q, vecRotations.data(), vecComposed.data(), unCount);
+		for (uint32_t i = 0; i < unCount; i++)
+		{
+			double vecIn[3] = { vecX[i], vecY[i], vecZ[i] };
+			double vecOut[3];
+			HmdQuaternion_RotateVector(q, vecIn, vecOut);
+			double rgflError[3] = { x[i] - vecOut[0] - vecTranslation[0], y[i] - vecOut[1] - vecTranslation[1], z[i] - vecOut[2] - vecTranslation[2] };
+			vr::HmdQuaternion_t qExpected = HmdQuaternion_Multiply(q, vecRotations[i]);
+			double rgflQuatError[4] = { vecComposed[i].w - qExpected.w, vecComposed[i].x - qExpected.x, vecComposed[i].y - qExpected.y, vecComposed[i].z - qExpected.z };
+			for (double flError : rgflError)
+				flMaxError = fabs(flError) > flMaxError ? fabs(flError) : flMaxError;
+			for (double flError : rgflQuatError)
+				flMaxError = fabs(flError) > flMaxError ? fabs(flError) : flMaxError;
+		}
+	}
+	printf("max batch error vs scalar: %.3g\n", flMaxError);
+
+	Matrix4 transform;
+	transform.rotate(37.0f, 0.2f, -0.6f, 0.4f);
+	transform.translate((float)vecTranslation[0], (float)vecTranslation[1], (float)vecTranslation[2]);
+
+	volatile double flSink = 0.0;
+
+	double flMatrixNs = TimeNanosecondsPerItem(unCount, unIterations, [&]()
+	{
+		for (uint32_t i = 0; i < unCount; i++)
+			vecPoints[i] = transform * vecPoints[i];
+		flSink = flSink + vecPoints[0].x;
+	});
+	double flScalarNs = TimeNanosecondsPerItem(unCount, unIterations, [&]()
+	{
+		for (uint32_t i = 0; i < unCount; i++)
+		{
+			double vecIn[3] = { vecX[i], vecY[i], vecZ[i] };
+			double vecOut[3];
+			HmdQuaternion_RotateVector(q, vecIn, vecOut);
+			vecX[i] = vecOut[0] + vecTranslation[0];
+			vecY[i] = vecOut[1] + vecTranslation[1];
+			vecZ[i] = vecOut[2] + vecTranslation[2];
+		}
+		flSink = flSink + vecX[0];
+	});
+	double flBatchNs = TimeNanosecondsPerItem(unCount, unIterations, [&]()
+	{
+		HmdQuaternion_TransformBatch(q, vecTranslation, vecX.data(), vecY.data(), vecZ.data(), unCount);
+		flSink = flSink + vecX[0];
+	});
+	printf("transform point:  Matrix4 %6.2f ns  RotateVector %6.2f ns  TransformBatch %6.2f ns\n", flMatrixNs, flScalarNs, flBatchNs);
+
+	flMatrixNs = TimeNanosecondsPerItem(unCount, unIterations, [&]()
+	{
+		for (uint32_t i = 0; i < unCount; i++)
+			vecMatricesOut[i] = transform * vecMatrices[i];
+		flSink = flSink + vecMatricesOut[0][0];
+	});
+	flScalarNs = TimeNanosecondsPerItem(unCount, unIterations, [&]()
+	{
+		for (uint32_t i = 0; i < unCount; i++)
+			vecComposed[i] = HmdQuaternion_Multiply(q, vecRotations[i]);
+		flSink = flSink + vecComposed[0].w;
+	});
+	flBatchNs = TimeNanosecondsPerItem(unCount, unIterations, [&]()
+	{
+		HmdQuaternion_MultiplyBatch(q, vecRotations.data(), vecComposed.data(), unCount);
+		flSink = flSink + vecComposed[0].w;
+	});
+	printf("compose rotation: Matrix4 %6.2f ns  Multiply     %6.2f ns  MultiplyBatch  %6.2f ns\n", flMatrixNs, flScalarNs, flBatchNs);
+
+	// Matrix4 on its own, checked against double precision
+	double flMaxMatrixError = 0.0;
+	for (uint32_t i = 0; i < unCount; i++)
+	{
+		// an affine pose, and a projective matrix that invert() hands to invertGeneral()
+		Matrix4 rgmat[2] = { vecMatrices[i], vecMatrices[i] };
+		rgmat[0].translate((float)vecX[i], (float)vecY[i], (float)vecZ[i]);
+		rgmat[1][3] = 0.25f;
+		for (const Matrix4& mat : rgmat)
+		{
+			Matrix4 matInverse = mat;
+			matInverse.invert();
+			for (int nCol = 0; nCol < 4; nCol++)
+			{
+				for (int nRow = 0; nRow < 4; nRow++)
+				{
+					double flProduct = 0.0;
+					for (int k = 0; k < 4; k++)
+						flProduct += (double)matInverse[k * 4 + nRow] * mat[nCol * 4 + k];
+					double flError = fabs(flProduct - (nRow == nCol ? 1.0 : 0.0));
+					flMaxMatrixError = flError > flMaxMatrixError ? flError : flMaxMatrixError;
+				}
+			}
+		}
+	}
+	printf("max Matrix4 inverse error: %.3g\n", flMaxMatrixError);
+
+	double flMultiplyNs = TimeNanosecondsPerItem(unCount, unIterations, [&]()
+	{
+		for (uint32_t i = 0; i < unCount; i++)
+			vecMatricesOut[i] = vecMatrices[i] * transform;
+		flSink = flSink + vecMatricesOut[0][0];
+	});
+	double flInvertNs = TimeNanosecondsPerItem(unCount, unIterations, [&]()
+	{
+		for (uint32_t i = 0; i < unCount; i++)
+		{
+			vecMatricesOut[i] = vecMatrices[i];
+			vecMatricesOut[i].invert();
+		}
+		flSink = flSink + vecMatricesOut[0][0];
+	});
+	double flInvertGeneralNs = TimeNanosecondsPerItem(unCount, unIterations, [&]()
+	{
+		for (uint32_t i = 0; i < unCount; i++)
+		{
+			vecMatricesOut[i] = vecMatrices[i];
+			vecMatricesOut[i].invertGeneral();
+		}
+		flSink = flSink + vecMatricesOut[0][0];
+	});
+	std::vector<Vector3> vecPointsOut(unCount);
+	double flTransformNs = TimeNanosecondsPerItem(unCount, unIterations, [&]()
+	{
+		transform.transform(vecPoints.data(), vecPointsOut.data(), (int)unCount);
+		flSink = flSink + vecPointsOut[0].x;
+	});
+	printf("Matrix4: multiply %6.2f ns  invert %6.2f ns  invertGeneral %6.2f ns  transform %6.2f ns\n",
+		flMultiplyNs, flInvertNs, flInvertGeneralNs, flTransformNs);
+
+	// fresh points, the ones above have shrunk towards denormals by now, and
+	// the same points as separate x, y and z arrays
+	std::vector<Vector3> vecBatchPoints(unCount);
+	for (uint32_t i = 0; i < unCount; i++)
+		vecBatchPoints[i] = Vector3((float)RandomUnit(), (float)RandomUnit(), (float)RandomUnit());
+	Vector3Batch pointBatch;
+	double flMaxBatchError = 0.0;
+	pointBatch.load(&vecBatchPoints[0].x, sizeof(Vector3), (int)unCount);
+	pointBatch.transformPoints(transform);
+	pointBatch.normalize();
+	for (uint32_t i = 0; i < unCount; i++)
+	{
+		Vector4 vecTransformed = transform * Vector4(vecBatchPoints[i].x, vecBatchPoints[i].y, vecBatchPoints[i].z, 1.0f);
+		Vector3 vecExpected = Vector3(vecTransformed.x, vecTransformed.y, vecTransformed.z).normalize();
+		double flError = (pointBatch.get((int)i) - vecExpected).length();
+		flMaxBatchError = flError > flMaxBatchError ? flError : flMaxBatchError;
+	}
+	printf("max Vector3Batch error: %.3g\n", flMaxBatchError);
+
+	double flPointsNs = TimeNanosecondsPerItem(unCount, unIterations, [&]()
+	{
+		for (uint32_t i = 0; i < unCount; i++)
+		{
+			Vector4 vecTransformed = transform * Vector4(vecBatchPoints[i].x, vecBatchPoints[i].y, vecBatchPoints[i].z, 1.0f);
+			vecPointsOut[i] = Vector3(vecTransformed.x, vecTransformed.y, vecTransformed.z).normalize();
+		}
+		flSink = flSink + vecPointsOut[0].x;
+	});
+	double flBatchPointsNs = TimeNanosecondsPerItem(unCount, unIterations, [&]()
+	{
+		pointBatch.load(&vecBatchPoints[0].x, sizeof(Vector3), (int)unCount);
+		pointBatch.transformPoints(transform);
+		pointBatch.normalize();
+		flSink = flSink + pointBatch.x()[0];
+	});
+	double flBoundsNs = TimeNanosecondsPerItem(unCount, unIterations, [&]()
+	{
+		Vector3 vecMins = vecBatchPoints[0], vecMaxs = vecBatchPoints[0];
+		for (uint32_t i = 1; i < unCount; i++)
+		{
+			vecMins.set(std::min(vecMins.x, vecBatchPoints[i].x), std::min(vecMins.y, vecBatchPoints[i].y), std::min(vecMins.z, vecBatchPoints[i].z));
+			vecMaxs.set(std::max(vecMaxs.x, vecBatchPoints[i].x), std::max(vecMaxs.y, vecBatchPoints[i].y), std::max(vecMaxs.z, vecBatchPoints[i].z));
+		}
+		Vector3 vecCenter = (vecMins + vecMaxs) * 0.5f;
+		float flRadius = 0.0f;
+		for (uint32_t i = 0; i < unCount; i++)
+			flRadius = std::max(flRadius, (vecBatchPoints[i] - vecCenter).length());
+		flSink = flSink + flRadius;
+	});
+	double flBatchBoundsNs = TimeNanosecondsPerItem(unCount, unIterations, [&]()
+	{
+		Vector3 vecMins, vecMaxs;
+		pointBatch.bounds(&vecMins, &vecMaxs);
+		flSink = flSink + pointBatch.maxDistance((vecMins + vecMaxs) * 0.5f);
+	});
+	printf("Vector3Batch: transform+normalize %6.2f ns (Vector3 %6.2f ns)  bounds+radius %6.2f ns (Vector3 %6.2f ns)\n",
+		flBatchPointsNs, flPointsNs, flBatchBoundsNs, flBoundsNs);
+
+	vr::TrackedDevicePose_t rgPoses[vr::k_unMaxTrackedDeviceCount] = {};
+	Matrix4 rgmatPoses[vr::k_unMaxTrackedDeviceCount];
+	for (uint32_t i = 0; i < vr::k_unMaxTrackedDeviceCount; i++)
+	{
+		for (int nRow = 0; nRow < 3; nRow++)
+			for (int nCol = 0; nCol < 4; nCol++)
+				rgPoses[i].mDeviceToAbsoluteTracking.m[nRow][nCol] = (float)RandomUnit();
+	}
+	double flConvertNs = TimeNanosecondsPerItem(vr::k_unMaxTrackedDeviceCount, unIterations * 16, [&]()
+	{
+		convertRowMajor3x4(rgmatPoses, &rgPoses[0].mDeviceToAbsoluteTracking.m[0][0], sizeof(vr::TrackedDevicePose_t), vr::k_unMaxTrackedDeviceCount);
+		flSink = flSink + rgmatPoses[0][12];
+	});
+	printf("convert %u poses: %6.2f ns/pose\n", vr::k_unMaxTrackedDeviceCount, flConvertNs);
+
+	return flMaxError < 1e-9 && flMaxMatrixError < 1e-3 && flMaxBatchError < 1e-5 ? 0 : 1;
+}
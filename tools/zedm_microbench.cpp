@@ -0,0 +1,463 @@
+//-----------------------------------------------------------------------------
+// Purpose: Times the building blocks on the per-sample path of the driver,
+// each on its own: quaternion math, the pose history's write and "pose at
+// time t" query, the IMU/visual fusion, the One-Euro filter bank, the IMU
+// ring, waking its reader on another thread and formatting a binary log
+// record. Each benchmark is run in batches
+// sized to take about k_flBatchSeconds, and the median of k_unRepetitions
+// batches is reported in ns per operation.
+//
+// --json writes the results as a flat {"name": ns} object, one line each, to
+// keep per commit; --baseline compares with such a file and exits 1 when a
+// benchmark got slower by more than --threshold (a fraction, 0.1 default).
+// Compare runs of the same build type on the same machine only.
+//
+// usage: zedm_microbench [--filter substring] [--json file] [--baseline file] [--threshold fraction]
+//-----------------------------------------------------------------------------
+#include "driverlog.h"
+#include "hmdmath.h"
+#include "imuring.h"
+#include "posefilter.h"
+#include "posefusion.h"
+#include "posehistory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const double k_flBatchSeconds = 0.1;
+static const uint32_t k_unRepetitions = 7;
+
+// the IMU and camera rates of a ZED M
+static const uint64_t k_ulImuIntervalNs = 2500000;
+static const uint64_t k_ulFrameIntervalNs = 16666667;
+
+struct Benchmark_t
+{
+	const char* pchName;
+	std::function<void(uint64_t ulIterations)> run; // ulIterations operations
+};
+
+static double RandomUnit()
+{
+	return rand() / (double)RAND_MAX * 2.0 - 1.0;
+}
+
+static vr::HmdQuaternion_t RandomRotation()
+{
+	return HmdQuaternion_Normalize(HmdQuaternion_Init(RandomUnit(), RandomUnit(), RandomUnit(), RandomUnit()));
+}
+
+static double MeasureNanosecondsPerOperation(const Benchmark_t& benchmark)
+{
+	// grow the batch until it takes long enough to time
+	uint64_t ulIterations = 1;
+	for (;;)
+	{
+		auto start = std::chrono::steady_clock::now();
+		benchmark.run(ulIterations);
+		double flSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (flSeconds >= k_flBatchSeconds / 10.0 || ulIterations >= (1ull << 40))
+		{
+			ulIterations = (uint64_t)(ulIterations * k_flBatchSeconds / std::max(flSeconds, 1e-9)) + 1;
+			break;
+		}
+		ulIterations *= 10;
+	}
+
+	std::vector<double> vecNs;
+	for (uint32_t i = 0; i < k_unRepetitions; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		benchmark.run(ulIterations);
+		vecNs.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ulIterations);
+	}
+	std::sort(vecNs.begin(), vecNs.end());
+	return vecNs[vecNs.size() / 2];
+}
+
+static bool LoadResults(const char* pchPath, std::map<std::string, double>* pmapResults)
+{
+	FILE* pFile = fopen(pchPath, "r");
+	if (!pFile)
+		return false;
+	char rgchLine[256];
+	while (fgets(rgchLine, sizeof(rgchLine), pFile))
+	{
+		char rgchName[128];
+		double flNs;
+		if (sscanf(rgchLine, " \"%127[^\"]\" : %lf", rgchName, &flNs) == 2)
+			(*pmapResults)[rgchName] = flNs;
+	}
+	fclose(pFile);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	const char* pchFilter = nullptr;
+	const char* pchJsonPath = nullptr;
+	const char* pchBaselinePath = nullptr;
+	double flThreshold = 0.1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+			pchFilter = argv[++i];
+		else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+			pchJsonPath = argv[++i];
+		else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+			pchBaselinePath = argv[++i];
+		else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+			flThreshold = atof(argv[++i]);
+		else
+		{
+			fprintf(stderr, "usage: %s [--filter substring] [--json file] [--baseline file] [--threshold fraction]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::map<std::string, double> mapBaseline;
+	if (pchBaselinePath && !LoadResults(pchBaselinePath, &mapBaseline))
+	{
+		fprintf(stderr, "Unable to read %s\n", pchBaselinePath);
+		return 1;
+	}
+
+	// inputs are made once; a benchmark cycles through them so the compiler can't fold the work away
+	static const uint32_t k_unInputs = 1024;
+	std::vector<vr::HmdQuaternion_t> vecRotations(k_unInputs);
+	std::vector<double> vecPoints(3 * k_unInputs);
+	for (uint32_t i = 0; i < k_unInputs; i++)
+	{
+		vecRotations[i] = RandomRotation();
+		for (int j = 0; j < 3; j++)
+			vecPoints[3 * i + j] = RandomUnit();
+	}
+	volatile double flSink = 0.0;
+
+	// a full history of IMU-rate poses, and the times queried between them
+	CPoseHistory* pHistory = new CPoseHistory();
+	uint64_t ulHistoryStartNs = 1000000000;
+	for (uint32_t i = 0; i < CPoseHistory::k_unCapacity; i++)
+	{
+		PoseHistorySample_t sample = {};
+		sample.ulTimestampNs = ulHistoryStartNs + i * k_ulImuIntervalNs;
+		sample.qRotation = vecRotations[i % k_unInputs];
+		sample.vecPosition[0] = vecPoints[3 * (i % k_unInputs)];
+		pHistory->Write(sample);
+	}
+	uint64_t ulHistorySpanNs = (CPoseHistory::k_unCapacity - 1) * k_ulImuIntervalNs;
+
+	CPoseFusion fusion;
+	CPoseFilterBank filter;
+	OneEuroParams_t filterParams = { 1.0, 0.5, 1.0 };
+	filter.Configure(true, filterParams);
+	CImuRing* pImuRing = new CImuRing();
+	CImuRing* pImuReplyRing = new CImuRing();
+
+	std::vector<Benchmark_t> vecBenchmarks = {
+		{ "quaternion.multiply", [&](uint64_t ulIterations)
+		{
+			vr::HmdQuaternion_t q = HmdQuaternion_Identity();
+			for (uint64_t i = 0; i < ulIterations; i++)
+				q = HmdQuaternion_Multiply(vecRotations[i % k_unInputs], q);
+			flSink = flSink + q.w;
+		} },
+		{ "quaternion.normalize", [&](uint64_t ulIterations)
+		{
+			double flSum = 0.0;
+			for (uint64_t i = 0; i < ulIterations; i++)
+				flSum += HmdQuaternion_Normalize(vecRotations[i % k_unInputs]).w;
+			flSink = flSink + flSum;
+		} },
+		{ "quaternion.slerp", [&](uint64_t ulIterations)
+		{
+			double flSum = 0.0;
+			for (uint64_t i = 0; i < ulIterations; i++)
+				flSum += HmdQuaternion_Slerp(vecRotations[i % k_unInputs], vecRotations[(i + 1) % k_unInputs], 0.3).w;
+			flSink = flSink + flSum;
+		} },
+		{ "quaternion.rotate_vector", [&](uint64_t ulIterations)
+		{
+			double flSum = 0.0;
+			for (uint64_t i = 0; i < ulIterations; i++)
+			{
+				double vecOut[3];
+				HmdQuaternion_RotateVector(vecRotations[i % k_unInputs], &vecPoints[3 * (i % k_unInputs)], vecOut);
+				flSum += vecOut[0];
+			}
+			flSink = flSink + flSum;
+		} },
+		{ "quaternion.to_matrix", [&](uint64_t ulIterations)
+		{
+			double flSum = 0.0;
+			for (uint64_t i = 0; i < ulIterations; i++)
+			{
+				double rgflMatrix[3][3];
+				HmdQuaternion_ToMatrix(vecRotations[i % k_unInputs], rgflMatrix);
+				flSum += rgflMatrix[0][0] + rgflMatrix[1][2] + rgflMatrix[2][1];
+			}
+			flSink = flSink + flSum;
+		} },
+		{ "quaternion.transform_batch_per_point", [&](uint64_t ulIterations)
+		{
+			// per point, a batch of k_unInputs at a time
+			static const double vecTranslation[3] = { 0.5, 1.5, -2.0 };
+			std::vector<double> x(k_unInputs), y(k_unInputs), z(k_unInputs);
+			for (uint64_t i = 0; i < ulIterations; i += k_unInputs)
+			{
+				uint32_t unCount = (uint32_t)std::min<uint64_t>(k_unInputs, ulIterations - i);
+				HmdQuaternion_TransformBatch(vecRotations[(i / k_unInputs) % k_unInputs], vecTranslation, x.data(), y.data(), z.data(), unCount);
+			}
+			flSink = flSink + x[0];
+		} },
+		{ "pose_history.write", [&](uint64_t ulIterations)
+		{
+			CPoseHistory& history = *pHistory;
+			PoseHistorySample_t sample = {};
+			PoseHistorySample_t latest;
+			history.GetLatest(&latest);
+			for (uint64_t i = 0; i < ulIterations; i++)
+			{
+				sample.ulTimestampNs = latest.ulTimestampNs + (i + 1) * k_ulImuIntervalNs;
+				sample.qRotation = vecRotations[i % k_unInputs];
+				history.Write(sample);
+			}
+		} },
+		{ "pose_history.query_interpolate", [&](uint64_t ulIterations)
+		{
+			PoseHistorySample_t latest;
+			pHistory->GetLatest(&latest);
+			uint64_t ulOldestNs = latest.ulTimestampNs - ulHistorySpanNs;
+			double flSum = 0.0;
+			for (uint64_t i = 0; i < ulIterations; i++)
+			{
+				PoseHistorySample_t pose;
+				// a time between two samples, spread over the whole history
+				uint64_t ulTimestampNs = ulOldestNs + (i * 7919 % CPoseHistory::k_unCapacity) * (ulHistorySpanNs / CPoseHistory::k_unCapacity) + 1;
+				if (pHistory->Query(ulTimestampNs, &pose))
+					flSum += pose.qRotation.w;
+			}
+			flSink = flSink + flSum;
+		} },
+		{ "pose_history.query_extrapolate", [&](uint64_t ulIterations)
+		{
+			PoseHistorySample_t latest;
+			pHistory->GetLatest(&latest);
+			double flSum = 0.0;
+			for (uint64_t i = 0; i < ulIterations; i++)
+			{
+				PoseHistorySample_t pose;
+				if (pHistory->Query(latest.ulTimestampNs + 1000000 + i % 1000, &pose))
+					flSum += pose.vecPosition[0];
+			}
+			flSink = flSink + flSum;
+		} },
+		{ "fusion.imu_sample", [&](uint64_t ulIterations)
+		{
+			// per IMU sample: AddImuSample and GetPose, plus a visual sample every frame's worth of them
+			fusion.Reset();
+			uint64_t ulTimestampNs = 1000000000;
+			uint64_t ulNextFrameNs = ulTimestampNs;
+			double vecVelocity[3] = { 0.1, 0.0, -0.2 };
+			double flSum = 0.0;
+			for (uint64_t i = 0; i < ulIterations; i++)
+			{
+				ulTimestampNs += k_ulImuIntervalNs;
+				fusion.AddImuSample(vecRotations[i % k_unInputs], ulTimestampNs);
+				if (ulTimestampNs >= ulNextFrameNs)
+				{
+					fusion.AddVisualSample(&vecPoints[3 * (i % k_unInputs)], vecVelocity, vecRotations[(i + 3) % k_unInputs], ulTimestampNs - k_ulImuIntervalNs);
+					ulNextFrameNs += k_ulFrameIntervalNs;
+				}
+				CPoseFusion::FusedPose_t pose;
+				if (fusion.GetPose(ulTimestampNs, &pose))
+					flSum += pose.qRotation.w;
+			}
+			flSink = flSink + flSum;
+		} },
+		{ "filter.one_pose", [&](uint64_t ulIterations)
+		{
+			filter.Reset();
+			vr::DriverPose_t pose = {};
+			pose.poseIsValid = true;
+			for (uint64_t i = 0; i < ulIterations; i++)
+			{
+				for (int j = 0; j < 3; j++)
+					pose.vecPosition[j] = vecPoints[3 * (i % k_unInputs) + j];
+				pose.qRotation = vecRotations[i % k_unInputs];
+				filter.Filter(&pose, 1, 1000000000 + (i + 1) * k_ulImuIntervalNs);
+			}
+			flSink = flSink + pose.vecPosition[0];
+		} },
+		{ "filter.eight_poses", [&](uint64_t ulIterations)
+		{
+			// per call, all CPoseFilterBank::k_unMaxPoses poses together as for a body
+			filter.Reset();
+			vr::DriverPose_t rgPoses[CPoseFilterBank::k_unMaxPoses] = {};
+			for (uint64_t i = 0; i < ulIterations; i++)
+			{
+				for (uint32_t unPose = 0; unPose < CPoseFilterBank::k_unMaxPoses; unPose++)
+				{
+					uint32_t unInput = (uint32_t)((i + unPose) % k_unInputs);
+					rgPoses[unPose].poseIsValid = true;
+					for (int j = 0; j < 3; j++)
+						rgPoses[unPose].vecPosition[j] = vecPoints[3 * unInput + j];
+					rgPoses[unPose].qRotation = vecRotations[unInput];
+				}
+				filter.Filter(rgPoses, CPoseFilterBank::k_unMaxPoses, 1000000000 + (i + 1) * k_ulFrameIntervalNs);
+			}
+			flSink = flSink + rgPoses[0].vecPosition[0];
+		} },
+		{ "imu_ring.write_read", [&](uint64_t ulIterations)
+		{
+			// per sample: written, then read by a consumer that keeps up four at a time
+			CImuRing& ring = *pImuRing;
+			uint64_t ulNext = ring.GetWriteCount();
+			ImuRingSample_t sample = {};
+			ImuRingSample_t rgRead[4];
+			double flSum = 0.0;
+			for (uint64_t i = 0; i < ulIterations; i++)
+			{
+				sample.ulTimestampNs += k_ulImuIntervalNs;
+				sample.qOrientation = vecRotations[i % k_unInputs];
+				ring.Write(sample);
+				if ((i & 3) == 3)
+				{
+					uint32_t unRead = ring.Read(&ulNext, rgRead, 4);
+					flSum += unRead > 0 ? rgRead[unRead - 1].qOrientation.w : 0.0;
+				}
+			}
+			flSink = flSink + flSum;
+		} },
+		{ "imu_ring.wake_round_trip", [&](uint64_t ulIterations)
+		{
+			// per sample: written, the sleeping reader thread woken, and its reply woken back
+			CImuRing& ring = *pImuRing;
+			CImuRing& reply = *pImuReplyRing;
+			uint64_t ulNext = ring.GetWriteCount();
+			uint64_t ulReplyNext = reply.GetWriteCount();
+			std::thread reader([&ring, &reply, ulNext, ulIterations]()
+			{
+				uint64_t ulReaderNext = ulNext;
+				ImuRingSample_t sample;
+				for (uint64_t i = 0; i < ulIterations; i++)
+				{
+					while (!ring.WaitForWrite(ulReaderNext))
+					{
+					}
+					ring.Read(&ulReaderNext, &sample, 1);
+					reply.Write(sample);
+				}
+			});
+			ImuRingSample_t sample = {};
+			for (uint64_t i = 0; i < ulIterations; i++)
+			{
+				sample.ulTimestampNs += k_ulImuIntervalNs;
+				ring.Write(sample);
+				while (!reply.WaitForWrite(ulReplyNext))
+				{
+				}
+				reply.Read(&ulReplyNext, &sample, 1);
+			}
+			reader.join();
+			flSink = flSink + (double)sample.ulTimestampNs;
+		} },
+		{ "log.binary_args", [&](uint64_t ulIterations)
+		{
+			// what DriverTrace does on the calling thread
+			uint32_t unSize = 0;
+			for (uint64_t i = 0; i < ulIterations; i++)
+			{
+				CBinaryLogArgs args;
+				args.Put((unsigned int)i);
+				args.Put(vecPoints[i % k_unInputs]);
+				args.Put("tracking");
+				unSize += args.GetSize();
+			}
+			flSink = flSink + unSize;
+		} },
+		{ "log.format_binary_record", [&](uint64_t ulIterations)
+		{
+			// what the flush thread does per record for vrserver.txt
+			CBinaryLogArgs args;
+			args.Put(12345678u);
+			args.Put(0.0123);
+			args.Put("tracking");
+			char rgchLine[256];
+			uint32_t unLength = 0;
+			for (uint64_t i = 0; i < ulIterations; i++)
+			{
+				FormatBinaryLogRecord("ZED %u: grab took %.3f s, %s\n", args.GetData(), args.GetSize(), rgchLine, sizeof(rgchLine));
+				unLength += (uint32_t)rgchLine[4];
+			}
+			flSink = flSink + unLength;
+		} },
+		{ "log.snprintf", [&](uint64_t ulIterations)
+		{
+			// the same line formatted directly, for comparison
+			char rgchLine[256];
+			uint32_t unLength = 0;
+			for (uint64_t i = 0; i < ulIterations; i++)
+				unLength += (uint32_t)snprintf(rgchLine, sizeof(rgchLine), "ZED %u: grab took %.3f s, %s\n", 12345678u, vecPoints[i % k_unInputs], "tracking");
+			flSink = flSink + unLength;
+		} },
+	};
+
+	std::map<std::string, double> mapResults;
+	int nRegressions = 0;
+	for (const Benchmark_t& benchmark : vecBenchmarks)
+	{
+		if (pchFilter && !strstr(benchmark.pchName, pchFilter))
+			continue;
+		double flNs = MeasureNanosecondsPerOperation(benchmark);
+		mapResults[benchmark.pchName] = flNs;
+
+		auto itBaseline = mapBaseline.find(benchmark.pchName);
+		if (itBaseline == mapBaseline.end() || itBaseline->second <= 0.0)
+		{
+			printf("%-38s %10.2f ns\n", benchmark.pchName, flNs);
+			continue;
+		}
+		double flChange = flNs / itBaseline->second - 1.0;
+		bool bRegression = flChange > flThreshold;
+		printf("%-38s %10.2f ns  %+6.1f%%%s\n", benchmark.pchName, flNs, flChange * 100.0, bRegression ? "  REGRESSION" : "");
+		if (bRegression)
+			nRegressions++;
+	}
+
+	delete pImuReplyRing;
+	delete pImuRing;
+	delete pHistory;
+
+	if (pchJsonPath)
+	{
+		FILE* pFile = fopen(pchJsonPath, "w");
+		if (!pFile)
+		{
+			fprintf(stderr, "Unable to create %s\n", pchJsonPath);
+			return 1;
+		}
+		fprintf(pFile, "{\n");
+		size_t unWritten = 0;
+		for (const auto& result : mapResults)
+			fprintf(pFile, "\"%s\": %.3f%s\n", result.first.c_str(), result.second, ++unWritten < mapResults.size() ? "," : "");
+		fprintf(pFile, "}\n");
+		fclose(pFile);
+	}
+
+	if (nRegressions > 0)
+	{
+		printf("%d benchmark(s) more than %.0f%% slower than %s\n", nRegressions, flThreshold * 100.0, pchBaselinePath);
+		return 1;
+	}
+	return 0;
+}
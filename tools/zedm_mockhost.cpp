@@ -0,0 +1,157 @@
+//-----------------------------------------------------------------------------
+// Purpose: Loads the driver DLL into a mock vrserver and runs it for a while:
+// Init, Activate on every added device, RunFrame at 90 Hz, then shutdown. All
+// pose updates are recorded and summarized, optionally dumped as CSV. Meant for
+// profiling the shipping driver binary and for soak runs without SteamVR.
+//
+// usage: zedm_mockhost <driver dll> [--seconds N] [--csv file] [section/key=value ...]
+//-----------------------------------------------------------------------------
+#include "latencystats.h"
+#include "mockdrivercontext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+typedef void* (*HmdDriverFactoryFn)(const char* pInterfaceName, int* pReturnCode);
+
+static const std::chrono::microseconds k_RunFrameInterval(11111);
+
+static HmdDriverFactoryFn LoadDriverFactory(const char* pchPath)
+{
+#if defined(_WIN32)
+	HMODULE hModule = LoadLibraryA(pchPath);
+	return hModule ? (HmdDriverFactoryFn)GetProcAddress(hModule, "HmdDriverFactory") : nullptr;
+#else
+	void* pModule = dlopen(pchPath, RTLD_NOW | RTLD_LOCAL);
+	return pModule ? (HmdDriverFactoryFn)dlsym(pModule, "HmdDriverFactory") : nullptr;
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <driver dll> [--seconds N] [--csv file] [section/key=value ...]\n", argv[0]);
+		return 1;
+	}
+
+	CMockDriverContext context;
+	double flSeconds = 10.0;
+	const char* pchCsvPath = nullptr;
+
+	for (int i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+			flSeconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+			pchCsvPath = argv[++i];
+		else if (!context.m_settings.ParseAssignment(argv[i]))
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	HmdDriverFactoryFn pFactory = LoadDriverFactory(argv[1]);
+	if (!pFactory)
+	{
+		fprintf(stderr, "Unable to load HmdDriverFactory from %s\n", argv[1]);
+		return 1;
+	}
+
+	int nError = vr::VRInitError_None;
+	vr::IServerTrackedDeviceProvider* pProvider = (vr::IServerTrackedDeviceProvider*)pFactory(vr::IServerTrackedDeviceProvider_Version, &nError);
+	if (!pProvider)
+	{
+		fprintf(stderr, "Driver has no %s (error %d)\n", vr::IServerTrackedDeviceProvider_Version, nError);
+		return 1;
+	}
+
+	vr::EVRInitError eInitError = pProvider->Init(&context);
+	if (eInitError != vr::VRInitError_None)
+	{
+		fprintf(stderr, "Driver Init failed with %d\n", (int)eInitError);
+		return 1;
+	}
+
+	std::vector<MockTrackedDevice_t> vecDevices = context.m_host.GetDevices();
+	for (uint32_t i = 0; i < vecDevices.size(); i++)
+	{
+		vr::EVRInitError eError = vecDevices[i].pDriver->Activate(i);
+		printf("Activated %s as device %u: %d\n", vecDevices[i].sSerialNumber.c_str(), i, (int)eError);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	auto nextFrame = start;
+	uint64_t ulRunFrames = 0;
+	while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < flSeconds)
+	{
+		pProvider->RunFrame();
+		ulRunFrames++;
+		nextFrame += k_RunFrameInterval;
+		std::this_thread::sleep_until(nextFrame);
+	}
+
+	context.m_host.SetExiting(true);
+	for (uint32_t i = 0; i < vecDevices.size(); i++)
+		vecDevices[i].pDriver->Deactivate();
+	pProvider->Cleanup();
+
+	std::vector<MockPoseUpdate_t> vecUpdates = context.m_host.TakePoseUpdates();
+
+	// per device: count, valid poses and the spacing between consecutive updates
+	for (uint32_t unDevice = 0; unDevice < vecDevices.size(); unDevice++)
+	{
+		CLatencyHistogram intervals;
+		uint64_t ulCount = 0, ulValid = 0, ulLastNs = 0;
+		for (const MockPoseUpdate_t& update : vecUpdates)
+		{
+			if (update.unDeviceIndex != unDevice)
+				continue;
+			ulCount++;
+			if (update.pose.poseIsValid)
+				ulValid++;
+			if (ulLastNs)
+				intervals.Record(update.ulReceivedNs - ulLastNs);
+			ulLastNs = update.ulReceivedNs;
+		}
+
+		LatencySummary_t summary = intervals.Summarize();
+		printf("device %u (%s): %llu poses (%llu valid), %.1f/s, interval p50=%.0fus p99=%.0fus max=%.0fus\n", unDevice,
+			vecDevices[unDevice].sSerialNumber.c_str(), (unsigned long long)ulCount, (unsigned long long)ulValid,
+			ulCount / flSeconds, summary.flP50Us, summary.flP99Us, summary.flMaxUs);
+	}
+	printf("%llu RunFrame calls, %llu property writes\n", (unsigned long long)ulRunFrames, (unsigned long long)context.m_properties.GetWriteCount());
+
+	if (pchCsvPath)
+	{
+		FILE* pFile = fopen(pchCsvPath, "w");
+		if (!pFile)
+		{
+			fprintf(stderr, "Unable to create %s\n", pchCsvPath);
+			return 1;
+		}
+		fprintf(pFile, "device,received_ns,valid,result,x,y,z,qw,qx,qy,qz,time_offset\n");
+		for (const MockPoseUpdate_t& update : vecUpdates)
+		{
+			const vr::DriverPose_t& pose = update.pose;
+			fprintf(pFile, "%u,%llu,%d,%d,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n", update.unDeviceIndex,
+				(unsigned long long)update.ulReceivedNs, pose.poseIsValid ? 1 : 0, (int)pose.result,
+				pose.vecPosition[0], pose.vecPosition[1], pose.vecPosition[2],
+				pose.qRotation.w, pose.qRotation.x, pose.qRotation.y, pose.qRotation.z, pose.poseTimeOffset);
+		}
+		fclose(pFile);
+	}
+
+	return 0;
+}
@@ -0,0 +1,766 @@
+//-----------------------------------------------------------------------------
+// Purpose: Grades a pose recording (driver_zedm/poseRecordingPath) offline:
+// record rates, the distributions of the sample intervals and of the pose
+// age at publish, publish gaps, tracking-loss intervals and the spectrum of
+// the published position's jitter.
+//
+// The recording is memory-mapped and cut into one chunk per thread. The
+// delta-encoded timestamps make a chunk's start depend on everything before
+// it, so a first pass only sums each chunk's deltas, after which the chunks
+// are analyzed in parallel from their resolved starts. What spans two chunks,
+// an interval, a tracking loss or a jitter segment, is stitched together when
+// merging. The publish gap threshold and the jitter resampling rate default to
+// multiples of the median publish interval, so gaps and jitter are a third pass.
+//
+// usage: zedm_poseanalyze [--threads n] [--gap ms] [--rate hz] [--list] <recording>
+//-----------------------------------------------------------------------------
+#include "latencystats.h"
+#include "poserecordingview.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <complex>
+#include <thread>
+#include <vector>
+
+static const double k_flPi = 3.14159265358979323846;
+
+// the record types with samples of their own, for the interval histograms
+enum EStream
+{
+	Stream_Visual = 0,
+	Stream_Imu,
+	Stream_Published,
+
+	Stream_Count
+};
+
+static const char* const k_rpchStreamNames[Stream_Count] = { "visual", "imu", "published" };
+
+// without --gap, an interval between two valid published poses this many median intervals long is a gap
+static const double k_flGapMedians = 2.5;
+
+// without --list, the longest few gaps and losses are printed
+static const size_t k_unListedIntervals = 10;
+
+// Welch's method: segments of this many resampled poses, detrended and Hann windowed
+static const uint32_t k_unSpectrumSegment = 256;
+
+// a run of resampled poses is cut where two are further apart than this many resampling periods
+static const double k_flMaxRunGapPeriods = 4.0;
+
+// the lowest jitter band; slower than this is the user moving
+static const double k_flMinJitterHz = 1.0;
+
+// how far back before a chunk its first published poses look for their visual pose
+static const size_t k_unMaxVisualLookback = 4096;
+
+struct Interval_t
+{
+	uint64_t ulStartNs;
+	uint64_t ulEndNs;
+	bool bLost; // a gap with an invalid pose published in it; a loss still lost at the end
+};
+
+static bool IsLonger(const Interval_t& a, const Interval_t& b)
+{
+	return a.ulEndNs - a.ulStartNs > b.ulEndNs - b.ulStartNs;
+}
+
+static bool IsEarlier(const Interval_t& a, const Interval_t& b)
+{
+	return a.ulStartNs < b.ulStartNs;
+}
+
+static EStream GetStream(uint8_t unType)
+{
+	switch (unType)
+	{
+	case PoseRecord_Visual:
+		return Stream_Visual;
+	case PoseRecord_Imu:
+		return Stream_Imu;
+	default:
+		return Stream_Published;
+	}
+}
+
+// the timestamp just before each chunk
+struct ChunkBounds_t
+{
+	size_t unBegin;
+	size_t unEnd;
+	uint64_t ulStartNs;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Pass 1, the chunk's effect on the running timestamp: a sync record
+// sets it, so from the last sync on the end is known without the start
+//-----------------------------------------------------------------------------
+struct ChunkScan_t
+{
+	bool bSync;
+	uint64_t ulEndNs; // absolute with bSync, otherwise the sum of the deltas
+};
+
+static ChunkScan_t ScanChunk(const CPoseRecordingView& view, size_t unBegin, size_t unEnd)
+{
+	ChunkScan_t scan = { false, 0 };
+	for (size_t i = unBegin; i < unEnd; i++)
+	{
+		const PoseRecord_t& record = view.GetRecord(i);
+		if (record.unType == PoseRecord_Sync)
+		{
+			scan.bSync = true;
+			scan.ulEndNs = record.ulAbsoluteTimestampNs;
+		}
+		else
+		{
+			scan.ulEndNs += (int64_t)record.nDeltaNs;
+		}
+	}
+	return scan;
+}
+
+// the last visual pose before the chunk: the deltas undone from its start back to it, unless a sync is in the way
+static uint64_t FindVisualBefore(const CPoseRecordingView& view, const ChunkBounds_t& bounds)
+{
+	uint64_t ulTimestampNs = bounds.ulStartNs;
+	size_t unStop = bounds.unBegin > k_unMaxVisualLookback ? bounds.unBegin - k_unMaxVisualLookback : 0;
+	for (size_t i = bounds.unBegin; i-- > unStop;)
+	{
+		const PoseRecord_t& record = view.GetRecord(i);
+		if (record.unType == PoseRecord_Sync)
+			return 0;
+		if (record.unType == PoseRecord_Visual)
+			return ulTimestampNs;
+		ulTimestampNs -= (int64_t)record.nDeltaNs;
+	}
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Pass 2, everything that doesn't need the median publish interval.
+// Invalid published poses carry no timestamp; they are placed at the last
+// timestamp before them, or at the previous chunk's when the chunk has none.
+//-----------------------------------------------------------------------------
+struct ChunkStats_t
+{
+	uint64_t rgulRecords[Stream_Count];
+	uint64_t ulInvalid; // published poses without the valid flag
+	uint64_t ulSubmitted;
+	CLatencyHistogram rgInterval[Stream_Count];
+	CLatencyHistogram poseAge; // -poseTimeOffset, the sample's age when published
+	CLatencyHistogram visualAge; // from the last visual pose to the published sample
+	uint64_t rgulFirstNs[Stream_Count]; // 0 for none, to stitch the intervals across chunks
+	uint64_t rgulLastNs[Stream_Count];
+	uint64_t ulMinNs;
+	uint64_t ulMaxNs;
+	uint64_t ulLastNonzeroNs;
+
+	// tracking losses: from an invalid pose published after a valid one to the next valid one
+	bool bLeadingLoss; // an invalid pose before the chunk's first valid one
+	uint64_t ulLeadingLossNs; // 0 when the previous chunk's last timestamp applies
+	uint64_t ulFirstValidNs;
+	std::vector<Interval_t> vecLosses; // begun and ended in the chunk
+	bool bOpenLoss; // begun after a valid pose, not over at the chunk's end
+	uint64_t ulOpenLossNs;
+};
+
+static void AnalyzeChunk(const CPoseRecordingView& view, const ChunkBounds_t& bounds, ChunkStats_t* pStats)
+{
+	memset(pStats->rgulRecords, 0, sizeof(pStats->rgulRecords));
+	memset(pStats->rgulFirstNs, 0, sizeof(pStats->rgulFirstNs));
+	memset(pStats->rgulLastNs, 0, sizeof(pStats->rgulLastNs));
+	pStats->ulInvalid = pStats->ulSubmitted = 0;
+	pStats->ulMinNs = UINT64_MAX;
+	pStats->ulMaxNs = pStats->ulLastNonzeroNs = 0;
+	pStats->bLeadingLoss = pStats->bOpenLoss = false;
+	pStats->ulLeadingLossNs = pStats->ulFirstValidNs = pStats->ulOpenLossNs = 0;
+
+	uint64_t ulLastVisualNs = FindVisualBefore(view, bounds);
+	CPoseRecordingView::CIterator iter(view, bounds.unBegin, bounds.unEnd, bounds.ulStartNs);
+	const PoseRecord_t* pRecord;
+	uint64_t ulTimestampNs;
+	while (iter.Next(&pRecord, &ulTimestampNs))
+	{
+		EStream eStream = GetStream(pRecord->unType);
+		pStats->rgulRecords[eStream]++;
+		if (ulTimestampNs != 0)
+		{
+			pStats->ulLastNonzeroNs = ulTimestampNs;
+			pStats->ulMinNs = std::min(pStats->ulMinNs, ulTimestampNs);
+			pStats->ulMaxNs = std::max(pStats->ulMaxNs, ulTimestampNs);
+		}
+
+		bool bValid = eStream != Stream_Published || (pRecord->unFlags & k_unPoseRecordFlag_Valid) != 0;
+		if (eStream == Stream_Published)
+		{
+			if (pRecord->unFlags & k_unPoseRecordFlag_Submitted)
+				pStats->ulSubmitted++;
+
+			if (!bValid)
+			{
+				pStats->ulInvalid++;
+				if (pStats->ulFirstValidNs == 0 && !pStats->bLeadingLoss)
+				{
+					pStats->bLeadingLoss = true;
+					pStats->ulLeadingLossNs = pStats->ulLastNonzeroNs;
+				}
+				else if (pStats->ulFirstValidNs != 0 && !pStats->bOpenLoss)
+				{
+					pStats->bOpenLoss = true;
+					pStats->ulOpenLossNs = pStats->ulLastNonzeroNs;
+				}
+				continue;
+			}
+			if (ulTimestampNs == 0)
+				continue;
+
+			if (pStats->ulFirstValidNs == 0)
+			{
+				pStats->ulFirstValidNs = ulTimestampNs;
+			}
+			else if (pStats->bOpenLoss)
+			{
+				Interval_t loss = { pStats->ulOpenLossNs, ulTimestampNs, false };
+				pStats->vecLosses.push_back(loss);
+				pStats->bOpenLoss = false;
+			}
+
+			double flAge = -pRecord->rgflValues[13];
+			if (flAge > 0.0)
+				pStats->poseAge.Record((uint64_t)(flAge * 1e9));
+			if (ulLastVisualNs != 0 && ulTimestampNs >= ulLastVisualNs)
+				pStats->visualAge.Record(ulTimestampNs - ulLastVisualNs);
+		}
+		else if (eStream == Stream_Visual && ulTimestampNs > ulLastVisualNs)
+		{
+			ulLastVisualNs = ulTimestampNs;
+		}
+
+		// the threads' records interleave in the file, each stream's are in order
+		if (ulTimestampNs == 0)
+			continue;
+		if (pStats->rgulFirstNs[eStream] == 0)
+			pStats->rgulFirstNs[eStream] = ulTimestampNs;
+		else if (ulTimestampNs > pStats->rgulLastNs[eStream])
+			pStats->rgInterval[eStream].Record(ulTimestampNs - pStats->rgulLastNs[eStream]);
+		pStats->rgulLastNs[eStream] = std::max(pStats->rgulLastNs[eStream], ulTimestampNs);
+	}
+}
+
+// in place, unCount a power of two
+static void Fft(std::complex<double>* pData, uint32_t unCount)
+{
+	for (uint32_t i = 1, j = 0; i < unCount; i++)
+	{
+		uint32_t unBit = unCount >> 1;
+		for (; j & unBit; unBit >>= 1)
+			j ^= unBit;
+		j ^= unBit;
+		if (i < j)
+			std::swap(pData[i], pData[j]);
+	}
+
+	for (uint32_t unLength = 2; unLength <= unCount; unLength <<= 1)
+	{
+		double flAngle = -2.0 * k_flPi / unLength;
+		std::complex<double> wStep(cos(flAngle), sin(flAngle));
+		for (uint32_t i = 0; i < unCount; i += unLength)
+		{
+			std::complex<double> w(1.0, 0.0);
+			for (uint32_t j = 0; j < unLength / 2; j++)
+			{
+				std::complex<double> u = pData[i + j];
+				std::complex<double> v = pData[i + j + unLength / 2] * w;
+				pData[i + j] = u + v;
+				pData[i + j + unLength / 2] = u - v;
+				w *= wStep;
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Pass 3, publish gaps and the position jitter. The valid published
+// positions are resampled by linear interpolation onto a uniform grid anchored
+// at the recording's origin; every k_unSpectrumSegment consecutive grid points
+// starting at a multiple of it have their linear trend removed, are windowed
+// and add their periodogram to the chunk's sum. Runs are cut at invalid poses
+// and long gaps. Because grid and segments are anchored to the recording, a
+// chunk can hand the merge the points before its first segment start and its
+// open segment at the end, and the segments come out the same for any number
+// of chunks.
+//-----------------------------------------------------------------------------
+struct JitterSample_t
+{
+	uint64_t ulTimestampNs;
+	double rgflPosition[3];
+};
+
+// the resampled points of the segment being filled
+struct JitterSegment_t
+{
+	int64_t nNextPoint; // grid index that continues the segment, -1 after a cut
+	std::vector<double> vecPoints; // xyz per grid point
+};
+
+struct ChunkJitter_t
+{
+	JitterSample_t firstValid; // timestamp 0 if the chunk has no valid pose
+	JitterSample_t lastValid;
+	bool bLossBeforeFirst;
+	bool bLossAfterLast;
+	std::vector<Interval_t> vecGaps;
+
+	// points before the chunk's first segment start or run cut, for the previous chunk's open segment
+	int64_t nHeadFirstPoint;
+	std::vector<double> vecHead;
+	bool bHeadOpen; // no segment start or cut in the chunk, so the open segment runs through it
+	JitterSegment_t tail;
+
+	uint32_t unSegments;
+	std::vector<double> vecPower; // |X(k)|^2 per bin up to Nyquist, summed over segments and axes
+};
+
+struct JitterParams_t
+{
+	uint64_t ulGapNs;
+	uint64_t ulOriginNs; // of the resampling grid
+	double flPeriodNs;
+	uint64_t ulMaxRunGapNs;
+	const double* pflWindow;
+};
+
+static void AddSegment(const double* pflSegment, const JitterParams_t& params, ChunkJitter_t* pJitter)
+{
+	const uint32_t N = k_unSpectrumSegment;
+	std::complex<double> rgData[k_unSpectrumSegment];
+	for (int nAxis = 0; nAxis < 3; nAxis++)
+	{
+		// least squares line through the segment, centered so its slope and mean are independent
+		double flMean = 0.0;
+		double flSlope = 0.0;
+		double flSumX2 = 0.0;
+		for (uint32_t i = 0; i < N; i++)
+		{
+			double x = i - (N - 1) * 0.5;
+			flMean += pflSegment[i * 3 + nAxis];
+			flSlope += x * pflSegment[i * 3 + nAxis];
+			flSumX2 += x * x;
+		}
+		flMean /= N;
+		flSlope /= flSumX2;
+
+		for (uint32_t i = 0; i < N; i++)
+		{
+			double x = i - (N - 1) * 0.5;
+			rgData[i] = (pflSegment[i * 3 + nAxis] - flMean - flSlope * x) * params.pflWindow[i];
+		}
+		Fft(rgData, N);
+		for (uint32_t k = 0; k <= N / 2; k++)
+			pJitter->vecPower[k] += std::norm(rgData[k]);
+	}
+	pJitter->unSegments++;
+}
+
+// appends one grid point; a segment only starts at a multiple of k_unSpectrumSegment
+static void AddPoint(JitterSegment_t* pSegment, int64_t nPoint, const double* pflPosition, const JitterParams_t& params, ChunkJitter_t* pJitter)
+{
+	if (nPoint != pSegment->nNextPoint)
+		pSegment->vecPoints.clear();
+	pSegment->nNextPoint = nPoint + 1;
+	if (pSegment->vecPoints.empty() && nPoint % k_unSpectrumSegment != 0)
+		return;
+
+	pSegment->vecPoints.insert(pSegment->vecPoints.end(), pflPosition, pflPosition + 3);
+	if (pSegment->vecPoints.size() == k_unSpectrumSegment * 3)
+	{
+		AddSegment(pSegment->vecPoints.data(), params, pJitter);
+		pSegment->vecPoints.clear();
+	}
+}
+
+// the grid points in (from, to], or false if the run is cut between the two samples
+template <typename Function>
+static bool Resample(const JitterSample_t& from, const JitterSample_t& to, const JitterParams_t& params, Function addPoint)
+{
+	if (to.ulTimestampNs <= from.ulTimestampNs || to.ulTimestampNs - from.ulTimestampNs > params.ulMaxRunGapNs)
+		return false;
+
+	double flFrom = (int64_t)(from.ulTimestampNs - params.ulOriginNs) / params.flPeriodNs;
+	double flTo = (int64_t)(to.ulTimestampNs - params.ulOriginNs) / params.flPeriodNs;
+	for (int64_t nPoint = (int64_t)floor(flFrom) + 1; nPoint <= (int64_t)floor(flTo); nPoint++)
+	{
+		double t = (nPoint - flFrom) / (flTo - flFrom);
+		double rgflPosition[3];
+		for (int i = 0; i < 3; i++)
+			rgflPosition[i] = from.rgflPosition[i] + (to.rgflPosition[i] - from.rgflPosition[i]) * t;
+		addPoint(nPoint, rgflPosition);
+	}
+	return true;
+}
+
+static void AnalyzeJitter(const CPoseRecordingView& view, const ChunkBounds_t& bounds, const JitterParams_t& params, ChunkJitter_t* pJitter)
+{
+	pJitter->firstValid.ulTimestampNs = pJitter->lastValid.ulTimestampNs = 0;
+	pJitter->bLossBeforeFirst = pJitter->bLossAfterLast = false;
+	pJitter->nHeadFirstPoint = -1;
+	pJitter->bHeadOpen = true;
+	pJitter->tail.nNextPoint = -1;
+	pJitter->unSegments = 0;
+	pJitter->vecPower.assign(k_unSpectrumSegment / 2 + 1, 0.0);
+
+	pJitter->tail.vecPoints.reserve(k_unSpectrumSegment * 3);
+	auto addPoint = [&](int64_t nPoint, const double* pflPosition)
+	{
+		if (pJitter->bHeadOpen && nPoint % k_unSpectrumSegment != 0)
+		{
+			if (pJitter->vecHead.empty())
+				pJitter->nHeadFirstPoint = nPoint;
+			pJitter->vecHead.insert(pJitter->vecHead.end(), pflPosition, pflPosition + 3);
+			return;
+		}
+		pJitter->bHeadOpen = false;
+		AddPoint(&pJitter->tail, nPoint, pflPosition, params, pJitter);
+	};
+
+	CPoseRecordingView::CIterator iter(view, bounds.unBegin, bounds.unEnd, bounds.ulStartNs);
+	const PoseRecord_t* pRecord;
+	uint64_t ulTimestampNs;
+	while (iter.Next(&pRecord, &ulTimestampNs))
+	{
+		if (pRecord->unType != PoseRecord_Published)
+			continue;
+
+		if (!(pRecord->unFlags & k_unPoseRecordFlag_Valid))
+		{
+			if (pJitter->firstValid.ulTimestampNs == 0)
+				pJitter->bLossBeforeFirst = true;
+			else
+				pJitter->bLossAfterLast = true;
+			continue;
+		}
+		if (ulTimestampNs == 0 || ulTimestampNs <= pJitter->lastValid.ulTimestampNs)
+			continue;
+
+		JitterSample_t sample;
+		sample.ulTimestampNs = ulTimestampNs;
+		for (int i = 0; i < 3; i++)
+			sample.rgflPosition[i] = pRecord->rgflValues[i];
+
+		if (pJitter->firstValid.ulTimestampNs == 0)
+		{
+			pJitter->firstValid = sample;
+		}
+		else
+		{
+			if (ulTimestampNs - pJitter->lastValid.ulTimestampNs > params.ulGapNs)
+			{
+				Interval_t gap = { pJitter->lastValid.ulTimestampNs, ulTimestampNs, pJitter->bLossAfterLast };
+				pJitter->vecGaps.push_back(gap);
+			}
+			if (pJitter->bLossAfterLast || !Resample(pJitter->lastValid, sample, params, addPoint))
+			{
+				pJitter->bHeadOpen = false;
+				pJitter->tail.nNextPoint = -1;
+			}
+		}
+		pJitter->lastValid = sample;
+		pJitter->bLossAfterLast = false;
+	}
+}
+
+// one thread per chunk
+template <typename Function>
+static void RunChunks(size_t unChunks, Function function)
+{
+	std::vector<std::thread> vecThreads;
+	for (size_t i = 0; i < unChunks; i++)
+		vecThreads.push_back(std::thread(function, i));
+	for (size_t i = 0; i < vecThreads.size(); i++)
+		vecThreads[i].join();
+}
+
+static void PrintSummary(const char* pchName, const CLatencyHistogram& histogram)
+{
+	LatencySummary_t summary = histogram.Summarize();
+	if (summary.ulCount == 0)
+		printf("%-22s %10s\n", pchName, "-");
+	else
+		printf("%-22s %10llu %10.0f %10.0f %10.0f %10.0f\n", pchName, (unsigned long long)summary.ulCount,
+			summary.flP50Us, summary.flP95Us, summary.flP99Us, summary.flMaxUs);
+}
+
+// all of them in time order with bList, otherwise the longest few
+static void PrintIntervals(std::vector<Interval_t> vecIntervals, uint64_t ulOriginNs, bool bList, const char* pchLostNote)
+{
+	if (!bList && vecIntervals.size() > k_unListedIntervals)
+	{
+		std::partial_sort(vecIntervals.begin(), vecIntervals.begin() + k_unListedIntervals, vecIntervals.end(), IsLonger);
+		vecIntervals.resize(k_unListedIntervals);
+		std::sort(vecIntervals.begin(), vecIntervals.end(), IsEarlier);
+		printf("  the %u longest:\n", (unsigned int)k_unListedIntervals);
+	}
+	for (size_t i = 0; i < vecIntervals.size(); i++)
+	{
+		const Interval_t& interval = vecIntervals[i];
+		printf("  at %10.3f s  %10.1f ms%s\n", (int64_t)(interval.ulStartNs - ulOriginNs) * 1e-9,
+			(interval.ulEndNs - interval.ulStartNs) * 1e-6, interval.bLost ? pchLostNote : "");
+	}
+}
+
+static void PrintIntervalTotals(const char* pchName, const std::vector<Interval_t>& vecIntervals)
+{
+	uint64_t ulTotalNs = 0;
+	uint64_t ulLongestNs = 0;
+	for (size_t i = 0; i < vecIntervals.size(); i++)
+	{
+		ulTotalNs += vecIntervals[i].ulEndNs - vecIntervals[i].ulStartNs;
+		ulLongestNs = std::max(ulLongestNs, vecIntervals[i].ulEndNs - vecIntervals[i].ulStartNs);
+	}
+	printf("%s %llu, %.3f s in all, the longest %.1f ms\n", pchName, (unsigned long long)vecIntervals.size(), ulTotalNs * 1e-9, ulLongestNs * 1e-6);
+}
+
+int main(int argc, char** argv)
+{
+	const char* pchRecordingPath = nullptr;
+	unsigned int unThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	double flGapMs = 0.0;
+	double flRateHz = 0.0;
+	bool bList = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			unThreads = (unsigned int)std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "--gap") == 0 && i + 1 < argc)
+			flGapMs = atof(argv[++i]);
+		else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+			flRateHz = atof(argv[++i]);
+		else if (strcmp(argv[i], "--list") == 0)
+			bList = true;
+		else if (!pchRecordingPath && argv[i][0] != '-')
+			pchRecordingPath = argv[i];
+		else
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (!pchRecordingPath)
+	{
+		fprintf(stderr, "usage: %s [--threads n] [--gap ms] [--rate hz] [--list] <recording>\n", argv[0]);
+		return 1;
+	}
+
+	CPoseRecordingView view;
+	if (!view.Open(pchRecordingPath))
+	{
+		fprintf(stderr, "%s is not a pose recording\n", pchRecordingPath);
+		return 1;
+	}
+
+	// a chunk per thread, unless that makes them tiny
+	size_t unRecords = view.GetRecordCount();
+	size_t unChunks = std::max<size_t>(std::min<size_t>(unThreads, unRecords / 4096), 1);
+	std::vector<ChunkBounds_t> vecBounds(unChunks);
+	std::vector<ChunkScan_t> vecScans(unChunks);
+	for (size_t i = 0; i < unChunks; i++)
+	{
+		vecBounds[i].unBegin = unRecords * i / unChunks;
+		vecBounds[i].unEnd = unRecords * (i + 1) / unChunks;
+	}
+
+	RunChunks(unChunks, [&](size_t i) { vecScans[i] = ScanChunk(view, vecBounds[i].unBegin, vecBounds[i].unEnd); });
+	vecBounds[0].ulStartNs = view.GetHeader()->ulFirstTimestampNs;
+	for (size_t i = 1; i < unChunks; i++)
+		vecBounds[i].ulStartNs = vecScans[i - 1].bSync ? vecScans[i - 1].ulEndNs : vecBounds[i - 1].ulStartNs + vecScans[i - 1].ulEndNs;
+
+	std::vector<ChunkStats_t> vecStats(unChunks);
+	RunChunks(unChunks, [&](size_t i) { AnalyzeChunk(view, vecBounds[i], &vecStats[i]); });
+
+	// merged in file order; the intervals and losses that span chunks are added here
+	uint64_t rgulRecords[Stream_Count] = {};
+	uint64_t ulInvalid = 0;
+	uint64_t ulSubmitted = 0;
+	CLatencyHistogram rgInterval[Stream_Count];
+	CLatencyHistogram poseAge;
+	CLatencyHistogram visualAge;
+	uint64_t rgulLastNs[Stream_Count] = {};
+	uint64_t ulMinNs = UINT64_MAX;
+	uint64_t ulMaxNs = 0;
+	uint64_t ulLastNonzeroNs = 0;
+	std::vector<Interval_t> vecLosses;
+	bool bLost = false;
+	uint64_t ulLossStartNs = 0;
+	for (size_t c = 0; c < unChunks; c++)
+	{
+		ChunkStats_t& stats = vecStats[c];
+		ulInvalid += stats.ulInvalid;
+		ulSubmitted += stats.ulSubmitted;
+		poseAge.Merge(stats.poseAge);
+		visualAge.Merge(stats.visualAge);
+		ulMinNs = std::min(ulMinNs, stats.ulMinNs);
+		ulMaxNs = std::max(ulMaxNs, stats.ulMaxNs);
+		for (int s = 0; s < Stream_Count; s++)
+		{
+			rgulRecords[s] += stats.rgulRecords[s];
+			rgInterval[s].Merge(stats.rgInterval[s]);
+			if (stats.rgulFirstNs[s] == 0)
+				continue;
+			if (rgulLastNs[s] != 0 && stats.rgulFirstNs[s] > rgulLastNs[s])
+				rgInterval[s].Record(stats.rgulFirstNs[s] - rgulLastNs[s]);
+			rgulLastNs[s] = std::max(rgulLastNs[s], stats.rgulLastNs[s]);
+		}
+
+		if (stats.bLeadingLoss && !bLost)
+		{
+			bLost = true;
+			ulLossStartNs = stats.ulLeadingLossNs != 0 ? stats.ulLeadingLossNs : ulLastNonzeroNs;
+		}
+		if (stats.ulFirstValidNs != 0)
+		{
+			if (bLost)
+			{
+				Interval_t loss = { ulLossStartNs, stats.ulFirstValidNs, false };
+				vecLosses.push_back(loss);
+			}
+			vecLosses.insert(vecLosses.end(), stats.vecLosses.begin(), stats.vecLosses.end());
+			bLost = stats.bOpenLoss;
+			ulLossStartNs = stats.ulOpenLossNs;
+		}
+		if (stats.ulLastNonzeroNs != 0)
+			ulLastNonzeroNs = stats.ulLastNonzeroNs;
+	}
+	if (bLost)
+	{
+		// never recovered; up to the end of the recording
+		Interval_t loss = { ulLossStartNs, std::max(ulLossStartNs, ulMaxNs), true };
+		vecLosses.push_back(loss);
+	}
+
+	uint64_t ulOriginNs = ulMinNs != UINT64_MAX ? ulMinNs : 0;
+	double flSeconds = ulMaxNs > ulOriginNs ? (ulMaxNs - ulOriginNs) * 1e-9 : 0.0;
+	printf("%s: %llu records over %.3f s, %u chunks\n", pchRecordingPath, (unsigned long long)unRecords, flSeconds, (unsigned int)unChunks);
+	for (int s = 0; s < Stream_Count; s++)
+		printf("%-10s %10llu  %8.1f/s\n", k_rpchStreamNames[s], (unsigned long long)rgulRecords[s], flSeconds > 0.0 ? rgulRecords[s] / flSeconds : 0.0);
+	printf("%-10s %10llu submitted, %llu invalid\n", "", (unsigned long long)ulSubmitted, (unsigned long long)ulInvalid);
+
+	printf("\n%-22s %10s %10s %10s %10s %10s\n", "us", "n", "p50", "p95", "p99", "max");
+	for (int s = 0; s < Stream_Count; s++)
+	{
+		char rgchName[32];
+		snprintf(rgchName, sizeof(rgchName), "%s interval", k_rpchStreamNames[s]);
+		PrintSummary(rgchName, rgInterval[s]);
+	}
+	PrintSummary("pose age", poseAge);
+	PrintSummary("visual age", visualAge);
+
+	printf("\n");
+	PrintIntervalTotals("tracking losses", vecLosses);
+	PrintIntervals(vecLosses, ulOriginNs, bList, "  not recovered");
+
+	// the rest is paced by the median publish interval
+	LatencySummary_t published = rgInterval[Stream_Published].Summarize();
+	if (published.ulCount == 0 || published.flP50Us <= 0.0)
+		return 0;
+	if (flGapMs <= 0.0)
+		flGapMs = published.flP50Us * 1e-3 * k_flGapMedians;
+	if (flRateHz <= 0.0)
+		flRateHz = 1e6 / published.flP50Us;
+
+	std::vector<double> vecWindow(k_unSpectrumSegment);
+	double flWindowPower = 0.0;
+	for (uint32_t i = 0; i < k_unSpectrumSegment; i++)
+	{
+		vecWindow[i] = 0.5 - 0.5 * cos(2.0 * k_flPi * i / k_unSpectrumSegment);
+		flWindowPower += vecWindow[i] * vecWindow[i];
+	}
+	double flPeriodNs = 1e9 / flRateHz;
+	JitterParams_t params = { (uint64_t)(flGapMs * 1e6), ulOriginNs, flPeriodNs, (uint64_t)(flPeriodNs * k_flMaxRunGapPeriods), vecWindow.data() };
+
+	std::vector<ChunkJitter_t> vecJitter(unChunks);
+	RunChunks(unChunks, [&](size_t i) { AnalyzeJitter(view, vecBounds[i], params, &vecJitter[i]); });
+
+	// the segments spanning chunk boundaries go to the spectrum of a chunk of their own
+	std::vector<Interval_t> vecGaps;
+	ChunkJitter_t stitched;
+	stitched.unSegments = 0;
+	stitched.vecPower.assign(k_unSpectrumSegment / 2 + 1, 0.0);
+	JitterSegment_t segment = { -1, std::vector<double>() };
+	JitterSample_t lastValid = {};
+	bool bLossSinceValid = false;
+	auto addPoint = [&](int64_t nPoint, const double* pflPosition) { AddPoint(&segment, nPoint, pflPosition, params, &stitched); };
+	for (size_t c = 0; c < unChunks; c++)
+	{
+		ChunkJitter_t& jitter = vecJitter[c];
+		bLossSinceValid = bLossSinceValid || jitter.bLossBeforeFirst;
+		if (jitter.firstValid.ulTimestampNs == 0)
+			continue;
+
+		uint64_t ulFirstValidNs = jitter.firstValid.ulTimestampNs;
+		if (lastValid.ulTimestampNs != 0 && ulFirstValidNs > lastValid.ulTimestampNs && ulFirstValidNs - lastValid.ulTimestampNs > params.ulGapNs)
+		{
+			Interval_t gap = { lastValid.ulTimestampNs, ulFirstValidNs, bLossSinceValid };
+			vecGaps.push_back(gap);
+		}
+		vecGaps.insert(vecGaps.end(), jitter.vecGaps.begin(), jitter.vecGaps.end());
+
+		if (lastValid.ulTimestampNs == 0 || bLossSinceValid || !Resample(lastValid, jitter.firstValid, params, addPoint))
+			segment.nNextPoint = -1;
+		for (size_t i = 0; i < jitter.vecHead.size() / 3; i++)
+			AddPoint(&segment, jitter.nHeadFirstPoint + (int64_t)i, &jitter.vecHead[i * 3], params, &stitched);
+		if (!jitter.bHeadOpen)
+			segment = jitter.tail;
+
+		lastValid = jitter.lastValid;
+		bLossSinceValid = jitter.bLossAfterLast;
+	}
+
+	std::vector<double> vecPower = stitched.vecPower;
+	uint32_t unSegments = stitched.unSegments;
+	for (size_t c = 0; c < unChunks; c++)
+	{
+		unSegments += vecJitter[c].unSegments;
+		for (size_t k = 0; k < vecPower.size(); k++)
+			vecPower[k] += vecJitter[c].vecPower[k];
+	}
+
+	printf("\n");
+	char rgchName[64];
+	snprintf(rgchName, sizeof(rgchName), "publish gaps over %.1f ms:", flGapMs);
+	PrintIntervalTotals(rgchName, vecGaps);
+	PrintIntervals(vecGaps, ulOriginNs, bList, "  tracking lost");
+
+	printf("\njitter: published position resampled at %.1f Hz, %u segments of %u\n", flRateHz, unSegments, k_unSpectrumSegment);
+	if (unSegments == 0)
+		return 0;
+
+	// one-sided PSD in m^2/Hz, summed over the band's bins into the RMS displacement
+	double flBinHz = flRateHz / k_unSpectrumSegment;
+	double flScale = 1.0 / (unSegments * flRateHz * flWindowPower);
+	double flTotal = 0.0;
+	printf("%-22s %10s\n", "band Hz", "rms mm");
+	for (double flLowHz = k_flMinJitterHz; flLowHz < flRateHz * 0.5; flLowHz *= 2.0)
+	{
+		double flHighHz = std::min(flLowHz * 2.0, flRateHz * 0.5);
+		double flBand = 0.0;
+		for (uint32_t k = 1; k <= k_unSpectrumSegment / 2; k++)
+		{
+			double flHz = k * flBinHz;
+			if (flHz >= flLowHz && (flHz < flHighHz || (k == k_unSpectrumSegment / 2 && flHz <= flHighHz)))
+				flBand += vecPower[k] * flScale * (k == k_unSpectrumSegment / 2 ? 1.0 : 2.0) * flBinHz;
+		}
+		flTotal += flBand;
+		char rgchBand[32];
+		snprintf(rgchBand, sizeof(rgchBand), "%.0f-%.0f", flLowHz, flHighHz);
+		printf("%-22s %10.4f\n", rgchBand, sqrt(flBand) * 1000.0);
+	}
+	printf("%-22s %10.4f\n", "total", sqrt(flTotal) * 1000.0);
+	return 0;
+}
@@ -0,0 +1,112 @@
+//-----------------------------------------------------------------------------
+// Purpose: Prints a pose recording (driver_zedm/poseRecordingPath) as CSV,
+// one line per record with its absolute ZED timestamp. --ndjson writes the
+// records to a file as newline-delimited JSON objects instead, streamed out
+// as they are converted so long recordings don't build up in memory.
+//
+// usage: zedm_posedump [--ndjson file] <recording>
+//-----------------------------------------------------------------------------
+#include "ndjsonwriter.h"
+#include "poserecordingview.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const k_rpchRecordTypeNames[] = { "sync", "visual", "imu", "published" };
+
+// the double nearest the float's 7 significant digits, which jsoncpp prints without the float's binary noise
+static double RoundFloat(float flValue)
+{
+	char rgchValue[32];
+	snprintf(rgchValue, sizeof(rgchValue), "%.7g", flValue);
+	return strtod(rgchValue, nullptr);
+}
+
+static int WriteNdjson(const CPoseRecordingView& view, const char* pchPath)
+{
+	CNdjsonWriter writer;
+	if (!writer.Open(pchPath))
+	{
+		fprintf(stderr, "Unable to create %s\n", pchPath);
+		return 1;
+	}
+
+	// one object reused for every record; its members are overwritten in place
+	Json::Value record(Json::objectValue);
+	Json::Value& values = record["values"];
+	values.resize(k_unPoseRecordValues);
+
+	CPoseRecordingView::CIterator iter(view);
+	const PoseRecord_t* pRecord;
+	uint64_t ulTimestampNs;
+	while (iter.Next(&pRecord, &ulTimestampNs))
+	{
+		record["type"] = pRecord->unType < 4 ? k_rpchRecordTypeNames[pRecord->unType] : "?";
+		record["timestamp_ns"] = Json::Value((Json::UInt64)ulTimestampNs);
+		record["flags"] = pRecord->unFlags;
+		for (uint32_t i = 0; i < k_unPoseRecordValues; i++)
+			values[i] = RoundFloat(pRecord->rgflValues[i]);
+		writer.Write(record);
+	}
+
+	uint64_t ulRecords = writer.GetRecordCount();
+	if (!writer.Close())
+	{
+		fprintf(stderr, "Writing %s failed\n", pchPath);
+		return 1;
+	}
+	fprintf(stderr, "%llu records written to %s\n", (unsigned long long)ulRecords, pchPath);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	const char* pchNdjsonPath = nullptr;
+	const char* pchRecordingPath = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--ndjson") == 0 && i + 1 < argc)
+			pchNdjsonPath = argv[++i];
+		else if (!pchRecordingPath && argv[i][0] != '-')
+			pchRecordingPath = argv[i];
+		else
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (!pchRecordingPath)
+	{
+		fprintf(stderr, "usage: %s [--ndjson file] <recording>\n", argv[0]);
+		return 1;
+	}
+
+	CPoseRecordingView view;
+	if (!view.Open(pchRecordingPath))
+	{
+		fprintf(stderr, "%s is not a pose recording\n", pchRecordingPath);
+		return 1;
+	}
+
+	if (pchNdjsonPath)
+		return WriteNdjson(view, pchNdjsonPath);
+
+	printf("type,timestamp_ns,flags");
+	for (uint32_t i = 0; i < k_unPoseRecordValues; i++)
+		printf(",v%u", i);
+	printf("\n");
+
+	CPoseRecordingView::CIterator iter(view);
+	const PoseRecord_t* pRecord;
+	uint64_t ulTimestampNs;
+	while (iter.Next(&pRecord, &ulTimestampNs))
+	{
+		printf("%s,%llu,%u", pRecord->unType < 4 ? k_rpchRecordTypeNames[pRecord->unType] : "?", (unsigned long long)ulTimestampNs, pRecord->unFlags);
+		for (uint32_t i = 0; i < k_unPoseRecordValues; i++)
+			printf(",%.6g", pRecord->rgflValues[i]);
+		printf("\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,137 @@
+//-----------------------------------------------------------------------------
+// Purpose: The remote end of the driver's receiver mode. Runs the driver's
+// pose pipeline on the ZED attached to this machine (or on a recording) and
+// streams every published pose over UDP to a driver with remotePort set,
+// --batch poses per datagram (4 by default, up to 16). Calibration is
+// applied by the receiving driver, so this uses the defaults.
+//
+// With --body, the node also runs body tracking and sends every skeleton to
+// that port of the same host, for a driver with bodyFusionPort set; --node
+// is the node's id in its bodyFusionNodes (1 by default, up to 8).
+//
+// usage: zedm_posesender <host> <port> [--svo recording.svo] [--profile name] [--batch n] [--body port] [--node id]
+//-----------------------------------------------------------------------------
+#include "driverlog.h"
+#include "mockdrivercontext.h"
+#include "posestream.h"
+#include "workerpool.h"
+#include "zedtracker.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "usage: %s <host> <port> [--svo recording.svo] [--profile name] [--batch n] [--body port] [--node id]\n", argv[0]);
+		return 1;
+	}
+
+	ZedmSettings_t settings;
+	int nBatchSize = 4;
+	int nBodyPort = 0;
+	int nNode = 1;
+	for (int i = 3; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "--svo") == 0)
+		{
+			settings.sSvoPath = argv[i + 1];
+			// the receiver plays the stream out at the rate it arrives
+			settings.bSvoRealTime = true;
+		}
+		else if (strcmp(argv[i], "--profile") == 0)
+		{
+			settings.sCameraProfile = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--batch") == 0)
+		{
+			nBatchSize = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "--body") == 0)
+		{
+			nBodyPort = atoi(argv[i + 1]);
+			settings.bBodyTracking = true;
+		}
+		else if (strcmp(argv[i], "--node") == 0)
+		{
+			nNode = atoi(argv[i + 1]);
+		}
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	CPoseStreamSender sender;
+	int nPort = atoi(argv[2]);
+	if (nPort <= 0 || nPort > 65535 || !sender.Open(argv[1], (uint16_t)nPort, nBatchSize > 0 ? (uint32_t)nBatchSize : 1))
+	{
+		fprintf(stderr, "Unable to send to %s:%s\n", argv[1], argv[2]);
+		return 1;
+	}
+
+	CSkeletonStreamSender skeletonSender;
+	if (nBodyPort != 0 && (nBodyPort < 0 || nBodyPort > 65535 || nNode < 1 || !skeletonSender.Open(argv[1], (uint16_t)nBodyPort, (uint32_t)nNode)))
+	{
+		fprintf(stderr, "Unable to send skeletons to %s:%d as node %d\n", argv[1], nBodyPort, nNode);
+		return 1;
+	}
+
+	// poses only go to the stream, the mock host just counts them
+	CMockDriverContext context;
+	context.m_host.SetRecordPoses(false);
+	context.Install();
+	InitDriverLog(vr::VRDriverLog());
+
+	// for the grab watchdog; a remote node has nobody to restart it by hand
+	CWorkerPool workerPool;
+	workerPool.Start(1);
+
+	CZedTracker tracker;
+	tracker.SetWorkerPool(&workerPool);
+	if (nBodyPort != 0)
+		tracker.GetBodyTracker()->SetSkeletonListener(k_nBodyFusionListenerSlot, &skeletonSender);
+	if (!tracker.Start(settings))
+	{
+		fprintf(stderr, "Unable to create tracking thread\n");
+		return 1;
+	}
+
+	// ReadPose is a seqlock read, polling it costs next to nothing
+	bool bReplay = !settings.sSvoPath.empty();
+	uint32_t unLastSequence = 0;
+	while (!tracker.HasExited())
+	{
+		vr::DriverPose_t pose;
+		uint64_t ulSampleTimestampNs;
+		uint32_t unSequence = tracker.ReadPose(&pose, &ulSampleTimestampNs);
+		if (unSequence != 0 && unSequence != unLastSequence)
+		{
+			unLastSequence = unSequence;
+			// the receiver weighs the joints by their distance from this camera
+			if (pose.poseIsValid)
+				skeletonSender.SetCameraPosition(pose.vecPosition);
+			// a replay's timestamps are the recording's, its samples count as sent when taken
+			sender.Send(pose, ulSampleTimestampNs, bReplay ? ulSampleTimestampNs : tracker.GetCameraTimeNs());
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(500));
+	}
+	tracker.Stop();
+	tracker.GetBodyTracker()->SetSkeletonListener(k_nBodyFusionListenerSlot, nullptr);
+	workerPool.Stop();
+	sender.Close();
+	skeletonSender.Close();
+
+	CleanupDriverLog();
+
+	printf("poses sent: %llu in %llu datagrams\n", (unsigned long long)sender.GetSentCount(), (unsigned long long)sender.GetDatagramCount());
+	if (nBodyPort != 0)
+		printf("skeletons sent: %llu\n", (unsigned long long)skeletonSender.GetSentCount());
+	return sender.GetSentCount() > 0 ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+//-----------------------------------------------------------------------------
+// Purpose: Reads a device's sharedMemoryExport segment the way another local
+// process would and prints, once a second, the pose and IMU rates it sees,
+// how many samples it missed and the newest pose.
+//
+// usage: zedm_posetap <device serial, e.g. ZED_12345> [--seconds n]
+//-----------------------------------------------------------------------------
+#include "sharedpose.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <device serial> [--seconds n]\n", argv[0]);
+		return 1;
+	}
+	int nSeconds = argc > 3 && strcmp(argv[2], "--seconds") == 0 ? atoi(argv[3]) : 0;
+
+	CSharedPoseReader reader;
+	std::string sName = GetSharedPoseName(argv[1]);
+	if (!reader.Open(sName))
+	{
+		fprintf(stderr, "Unable to open %s; is sharedMemoryExport on and the device active?\n", sName.c_str());
+		return 1;
+	}
+
+	// from now on, not the whole ring
+	uint64_t ulNextPose = reader.GetPoseWriteCount();
+	uint64_t ulNextImu = reader.GetImuWriteCount();
+	SharedPoseSample_t rgPoses[64];
+	SharedImuSample_t rgImu[64];
+
+	for (int nSecond = 0; nSeconds == 0 || nSecond < nSeconds; nSecond++)
+	{
+		uint64_t ulPoses = 0, ulImu = 0, ulPosesSkipped = 0, ulImuSkipped = 0;
+		auto end = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+		while (std::chrono::steady_clock::now() < end)
+		{
+			uint64_t ulSkipped;
+			ulPoses += reader.ReadPoses(&ulNextPose, rgPoses, 64, &ulSkipped);
+			ulPosesSkipped += ulSkipped;
+			ulImu += reader.ReadImuSamples(&ulNextImu, rgImu, 64, &ulSkipped);
+			ulImuSkipped += ulSkipped;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		SharedPoseSample_t latest;
+		if (!reader.ReadLatestPose(&latest))
+		{
+			printf("poses %llu/s imu %llu/s, nothing published yet\n", (unsigned long long)ulPoses, (unsigned long long)ulImu);
+			continue;
+		}
+		printf("poses %llu/s (%llu missed) imu %llu/s (%llu missed) | %s result %d pos %.3f %.3f %.3f rot %.3f %.3f %.3f %.3f\n",
+			(unsigned long long)ulPoses, (unsigned long long)ulPosesSkipped, (unsigned long long)ulImu, (unsigned long long)ulImuSkipped,
+			(latest.unFlags & SharedPoseFlag_Valid) ? "valid" : "invalid", latest.nResult,
+			latest.vecPosition[0], latest.vecPosition[1], latest.vecPosition[2],
+			latest.qRotation[0], latest.qRotation[1], latest.qRotation[2], latest.qRotation[3]);
+		fflush(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,90 @@
+//-----------------------------------------------------------------------------
+// Purpose: Fills in sdkCachePath ahead of time, so the driver starts offline
+// and doesn't spend the first minutes in the SDK: opens every connected
+// camera once, letting the SDK download its calibration, and copies that
+// into the cache directory, then downloads and optimizes the body tracking
+// model for the GPU. Run it with the cameras connected, once per machine and
+// again after an SDK or GPU driver update.
+//
+// usage: zedm_prewarm <cache dir> [--gpu <cudaDevice>] [--no-body-model]
+//-----------------------------------------------------------------------------
+#include "cameradetect.h"
+#include "sdkcache.h"
+
+#include <sl/Camera.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <cache dir> [--gpu <cudaDevice>] [--no-body-model]\n", argv[0]);
+		return 1;
+	}
+
+	std::string sCacheDir = argv[1];
+	int nGpu = 0;
+	bool bBodyModel = true;
+	for (int i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--gpu") == 0 && i + 1 < argc)
+			nGpu = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--no-body-model") == 0)
+			bBodyModel = false;
+	}
+
+	int nFailures = 0;
+	std::vector<unsigned int> vecSerials = EnumerateZedCameras();
+	if (vecSerials.empty())
+		printf("no cameras connected, no calibration cached\n");
+	for (unsigned int unSerial : vecSerials)
+	{
+		// open downloads the calibration if the SDK doesn't have it; no depth, it isn't needed
+		sl::InitParameters init_params;
+		init_params.input.setFromSerialNumber(unSerial);
+		init_params.depth_mode = sl::DEPTH_MODE::NONE;
+		init_params.sdk_gpu_id = nGpu;
+
+		sl::Camera zed;
+		sl::ERROR_CODE eError = zed.open(init_params);
+		if (eError != sl::ERROR_CODE::SUCCESS)
+		{
+			printf("ZED %u: unable to open: %s\n", unSerial, sl::toString(eError).c_str());
+			nFailures++;
+			continue;
+		}
+		zed.close();
+
+		if (CacheCalibration(sCacheDir, unSerial))
+		{
+			printf("ZED %u: calibration cached in %s\n", unSerial, sCacheDir.c_str());
+		}
+		else
+		{
+			printf("ZED %u: unable to cache %s in %s\n", unSerial, GetCalibrationFileName(unSerial).c_str(), sCacheDir.c_str());
+			nFailures++;
+		}
+	}
+
+	if (bBodyModel)
+	{
+		printf("body tracking model: %s\n", IsBodyTrackingModelReady(nGpu) ? "ready" : "optimizing for this GPU, this takes a few minutes");
+		if (PrepareBodyTrackingModel(nGpu))
+		{
+			printf("body tracking model ready on GPU %d\n", nGpu);
+		}
+		else
+		{
+			printf("unable to prepare the body tracking model on GPU %d\n", nGpu);
+			nFailures++;
+		}
+	}
+
+	return nFailures ? 1 : 0;
+}
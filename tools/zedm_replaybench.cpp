@@ -0,0 +1,64 @@
+//-----------------------------------------------------------------------------
+// Purpose: Replays an SVO recording through the driver's pose pipeline as fast
+// as the SDK can decode it and reports throughput and per-stage latency.
+// Poses go to a mock IVRServerDriverHost, so SteamVR isn't needed.
+//
+// usage: zedm_replaybench <recording.svo> [--realtime]
+//-----------------------------------------------------------------------------
+#include "driverlog.h"
+#include "mockdrivercontext.h"
+#include "zedtracker.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <recording.svo> [--realtime]\n", argv[0]);
+		return 1;
+	}
+
+	CMockDriverContext context;
+	context.m_host.SetRecordPoses(false);
+	context.Install();
+	InitDriverLog(vr::VRDriverLog());
+
+	ZedmSettings_t settings;
+	settings.sSvoPath = argv[1];
+	settings.bSvoRealTime = argc > 2 && strcmp(argv[2], "--realtime") == 0;
+
+	CZedTracker tracker;
+	tracker.SetObjectId(0);
+
+	auto start = std::chrono::steady_clock::now();
+	if (!tracker.Start(settings))
+	{
+		fprintf(stderr, "Unable to create tracking thread\n");
+		return 1;
+	}
+	tracker.WaitForExit();
+	double flSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	CleanupDriverLog();
+
+	ZedTrackerStats_t stats;
+	tracker.GetStats(&stats);
+	uint64_t ulPoses = context.m_host.GetPoseUpdateCount();
+
+	printf("frames grabbed:   %llu (%llu grab failures)\n", (unsigned long long)stats.ulFramesGrabbed, (unsigned long long)stats.ulGrabFailures);
+	printf("poses submitted:  %llu in %.2f s, %.1f poses/s\n", (unsigned long long)ulPoses, flSeconds, flSeconds > 0.0 ? ulPoses / flSeconds : 0.0);
+	for (int i = 0; i < LatencyStage_Count; i++)
+	{
+		LatencySummary_t summary = tracker.GetLatencySummary((ELatencyStage)i);
+		if (summary.ulCount == 0)
+			continue;
+		printf("%-18s n=%-8llu p50=%6.0fus p95=%6.0fus p99=%6.0fus max=%6.0fus\n", GetLatencyStageName((ELatencyStage)i),
+			(unsigned long long)summary.ulCount, summary.flP50Us, summary.flP95Us, summary.flP99Us, summary.flMaxUs);
+	}
+
+	return ulPoses > 0 ? 0 : 1;
+}
@@ -0,0 +1,324 @@
+//-----------------------------------------------------------------------------
+// Purpose: Regression check of the pose pipeline. Replays an SVO recording
+// as fast as it decodes, records what the pipeline produced (the
+// poseRecordingPath format) and compares it with a baseline recording made
+// the same way by a known-good build:
+//
+// - visual poses, frame by frame at the same ZED timestamps
+// - published poses, against the baseline's interpolated to each timestamp;
+//   they come from the IMU thread, which races the grab thread, so they are
+//   compared by time rather than one to one
+// - timing: published poses per second of recording and the p99 interval
+//   between them, both on the recording's clock, so the wall-clock speed of
+//   the machine doesn't matter
+//
+// Errors are checked at the 95th percentile against the tolerances and at
+// the maximum against ten times them. --update writes the baseline instead.
+// The new recording is kept next to the baseline as <baseline>.last, for
+// zedm_posedump.
+//
+// usage: zedm_replaycheck <recording.svo> <baseline> [--update] [--profile name]
+//        [--position-tolerance m] [--rotation-tolerance deg] [--rate-tolerance fraction]
+//-----------------------------------------------------------------------------
+#include "driverlog.h"
+#include "hmdmath.h"
+#include "mockdrivercontext.h"
+#include "poserecordingview.h"
+#include "zedtracker.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// baseline poses further apart than this aren't interpolated across
+static const uint64_t k_ulMaxInterpolationGapNs = 50000000ull;
+
+struct RecordedPose_t
+{
+	uint64_t ulTimestampNs;
+	double vecPosition[3];
+	vr::HmdQuaternion_t qRotation;
+};
+
+struct RecordedSession_t
+{
+	std::vector<RecordedPose_t> vecVisual;
+	std::vector<RecordedPose_t> vecPublished; // valid ones only
+	uint64_t ulPublishedTotal;
+};
+
+static bool LoadSession(const char* pchPath, RecordedSession_t* pSession)
+{
+	CPoseRecordingView view;
+	if (!view.Open(pchPath))
+		return false;
+
+	pSession->ulPublishedTotal = 0;
+	CPoseRecordingView::CIterator iter(view);
+	const PoseRecord_t* pRecord;
+	uint64_t ulTimestampNs;
+	while (iter.Next(&pRecord, &ulTimestampNs))
+	{
+		if (pRecord->unType == PoseRecord_Published)
+			pSession->ulPublishedTotal++;
+		if (pRecord->unType != PoseRecord_Visual && (pRecord->unType != PoseRecord_Published || !(pRecord->unFlags & k_unPoseRecordFlag_Valid)))
+			continue;
+
+		RecordedPose_t pose;
+		pose.ulTimestampNs = ulTimestampNs;
+		for (int i = 0; i < 3; i++)
+			pose.vecPosition[i] = pRecord->rgflValues[i];
+		pose.qRotation = HmdQuaternion_Init(pRecord->rgflValues[3], pRecord->rgflValues[4], pRecord->rgflValues[5], pRecord->rgflValues[6]);
+		(pRecord->unType == PoseRecord_Visual ? pSession->vecVisual : pSession->vecPublished).push_back(pose);
+	}
+
+	// the recorder keeps arrival order, which the IMU and grab threads can interleave
+	auto byTime = [](const RecordedPose_t& a, const RecordedPose_t& b) { return a.ulTimestampNs < b.ulTimestampNs; };
+	std::stable_sort(pSession->vecVisual.begin(), pSession->vecVisual.end(), byTime);
+	std::stable_sort(pSession->vecPublished.begin(), pSession->vecPublished.end(), byTime);
+	return true;
+}
+
+static double RotationDegrees(const vr::HmdQuaternion_t& a, const vr::HmdQuaternion_t& b)
+{
+	double flDot = fabs(a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z);
+	return 2.0 * acos(std::min(flDot, 1.0)) * 180.0 / 3.14159265358979323846;
+}
+
+static double PositionDistance(const double* vecA, const double* vecB)
+{
+	double dx = vecA[0] - vecB[0], dy = vecA[1] - vecB[1], dz = vecA[2] - vecB[2];
+	return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+/** The baseline at ulTimestampNs, false outside it or across a gap */
+static bool InterpolatePose(const std::vector<RecordedPose_t>& vecPoses, uint64_t ulTimestampNs, RecordedPose_t* pOut)
+{
+	auto after = std::lower_bound(vecPoses.begin(), vecPoses.end(), ulTimestampNs,
+		[](const RecordedPose_t& pose, uint64_t ulTime) { return pose.ulTimestampNs < ulTime; });
+	if (after == vecPoses.end())
+		return false;
+	if (after->ulTimestampNs == ulTimestampNs)
+	{
+		*pOut = *after;
+		return true;
+	}
+	if (after == vecPoses.begin())
+		return false;
+
+	const RecordedPose_t& before = *(after - 1);
+	uint64_t ulSpanNs = after->ulTimestampNs - before.ulTimestampNs;
+	if (ulSpanNs > k_ulMaxInterpolationGapNs)
+		return false;
+
+	double t = (double)(ulTimestampNs - before.ulTimestampNs) / (double)ulSpanNs;
+	pOut->ulTimestampNs = ulTimestampNs;
+	for (int i = 0; i < 3; i++)
+		pOut->vecPosition[i] = before.vecPosition[i] + (after->vecPosition[i] - before.vecPosition[i]) * t;
+	pOut->qRotation = HmdQuaternion_Slerp(before.qRotation, after->qRotation, t);
+	return true;
+}
+
+static double Percentile(std::vector<double> vecValues, double flFraction)
+{
+	if (vecValues.empty())
+		return 0.0;
+	size_t unIndex = std::min((size_t)(flFraction * vecValues.size()), vecValues.size() - 1);
+	std::nth_element(vecValues.begin(), vecValues.begin() + unIndex, vecValues.end());
+	return vecValues[unIndex];
+}
+
+static double Maximum(const std::vector<double>& vecValues)
+{
+	return vecValues.empty() ? 0.0 : *std::max_element(vecValues.begin(), vecValues.end());
+}
+
+struct Tolerances_t
+{
+	double flPositionM = 0.001;
+	double flRotationDeg = 0.1;
+	double flRateFraction = 0.05;
+};
+
+/** Prints one check and returns whether it passed */
+static bool CheckErrors(const char* pchName, const std::vector<double>& vecErrors, double flTolerance, const char* pchUnit)
+{
+	double flP95 = Percentile(vecErrors, 0.95);
+	double flMax = Maximum(vecErrors);
+	bool bPass = flP95 <= flTolerance && flMax <= 10.0 * flTolerance;
+	printf("%-4s %-22s p95=%.6f max=%.6f %s (tolerance %.6f)\n", bPass ? "ok" : "FAIL", pchName, flP95, flMax, pchUnit, flTolerance);
+	return bPass;
+}
+
+static bool CheckRatio(const char* pchName, double flValue, double flBaseline, double flTolerance)
+{
+	double flRelative = flBaseline > 0.0 ? fabs(flValue - flBaseline) / flBaseline : (flValue > 0.0 ? 1.0 : 0.0);
+	bool bPass = flRelative <= flTolerance;
+	printf("%-4s %-22s %.3f, baseline %.3f (%+.1f%%)\n", bPass ? "ok" : "FAIL", pchName, flValue, flBaseline,
+		flBaseline > 0.0 ? (flValue - flBaseline) / flBaseline * 100.0 : 0.0);
+	return bPass;
+}
+
+static void GetPublishedTiming(const RecordedSession_t& session, double* pflRate, double* pflP99IntervalMs)
+{
+	const std::vector<RecordedPose_t>& vecPoses = session.vecPublished;
+	std::vector<double> vecIntervals;
+	for (size_t i = 1; i < vecPoses.size(); i++)
+		vecIntervals.push_back((vecPoses[i].ulTimestampNs - vecPoses[i - 1].ulTimestampNs) * 1e-6);
+	double flSpanSeconds = vecPoses.size() > 1 ? (vecPoses.back().ulTimestampNs - vecPoses.front().ulTimestampNs) * 1e-9 : 0.0;
+	*pflRate = flSpanSeconds > 0.0 ? (vecPoses.size() - 1) / flSpanSeconds : 0.0;
+	*pflP99IntervalMs = Percentile(vecIntervals, 0.99);
+}
+
+static bool Compare(const RecordedSession_t& session, const RecordedSession_t& baseline, const Tolerances_t& tolerances)
+{
+	bool bPass = true;
+
+	// the SDK's visual poses of the same frames, which don't depend on thread timing
+	std::vector<double> vecPositionErrors, vecRotationErrors;
+	size_t unMatched = 0;
+	for (const RecordedPose_t& pose : session.vecVisual)
+	{
+		auto match = std::lower_bound(baseline.vecVisual.begin(), baseline.vecVisual.end(), pose.ulTimestampNs,
+			[](const RecordedPose_t& other, uint64_t ulTime) { return other.ulTimestampNs < ulTime; });
+		if (match == baseline.vecVisual.end() || match->ulTimestampNs != pose.ulTimestampNs)
+			continue;
+		unMatched++;
+		vecPositionErrors.push_back(PositionDistance(pose.vecPosition, match->vecPosition));
+		vecRotationErrors.push_back(RotationDegrees(pose.qRotation, match->qRotation));
+	}
+	bPass &= CheckRatio("visual frames matched", (double)unMatched, (double)baseline.vecVisual.size(), tolerances.flRateFraction);
+	bPass &= CheckErrors("visual position", vecPositionErrors, tolerances.flPositionM, "m");
+	bPass &= CheckErrors("visual rotation", vecRotationErrors, tolerances.flRotationDeg, "deg");
+
+	vecPositionErrors.clear();
+	vecRotationErrors.clear();
+	for (const RecordedPose_t& pose : session.vecPublished)
+	{
+		RecordedPose_t expected;
+		if (!InterpolatePose(baseline.vecPublished, pose.ulTimestampNs, &expected))
+			continue;
+		vecPositionErrors.push_back(PositionDistance(pose.vecPosition, expected.vecPosition));
+		vecRotationErrors.push_back(RotationDegrees(pose.qRotation, expected.qRotation));
+	}
+	bPass &= CheckRatio("published compared", (double)vecPositionErrors.size(), (double)baseline.vecPublished.size(), tolerances.flRateFraction);
+	bPass &= CheckErrors("published position", vecPositionErrors, tolerances.flPositionM, "m");
+	bPass &= CheckErrors("published rotation", vecRotationErrors, tolerances.flRotationDeg, "deg");
+
+	double flRate, flP99IntervalMs, flBaselineRate, flBaselineP99IntervalMs;
+	GetPublishedTiming(session, &flRate, &flP99IntervalMs);
+	GetPublishedTiming(baseline, &flBaselineRate, &flBaselineP99IntervalMs);
+	bPass &= CheckRatio("published per second", flRate, flBaselineRate, tolerances.flRateFraction);
+	// an interval is quantized to IMU samples, so it gets one sample (2.5 ms) on top
+	bool bIntervalPass = flP99IntervalMs <= flBaselineP99IntervalMs * (1.0 + tolerances.flRateFraction) + 2.5;
+	printf("%-4s %-22s %.2f ms, baseline %.2f ms\n", bIntervalPass ? "ok" : "FAIL", "published p99 interval", flP99IntervalMs, flBaselineP99IntervalMs);
+	bPass &= bIntervalPass;
+
+	return bPass;
+}
+
+/** Runs the pipeline over the SVO into the recording at pchRecordingPath; false if nothing came out */
+static bool Replay(const char* pchSvoPath, const std::string& sProfile, const char* pchRecordingPath)
+{
+	remove(pchRecordingPath);
+
+	CMockDriverContext context;
+	context.m_host.SetRecordPoses(false);
+	context.Install();
+	InitDriverLog(vr::VRDriverLog());
+
+	ZedmSettings_t settings;
+	settings.sSvoPath = pchSvoPath;
+	settings.bSvoRealTime = false;
+	settings.sPoseRecordingPath = pchRecordingPath;
+	if (!sProfile.empty())
+		settings.sCameraProfile = sProfile;
+
+	bool bStarted;
+	ZedTrackerStats_t stats;
+	{
+		// the recording is complete once the tracker is gone
+		CZedTracker tracker;
+		tracker.SetObjectId(0);
+		bStarted = tracker.Start(settings);
+		if (bStarted)
+			tracker.WaitForExit();
+		tracker.GetStats(&stats);
+	}
+	CleanupDriverLog();
+
+	if (!bStarted)
+	{
+		fprintf(stderr, "Unable to create tracking thread\n");
+		return false;
+	}
+	if (stats.ulRecorderDropped > 0)
+		fprintf(stderr, "warning: the recorder dropped %llu records\n", (unsigned long long)stats.ulRecorderDropped);
+	printf("replayed %llu frames, %llu poses submitted\n", (unsigned long long)stats.ulFramesGrabbed, (unsigned long long)context.m_host.GetPoseUpdateCount());
+	return context.m_host.GetPoseUpdateCount() > 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "usage: %s <recording.svo> <baseline> [--update] [--profile name]\n"
+			"       [--position-tolerance m] [--rotation-tolerance deg] [--rate-tolerance fraction]\n", argv[0]);
+		return 2;
+	}
+
+	bool bUpdate = false;
+	std::string sProfile;
+	Tolerances_t tolerances;
+	for (int i = 3; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--update") == 0)
+			bUpdate = true;
+		else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+			sProfile = argv[++i];
+		else if (strcmp(argv[i], "--position-tolerance") == 0 && i + 1 < argc)
+			tolerances.flPositionM = atof(argv[++i]);
+		else if (strcmp(argv[i], "--rotation-tolerance") == 0 && i + 1 < argc)
+			tolerances.flRotationDeg = atof(argv[++i]);
+		else if (strcmp(argv[i], "--rate-tolerance") == 0 && i + 1 < argc)
+			tolerances.flRateFraction = atof(argv[++i]);
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	std::string sRecordingPath = bUpdate ? argv[2] : std::string(argv[2]) + ".last";
+	if (!Replay(argv[1], sProfile, sRecordingPath.c_str()))
+		return 2;
+
+	RecordedSession_t session;
+	if (!LoadSession(sRecordingPath.c_str(), &session))
+	{
+		fprintf(stderr, "Unable to read the new recording %s\n", sRecordingPath.c_str());
+		return 2;
+	}
+	if (bUpdate)
+	{
+		printf("baseline %s: %zu visual, %zu valid of %llu published poses\n", argv[2], session.vecVisual.size(),
+			session.vecPublished.size(), (unsigned long long)session.ulPublishedTotal);
+		return 0;
+	}
+
+	RecordedSession_t baseline;
+	if (!LoadSession(argv[2], &baseline))
+	{
+		fprintf(stderr, "%s is not a pose recording; make one with --update\n", argv[2]);
+		return 2;
+	}
+
+	bool bPass = Compare(session, baseline, tolerances);
+	printf("%s\n", bPass ? "PASS" : "FAIL");
+	return bPass ? 0 : 1;
+}
@@ -0,0 +1,452 @@
+//-----------------------------------------------------------------------------
+// Purpose: Soak test: loads the driver DLL into a mock vrserver like
+// zedm_mockhost and runs it for hours, a live camera or an SVO looped with
+// driver_zedm/svoLoop=true. Every sample interval it records the process's
+// resident memory and threads, the GPU memory in use, the first device's pose
+// rate, latency percentiles since the sample before and, in
+// ZEDM_ALLOCATION_AUDIT builds, the pose threads' heap calls. At the end the
+// samples just after the warm-up are compared with the last ones; the run
+// fails if memory, threads, allocations or a latency p99 drifted up past the
+// limits, or the pose rate dropped. Leaks and slow latency growth that only
+// show after a long shift show up here in one. --ndjson keeps every sample's
+// full "stats" reply, one JSON object per line.
+//
+// usage: zedm_soak <driver dll> [--hours N] [--sample-seconds N] [--warmup-minutes N] [--csv file] [--ndjson file]
+//                  [--max-rss-mb-per-hour N] [--max-gpu-mb-per-hour N] [--max-p99-growth fraction]
+//                  [--max-thread-growth N] [section/key=value ...]
+//-----------------------------------------------------------------------------
+#include "latencystats.h"
+#include "mockdrivercontext.h"
+#include "ndjsonwriter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+#else
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
+
+typedef void* (*HmdDriverFactoryFn)(const char* pInterfaceName, int* pReturnCode);
+
+static const std::chrono::microseconds k_RunFrameInterval(11111);
+static const uint32_t k_unStatsBufferSize = 65536;
+
+// a p99 has to grow by this much besides the fraction, so a few microseconds of noise on a fast stage don't fail the run
+static const double k_flMinP99GrowthUs = 250.0;
+
+// of the samples after the warm-up, the first and last this fraction are compared
+static const double k_flCompareFraction = 0.1;
+
+struct SoakSample_t
+{
+	double flElapsedSeconds;
+	double flRssMb;
+	double flGpuUsedMb; // < 0 if the stats have none
+	uint32_t unThreads;
+	double flPoseRate;
+	double flAllocationsPerSecond; // < 0 unless the driver counts them
+	double rgflP99Us[LatencyStage_Count]; // < 0 for a stage without samples in the interval
+};
+
+static HmdDriverFactoryFn LoadDriverFactory(const char* pchPath)
+{
+#if defined(_WIN32)
+	HMODULE hModule = LoadLibraryA(pchPath);
+	return hModule ? (HmdDriverFactoryFn)GetProcAddress(hModule, "HmdDriverFactory") : nullptr;
+#else
+	void* pModule = dlopen(pchPath, RTLD_NOW | RTLD_LOCAL);
+	return pModule ? (HmdDriverFactoryFn)dlsym(pModule, "HmdDriverFactory") : nullptr;
+#endif
+}
+
+// the driver runs in this process, so its memory and threads are this process's
+static bool GetProcessFootprint(double* pflRssMb, uint32_t* punThreads)
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return false;
+	*pflRssMb = counters.WorkingSetSize / (1024.0 * 1024.0);
+
+	HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+	if (hSnapshot == INVALID_HANDLE_VALUE)
+		return false;
+	uint32_t unThreads = 0;
+	THREADENTRY32 entry;
+	entry.dwSize = sizeof(entry);
+	for (BOOL bMore = Thread32First(hSnapshot, &entry); bMore; bMore = Thread32Next(hSnapshot, &entry))
+	{
+		if (entry.th32OwnerProcessID == GetCurrentProcessId())
+			unThreads++;
+	}
+	CloseHandle(hSnapshot);
+	*punThreads = unThreads;
+	return true;
+#else
+	FILE* pFile = fopen("/proc/self/status", "r");
+	if (!pFile)
+		return false;
+	char rgchLine[256];
+	bool bRss = false, bThreads = false;
+	while (fgets(rgchLine, sizeof(rgchLine), pFile))
+	{
+		unsigned long ulValue;
+		if (sscanf(rgchLine, "VmRSS: %lu kB", &ulValue) == 1)
+		{
+			*pflRssMb = ulValue / 1024.0;
+			bRss = true;
+		}
+		else if (sscanf(rgchLine, "Threads: %lu", &ulValue) == 1)
+		{
+			*punThreads = (uint32_t)ulValue;
+			bThreads = true;
+		}
+	}
+	fclose(pFile);
+	return bRss && bThreads;
+#endif
+}
+
+// the number after "key": at or after pchFrom, which is where the object of interest starts
+static bool FindJsonNumber(const char* pchFrom, const char* pchKey, double* pflValue)
+{
+	if (!pchFrom)
+		return false;
+	char rgchPattern[96];
+	snprintf(rgchPattern, sizeof(rgchPattern), "\"%s\":", pchKey);
+	const char* pch = strstr(pchFrom, rgchPattern);
+	if (!pch)
+		return false;
+	char* pchEnd;
+	*pflValue = strtod(pch + strlen(rgchPattern), &pchEnd);
+	return pchEnd != pch + strlen(rgchPattern);
+}
+
+static const char* FindJsonObject(const char* pchFrom, const char* pchKey)
+{
+	if (!pchFrom)
+		return nullptr;
+	char rgchPattern[96];
+	snprintf(rgchPattern, sizeof(rgchPattern), "\"%s\":{", pchKey);
+	const char* pch = strstr(pchFrom, rgchPattern);
+	return pch ? pch + strlen(rgchPattern) : nullptr;
+}
+
+// the pose threads' heap calls since they started, from the stats' "allocations" object
+static bool GetAllocationCount(const char* pchStats, double* pflCount)
+{
+	const char* pchAllocations = FindJsonObject(pchStats, "allocations");
+	double flGrab, flImu;
+	if (!FindJsonNumber(FindJsonObject(pchAllocations, "grab"), "new", &flGrab) || !FindJsonNumber(FindJsonObject(pchAllocations, "imu"), "new", &flImu))
+		return false;
+	*pflCount = flGrab + flImu;
+	return true;
+}
+
+static double Average(const std::vector<SoakSample_t>& vecSamples, size_t unBegin, size_t unEnd, double SoakSample_t::*pMember)
+{
+	double flSum = 0.0;
+	for (size_t i = unBegin; i < unEnd; i++)
+		flSum += vecSamples[i].*pMember;
+	return unEnd > unBegin ? flSum / (unEnd - unBegin) : 0.0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <driver dll> [--hours N] [--sample-seconds N] [--warmup-minutes N] [--csv file] [--ndjson file]\n"
+			"       [--max-rss-mb-per-hour N] [--max-gpu-mb-per-hour N] [--max-p99-growth fraction] [--max-thread-growth N]\n"
+			"       [section/key=value ...]\n", argv[0]);
+		return 1;
+	}
+
+	CMockDriverContext context;
+	context.m_host.SetRecordPoses(false);
+	double flHours = 24.0;
+	double flSampleSeconds = 60.0;
+	double flWarmupMinutes = 10.0;
+	const char* pchCsvPath = nullptr;
+	const char* pchNdjsonPath = nullptr;
+	double flMaxRssMbPerHour = 20.0;
+	double flMaxGpuMbPerHour = 50.0;
+	double flMaxP99Growth = 0.25;
+	int nMaxThreadGrowth = 0;
+
+	for (int i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--hours") == 0 && i + 1 < argc)
+			flHours = atof(argv[++i]);
+		else if (strcmp(argv[i], "--sample-seconds") == 0 && i + 1 < argc)
+			flSampleSeconds = std::max(atof(argv[++i]), 1.0);
+		else if (strcmp(argv[i], "--warmup-minutes") == 0 && i + 1 < argc)
+			flWarmupMinutes = atof(argv[++i]);
+		else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+			pchCsvPath = argv[++i];
+		else if (strcmp(argv[i], "--ndjson") == 0 && i + 1 < argc)
+			pchNdjsonPath = argv[++i];
+		else if (strcmp(argv[i], "--max-rss-mb-per-hour") == 0 && i + 1 < argc)
+			flMaxRssMbPerHour = atof(argv[++i]);
+		else if (strcmp(argv[i], "--max-gpu-mb-per-hour") == 0 && i + 1 < argc)
+			flMaxGpuMbPerHour = atof(argv[++i]);
+		else if (strcmp(argv[i], "--max-p99-growth") == 0 && i + 1 < argc)
+			flMaxP99Growth = atof(argv[++i]);
+		else if (strcmp(argv[i], "--max-thread-growth") == 0 && i + 1 < argc)
+			nMaxThreadGrowth = atoi(argv[++i]);
+		else if (!context.m_settings.ParseAssignment(argv[i]))
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	FILE* pCsv = nullptr;
+	if (pchCsvPath)
+	{
+		pCsv = fopen(pchCsvPath, "w");
+		if (!pCsv)
+		{
+			fprintf(stderr, "Unable to create %s\n", pchCsvPath);
+			return 1;
+		}
+		fprintf(pCsv, "elapsed_s,rss_mb,gpu_used_mb,threads,pose_rate,allocations_per_s");
+		for (int i = 0; i < LatencyStage_Count; i++)
+			fprintf(pCsv, ",%s_p99_us", GetLatencyStageName((ELatencyStage)i));
+		fprintf(pCsv, "\n");
+	}
+
+	CNdjsonWriter ndjson;
+	if (pchNdjsonPath && !ndjson.Open(pchNdjsonPath))
+	{
+		fprintf(stderr, "Unable to create %s\n", pchNdjsonPath);
+		return 1;
+	}
+
+	HmdDriverFactoryFn pFactory = LoadDriverFactory(argv[1]);
+	if (!pFactory)
+	{
+		fprintf(stderr, "Unable to load HmdDriverFactory from %s\n", argv[1]);
+		return 1;
+	}
+
+	int nError = vr::VRInitError_None;
+	vr::IServerTrackedDeviceProvider* pProvider = (vr::IServerTrackedDeviceProvider*)pFactory(vr::IServerTrackedDeviceProvider_Version, &nError);
+	if (!pProvider)
+	{
+		fprintf(stderr, "Driver has no %s (error %d)\n", vr::IServerTrackedDeviceProvider_Version, nError);
+		return 1;
+	}
+
+	vr::EVRInitError eInitError = pProvider->Init(&context);
+	if (eInitError != vr::VRInitError_None)
+	{
+		fprintf(stderr, "Driver Init failed with %d\n", (int)eInitError);
+		return 1;
+	}
+
+	std::vector<MockTrackedDevice_t> vecDevices = context.m_host.GetDevices();
+	if (vecDevices.empty())
+	{
+		fprintf(stderr, "The driver added no device\n");
+		pProvider->Cleanup();
+		return 1;
+	}
+	for (uint32_t i = 0; i < vecDevices.size(); i++)
+		vecDevices[i].pDriver->Activate(i);
+	vr::ITrackedDeviceServerDriver* pDevice = vecDevices[0].pDriver;
+
+	std::vector<char> vecStats(k_unStatsBufferSize);
+	std::string sRecord;
+	char rgchReply[256];
+	std::vector<SoakSample_t> vecSamples;
+	vecSamples.reserve((size_t)(flHours * 3600.0 / flSampleSeconds) + 1);
+
+	auto start = std::chrono::steady_clock::now();
+	auto nextFrame = start;
+	auto nextSample = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(flSampleSeconds));
+	auto lastSample = start;
+	uint64_t ulLastPoses = context.m_host.GetPoseUpdateCount();
+	double flLastAllocations = -1.0;
+	pDevice->DebugRequest("latency_reset", rgchReply, sizeof(rgchReply));
+
+	while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < flHours * 3600.0)
+	{
+		pProvider->RunFrame();
+		nextFrame += k_RunFrameInterval;
+		std::this_thread::sleep_until(nextFrame);
+
+		auto now = std::chrono::steady_clock::now();
+		if (now < nextSample)
+			continue;
+
+		// the percentiles cover the interval since the last sample, not the whole run
+		vecStats[0] = 0;
+		pDevice->DebugRequest("stats", vecStats.data(), k_unStatsBufferSize);
+		pDevice->DebugRequest("latency_reset", rgchReply, sizeof(rgchReply));
+		double flInterval = std::chrono::duration<double>(now - lastSample).count();
+		lastSample = now;
+		nextSample += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(flSampleSeconds));
+
+		SoakSample_t sample;
+		sample.flElapsedSeconds = std::chrono::duration<double>(now - start).count();
+		sample.flRssMb = 0.0;
+		sample.unThreads = 0;
+		GetProcessFootprint(&sample.flRssMb, &sample.unThreads);
+		const char* pchStats = vecStats.data();
+		if (!FindJsonNumber(FindJsonObject(pchStats, "memory"), "gpu_used_mb", &sample.flGpuUsedMb))
+			sample.flGpuUsedMb = -1.0;
+		uint64_t ulPoses = context.m_host.GetPoseUpdateCount();
+		sample.flPoseRate = (ulPoses - ulLastPoses) / flInterval;
+		ulLastPoses = ulPoses;
+		double flAllocations;
+		sample.flAllocationsPerSecond = -1.0;
+		if (GetAllocationCount(pchStats, &flAllocations))
+		{
+			if (flLastAllocations >= 0.0)
+				sample.flAllocationsPerSecond = (flAllocations - flLastAllocations) / flInterval;
+			flLastAllocations = flAllocations;
+		}
+		const char* pchLatency = FindJsonObject(pchStats, "latency_us");
+		for (int i = 0; i < LatencyStage_Count; i++)
+		{
+			const char* pchStage = FindJsonObject(pchLatency, GetLatencyStageName((ELatencyStage)i));
+			double flCount;
+			if (!FindJsonNumber(pchStage, "n", &flCount) || flCount == 0.0 || !FindJsonNumber(pchStage, "p99", &sample.rgflP99Us[i]))
+				sample.rgflP99Us[i] = -1.0;
+		}
+		vecSamples.push_back(sample);
+
+		printf("%8.0f s: rss %.0f MB, gpu %.0f MB, %u threads, %.1f poses/s\n", sample.flElapsedSeconds, sample.flRssMb, sample.flGpuUsedMb,
+			sample.unThreads, sample.flPoseRate);
+		if (pCsv)
+		{
+			fprintf(pCsv, "%.0f,%.1f,%.0f,%u,%.1f,%.1f", sample.flElapsedSeconds, sample.flRssMb, sample.flGpuUsedMb, sample.unThreads,
+				sample.flPoseRate, sample.flAllocationsPerSecond);
+			for (int i = 0; i < LatencyStage_Count; i++)
+				fprintf(pCsv, ",%.0f", sample.rgflP99Us[i]);
+			fprintf(pCsv, "\n");
+			fflush(pCsv);
+		}
+		if (ndjson.IsOpen())
+		{
+			// the reply is an object already, so it's spliced in rather than parsed
+			char rgchElapsed[64];
+			snprintf(rgchElapsed, sizeof(rgchElapsed), "{\"elapsed_s\":%.3f,\"stats\":", sample.flElapsedSeconds);
+			sRecord = rgchElapsed;
+			sRecord += pchStats[0] ? pchStats : "null";
+			sRecord += '}';
+			ndjson.WriteLine(sRecord.data(), sRecord.size());
+			ndjson.Flush();
+		}
+	}
+
+	context.m_host.SetExiting(true);
+	for (uint32_t i = 0; i < vecDevices.size(); i++)
+		vecDevices[i].pDriver->Deactivate();
+	pProvider->Cleanup();
+	if (pCsv)
+		fclose(pCsv);
+	if (ndjson.IsOpen() && !ndjson.Close())
+		fprintf(stderr, "Writing %s failed\n", pchNdjsonPath);
+
+	// the samples after the warm-up, and of those the first and last windows
+	size_t unFirst = 0;
+	while (unFirst < vecSamples.size() && vecSamples[unFirst].flElapsedSeconds < flWarmupMinutes * 60.0)
+		unFirst++;
+	size_t unCount = vecSamples.size() - unFirst;
+	if (unCount < 2)
+	{
+		fprintf(stderr, "Too few samples after the warm-up to compare\n");
+		return 1;
+	}
+	size_t unWindow = std::max<size_t>(1, (size_t)(unCount * k_flCompareFraction));
+	size_t unLast = vecSamples.size() - unWindow;
+	double flHoursApart = (Average(vecSamples, unLast, vecSamples.size(), &SoakSample_t::flElapsedSeconds)
+		- Average(vecSamples, unFirst, unFirst + unWindow, &SoakSample_t::flElapsedSeconds)) / 3600.0;
+	bool bFailed = false;
+
+	double flRssEarly = Average(vecSamples, unFirst, unFirst + unWindow, &SoakSample_t::flRssMb);
+	double flRssLate = Average(vecSamples, unLast, vecSamples.size(), &SoakSample_t::flRssMb);
+	double flRssRate = flHoursApart > 0.0 ? (flRssLate - flRssEarly) / flHoursApart : 0.0;
+	bool bRssDrift = flRssRate > flMaxRssMbPerHour;
+	printf("rss:     %.0f -> %.0f MB, %+.1f MB/h%s\n", flRssEarly, flRssLate, flRssRate, bRssDrift ? "  DRIFT" : "");
+	bFailed = bFailed || bRssDrift;
+
+	if (vecSamples[unFirst].flGpuUsedMb >= 0.0 && vecSamples.back().flGpuUsedMb >= 0.0)
+	{
+		double flGpuEarly = Average(vecSamples, unFirst, unFirst + unWindow, &SoakSample_t::flGpuUsedMb);
+		double flGpuLate = Average(vecSamples, unLast, vecSamples.size(), &SoakSample_t::flGpuUsedMb);
+		double flGpuRate = flHoursApart > 0.0 ? (flGpuLate - flGpuEarly) / flHoursApart : 0.0;
+		bool bGpuDrift = flGpuRate > flMaxGpuMbPerHour;
+		printf("gpu:     %.0f -> %.0f MB, %+.1f MB/h%s\n", flGpuEarly, flGpuLate, flGpuRate, bGpuDrift ? "  DRIFT" : "");
+		bFailed = bFailed || bGpuDrift;
+	}
+
+	uint32_t unThreadsEarly = vecSamples[unFirst].unThreads;
+	uint32_t unThreadsLate = 0;
+	for (size_t i = unLast; i < vecSamples.size(); i++)
+		unThreadsLate = std::max(unThreadsLate, vecSamples[i].unThreads);
+	bool bThreadDrift = (int)unThreadsLate - (int)unThreadsEarly > nMaxThreadGrowth;
+	printf("threads: %u -> %u%s\n", unThreadsEarly, unThreadsLate, bThreadDrift ? "  DRIFT" : "");
+	bFailed = bFailed || bThreadDrift;
+
+	if (vecSamples[unFirst].flAllocationsPerSecond >= 0.0)
+	{
+		double flAllocEarly = Average(vecSamples, unFirst, unFirst + unWindow, &SoakSample_t::flAllocationsPerSecond);
+		double flAllocLate = Average(vecSamples, unLast, vecSamples.size(), &SoakSample_t::flAllocationsPerSecond);
+		// steady tracking allocates nothing on the pose threads, so any rise is a regression
+		bool bAllocDrift = flAllocLate > flAllocEarly + 1.0;
+		printf("allocs:  %.1f -> %.1f /s%s\n", flAllocEarly, flAllocLate, bAllocDrift ? "  DRIFT" : "");
+		bFailed = bFailed || bAllocDrift;
+	}
+
+	double flRateEarly = Average(vecSamples, unFirst, unFirst + unWindow, &SoakSample_t::flPoseRate);
+	double flRateLate = Average(vecSamples, unLast, vecSamples.size(), &SoakSample_t::flPoseRate);
+	bool bRateDrop = flRateLate < flRateEarly * 0.9;
+	printf("poses:   %.1f -> %.1f /s%s\n", flRateEarly, flRateLate, bRateDrop ? "  DROP" : "");
+	bFailed = bFailed || bRateDrop;
+
+	for (int i = 0; i < LatencyStage_Count; i++)
+	{
+		double flEarly = 0.0, flLate = 0.0;
+		int nEarly = 0, nLate = 0;
+		for (size_t j = unFirst; j < unFirst + unWindow; j++)
+		{
+			if (vecSamples[j].rgflP99Us[i] >= 0.0)
+			{
+				flEarly += vecSamples[j].rgflP99Us[i];
+				nEarly++;
+			}
+		}
+		for (size_t j = unLast; j < vecSamples.size(); j++)
+		{
+			if (vecSamples[j].rgflP99Us[i] >= 0.0)
+			{
+				flLate += vecSamples[j].rgflP99Us[i];
+				nLate++;
+			}
+		}
+		if (nEarly == 0 || nLate == 0)
+			continue;
+		flEarly /= nEarly;
+		flLate /= nLate;
+		bool bDrift = flLate > flEarly * (1.0 + flMaxP99Growth) && flLate - flEarly > k_flMinP99GrowthUs;
+		printf("%-18s p99 %6.0f -> %6.0f us%s\n", GetLatencyStageName((ELatencyStage)i), flEarly, flLate, bDrift ? "  DRIFT" : "");
+		bFailed = bFailed || bDrift;
+	}
+
+	printf("%s after %.1f h, %zu samples\n", bFailed ? "FAILED" : "passed", vecSamples.back().flElapsedSeconds / 3600.0, vecSamples.size());
+	return bFailed ? 1 : 0;
+}
@@ -0,0 +1,149 @@
+//-----------------------------------------------------------------------------
+// Purpose: Dashboard overlay showing a device's pipeline health in the
+// headset: tracking state, pose and IMU rates, grabbed and dropped frames, the
+// nearest proximityWarning obstacle and the latency percentiles of every stage. It reads the sharedMemoryExport
+// stats segment and draws through the helloworldoverlay sample's
+// COpenVROverlayController. The text is refreshed at a low rate and is only
+// repainted when it changes.
+//
+// usage: zedm_statusoverlay <device serial, e.g. ZED_12345> [--rate hz]
+//-----------------------------------------------------------------------------
+#include "openvroverlaycontroller.h"
+#include "sharedstats.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTimer>
+#include <QtGui/QFontDatabase>
+#include <QtWidgets/QApplication>
+#include <QtWidgets/QLabel>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+// the driver writes every k_ulSharedStatsIntervalNs; after this long without a write it is not publishing
+static const qint64 k_nStaleMs = 2000;
+
+static void AppendLine(std::string* psText, const char* pchFormat, ...)
+{
+	char rgchLine[256];
+	va_list args;
+	va_start(args, pchFormat);
+	vsnprintf(rgchLine, sizeof(rgchLine), pchFormat, args);
+	va_end(args);
+	*psText += rgchLine;
+	*psText += '\n';
+}
+
+static std::string FormatStats(const SharedStats_t& stats)
+{
+	std::string sText;
+	AppendLine(&sText, "tracking  %s%s%s%s%s", stats.rgchTrackingState,
+		(stats.unFlags & SharedStatsFlag_DeadReckoning) ? ", dead reckoning" : "",
+		(stats.unFlags & SharedStatsFlag_Relocalizing) ? ", relocalizing" : "",
+		(stats.unFlags & SharedStatsFlag_GrabStalled) ? ", GRAB STALLED" : "",
+		(stats.unFlags & SharedStatsFlag_ImuPublisher) ? "" : ", no IMU publisher");
+	AppendLine(&sText, "poses     %7.1f/s  %llu published", stats.flPosePublishRate, (unsigned long long)stats.ulPosesPublished);
+	AppendLine(&sText, "imu       %7.1f/s", stats.flImuRate);
+	AppendLine(&sText, "grab      %7.1f/s  %llu grabbed, %llu dropped, %llu failed, %llu stalls", stats.flGrabFps,
+		(unsigned long long)stats.ulFramesGrabbed, (unsigned long long)stats.ulFramesDropped,
+		(unsigned long long)stats.ulGrabFailures, (unsigned long long)stats.ulGrabStalls);
+	if (stats.unProximitySectors != 0)
+	{
+		// the nearest sector's distance and the direction of its center, positive to the right
+		int nNearest = -1;
+		for (uint32_t i = 0; i < stats.unProximitySectors && i < k_unMaxProximitySectors; i++)
+		{
+			if (stats.rgflProximity[i] >= 0.0f && (nNearest < 0 || stats.rgflProximity[i] < stats.rgflProximity[nNearest]))
+				nNearest = (int)i;
+		}
+		if (nNearest < 0)
+			AppendLine(&sText, "nearest   nothing within %.1f m", stats.flProximityRange);
+		else
+			AppendLine(&sText, "nearest   %7.2f m  at %+.0f degrees", stats.rgflProximity[nNearest],
+				(stats.flProximityFirstAngle + (nNearest + 0.5f) * stats.flProximitySectorAngle) * 180.0f / 3.14159265f);
+	}
+	AppendLine(&sText, "");
+	AppendLine(&sText, "latency us          %8s %8s %8s %8s %8s", "n", "p50", "p95", "p99", "max");
+	for (int i = 0; i < LatencyStage_Count; i++)
+	{
+		const LatencySummary_t& summary = stats.rgLatency[i];
+		AppendLine(&sText, "%-19s %8llu %8.0f %8.0f %8.0f %8.0f", GetLatencyStageName((ELatencyStage)i),
+			(unsigned long long)summary.ulCount, summary.flP50Us, summary.flP95Us, summary.flP99Us, summary.flMaxUs);
+	}
+	return sText;
+}
+
+int main(int argc, char** argv)
+{
+	QApplication app(argc, argv);
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <device serial> [--rate hz]\n", argv[0]);
+		return 1;
+	}
+	double flRate = argc > 3 && strcmp(argv[2], "--rate") == 0 ? atof(argv[3]) : 2.0;
+	if (flRate <= 0.0)
+		flRate = 2.0;
+
+	std::string sName = GetSharedStatsName(argv[1]);
+	CSharedStatsReader reader;
+
+	QLabel* pLabel = new QLabel();
+	pLabel->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+	pLabel->setAlignment(Qt::AlignLeft | Qt::AlignTop);
+	pLabel->setAutoFillBackground(true);
+	pLabel->setMargin(8);
+	pLabel->resize(640, 320);
+
+	COpenVROverlayController* pController = COpenVROverlayController::SharedInstance();
+	pController->Init("zedm_status");
+	pController->SetWidget(pLabel);
+
+	bool bHaveStats = false;
+	SharedStats_t lastStats;
+	uint64_t ulLastWrite = 0;
+	QElapsedTimer sinceWrite;
+	sinceWrite.start();
+
+	QTimer refreshTimer;
+	QObject::connect(&refreshTimer, &QTimer::timeout, [&]()
+	{
+		// QLabel ignores unchanged text, so a steady display costs no repaint or texture submit
+		if (!reader.IsOpen() && !reader.Open(sName))
+		{
+			pLabel->setText(QString("Waiting for %1; is sharedMemoryExport on and the device active?").arg(sName.c_str()));
+			return;
+		}
+
+		SharedStats_t stats;
+		uint64_t ulWrite;
+		if (reader.Read(&stats, &ulWrite) && (!bHaveStats || ulWrite != ulLastWrite))
+		{
+			bHaveStats = true;
+			lastStats = stats;
+			ulLastWrite = ulWrite;
+			sinceWrite.restart();
+			pLabel->setText(QString::fromStdString(FormatStats(lastStats)));
+		}
+		else if (!bHaveStats)
+		{
+			pLabel->setText(QString("Waiting for the first stats in %1").arg(sName.c_str()));
+		}
+		else if (sinceWrite.elapsed() > k_nStaleMs)
+		{
+			char rgchHeader[64];
+			snprintf(rgchHeader, sizeof(rgchHeader), "NOT UPDATING for %lld s\n\n", (long long)(sinceWrite.elapsed() / 1000));
+			pLabel->setText(rgchHeader + QString::fromStdString(FormatStats(lastStats)));
+		}
+	});
+	refreshTimer.start((int)(1000.0 / flRate));
+
+	int nResult = app.exec();
+	pController->Shutdown();
+	return nResult;
+}
@@ -0,0 +1,109 @@
+//-----------------------------------------------------------------------------
+// Purpose: Runs threads on the driver's CPreciseTimer at a fixed rate, each
+// spinning for a given time per tick, and reports how late the wake-ups were
+// and how many ticks were missed. With one thread and no work it shows what
+// the IMU publisher can expect from this host; with more threads and work it
+// is a synthetic load to run next to SteamVR or the other benchmarks.
+//
+// usage: zedm_timerbench [--rate hz] [--threads n] [--work us] [--seconds n]
+//-----------------------------------------------------------------------------
+#include "latencystats.h"
+#include "precisetimer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+struct TimerThread_t
+{
+	CLatencyHistogram lateness;
+	uint64_t ulTicks;
+	uint64_t ulMissedTicks;
+	bool bHighResolution;
+};
+
+static void RunTimerThread(TimerThread_t* pThread, uint64_t ulPeriodNs, std::chrono::microseconds work, const std::atomic<bool>* pbStop)
+{
+	CPreciseTimer timer;
+	timer.Start(ulPeriodNs, &pThread->lateness);
+	pThread->bHighResolution = timer.IsHighResolution();
+
+	while (!pbStop->load(std::memory_order_relaxed))
+	{
+		timer.WaitForNextTick();
+		pThread->ulTicks++;
+
+		// spin rather than sleep, the point is to keep a core busy like a publisher does
+		auto spinUntil = std::chrono::steady_clock::now() + work;
+		while (std::chrono::steady_clock::now() < spinUntil)
+		{
+		}
+	}
+	pThread->ulMissedTicks = timer.GetMissedTicks();
+}
+
+int main(int argc, char** argv)
+{
+	double flRate = 800.0;
+	int nThreads = 1;
+	int nWorkUs = 0;
+	int nSeconds = 10;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "--rate") == 0)
+			flRate = atof(argv[i + 1]);
+		else if (strcmp(argv[i], "--threads") == 0)
+			nThreads = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--work") == 0)
+			nWorkUs = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--seconds") == 0)
+			nSeconds = atoi(argv[i + 1]);
+		else
+		{
+			fprintf(stderr, "usage: %s [--rate hz] [--threads n] [--work us] [--seconds n]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (flRate <= 0.0 || nThreads < 1 || nWorkUs < 0 || nSeconds < 1)
+	{
+		fprintf(stderr, "rate, threads and seconds must be positive\n");
+		return 1;
+	}
+
+	uint64_t ulPeriodNs = (uint64_t)(1e9 / flRate);
+	printf("%d thread(s) at %.1f Hz (%.1f us period), %d us of work per tick, %d s\n",
+		nThreads, flRate, ulPeriodNs / 1000.0, nWorkUs, nSeconds);
+
+	std::atomic<bool> bStop(false);
+	std::vector<TimerThread_t> vecThreads(nThreads);
+	std::vector<std::thread> vecWorkers;
+	for (int i = 0; i < nThreads; i++)
+	{
+		vecThreads[i].ulTicks = 0;
+		vecThreads[i].ulMissedTicks = 0;
+		vecThreads[i].bHighResolution = false;
+		vecWorkers.emplace_back(RunTimerThread, &vecThreads[i], ulPeriodNs, std::chrono::microseconds(nWorkUs), &bStop);
+	}
+
+	std::this_thread::sleep_for(std::chrono::seconds(nSeconds));
+	bStop.store(true, std::memory_order_relaxed);
+	for (std::thread& worker : vecWorkers)
+		worker.join();
+
+	printf("\nlateness us  %10s %8s %8s %8s %8s %8s %8s\n", "ticks", "missed", "p50", "p95", "p99", "max", "timer");
+	for (int i = 0; i < nThreads; i++)
+	{
+		const TimerThread_t& thread = vecThreads[i];
+		LatencySummary_t summary = thread.lateness.Summarize();
+		printf("thread %-5d %10llu %8llu %8.0f %8.0f %8.0f %8.0f %8s\n", i,
+			(unsigned long long)thread.ulTicks, (unsigned long long)thread.ulMissedTicks,
+			summary.flP50Us, summary.flP95Us, summary.flP99Us, summary.flMaxUs,
+			thread.bHighResolution ? "high-res" : "1 ms");
+	}
+	return 0;
+}